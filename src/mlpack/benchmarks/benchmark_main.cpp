@@ -0,0 +1,443 @@
+/**
+ * @file benchmark_main.cpp
+ *
+ * Times tree construction and dual-tree (or single-tree) search for each of
+ * the tree types in mlpack, over synthetic and real datasets, and writes the
+ * results to a CSV file so that they can be compared across releases.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/core/tree/ballbound.hpp>
+#include <mlpack/core/tree/binary_space_tree.hpp>
+#include <mlpack/core/tree/cover_tree.hpp>
+#include <mlpack/core/tree/rectangle_tree.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <mlpack/methods/range_search/range_search.hpp>
+
+#include "benchmark_util.hpp"
+
+#include <fstream>
+
+PROGRAM_INFO("Tree benchmarks", "This program times tree construction and "
+    "search with each of mlpack's tree types, and saves the timings to a CSV "
+    "file.  It is meant for tracking the performance of mlpack across "
+    "releases, so the output of two versions can be compared directly."
+    "\n\n"
+    "Each dataset is either a synthetic dataset (one of each combination of "
+    "--distributions, --sizes and --dimensions) or a file given in --datasets "
+    "(a comma-separated list).  For each dataset, each tree type in --trees "
+    "and each leaf size in --leaf_sizes, the reference tree is built and all-"
+    "k-nearest-neighbors is run for each k in --k; if --range is given, range "
+    "search with that range is run too.  Each measurement is repeated "
+    "--trials times.  Tree types are 'kd', 'ball', 'cover', 'r', 'r-star' and "
+    "'x'; cover trees have no leaf size, so they are only run once for each "
+    "dataset, with a leaf size of 0 in the output."
+    "\n\n"
+    "Each row of the output file is one measurement: the mlpack version, the "
+    "dataset, its size and dimensionality, the tree type, leaf size, task "
+    "('knn' or 'range'), task parameter (k or the range), search mode, trial, "
+    "the tree building and search times in seconds, the number of base cases "
+    "and node combinations scored (for k-nearest-neighbors), and the number of "
+    "results.");
+
+PARAM_STRING("output_file", "File to save the results to (CSV).", "o",
+    "benchmark.csv");
+PARAM_STRING("datasets", "Comma-separated list of dataset files to run on, in "
+    "addition to the synthetic datasets.", "D", "");
+PARAM_STRING("distributions", "Comma-separated list of synthetic dataset "
+    "distributions: 'uniform', 'gaussian' and/or 'clustered'.  Use '' for no "
+    "synthetic datasets.", "u", "uniform,gaussian,clustered");
+PARAM_STRING("sizes", "Comma-separated list of synthetic dataset sizes.", "n",
+    "10000,100000");
+PARAM_STRING("dimensions", "Comma-separated list of synthetic dataset "
+    "dimensionalities.", "d", "2,5,10");
+PARAM_STRING("trees", "Comma-separated list of tree types to run.", "T",
+    "kd,ball,cover,r,r-star,x");
+PARAM_STRING("leaf_sizes", "Comma-separated list of leaf sizes.", "l", "20");
+PARAM_STRING("k", "Comma-separated list of numbers of nearest neighbors to "
+    "find.", "k", "1,5");
+PARAM_DOUBLE("range", "If greater than 0, also run range search for all "
+    "points within this distance.", "r", 0.0);
+PARAM_STRING("modes", "Comma-separated list of search modes: 'dual' and/or "
+    "'single'.", "m", "dual");
+PARAM_INT("trials", "Number of times to repeat each measurement.", "t", 3);
+PARAM_INT("threads", "Number of threads to use for searches (0 uses all "
+    "available cores; ignored if mlpack was built without OpenMP).", "H", 1);
+PARAM_FLAG("bulk_load", "If true, build rectangle trees with Sort-Tile-"
+    "Recursive bulk loading instead of inserting the points one by one.", "b");
+PARAM_INT("seed", "Random seed for the synthetic datasets.", "s", 42);
+
+using namespace mlpack;
+using namespace mlpack::benchmark;
+using namespace mlpack::neighbor;
+using namespace mlpack::range;
+using namespace mlpack::tree;
+using namespace mlpack::metric;
+using namespace mlpack::bound;
+using namespace std;
+
+/**
+ * Settings shared by every measurement, and the stream the results are written
+ * to.
+ */
+struct BenchmarkSettings
+{
+  vector<size_t> leafSizes;
+  vector<size_t> k;
+  double range;
+  vector<string> modes;
+  size_t trials;
+  size_t threads;
+  bool bulkLoad;
+  ofstream output;
+};
+
+/**
+ * Each tree type is described by a class with its name, the tree type with a
+ * given statistic (Tree<StatisticType>::Type), whether it has a leaf size, and
+ * a function to build the tree on a dataset.
+ */
+struct KDTreeType
+{
+  static string Name() { return "kd"; }
+  static bool HasLeafSize() { return true; }
+
+  template<typename StatisticType>
+  struct Tree
+  {
+    typedef BinarySpaceTree<HRectBound<2>, StatisticType> Type;
+  };
+
+  template<typename TreeType>
+  static TreeType* Build(arma::mat& data,
+                         const size_t leafSize,
+                         const bool /* bulkLoad */)
+  {
+    // Store the tree contiguously, as allknn does.
+    TreeType* tree = new TreeType(data, leafSize);
+    tree->Compact();
+    return tree;
+  }
+};
+
+struct BallTreeType
+{
+  static string Name() { return "ball"; }
+  static bool HasLeafSize() { return true; }
+
+  template<typename StatisticType>
+  struct Tree
+  {
+    typedef BinarySpaceTree<BallBound<arma::vec, LMetric<2, true> >,
+        StatisticType> Type;
+  };
+
+  template<typename TreeType>
+  static TreeType* Build(arma::mat& data,
+                         const size_t leafSize,
+                         const bool /* bulkLoad */)
+  {
+    TreeType* tree = new TreeType(data, leafSize);
+    tree->Compact();
+    return tree;
+  }
+};
+
+struct CoverTreeType
+{
+  static string Name() { return "cover"; }
+  static bool HasLeafSize() { return false; }
+
+  template<typename StatisticType>
+  struct Tree
+  {
+    typedef CoverTree<LMetric<2, true>, FirstPointIsRoot, StatisticType> Type;
+  };
+
+  template<typename TreeType>
+  static TreeType* Build(arma::mat& data,
+                         const size_t /* leafSize */,
+                         const bool /* bulkLoad */)
+  {
+    // Use the same base as allknn.
+    return new TreeType(data, 1.3);
+  }
+};
+
+/**
+ * All the rectangle tree types are built the same way; only the split and
+ * descent heuristic differ.
+ */
+template<template<typename, typename, typename> class SplitType,
+         typename DescentType>
+struct RectangleTreeType
+{
+  static string Name();
+  static bool HasLeafSize() { return true; }
+
+  template<typename StatisticType>
+  struct Tree
+  {
+    typedef RectangleTree<SplitType<DescentType, StatisticType, arma::mat>,
+        DescentType, StatisticType, arma::mat> Type;
+  };
+
+  template<typename TreeType>
+  static TreeType* Build(arma::mat& data,
+                         const size_t leafSize,
+                         const bool bulkLoad)
+  {
+    // Use the same parameters as allknn.
+    return new TreeType(data, leafSize, leafSize * 0.4, 5, 2, 0, bulkLoad);
+  }
+};
+
+template<>
+string RectangleTreeType<RTreeSplit, RTreeDescentHeuristic>::Name()
+{ return "r"; }
+
+template<>
+string RectangleTreeType<RStarTreeSplit, RStarTreeDescentHeuristic>::Name()
+{ return "r-star"; }
+
+template<>
+string RectangleTreeType<XTreeSplit, RStarTreeDescentHeuristic>::Name()
+{ return "x"; }
+
+//! Write one measurement to the output file.
+void WriteResult(BenchmarkSettings& settings,
+                 const string& dataset,
+                 const arma::mat& data,
+                 const string& tree,
+                 const size_t leafSize,
+                 const string& task,
+                 const double parameter,
+                 const string& mode,
+                 const size_t trial,
+                 const double buildTime,
+                 const double searchTime,
+                 const size_t baseCases,
+                 const size_t scores,
+                 const size_t results)
+{
+  settings.output << util::GetVersion() << "," << dataset << "," << data.n_cols
+      << "," << data.n_rows << "," << tree << "," << leafSize << "," << task
+      << "," << parameter << "," << mode << "," << trial << "," << buildTime
+      << "," << searchTime << "," << baseCases << "," << scores << ","
+      << results << endl;
+
+  Log::Info << dataset << ", " << tree << " tree (leaf size " << leafSize
+      << "), " << task << " " << parameter << ", " << mode << " mode: built in "
+      << buildTime << "s, searched in " << searchTime << "s." << endl;
+}
+
+//! Run every measurement for the given tree type on the given dataset.
+template<typename TreeKind>
+void Benchmark(BenchmarkSettings& settings,
+               const string& dataset,
+               const arma::mat& data)
+{
+  typedef typename TreeKind::template Tree<
+      NeighborSearchStat<NearestNeighborSort> >::Type KNNTreeType;
+  typedef typename TreeKind::template Tree<RangeSearchStat>::Type
+      RangeTreeType;
+
+  // Trees without a leaf size are only run once.
+  vector<size_t> leafSizes = settings.leafSizes;
+  if (!TreeKind::HasLeafSize())
+    leafSizes.assign(1, 0);
+
+  for (size_t l = 0; l < leafSizes.size(); ++l)
+  {
+    for (size_t m = 0; m < settings.modes.size(); ++m)
+    {
+      const bool singleMode = (settings.modes[m] == "single");
+
+      for (size_t trial = 0; trial < settings.trials; ++trial)
+      {
+        // The tree statistics hold the bounds found by a search, so each
+        // search gets a freshly built tree.  Tree building may also reorder
+        // the data, so each tree gets its own copy.
+        for (size_t i = 0; i < settings.k.size(); ++i)
+        {
+          arma::mat knnData(data);
+          double start = Timer::Now();
+          KNNTreeType* knnTree = TreeKind::template Build<KNNTreeType>(
+              knnData, leafSizes[l], settings.bulkLoad);
+          const double buildTime = Timer::Now() - start;
+
+          size_t baseCases, scores;
+          arma::Mat<size_t> neighbors;
+          arma::mat distances;
+          double searchTime;
+          {
+            NeighborSearch<NearestNeighborSort, LMetric<2, true>, KNNTreeType>
+                knn(knnTree, knnData, singleMode);
+            knn.Threads() = settings.threads;
+
+            start = Timer::Now();
+            knn.Search(settings.k[i], neighbors, distances);
+            searchTime = Timer::Now() - start;
+            baseCases = knn.BaseCases();
+            scores = knn.Scores();
+          }
+          delete knnTree;
+
+          WriteResult(settings, dataset, data, TreeKind::Name(), leafSizes[l],
+              "knn", settings.k[i], settings.modes[m], trial, buildTime,
+              searchTime, baseCases, scores, neighbors.n_elem);
+        }
+
+        if (settings.range > 0.0)
+        {
+          arma::mat rangeData(data);
+          double start = Timer::Now();
+          RangeTreeType* rangeTree = TreeKind::template Build<RangeTreeType>(
+              rangeData, leafSizes[l], settings.bulkLoad);
+          const double buildTime = Timer::Now() - start;
+
+          RangeSearchResults results;
+          double searchTime;
+          {
+            RangeSearch<LMetric<2, true>, RangeTreeType> rangeSearch(
+                rangeTree, rangeData, singleMode);
+            rangeSearch.Threads() = settings.threads;
+
+            start = Timer::Now();
+            rangeSearch.Search(math::Range(0.0, settings.range), results);
+            searchTime = Timer::Now() - start;
+          }
+          delete rangeTree;
+
+          WriteResult(settings, dataset, data, TreeKind::Name(), leafSizes[l],
+              "range", settings.range, settings.modes[m], trial, buildTime,
+              searchTime, 0, 0, results.TotalResults());
+        }
+      }
+    }
+  }
+}
+
+//! Run every requested tree type on the given dataset.
+void Benchmark(BenchmarkSettings& settings,
+               const vector<string>& trees,
+               const string& dataset,
+               const arma::mat& data)
+{
+  for (size_t i = 0; i < trees.size(); ++i)
+  {
+    if (trees[i] == "kd")
+      Benchmark<KDTreeType>(settings, dataset, data);
+    else if (trees[i] == "ball")
+      Benchmark<BallTreeType>(settings, dataset, data);
+    else if (trees[i] == "cover")
+      Benchmark<CoverTreeType>(settings, dataset, data);
+    else if (trees[i] == "r")
+      Benchmark<RectangleTreeType<RTreeSplit, RTreeDescentHeuristic> >(
+          settings, dataset, data);
+    else if (trees[i] == "r-star")
+      Benchmark<RectangleTreeType<RStarTreeSplit, RStarTreeDescentHeuristic> >(
+          settings, dataset, data);
+    else if (trees[i] == "x")
+      Benchmark<RectangleTreeType<XTreeSplit, RStarTreeDescentHeuristic> >(
+          settings, dataset, data);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  CLI::ParseCommandLine(argc, argv);
+
+  BenchmarkSettings settings;
+  settings.leafSizes = ParseList<size_t>(CLI::GetParam<string>("leaf_sizes"));
+  settings.k = ParseList<size_t>(CLI::GetParam<string>("k"));
+  settings.range = CLI::GetParam<double>("range");
+  settings.modes = ParseList<string>(CLI::GetParam<string>("modes"));
+  settings.bulkLoad = CLI::HasParam("bulk_load");
+
+  if (CLI::GetParam<int>("trials") <= 0)
+    Log::Fatal << "Invalid number of trials (" << CLI::GetParam<int>("trials")
+        << "); must be greater than 0." << endl;
+  settings.trials = (size_t) CLI::GetParam<int>("trials");
+
+  if (CLI::GetParam<int>("threads") < 0)
+    Log::Fatal << "Invalid number of threads (" << CLI::GetParam<int>("threads")
+        << "); must be 0 or greater." << endl;
+  settings.threads = (size_t) CLI::GetParam<int>("threads");
+
+  const vector<string> trees =
+      ParseList<string>(CLI::GetParam<string>("trees"));
+  for (size_t i = 0; i < trees.size(); ++i)
+  {
+    if (trees[i] != "kd" && trees[i] != "ball" && trees[i] != "cover" &&
+        trees[i] != "r" && trees[i] != "r-star" && trees[i] != "x")
+      Log::Fatal << "Unknown tree type '" << trees[i] << "'." << endl;
+  }
+
+  for (size_t i = 0; i < settings.modes.size(); ++i)
+  {
+    if (settings.modes[i] != "dual" && settings.modes[i] != "single")
+      Log::Fatal << "Unknown search mode '" << settings.modes[i] << "'."
+          << endl;
+  }
+
+  for (size_t i = 0; i < settings.leafSizes.size(); ++i)
+  {
+    if (settings.leafSizes[i] == 0)
+      Log::Fatal << "Invalid leaf size 0; must be greater than 0." << endl;
+  }
+
+  const vector<string> distributions =
+      ParseList<string>(CLI::GetParam<string>("distributions"));
+  for (size_t i = 0; i < distributions.size(); ++i)
+  {
+    if (!IsDistribution(distributions[i]))
+      Log::Fatal << "Unknown distribution '" << distributions[i] << "'."
+          << endl;
+  }
+
+  const string outputFile = CLI::GetParam<string>("output_file");
+  settings.output.open(outputFile.c_str());
+  if (!settings.output.is_open())
+    Log::Fatal << "Cannot open '" << outputFile << "' for writing." << endl;
+
+  settings.output << "version,dataset,points,dimensions,tree,leaf_size,task,"
+      << "parameter,mode,trial,build_time,search_time,base_cases,scores,"
+      << "results" << endl;
+
+  // Synthetic datasets.
+  const vector<size_t> sizes =
+      ParseList<size_t>(CLI::GetParam<string>("sizes"));
+  const vector<size_t> dimensions =
+      ParseList<size_t>(CLI::GetParam<string>("dimensions"));
+  for (size_t i = 0; i < distributions.size(); ++i)
+  {
+    for (size_t j = 0; j < sizes.size(); ++j)
+    {
+      for (size_t l = 0; l < dimensions.size(); ++l)
+      {
+        // Seed each dataset separately, so the same dataset is generated no
+        // matter which other datasets are run.
+        math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
+
+        arma::mat data;
+        GenerateDataset(distributions[i], sizes[j], dimensions[l], data);
+
+        ostringstream name;
+        name << distributions[i] << "_" << sizes[j] << "x" << dimensions[l];
+        Benchmark(settings, trees, name.str(), data);
+      }
+    }
+  }
+
+  // Real datasets.
+  const vector<string> datasets =
+      ParseList<string>(CLI::GetParam<string>("datasets"));
+  for (size_t i = 0; i < datasets.size(); ++i)
+  {
+    arma::mat data;
+    data::Load(datasets[i], data, true);
+    Benchmark(settings, trees, datasets[i], data);
+  }
+
+  return 0;
+}
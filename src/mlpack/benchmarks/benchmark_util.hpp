@@ -0,0 +1,113 @@
+/**
+ * @file benchmark_util.hpp
+ *
+ * Utilities shared by the benchmark programs: parsing comma-separated lists of
+ * options, generating synthetic datasets, and measuring memory usage.
+ */
+#ifndef __MLPACK_BENCHMARKS_BENCHMARK_UTIL_HPP
+#define __MLPACK_BENCHMARKS_BENCHMARK_UTIL_HPP
+
+#include <mlpack/core.hpp>
+
+#ifdef __linux__
+  #include <unistd.h>
+  #include <fstream>
+#endif
+
+namespace mlpack {
+namespace benchmark /** Utilities for the benchmark programs. */ {
+
+//! Split a comma-separated list into its elements, skipping empty elements.
+template<typename T>
+std::vector<T> ParseList(const std::string& list)
+{
+  std::vector<T> elements;
+  std::istringstream stream(list);
+  std::string element;
+  while (std::getline(stream, element, ','))
+  {
+    if (element.empty())
+      continue;
+
+    std::istringstream elementStream(element);
+    T value;
+    if (!(elementStream >> value))
+      Log::Fatal << "Invalid list element '" << element << "' in '" << list
+          << "'." << std::endl;
+    elements.push_back(value);
+  }
+
+  return elements;
+}
+
+//! Return true if the given synthetic dataset distribution is known.
+inline bool IsDistribution(const std::string& distribution)
+{
+  return (distribution == "uniform" || distribution == "gaussian" ||
+      distribution == "clustered");
+}
+
+/**
+ * Generate a synthetic dataset.  The distribution is one of 'uniform' (uniform
+ * over the unit cube), 'gaussian' (standard normal) or 'clustered' (ten
+ * Gaussian clusters with standard deviation 0.5, with centers spread uniformly
+ * over [0, 10]^d).  The dataset depends only on the state of the random number
+ * generators, so call math::RandomSeed() first to get the same dataset every
+ * time.
+ *
+ * @param distribution Distribution of the points.
+ * @param size Number of points.
+ * @param dimensions Dimensionality of the points.
+ * @param data Matrix to store the dataset in.
+ */
+inline void GenerateDataset(const std::string& distribution,
+                            const size_t size,
+                            const size_t dimensions,
+                            arma::mat& data)
+{
+  if (distribution == "uniform")
+  {
+    data.randu(dimensions, size);
+  }
+  else if (distribution == "gaussian")
+  {
+    data.randn(dimensions, size);
+  }
+  else
+  {
+    const size_t clusters = 10;
+    arma::mat centers(dimensions, clusters);
+    centers.randu();
+    centers *= 10.0;
+
+    data.randn(dimensions, size);
+    data *= 0.5;
+    for (size_t i = 0; i < size; ++i)
+      data.col(i) += centers.col(math::RandInt(clusters));
+  }
+}
+
+/**
+ * Get the resident memory of this process, in bytes.  This is only available on
+ * Linux; elsewhere it is always 0.  The difference between two calls is only a
+ * rough measure of the memory allocated in between, since the allocator may
+ * keep freed memory or reuse memory that was freed earlier.
+ */
+inline size_t ResidentMemory()
+{
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0, residentPages = 0;
+  if (!(statm >> pages >> residentPages))
+    return 0;
+
+  return residentPages * (size_t) sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif
+}
+
+}; // namespace benchmark
+}; // namespace mlpack
+
+#endif
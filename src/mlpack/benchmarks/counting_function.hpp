@@ -0,0 +1,333 @@
+/**
+ * @file counting_function.hpp
+ *
+ * A wrapper around an objective function which counts and times the calls an
+ * optimizer makes to it, and records the objective over time.
+ */
+#ifndef __MLPACK_BENCHMARKS_COUNTING_FUNCTION_HPP
+#define __MLPACK_BENCHMARKS_COUNTING_FUNCTION_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/lbfgs/evaluate_with_gradient.hpp>
+#include <mlpack/core/optimizers/aug_lagrangian/evaluate_constraints.hpp>
+#include <mlpack/core/optimizers/sgd/sgd.hpp>
+
+namespace mlpack {
+namespace benchmark {
+
+/**
+ * Wrap an objective function so that every call an optimizer makes to it is
+ * counted and timed.  Each call is forwarded to the wrapped function, so the
+ * optimizer does exactly the work it would do with the wrapped function: the
+ * wrapper always has an EvaluateWithGradient(), a batch Gradient(), and the
+ * batch constraint methods EvaluateConstraints() and GradientConstraints(),
+ * which call the wrapped function's own if it has them and fall back to
+ * separate calls in the same way the optimizers do otherwise.  Only the members
+ * the optimizer uses are instantiated, so any function L-BFGS, SGD, SA or
+ * AugLagrangian can optimize can be wrapped.
+ *
+ * The objective at each full evaluation is recorded, with the time since the
+ * wrapper was created (or last reset), so that the time taken to reach a given
+ * objective can be found.  Evaluations of the separable objectives are summed
+ * in order, and the sum is recorded each time all NumFunctions() of them have
+ * been evaluated; this is the objective of a pass if the optimizer evaluates
+ * every function at the end of each pass, as SGD does when its number of
+ * objective samples is NumFunctions().
+ *
+ * The counters are not thread-safe, so the optimizer must call the function
+ * from one thread at a time.
+ *
+ * @tparam FunctionType Type of the objective function to wrap.
+ * @tparam SparseGradient Whether the wrapped function has a sparse Gradient()
+ *     (if so, the wrapper has one too, so SGD takes sparse steps with it).
+ */
+template<typename FunctionType,
+         bool SparseGradient =
+             optimization::HasSparseGradientFunction<FunctionType>::value>
+class CountingFunction
+{
+ public:
+  /**
+   * Wrap the given function.  The function is not copied, so it must outlive
+   * the wrapper.
+   */
+  CountingFunction(FunctionType& function) :
+      function(function),
+      initialPoint(function.GetInitialPoint())
+  {
+    Reset();
+  }
+
+  //! Reset every counter and the recorded objectives, and restart the clock.
+  void Reset()
+  {
+    evaluations = 0;
+    gradients = 0;
+    functionEvaluations = 0;
+    functionGradients = 0;
+    constraintEvaluations = 0;
+    constraintGradients = 0;
+    time = 0;
+    passObjective = 0;
+    passEvaluations = 0;
+    trace.clear();
+    start = Timer::Now();
+  }
+
+  //! Evaluate the objective.
+  double Evaluate(const arma::mat& coordinates)
+  {
+    const double callStart = Timer::Now();
+    const double objective = function.Evaluate(coordinates);
+    time += Timer::Now() - callStart;
+    ++evaluations;
+    Record(objective);
+    return objective;
+  }
+
+  //! Evaluate the gradient of the objective.
+  void Gradient(const arma::mat& coordinates, arma::mat& gradient)
+  {
+    const double callStart = Timer::Now();
+    function.Gradient(coordinates, gradient);
+    time += Timer::Now() - callStart;
+    ++gradients;
+  }
+
+  //! Evaluate the objective and its gradient, which counts as one of each.
+  double EvaluateWithGradient(const arma::mat& coordinates,
+                              arma::mat& gradient)
+  {
+    const double callStart = Timer::Now();
+    const double objective = optimization::EvaluateWithGradient(function,
+        coordinates, gradient);
+    time += Timer::Now() - callStart;
+    ++evaluations;
+    ++gradients;
+    Record(objective);
+    return objective;
+  }
+
+  //! Get the number of separable functions.
+  size_t NumFunctions() const { return function.NumFunctions(); }
+
+  //! Evaluate the objective of separable function i.
+  double Evaluate(const arma::mat& coordinates, const size_t i)
+  {
+    const double callStart = Timer::Now();
+    const double objective = function.Evaluate(coordinates, i);
+    time += Timer::Now() - callStart;
+    ++functionEvaluations;
+
+    passObjective += objective;
+    if (++passEvaluations == function.NumFunctions())
+    {
+      Record(passObjective);
+      passObjective = 0;
+      passEvaluations = 0;
+    }
+
+    return objective;
+  }
+
+  //! Evaluate the gradient of separable function i.
+  void Gradient(const arma::mat& coordinates,
+                const size_t i,
+                arma::mat& gradient)
+  {
+    const double callStart = Timer::Now();
+    function.Gradient(coordinates, i, gradient);
+    time += Timer::Now() - callStart;
+    ++functionGradients;
+  }
+
+  //! Evaluate the summed gradient of a batch of separable functions, which
+  //! counts as one gradient for each function in the batch.
+  void Gradient(const arma::mat& coordinates,
+                const size_t begin,
+                const size_t batchSize,
+                arma::mat& gradient)
+  {
+    const double callStart = Timer::Now();
+    optimization::BatchGradient(function, coordinates, begin, batchSize,
+        gradient);
+    time += Timer::Now() - callStart;
+    functionGradients += batchSize;
+  }
+
+  //! Get the number of constraints.
+  size_t NumConstraints() const { return function.NumConstraints(); }
+
+  //! Evaluate the given constraint.
+  double EvaluateConstraint(const size_t index, const arma::mat& coordinates)
+  {
+    const double callStart = Timer::Now();
+    const double constraint = function.EvaluateConstraint(index, coordinates);
+    time += Timer::Now() - callStart;
+    ++constraintEvaluations;
+    return constraint;
+  }
+
+  //! Evaluate the gradient of the given constraint.
+  void GradientConstraint(const size_t index,
+                          const arma::mat& coordinates,
+                          arma::mat& gradient)
+  {
+    const double callStart = Timer::Now();
+    function.GradientConstraint(index, coordinates, gradient);
+    time += Timer::Now() - callStart;
+    ++constraintGradients;
+  }
+
+  //! Evaluate every constraint, which counts as one evaluation for each
+  //! constraint.
+  void EvaluateConstraints(const arma::mat& coordinates,
+                           arma::vec& constraints)
+  {
+    const double callStart = Timer::Now();
+    optimization::EvaluateConstraints(function, coordinates, constraints);
+    time += Timer::Now() - callStart;
+    constraintEvaluations += function.NumConstraints();
+  }
+
+  //! Add the weighted sum of the constraint gradients to the given gradient,
+  //! which counts as one gradient for each constraint with a nonzero weight.
+  void GradientConstraints(const arma::mat& coordinates,
+                           const arma::vec& weights,
+                           arma::mat& gradient)
+  {
+    const double callStart = Timer::Now();
+    optimization::GradientConstraints(function, coordinates, weights,
+        gradient);
+    time += Timer::Now() - callStart;
+    constraintGradients += (size_t) arma::accu(weights != 0.0);
+  }
+
+  //! Get the initial point of the wrapped function.
+  const arma::mat& GetInitialPoint() const { return initialPoint; }
+
+  //! Get the number of evaluations of the objective.
+  size_t Evaluations() const { return evaluations; }
+  //! Get the number of evaluations of the gradient of the objective.
+  size_t Gradients() const { return gradients; }
+  //! Get the number of evaluations of separable functions.
+  size_t FunctionEvaluations() const { return functionEvaluations; }
+  //! Get the number of gradients of separable functions.
+  size_t FunctionGradients() const { return functionGradients; }
+  //! Get the number of evaluations of constraints.
+  size_t ConstraintEvaluations() const { return constraintEvaluations; }
+  //! Get the number of gradients of constraints.
+  size_t ConstraintGradients() const { return constraintGradients; }
+  //! Get the time spent in the wrapped function, in seconds.
+  double Time() const { return time; }
+
+  //! Get the recorded objectives: the time each was found at (in seconds since
+  //! the clock was started), and its value.
+  const std::vector<std::pair<double, double> >& Trace() const
+  { return trace; }
+
+  //! Get the wrapped function.
+  FunctionType& Function() { return function; }
+
+ protected:
+  //! Record the given objective at the current time.
+  void Record(const double objective)
+  {
+    trace.push_back(std::make_pair(Timer::Now() - start, objective));
+  }
+
+  //! The wrapped function.
+  FunctionType& function;
+  //! The initial point of the wrapped function.
+  arma::mat initialPoint;
+
+  //! The number of evaluations of the objective.
+  size_t evaluations;
+  //! The number of evaluations of the gradient of the objective.
+  size_t gradients;
+  //! The number of evaluations of separable functions.
+  size_t functionEvaluations;
+  //! The number of gradients of separable functions.
+  size_t functionGradients;
+  //! The number of evaluations of constraints.
+  size_t constraintEvaluations;
+  //! The number of gradients of constraints.
+  size_t constraintGradients;
+  //! The time spent in the wrapped function.
+  double time;
+
+  //! The sum of the separable objectives of the current pass.
+  double passObjective;
+  //! The number of separable objectives evaluated in the current pass.
+  size_t passEvaluations;
+
+  //! The time the clock was started at.
+  double start;
+  //! The recorded objectives and the times they were found at.
+  std::vector<std::pair<double, double> > trace;
+};
+
+/**
+ * The wrapper for functions with a sparse gradient, which also forwards the
+ * sparse Gradient(), Support() and Regularization() that SGD needs for sparse
+ * steps.  The optimizers detect members by their exact type, so the members
+ * they detect are declared again here rather than inherited.
+ */
+template<typename FunctionType>
+class CountingFunction<FunctionType, true> :
+    public CountingFunction<FunctionType, false>
+{
+ public:
+  //! The wrapper this one extends.
+  typedef CountingFunction<FunctionType, false> Base;
+
+  using Base::Evaluate;
+  using Base::Gradient;
+
+  //! Wrap the given function; see the dense wrapper.
+  CountingFunction(FunctionType& function) : Base(function) { }
+
+  //! Evaluate the objective and its gradient, which counts as one of each.
+  double EvaluateWithGradient(const arma::mat& coordinates,
+                              arma::mat& gradient)
+  {
+    return Base::EvaluateWithGradient(coordinates, gradient);
+  }
+
+  //! Evaluate the summed gradient of a batch of separable functions.
+  void Gradient(const arma::mat& coordinates,
+                const size_t begin,
+                const size_t batchSize,
+                arma::mat& gradient)
+  {
+    Base::Gradient(coordinates, begin, batchSize, gradient);
+  }
+
+  //! Evaluate the sparse gradient of separable function i.
+  void Gradient(const arma::mat& coordinates,
+                const size_t i,
+                arma::sp_mat& gradient)
+  {
+    const double callStart = Timer::Now();
+    this->function.Gradient(coordinates, i, gradient);
+    this->time += Timer::Now() - callStart;
+    ++this->functionGradients;
+  }
+
+  //! Get the indices of the coordinates separable function i depends on.
+  void Support(const size_t i, arma::uvec& indices)
+  {
+    this->function.Support(i, indices);
+  }
+
+  //! Get the L2 regularization coefficient of each coordinate.
+  void Regularization(arma::mat& lambdas)
+  {
+    this->function.Regularization(lambdas);
+  }
+};
+
+}; // namespace benchmark
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,356 @@
+/**
+ * @file kmeans_benchmark_main.cpp
+ *
+ * Runs each of the k-means Lloyd step types from the same initial centroids,
+ * and records the time, distance calculations and memory of every iteration,
+ * so that the fastest step type for a given dataset and number of clusters can
+ * be chosen on evidence.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/methods/kmeans/kmeans.hpp>
+#include <mlpack/methods/kmeans/kmeans_plus_plus.hpp>
+#include <mlpack/methods/kmeans/elkan_kmeans.hpp>
+#include <mlpack/methods/kmeans/hamerly_kmeans.hpp>
+#include <mlpack/methods/kmeans/pelleg_moore_kmeans.hpp>
+#include <mlpack/methods/kmeans/dual_tree_kmeans.hpp>
+#include <mlpack/methods/kmeans/dtnn_kmeans.hpp>
+
+#include "benchmark_util.hpp"
+
+#include <fstream>
+
+PROGRAM_INFO("k-means benchmarks", "This program runs k-means with each of the "
+    "Lloyd step types in mlpack ('naive', 'elkan', 'hamerly', 'pelleg-moore', "
+    "'dualtree' and 'dtnn'), starting every step type from the same initial "
+    "centroids, and saves the cost of each iteration to a CSV file."
+    "\n\n"
+    "Each dataset is either a synthetic dataset (one of each combination of "
+    "--distributions, --sizes and --dimensions) or a file given in --datasets "
+    "(a comma-separated list).  For each dataset and each number of clusters "
+    "in --clusters, the initial centroids are chosen once (by a random "
+    "partition, or with k-means++ if --kmeans_plus_plus is given), and then "
+    "each step type in --algorithms is iterated until the centroids move less "
+    "than 1e-5 or --max_iterations is reached.  Each run is repeated --trials "
+    "times."
+    "\n\n"
+    "Each row of the output file is one iteration: the mlpack version, the "
+    "dataset, its size and dimensionality, the number of clusters, the step "
+    "type, trial, iteration, the time taken in seconds, the number of distance "
+    "calculations, the distance the centroids moved, and the increase in "
+    "resident memory since before the step type was created (only measured on "
+    "Linux).  Iteration 0 is the construction of the step type, which is where "
+    "the tree-based step types build their trees."
+    "\n\n"
+    "All step types should converge to the same centroids; if the final "
+    "centroids of a step type differ from those of the first step type, a "
+    "warning is printed.");
+
+PARAM_STRING("output_file", "File to save the results to (CSV).", "o",
+    "kmeans_benchmark.csv");
+PARAM_STRING("datasets", "Comma-separated list of dataset files to run on, in "
+    "addition to the synthetic datasets.", "D", "");
+PARAM_STRING("distributions", "Comma-separated list of synthetic dataset "
+    "distributions: 'uniform', 'gaussian' and/or 'clustered'.  Use '' for no "
+    "synthetic datasets.", "u", "clustered");
+PARAM_STRING("sizes", "Comma-separated list of synthetic dataset sizes.", "n",
+    "10000,100000");
+PARAM_STRING("dimensions", "Comma-separated list of synthetic dataset "
+    "dimensionalities.", "d", "2,10");
+PARAM_STRING("clusters", "Comma-separated list of numbers of clusters.", "c",
+    "10,100");
+PARAM_STRING("algorithms", "Comma-separated list of Lloyd step types to run.",
+    "a", "naive,elkan,hamerly,pelleg-moore,dualtree,dtnn");
+PARAM_INT("max_iterations", "Maximum number of iterations of each run.", "m",
+    100);
+PARAM_FLAG("kmeans_plus_plus", "If true, choose the initial centroids with "
+    "k-means++ instead of a random partition.", "K");
+PARAM_INT("trials", "Number of times to repeat each run.", "t", 1);
+PARAM_INT("threads", "Number of threads to use, for the step types which "
+    "support it (0 uses all available cores; ignored if mlpack was built "
+    "without OpenMP).", "H", 1);
+PARAM_INT("seed", "Random seed for the synthetic datasets and the initial "
+    "centroids.", "s", 42);
+
+using namespace mlpack;
+using namespace mlpack::benchmark;
+using namespace mlpack::kmeans;
+using namespace mlpack::metric;
+using namespace std;
+
+/**
+ * Settings shared by every run, and the stream the results are written to.
+ */
+struct BenchmarkSettings
+{
+  size_t maxIterations;
+  size_t trials;
+  size_t threads;
+  ofstream output;
+};
+
+//! Get the increase in resident memory since the given value (which may be
+//! negative).
+double MemoryIncrease(const size_t startMemory)
+{
+  return (double) ResidentMemory() - (double) startMemory;
+}
+
+/**
+ * Run the given Lloyd step type from the given initial centroids, writing one
+ * row for each iteration, and store the final centroids.
+ */
+template<template<class, class> class LloydStepType>
+void Benchmark(BenchmarkSettings& settings,
+               const string& dataset,
+               const arma::mat& data,
+               const string& algorithm,
+               const size_t trial,
+               const arma::mat& initialCentroids,
+               arma::mat& finalCentroids)
+{
+  const size_t clusters = initialCentroids.n_cols;
+  const size_t startMemory = ResidentMemory();
+
+  EuclideanDistance metric;
+  double start = Timer::Now();
+  LloydStepType<EuclideanDistance, arma::mat> lloydStep(data, metric);
+  SetLloydStepThreads(lloydStep, settings.threads);
+  double time = Timer::Now() - start;
+
+  settings.output << util::GetVersion() << "," << dataset << "," << data.n_cols
+      << "," << data.n_rows << "," << clusters << "," << algorithm << ","
+      << trial << ",0," << time << "," << lloydStep.DistanceCalculations()
+      << ",0," << MemoryIncrease(startMemory) << endl;
+
+  // This is the same loop as KMeans::Cluster(), so that every step type does
+  // exactly the work it would do there.
+  arma::mat centroids(initialCentroids);
+  arma::mat centroidsOther;
+  arma::Col<size_t> counts(clusters);
+  MaxVarianceNewCluster emptyClusterAction;
+  size_t iteration = 0;
+  double totalTime = time;
+  double cNorm;
+  do
+  {
+    const size_t distanceCalculations = lloydStep.DistanceCalculations();
+
+    start = Timer::Now();
+    if (iteration % 2 == 0)
+      cNorm = lloydStep.Iterate(centroids, centroidsOther, counts);
+    else
+      cNorm = lloydStep.Iterate(centroidsOther, centroids, counts);
+
+    for (size_t i = 0; i < clusters; i++)
+    {
+      if (counts[i] == 0)
+      {
+        if (iteration % 2 == 0)
+          emptyClusterAction.EmptyCluster(data, i, centroidsOther, counts,
+              metric);
+        else
+          emptyClusterAction.EmptyCluster(data, i, centroids, counts, metric);
+      }
+    }
+    time = Timer::Now() - start;
+    totalTime += time;
+
+    iteration++;
+    settings.output << util::GetVersion() << "," << dataset << ","
+        << data.n_cols << "," << data.n_rows << "," << clusters << ","
+        << algorithm << "," << trial << "," << iteration << "," << time << ","
+        << (lloydStep.DistanceCalculations() - distanceCalculations) << ","
+        << cNorm << "," << MemoryIncrease(startMemory) << endl;
+  } while (cNorm > 1e-5 && iteration != settings.maxIterations);
+
+  if ((iteration - 1) % 2 == 0)
+    finalCentroids = centroidsOther;
+  else
+    finalCentroids = centroids;
+
+  Log::Info << dataset << ", " << clusters << " clusters, " << algorithm
+      << ": " << iteration << " iterations in " << totalTime << "s, "
+      << lloydStep.DistanceCalculations() << " distance calculations." << endl;
+}
+
+//! Run every requested step type from the same initial centroids.
+void Benchmark(BenchmarkSettings& settings,
+               const vector<string>& algorithms,
+               const string& dataset,
+               const arma::mat& data,
+               const size_t clusters,
+               const bool kmeansPlusPlus)
+{
+  // Choose the initial centroids in the same way that KMeans::Cluster() does,
+  // from the assignments given by the initial partition policy.
+  arma::Col<size_t> assignments;
+  if (kmeansPlusPlus)
+    KMeansPlusPlus().Cluster(data, clusters, assignments);
+  else
+    RandomPartition::Cluster(data, clusters, assignments);
+
+  arma::Col<size_t> counts;
+  counts.zeros(clusters);
+  arma::mat initialCentroids;
+  initialCentroids.zeros(data.n_rows, clusters);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    initialCentroids.col(assignments[i]) += arma::vec(data.col(i));
+    counts[assignments[i]]++;
+  }
+
+  for (size_t i = 0; i < clusters; ++i)
+    if (counts[i] != 0)
+      initialCentroids.col(i) /= counts[i];
+
+  for (size_t trial = 0; trial < settings.trials; ++trial)
+  {
+    arma::mat referenceCentroids;
+    for (size_t i = 0; i < algorithms.size(); ++i)
+    {
+      arma::mat finalCentroids;
+      if (algorithms[i] == "naive")
+        Benchmark<NaiveKMeans>(settings, dataset, data, algorithms[i], trial,
+            initialCentroids, finalCentroids);
+      else if (algorithms[i] == "elkan")
+        Benchmark<ElkanKMeans>(settings, dataset, data, algorithms[i], trial,
+            initialCentroids, finalCentroids);
+      else if (algorithms[i] == "hamerly")
+        Benchmark<HamerlyKMeans>(settings, dataset, data, algorithms[i], trial,
+            initialCentroids, finalCentroids);
+      else if (algorithms[i] == "pelleg-moore")
+        Benchmark<PellegMooreKMeans>(settings, dataset, data, algorithms[i],
+            trial, initialCentroids, finalCentroids);
+      else if (algorithms[i] == "dualtree")
+        Benchmark<DefaultDualTreeKMeans>(settings, dataset, data,
+            algorithms[i], trial, initialCentroids, finalCentroids);
+      else if (algorithms[i] == "dtnn")
+        Benchmark<DefaultDTNNKMeans>(settings, dataset, data, algorithms[i],
+            trial, initialCentroids, finalCentroids);
+
+      // Every step type computes exact Lloyd iterations, so they should all
+      // end up at the same centroids.
+      if (i == 0)
+      {
+        referenceCentroids = finalCentroids;
+      }
+      else
+      {
+        const arma::mat differences = arma::abs(finalCentroids -
+            referenceCentroids);
+        const double difference = differences.max();
+        if (difference > 1e-5)
+          Log::Warn << dataset << ", " << clusters << " clusters: the final "
+              << "centroids of '" << algorithms[i] << "' differ from those of '"
+              << algorithms[0] << "' by up to " << difference << "." << endl;
+      }
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  CLI::ParseCommandLine(argc, argv);
+
+  BenchmarkSettings settings;
+
+  if (CLI::GetParam<int>("max_iterations") <= 0)
+    Log::Fatal << "Invalid maximum number of iterations ("
+        << CLI::GetParam<int>("max_iterations") << "); must be greater than "
+        << "0." << endl;
+  settings.maxIterations = (size_t) CLI::GetParam<int>("max_iterations");
+
+  if (CLI::GetParam<int>("trials") <= 0)
+    Log::Fatal << "Invalid number of trials (" << CLI::GetParam<int>("trials")
+        << "); must be greater than 0." << endl;
+  settings.trials = (size_t) CLI::GetParam<int>("trials");
+
+  if (CLI::GetParam<int>("threads") < 0)
+    Log::Fatal << "Invalid number of threads (" << CLI::GetParam<int>("threads")
+        << "); must be 0 or greater." << endl;
+  settings.threads = (size_t) CLI::GetParam<int>("threads");
+
+  const vector<string> algorithms =
+      ParseList<string>(CLI::GetParam<string>("algorithms"));
+  for (size_t i = 0; i < algorithms.size(); ++i)
+  {
+    if (algorithms[i] != "naive" && algorithms[i] != "elkan" &&
+        algorithms[i] != "hamerly" && algorithms[i] != "pelleg-moore" &&
+        algorithms[i] != "dualtree" && algorithms[i] != "dtnn")
+      Log::Fatal << "Unknown algorithm '" << algorithms[i] << "'." << endl;
+  }
+
+  const vector<size_t> clusters =
+      ParseList<size_t>(CLI::GetParam<string>("clusters"));
+  for (size_t i = 0; i < clusters.size(); ++i)
+  {
+    if (clusters[i] == 0)
+      Log::Fatal << "Invalid number of clusters 0; must be greater than 0."
+          << endl;
+  }
+
+  const vector<string> distributions =
+      ParseList<string>(CLI::GetParam<string>("distributions"));
+  for (size_t i = 0; i < distributions.size(); ++i)
+  {
+    if (!IsDistribution(distributions[i]))
+      Log::Fatal << "Unknown distribution '" << distributions[i] << "'."
+          << endl;
+  }
+
+  const string outputFile = CLI::GetParam<string>("output_file");
+  settings.output.open(outputFile.c_str());
+  if (!settings.output.is_open())
+    Log::Fatal << "Cannot open '" << outputFile << "' for writing." << endl;
+
+  settings.output << "version,dataset,points,dimensions,clusters,algorithm,"
+      << "trial,iteration,time,distance_calculations,residual,memory" << endl;
+
+  const bool kmeansPlusPlus = CLI::HasParam("kmeans_plus_plus");
+  const size_t seed = (size_t) CLI::GetParam<int>("seed");
+
+  // Synthetic datasets.
+  const vector<size_t> sizes =
+      ParseList<size_t>(CLI::GetParam<string>("sizes"));
+  const vector<size_t> dimensions =
+      ParseList<size_t>(CLI::GetParam<string>("dimensions"));
+  for (size_t i = 0; i < distributions.size(); ++i)
+  {
+    for (size_t j = 0; j < sizes.size(); ++j)
+    {
+      for (size_t l = 0; l < dimensions.size(); ++l)
+      {
+        math::RandomSeed(seed);
+        arma::mat data;
+        GenerateDataset(distributions[i], sizes[j], dimensions[l], data);
+
+        ostringstream name;
+        name << distributions[i] << "_" << sizes[j] << "x" << dimensions[l];
+        for (size_t c = 0; c < clusters.size(); ++c)
+        {
+          // Seed the initial centroids separately for each run.
+          math::RandomSeed(seed + c + 1);
+          Benchmark(settings, algorithms, name.str(), data, clusters[c],
+              kmeansPlusPlus);
+        }
+      }
+    }
+  }
+
+  // Real datasets.
+  const vector<string> datasets =
+      ParseList<string>(CLI::GetParam<string>("datasets"));
+  for (size_t i = 0; i < datasets.size(); ++i)
+  {
+    arma::mat data;
+    data::Load(datasets[i], data, true);
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+      math::RandomSeed(seed + c + 1);
+      Benchmark(settings, algorithms, datasets[i], data, clusters[c],
+          kmeansPlusPlus);
+    }
+  }
+
+  return 0;
+}
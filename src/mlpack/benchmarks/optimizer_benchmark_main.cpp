@@ -0,0 +1,743 @@
+/**
+ * @file optimizer_benchmark_main.cpp
+ *
+ * Runs the optimizers in core/optimizers/ on their test functions and on the
+ * objectives of some of the methods, and records the time, the number of
+ * function and gradient evaluations, and the time taken to reach the best
+ * objective found, so that changes to the optimizers can be measured.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/lbfgs/lbfgs.hpp>
+#include <mlpack/core/optimizers/lbfgs/test_functions.hpp>
+#include <mlpack/core/optimizers/sgd/sgd.hpp>
+#include <mlpack/core/optimizers/sgd/test_function.hpp>
+#include <mlpack/core/optimizers/sa/sa.hpp>
+#include <mlpack/core/optimizers/aug_lagrangian/aug_lagrangian.hpp>
+#include <mlpack/core/optimizers/aug_lagrangian/aug_lagrangian_test_functions.hpp>
+#include <mlpack/core/optimizers/lrsdp/lrsdp.hpp>
+#include <mlpack/methods/logistic_regression/logistic_regression_function.hpp>
+#include <mlpack/methods/softmax_regression/softmax_regression_function.hpp>
+#include <mlpack/methods/nca/nca_softmax_error_function.hpp>
+#include <mlpack/methods/regularized_svd/regularized_svd_function.hpp>
+
+#include "benchmark_util.hpp"
+#include "counting_function.hpp"
+
+#include <fstream>
+
+PROGRAM_INFO("Optimizer benchmarks", "This program runs the optimizers in "
+    "mlpack on their test functions and on the objectives of some of the "
+    "methods, and saves the cost of each run to a CSV file."
+    "\n\n"
+    "The functions (--functions, a comma-separated list) are the test "
+    "functions 'rosenbrock', 'wood', 'rosenbrock_wood', "
+    "'generalized_rosenbrock' and 'sgd_test', the constrained test functions "
+    "'aug_lagrangian_test', 'gockenbach' and 'lovasz_theta' (the Lovasz-theta "
+    "SDP of a cycle of --vertices vertices), and the objectives 'logistic' "
+    "(logistic regression), 'softmax' (softmax regression), 'nca' (the "
+    "softmax error of NCA) and 'rsvd' (regularized SVD), on synthetic datasets "
+    "of --points points in --dimensions dimensions."
+    "\n\n"
+    "The optimizers (--optimizers) are 'lbfgs', 'sgd', 'momentum_sgd', "
+    "'adagrad', 'rmsprop', 'adam', 'sa', 'aug_lagrangian' and 'lrsdp'.  Each "
+    "optimizer is run on each function it can optimize: L-BFGS and SA on the "
+    "unconstrained functions with a full objective (SA only on the test "
+    "functions), the SGD variants on the functions with separable objectives, "
+    "AugLagrangian on the constrained functions, and LR-SDP on "
+    "'lovasz_theta'.  Each run is repeated --trials times."
+    "\n\n"
+    "Each row of the output file is one run: the mlpack version, the function, "
+    "its number of coordinates, the optimizer, the trial, the time taken in "
+    "seconds, the time spent in the function, the number of iterations, the "
+    "time per iteration, the numbers of evaluations and gradients of the "
+    "objective, of the separable objectives and of the constraints, the final "
+    "objective, and the time taken to reach the objective tolerance."
+    "\n\n"
+    "An iteration is one line search trial for L-BFGS and AugLagrangian (each "
+    "evaluates the objective and its gradient once), one step (the gradient of "
+    "one separable objective) for the SGD variants, and one move (one "
+    "evaluation) for SA.  The time to tolerance is the time at which the "
+    "objective first came within --tolerance (relative to its magnitude, or "
+    "absolute if it is less than 1) of the best objective any run on the "
+    "function reached; for the SGD variants, the objective is only known at "
+    "the end of each pass over the data.  It is left empty for the "
+    "constrained functions, whose objective alone does not measure progress, "
+    "and for runs which never reach the tolerance.  LR-SDP builds its own "
+    "objective, and plain SGD has its own implementation for 'rsvd', so only "
+    "the time and final objective of those runs are measured.");
+
+PARAM_STRING("output_file", "File to save the results to (CSV).", "o",
+    "optimizer_benchmark.csv");
+PARAM_STRING("functions", "Comma-separated list of functions to optimize.",
+    "f", "rosenbrock,wood,rosenbrock_wood,generalized_rosenbrock,sgd_test,"
+    "aug_lagrangian_test,gockenbach,lovasz_theta,logistic,softmax,nca,rsvd");
+PARAM_STRING("optimizers", "Comma-separated list of optimizers to run.", "O",
+    "lbfgs,sgd,momentum_sgd,adagrad,rmsprop,adam,sa,aug_lagrangian,lrsdp");
+PARAM_INT("points", "Number of points in the synthetic datasets (the number "
+    "of ratings for 'rsvd').", "n", 1000);
+PARAM_INT("dimensions", "Dimensionality of the synthetic datasets, and of "
+    "'generalized_rosenbrock'.", "d", 10);
+PARAM_INT("vertices", "Number of vertices of the cycle for 'lovasz_theta'.",
+    "g", 11);
+PARAM_INT("passes", "Maximum number of passes over the data for the SGD "
+    "variants.", "p", 100);
+PARAM_DOUBLE("step_size", "Step size for the SGD variants.", "a", 0.001);
+PARAM_INT("sa_iterations", "Maximum number of moves for SA.", "S", 1000000);
+PARAM_DOUBLE("tolerance", "Objective tolerance for the time to tolerance.",
+    "e", 1e-3);
+PARAM_INT("trials", "Number of times to repeat each run.", "t", 3);
+PARAM_INT("seed", "Random seed for the synthetic datasets and the "
+    "optimizers.", "s", 42);
+
+using namespace mlpack;
+using namespace mlpack::benchmark;
+using namespace mlpack::optimization;
+using namespace mlpack::regression;
+using namespace mlpack::nca;
+using namespace mlpack::svd;
+using namespace std;
+
+/**
+ * Settings shared by every run, and the stream the results are written to.
+ */
+struct BenchmarkSettings
+{
+  vector<string> optimizers;
+  size_t passes;
+  double stepSize;
+  size_t saIterations;
+  double tolerance;
+  size_t trials;
+  size_t seed;
+  ofstream output;
+
+  //! Return true if the given optimizer should be run.
+  bool Runs(const string& optimizer) const
+  {
+    return find(optimizers.begin(), optimizers.end(), optimizer) !=
+        optimizers.end();
+  }
+};
+
+/**
+ * The cost of one run of an optimizer.
+ */
+struct BenchmarkResult
+{
+  string optimizer;
+  size_t trial;
+  double time;
+  double functionTime;
+  double objective;
+  size_t iterations;
+  size_t evaluations;
+  size_t gradients;
+  size_t functionEvaluations;
+  size_t functionGradients;
+  size_t constraintEvaluations;
+  size_t constraintGradients;
+  //! False if the calls to the function could not be counted.
+  bool counted;
+  //! False if the objectives in the trace do not measure progress.
+  bool traced;
+  vector<pair<double, double> > trace;
+};
+
+//! Store the counts of the given wrapper in the given result.
+template<typename CountingFunctionType>
+void StoreCounts(const CountingFunctionType& counting,
+                 const bool traced,
+                 BenchmarkResult& result)
+{
+  result.functionTime = counting.Time();
+  result.evaluations = counting.Evaluations();
+  result.gradients = counting.Gradients();
+  result.functionEvaluations = counting.FunctionEvaluations();
+  result.functionGradients = counting.FunctionGradients();
+  result.constraintEvaluations = counting.ConstraintEvaluations();
+  result.constraintGradients = counting.ConstraintGradients();
+  result.counted = true;
+  result.traced = traced;
+  result.trace = counting.Trace();
+}
+
+//! Run L-BFGS on the given function.
+template<typename FunctionType>
+void BenchmarkLBFGS(BenchmarkSettings& settings,
+                    FunctionType& function,
+                    vector<BenchmarkResult>& results)
+{
+  for (size_t trial = 0; trial < settings.trials; ++trial)
+  {
+    CountingFunction<FunctionType> counting(function);
+    L_BFGS<CountingFunction<FunctionType> > lbfgs(counting);
+    // The counters can only be used from one thread.
+    lbfgs.LineSearchThreads() = 1;
+    arma::mat coordinates(counting.GetInitialPoint());
+
+    BenchmarkResult result;
+    result.optimizer = "lbfgs";
+    result.trial = trial;
+    counting.Reset();
+    const double start = Timer::Now();
+    result.objective = lbfgs.Optimize(coordinates);
+    result.time = Timer::Now() - start;
+    StoreCounts(counting, true, result);
+    result.iterations = counting.Gradients();
+    results.push_back(result);
+  }
+}
+
+//! Run SGD with the given update policy on the given function.
+template<typename UpdatePolicyType, typename FunctionType>
+void BenchmarkSGD(BenchmarkSettings& settings,
+                  const string& optimizer,
+                  FunctionType& function,
+                  vector<BenchmarkResult>& results)
+{
+  if (!settings.Runs(optimizer))
+    return;
+
+  for (size_t trial = 0; trial < settings.trials; ++trial)
+  {
+    // The order the functions are visited in is random.
+    math::RandomSeed(settings.seed + trial);
+
+    // The objective is evaluated on every function at the end of each pass,
+    // which the wrapper records.
+    CountingFunction<FunctionType> counting(function);
+    const size_t numFunctions = counting.NumFunctions();
+    StochasticGradientDescent<CountingFunction<FunctionType>, UpdatePolicyType>
+        sgd(counting, settings.stepSize, settings.passes * numFunctions, 1e-5,
+        true, 1, numFunctions);
+    arma::mat coordinates(counting.GetInitialPoint());
+
+    BenchmarkResult result;
+    result.optimizer = optimizer;
+    result.trial = trial;
+    counting.Reset();
+    const double start = Timer::Now();
+    result.objective = sgd.Optimize(coordinates);
+    result.time = Timer::Now() - start;
+    StoreCounts(counting, true, result);
+    result.iterations = counting.FunctionGradients();
+    results.push_back(result);
+  }
+}
+
+//! Run every SGD variant on the given function.
+template<typename FunctionType>
+void BenchmarkSGD(BenchmarkSettings& settings,
+                  FunctionType& function,
+                  vector<BenchmarkResult>& results)
+{
+  BenchmarkSGD<VanillaUpdate>(settings, "sgd", function, results);
+  BenchmarkSGD<MomentumUpdate>(settings, "momentum_sgd", function, results);
+  BenchmarkSGD<AdaGradUpdate>(settings, "adagrad", function, results);
+  BenchmarkSGD<RMSPropUpdate>(settings, "rmsprop", function, results);
+  BenchmarkSGD<AdamUpdate>(settings, "adam", function, results);
+}
+
+/**
+ * Run plain SGD on the regularized SVD objective.  This has a specialization of
+ * SGD which the wrapper would hide, so it is run on the function itself, and
+ * only its time and final objective are measured.
+ */
+void BenchmarkRegularizedSVDSGD(BenchmarkSettings& settings,
+                                RegularizedSVDFunction& function,
+                                vector<BenchmarkResult>& results)
+{
+  if (!settings.Runs("sgd"))
+    return;
+
+  for (size_t trial = 0; trial < settings.trials; ++trial)
+  {
+    math::RandomSeed(settings.seed + trial);
+    SGD<RegularizedSVDFunction> sgd(function, settings.stepSize,
+        settings.passes * function.NumFunctions(), 1e-5, true, 1,
+        function.NumFunctions());
+    arma::mat coordinates(function.GetInitialPoint());
+
+    BenchmarkResult result;
+    result.optimizer = "sgd";
+    result.trial = trial;
+    const double start = Timer::Now();
+    result.objective = sgd.Optimize(coordinates);
+    result.time = Timer::Now() - start;
+    result.counted = false;
+    result.traced = false;
+    results.push_back(result);
+  }
+}
+
+//! Run SA on the given function.
+template<typename FunctionType>
+void BenchmarkSA(BenchmarkSettings& settings,
+                 FunctionType& function,
+                 vector<BenchmarkResult>& results)
+{
+  for (size_t trial = 0; trial < settings.trials; ++trial)
+  {
+    // SA seeds the random number generator itself, from the time.
+    CountingFunction<FunctionType> counting(function);
+    ExponentialSchedule schedule(1e-5);
+    SA<CountingFunction<FunctionType> > sa(counting, schedule,
+        settings.saIterations);
+    arma::mat coordinates(counting.GetInitialPoint());
+
+    BenchmarkResult result;
+    result.optimizer = "sa";
+    result.trial = trial;
+    counting.Reset();
+    const double start = Timer::Now();
+    result.objective = sa.Optimize(coordinates);
+    result.time = Timer::Now() - start;
+    StoreCounts(counting, true, result);
+    result.iterations = counting.Evaluations();
+    results.push_back(result);
+  }
+}
+
+//! Run AugLagrangian on the given constrained function.
+template<typename FunctionType>
+void BenchmarkAugLagrangian(BenchmarkSettings& settings,
+                            FunctionType& function,
+                            vector<BenchmarkResult>& results)
+{
+  for (size_t trial = 0; trial < settings.trials; ++trial)
+  {
+    CountingFunction<FunctionType> counting(function);
+    AugLagrangian<CountingFunction<FunctionType> > augLag(counting);
+    arma::mat coordinates(counting.GetInitialPoint());
+
+    BenchmarkResult result;
+    result.optimizer = "aug_lagrangian";
+    result.trial = trial;
+    counting.Reset();
+    const double start = Timer::Now();
+    if (!augLag.Optimize(coordinates, 0))
+      Log::Warn << "AugLagrangian did not converge." << endl;
+    result.time = Timer::Now() - start;
+    StoreCounts(counting, false, result);
+    result.objective = function.Evaluate(coordinates);
+    result.iterations = counting.Gradients();
+    results.push_back(result);
+  }
+}
+
+//! Get the edges of a cycle of the given number of vertices.
+arma::mat CycleEdges(const size_t vertices)
+{
+  arma::mat edges(2, vertices);
+  for (size_t i = 0; i < vertices; ++i)
+  {
+    edges(0, i) = i;
+    edges(1, i) = (i + 1) % vertices;
+  }
+
+  return edges;
+}
+
+/**
+ * Run LR-SDP on the Lovasz-theta SDP of the graph with the given edges, set up
+ * as in Monteiro and Burer (2004).  LR-SDP builds its own objective, so the
+ * calls to it are not counted.
+ */
+void BenchmarkLRSDP(BenchmarkSettings& settings,
+                    const arma::mat& edges,
+                    vector<BenchmarkResult>& results)
+{
+  const size_t vertices = (size_t) arma::max(arma::max(edges)) + 1;
+  const size_t constraints = edges.n_cols + 1;
+
+  // The initial point of Section 4 of Monteiro and Burer.
+  double r = 0.5 + sqrt(0.25 + 2 * constraints);
+  if (ceil(r) > vertices)
+    r = vertices;
+  const size_t rank = (size_t) ceil(r);
+  arma::mat initialPoint(vertices, rank);
+  for (size_t i = 0; i < vertices; ++i)
+  {
+    for (size_t j = 0; j < rank; ++j)
+    {
+      initialPoint(i, j) = sqrt(1.0 / (vertices * constraints));
+      if (i == j)
+        initialPoint(i, j) += sqrt(1.0 / r);
+    }
+  }
+
+  for (size_t trial = 0; trial < settings.trials; ++trial)
+  {
+    LRSDP lrsdp(constraints, initialPoint);
+
+    // C = -(e e^T); A_0 = I with b_0 = 1, and each edge (i, j) has a
+    // constraint X_ij + X_ji = 0, stored as a list of entries.
+    lrsdp.C().ones(vertices, vertices);
+    lrsdp.C() *= -1;
+    lrsdp.B().zeros(constraints);
+    lrsdp.B()[0] = 1;
+    lrsdp.AModes().ones(constraints);
+    lrsdp.AModes()[0] = 0;
+    lrsdp.A()[0].eye(vertices, vertices);
+    for (size_t i = 0; i < edges.n_cols; ++i)
+    {
+      arma::mat a(3, 2);
+      a(0, 0) = edges(0, i);
+      a(1, 0) = edges(1, i);
+      a(2, 0) = 1;
+      a(0, 1) = edges(1, i);
+      a(1, 1) = edges(0, i);
+      a(2, 1) = 1;
+      lrsdp.A()[i + 1] = a;
+    }
+
+    lrsdp.AugLag().Lambda().ones(constraints);
+    lrsdp.AugLag().Lambda() *= -1;
+    lrsdp.AugLag().Lambda()[0] = -double(vertices);
+
+    arma::mat coordinates(initialPoint);
+
+    BenchmarkResult result;
+    result.optimizer = "lrsdp";
+    result.trial = trial;
+    const double start = Timer::Now();
+    result.objective = lrsdp.Optimize(coordinates);
+    result.time = Timer::Now() - start;
+    result.counted = false;
+    result.traced = false;
+    results.push_back(result);
+  }
+}
+
+/**
+ * Generate a labeled synthetic dataset: the points of each class are drawn
+ * from a standard normal distribution around a center, and the centers are
+ * drawn from a normal distribution with standard deviation 2.
+ */
+void GenerateLabeledDataset(const size_t size,
+                            const size_t dimensions,
+                            const size_t classes,
+                            arma::mat& data,
+                            arma::Col<size_t>& labels)
+{
+  arma::mat centers(dimensions, classes);
+  centers.randn();
+  centers *= 2.0;
+
+  data.randn(dimensions, size);
+  labels.set_size(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    labels[i] = math::RandInt(classes);
+    data.col(i) += centers.col(labels[i]);
+  }
+}
+
+/**
+ * Generate a synthetic set of ratings for regularized SVD: each column is a
+ * user, an item and a rating, and the ratings are those of a rank 5 model plus
+ * noise.
+ */
+void GenerateRatings(const size_t size, arma::mat& data)
+{
+  const size_t users = std::max(size / 20, (size_t) 1);
+  const size_t items = std::max(size / 20, (size_t) 1);
+  arma::mat userFactors(5, users), itemFactors(5, items);
+  userFactors.randn();
+  itemFactors.randn();
+
+  data.set_size(3, size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    const size_t user = math::RandInt(users);
+    const size_t item = math::RandInt(items);
+    data(0, i) = user;
+    data(1, i) = item;
+    data(2, i) = arma::dot(userFactors.col(user), itemFactors.col(item)) +
+        0.1 * math::RandNormal();
+  }
+}
+
+/**
+ * Write the results of every run on the given function.  The time to
+ * tolerance of each run is measured against the best objective any run
+ * reached.
+ */
+void WriteResults(BenchmarkSettings& settings,
+                  const string& name,
+                  const size_t coordinates,
+                  const vector<BenchmarkResult>& results)
+{
+  double best = DBL_MAX;
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    if (!results[i].traced)
+      continue;
+    for (size_t j = 0; j < results[i].trace.size(); ++j)
+      best = std::min(best, results[i].trace[j].second);
+  }
+  const double target = best + settings.tolerance *
+      std::max(std::abs(best), 1.0);
+
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const BenchmarkResult& result = results[i];
+    settings.output << util::GetVersion() << "," << name << "," << coordinates
+        << "," << result.optimizer << "," << result.trial << ","
+        << result.time << ",";
+
+    if (result.counted)
+    {
+      settings.output << result.functionTime << "," << result.iterations << ","
+          << (result.iterations > 0 ? result.time / result.iterations : 0.0)
+          << "," << result.evaluations << "," << result.gradients << ","
+          << result.functionEvaluations << "," << result.functionGradients
+          << "," << result.constraintEvaluations << ","
+          << result.constraintGradients << ",";
+    }
+    else
+    {
+      settings.output << ",,,,,,,,,";
+    }
+
+    settings.output << result.objective << ",";
+    if (result.traced)
+    {
+      for (size_t j = 0; j < result.trace.size(); ++j)
+      {
+        if (result.trace[j].second <= target)
+        {
+          settings.output << result.trace[j].first;
+          break;
+        }
+      }
+    }
+    settings.output << endl;
+
+    Log::Info << name << ", " << result.optimizer << ": objective "
+        << result.objective << " in " << result.time << "s." << endl;
+  }
+}
+
+//! Run every requested optimizer which can optimize the given function.
+void Benchmark(BenchmarkSettings& settings,
+               const string& name,
+               const size_t points,
+               const size_t dimensions,
+               const size_t vertices)
+{
+  vector<BenchmarkResult> results;
+  size_t coordinates = 0;
+
+  math::RandomSeed(settings.seed);
+  if (name == "rosenbrock")
+  {
+    test::RosenbrockFunction function;
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("lbfgs"))
+      BenchmarkLBFGS(settings, function, results);
+    if (settings.Runs("sa"))
+      BenchmarkSA(settings, function, results);
+  }
+  else if (name == "wood")
+  {
+    test::WoodFunction function;
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("lbfgs"))
+      BenchmarkLBFGS(settings, function, results);
+    if (settings.Runs("sa"))
+      BenchmarkSA(settings, function, results);
+  }
+  else if (name == "rosenbrock_wood")
+  {
+    test::RosenbrockWoodFunction function;
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("lbfgs"))
+      BenchmarkLBFGS(settings, function, results);
+    if (settings.Runs("sa"))
+      BenchmarkSA(settings, function, results);
+  }
+  else if (name == "generalized_rosenbrock")
+  {
+    test::GeneralizedRosenbrockFunction function(dimensions);
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("lbfgs"))
+      BenchmarkLBFGS(settings, function, results);
+    BenchmarkSGD(settings, function, results);
+    if (settings.Runs("sa"))
+      BenchmarkSA(settings, function, results);
+  }
+  else if (name == "sgd_test")
+  {
+    test::SGDTestFunction function;
+    coordinates = function.GetInitialPoint().n_elem;
+    BenchmarkSGD(settings, function, results);
+  }
+  else if (name == "aug_lagrangian_test")
+  {
+    AugLagrangianTestFunction function;
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("aug_lagrangian"))
+      BenchmarkAugLagrangian(settings, function, results);
+  }
+  else if (name == "gockenbach")
+  {
+    GockenbachFunction function;
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("aug_lagrangian"))
+      BenchmarkAugLagrangian(settings, function, results);
+  }
+  else if (name == "lovasz_theta")
+  {
+    const arma::mat edges = CycleEdges(vertices);
+    LovaszThetaSDP function(edges);
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("aug_lagrangian"))
+      BenchmarkAugLagrangian(settings, function, results);
+    if (settings.Runs("lrsdp"))
+      BenchmarkLRSDP(settings, edges, results);
+  }
+  else if (name == "logistic")
+  {
+    arma::mat data;
+    arma::Col<size_t> labels;
+    GenerateLabeledDataset(points, dimensions, 2, data, labels);
+    const arma::vec responses = arma::conv_to<arma::vec>::from(labels);
+    LogisticRegressionFunction<> function(data, responses, 0.001);
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("lbfgs"))
+      BenchmarkLBFGS(settings, function, results);
+    BenchmarkSGD(settings, function, results);
+  }
+  else if (name == "softmax")
+  {
+    arma::mat data;
+    arma::Col<size_t> labels;
+    GenerateLabeledDataset(points, dimensions, 3, data, labels);
+    const arma::vec responses = arma::conv_to<arma::vec>::from(labels);
+    SoftmaxRegressionFunction function(data, responses, dimensions, 3);
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("lbfgs"))
+      BenchmarkLBFGS(settings, function, results);
+  }
+  else if (name == "nca")
+  {
+    arma::mat data;
+    arma::Col<size_t> labels;
+    GenerateLabeledDataset(points, dimensions, 3, data, labels);
+    SoftmaxErrorFunction<> function(data, labels);
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("lbfgs"))
+      BenchmarkLBFGS(settings, function, results);
+    BenchmarkSGD(settings, function, results);
+  }
+  else if (name == "rsvd")
+  {
+    arma::mat data;
+    GenerateRatings(points, data);
+    RegularizedSVDFunction function(data, 5, 0.02);
+    coordinates = function.GetInitialPoint().n_elem;
+    if (settings.Runs("lbfgs"))
+      BenchmarkLBFGS(settings, function, results);
+    BenchmarkRegularizedSVDSGD(settings, function, results);
+    BenchmarkSGD<MomentumUpdate>(settings, "momentum_sgd", function, results);
+    BenchmarkSGD<AdaGradUpdate>(settings, "adagrad", function, results);
+    BenchmarkSGD<RMSPropUpdate>(settings, "rmsprop", function, results);
+    BenchmarkSGD<AdamUpdate>(settings, "adam", function, results);
+  }
+
+  WriteResults(settings, name, coordinates, results);
+}
+
+int main(int argc, char* argv[])
+{
+  CLI::ParseCommandLine(argc, argv);
+
+  BenchmarkSettings settings;
+
+  const vector<string> functions =
+      ParseList<string>(CLI::GetParam<string>("functions"));
+  for (size_t i = 0; i < functions.size(); ++i)
+  {
+    if (functions[i] != "rosenbrock" && functions[i] != "wood" &&
+        functions[i] != "rosenbrock_wood" &&
+        functions[i] != "generalized_rosenbrock" &&
+        functions[i] != "sgd_test" && functions[i] != "aug_lagrangian_test" &&
+        functions[i] != "gockenbach" && functions[i] != "lovasz_theta" &&
+        functions[i] != "logistic" && functions[i] != "softmax" &&
+        functions[i] != "nca" && functions[i] != "rsvd")
+      Log::Fatal << "Unknown function '" << functions[i] << "'." << endl;
+  }
+
+  settings.optimizers = ParseList<string>(CLI::GetParam<string>("optimizers"));
+  for (size_t i = 0; i < settings.optimizers.size(); ++i)
+  {
+    const string& optimizer = settings.optimizers[i];
+    if (optimizer != "lbfgs" && optimizer != "sgd" &&
+        optimizer != "momentum_sgd" && optimizer != "adagrad" &&
+        optimizer != "rmsprop" && optimizer != "adam" && optimizer != "sa" &&
+        optimizer != "aug_lagrangian" && optimizer != "lrsdp")
+      Log::Fatal << "Unknown optimizer '" << optimizer << "'." << endl;
+  }
+
+  if (CLI::GetParam<int>("points") <= 0)
+    Log::Fatal << "Invalid number of points (" << CLI::GetParam<int>("points")
+        << "); must be greater than 0." << endl;
+  const size_t points = (size_t) CLI::GetParam<int>("points");
+
+  // The generalized Rosenbrock function needs at least two dimensions.
+  if (CLI::GetParam<int>("dimensions") <= 1)
+    Log::Fatal << "Invalid dimensionality ("
+        << CLI::GetParam<int>("dimensions") << "); must be greater than 1."
+        << endl;
+  const size_t dimensions = (size_t) CLI::GetParam<int>("dimensions");
+
+  if (CLI::GetParam<int>("vertices") <= 2)
+    Log::Fatal << "Invalid number of vertices ("
+        << CLI::GetParam<int>("vertices") << "); must be greater than 2."
+        << endl;
+  const size_t vertices = (size_t) CLI::GetParam<int>("vertices");
+
+  if (CLI::GetParam<int>("passes") <= 0)
+    Log::Fatal << "Invalid number of passes (" << CLI::GetParam<int>("passes")
+        << "); must be greater than 0." << endl;
+  settings.passes = (size_t) CLI::GetParam<int>("passes");
+
+  if (CLI::GetParam<double>("step_size") <= 0.0)
+    Log::Fatal << "Invalid step size (" << CLI::GetParam<double>("step_size")
+        << "); must be greater than 0." << endl;
+  settings.stepSize = CLI::GetParam<double>("step_size");
+
+  if (CLI::GetParam<int>("sa_iterations") <= 0)
+    Log::Fatal << "Invalid number of SA iterations ("
+        << CLI::GetParam<int>("sa_iterations") << "); must be greater than 0."
+        << endl;
+  settings.saIterations = (size_t) CLI::GetParam<int>("sa_iterations");
+
+  if (CLI::GetParam<double>("tolerance") < 0.0)
+    Log::Fatal << "Invalid tolerance (" << CLI::GetParam<double>("tolerance")
+        << "); must be 0 or greater." << endl;
+  settings.tolerance = CLI::GetParam<double>("tolerance");
+
+  if (CLI::GetParam<int>("trials") <= 0)
+    Log::Fatal << "Invalid number of trials (" << CLI::GetParam<int>("trials")
+        << "); must be greater than 0." << endl;
+  settings.trials = (size_t) CLI::GetParam<int>("trials");
+
+  settings.seed = (size_t) CLI::GetParam<int>("seed");
+
+  const string outputFile = CLI::GetParam<string>("output_file");
+  settings.output.open(outputFile.c_str());
+  if (!settings.output.is_open())
+    Log::Fatal << "Cannot open '" << outputFile << "' for writing." << endl;
+
+  settings.output << "version,function,coordinates,optimizer,trial,time,"
+      << "function_time,iterations,time_per_iteration,evaluations,gradients,"
+      << "function_evaluations,function_gradients,constraint_evaluations,"
+      << "constraint_gradients,objective,time_to_tolerance" << endl;
+
+  for (size_t i = 0; i < functions.size(); ++i)
+    Benchmark(settings, functions[i], points, dimensions, vertices);
+
+  return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file allknn_model.cpp
+ *
+ * MEX function for a MATLAB All-kNN binding which keeps the kd-tree built on
+ * the reference set alive between calls, so that many query sets can be
+ * searched without building it again.
+ */
+#include "mex.h"
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <mlpack/methods/neighbor_search/unmap.hpp>
+
+#include "../mex_handle.hpp"
+
+using namespace std;
+using namespace mlpack;
+using namespace mlpack::neighbor;
+using namespace mlpack::matlab;
+
+typedef tree::BinarySpaceTree<bound::HRectBound<2>,
+    NeighborSearchStat<NearestNeighborSort> > TreeType;
+typedef NeighborSearch<NearestNeighborSort, metric::EuclideanDistance,
+    TreeType> SearchType;
+
+// The reference set and the kd-tree built on it.
+struct AllkNNModel
+{
+  // The reference set, rearranged by the tree.
+  arma::mat referenceData;
+  // Mappings from the points of the tree to the original points.
+  std::vector<size_t> oldFromNew;
+  // The kd-tree.
+  TreeType* tree;
+
+  AllkNNModel() : tree(NULL) { }
+  ~AllkNNModel() { delete tree; }
+};
+
+// Get a string argument.
+static string GetString(const mxArray* array)
+{
+  if (mxCHAR_CLASS != mxGetClassID(array))
+    mexErrMsgTxt("Command must have type mxCHAR_CLASS.");
+
+  const int bufLength = mxGetNumberOfElements(array) + 1;
+  char* buf = (char*) mxCalloc(bufLength, sizeof(char));
+  mxGetString(array, buf, bufLength);
+  string str(buf);
+  mxFree(buf);
+  return str;
+}
+
+// Copy the neighbor indices into a new MATLAB matrix of doubles.
+static mxArray* NeighborsToMatlab(const arma::Mat<size_t>& neighbors)
+{
+  mxArray* array = mxCreateDoubleMatrix(neighbors.n_rows, neighbors.n_cols,
+      mxREAL);
+  double* out = mxGetPr(array);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+    out[i] = (double) neighbors[i];
+
+  return array;
+}
+
+// The gateway.  The first argument is a command:
+//
+//   handle = allknn_model_mex('build', referencePoints, leafSize)
+//   [distances neighbors] = allknn_model_mex('search', handle, queryPoints, k)
+//   allknn_model_mex('free', handle)
+//
+// Points are columns.  If the query set is empty, the reference set is used as
+// the query set.
+void mexFunction(int nlhs, mxArray *plhs[],
+                 int nrhs, const mxArray *prhs[])
+{
+  if (nrhs < 1)
+    mexErrMsgTxt("Expecting a command.");
+
+  const string command = GetString(prhs[0]);
+  if (command == "build")
+  {
+    if (nrhs != 3)
+      mexErrMsgTxt("Expecting three arguments.");
+    if (nlhs != 1)
+      mexErrMsgTxt("Output required.");
+    if (mxDOUBLE_CLASS != mxGetClassID(prhs[1]))
+      mexErrMsgTxt("Reference points must have type mxDOUBLE_CLASS.");
+
+    const int leafSize = (int) mxGetScalar(prhs[2]);
+    if (leafSize <= 0)
+    {
+      stringstream os;
+      os << "Invalid leaf size: " << leafSize << ".  Must be greater than 0."
+          << endl;
+      mexErrMsgTxt(os.str().c_str());
+    }
+
+    // The tree rearranges the points, so this is the one copy of the reference
+    // set; it is kept in the model.
+    AllkNNModel* model = new AllkNNModel();
+    model->referenceData = arma::mat(mxGetPr(prhs[1]), mxGetM(prhs[1]),
+        mxGetN(prhs[1]));
+    model->tree = new TreeType(model->referenceData, model->oldFromNew,
+        (size_t) leafSize);
+
+    plhs[0] = MexHandle<AllkNNModel>::Create(model);
+  }
+  else if (command == "search")
+  {
+    if (nrhs != 4)
+      mexErrMsgTxt("Expecting four arguments.");
+    if (nlhs != 2)
+      mexErrMsgTxt("Two outputs required.");
+    if (mxDOUBLE_CLASS != mxGetClassID(prhs[2]))
+      mexErrMsgTxt("Query points must have type mxDOUBLE_CLASS.");
+
+    AllkNNModel& model = MexHandle<AllkNNModel>::Get(prhs[1]);
+
+    const size_t k = (size_t) mxGetScalar(prhs[3]);
+    if (k == 0 || k > model.referenceData.n_cols)
+    {
+      stringstream os;
+      os << "Invalid k: " << k << "; must be greater than 0 and less than or "
+          << "equal to the number of reference points ("
+          << model.referenceData.n_cols << ")." << endl;
+      mexErrMsgTxt(os.str().c_str());
+    }
+
+    arma::Mat<size_t> neighbors;
+    const bool hasQueryData = (mxGetM(prhs[2]) != 0) &&
+        (mxGetN(prhs[2]) != 0);
+    if (hasQueryData)
+    {
+      const size_t numQueries = mxGetN(prhs[2]);
+      if (mxGetM(prhs[2]) != model.referenceData.n_rows)
+        mexErrMsgTxt("Query points must have the dimension of the reference "
+            "points.");
+
+      // The query points are only read, and the distances need no unmapping,
+      // so both use MATLAB's memory directly.
+      const arma::mat queryData(mxGetPr(prhs[2]), mxGetM(prhs[2]), numQueries,
+          false, true);
+      plhs[0] = mxCreateDoubleMatrix(k, numQueries, mxREAL);
+      arma::mat distances(mxGetPr(plhs[0]), k, numQueries, false, true);
+
+      SearchType search(model.tree, NULL, model.referenceData, queryData,
+          true);
+      search.Search(k, neighbors, distances);
+
+      for (size_t i = 0; i < neighbors.n_elem; ++i)
+        neighbors[i] = model.oldFromNew[neighbors[i]];
+    }
+    else
+    {
+      // The results for the points of the tree are in tree order.
+      arma::Mat<size_t> treeNeighbors;
+      arma::mat treeDistances;
+      SearchType search(model.tree, model.referenceData);
+      search.Search(k, treeNeighbors, treeDistances);
+
+      const size_t numPoints = model.referenceData.n_cols;
+      plhs[0] = mxCreateDoubleMatrix(k, numPoints, mxREAL);
+      arma::mat distances(mxGetPr(plhs[0]), k, numPoints, false, true);
+      Unmap(treeNeighbors, treeDistances, model.oldFromNew, model.oldFromNew,
+          neighbors, distances);
+    }
+
+    plhs[1] = NeighborsToMatlab(neighbors);
+  }
+  else if (command == "free")
+  {
+    if (nrhs != 2)
+      mexErrMsgTxt("Expecting two arguments.");
+
+    MexHandle<AllkNNModel>::Destroy(prhs[1]);
+  }
+  else
+  {
+    stringstream os;
+    os << "Unknown command '" << command << "'; must be 'build', 'search', or "
+        << "'free'." << endl;
+    mexErrMsgTxt(os.str().c_str());
+  }
+}
@@ -0,0 +1,54 @@
+function varargout = allknn_model(command, varargin)
+% varargout = allknn_model(command, varargin)
+%
+% All k-nearest-neighbors with a kd-tree which is kept between calls.  Building
+% the tree on the reference set is done once by the 'build' command, which
+% returns a handle to the tree; each 'search' command then finds the nearest
+% neighbors of a set of query points with that tree, and 'free' deletes it.
+%
+% Unlike the other bindings, the points are the columns of each matrix (as in
+% MLPACK), so that the matrices don't have to be transposed (and copied): the
+% query points and the distances are used in place, and the only copy of the
+% reference set is the one kept with the tree.
+%
+% Commands:
+%
+% model = allknn_model('build', referencePoints, leafSize)
+%   Build a kd-tree on the reference points (one point per column) with the
+%   given leaf size (defaults to 20), and return a handle to it.
+%
+% [distances neighbors] = allknn_model('search', model, queryPoints, k)
+%   Find the k nearest neighbors of each query point (one point per column).
+%   Column j of neighbors holds the indices of the reference points which are
+%   nearest to query point j, and column j of distances holds the distances to
+%   them.  If queryPoints is empty, the reference set is used as the query set.
+%
+% allknn_model('free', model)
+%   Delete the tree.  The handle must not be used afterwards.
+%
+% Examples:
+%
+% model = allknn_model('build', referencePoints);
+% [distances neighbors] = allknn_model('search', model, queryPoints, 5);
+% [distances neighbors] = allknn_model('search', model, otherQueryPoints, 3);
+% allknn_model('free', model);
+
+if strcmpi(command, 'build')
+  leafSize = 20;
+  if nargin > 2
+    leafSize = varargin{2};
+  end
+  varargout{1} = allknn_model_mex('build', varargin{1}, leafSize);
+elseif strcmpi(command, 'search')
+  [distances neighbors] = allknn_model_mex('search', varargin{1}, ...
+      varargin{2}, varargin{3});
+  varargout{1} = distances;
+  varargout{2} = neighbors + 1; % MATLAB indices begin at 1, not zero.
+elseif strcmpi(command, 'free')
+  allknn_model_mex('free', varargin{1});
+else
+  error('Unknown command ''%s''; must be ''build'', ''search'', or ''free''.', ...
+      command);
+end
+
+return;
@@ -35,14 +35,12 @@ void mexFunction(int nlhs, mxArray *plhs[],
     math::RandomSeed((size_t) std::time(NULL));
 
   // loading the data
-  double * mexDataPoints = mxGetPr(prhs[0]);
+  // Use the MATLAB matrix directly (without copying it); the estimation only
+  // reads it.
   size_t numPoints = mxGetN(prhs[0]);
   size_t numDimensions = mxGetM(prhs[0]);
-  arma::mat dataPoints(numDimensions, numPoints);
-  for (int i = 0, n = numPoints * numDimensions; i < n; ++i)
-  {
-    dataPoints(i) = mexDataPoints[i];
-  }
+  const arma::mat dataPoints(mxGetPr(prhs[0]), numDimensions, numPoints, false,
+      true);
 
   int gaussians = (int) mxGetScalar(prhs[1]);
   if (gaussians <= 0)
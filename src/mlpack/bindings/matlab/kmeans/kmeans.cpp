@@ -82,17 +82,12 @@ void mexFunction(int nlhs, mxArray *plhs[],
   }
   */
 
-  // Load our dataset.
+  // Use the MATLAB matrix directly as our dataset (without copying it); the
+  // clustering only reads it.
   const size_t numPoints = mxGetN(prhs[0]);
   const size_t numDimensions = mxGetM(prhs[0]);
-  arma::mat dataset(numDimensions, numPoints);
-
-  // setting the values.
-  double * mexDataPoints = mxGetPr(prhs[0]);
-  for (int i = 0, n = numPoints * numDimensions; i < n; ++i)
-  {
-    dataset(i) = mexDataPoints[i];
-  }
+  const arma::mat dataset(mxGetPr(prhs[0]), numDimensions, numPoints, false,
+      true);
 
   // Now create the KMeans object.  Because we could be using different types,
   // it gets a little weird...
@@ -27,17 +27,12 @@ void mexFunction(int nlhs, mxArray *plhs[],
   double lambda2 = mxGetScalar(prhs[3]);
   bool useCholesky = (mxGetScalar(prhs[3]) == 1.0);
 
-  // loading covariates
-  mat matX(mxGetM(prhs[0]), mxGetN(prhs[0]));
-  double * values = mxGetPr(prhs[0]);
-  for (int i=0, num=mxGetNumberOfElements(prhs[0]); i<num; ++i)
-    matX(i) = values[i];
-
-  // loading responses
-  mat matY(mxGetM(prhs[1]), mxGetN(prhs[1]));
-  values = mxGetPr(prhs[1]);
-  for (int i=0, num=mxGetNumberOfElements(prhs[1]); i<num; ++i)
-    matY(i) = values[i];
+  // Use the MATLAB matrices as the covariates and responses directly (without
+  // copying them); LARS only reads them.
+  const mat matX(mxGetPr(prhs[0]), mxGetM(prhs[0]), mxGetN(prhs[0]), false,
+      true);
+  const mat matY(mxGetPr(prhs[1]), mxGetM(prhs[1]), mxGetN(prhs[1]), false,
+      true);
 
   if (matY.n_cols > 1)
     mexErrMsgTxt("Only one column or row allowed in responses file!");
@@ -52,7 +47,7 @@ void mexFunction(int nlhs, mxArray *plhs[],
 
   // return to matlab
   plhs[0] = mxCreateDoubleMatrix(beta.n_elem, 1, mxREAL);
-  values = mxGetPr(plhs[0]);
+  double * values = mxGetPr(plhs[0]);
   for (int i = 0; i < beta.n_elem; ++i)
     values[i] = beta(i);
 }
@@ -0,0 +1,121 @@
+/**
+ * @file mex_handle.hpp
+ *
+ * Handles which let MATLAB hold on to C++ objects (such as trees) between
+ * calls to a MEX function.
+ */
+#ifndef __MLPACK_BINDINGS_MATLAB_MEX_HANDLE_HPP
+#define __MLPACK_BINDINGS_MATLAB_MEX_HANDLE_HPP
+
+#include "mex.h"
+
+#include <mlpack/core.hpp>
+
+#include <string>
+#include <typeinfo>
+
+namespace mlpack {
+namespace matlab {
+
+/**
+ * A handle to a C++ object owned by a MEX file.  Create() takes ownership of
+ * an object and returns a uint64 scalar to give back to MATLAB; later calls to
+ * the MEX function pass that scalar back and use Get() to find the object, and
+ * Destroy() deletes it.  The MEX file is locked in memory while any handle
+ * exists, so that MATLAB does not unload it (and lose the objects) on 'clear'.
+ *
+ * Each handle records a signature and the type of the object, so that a scalar
+ * which is not a live handle of the right type is usually caught with an error
+ * rather than crashing MATLAB; a handle must not be used after it has been
+ * destroyed.
+ *
+ * @tparam ObjectType Type of the object held by the handle.
+ */
+template<typename ObjectType>
+class MexHandle
+{
+ public:
+  /**
+   * Take ownership of the given object, and return a MATLAB scalar which holds
+   * a handle to it.
+   *
+   * @param object Object to hold; it will be deleted by Destroy().
+   */
+  static mxArray* Create(ObjectType* object)
+  {
+    MexHandle* handle = new MexHandle(object);
+    mexLock();
+
+    mxArray* array = mxCreateNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
+    *((uint64_t*) mxGetData(array)) = (uint64_t) (uintptr_t) handle;
+    return array;
+  }
+
+  /**
+   * Get the object held by the handle in the given MATLAB scalar.
+   *
+   * @param array MATLAB scalar returned by Create().
+   */
+  static ObjectType& Get(const mxArray* array)
+  {
+    return *FromArray(array)->object;
+  }
+
+  /**
+   * Delete the object held by the handle in the given MATLAB scalar, and the
+   * handle itself.
+   *
+   * @param array MATLAB scalar returned by Create().
+   */
+  static void Destroy(const mxArray* array)
+  {
+    delete FromArray(array);
+    mexUnlock();
+  }
+
+ private:
+  //! The signature of a live handle ("mlpk").
+  static const uint32_t LiveSignature = 0x6d6c706b;
+
+  //! Hold the given object.
+  MexHandle(ObjectType* object) :
+      signature(LiveSignature),
+      name(typeid(ObjectType).name()),
+      object(object)
+  { }
+
+  //! Delete the object, and mark the handle as dead.
+  ~MexHandle()
+  {
+    signature = 0;
+    delete object;
+  }
+
+  //! Get the handle from a MATLAB scalar, and check it.
+  static MexHandle* FromArray(const mxArray* array)
+  {
+    if ((mxGetNumberOfElements(array) != 1) ||
+        (mxGetClassID(array) != mxUINT64_CLASS) || mxIsComplex(array))
+      mexErrMsgTxt("Handle must be a real uint64 scalar.");
+
+    MexHandle* handle = (MexHandle*) (uintptr_t)
+        *((uint64_t*) mxGetData(array));
+    if ((handle == NULL) || (handle->signature != LiveSignature) ||
+        (handle->name != typeid(ObjectType).name()))
+      mexErrMsgTxt("Invalid handle (it may have been freed already).");
+
+    return handle;
+  }
+
+  //! The signature; LiveSignature while the handle is alive.
+  uint32_t signature;
+  //! The name of the type of the object.
+  std::string name;
+  //! The object.
+  ObjectType* object;
+};
+
+}; // namespace matlab
+}; // namespace mlpack
+
+#endif
@@ -25,15 +25,14 @@ void mexFunction(int nlhs, mxArray *plhs[],
     mexErrMsgTxt("Output required.");
   }
 
-  // Load data.
-  mat data(mxGetM(prhs[0]), mxGetN(prhs[0]));
-  double * values = mxGetPr(prhs[0]);
-  for (int i=0, num=mxGetNumberOfElements(prhs[0]); i<num; ++i)
-    data(i) = values[i];
+  // Use the MATLAB matrix as the data directly (without copying it); NCA only
+  // reads it.
+  const mat data(mxGetPr(prhs[0]), mxGetM(prhs[0]), mxGetN(prhs[0]), false,
+      true);
 
   // load labels
   umat labels(mxGetNumberOfElements(prhs[1]), 1);
-  values = mxGetPr(prhs[1]);
+  double * values = mxGetPr(prhs[1]);
   for (int i=0, num=mxGetNumberOfElements(prhs[1]); i<num; ++i)
     labels(i) = (int) values[i];
 
@@ -149,15 +149,26 @@
 #include <mlpack/core/util/log.hpp>
 #include <mlpack/core/util/cli.hpp>
 #include <mlpack/core/util/ostream_extra.hpp>
+#include <mlpack/core/data/compression.hpp>
 #include <mlpack/core/data/load.hpp>
+#include <mlpack/core/data/load_sparse.hpp>
+#include <mlpack/core/data/mapped_matrix.hpp>
 #include <mlpack/core/data/save.hpp>
 #include <mlpack/core/data/normalize_labels.hpp>
+#include <mlpack/core/data/pipeline.hpp>
+#include <mlpack/core/data/space_filling_curve.hpp>
 #include <mlpack/core/math/clamp.hpp>
 #include <mlpack/core/math/random.hpp>
 #include <mlpack/core/math/lin_alg.hpp>
 #include <mlpack/core/math/range.hpp>
 #include <mlpack/core/math/round.hpp>
 #include <mlpack/core/util/save_restore_utility.hpp>
+#include <mlpack/core/util/binary_io.hpp>
+#include <mlpack/core/util/numa.hpp>
+#include <mlpack/core/util/lru_cache.hpp>
+#include <mlpack/core/util/reduction.hpp>
+#include <mlpack/core/util/accelerator.hpp>
+#include <mlpack/core/util/model_selection.hpp>
 #include <mlpack/core/dists/discrete_distribution.hpp>
 #include <mlpack/core/dists/gaussian_distribution.hpp>
 #include <mlpack/core/dists/laplace_distribution.hpp>
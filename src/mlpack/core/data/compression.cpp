@@ -0,0 +1,358 @@
+/**
+ * @file compression.cpp
+ *
+ * Implementation of streaming gzip and zstd (de)compression.  MLPACK_HAS_ZLIB
+ * and MLPACK_HAS_ZSTD are defined by CMake when the libraries are found.
+ */
+#include "compression.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef MLPACK_HAS_ZLIB
+  #include <zlib.h>
+#endif
+#ifdef MLPACK_HAS_ZSTD
+  #include <zstd.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+namespace {
+
+//! Size of the blocks that are read from and written to disk.
+const size_t blockSize = 1 << 16;
+
+//! Give a warning about the given file and return false.
+bool CompressionFailure(const std::string& filename, const std::string& reason)
+{
+  Log::Warn << "'" << filename << "': " << reason << "." << std::endl;
+  return false;
+}
+
+#ifdef MLPACK_HAS_ZLIB
+
+bool GzipDecompress(std::istream& file,
+                    const std::string& filename,
+                    std::ostream& out)
+{
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  // 15 + 32: the largest window, and detect the gzip (or zlib) header.
+  if (inflateInit2(&strm, 15 + 32) != Z_OK)
+    return CompressionFailure(filename, "could not initialize zlib");
+
+  std::vector<char> inBuf(blockSize), outBuf(blockSize);
+  int ret = Z_OK;
+  while (file)
+  {
+    file.read(&inBuf[0], inBuf.size());
+    const size_t count = file.gcount();
+    if (count == 0)
+      break;
+
+    strm.next_in = reinterpret_cast<Bytef*>(&inBuf[0]);
+    strm.avail_in = count;
+    while (true)
+    {
+      // Another gzip member may follow the end of the last one.
+      if (ret == Z_STREAM_END)
+      {
+        if (strm.avail_in == 0)
+          break;
+        inflateReset(&strm);
+      }
+
+      strm.next_out = reinterpret_cast<Bytef*>(&outBuf[0]);
+      strm.avail_out = outBuf.size();
+      ret = inflate(&strm, Z_NO_FLUSH);
+      if (ret == Z_BUF_ERROR) // More input is needed.
+      {
+        ret = Z_OK;
+        break;
+      }
+      else if (ret != Z_OK && ret != Z_STREAM_END)
+      {
+        const std::string message = (strm.msg != NULL) ? strm.msg :
+            "unknown error";
+        inflateEnd(&strm);
+        return CompressionFailure(filename, "gzip decompression failed (" +
+            message + ")");
+      }
+
+      out.write(&outBuf[0], outBuf.size() - strm.avail_out);
+      if (strm.avail_in == 0 && strm.avail_out != 0)
+        break;
+    }
+  }
+
+  inflateEnd(&strm);
+  if (ret != Z_STREAM_END)
+    return CompressionFailure(filename, "unexpected end of gzip data");
+
+  return out.good();
+}
+
+bool GzipCompress(std::istream& in,
+                  const std::string& filename,
+                  std::ostream& file)
+{
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  // 15 + 16: the largest window, and write a gzip header.
+  if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+      Z_DEFAULT_STRATEGY) != Z_OK)
+    return CompressionFailure(filename, "could not initialize zlib");
+
+  std::vector<char> inBuf(blockSize), outBuf(blockSize);
+  int flush = Z_NO_FLUSH;
+  while (flush != Z_FINISH)
+  {
+    in.read(&inBuf[0], inBuf.size());
+    const size_t count = in.gcount();
+    flush = (count < inBuf.size()) ? Z_FINISH : Z_NO_FLUSH;
+
+    strm.next_in = reinterpret_cast<Bytef*>(&inBuf[0]);
+    strm.avail_in = count;
+    do
+    {
+      strm.next_out = reinterpret_cast<Bytef*>(&outBuf[0]);
+      strm.avail_out = outBuf.size();
+      deflate(&strm, flush);
+      file.write(&outBuf[0], outBuf.size() - strm.avail_out);
+    } while (strm.avail_out == 0);
+  }
+
+  deflateEnd(&strm);
+  return file.good();
+}
+
+#endif
+
+#ifdef MLPACK_HAS_ZSTD
+
+bool ZstdDecompress(std::istream& file,
+                    const std::string& filename,
+                    std::ostream& out)
+{
+  ZSTD_DStream* stream = ZSTD_createDStream();
+  if (stream == NULL || ZSTD_isError(ZSTD_initDStream(stream)))
+  {
+    ZSTD_freeDStream(stream);
+    return CompressionFailure(filename, "could not initialize zstd");
+  }
+
+  std::vector<char> inBuf(ZSTD_DStreamInSize()), outBuf(ZSTD_DStreamOutSize());
+  size_t ret = 1;
+  while (file)
+  {
+    file.read(&inBuf[0], inBuf.size());
+    const size_t count = file.gcount();
+    if (count == 0)
+      break;
+
+    // Keep going while there is input, or while the output buffer was filled
+    // (there may be more output waiting).  Each new frame is started
+    // automatically.
+    ZSTD_inBuffer input = { &inBuf[0], count, 0 };
+    ZSTD_outBuffer output;
+    do
+    {
+      output.dst = &outBuf[0];
+      output.size = outBuf.size();
+      output.pos = 0;
+      ret = ZSTD_decompressStream(stream, &output, &input);
+      if (ZSTD_isError(ret))
+      {
+        const std::string message = ZSTD_getErrorName(ret);
+        ZSTD_freeDStream(stream);
+        return CompressionFailure(filename, "zstd decompression failed (" +
+            message + ")");
+      }
+
+      out.write(&outBuf[0], output.pos);
+    } while (input.pos < input.size || output.pos == output.size);
+  }
+
+  ZSTD_freeDStream(stream);
+  // ZSTD_decompressStream() returns 0 only when a frame is complete.
+  if (ret != 0)
+    return CompressionFailure(filename, "unexpected end of zstd data");
+
+  return out.good();
+}
+
+bool ZstdCompress(std::istream& in,
+                  const std::string& filename,
+                  std::ostream& file)
+{
+  ZSTD_CStream* stream = ZSTD_createCStream();
+  if (stream == NULL || ZSTD_isError(ZSTD_initCStream(stream, 3)))
+  {
+    ZSTD_freeCStream(stream);
+    return CompressionFailure(filename, "could not initialize zstd");
+  }
+
+  std::vector<char> inBuf(ZSTD_CStreamInSize()), outBuf(ZSTD_CStreamOutSize());
+  ZSTD_outBuffer output;
+  while (in)
+  {
+    in.read(&inBuf[0], inBuf.size());
+    const size_t count = in.gcount();
+    if (count == 0)
+      break;
+
+    ZSTD_inBuffer input = { &inBuf[0], count, 0 };
+    while (input.pos < input.size)
+    {
+      output.dst = &outBuf[0];
+      output.size = outBuf.size();
+      output.pos = 0;
+      const size_t ret = ZSTD_compressStream(stream, &output, &input);
+      if (ZSTD_isError(ret))
+      {
+        ZSTD_freeCStream(stream);
+        return CompressionFailure(filename, std::string("zstd compression "
+            "failed (") + ZSTD_getErrorName(ret) + ")");
+      }
+
+      file.write(&outBuf[0], output.pos);
+    }
+  }
+
+  // Flush whatever is left and end the frame.
+  size_t remaining;
+  do
+  {
+    output.dst = &outBuf[0];
+    output.size = outBuf.size();
+    output.pos = 0;
+    remaining = ZSTD_endStream(stream, &output);
+    if (ZSTD_isError(remaining))
+    {
+      ZSTD_freeCStream(stream);
+      return CompressionFailure(filename, std::string("zstd compression "
+          "failed (") + ZSTD_getErrorName(remaining) + ")");
+    }
+
+    file.write(&outBuf[0], output.pos);
+  } while (remaining > 0);
+
+  ZSTD_freeCStream(stream);
+  return file.good();
+}
+
+#endif
+
+//! Give a warning that the given compression isn't available.
+bool Unsupported(const std::string& filename, const Compression compression)
+{
+  return CompressionFailure(filename, std::string("mlpack was built without ") +
+      ((compression == GZIP_COMPRESSION) ? "zlib; gzip" : "libzstd; zstd") +
+      " compressed files can't be used");
+}
+
+} // anonymous namespace
+
+Compression mlpack::data::GetCompression(const std::string& filename,
+                                         std::string& innerName)
+{
+  innerName = filename;
+
+  const size_t ext = filename.rfind('.');
+  if (ext == std::string::npos)
+    return NO_COMPRESSION;
+
+  std::string extension = filename.substr(ext + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+      ::tolower);
+
+  Compression compression = NO_COMPRESSION;
+  if (extension == "gz")
+    compression = GZIP_COMPRESSION;
+  else if (extension == "zst")
+    compression = ZSTD_COMPRESSION;
+
+  if (compression != NO_COMPRESSION)
+    innerName = filename.substr(0, ext);
+
+  return compression;
+}
+
+bool mlpack::data::CompressionSupported(const Compression compression)
+{
+  switch (compression)
+  {
+    case GZIP_COMPRESSION:
+#ifdef MLPACK_HAS_ZLIB
+      return true;
+#else
+      return false;
+#endif
+    case ZSTD_COMPRESSION:
+#ifdef MLPACK_HAS_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    default:
+      return true;
+  }
+}
+
+bool mlpack::data::Decompress(const std::string& filename,
+                              const Compression compression,
+                              std::ostream& out)
+{
+  if (!CompressionSupported(compression))
+    return Unsupported(filename, compression);
+
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file.is_open())
+    return CompressionFailure(filename, "cannot open file");
+
+  switch (compression)
+  {
+#ifdef MLPACK_HAS_ZLIB
+    case GZIP_COMPRESSION:
+      return GzipDecompress(file, filename, out);
+#endif
+#ifdef MLPACK_HAS_ZSTD
+    case ZSTD_COMPRESSION:
+      return ZstdDecompress(file, filename, out);
+#endif
+    default:
+      out << file.rdbuf();
+      return out.good();
+  }
+}
+
+bool mlpack::data::Compress(std::istream& in,
+                            const Compression compression,
+                            const std::string& filename)
+{
+  if (!CompressionSupported(compression))
+    return Unsupported(filename, compression);
+
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!file.is_open())
+    return CompressionFailure(filename, "cannot open file for writing");
+
+  switch (compression)
+  {
+#ifdef MLPACK_HAS_ZLIB
+    case GZIP_COMPRESSION:
+      return GzipCompress(in, filename, file);
+#endif
+#ifdef MLPACK_HAS_ZSTD
+    case ZSTD_COMPRESSION:
+      return ZstdCompress(in, filename, file);
+#endif
+    default:
+      file << in.rdbuf();
+      return file.good();
+  }
+}
@@ -0,0 +1,78 @@
+/**
+ * @file compression.hpp
+ *
+ * Streaming gzip and zstd (de)compression, used by data::Load() and
+ * data::Save() for files ending in .gz or .zst.
+ */
+#ifndef __MLPACK_CORE_DATA_COMPRESSION_HPP
+#define __MLPACK_CORE_DATA_COMPRESSION_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <iostream>
+#include <string>
+
+namespace mlpack {
+namespace data {
+
+//! Compression formats understood by data::Load() and data::Save().
+enum Compression
+{
+  NO_COMPRESSION,
+  GZIP_COMPRESSION, // Denoted by .gz.
+  ZSTD_COMPRESSION  // Denoted by .zst.
+};
+
+/**
+ * Get the compression of the given file from its extension: .gz is gzip and
+ * .zst is zstd (in any case).  If the file is compressed, innerName is set to
+ * the filename without the compression extension (so "data.csv.gz" gives
+ * "data.csv"); otherwise it is set to the filename.
+ *
+ * @param filename Name of the file.
+ * @param innerName Set to the filename without the compression extension.
+ * @return Compression of the file.
+ */
+Compression GetCompression(const std::string& filename,
+                           std::string& innerName);
+
+/**
+ * Return whether or not mlpack was built with support for the given
+ * compression.  gzip needs zlib and zstd needs libzstd; both are found by CMake
+ * if they are installed.
+ */
+bool CompressionSupported(const Compression compression);
+
+/**
+ * Decompress the given file, a block at a time, writing the decompressed data
+ * to the given stream.  The compressed file is never held in memory and
+ * nothing is written to disk.  Concatenated gzip members and zstd frames are
+ * decompressed one after the other, as gunzip and unzstd do.  If the file
+ * can't be read or is corrupt, a warning is given and false is returned.
+ *
+ * @param filename Name of compressed file.
+ * @param compression Compression of the file.
+ * @param out Stream to write decompressed data to.
+ * @return Whether or not the file was decompressed.
+ */
+bool Decompress(const std::string& filename,
+                const Compression compression,
+                std::ostream& out);
+
+/**
+ * Compress the contents of the given stream, a block at a time, into the given
+ * file.  If the file can't be written, a warning is given and false is
+ * returned.
+ *
+ * @param in Stream to compress the remaining contents of.
+ * @param compression Compression to use.
+ * @param filename Name of file to write.
+ * @return Whether or not the file was written.
+ */
+bool Compress(std::istream& in,
+              const Compression compression,
+              const std::string& filename);
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
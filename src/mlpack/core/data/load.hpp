@@ -24,7 +24,7 @@ namespace data /** Functions to load and save matrices. */ {
  * The supported types of files are the same as found in Armadillo:
  *
  *  - CSV (csv_ascii), denoted by .csv, or optionally .txt
- *  - ASCII (raw_ascii), denoted by .txt
+ *  - ASCII (raw_ascii), denoted by .txt or .tsv
  *  - Armadillo ASCII (arma_ascii), also denoted by .txt
  *  - PGM (pgm_binary), denoted by .pgm
  *  - PPM (ppm_binary), denoted by .ppm
@@ -32,6 +32,14 @@ namespace data /** Functions to load and save matrices. */ {
  *  - Armadillo binary (arma_binary), denoted by .bin
  *  - HDF5, denoted by .hdf, .hdf5, .h5, or .he5
  *
+ * CSV and ASCII files are read with a parallel parser (see LoadText()) which
+ * writes each value directly to its place in the transposed matrix.
+ *
+ * Any of these files may be compressed with gzip, denoted by a further .gz
+ * (e.g. data.csv.gz), or zstd, denoted by .zst, if mlpack was built with zlib
+ * or libzstd respectively.  The file is decompressed a block at a time into
+ * memory, so no temporary file is needed.
+ *
  * If the file extension is not one of those types, an error will be given.
  * This is preferable to Armadillo's default behavior of loading an unknown
  * filetype as raw_binary, which can have very confusing effects.
@@ -9,8 +9,12 @@
 
 // In case it hasn't already been included.
 #include "load.hpp"
+#include "compression.hpp"
+#include "load_text.hpp"
+#include "transpose.hpp"
 
 #include <algorithm>
+#include <sstream>
 #include <mlpack/core/util/timers.hpp>
 
 namespace mlpack {
@@ -24,8 +28,13 @@ bool Load(const std::string& filename,
 {
   Timer::Start("loading_data");
 
+  // A compressed file has the extension of its contents under the compression
+  // extension (e.g. data.csv.gz).
+  std::string innerName;
+  const Compression compression = GetCompression(filename, innerName);
+
   // First we will try to discriminate by file extension.
-  size_t ext = filename.rfind('.');
+  size_t ext = innerName.rfind('.');
   if (ext == std::string::npos)
   {
     Timer::Stop("loading_data");
@@ -40,26 +49,48 @@ bool Load(const std::string& filename,
   }
 
   // Get the extension and force it to lowercase.
-  std::string extension = filename.substr(ext + 1);
+  std::string extension = innerName.substr(ext + 1);
   std::transform(extension.begin(), extension.end(), extension.begin(),
       ::tolower);
 
-  // Catch nonexistent files by opening the stream ourselves.
-  std::fstream stream;
-  stream.open(filename.c_str(), std::fstream::in);
+  // Catch nonexistent files by opening the stream ourselves.  Compressed files
+  // are decompressed a block at a time into memory (never to disk); the
+  // loaders below need to seek back to the start, so they can't read from the
+  // decompressor directly.
+  std::fstream fileStream;
+  std::stringstream memoryStream;
+  if (compression == NO_COMPRESSION)
+  {
+    fileStream.open(filename.c_str(), std::fstream::in);
 
-  if (!stream.is_open())
+    if (!fileStream.is_open())
+    {
+      Timer::Stop("loading_data");
+      if (fatal)
+        Log::Fatal << "Cannot open file '" << filename << "'. " << std::endl;
+      else
+        Log::Warn << "Cannot open file '" << filename << "'; load failed."
+            << std::endl;
+
+      return false;
+    }
+  }
+  else if (!Decompress(filename, compression, memoryStream))
   {
     Timer::Stop("loading_data");
     if (fatal)
-      Log::Fatal << "Cannot open file '" << filename << "'. " << std::endl;
+      Log::Fatal << "Cannot decompress file '" << filename << "'. "
+          << std::endl;
     else
-      Log::Warn << "Cannot open file '" << filename << "'; load failed."
+      Log::Warn << "Cannot decompress file '" << filename << "'; load failed."
           << std::endl;
 
     return false;
   }
 
+  std::iostream& stream = (compression == NO_COMPRESSION) ?
+      static_cast<std::iostream&>(fileStream) : memoryStream;
+
   bool unknownType = false;
   arma::file_type loadType;
   std::string stringType;
@@ -69,6 +100,11 @@ bool Load(const std::string& filename,
     loadType = arma::csv_ascii;
     stringType = "CSV data";
   }
+  else if (extension == "tsv")
+  {
+    loadType = arma::raw_ascii;
+    stringType = "raw ASCII formatted data";
+  }
   else if (extension == "txt")
   {
     // This could be raw ASCII or Armadillo ASCII (ASCII with size header).
@@ -201,7 +237,25 @@ bool Load(const std::string& filename,
     Log::Info << "Loading '" << filename << "' as " << stringType << ".  "
         << std::flush;
 
-  const bool success = matrix.load(stream, loadType);
+  // CSV and raw ASCII files are parsed by LoadText(), which is much faster
+  // than Armadillo and can transpose as it goes; Armadillo binary files can be
+  // transposed as they are read, too.
+  bool success;
+  bool transposed = false;
+  if (loadType == arma::csv_ascii || loadType == arma::raw_ascii)
+  {
+    success = LoadText(stream, matrix, loadType == arma::csv_ascii, transpose);
+    transposed = transpose;
+  }
+  else if (loadType == arma::arma_binary && transpose)
+  {
+    success = LoadTransposedArmaBinary(stream, matrix);
+    transposed = true;
+  }
+  else
+  {
+    success = matrix.load(stream, loadType);
+  }
 
   if (!success)
   {
@@ -215,12 +269,17 @@ bool Load(const std::string& filename,
     return false;
   }
   else
-    Log::Info << "Size is " << (transpose ? matrix.n_cols : matrix.n_rows)
-        << " x " << (transpose ? matrix.n_rows : matrix.n_cols) << ".\n";
+    Log::Info << "Size is " << (transpose && !transposed ? matrix.n_cols :
+        matrix.n_rows) << " x " << (transpose && !transposed ? matrix.n_rows :
+        matrix.n_cols) << ".\n";
+
+  // Now transpose the matrix, if necessary, without a second copy.
+  if (transpose && !transposed)
+    InplaceTranspose(matrix);
 
-  // Now transpose the matrix, if necessary.
-  if (transpose)
-    matrix = trans(matrix);
+  // The size of the dataset, for --metrics_file.
+  Metric::Set("loaded_data/" + filename + "/rows", matrix.n_rows);
+  Metric::Set("loaded_data/" + filename + "/cols", matrix.n_cols);
 
   Timer::Stop("loading_data");
 
@@ -0,0 +1,71 @@
+/**
+ * @file load_sparse.hpp
+ *
+ * Load sparse matrices from coordinate list, Matrix Market, and libsvm files
+ * straight into an arma::SpMat, without ever building a dense matrix.
+ */
+#ifndef __MLPACK_CORE_DATA_LOAD_SPARSE_HPP
+#define __MLPACK_CORE_DATA_LOAD_SPARSE_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <string>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Loads a sparse matrix from file, guessing the filetype from the extension.
+ * Like the dense data::Load(), each row of the file is taken to be one point,
+ * so by default the matrix is transposed so that each point is a column.  The
+ * supported types of files are:
+ *
+ *  - Coordinate lists, denoted by .csv, .txt, .tsv or .coo: each line holds a
+ *    row index, a column index and a value (0-based, separated by commas or
+ *    whitespace)
+ *  - Matrix Market coordinate files (real, integer or pattern; general or
+ *    symmetric), denoted by .mtx
+ *  - libsvm files, denoted by .svm or .libsvm: each line is a point, given as
+ *    a label followed by index:value pairs (1-based); the labels are ignored
+ *    by this overload
+ *
+ * Every line is parsed straight into a list of nonzero elements, so memory use
+ * is proportional to the number of nonzeros.  Each element may be given only
+ * once.  Any of these may be compressed with gzip or zstd, as for dense files
+ * (e.g. data.mtx.gz).
+ *
+ * @param filename Name of file to load.
+ * @param matrix Sparse matrix to load contents of file into.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @param transpose If true, transpose the matrix after loading.
+ * @return Boolean value indicating success or failure of load.
+ */
+template<typename eT>
+bool Load(const std::string& filename,
+          arma::SpMat<eT>& matrix,
+          bool fatal = false,
+          bool transpose = true);
+
+/**
+ * Loads a libsvm file into a sparse matrix, with one point per column, and the
+ * label of each point.
+ *
+ * @param filename Name of file to load.
+ * @param matrix Sparse matrix to load the points into.
+ * @param labels Vector to load the labels into.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @return Boolean value indicating success or failure of load.
+ */
+template<typename eT>
+bool LoadLibSVM(const std::string& filename,
+                arma::SpMat<eT>& matrix,
+                arma::vec& labels,
+                bool fatal = false);
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "load_sparse_impl.hpp"
+
+#endif
@@ -0,0 +1,474 @@
+/**
+ * @file load_sparse_impl.hpp
+ *
+ * Implementation of the sparse matrix loaders.
+ */
+#ifndef __MLPACK_CORE_DATA_LOAD_SPARSE_IMPL_HPP
+#define __MLPACK_CORE_DATA_LOAD_SPARSE_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "load_sparse.hpp"
+#include "compression.hpp"
+
+#include <mlpack/core/util/timers.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace mlpack {
+namespace data {
+namespace detail {
+
+//! Report a failed sparse load, and return false.
+inline bool SparseLoadFailure(const std::string& filename,
+                              const std::string& reason,
+                              const bool fatal)
+{
+  Timer::Stop("loading_data");
+  if (fatal)
+    Log::Fatal << "Loading from '" << filename << "' failed: " << reason << "."
+        << std::endl;
+  else
+    Log::Warn << "Loading from '" << filename << "' failed: " << reason << "."
+        << std::endl;
+
+  return false;
+}
+
+/**
+ * Open the given file for reading, and get the lowercase extension of its
+ * contents.  Compressed files (.gz or .zst) are decompressed into memoryStream.
+ * Returns the stream to read, or NULL if the file can't be read.
+ */
+inline std::istream* OpenSparseFile(const std::string& filename,
+                                    std::ifstream& fileStream,
+                                    std::stringstream& memoryStream,
+                                    std::string& extension)
+{
+  std::string innerName;
+  const Compression compression = GetCompression(filename, innerName);
+
+  const size_t ext = innerName.rfind('.');
+  extension = (ext == std::string::npos) ? "" : innerName.substr(ext + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+      ::tolower);
+
+  if (compression != NO_COMPRESSION)
+    return Decompress(filename, compression, memoryStream) ? &memoryStream :
+        NULL;
+
+  fileStream.open(filename.c_str());
+  return fileStream.is_open() ? &fileStream : NULL;
+}
+
+/**
+ * The nonzero elements of a sparse matrix, collected while a file is parsed.
+ */
+template<typename eT>
+struct SparseElements
+{
+  std::vector<arma::uword> rows;
+  std::vector<arma::uword> cols;
+  std::vector<eT> values;
+
+  void Add(const size_t row, const size_t col, const eT value)
+  {
+    rows.push_back(row);
+    cols.push_back(col);
+    values.push_back(value);
+  }
+
+  /**
+   * Build the matrix, of the given size (or transposed).  The elements are
+   * released as they are copied.
+   */
+  void Build(arma::SpMat<eT>& matrix,
+             const size_t nRows,
+             const size_t nCols,
+             const bool transpose)
+  {
+    arma::umat locations(2, values.size());
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+      locations(0, i) = transpose ? cols[i] : rows[i];
+      locations(1, i) = transpose ? rows[i] : cols[i];
+    }
+    std::vector<arma::uword>().swap(rows);
+    std::vector<arma::uword>().swap(cols);
+
+    arma::Col<eT> elements(values.size());
+    if (values.size() > 0)
+      std::copy(values.begin(), values.end(), elements.begin());
+    std::vector<eT>().swap(values);
+
+    matrix = arma::SpMat<eT>(locations, elements, transpose ? nCols : nRows,
+        transpose ? nRows : nCols);
+  }
+};
+
+//! Parse a nonnegative integer; return false if there isn't one.
+inline bool ParseIndex(const char*& p, size_t& index)
+{
+  char* end;
+  const long long value = std::strtoll(p, &end, 10);
+  if (end == p || value < 0)
+    return false;
+
+  index = (size_t) value;
+  p = end;
+  return true;
+}
+
+//! Parse a number; return false if there isn't one.
+inline bool ParseValue(const char*& p, double& value)
+{
+  char* end;
+  value = std::strtod(p, &end);
+  if (end == p)
+    return false;
+
+  p = end;
+  return true;
+}
+
+//! Skip whitespace and (optionally) one comma.
+inline void SkipSeparator(const char*& p)
+{
+  while (*p == ' ' || *p == '\t' || *p == '\r')
+    ++p;
+  if (*p == ',')
+    ++p;
+}
+
+//! Return whether only whitespace is left on the line.
+inline bool LineEnded(const char* p)
+{
+  while (*p == ' ' || *p == '\t' || *p == '\r')
+    ++p;
+  return (*p == '\0');
+}
+
+//! Return whether the line is blank.
+inline bool BlankLine(const std::string& line)
+{
+  return (line.find_first_not_of(" \t\r") == std::string::npos);
+}
+
+template<typename eT>
+bool LoadCoordinateList(std::istream& stream,
+                        const std::string& filename,
+                        arma::SpMat<eT>& matrix,
+                        const bool fatal,
+                        const bool transpose)
+{
+  SparseElements<eT> elements;
+  size_t nRows = 0;
+  size_t nCols = 0;
+
+  std::string line;
+  size_t lineNumber = 0;
+  while (std::getline(stream, line))
+  {
+    ++lineNumber;
+    if (BlankLine(line))
+      continue;
+
+    const char* p = line.c_str();
+    size_t row, col;
+    double value;
+    bool valid = ParseIndex(p, row);
+    SkipSeparator(p);
+    valid = valid && ParseIndex(p, col);
+    SkipSeparator(p);
+    valid = valid && ParseValue(p, value) && LineEnded(p);
+    if (!valid)
+    {
+      std::ostringstream reason;
+      reason << "line " << lineNumber << " is not 'row col value'";
+      return SparseLoadFailure(filename, reason.str(), fatal);
+    }
+
+    nRows = std::max(nRows, row + 1);
+    nCols = std::max(nCols, col + 1);
+    if (value != 0.0)
+      elements.Add(row, col, (eT) value);
+  }
+
+  elements.Build(matrix, nRows, nCols, transpose);
+  return true;
+}
+
+template<typename eT>
+bool LoadMatrixMarket(std::istream& stream,
+                      const std::string& filename,
+                      arma::SpMat<eT>& matrix,
+                      const bool fatal,
+                      const bool transpose)
+{
+  std::string line;
+  if (!std::getline(stream, line))
+    return SparseLoadFailure(filename, "the file is empty", fatal);
+
+  // The banner gives the format: %%MatrixMarket matrix coordinate real general.
+  std::istringstream banner(line);
+  std::string magic, object, format, field, symmetry;
+  banner >> magic >> object >> format >> field >> symmetry;
+  std::transform(object.begin(), object.end(), object.begin(), ::tolower);
+  std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+  std::transform(field.begin(), field.end(), field.begin(), ::tolower);
+  std::transform(symmetry.begin(), symmetry.end(), symmetry.begin(),
+      ::tolower);
+
+  if (magic != "%%MatrixMarket" || object != "matrix")
+    return SparseLoadFailure(filename, "no Matrix Market banner", fatal);
+  if (format != "coordinate")
+    return SparseLoadFailure(filename, "only the coordinate format is "
+        "supported", fatal);
+  if (field != "real" && field != "double" && field != "integer" &&
+      field != "pattern")
+    return SparseLoadFailure(filename, "unsupported field '" + field + "'",
+        fatal);
+  if (symmetry != "general" && symmetry != "symmetric")
+    return SparseLoadFailure(filename, "unsupported symmetry '" + symmetry +
+        "'", fatal);
+
+  const bool pattern = (field == "pattern");
+  const bool symmetric = (symmetry == "symmetric");
+
+  // Skip comments; the first other line is the size.
+  size_t nRows = 0, nCols = 0, nonzeros = 0;
+  bool sizeRead = false;
+  while (!sizeRead && std::getline(stream, line))
+  {
+    if (line.empty() || line[0] == '%' || BlankLine(line))
+      continue;
+
+    std::istringstream size(line);
+    if (!(size >> nRows >> nCols >> nonzeros))
+      return SparseLoadFailure(filename, "invalid size line", fatal);
+    sizeRead = true;
+  }
+
+  if (!sizeRead)
+    return SparseLoadFailure(filename, "no size line", fatal);
+
+  SparseElements<eT> elements;
+  elements.rows.reserve(symmetric ? 2 * nonzeros : nonzeros);
+  elements.cols.reserve(symmetric ? 2 * nonzeros : nonzeros);
+  elements.values.reserve(symmetric ? 2 * nonzeros : nonzeros);
+
+  size_t read = 0;
+  while (read < nonzeros && std::getline(stream, line))
+  {
+    if (line.empty() || line[0] == '%' || BlankLine(line))
+      continue;
+
+    const char* p = line.c_str();
+    size_t row, col;
+    double value = 1.0;
+    bool valid = ParseIndex(p, row) && ParseIndex(p, col);
+    if (valid && !pattern)
+      valid = ParseValue(p, value);
+    valid = valid && LineEnded(p) && row >= 1 && row <= nRows && col >= 1 &&
+        col <= nCols;
+    if (!valid)
+    {
+      std::ostringstream reason;
+      reason << "invalid entry '" << line << "'";
+      return SparseLoadFailure(filename, reason.str(), fatal);
+    }
+
+    ++read;
+    if (value == 0.0)
+      continue;
+
+    elements.Add(row - 1, col - 1, (eT) value);
+    if (symmetric && row != col)
+      elements.Add(col - 1, row - 1, (eT) value);
+  }
+
+  if (read < nonzeros)
+    return SparseLoadFailure(filename, "fewer entries than the size line "
+        "gives", fatal);
+
+  elements.Build(matrix, nRows, nCols, transpose);
+  return true;
+}
+
+template<typename eT>
+bool LoadLibSVM(std::istream& stream,
+                const std::string& filename,
+                arma::SpMat<eT>& matrix,
+                std::vector<double>& labels,
+                const bool fatal)
+{
+  // Each line is a point, so it is a column of the result.
+  SparseElements<eT> elements;
+  size_t dimensionality = 0;
+
+  std::string line;
+  size_t lineNumber = 0;
+  while (std::getline(stream, line))
+  {
+    ++lineNumber;
+
+    // Anything after a '#' is a comment.
+    const size_t comment = line.find('#');
+    if (comment != std::string::npos)
+      line.erase(comment);
+    if (BlankLine(line))
+      continue;
+
+    const char* p = line.c_str();
+    double label;
+    bool valid = ParseValue(p, label);
+    while (valid && !LineEnded(p))
+    {
+      size_t index;
+      double value;
+      while (*p == ' ' || *p == '\t')
+        ++p;
+      valid = ParseIndex(p, index) && (index >= 1) && (*p == ':');
+      if (valid)
+      {
+        ++p;
+        valid = ParseValue(p, value);
+      }
+
+      if (valid)
+      {
+        dimensionality = std::max(dimensionality, index);
+        if (value != 0.0)
+          elements.Add(index - 1, labels.size(), (eT) value);
+      }
+    }
+
+    if (!valid)
+    {
+      std::ostringstream reason;
+      reason << "line " << lineNumber << " is not 'label index:value ...'";
+      return SparseLoadFailure(filename, reason.str(), fatal);
+    }
+
+    labels.push_back(label);
+  }
+
+  elements.Build(matrix, dimensionality, labels.size(), false);
+  return true;
+}
+
+}; // namespace detail
+
+template<typename eT>
+bool Load(const std::string& filename,
+          arma::SpMat<eT>& matrix,
+          bool fatal,
+          bool transpose)
+{
+  Timer::Start("loading_data");
+
+  // Get the extension (under any compression extension) and open the file.
+  std::string extension;
+  std::ifstream fileStream;
+  std::stringstream memoryStream;
+  std::istream* file = detail::OpenSparseFile(filename, fileStream,
+      memoryStream, extension);
+  if (file == NULL)
+    return detail::SparseLoadFailure(filename, "cannot open file", fatal);
+  std::istream& stream = *file;
+
+  bool success;
+  if (extension == "csv" || extension == "txt" || extension == "tsv" ||
+      extension == "coo")
+  {
+    Log::Info << "Loading '" << filename << "' as a coordinate list.  "
+        << std::flush;
+    success = detail::LoadCoordinateList(stream, filename, matrix, fatal,
+        transpose);
+  }
+  else if (extension == "mtx")
+  {
+    Log::Info << "Loading '" << filename << "' as a Matrix Market file.  "
+        << std::flush;
+    success = detail::LoadMatrixMarket(stream, filename, matrix, fatal,
+        transpose);
+  }
+  else if (extension == "svm" || extension == "libsvm")
+  {
+    Log::Info << "Loading '" << filename << "' as a libsvm file (labels are "
+        << "ignored).  " << std::flush;
+    std::vector<double> labels;
+    success = detail::LoadLibSVM(stream, filename, matrix, labels, fatal);
+
+    // libsvm files already have one point per column.
+    if (success && !transpose)
+      matrix = trans(matrix);
+  }
+  else
+  {
+    return detail::SparseLoadFailure(filename, "unknown sparse file type; "
+        "incorrect extension?", fatal);
+  }
+
+  if (!success)
+    return false;
+
+  Log::Info << "Size is " << matrix.n_rows << " x " << matrix.n_cols << ", "
+      << "with " << matrix.n_nonzero << " nonzero elements." << std::endl;
+
+  // The size of the dataset, for --metrics_file.
+  Metric::Set("loaded_data/" + filename + "/rows", matrix.n_rows);
+  Metric::Set("loaded_data/" + filename + "/cols", matrix.n_cols);
+  Metric::Set("loaded_data/" + filename + "/nonzeros", matrix.n_nonzero);
+
+  Timer::Stop("loading_data");
+  return true;
+}
+
+template<typename eT>
+bool LoadLibSVM(const std::string& filename,
+                arma::SpMat<eT>& matrix,
+                arma::vec& labels,
+                bool fatal)
+{
+  Timer::Start("loading_data");
+
+  std::string extension;
+  std::ifstream fileStream;
+  std::stringstream memoryStream;
+  std::istream* file = detail::OpenSparseFile(filename, fileStream,
+      memoryStream, extension);
+  if (file == NULL)
+    return detail::SparseLoadFailure(filename, "cannot open file", fatal);
+  std::istream& stream = *file;
+
+  Log::Info << "Loading '" << filename << "' as a libsvm file.  "
+      << std::flush;
+
+  std::vector<double> labelList;
+  if (!detail::LoadLibSVM(stream, filename, matrix, labelList, fatal))
+    return false;
+
+  labels.set_size(labelList.size());
+  if (labelList.size() > 0)
+    std::copy(labelList.begin(), labelList.end(), labels.begin());
+
+  Log::Info << "Size is " << matrix.n_rows << " x " << matrix.n_cols << ", "
+      << "with " << matrix.n_nonzero << " nonzero elements." << std::endl;
+
+  // The size of the dataset, for --metrics_file.
+  Metric::Set("loaded_data/" + filename + "/rows", matrix.n_rows);
+  Metric::Set("loaded_data/" + filename + "/cols", matrix.n_cols);
+  Metric::Set("loaded_data/" + filename + "/nonzeros", matrix.n_nonzero);
+
+  Timer::Stop("loading_data");
+  return true;
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,187 @@
+/**
+ * @file load_text.hpp
+ *
+ * A parser for CSV and whitespace-separated ASCII matrix files, used by
+ * data::Load().  It is much faster than Armadillo's stream parser: the file is
+ * read in large chunks, the lines of each chunk are parsed in parallel (if
+ * OpenMP is available), and each value is written directly to its final
+ * place, so a transposed load needs no separate transpose step.
+ */
+#ifndef __MLPACK_CORE_DATA_LOAD_TEXT_HPP
+#define __MLPACK_CORE_DATA_LOAD_TEXT_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <istream>
+#include <vector>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Load a matrix from a CSV or whitespace-separated ASCII stream.  Each
+ * non-blank line of the stream is one row of the file; every row must have
+ * the same number of values.  In CSV files, an empty field is taken to be 0,
+ * as in Armadillo.  The stream must be seekable, because it is read twice: once
+ * to count the rows, so that the matrix can be allocated at its final size,
+ * and once to parse them.
+ *
+ * If an error is found, a warning describing it is given and false is
+ * returned.
+ *
+ * @param stream Stream to read from.
+ * @param matrix Matrix to load the file into.
+ * @param csv If true, values are separated by commas; otherwise, by
+ *     whitespace.
+ * @param transpose If true, each row of the file becomes a column of the
+ *     matrix.
+ * @param chunkSize Number of characters to read at once.
+ * @return Whether or not the file was parsed successfully.
+ */
+template<typename eT>
+bool LoadText(std::istream& stream,
+              arma::Mat<eT>& matrix,
+              const bool csv,
+              const bool transpose,
+              const size_t chunkSize = (1 << 24));
+
+namespace detail {
+
+/**
+ * Reads a stream in large chunks which each end at the end of a line (or of the
+ * stream).  The character after each chunk is always either a newline or a
+ * terminating null character, so that the numbers in a chunk can be parsed
+ * with strtod() without reading past it.
+ */
+class ChunkReader
+{
+ public:
+  /**
+   * Create a reader for the given stream.
+   *
+   * @param stream Stream to read.
+   * @param chunkSize Initial size of each chunk; chunks grow if a line is
+   *     longer than this.
+   */
+  ChunkReader(std::istream& stream, const size_t chunkSize = (1 << 24)) :
+      stream(stream),
+      buffer(chunkSize + 1),
+      length(0),
+      chunkEnd(0),
+      eof(false)
+  { }
+
+  /**
+   * Get the next chunk.
+   *
+   * @param begin Set to the first character of the chunk.
+   * @param end Set to one past the last character of the chunk.
+   * @return False if the stream has ended.
+   */
+  bool Next(const char*& begin, const char*& end)
+  {
+    // Move the rest of the last read to the front.
+    if (chunkEnd > 0)
+    {
+      std::copy(buffer.begin() + chunkEnd, buffer.begin() + length,
+          buffer.begin());
+      length -= chunkEnd;
+      chunkEnd = 0;
+    }
+
+    while (true)
+    {
+      if (!eof)
+      {
+        const size_t space = buffer.size() - 1 - length;
+        stream.read(&buffer[length], space);
+        const size_t read = (size_t) stream.gcount();
+        length += read;
+        eof = (read < space);
+      }
+
+      if (length == 0)
+        return false;
+
+      // Find the end of the last whole line.
+      size_t last = length;
+      while (last > 0 && buffer[last - 1] != '\n')
+        --last;
+
+      if (eof)
+      {
+        chunkEnd = length;
+        buffer[length] = '\0';
+        break;
+      }
+      else if (last > 0)
+      {
+        chunkEnd = last;
+        break;
+      }
+
+      // The line does not fit in the buffer; make it bigger.
+      buffer.resize(2 * buffer.size());
+    }
+
+    begin = &buffer[0];
+    end = &buffer[chunkEnd];
+    return true;
+  }
+
+ private:
+  //! The stream being read.
+  std::istream& stream;
+  //! The characters read so far, plus one for the terminator.
+  std::vector<char> buffer;
+  //! The number of characters in the buffer.
+  size_t length;
+  //! The end of the current chunk in the buffer.
+  size_t chunkEnd;
+  //! Whether the stream has ended.
+  bool eof;
+};
+
+/**
+ * Parse the values of one line, writing the i'th value to out[i * stride] if
+ * i < maxValues (out may be NULL to only count the values).
+ *
+ * @param begin First character of the line.
+ * @param end One past the last character of the line (not including the
+ *     newline).
+ * @param csv Whether the values are separated by commas.
+ * @param out Where to write the values.
+ * @param stride Distance between successive values in out.
+ * @param maxValues Maximum number of values to write.
+ * @param values Set to the number of values in the line.
+ * @return False if the line contains something which is not a number.
+ */
+template<typename eT>
+bool ParseLine(const char* begin,
+               const char* end,
+               const bool csv,
+               eT* out,
+               const size_t stride,
+               const size_t maxValues,
+               size_t& values);
+
+//! Return whether the line only has whitespace in it.
+inline bool BlankLine(const char* begin, const char* end)
+{
+  for (; begin < end; ++begin)
+    if (*begin != ' ' && *begin != '\t' && *begin != '\r' && *begin != '\v' &&
+        *begin != '\f')
+      return false;
+
+  return true;
+}
+
+}; // namespace detail
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "load_text_impl.hpp"
+
+#endif
@@ -0,0 +1,218 @@
+/**
+ * @file load_text_impl.hpp
+ *
+ * Implementation of the CSV and ASCII parser.
+ */
+#ifndef __MLPACK_CORE_DATA_LOAD_TEXT_IMPL_HPP
+#define __MLPACK_CORE_DATA_LOAD_TEXT_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "load_text.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace mlpack {
+namespace data {
+namespace detail {
+
+//! Return whether the character is whitespace (but not a newline).
+inline bool IsBlank(const char c)
+{
+  return (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f');
+}
+
+template<typename eT>
+bool ParseLine(const char* begin,
+               const char* end,
+               const bool csv,
+               eT* out,
+               const size_t stride,
+               const size_t maxValues,
+               size_t& values)
+{
+  values = 0;
+  const char* p = begin;
+  while (true)
+  {
+    while (p < end && IsBlank(*p))
+      ++p;
+
+    // Whitespace-separated lines end after the last value.
+    if (!csv && p >= end)
+      break;
+
+    // Empty CSV fields are zero.  strtod() is only called on a character that
+    // is not whitespace, so it can't skip ahead onto the next line.
+    double value = 0.0;
+    if (p < end && *p != ',')
+    {
+      char* valueEnd;
+      value = std::strtod(p, &valueEnd);
+      if (valueEnd == p || valueEnd > end)
+        return false;
+      p = valueEnd;
+    }
+
+    if (out != NULL && values < maxValues)
+      out[values * stride] = (eT) value;
+    ++values;
+
+    if (csv)
+    {
+      while (p < end && IsBlank(*p))
+        ++p;
+      if (p >= end)
+        break;
+      if (*p != ',')
+        return false;
+      ++p;
+    }
+    else if (p < end && !IsBlank(*p))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}; // namespace detail
+
+template<typename eT>
+bool LoadText(std::istream& stream,
+              arma::Mat<eT>& matrix,
+              const bool csv,
+              const bool transpose,
+              const size_t chunkSize)
+{
+  const std::streampos start = stream.tellg();
+
+  // First count the rows, and the values in the first row.
+  size_t rows = 0;
+  size_t cols = 0;
+  const char* begin;
+  const char* end;
+  {
+    detail::ChunkReader reader(stream, chunkSize);
+    while (reader.Next(begin, end))
+    {
+      for (const char* line = begin; line < end; )
+      {
+        const char* lineEnd = (const char*) std::memchr(line, '\n',
+            end - line);
+        if (lineEnd == NULL)
+          lineEnd = end;
+
+        if (!detail::BlankLine(line, lineEnd))
+        {
+          if (rows == 0 && !detail::ParseLine<eT>(line, lineEnd, csv, NULL,
+              0, 0, cols))
+          {
+            Log::Warn << "Row 1 contains a value that is not a number."
+                << std::endl;
+            return false;
+          }
+          ++rows;
+        }
+
+        line = lineEnd + 1;
+      }
+    }
+  }
+
+  if (transpose)
+    matrix.set_size(cols, rows);
+  else
+    matrix.set_size(rows, cols);
+
+  // Now parse each chunk with all threads.  Each row is written straight to
+  // its place in the matrix.
+  stream.clear();
+  stream.seekg(start);
+
+  detail::ChunkReader reader(stream, chunkSize);
+  std::vector<const char*> lines;
+  size_t row = 0;
+  while (reader.Next(begin, end))
+  {
+    lines.clear();
+    for (const char* line = begin; line < end; )
+    {
+      const char* lineEnd = (const char*) std::memchr(line, '\n', end - line);
+      if (lineEnd == NULL)
+        lineEnd = end;
+
+      if (!detail::BlankLine(line, lineEnd))
+        lines.push_back(line);
+
+      line = lineEnd + 1;
+    }
+    lines.push_back(end);
+
+    if (row + lines.size() - 1 > rows)
+    {
+      Log::Warn << "The file changed while it was being loaded." << std::endl;
+      matrix.reset();
+      return false;
+    }
+
+    // The first bad row in this chunk, if any.
+    omp_size_t badLine = (omp_size_t) lines.size();
+    size_t badValues = cols;
+
+    #pragma omp parallel for schedule(static)
+    for (omp_size_t i = 0; i < (omp_size_t) lines.size() - 1; ++i)
+    {
+      const char* line = lines[i];
+      const char* lineEnd = (const char*) std::memchr(line, '\n',
+          lines[i + 1] - line);
+      if (lineEnd == NULL)
+        lineEnd = lines[i + 1];
+
+      eT* out = transpose ? matrix.colptr(row + i) : matrix.memptr() + row + i;
+      size_t values;
+      const bool parsed = detail::ParseLine(line, lineEnd, csv, out,
+          transpose ? 1 : rows, cols, values);
+      if (!parsed || values != cols)
+      {
+        #pragma omp critical
+        {
+          if (i < badLine)
+          {
+            badLine = i;
+            badValues = parsed ? values : cols;
+          }
+        }
+      }
+    }
+
+    if (badLine < (omp_size_t) lines.size())
+    {
+      if (badValues != cols)
+        Log::Warn << "Row " << (row + badLine + 1) << " has " << badValues
+            << " values, but row 1 has " << cols << "." << std::endl;
+      else
+        Log::Warn << "Row " << (row + badLine + 1) << " contains a value that "
+            << "is not a number." << std::endl;
+      matrix.reset();
+      return false;
+    }
+
+    row += lines.size() - 1;
+  }
+
+  if (row != rows)
+  {
+    Log::Warn << "The file changed while it was being loaded." << std::endl;
+    matrix.reset();
+    return false;
+  }
+
+  return true;
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * @file mapped_matrix.cpp
+ *
+ * Implementation of MappedMatrix.
+ */
+#include "mapped_matrix.hpp"
+#include "load.hpp"
+
+#include <mlpack/core/util/timers.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define MLPACK_HAS_MMAP
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+MappedMatrix::MappedMatrix() :
+    address(NULL),
+    length(0),
+    matrix(new arma::mat())
+{
+  // Nothing to do.
+}
+
+MappedMatrix::MappedMatrix(const std::string& filename,
+                           const bool fatal,
+                           const size_t rows) :
+    address(NULL),
+    length(0),
+    matrix(new arma::mat())
+{
+  Map(filename, fatal, rows);
+}
+
+MappedMatrix::~MappedMatrix()
+{
+  Unmap();
+  delete matrix;
+}
+
+void MappedMatrix::Unmap()
+{
+  // Drop the alias before the pages go away.
+  delete matrix;
+  matrix = new arma::mat();
+
+#ifdef MLPACK_HAS_MMAP
+  if (address != NULL)
+    munmap(address, length);
+#endif
+
+  address = NULL;
+  length = 0;
+}
+
+bool MappedMatrix::Map(const std::string& filename,
+                       const bool fatal,
+                       const size_t rows)
+{
+  Unmap();
+
+  Timer::Start("loading_data");
+
+#ifdef MLPACK_HAS_MMAP
+  const int fd = open(filename.c_str(), O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0)
+  {
+    if (fd >= 0)
+      close(fd);
+
+    Timer::Stop("loading_data");
+    if (fatal)
+      Log::Fatal << "Cannot open file '" << filename << "'. " << std::endl;
+    else
+      Log::Warn << "Cannot open file '" << filename << "'; load failed."
+          << std::endl;
+
+    return false;
+  }
+
+  const size_t fileLength = (size_t) status.st_size;
+  void* mapped = (fileLength == 0) ? MAP_FAILED : mmap(NULL, fileLength,
+      PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid after the file is closed.
+  close(fd);
+
+  if (mapped != MAP_FAILED)
+  {
+    const char* bytes = (const char*) mapped;
+
+    // Armadillo binary files start with a header line, then a line with the
+    // size; the elements follow.
+    const std::string ARMA_MAT_BIN = "ARMA_MAT_BIN_FN008\n";
+    size_t offset = 0;
+    size_t matRows = rows;
+    size_t matCols = 0;
+    bool valid = true;
+    if (fileLength > ARMA_MAT_BIN.length() &&
+        std::memcmp(bytes, "ARMA_MAT_BIN", 12) == 0)
+    {
+      const char* end = (const char*) std::memchr(bytes +
+          ARMA_MAT_BIN.length(), '\n', std::min(fileLength -
+          ARMA_MAT_BIN.length(), (size_t) 64));
+      if (std::memcmp(bytes, ARMA_MAT_BIN.c_str(), ARMA_MAT_BIN.length()) !=
+          0 || end == NULL)
+      {
+        valid = false;
+      }
+      else
+      {
+        std::istringstream size(std::string(bytes + ARMA_MAT_BIN.length(),
+            end));
+        valid = !(size >> matRows >> matCols).fail();
+        offset = (end - bytes) + 1;
+        valid = valid && (fileLength - offset == sizeof(double) * matRows *
+            matCols);
+      }
+    }
+    else
+    {
+      // Raw binary: only the number of elements is known.
+      const size_t elements = fileLength / sizeof(double);
+      if (matRows == 0)
+        matRows = elements;
+      valid = (fileLength % sizeof(double) == 0) &&
+          (elements % matRows == 0);
+      matCols = valid ? elements / matRows : 0;
+    }
+
+    if (valid && (offset % sizeof(double) == 0))
+    {
+      address = mapped;
+      length = fileLength;
+
+      // The pages are read-only, so only a const reference to this alias is
+      // ever handed out.
+      delete matrix;
+      matrix = new arma::mat((double*) (bytes + offset), matRows, matCols,
+          false, true);
+
+      Log::Info << "Mapped '" << filename << "'; size is " << matrix->n_rows
+          << " x " << matrix->n_cols << "." << std::endl;
+      Timer::Stop("loading_data");
+      return true;
+    }
+
+    munmap(mapped, fileLength);
+
+    if (!valid)
+    {
+      Timer::Stop("loading_data");
+      if (fatal)
+        Log::Fatal << "'" << filename << "' is not a valid binary matrix "
+            << "file." << std::endl;
+      else
+        Log::Warn << "'" << filename << "' is not a valid binary matrix file;"
+            << " load failed." << std::endl;
+
+      return false;
+    }
+
+    Log::Warn << "The elements in '" << filename << "' are not aligned, so "
+        << "the file cannot be mapped; reading it instead." << std::endl;
+  }
+#else
+  Log::Warn << "Memory mapping is not available; reading '" << filename
+      << "' instead." << std::endl;
+#endif
+
+  Timer::Stop("loading_data");
+
+  // Read the file normally, but without transposing, so that the result is
+  // the same as if it had been mapped.
+  if (!data::Load(filename, *matrix, fatal, false))
+    return false;
+
+  if (rows != 0 && matrix->n_cols == 1 && matrix->n_elem % rows == 0)
+    matrix->reshape(rows, matrix->n_elem / rows);
+
+  return true;
+}
+
+bool mlpack::data::Load(const std::string& filename,
+                        MappedMatrix& matrix,
+                        bool fatal)
+{
+  return matrix.Map(filename, fatal);
+}
@@ -0,0 +1,112 @@
+/**
+ * @file mapped_matrix.hpp
+ *
+ * Definition of MappedMatrix, which gives a read-only arma::mat view of a
+ * memory-mapped binary matrix file, and a data::Load() overload for it.
+ */
+#ifndef __MLPACK_CORE_DATA_MAPPED_MATRIX_HPP
+#define __MLPACK_CORE_DATA_MAPPED_MATRIX_HPP
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <string>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * A read-only matrix backed by a memory-mapped file.  The file is mapped, not
+ * read, so opening even a very large file is nearly instant, only the pages
+ * that are used are ever read from disk, and processes that map the same file
+ * share the page cache.  Matrix() returns an arma::mat which uses the mapped
+ * pages directly (through Armadillo's advanced constructor), so it must not be
+ * modified, and it is only valid while the MappedMatrix is.
+ *
+ * Armadillo binary files (arma_binary, as written by data::Save() to a .bin
+ * file) and raw binary files of doubles are supported.  Unlike data::Load(),
+ * the matrix can't be transposed without copying it, so it is given exactly as
+ * it is stored: data meant to be mapped should be saved with data::Save(...,
+ * false, false), so that each point is a column.
+ *
+ * The elements have to be aligned to map them.  This is always the case for raw
+ * binary files, but the header of an Armadillo binary file has a length which
+ * depends on the size of the matrix, so these can only be mapped about one
+ * time in eight.  On systems without mmap(), or when the elements are not
+ * aligned, the file is read into memory instead, and a warning is given; so
+ * raw binary files are the best choice for large data sets.
+ */
+class MappedMatrix
+{
+ public:
+  //! Create an empty MappedMatrix.
+  MappedMatrix();
+
+  /**
+   * Map the given file; see Map().
+   */
+  MappedMatrix(const std::string& filename,
+               const bool fatal = false,
+               const size_t rows = 0);
+
+  //! Unmap the file.
+  ~MappedMatrix();
+
+  /**
+   * Map the given file, unmapping any file mapped before.  Armadillo binary
+   * files give their own size; raw binary files are taken to have the given
+   * number of rows, or to be a single column if rows is 0.
+   *
+   * @param filename File to map.
+   * @param fatal If true, an error is fatal.
+   * @param rows Number of rows of a raw binary file.
+   * @return Whether the file was mapped (or read) successfully.
+   */
+  bool Map(const std::string& filename,
+           const bool fatal = false,
+           const size_t rows = 0);
+
+  //! Unmap the file; Matrix() becomes empty.
+  void Unmap();
+
+  //! Get the matrix.
+  const arma::mat& Matrix() const { return *matrix; }
+
+  //! Return whether the matrix uses mapped pages (instead of a copy).
+  bool IsMapped() const { return address != NULL; }
+  //! Get the address of the mapping, or NULL if nothing is mapped.
+  const void* Address() const { return address; }
+  //! Get the length of the mapping in bytes.
+  size_t Length() const { return length; }
+
+ private:
+  //! The address of the mapping, or NULL if nothing is mapped.
+  void* address;
+  //! The length of the mapping.
+  size_t length;
+  //! The matrix; an alias of the mapped pages, or a normal matrix if the file
+  //! had to be read.  It is held by pointer because assigning an alias to a
+  //! matrix copies the elements, so the alias has to be constructed in place.
+  arma::mat* matrix;
+
+  // A mapping can't be shared, so copying is not allowed.
+  MappedMatrix(const MappedMatrix& other);
+  MappedMatrix& operator=(const MappedMatrix& other);
+};
+
+/**
+ * Map a binary matrix file into memory instead of loading it; see
+ * MappedMatrix.  The matrix is not transposed.
+ *
+ * @param filename Name of file to map.
+ * @param matrix MappedMatrix to map the file with.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @return Boolean value indicating success or failure of mapping.
+ */
+bool Load(const std::string& filename,
+          MappedMatrix& matrix,
+          bool fatal = false);
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * @file pipeline.hpp
+ *
+ * A three-stage pipeline for programs which stream their data in chunks: while
+ * one chunk is being computed on, the next chunk is read and the results of
+ * the previous chunk are written.
+ */
+#ifndef __MLPACK_CORE_DATA_PIPELINE_HPP
+#define __MLPACK_CORE_DATA_PIPELINE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Run a loader, a compute stage and a writer over a stream of chunks, so that
+ * reading, computing and writing overlap.  Each step of the pipeline reads
+ * chunk i + 1, computes on chunk i and writes the results of chunk i - 1 at
+ * the same time (with OpenMP), so the time taken is about that of the slowest
+ * stage rather than the sum of all three.
+ *
+ * The stages are functors:
+ *
+ * @code
+ * bool loader(InputType& input); // Read the next chunk; false at the end.
+ * void compute(InputType& input, OutputType& output);
+ * void writer(OutputType& output); // Write the results of a chunk.
+ * @endcode
+ *
+ * Chunks are computed and written in the order they are read, and each stage
+ * is only run by one thread at a time, so a stage may keep state (a stream, a
+ * counter) without locking.  The three stages do run at the same time as each
+ * other, though, so they must not share state; since Timer and Log are not
+ * thread-safe, only the compute stage should use them.  The compute stage may
+ * use OpenMP itself: nested parallelism is turned on while the pipeline runs.
+ *
+ * The input and output buffers (two of each) are kept in the Pipeline object
+ * and reused for every chunk, so a loader which reads into a matrix of the same
+ * size each time does not allocate.
+ *
+ * For example, to read chunks of a text file, search them and append the
+ * results to another file:
+ *
+ * @code
+ * data::Pipeline<arma::mat, ChunkResults> pipeline;
+ * pipeline.Run(loader, searcher, writer);
+ * @endcode
+ *
+ * If there is nothing to write, NoOutput can be used as both the output type
+ * and the writer.
+ *
+ * @tparam InputType Type of one chunk of input.
+ * @tparam OutputType Type of the results of one chunk.
+ */
+template<typename InputType, typename OutputType>
+class Pipeline
+{
+ public:
+  /**
+   * Create the pipeline.
+   *
+   * @param overlap If false, the stages are run one after another, as if there
+   *     were no pipeline.
+   */
+  Pipeline(const bool overlap = true) : overlap(overlap) { }
+
+  /**
+   * Run the pipeline until the loader has no more chunks, and all of them
+   * have been computed and written.
+   *
+   * @param loader Functor which reads the next chunk.
+   * @param compute Functor which computes the results of a chunk.
+   * @param writer Functor which writes the results of a chunk.
+   * @return The number of chunks.
+   */
+  template<typename LoaderType, typename ComputeType, typename WriterType>
+  size_t Run(LoaderType& loader, ComputeType& compute, WriterType& writer);
+
+  //! Get whether the stages are overlapped.
+  bool Overlap() const { return overlap; }
+  //! Modify whether the stages are overlapped.
+  bool& Overlap() { return overlap; }
+
+ private:
+  //! The chunks being read and computed on.
+  InputType inputs[2];
+  //! The results being computed and written.
+  OutputType outputs[2];
+  //! Whether the stages are overlapped.
+  bool overlap;
+};
+
+/**
+ * The output type, and the writer, for a Pipeline whose compute stage has no
+ * results to write.
+ */
+class NoOutput
+{
+ public:
+  void operator()(NoOutput& /* output */) const { }
+};
+
+template<typename InputType, typename OutputType>
+template<typename LoaderType, typename ComputeType, typename WriterType>
+size_t Pipeline<InputType, OutputType>::Run(LoaderType& loader,
+                                            ComputeType& compute,
+                                            WriterType& writer)
+{
+#ifdef _OPENMP
+  // The compute stage runs inside the parallel region of the pipeline, so it
+  // can only use more than one thread if nested parallelism is on.
+  const int nested = omp_get_nested();
+  if (overlap)
+    omp_set_nested(1);
+#endif
+
+  // loaded[i] is true if inputs[i] holds a chunk which has not been computed
+  // yet, and computed[i] if outputs[i] holds results which have not been
+  // written yet.  The first chunk has nothing to overlap with.
+  bool loaded[2] = { loader(inputs[0]), false };
+  bool computed[2] = { false, false };
+  bool more = loaded[0];
+  size_t chunks = 0;
+
+  size_t current = 0;
+  while (loaded[current] || computed[1 - current])
+  {
+    const size_t other = 1 - current;
+    bool loadedNext = false;
+
+    #pragma omp parallel sections num_threads(3) if(overlap)
+    {
+      #pragma omp section
+      {
+        if (more)
+          loadedNext = loader(inputs[other]);
+      }
+
+      #pragma omp section
+      {
+        if (loaded[current])
+          compute(inputs[current], outputs[current]);
+      }
+
+      #pragma omp section
+      {
+        if (computed[other])
+          writer(outputs[other]);
+      }
+    }
+
+    if (loaded[current])
+      ++chunks;
+    computed[other] = false;
+    computed[current] = loaded[current];
+    loaded[current] = false;
+    loaded[other] = loadedNext;
+    more = loadedNext;
+
+    current = other;
+  }
+
+#ifdef _OPENMP
+  omp_set_nested(nested);
+#endif
+
+  return chunks;
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -32,6 +32,9 @@ namespace data /** Functions to load and save matrices. */ {
  *  - Armadillo binary (arma_binary), denoted by .bin
  *  - HDF5 (hdf5_binary), denoted by .hdf5, .hdf, .h5, or .he5
  *
+ * Adding .gz or .zst to the filename (e.g. data.csv.gz) compresses the file
+ * with gzip or zstd, if mlpack was built with zlib or libzstd respectively.
+ *
  * If the file extension is not one of those types, an error will be given.  If
  * the 'fatal' parameter is set to true, an error will cause the program to
  * exit.  If the 'transpose' parameter is set to true, the matrix will be
@@ -51,6 +54,32 @@ bool Save(const std::string& filename,
           bool fatal = false,
           bool transpose = true);
 
+/**
+ * Append a matrix to a stream which is already open, in CSV (arma::csv_ascii)
+ * or raw ASCII (arma::raw_ascii) format.  This is for programs which compute
+ * their results in chunks: each chunk is written as soon as it is done, and
+ * the file is the same as if the whole matrix had been saved with Save().  As
+ * with Save(), if transpose is true, each column of the matrix is written as
+ * a line, but without a transposed copy of the matrix; the numbers are
+ * formatted in parallel with OpenMP.
+ *
+ * Unlike Save(), this prints nothing and does not use the timers, so it may
+ * be called while another thread is running (as the writer of a
+ * data::Pipeline, for instance).
+ *
+ * @param stream Stream to append the matrix to.
+ * @param matrix Matrix to save.
+ * @param type Either arma::csv_ascii or arma::raw_ascii.
+ * @param transpose If true, transpose the matrix as it is saved.
+ * @return Boolean value indicating success or failure of save (false for any
+ *     other type).
+ */
+template<typename eT>
+bool SaveChunk(std::ostream& stream,
+               const arma::Mat<eT>& matrix,
+               const arma::file_type type,
+               const bool transpose = true);
+
 }; // namespace data
 }; // namespace mlpack
 
@@ -9,6 +9,10 @@
 
 // In case it hasn't already been included.
 #include "save.hpp"
+#include "compression.hpp"
+#include "transpose.hpp"
+
+#include <sstream>
 
 namespace mlpack {
 namespace data {
@@ -21,8 +25,13 @@ bool Save(const std::string& filename,
 {
   Timer::Start("saving_data");
 
+  // A compressed file has the extension of its contents under the compression
+  // extension (e.g. data.csv.gz).
+  std::string innerName;
+  const Compression compression = GetCompression(filename, innerName);
+
   // First we will try to discriminate by file extension.
-  size_t ext = filename.rfind('.');
+  size_t ext = innerName.rfind('.');
   if (ext == std::string::npos)
   {
     Timer::Stop("saving_data");
@@ -37,13 +46,30 @@ bool Save(const std::string& filename,
   }
 
   // Get the actual extension.
-  std::string extension = filename.substr(ext + 1);
+  std::string extension = innerName.substr(ext + 1);
+
+  // Catch errors opening the file.  Compressed files are written to memory
+  // first, and then compressed into the file a block at a time.
+  std::fstream fileStream;
+  std::stringstream memoryStream;
+  if (compression == NO_COMPRESSION)
+    fileStream.open(filename.c_str(), std::fstream::out);
 
-  // Catch errors opening the file.
-  std::fstream stream;
-  stream.open(filename.c_str(), std::fstream::out);
+  if (compression != NO_COMPRESSION && !CompressionSupported(compression))
+  {
+    Timer::Stop("saving_data");
+    if (fatal)
+      Log::Fatal << "Cannot save compressed file '" << filename << "'; "
+          << "mlpack was built without support for this compression."
+          << std::endl;
+    else
+      Log::Warn << "Cannot save compressed file '" << filename << "'; "
+          << "mlpack was built without support for this compression.  Save "
+          << "failed." << std::endl;
 
-  if (!stream.is_open())
+    return false;
+  }
+  else if (compression == NO_COMPRESSION && !fileStream.is_open())
   {
     Timer::Stop("saving_data");
     if (fatal)
@@ -121,16 +147,35 @@ bool Save(const std::string& filename,
     return false;
   }
 
+  std::iostream& stream = (compression == NO_COMPRESSION) ?
+      static_cast<std::iostream&>(fileStream) : memoryStream;
+
   // Try to save the file.
   Log::Info << "Saving " << stringType << " to '" << filename << "'."
       << std::endl;
 
-  // Transpose the matrix.
+  // Transpose the matrix.  Text and Armadillo binary files are written
+  // without making a transposed copy of the whole matrix.
   if (transpose)
   {
-    arma::Mat<eT> tmp = trans(matrix);
+    bool success;
+    if (saveType == arma::csv_ascii || saveType == arma::raw_ascii)
+    {
+      success = SaveTransposedText(stream, matrix, saveType);
+    }
+    else if (saveType == arma::arma_binary)
+    {
+      // A std::stringstream can't seek past its end.
+      success = SaveTransposedArmaBinary(stream, matrix,
+          compression == NO_COMPRESSION);
+    }
+    else
+    {
+      arma::Mat<eT> tmp = trans(matrix);
+      success = tmp.quiet_save(stream, saveType);
+    }
 
-    if (!tmp.quiet_save(stream, saveType))
+    if (!success)
     {
       Timer::Stop("saving_data");
       if (fatal)
@@ -155,12 +200,44 @@ bool Save(const std::string& filename,
     }
   }
 
+  if (compression != NO_COMPRESSION &&
+      !Compress(memoryStream, compression, filename))
+  {
+    Timer::Stop("saving_data");
+    if (fatal)
+      Log::Fatal << "Save to '" << filename << "' failed." << std::endl;
+    else
+      Log::Warn << "Save to '" << filename << "' failed." << std::endl;
+
+    return false;
+  }
+
+  // The size of the dataset, for --metrics_file.
+  Metric::Set("saved_data/" + filename + "/rows", matrix.n_rows);
+  Metric::Set("saved_data/" + filename + "/cols", matrix.n_cols);
+
   Timer::Stop("saving_data");
 
   // Finally return success.
   return true;
 }
 
+template<typename eT>
+bool SaveChunk(std::ostream& stream,
+               const arma::Mat<eT>& matrix,
+               const arma::file_type type,
+               const bool transpose)
+{
+  // Binary formats have a header, or no way to tell where one chunk ends.
+  if (type != arma::csv_ascii && type != arma::raw_ascii)
+    return false;
+
+  if (transpose)
+    return SaveTransposedText(stream, matrix, type);
+  else
+    return matrix.quiet_save(stream, type);
+}
+
 }; // namespace data
 }; // namespace mlpack
 
@@ -0,0 +1,69 @@
+/**
+ * @file space_filling_curve.hpp
+ *
+ * Functions to sort the points of a dataset along a space-filling curve (the
+ * Hilbert curve or the Morton Z-order curve), so that points which are close
+ * together in space are also close together in memory.
+ */
+#ifndef __MLPACK_CORE_DATA_SPACE_FILLING_CURVE_HPP
+#define __MLPACK_CORE_DATA_SPACE_FILLING_CURVE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Find the order of the points of the dataset along the Hilbert curve through
+ * their bounding box.  Each coordinate is quantized to a grid of between 8 and
+ * 32 bits per dimension (fewer bits in higher dimensions), so points in the
+ * same grid cell keep their original relative order.
+ *
+ * Trees which do not rearrange the dataset (cover trees and rectangle trees)
+ * have the points of each node scattered through memory; building them on a
+ * dataset that was reordered with this function and Reorder() makes the base
+ * cases of each node touch nearby memory.  The results of the search then have
+ * to be mapped back with oldFromNew, as for kd-trees.
+ *
+ * The Hilbert index is computed with the algorithm of Skilling (2004),
+ * "Programming the Hilbert curve", AIP Conference Proceedings 707.
+ *
+ * @param dataset Dataset to find the order of (one point per column).
+ * @param oldFromNew Vector to store the order in: point i along the curve is
+ *     column oldFromNew[i] of the dataset.
+ */
+template<typename eT>
+void HilbertOrder(const arma::Mat<eT>& dataset,
+                  std::vector<size_t>& oldFromNew);
+
+/**
+ * Find the order of the points of the dataset along the Morton (Z-order) curve
+ * through their bounding box, which interleaves the bits of the quantized
+ * coordinates.  This is cheaper to compute than HilbertOrder(), but the curve
+ * makes long jumps, so the locality of the order is worse.
+ *
+ * @param dataset Dataset to find the order of (one point per column).
+ * @param oldFromNew Vector to store the order in: point i along the curve is
+ *     column oldFromNew[i] of the dataset.
+ */
+template<typename eT>
+void MortonOrder(const arma::Mat<eT>& dataset,
+                 std::vector<size_t>& oldFromNew);
+
+/**
+ * Rearrange the columns of the dataset in place, so that column i becomes what
+ * was column oldFromNew[i].  Only one column of extra storage is used.
+ *
+ * @param dataset Dataset to rearrange.
+ * @param oldFromNew The new order of the columns; it must be a permutation.
+ */
+template<typename eT>
+void Reorder(arma::Mat<eT>& dataset, const std::vector<size_t>& oldFromNew);
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "space_filling_curve_impl.hpp"
+
+#endif
@@ -0,0 +1,195 @@
+/**
+ * @file space_filling_curve_impl.hpp
+ *
+ * Implementation of the functions which sort datasets along space-filling
+ * curves.
+ */
+#ifndef __MLPACK_CORE_DATA_SPACE_FILLING_CURVE_IMPL_HPP
+#define __MLPACK_CORE_DATA_SPACE_FILLING_CURVE_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "space_filling_curve.hpp"
+
+#include <mlpack/core/util/log.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+
+namespace mlpack {
+namespace data {
+namespace detail {
+
+/**
+ * Turn the quantized coordinates of a point into the "transposed" Hilbert
+ * index, in place; interleaving the bits of the result gives the index of the
+ * point along the Hilbert curve.  This is AxestoTranspose() of Skilling (2004).
+ */
+inline void HilbertTranspose(uint64_t* x, const size_t dims, const size_t bits)
+{
+  const uint64_t m = ((uint64_t) 1) << (bits - 1);
+
+  // Inverse undo.
+  for (uint64_t q = m; q > 1; q >>= 1)
+  {
+    const uint64_t p = q - 1;
+    for (size_t i = 0; i < dims; ++i)
+    {
+      if (x[i] & q)
+      {
+        x[0] ^= p; // Invert.
+      }
+      else
+      {
+        const uint64_t t = (x[0] ^ x[i]) & p; // Exchange.
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encode.
+  for (size_t i = 1; i < dims; ++i)
+    x[i] ^= x[i - 1];
+  uint64_t t = 0;
+  for (uint64_t q = m; q > 1; q >>= 1)
+    if (x[dims - 1] & q)
+      t ^= q - 1;
+  for (size_t i = 0; i < dims; ++i)
+    x[i] ^= t;
+}
+
+//! Orders points by their keys (several words each, most significant first),
+//! and then by their index, so that the order is deterministic.
+class CurveKeyComparator
+{
+ public:
+  CurveKeyComparator(const std::vector<uint64_t>& keys, const size_t words) :
+      keys(keys), words(words) { }
+
+  bool operator()(const size_t a, const size_t b) const
+  {
+    for (size_t w = 0; w < words; ++w)
+      if (keys[a * words + w] != keys[b * words + w])
+        return keys[a * words + w] < keys[b * words + w];
+
+    return a < b;
+  }
+
+ private:
+  const std::vector<uint64_t>& keys;
+  const size_t words;
+};
+
+/**
+ * Sort the points along the Hilbert curve (if hilbert is true) or the Morton
+ * curve through the bounding box of the dataset.
+ */
+template<typename eT>
+void CurveOrder(const arma::Mat<eT>& dataset,
+                std::vector<size_t>& oldFromNew,
+                const bool hilbert)
+{
+  const size_t dims = dataset.n_rows;
+  const size_t n = dataset.n_cols;
+
+  oldFromNew.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    oldFromNew[i] = i;
+  if (n == 0 || dims == 0)
+    return;
+
+  // Keep the keys of low-dimensional points in one word, but use at least
+  // eight bits per dimension.
+  const size_t bits = std::min((size_t) 32, std::max((size_t) 8, 64 / dims));
+  const size_t words = (dims * bits + 63) / 64;
+  const double scale = (double) ((((uint64_t) 1) << bits) - 1);
+
+  const arma::Col<eT> mins = arma::min(dataset, 1);
+  const arma::Col<eT> maxs = arma::max(dataset, 1);
+
+  std::vector<uint64_t> keys(n * words, 0);
+  std::vector<uint64_t> x(dims);
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (size_t d = 0; d < dims; ++d)
+    {
+      const double width = (double) maxs[d] - (double) mins[d];
+      x[d] = (width > 0) ? (uint64_t) (((double) dataset(d, i) -
+          (double) mins[d]) / width * scale + 0.5) : 0;
+    }
+
+    if (hilbert)
+      HilbertTranspose(&x[0], dims, bits);
+
+    // Interleave the bits, most significant first.
+    uint64_t* key = &keys[i * words];
+    size_t position = 0;
+    for (size_t b = bits; b > 0; --b)
+    {
+      for (size_t d = 0; d < dims; ++d, ++position)
+        if ((x[d] >> (b - 1)) & 1)
+          key[position / 64] |= ((uint64_t) 1) << (63 - position % 64);
+    }
+  }
+
+  std::sort(oldFromNew.begin(), oldFromNew.end(),
+      CurveKeyComparator(keys, words));
+}
+
+}; // namespace detail
+
+template<typename eT>
+void HilbertOrder(const arma::Mat<eT>& dataset,
+                  std::vector<size_t>& oldFromNew)
+{
+  detail::CurveOrder(dataset, oldFromNew, true);
+}
+
+template<typename eT>
+void MortonOrder(const arma::Mat<eT>& dataset,
+                 std::vector<size_t>& oldFromNew)
+{
+  detail::CurveOrder(dataset, oldFromNew, false);
+}
+
+template<typename eT>
+void Reorder(arma::Mat<eT>& dataset, const std::vector<size_t>& oldFromNew)
+{
+  if (oldFromNew.size() != dataset.n_cols)
+  {
+    Log::Fatal << "data::Reorder(): the order has " << oldFromNew.size()
+        << " elements, but the dataset has " << dataset.n_cols << " points!"
+        << std::endl;
+  }
+
+  // Follow each cycle of the permutation, pulling each column into the place
+  // of the one before it.
+  std::vector<bool> done(dataset.n_cols, false);
+  arma::Col<eT> temp(dataset.n_rows);
+  for (size_t start = 0; start < dataset.n_cols; ++start)
+  {
+    if (done[start] || oldFromNew[start] == start)
+      continue;
+
+    temp = dataset.col(start);
+    size_t current = start;
+    while (true)
+    {
+      done[current] = true;
+      const size_t next = oldFromNew[current];
+      if (next == start)
+      {
+        dataset.col(current) = temp;
+        break;
+      }
+
+      dataset.col(current) = dataset.col(next);
+      current = next;
+    }
+  }
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file transpose.hpp
+ *
+ * Helpers which let data::Load() and data::Save() transpose matrices without
+ * making a full transposed copy.
+ */
+#ifndef __MLPACK_CORE_DATA_TRANSPOSE_HPP
+#define __MLPACK_CORE_DATA_TRANSPOSE_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/arma_extend/arma_extend.hpp> // Includes Armadillo.
+#include <iostream>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Transpose a matrix in place.  Square matrices are transposed by swapping
+ * blocks; other matrices are permuted by following the cycles of the
+ * transposition, which needs only one bit of extra memory per element.
+ *
+ * @param matrix Matrix to transpose.
+ */
+template<typename eT>
+void InplaceTranspose(arma::Mat<eT>& matrix);
+
+/**
+ * Load an Armadillo binary matrix from the stream, transposing it as it is
+ * read: each element is written straight to its transposed position.  If the
+ * header is not the one Armadillo writes for eT, the file is handed to
+ * Armadillo instead, so that the same error is given as before.
+ *
+ * @param stream Stream to read from.
+ * @param matrix Matrix to load into.
+ * @return Whether or not the matrix was loaded successfully.
+ */
+template<typename eT>
+bool LoadTransposedArmaBinary(std::istream& stream, arma::Mat<eT>& matrix);
+
+/**
+ * Save the transpose of a matrix to the stream in Armadillo binary format,
+ * without making a transposed copy.  Normally the matrix is read in contiguous
+ * blocks which are written to their places in the file, so the stream must be
+ * able to seek past its end; if it can't (a std::stringstream, for instance),
+ * set seekable to false, and each row is gathered and written in order
+ * instead.
+ *
+ * @param stream Stream to write to.
+ * @param matrix Matrix to save the transpose of.
+ * @param seekable Whether or not the stream can seek past its end.
+ * @return Whether or not the matrix was saved successfully.
+ */
+template<typename eT>
+bool SaveTransposedArmaBinary(std::ostream& stream,
+                              const arma::Mat<eT>& matrix,
+                              const bool seekable = true);
+
+/**
+ * Save the transpose of a matrix to the stream as CSV or raw ASCII, a few
+ * columns at a time, so that only a small block is ever transposed.  With
+ * OpenMP, each thread formats one block into memory, and the blocks are then
+ * written in order; formatting numbers takes much longer than writing them.
+ *
+ * @param stream Stream to write to.
+ * @param matrix Matrix to save the transpose of.
+ * @param type Either arma::csv_ascii or arma::raw_ascii.
+ * @return Whether or not the matrix was saved successfully.
+ */
+template<typename eT>
+bool SaveTransposedText(std::ostream& stream,
+                        const arma::Mat<eT>& matrix,
+                        const arma::file_type type);
+
+}; // namespace data
+}; // namespace mlpack
+
+// Include implementation.
+#include "transpose_impl.hpp"
+
+#endif
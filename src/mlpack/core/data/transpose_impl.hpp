@@ -0,0 +1,237 @@
+/**
+ * @file transpose_impl.hpp
+ *
+ * Implementation of the in-place and streaming transposition helpers.
+ */
+#ifndef __MLPACK_CORE_DATA_TRANSPOSE_IMPL_HPP
+#define __MLPACK_CORE_DATA_TRANSPOSE_IMPL_HPP
+
+// In case it hasn't already been included.
+#include "transpose.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace mlpack {
+namespace data {
+
+template<typename eT>
+void InplaceTranspose(arma::Mat<eT>& matrix)
+{
+  const size_t rows = matrix.n_rows;
+  const size_t cols = matrix.n_cols;
+  eT* mem = matrix.memptr();
+
+  if (rows == cols)
+  {
+    // Swap the blocks above the diagonal with the blocks below it; each block
+    // pair fits in cache.
+    const size_t blockSize = 32;
+    for (size_t bj = 0; bj < cols; bj += blockSize)
+    {
+      for (size_t bi = bj; bi < rows; bi += blockSize)
+      {
+        const size_t jEnd = std::min(bj + blockSize, cols);
+        const size_t iEnd = std::min(bi + blockSize, rows);
+        for (size_t j = bj; j < jEnd; ++j)
+          for (size_t i = std::max(bi, j + 1); i < iEnd; ++i)
+            std::swap(mem[i + j * rows], mem[j + i * rows]);
+      }
+    }
+    return;
+  }
+
+  if (rows > 1 && cols > 1)
+  {
+    // The element at index k = i + j * rows goes to index j + i * cols.
+    // Follow each cycle of this permutation once.
+    const size_t elements = matrix.n_elem;
+    std::vector<bool> moved(elements, false);
+    for (size_t start = 1; start + 1 < elements; ++start)
+    {
+      if (moved[start])
+        continue;
+
+      eT value = mem[start];
+      size_t k = start;
+      do
+      {
+        const size_t next = (k / rows) + (k % rows) * cols;
+        std::swap(value, mem[next]);
+        moved[next] = true;
+        k = next;
+      } while (k != start);
+    }
+  }
+
+  // Armadillo keeps the memory (and so the elements) of a matrix when it is
+  // resized to the same number of elements.
+  matrix.set_size(cols, rows);
+}
+
+template<typename eT>
+bool LoadTransposedArmaBinary(std::istream& stream, arma::Mat<eT>& matrix)
+{
+  const std::streampos start = stream.tellg();
+
+  std::string header;
+  size_t rows = 0;
+  size_t cols = 0;
+  stream >> header >> rows >> cols;
+  if (!stream)
+    return false;
+
+  if (header != arma::diskio::gen_bin_header(matrix))
+  {
+    // Let Armadillo deal with it.
+    stream.clear();
+    stream.seekg(start);
+    if (!matrix.load(stream, arma::arma_binary))
+      return false;
+
+    InplaceTranspose(matrix);
+    return true;
+  }
+
+  // Skip the newline after the size.
+  stream.get();
+
+  // The file holds the matrix column by column; each column of the file is a
+  // row of the result.  Read it in pieces and scatter them.
+  matrix.set_size(cols, rows);
+  std::vector<eT> buffer(std::min(rows, (size_t) 65536));
+  for (size_t j = 0; j < cols; ++j)
+  {
+    for (size_t i = 0; i < rows; i += buffer.size())
+    {
+      const size_t count = std::min(buffer.size(), rows - i);
+      stream.read(reinterpret_cast<char*>(&buffer[0]), count * sizeof(eT));
+      if (!stream)
+      {
+        matrix.reset();
+        return false;
+      }
+
+      eT* out = matrix.memptr() + j + i * cols;
+      for (size_t t = 0; t < count; ++t)
+        out[t * cols] = buffer[t];
+    }
+  }
+
+  return true;
+}
+
+template<typename eT>
+bool SaveTransposedArmaBinary(std::ostream& stream,
+                              const arma::Mat<eT>& matrix,
+                              const bool seekable)
+{
+  const size_t rows = matrix.n_rows;
+  const size_t cols = matrix.n_cols;
+
+  stream << arma::diskio::gen_bin_header(matrix) << '\n' << cols << ' '
+      << rows << '\n';
+  const std::streampos start = stream.tellp();
+
+  if (matrix.n_elem == 0)
+    return stream.good();
+
+  // Row i of the matrix is column i of the file.
+  const size_t blockCols = std::max((size_t) 1,
+      std::min(cols, (size_t) 65536));
+  std::vector<eT> buffer(blockCols);
+
+  if (!seekable)
+  {
+    // Write the file in order: each row of the matrix, a block at a time.
+    for (size_t i = 0; i < rows; ++i)
+    {
+      for (size_t c = 0; c < cols; c += blockCols)
+      {
+        const size_t count = std::min(blockCols, cols - c);
+        const eT* in = matrix.memptr() + i + c * rows;
+        for (size_t t = 0; t < count; ++t)
+          buffer[t] = in[t * rows];
+
+        stream.write(reinterpret_cast<const char*>(&buffer[0]),
+            count * sizeof(eT));
+      }
+    }
+
+    return stream.good();
+  }
+
+  // Go through the matrix a block of columns at a time (which is contiguous);
+  // for each row, write the part of it in this block to its place in the file.
+  for (size_t c = 0; c < cols; c += blockCols)
+  {
+    const size_t count = std::min(blockCols, cols - c);
+    for (size_t i = 0; i < rows; ++i)
+    {
+      const eT* in = matrix.memptr() + i + c * rows;
+      for (size_t t = 0; t < count; ++t)
+        buffer[t] = in[t * rows];
+
+      stream.seekp(start + std::streamoff((i * cols + c) * sizeof(eT)));
+      stream.write(reinterpret_cast<const char*>(&buffer[0]),
+          count * sizeof(eT));
+    }
+  }
+
+  // Leave the stream at the end of the file.
+  stream.seekp(start + std::streamoff(matrix.n_elem * sizeof(eT)));
+  return stream.good();
+}
+
+template<typename eT>
+bool SaveTransposedText(std::ostream& stream,
+                        const arma::Mat<eT>& matrix,
+                        const arma::file_type type)
+{
+  // Each column of the matrix is a line of the file, so Armadillo can write a
+  // few transposed columns at a time.
+  const size_t blockCols = std::max((size_t) 1, (size_t) 65536 /
+      std::max(matrix.n_rows, (arma::uword) 1));
+  const size_t blocks = (matrix.n_cols + blockCols - 1) / blockCols;
+
+  // Each thread formats one block of a group; then the group is written.  This
+  // keeps one block per thread in memory.
+#ifdef _OPENMP
+  const size_t groupSize = (size_t) omp_get_max_threads();
+#else
+  const size_t groupSize = 1;
+#endif
+  std::vector<std::string> text(groupSize);
+  std::vector<char> formatted(groupSize);
+  for (size_t first = 0; first < blocks; first += groupSize)
+  {
+    const size_t count = std::min(groupSize, blocks - first);
+
+    #pragma omp parallel for schedule(static, 1) if (count > 1)
+    for (omp_size_t b = 0; b < (omp_size_t) count; ++b)
+    {
+      const size_t c = (first + b) * blockCols;
+      const size_t last = std::min(c + blockCols, (size_t) matrix.n_cols) - 1;
+      const arma::Mat<eT> block = trans(matrix.cols(c, last));
+
+      std::ostringstream blockStream;
+      formatted[b] = block.quiet_save(blockStream, type);
+      text[b] = blockStream.str();
+    }
+
+    for (size_t b = 0; b < count; ++b)
+    {
+      if (!formatted[b])
+        return false;
+      stream.write(text[b].data(), text[b].size());
+    }
+  }
+
+  return stream.good();
+}
+
+}; // namespace data
+}; // namespace mlpack
+
+#endif
@@ -11,32 +11,135 @@ using namespace mlpack;
 using namespace mlpack::distribution;
 
 /**
- * Calculates the multivariate Gaussian probability density function for each
- * data point (column) in the given matrix, with respect to the given mean and
- * variance.
- *
- * @param x List of observations.
- * @param mean Mean of multivariate Gaussian.
- * @param cov Covariance of multivariate Gaussian.
- * @param probabilities Output probabilities for each input observation.
+ * Return the probability of the given observation.
  */
-
 double GaussianDistribution::Probability(const arma::vec& observation) const
 {
-  arma::vec diff = mean - observation;
+  return std::exp(LogProbability(observation));
+}
+
+/**
+ * Return the log-probability of the given observation.
+ */
+double GaussianDistribution::LogProbability(const arma::vec& observation) const
+{
+  FactorCovariance();
 
-  arma::vec exponent = -0.5 * (trans(diff) * inv(covariance) * diff);
+  const arma::vec diff = observation - mean;
+
+  double exponent;
+  if (diagonal)
+  {
+    const arma::vec scaled = diff % invStdDev;
+    exponent = arma::dot(scaled, scaled);
+  }
+  else if (positiveDefinite)
+  {
+    const arma::vec solved = arma::solve(arma::trimatl(covLower), diff);
+    exponent = arma::dot(solved, solved);
+  }
+  else
+  {
+    exponent = arma::dot(diff, invCov * diff);
+  }
 
-  // TODO: What if det(cov) < 0?
-  return pow(2 * M_PI, (double) observation.n_elem / -2.0) *
-      pow(det(covariance), -0.5) * exp(exponent[0]);
+  return -0.5 * (observation.n_elem * std::log(2 * M_PI) + logDetCov +
+      exponent);
 }
 
+/**
+ * Return whether all the off-diagonal elements of the given matrix are zero.
+ */
+bool GaussianDistribution::IsDiagonal(const arma::mat& matrix)
+{
+  for (size_t c = 0; c < matrix.n_cols; ++c)
+    for (size_t r = 0; r < matrix.n_rows; ++r)
+      if (r != c && matrix(r, c) != 0.0)
+        return false;
 
+  return true;
+}
+
+/**
+ * Set the covariance and factor it.
+ */
+void GaussianDistribution::Covariance(const arma::mat& covariance)
+{
+  this->covariance = covariance;
+  factored = false;
+  FactorCovariance();
+}
+
+/**
+ * Compute the Cholesky factor and log-determinant of the covariance, if the
+ * covariance may have changed since the last time.
+ */
+void GaussianDistribution::FactorCovariance() const
+{
+  if (factored)
+    return; // The cached factorization is still valid.
+
+  factored = true;
+
+  // There is nothing to factor for an empty distribution.
+  if (covariance.n_elem == 0)
+  {
+    positiveDefinite = false;
+    diagonal = false;
+    covLower.reset();
+    invCov.reset();
+    invStdDev.reset();
+    logDetCov = 0.0;
+    return;
+  }
+
+  // A diagonal covariance with a positive diagonal needs no factorization.
+  diagonal = (covariance.n_elem > 0) && covariance.is_square() &&
+      IsDiagonal(covariance) && (arma::min(covariance.diag()) > 0.0);
+  if (diagonal)
+  {
+    positiveDefinite = true;
+    covLower.reset();
+    invCov.reset();
+    invStdDev = 1.0 / arma::sqrt(covariance.diag());
+    logDetCov = arma::accu(arma::log(covariance.diag()));
+    return;
+  }
+
+  // The Cholesky decomposition only looks at the upper triangle, so it can only
+  // be used if the covariance is symmetric (up to rounding error).
+  arma::mat upper;
+  const double asymmetry = (covariance.n_elem == 0) ? 0.0 :
+      arma::max(arma::max(arma::abs(covariance - trans(covariance))));
+  const double scale = (covariance.n_elem == 0) ? 0.0 :
+      arma::max(arma::max(arma::abs(covariance)));
+  positiveDefinite = (covariance.n_elem > 0) && (covariance.is_square()) &&
+      (asymmetry <= 1e-10 * scale) && arma::chol(upper, covariance);
+  if (positiveDefinite)
+  {
+    covLower = trans(upper);
+    invCov.reset();
+    logDetCov = 2.0 * arma::accu(arma::log(covLower.diag()));
+  }
+  else
+  {
+    // Fall back to the inverse and the determinant, which also work for
+    // covariances that are not symmetric.
+    // TODO: What if det(cov) < 0?
+    covLower.reset();
+    invCov = arma::inv(covariance);
+    logDetCov = std::log(arma::det(covariance));
+  }
+}
 
 arma::vec GaussianDistribution::Random() const
 {
-  // Should we store chol(covariance) for easier calculation later?
+  FactorCovariance();
+  if (diagonal)
+    return arma::randn<arma::vec>(mean.n_elem) / invStdDev + mean;
+  if (positiveDefinite)
+    return covLower * arma::randn<arma::vec>(mean.n_elem) + mean;
+
   return trans(chol(covariance)) * arma::randn<arma::vec>(mean.n_elem) + mean;
 }
 
@@ -47,6 +150,8 @@ arma::vec GaussianDistribution::Random() const
  */
 void GaussianDistribution::Estimate(const arma::mat& observations)
 {
+  factored = false;
+
   if (observations.n_cols > 0)
   {
     mean.zeros(observations.n_rows);
@@ -90,6 +195,8 @@ void GaussianDistribution::Estimate(const arma::mat& observations)
       perturbation *= 10; // Slow, but we don't want to add too much.
     }
   }
+
+  FactorCovariance();
 }
 
 /**
@@ -100,6 +207,8 @@ void GaussianDistribution::Estimate(const arma::mat& observations)
 void GaussianDistribution::Estimate(const arma::mat& observations,
                                     const arma::vec& probabilities)
 {
+  factored = false;
+
   if (observations.n_cols > 0)
   {
     mean.zeros(observations.n_rows);
@@ -156,6 +265,8 @@ void GaussianDistribution::Estimate(const arma::mat& observations,
       perturbation *= 10; // Slow, but we don't want to add too much.
     }
   }
+
+  FactorCovariance();
 }
 
 /**
@@ -183,7 +294,13 @@ void GaussianDistribution::Save(util::SaveRestoreUtility& sr) const
 {
   sr.SaveParameter(Type(), "type");
   sr.SaveParameter(mean, "mean");
-  sr.SaveParameter(covariance, "covariance");
+
+  // Only the diagonal of a diagonal covariance is stored.
+  if (covariance.n_elem > 0 && covariance.is_square() &&
+      IsDiagonal(covariance))
+    sr.SaveParameter(arma::vec(covariance.diag()), "diagonal_covariance");
+  else
+    sr.SaveParameter(covariance, "covariance");
 }
 
 /**
@@ -192,5 +309,17 @@ void GaussianDistribution::Save(util::SaveRestoreUtility& sr) const
 void GaussianDistribution::Load(const util::SaveRestoreUtility& sr)
 {
   sr.LoadParameter(mean, "mean");
-  sr.LoadParameter(covariance, "covariance");
+  if (sr.HasParameter("diagonal_covariance"))
+  {
+    arma::vec diagonalCovariance;
+    sr.LoadParameter(diagonalCovariance, "diagonal_covariance");
+    covariance = arma::diagmat(diagonalCovariance);
+  }
+  else
+  {
+    sr.LoadParameter(covariance, "covariance");
+  }
+
+  factored = false;
+  FactorCovariance();
 }
@@ -24,11 +24,36 @@ class GaussianDistribution
   //! Covariance of the distribution.
   arma::mat covariance;
 
+  //! Whether the cached factorization below is up to date.  The non-const
+  //! Covariance() clears it, since the covariance may be changed through the
+  //! reference it returns.
+  mutable bool factored;
+  //! Whether the covariance is positive definite (so covLower or invStdDev is
+  //! valid).
+  mutable bool positiveDefinite;
+  //! Whether the covariance is diagonal (so invStdDev is used instead of
+  //! covLower).
+  mutable bool diagonal;
+  //! One over the square root of each diagonal element of a diagonal
+  //! covariance.
+  mutable arma::vec invStdDev;
+  //! Lower triangular Cholesky factor of the covariance.
+  mutable arma::mat covLower;
+  //! Inverse of the covariance; only used if it is not positive definite.
+  mutable arma::mat invCov;
+  //! Log-determinant of the covariance.
+  mutable double logDetCov;
+
  public:
   /**
    * Default constructor, which creates a Gaussian with zero dimension.
    */
-  GaussianDistribution() { /* nothing to do */ }
+  GaussianDistribution() :
+      factored(false),
+      positiveDefinite(false),
+      diagonal(false),
+      logDetCov(0.0)
+  { /* nothing to do */ }
 
   /**
    * Create a Gaussian distribution with zero mean and identity covariance with
@@ -36,14 +61,28 @@ class GaussianDistribution
    */
   GaussianDistribution(const size_t dimension) :
       mean(arma::zeros<arma::vec>(dimension)),
-      covariance(arma::eye<arma::mat>(dimension, dimension))
-  { /* Nothing to do. */ }
+      covariance(arma::eye<arma::mat>(dimension, dimension)),
+      factored(false),
+      positiveDefinite(false),
+      diagonal(false),
+      logDetCov(0.0)
+  {
+    FactorCovariance();
+  }
 
   /**
    * Create a Gaussian distribution with the given mean and covariance.
    */
   GaussianDistribution(const arma::vec& mean, const arma::mat& covariance) :
-      mean(mean), covariance(covariance) { /* Nothing to do. */ }
+      mean(mean),
+      covariance(covariance),
+      factored(false),
+      positiveDefinite(false),
+      diagonal(false),
+      logDetCov(0.0)
+  {
+    FactorCovariance();
+  }
 
   //! Return the dimensionality of this distribution.
   size_t Dimensionality() const { return mean.n_elem; }
@@ -52,7 +91,7 @@ class GaussianDistribution
    * Return the probability of the given observation.
    */
   double Probability(const arma::vec& observation) const;
-  
+
   /**
    * Calculates the multivariate Gaussian probability density function for each
    * data point (column) in the given matrix
@@ -61,7 +100,40 @@ class GaussianDistribution
    * @param probabilities Output probabilities for each input observation.
    */
   void Probability(const arma::mat& x, arma::vec& probabilities) const;
-  
+
+  /**
+   * Return the log-probability of the given observation.
+   */
+  double LogProbability(const arma::vec& observation) const;
+
+  /**
+   * Calculate the log of the multivariate Gaussian probability density
+   * function for each data point (column) in the given matrix.  This uses one
+   * triangular solve with the Cholesky factor of the covariance for the whole
+   * matrix, and it does not underflow for points far from the mean.
+   *
+   * @param x List of observations.
+   * @param logProbabilities Output log-probabilities for each input
+   *     observation.
+   */
+  void LogProbability(const arma::mat& x, arma::vec& logProbabilities) const;
+
+  /**
+   * Compute the Cholesky factor and the log-determinant of the covariance, if
+   * the non-const Covariance() has been called since they were last computed.
+   * A diagonal covariance is not factored, and evaluating the distribution
+   * then costs O(d) per point instead of O(d^2).
+   *
+   * The constructors and Covariance(const arma::mat&) factor the covariance
+   * right away.  After changing the covariance through the non-const
+   * Covariance(), the first call to Probability(), LogProbability() or Random()
+   * factors it; so this must be called before evaluating the same distribution
+   * from several threads at once, since that first call writes the cache.
+   * Changes made through a reference to the covariance that was obtained
+   * before the last factorization are not seen.
+   */
+  void FactorCovariance() const;
+
   /**
    * Return a randomly generated observation according to the probability
    * distribution defined by this object.
@@ -101,9 +173,15 @@ class GaussianDistribution
   const arma::mat& Covariance() const { return covariance; }
 
   /**
-   * Return a modifiable copy of the covariance.
+   * Return a modifiable copy of the covariance.  The cached factorization is
+   * recomputed the next time it is needed.
    */
-  arma::mat& Covariance() { return covariance; }
+  arma::mat& Covariance() { factored = false; return covariance; }
+
+  /**
+   * Set the covariance, and factor it right away.
+   */
+  void Covariance(const arma::mat& covariance);
 
   /**
    * Returns a string representation of this object.
@@ -116,37 +194,69 @@ class GaussianDistribution
   void Save(util::SaveRestoreUtility& n) const;
   void Load(const util::SaveRestoreUtility& n);
   static std::string const Type() { return "GaussianDistribution"; }
+
+  //! Return whether all the off-diagonal elements of the matrix are zero.
+  static bool IsDiagonal(const arma::mat& matrix);
   
   
     
 };
 
 /**
-* Calculates the multivariate Gaussian probability density function for each
-* data point (column) in the given matrix
-*
-* @param x List of observations.
-* @param probabilities Output probabilities for each input observation.
-*/
+ * Calculates the multivariate Gaussian probability density function for each
+ * data point (column) in the given matrix.
+ *
+ * @param x List of observations.
+ * @param probabilities Output probabilities for each input observation.
+ */
 inline void GaussianDistribution::Probability(const arma::mat& x,
                                               arma::vec& probabilities) const
 {
+  LogProbability(x, probabilities);
+  probabilities = arma::exp(probabilities);
+}
+
+/**
+ * Calculates the log of the multivariate Gaussian probability density function
+ * for each data point (column) in the given matrix.
+ *
+ * @param x List of observations.
+ * @param logProbabilities Output log-probabilities for each input observation.
+ */
+inline void GaussianDistribution::LogProbability(
+    const arma::mat& x,
+    arma::vec& logProbabilities) const
+{
+  FactorCovariance();
+
   // Column i of 'diffs' is the difference between x.col(i) and the mean.
-  arma::mat diffs = x - (mean * arma::ones<arma::rowvec>(x.n_cols));
-  
-  // Now, we only want to calculate the diagonal elements of (diffs' * cov^-1 *
-  // diffs).  We just don't need any of the other elements.  We can calculate
-  // the right hand part of the equation (instead of the left side) so that
-  // later we are referencing columns, not rows -- that is faster.
-  arma::mat rhs = -0.5 * inv(covariance) * diffs;
-  arma::vec exponents(diffs.n_cols); // We will now fill this.
-  for (size_t i = 0; i < diffs.n_cols; i++)
-    exponents(i) = exp(accu(diffs.unsafe_col(i) % rhs.unsafe_col(i)));
-  
-  probabilities = pow(2 * M_PI, (double) mean.n_elem / -2.0) *
-  pow(arma::det(covariance), -0.5) * exponents;
+  const arma::mat diffs = x - (mean * arma::ones<arma::rowvec>(x.n_cols));
+
+  // We only need the diagonal elements of (diffs' * cov^-1 * diffs).  With
+  // cov = L * L', element i is the squared norm of column i of L^-1 * diffs,
+  // which one triangular solve gives for all points at once.
+  arma::rowvec exponents;
+  if (diagonal)
+  {
+    arma::mat scaled = diffs;
+    for (size_t i = 0; i < scaled.n_rows; ++i)
+      scaled.row(i) *= invStdDev[i];
+    exponents = arma::sum(scaled % scaled, 0);
+  }
+  else if (positiveDefinite)
+  {
+    const arma::mat solved = arma::solve(arma::trimatl(covLower), diffs);
+    exponents = arma::sum(solved % solved, 0);
+  }
+  else
+  {
+    exponents = arma::sum(diffs % (invCov * diffs), 0);
+  }
+
+  const double logNormalizer = -0.5 * (mean.n_elem * std::log(2 * M_PI) +
+      logDetCov);
+  logProbabilities = logNormalizer - 0.5 * trans(exponents);
 }
-  
 
 }; // namespace distribution
 }; // namespace mlpack
@@ -35,6 +35,17 @@ class CosineDistance
   template<typename VecType>
   static double Evaluate(const VecType& a, const VecType& b);
 
+  /**
+   * Computes the cosine distance between every point in a and every point in
+   * b, so that k(i, j) = d(a.col(i), b.col(j)).  The inner products are
+   * computed with a single matrix multiplication.
+   *
+   * @param a First set of points.
+   * @param b Second set of points.
+   * @param k Matrix to store distances in (a.n_cols x b.n_cols).
+   */
+  static void Evaluate(const arma::mat& a, const arma::mat& b, arma::mat& k);
+
   /**
    * Returns a string representation of this object.
    */
@@ -53,6 +64,8 @@ class KernelTraits<CosineDistance>
  public:
   //! The cosine kernel is normalized: K(x, x) = 1 for all x.
   static const bool IsNormalized = true;
+  //! The cosine distance can be evaluated on sets of points at once.
+  static const bool HasBatchEvaluate = true;
 };
 
 }; // namespace kernel
@@ -27,6 +27,23 @@ double CosineDistance::Evaluate(const VecType& a, const VecType& b)
     return dot(a, b) / denominator;
 }
 
+inline void CosineDistance::Evaluate(const arma::mat& a,
+                                     const arma::mat& b,
+                                     arma::mat& k)
+{
+  arma::vec aNorms = arma::trans(arma::sqrt(arma::sum(arma::square(a), 0)));
+  arma::rowvec bNorms = arma::sqrt(arma::sum(arma::square(b), 0));
+
+  // As above, a point with zero norm has zero inner products, so any nonzero
+  // normalization gives the same result.
+  aNorms.elem(arma::find(aNorms == 0.0)).ones();
+  bNorms.elem(arma::find(bNorms == 0.0)).ones();
+
+  k = arma::trans(a) * b;
+  k.each_col() /= aNorms;
+  k.each_row() /= bNorms;
+}
+
 }; // namespace kernel
 }; // namespace mlpack
 
@@ -31,6 +31,18 @@ double EpanechnikovKernel::Evaluate(const double distance) const
   return std::max(0.0, 1 - std::pow(distance, 2.0) * inverseBandwidthSquared);
 }
 
+/**
+ * Evaluate the kernel between every point in a and every point in b.
+ */
+void EpanechnikovKernel::Evaluate(const arma::mat& a,
+                                  const arma::mat& b,
+                                  arma::mat& k) const
+{
+  math::SquaredDistances(a, b, k);
+  k = 1.0 - k * inverseBandwidthSquared;
+  k.elem(arma::find(k < 0.0)).zeros();
+}
+
 // Return string of object.
 std::string EpanechnikovKernel::ToString() const
 {
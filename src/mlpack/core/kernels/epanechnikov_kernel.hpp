@@ -49,6 +49,17 @@ class EpanechnikovKernel
    */
   double Evaluate(const double distance) const;
 
+  /**
+   * Evaluate the Epanechnikov kernel between every point in a and every point
+   * in b, so that k(i, j) = K(a.col(i), b.col(j)).  The squared distances are
+   * computed with math::SquaredDistances().
+   *
+   * @param a First set of points.
+   * @param b Second set of points.
+   * @param k Matrix to store kernel values in (a.n_cols x b.n_cols).
+   */
+  void Evaluate(const arma::mat& a, const arma::mat& b, arma::mat& k) const;
+
   /**
    * Obtains the convolution integral [integral of K(||x-a||) K(||b-x||) dx]
    * for the two vectors.
@@ -87,6 +98,8 @@ class KernelTraits<EpanechnikovKernel>
  public:
   //! The Epanechnikov kernel is normalized: K(x, x) = 1 for all x.
   static const bool IsNormalized = true;
+  //! The Epanechnikov kernel can be evaluated on sets of points at once.
+  static const bool HasBatchEvaluate = true;
 };
 
 }; // namespace kernel
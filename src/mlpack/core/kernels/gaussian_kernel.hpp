@@ -75,6 +75,21 @@ class GaussianKernel
     return exp(gamma * std::pow(t, 2.0));
   }
 
+  /**
+   * Evaluate the kernel between every point in a and every point in b, so that
+   * k(i, j) = K(a.col(i), b.col(j)).  The squared distances are computed with
+   * math::SquaredDistances(), which is a single matrix multiplication.
+   *
+   * @param a First set of points.
+   * @param b Second set of points.
+   * @param k Matrix to store kernel values in (a.n_cols x b.n_cols).
+   */
+  void Evaluate(const arma::mat& a, const arma::mat& b, arma::mat& k) const
+  {
+    math::SquaredDistances(a, b, k);
+    k = arma::exp(gamma * k);
+  }
+
   /**
    * Obtain the normalization constant of the Gaussian kernel.
    *
@@ -140,6 +155,8 @@ class KernelTraits<GaussianKernel>
  public:
   //! The Gaussian kernel is normalized: K(x, x) = 1 for all x.
   static const bool IsNormalized = true;
+  //! The Gaussian kernel can be evaluated on sets of points at once.
+  static const bool HasBatchEvaluate = true;
 };
 
 }; // namespace kernel
@@ -55,6 +55,20 @@ class HyperbolicTangentKernel
     return tanh(scale * arma::dot(a, b) + offset);
   }
 
+  /**
+   * Evaluate the kernel between every point in a and every point in b, so that
+   * k(i, j) = K(a.col(i), b.col(j)).  The inner products are computed with a
+   * single matrix multiplication.
+   *
+   * @param a First set of points.
+   * @param b Second set of points.
+   * @param k Matrix to store kernel values in (a.n_cols x b.n_cols).
+   */
+  void Evaluate(const arma::mat& a, const arma::mat& b, arma::mat& k) const
+  {
+    k = arma::tanh(scale * arma::trans(a) * b + offset);
+  }
+
   //! Get scale factor.
   double Scale() const { return scale; }
   //! Modify scale factor.
@@ -80,6 +94,17 @@ class HyperbolicTangentKernel
   double offset;
 };
 
+//! Kernel traits for the hyperbolic tangent kernel.
+template<>
+class KernelTraits<HyperbolicTangentKernel>
+{
+ public:
+  //! The hyperbolic tangent kernel is not normalized.
+  static const bool IsNormalized = false;
+  //! The hyperbolic tangent kernel can be evaluated on sets of points at once.
+  static const bool HasBatchEvaluate = true;
+};
+
 }; // namespace kernel
 }; // namespace mlpack
 
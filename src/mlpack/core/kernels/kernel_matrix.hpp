@@ -0,0 +1,110 @@
+/**
+ * @file kernel_matrix.hpp
+ *
+ * Functions to build the kernel matrix between two sets of points (or of one
+ * set of points with itself), in blocks and in parallel.
+ */
+#ifndef __MLPACK_CORE_KERNELS_KERNEL_MATRIX_HPP
+#define __MLPACK_CORE_KERNELS_KERNEL_MATRIX_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kernel {
+
+/**
+ * Compute the kernel matrix between the points in a and the points in b, so
+ * that k(i, j) = K(a.col(i), b.col(j)).  The matrix is computed in square
+ * blocks which are split among the given number of threads (if OpenMP is
+ * available).  If the kernel provides a batch Evaluate(a, b, k) (see
+ * KernelTraits::HasBatchEvaluate), each block is computed with one call to it;
+ * otherwise, Evaluate() is called for each pair of points.
+ *
+ * @param kernel Kernel to evaluate.
+ * @param a First set of points.
+ * @param b Second set of points.
+ * @param k Matrix to store the kernel matrix in (a.n_cols x b.n_cols).
+ * @param threads Number of threads to use (0 uses all available).
+ */
+template<typename KernelType>
+void KernelMatrix(KernelType& kernel,
+                  const arma::mat& a,
+                  const arma::mat& b,
+                  arma::mat& k,
+                  const size_t threads = 0);
+
+/**
+ * Compute the kernel matrix of the points in data with themselves, so that
+ * k(i, j) = K(data.col(i), data.col(j)).  Only the blocks on and above the
+ * diagonal are computed; the rest of the matrix is filled by symmetry.
+ *
+ * @param kernel Kernel to evaluate.
+ * @param data Set of points.
+ * @param k Matrix to store the kernel matrix in (data.n_cols x data.n_cols).
+ * @param threads Number of threads to use (0 uses all available).
+ */
+template<typename KernelType>
+void KernelMatrix(KernelType& kernel,
+                  const arma::mat& data,
+                  arma::mat& k,
+                  const size_t threads = 0);
+
+/**
+ * Compute one block of a kernel matrix: k(i, j) = K(a.col(i), b.col(j)) for
+ * rowBegin <= i < rowEnd and colBegin <= j < colEnd.  This generic version
+ * evaluates the kernel on each pair of points; kernels with a batch Evaluate()
+ * use the specialization below.
+ */
+template<typename KernelType,
+         bool HasBatchEvaluate = KernelTraits<KernelType>::HasBatchEvaluate>
+class KernelMatrixRule
+{
+ public:
+  static void Block(KernelType& kernel,
+                    const arma::mat& a,
+                    const arma::mat& b,
+                    arma::mat& k,
+                    const size_t rowBegin,
+                    const size_t rowEnd,
+                    const size_t colBegin,
+                    const size_t colEnd)
+  {
+    for (size_t j = colBegin; j < colEnd; ++j)
+      for (size_t i = rowBegin; i < rowEnd; ++i)
+        k(i, j) = kernel.Evaluate(a.unsafe_col(i), b.unsafe_col(j));
+  }
+};
+
+/**
+ * Compute one block of a kernel matrix with the kernel's batch Evaluate(),
+ * which is usually a single matrix multiplication.
+ */
+template<typename KernelType>
+class KernelMatrixRule<KernelType, true>
+{
+ public:
+  static void Block(KernelType& kernel,
+                    const arma::mat& a,
+                    const arma::mat& b,
+                    arma::mat& k,
+                    const size_t rowBegin,
+                    const size_t rowEnd,
+                    const size_t colBegin,
+                    const size_t colEnd)
+  {
+    const arma::mat aBlock = a.cols(rowBegin, rowEnd - 1);
+    const arma::mat bBlock = b.cols(colBegin, colEnd - 1);
+
+    arma::mat block;
+    kernel.Evaluate(aBlock, bBlock, block);
+    k.submat(rowBegin, colBegin, rowEnd - 1, colEnd - 1) = block;
+  }
+};
+
+}; // namespace kernel
+}; // namespace mlpack
+
+// Include implementation.
+#include "kernel_matrix_impl.hpp"
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file kernel_matrix_impl.hpp
+ *
+ * Implementation of the blocked, parallel kernel matrix functions.
+ */
+#ifndef __MLPACK_CORE_KERNELS_KERNEL_MATRIX_IMPL_HPP
+#define __MLPACK_CORE_KERNELS_KERNEL_MATRIX_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kernel_matrix.hpp"
+
+namespace mlpack {
+namespace kernel {
+
+//! The number of points in each side of a block of the kernel matrix.
+const size_t kernelMatrixBlockSize = 128;
+
+template<typename KernelType>
+void KernelMatrix(KernelType& kernel,
+                  const arma::mat& a,
+                  const arma::mat& b,
+                  arma::mat& k,
+                  const size_t threads)
+{
+  k.set_size(a.n_cols, b.n_cols);
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  const size_t rowBlocks = (a.n_cols + kernelMatrixBlockSize - 1) /
+      kernelMatrixBlockSize;
+  const size_t colBlocks = (b.n_cols + kernelMatrixBlockSize - 1) /
+      kernelMatrixBlockSize;
+
+  // Each block is written by only one thread.
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t block = 0; block < (omp_size_t) (rowBlocks * colBlocks);
+       ++block)
+  {
+    const size_t rowBegin = (block % rowBlocks) * kernelMatrixBlockSize;
+    const size_t colBegin = (block / rowBlocks) * kernelMatrixBlockSize;
+    KernelMatrixRule<KernelType>::Block(kernel, a, b, k, rowBegin,
+        std::min(rowBegin + kernelMatrixBlockSize, (size_t) a.n_cols),
+        colBegin, std::min(colBegin + kernelMatrixBlockSize,
+        (size_t) b.n_cols));
+  }
+}
+
+template<typename KernelType>
+void KernelMatrix(KernelType& kernel,
+                  const arma::mat& data,
+                  arma::mat& k,
+                  const size_t threads)
+{
+  k.set_size(data.n_cols, data.n_cols);
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  const size_t blocks = (data.n_cols + kernelMatrixBlockSize - 1) /
+      kernelMatrixBlockSize;
+
+  // Only compute the blocks on or above the diagonal.
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t block = 0; block < (omp_size_t) (blocks * blocks); ++block)
+  {
+    const size_t rowBlock = block % blocks;
+    const size_t colBlock = block / blocks;
+    if (rowBlock > colBlock)
+      continue;
+
+    const size_t rowBegin = rowBlock * kernelMatrixBlockSize;
+    const size_t colBegin = colBlock * kernelMatrixBlockSize;
+    KernelMatrixRule<KernelType>::Block(kernel, data, data, k, rowBegin,
+        std::min(rowBegin + kernelMatrixBlockSize, (size_t) data.n_cols),
+        colBegin, std::min(colBegin + kernelMatrixBlockSize,
+        (size_t) data.n_cols));
+  }
+
+  // Copy to the lower triangular part of the matrix.  The blocks on the
+  // diagonal were computed entirely, so only the blocks below need copying.
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t j = 0; j < (omp_size_t) data.n_cols; ++j)
+  {
+    const size_t firstRow = (j / kernelMatrixBlockSize + 1) *
+        kernelMatrixBlockSize;
+    for (size_t i = firstRow; i < data.n_cols; ++i)
+      k(i, j) = k(j, i);
+  }
+}
+
+}; // namespace kernel
+}; // namespace mlpack
+
+#endif
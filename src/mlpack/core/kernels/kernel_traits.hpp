@@ -26,6 +26,13 @@ class KernelTraits
    * If true, then the kernel is normalized: K(x, x) = K(y, y) = 1 for all x.
    */
   static const bool IsNormalized = false;
+
+  /**
+   * If true, then the kernel provides Evaluate(a, b, k), which computes the
+   * kernel between every point in a and every point in b at once (usually
+   * with a single matrix multiplication).
+   */
+  static const bool HasBatchEvaluate = false;
 };
 
 }; // namespace kernel
@@ -72,6 +72,21 @@ class LaplacianKernel
     return exp(-t / bandwidth);
   }
 
+  /**
+   * Evaluate the kernel between every point in a and every point in b, so that
+   * k(i, j) = K(a.col(i), b.col(j)).  The distances are computed with
+   * math::SquaredDistances(), which is a single matrix multiplication.
+   *
+   * @param a First set of points.
+   * @param b Second set of points.
+   * @param k Matrix to store kernel values in (a.n_cols x b.n_cols).
+   */
+  void Evaluate(const arma::mat& a, const arma::mat& b, arma::mat& k) const
+  {
+    math::SquaredDistances(a, b, k);
+    k = arma::exp(-arma::sqrt(k) / bandwidth);
+  }
+
   //! Get the bandwidth.
   double Bandwidth() const { return bandwidth; }
   //! Modify the bandwidth.
@@ -98,6 +113,8 @@ class KernelTraits<LaplacianKernel>
  public:
   //! The Laplacian kernel is normalized: K(x, x) = 1 for all x.
   static const bool IsNormalized = true;
+  //! The Laplacian kernel can be evaluated on sets of points at once.
+  static const bool HasBatchEvaluate = true;
 };
 
 }; // namespace kernel
@@ -48,6 +48,19 @@ class LinearKernel
     return arma::dot(a, b);
   }
 
+  /**
+   * Evaluate the kernel between every point in a and every point in b, so that
+   * k(i, j) = K(a.col(i), b.col(j)).  This is a single matrix multiplication.
+   *
+   * @param a First set of points.
+   * @param b Second set of points.
+   * @param k Matrix to store kernel values in (a.n_cols x b.n_cols).
+   */
+  static void Evaluate(const arma::mat& a, const arma::mat& b, arma::mat& k)
+  {
+    k = arma::trans(a) * b;
+  }
+
   //! Return a string representation of the kernel.
   std::string ToString() const
   {
@@ -57,6 +70,17 @@ class LinearKernel
   }
 };
 
+//! Kernel traits for the linear kernel.
+template<>
+class KernelTraits<LinearKernel>
+{
+ public:
+  //! The linear kernel is not normalized.
+  static const bool IsNormalized = false;
+  //! The linear kernel can be evaluated on sets of points at once.
+  static const bool HasBatchEvaluate = true;
+};
+
 }; // namespace kernel
 }; // namespace mlpack
 
@@ -10,6 +10,8 @@
  */
 #include "pspectrum_string_kernel.hpp"
 
+#include <algorithm>
+
 using namespace std;
 using namespace mlpack;
 using namespace mlpack::kernel;
@@ -79,5 +81,138 @@ mlpack::kernel::PSpectrumStringKernel::PSpectrumStringKernel(
     }
   }
 
+  // Encode the substrings of each string as keys, and store the sorted keys
+  // of each dataset contiguously.
+  keys.resize(datasets.size());
+  keyCounts.resize(datasets.size());
+  offsets.resize(datasets.size());
+  for (size_t dataset = 0; dataset < datasets.size(); ++dataset)
+  {
+    size_t total = 0;
+    for (size_t index = 0; index < counts[dataset].size(); ++index)
+      total += counts[dataset][index].size();
+
+    keys[dataset].reserve(total);
+    keyCounts[dataset].reserve(total);
+    offsets[dataset].resize(counts[dataset].size() + 1);
+    offsets[dataset][0] = 0;
+
+    std::vector<std::pair<uint64_t, int> > stringKeys;
+    for (size_t index = 0; index < counts[dataset].size(); ++index)
+    {
+      const std::map<std::string, int>& mapping = counts[dataset][index];
+      stringKeys.clear();
+      for (std::map<std::string, int>::const_iterator it = mapping.begin();
+           it != mapping.end(); ++it)
+        stringKeys.push_back(std::make_pair(Key((*it).first), (*it).second));
+
+      std::sort(stringKeys.begin(), stringKeys.end());
+      for (size_t i = 0; i < stringKeys.size(); ++i)
+      {
+        keys[dataset].push_back(stringKeys[i].first);
+        keyCounts[dataset].push_back(stringKeys[i].second);
+      }
+
+      offsets[dataset][index + 1] = keys[dataset].size();
+    }
+  }
+
   Log::Info << "Substring extraction complete." << std::endl;
 }
+
+/**
+ * Evaluate the kernel between every string in a and every string in b.  Each
+ * evaluation is a merge of the sorted keys of the two strings.
+ */
+void PSpectrumStringKernel::Evaluate(const arma::mat& a,
+                                     const arma::mat& b,
+                                     arma::mat& k) const
+{
+  k.set_size(a.n_cols, b.n_cols);
+  for (size_t j = 0; j < b.n_cols; ++j)
+  {
+    const size_t bSet = (size_t) b(0, j);
+    const size_t bIndex = (size_t) b(1, j);
+    for (size_t i = 0; i < a.n_cols; ++i)
+      k(i, j) = EvaluateKeys((size_t) a(0, i), (size_t) a(1, i), bSet, bIndex);
+  }
+}
+
+/**
+ * Encode a substring as a key.  If p is at most 12, a substring of lowercase
+ * ASCII letters and digits is written as a number in base 37 (each character
+ * is a nonzero digit), so each of these substrings has its own key; otherwise,
+ * the key is the 64-bit FNV-1a hash of the substring.
+ */
+uint64_t PSpectrumStringKernel::Key(const std::string& substring) const
+{
+  if (p <= 12)
+  {
+    uint64_t key = 0;
+    size_t i = 0;
+    for (; i < substring.length(); ++i)
+    {
+      const char c = substring[i];
+      if (c >= '0' && c <= '9')
+        key = 37 * key + (c - '0' + 1);
+      else if (c >= 'a' && c <= 'z')
+        key = 37 * key + (c - 'a' + 11);
+      else
+        break; // Another alphanumeric character in the current locale.
+    }
+
+    if (i == substring.length())
+      return key;
+  }
+
+  uint64_t key = 14695981039346656037ULL;
+  for (size_t i = 0; i < substring.length(); ++i)
+  {
+    key ^= (uint64_t) (unsigned char) substring[i];
+    key *= 1099511628211ULL;
+  }
+
+  return key;
+}
+
+/**
+ * Evaluate the kernel between two strings by walking through their sorted keys
+ * together and summing the products of the counts of the matching keys.
+ */
+double PSpectrumStringKernel::EvaluateKeys(const size_t aSet,
+                                           const size_t aIndex,
+                                           const size_t bSet,
+                                           const size_t bIndex) const
+{
+  const std::vector<uint64_t>& aKeys = keys[aSet];
+  const std::vector<uint64_t>& bKeys = keys[bSet];
+  const std::vector<int>& aCounts = keyCounts[aSet];
+  const std::vector<int>& bCounts = keyCounts[bSet];
+
+  size_t aPos = offsets[aSet][aIndex];
+  size_t bPos = offsets[bSet][bIndex];
+  const size_t aEnd = offsets[aSet][aIndex + 1];
+  const size_t bEnd = offsets[bSet][bIndex + 1];
+
+  double eval = 0;
+  while ((aPos < aEnd) && (bPos < bEnd))
+  {
+    if (aKeys[aPos] == bKeys[bPos]) // The same substring.
+    {
+      eval += (aCounts[aPos] * bCounts[bPos]);
+      ++aPos;
+      ++bPos;
+    }
+    else if (aKeys[aPos] > bKeys[bPos])
+    {
+      // aPos is "ahead" of bPos; so increment bPos to "catch up".
+      ++bPos;
+    }
+    else
+    {
+      ++aPos;
+    }
+  }
+
+  return eval;
+}
@@ -55,6 +55,14 @@ namespace kernel {
  * the data according to the fake data matrix -- resulting in a meaningless
  * tree.  This kernel was originally written for the FastMKS method; so, at the
  * very least, it will work with that.
+ *
+ * At construction time, the substrings of each string are also encoded as
+ * 64-bit integer keys, and the keys and counts of each string are stored as a
+ * sorted array (the arrays of one dataset are stored contiguously).  Each
+ * evaluation of the kernel is then a merge of two arrays of integers.  If p is
+ * at most 12, each substring (of lowercase alphanumeric characters) has a
+ * distinct key; for larger p, the keys are 64-bit hashes of the substrings,
+ * and two distinct substrings share a key with negligible probability.
  */
 class PSpectrumStringKernel
 {
@@ -83,6 +91,17 @@ class PSpectrumStringKernel
   template<typename VecType>
   double Evaluate(const VecType& a, const VecType& b) const;
 
+  /**
+   * Evaluate the kernel between every string in a and every string in b, so
+   * that k(i, j) = K(a.col(i), b.col(j)).  Each column of a and b holds the
+   * index of a dataset and the index of a string, as for Evaluate(a, b).
+   *
+   * @param a First set of string indices.
+   * @param b Second set of string indices.
+   * @param k Matrix to store kernel values in (a.n_cols x b.n_cols).
+   */
+  void Evaluate(const arma::mat& a, const arma::mat& b, arma::mat& k) const;
+
   //! Access the lists of substrings.
   const std::vector<std::vector<std::map<std::string, int> > >& Counts() const
   { return counts; }
@@ -117,8 +136,36 @@ class PSpectrumStringKernel
   //! is not wonderful...
   std::vector<std::vector<std::map<std::string, int> > > counts;
 
+  //! For each dataset, the sorted keys of the substrings of every string; the
+  //! keys of string i are at indices offsets[i] to offsets[i + 1] - 1.
+  std::vector<std::vector<uint64_t> > keys;
+  //! For each dataset, the count of the substring with each key.
+  std::vector<std::vector<int> > keyCounts;
+  //! For each dataset, the index of the first key of every string.
+  std::vector<std::vector<size_t> > offsets;
+
   //! The value of p to use in calculation.
   size_t p;
+
+  //! Encode a substring of length p as a key.
+  uint64_t Key(const std::string& substring) const;
+
+  //! Evaluate the kernel between two strings by merging their keys.
+  double EvaluateKeys(const size_t aSet,
+                      const size_t aIndex,
+                      const size_t bSet,
+                      const size_t bIndex) const;
+};
+
+//! Kernel traits for the p-spectrum string kernel.
+template<>
+class KernelTraits<PSpectrumStringKernel>
+{
+ public:
+  //! The p-spectrum string kernel is not normalized.
+  static const bool IsNormalized = false;
+  //! The p-spectrum string kernel can be evaluated on sets of strings at once.
+  static const bool HasBatchEvaluate = true;
 };
 
 }; // namespace kernel
@@ -31,6 +31,17 @@ class SphericalKernel
       (metric::SquaredEuclideanDistance::Evaluate(a, b) <= bandwidthSquared) ?
         1.0 : 0.0;
   }
+
+  /**
+   * Evaluate the spherical kernel between every point in a and every point in
+   * b, so that k(i, j) = K(a.col(i), b.col(j)).  The squared distances are
+   * computed with math::SquaredDistances().
+   */
+  void Evaluate(const arma::mat& a, const arma::mat& b, arma::mat& k) const
+  {
+    math::SquaredDistances(a, b, k);
+    k = arma::conv_to<arma::mat>::from(k <= bandwidthSquared);
+  }
   /**
    * Obtains the convolution integral [integral K(||x-a||)K(||b-x||)dx]
    * for the two vectors.  In this case, because
@@ -101,6 +112,8 @@ class KernelTraits<SphericalKernel>
  public:
   //! The spherical kernel is normalized: K(x, x) = 1 for all x.
   static const bool IsNormalized = true;
+  //! The spherical kernel can be evaluated on sets of points at once.
+  static const bool HasBatchEvaluate = true;
 };
 
 }; // namespace kernel
@@ -56,6 +56,22 @@ class TriangularKernel
     return std::max(0.0, (1 - distance) / bandwidth);
   }
 
+  /**
+   * Evaluate the triangular kernel between every point in a and every point in
+   * b, so that k(i, j) = K(a.col(i), b.col(j)).  The distances are computed
+   * with math::SquaredDistances().
+   *
+   * @param a First set of points.
+   * @param b Second set of points.
+   * @param k Matrix to store kernel values in (a.n_cols x b.n_cols).
+   */
+  void Evaluate(const arma::mat& a, const arma::mat& b, arma::mat& k) const
+  {
+    math::SquaredDistances(a, b, k);
+    k = 1.0 - arma::sqrt(k) / bandwidth;
+    k.elem(arma::find(k < 0.0)).zeros();
+  }
+
   //! Get the bandwidth of the kernel.
   double Bandwidth() const { return bandwidth; }
   //! Modify the bandwidth of the kernel.
@@ -82,6 +98,8 @@ class KernelTraits<TriangularKernel>
  public:
   //! The triangular kernel is normalized: K(x, x) = 1 for all x.
   static const bool IsNormalized = true;
+  //! The triangular kernel can be evaluated on sets of points at once.
+  static const bool HasBatchEvaluate = true;
 };
 
 }; // namespace kernel
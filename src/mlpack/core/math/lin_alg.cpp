@@ -42,6 +42,103 @@ void mlpack::math::Center(const arma::mat& x, arma::mat& xCentered)
   xCentered = x - arma::repmat(rowMean, 1, x.n_cols);
 }
 
+/**
+ * Computes the mean and the covariance matrix of the columns of a matrix in one
+ * blocked pass.
+ */
+void mlpack::math::Covariance(const arma::mat& x,
+                              arma::mat& covariance,
+                              arma::vec& mean,
+                              const size_t threads)
+{
+  const size_t d = x.n_rows;
+  const size_t n = x.n_cols;
+
+  covariance.zeros(d, d);
+  mean.zeros(d);
+  if (n == 0)
+    return;
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Each block is big enough for the product to be efficient.  The columns are
+  // split into contiguous parts (as many as util::ReductionBlocks() gives) of
+  // at least one block each, and the sums of the parts are added with
+  // util::TreeReduce(), so the result does not depend on the number of
+  // threads.
+  const size_t blockSize = std::max(d, (size_t) 1024);
+  const size_t parts = util::ReductionBlocks(n, blockSize);
+  const arma::vec shift = x.col(0);
+
+  std::vector<arma::mat> partOuterProducts(parts);
+  std::vector<arma::vec> partSums(parts);
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t p = 0; p < (omp_size_t) parts; ++p)
+  {
+    const size_t begin = (size_t) p * n / parts;
+    const size_t end = ((size_t) p + 1) * n / parts;
+
+    arma::mat& outerProduct = partOuterProducts[p];
+    outerProduct.zeros(d, d);
+    arma::vec sum = arma::zeros<arma::vec>(d);
+    for (size_t b = begin; b < end; b += blockSize)
+    {
+      arma::mat block = x.cols(b, std::min(b + blockSize, end) - 1);
+      block.each_col() -= shift;
+
+      sum += arma::sum(block, 1);
+      outerProduct += block * arma::trans(block);
+    }
+
+    partSums[p] = sum;
+  }
+
+  util::TreeReduce(partOuterProducts);
+  util::TreeReduce(partSums);
+  covariance.swap(partOuterProducts[0]);
+
+  // The sum of the centered outer products is the sum of the shifted outer
+  // products, minus N times the outer product of the shifted mean.
+  const arma::vec shiftedMean = partSums[0] / n;
+  covariance -= n * (shiftedMean * arma::trans(shiftedMean));
+  covariance /= (n > 1) ? (n - 1) : 1;
+
+  mean = shift + shiftedMean;
+}
+
+/**
+ * Multiply each point of x by the given matrix and write the result into
+ * output.  If output is x, the points are transformed in place, one block at a
+ * time, so that no second copy of the data is needed.
+ */
+static void TransformPoints(const arma::mat& matrix,
+                            const arma::mat& x,
+                            arma::mat& output)
+{
+  if (&output != &x)
+  {
+    output = matrix * x;
+    return;
+  }
+
+  const size_t blockSize = std::max((size_t) x.n_rows, (size_t) 1024);
+  const size_t blocks = (x.n_cols + blockSize - 1) / blockSize;
+
+  #pragma omp parallel for schedule(static)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+  {
+    const size_t begin = (size_t) b * blockSize;
+    const size_t end = std::min(begin + blockSize, (size_t) x.n_cols);
+    const arma::mat block = matrix * output.cols(begin, end - 1);
+    output.cols(begin, end - 1) = block;
+  }
+}
+
 /**
  * Whitens a matrix using the singular value decomposition of the covariance
  * matrix. Whitening means the covariance matrix of the result is the identity
@@ -51,10 +148,10 @@ void mlpack::math::WhitenUsingSVD(const arma::mat& x,
                                   arma::mat& xWhitened,
                                   arma::mat& whiteningMatrix)
 {
-  arma::mat covX, u, v, invSMatrix, temp1;
-  arma::vec sVector;
+  arma::mat covX, u, v, invSMatrix;
+  arma::vec sVector, mean;
 
-  covX = ccov(x);
+  Covariance(x, covX, mean);
 
   svd(u, sVector, v, covX);
 
@@ -64,7 +161,7 @@ void mlpack::math::WhitenUsingSVD(const arma::mat& x,
 
   whiteningMatrix = v * invSMatrix * trans(u);
 
-  xWhitened = whiteningMatrix * x;
+  TransformPoints(whiteningMatrix, x, xWhitened);
 }
 
 /**
@@ -75,11 +172,12 @@ void mlpack::math::WhitenUsingEig(const arma::mat& x,
                                   arma::mat& xWhitened,
                                   arma::mat& whiteningMatrix)
 {
-  arma::mat diag, eigenvectors;
-  arma::vec eigenvalues;
+  arma::mat covX, diag, eigenvectors;
+  arma::vec eigenvalues, mean;
 
   // Get eigenvectors of covariance of input matrix.
-  eig_sym(eigenvalues, eigenvectors, ccov(x));
+  Covariance(x, covX, mean);
+  eig_sym(eigenvalues, eigenvectors, covX);
 
   // Generate diagonal matrix using 1 / sqrt(eigenvalues) for each value.
   VectorPower(eigenvalues, -0.5);
@@ -90,7 +188,7 @@ void mlpack::math::WhitenUsingEig(const arma::mat& x,
   whiteningMatrix = diag * trans(eigenvectors);
 
   // Now apply the whitening matrix.
-  xWhitened = whiteningMatrix * x;
+  TransformPoints(whiteningMatrix, x, xWhitened);
 }
 
 /**
@@ -208,3 +306,18 @@ void mlpack::math::RemoveRows(const arma::mat& input,
     }
   }
 }
+
+void mlpack::math::SquaredDistances(const arma::mat& a,
+                                    const arma::mat& b,
+                                    arma::mat& distances)
+{
+  const arma::vec aNorms = arma::trans(arma::sum(arma::square(a), 0));
+  const arma::rowvec bNorms = arma::sum(arma::square(b), 0);
+
+  distances = -2.0 * arma::trans(a) * b;
+  distances.each_col() += aNorms;
+  distances.each_row() += bNorms;
+
+  // Rounding can make the squared distance of very close points negative.
+  distances.elem(arma::find(distances < 0.0)).zeros();
+}
@@ -31,10 +31,30 @@ void VectorPower(arma::vec& vec, const double power);
  */
 void Center(const arma::mat& x, arma::mat& xCentered);
 
+/**
+ * Computes the mean and the covariance matrix (normalized by N - 1, like
+ * ccov()) of the columns of a matrix in one pass, without forming a centered
+ * copy.  The points are taken in blocks, shifted by the first point, and the
+ * outer products and sums of the blocks are accumulated; the columns are split
+ * between threads, each of which keeps its own sums.  The shift keeps the
+ * result accurate when the mean is large compared to the spread of the data.
+ *
+ * @param x Input matrix (one point per column).
+ * @param covariance Matrix to write the covariance into.
+ * @param mean Vector to write the mean into.
+ * @param threads Number of threads to use (0 means all available cores).  This
+ *     has no effect if mlpack was compiled without OpenMP.
+ */
+void Covariance(const arma::mat& x,
+                arma::mat& covariance,
+                arma::vec& mean,
+                const size_t threads = 0);
+
 /**
  * Whitens a matrix using the singular value decomposition of the covariance
  * matrix. Whitening means the covariance matrix of the result is the identity
- * matrix.
+ * matrix.  xWhitened may be the same matrix as x, in which case the points are
+ * whitened in place, one block at a time.
  */
 void WhitenUsingSVD(const arma::mat& x,
                     arma::mat& xWhitened,
@@ -43,6 +63,8 @@ void WhitenUsingSVD(const arma::mat& x,
 /**
  * Whitens a matrix using the eigendecomposition of the covariance matrix.
  * Whitening means the covariance matrix of the result is the identity matrix.
+ * xWhitened may be the same matrix as x, in which case the points are whitened
+ * in place, one block at a time.
  */
 void WhitenUsingEig(const arma::mat& x,
                     arma::mat& xWhitened,
@@ -76,6 +98,20 @@ void RemoveRows(const arma::mat& input,
                 const std::vector<size_t>& rowsToRemove,
                 arma::mat& output);
 
+/**
+ * Compute the squared Euclidean distances between every point in a and every
+ * point in b, so that distances(i, j) = || a.col(i) - b.col(j) ||^2.  This uses
+ * ||a||^2 + ||b||^2 - 2 a^T b, so the bulk of the work is a single matrix
+ * multiplication.  Entries which rounding makes negative are set to zero.
+ *
+ * @param a First set of points.
+ * @param b Second set of points.
+ * @param distances Matrix to store distances in (a.n_cols x b.n_cols).
+ */
+void SquaredDistances(const arma::mat& a,
+                      const arma::mat& b,
+                      arma::mat& distances);
+
 }; // namespace math
 }; // namespace mlpack
 
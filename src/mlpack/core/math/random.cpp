@@ -3,8 +3,7 @@
  *
  * Declarations of global Boost random number generators.
  */
-#include <boost/random.hpp>
-#include <boost/version.hpp>
+#include "random.hpp"
 
 namespace mlpack {
 namespace math {
@@ -16,6 +15,9 @@ namespace math {
   boost::random::uniform_01<> randUniformDist;
   // Global normal distribution.
   boost::random::normal_distribution<> randNormalDist;
+
+  typedef boost::random::mt19937 ThreadGenerator;
+  typedef boost::random::normal_distribution<> ThreadNormalDistribution;
 #else
   // Global random object.
   boost::mt19937 randGen;
@@ -30,7 +32,77 @@ namespace math {
 
   // Global normal distribution.
   boost::normal_distribution<> randNormalDist;
+
+  typedef boost::mt19937 ThreadGenerator;
+  typedef boost::normal_distribution<> ThreadNormalDistribution;
 #endif
 
 }; // namespace math
 }; // namespace mlpack
+
+using namespace mlpack;
+using namespace mlpack::math;
+
+// The random objects of a single thread, and the seed they were made from.
+struct ThreadRandom
+{
+  ThreadGenerator generator;
+  ThreadNormalDistribution normalDist;
+  size_t seedGeneration;
+};
+
+// Each thread makes its own random objects the first time it needs them.  The
+// pointer is a void* because threadprivate variables must be plain old data.
+static void* threadRandom = NULL;
+#pragma omp threadprivate(threadRandom)
+
+// The seed that the random objects of each thread are derived from, and how
+// many times it has been set; a thread whose random objects were seeded before
+// the last call to ThreadRandomSeed() reseeds them.  The default seed is the
+// same as the default seed of mt19937.
+static size_t threadSeed = 5489;
+static size_t threadSeedGeneration = 0;
+
+static ThreadRandom& LocalRandom()
+{
+  ThreadRandom* local = static_cast<ThreadRandom*>(threadRandom);
+  if (local == NULL)
+  {
+    local = new ThreadRandom();
+    local->seedGeneration = threadSeedGeneration + 1;
+    threadRandom = local;
+  }
+
+  if (local->seedGeneration != threadSeedGeneration)
+  {
+#ifdef _OPENMP
+    const size_t thread = (size_t) omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+
+    // Spread the seeds of neighboring threads out, so that they are not close
+    // to the seeds that RandomSeed() would give the global random object.
+    local->generator.seed((uint32_t) (threadSeed + 0x9E3779B9 * (thread + 1)));
+    local->normalDist.reset();
+    local->seedGeneration = threadSeedGeneration;
+  }
+
+  return *local;
+}
+
+ThreadGenerator& mlpack::math::ThreadRandGen()
+{
+  return LocalRandom().generator;
+}
+
+ThreadNormalDistribution& mlpack::math::ThreadRandNormalDist()
+{
+  return LocalRandom().normalDist;
+}
+
+void mlpack::math::ThreadRandomSeed(const size_t seed)
+{
+  threadSeed = seed;
+  ++threadSeedGeneration;
+}
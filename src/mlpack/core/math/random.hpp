@@ -22,6 +22,11 @@ namespace math /** Miscellaneous math routines. */ {
   extern boost::random::uniform_01<> randUniformDist;
   // Global normal distribution.
   extern boost::random::normal_distribution<> randNormalDist;
+
+  // Random object of the calling thread, for use in parallel regions.
+  boost::random::mt19937& ThreadRandGen();
+  // Normal distribution of the calling thread, for use in parallel regions.
+  boost::random::normal_distribution<>& ThreadRandNormalDist();
 #else
   // Global random object.
   extern boost::mt19937 randGen;
@@ -36,18 +41,70 @@ namespace math /** Miscellaneous math routines. */ {
 
   // Global normal distribution.
   extern boost::normal_distribution<> randNormalDist;
+
+  // Random object of the calling thread, for use in parallel regions.
+  boost::mt19937& ThreadRandGen();
+  // Normal distribution of the calling thread, for use in parallel regions.
+  boost::normal_distribution<>& ThreadRandNormalDist();
+#endif
+
+/**
+ * Set the seed that the random objects of each thread are derived from.  This
+ * is called by RandomSeed(), and shouldn't be called inside a parallel region.
+ *
+ * @param seed Seed for the random number generators of each thread.
+ */
+void ThreadRandomSeed(const size_t seed);
+
+/**
+ * Get the random object to use on the calling thread.  Outside of a parallel
+ * region this is the global random object randGen.  Inside a parallel region,
+ * each thread has its own random object, which is seeded from the seed given
+ * to RandomSeed() and the index of the thread; so, for a given seed and number
+ * of threads, each thread draws the same numbers every time the program is
+ * run, as long as the work is split between the threads the same way.
+ */
+#if BOOST_VERSION >= 104700
+inline boost::random::mt19937& RandGen()
+#else
+inline boost::mt19937& RandGen()
 #endif
+{
+#ifdef _OPENMP
+  if (omp_in_parallel())
+    return ThreadRandGen();
+#endif
+  return randGen;
+}
+
+/**
+ * Get the normal distribution to use on the calling thread; see RandGen().
+ */
+#if BOOST_VERSION >= 104700
+inline boost::random::normal_distribution<>& RandNormalDist()
+#else
+inline boost::normal_distribution<>& RandNormalDist()
+#endif
+{
+#ifdef _OPENMP
+  if (omp_in_parallel())
+    return ThreadRandNormalDist();
+#endif
+  return randNormalDist;
+}
 
 /**
  * Set the random seed used by the random functions (Random() and RandInt()).
  * The seed is casted to a 32-bit integer before being given to the random
  * number generator, but a size_t is taken as a parameter for API consistency.
+ * The random objects used by each thread in parallel regions are reseeded too.
  *
  * @param seed Seed for the random number generator.
  */
 inline void RandomSeed(const size_t seed)
 {
   randGen.seed((uint32_t) seed);
+  ThreadRandomSeed(seed);
   srand((unsigned int) seed);
 #if ARMA_VERSION_MAJOR > 3 || \
     (ARMA_VERSION_MAJOR == 3 && ARMA_VERSION_MINOR >= 930)
@@ -63,7 +120,7 @@ inline void RandomSeed(const size_t seed)
 inline double Random()
 {
 #if BOOST_VERSION >= 103900
-  return randUniformDist(randGen);
+  return randUniformDist(RandGen());
 #else
   // Before Boost 1.39, we did not give the random object when we wanted a
   // random number; that gets given at construction time.
@@ -77,7 +134,7 @@ inline double Random()
 inline double Random(const double lo, const double hi)
 {
 #if BOOST_VERSION >= 103900
-  return lo + (hi - lo) * randUniformDist(randGen);
+  return lo + (hi - lo) * randUniformDist(RandGen());
 #else
   // Before Boost 1.39, we did not give the random object when we wanted a
   // random number; that gets given at construction time.
@@ -91,7 +148,7 @@ inline double Random(const double lo, const double hi)
 inline int RandInt(const int hiExclusive)
 {
 #if BOOST_VERSION >= 103900
-  return (int) std::floor((double) hiExclusive * randUniformDist(randGen));
+  return (int) std::floor((double) hiExclusive * randUniformDist(RandGen()));
 #else
   // Before Boost 1.39, we did not give the random object when we wanted a
   // random number; that gets given at construction time.
@@ -106,7 +163,7 @@ inline int RandInt(const int lo, const int hiExclusive)
 {
 #if BOOST_VERSION >= 103900
   return lo + (int) std::floor((double) (hiExclusive - lo)
-                               * randUniformDist(randGen));
+                               * randUniformDist(RandGen()));
 #else
   // Before Boost 1.39, we did not give the random object when we wanted a
   // random number; that gets given at construction time.
@@ -121,7 +178,7 @@ inline int RandInt(const int lo, const int hiExclusive)
  */
 inline double RandNormal()
 {
-  return randNormalDist(randGen);
+  return RandNormalDist()(RandGen());
 }
 
 /**
@@ -133,7 +190,7 @@ inline double RandNormal()
  */
 inline double RandNormal(const double mean, const double variance)
 {
-  return variance * randNormalDist(randGen) + mean;
+  return variance * RandNormalDist()(RandGen()) + mean;
 }
 
 }; // namespace math
@@ -0,0 +1,87 @@
+/**
+ * @file fixed_lmetric.hpp
+ *
+ * An L-metric for points of a dimensionality known at compile time.
+ */
+#ifndef __MLPACK_CORE_METRICS_FIXED_LMETRIC_HPP
+#define __MLPACK_CORE_METRICS_FIXED_LMETRIC_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace metric {
+
+/**
+ * The L_p metric for points whose dimensionality is known at compile time.
+ * This gives the same distances as LMetric<Power, TakeRoot>, but the
+ * loop over the dimensions has a constant trip count, so for low-dimensional
+ * data (such as 2-D or 3-D spatial data) the compiler unrolls it completely,
+ * and no temporaries are created.  The points themselves may be of any
+ * Armadillo vector type (such as columns of an arma::mat) and must have
+ * Dimensionality elements; this is only checked in debug mode.
+ *
+ * To build trees which use this metric, use FixedHRectBound<Dimensionality,
+ * Power, TakeRoot> as the bound type.
+ *
+ * @tparam Dimensionality Dimensionality of the points.
+ * @tparam Power Power of metric; i.e. Power = 1 gives the L1-norm (Manhattan
+ *    distance), and INT_MAX gives the L-infinity norm.
+ * @tparam TakeRoot If true, the Power'th root of the result is taken before it
+ *    is returned (see LMetric).
+ */
+template<size_t Dimensionality, int Power = 2, bool TakeRoot = true>
+class FixedLMetric
+{
+ public:
+  /***
+   * Default constructor does nothing, but is required to satisfy the Kernel
+   * policy.
+   */
+  FixedLMetric() { }
+
+  /**
+   * Computes the distance between two points.
+   */
+  template<typename VecType1, typename VecType2>
+  static double Evaluate(const VecType1& a, const VecType2& b)
+  {
+    Log::Assert((a.n_elem == Dimensionality) && (b.n_elem == Dimensionality));
+
+    // All of these conditions are resolved at compile time.
+    double sum = 0;
+    for (size_t i = 0; i < Dimensionality; ++i)
+    {
+      const double diff = fabs(a[i] - b[i]);
+      if (Power == 1)
+        sum += diff;
+      else if (Power == 2)
+        sum += diff * diff;
+      else if (Power == INT_MAX)
+        sum = std::max(sum, diff);
+      else
+        sum += pow(diff, (double) Power);
+    }
+
+    if (!TakeRoot || Power == 1 || Power == INT_MAX)
+      return sum;
+    else if (Power == 2)
+      return sqrt(sum);
+    else
+      return pow(sum, 1.0 / (double) Power);
+  }
+
+  std::string ToString() const
+  {
+    std::ostringstream convert;
+    convert << "FixedLMetric [" << this << "]" << std::endl;
+    convert << "  Dimensionality: " << Dimensionality << std::endl;
+    convert << "  Power: " << Power << std::endl;
+    convert << "  TakeRoot: " << (TakeRoot ? "true" : "false") << std::endl;
+    return convert.str();
+  }
+};
+
+}; // namespace metric
+}; // namespace mlpack
+
+#endif
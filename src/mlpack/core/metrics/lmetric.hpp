@@ -69,6 +69,39 @@ class LMetric
    */
   template<typename VecType1, typename VecType2>
   static double Evaluate(const VecType1& a, const VecType2& b);
+
+  /**
+   * Computes the distance between two points, but gives up as soon as it is
+   * clear that the distance is greater than the given bound.  The terms of the
+   * sum are added in blocks of EarlyAbandonBlockSize dimensions, and after each
+   * block the partial sum is compared with the bound; the partial sum can only
+   * grow, so once it is past the bound, so is the distance.  This saves time
+   * when most distances are past the bound, as when checking candidates for
+   * the nearest neighbors of a point, which only need to be better than the
+   * k'th best candidate so far.
+   *
+   * If the distance is not greater than the bound, it is returned exactly as
+   * Evaluate() gives it.  Otherwise, the returned value is greater than the
+   * bound but may be less than the distance.  Points with fewer than two
+   * blocks of dimensions are not worth the checks and are passed straight to
+   * Evaluate(), as is anything with a bound of DBL_MAX.
+   *
+   * The elements of the points are accessed one by one, so this should only be
+   * used with dense vectors.
+   *
+   * @param a First point.
+   * @param b Second point.
+   * @param bound Bound on the distance, in the same units as Evaluate().
+   */
+  template<typename VecType1, typename VecType2>
+  static double EvaluateBounded(const VecType1& a,
+                                const VecType2& b,
+                                const double bound);
+
+  //! The number of dimensions added up between checks of the bound in
+  //! EvaluateBounded().
+  static const size_t EarlyAbandonBlockSize = 16;
+
   std::string ToString() const;
 };
 
@@ -29,6 +29,55 @@ double LMetric<Power, TakeRoot>::Evaluate(const VecType1& a,
   return pow(sum, (1.0 / Power));
 }
 
+template<int Power, bool TakeRoot>
+const size_t LMetric<Power, TakeRoot>::EarlyAbandonBlockSize;
+
+template<int Power, bool TakeRoot>
+template<typename VecType1, typename VecType2>
+double LMetric<Power, TakeRoot>::EvaluateBounded(const VecType1& a,
+                                                 const VecType2& b,
+                                                 const double bound)
+{
+  const size_t blockSize = EarlyAbandonBlockSize;
+  if (bound == DBL_MAX || a.n_elem < 2 * blockSize)
+    return Evaluate(a, b);
+
+  // The bound on the partial sum, which is the sum of the powers of the
+  // differences (or the largest difference, for the L-infinity distance).
+  double sumBound = bound;
+  if (TakeRoot && Power != 1 && Power != INT_MAX)
+    sumBound = (Power == 2) ? (bound * bound) : pow(bound, Power);
+
+  double sum = 0;
+  for (size_t begin = 0; begin < a.n_elem; begin += blockSize)
+  {
+    const size_t end = std::min(begin + blockSize, (size_t) a.n_elem);
+    for (size_t i = begin; i < end; ++i)
+    {
+      const double diff = fabs(a[i] - b[i]);
+      if (Power == 1)
+        sum += diff;
+      else if (Power == 2)
+        sum += diff * diff;
+      else if (Power == INT_MAX)
+        sum = std::max(sum, diff);
+      else
+        sum += pow(diff, Power);
+    }
+
+    if (sum > sumBound)
+    {
+      if (!TakeRoot || Power == 1 || Power == INT_MAX)
+        return sum;
+      return (Power == 2) ? sqrt(sum) : pow(sum, 1.0 / Power);
+    }
+  }
+
+  // The distance is within the bound.  It is computed again by Evaluate(), so
+  // that the result does not depend on the order of the sum.
+  return Evaluate(a, b);
+}
+
 // String conversion.
 template<int Power, bool TakeRoot>
 std::string LMetric<Power, TakeRoot>::ToString() const
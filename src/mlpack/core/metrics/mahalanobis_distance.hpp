@@ -27,8 +27,15 @@ namespace metric {
  *
  * Because each evaluation multiplies (x_1 - x_2) by the covariance matrix, it
  * may be much quicker to use an LMetric and simply stretch the actual dataset
- * itself before performing any evaluations.  However, this class is provided
- * for convenience.
+ * itself before performing any evaluations.  Transform() does this: it factors
+ * the covariance matrix as @f$ Q = L^T L @f$ once and maps each point x to Lx,
+ * so that d(x, y) is the Euclidean distance between Lx and Ly, which takes
+ * O(d) time to evaluate instead of O(d^2).  This is the way to search with a
+ * metric learned by NCA; neighbor::BuildMahalanobisTree() builds a tree on the
+ * transformed points.  If the distance is only evaluated a few times, this
+ * class is provided for convenience, and the batch version of Evaluate() does
+ * the evaluations between one point and many points as a single matrix
+ * product.
  *
  * Similar to the LMetric class, this offers a template parameter TakeRoot
  * which, when set to false, will instead evaluate the distance
@@ -86,6 +93,45 @@ class MahalanobisDistance
   template<typename VecType1, typename VecType2>
   double Evaluate(const VecType1& a, const VecType2& b);
 
+  /**
+   * Evaluate the distance between the given point and each of the given
+   * points.  The differences are multiplied by the covariance matrix all at
+   * once, which is much faster than calling Evaluate() for each point.
+   *
+   * @param a Point to evaluate distances from.
+   * @param points Points to evaluate distances to (one per column).
+   * @param distances Vector to store the distance to each point in.
+   */
+  template<typename VecType>
+  void Evaluate(const VecType& a,
+                const arma::mat& points,
+                arma::rowvec& distances);
+
+  /**
+   * Factor the covariance matrix as @f$ Q = L^T L @f$.  Only the symmetric part
+   * of the covariance matrix affects the distance, so that is what is factored.
+   * This uses the Cholesky decomposition if that part is positive definite,
+   * and otherwise the eigendecomposition (ignoring any negative eigenvalues,
+   * which should only come from roundoff).  If the covariance matrix has not
+   * been set, the transformation is empty.
+   *
+   * @param transformation Matrix to store L in.
+   */
+  void Decompose(arma::mat& transformation) const;
+
+  /**
+   * Map each point x of the given dataset to Lx, where @f$ Q = L^T L @f$ (see
+   * Decompose()), so that the Euclidean distance between two transformed
+   * points is this Mahalanobis distance between the original points (or its
+   * square, if TakeRoot is false).  This takes O(d^3 + d^2 n) time for n
+   * points.  If the covariance matrix has not been set, it is taken to be the
+   * identity and the dataset is copied.
+   *
+   * @param data Dataset to transform.
+   * @param transformed Matrix to store the transformed dataset in.
+   */
+  void Transform(const arma::mat& data, arma::mat& transformed) const;
+
   /**
    * Access the covariance matrix.
    *
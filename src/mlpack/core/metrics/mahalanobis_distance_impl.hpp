@@ -42,6 +42,68 @@ double MahalanobisDistance<true>::Evaluate(const VecType1& a,
   return sqrt(out[0]);
 }
 
+template<bool TakeRoot>
+template<typename VecType>
+void MahalanobisDistance<TakeRoot>::Evaluate(const VecType& a,
+                                             const arma::mat& points,
+                                             arma::rowvec& distances)
+{
+  // Check if covariance matrix has been initialized.
+  if (covariance.n_rows == 0)
+    covariance = arma::eye<arma::mat>(a.n_elem, a.n_elem);
+
+  arma::mat m = points;
+  m.each_col() -= a;
+  distances = arma::sum((covariance * m) % m, 0);
+
+  if (TakeRoot)
+  {
+    // Roundoff can make the distance to an identical point slightly negative.
+    distances.elem(arma::find(distances < 0.0)).zeros();
+    distances = arma::sqrt(distances);
+  }
+}
+
+template<bool TakeRoot>
+void MahalanobisDistance<TakeRoot>::Decompose(arma::mat& transformation) const
+{
+  if (covariance.n_elem == 0)
+  {
+    transformation.reset();
+    return;
+  }
+
+  // chol() gives an upper triangular R with R^T R = Q.
+  const arma::mat symmetric = 0.5 * (covariance + trans(covariance));
+  if (arma::chol(transformation, symmetric))
+    return;
+
+  // The covariance is only positive semidefinite, so Q = V D V^T gives
+  // L = D^(1/2) V^T.
+  arma::vec eigenvalues;
+  arma::mat eigenvectors;
+  arma::eig_sym(eigenvalues, eigenvectors, symmetric);
+  eigenvalues.elem(arma::find(eigenvalues < 0.0)).zeros();
+
+  transformation = arma::diagmat(arma::sqrt(eigenvalues)) *
+      trans(eigenvectors);
+}
+
+template<bool TakeRoot>
+void MahalanobisDistance<TakeRoot>::Transform(const arma::mat& data,
+                                              arma::mat& transformed) const
+{
+  if (covariance.n_rows == 0)
+  {
+    transformed = data;
+    return;
+  }
+
+  arma::mat transformation;
+  Decompose(transformation);
+  transformed = transformation * data;
+}
+
 // Convert object into string.
 template<bool TakeRoot>
 std::string MahalanobisDistance<TakeRoot>::ToString() const
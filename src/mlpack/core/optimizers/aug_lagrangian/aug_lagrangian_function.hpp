@@ -8,6 +8,8 @@
 #define __MLPACK_CORE_OPTIMIZERS_AUG_LAGRANGIAN_AUG_LAGRANGIAN_FUNCTION_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/lbfgs/evaluate_with_gradient.hpp>
+#include "evaluate_constraints.hpp"
 
 namespace mlpack {
 namespace optimization {
@@ -27,6 +29,21 @@ namespace optimization {
  * of the methods (unfortunately, C++ specialization rules mean you have to
  * re-implement everything).
  *
+ * If the LagrangianFunction has the optional batch methods
+ *
+ * - void EvaluateConstraints(const arma::mat& coordinates,
+ *                            arma::vec& constraints);
+ * - void GradientConstraints(const arma::mat& coordinates,
+ *                            const arma::vec& weights,
+ *                            arma::mat& gradient);
+ *
+ * they are used instead of calling EvaluateConstraint() and
+ * GradientConstraint() for each constraint.  EvaluateConstraints() should store
+ * every constraint value in the given vector, and GradientConstraints() should
+ * add the sum of the constraint gradients, each multiplied by its weight, to
+ * the given gradient.  These let problems with very many constraints evaluate
+ * them in parallel and without a temporary gradient for each constraint.
+ *
  * @tparam LagrangianFunction Lagrangian function to be used.
  */
 template<typename LagrangianFunction>
@@ -71,6 +88,18 @@ class AugLagrangianFunction
    */
   void Gradient(const arma::mat& coordinates, arma::mat& gradient) const;
 
+  /**
+   * Evaluate both the objective function and the gradient of the Augmented
+   * Lagrangian function.  Each constraint is only evaluated once, and the
+   * Lagrangian function's own EvaluateWithGradient() is used if it has one.
+   *
+   * @param coordinates Coordinates to evaluate function and gradient at.
+   * @param gradient Matrix to store gradient into.
+   * @return Objective function.
+   */
+  double EvaluateWithGradient(const arma::mat& coordinates,
+                              arma::mat& gradient) const;
+
   /**
    * Get the initial point of the optimization (supplied by the
    * LagrangianFunction).
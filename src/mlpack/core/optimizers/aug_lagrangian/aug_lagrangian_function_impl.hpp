@@ -51,13 +51,13 @@ double AugLagrangianFunction<LagrangianFunction>::Evaluate(
   // First get the function's objective value.
   double objective = function.Evaluate(coordinates);
 
-  // Now loop for each constraint.
-  for (size_t i = 0; i < function.NumConstraints(); ++i)
+  // Now add the terms for each constraint.
+  arma::vec constraints;
+  EvaluateConstraints(function, coordinates, constraints);
+  for (size_t i = 0; i < constraints.n_elem; ++i)
   {
-    double constraint = function.EvaluateConstraint(i, coordinates);
-
-    objective += (-lambda[i] * constraint) +
-        sigma * std::pow(constraint, 2) / 2;
+    objective += (-lambda[i] * constraints[i]) +
+        sigma * std::pow(constraints[i], 2) / 2;
   }
 
   return objective;
@@ -74,17 +74,37 @@ void AugLagrangianFunction<LagrangianFunction>::Gradient(
   gradient.zeros();
   function.Gradient(coordinates, gradient);
 
-  arma::mat constraintGradient; // Temporary for constraint gradients.
-  for (size_t i = 0; i < function.NumConstraints(); i++)
-  {
-    function.GradientConstraint(i, coordinates, constraintGradient);
+  arma::vec constraints;
+  EvaluateConstraints(function, coordinates, constraints);
+  const arma::vec weights = -lambda + sigma * constraints;
+  GradientConstraints(function, coordinates, weights, gradient);
+}
 
-    // Now calculate scaling factor and add to existing gradient.
-    arma::mat tmpGradient;
-    tmpGradient = (-lambda[i] + sigma *
-        function.EvaluateConstraint(i, coordinates)) * constraintGradient;
-    gradient += tmpGradient;
+// Evaluate the AugLagrangianFunction and its gradient at the given
+// coordinates.
+template<typename LagrangianFunction>
+double AugLagrangianFunction<LagrangianFunction>::EvaluateWithGradient(
+    const arma::mat& coordinates,
+    arma::mat& gradient) const
+{
+  // This is Evaluate() and Gradient() together, with each c_i(x) computed
+  // only once.
+  gradient.zeros(coordinates.n_rows, coordinates.n_cols);
+  double objective = optimization::EvaluateWithGradient(function, coordinates,
+      gradient);
+
+  arma::vec constraints;
+  EvaluateConstraints(function, coordinates, constraints);
+  for (size_t i = 0; i < constraints.n_elem; ++i)
+  {
+    objective += (-lambda[i] * constraints[i]) +
+        sigma * std::pow(constraints[i], 2) / 2;
   }
+
+  const arma::vec weights = -lambda + sigma * constraints;
+  GradientConstraints(function, coordinates, weights, gradient);
+
+  return objective;
 }
 
 // Get the initial point.
@@ -73,9 +73,9 @@ bool AugLagrangian<LagrangianFunction>::Optimize(arma::mat& coordinates,
   double lastObjective = function.Evaluate(coordinates);
 
   // Then, calculate the current penalty.
-  double penalty = 0;
-  for (size_t i = 0; i < function.NumConstraints(); i++)
-    penalty += std::pow(function.EvaluateConstraint(i, coordinates), 2);
+  arma::vec constraints;
+  EvaluateConstraints(function, coordinates, constraints);
+  double penalty = dot(constraints, constraints);
 
   Log::Debug << "Penalty is " << penalty << " (threshold " << penaltyThreshold
       << ")." << std::endl;
@@ -108,14 +108,10 @@ bool AugLagrangian<LagrangianFunction>::Optimize(arma::mat& coordinates,
     // we now update either lambda or sigma.  We update sigma if the penalty
     // term is too high, and we update lambda otherwise.
 
-    // First, calculate the current penalty.
-    double penalty = 0;
-    for (size_t i = 0; i < function.NumConstraints(); i++)
-    {
-      penalty += std::pow(function.EvaluateConstraint(i, coordinates), 2);
-//      Log::Debug << "Constraint " << i << " is " <<
-//          function.EvaluateConstraint(i, coordinates) << std::endl;
-    }
+    // First, calculate the current penalty.  The constraints are kept for the
+    // update of lambda.
+    EvaluateConstraints(function, coordinates, constraints);
+    double penalty = dot(constraints, constraints);
 
     Log::Warn << "Penalty is " << penalty << " (threshold "
         << penaltyThreshold << ")." << std::endl;
@@ -130,11 +126,8 @@ bool AugLagrangian<LagrangianFunction>::Optimize(arma::mat& coordinates,
 
     if (penalty < penaltyThreshold) // We update lambda.
     {
-      // We use the update: lambda_{k + 1} = lambda_k - sigma * c(coordinates),
-      // but we have to write a loop to do this for each constraint.
-      for (size_t i = 0; i < function.NumConstraints(); i++)
-        augfunc.Lambda()[i] -= augfunc.Sigma() *
-            function.EvaluateConstraint(i, coordinates);
+      // We use the update: lambda_{k + 1} = lambda_k - sigma * c(coordinates).
+      augfunc.Lambda() -= augfunc.Sigma() * constraints;
 
       // We also update the penalty threshold to be a factor of the current
       // penalty.  TODO: this factor should be a parameter (from CLI).  The
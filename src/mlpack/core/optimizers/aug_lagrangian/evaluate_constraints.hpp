@@ -0,0 +1,112 @@
+/**
+ * @file evaluate_constraints.hpp
+ *
+ * Evaluate all the constraints of a Lagrangian function, or the weighted sum of
+ * their gradients, with a single call if the function supports it.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_AUG_LAGRANGIAN_EVALUATE_CONSTRAINTS_HPP
+#define __MLPACK_CORE_OPTIMIZERS_AUG_LAGRANGIAN_EVALUATE_CONSTRAINTS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+HAS_MEM_FUNC(EvaluateConstraints, HasEvaluateConstraintsCheck);
+HAS_MEM_FUNC(GradientConstraints, HasGradientConstraintsCheck);
+
+//! Whether or not the given function type has an EvaluateConstraints() (const
+//! or not).
+template<typename FunctionType>
+struct HasEvaluateConstraints
+{
+  static const bool value =
+      HasEvaluateConstraintsCheck<FunctionType, void (FunctionType::*)(
+          const arma::mat&, arma::vec&) const>::value ||
+      HasEvaluateConstraintsCheck<FunctionType, void (FunctionType::*)(
+          const arma::mat&, arma::vec&)>::value;
+};
+
+//! Whether or not the given function type has a GradientConstraints() (const
+//! or not).
+template<typename FunctionType>
+struct HasGradientConstraints
+{
+  static const bool value =
+      HasGradientConstraintsCheck<FunctionType, void (FunctionType::*)(
+          const arma::mat&, const arma::vec&, arma::mat&) const>::value ||
+      HasGradientConstraintsCheck<FunctionType, void (FunctionType::*)(
+          const arma::mat&, const arma::vec&, arma::mat&)>::value;
+};
+
+/**
+ * Evaluate every constraint of the function at the given coordinates, storing
+ * constraint i in constraints[i].  This calls function.EvaluateConstraints(),
+ * which can evaluate the constraints together (for instance, in parallel).
+ */
+template<typename FunctionType>
+inline typename boost::enable_if_c<
+    HasEvaluateConstraints<FunctionType>::value>::type
+EvaluateConstraints(FunctionType& function,
+                    const arma::mat& coordinates,
+                    arma::vec& constraints)
+{
+  function.EvaluateConstraints(coordinates, constraints);
+}
+
+//! For functions without EvaluateConstraints(), call EvaluateConstraint() for
+//! each constraint.
+template<typename FunctionType>
+inline typename boost::disable_if_c<
+    HasEvaluateConstraints<FunctionType>::value>::type
+EvaluateConstraints(FunctionType& function,
+                    const arma::mat& coordinates,
+                    arma::vec& constraints)
+{
+  constraints.set_size(function.NumConstraints());
+  for (size_t i = 0; i < function.NumConstraints(); ++i)
+    constraints[i] = function.EvaluateConstraint(i, coordinates);
+}
+
+/**
+ * Add the sum of the gradients of the constraints of the function at the given
+ * coordinates, with the gradient of constraint i weighted by weights[i], to the
+ * given gradient.  This calls function.GradientConstraints(), which can
+ * accumulate the gradients without a temporary for each constraint.
+ */
+template<typename FunctionType>
+inline typename boost::enable_if_c<
+    HasGradientConstraints<FunctionType>::value>::type
+GradientConstraints(FunctionType& function,
+                    const arma::mat& coordinates,
+                    const arma::vec& weights,
+                    arma::mat& gradient)
+{
+  function.GradientConstraints(coordinates, weights, gradient);
+}
+
+//! For functions without GradientConstraints(), call GradientConstraint() for
+//! each constraint with a nonzero weight, reusing one temporary.
+template<typename FunctionType>
+inline typename boost::disable_if_c<
+    HasGradientConstraints<FunctionType>::value>::type
+GradientConstraints(FunctionType& function,
+                    const arma::mat& coordinates,
+                    const arma::vec& weights,
+                    arma::mat& gradient)
+{
+  arma::mat constraintGradient;
+  for (size_t i = 0; i < function.NumConstraints(); ++i)
+  {
+    if (weights[i] == 0.0)
+      continue;
+
+    function.GradientConstraint(i, coordinates, constraintGradient);
+    gradient += weights[i] * constraintGradient;
+  }
+}
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
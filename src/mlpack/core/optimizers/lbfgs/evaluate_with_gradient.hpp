@@ -0,0 +1,62 @@
+/**
+ * @file evaluate_with_gradient.hpp
+ *
+ * Evaluate a function and its gradient at the same point, with a single call
+ * to EvaluateWithGradient() if the function has one.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_LBFGS_EVALUATE_WITH_GRADIENT_HPP
+#define __MLPACK_CORE_OPTIMIZERS_LBFGS_EVALUATE_WITH_GRADIENT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+HAS_MEM_FUNC(EvaluateWithGradient, HasEvaluateWithGradientCheck);
+
+//! Whether or not the given function type has an EvaluateWithGradient() (const
+//! or not).
+template<typename FunctionType>
+struct HasEvaluateWithGradient
+{
+  static const bool value =
+      HasEvaluateWithGradientCheck<FunctionType, double (FunctionType::*)(
+          const arma::mat&, arma::mat&) const>::value ||
+      HasEvaluateWithGradientCheck<FunctionType, double (FunctionType::*)(
+          const arma::mat&, arma::mat&)>::value;
+};
+
+/**
+ * Evaluate the function at the given coordinates, store its gradient there in
+ * the given matrix, and return the objective.  This calls
+ * function.EvaluateWithGradient(), which can share the work common to the
+ * objective and the gradient.
+ */
+template<typename FunctionType>
+inline typename boost::enable_if_c<
+    HasEvaluateWithGradient<FunctionType>::value, double>::type
+EvaluateWithGradient(FunctionType& function,
+                     const arma::mat& coordinates,
+                     arma::mat& gradient)
+{
+  return function.EvaluateWithGradient(coordinates, gradient);
+}
+
+//! For functions without EvaluateWithGradient(), call Evaluate() and then
+//! Gradient().
+template<typename FunctionType>
+inline typename boost::disable_if_c<
+    HasEvaluateWithGradient<FunctionType>::value, double>::type
+EvaluateWithGradient(FunctionType& function,
+                     const arma::mat& coordinates,
+                     arma::mat& gradient)
+{
+  const double objective = function.Evaluate(coordinates);
+  function.Gradient(coordinates, gradient);
+  return objective;
+}
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
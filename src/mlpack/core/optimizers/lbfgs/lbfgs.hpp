@@ -10,6 +10,8 @@
 
 #include <mlpack/core.hpp>
 
+#include "evaluate_with_gradient.hpp"
+
 namespace mlpack {
 namespace optimization {
 
@@ -24,6 +26,20 @@ namespace optimization {
  *  - double Evaluate(const arma::mat& coordinates);
  *  - void Gradient(const arma::mat& coordinates, arma::mat& gradient);
  *  - arma::mat& GetInitialPoint();
+ *
+ * If the function also implements
+ *
+ *  - double EvaluateWithGradient(const arma::mat& coordinates,
+ *                                arma::mat& gradient);
+ *
+ * which returns the objective and stores the gradient at the same point, then
+ * that is called instead of Evaluate() and Gradient(), so that any work common
+ * to the two is only done once.
+ *
+ * For expensive functions, the line search can evaluate several step sizes at
+ * once; see LineSearchThreads().  In that case the function's Evaluate() and
+ * Gradient() (or EvaluateWithGradient()) must be safe to call from several
+ * threads at once.
  */
 template<typename FunctionType>
 class L_BFGS
@@ -139,6 +155,18 @@ class L_BFGS
   //! Modify the maximum line search step size.
   double& MaxStep() { return maxStep; }
 
+  /**
+   * Get the number of step sizes the line search evaluates at once.  If this
+   * is larger than 1, then whenever the line search needs the function at a
+   * step size it has not yet evaluated, it evaluates that step size and the
+   * next smaller ones it would try if each of them were too long, in parallel.
+   * The step size that is chosen is the same as with the sequential search, but
+   * some evaluations may be wasted.  The default is 1.
+   */
+  size_t LineSearchThreads() const { return lineSearchThreads; }
+  //! Modify the number of step sizes the line search evaluates at once.
+  size_t& LineSearchThreads() { return lineSearchThreads; }
+
   // convert the obkect into a string
   std::string ToString() const;
 
@@ -169,17 +197,49 @@ class L_BFGS
   double minStep;
   //! Maximum step of the line search.
   double maxStep;
+  //! Number of step sizes the line search evaluates at once.
+  size_t lineSearchThreads;
+
+  //! Step sizes of the candidate points evaluated at once by the line search.
+  std::vector<double> batchSteps;
+  //! Candidate points evaluated at once by the line search.
+  std::vector<arma::mat> batchIterates;
+  //! Gradients at the candidate points.
+  std::vector<arma::mat> batchGradients;
+  //! Function values at the candidate points.
+  std::vector<double> batchValues;
 
   //! Best point found so far.
   std::pair<arma::mat, double> minPointIterate;
 
   /**
-   * Evaluate the function at the given iterate point and store the result if it
-   * is a new minimum.
+   * Evaluate the function and its gradient at the given iterate point, and
+   * store the result if it is a new minimum.
    *
+   * @param iterate Point to evaluate the function at.
+   * @param gradient Matrix to store the gradient in.
    * @return The value of the function.
    */
-  double Evaluate(const arma::mat& iterate);
+  double EvaluateWithGradient(const arma::mat& iterate, arma::mat& gradient);
+
+  /**
+   * Evaluate the function and its gradient in parallel at the given number of
+   * points along the search direction, with step sizes stepSize,
+   * stepSize * dec, stepSize * dec^2, and so on.  The points and the results
+   * are stored in batchSteps, batchIterates, batchGradients and batchValues,
+   * and the best point is stored if it is a new minimum.
+   *
+   * @param iterate Point the line search starts from.
+   * @param searchDirection Direction of the line search.
+   * @param stepSize Largest step size to evaluate.
+   * @param dec Factor between consecutive step sizes.
+   * @param count Number of points to evaluate.
+   */
+  void EvaluateBatch(const arma::mat& iterate,
+                     const arma::mat& searchDirection,
+                     const double stepSize,
+                     const double dec,
+                     const size_t count);
 
   /**
    * Calculate the scaling factor, gamma, which is used to scale the Hessian
@@ -45,7 +45,8 @@ L_BFGS<FunctionType>::L_BFGS(FunctionType& function,
     minGradientNorm(minGradientNorm),
     maxLineSearchTrials(maxLineSearchTrials),
     minStep(minStep),
-    maxStep(maxStep)
+    maxStep(maxStep),
+    lineSearchThreads(1)
 {
   // Get the dimensions of the coordinates of the function; GetInitialPoint()
   // might return an arma::vec, but that's okay because then n_cols will simply
@@ -63,17 +64,19 @@ L_BFGS<FunctionType>::L_BFGS(FunctionType& function,
 }
 
 /**
- * Evaluate the function at the given iterate point and store the result if
- * it is a new minimum.
+ * Evaluate the function and its gradient at the given iterate point and store
+ * the result if it is a new minimum.
  *
  * @return The value of the function
  */
 template<typename FunctionType>
-double L_BFGS<FunctionType>::Evaluate(const arma::mat& iterate)
+double L_BFGS<FunctionType>::EvaluateWithGradient(const arma::mat& iterate,
+                                                  arma::mat& gradient)
 {
   // Evaluate the function and keep track of the minimum function
   // value encountered during the optimization.
-  double functionValue = function.Evaluate(iterate);
+  double functionValue = optimization::EvaluateWithGradient(function, iterate,
+      gradient);
 
   if (functionValue < minPointIterate.second)
   {
@@ -84,6 +87,49 @@ double L_BFGS<FunctionType>::Evaluate(const arma::mat& iterate)
   return functionValue;
 }
 
+/**
+ * Evaluate the function and its gradient at several points along the search
+ * direction in parallel, and store the best point if it is a new minimum.
+ */
+template<typename FunctionType>
+void L_BFGS<FunctionType>::EvaluateBatch(const arma::mat& iterate,
+                                         const arma::mat& searchDirection,
+                                         const double stepSize,
+                                         const double dec,
+                                         const size_t count)
+{
+  batchSteps.resize(count);
+  batchIterates.resize(count);
+  batchGradients.resize(count);
+  batchValues.resize(count);
+
+  // The step sizes are found the same way the line search finds them, so that
+  // they compare equal to the ones it asks for.
+  batchSteps[0] = stepSize;
+  for (size_t i = 1; i < count; ++i)
+    batchSteps[i] = batchSteps[i - 1] * dec;
+
+  #pragma omp parallel for num_threads(count) schedule(static, 1)
+  for (omp_size_t i = 0; i < (omp_size_t) count; ++i)
+  {
+    batchIterates[i] = iterate;
+    batchIterates[i] += batchSteps[i] * searchDirection;
+    batchValues[i] = optimization::EvaluateWithGradient(function,
+        batchIterates[i], batchGradients[i]);
+  }
+
+  // Keep track of the minimum function value encountered during the
+  // optimization.
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (batchValues[i] < minPointIterate.second)
+    {
+      minPointIterate.first = batchIterates[i];
+      minPointIterate.second = batchValues[i];
+    }
+  }
+}
+
 /**
  * Calculate the scaling factor gamma which is used to scale the Hessian
  * approximation matrix.  See method M3 in Section 4 of Liu and Nocedal (1989).
@@ -174,14 +220,40 @@ bool L_BFGS<FunctionType>::LineSearch(double& functionValue,
   const double dec = 0.5;
   double width = 0;
 
+  // The next candidate point from the last batch of points evaluated in
+  // parallel, if there is one.
+  size_t batchPosition = 0;
+  batchSteps.clear();
+
   while (true)
   {
     // Perform a step and evaluate the gradient and the function values at that
     // point.
-    newIterateTmp = iterate;
-    newIterateTmp += stepSize * searchDirection;
-    functionValue = Evaluate(newIterateTmp);
-    function.Gradient(newIterateTmp, gradient);
+    if (lineSearchThreads > 1)
+    {
+      // If this step size was not evaluated ahead of time, evaluate it and the
+      // ones that would be tried next if it is too long.
+      if (batchPosition == batchSteps.size() ||
+          batchSteps[batchPosition] != stepSize)
+      {
+        const size_t trialsLeft = (maxLineSearchTrials > numIterations) ?
+            maxLineSearchTrials - numIterations : 1;
+        EvaluateBatch(iterate, searchDirection, stepSize, dec,
+            std::min(lineSearchThreads, trialsLeft));
+        batchPosition = 0;
+      }
+
+      newIterateTmp = batchIterates[batchPosition];
+      gradient = batchGradients[batchPosition];
+      functionValue = batchValues[batchPosition];
+      ++batchPosition;
+    }
+    else
+    {
+      newIterateTmp = iterate;
+      newIterateTmp += stepSize * searchDirection;
+      functionValue = EvaluateWithGradient(newIterateTmp, gradient);
+    }
     numIterations++;
 
     if (functionValue > initialFunctionValue + stepSize *
@@ -218,6 +290,8 @@ bool L_BFGS<FunctionType>::LineSearch(double& functionValue,
     if ((stepSize < minStep) || (stepSize > maxStep) ||
         (numIterations >= maxLineSearchTrials))
     {
+      // The iterate is not moved, so its function value is kept.
+      functionValue = initialFunctionValue;
       return false;
     }
 
@@ -353,9 +427,6 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
   // Whether to optimize until convergence.
   bool optimizeUntilConvergence = (maxIterations == 0);
 
-  // The initial function value.
-  double functionValue = Evaluate(iterate);
-
   // The gradient: the current and the old.
   arma::mat gradient;
   arma::mat oldGradient;
@@ -366,15 +437,15 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
   arma::mat searchDirection;
   searchDirection.zeros(iterate.n_rows, iterate.n_cols);
 
-  // The initial gradient value.
-  function.Gradient(iterate, gradient);
+  // The initial function value and gradient.
+  double functionValue = EvaluateWithGradient(iterate, gradient);
 
   // The main optimization loop.
   for (size_t itNum = 0; optimizeUntilConvergence || (itNum != maxIterations);
        ++itNum)
   {
     Log::Debug << "L-BFGS iteration " << itNum << "; objective " <<
-        function.Evaluate(iterate) << "." << std::endl;
+        functionValue << "." << std::endl;
 
     // Break when the norm of the gradient becomes too small.
     if (GradientNormTooSmall(gradient))
@@ -416,7 +487,8 @@ double L_BFGS<FunctionType>::Optimize(arma::mat& iterate,
 
   } // End of the optimization loop.
 
-  return function.Evaluate(iterate);
+  // functionValue always holds the objective at the current iterate.
+  return functionValue;
 }
 
 // Convert the object to a string.
@@ -436,6 +508,7 @@ std::string L_BFGS<FunctionType>::ToString() const
   convert << "  Minimum gradient norm: " << minGradientNorm << std::endl;
   convert << "  Minimum step for line search: " << minStep << std::endl;
   convert << "  Maximum step for line search: " << maxStep << std::endl;
+  convert << "  Line search threads: " << lineSearchThreads << std::endl;
   return convert.str();
 }
 
@@ -62,12 +62,17 @@ class LRSDP
   //! Modify the objective function matrix (C).
   arma::mat& C() { return function.C(); }
 
+  //! Return the mode of the objective function matrix (C).
+  size_t CMode() const { return function.CMode(); }
+  //! Modify the mode of the objective function matrix (C).
+  size_t& CMode() { return function.CMode(); }
+
   //! Return the vector of A matrices (which correspond to the constraints).
   const std::vector<arma::mat>& A() const { return function.A(); }
   //! Modify the veector of A matrices (which correspond to the constraints).
   std::vector<arma::mat>& A() { return function.A(); }
 
-  //! Return the vector of modes for the A matrices.
+  //! Return the vector of modes for the A matrices (see LRSDPFunction).
   const arma::uvec& AModes() const { return function.AModes(); }
   //! Modify the vector of modes for the A matrices.
   arma::uvec& AModes() { return function.AModes(); }
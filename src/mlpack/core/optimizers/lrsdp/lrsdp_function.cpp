@@ -13,46 +13,165 @@ using namespace mlpack::optimization;
 
 LRSDPFunction::LRSDPFunction(const size_t numConstraints,
                              const arma::mat& initialPoint):
+    cMode(0),
     a(numConstraints),
     b(numConstraints),
     initialPoint(initialPoint),
-    aModes(numConstraints)
+    aModes(numConstraints),
+    threads(0)
 { }
 
+/**
+ * Compute Tr(M * (R R^T)) for a matrix M stored in the given mode (see the
+ * LRSDPFunction documentation), without forming R R^T.
+ */
+static double EvaluateTrace(const arma::mat& m,
+                            const size_t mode,
+                            const arma::mat& coordinates)
+{
+  if (mode == 0)
+  {
+    // Tr(M R R^T) = sum(sum((M R) % R)).
+    return accu((m * coordinates) % coordinates);
+  }
+  else if (mode == 1)
+  {
+    // Each entry M(i, j) = v contributes v * (R R^T)(i, j).
+    double value = 0;
+    for (size_t k = 0; k < m.n_cols; ++k)
+    {
+      value += m(2, k) * dot(coordinates.row((size_t) m(0, k)),
+          coordinates.row((size_t) m(1, k)));
+    }
+    return value;
+  }
+  else
+  {
+    // M = U U^T, so Tr(M R R^T) = ||U^T R||_F^2.
+    return accu(square(trans(m) * coordinates));
+  }
+}
+
+/**
+ * Add scale * M * R to the given matrix, for a matrix M stored in the given
+ * mode (see the LRSDPFunction documentation).
+ */
+static void AddProduct(const arma::mat& m,
+                       const size_t mode,
+                       const double scale,
+                       const arma::mat& coordinates,
+                       arma::mat& product)
+{
+  if (mode == 0)
+  {
+    product += scale * (m * coordinates);
+  }
+  else if (mode == 1)
+  {
+    // Each entry M(i, j) = v adds v * R.row(j) to row i of the product.
+    for (size_t k = 0; k < m.n_cols; ++k)
+    {
+      product.row((size_t) m(0, k)) += (scale * m(2, k)) *
+          coordinates.row((size_t) m(1, k));
+    }
+  }
+  else
+  {
+    product += scale * (m * (trans(m) * coordinates));
+  }
+}
+
 double LRSDPFunction::Evaluate(const arma::mat& coordinates) const
 {
-  return -accu(coordinates * trans(coordinates));
+  return EvaluateTrace(c, cMode, coordinates);
 }
 
-void LRSDPFunction::Gradient(const arma::mat& /* coordinates */,
-                     arma::mat& /* gradient */) const
+void LRSDPFunction::Gradient(const arma::mat& coordinates,
+                             arma::mat& gradient) const
 {
-  Log::Fatal << "LRSDP::Gradient() not implemented for arbitrary optimizers!"
-      << std::endl;
+  // The gradient of Tr(C R R^T) is 2 C R.
+  gradient.zeros(coordinates.n_rows, coordinates.n_cols);
+  AddProduct(c, cMode, 2.0, coordinates, gradient);
 }
 
 double LRSDPFunction::EvaluateConstraint(const size_t index,
                                  const arma::mat& coordinates) const
 {
-  arma::mat rrt = coordinates * trans(coordinates);
-  if (aModes[index] == 0)
-    return trace(a[index] * rrt) - b[index];
-  else
-  {
-    double value = -b[index];
-    for (size_t i = 0; i < a[index].n_cols; ++i)
-      value += a[index](2, i) * rrt(a[index](0, i), a[index](1, i));
+  return EvaluateTrace(a[index], aModes[index], coordinates) - b[index];
+}
 
-    return value;
-  }
+void LRSDPFunction::GradientConstraint(const size_t index,
+                                       const arma::mat& coordinates,
+                                       arma::mat& gradient) const
+{
+  // The gradient of Tr(A_i R R^T) - b_i is 2 A_i R.
+  gradient.zeros(coordinates.n_rows, coordinates.n_cols);
+  AddProduct(a[index], aModes[index], 2.0, coordinates, gradient);
 }
 
-void LRSDPFunction::GradientConstraint(const size_t /* index */,
-                               const arma::mat& /* coordinates */,
-                               arma::mat& /* gradient */) const
+void LRSDPFunction::EvaluateConstraints(const arma::mat& coordinates,
+                                        arma::vec& constraints) const
 {
-  Log::Fatal << "LRSDP::GradientConstraint() not implemented for arbitrary "
-      << "optimizers!" << std::endl;
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // The constraints can have very different costs (a dense constraint costs
+  // far more than a sparse one), so they are scheduled dynamically.
+  constraints.set_size(b.n_elem);
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 64)
+  for (omp_size_t i = 0; i < (omp_size_t) b.n_elem; ++i)
+    constraints[i] = EvaluateConstraint(i, coordinates);
+}
+
+void LRSDPFunction::GradientConstraints(const arma::mat& coordinates,
+                                        const arma::vec& weights,
+                                        arma::mat& gradient) const
+{
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // The gradients of contiguous blocks of constraints (as many blocks as
+  // util::ReductionBlocks() gives) are summed separately, and added with
+  // util::TreeReduce(), so the result does not depend on the number of
+  // threads.  Each constraint is a matrix product, so a block can be small.
+  const size_t blocks = util::ReductionBlocks(b.n_elem, 4);
+  if (blocks == 1)
+  {
+    for (size_t i = 0; i < b.n_elem; ++i)
+    {
+      if (weights[i] != 0.0)
+        AddProduct(a[i], aModes[i], 2.0 * weights[i], coordinates, gradient);
+    }
+    return;
+  }
+
+  std::vector<arma::mat> blockGradients(blocks);
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t block = 0; block < (omp_size_t) blocks; ++block)
+  {
+    const size_t begin = (block * b.n_elem) / blocks;
+    const size_t end = ((block + 1) * b.n_elem) / blocks;
+
+    arma::mat& blockGradient = blockGradients[block];
+    blockGradient.zeros(coordinates.n_rows, coordinates.n_cols);
+    for (size_t i = begin; i < end; ++i)
+    {
+      if (weights[i] != 0.0)
+        AddProduct(a[i], aModes[i], 2.0 * weights[i], coordinates,
+            blockGradient);
+    }
+  }
+
+  util::TreeReduce(blockGradients);
+  gradient += blockGradients[0];
 }
 
 // Return a string representation of the object.
@@ -67,13 +186,20 @@ std::string LRSDPFunction::ToString() const
   convert << "  Constraint b_i values: " << b.t();
   convert << "  Objective matrix (C) size: " << c.n_rows << "x" << c.n_cols
       << std::endl;
+  convert << "  C mode: " << cMode << std::endl;
+  convert << "  Threads: " << threads << std::endl;
   return convert.str();
 }
 
 namespace mlpack {
 namespace optimization {
 
-// Template specializations for function and gradient evaluation.
+// Template specializations for function and gradient evaluation.  None of
+// these form R R^T: the traces and the products with R are computed directly
+// from the representation of each matrix, so a sparse or low-rank constraint
+// costs time proportional to its number of entries (or its rank) times the
+// rank of R, instead of O(n^2) or more.  The constraints are evaluated and
+// their gradients accumulated in parallel by the LRSDPFunction.
 template<>
 double AugLagrangianFunction<LRSDPFunction>::Evaluate(
     const arma::mat& coordinates) const
@@ -82,33 +208,15 @@ double AugLagrangianFunction<LRSDPFunction>::Evaluate(
   // L(R, y, s) = Tr(C * (R R^T)) -
   //     sum_{i = 1}^{m} (y_i (Tr(A_i * (R R^T)) - b_i)) +
   //     (sigma / 2) * sum_{i = 1}^{m} (Tr(A_i * (R R^T)) - b_i)^2
-
-  // Let's start with the objective: Tr(C * (R R^T)).
-  // Simple, possibly slow solution.
-  arma::mat rrt = coordinates * trans(coordinates);
-  double objective = trace(function.C() * rrt);
+  double objective = function.Evaluate(coordinates);
 
   // Now each constraint.
-  for (size_t i = 0; i < function.B().n_elem; ++i)
+  arma::vec constraints;
+  function.EvaluateConstraints(coordinates, constraints);
+  for (size_t i = 0; i < constraints.n_elem; ++i)
   {
-    // Take the trace subtracted by the b_i.
-    double constraint = -function.B()[i];
-
-    if (function.AModes()[i] == 0)
-    {
-      constraint += trace(function.A()[i] * rrt);
-    }
-    else
-    {
-      for (size_t j = 0; j < function.A()[i].n_cols; ++j)
-      {
-        constraint += function.A()[i](2, j) *
-            rrt(function.A()[i](0, j), function.A()[i](1, j));
-      }
-    }
-
-    objective -= (lambda[i] * constraint);
-    objective += (sigma / 2) * std::pow(constraint, 2.0);
+    objective -= (lambda[i] * constraints[i]);
+    objective += (sigma / 2) * std::pow(constraints[i], 2.0);
   }
 
   return objective;
@@ -125,43 +233,37 @@ void AugLagrangianFunction<LRSDPFunction>::Gradient(
   //   with
   // S' = C - sum_{i = 1}^{m} y'_i A_i
   // y'_i = y_i - sigma * (Trace(A_i * (R R^T)) - b_i)
-  arma::mat rrt = coordinates * trans(coordinates);
-  arma::mat s = function.C();
-
-  for (size_t i = 0; i < function.B().n_elem; ++i)
-  {
-    double constraint = -function.B()[i];
+  // S' is never formed; each term of S' * R is added separately.
+  function.Gradient(coordinates, gradient);
 
-    if (function.AModes()[i] == 0)
-    {
-      constraint += trace(function.A()[i] * rrt);
-    }
-    else
-    {
-      for (size_t j = 0; j < function.A()[i].n_cols; ++j)
-      {
-        constraint += function.A()[i](2, j) *
-            rrt(function.A()[i](0, j), function.A()[i](1, j));
-      }
-    }
+  arma::vec constraints;
+  function.EvaluateConstraints(coordinates, constraints);
+  const arma::vec weights = sigma * constraints - lambda;
+  function.GradientConstraints(coordinates, weights, gradient);
+}
 
-    double y = lambda[i] - sigma * constraint;
+template<>
+double AugLagrangianFunction<LRSDPFunction>::EvaluateWithGradient(
+    const arma::mat& coordinates,
+    arma::mat& gradient) const
+{
+  // Both the objective and the gradient need every constraint, so these are
+  // only computed once; see Evaluate() and Gradient().
+  double objective = function.Evaluate(coordinates);
+  function.Gradient(coordinates, gradient);
 
-    if (function.AModes()[i] == 0)
-    {
-      s -= (y * function.A()[i]);
-    }
-    else
-    {
-      // We only need to subtract the entries which could be modified.
-      for (size_t j = 0; j < function.A()[i].n_cols; ++j)
-      {
-        s(function.A()[i](0, j), function.A()[i](1, j)) -= y;
-      }
-    }
+  arma::vec constraints;
+  function.EvaluateConstraints(coordinates, constraints);
+  for (size_t i = 0; i < constraints.n_elem; ++i)
+  {
+    objective -= (lambda[i] * constraints[i]);
+    objective += (sigma / 2) * std::pow(constraints[i], 2.0);
   }
 
-  gradient = 2 * s * coordinates;
+  const arma::vec weights = sigma * constraints - lambda;
+  function.GradientConstraints(coordinates, weights, gradient);
+
+  return objective;
 }
 
 }; // namespace optimization
@@ -16,6 +16,20 @@ namespace optimization {
 
 /**
  * The objective function that LRSDP is trying to optimize.
+ *
+ * The objective matrix C and each constraint matrix A_i can be stored in one
+ * of three modes, set with CMode() and AModes():
+ *
+ *  - 0 (dense): the matrix itself, n x n.
+ *  - 1 (sparse): a 3 x nnz matrix of entries; column k holds the row index,
+ *    column index, and value of one nonzero entry.  Symmetric matrices must
+ *    list both (i, j) and (j, i).
+ *  - 2 (low-rank): an n x k matrix U, where the matrix is U U^T.
+ *
+ * R R^T is never formed; evaluating a sparse matrix costs O(nnz * r) and a
+ * low-rank one O(n * k * r), where r is the number of columns of the
+ * coordinates, so large problems with sparse or low-rank constraints (such as
+ * the distance constraints of MVU) remain tractable.
  */
 class LRSDPFunction
 {
@@ -36,7 +50,7 @@ class LRSDPFunction
 
   /**
    * Evaluate the gradient of the LRSDP (no constraints) at the given
-   * coordinates.
+   * coordinates.  C must be symmetric.
    */
   void Gradient(const arma::mat& coordinates, arma::mat& gradient) const;
 
@@ -47,12 +61,37 @@ class LRSDPFunction
                             const arma::mat& coordinates) const;
   /**
    * Evaluate the gradient of a particular constraint of the LRSDP at the given
-   * coordinates.
+   * coordinates.  A_i must be symmetric.
    */
   void GradientConstraint(const size_t index,
                           const arma::mat& coordinates,
                           arma::mat& gradient) const;
 
+  /**
+   * Evaluate every constraint of the LRSDP at the given coordinates.  The
+   * constraints are evaluated in parallel with Threads() threads if OpenMP is
+   * available.
+   *
+   * @param coordinates Coordinates to evaluate the constraints at.
+   * @param constraints Vector to store the value of each constraint in.
+   */
+  void EvaluateConstraints(const arma::mat& coordinates,
+                           arma::vec& constraints) const;
+
+  /**
+   * Add the sum of the gradients of the constraints at the given coordinates,
+   * each multiplied by the given weight, to the given gradient.  The
+   * constraints are split among Threads() threads if OpenMP is available; the
+   * result does not depend on the scheduling, only on the number of threads.
+   *
+   * @param coordinates Coordinates to evaluate the gradients at.
+   * @param weights Weight of the gradient of each constraint.
+   * @param gradient Matrix to add the weighted gradients to.
+   */
+  void GradientConstraints(const arma::mat& coordinates,
+                           const arma::vec& weights,
+                           arma::mat& gradient) const;
+
   //! Get the number of constraints in the LRSDP.
   size_t NumConstraints() const { return b.n_elem; }
 
@@ -64,6 +103,11 @@ class LRSDPFunction
   //! Modify the objective function matrix (C).
   arma::mat& C() { return c; }
 
+  //! Return the mode of the objective function matrix (C).
+  size_t CMode() const { return cMode; }
+  //! Modify the mode of the objective function matrix (C).
+  size_t& CMode() { return cMode; }
+
   //! Return the vector of A matrices (which correspond to the constraints).
   const std::vector<arma::mat>& A() const { return a; }
   //! Modify the veector of A matrices (which correspond to the constraints).
@@ -79,12 +123,22 @@ class LRSDPFunction
   //! Modify the vector of B values.
   arma::vec& B() { return b; }
 
+  //! Get the number of threads used to evaluate the constraints (0 means all
+  //! available threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used to evaluate the constraints (0 means
+  //! all available threads).  This has no effect if mlpack was compiled
+  //! without OpenMP.
+  size_t& Threads() { return threads; }
+
   //! Return string representation of object.
   std::string ToString() const;
 
  private:
   //! Objective function matrix c.
   arma::mat c;
+  //! Mode of the objective function matrix c.
+  size_t cMode;
   //! A_i for each constraint.
   std::vector<arma::mat> a;
   //! b_i for each constraint.
@@ -92,8 +146,11 @@ class LRSDPFunction
 
   //! Initial point.
   arma::mat initialPoint;
-  //! 1 if entries in matrix, 0 for normal.
+  //! Mode of each A_i: 0 for dense, 1 for sparse entries, 2 for low-rank.
   arma::uvec aModes;
+
+  //! Number of threads used to evaluate the constraints (0 means all).
+  size_t threads;
 };
 
 // Declare specializations in lrsdp_function.cpp.
@@ -106,6 +163,11 @@ void AugLagrangianFunction<LRSDPFunction>::Gradient(
     const arma::mat& coordinates,
     arma::mat& gradient) const;
 
+template<>
+double AugLagrangianFunction<LRSDPFunction>::EvaluateWithGradient(
+    const arma::mat& coordinates,
+    arma::mat& gradient) const;
+
 };
 };
 
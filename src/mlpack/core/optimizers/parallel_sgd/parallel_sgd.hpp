@@ -0,0 +1,158 @@
+/**
+ * @file parallel_sgd.hpp
+ *
+ * Stochastic gradient descent with the functions of each pass split across
+ * threads.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_HPP
+#define __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/sgd/sgd.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * ParallelSGD minimizes a decomposable function, like SGD, but each pass over
+ * the functions is split into one shard per thread.  It takes the same
+ * DecomposableFunctionType as SGD (see mlpack::optimization::SGD), and how the
+ * threads share the iterate depends on what that type implements.
+ *
+ * For functions with sparse gradients, which implement
+ *
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t i,
+ *                 arma::sp_mat& gradient);
+ *   void Support(const size_t i, arma::uvec& indices);
+ *   void Regularization(arma::mat& lambdas);
+ *
+ * as described for SGD, each thread takes the steps of its shard without any
+ * locking, as in 'Hogwild!: A Lock-Free Approach to Parallelizing Stochastic
+ * Gradient Descent' by F. Niu, B. Recht, C. Re and S. J. Wright.  When most
+ * functions touch few coordinates, two threads rarely update the same
+ * coordinate at once, and a lost update does little harm.  The L2
+ * regularization is split among the functions that depend on each coordinate
+ * (a coordinate that d of the n functions depend on gets n / d times the
+ * regularization of one function from each of them), so that every step stays
+ * sparse and the sum over a pass is still the whole regularization.
+ * Regularized coordinates that no function depends on get the decay of all the
+ * steps of a pass at the end of it, as dense steps would have given them.  A
+ * coordinate few functions depend on gets a large decay in each of their
+ * steps, so the step size times the total regularization of each coordinate
+ * should be well below one.
+ *
+ * Any other function is optimized synchronously: each step, the gradients of
+ * the next batchSize functions are computed in parallel, and the iterate moves
+ * along their average, as SGD does with a mini-batch.  The batches don't depend
+ * on the number of threads, so neither does the result; the step size applies
+ * to the average of each batch, as in SGD.  Gradient() must be safe to call
+ * from several threads at once.
+ *
+ * In both cases the shards are taken from a new random order of the functions
+ * at every pass, and the objective is evaluated (in parallel) at the end of
+ * each pass; the optimization terminates when it changes by less than the
+ * tolerance, or after maxIterations steps with single functions.  Without
+ * OpenMP, this is plain SGD with the objective evaluated at the end of each
+ * pass.
+ *
+ * @tparam DecomposableFunctionType Decomposable objective function type to be
+ *     minimized.
+ */
+template<typename DecomposableFunctionType>
+class ParallelSGD
+{
+ public:
+  /**
+   * Construct the ParallelSGD optimizer with the given function and
+   * parameters.
+   *
+   * @param function Function to be optimized (minimized).
+   * @param stepSize Step size for each iteration.
+   * @param maxIterations Maximum number of iterations allowed (0 means no
+   *     limit).
+   * @param tolerance Maximum absolute tolerance to terminate algorithm.
+   * @param threads Number of threads to use (0 means all available cores).
+   * @param batchSize Number of functions whose gradients are averaged for each
+   *     synchronous step; it is not used for functions with sparse gradients.
+   */
+  ParallelSGD(DecomposableFunctionType& function,
+              const double stepSize = 0.01,
+              const size_t maxIterations = 100000,
+              const double tolerance = 1e-5,
+              const size_t threads = 0,
+              const size_t batchSize = 16);
+
+  /**
+   * Optimize the given function using parallel stochastic gradient descent.
+   * The given starting point will be modified to store the finishing point of
+   * the algorithm, and the final objective value is returned.
+   *
+   * @param iterate Starting point (will be modified).
+   * @return Objective value of the final point.
+   */
+  double Optimize(arma::mat& iterate);
+
+  //! Get the instantiated function to be optimized.
+  const DecomposableFunctionType& Function() const { return function; }
+  //! Modify the instantiated function.
+  DecomposableFunctionType& Function() { return function; }
+
+  //! Get the step size.
+  double StepSize() const { return stepSize; }
+  //! Modify the step size.
+  double& StepSize() { return stepSize; }
+
+  //! Get the maximum number of iterations (0 indicates no limit).
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of iterations (0 indicates no limit).
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get the tolerance for termination.
+  double Tolerance() const { return tolerance; }
+  //! Modify the tolerance for termination.
+  double& Tolerance() { return tolerance; }
+
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+  //! Get the number of functions in each synchronous step.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the number of functions in each synchronous step.
+  size_t& BatchSize() { return batchSize; }
+
+  // Convert the object into a string.
+  std::string ToString() const;
+
+ private:
+  //! The instantiated function.
+  DecomposableFunctionType& function;
+
+  //! The step size for each example.
+  double stepSize;
+
+  //! The maximum number of allowed iterations.
+  size_t maxIterations;
+
+  //! The tolerance for termination.
+  double tolerance;
+
+  //! The number of threads to use.
+  size_t threads;
+
+  //! The number of functions in each synchronous step.
+  size_t batchSize;
+
+  //! Evaluate the objective on all of the functions, in parallel.
+  double Objective(const arma::mat& iterate, const size_t numThreads) const;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+// Include implementation.
+#include "parallel_sgd_impl.hpp"
+
+#endif
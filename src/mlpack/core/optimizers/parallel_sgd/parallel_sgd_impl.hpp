@@ -0,0 +1,275 @@
+/**
+ * @file parallel_sgd_impl.hpp
+ *
+ * Implementation of parallel stochastic gradient descent.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_IMPL_HPP
+#define __MLPACK_CORE_OPTIMIZERS_PARALLEL_SGD_PARALLEL_SGD_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "parallel_sgd.hpp"
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * For functions with a sparse gradient, get the regularization each step
+ * applies to each coordinate: the regularization of a coordinate over all the
+ * functions, split evenly among the functions that depend on it.  The
+ * regularized coordinates that no function depends on are returned in
+ * 'unused'; their regularization is left as that of one function.
+ */
+template<typename FunctionType>
+inline typename boost::enable_if_c<
+    HasSparseGradientFunction<FunctionType>::value>::type
+HogwildRegularization(FunctionType& function,
+                      const arma::mat& iterate,
+                      arma::mat& regularization,
+                      arma::uvec& unused)
+{
+  const size_t numFunctions = function.NumFunctions();
+
+  arma::mat uses = arma::zeros<arma::mat>(iterate.n_rows, iterate.n_cols);
+  arma::uvec support;
+  for (size_t i = 0; i < numFunctions; ++i)
+  {
+    function.Support(i, support);
+    for (size_t k = 0; k < support.n_elem; ++k)
+      uses[support[k]] += 1;
+  }
+
+  function.Regularization(regularization);
+  std::vector<arma::uword> unusedList;
+  for (size_t j = 0; j < iterate.n_elem; ++j)
+  {
+    if (uses[j] > 0)
+      regularization[j] *= numFunctions / uses[j];
+    else if (regularization[j] > 0)
+      unusedList.push_back(j);
+  }
+
+  unused.set_size(unusedList.size());
+  for (size_t k = 0; k < unusedList.size(); ++k)
+    unused[k] = unusedList[k];
+}
+
+//! Functions without a sparse gradient take dense steps, and need nothing.
+template<typename FunctionType>
+inline typename boost::disable_if_c<
+    HasSparseGradientFunction<FunctionType>::value>::type
+HogwildRegularization(FunctionType& /* function */,
+                      const arma::mat& /* iterate */,
+                      arma::mat& /* regularization */,
+                      arma::uvec& unused)
+{
+  unused.reset();
+}
+
+/**
+ * Take the steps of the given functions with sparse gradients.  Each thread
+ * takes the steps of a contiguous shard of them, without locking the iterate.
+ */
+template<typename FunctionType>
+inline typename boost::enable_if_c<
+    HasSparseGradientFunction<FunctionType>::value>::type
+ParallelPass(FunctionType& function,
+             arma::mat& iterate,
+             const arma::uvec& functions,
+             const double stepSize,
+             const arma::mat& regularization,
+             const size_t /* batchSize */,
+             const size_t numThreads)
+{
+  #pragma omp parallel num_threads(numThreads)
+  {
+    arma::uvec support;
+    arma::sp_mat gradient;
+
+    #pragma omp for schedule(static)
+    for (omp_size_t k = 0; k < (omp_size_t) functions.n_elem; ++k)
+    {
+      const size_t i = functions[k];
+      function.Support(i, support);
+      function.Gradient(iterate, i, gradient);
+
+      for (size_t s = 0; s < support.n_elem; ++s)
+        iterate[support[s]] -= stepSize * regularization[support[s]] *
+            iterate[support[s]];
+      for (arma::sp_mat::const_iterator it = gradient.begin();
+           it != gradient.end(); ++it)
+        iterate(it.row(), it.col()) -= stepSize * (*it);
+    }
+  }
+}
+
+/**
+ * Take the steps of the given functions synchronously: each step averages the
+ * gradients of a batch of functions, which are computed in parallel.  The
+ * batches don't depend on the number of threads, and the gradients of each
+ * batch are added in order, so neither does the result.
+ */
+template<typename FunctionType>
+inline typename boost::disable_if_c<
+    HasSparseGradientFunction<FunctionType>::value>::type
+ParallelPass(FunctionType& function,
+             arma::mat& iterate,
+             const arma::uvec& functions,
+             const double stepSize,
+             const arma::mat& /* regularization */,
+             const size_t batchSize,
+             const size_t numThreads)
+{
+  std::vector<arma::mat> gradients(batchSize);
+
+  // The threads are started once for the whole pass.  Each step computes the
+  // gradients of the batch in parallel; then one thread takes the step, while
+  // the others wait for it at the end of the 'single' block.
+  #pragma omp parallel num_threads(numThreads)
+  {
+    for (size_t begin = 0; begin < functions.n_elem; begin += batchSize)
+    {
+      const size_t count = std::min(batchSize, functions.n_elem - begin);
+
+      #pragma omp for schedule(static)
+      for (omp_size_t t = 0; t < (omp_size_t) count; ++t)
+        function.Gradient(iterate, functions[begin + t], gradients[t]);
+
+      #pragma omp single
+      {
+        for (size_t t = 0; t < count; ++t)
+          iterate -= (stepSize / count) * gradients[t];
+      }
+    }
+  }
+}
+
+template<typename DecomposableFunctionType>
+ParallelSGD<DecomposableFunctionType>::ParallelSGD(
+    DecomposableFunctionType& function,
+    const double stepSize,
+    const size_t maxIterations,
+    const double tolerance,
+    const size_t threads,
+    const size_t batchSize) :
+    function(function),
+    stepSize(stepSize),
+    maxIterations(maxIterations),
+    tolerance(tolerance),
+    threads(threads),
+    batchSize(batchSize)
+{ /* Nothing to do. */ }
+
+//! Optimize the function (minimize).
+template<typename DecomposableFunctionType>
+double ParallelSGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
+{
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  const size_t numFunctions = function.NumFunctions();
+
+  arma::mat regularization;
+  arma::uvec unused;
+  HogwildRegularization(function, iterate, regularization, unused);
+
+  double overallObjective = Objective(iterate, numThreads);
+  double lastObjective = DBL_MAX;
+
+  arma::uvec order = arma::linspace<arma::uvec>(0, numFunctions - 1,
+      numFunctions);
+  size_t i = 0;
+  while (maxIterations == 0 || i < maxIterations)
+  {
+    Log::Info << "Parallel SGD: iteration " << i << ", objective "
+        << overallObjective << "." << std::endl;
+
+    if (overallObjective != overallObjective)
+    {
+      Log::Warn << "Parallel SGD: converged to " << overallObjective << "; "
+          << "terminating with failure.  Try a smaller step size?"
+          << std::endl;
+      return overallObjective;
+    }
+
+    if (std::abs(lastObjective - overallObjective) < tolerance)
+    {
+      Log::Info << "Parallel SGD: minimized within tolerance " << tolerance
+          << "; terminating optimization." << std::endl;
+      return overallObjective;
+    }
+
+    // Take one pass over the functions, in a new random order (or what is left
+    // of the iterations).
+    order = arma::shuffle(order);
+    const size_t steps = (maxIterations == 0) ? numFunctions :
+        std::min(numFunctions, maxIterations - i);
+    if (steps < numFunctions)
+      ParallelPass(function, iterate, order.subvec(0, steps - 1), stepSize,
+          regularization, batchSize, numThreads);
+    else
+      ParallelPass(function, iterate, order, stepSize, regularization,
+          batchSize, numThreads);
+    i += steps;
+
+    // Coordinates that no function depends on are never touched by the steps,
+    // so they get the decay of all of them at once.
+    for (size_t k = 0; k < unused.n_elem; ++k)
+      iterate[unused[k]] *= std::pow(1.0 - stepSize *
+          regularization[unused[k]], (double) steps);
+
+    lastObjective = overallObjective;
+    overallObjective = Objective(iterate, numThreads);
+  }
+
+  Log::Info << "Parallel SGD: maximum iterations (" << maxIterations << ") "
+      << "reached; terminating optimization." << std::endl;
+  return overallObjective;
+}
+
+template<typename DecomposableFunctionType>
+double ParallelSGD<DecomposableFunctionType>::Objective(
+    const arma::mat& iterate,
+    const size_t numThreads) const
+{
+  // The functions are summed in blocks which are added with
+  // util::TreeReduce(), so the objective does not depend on the number of
+  // threads.
+  const size_t numFunctions = function.NumFunctions();
+  const size_t blocks = util::ReductionBlocks(numFunctions);
+  std::vector<double> objectives(blocks, 0.0);
+
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+  {
+    const size_t end = (b + 1) * numFunctions / blocks;
+    for (size_t i = b * numFunctions / blocks; i < end; ++i)
+      objectives[b] += function.Evaluate(iterate, i);
+  }
+
+  util::TreeReduce(objectives);
+  return objectives[0];
+}
+
+// Convert the object to a string.
+template<typename DecomposableFunctionType>
+std::string ParallelSGD<DecomposableFunctionType>::ToString() const
+{
+  std::ostringstream convert;
+  convert << "ParallelSGD [" << this << "]" << std::endl;
+  convert << "  Function:" << std::endl;
+  convert << util::Indent(function.ToString(), 2);
+  convert << "  Step size: " << stepSize << std::endl;
+  convert << "  Maximum iterations: " << maxIterations << std::endl;
+  convert << "  Tolerance: " << tolerance << std::endl;
+  convert << "  Threads: " << threads << std::endl;
+  convert << "  Batch size: " << batchSize << std::endl;
+  return convert.str();
+}
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
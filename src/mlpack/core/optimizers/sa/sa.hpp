@@ -36,6 +36,38 @@ namespace optimization {
  * The system is considered "frozen" when its score fails to change more then
  * tolerance for maxToleranceSweep consecutive sweeps.
  *
+ * If more than one chain is requested, the optimizer runs parallel tempering
+ * (replica exchange): every chain starts from the given point, chain i starts
+ * at temperature initT * chainTemperatureRatio^i, and each chain is cooled by
+ * its own copy of the cooling schedule.  The chains are advanced in parallel
+ * for moveCtrlSweep sweeps at a time; after each of these rounds, the states
+ * of neighboring chains are exchanged with probability
+ *
+ *   min{1, exp((1 / T_i - 1 / T_{i + 1}) (E_i - E_{i + 1}))},
+ *
+ * so that good states found by the hot chains, which cross barriers easily,
+ * are passed down to the cold chains.  Each thread draws its moves from its
+ * own random number generator (see math::RandGen()).  The optimization stops
+ * when the coldest chain is frozen or every chain has taken maxIterations
+ * steps, and the lowest-energy final state of any chain is returned.  In this
+ * mode Evaluate() is called from several threads at once, so it must be safe
+ * to call concurrently (or the number of threads must be set to 1), and the
+ * cooling schedule must be copyable.
+ *
+ * For more information on parallel tempering, see the following paper:
+ *
+ * @code
+ * @article{earl2005parallel,
+ *   title={Parallel tempering: Theory, applications, and new perspectives},
+ *   author={Earl, David J. and Deem, Michael W.},
+ *   journal={Physical Chemistry Chemical Physics},
+ *   volume={7},
+ *   number={23},
+ *   pages={3910--3916},
+ *   year={2005}
+ * }
+ * @endcode
+ *
  * For SA to work, the FunctionType parameter must implement the following
  * two methods:
  *
@@ -75,6 +107,12 @@ class SA
    * @param maxMoveCoef Maximum move size.
    * @param initMoveCoef Initial move size.
    * @param gain Proportional control in feedback move control.
+   * @param chains Number of chains to run with parallel tempering (1 runs
+   *      plain simulated annealing).
+   * @param chainTemperatureRatio Ratio between the initial temperatures of
+   *      neighboring chains.
+   * @param threads Number of threads to run the chains with (0 means all
+   *      available threads).
    */
   SA(FunctionType& function,
      CoolingScheduleType& coolingSchedule,
@@ -86,7 +124,10 @@ class SA
      const size_t maxToleranceSweep = 3,
      const double maxMoveCoef = 20,
      const double initMoveCoef = 0.3,
-     const double gain = 0.3);
+     const double gain = 0.3,
+     const size_t chains = 1,
+     const double chainTemperatureRatio = 2.0,
+     const size_t threads = 0);
 
   /**
    * Optimize the given function using simulated annealing. The given starting
@@ -148,6 +189,23 @@ class SA
   //! Modify move size of each parameter.
   arma::mat& MoveSize() { return moveSize; }
 
+  //! Get the number of chains.
+  size_t Chains() const { return chains; }
+  //! Modify the number of chains.
+  size_t& Chains() { return chains; }
+
+  //! Get the ratio between the initial temperatures of neighboring chains.
+  double ChainTemperatureRatio() const { return chainTemperatureRatio; }
+  //! Modify the ratio between the initial temperatures of neighboring chains.
+  double& ChainTemperatureRatio() { return chainTemperatureRatio; }
+
+  //! Get the number of threads used to run the chains (0 means all
+  //! available threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used to run the chains.  This has no effect
+  //! if mlpack was compiled without OpenMP.
+  size_t& Threads() { return threads; }
+
   //! Return a string representation of this object.
   std::string ToString() const;
  private:
@@ -175,6 +233,43 @@ class SA
   //! Move size of each parameter.
   arma::mat moveSize;
 
+  //! Number of chains to run with parallel tempering.
+  size_t chains;
+  //! Ratio between the initial temperatures of neighboring chains.
+  double chainTemperatureRatio;
+  //! Number of threads used to run the chains (0 means all available).
+  size_t threads;
+
+  //! The state of one chain in parallel tempering.
+  struct Chain
+  {
+    //! Current position of the chain.
+    arma::mat iterate;
+    //! Energy of the current position.
+    double energy;
+    //! Temperature of the chain.
+    double temperature;
+    //! Move size of each parameter.
+    arma::mat moveSize;
+    //! Accepted moves of each parameter since the last MoveControl() call.
+    arma::mat accept;
+    //! Next parameter to move.
+    size_t idx;
+    //! Sweeps since the last MoveControl() call.
+    size_t sweepCounter;
+    //! Consecutive steps that changed the energy by less than the tolerance.
+    size_t frozenCount;
+  };
+
+  /**
+   * Optimize the function with parallel tempering; see the class
+   * documentation.
+   *
+   * @param iterate Starting point (will be modified).
+   * @return Objective value of the final point.
+   */
+  double OptimizeChains(arma::mat& iterate);
+
   /**
    * GenerateMove proposes a move on element iterate(idx), and determines if
    * that move is acceptable or not according to the Metropolis criterion.
@@ -185,6 +280,8 @@ class SA
    *
    * @param iterate Current optimization position.
    * @param accept Matrix representing which parameters have had accepted moves.
+   * @param chainMoveSize Move size of each parameter.
+   * @param chainTemperature Current temperature of the system.
    * @param energy Current energy of the system.
    * @param idx Current parameter to modify.
    * @param sweepCounter Current counter representing how many sweeps have been
@@ -192,6 +289,8 @@ class SA
    */
   void GenerateMove(arma::mat& iterate,
                     arma::mat& accept,
+                    arma::mat& chainMoveSize,
+                    const double chainTemperature,
                     double& energy,
                     size_t& idx,
                     size_t& sweepCounter);
@@ -213,8 +312,11 @@ class SA
    *
    * @param nMoves Number of moves since last call.
    * @param accept Matrix representing which parameters have had accepted moves.
+   * @param chainMoveSize Move size of each parameter (will be modified).
    */
-  void MoveControl(const size_t nMoves, arma::mat& accept);
+  void MoveControl(const size_t nMoves,
+                   arma::mat& accept,
+                   arma::mat& chainMoveSize);
 };
 
 }; // namespace optimization
@@ -27,7 +27,10 @@ SA<FunctionType, CoolingScheduleType>::SA(
     const size_t maxToleranceSweep,
     const double maxMoveCoef,
     const double initMoveCoef,
-    const double gain) :
+    const double gain,
+    const size_t chains,
+    const double chainTemperatureRatio,
+    const size_t threads) :
     function(function),
     coolingSchedule(coolingSchedule),
     maxIterations(maxIterations),
@@ -36,7 +39,10 @@ SA<FunctionType, CoolingScheduleType>::SA(
     moveCtrlSweep(moveCtrlSweep),
     tolerance(tolerance),
     maxToleranceSweep(maxToleranceSweep),
-    gain(gain)
+    gain(gain),
+    chains(chains),
+    chainTemperatureRatio(chainTemperatureRatio),
+    threads(threads)
 {
   const size_t rows = function.GetInitialPoint().n_rows;
   const size_t cols = function.GetInitialPoint().n_cols;
@@ -54,6 +60,9 @@ template<
 >
 double SA<FunctionType, CoolingScheduleType>::Optimize(arma::mat &iterate)
 {
+  if (chains > 1)
+    return OptimizeChains(iterate);
+
   const size_t rows = function.GetInitialPoint().n_rows;
   const size_t cols = function.GetInitialPoint().n_cols;
 
@@ -70,13 +79,15 @@ double SA<FunctionType, CoolingScheduleType>::Optimize(arma::mat &iterate)
 
   // Initial moves to get rid of dependency of initial states.
   for (size_t i = 0; i < initMoves; ++i)
-    GenerateMove(iterate, accept, energy, idx, sweepCounter);
+    GenerateMove(iterate, accept, moveSize, temperature, energy, idx,
+        sweepCounter);
 
   // Iterating and cooling.
   for (size_t i = 0; i != maxIterations; ++i)
   {
     oldEnergy = energy;
-    GenerateMove(iterate, accept, energy, idx, sweepCounter);
+    GenerateMove(iterate, accept, moveSize, temperature, energy, idx,
+        sweepCounter);
     temperature = coolingSchedule.NextTemperature(temperature, energy);
 
     // Determine if the optimization has entered (or continues to be in) a
@@ -101,6 +112,142 @@ double SA<FunctionType, CoolingScheduleType>::Optimize(arma::mat &iterate)
   return energy;
 }
 
+//! Optimize the function (minimize) with parallel tempering.
+template<
+    typename FunctionType,
+    typename CoolingScheduleType
+>
+double SA<FunctionType, CoolingScheduleType>::OptimizeChains(
+    arma::mat& iterate)
+{
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  math::RandomSeed(std::time(NULL));
+
+  // Every chain starts from the given point, and each is hotter than the one
+  // before it.
+  const double initEnergy = function.Evaluate(iterate);
+  std::vector<Chain> states(chains);
+  std::vector<CoolingScheduleType> schedules(chains, coolingSchedule);
+  double initTemperature = temperature;
+  for (size_t c = 0; c < chains; ++c)
+  {
+    states[c].iterate = iterate;
+    states[c].energy = initEnergy;
+    states[c].temperature = initTemperature;
+    states[c].moveSize = moveSize;
+    states[c].accept.zeros(iterate.n_rows, iterate.n_cols);
+    states[c].idx = 0;
+    states[c].sweepCounter = 0;
+    states[c].frozenCount = 0;
+    initTemperature *= chainTemperatureRatio;
+  }
+
+  // Initial moves to get rid of dependency of initial states.  The chains are
+  // split between the threads the same way every time, so each chain always
+  // draws from the random number generator of the same thread.
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t c = 0; c < (omp_size_t) chains; ++c)
+  {
+    Chain& chain = states[c];
+    for (size_t i = 0; i < initMoves; ++i)
+      GenerateMove(chain.iterate, chain.accept, chain.moveSize,
+          chain.temperature, chain.energy, chain.idx, chain.sweepCounter);
+  }
+
+  // The chains are advanced for moveCtrlSweep sweeps between exchanges.
+  const size_t roundMoves = std::max(moveCtrlSweep * iterate.n_elem,
+      (size_t) 1);
+  const size_t frozenMoves = maxToleranceSweep * moveCtrlSweep *
+      iterate.n_elem;
+  size_t iterations = 0;
+  while (iterations != maxIterations)
+  {
+    const size_t moves = (maxIterations == 0) ? roundMoves :
+        std::min(roundMoves, maxIterations - iterations);
+
+    // Iterating and cooling.
+    #pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (omp_size_t c = 0; c < (omp_size_t) chains; ++c)
+    {
+      Chain& chain = states[c];
+      for (size_t i = 0; i < moves; ++i)
+      {
+        const double oldEnergy = chain.energy;
+        GenerateMove(chain.iterate, chain.accept, chain.moveSize,
+            chain.temperature, chain.energy, chain.idx, chain.sweepCounter);
+        chain.temperature = schedules[c].NextTemperature(chain.temperature,
+            chain.energy);
+
+        if (std::abs(chain.energy - oldEnergy) < tolerance)
+          ++chain.frozenCount;
+        else
+          chain.frozenCount = 0;
+      }
+    }
+    iterations += moves;
+
+    // Terminate if the coldest chain is frozen.
+    if (states[0].frozenCount >= frozenMoves)
+    {
+      Log::Debug << "SA: coldest of " << chains << " chains minimized within "
+          << "tolerance " << tolerance << " for " << maxToleranceSweep
+          << " sweeps after " << iterations << " iterations; terminating "
+          << "optimization." << std::endl;
+      break;
+    }
+
+    // Exchange the states of neighboring chains according to the Metropolis
+    // criterion, with probability
+    // min{1, exp((1 / T_cold - 1 / T_hot) (E_cold - E_hot))}.
+    for (size_t c = 0; c + 1 < chains; ++c)
+    {
+      Chain& cold = states[c];
+      Chain& hot = states[c + 1];
+      const double delta = cold.energy - hot.energy;
+      const double criterion = std::exp((1.0 / cold.temperature -
+          1.0 / hot.temperature) * delta);
+      if (criterion >= 1.0 || math::Random() < criterion)
+      {
+        cold.iterate.swap(hot.iterate);
+        std::swap(cold.energy, hot.energy);
+
+        // The energy of both chains has jumped, unless they were in states of
+        // about the same energy.
+        if (std::abs(delta) >= tolerance)
+        {
+          cold.frozenCount = 0;
+          hot.frozenCount = 0;
+        }
+      }
+    }
+  }
+
+  if (iterations == maxIterations)
+  {
+    Log::Debug << "SA: maximum iterations (" << maxIterations << ") reached "
+        << "by each of " << chains << " chains; terminating optimization."
+        << std::endl;
+  }
+
+  // Keep the temperature and move sizes of the coldest chain, and return the
+  // best final state of any chain.
+  temperature = states[0].temperature;
+  moveSize = states[0].moveSize;
+
+  size_t best = 0;
+  for (size_t c = 1; c < chains; ++c)
+    if (states[c].energy < states[best].energy)
+      best = c;
+
+  iterate = states[best].iterate;
+  return states[best].energy;
+}
+
 /**
  * GenerateMove proposes a move on element iterate(idx), and determines
  * it that move is acceptable or not according to the Metropolis criterion.
@@ -116,6 +263,8 @@ template<
 void SA<FunctionType, CoolingScheduleType>::GenerateMove(
     arma::mat& iterate,
     arma::mat& accept,
+    arma::mat& chainMoveSize,
+    const double chainTemperature,
     double& energy,
     size_t& idx,
     size_t& sweepCounter)
@@ -129,8 +278,8 @@ void SA<FunctionType, CoolingScheduleType>::GenerateMove(
 
   // Sample from a Laplace distribution with scale parameter moveSize(idx).
   const double unif = 2.0 * math::Random() - 1.0;
-  const double move = (unif < 0) ? (moveSize(idx) * std::log(1 + unif)) :
-      (-moveSize(idx) * std::log(1 - unif));
+  const double move = (unif < 0) ? (chainMoveSize(idx) * std::log(1 + unif)) :
+      (-chainMoveSize(idx) * std::log(1 - unif));
 
   iterate(idx) += move;
   energy = function.Evaluate(iterate);
@@ -138,7 +287,7 @@ void SA<FunctionType, CoolingScheduleType>::GenerateMove(
   // min{1, exp(-(E_new - E_old) / T)}.
   const double xi = math::Random();
   const double delta = energy - prevEnergy;
-  const double criterion = std::exp(-delta / temperature);
+  const double criterion = std::exp(-delta / chainTemperature);
   if (delta <= 0. || criterion > xi)
   {
     accept(idx) += 1.;
@@ -158,7 +307,7 @@ void SA<FunctionType, CoolingScheduleType>::GenerateMove(
 
   if (sweepCounter == moveCtrlSweep) // Do MoveControl().
   {
-    MoveControl(moveCtrlSweep, accept);
+    MoveControl(moveCtrlSweep, accept, chainMoveSize);
     sweepCounter = 0;
   }
 }
@@ -181,20 +330,23 @@ template<
     typename FunctionType,
     typename CoolingScheduleType
 >
-void SA<FunctionType, CoolingScheduleType>::MoveControl(const size_t nMoves,
-                                                        arma::mat& accept)
+void SA<FunctionType, CoolingScheduleType>::MoveControl(
+    const size_t nMoves,
+    arma::mat& accept,
+    arma::mat& chainMoveSize)
 {
   arma::mat target;
   target.copy_size(accept);
   target.fill(0.44);
-  moveSize = arma::log(moveSize);
-  moveSize += gain * (accept / (double) nMoves - target);
-  moveSize = arma::exp(moveSize);
+  chainMoveSize = arma::log(chainMoveSize);
+  chainMoveSize += gain * (accept / (double) nMoves - target);
+  chainMoveSize = arma::exp(chainMoveSize);
 
   // To avoid the use of element-wise arma::min(), which is only available in
   // Armadillo after v3.930, we use a for loop here instead.
   for (size_t i = 0; i < accept.n_elem; ++i)
-    moveSize(i) = (moveSize(i) > maxMove(i)) ? maxMove(i) : moveSize(i);
+    chainMoveSize(i) = (chainMoveSize(i) > maxMove(i)) ? maxMove(i) :
+        chainMoveSize(i);
 
   accept.zeros();
 }
@@ -220,6 +372,10 @@ ToString() const
       << std::endl;
   convert << "  Move control gain: " << gain << std::endl;
   convert << "  Maximum iterations: " << maxIterations << std::endl;
+  convert << "  Chains: " << chains << std::endl;
+  convert << "  Chain temperature ratio: " << chainTemperatureRatio
+      << std::endl;
+  convert << "  Threads: " << threads << std::endl;
   return convert.str();
 }
 
@@ -0,0 +1,76 @@
+/**
+ * @file adagrad_update.hpp
+ *
+ * AdaGrad update for SGD.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_ADAGRAD_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_ADAGRAD_UPDATE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * The AdaGrad update policy, from 'Adaptive Subgradient Methods for Online
+ * Learning and Stochastic Optimization' by J. Duchi, E. Hazan and Y. Singer,
+ * scales the step of each coordinate by the root of the sum of its squared
+ * gradients so far:
+ *
+ * \f[
+ * G_{j + 1} = G_j + g_j^2, \qquad
+ * A_{j + 1} = A_j - \alpha g_j / (\sqrt{G_{j + 1}} + \epsilon)
+ * \f]
+ *
+ * with \f$ g_j = \nabla f_i(A_j) \f$ and all operations taken elementwise.
+ * Coordinates with small or rare gradients get larger steps.
+ */
+class AdaGradUpdate
+{
+ public:
+  /**
+   * Construct the AdaGrad update policy.
+   *
+   * @param epsilon Value added to the denominator, to avoid division by zero.
+   */
+  AdaGradUpdate(const double epsilon = 1e-8) : epsilon(epsilon) { }
+
+  /**
+   * Prepare for an optimization of an iterate of the given size.
+   */
+  void Initialize(const size_t rows, const size_t cols)
+  {
+    squaredGradient.zeros(rows, cols);
+  }
+
+  /**
+   * Update the iterate with the given gradient.
+   *
+   * @param iterate Iterate to be updated.
+   * @param stepSize Step size.
+   * @param gradient Gradient of the functions of this step.
+   */
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    squaredGradient += arma::square(gradient);
+    iterate -= stepSize * gradient / (arma::sqrt(squaredGradient) + epsilon);
+  }
+
+  //! Get the value added to the denominator.
+  double Epsilon() const { return epsilon; }
+  //! Modify the value added to the denominator.
+  double& Epsilon() { return epsilon; }
+
+ private:
+  //! The value added to the denominator.
+  double epsilon;
+  //! The sum of the squared gradients so far.
+  arma::mat squaredGradient;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file adam_update.hpp
+ *
+ * Adam update for SGD.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_ADAM_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_ADAM_UPDATE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * The Adam update policy, from 'Adam: A Method for Stochastic Optimization' by
+ * D. P. Kingma and J. Ba, keeps decaying averages of both the gradients and
+ * their squares, corrects them for their initialization at zero, and takes
+ *
+ * \f[
+ * A_{j + 1} = A_j - \alpha \hat{m}_{j + 1} / (\sqrt{\hat{v}_{j + 1}} +
+ *     \epsilon)
+ * \f]
+ *
+ * where \f$ \hat{m} \f$ and \f$ \hat{v} \f$ are the corrected averages (with
+ * weights \f$ \beta_1 \f$ and \f$ \beta_2 \f$ for the old averages) and all
+ * operations are taken elementwise.  The step of each coordinate is then
+ * roughly bounded by the step size, whatever the scale of its gradient.
+ */
+class AdamUpdate
+{
+ public:
+  /**
+   * Construct the Adam update policy.
+   *
+   * @param beta1 Weight of the old average of the gradients.
+   * @param beta2 Weight of the old average of the squared gradients.
+   * @param epsilon Value added to the denominator, to avoid division by zero.
+   */
+  AdamUpdate(const double beta1 = 0.9,
+             const double beta2 = 0.999,
+             const double epsilon = 1e-8) :
+      beta1(beta1),
+      beta2(beta2),
+      epsilon(epsilon),
+      steps(0)
+  { }
+
+  /**
+   * Prepare for an optimization of an iterate of the given size.
+   */
+  void Initialize(const size_t rows, const size_t cols)
+  {
+    mean.zeros(rows, cols);
+    meanSquared.zeros(rows, cols);
+    steps = 0;
+  }
+
+  /**
+   * Update the iterate with the given gradient.
+   *
+   * @param iterate Iterate to be updated.
+   * @param stepSize Step size.
+   * @param gradient Gradient of the functions of this step.
+   */
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    ++steps;
+    mean = beta1 * mean + (1 - beta1) * gradient;
+    meanSquared = beta2 * meanSquared + (1 - beta2) * arma::square(gradient);
+
+    // The bias corrections are folded into the step size and epsilon.
+    const double correction1 = 1 - std::pow(beta1, (double) steps);
+    const double correction2 = std::sqrt(1 - std::pow(beta2, (double) steps));
+    iterate -= (stepSize * correction2 / correction1) * mean /
+        (arma::sqrt(meanSquared) + epsilon * correction2);
+  }
+
+  //! Get the weight of the old average of the gradients.
+  double Beta1() const { return beta1; }
+  //! Modify the weight of the old average of the gradients.
+  double& Beta1() { return beta1; }
+
+  //! Get the weight of the old average of the squared gradients.
+  double Beta2() const { return beta2; }
+  //! Modify the weight of the old average of the squared gradients.
+  double& Beta2() { return beta2; }
+
+  //! Get the value added to the denominator.
+  double Epsilon() const { return epsilon; }
+  //! Modify the value added to the denominator.
+  double& Epsilon() { return epsilon; }
+
+ private:
+  //! The weight of the old average of the gradients.
+  double beta1;
+  //! The weight of the old average of the squared gradients.
+  double beta2;
+  //! The value added to the denominator.
+  double epsilon;
+  //! The number of steps taken so far.
+  size_t steps;
+  //! The decaying average of the gradients.
+  arma::mat mean;
+  //! The decaying average of the squared gradients.
+  arma::mat meanSquared;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
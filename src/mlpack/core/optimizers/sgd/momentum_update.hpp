@@ -0,0 +1,77 @@
+/**
+ * @file momentum_update.hpp
+ *
+ * SGD update with momentum.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_MOMENTUM_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_MOMENTUM_UPDATE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * The momentum update policy keeps a velocity, a decaying sum of the earlier
+ * steps, and moves the iterate along it:
+ *
+ * \f[
+ * v_{j + 1} = \mu v_j - \alpha \nabla f_i(A_j), \qquad
+ * A_{j + 1} = A_j + v_{j + 1}
+ * \f]
+ *
+ * where \f$ \mu \f$ is the momentum.  Along directions in which the gradient
+ * keeps its sign, steps grow to up to \f$ 1 / (1 - \mu) \f$ times the plain
+ * step, which helps on badly scaled problems; the oscillating components
+ * cancel out.
+ */
+class MomentumUpdate
+{
+ public:
+  /**
+   * Construct the momentum update policy.
+   *
+   * @param momentum Fraction of the velocity kept at each step (in [0, 1)).
+   */
+  MomentumUpdate(const double momentum = 0.9) : momentum(momentum) { }
+
+  /**
+   * Prepare for an optimization of an iterate of the given size, with zero
+   * velocity.
+   */
+  void Initialize(const size_t rows, const size_t cols)
+  {
+    velocity.zeros(rows, cols);
+  }
+
+  /**
+   * Update the iterate with the given gradient.
+   *
+   * @param iterate Iterate to be updated.
+   * @param stepSize Step size.
+   * @param gradient Gradient of the functions of this step.
+   */
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    velocity = momentum * velocity - stepSize * gradient;
+    iterate += velocity;
+  }
+
+  //! Get the momentum.
+  double Momentum() const { return momentum; }
+  //! Modify the momentum.
+  double& Momentum() { return momentum; }
+
+ private:
+  //! The fraction of the velocity kept at each step.
+  double momentum;
+  //! The velocity.
+  arma::mat velocity;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
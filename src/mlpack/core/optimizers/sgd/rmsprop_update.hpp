@@ -0,0 +1,88 @@
+/**
+ * @file rmsprop_update.hpp
+ *
+ * RMSProp update for SGD.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_RMSPROP_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_RMSPROP_UPDATE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * The RMSProp update policy (proposed by G. Hinton in his lectures on neural
+ * networks) is like AdaGrad, but the squared gradients are averaged with
+ * exponentially decaying weights instead of summed, so the steps do not
+ * shrink forever:
+ *
+ * \f[
+ * G_{j + 1} = \beta G_j + (1 - \beta) g_j^2, \qquad
+ * A_{j + 1} = A_j - \alpha g_j / (\sqrt{G_{j + 1}} + \epsilon)
+ * \f]
+ *
+ * with \f$ g_j = \nabla f_i(A_j) \f$ and all operations taken elementwise.
+ */
+class RMSPropUpdate
+{
+ public:
+  /**
+   * Construct the RMSProp update policy.
+   *
+   * @param decay Weight of the old average of the squared gradients (beta).
+   * @param epsilon Value added to the denominator, to avoid division by zero.
+   */
+  RMSPropUpdate(const double decay = 0.99, const double epsilon = 1e-8) :
+      decay(decay),
+      epsilon(epsilon)
+  { }
+
+  /**
+   * Prepare for an optimization of an iterate of the given size.
+   */
+  void Initialize(const size_t rows, const size_t cols)
+  {
+    meanSquaredGradient.zeros(rows, cols);
+  }
+
+  /**
+   * Update the iterate with the given gradient.
+   *
+   * @param iterate Iterate to be updated.
+   * @param stepSize Step size.
+   * @param gradient Gradient of the functions of this step.
+   */
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    meanSquaredGradient = decay * meanSquaredGradient +
+        (1 - decay) * arma::square(gradient);
+    iterate -= stepSize * gradient / (arma::sqrt(meanSquaredGradient) +
+        epsilon);
+  }
+
+  //! Get the weight of the old average of the squared gradients.
+  double Decay() const { return decay; }
+  //! Modify the weight of the old average of the squared gradients.
+  double& Decay() { return decay; }
+
+  //! Get the value added to the denominator.
+  double Epsilon() const { return epsilon; }
+  //! Modify the value added to the denominator.
+  double& Epsilon() { return epsilon; }
+
+ private:
+  //! The weight of the old average of the squared gradients.
+  double decay;
+  //! The value added to the denominator.
+  double epsilon;
+  //! The decaying average of the squared gradients.
+  arma::mat meanSquaredGradient;
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
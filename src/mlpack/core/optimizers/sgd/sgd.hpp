@@ -9,6 +9,12 @@
 
 #include <mlpack/core.hpp>
 
+#include "vanilla_update.hpp"
+#include "momentum_update.hpp"
+#include "adagrad_update.hpp"
+#include "rmsprop_update.hpp"
+#include "adam_update.hpp"
+
 namespace mlpack {
 namespace optimization {
 
@@ -64,11 +70,76 @@ namespace optimization {
  * objective function on the first point in the dataset (presumably, the dataset
  * is held internally in the DecomposableFunctionType).
  *
+ * SGD can also take each step with a mini-batch of batchSize consecutive
+ * functions instead of a single one; the iterate then moves along the average
+ * of their gradients, and with shuffle the order of the batches is shuffled.
+ * If the DecomposableFunctionType implements
+ *
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t begin,
+ *                 const size_t batchSize,
+ *                 arma::mat& gradient);
+ *
+ * which should give the sum of the gradients of the functions begin, ...,
+ * begin + batchSize - 1, then each step is a single call (which can be one
+ * vectorized matrix operation); otherwise the gradients of the functions in the
+ * batch are computed one by one and summed.
+ *
+ * By default the objective of each pass is the sum of the objectives of each
+ * function, each evaluated just after the step that used it; this costs one
+ * Evaluate() per function, as much again as the steps themselves.  With
+ * objectiveSamples, this is skipped, and the objective is instead evaluated at
+ * the end of each pass on a fixed random sample of that many functions (scaled
+ * up to all of them); a value of at least NumFunctions() gives the exact
+ * objective at the end of each pass.
+ *
+ * For models with very many sparse features, the gradient of one function is
+ * mostly zero, so a dense step touches every coordinate for nothing.  If the
+ * DecomposableFunctionType also implements
+ *
+ *   void Gradient(const arma::mat& coordinates,
+ *                 const size_t i,
+ *                 arma::sp_mat& gradient);
+ *   void Support(const size_t i, arma::uvec& indices);
+ *   void Regularization(arma::mat& lambdas);
+ *
+ * where the sparse Gradient() is the gradient of function i without its L2
+ * regularization term, Support() gives the (linear) indices of the coordinates
+ * function i depends on, which must include the nonzeros of its sparse
+ * gradient, and Regularization() gives the coefficient of the L2
+ * regularization term (lambdas[j] / 2) * coordinates[j]^2 that each function
+ * has for each coordinate, then steps with one function (batchSize of 1) when
+ * objectiveSamples is nonzero only touch the coordinates in the support of that
+ * function.  The regularization is applied lazily: a coordinate that is not
+ * used for some steps gets the decay of all of them at once the next time it
+ * is used, or at the end of the pass, so the result is the same as with dense
+ * steps.
+ *
+ * How a step moves the iterate is given by the UpdatePolicyType, which must
+ * implement
+ *
+ *   void Initialize(const size_t rows, const size_t cols);
+ *   void Update(arma::mat& iterate,
+ *               const double stepSize,
+ *               const arma::mat& gradient);
+ *
+ * where Initialize() is called at the start of each optimization, with the
+ * size of the iterate, and Update() takes each step with the (average)
+ * gradient of its functions.  VanillaUpdate takes the plain step above;
+ * MomentumUpdate, AdaGradUpdate, RMSPropUpdate and AdamUpdate adapt the steps
+ * with what they have seen of the gradients, which usually needs far fewer
+ * passes on badly scaled problems.  These are available with one template
+ * parameter, for methods that take an optimizer type (such as
+ * LogisticRegression<Adam>), as SGD, MomentumSGD, AdaGrad, RMSProp and Adam.
+ * Only VanillaUpdate takes sparse steps.
+ *
  * @tparam DecomposableFunctionType Decomposable objective function type to be
  *     minimized.
+ * @tparam UpdatePolicyType Policy that takes each step.
  */
-template<typename DecomposableFunctionType>
-class SGD
+template<typename DecomposableFunctionType,
+         typename UpdatePolicyType = VanillaUpdate>
+class StochasticGradientDescent
 {
  public:
   /**
@@ -81,12 +152,20 @@ class SGD
    * @param tolerance Maximum absolute tolerance to terminate algorithm.
    * @param shuffle If true, the function order is shuffled; otherwise, each
    *     function is visited in linear order.
+   * @param batchSize Number of functions used for each step.
+   * @param objectiveSamples If nonzero, the objective is only evaluated at the
+   *     end of each pass, on this many functions.
+   * @param updatePolicy Instantiated policy that takes each step.
    */
-  SGD(DecomposableFunctionType& function,
-      const double stepSize = 0.01,
-      const size_t maxIterations = 100000,
-      const double tolerance = 1e-5,
-      const bool shuffle = true);
+  StochasticGradientDescent(DecomposableFunctionType& function,
+                            const double stepSize = 0.01,
+                            const size_t maxIterations = 100000,
+                            const double tolerance = 1e-5,
+                            const bool shuffle = true,
+                            const size_t batchSize = 1,
+                            const size_t objectiveSamples = 0,
+                            const UpdatePolicyType& updatePolicy =
+                                UpdatePolicyType());
 
   /**
    * Optimize the given function using stochastic gradient descent.  The given
@@ -123,6 +202,23 @@ class SGD
   //! Modify whether or not the individual functions are shuffled.
   bool& Shuffle() { return shuffle; }
 
+  //! Get the number of functions used for each step.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the number of functions used for each step.
+  size_t& BatchSize() { return batchSize; }
+
+  //! Get the number of functions the objective is evaluated on at the end of
+  //! each pass (0 means it is accumulated during the pass).
+  size_t ObjectiveSamples() const { return objectiveSamples; }
+  //! Modify the number of functions the objective is evaluated on at the end
+  //! of each pass (0 means it is accumulated during the pass).
+  size_t& ObjectiveSamples() { return objectiveSamples; }
+
+  //! Get the update policy.
+  const UpdatePolicyType& UpdatePolicy() const { return updatePolicy; }
+  //! Modify the update policy.
+  UpdatePolicyType& UpdatePolicy() { return updatePolicy; }
+
   // convert the obkect into a string
   std::string ToString() const;
 
@@ -142,8 +238,48 @@ class SGD
   //! Controls whether or not the individual functions are shuffled when
   //! iterating.
   bool shuffle;
+
+  //! The number of functions used for each step.
+  size_t batchSize;
+
+  //! The number of functions the objective is evaluated on at the end of each
+  //! pass (0 means it is accumulated during the pass).
+  size_t objectiveSamples;
+
+  //! The policy that takes each step.
+  UpdatePolicyType updatePolicy;
+
+  /**
+   * Evaluate the objective on the given functions, scaled to the number of
+   * functions, or on all functions if none are given.
+   */
+  double SampledObjective(const arma::mat& iterate,
+                          const arma::uvec& functions);
 };
 
+//! Plain stochastic gradient descent.
+template<typename DecomposableFunctionType>
+using SGD = StochasticGradientDescent<DecomposableFunctionType, VanillaUpdate>;
+
+//! Stochastic gradient descent with momentum.
+template<typename DecomposableFunctionType>
+using MomentumSGD = StochasticGradientDescent<DecomposableFunctionType,
+    MomentumUpdate>;
+
+//! Stochastic gradient descent with AdaGrad steps.
+template<typename DecomposableFunctionType>
+using AdaGrad = StochasticGradientDescent<DecomposableFunctionType,
+    AdaGradUpdate>;
+
+//! Stochastic gradient descent with RMSProp steps.
+template<typename DecomposableFunctionType>
+using RMSProp = StochasticGradientDescent<DecomposableFunctionType,
+    RMSPropUpdate>;
+
+//! Stochastic gradient descent with Adam steps.
+template<typename DecomposableFunctionType>
+using Adam = StochasticGradientDescent<DecomposableFunctionType, AdamUpdate>;
+
 }; // namespace optimization
 }; // namespace mlpack
 
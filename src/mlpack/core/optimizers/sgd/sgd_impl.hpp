@@ -8,54 +8,271 @@
 #define __MLPACK_CORE_OPTIMIZERS_SGD_SGD_IMPL_HPP
 
 #include <mlpack/methods/regularized_svd/regularized_svd_function.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
 // In case it hasn't been included yet.
 #include "sgd.hpp"
 
 namespace mlpack {
 namespace optimization {
 
-template<typename DecomposableFunctionType>
-SGD<DecomposableFunctionType>::SGD(DecomposableFunctionType& function,
-                                   const double stepSize,
-                                   const size_t maxIterations,
-                                   const double tolerance,
-                                   const bool shuffle) :
+//! Detect whether a function can compute the gradient of a batch of functions.
+HAS_MEM_FUNC(Gradient, HasBatchGradient);
+
+//! Whether or not the given function type has a batch Gradient() (const or
+//! not).
+template<typename FunctionType>
+struct HasBatchGradientFunction
+{
+  static const bool value =
+      HasBatchGradient<FunctionType, void (FunctionType::*)(const arma::mat&,
+          const size_t, const size_t, arma::mat&) const>::value ||
+      HasBatchGradient<FunctionType, void (FunctionType::*)(const arma::mat&,
+          const size_t, const size_t, arma::mat&)>::value;
+};
+
+//! Compute the summed gradient of a batch of functions with one call, for
+//! functions that support it.
+template<typename FunctionType>
+inline typename boost::enable_if_c<
+    HasBatchGradientFunction<FunctionType>::value>::type
+BatchGradient(FunctionType& function,
+              const arma::mat& iterate,
+              const size_t begin,
+              const size_t batchSize,
+              arma::mat& gradient)
+{
+  function.Gradient(iterate, begin, batchSize, gradient);
+}
+
+//! Compute the summed gradient of a batch of functions one function at a time,
+//! for functions that can only compute the gradient of a single function.
+template<typename FunctionType>
+inline typename boost::disable_if_c<
+    HasBatchGradientFunction<FunctionType>::value>::type
+BatchGradient(FunctionType& function,
+              const arma::mat& iterate,
+              const size_t begin,
+              const size_t batchSize,
+              arma::mat& gradient)
+{
+  function.Gradient(iterate, begin, gradient);
+  arma::mat pointGradient;
+  for (size_t j = begin + 1; j < begin + batchSize; ++j)
+  {
+    function.Gradient(iterate, j, pointGradient);
+    gradient += pointGradient;
+  }
+}
+
+//! Detect whether a function can compute a sparse gradient of one function.
+HAS_MEM_FUNC(Gradient, HasSparseGradient);
+
+//! Whether or not the given function type has a sparse Gradient() (const or
+//! not).
+template<typename FunctionType>
+struct HasSparseGradientFunction
+{
+  static const bool value =
+      HasSparseGradient<FunctionType, void (FunctionType::*)(const arma::mat&,
+          const size_t, arma::sp_mat&) const>::value ||
+      HasSparseGradient<FunctionType, void (FunctionType::*)(const arma::mat&,
+          const size_t, arma::sp_mat&)>::value;
+};
+
+/**
+ * For functions with a sparse gradient, get the factor each coordinate is
+ * multiplied by in a step because of its L2 regularization, and return true.
+ */
+template<typename FunctionType>
+inline typename boost::enable_if_c<
+    HasSparseGradientFunction<FunctionType>::value, bool>::type
+SparseStepDecay(FunctionType& function,
+                const double stepSize,
+                arma::mat& decay)
+{
+  function.Regularization(decay);
+  decay = 1.0 - stepSize * decay;
+  return true;
+}
+
+//! Functions without a sparse gradient can't take sparse steps.
+template<typename FunctionType>
+inline typename boost::disable_if_c<
+    HasSparseGradientFunction<FunctionType>::value, bool>::type
+SparseStepDecay(FunctionType& /* function */,
+                const double /* stepSize */,
+                arma::mat& /* decay */)
+{
+  return false;
+}
+
+/**
+ * Take step number 'step' with the sparse gradient of function i.  The L2
+ * regularization of a coordinate is applied lazily: lastStep holds the last
+ * step whose decay has been applied to each coordinate, and the decay that a
+ * coordinate has missed is applied all at once just before function i reads
+ * it.  So only the coordinates function i depends on are touched.
+ */
+template<typename FunctionType>
+inline typename boost::enable_if_c<
+    HasSparseGradientFunction<FunctionType>::value>::type
+SparseStep(FunctionType& function,
+           arma::mat& iterate,
+           const size_t i,
+           const double stepSize,
+           const arma::mat& decay,
+           const size_t step,
+           arma::Col<size_t>& lastStep,
+           arma::uvec& support,
+           arma::sp_mat& gradient)
+{
+  // Bring the coordinates up to date with the decay of the earlier steps.
+  function.Support(i, support);
+  for (size_t k = 0; k < support.n_elem; ++k)
+  {
+    const size_t j = support[k];
+    if (lastStep[j] + 1 < step)
+      iterate[j] *= std::pow(decay[j], (double) (step - 1 - lastStep[j]));
+  }
+
+  function.Gradient(iterate, i, gradient);
+
+  // The decay of this step, and then the gradient of the loss.
+  for (size_t k = 0; k < support.n_elem; ++k)
+  {
+    const size_t j = support[k];
+    iterate[j] *= decay[j];
+    lastStep[j] = step;
+  }
+  for (arma::sp_mat::const_iterator it = gradient.begin();
+       it != gradient.end(); ++it)
+    iterate(it.row(), it.col()) -= stepSize * (*it);
+}
+
+//! Functions without a sparse gradient can't take sparse steps.
+template<typename FunctionType>
+inline typename boost::disable_if_c<
+    HasSparseGradientFunction<FunctionType>::value>::type
+SparseStep(FunctionType& /* function */,
+           arma::mat& /* iterate */,
+           const size_t /* i */,
+           const double /* stepSize */,
+           const arma::mat& /* decay */,
+           const size_t /* step */,
+           arma::Col<size_t>& /* lastStep */,
+           arma::uvec& /* support */,
+           arma::sp_mat& /* gradient */)
+{ }
+
+//! Apply the decay every coordinate has missed after the given number of sparse
+//! steps.
+inline void CatchUpDecay(arma::mat& iterate,
+                         const arma::mat& decay,
+                         const size_t step,
+                         arma::Col<size_t>& lastStep)
+{
+  for (size_t j = 0; j < iterate.n_elem; ++j)
+  {
+    if (lastStep[j] < step)
+      iterate[j] *= std::pow(decay[j], (double) (step - lastStep[j]));
+    lastStep[j] = step;
+  }
+}
+
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+StochasticGradientDescent<DecomposableFunctionType, UpdatePolicyType>::
+StochasticGradientDescent(DecomposableFunctionType& function,
+                          const double stepSize,
+                          const size_t maxIterations,
+                          const double tolerance,
+                          const bool shuffle,
+                          const size_t batchSize,
+                          const size_t objectiveSamples,
+                          const UpdatePolicyType& updatePolicy) :
     function(function),
     stepSize(stepSize),
     maxIterations(maxIterations),
     tolerance(tolerance),
-    shuffle(shuffle)
+    shuffle(shuffle),
+    batchSize(std::max(batchSize, (size_t) 1)),
+    objectiveSamples(objectiveSamples),
+    updatePolicy(updatePolicy)
 { /* Nothing to do. */ }
 
 //! Optimize the function (minimize).
-template<typename DecomposableFunctionType>
-double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+double StochasticGradientDescent<DecomposableFunctionType, UpdatePolicyType>::
+Optimize(arma::mat& iterate)
 {
-  // Find the number of functions to use.
+  // Find the number of functions to use.  The functions are visited in
+  // batches of batchSize consecutive functions (the last one may be smaller).
   const size_t numFunctions = function.NumFunctions();
+  const size_t numBatches = (numFunctions + batchSize - 1) / batchSize;
 
   // This is used only if shuffle is true.
   arma::vec visitationOrder;
   if (shuffle)
-    visitationOrder = arma::shuffle(arma::linspace(0, (numFunctions - 1),
-        numFunctions));
+    visitationOrder = arma::shuffle(arma::linspace(0, (numBatches - 1),
+        numBatches));
+
+  // If the objective is only evaluated at the end of each pass, choose the
+  // functions it is evaluated on (none means all of them).
+  const bool passObjective = (objectiveSamples > 0);
+  arma::uvec objectiveFunctions;
+  if (passObjective && objectiveSamples < numFunctions)
+  {
+    objectiveFunctions = arma::shuffle(arma::linspace<arma::uvec>(0,
+        numFunctions - 1, numFunctions));
+    objectiveFunctions = objectiveFunctions.subvec(0, objectiveSamples - 1);
+  }
+
+  // Functions with a sparse gradient take sparse steps, one function at a
+  // time.  This needs the objective to be evaluated only at the end of each
+  // pass, when all the coordinates are brought up to date; the running
+  // objective would need every coordinate at every step.
+  arma::mat decay;
+  arma::Col<size_t> lastStep;
+  arma::uvec support;
+  arma::sp_mat sparseGradient;
+  const bool sparseSteps = (batchSize == 1) && passObjective &&
+      boost::is_same<UpdatePolicyType, VanillaUpdate>::value &&
+      SparseStepDecay(function, stepSize, decay);
+  size_t step = 0;
+  if (sparseSteps)
+    lastStep.zeros(iterate.n_elem);
 
   // To keep track of where we are and how things are going.
-  size_t currentFunction = 0;
+  size_t currentBatch = 0;
   double overallObjective = 0;
   double lastObjective = DBL_MAX;
 
   // Calculate the first objective function.
-  for (size_t i = 0; i < numFunctions; ++i)
-    overallObjective += function.Evaluate(iterate, i);
+  if (passObjective)
+  {
+    overallObjective = SampledObjective(iterate, objectiveFunctions);
+  }
+  else
+  {
+    for (size_t i = 0; i < numFunctions; ++i)
+      overallObjective += function.Evaluate(iterate, i);
+  }
 
-  // Now iterate!
+  // Now iterate!  Each step counts as one iteration per function it used.
   arma::mat gradient(iterate.n_rows, iterate.n_cols);
-  for (size_t i = 1; i != maxIterations; ++i, ++currentFunction)
+  updatePolicy.Initialize(iterate.n_rows, iterate.n_cols);
+  for (size_t i = 1; maxIterations == 0 || i < maxIterations; ++currentBatch)
   {
     // Is this iteration the start of a sequence?
-    if ((currentFunction % numFunctions) == 0)
+    if ((currentBatch % numBatches) == 0)
     {
+      // The objective of a finished pass may not have been accumulated.
+      if (passObjective && currentBatch > 0)
+      {
+        if (sparseSteps)
+          CatchUpDecay(iterate, decay, step, lastStep);
+        overallObjective = SampledObjective(iterate, objectiveFunctions);
+      }
+
       // Output current objective function.
       Log::Info << "SGD: iteration " << i << ", objective " << overallObjective
           << "." << std::endl;
@@ -77,31 +294,52 @@ double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
       // Reset the counter variables.
       lastObjective = overallObjective;
       overallObjective = 0;
-      currentFunction = 0;
+      currentBatch = 0;
 
       if (shuffle) // Determine order of visitation.
         visitationOrder = arma::shuffle(visitationOrder);
     }
 
-    // Evaluate the gradient for this iteration.
-    if (shuffle)
-      function.Gradient(iterate, visitationOrder[currentFunction], gradient);
-    else
-      function.Gradient(iterate, currentFunction, gradient);
+    // Find the functions of this step.
+    const size_t begin = batchSize * (shuffle ?
+        (size_t) visitationOrder[currentBatch] : currentBatch);
+    const size_t effectiveBatchSize = std::min(batchSize,
+        numFunctions - begin);
 
-    // And update the iterate.
-    iterate -= stepSize * gradient;
+    // Evaluate the gradient for this iteration, and update the iterate with
+    // the average gradient of the batch.
+    if (sparseSteps)
+    {
+      SparseStep(function, iterate, begin, stepSize, decay, ++step, lastStep,
+          support, sparseGradient);
+    }
+    else if (effectiveBatchSize == 1)
+    {
+      function.Gradient(iterate, begin, gradient);
+      updatePolicy.Update(iterate, stepSize, gradient);
+    }
+    else
+    {
+      BatchGradient(function, iterate, begin, effectiveBatchSize, gradient);
+      gradient /= effectiveBatchSize;
+      updatePolicy.Update(iterate, stepSize, gradient);
+    }
 
     // Now add that to the overall objective function.
-    if (shuffle)
-      overallObjective += function.Evaluate(iterate,
-          visitationOrder[currentFunction]);
-    else
-      overallObjective += function.Evaluate(iterate, currentFunction);
+    if (!passObjective)
+    {
+      for (size_t j = begin; j < begin + effectiveBatchSize; ++j)
+        overallObjective += function.Evaluate(iterate, j);
+    }
+
+    i += effectiveBatchSize;
   }
 
   Log::Info << "SGD: maximum iterations (" << maxIterations << ") reached; "
       << "terminating optimization." << std::endl;
+  if (sparseSteps)
+    CatchUpDecay(iterate, decay, step, lastStep);
+
   // Calculate final objective.
   overallObjective = 0;
   for (size_t i = 0; i < numFunctions; ++i)
@@ -109,9 +347,31 @@ double SGD<DecomposableFunctionType>::Optimize(arma::mat& iterate)
   return overallObjective;
 }
 
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+double StochasticGradientDescent<DecomposableFunctionType, UpdatePolicyType>::
+SampledObjective(
+    const arma::mat& iterate,
+    const arma::uvec& functions)
+{
+  const size_t numFunctions = function.NumFunctions();
+
+  double objective = 0;
+  if (functions.n_elem == 0)
+  {
+    for (size_t i = 0; i < numFunctions; ++i)
+      objective += function.Evaluate(iterate, i);
+    return objective;
+  }
+
+  for (size_t i = 0; i < functions.n_elem; ++i)
+    objective += function.Evaluate(iterate, functions[i]);
+  return objective * ((double) numFunctions / functions.n_elem);
+}
+
 // Convert the object to a string.
-template<typename DecomposableFunctionType>
-std::string SGD<DecomposableFunctionType>::ToString() const
+template<typename DecomposableFunctionType, typename UpdatePolicyType>
+std::string StochasticGradientDescent<DecomposableFunctionType,
+    UpdatePolicyType>::ToString() const
 {
   std::ostringstream convert;
   convert << "SGD [" << this << "]" << std::endl;
@@ -121,6 +381,8 @@ std::string SGD<DecomposableFunctionType>::ToString() const
   convert << "  Maximum iterations: " << maxIterations << std::endl;
   convert << "  Tolerance: " << tolerance << std::endl;
   convert << "  Shuffle points: " << (shuffle ? "true" : "false") << std::endl;
+  convert << "  Batch size: " << batchSize << std::endl;
+  convert << "  Objective samples: " << objectiveSamples << std::endl;
   return convert.str();
 }
 
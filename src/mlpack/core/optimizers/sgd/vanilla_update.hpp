@@ -0,0 +1,52 @@
+/**
+ * @file vanilla_update.hpp
+ *
+ * The plain SGD update, which moves the iterate along the gradient with a
+ * fixed step size.
+ */
+#ifndef __MLPACK_CORE_OPTIMIZERS_SGD_VANILLA_UPDATE_HPP
+#define __MLPACK_CORE_OPTIMIZERS_SGD_VANILLA_UPDATE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace optimization {
+
+/**
+ * The vanilla update policy takes the step
+ *
+ * \f[
+ * A_{j + 1} = A_j - \alpha \nabla f_i(A_j)
+ * \f]
+ *
+ * and keeps no state.  This is the update of the SGD optimizer, and the only
+ * one that can take sparse steps.
+ */
+class VanillaUpdate
+{
+ public:
+  /**
+   * Prepare for an optimization of an iterate of the given size (nothing to
+   * do).
+   */
+  void Initialize(const size_t /* rows */, const size_t /* cols */) { }
+
+  /**
+   * Update the iterate with the given gradient.
+   *
+   * @param iterate Iterate to be updated.
+   * @param stepSize Step size.
+   * @param gradient Gradient of the functions of this step.
+   */
+  void Update(arma::mat& iterate,
+              const double stepSize,
+              const arma::mat& gradient)
+  {
+    iterate -= stepSize * gradient;
+  }
+};
+
+}; // namespace optimization
+}; // namespace mlpack
+
+#endif
@@ -113,6 +113,17 @@ class BallBound
    */
   void Centroid(VecType& centroid) const { centroid = center; }
 
+  /**
+   * Place the centroid of BallBound into the given vector, which holds a
+   * different element type than the bound (for instance, the centroid of a
+   * single precision bound can be stored in an arma::vec).
+   *
+   * @param centroid Vector which the centroid will be written to.
+   */
+  template<typename OtherVecType>
+  void Centroid(OtherVecType& centroid) const
+  { centroid = arma::conv_to<OtherVecType>::from(center); }
+
   /**
    * Calculates minimum bound-to-point squared distance.
    */
@@ -220,6 +220,11 @@ BallBound<VecType, TMetricType>::operator|=(
  * Jack Ritter, "An Efficient Bounding Sphere" in Graphics Gems (1990).
  * The difference lies in the way we initialize the ball bound. The way we
  * expand the bound is same.
+ *
+ * If the bound is empty, it is instead set to the ball around the centroid of
+ * the points which just contains them; this is usually much tighter than the
+ * ball found by expanding from the first point, and it is what trees building
+ * a bound from all of a node's points at once get.
  */
 template<typename VecType, typename TMetricType>
 template<typename MatType>
@@ -229,7 +234,16 @@ BallBound<VecType, TMetricType>::operator|=(const MatType& data)
   if (radius < 0)
   {
     center = data.col(0);
+    for (size_t i = 1; i < data.n_cols; ++i)
+      center += data.col(i);
+    center /= data.n_cols;
+
     radius = 0;
+    for (size_t i = 0; i < data.n_cols; ++i)
+      radius = std::max(radius, metric->Evaluate(center,
+          (VecType) data.col(i)));
+
+    return *this;
   }
 
   // Now iteratively add points.
@@ -242,7 +256,7 @@ BallBound<VecType, TMetricType>::operator|=(const MatType& data)
     {
       // Move towards the new point and increase the radius just enough to
       // accomodate the new point.
-      arma::vec diff = data.col(i) - center;
+      VecType diff = data.col(i) - center;
       center += ((dist - radius) / (2 * dist)) * diff;
       radius = 0.5 * (dist + radius);
     }
@@ -0,0 +1,56 @@
+/**
+ * @file base_case_range.hpp
+ *
+ * A helper used by tree traversers to evaluate the base case between one query
+ * point and a contiguous range of reference points.  If the rules used for the
+ * traversal provide a batched BaseCaseRange() method, it is called once for
+ * the whole range; otherwise, BaseCase() is called for each reference point.
+ */
+#ifndef __MLPACK_CORE_TREE_BASE_CASE_RANGE_HPP
+#define __MLPACK_CORE_TREE_BASE_CASE_RANGE_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
+
+namespace mlpack {
+namespace tree {
+
+HAS_MEM_FUNC(BaseCaseRange, HasBaseCaseRange);
+
+/**
+ * Evaluate the base case between the given query point and each reference
+ * point in [referenceBegin, referenceEnd), using the batched BaseCaseRange()
+ * method of the rules.
+ */
+template<typename RuleType>
+inline typename boost::enable_if_c<HasBaseCaseRange<RuleType,
+    void (RuleType::*)(const size_t, const size_t, const size_t)>::value>::type
+BaseCases(RuleType& rule,
+          const size_t queryIndex,
+          const size_t referenceBegin,
+          const size_t referenceEnd)
+{
+  rule.BaseCaseRange(queryIndex, referenceBegin, referenceEnd);
+}
+
+/**
+ * Evaluate the base case between the given query point and each reference
+ * point in [referenceBegin, referenceEnd), one point at a time, for rules that
+ * do not provide BaseCaseRange().
+ */
+template<typename RuleType>
+inline typename boost::disable_if_c<HasBaseCaseRange<RuleType,
+    void (RuleType::*)(const size_t, const size_t, const size_t)>::value>::type
+BaseCases(RuleType& rule,
+          const size_t queryIndex,
+          const size_t referenceBegin,
+          const size_t referenceEnd)
+{
+  for (size_t ref = referenceBegin; ref < referenceEnd; ++ref)
+    rule.BaseCase(queryIndex, ref);
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
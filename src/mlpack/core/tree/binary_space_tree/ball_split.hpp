@@ -0,0 +1,99 @@
+/**
+ * @file ball_split.hpp
+ *
+ * Definition of BallSplit, a class that splits a ball tree node into two parts
+ * around two far-apart pivot points, using only distances between points.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BALL_SPLIT_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BALL_SPLIT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace tree /** Trees and tree-building procedures. */ {
+
+/**
+ * A ball tree node is split into its left and right child around two pivots:
+ * the point furthest from the center of the node's ball, and the point furthest
+ * from that one.  Each point goes to the child of the pivot it is closer to.
+ * Only distances computed with the metric of the bound are used, so this works
+ * for any metric, and the two groups of points are compact, so the balls of the
+ * children are small.  Use it with BallBound:
+ *
+ * @code
+ * typedef BinarySpaceTree<bound::BallBound<>, StatisticType, arma::mat,
+ *     BallSplit<bound::BallBound<>, arma::mat> > BallTreeType;
+ * @endcode
+ *
+ * There is no split dimension, so the split dimension of each node is set to
+ * the dimensionality of the data.
+ *
+ * @tparam BoundType Type of bound; it must have Center() and Metric(), as
+ *     BallBound does.
+ */
+template<typename BoundType, typename MatType = arma::mat>
+class BallSplit
+{
+ public:
+  /**
+   * Split the node around two far-apart pivots.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be set to the dimensionality of the data.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol);
+
+  /**
+   * Split the node around two far-apart pivots and return a list of changed
+   * indices.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be set to the dimensionality of the data.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   * @param oldFromNew Vector which will be filled with the old positions for
+   *    each new point.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>& oldFromNew);
+
+ private:
+  /**
+   * Split the node, updating oldFromNew if it is not NULL.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>* oldFromNew);
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+// Include implementation.
+#include "ball_split_impl.hpp"
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file ball_split_impl.hpp
+ *
+ * Implementation of class (BallSplit) to split a ball tree.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BALL_SPLIT_IMPL_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BALL_SPLIT_IMPL_HPP
+
+#include "ball_split.hpp"
+#include "split_utility.hpp"
+
+namespace mlpack {
+namespace tree {
+
+template<typename BoundType, typename MatType>
+bool BallSplit<BoundType, MatType>::SplitNode(const BoundType& bound,
+                                              MatType& data,
+                                              const size_t begin,
+                                              const size_t count,
+                                              size_t& splitDimension,
+                                              size_t& splitCol)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      (std::vector<size_t>*) NULL);
+}
+
+template<typename BoundType, typename MatType>
+bool BallSplit<BoundType, MatType>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>& oldFromNew)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      &oldFromNew);
+}
+
+template<typename BoundType, typename MatType>
+bool BallSplit<BoundType, MatType>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>* oldFromNew)
+{
+  splitDimension = data.n_rows; // There is no split dimension.
+
+  typename BoundType::MetricType metric = bound.Metric();
+  typedef typename BoundType::Vec VecType;
+
+  // The first pivot is the point furthest from the center.
+  size_t firstPivot = begin;
+  double maxDistance = -1;
+  for (size_t i = begin; i < begin + count; ++i)
+  {
+    const double distance = metric.Evaluate(bound.Center(),
+        (VecType) data.col(i));
+    if (distance > maxDistance)
+    {
+      maxDistance = distance;
+      firstPivot = i;
+    }
+  }
+
+  // The second pivot is the point furthest from the first pivot.  The
+  // distances to the first pivot are kept.
+  const VecType first = (VecType) data.col(firstPivot);
+  arma::vec firstDistances(count);
+  size_t secondPivot = begin;
+  maxDistance = -1;
+  for (size_t i = begin; i < begin + count; ++i)
+  {
+    firstDistances[i - begin] = metric.Evaluate(first, (VecType) data.col(i));
+    if (firstDistances[i - begin] > maxDistance)
+    {
+      maxDistance = firstDistances[i - begin];
+      secondPivot = i;
+    }
+  }
+
+  if (maxDistance == 0) // All these points are the same.  We can't split.
+    return false;
+
+  // Points closer to the first pivot come first.  The first pivot has key
+  // -maxDistance and the second has key maxDistance, so neither side is empty.
+  const VecType second = (VecType) data.col(secondPivot);
+  arma::vec keys(count);
+  for (size_t i = begin; i < begin + count; ++i)
+    keys[i - begin] = firstDistances[i - begin] -
+        metric.Evaluate(second, (VecType) data.col(i));
+
+  splitCol = PartitionColumns(data, begin, keys, 0.0, oldFromNew);
+
+  return true;
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
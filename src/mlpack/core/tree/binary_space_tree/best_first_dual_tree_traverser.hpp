@@ -0,0 +1,43 @@
+/**
+ * @file best_first_dual_tree_traverser.hpp
+ *
+ * Defines the BestFirstDualTreeTraverser for the BinarySpaceTree tree type.
+ * This is a nested class of BinarySpaceTree which traverses two trees
+ * best-first, always visiting the node combination with the best score next;
+ * see PriorityDualTreeTraverser.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BEST_FIRST_DUAL_TREE_TRAVERSER_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BEST_FIRST_DUAL_TREE_TRAVERSER_HPP
+
+#include <mlpack/core.hpp>
+
+#include "binary_space_tree.hpp"
+#include "../priority_dual_tree_traverser.hpp"
+
+namespace mlpack {
+namespace tree {
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+template<typename RuleType>
+class BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    BestFirstDualTreeTraverser :
+    public PriorityDualTreeTraverser<
+        BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>,
+        RuleType>
+{
+ public:
+  /**
+   * Instantiate the dual-tree traverser with the given rule set.
+   */
+  BestFirstDualTreeTraverser(RuleType& rule) :
+      PriorityDualTreeTraverser<BinarySpaceTree, RuleType>(rule)
+  { /* Nothing to do. */ }
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif // __MLPACK_CORE_TREE_BINARY_SPACE_TREE_BEST_FIRST_DUAL_TREE_TRAVERSER_HPP
@@ -8,6 +8,11 @@
 
 #include <mlpack/core.hpp>
 #include "mean_split.hpp"
+#include "median_split.hpp"
+#include "sliding_midpoint_split.hpp"
+#include "pca_split.hpp"
+#include "ball_split.hpp"
+#include "vp_tree_split.hpp"
 
 #include "../statistic.hpp"
 
@@ -35,7 +40,10 @@ namespace tree /** Trees and tree-building procedures. */ {
  * @tparam MatType The dataset class.
  * @tparam SplitType The class that partitions the dataset/points at a
  *     particular node into two parts. Its definition decides the way this split
- *     is done.
+ *     is done: MeanSplit (the middle of the widest dimension), MedianSplit
+ *     (balanced), SlidingMidpointSplit and PCASplit (along the principal
+ *     direction) are available, and with BallBound, BallSplit gives a ball tree
+ *     and VPTreeSplit gives a vantage point tree.
  */
 template<typename BoundType,
          typename StatisticType = EmptyStatistic,
@@ -73,6 +81,13 @@ class BinarySpaceTree
   double minimumBoundDistance;
   //! The dataset.
   MatType& dataset;
+  //! If this is the root of a compacted tree, the contiguous block of memory
+  //! holding every other node of the tree (see Compact()).
+  BinarySpaceTree* nodePool;
+  //! The number of nodes in nodePool.
+  size_t nodePoolSize;
+  //! Whether or not this node is stored in its root's nodePool.
+  bool pooled;
 
  public:
   //! So other classes can use TreeType::Mat.
@@ -90,6 +105,11 @@ class BinarySpaceTree
   template<typename RuleType>
   class BreadthFirstDualTreeTraverser;
 
+  //! A best-first dual-tree traverser for binary space trees; see
+  //! best_first_dual_tree_traverser.hpp.
+  template<typename RuleType>
+  class BestFirstDualTreeTraverser;
+
   /**
    * Construct this as the root node of a binary space tree using the given
    * dataset.  This will modify the ordering of the points in the dataset!
@@ -210,6 +230,49 @@ class BinarySpaceTree
    */
   BinarySpaceTree(const BinarySpaceTree& other);
 
+  /**
+   * Create a binary space tree by deep-copying the other tree, but referring to
+   * the given dataset instead of the dataset of the other tree.  The dataset
+   * must hold the points of the other tree at the same indices (for instance,
+   * it can be a copy of the other tree's dataset).  The new tree is a root, is
+   * not compact, and the statistics of its nodes are built anew.
+   *
+   * @param other Tree to be replicated.
+   * @param data Dataset which the copy refers to.
+   */
+  BinarySpaceTree(const BinarySpaceTree& other, MatType& data);
+
+  /**
+   * Load a tree that was previously stored with Save().  The given dataset
+   * must be the same dataset (in its original ordering) that the stored tree
+   * was built on; it will be reordered exactly as the original build reordered
+   * it, and oldFromNew will be filled with the stored mapping.  No splitting is
+   * performed, so this is much faster than building the tree again; the bounds
+   * and statistics are recalculated from the reordered points.  If the stream
+   * does not hold a tree, or the tree does not match the dataset, a fatal
+   * error is thrown.
+   *
+   * @param data Dataset the stored tree was built on.  This will be modified!
+   * @param oldFromNew Vector which will be filled with the old positions for
+   *     each new point.
+   * @param stream Binary stream to read the tree from.
+   */
+  BinarySpaceTree(MatType& data,
+                  std::vector<size_t>& oldFromNew,
+                  std::istream& stream);
+
+  /**
+   * Store this tree (which should be the root of its tree) in the given binary
+   * stream, so that it can be loaded later without rebuilding it.  The stored
+   * tree holds the point permutation (oldFromNew) and the layout of every node,
+   * but not the dataset itself.
+   *
+   * @param stream Binary stream to write the tree to.
+   * @param oldFromNew Mapping of new point positions to old point positions,
+   *     as filled in when the tree was built.
+   */
+  void Save(std::ostream& stream, const std::vector<size_t>& oldFromNew) const;
+
   /**
    * Deletes this node, deallocating the memory for the children and calling
    * their destructors in turn.  This will invalidate any pointers or references
@@ -217,6 +280,27 @@ class BinarySpaceTree
    */
   ~BinarySpaceTree();
 
+  /**
+   * Move all the nodes of this tree into a single contiguous block of memory,
+   * ordered depth-first (the order in which the traversers visit them).  Nodes
+   * are normally allocated one at a time, so they can end up scattered across
+   * the heap; compacting the tree makes traversals of large trees much more
+   * cache-friendly.  This must be called on the root of the tree, and it
+   * invalidates any pointers to nodes other than the root.  The statistics of
+   * each node are recalculated.  Calling this on a tree that is already compact
+   * does nothing.
+   *
+   * Like the nodes of a tree which is being built, the subtrees of large trees
+   * are copied by several OpenMP threads, so on NUMA machines the pool is spread
+   * over the memory of the nodes those threads run on, rather than being placed
+   * on a single node.
+   */
+  void Compact();
+
+  //! Return whether or not the nodes of this tree are stored contiguously (see
+  //! Compact()).
+  bool IsCompact() const { return (nodePool != NULL) || pooled; }
+
   /**
    * Find a node in this tree by its begin and count (const).
    *
@@ -463,8 +547,72 @@ class BinarySpaceTree
     return new BinarySpaceTree(begin, count, bound, stat, maxLeafSize);
   }
 
+  /**
+   * Private constructor used to load a child node (and its children) from a
+   * stream written by Save().
+   *
+   * @param data Dataset the tree is built on, already reordered.
+   * @param parent Parent of this node.
+   * @param stream Binary stream to read from.
+   */
+  BinarySpaceTree(MatType& data,
+                  BinarySpaceTree* parent,
+                  std::istream& stream);
+
+  /**
+   * Private copy constructor used by Compact(): copy the given node, but none
+   * of its children, and mark it as part of a node pool.
+   *
+   * @param other Node to copy.
+   * @param parent Parent of the new node.
+   */
+  BinarySpaceTree(const BinarySpaceTree& other, BinarySpaceTree* parent);
+
+  //! A node which Compact() has yet to copy into the node pool.
+  struct PoolEntry
+  {
+    //! The node to copy.
+    BinarySpaceTree* node;
+    //! The copy of its parent.
+    BinarySpaceTree* parent;
+    //! Whether it is the left child of its parent.
+    bool isLeft;
+    //! The slot of the pool to copy it into (only set for deferred subtrees).
+    size_t index;
+  };
+
+  /**
+   * Copy the given nodes and their descendants into the node pool in
+   * depth-first order, starting at the given slot.  The nodes are popped from
+   * the back of the stack.  If deferred is not NULL, subtrees with fewer than
+   * ParallelSplitThreshold points are not copied; their slots are reserved,
+   * and they are added to deferred, to be copied by another call.
+   *
+   * @param stack Nodes to copy, with the copies of their parents.
+   * @param index Slot of the pool to copy the first node into.
+   * @param deferred If not NULL, list of subtrees which are left to copy.
+   */
+  void CompactNodes(std::vector<PoolEntry>& stack,
+                    size_t index,
+                    std::vector<PoolEntry>* deferred);
+
+  //! Write the record for this node and its children to the stream.
+  void SaveNode(std::ostream& stream) const;
+
+  //! Read the record for this node from the stream, then load its children.
+  void LoadNode(std::istream& stream);
+
+  /**
+   * Nodes with at least this many points build their two children as separate
+   * OpenMP tasks; below this size, the overhead of a task is larger than the
+   * work saved.
+   */
+  static const size_t ParallelSplitThreshold = 10000;
+
   /**
    * Splits the current node, assigning its left and right children recursively.
+   * The children hold disjoint ranges of the dataset, so if OpenMP is enabled,
+   * large nodes build their children concurrently.
    *
    * @param data Dataset which we are using.
    */
@@ -472,7 +620,10 @@ class BinarySpaceTree
 
   /**
    * Splits the current node, assigning its left and right children recursively.
-   * Also returns a list of the changed indices.
+   * Also returns a list of the changed indices.  As with the other overload,
+   * the children may be built concurrently; each child only touches its own
+   * range of oldFromNew, so the resulting permutation is the same as the one
+   * produced by a serial build.
    *
    * @param data Dataset which we are using.
    * @param oldFromNew Vector holding permuted indices.
@@ -12,6 +12,7 @@
 #include <mlpack/core/util/cli.hpp>
 #include <mlpack/core/util/log.hpp>
 #include <mlpack/core/util/string_util.hpp>
+#include <mlpack/core/util/binary_io.hpp>
 
 namespace mlpack {
 namespace tree {
@@ -33,10 +34,18 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     maxLeafSize(maxLeafSize),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(data)
+    dataset(data),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
 {
-  // Do the actual splitting of this node.
-  SplitNode(data);
+  // Do the actual splitting of this node.  The children of large nodes are
+  // built as OpenMP tasks, which need an enclosing parallel region.
+  #pragma omp parallel if (count >= ParallelSplitThreshold)
+  {
+    #pragma omp single
+    SplitNode(data);
+  }
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
@@ -58,15 +67,23 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     maxLeafSize(maxLeafSize),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(data)
+    dataset(data),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
 {
   // Initialize oldFromNew correctly.
   oldFromNew.resize(data.n_cols);
   for (size_t i = 0; i < data.n_cols; i++)
     oldFromNew[i] = i; // Fill with unharmed indices.
 
-  // Now do the actual splitting.
-  SplitNode(data, oldFromNew);
+  // Now do the actual splitting.  The children of large nodes are built as
+  // OpenMP tasks, which need an enclosing parallel region.
+  #pragma omp parallel if (count >= ParallelSplitThreshold)
+  {
+    #pragma omp single
+    SplitNode(data, oldFromNew);
+  }
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
@@ -89,15 +106,23 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     maxLeafSize(maxLeafSize),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(data)
+    dataset(data),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
 {
   // Initialize the oldFromNew vector correctly.
   oldFromNew.resize(data.n_cols);
   for (size_t i = 0; i < data.n_cols; i++)
     oldFromNew[i] = i; // Fill with unharmed indices.
 
-  // Now do the actual splitting.
-  SplitNode(data, oldFromNew);
+  // Now do the actual splitting.  The children of large nodes are built as
+  // OpenMP tasks, which need an enclosing parallel region.
+  #pragma omp parallel if (count >= ParallelSplitThreshold)
+  {
+    #pragma omp single
+    SplitNode(data, oldFromNew);
+  }
 
   // Create the statistic depending on if we are a leaf or not.
   stat = StatisticType(*this);
@@ -125,7 +150,10 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     count(count),
     maxLeafSize(maxLeafSize),
     bound(data.n_rows),
-    dataset(data)
+    dataset(data),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
 {
   // Perform the actual splitting.
   SplitNode(data);
@@ -152,7 +180,10 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     count(count),
     maxLeafSize(maxLeafSize),
     bound(data.n_rows),
-    dataset(data)
+    dataset(data),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
 {
   // Hopefully the vector is initialized correctly!  We can't check that
   // entirely but we can do a minor sanity check.
@@ -184,7 +215,10 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     count(count),
     maxLeafSize(maxLeafSize),
     bound(data.n_rows),
-    dataset(data)
+    dataset(data),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
 {
   // Hopefully the vector is initialized correctly!  We can't check that
   // entirely but we can do a minor sanity check.
@@ -238,7 +272,10 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
     splitDimension(other.splitDimension),
     parentDistance(other.parentDistance),
     furthestDescendantDistance(other.furthestDescendantDistance),
-    dataset(other.dataset)
+    dataset(other.dataset),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
 {
   // Create left and right children (if any).
   if (other.Left())
@@ -254,6 +291,235 @@ BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
   }
 }
 
+/**
+ * Deep-copy the other tree, referring to the given dataset.
+ */
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
+    const BinarySpaceTree& other,
+    MatType& data) :
+    left(NULL),
+    right(NULL),
+    parent(NULL),
+    begin(other.begin),
+    count(other.count),
+    maxLeafSize(other.maxLeafSize),
+    bound(other.bound),
+    splitDimension(other.splitDimension),
+    parentDistance(other.parentDistance),
+    furthestDescendantDistance(other.furthestDescendantDistance),
+    dataset(data),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
+{
+  if (other.Left())
+  {
+    left = new BinarySpaceTree(*other.Left(), data);
+    left->Parent() = this;
+  }
+
+  if (other.Right())
+  {
+    right = new BinarySpaceTree(*other.Right(), data);
+    right->Parent() = this;
+  }
+
+  // The children are complete, so the statistic can be built.
+  stat = StatisticType(*this);
+}
+
+/**
+ * Load a tree that was previously stored with Save().  The dataset is reordered
+ * to match the stored tree, and then the nodes are rebuilt from their stored
+ * records.
+ */
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
+    MatType& data,
+    std::vector<size_t>& oldFromNew,
+    std::istream& stream) :
+    left(NULL),
+    right(NULL),
+    parent(NULL),
+    begin(0),
+    count(data.n_cols),
+    bound(data.n_rows),
+    parentDistance(0), // Parent distance for the root is 0: it has no parent.
+    dataset(data),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
+{
+  // Check the header, so that we don't try to load something that isn't a
+  // tree (or a tree built on a different dataset).
+  size_t magic, version, rows, cols;
+  util::ReadBinary(stream, magic);
+  util::ReadBinary(stream, version);
+  if (magic != 0x42535054 /* "BSPT" */ || version != 1)
+    Log::Fatal << "BinarySpaceTree: stream does not hold a stored binary space "
+        << "tree." << std::endl;
+
+  util::ReadBinary(stream, rows);
+  util::ReadBinary(stream, cols);
+  if (rows != data.n_rows || cols != data.n_cols)
+    Log::Fatal << "BinarySpaceTree: stored tree was built on a " << rows << "x"
+        << cols << " dataset, but the given dataset is " << data.n_rows << "x"
+        << data.n_cols << "." << std::endl;
+
+  util::ReadBinary(stream, maxLeafSize);
+  util::ReadBinary(stream, oldFromNew);
+  if (oldFromNew.size() != data.n_cols)
+    Log::Fatal << "BinarySpaceTree: stored point mapping has "
+        << oldFromNew.size() << " points, but the dataset has " << data.n_cols
+        << " points." << std::endl;
+
+  // The mapping must be a permutation of the points, or the dataset can't be
+  // reordered with it.
+  std::vector<char> mapped(data.n_cols, 0);
+  for (size_t i = 0; i < oldFromNew.size(); i++)
+  {
+    if (oldFromNew[i] >= data.n_cols || mapped[oldFromNew[i]])
+      Log::Fatal << "BinarySpaceTree: stored point mapping is not a "
+          << "permutation of the points." << std::endl;
+    mapped[oldFromNew[i]] = 1;
+  }
+
+  // Reorder the dataset the same way the original build did.
+  MatType oldData(data);
+  for (size_t i = 0; i < data.n_cols; i++)
+    data.col(i) = oldData.col(oldFromNew[i]);
+
+  // Now load the nodes themselves.  The root must hold every point.
+  LoadNode(stream);
+  if (begin != 0 || count != data.n_cols)
+    Log::Fatal << "BinarySpaceTree: stored root node [" << begin << ", "
+        << begin + count << ") does not hold the whole dataset." << std::endl;
+
+  // Create the statistic depending on if we are a leaf or not.
+  stat = StatisticType(*this);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
+    MatType& data,
+    BinarySpaceTree* parent,
+    std::istream& stream) :
+    left(NULL),
+    right(NULL),
+    parent(parent),
+    maxLeafSize(parent->MaxLeafSize()),
+    bound(data.n_rows),
+    dataset(data),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false)
+{
+  LoadNode(stream);
+
+  // Create the statistic depending on if we are a leaf or not.
+  stat = StatisticType(*this);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::Save(
+    std::ostream& stream,
+    const std::vector<size_t>& oldFromNew) const
+{
+  const size_t magic = 0x42535054; // "BSPT".
+  const size_t version = 1;
+  util::WriteBinary(stream, magic);
+  util::WriteBinary(stream, version);
+  util::WriteBinary(stream, (size_t) dataset.n_rows);
+  util::WriteBinary(stream, (size_t) dataset.n_cols);
+  util::WriteBinary(stream, maxLeafSize);
+  util::WriteBinary(stream, oldFromNew);
+
+  SaveNode(stream);
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SaveNode(
+    std::ostream& stream) const
+{
+  // Each node is stored in preorder as its range of points, its split
+  // dimension, and whether or not it has children.
+  const char hasChildren = (left != NULL) ? 1 : 0;
+  util::WriteBinary(stream, begin);
+  util::WriteBinary(stream, count);
+  util::WriteBinary(stream, splitDimension);
+  util::WriteBinary(stream, hasChildren);
+
+  if (hasChildren)
+  {
+    left->SaveNode(stream);
+    right->SaveNode(stream);
+  }
+}
+
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::LoadNode(
+    std::istream& stream)
+{
+  char hasChildren;
+  util::ReadBinary(stream, begin);
+  util::ReadBinary(stream, count);
+  util::ReadBinary(stream, splitDimension);
+  util::ReadBinary(stream, hasChildren);
+
+  if (count == 0 || begin + count > dataset.n_cols)
+    Log::Fatal << "BinarySpaceTree: stored node [" << begin << ", "
+        << begin + count << ") is outside of the dataset." << std::endl;
+
+  // The bound is cheap to recalculate, so it isn't stored.
+  bound |= dataset.cols(begin, begin + count - 1);
+  furthestDescendantDistance = 0.5 * bound.Diameter();
+
+  if (!hasChildren)
+    return;
+
+  left = new BinarySpaceTree(dataset, this, stream);
+  right = new BinarySpaceTree(dataset, this, stream);
+
+  // The children must split the points of this node between them exactly, or
+  // traversals will visit points twice or read outside of the node.
+  if (left->Begin() != begin || right->Begin() != begin + left->Count() ||
+      left->Count() + right->Count() != count)
+  {
+    Log::Fatal << "BinarySpaceTree: stored children [" << left->Begin() << ", "
+        << left->Begin() + left->Count() << ") and [" << right->Begin() << ", "
+        << right->Begin() + right->Count() << ") do not split their parent ["
+        << begin << ", " << begin + count << ")." << std::endl;
+  }
+
+  // Calculate parent distances for those two nodes.
+  arma::vec centroid, leftCentroid, rightCentroid;
+  Centroid(centroid);
+  left->Centroid(leftCentroid);
+  right->Centroid(rightCentroid);
+
+  left->ParentDistance() = bound.Metric().Evaluate(centroid, leftCentroid);
+  right->ParentDistance() = bound.Metric().Evaluate(centroid, rightCentroid);
+}
+
 /**
  * Deletes this node, deallocating the memory for the children and calling their
  * destructors in turn.  This will invalidate any pointers or references to any
@@ -266,10 +532,158 @@ template<typename BoundType,
 BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
   ~BinarySpaceTree()
 {
-  if (left)
+  // Children stored in a node pool are destroyed by the root of the tree.
+  if (left && !left->pooled)
     delete left;
-  if (right)
+  if (right && !right->pooled)
     delete right;
+
+  // If this is the root of a compacted tree, destroy the pooled nodes.
+  if (nodePool)
+  {
+    for (size_t i = 0; i < nodePoolSize; ++i)
+      nodePool[i].~BinarySpaceTree();
+    ::operator delete(nodePool);
+  }
+}
+
+/**
+ * Move every descendant of this node (which must be the root of the tree) into
+ * one contiguous block of memory, in depth-first order.
+ */
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::Compact()
+{
+  if (parent != NULL)
+    Log::Fatal << "BinarySpaceTree::Compact() must be called on the root of "
+        << "the tree." << std::endl;
+
+  // Nothing to do if the tree is already compact or has no children.
+  if (nodePool || !left)
+    return;
+
+  nodePoolSize = TreeSize() - 1;
+  nodePool = static_cast<BinarySpaceTree*>(
+      ::operator new(nodePoolSize * sizeof(BinarySpaceTree)));
+
+  // The nodes near the root are copied here.  Each subtree below them is small
+  // enough that the constructor built it on one thread, and it gets a block of
+  // the pool which is filled by one of the OpenMP threads, so that the pages of
+  // the pool are spread over the threads that first write to them.
+  BinarySpaceTree* oldLeft = left;
+  BinarySpaceTree* oldRight = right;
+
+  std::vector<PoolEntry> stack(2);
+  stack[0].node = oldRight;
+  stack[0].parent = this;
+  stack[0].isLeft = false;
+  stack[1].node = oldLeft;
+  stack[1].parent = this;
+  stack[1].isLeft = true;
+
+  std::vector<PoolEntry> subtrees;
+  CompactNodes(stack, 0, (count >= ParallelSplitThreshold) ? &subtrees : NULL);
+
+  #pragma omp parallel for schedule(dynamic) if (subtrees.size() > 1)
+  for (omp_size_t i = 0; i < (omp_size_t) subtrees.size(); ++i)
+  {
+    std::vector<PoolEntry> subtreeStack(1, subtrees[i]);
+    CompactNodes(subtreeStack, subtrees[i].index, NULL);
+  }
+
+  // The old nodes are no longer needed.
+  delete oldLeft;
+  delete oldRight;
+
+  // Statistics may hold pointers into the tree, so regenerate them.  In
+  // depth-first order every child comes after its parent, so walking the pool
+  // backwards builds them bottom-up.
+  for (size_t i = nodePoolSize; i > 0; --i)
+    nodePool[i - 1].stat = StatisticType(nodePool[i - 1]);
+  stat = StatisticType(*this);
+}
+
+/**
+ * Copy nodes into the node pool in depth-first order, leaving small subtrees for
+ * later if requested.
+ */
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::
+    CompactNodes(std::vector<PoolEntry>& stack,
+                 size_t index,
+                 std::vector<PoolEntry>* deferred)
+{
+  // Walk the old tree in depth-first order, copying each node into the next
+  // slot of the pool and linking it to its (already copied) parent.
+  while (!stack.empty())
+  {
+    PoolEntry entry = stack.back();
+    stack.pop_back();
+
+    if (deferred && (entry.node->count < ParallelSplitThreshold))
+    {
+      entry.index = index;
+      deferred->push_back(entry);
+      index += entry.node->TreeSize();
+      continue;
+    }
+
+    BinarySpaceTree* node = new (nodePool + index++) BinarySpaceTree(
+        *entry.node, entry.parent);
+    if (entry.isLeft)
+      entry.parent->left = node;
+    else
+      entry.parent->right = node;
+
+    if (entry.node->left)
+    {
+      PoolEntry child;
+      child.parent = node;
+      child.index = 0;
+
+      child.node = entry.node->right;
+      child.isLeft = false;
+      stack.push_back(child);
+      child.node = entry.node->left;
+      child.isLeft = true;
+      stack.push_back(child);
+    }
+  }
+}
+
+/**
+ * Copy a single node (but not its children) into a node pool.
+ */
+template<typename BoundType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::BinarySpaceTree(
+    const BinarySpaceTree& other,
+    BinarySpaceTree* parent) :
+    left(NULL),
+    right(NULL),
+    parent(parent),
+    begin(other.begin),
+    count(other.count),
+    maxLeafSize(other.maxLeafSize),
+    bound(other.bound),
+    stat(other.stat),
+    splitDimension(other.splitDimension),
+    parentDistance(other.parentDistance),
+    furthestDescendantDistance(other.furthestDescendantDistance),
+    dataset(other.dataset),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(true)
+{
+  // Nothing to do; the children are linked by Compact().
 }
 
 /**
@@ -591,11 +1005,16 @@ void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SplitNode(
     return;
 
   // Now that we know the split column, we will recursively split the children
-  // by calling their constructors (which perform this splitting process).
-  left = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, begin,
-      splitCol - begin, this, maxLeafSize);
-  right = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, splitCol,
-      begin + count - splitCol, this, maxLeafSize);
+  // by calling their constructors (which perform this splitting process).  The
+  // two children hold disjoint ranges of the dataset, so for large nodes they
+  // can be built at the same time.
+  #pragma omp task shared(data) if (count >= ParallelSplitThreshold)
+  left = new BinarySpaceTree(data, begin, splitCol - begin, this,
+      maxLeafSize);
+  #pragma omp task shared(data) if (count >= ParallelSplitThreshold)
+  right = new BinarySpaceTree(data, splitCol, begin + count - splitCol, this,
+      maxLeafSize);
+  #pragma omp taskwait
 
   // Calculate parent distances for those two nodes.
   arma::vec centroid, leftCentroid, rightCentroid;
@@ -648,11 +1067,18 @@ void BinarySpaceTree<BoundType, StatisticType, MatType, SplitType>::SplitNode(
     return;
 
   // Now that we know the split column, we will recursively split the children
-  // by calling their constructors (which perform this splitting process).
-  left = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, begin,
-      splitCol - begin, oldFromNew, this, maxLeafSize);
-  right = new BinarySpaceTree<BoundType, StatisticType, MatType>(data, splitCol,
-      begin + count - splitCol, oldFromNew, this, maxLeafSize);
+  // by calling their constructors (which perform this splitting process).  The
+  // two children hold disjoint ranges of the dataset and of oldFromNew, so for
+  // large nodes they can be built at the same time.
+  #pragma omp task shared(data, oldFromNew) \
+      if (count >= ParallelSplitThreshold)
+  left = new BinarySpaceTree(data, begin, splitCol - begin, oldFromNew, this,
+      maxLeafSize);
+  #pragma omp task shared(data, oldFromNew) \
+      if (count >= ParallelSplitThreshold)
+  right = new BinarySpaceTree(data, splitCol, begin + count - splitCol,
+      oldFromNew, this, maxLeafSize);
+  #pragma omp taskwait
 
   // Calculate parent distances for those two nodes.
   arma::vec centroid, leftCentroid, rightCentroid;
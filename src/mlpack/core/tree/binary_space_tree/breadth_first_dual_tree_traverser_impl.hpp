@@ -11,6 +11,7 @@
 
 // In case it hasn't been included yet.
 #include "breadth_first_dual_tree_traverser.hpp"
+#include "../base_case_range.hpp"
 
 #include <queue>
 
@@ -85,8 +86,7 @@ BreadthFirstDualTreeTraverser<RuleType>::Traverse(
 //        if (childScore == DBL_MAX)
 //          continue; // We can't improve this particular point.
 
-        for (size_t ref = referenceNode.Begin(); ref < referenceNode.End(); ++ref)
-          rule.BaseCase(query, ref);
+        BaseCases(rule, query, referenceNode.Begin(), referenceNode.End());
 
         numBaseCases += referenceNode.Count();
       }
@@ -11,6 +11,7 @@
 
 // In case it hasn't been included yet.
 #include "dual_tree_traverser.hpp"
+#include "../base_case_range.hpp"
 
 namespace mlpack {
 namespace tree {
@@ -61,8 +62,7 @@ DualTreeTraverser<RuleType>::Traverse(
       if (childScore == DBL_MAX)
         continue; // We can't improve this particular point.
 
-      for (size_t ref = referenceNode.Begin(); ref < referenceNode.End(); ++ref)
-        rule.BaseCase(query, ref);
+      BaseCases(rule, query, referenceNode.Begin(), referenceNode.End());
 
       numBaseCases += referenceNode.Count();
     }
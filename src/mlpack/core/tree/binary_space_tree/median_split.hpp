@@ -0,0 +1,92 @@
+/**
+ * @file median_split.hpp
+ *
+ * Definition of MedianSplit, a class that splits a binary space partitioning
+ * tree node into two halves at the median of the values in a certain
+ * dimension.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_MEDIAN_SPLIT_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_MEDIAN_SPLIT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace tree /** Trees and tree-building procedures. */ {
+
+/**
+ * A binary space partitioning tree node is split into its left and right child.
+ * The split is done in the dimension that has the maximum width, and the points
+ * are divided into two halves at the median of their values in this dimension
+ * (the left child gets the extra point if the number of points is odd).  This
+ * always gives a balanced tree, of depth about log2(n / leafSize), even for
+ * clustered data where MeanSplit makes very unbalanced splits; the children of
+ * a node can have overlapping bounds if many points have the median value.
+ */
+template<typename BoundType, typename MatType = arma::mat>
+class MedianSplit
+{
+ public:
+  /**
+   * Split the node at the median value in the dimension with maximum width.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be filled with the dimension the node is to
+   *    be split on.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol);
+
+  /**
+   * Split the node at the median value in the dimension with maximum width and
+   * return a list of changed indices.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be filled with the dimension the node is
+   *    to be split on.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   * @param oldFromNew Vector which will be filled with the old positions for
+   *    each new point.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>& oldFromNew);
+
+ private:
+  /**
+   * Split the node, updating oldFromNew if it is not NULL.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>* oldFromNew);
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+// Include implementation.
+#include "median_split_impl.hpp"
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file median_split_impl.hpp
+ *
+ * Implementation of class (MedianSplit) to split a binary space partition tree.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_MEDIAN_SPLIT_IMPL_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_MEDIAN_SPLIT_IMPL_HPP
+
+#include "median_split.hpp"
+#include "split_utility.hpp"
+
+namespace mlpack {
+namespace tree {
+
+template<typename BoundType, typename MatType>
+bool MedianSplit<BoundType, MatType>::SplitNode(const BoundType& bound,
+                                                MatType& data,
+                                                const size_t begin,
+                                                const size_t count,
+                                                size_t& splitDimension,
+                                                size_t& splitCol)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      (std::vector<size_t>*) NULL);
+}
+
+template<typename BoundType, typename MatType>
+bool MedianSplit<BoundType, MatType>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>& oldFromNew)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      &oldFromNew);
+}
+
+template<typename BoundType, typename MatType>
+bool MedianSplit<BoundType, MatType>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>* oldFromNew)
+{
+  splitDimension = data.n_rows; // Indicate invalid.
+  double maxWidth = -1;
+
+  // Find the split dimension.
+  for (size_t d = 0; d < data.n_rows; d++)
+  {
+    double width = bound[d].Width();
+
+    if (width > maxWidth)
+    {
+      maxWidth = width;
+      splitDimension = d;
+    }
+  }
+
+  if (maxWidth == 0) // All these points are the same.  We can't split.
+    return false;
+
+  // Select the median point, so that the points before it have values no
+  // greater than its value in the split dimension and the points after it have
+  // values no less than its value.  The median point goes to the left child.
+  arma::vec keys(count);
+  for (size_t i = 0; i < count; ++i)
+    keys[i] = data(splitDimension, begin + i);
+
+  const size_t median = (count - 1) / 2;
+  SelectColumn(data, begin, keys, median, oldFromNew);
+  splitCol = begin + median + 1;
+
+  return true;
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file pca_split.hpp
+ *
+ * Definition of PCASplit, a class that splits a binary space partitioning tree
+ * node into two halves along the principal direction of its points.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_PCA_SPLIT_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_PCA_SPLIT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace tree /** Trees and tree-building procedures. */ {
+
+/**
+ * A binary space partitioning tree node is split into its left and right child.
+ * The points are projected onto their principal direction (the direction of
+ * greatest variance), and divided into two halves at the median projection, as
+ * in a PCA tree or a random projection tree.  Unlike the axis-aligned splits,
+ * this adapts to the intrinsic dimension of the data: if the points lie near a
+ * low-dimensional subspace that isn't aligned with the axes, the splits follow
+ * the subspace, so the diameters of the nodes shrink as quickly as they would
+ * in the low-dimensional space.
+ *
+ * The principal direction is found approximately, with a few iterations of the
+ * power method started from the axis with the greatest width; each iteration
+ * takes one pass over the points of the node.  The bounds of the nodes are
+ * still axis-aligned (or whatever BoundType is), so they can be looser than the
+ * bounds of an axis-aligned split, and the split dimension reported for each
+ * node is the axis with the largest component in the principal direction.
+ *
+ * @tparam Iterations Number of iterations of the power method.
+ */
+template<typename BoundType, typename MatType = arma::mat, int Iterations = 5>
+class PCASplit
+{
+ public:
+  /**
+   * Split the node at the median projection onto the principal direction of
+   * its points.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be filled with the axis with the largest
+   *    component in the principal direction.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol);
+
+  /**
+   * Split the node at the median projection onto the principal direction of
+   * its points and return a list of changed indices.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be filled with the axis with the largest
+   *    component in the principal direction.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   * @param oldFromNew Vector which will be filled with the old positions for
+   *    each new point.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>& oldFromNew);
+
+ private:
+  /**
+   * Split the node, updating oldFromNew if it is not NULL.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>* oldFromNew);
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+// Include implementation.
+#include "pca_split_impl.hpp"
+
+#endif
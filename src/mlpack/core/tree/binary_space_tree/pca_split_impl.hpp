@@ -0,0 +1,127 @@
+/**
+ * @file pca_split_impl.hpp
+ *
+ * Implementation of class (PCASplit) to split a binary space partition tree.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_PCA_SPLIT_IMPL_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_PCA_SPLIT_IMPL_HPP
+
+#include "pca_split.hpp"
+#include "split_utility.hpp"
+
+namespace mlpack {
+namespace tree {
+
+template<typename BoundType, typename MatType, int Iterations>
+bool PCASplit<BoundType, MatType, Iterations>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      (std::vector<size_t>*) NULL);
+}
+
+template<typename BoundType, typename MatType, int Iterations>
+bool PCASplit<BoundType, MatType, Iterations>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>& oldFromNew)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      &oldFromNew);
+}
+
+template<typename BoundType, typename MatType, int Iterations>
+bool PCASplit<BoundType, MatType, Iterations>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>* oldFromNew)
+{
+  splitDimension = data.n_rows; // Indicate invalid.
+  double maxWidth = -1;
+
+  // Find the axis with the greatest width, to start the power method from.
+  for (size_t d = 0; d < data.n_rows; d++)
+  {
+    double width = bound[d].Width();
+
+    if (width > maxWidth)
+    {
+      maxWidth = width;
+      splitDimension = d;
+    }
+  }
+
+  if (maxWidth == 0) // All these points are the same.  We can't split.
+    return false;
+
+  // Center the points.
+  arma::vec mean(data.n_rows);
+  mean.zeros();
+  for (size_t i = begin; i < begin + count; ++i)
+    mean += arma::conv_to<arma::vec>::from(data.col(i));
+  mean /= count;
+
+  // Each iteration of the power method multiplies the direction by the
+  // (unnormalized) covariance matrix of the points, without forming it.
+  arma::vec direction(data.n_rows);
+  direction.zeros();
+  direction[splitDimension] = 1.0;
+  for (int iteration = 0; iteration < Iterations; ++iteration)
+  {
+    arma::vec next(data.n_rows);
+    next.zeros();
+    for (size_t i = begin; i < begin + count; ++i)
+    {
+      const arma::vec point = arma::conv_to<arma::vec>::from(data.col(i)) -
+          mean;
+      next += arma::dot(point, direction) * point;
+    }
+
+    const double norm = arma::norm(next, 2);
+    if (norm == 0.0)
+      break; // The points don't vary along the direction; keep the last one.
+    direction = next / norm;
+  }
+
+  // Project the points onto the direction.
+  arma::vec keys(count);
+  for (size_t i = 0; i < count; ++i)
+    keys[i] = arma::dot(arma::conv_to<arma::vec>::from(data.col(begin + i)),
+        direction);
+
+  if (keys.max() == keys.min()) // The projections are all the same.
+    return false;
+
+  // Report the axis closest to the direction as the split dimension.
+  const arma::vec absDirection = arma::abs(direction);
+  arma::uword axis;
+  absDirection.max(axis);
+  splitDimension = (size_t) axis;
+
+  // Select the median point, so that the points before it have projections no
+  // greater than its projection and the points after it have projections no
+  // less than its projection.  The median point goes to the left child.
+  const size_t median = (count - 1) / 2;
+  SelectColumn(data, begin, keys, median, oldFromNew);
+  splitCol = begin + median + 1;
+
+  return true;
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
@@ -11,6 +11,7 @@
 
 // In case it hasn't been included yet.
 #include "single_tree_traverser.hpp"
+#include "../base_case_range.hpp"
 
 #include <stack>
 
@@ -42,8 +43,7 @@ SingleTreeTraverser<RuleType>::Traverse(
   // If we are a leaf, run the base case as necessary.
   if (referenceNode.IsLeaf())
   {
-    for (size_t i = referenceNode.Begin(); i < referenceNode.End(); ++i)
-      rule.BaseCase(queryIndex, i);
+    BaseCases(rule, queryIndex, referenceNode.Begin(), referenceNode.End());
   }
   else
   {
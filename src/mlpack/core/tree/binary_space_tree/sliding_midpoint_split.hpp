@@ -0,0 +1,98 @@
+/**
+ * @file sliding_midpoint_split.hpp
+ *
+ * Definition of SlidingMidpointSplit, a class that splits a binary space
+ * partitioning tree node into two parts at the middle of the bound in a certain
+ * dimension, sliding the split to the nearest point if one side would be
+ * empty.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_SLIDING_MIDPOINT_SPLIT_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_SLIDING_MIDPOINT_SPLIT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace tree /** Trees and tree-building procedures. */ {
+
+/**
+ * A binary space partitioning tree node is split into its left and right child.
+ * The split is done in the dimension that has the maximum width of the bound,
+ * at the middle of the bound in that dimension, as MeanSplit does.  If all the
+ * points lie on one side of the middle, the split slides to the nearest point,
+ * so that point alone goes to the other child.
+ *
+ * For bounds which are the tightest bounding box of the points (HRectBound),
+ * the middle always has points on both sides, so this splits exactly as
+ * MeanSplit does.  For looser bounds (such as BallBound), where MeanSplit can
+ * leave a child empty, this always makes a valid split.
+ */
+template<typename BoundType, typename MatType = arma::mat>
+class SlidingMidpointSplit
+{
+ public:
+  /**
+   * Split the node at the middle of the bound in the dimension with maximum
+   * width, sliding the split to the nearest point if one side is empty.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be filled with the dimension the node is to
+   *    be split on.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol);
+
+  /**
+   * Split the node at the middle of the bound in the dimension with maximum
+   * width, sliding the split to the nearest point if one side is empty, and
+   * return a list of changed indices.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be filled with the dimension the node is
+   *    to be split on.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   * @param oldFromNew Vector which will be filled with the old positions for
+   *    each new point.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>& oldFromNew);
+
+ private:
+  /**
+   * Split the node, updating oldFromNew if it is not NULL.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>* oldFromNew);
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+// Include implementation.
+#include "sliding_midpoint_split_impl.hpp"
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * @file sliding_midpoint_split_impl.hpp
+ *
+ * Implementation of class (SlidingMidpointSplit) to split a binary space
+ * partition tree.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_SLIDING_MIDPOINT_SPLIT_IMPL_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_SLIDING_MIDPOINT_SPLIT_IMPL_HPP
+
+#include "sliding_midpoint_split.hpp"
+#include "split_utility.hpp"
+
+namespace mlpack {
+namespace tree {
+
+template<typename BoundType, typename MatType>
+bool SlidingMidpointSplit<BoundType, MatType>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      (std::vector<size_t>*) NULL);
+}
+
+template<typename BoundType, typename MatType>
+bool SlidingMidpointSplit<BoundType, MatType>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>& oldFromNew)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      &oldFromNew);
+}
+
+template<typename BoundType, typename MatType>
+bool SlidingMidpointSplit<BoundType, MatType>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>* oldFromNew)
+{
+  splitDimension = data.n_rows; // Indicate invalid.
+  double maxWidth = -1;
+
+  // Find the split dimension.
+  for (size_t d = 0; d < data.n_rows; d++)
+  {
+    double width = bound[d].Width();
+
+    if (width > maxWidth)
+    {
+      maxWidth = width;
+      splitDimension = d;
+    }
+  }
+
+  if (maxWidth == 0) // All these points are the same.  We can't split.
+    return false;
+
+  // Find the range of the points in the split dimension; if they all have the
+  // same value there, they can't be split in this dimension.
+  size_t minCol = begin;
+  size_t maxCol = begin;
+  for (size_t i = begin + 1; i < begin + count; ++i)
+  {
+    if (data(splitDimension, i) < data(splitDimension, minCol))
+      minCol = i;
+    if (data(splitDimension, i) > data(splitDimension, maxCol))
+      maxCol = i;
+  }
+
+  if (data(splitDimension, minCol) == data(splitDimension, maxCol))
+    return false;
+
+  const double splitVal = bound[splitDimension].Mid();
+
+  if (data(splitDimension, maxCol) < splitVal)
+  {
+    // Every point is left of the middle, so slide the split left to the
+    // rightmost point, which goes to the right child alone.
+    SwapColumns(data, maxCol, begin + count - 1, oldFromNew);
+    splitCol = begin + count - 1;
+    return true;
+  }
+
+  if (data(splitDimension, minCol) >= splitVal)
+  {
+    // Every point is right of the middle, so slide the split right to the
+    // leftmost point, which goes to the left child alone.
+    SwapColumns(data, minCol, begin, oldFromNew);
+    splitCol = begin + 1;
+    return true;
+  }
+
+  // Points with value less than splitVal go to the left of splitCol, and the
+  // others go to the right.
+  size_t left = begin;
+  size_t right = begin + count - 1;
+  while (true)
+  {
+    while (data(splitDimension, left) < splitVal)
+      ++left;
+    while (data(splitDimension, right) >= splitVal)
+      --right;
+
+    if (left > right)
+      break;
+
+    SwapColumns(data, left, right, oldFromNew);
+  }
+
+  splitCol = left;
+  return true;
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,134 @@
+/**
+ * @file split_utility.hpp
+ *
+ * Utilities shared by the split policies of the BinarySpaceTree, for
+ * rearranging the points of a node.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_SPLIT_UTILITY_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_SPLIT_UTILITY_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * Swap two columns of the dataset, and the corresponding entries of
+ * oldFromNew, if it is given.
+ *
+ * @param data The dataset used by the binary space tree.
+ * @param a Index of the first column.
+ * @param b Index of the second column.
+ * @param oldFromNew Mappings to update, or NULL.
+ */
+template<typename MatType>
+void SwapColumns(MatType& data,
+                 const size_t a,
+                 const size_t b,
+                 std::vector<size_t>* oldFromNew)
+{
+  data.swap_cols(a, b);
+  if (oldFromNew)
+    std::swap((*oldFromNew)[a], (*oldFromNew)[b]);
+}
+
+/**
+ * Rearrange the points of a node by their keys so that the point with the
+ * given rank is at index begin + rank, every point before it has a key no
+ * greater than its key, and every point after it has a key no less than its
+ * key.  This is a quickselect, so it takes linear time on average; ties are
+ * allowed, and the points on each side are not sorted.
+ *
+ * @param data The dataset used by the binary space tree.
+ * @param begin Index of the first point of the node.
+ * @param keys The key of each point of the node (keys[i] is the key of point
+ *     begin + i); this is rearranged along with the points.
+ * @param rank The rank of the point to select, which must be less than the
+ *     number of keys.
+ * @param oldFromNew Mappings to update, or NULL.
+ */
+template<typename MatType>
+void SelectColumn(MatType& data,
+                  const size_t begin,
+                  arma::vec& keys,
+                  const size_t rank,
+                  std::vector<size_t>* oldFromNew)
+{
+  size_t lo = 0;
+  size_t hi = keys.n_elem - 1;
+  while (lo < hi)
+  {
+    const double pivot = keys[lo + (hi - lo) / 2];
+
+    // Partition [lo, hi] so that the keys in [lo, j] are no greater than the
+    // pivot and the keys in [i, hi] are no less than it; any keys between j
+    // and i are equal to it.
+    size_t i = lo;
+    size_t j = hi;
+    while (i <= j)
+    {
+      while (keys[i] < pivot)
+        ++i;
+      while (keys[j] > pivot)
+        --j;
+
+      if (i <= j)
+      {
+        std::swap(keys[i], keys[j]);
+        SwapColumns(data, begin + i, begin + j, oldFromNew);
+        ++i;
+        if (j == 0)
+          break;
+        --j;
+      }
+    }
+
+    if (rank <= j)
+      hi = j;
+    else if (rank >= i)
+      lo = i;
+    else
+      break; // The point with the given rank has the key of the pivot.
+  }
+}
+
+/**
+ * Rearrange the points of a node so that the points with keys less than the
+ * given value come first, and return the index of the first point with a key
+ * that is not less than the value.
+ *
+ * @param data The dataset used by the binary space tree.
+ * @param begin Index of the first point of the node.
+ * @param keys The key of each point of the node (keys[i] is the key of point
+ *     begin + i); this is rearranged along with the points.
+ * @param splitVal Points with keys less than this come first.
+ * @param oldFromNew Mappings to update, or NULL.
+ */
+template<typename MatType>
+size_t PartitionColumns(MatType& data,
+                        const size_t begin,
+                        arma::vec& keys,
+                        const double splitVal,
+                        std::vector<size_t>* oldFromNew)
+{
+  size_t left = 0;
+  for (size_t i = 0; i < keys.n_elem; ++i)
+  {
+    if (keys[i] < splitVal)
+    {
+      if (i != left)
+      {
+        std::swap(keys[i], keys[left]);
+        SwapColumns(data, begin + i, begin + left, oldFromNew);
+      }
+      ++left;
+    }
+  }
+
+  return begin + left;
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
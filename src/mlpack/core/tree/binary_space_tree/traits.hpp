@@ -20,8 +20,9 @@ namespace tree {
  */
 template<typename BoundType,
          typename StatisticType,
-         typename MatType>
-class TreeTraits<BinarySpaceTree<BoundType, StatisticType, MatType> >
+         typename MatType,
+         typename SplitType>
+class TreeTraits<BinarySpaceTree<BoundType, StatisticType, MatType, SplitType> >
 {
  public:
   /**
@@ -45,6 +46,52 @@ class TreeTraits<BinarySpaceTree<BoundType, StatisticType, MatType> >
    * Points are rearranged during building of the tree.
    */
   static const bool RearrangesDataset = true;
+
+  /**
+   * A binary space tree can be copied so that it refers to another dataset.
+   */
+  static const bool CanCopyToDataset = true;
+};
+
+/**
+ * This is a specialization of the TreeTraits class to binary space trees with
+ * ball bounds (ball trees and vantage point trees).  The balls of the two
+ * children of a node can overlap; otherwise these are the same as other binary
+ * space trees.
+ */
+template<typename VecType,
+         typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         typename SplitType>
+class TreeTraits<BinarySpaceTree<bound::BallBound<VecType, MetricType>,
+    StatisticType, MatType, SplitType> >
+{
+ public:
+  /**
+   * The balls of the children of a node can overlap.
+   */
+  static const bool HasOverlappingChildren = true;
+
+  /**
+   * There is no guarantee that the first point in a node is its centroid.
+   */
+  static const bool FirstPointIsCentroid = false;
+
+  /**
+   * Points are not contained at multiple levels of the binary space tree.
+   */
+  static const bool HasSelfChildren = false;
+
+  /**
+   * Points are rearranged during building of the tree.
+   */
+  static const bool RearrangesDataset = true;
+
+  /**
+   * A binary space tree can be copied so that it refers to another dataset.
+   */
+  static const bool CanCopyToDataset = true;
 };
 
 }; // namespace tree
@@ -0,0 +1,104 @@
+/**
+ * @file vp_tree_split.hpp
+ *
+ * Definition of VPTreeSplit, a class that splits a node of a vantage point tree
+ * into the points near a vantage point and the points far from it.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_VP_TREE_SPLIT_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_VP_TREE_SPLIT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace tree /** Trees and tree-building procedures. */ {
+
+/**
+ * A vantage point tree node is split into its left and right child using a
+ * vantage point: the point furthest from the center of the node's ball, which
+ * is near the edge of the points, so the distances to it are spread out.  The
+ * half of the points nearest to the vantage point (including the vantage point
+ * itself) go to the left child, and the other half go to the right child.  Only distances computed with the
+ * metric of the bound are used, so this works for any metric, and the tree is
+ * balanced.  Use it with BallBound:
+ *
+ * @code
+ * typedef BinarySpaceTree<bound::BallBound<>, StatisticType, arma::mat,
+ *     VPTreeSplit<bound::BallBound<>, arma::mat> > VPTreeType;
+ * @endcode
+ *
+ * A classic vantage point tree bounds the right child by a shell around the
+ * vantage point; here both children are bounded by balls around their own
+ * points, which is the bound the tree traversals already support.
+ *
+ * There is no split dimension, so the split dimension of each node is set to
+ * the dimensionality of the data.
+ *
+ * @tparam BoundType Type of bound; it must have Center() and Metric(), as
+ *     BallBound does.
+ */
+template<typename BoundType, typename MatType = arma::mat>
+class VPTreeSplit
+{
+ public:
+  /**
+   * Split the node at the median distance to the vantage point.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be set to the dimensionality of the data.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol);
+
+  /**
+   * Split the node at the median distance to the vantage point and return a
+   * list of changed indices.
+   *
+   * @param bound The bound used for this node.
+   * @param data The dataset used by the binary space tree.
+   * @param begin Index of the starting point in the dataset that belongs to
+   *    this node.
+   * @param count Number of points in this node.
+   * @param splitDimension This will be set to the dimensionality of the data.
+   * @param splitCol The index at which the dataset is divided into two parts
+   *    after the rearrangement.
+   * @param oldFromNew Vector which will be filled with the old positions for
+   *    each new point.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>& oldFromNew);
+
+ private:
+  /**
+   * Split the node, updating oldFromNew if it is not NULL.
+   */
+  static bool SplitNode(const BoundType& bound,
+                        MatType& data,
+                        const size_t begin,
+                        const size_t count,
+                        size_t& splitDimension,
+                        size_t& splitCol,
+                        std::vector<size_t>* oldFromNew);
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+// Include implementation.
+#include "vp_tree_split_impl.hpp"
+
+#endif
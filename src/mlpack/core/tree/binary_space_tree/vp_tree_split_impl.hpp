@@ -0,0 +1,94 @@
+/**
+ * @file vp_tree_split_impl.hpp
+ *
+ * Implementation of class (VPTreeSplit) to split a vantage point tree.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_VP_TREE_SPLIT_IMPL_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_VP_TREE_SPLIT_IMPL_HPP
+
+#include "vp_tree_split.hpp"
+#include "split_utility.hpp"
+
+namespace mlpack {
+namespace tree {
+
+template<typename BoundType, typename MatType>
+bool VPTreeSplit<BoundType, MatType>::SplitNode(const BoundType& bound,
+                                                MatType& data,
+                                                const size_t begin,
+                                                const size_t count,
+                                                size_t& splitDimension,
+                                                size_t& splitCol)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      (std::vector<size_t>*) NULL);
+}
+
+template<typename BoundType, typename MatType>
+bool VPTreeSplit<BoundType, MatType>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>& oldFromNew)
+{
+  return SplitNode(bound, data, begin, count, splitDimension, splitCol,
+      &oldFromNew);
+}
+
+template<typename BoundType, typename MatType>
+bool VPTreeSplit<BoundType, MatType>::SplitNode(
+    const BoundType& bound,
+    MatType& data,
+    const size_t begin,
+    const size_t count,
+    size_t& splitDimension,
+    size_t& splitCol,
+    std::vector<size_t>* oldFromNew)
+{
+  splitDimension = data.n_rows; // There is no split dimension.
+
+  typename BoundType::MetricType metric = bound.Metric();
+  typedef typename BoundType::Vec VecType;
+
+  // The vantage point is the point furthest from the center.
+  size_t vantagePoint = begin;
+  double maxDistance = -1;
+  for (size_t i = begin; i < begin + count; ++i)
+  {
+    const double distance = metric.Evaluate(bound.Center(),
+        (VecType) data.col(i));
+    if (distance > maxDistance)
+    {
+      maxDistance = distance;
+      vantagePoint = i;
+    }
+  }
+
+  // Move the vantage point to the front, and find the distances to it.
+  SwapColumns(data, begin, vantagePoint, oldFromNew);
+  const VecType vantage = (VecType) data.col(begin);
+
+  arma::vec keys(count);
+  for (size_t i = 0; i < count; ++i)
+    keys[i] = metric.Evaluate(vantage, (VecType) data.col(begin + i));
+
+  if (keys.max() == 0) // All these points are the same.  We can't split.
+    return false;
+
+  // Select the point at the median distance; the points before it are no
+  // further from the vantage point, and the points after it are no nearer.
+  // The vantage point has distance 0, so it goes to the left child.
+  const size_t median = (count - 1) / 2;
+  SelectColumn(data, begin, keys, median, oldFromNew);
+  splitCol = begin + median + 1;
+
+  return true;
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
@@ -11,6 +11,7 @@
 #include <mlpack/core/metrics/lmetric.hpp>
 
 #include "hrectbound.hpp"
+#include "fixed_hrectbound.hpp"
 #include "ballbound.hpp"
 
 #endif // __MLPACK_CORE_TREE_BOUNDS_HPP
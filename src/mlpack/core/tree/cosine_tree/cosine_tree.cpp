@@ -23,7 +23,8 @@ CosineTree::CosineTree(const arma::mat& dataset) :
   l2NormsSquared.zeros(numColumns);
 
   // Set indices and calculate squared norms of the columns.
-  for(size_t i = 0; i < numColumns; i++)
+  #pragma omp parallel for
+  for (omp_size_t i = 0; i < (omp_size_t) numColumns; i++)
   {
     indices[i] = i;
     double l2Norm = arma::norm(dataset.col(i), 2);
@@ -89,6 +90,10 @@ CosineTree::CosineTree(const arma::mat& dataset,
   // Initialize Monte Carlo error estimate for comparison.
   double monteCarloError = root.FrobNormSquared();
 
+  // The basis vectors of the nodes in the queue, and of the children of the
+  // node being split, one per column.
+  arma::mat currentBasis;
+
   while (monteCarloError > epsilon * root.FrobNormSquared())
   {
     // Pop node from queue with highest projection error.
@@ -96,6 +101,10 @@ CosineTree::CosineTree(const arma::mat& dataset,
     currentNode = treeQueue.top();
     treeQueue.pop();
 
+    // Collect the basis vectors of the rest of the queue once, instead of
+    // walking the queue for every orthonormalization and error estimate.
+    QueueBasis(treeQueue, currentBasis);
+
     // Split the node into left and right children.
     currentNode->CosineNodeSplit();
 
@@ -104,27 +113,30 @@ CosineTree::CosineTree(const arma::mat& dataset,
     currentLeft = currentNode->Left();
     currentRight = currentNode->Right();
 
-    // Calculate basis vectors of left and right children.
+    // Calculate basis vectors of left and right children, adding each to the
+    // current basis.
     arma::vec lBasisVector, rBasisVector;
 
-    ModifiedGramSchmidt(treeQueue, currentLeft->Centroid(), lBasisVector);
-    ModifiedGramSchmidt(treeQueue, currentRight->Centroid(), rBasisVector,
-                        &lBasisVector);
+    ModifiedGramSchmidt(currentBasis, currentLeft->Centroid(), lBasisVector);
+    currentBasis.insert_cols(currentBasis.n_cols, lBasisVector);
+    ModifiedGramSchmidt(currentBasis, currentRight->Centroid(), rBasisVector);
+    currentBasis.insert_cols(currentBasis.n_cols, rBasisVector);
 
     // Add basis vectors to their respective nodes.
     currentLeft->BasisVector(lBasisVector);
     currentRight->BasisVector(rBasisVector);
 
     // Calculate Monte Carlo error estimates for child nodes.
-    MonteCarloError(currentLeft, treeQueue, &lBasisVector, &rBasisVector);
-    MonteCarloError(currentRight, treeQueue, &lBasisVector, &rBasisVector);
+    MonteCarloError(currentLeft, currentBasis);
+    MonteCarloError(currentRight, currentBasis);
 
     // Push child nodes into the priority queue.
     treeQueue.push(currentLeft);
     treeQueue.push(currentRight);
 
-    // Calculate Monte Carlo error estimate for the root node.
-    monteCarloError = MonteCarloError(&root, treeQueue);
+    // Calculate Monte Carlo error estimate for the root node.  The queue now
+    // holds exactly the nodes whose basis vectors are in the current basis.
+    monteCarloError = MonteCarloError(&root, currentBasis);
   }
 
   // Construct the subspace basis from the current priority queue.
@@ -143,30 +155,24 @@ void CosineTree::ModifiedGramSchmidt(CosineNodeQueue& treeQueue,
                                      arma::vec& centroid,
                                      arma::vec& newBasisVector,
                                      arma::vec* addBasisVector)
+{
+  arma::mat currentBasis;
+  QueueBasis(treeQueue, currentBasis, addBasisVector);
+  ModifiedGramSchmidt(currentBasis, centroid, newBasisVector);
+}
+
+void CosineTree::ModifiedGramSchmidt(const arma::mat& currentBasis,
+                                     const arma::vec& centroid,
+                                     arma::vec& newBasisVector)
 {
   // Set new basis vector to centroid.
   newBasisVector = centroid;
 
-  // Variables for iterating throught the priority queue.
-  CosineTree *currentNode;
-  CosineNodeQueue::const_iterator i = treeQueue.begin();
-
   // For every vector in the current basis, remove its projection from the
-  // centroid.
-  for(; i != treeQueue.end(); i++)
-  {
-    currentNode = *i;
-
-    double projection = arma::dot(currentNode->BasisVector(), centroid);
-    newBasisVector -= projection * currentNode->BasisVector();
-  }
-
-  // If additional basis vector is passed, take it into account.
-  if(addBasisVector)
-  {
-    double projection = arma::dot(*addBasisVector, centroid);
-    newBasisVector -= *addBasisVector * projection;
-  }
+  // centroid.  The projections are all taken from the centroid itself, so they
+  // can be calculated with one matrix-vector product.
+  if (currentBasis.n_cols > 0)
+    newBasisVector -= currentBasis * (trans(currentBasis) * centroid);
 
   // Normalize the modified centroid vector.
   if(arma::norm(newBasisVector, 2))
@@ -177,6 +183,19 @@ double CosineTree::MonteCarloError(CosineTree* node,
                                    CosineNodeQueue& treeQueue,
                                    arma::vec* addBasisVector1,
                                    arma::vec* addBasisVector2)
+{
+  // The additional basis vectors are only used if both are passed.
+  arma::mat currentBasis;
+  if(addBasisVector1 && addBasisVector2)
+    QueueBasis(treeQueue, currentBasis, addBasisVector1, addBasisVector2);
+  else
+    QueueBasis(treeQueue, currentBasis);
+
+  return MonteCarloError(node, currentBasis);
+}
+
+double CosineTree::MonteCarloError(CosineTree* node,
+                                   const arma::mat& currentBasis)
 {
   std::vector<size_t> sampledIndices;
   arma::vec probabilities;
@@ -186,55 +205,26 @@ double CosineTree::MonteCarloError(CosineTree* node,
   size_t numSamples = log(node->NumColumns()) + 1;
   node->ColumnSamplesLS(sampledIndices, probabilities, numSamples);
 
-  // Get pointer to the original dataset.
-  arma::mat dataset = node->GetDataset();
+  // Get reference to the original dataset.
+  const arma::mat& dataset = node->GetDataset();
 
   // Initialize weighted projection magnitudes as zeros.
   arma::vec weightedMagnitudes;
   weightedMagnitudes.zeros(numSamples);
 
-  // Set size of projection vector, depending on whether additional basis
-  // vectors are passed.
-  size_t projectionSize;
-  if(addBasisVector1 && addBasisVector2)
-    projectionSize = treeQueue.size() + 2;
-  else
-    projectionSize = treeQueue.size();
-
-  // For each sample, calculate the weighted projection onto the current basis.
-  for(size_t i = 0; i < numSamples; i++)
+  // Calculate the weighted projections of all the samples onto the current
+  // basis with one matrix product.
+  if (currentBasis.n_cols > 0)
   {
-    // Initialize projection as a vector of zeros.
-    arma::vec projection;
-    projection.zeros(projectionSize);
-
-    CosineTree *currentNode;
-    CosineNodeQueue::const_iterator j = treeQueue.begin();
-
-    size_t k = 0;
-    // Compute the projection of the sampled vector onto the existing subspace.
-    for(; j != treeQueue.end(); j++, k++)
-    {
-      currentNode = *j;
+    arma::mat samples(dataset.n_rows, numSamples);
+    for(size_t i = 0; i < numSamples; i++)
+      samples.col(i) = dataset.col(sampledIndices[i]);
 
-      projection(k) = arma::dot(dataset.col(sampledIndices[i]),
-                                currentNode->BasisVector());
-    }
-    // If two additional vectors are passed, take their projections.
-    if(addBasisVector1 && addBasisVector2)
-    {
-      projection(k++) = arma::dot(dataset.col(sampledIndices[i]),
-                                  *addBasisVector1);
-      projection(k) = arma::dot(dataset.col(sampledIndices[i]),
-                                *addBasisVector2);
-    }
+    const arma::mat projections = trans(currentBasis) * samples;
 
-    // Calculate the Frobenius norm squared of the projected vector.
-    double frobProjection = arma::norm(projection, "frob");
-    double frobProjectionSquared = frobProjection * frobProjection;
-
-    // Calculate the weighted projection magnitude.
-    weightedMagnitudes(i) = frobProjectionSquared / probabilities(i);
+    // The squared Frobenius norm of each projected vector, weighted.
+    weightedMagnitudes = trans(arma::sum(arma::square(projections), 0)) /
+        probabilities;
   }
 
   // Compute mean and standard deviation of the weighted samples.
@@ -260,20 +250,34 @@ double CosineTree::MonteCarloError(CosineTree* node,
 
 void CosineTree::ConstructBasis(CosineNodeQueue& treeQueue)
 {
-  // Initialize basis as matrix of zeros.
-  basis.zeros(dataset.n_rows, treeQueue.size());
+  // Transfer basis vectors from the queue to the basis matrix.
+  QueueBasis(treeQueue, basis);
+}
+
+void CosineTree::QueueBasis(CosineNodeQueue& treeQueue,
+                            arma::mat& queueBasis,
+                            arma::vec* addBasisVector1,
+                            arma::vec* addBasisVector2)
+{
+  const size_t numAdded = (addBasisVector1 ? 1 : 0) +
+      (addBasisVector2 ? 1 : 0);
+  queueBasis.set_size(dataset.n_rows, treeQueue.size() + numAdded);
 
   // Variables for iterating through the priority queue.
   CosineTree *currentNode;
   CosineNodeQueue::const_iterator i = treeQueue.begin();
 
-  // Transfer basis vectors from the queue to the basis matrix.
   size_t j = 0;
   for(; i != treeQueue.end(); i++, j++)
   {
     currentNode = *i;
-    basis.col(j) = currentNode->BasisVector();
+    queueBasis.col(j) = currentNode->BasisVector();
   }
+
+  if(addBasisVector1)
+    queueBasis.col(j++) = *addBasisVector1;
+  if(addBasisVector2)
+    queueBasis.col(j) = *addBasisVector2;
 }
 
 void CosineTree::CosineNodeSplit()
@@ -402,7 +406,9 @@ void CosineTree::CalculateCosines(arma::vec& cosines)
   // Initialize cosine vector as a vector of zeros.
   cosines.zeros(numColumns);
 
-  for(size_t i = 0; i < numColumns; i++)
+  // The cosines are independent, so they are calculated in parallel.
+  #pragma omp parallel for
+  for (omp_size_t i = 0; i < (omp_size_t) numColumns; i++)
   {
     // If norm is zero, store cosine value as zero. Else, calculate cosine value
     // between two vectors.
@@ -420,14 +426,35 @@ void CosineTree::CalculateCosines(arma::vec& cosines)
 
 void CosineTree::CalculateCentroid()
 {
-  // Initialize centroid as vector of zeros.
-  centroid.zeros(dataset.n_rows);
-
-  // Calculate centroid of columns in the node.
-  for(size_t i = 0; i < numColumns; i++)
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = omp_get_max_threads();
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // The columns are split into one contiguous block per thread, and each block
+  // is summed separately; the block sums are added in order at the end, so the
+  // result does not depend on the schedule.  Small nodes (which most nodes
+  // are) are summed by one thread.
+  const size_t blocks = (numColumns < 1000) ? 1 :
+      std::min(numThreads, numColumns);
+  arma::mat blockSums(dataset.n_rows, blocks);
+
+  #pragma omp parallel for num_threads(blocks) schedule(static)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
   {
-    centroid += dataset.col(indices[i]);
+    arma::vec sum = arma::zeros<arma::vec>(dataset.n_rows);
+    const size_t begin = b * numColumns / blocks;
+    const size_t end = (b + 1) * numColumns / blocks;
+    for (size_t i = begin; i < end; i++)
+      sum += dataset.col(indices[i]);
+
+    blockSums.col(b) = sum;
   }
+
+  // Calculate centroid of columns in the node.
+  centroid = arma::sum(blockSums, 1);
   centroid /= numColumns;
 }
 
@@ -82,6 +82,19 @@ class CosineTree
                            arma::vec& newBasisVector,
                            arma::vec* addBasisVector = NULL);
 
+  /**
+   * Calculates the orthonormalization of the passed centroid, with respect to
+   * the given vector subspace.
+   *
+   * @param currentBasis Orthonormal basis of the subspace, one vector per
+   *     column.
+   * @param centroid Centroid of the node being added to the basis.
+   * @param newBasisVector Orthonormalized centroid of the node.
+   */
+  void ModifiedGramSchmidt(const arma::mat& currentBasis,
+                           const arma::vec& centroid,
+                           arma::vec& newBasisVector);
+
   /**
    * Estimates the squared error of the projection of the input node's matrix
    * onto the current vector subspace. A normal distribution is fit using
@@ -99,6 +112,17 @@ class CosineTree
                          arma::vec* addBasisVector1 = NULL,
                          arma::vec* addBasisVector2 = NULL);
 
+  /**
+   * Estimates the squared error of the projection of the input node's matrix
+   * onto the given vector subspace, as above.  The projections of all the
+   * samples are calculated with one matrix product.
+   *
+   * @param node Node for which Monte Carlo estimate is calculated.
+   * @param currentBasis Orthonormal basis of the subspace, one vector per
+   *     column.
+   */
+  double MonteCarloError(CosineTree* node, const arma::mat& currentBasis);
+
   /**
    * Constructs the final basis matrix, after the cosine tree construction.
    *
@@ -106,6 +130,20 @@ class CosineTree
    */
   void ConstructBasis(CosineNodeQueue& treeQueue);
 
+  /**
+   * Collect the basis vectors of the nodes in the queue, and any additional
+   * basis vectors that are passed, into the columns of a matrix.
+   *
+   * @param treeQueue Priority queue of cosine nodes.
+   * @param queueBasis Matrix to store the basis vectors in.
+   * @param addBasisVector1 Address to first additional basis vector.
+   * @param addBasisVector2 Address to second additional basis vector.
+   */
+  void QueueBasis(CosineNodeQueue& treeQueue,
+                  arma::mat& queueBasis,
+                  arma::vec* addBasisVector1 = NULL,
+                  arma::vec* addBasisVector2 = NULL);
+
   /**
    * This function splits the cosine node into two children based on the cosines
    * of the columns contained in the node, with respect to the sampled splitting
@@ -13,6 +13,7 @@
 #include "cover_tree/single_tree_traverser_impl.hpp"
 #include "cover_tree/dual_tree_traverser.hpp"
 #include "cover_tree/dual_tree_traverser_impl.hpp"
+#include "cover_tree/best_first_dual_tree_traverser.hpp"
 #include "cover_tree/traits.hpp"
 
 #endif
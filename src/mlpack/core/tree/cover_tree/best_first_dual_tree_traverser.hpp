@@ -0,0 +1,38 @@
+/**
+ * @file best_first_dual_tree_traverser.hpp
+ *
+ * Defines the BestFirstDualTreeTraverser for the cover tree, which traverses
+ * two cover trees best-first, always visiting the node combination with the
+ * best score next; see PriorityDualTreeTraverser.
+ */
+#ifndef __MLPACK_CORE_TREE_COVER_TREE_BEST_FIRST_DUAL_TREE_TRAVERSER_HPP
+#define __MLPACK_CORE_TREE_COVER_TREE_BEST_FIRST_DUAL_TREE_TRAVERSER_HPP
+
+#include <mlpack/core.hpp>
+
+#include "cover_tree.hpp"
+#include "../priority_dual_tree_traverser.hpp"
+
+namespace mlpack {
+namespace tree {
+
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+template<typename RuleType>
+class CoverTree<MetricType, RootPointPolicy, StatisticType>::
+    BestFirstDualTreeTraverser :
+    public PriorityDualTreeTraverser<
+        CoverTree<MetricType, RootPointPolicy, StatisticType>, RuleType>
+{
+ public:
+  /**
+   * Instantiate the dual-tree traverser with the given rule set.
+   */
+  BestFirstDualTreeTraverser(RuleType& rule) :
+      PriorityDualTreeTraverser<CoverTree, RuleType>(rule)
+  { /* Nothing to do. */ }
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif // __MLPACK_CORE_TREE_COVER_TREE_BEST_FIRST_DUAL_TREE_TRAVERSER_HPP
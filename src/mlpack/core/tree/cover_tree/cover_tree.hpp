@@ -9,6 +9,7 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
+#include <deque>
 #include "first_point_is_root.hpp"
 #include "../statistic.hpp"
 
@@ -40,7 +41,11 @@ namespace tree {
  * only have a "self-child" (a child referencing the same point, but at a lower
  * scale level).  This practical implementation only constructs explicit nodes
  * -- non-leaf nodes with more than one child.  A leaf node has no children, and
- * its scale level is INT_MIN.
+ * its scale level is INT_MIN.  Each point is held by exactly one leaf, so a
+ * tree on n points has at most 2n - 1 nodes, however clustered the data is
+ * (chains of implicit nodes, which the theoretical structure has for points
+ * that are far from everything else at many scales, are collapsed into a
+ * single edge).
  *
  * For more information on cover trees, see
  *
@@ -117,6 +122,13 @@ class CoverTree
             MetricType& metric,
             const double base = 2.0);
 
+  /**
+   * Reusable buffers for the near and far sets of children during tree
+   * building.  Entry i is shared by every node at depth i, since only one node
+   * at each depth is being built at any time; the buffers only ever grow.
+   */
+  typedef std::deque<std::pair<arma::Col<size_t>, arma::vec> > BuildBuffers;
+
   /**
    * Construct a child cover tree node.  This constructor is not meant to be
    * used externally, but it could be used to insert another node into a tree.
@@ -147,6 +159,10 @@ class CoverTree
    * @param farSetSize Size of the far set; may be modified (if this node uses
    *     any points in the far set).
    * @param usedSetSize The number of points used will be added to this number.
+   * @param metric Instantiated metric to use during tree building.
+   * @param buffers Buffers to build the children's near and far sets in (if
+   *     NULL, new buffers are used).
+   * @param depth Depth of this node in the tree (used to select buffers).
    */
   CoverTree(const arma::mat& dataset,
             const double base,
@@ -159,7 +175,9 @@ class CoverTree
             size_t nearSetSize,
             size_t& farSetSize,
             size_t& usedSetSize,
-            MetricType& metric = NULL);
+            MetricType& metric = NULL,
+            BuildBuffers* buffers = NULL,
+            const size_t depth = 0);
 
   /**
    * Manually construct a cover tree node; no tree assembly is done in this
@@ -194,11 +212,52 @@ class CoverTree
    */
   CoverTree(const CoverTree& other);
 
+  /**
+   * Load a cover tree that was previously stored with Save().  The given
+   * dataset must be the dataset the stored tree was built on; the cover tree
+   * does not reorder points, so nothing is modified.  If the stream does not
+   * hold a cover tree, or the tree does not match the dataset, a fatal error is
+   * thrown.
+   *
+   * @param dataset Reference to the dataset the stored tree was built on.
+   * @param stream Binary stream to read the tree from.
+   * @param metric Instantiated metric (optional).
+   */
+  CoverTree(const arma::mat& dataset,
+            std::istream& stream,
+            MetricType* metric = NULL);
+
+  /**
+   * Store this tree (which should be the root of its tree) in the given binary
+   * stream, so that it can be loaded later without rebuilding it.  The dataset
+   * itself is not stored.
+   *
+   * @param stream Binary stream to write the tree to.
+   */
+  void Save(std::ostream& stream) const;
+
   /**
    * Delete this cover tree node and its children.
    */
   ~CoverTree();
 
+  /**
+   * Move all the nodes of this tree into a single contiguous block of memory,
+   * ordered depth-first (the order in which the traversers visit them).  Nodes
+   * are normally allocated one at a time, so a large tree spends a lot of time
+   * in the allocator when it is destroyed and can end up scattered across the
+   * heap; a compact tree is freed with one deallocation and is more
+   * cache-friendly to traverse.  This must be called on the root of the tree,
+   * and it invalidates any pointers to nodes other than the root.  The
+   * statistics of each node are recalculated.  Calling this on a tree that is
+   * already compact does nothing.
+   */
+  void Compact();
+
+  //! Return whether or not the nodes of this tree are stored contiguously (see
+  //! Compact()).
+  bool IsCompact() const { return (nodePool != NULL) || pooled; }
+
   //! A single-tree cover tree traverser; see single_tree_traverser.hpp for
   //! implementation.
   template<typename RuleType>
@@ -208,6 +267,11 @@ class CoverTree
   template<typename RuleType>
   class DualTreeTraverser;
 
+  //! A best-first dual-tree cover tree traverser; see
+  //! best_first_dual_tree_traverser.hpp.
+  template<typename RuleType>
+  class BestFirstDualTreeTraverser;
+
   //! Get a reference to the dataset.
   const arma::mat& Dataset() const { return dataset; }
 
@@ -367,20 +431,41 @@ class CoverTree
   //! The metric used for this tree.
   MetricType* metric;
 
+  //! If this is the root of a compacted tree, the contiguous block of memory
+  //! holding every other node of the tree (see Compact()).
+  CoverTree* nodePool;
+  //! The number of nodes in nodePool.
+  size_t nodePoolSize;
+  //! Whether or not this node is stored in its root's nodePool.
+  bool pooled;
+
+  /**
+   * Private copy constructor used by Compact(): copy the given node, but none
+   * of its children, and mark it as part of a node pool.
+   *
+   * @param other Node to copy.
+   * @param parent Parent of the new node.
+   */
+  CoverTree(const CoverTree& other, CoverTree* parent);
+
   /**
-   * Create the children for this node.
+   * Create the children for this node.  The near and far sets of the children
+   * are built in the entry of the given buffers for this node's depth.
    */
   void CreateChildren(arma::Col<size_t>& indices,
                       arma::vec& distances,
                       size_t nearSetSize,
                       size_t& farSetSize,
-                      size_t& usedSetSize);
+                      size_t& usedSetSize,
+                      BuildBuffers& buffers,
+                      const size_t depth);
 
   /**
    * Fill the vector of distances with the distances between the point specified
    * by pointIndex and each point in the indices array.  The distances of the
    * first pointSetSize points in indices are calculated (so, this does not
-   * necessarily need to use all of the points in the arrays).
+   * necessarily need to use all of the points in the arrays).  Large sets are
+   * split between threads if OpenMP is available.
    *
    * @param pointIndex Point to build the distances for.
    * @param indices List of indices to compute distances for.
@@ -455,6 +540,23 @@ class CoverTree
    */
   void RemoveNewImplicitNodes();
 
+  /**
+   * Load a child node (and its children) from a stream written by Save().
+   *
+   * @param dataset Reference to the dataset the tree is built on.
+   * @param parent Parent of this node.
+   * @param stream Binary stream to read from.
+   */
+  CoverTree(const arma::mat& dataset,
+            CoverTree* parent,
+            std::istream& stream);
+
+  //! Write the record for this node and its children to the stream.
+  void SaveNode(std::ostream& stream) const;
+
+  //! Read the record for this node from the stream, then load its children.
+  void LoadNode(std::istream& stream);
+
  public:
   /**
    * Returns a string representation of this object.
@@ -11,6 +11,7 @@
 #include "cover_tree.hpp"
 
 #include <mlpack/core/util/string_util.hpp>
+#include <mlpack/core/util/binary_io.hpp>
 #include <string>
 
 namespace mlpack {
@@ -32,6 +33,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
     furthestDescendantDistance(0),
     localMetric(metric == NULL),
     metric(metric),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false),
     distanceComps(0)
 {
   // If we need to create a metric, do that.  We'll just do it on the heap.
@@ -58,8 +62,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
   // Create the children.
   size_t farSetSize = 0;
   size_t usedSetSize = 0;
+  BuildBuffers buffers;
   CreateChildren(indices, distances, dataset.n_cols - 1, farSetSize,
-      usedSetSize);
+      usedSetSize, buffers, 0);
 
   // If we ended up creating only one child, remove the implicit node.
   while (children.size() == 1)
@@ -113,6 +118,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
     furthestDescendantDistance(0),
     localMetric(false),
     metric(&metric),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false),
     distanceComps(0)
 {
   // If there is only one point in the dataset, uh, we're done.
@@ -135,8 +143,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
   // Create the children.
   size_t farSetSize = 0;
   size_t usedSetSize = 0;
+  BuildBuffers buffers;
   CreateChildren(indices, distances, dataset.n_cols - 1, farSetSize,
-      usedSetSize);
+      usedSetSize, buffers, 0);
 
   // If we ended up creating only one child, remove the implicit node.
   while (children.size() == 1)
@@ -188,7 +197,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
     size_t nearSetSize,
     size_t& farSetSize,
     size_t& usedSetSize,
-    MetricType& metric) :
+    MetricType& metric,
+    BuildBuffers* buffers,
+    const size_t depth) :
     dataset(dataset),
     point(pointIndex),
     scale(scale),
@@ -199,6 +210,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
     furthestDescendantDistance(0),
     localMetric(false),
     metric(&metric),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false),
     distanceComps(0)
 {
   // If the size of the near set is 0, this is a leaf.
@@ -211,7 +225,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
   }
 
   // Otherwise, create the children.
-  CreateChildren(indices, distances, nearSetSize, farSetSize, usedSetSize);
+  BuildBuffers localBuffers;
+  CreateChildren(indices, distances, nearSetSize, farSetSize, usedSetSize,
+      (buffers == NULL) ? localBuffers : *buffers, depth);
 
   // Initialize statistic.
   stat = StatisticType(*this);
@@ -238,6 +254,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
     furthestDescendantDistance(furthestDescendantDistance),
     localMetric(metric == NULL),
     metric(metric),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false),
     distanceComps(0)
 {
   // If necessary, create a local metric.
@@ -262,6 +281,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
     furthestDescendantDistance(other.furthestDescendantDistance),
     localMetric(false),
     metric(other.metric),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false),
     distanceComps(0)
 {
   // Copy each child by hand.
@@ -272,18 +294,257 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
   }
 }
 
+// Load a cover tree that was stored with Save().
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
+    const arma::mat& dataset,
+    std::istream& stream,
+    MetricType* metric) :
+    dataset(dataset),
+    numDescendants(0),
+    parent(NULL),
+    parentDistance(0),
+    furthestDescendantDistance(0),
+    localMetric(metric == NULL),
+    metric(metric),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false),
+    distanceComps(0)
+{
+  // If we need to create a metric, do that.  We'll just do it on the heap.
+  if (localMetric)
+    this->metric = new MetricType();
+
+  // Check the header, so that we don't try to load something that isn't a
+  // cover tree (or a tree built on a different dataset).
+  size_t magic, version, cols;
+  util::ReadBinary(stream, magic);
+  util::ReadBinary(stream, version);
+  if (magic != 0x434f5654 /* "COVT" */ || version != 1)
+    Log::Fatal << "CoverTree: stream does not hold a stored cover tree."
+        << std::endl;
+
+  util::ReadBinary(stream, cols);
+  if (cols != dataset.n_cols)
+    Log::Fatal << "CoverTree: stored tree was built on " << cols << " points, "
+        << "but the given dataset has " << dataset.n_cols << " points."
+        << std::endl;
+
+  util::ReadBinary(stream, base);
+  LoadNode(stream);
+
+  // Initialize statistic.
+  stat = StatisticType(*this);
+}
+
+// Load a child node that was stored with Save().
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
+    const arma::mat& dataset,
+    CoverTree* parent,
+    std::istream& stream) :
+    dataset(dataset),
+    base(parent->Base()),
+    numDescendants(0),
+    parent(parent),
+    parentDistance(0),
+    furthestDescendantDistance(0),
+    localMetric(false),
+    metric(&parent->Metric()),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(false),
+    distanceComps(0)
+{
+  LoadNode(stream);
+
+  // Initialize statistic.
+  stat = StatisticType(*this);
+}
+
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+void CoverTree<MetricType, RootPointPolicy, StatisticType>::Save(
+    std::ostream& stream) const
+{
+  const size_t magic = 0x434f5654; // "COVT".
+  const size_t version = 1;
+  util::WriteBinary(stream, magic);
+  util::WriteBinary(stream, version);
+  util::WriteBinary(stream, (size_t) dataset.n_cols);
+  util::WriteBinary(stream, base);
+
+  SaveNode(stream);
+}
+
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+void CoverTree<MetricType, RootPointPolicy, StatisticType>::SaveNode(
+    std::ostream& stream) const
+{
+  // Each node is stored in preorder; the children follow their parent.
+  util::WriteBinary(stream, point);
+  util::WriteBinary(stream, scale);
+  util::WriteBinary(stream, parentDistance);
+  util::WriteBinary(stream, furthestDescendantDistance);
+  util::WriteBinary(stream, numDescendants);
+  util::WriteBinary(stream, (size_t) children.size());
+
+  for (size_t i = 0; i < children.size(); ++i)
+    children[i]->SaveNode(stream);
+}
+
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+void CoverTree<MetricType, RootPointPolicy, StatisticType>::LoadNode(
+    std::istream& stream)
+{
+  size_t numChildren;
+  util::ReadBinary(stream, point);
+  util::ReadBinary(stream, scale);
+  util::ReadBinary(stream, parentDistance);
+  util::ReadBinary(stream, furthestDescendantDistance);
+  util::ReadBinary(stream, numDescendants);
+  util::ReadBinary(stream, numChildren);
+
+  if (point >= dataset.n_cols || numChildren > dataset.n_cols)
+    Log::Fatal << "CoverTree: stored node (point " << point << ", "
+        << numChildren << " children) does not match the dataset." << std::endl;
+
+  children.resize(numChildren);
+  for (size_t i = 0; i < numChildren; ++i)
+    children[i] = new CoverTree(dataset, this, stream);
+
+  // Descendant() relies on the first child holding this node's point and on
+  // the descendants of the children adding up to those of this node (a leaf
+  // has at most its own point; a root built on one point counts none).
+  size_t childDescendants = 0;
+  for (size_t i = 0; i < numChildren; ++i)
+    childDescendants += children[i]->NumDescendants();
+
+  if ((numChildren == 0 && numDescendants > 1) ||
+      (numChildren > 0 && (children[0]->Point() != point ||
+      childDescendants != numDescendants)))
+  {
+    Log::Fatal << "CoverTree: stored node (point " << point << ", "
+        << numDescendants << " descendants) does not match its children."
+        << std::endl;
+  }
+}
+
 template<typename MetricType, typename RootPointPolicy, typename StatisticType>
 CoverTree<MetricType, RootPointPolicy, StatisticType>::~CoverTree()
 {
-  // Delete each child.
+  // Delete each child.  Children stored in a node pool are destroyed by the
+  // root of the tree.
   for (size_t i = 0; i < children.size(); ++i)
-    delete children[i];
+    if (!children[i]->pooled)
+      delete children[i];
+
+  // If this is the root of a compacted tree, destroy the pooled nodes.
+  if (nodePool)
+  {
+    for (size_t i = 0; i < nodePoolSize; ++i)
+      nodePool[i].~CoverTree();
+    ::operator delete(nodePool);
+  }
 
   // Delete the local metric, if necessary.
   if (localMetric)
     delete metric;
 }
 
+/**
+ * Move every descendant of this node (which must be the root of the tree) into
+ * one contiguous block of memory, in depth-first order.
+ */
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+void CoverTree<MetricType, RootPointPolicy, StatisticType>::Compact()
+{
+  if (parent != NULL)
+    Log::Fatal << "CoverTree::Compact() must be called on the root of the "
+        << "tree." << std::endl;
+
+  // Nothing to do if the tree is already compact or has no children.
+  if (nodePool || children.empty())
+    return;
+
+  // Count the nodes below the root.
+  std::vector<const CoverTree*> countStack(children.begin(), children.end());
+  nodePoolSize = 0;
+  while (!countStack.empty())
+  {
+    const CoverTree* node = countStack.back();
+    countStack.pop_back();
+    ++nodePoolSize;
+    for (size_t i = 0; i < node->NumChildren(); ++i)
+      countStack.push_back(&node->Child(i));
+  }
+
+  nodePool = static_cast<CoverTree*>(
+      ::operator new(nodePoolSize * sizeof(CoverTree)));
+
+  // Walk the old tree in depth-first order, copying each node into the next
+  // slot of the pool and appending it to the children of its (already copied)
+  // parent.  The children of each node are pushed in reverse, so they are
+  // copied (and appended) in their original order.
+  std::vector<CoverTree*> oldChildren;
+  oldChildren.swap(children);
+
+  std::vector<std::pair<CoverTree*, CoverTree*> > stack;
+  for (size_t i = oldChildren.size(); i > 0; --i)
+    stack.push_back(std::make_pair(oldChildren[i - 1], this));
+
+  size_t index = 0;
+  while (!stack.empty())
+  {
+    CoverTree* oldNode = stack.back().first;
+    CoverTree* newParent = stack.back().second;
+    stack.pop_back();
+
+    CoverTree* node = new (nodePool + index++) CoverTree(*oldNode, newParent);
+    newParent->children.push_back(node);
+
+    for (size_t i = oldNode->NumChildren(); i > 0; --i)
+      stack.push_back(std::make_pair(&oldNode->Child(i - 1), node));
+  }
+
+  // The old nodes are no longer needed.
+  for (size_t i = 0; i < oldChildren.size(); ++i)
+    delete oldChildren[i];
+
+  // Statistics may hold pointers into the tree, so regenerate them.  In
+  // depth-first order every child comes after its parent, so walking the pool
+  // backwards builds them bottom-up.
+  for (size_t i = nodePoolSize; i > 0; --i)
+    nodePool[i - 1].stat = StatisticType(nodePool[i - 1]);
+  stat = StatisticType(*this);
+}
+
+/**
+ * Copy a single node (but not its children) into a node pool.
+ */
+template<typename MetricType, typename RootPointPolicy, typename StatisticType>
+CoverTree<MetricType, RootPointPolicy, StatisticType>::CoverTree(
+    const CoverTree& other,
+    CoverTree* parent) :
+    dataset(other.dataset),
+    point(other.point),
+    scale(other.scale),
+    base(other.base),
+    stat(other.stat),
+    numDescendants(other.numDescendants),
+    parent(parent),
+    parentDistance(other.parentDistance),
+    furthestDescendantDistance(other.furthestDescendantDistance),
+    localMetric(false),
+    metric(other.metric),
+    nodePool(NULL),
+    nodePoolSize(0),
+    pooled(true),
+    distanceComps(0)
+{
+  // Nothing to do; the children are linked by Compact().
+}
+
 //! Return the number of descendant points.
 template<typename MetricType, typename RootPointPolicy, typename StatisticType>
 inline size_t
@@ -453,7 +714,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
     arma::vec& distances,
     size_t nearSetSize,
     size_t& farSetSize,
-    size_t& usedSetSize)
+    size_t& usedSetSize,
+    BuildBuffers& buffers,
+    const size_t depth)
 {
   // Determine the next scale level.  This should be the first level where there
   // are any points in the far set.  So, if we know the maximum distance in the
@@ -471,7 +734,8 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
     // This should not modify farSetSize or usedSetSize.
     size_t tempSize = 0;
     children.push_back(new CoverTree(dataset, base, point, INT_MIN, this, 0,
-        indices, distances, 0, tempSize, usedSetSize, *metric));
+        indices, distances, 0, tempSize, usedSetSize, *metric, &buffers,
+        depth + 1));
     distanceComps += children.back()->DistanceComps();
 
     // Every point in the near set should be a leaf.
@@ -480,7 +744,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
       // farSetSize and usedSetSize will not be modified.
       children.push_back(new CoverTree(dataset, base, indices[i],
           INT_MIN, this, distances[i], indices, distances, 0, tempSize,
-          usedSetSize, *metric));
+          usedSetSize, *metric, &buffers, depth + 1));
       distanceComps += children.back()->DistanceComps();
       usedSetSize++;
     }
@@ -512,7 +776,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
   size_t childUsedSetSize = 0;
   children.push_back(new CoverTree(dataset, base, point, nextScale, this, 0,
       indices, distances, childNearSetSize, childFarSetSize, childUsedSetSize,
-      *metric));
+      *metric, &buffers, depth + 1));
   // Don't double-count the self-child (so, subtract one).
   numDescendants += children[0]->NumDescendants();
 
@@ -539,6 +803,19 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
   nearSetSize -= childUsedSetSize;
   usedSetSize += childUsedSetSize;
 
+  // The near and far sets of each child are built in the buffers for this
+  // depth.  The sets only shrink from here on, so if the buffers are big enough
+  // for the first child, they are big enough for all of them.
+  if (buffers.size() <= depth)
+    buffers.resize(depth + 1);
+  arma::Col<size_t>& childIndices = buffers[depth].first;
+  arma::vec& childDistances = buffers[depth].second;
+  if (childIndices.n_elem < nearSetSize + farSetSize)
+  {
+    childIndices.set_size(nearSetSize + farSetSize);
+    childDistances.set_size(nearSetSize + farSetSize);
+  }
+
   // Now for each point in the near set, we need to make children.  To save
   // computation later, we'll create an array holding the points in the near
   // set, and then after each run we'll check which of those (if any) were used
@@ -570,7 +847,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
       size_t childNearSetSize = 0;
       children.push_back(new CoverTree(dataset, base, indices[0], nextScale,
           this, distances[0], indices, distances, childNearSetSize, farSetSize,
-          usedSetSize, *metric));
+          usedSetSize, *metric, &buffers, depth + 1));
       distanceComps += children.back()->DistanceComps();
       numDescendants += children.back()->NumDescendants();
 
@@ -583,12 +860,9 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
       break;
     }
 
-    // Create the near and far set indices and distance vectors.  We don't fill
-    // in the self-point, yet.
-    arma::Col<size_t> childIndices(nearSetSize + farSetSize);
+    // Fill the near and far set indices.  We don't fill in the self-point, yet.
     childIndices.rows(0, (nearSetSize + farSetSize - 2)) = indices.rows(1,
         nearSetSize + farSetSize - 1);
-    arma::vec childDistances(nearSetSize + farSetSize);
 
     // Build distances for the child.
     ComputeDistances(indices[0], childIndices, childDistances, nearSetSize
@@ -612,7 +886,7 @@ CoverTree<MetricType, RootPointPolicy, StatisticType>::CreateChildren(
     childUsedSetSize = 1; // Mark self point as used.
     children.push_back(new CoverTree(dataset, base, indices[0], nextScale,
         this, distances[0], childIndices, childDistances, childNearSetSize,
-        childFarSetSize, childUsedSetSize, *metric));
+        childFarSetSize, childUsedSetSize, *metric, &buffers, depth + 1));
     numDescendants += children.back()->NumDescendants();
 
     // Remove any implicit nodes.
@@ -699,7 +973,11 @@ void CoverTree<MetricType, RootPointPolicy, StatisticType>::ComputeDistances(
   // For each point, rebuild the distances.  The indices do not need to be
   // modified.
   distanceComps += pointSetSize;
-  for (size_t i = 0; i < pointSetSize; ++i)
+
+  // Near the top of the tree the sets are large, and this is where most of the
+  // construction time goes; those are split between threads.
+  #pragma omp parallel for schedule(static) if (pointSetSize >= 4096)
+  for (omp_size_t i = 0; i < (omp_size_t) pointSetSize; ++i)
   {
     distances[i] = metric->Evaluate(dataset.unsafe_col(pointIndex),
         dataset.unsafe_col(indices[i]));
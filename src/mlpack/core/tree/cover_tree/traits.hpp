@@ -46,6 +46,11 @@ class TreeTraits<CoverTree<MetricType, RootPointPolicy, StatisticType> >
    * Points are not rearranged when the tree is built.
    */
   static const bool RearrangesDataset = false;
+
+  /**
+   * Cover trees cannot be copied so that they refer to another dataset.
+   */
+  static const bool CanCopyToDataset = false;
 };
 
 }; // namespace tree
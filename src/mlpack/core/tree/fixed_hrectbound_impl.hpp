@@ -0,0 +1,348 @@
+/**
+ * @file fixed_hrectbound_impl.hpp
+ *
+ * Implementation of the fixed-dimension hyper-rectangle bound.
+ */
+#ifndef __MLPACK_CORE_TREE_FIXED_HRECTBOUND_IMPL_HPP
+#define __MLPACK_CORE_TREE_FIXED_HRECTBOUND_IMPL_HPP
+
+#include <math.h>
+
+// In case it has not been included yet.
+#include "fixed_hrectbound.hpp"
+
+namespace mlpack {
+namespace bound {
+
+/**
+ * Empty constructor.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline FixedHRectBound<Dimensionality, Power, TakeRoot>::FixedHRectBound() :
+    minWidth(0)
+{ /* Nothing to do; each range is empty. */ }
+
+/**
+ * Initializes the bound; the dimensionality must match.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline FixedHRectBound<Dimensionality, Power, TakeRoot>::FixedHRectBound(
+    const size_t dimension) :
+    minWidth(0)
+{
+  if (dimension != Dimensionality)
+  {
+    Log::Fatal << "FixedHRectBound::FixedHRectBound(): the bound has "
+        << Dimensionality << " dimensions, but " << dimension << " were "
+        << "requested!" << std::endl;
+  }
+}
+
+/**
+ * Resets all dimensions to the empty set.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline void FixedHRectBound<Dimensionality, Power, TakeRoot>::Clear()
+{
+  for (size_t i = 0; i < Dimensionality; i++)
+    bounds[i] = math::Range();
+  minWidth = 0;
+}
+
+/**
+ * Calculates the centroid of the range, placing it into the given vector.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline void FixedHRectBound<Dimensionality, Power, TakeRoot>::Centroid(
+    arma::vec& centroid) const
+{
+  // Set size correctly if necessary.
+  if (centroid.n_elem != Dimensionality)
+    centroid.set_size(Dimensionality);
+
+  for (size_t i = 0; i < Dimensionality; i++)
+    centroid[i] = bounds[i].Mid();
+}
+
+/**
+ * Calculate the volume of the hyperrectangle.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline double FixedHRectBound<Dimensionality, Power, TakeRoot>::Volume() const
+{
+  double volume = 1.0;
+  for (size_t i = 0; i < Dimensionality; ++i)
+    volume *= (bounds[i].Hi() - bounds[i].Lo());
+
+  return volume;
+}
+
+/**
+ * Calculates minimum bound-to-point distance.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+template<typename VecType>
+inline double FixedHRectBound<Dimensionality, Power, TakeRoot>::MinDistance(
+    const VecType& point,
+    typename boost::enable_if<IsVector<VecType> >* /* junk */) const
+{
+  Log::Assert(point.n_elem == Dimensionality);
+
+  double sum = 0;
+  for (size_t d = 0; d < Dimensionality; d++)
+  {
+    // Only one of these can be positive (if the point is outside the bound in
+    // this dimension), and that one is the distance to the bound.
+    const double lower = bounds[d].Lo() - point[d];
+    const double higher = point[d] - bounds[d].Hi();
+    sum += detail::BoundPower<Power>::Pow(std::max(std::max(lower, higher),
+        0.0));
+  }
+
+  if (TakeRoot)
+    return detail::BoundPower<Power>::Root(sum);
+  else
+    return sum;
+}
+
+/**
+ * Calculates minimum bound-to-bound distance.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline double FixedHRectBound<Dimensionality, Power, TakeRoot>::MinDistance(
+    const FixedHRectBound& other) const
+{
+  double sum = 0;
+  for (size_t d = 0; d < Dimensionality; d++)
+  {
+    // At most one of these is positive (if the bounds do not overlap in this
+    // dimension), and that one is the gap between them.
+    const double lower = other.bounds[d].Lo() - bounds[d].Hi();
+    const double higher = bounds[d].Lo() - other.bounds[d].Hi();
+    sum += detail::BoundPower<Power>::Pow(std::max(std::max(lower, higher),
+        0.0));
+  }
+
+  if (TakeRoot)
+    return detail::BoundPower<Power>::Root(sum);
+  else
+    return sum;
+}
+
+/**
+ * Calculates maximum bound-to-point distance.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+template<typename VecType>
+inline double FixedHRectBound<Dimensionality, Power, TakeRoot>::MaxDistance(
+    const VecType& point,
+    typename boost::enable_if<IsVector<VecType> >* /* junk */) const
+{
+  Log::Assert(point.n_elem == Dimensionality);
+
+  double sum = 0;
+  for (size_t d = 0; d < Dimensionality; d++)
+  {
+    const double v = std::max(fabs(point[d] - bounds[d].Lo()),
+        fabs(bounds[d].Hi() - point[d]));
+    sum += detail::BoundPower<Power>::Pow(v);
+  }
+
+  if (TakeRoot)
+    return detail::BoundPower<Power>::Root(sum);
+  else
+    return sum;
+}
+
+/**
+ * Computes maximum bound-to-bound distance.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline double FixedHRectBound<Dimensionality, Power, TakeRoot>::MaxDistance(
+    const FixedHRectBound& other) const
+{
+  double sum = 0;
+  for (size_t d = 0; d < Dimensionality; d++)
+  {
+    const double v = std::max(fabs(other.bounds[d].Hi() - bounds[d].Lo()),
+        fabs(bounds[d].Hi() - other.bounds[d].Lo()));
+    sum += detail::BoundPower<Power>::Pow(v); // v is non-negative.
+  }
+
+  if (TakeRoot)
+    return detail::BoundPower<Power>::Root(sum);
+  else
+    return sum;
+}
+
+/**
+ * Calculates minimum and maximum bound-to-bound distance.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline math::Range
+FixedHRectBound<Dimensionality, Power, TakeRoot>::RangeDistance(
+    const FixedHRectBound& other) const
+{
+  double loSum = 0;
+  double hiSum = 0;
+  for (size_t d = 0; d < Dimensionality; d++)
+  {
+    const double v1 = other.bounds[d].Lo() - bounds[d].Hi();
+    const double v2 = bounds[d].Lo() - other.bounds[d].Hi();
+
+    // See HRectBound::RangeDistance().
+    loSum += detail::BoundPower<Power>::Pow(std::max(std::max(v1, v2), 0.0));
+    hiSum += detail::BoundPower<Power>::Pow(-std::min(v1, v2));
+  }
+
+  if (TakeRoot)
+    return math::Range(detail::BoundPower<Power>::Root(loSum),
+                       detail::BoundPower<Power>::Root(hiSum));
+  else
+    return math::Range(loSum, hiSum);
+}
+
+/**
+ * Calculates minimum and maximum bound-to-point distance.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+template<typename VecType>
+inline math::Range
+FixedHRectBound<Dimensionality, Power, TakeRoot>::RangeDistance(
+    const VecType& point,
+    typename boost::enable_if<IsVector<VecType> >* /* junk */) const
+{
+  Log::Assert(point.n_elem == Dimensionality);
+
+  double loSum = 0;
+  double hiSum = 0;
+  for (size_t d = 0; d < Dimensionality; d++)
+  {
+    const double v1 = bounds[d].Lo() - point[d]; // Negative if point[d] > lo.
+    const double v2 = point[d] - bounds[d].Hi(); // Negative if point[d] < hi.
+
+    // See HRectBound::RangeDistance().
+    loSum += detail::BoundPower<Power>::Pow(std::max(std::max(v1, v2), 0.0));
+    hiSum += detail::BoundPower<Power>::Pow(-std::min(v1, v2));
+  }
+
+  if (TakeRoot)
+    return math::Range(detail::BoundPower<Power>::Root(loSum),
+                       detail::BoundPower<Power>::Root(hiSum));
+  else
+    return math::Range(loSum, hiSum);
+}
+
+/**
+ * Expands this region to include new points.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+template<typename MatType>
+inline FixedHRectBound<Dimensionality, Power, TakeRoot>&
+FixedHRectBound<Dimensionality, Power, TakeRoot>::operator|=(
+    const MatType& data)
+{
+  Log::Assert(data.n_rows == Dimensionality);
+
+  // Walk the points directly instead of computing the minimum and maximum of
+  // each row with Armadillo, which would allocate two temporary vectors.
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    for (size_t d = 0; d < Dimensionality; ++d)
+    {
+      const double value = data(d, i);
+      if (value < bounds[d].Lo())
+        bounds[d].Lo() = value;
+      if (value > bounds[d].Hi())
+        bounds[d].Hi() = value;
+    }
+  }
+
+  minWidth = DBL_MAX;
+  for (size_t d = 0; d < Dimensionality; d++)
+  {
+    const double width = bounds[d].Width();
+    if (width < minWidth)
+      minWidth = width;
+  }
+
+  return *this;
+}
+
+/**
+ * Expands this region to encompass another bound.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline FixedHRectBound<Dimensionality, Power, TakeRoot>&
+FixedHRectBound<Dimensionality, Power, TakeRoot>::operator|=(
+    const FixedHRectBound& other)
+{
+  minWidth = DBL_MAX;
+  for (size_t i = 0; i < Dimensionality; i++)
+  {
+    bounds[i] |= other.bounds[i];
+    const double width = bounds[i].Width();
+    if (width < minWidth)
+      minWidth = width;
+  }
+
+  return *this;
+}
+
+/**
+ * Determines if a point is within this bound.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+template<typename VecType>
+inline bool FixedHRectBound<Dimensionality, Power, TakeRoot>::Contains(
+    const VecType& point) const
+{
+  for (size_t i = 0; i < Dimensionality; i++)
+  {
+    if (!bounds[i].Contains(point[i]))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * Returns the diameter of the hyperrectangle (that is, the longest diagonal).
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+inline double FixedHRectBound<Dimensionality, Power, TakeRoot>::Diameter()
+    const
+{
+  double d = 0;
+  for (size_t i = 0; i < Dimensionality; ++i)
+    d += detail::BoundPower<Power>::Pow(bounds[i].Hi() - bounds[i].Lo());
+
+  if (TakeRoot)
+    return detail::BoundPower<Power>::Root(d);
+  else
+    return d;
+}
+
+/**
+ * Returns a string representation of this object.
+ */
+template<size_t Dimensionality, int Power, bool TakeRoot>
+std::string FixedHRectBound<Dimensionality, Power, TakeRoot>::ToString() const
+{
+  std::ostringstream convert;
+  convert << "FixedHRectBound [" << this << "]" << std::endl;
+  convert << "  Power: " << Power << std::endl;
+  convert << "  TakeRoot: " << (TakeRoot ? "true" : "false") << std::endl;
+  convert << "  Dimensionality: " << Dimensionality << std::endl;
+  convert << "  Bounds: " << std::endl;
+  for (size_t i = 0; i < Dimensionality; ++i)
+    convert << util::Indent(bounds[i].ToString()) << std::endl;
+  convert << "  Minimum width: " << minWidth << std::endl;
+
+  return convert.str();
+}
+
+}; // namespace bound
+}; // namespace mlpack
+
+#endif // __MLPACK_CORE_TREE_FIXED_HRECTBOUND_IMPL_HPP
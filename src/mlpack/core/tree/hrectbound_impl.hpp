@@ -16,6 +16,40 @@
 
 namespace mlpack {
 namespace bound {
+namespace detail {
+
+/**
+ * Raise distances along each dimension to the given power, and take the root of
+ * their sum.  This is specialized for the L1 and L2 distances so that the
+ * distance computations of HRectBound avoid calls to pow() and can be
+ * vectorized by the compiler.
+ */
+template<int Power>
+struct BoundPower
+{
+  //! Raise the given (nonnegative) distance to the power.
+  static double Pow(const double x) { return pow(x, (double) Power); }
+  //! Take the root of the given sum of powers.
+  static double Root(const double x) { return pow(x, 1.0 / (double) Power); }
+};
+
+//! The L1 distance needs no powers or roots.
+template<>
+struct BoundPower<1>
+{
+  static double Pow(const double x) { return x; }
+  static double Root(const double x) { return x; }
+};
+
+//! The L2 distance only needs a square and a square root.
+template<>
+struct BoundPower<2>
+{
+  static double Pow(const double x) { return x * x; }
+  static double Root(const double x) { return sqrt(x); }
+};
+
+}; // namespace detail
 
 /**
  * Empty constructor.
@@ -142,61 +176,48 @@ inline double HRectBound<Power, TakeRoot>::MinDistance(
   Log::Assert(point.n_elem == dim);
 
   double sum = 0;
-
-  double lower, higher;
   for (size_t d = 0; d < dim; d++)
   {
-    lower = bounds[d].Lo() - point[d];
-    higher = point[d] - bounds[d].Hi();
-
-    // Since only one of 'lower' or 'higher' is negative, if we add each's
-    // absolute value to itself and then sum those two, our result is the
-    // nonnegative half of the equation times two; then we raise to power Power.
-    sum += pow((lower + fabs(lower)) + (higher + fabs(higher)), (double) Power);
+    // Only one of these can be positive (if the point is outside the bound in
+    // this dimension), and that one is the distance to the bound.
+    const double lower = bounds[d].Lo() - point[d];
+    const double higher = point[d] - bounds[d].Hi();
+    sum += detail::BoundPower<Power>::Pow(std::max(std::max(lower, higher),
+        0.0));
   }
 
-  // Now take the Power'th root (but make sure our result is squared if it needs
-  // to be); then cancel out the constant of 2 (which may have been squared now)
-  // that was introduced earlier.  The compiler should optimize out the if
-  // statement entirely.
+  // The compiler should optimize out this if statement entirely.
   if (TakeRoot)
-    return pow(sum, 1.0 / (double) Power) / 2.0;
+    return detail::BoundPower<Power>::Root(sum);
   else
-    return sum / pow(2.0, Power);
+    return sum;
 }
 
 /**
  * Calculates minimum bound-to-bound squared distance.
  */
 template<int Power, bool TakeRoot>
-double HRectBound<Power, TakeRoot>::MinDistance(const HRectBound& other) const
+inline double HRectBound<Power, TakeRoot>::MinDistance(const HRectBound& other)
+    const
 {
   Log::Assert(dim == other.dim);
 
   double sum = 0;
-  const math::Range* mbound = bounds;
-  const math::Range* obound = other.bounds;
-
-  double lower, higher;
   for (size_t d = 0; d < dim; d++)
   {
-    lower = obound->Lo() - mbound->Hi();
-    higher = mbound->Lo() - obound->Hi();
-    // We invoke the following:
-    //   x + fabs(x) = max(x * 2, 0)
-    //   (x * 2)^2 / 4 = x^2
-    sum += pow((lower + fabs(lower)) + (higher + fabs(higher)), (double) Power);
-
-    // Move bound pointers.
-    mbound++;
-    obound++;
+    // At most one of these is positive (if the bounds do not overlap in this
+    // dimension), and that one is the gap between them.
+    const double lower = other.bounds[d].Lo() - bounds[d].Hi();
+    const double higher = bounds[d].Lo() - other.bounds[d].Hi();
+    sum += detail::BoundPower<Power>::Pow(std::max(std::max(lower, higher),
+        0.0));
   }
 
   // The compiler should optimize out this if statement entirely.
   if (TakeRoot)
-    return pow(sum, 1.0 / (double) Power) / 2.0;
+    return detail::BoundPower<Power>::Root(sum);
   else
-    return sum / pow(2.0, Power);
+    return sum;
 }
 
 /**
@@ -208,20 +229,19 @@ inline double HRectBound<Power, TakeRoot>::MaxDistance(
     const VecType& point,
     typename boost::enable_if<IsVector<VecType> >* /* junk */) const
 {
-  double sum = 0;
-
   Log::Assert(point.n_elem == dim);
 
+  double sum = 0;
   for (size_t d = 0; d < dim; d++)
   {
-    double v = std::max(fabs(point[d] - bounds[d].Lo()),
+    const double v = std::max(fabs(point[d] - bounds[d].Lo()),
         fabs(bounds[d].Hi() - point[d]));
-    sum += pow(v, (double) Power);
+    sum += detail::BoundPower<Power>::Pow(v);
   }
 
   // The compiler should optimize out this if statement entirely.
   if (TakeRoot)
-    return pow(sum, 1.0 / (double) Power);
+    return detail::BoundPower<Power>::Root(sum);
   else
     return sum;
 }
@@ -233,21 +253,19 @@ template<int Power, bool TakeRoot>
 inline double HRectBound<Power, TakeRoot>::MaxDistance(const HRectBound& other)
     const
 {
-  double sum = 0;
-
   Log::Assert(dim == other.dim);
 
-  double v;
+  double sum = 0;
   for (size_t d = 0; d < dim; d++)
   {
-    v = std::max(fabs(other.bounds[d].Hi() - bounds[d].Lo()),
+    const double v = std::max(fabs(other.bounds[d].Hi() - bounds[d].Lo()),
         fabs(bounds[d].Hi() - other.bounds[d].Lo()));
-    sum += pow(v, (double) Power); // v is non-negative.
+    sum += detail::BoundPower<Power>::Pow(v); // v is non-negative.
   }
 
   // The compiler should optimize out this if statement entirely.
   if (TakeRoot)
-    return pow(sum, 1.0 / (double) Power);
+    return detail::BoundPower<Power>::Root(sum);
   else
     return sum;
 }
@@ -259,35 +277,24 @@ template<int Power, bool TakeRoot>
 inline math::Range HRectBound<Power, TakeRoot>::RangeDistance(
     const HRectBound& other) const
 {
-  double loSum = 0;
-  double hiSum = 0;
-
   Log::Assert(dim == other.dim);
 
-  double v1, v2, vLo, vHi;
+  double loSum = 0;
+  double hiSum = 0;
   for (size_t d = 0; d < dim; d++)
   {
-    v1 = other.bounds[d].Lo() - bounds[d].Hi();
-    v2 = bounds[d].Lo() - other.bounds[d].Hi();
-    // One of v1 or v2 is negative.
-    if (v1 >= v2)
-    {
-      vHi = -v2; // Make it nonnegative.
-      vLo = (v1 > 0) ? v1 : 0; // Force to be 0 if negative.
-    }
-    else
-    {
-      vHi = -v1; // Make it nonnegative.
-      vLo = (v2 > 0) ? v2 : 0; // Force to be 0 if negative.
-    }
-
-    loSum += pow(vLo, (double) Power);
-    hiSum += pow(vHi, (double) Power);
+    const double v1 = other.bounds[d].Lo() - bounds[d].Hi();
+    const double v2 = bounds[d].Lo() - other.bounds[d].Hi();
+
+    // At most one of v1 or v2 is positive, and that one is the gap between the
+    // bounds; the smaller one, negated, is the largest distance between them.
+    loSum += detail::BoundPower<Power>::Pow(std::max(std::max(v1, v2), 0.0));
+    hiSum += detail::BoundPower<Power>::Pow(-std::min(v1, v2));
   }
 
   if (TakeRoot)
-    return math::Range(pow(loSum, 1.0 / (double) Power),
-                       pow(hiSum, 1.0 / (double) Power));
+    return math::Range(detail::BoundPower<Power>::Root(loSum),
+                       detail::BoundPower<Power>::Root(hiSum));
   else
     return math::Range(loSum, hiSum);
 }
@@ -301,43 +308,25 @@ inline math::Range HRectBound<Power, TakeRoot>::RangeDistance(
     const VecType& point,
     typename boost::enable_if<IsVector<VecType> >* /* junk */) const
 {
-  double loSum = 0;
-  double hiSum = 0;
-
   Log::Assert(point.n_elem == dim);
 
-  double v1, v2, vLo, vHi;
+  double loSum = 0;
+  double hiSum = 0;
   for (size_t d = 0; d < dim; d++)
   {
-    v1 = bounds[d].Lo() - point[d]; // Negative if point[d] > lo.
-    v2 = point[d] - bounds[d].Hi(); // Negative if point[d] < hi.
-    // One of v1 or v2 (or both) is negative.
-    if (v1 >= 0) // point[d] <= bounds_[d].Lo().
-    {
-      vHi = -v2; // v2 will be larger but must be negated.
-      vLo = v1;
-    }
-    else // point[d] is between lo and hi, or greater than hi.
-    {
-      if (v2 >= 0)
-      {
-        vHi = -v1; // v1 will be larger, but must be negated.
-        vLo = v2;
-      }
-      else
-      {
-        vHi = -std::min(v1, v2); // Both are negative, but we need the larger.
-        vLo = 0;
-      }
-    }
-
-    loSum += pow(vLo, (double) Power);
-    hiSum += pow(vHi, (double) Power);
+    const double v1 = bounds[d].Lo() - point[d]; // Negative if point[d] > lo.
+    const double v2 = point[d] - bounds[d].Hi(); // Negative if point[d] < hi.
+
+    // At most one of v1 or v2 is positive (if the point is outside the bound in
+    // this dimension), and that one is the distance to the bound; the smaller
+    // one, negated, is the distance to the far side of the bound.
+    loSum += detail::BoundPower<Power>::Pow(std::max(std::max(v1, v2), 0.0));
+    hiSum += detail::BoundPower<Power>::Pow(-std::min(v1, v2));
   }
 
   if (TakeRoot)
-    return math::Range(pow(loSum, 1.0 / (double) Power),
-                       pow(hiSum, 1.0 / (double) Power));
+    return math::Range(detail::BoundPower<Power>::Root(loSum),
+                       detail::BoundPower<Power>::Root(hiSum));
   else
     return math::Range(loSum, hiSum);
 }
@@ -352,8 +341,10 @@ inline HRectBound<Power, TakeRoot>& HRectBound<Power, TakeRoot>::operator|=(
 {
   Log::Assert(data.n_rows == dim);
 
-  arma::vec mins(min(data, 1));
-  arma::vec maxs(max(data, 1));
+  // Use the element type of the data, so that this works for single precision
+  // matrices too.
+  arma::Col<typename MatType::elem_type> mins(min(data, 1));
+  arma::Col<typename MatType::elem_type> maxs(max(data, 1));
 
   minWidth = DBL_MAX;
   for (size_t i = 0; i < dim; i++)
@@ -412,10 +403,10 @@ inline double HRectBound<Power, TakeRoot>::Diameter() const
 {
   double d = 0;
   for (size_t i = 0; i < dim; ++i)
-    d += std::pow(bounds[i].Hi() - bounds[i].Lo(), (double) Power);
+    d += detail::BoundPower<Power>::Pow(bounds[i].Hi() - bounds[i].Lo());
 
   if (TakeRoot)
-    return std::pow(d, 1.0 / (double) Power);
+    return detail::BoundPower<Power>::Root(d);
   else
     return d;
 }
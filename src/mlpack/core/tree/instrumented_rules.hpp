@@ -0,0 +1,142 @@
+/**
+ * @file instrumented_rules.hpp
+ *
+ * A wrapper around the rules of a tree traversal, which reports every call the
+ * traverser makes to an instrumentation policy (see
+ * traversal_instrumentation.hpp).
+ */
+#ifndef __MLPACK_CORE_TREE_INSTRUMENTED_RULES_HPP
+#define __MLPACK_CORE_TREE_INSTRUMENTED_RULES_HPP
+
+#include <mlpack/core.hpp>
+#include "base_case_range.hpp"
+#include "traversal_instrumentation.hpp"
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * Wrap the given rules so that a traverser can be run with them, reporting
+ * every call to Score(), Rescore() and BaseCase() to the given instrumentation
+ * object.  Each call is forwarded to the wrapped rules, so the results of the
+ * traversal are unchanged.  With NoTraversalInstrumentation every call is
+ * forwarded directly.
+ *
+ * @code
+ * RuleType rules(...);
+ * InstrumentationType instrumentation;
+ * InstrumentedRules<RuleType, InstrumentationType> instrumentedRules(rules,
+ *     instrumentation);
+ * typename TreeType::template DualTreeTraverser<InstrumentedRules<RuleType,
+ *     InstrumentationType> > traverser(instrumentedRules);
+ * traverser.Traverse(*queryTree, *referenceTree);
+ * @endcode
+ *
+ * @tparam RuleType Rules of the traversal.
+ * @tparam InstrumentationType Instrumentation policy to report calls to.
+ */
+template<typename RuleType, typename InstrumentationType>
+class InstrumentedRules
+{
+ public:
+  //! The traversal info of the wrapped rules.
+  typedef typename RuleType::TraversalInfoType TraversalInfoType;
+
+  /**
+   * Wrap the given rules.  Neither object is copied, so both must outlive this
+   * one.
+   *
+   * @param rules Rules to forward calls to.
+   * @param instrumentation Instrumentation to report calls to.
+   */
+  InstrumentedRules(RuleType& rules, InstrumentationType& instrumentation) :
+      rules(rules),
+      instrumentation(instrumentation)
+  { /* Nothing to do. */ }
+
+  //! Evaluate the base case between two points.
+  double BaseCase(const size_t queryIndex, const size_t referenceIndex)
+  {
+    const uint64_t start = instrumentation.Start();
+    const double result = rules.BaseCase(queryIndex, referenceIndex);
+    instrumentation.BaseCases(1, start);
+    return result;
+  }
+
+  //! Evaluate the base case between a point and a range of reference points.
+  void BaseCaseRange(const size_t queryIndex,
+                     const size_t referenceBegin,
+                     const size_t referenceEnd)
+  {
+    const uint64_t start = instrumentation.Start();
+    BaseCases(rules, queryIndex, referenceBegin, referenceEnd);
+    instrumentation.BaseCases(referenceEnd - referenceBegin, start);
+  }
+
+  //! Score a query point and a reference node.
+  template<typename TreeType>
+  double Score(const size_t queryIndex, TreeType& referenceNode)
+  {
+    const uint64_t start = instrumentation.Start();
+    const double score = rules.Score(queryIndex, referenceNode);
+    instrumentation.Score((const TreeType*) NULL, referenceNode, score, start);
+    return score;
+  }
+
+  //! Score a query node and a reference node.
+  template<typename TreeType>
+  double Score(TreeType& queryNode, TreeType& referenceNode)
+  {
+    const uint64_t start = instrumentation.Start();
+    const double score = rules.Score(queryNode, referenceNode);
+    instrumentation.Score((const TreeType*) &queryNode, referenceNode, score,
+        start);
+    return score;
+  }
+
+  //! Rescore a query point and a reference node.
+  template<typename TreeType>
+  double Rescore(const size_t queryIndex,
+                 TreeType& referenceNode,
+                 const double oldScore)
+  {
+    const double score = rules.Rescore(queryIndex, referenceNode, oldScore);
+    instrumentation.Rescore((const TreeType*) NULL, referenceNode, oldScore,
+        score);
+    return score;
+  }
+
+  //! Rescore a query node and a reference node.
+  template<typename TreeType>
+  double Rescore(TreeType& queryNode,
+                 TreeType& referenceNode,
+                 const double oldScore)
+  {
+    const double score = rules.Rescore(queryNode, referenceNode, oldScore);
+    instrumentation.Rescore((const TreeType*) &queryNode, referenceNode,
+        oldScore, score);
+    return score;
+  }
+
+  //! Get the traversal info of the wrapped rules.
+  const TraversalInfoType& TraversalInfo() const
+  { return rules.TraversalInfo(); }
+  //! Modify the traversal info of the wrapped rules.
+  TraversalInfoType& TraversalInfo() { return rules.TraversalInfo(); }
+
+  //! Get the wrapped rules.
+  const RuleType& Rules() const { return rules; }
+  //! Modify the wrapped rules.
+  RuleType& Rules() { return rules; }
+
+ private:
+  //! The wrapped rules.
+  RuleType& rules;
+  //! The instrumentation calls are reported to.
+  InstrumentationType& instrumentation;
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
@@ -15,7 +15,12 @@ MRKDStatistic::MRKDStatistic() :
     count(0),
     leftStat(NULL),
     rightStat(NULL),
-    parentStat(NULL)
+    parentStat(NULL),
+    sumOfSquaredNorms(0.0),
+    weight(0.0),
+    radius(0.0),
+    dominatingCentroid(0),
+    isWhitelistValid(false)
 { }
 
 /**
@@ -29,6 +34,8 @@ std::string MRKDStatistic::ToString() const
   convert << "begin: " << begin << std::endl;
   convert << "count: " << count << std::endl;
   convert << "sumOfSquaredNorms: " << sumOfSquaredNorms << std::endl;
+  convert << "weight: " << weight << std::endl;
+  convert << "radius: " << radius << std::endl;
   if (leftStat != NULL)
   {
     convert << "leftStat:" << std::endl;
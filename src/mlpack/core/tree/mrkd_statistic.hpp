@@ -13,7 +13,12 @@ namespace mlpack {
 namespace tree {
 
 /**
- * Statistic for multi-resolution kd-trees.
+ * Statistic for multi-resolution kd-trees.  Besides the extent of the node,
+ * this can hold the (weighted) sufficient statistics of the points in the
+ * node: their total weight, their center of mass, and their scatter matrix
+ * around the center of mass.  These are not computed when the tree is built,
+ * since they depend on the point weights; algorithms that use them (such as
+ * gmm::MRKDEMFit) fill them in after building the tree.
  */
 class MRKDStatistic
 {
@@ -54,6 +59,26 @@ class MRKDStatistic
   //! Modify the index of the dominating centroid.
   size_t& DominatingCentroid() { return dominatingCentroid; }
 
+  //! Get the total weight of the points in the node.
+  double Weight() const { return weight; }
+  //! Modify the total weight of the points in the node.
+  double& Weight() { return weight; }
+
+  //! Get the weighted scatter matrix of the points around the center of mass.
+  const arma::mat& Scatter() const { return scatter; }
+  //! Modify the weighted scatter matrix around the center of mass.
+  arma::mat& Scatter() { return scatter; }
+
+  //! Get the maximum distance from the center of mass to any point.
+  double Radius() const { return radius; }
+  //! Modify the maximum distance from the center of mass to any point.
+  double& Radius() { return radius; }
+
+  //! Get the sum of the squared Euclidean norms of the points.
+  double SumOfSquaredNorms() const { return sumOfSquaredNorms; }
+  //! Modify the sum of the squared Euclidean norms of the points.
+  double& SumOfSquaredNorms() { return sumOfSquaredNorms; }
+
   //! Access the whitelist.
   const std::vector<size_t>& Whitelist() const { return whitelist; }
   //! Modify the whitelist.
@@ -78,6 +103,12 @@ class MRKDStatistic
   arma::colvec centerOfMass;
   //! The sum of the squared Euclidean norms for this dataset.
   double sumOfSquaredNorms;
+  //! The total weight of the points.
+  double weight;
+  //! The weighted scatter matrix of the points around the center of mass.
+  arma::mat scatter;
+  //! The maximum distance from the center of mass to any point.
+  double radius;
 
   // There may be a better place to store this -- HRectBound?
   //! The index of the dominating centroid of the associated hyperrectangle.
@@ -20,7 +20,12 @@ MRKDStatistic::MRKDStatistic(const TreeType& /* node */) :
     count(0),
     leftStat(NULL),
     rightStat(NULL),
-    parentStat(NULL)
+    parentStat(NULL),
+    sumOfSquaredNorms(0.0),
+    weight(0.0),
+    radius(0.0),
+    dominatingCentroid(0),
+    isWhitelistValid(false)
 { }
 
 /**
@@ -0,0 +1,143 @@
+/**
+ * @file priority_dual_tree_traverser.hpp
+ *
+ * Defines the PriorityDualTreeTraverser, which traverses two trees of any type
+ * best-first: the node combinations are held in a priority queue ordered by
+ * score, so the most promising combination anywhere in the traversal is always
+ * visited next.
+ */
+#ifndef __MLPACK_CORE_TREE_PRIORITY_DUAL_TREE_TRAVERSER_HPP
+#define __MLPACK_CORE_TREE_PRIORITY_DUAL_TREE_TRAVERSER_HPP
+
+#include <mlpack/core.hpp>
+#include "tree_traits.hpp"
+
+#include <queue>
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * A best-first dual-tree traverser.  Where the depth-first traversers only
+ * choose the order to visit the children of the current node combination in,
+ * this traverser keeps every node combination that has been scored but not yet
+ * visited in a priority queue, and always visits the combination with the best
+ * (lowest) score next.  For problems like k-nearest-neighbor search with small
+ * k, this finds good candidates for every query node early, so the bounds used
+ * for pruning tighten sooner and fewer base cases are computed overall.  Each
+ * combination is rescored when it is taken from the queue, since the bounds may
+ * have tightened since it was scored.
+ *
+ * The traverser uses only the generic tree API (IsLeaf(), NumChildren(),
+ * Child(), NumPoints(), Point() and FurthestDescendantDistance()), so it works
+ * with any tree type; the trees use it for their BestFirstDualTreeTraverser
+ * classes.  At each combination, the node with the larger furthest descendant
+ * distance is split (or the one that is not a leaf).  If the first point of
+ * each node is its centroid (as for cover trees), the base case between the
+ * two centroids is evaluated when each combination is scored, as the cover tree
+ * traverser does; otherwise, base cases are only evaluated between two leaves.
+ *
+ * The queue can hold many more combinations than the stack of a depth-first
+ * traversal, so this uses more memory.
+ *
+ * @tparam TreeType Type of the trees to traverse.
+ * @tparam RuleType Type of the rules which score combinations and evaluate base
+ *     cases.
+ */
+template<typename TreeType, typename RuleType>
+class PriorityDualTreeTraverser
+{
+ public:
+  /**
+   * Instantiate the dual-tree traverser with the given rule set.
+   */
+  PriorityDualTreeTraverser(RuleType& rule);
+
+  /**
+   * Traverse the two trees.  This does not reset the number of prunes.
+   *
+   * @param queryNode The query node to be traversed.
+   * @param referenceNode The reference node to be traversed.
+   */
+  void Traverse(TreeType& queryNode, TreeType& referenceNode);
+
+  //! Get the number of prunes.
+  size_t NumPrunes() const { return numPrunes; }
+  //! Modify the number of prunes.
+  size_t& NumPrunes() { return numPrunes; }
+
+  //! Get the number of visited combinations.
+  size_t NumVisited() const { return numVisited; }
+  //! Modify the number of visited combinations.
+  size_t& NumVisited() { return numVisited; }
+
+  //! Get the number of times a node combination was scored.
+  size_t NumScores() const { return numScores; }
+  //! Modify the number of times a node combination was scored.
+  size_t& NumScores() { return numScores; }
+
+  //! Get the number of times a base case was calculated.
+  size_t NumBaseCases() const { return numBaseCases; }
+  //! Modify the number of times a base case was calculated.
+  size_t& NumBaseCases() { return numBaseCases; }
+
+ private:
+  //! A node combination which has been scored but not yet visited.
+  struct QueueEntry
+  {
+    //! The query node.
+    TreeType* queryNode;
+    //! The reference node.
+    TreeType* referenceNode;
+    //! The score of the combination.
+    double score;
+    //! The traversal information after the combination was scored.
+    typename RuleType::TraversalInfoType traversalInfo;
+  };
+
+  //! Order queue entries so that the one with the lowest score is on top.
+  struct QueueEntryCompare
+  {
+    bool operator()(const QueueEntry& a, const QueueEntry& b) const
+    {
+      return a.score > b.score;
+    }
+  };
+
+  //! The type of the queue of node combinations.
+  typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+      QueueEntryCompare> QueueType;
+
+  /**
+   * Score the given combination, and add it to the queue unless it can be
+   * pruned.  The traversal information of the rules must be set to that of the
+   * parent combination before this is called.
+   */
+  void Score(TreeType& queryNode, TreeType& referenceNode, QueueType& queue);
+
+  //! Evaluate the base cases between the points of two leaves.
+  void BaseCases(TreeType& queryNode, TreeType& referenceNode);
+
+  //! Reference to the rules with which the trees will be traversed.
+  RuleType& rule;
+
+  //! The number of prunes.
+  size_t numPrunes;
+
+  //! The number of node combinations that have been visited during traversal.
+  size_t numVisited;
+
+  //! The number of times a node combination was scored.
+  size_t numScores;
+
+  //! The number of times a base case was calculated.
+  size_t numBaseCases;
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+// Include implementation.
+#include "priority_dual_tree_traverser_impl.hpp"
+
+#endif // __MLPACK_CORE_TREE_PRIORITY_DUAL_TREE_TRAVERSER_HPP
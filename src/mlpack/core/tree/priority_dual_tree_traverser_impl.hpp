@@ -0,0 +1,141 @@
+/**
+ * @file priority_dual_tree_traverser_impl.hpp
+ *
+ * Implementation of the PriorityDualTreeTraverser, a best-first dual-tree
+ * traverser for any type of tree.
+ */
+#ifndef __MLPACK_CORE_TREE_PRIORITY_DUAL_TREE_TRAVERSER_IMPL_HPP
+#define __MLPACK_CORE_TREE_PRIORITY_DUAL_TREE_TRAVERSER_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "priority_dual_tree_traverser.hpp"
+
+namespace mlpack {
+namespace tree {
+
+template<typename TreeType, typename RuleType>
+PriorityDualTreeTraverser<TreeType, RuleType>::PriorityDualTreeTraverser(
+    RuleType& rule) :
+    rule(rule),
+    numPrunes(0),
+    numVisited(0),
+    numScores(0),
+    numBaseCases(0)
+{ /* Nothing to do. */ }
+
+template<typename TreeType, typename RuleType>
+void PriorityDualTreeTraverser<TreeType, RuleType>::Traverse(
+    TreeType& queryRoot,
+    TreeType& referenceRoot)
+{
+  QueueType queue;
+
+  // Score the roots to start the queue.
+  Score(queryRoot, referenceRoot, queue);
+
+  while (!queue.empty())
+  {
+    const QueueEntry entry = queue.top();
+    queue.pop();
+
+    TreeType& queryNode = *entry.queryNode;
+    TreeType& referenceNode = *entry.referenceNode;
+
+    // The bounds may have tightened since this combination was scored, so it
+    // may be possible to prune it now.
+    rule.TraversalInfo() = entry.traversalInfo;
+    if (rule.Rescore(queryNode, referenceNode, entry.score) == DBL_MAX)
+    {
+      ++numPrunes;
+      continue;
+    }
+
+    ++numVisited;
+
+    if (queryNode.IsLeaf() && referenceNode.IsLeaf())
+    {
+      BaseCases(queryNode, referenceNode);
+      continue;
+    }
+
+    // Split the larger of the two nodes (or the one that isn't a leaf).  The
+    // traversal information of this combination is restored before each child
+    // combination is scored, since scoring changes it.
+    if (!referenceNode.IsLeaf() && (queryNode.IsLeaf() ||
+        referenceNode.FurthestDescendantDistance() >=
+        queryNode.FurthestDescendantDistance()))
+    {
+      for (size_t i = 0; i < referenceNode.NumChildren(); ++i)
+      {
+        rule.TraversalInfo() = entry.traversalInfo;
+        Score(queryNode, referenceNode.Child(i), queue);
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < queryNode.NumChildren(); ++i)
+      {
+        rule.TraversalInfo() = entry.traversalInfo;
+        Score(queryNode.Child(i), referenceNode, queue);
+      }
+    }
+  }
+}
+
+template<typename TreeType, typename RuleType>
+void PriorityDualTreeTraverser<TreeType, RuleType>::Score(
+    TreeType& queryNode,
+    TreeType& referenceNode,
+    QueueType& queue)
+{
+  const double score = rule.Score(queryNode, referenceNode);
+  ++numScores;
+
+  if (score == DBL_MAX)
+  {
+    ++numPrunes;
+    return;
+  }
+
+  // If the first point of each node is its centroid, the rules have just
+  // evaluated the base case between the centroids to score the combination, so
+  // this is cached and cheap; it is done here so that it isn't left to the
+  // rules.
+  if (TreeTraits<TreeType>::FirstPointIsCentroid)
+  {
+    rule.BaseCase(queryNode.Point(0), referenceNode.Point(0));
+    ++numBaseCases;
+  }
+
+  QueueEntry entry;
+  entry.queryNode = &queryNode;
+  entry.referenceNode = &referenceNode;
+  entry.score = score;
+  entry.traversalInfo = rule.TraversalInfo();
+  queue.push(entry);
+}
+
+template<typename TreeType, typename RuleType>
+void PriorityDualTreeTraverser<TreeType, RuleType>::BaseCases(
+    TreeType& queryNode,
+    TreeType& referenceNode)
+{
+  for (size_t i = 0; i < queryNode.NumPoints(); ++i)
+  {
+    for (size_t j = 0; j < referenceNode.NumPoints(); ++j)
+    {
+      // The base case between the centroids was evaluated when the combination
+      // was scored.
+      if (TreeTraits<TreeType>::FirstPointIsCentroid && i == 0 && j == 0)
+        continue;
+
+      rule.BaseCase(queryNode.Point(i), referenceNode.Point(j));
+      ++numBaseCases;
+    }
+  }
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif // __MLPACK_CORE_TREE_PRIORITY_DUAL_TREE_TRAVERSER_IMPL_HPP
@@ -0,0 +1,165 @@
+/**
+ * @file priority_single_tree_traverser.hpp
+ *
+ * Defines the PrioritySingleTreeTraverser, which traverses a tree of any type
+ * best-first for each query point, and can stop early when a budget of base
+ * cases or time runs out.
+ */
+#ifndef __MLPACK_CORE_TREE_PRIORITY_SINGLE_TREE_TRAVERSER_HPP
+#define __MLPACK_CORE_TREE_PRIORITY_SINGLE_TREE_TRAVERSER_HPP
+
+#include <mlpack/core.hpp>
+#include "tree_traits.hpp"
+
+#include <queue>
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * A best-first single-tree traverser, for anytime search.  The reference nodes
+ * that have been scored but not yet visited are kept in a priority queue, and
+ * the node with the best (lowest) score is always visited next, so the best
+ * candidates are usually found first.  That makes it possible to stop the
+ * traversal early and still have good results: if MaxBaseCases() or
+ * TimeLimit() is set, the traversal of each query point stops when that many
+ * base cases have been evaluated, or that many seconds have passed.  After
+ * each traversal, Exact() tells whether the results are exact: either the
+ * traversal finished, or every node left in the queue can be pruned.
+ *
+ * The traverser uses only the generic tree API (IsLeaf(), NumChildren(),
+ * Child(), NumPoints(), Point() and Parent()), so it works with any tree type.
+ * If the first point of each node is its centroid (as for cover trees), the
+ * base case with the centroid is evaluated when the node is scored (just after
+ * the rules evaluated it, so the rules can use their cached value); if the tree
+ * has self-children, a point is only evaluated at the highest node it is the
+ * centroid of.  Otherwise, base cases are evaluated at the leaves.
+ *
+ * The time limit is checked every few nodes, since reading the clock is not
+ * free, so a traversal can overrun it slightly.
+ *
+ * @tparam TreeType Type of the tree to traverse.
+ * @tparam RuleType Type of the rules which score nodes and evaluate base cases.
+ */
+template<typename TreeType, typename RuleType>
+class PrioritySingleTreeTraverser
+{
+ public:
+  /**
+   * Instantiate the traverser with the given rule set.
+   *
+   * @param rule Rules to traverse with.
+   * @param maxBaseCases Largest number of base cases to evaluate for each query
+   *     point (0 means no limit).
+   * @param timeLimit Largest number of seconds to spend on each query point (0
+   *     means no limit).
+   */
+  PrioritySingleTreeTraverser(RuleType& rule,
+                              const size_t maxBaseCases = 0,
+                              const double timeLimit = 0.0);
+
+  /**
+   * Traverse the tree with the given query point.
+   *
+   * @param queryIndex The index of the query point.
+   * @param referenceNode The tree node to be traversed.
+   */
+  void Traverse(const size_t queryIndex, TreeType& referenceNode);
+
+  //! Get whether the results of the last traversal are exact.
+  bool Exact() const { return exact; }
+
+  //! Get the largest number of base cases for each query point (0 means no
+  //! limit).
+  size_t MaxBaseCases() const { return maxBaseCases; }
+  //! Modify the largest number of base cases for each query point.
+  size_t& MaxBaseCases() { return maxBaseCases; }
+
+  //! Get the time limit for each query point in seconds (0 means no limit).
+  double TimeLimit() const { return timeLimit; }
+  //! Modify the time limit for each query point in seconds.
+  double& TimeLimit() { return timeLimit; }
+
+  //! Get the number of prunes.
+  size_t NumPrunes() const { return numPrunes; }
+  //! Modify the number of prunes.
+  size_t& NumPrunes() { return numPrunes; }
+
+  //! Get the number of base cases evaluated by the traverser.
+  size_t NumBaseCases() const { return numBaseCases; }
+  //! Modify the number of base cases evaluated by the traverser.
+  size_t& NumBaseCases() { return numBaseCases; }
+
+  //! Get the number of traversals which were stopped early.
+  size_t NumStopped() const { return numStopped; }
+  //! Modify the number of traversals which were stopped early.
+  size_t& NumStopped() { return numStopped; }
+
+ private:
+  //! A node which has been scored but not yet visited.
+  struct QueueEntry
+  {
+    //! The reference node.
+    TreeType* node;
+    //! The score of the node.
+    double score;
+  };
+
+  //! Order queue entries so that the one with the lowest score is on top.
+  struct QueueEntryCompare
+  {
+    bool operator()(const QueueEntry& a, const QueueEntry& b) const
+    {
+      return a.score > b.score;
+    }
+  };
+
+  //! The type of the queue of nodes.
+  typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+      QueueEntryCompare> QueueType;
+
+  /**
+   * Score the given node, evaluate the base case with its centroid if it has
+   * one, and add it to the queue unless it can be pruned.
+   */
+  void Score(const size_t queryIndex, TreeType& node, QueueType& queue);
+
+  //! Evaluate the base cases with the points of a leaf.
+  void BaseCases(const size_t queryIndex, TreeType& leaf);
+
+  //! Check whether the budget of the current traversal has run out.
+  bool OutOfBudget();
+
+  //! Reference to the rules with which the tree will be traversed.
+  RuleType& rule;
+
+  //! The largest number of base cases for each query point (0 is no limit).
+  size_t maxBaseCases;
+  //! The time limit for each query point in seconds (0 is no limit).
+  double timeLimit;
+
+  //! The number of base cases evaluated in the current traversal.
+  size_t queryBaseCases;
+  //! The time at which the current traversal must stop (0 is never).
+  double deadline;
+  //! The number of nodes visited in the current traversal.
+  size_t queryVisits;
+
+  //! Whether the results of the last traversal are exact.
+  bool exact;
+
+  //! The number of prunes.
+  size_t numPrunes;
+  //! The number of base cases evaluated by the traverser.
+  size_t numBaseCases;
+  //! The number of traversals which were stopped early.
+  size_t numStopped;
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+// Include implementation.
+#include "priority_single_tree_traverser_impl.hpp"
+
+#endif // __MLPACK_CORE_TREE_PRIORITY_SINGLE_TREE_TRAVERSER_HPP
@@ -0,0 +1,153 @@
+/**
+ * @file priority_single_tree_traverser_impl.hpp
+ *
+ * Implementation of the PrioritySingleTreeTraverser, a best-first single-tree
+ * traverser for any type of tree.
+ */
+#ifndef __MLPACK_CORE_TREE_PRIORITY_SINGLE_TREE_TRAVERSER_IMPL_HPP
+#define __MLPACK_CORE_TREE_PRIORITY_SINGLE_TREE_TRAVERSER_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "priority_single_tree_traverser.hpp"
+
+namespace mlpack {
+namespace tree {
+
+template<typename TreeType, typename RuleType>
+PrioritySingleTreeTraverser<TreeType, RuleType>::PrioritySingleTreeTraverser(
+    RuleType& rule,
+    const size_t maxBaseCases,
+    const double timeLimit) :
+    rule(rule),
+    maxBaseCases(maxBaseCases),
+    timeLimit(timeLimit),
+    queryBaseCases(0),
+    deadline(0.0),
+    queryVisits(0),
+    exact(true),
+    numPrunes(0),
+    numBaseCases(0),
+    numStopped(0)
+{ /* Nothing to do. */ }
+
+template<typename TreeType, typename RuleType>
+void PrioritySingleTreeTraverser<TreeType, RuleType>::Traverse(
+    const size_t queryIndex,
+    TreeType& referenceRoot)
+{
+  queryBaseCases = 0;
+  queryVisits = 0;
+  deadline = (timeLimit > 0.0) ? (Timer::Now() + timeLimit) : 0.0;
+  exact = true;
+
+  QueueType queue;
+  Score(queryIndex, referenceRoot, queue);
+
+  while (!queue.empty())
+  {
+    if (OutOfBudget())
+    {
+      ++numStopped;
+
+      // The results are still exact if everything that is left can be pruned.
+      while (!queue.empty())
+      {
+        const QueueEntry entry = queue.top();
+        queue.pop();
+        if (rule.Rescore(queryIndex, *entry.node, entry.score) != DBL_MAX)
+        {
+          exact = false;
+          break;
+        }
+      }
+
+      return;
+    }
+
+    const QueueEntry entry = queue.top();
+    queue.pop();
+    TreeType& node = *entry.node;
+
+    // The bound may have tightened since this node was scored.
+    if (rule.Rescore(queryIndex, node, entry.score) == DBL_MAX)
+    {
+      ++numPrunes;
+      continue;
+    }
+
+    ++queryVisits;
+
+    if (node.IsLeaf())
+    {
+      BaseCases(queryIndex, node);
+      continue;
+    }
+
+    for (size_t i = 0; i < node.NumChildren(); ++i)
+      Score(queryIndex, node.Child(i), queue);
+  }
+}
+
+template<typename TreeType, typename RuleType>
+void PrioritySingleTreeTraverser<TreeType, RuleType>::Score(
+    const size_t queryIndex,
+    TreeType& node,
+    QueueType& queue)
+{
+  const double score = rule.Score(queryIndex, node);
+  if (score == DBL_MAX)
+  {
+    ++numPrunes;
+    return;
+  }
+
+  // If the first point of the node is its centroid, the rules have just
+  // evaluated the base case with it to score the node, so this is cached.  A
+  // self-child shares its point with its parent, which was evaluated already.
+  if (TreeTraits<TreeType>::FirstPointIsCentroid &&
+      !(TreeTraits<TreeType>::HasSelfChildren && node.Parent() != NULL &&
+      node.Point(0) == node.Parent()->Point(0)))
+  {
+    rule.BaseCase(queryIndex, node.Point(0));
+    ++queryBaseCases;
+    ++numBaseCases;
+  }
+
+  QueueEntry entry;
+  entry.node = &node;
+  entry.score = score;
+  queue.push(entry);
+}
+
+template<typename TreeType, typename RuleType>
+void PrioritySingleTreeTraverser<TreeType, RuleType>::BaseCases(
+    const size_t queryIndex,
+    TreeType& leaf)
+{
+  // The centroid was evaluated when the leaf was scored.
+  const size_t first = TreeTraits<TreeType>::FirstPointIsCentroid ? 1 : 0;
+  for (size_t i = first; i < leaf.NumPoints(); ++i)
+    rule.BaseCase(queryIndex, leaf.Point(i));
+
+  if (leaf.NumPoints() > first)
+  {
+    queryBaseCases += leaf.NumPoints() - first;
+    numBaseCases += leaf.NumPoints() - first;
+  }
+}
+
+template<typename TreeType, typename RuleType>
+bool PrioritySingleTreeTraverser<TreeType, RuleType>::OutOfBudget()
+{
+  if (maxBaseCases != 0 && queryBaseCases >= maxBaseCases)
+    return true;
+
+  // Only read the clock every few nodes.
+  return (deadline != 0.0) && ((queryVisits % 8) == 0) &&
+      (Timer::Now() >= deadline);
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif // __MLPACK_CORE_TREE_PRIORITY_SINGLE_TREE_TRAVERSER_IMPL_HPP
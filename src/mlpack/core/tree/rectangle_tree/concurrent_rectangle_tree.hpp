@@ -0,0 +1,211 @@
+/**
+ * @file concurrent_rectangle_tree.hpp
+ *
+ * Definition of ConcurrentRectangleTree, which lets searches run on a
+ * rectangle tree while points are inserted into and deleted from it.
+ */
+#ifndef __MLPACK_CORE_TREE_RECTANGLE_TREE_CONCURRENT_RECTANGLE_TREE_HPP
+#define __MLPACK_CORE_TREE_RECTANGLE_TREE_CONCURRENT_RECTANGLE_TREE_HPP
+
+#include <mlpack/core.hpp>
+
+#include "rectangle_tree.hpp"
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * A rectangle tree (and its dataset) which can be searched by any number of
+ * threads while another thread inserts and deletes points.
+ *
+ * The tree is kept as a sequence of immutable snapshots.  A reader calls
+ * Acquire() to get the current snapshot, searches its tree as long as it
+ * likes, and then calls Release().  A writer changes a private working copy
+ * of the tree and dataset with InsertPoint() and DeletePoint(), and makes all
+ * of its changes visible at once with Publish(), which makes the working copy
+ * the current snapshot.  Readers which still hold the old snapshot keep
+ * searching it; it is deleted when the last of them releases it.
+ *
+ * Readers therefore never wait for a writer: Acquire() and Release() only
+ * hold a lock for a few instructions, never while the tree is changed.  Every
+ * reader sees a consistent tree, which has either all or none of the changes
+ * of each Publish().  The price is that the first change after each Publish()
+ * copies the tree and the dataset, so writes should be batched: make many
+ * changes, then publish them together.
+ *
+ * Many readers share each snapshot, so searches must not modify its tree.
+ * Single-tree search (for instance, NeighborSearch with singleMode) only
+ * reads the reference tree, so it is safe; dual-tree search with the snapshot
+ * tree as the query tree is not, because it caches bounds in the statistics
+ * of the query nodes.
+ *
+ * @code
+ * typedef RectangleTree<RStarTreeSplit<RStarTreeDescentHeuristic,
+ *     NeighborSearchStat<NearestNeighborSort>, arma::mat>,
+ *     RStarTreeDescentHeuristic, NeighborSearchStat<NearestNeighborSort>,
+ *     arma::mat> TreeType;
+ * ConcurrentRectangleTree<TreeType> tree(dataset);
+ *
+ * // In a search thread:
+ * const ConcurrentRectangleTree<TreeType>::Snapshot* snapshot =
+ *     tree.Acquire();
+ * NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>, TreeType>
+ *     allknn(snapshot->Tree(), NULL, snapshot->Dataset(), queries, true);
+ * allknn.Search(k, neighbors, distances);
+ * tree.Release(snapshot);
+ *
+ * // In the writing thread:
+ * tree.InsertPoint(newPoint);
+ * tree.DeletePoint(oldIndex);
+ * tree.Publish();
+ * @endcode
+ *
+ * If mlpack was compiled without OpenMP, there are no locks, and the class
+ * must be used from only one thread.
+ *
+ * @tparam TreeType The type of RectangleTree.
+ */
+template<typename TreeType>
+class ConcurrentRectangleTree
+{
+ public:
+  //! The type of dataset of the tree.
+  typedef typename TreeType::Mat MatType;
+
+  /**
+   * One version of the tree, with the dataset it refers to.  Neither may be
+   * modified.
+   */
+  class Snapshot
+  {
+   public:
+    //! Get the tree of this version.  It must not be modified.
+    TreeType* Tree() const { return tree; }
+    //! Get the dataset of this version.
+    const MatType& Dataset() const { return dataset; }
+    //! Get the number of this version (0 for the tree given to the
+    //! constructor, and one more for each Publish() since).
+    size_t Version() const { return version; }
+
+   private:
+    //! The dataset of this version.
+    MatType dataset;
+    //! The tree of this version, which refers to the dataset.
+    TreeType* tree;
+    //! The number of this version.
+    size_t version;
+    //! The number of readers holding this version.
+    size_t readers;
+
+    Snapshot() : tree(NULL), version(0), readers(0) { }
+    ~Snapshot() { delete tree; }
+
+    friend class ConcurrentRectangleTree;
+  };
+
+  /**
+   * Build the tree on a copy of the given dataset.  The parameters are those of
+   * the RectangleTree constructor; the tree is bulk-loaded.
+   *
+   * @param data Dataset to build the tree on.
+   * @param maxLeafSize Maximum size of each leaf in the tree.
+   * @param minLeafSize Minimum size of each leaf in the tree.
+   * @param maxNumChildren The maximum number of children of a non-leaf node.
+   * @param minNumChildren The minimum number of children of a non-leaf node.
+   */
+  ConcurrentRectangleTree(const MatType& data,
+                          const size_t maxLeafSize = 20,
+                          const size_t minLeafSize = 8,
+                          const size_t maxNumChildren = 5,
+                          const size_t minNumChildren = 2);
+
+  /**
+   * Delete all of the snapshots.  No reader may still hold a snapshot.
+   */
+  ~ConcurrentRectangleTree();
+
+  /**
+   * Get the current snapshot of the tree.  It stays valid (and unchanged)
+   * until it is given to Release(), even if newer versions are published.
+   */
+  const Snapshot* Acquire();
+
+  /**
+   * Release a snapshot obtained from Acquire().  The snapshot must not be used
+   * afterwards.
+   */
+  void Release(const Snapshot* snapshot);
+
+  /**
+   * Add a point to the working copy of the dataset and insert it into the
+   * working copy of the tree.  It is not seen by readers until Publish() is
+   * called.
+   *
+   * @param point The point to insert.
+   * @return The index of the point in the dataset.
+   */
+  size_t InsertPoint(const arma::vec& point);
+
+  /**
+   * Delete a point from the working copy of the tree.  The point stays in the
+   * dataset, so the indices of the other points do not change.  It is not
+   * seen by readers until Publish() is called.
+   *
+   * @param point The index of the point to delete.
+   * @return false if the point is not in the tree.
+   */
+  bool DeletePoint(const size_t point);
+
+  /**
+   * Make the changes since the last Publish() visible to readers: the working
+   * copy becomes the current snapshot.  This does nothing if there are no
+   * changes.
+   */
+  void Publish();
+
+  //! Get the number of the current version.  This is for the writing thread;
+  //! readers should use the version of their snapshot.
+  size_t Version() const { return current->version; }
+
+  //! Get the number of snapshots which are kept because readers hold them
+  //! (including the current one).
+  size_t Snapshots();
+
+ private:
+  //! The current snapshot.
+  Snapshot* current;
+  //! The working copy, or NULL if nothing has changed since the last
+  //! Publish().
+  Snapshot* working;
+  //! Older snapshots which readers still hold.
+  std::vector<Snapshot*> retired;
+
+#ifdef _OPENMP
+  //! The lock for the current snapshot and the reader counts.
+  omp_lock_t readLock;
+  //! The lock which makes writers take turns.
+  omp_lock_t writeLock;
+#endif
+
+  //! Make the working copy of the current snapshot, if there isn't one.
+  void MakeWorkingCopy();
+
+  //! Take the writers' lock if write is true, or the readers' lock otherwise
+  //! (if there are locks).
+  void Lock(const bool write);
+  //! Release the writers' lock if write is true, or the readers' lock
+  //! otherwise (if there are locks).
+  void Unlock(const bool write);
+
+  // Copying would leave two owners of the snapshots.
+  ConcurrentRectangleTree(const ConcurrentRectangleTree& other);
+  ConcurrentRectangleTree& operator=(const ConcurrentRectangleTree& other);
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+// Include implementation.
+#include "concurrent_rectangle_tree_impl.hpp"
+
+#endif
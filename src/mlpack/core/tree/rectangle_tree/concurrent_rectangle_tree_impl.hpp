@@ -0,0 +1,185 @@
+/**
+ * @file concurrent_rectangle_tree_impl.hpp
+ *
+ * Implementation of ConcurrentRectangleTree.
+ */
+#ifndef __MLPACK_CORE_TREE_RECTANGLE_TREE_CONCURRENT_RECTANGLE_TREE_IMPL_HPP
+#define __MLPACK_CORE_TREE_RECTANGLE_TREE_CONCURRENT_RECTANGLE_TREE_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "concurrent_rectangle_tree.hpp"
+
+#include <algorithm>
+
+namespace mlpack {
+namespace tree {
+
+template<typename TreeType>
+ConcurrentRectangleTree<TreeType>::ConcurrentRectangleTree(
+    const MatType& data,
+    const size_t maxLeafSize,
+    const size_t minLeafSize,
+    const size_t maxNumChildren,
+    const size_t minNumChildren) :
+    current(new Snapshot()),
+    working(NULL)
+{
+#ifdef _OPENMP
+  omp_init_lock(&readLock);
+  omp_init_lock(&writeLock);
+#endif
+
+  current->dataset = data;
+  current->tree = new TreeType(current->dataset, maxLeafSize, minLeafSize,
+      maxNumChildren, minNumChildren, 0, true);
+}
+
+template<typename TreeType>
+ConcurrentRectangleTree<TreeType>::~ConcurrentRectangleTree()
+{
+  for (size_t i = 0; i < retired.size(); ++i)
+    delete retired[i];
+  delete working;
+  delete current;
+
+#ifdef _OPENMP
+  omp_destroy_lock(&readLock);
+  omp_destroy_lock(&writeLock);
+#endif
+}
+
+template<typename TreeType>
+const typename ConcurrentRectangleTree<TreeType>::Snapshot*
+ConcurrentRectangleTree<TreeType>::Acquire()
+{
+  Lock(false);
+  Snapshot* snapshot = current;
+  ++snapshot->readers;
+  Unlock(false);
+
+  return snapshot;
+}
+
+template<typename TreeType>
+void ConcurrentRectangleTree<TreeType>::Release(const Snapshot* snapshot)
+{
+  // If this was the last reader of a snapshot which is no longer current, it
+  // is taken out of the retired list, and deleted once the lock is released.
+  Snapshot* unused = NULL;
+
+  Lock(false);
+  Snapshot* released = const_cast<Snapshot*>(snapshot);
+  if (--released->readers == 0 && released != current)
+  {
+    retired.erase(std::find(retired.begin(), retired.end(), released));
+    unused = released;
+  }
+  Unlock(false);
+
+  delete unused;
+}
+
+template<typename TreeType>
+size_t ConcurrentRectangleTree<TreeType>::InsertPoint(const arma::vec& point)
+{
+  Lock(true);
+  MakeWorkingCopy();
+
+  // The tree refers to the dataset object, which stays the same when the
+  // column is added.
+  const size_t index = working->dataset.n_cols;
+  working->dataset.insert_cols(index, point);
+  working->tree->InsertPoint(index);
+  Unlock(true);
+
+  return index;
+}
+
+template<typename TreeType>
+bool ConcurrentRectangleTree<TreeType>::DeletePoint(const size_t point)
+{
+  Lock(true);
+  MakeWorkingCopy();
+  const bool deleted = working->tree->DeletePoint(point);
+  Unlock(true);
+
+  return deleted;
+}
+
+template<typename TreeType>
+void ConcurrentRectangleTree<TreeType>::Publish()
+{
+  Lock(true);
+  if (working == NULL)
+  {
+    Unlock(true);
+    return;
+  }
+
+  working->version = current->version + 1;
+
+  // Swap in the working copy.  The old snapshot is kept until its readers
+  // release it.
+  Snapshot* unused = NULL;
+  Lock(false);
+  Snapshot* old = current;
+  current = working;
+  if (old->readers == 0)
+    unused = old;
+  else
+    retired.push_back(old);
+  Unlock(false);
+
+  working = NULL;
+  Unlock(true);
+
+  delete unused;
+}
+
+template<typename TreeType>
+size_t ConcurrentRectangleTree<TreeType>::Snapshots()
+{
+  Lock(false);
+  const size_t snapshots = retired.size() + 1;
+  Unlock(false);
+
+  return snapshots;
+}
+
+template<typename TreeType>
+void ConcurrentRectangleTree<TreeType>::MakeWorkingCopy()
+{
+  if (working != NULL)
+    return;
+
+  // Only the writer changes the current snapshot, so it can be read here
+  // without the readers' lock; the readers only read it too.
+  working = new Snapshot();
+  working->dataset = current->dataset;
+  working->tree = new TreeType(*current->tree, working->dataset);
+}
+
+template<typename TreeType>
+void ConcurrentRectangleTree<TreeType>::Lock(const bool write)
+{
+#ifdef _OPENMP
+  omp_set_lock(write ? &writeLock : &readLock);
+#else
+  (void) write;
+#endif
+}
+
+template<typename TreeType>
+void ConcurrentRectangleTree<TreeType>::Unlock(const bool write)
+{
+#ifdef _OPENMP
+  omp_unset_lock(write ? &writeLock : &readLock);
+#else
+  (void) write;
+#endif
+}
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
@@ -58,6 +58,71 @@ class RStarTreeSplit
     return s1.d < s2.d;
   }
 
+  /**
+   * Storage for the computations of one split.  It is allocated once for each
+   * split, and reused for every axis and every distribution.
+   */
+  struct SplitWorkspace
+  {
+    //! The low corner of each entry (point or child bound), in a column.
+    arma::mat lo;
+    //! The high corner of each entry, in a column.
+    arma::mat hi;
+    //! Column i holds the bounding box of the first i + 1 sorted entries.
+    arma::mat prefixLo, prefixHi;
+    //! Column i holds the bounding box of the sorted entries from the ith on.
+    arma::mat suffixLo, suffixHi;
+    //! The entries, sorted along the current axis.
+    std::vector<SortStruct> sorted;
+    //! The total area of the two groups of each distribution.
+    std::vector<double> areas;
+    //! The overlap of the two groups of each distribution.
+    std::vector<double> overlapedAreas;
+
+    SplitWorkspace(const size_t dim,
+                   const size_t entries,
+                   const size_t distributions) :
+        lo(dim, entries),
+        hi(dim, entries),
+        prefixLo(dim, entries),
+        prefixHi(dim, entries),
+        suffixLo(dim, entries),
+        suffixHi(dim, entries),
+        sorted(entries),
+        areas(distributions),
+        overlapedAreas(distributions)
+    { }
+  };
+
+  /**
+   * Sort the entries of the workspace by their low (or high) corner along the
+   * given axis.
+   */
+  static void SortEntries(SplitWorkspace& workspace,
+                          const size_t axis,
+                          const bool useHi);
+
+  /**
+   * Compute the area and overlap of each distribution of the sorted entries
+   * into two groups: the first (minSize + i) entries, and the rest.  The
+   * bounding boxes of the groups are taken from the prefix and suffix bounds,
+   * which are built in one pass, so each distribution takes O(d) time.
+   *
+   * @return The sum of the margins of all the distributions.
+   */
+  static double EvaluateDistributions(SplitWorkspace& workspace,
+                                      const size_t minSize);
+
+  /**
+   * Remove the given points from a leaf which is being split, and shrink the
+   * bounds of the leaf and its ancestors, so that the points can be reinserted.
+   * The points are known to be in this leaf, so they are not searched for from
+   * the root.  The leaf may be deleted if it goes below its minimum fill.
+   */
+  static void RemovePointsForReinsertion(TreeType* tree,
+                                         const std::vector<size_t>& points,
+                                         std::vector<bool>& relevels);
+
   /**
    * Insert a node into another node.
    */
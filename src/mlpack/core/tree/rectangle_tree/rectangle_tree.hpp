@@ -12,6 +12,7 @@
 
 #include "../hrectbound.hpp"
 #include "../statistic.hpp"
+#include "sort_tile_recursive.hpp"
 
 namespace mlpack {
 namespace tree /** Trees and tree-building procedures. */ {
@@ -25,7 +26,14 @@ using bound::HRectBound;
  * will be built.
  *
  * This tree does allow growth, so you can add and delete nodes
- * from it.
+ * from it.  When a point is inserted or deleted, the statistic of every node
+ * whose contents change is reinitialized with StatisticType(node).
+ *
+ * The leaves hold only the indices of their points in the dataset, not copies
+ * of the points, so the tree takes little memory beyond the dataset itself.
+ * Once the tree is built, ReorderDataset() can be called to permute the dataset
+ * so that the points of each leaf are contiguous, which makes scanning the
+ * points of a leaf faster.
  *
  * @tparam StatisticType Extra data contained in the node.  See statistic.hpp
  *     for the necessary skeleton interface.
@@ -93,10 +101,8 @@ class RectangleTree
   double furthestDescendantDistance;
   //! The dataset.
   MatType& dataset;
-  //! The mapping to the dataset
+  //! The indices of the points held in this node (if it is a leaf).
   std::vector<size_t> points;
-  //! The local dataset
-  MatType* localDataset;
 
  public:
   //! So other classes can use TreeType::Mat.
@@ -123,13 +129,18 @@ class RectangleTree
    *      have.
    * @param firstDataIndex The index of the first data point.  UNUSED UNLESS WE
    *      ADD SUPPORT FOR HAVING A "CENTERAL" DATA MATRIX.
+   * @param bulkLoad If true, the tree is packed bottom-up with Sort-Tile-
+   *      Recursive (see SortTileRecursive) instead of inserting the points one
+   *      by one.  This is much faster for large datasets and gives nearly full
+   *      nodes; points can still be inserted and deleted afterwards.
    */
   RectangleTree(MatType& data,
                 const size_t maxLeafSize = 20,
                 const size_t minLeafSize = 8,
                 const size_t maxNumChildren = 5,
                 const size_t minNumChildren = 2,
-                const size_t firstDataIndex = 0);
+                const size_t firstDataIndex = 0,
+                const bool bulkLoad = false);
 
   /**
    * Construct this as an empty node with the specified parent.  Copying the
@@ -151,6 +162,18 @@ class RectangleTree
    */
   RectangleTree(const RectangleTree& other, const bool deepCopy = true);
 
+  /**
+   * Create a rectangle tree by deep-copying the other tree, but referring to the
+   * given dataset instead of the dataset of the other tree.  The dataset must
+   * hold the points of the other tree at the same indices (for instance, it can
+   * be a copy of the other tree's dataset).  The new tree is a root, and the
+   * statistics of its nodes are built anew.
+   *
+   * @param other The tree to be copied.
+   * @param data Dataset which the copy refers to.
+   */
+  RectangleTree(const RectangleTree& other, MatType& data);
+
   /**
    * Deletes this node, deallocating the memory for the children and calling
    * their destructors in turn.  This will invalidate any younters or references
@@ -166,26 +189,19 @@ class RectangleTree
   void SoftDelete();
 
   /**
-   * Set dataset to null. Used for memory management.  Be cafeful.
-   */
-  void NullifyData();
-
-  /**
-   * Inserts a point into the tree. The point will be copied to the data matrix
-   * of the leaf node where it is finally inserted, but we pass by reference
-   * since it may be passed many times before it actually reaches a leaf.
+   * Inserts a point into the tree.  The index of the point is stored in the
+   * leaf node where it is finally inserted.
    *
-   * @param point The point (arma::vec&) to be inserted.
+   * @param point The index of the point to be inserted.
    */
   void InsertPoint(const size_t point);
 
   /**
    * Inserts a point into the tree, tracking which levels have been inserted
-   * into.  The point will be copied to the data matrix of the leaf node where
-   * it is finally inserted, but we pass by reference since it may be passed
-   * many times before it actually reaches a leaf.
+   * into.  The index of the point is stored in the leaf node where it is
+   * finally inserted.
    *
-   * @param point The point (arma::vec&) to be inserted.
+   * @param point The index of the point to be inserted.
    * @param relevels The levels that have been reinserted to on this top level
    *      insertion.
    */
@@ -207,9 +223,8 @@ class RectangleTree
                   std::vector<bool>& relevels);
 
   /**
-   * Deletes a point in the tree.  The point will be removed from the data
-   * matrix of the leaf node where it is store and the bounding rectangles will
-   * be updated.  However, the point will be kept in the centeral dataset. (The
+   * Deletes a point in the tree.  The point will be removed from the leaf node
+   * where it is stored and the bounding rectangles will be updated.  However, the point will be kept in the centeral dataset. (The
    * user may remove it from there if he wants, but he must not change the
    * indices of the other points.) Returns true if the point is successfully
    * removed and false if it is not.  (ie. the point is not in the tree)
@@ -218,8 +233,8 @@ class RectangleTree
 
   /**
    * Deletes a point in the tree, tracking levels.  The point will be removed
-   * from the data matrix of the leaf node where it is store and the bounding
-   * rectangles will be updated.  However, the point will be kept in the
+   * from the leaf node where it is stored and the bounding rectangles will be
+   * updated.  However, the point will be kept in the
    * centeral dataset. (The user may remove it from there if he wants, but he
    * must not change the indices of the other points.) Returns true if the point
    * is successfully removed and false if it is not.  (ie. the point is not in
@@ -312,11 +327,6 @@ class RectangleTree
   //! Modify the points vector for this node.  Be careful!
   std::vector<size_t>& Points() { return points; }
 
-  //! Get the local dataset of this node.
-  const arma::mat& LocalDataset() const { return *localDataset; }
-  //! Modify the local dataset of this node.
-  arma::mat& LocalDataset() { return *localDataset; }
-
   //! Get the metric which the tree uses.
   typename HRectBound<>::MetricType Metric() const { return bound.Metric(); }
 
@@ -481,6 +491,21 @@ class RectangleTree
   //! Returns false: this tree type does not have self children.
   static bool HasSelfChildren() { return false; }
 
+  /**
+   * Permute the columns of the dataset so that the points of each leaf are
+   * contiguous, with the leaves in depth-first order, and update the indices
+   * held by the leaves to match.  Points which are in the dataset but not in
+   * the tree (because they were deleted, or were before the first data index)
+   * are moved to the end, in their original order.  The dataset is permuted in
+   * place, so no copy of it is made.  This applies to the whole tree, no matter
+   * which node it is called on.  Points can still be inserted and deleted
+   * afterwards, but the leaves they change will no longer be contiguous.
+   *
+   * @param oldFromNew Vector to store the permutation in: after the call, the
+   *     point at index i of the dataset was at index oldFromNew[i] before.
+   */
+  void ReorderDataset(std::vector<size_t>& oldFromNew);
+
  private:
   /**
    * Private copy constructor, available only to fill (pad) the tree to a
@@ -509,6 +534,15 @@ class RectangleTree
    */
   void SplitNode(std::vector<bool>& relevels);
 
+  /**
+   * Build the tree below this (empty) root node by packing the points with
+   * Sort-Tile-Recursive: the points are packed into leaves, then the leaves
+   * into parents, and so on, until the remaining nodes fit in the root.
+   *
+   * @param firstDataIndex The index of the first point to add to the tree.
+   */
+  void BulkLoad(const size_t firstDataIndex);
+
  public:
   /**
    * Condense the bounding rectangles for this node based on the removal of the
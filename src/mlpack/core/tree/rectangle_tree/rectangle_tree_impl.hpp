@@ -27,7 +27,8 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
     const size_t minLeafSize,
     const size_t maxNumChildren,
     const size_t minNumChildren,
-    const size_t firstDataIndex) :
+    const size_t firstDataIndex,
+    const bool bulkLoad) :
     maxNumChildren(maxNumChildren),
     minNumChildren(minNumChildren),
     numChildren(0),
@@ -41,11 +42,16 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
     splitHistory(bound.Dim()),
     parentDistance(0),
     dataset(data),
-    points(maxLeafSize + 1), // Add one to make splitting the node simpler.
-    localDataset(new MatType(data.n_rows, static_cast<int> (maxLeafSize) + 1))
+    points(maxLeafSize + 1) // Add one to make splitting the node simpler.
 {
   stat = StatisticType(*this);
 
+  if (bulkLoad)
+  {
+    BulkLoad(firstDataIndex);
+    return;
+  }
+
   // For now, just insert the points in order.
   RectangleTree* root = this;
 
@@ -72,9 +78,7 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
     splitHistory(bound.Dim()),
     parentDistance(0),
     dataset(parentNode->Dataset()),
-    points(maxLeafSize + 1), // Add one to make splitting the node simpler.
-    localDataset(new MatType(static_cast<int> (parentNode->Bound().Dim()),
-                             static_cast<int> (maxLeafSize) + 1))
+    points(maxLeafSize + 1) // Add one to make splitting the node simpler.
 {
   stat = StatisticType(*this);
 }
@@ -103,31 +107,59 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
     splitHistory(other.SplitHistory()),
     parentDistance(other.ParentDistance()),
     dataset(other.dataset),
-    points(other.Points()),
-    localDataset(NULL)
+    points(other.Points())
 {
   if (deepCopy)
   {
-    if (numChildren > 0)
-    {
-      for (size_t i = 0; i < numChildren; i++)
-      {
-        children[i] = new RectangleTree(*(other.Children()[i]));
-      }
-    }
-    else
+    for (size_t i = 0; i < numChildren; i++)
     {
-      localDataset = new MatType(other.LocalDataset());
+      children[i] = new RectangleTree(*(other.Children()[i]));
+      children[i]->Parent() = this;
     }
   }
   else
   {
     children = other.Children();
-    arma::mat& otherData = const_cast<arma::mat&>(other.LocalDataset());
-    localDataset = &otherData;
   }
 }
 
+/**
+ * Create a rectangle tree by deep-copying the other tree, referring to the given
+ * dataset.
+ */
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType>
+RectangleTree<SplitType, DescentType, StatisticType, MatType>::RectangleTree(
+    const RectangleTree& other,
+    MatType& data) :
+    maxNumChildren(other.MaxNumChildren()),
+    minNumChildren(other.MinNumChildren()),
+    numChildren(other.NumChildren()),
+    children(maxNumChildren + 1),
+    parent(NULL),
+    begin(other.Begin()),
+    count(other.Count()),
+    maxLeafSize(other.MaxLeafSize()),
+    minLeafSize(other.MinLeafSize()),
+    bound(other.bound),
+    splitHistory(other.SplitHistory()),
+    parentDistance(other.ParentDistance()),
+    furthestDescendantDistance(other.furthestDescendantDistance),
+    dataset(data),
+    points(other.Points())
+{
+  for (size_t i = 0; i < numChildren; i++)
+  {
+    children[i] = new RectangleTree(*(other.Children()[i]), data);
+    children[i]->Parent() = this;
+  }
+
+  // The children are complete, so the statistic can be built.
+  stat = StatisticType(*this);
+}
+
 /**
  * Deletes this node, deallocating the memory for the children and calling
  * their destructors in turn.  This will invalidate any pointers or references
@@ -141,8 +173,6 @@ RectangleTree<SplitType, DescentType, StatisticType, MatType>::~RectangleTree()
 {
   for (size_t i = 0; i < numChildren; i++)
     delete children[i];
-
-  delete localDataset;
 }
 
 /**
@@ -164,19 +194,6 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::SoftDelete()
   delete this;
 }
 
-/**
- * Set the local dataset to null.
- */
-template<typename SplitType,
-         typename DescentType,
-         typename StatisticType,
-         typename MatType>
-void RectangleTree<SplitType, DescentType, StatisticType, MatType>::
-    NullifyData()
-{
-  localDataset = NULL;
-}
-
 /**
  * Recurse through the tree and insert the point at the leaf node chosen
  * by the heuristic.
@@ -188,8 +205,10 @@ template<typename SplitType,
 void RectangleTree<SplitType, DescentType, StatisticType, MatType>::InsertPoint(
     const size_t point)
 {
-  // Expand the bound regardless of whether it is a leaf node.
+  // Expand the bound regardless of whether it is a leaf node.  The contents of
+  // this node are changing, so its statistic is reinitialized.
   bound |= dataset.col(point);
+  stat = StatisticType(*this);
 
   std::vector<bool> lvls(TreeDepth());
   for (size_t i = 0; i < lvls.size(); i++)
@@ -198,7 +217,6 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::InsertPoint(
   // If this is a leaf node, we stop here and add the point.
   if (numChildren == 0)
   {
-    localDataset->col(count) = dataset.col(point);
     points[count++] = point;
     SplitNode(lvls);
     return;
@@ -213,9 +231,8 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::InsertPoint(
 
 /**
  * Inserts a point into the tree, tracking which levels have been inserted into.
- * The point will be copied to the data matrix of the leaf node where it is
- * finally inserted, but we pass by reference since it may be passed many times
- * before it actually reaches a leaf.
+ * The index of the point is stored in the leaf node where it is finally
+ * inserted.
  */
 template<typename SplitType,
          typename DescentType,
@@ -225,13 +242,14 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::InsertPoint(
     const size_t point,
     std::vector<bool>& relevels)
 {
-  // Expand the bound regardless of whether it is a leaf node.
+  // Expand the bound regardless of whether it is a leaf node.  The contents of
+  // this node are changing, so its statistic is reinitialized.
   bound |= dataset.col(point);
+  stat = StatisticType(*this);
 
   // If this is a leaf node, we stop here and add the point.
   if (numChildren == 0)
   {
-    localDataset->col(count) = dataset.col(point);
     points[count++] = point;
     SplitNode(relevels);
     return;
@@ -303,8 +321,7 @@ bool RectangleTree<SplitType, DescentType, StatisticType, MatType>::DeletePoint(
     {
       if (points[i] == point)
       {
-        localDataset->col(i) = localDataset->col(--count); // Decrement count.
-        points[i] = points[count];
+        points[i] = points[--count]; // Decrement count.
         // This function wil ensure that minFill is satisfied.
         CondenseTree(dataset.col(point), lvls, true);
         return true;
@@ -338,8 +355,7 @@ bool RectangleTree<SplitType, DescentType, StatisticType, MatType>::DeletePoint(
     {
       if (points[i] == point)
       {
-        localDataset->col(i) = localDataset->col(--count);
-        points[i] = points[count];
+        points[i] = points[--count]; // Decrement count.
         // This function will ensure that minFill is satisfied.
         CondenseTree(dataset.col(point), relevels, true);
         return true;
@@ -519,7 +535,22 @@ template<typename SplitType,
 inline size_t RectangleTree<SplitType, DescentType, StatisticType, MatType>::
     Descendant(const size_t index) const
 {
-  return (points[index]);
+  if (numChildren == 0)
+    return (points[index]);
+
+  // The points are only held in the leaves, so find the child that holds the
+  // descendant with the given index.
+  size_t childIndex = index;
+  for (size_t i = 0; i < numChildren; i++)
+  {
+    const size_t numDescendants = children[i]->NumDescendants();
+    if (childIndex < numDescendants)
+      return children[i]->Descendant(childIndex);
+    childIndex -= numDescendants;
+  }
+
+  // This can only happen if the index is out of range.
+  return (size_t() - 1);
 }
 
 /**
@@ -568,6 +599,102 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::SplitNode(
   }
 }
 
+/**
+ * Pack the points into a tree with Sort-Tile-Recursive.  Every level is built
+ * from all the nodes of the level below, so all the leaves are at the same
+ * depth, as in a tree built by insertion.
+ */
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType>
+void RectangleTree<SplitType, DescentType, StatisticType, MatType>::BulkLoad(
+    const size_t firstDataIndex)
+{
+  const size_t numPoints = dataset.n_cols - firstDataIndex;
+
+  // If all the points fit in one leaf, then this node is that leaf.
+  if (numPoints <= maxLeafSize)
+  {
+    for (size_t i = firstDataIndex; i < dataset.n_cols; i++)
+    {
+      bound |= dataset.col(i);
+      points[count++] = i;
+    }
+
+    stat = StatisticType(*this);
+    return;
+  }
+
+  // Pack the points into leaves.
+  std::vector<size_t> order(numPoints);
+  for (size_t i = 0; i < numPoints; i++)
+    order[i] = firstDataIndex + i;
+
+  std::vector<size_t> groupStarts;
+  SortTileRecursive::Partition(dataset, maxLeafSize, order, groupStarts);
+
+  std::vector<RectangleTree*> nodes(groupStarts.size() - 1);
+  for (size_t g = 0; g < nodes.size(); g++)
+  {
+    RectangleTree* leaf = new RectangleTree(this);
+    for (size_t i = groupStarts[g]; i < groupStarts[g + 1]; i++)
+    {
+      leaf->Bound() |= dataset.col(order[i]);
+      leaf->Points()[leaf->Count()++] = order[i];
+    }
+
+    leaf->Stat() = StatisticType(*leaf);
+    nodes[g] = leaf;
+  }
+
+  // Now pack each level into parent nodes, using the centroids of the nodes,
+  // until the nodes that are left fit into this node.
+  while (nodes.size() > maxNumChildren)
+  {
+    arma::mat centroids(dataset.n_rows, nodes.size());
+    arma::vec centroid;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+      nodes[i]->Centroid(centroid);
+      centroids.col(i) = centroid;
+    }
+
+    order.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+      order[i] = i;
+
+    SortTileRecursive::Partition(centroids, maxNumChildren, order, groupStarts);
+
+    std::vector<RectangleTree*> parents(groupStarts.size() - 1);
+    for (size_t g = 0; g < parents.size(); g++)
+    {
+      RectangleTree* node = new RectangleTree(this);
+      for (size_t i = groupStarts[g]; i < groupStarts[g + 1]; i++)
+      {
+        RectangleTree* child = nodes[order[i]];
+        node->Children()[node->NumChildren()++] = child;
+        child->Parent() = node;
+        node->Bound() |= child->Bound();
+      }
+
+      node->Stat() = StatisticType(*node);
+      parents[g] = node;
+    }
+
+    nodes.swap(parents);
+  }
+
+  for (size_t i = 0; i < nodes.size(); i++)
+  {
+    children[numChildren++] = nodes[i];
+    nodes[i]->Parent() = this;
+    bound |= nodes[i]->Bound();
+  }
+
+  stat = StatisticType(*this);
+}
+
 /**
  * Condense the tree.  This shrinks the bounds and moves up the tree if
  * applicable.  If a node goes below minimum fill, this code will deal with it.
@@ -672,25 +799,29 @@ void RectangleTree<SplitType, DescentType, StatisticType, MatType>::
 
       numChildren = child->NumChildren();
 
+      // In case the tree has a height of two.
       for (size_t i = 0; i < child->Count(); i++)
-      {
-        // In case the tree has a height of two.
         points[i] = child->Points()[i];
-        localDataset->col(i) = child->LocalDataset().col(i);
-      }
 
       count = child->Count();
       maxNumChildren = child->MaxNumChildren(); // Required for the X tree.
       child->SoftDelete();
+      stat = StatisticType(*this);
       return;
     }
   }
 
-  // If we didn't delete it, shrink the bound if we need to.
+  // If we didn't delete it, shrink the bound if we need to.  Either way, the
+  // contents of this node and all of its ancestors have changed, so their
+  // statistics are reinitialized.
+  stat = StatisticType(*this);
   if (usePoint && ShrinkBoundForPoint(point) && parent != NULL)
     parent->CondenseTree(point, relevels, usePoint);
   else if (!usePoint && ShrinkBoundForBound(bound) && parent != NULL)
     parent->CondenseTree(point, relevels, usePoint);
+  else
+    for (RectangleTree* node = parent; node != NULL; node = node->Parent())
+      node->Stat() = StatisticType(*node);
 }
 
 /**
@@ -713,8 +844,8 @@ bool RectangleTree<SplitType, DescentType, StatisticType, MatType>::
         double min = DBL_MAX;
         for (size_t j = 0; j < count; j++)
         {
-          if (localDataset->col(j)[i] < min)
-            min = localDataset->col(j)[i];
+          if (dataset(i, points[j]) < min)
+            min = dataset(i, points[j]);
         }
 
         if (bound[i].Lo() < min)
@@ -732,8 +863,8 @@ bool RectangleTree<SplitType, DescentType, StatisticType, MatType>::
         double max = -1 * DBL_MAX;
         for (size_t j = 0; j < count; j++)
         {
-          if (localDataset->col(j)[i] > max)
-            max = localDataset->col(j)[i];
+          if (dataset(i, points[j]) > max)
+            max = dataset(i, points[j]);
         }
 
         if (bound[i].Hi() > max)
@@ -821,6 +952,76 @@ bool RectangleTree<SplitType, DescentType, StatisticType, MatType>::
   return sum != sum2;
 }
 
+/**
+ * Permute the dataset so that the points of each leaf are contiguous.
+ */
+template<typename SplitType,
+         typename DescentType,
+         typename StatisticType,
+         typename MatType>
+void RectangleTree<SplitType, DescentType, StatisticType, MatType>::
+    ReorderDataset(std::vector<size_t>& oldFromNew)
+{
+  RectangleTree* root = this;
+  while (root->Parent() != NULL)
+    root = root->Parent();
+
+  // Give the points of each leaf consecutive new indices, visiting the leaves
+  // in depth-first order.
+  oldFromNew.clear();
+  oldFromNew.reserve(dataset.n_cols);
+  std::vector<bool> inTree(dataset.n_cols, false);
+  std::vector<RectangleTree*> stack(1, root);
+  while (!stack.empty())
+  {
+    RectangleTree* node = stack.back();
+    stack.pop_back();
+
+    if (node->IsLeaf())
+    {
+      for (size_t i = 0; i < node->Count(); i++)
+      {
+        inTree[node->Points()[i]] = true;
+        oldFromNew.push_back(node->Points()[i]);
+        node->Points()[i] = oldFromNew.size() - 1;
+      }
+    }
+    else
+    {
+      // Push the children in reverse so that the first child is visited first.
+      for (size_t i = node->NumChildren(); i > 0; i--)
+        stack.push_back(node->Children()[i - 1]);
+    }
+  }
+
+  // The points which are not in the tree go at the end.
+  for (size_t i = 0; i < dataset.n_cols; i++)
+    if (!inTree[i])
+      oldFromNew.push_back(i);
+
+  // Now permute the columns in place by following each cycle of the
+  // permutation, so that only one column needs to be copied aside.
+  std::vector<bool> moved(dataset.n_cols, false);
+  arma::Col<typename MatType::elem_type> first;
+  for (size_t i = 0; i < dataset.n_cols; i++)
+  {
+    if (moved[i] || oldFromNew[i] == i)
+      continue;
+
+    first = dataset.col(i);
+    size_t j = i;
+    while (oldFromNew[j] != i)
+    {
+      dataset.col(j) = dataset.col(oldFromNew[j]);
+      moved[j] = true;
+      j = oldFromNew[j];
+    }
+
+    dataset.col(j) = first;
+    moved[j] = true;
+  }
+}
+
 /**
  * Returns a string representation of this object.
  */
@@ -0,0 +1,87 @@
+/**
+ * @file sort_tile_recursive.cpp
+ *
+ * Implementation of the Sort-Tile-Recursive (STR) packing used to bulk-load
+ * rectangle type trees.
+ */
+#include "sort_tile_recursive.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace mlpack;
+using namespace mlpack::tree;
+
+namespace {
+
+//! Compare two items by their center in one dimension.
+class DimensionLess
+{
+ public:
+  DimensionLess(const arma::mat& centers, const size_t dimension) :
+      centers(centers), dimension(dimension) { }
+
+  bool operator()(const size_t a, const size_t b) const
+  {
+    return centers(dimension, a) < centers(dimension, b);
+  }
+
+ private:
+  const arma::mat& centers;
+  size_t dimension;
+};
+
+} // anonymous namespace
+
+void SortTileRecursive::Partition(const arma::mat& centers,
+                                  const size_t capacity,
+                                  std::vector<size_t>& order,
+                                  std::vector<size_t>& groupStarts)
+{
+  groupStarts.clear();
+  PartitionRange(centers, capacity, 0, 0, order.size(), order, groupStarts);
+  groupStarts.push_back(order.size());
+}
+
+void SortTileRecursive::PartitionRange(const arma::mat& centers,
+                                       const size_t capacity,
+                                       const size_t dimension,
+                                       const size_t begin,
+                                       const size_t end,
+                                       std::vector<size_t>& order,
+                                       std::vector<size_t>& groupStarts)
+{
+  const size_t count = end - begin;
+  const size_t numGroups = (count + capacity - 1) / capacity;
+  if (numGroups <= 1)
+  {
+    groupStarts.push_back(begin);
+    return;
+  }
+
+  std::sort(order.begin() + begin, order.begin() + end,
+      DimensionLess(centers, dimension));
+
+  // Along the last dimension, cut directly into groups.  Otherwise, cut into
+  // (numGroups)^(1 / remaining dimensions) slabs, so that the same number of
+  // cuts is made along each of the remaining dimensions.
+  const size_t remainingDims = centers.n_rows - dimension;
+  size_t numSlabs = numGroups;
+  if (remainingDims > 1)
+    numSlabs = (size_t) std::ceil(std::pow((double) numGroups,
+        1.0 / remainingDims));
+
+  // The slabs (and groups) are made as even as possible, so that no group ends
+  // up with only a few items.
+  for (size_t s = 0; s < numSlabs; ++s)
+  {
+    const size_t slabBegin = begin + (s * count) / numSlabs;
+    const size_t slabEnd = begin + ((s + 1) * count) / numSlabs;
+
+    if (remainingDims > 1)
+      PartitionRange(centers, capacity, dimension + 1, slabBegin, slabEnd,
+          order, groupStarts);
+    else
+      groupStarts.push_back(slabBegin);
+  }
+}
@@ -0,0 +1,61 @@
+/**
+ * @file sort_tile_recursive.hpp
+ *
+ * Definition of the Sort-Tile-Recursive (STR) packing used to bulk-load
+ * rectangle type trees.
+ */
+#ifndef __MLPACK_CORE_TREE_RECTANGLE_TREE_SORT_TILE_RECURSIVE_HPP
+#define __MLPACK_CORE_TREE_RECTANGLE_TREE_SORT_TILE_RECURSIVE_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * Sort-Tile-Recursive packing, from Leutenegger, Lopez and Edgington, "STR: A
+ * Simple and Efficient Algorithm for R-Tree Packing" (1997).  The items are
+ * sorted along the first dimension and cut into slabs, each slab is sorted
+ * along the next dimension and cut again, and so on; along the last dimension
+ * the slabs are cut into groups of at most the given capacity.  This takes
+ * O(n log n) time and gives groups that are spatially compact and, as long as
+ * there is more than one group, at least about half full.
+ */
+class SortTileRecursive
+{
+ public:
+  /**
+   * Partition the given items into groups of at most the given capacity.  Each
+   * item is a column index into the centers matrix.  On return, the items in
+   * order are sorted so that each group is contiguous; group i holds
+   * order[groupStarts[i]] through order[groupStarts[i + 1] - 1] (the last
+   * element of groupStarts is order.size()).
+   *
+   * @param centers Matrix holding the center of each item in its columns.
+   * @param capacity Maximum number of items in a group.
+   * @param order Column indices of the items to partition; these are reordered.
+   * @param groupStarts Vector to store the start of each group in.
+   */
+  static void Partition(const arma::mat& centers,
+                        const size_t capacity,
+                        std::vector<size_t>& order,
+                        std::vector<size_t>& groupStarts);
+
+ private:
+  /**
+   * Partition order[begin] through order[end - 1], starting with the given
+   * dimension, and append the starts of the groups to groupStarts.
+   */
+  static void PartitionRange(const arma::mat& centers,
+                             const size_t capacity,
+                             const size_t dimension,
+                             const size_t begin,
+                             const size_t end,
+                             std::vector<size_t>& order,
+                             std::vector<size_t>& groupStarts);
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
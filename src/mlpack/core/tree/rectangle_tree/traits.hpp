@@ -44,6 +44,11 @@ class TreeTraits<RectangleTree<StatisticType, MatType> >
    * AND REARRANGE THE MATRIX
    */
   static const bool RearrangesDataset = true;
+
+  /**
+   * A rectangle tree can be copied so that it refers to another dataset.
+   */
+  static const bool CanCopyToDataset = true;
 };
 
 }; // namespace tree
@@ -35,7 +35,6 @@ void XTreeSplit<DescentType, StatisticType, MatType>::SplitLeafNode(
 
     copy->Parent() = tree;
     tree->Count() = 0;
-    tree->NullifyData();
     tree->Children()[(tree->NumChildren())++] = copy; // Because this was a leaf node, numChildren must be 0.
     assert(tree->NumChildren() == 1);
     XTreeSplit<DescentType, StatisticType, MatType>::SplitLeafNode(copy, relevels);
@@ -60,16 +59,18 @@ void XTreeSplit<DescentType, StatisticType, MatType>::SplitLeafNode(
    arma::vec centroid;
    tree->Bound().Centroid(centroid); // Modifies centroid.
    for(size_t i = 0; i < sorted.size(); i++) {
-     sorted[i].d = tree->Bound().Metric().Evaluate(centroid, tree->LocalDataset().col(i));
+     sorted[i].d = tree->Bound().Metric().Evaluate(centroid, tree->Dataset().col(tree->Points()[i]));
      sorted[i].n = i;
    }
 
    std::sort(sorted.begin(), sorted.end(), structComp);
-   std::vector<int> pointIndices(p);
-   for(size_t i = 0; i < p; i++) {
+   std::vector<size_t> pointIndices(p);
+   for(size_t i = 0; i < p; i++)
      pointIndices[i] = tree->Points()[sorted[sorted.size()-1-i].n]; // We start from the end of sorted.
-     root->DeletePoint(tree->Points()[sorted[sorted.size()-1-i].n], relevels);
-   }
+
+   // This may delete the leaf, so it is not used after this.
+   RemovePointsForReinsertion(tree, pointIndices, relevels);
+
    for(size_t i = 0; i < p; i++) { // We reverse the order again to reinsert the closest points first.
      root->InsertPoint(pointIndices[p-1-i], relevels);
    }
@@ -95,66 +96,23 @@ void XTreeSplit<DescentType, StatisticType, MatType>::SplitLeafNode(
   bool tiedOnOverlap = false;
   int bestAxis = 0;
   double bestAxisScore = DBL_MAX;
+
+  // The points are the entries to split; each is its own bound.
+  SplitWorkspace workspace(tree->Bound().Dim(), tree->Count(), tree->MaxLeafSize() - 2 * tree->MinLeafSize() + 2);
+  for (size_t i = 0; i < tree->Count(); i++)
+    workspace.lo.col(i) = tree->Dataset().col(tree->Points()[i]);
+  workspace.hi = workspace.lo;
+
+  const std::vector<double>& areas = workspace.areas;
+  const std::vector<double>& overlapedAreas = workspace.overlapedAreas;
+
   for (size_t j = 0; j < tree->Bound().Dim(); j++) {
-    double axisScore = 0.0;
     // Since we only have points in the leaf nodes, we only need to sort once.
-    std::vector<sortStruct> sorted(tree->Count());
-    for (size_t i = 0; i < sorted.size(); i++) {
-      sorted[i].d = tree->LocalDataset().col(i)[j];
-      sorted[i].n = i;
-    }
+    SortEntries(workspace, j, false);
 
-    std::sort(sorted.begin(), sorted.end(), structComp);
-
-    // We'll store each of the three scores for each distribution.
-    std::vector<double> areas(tree->MaxLeafSize() - 2 * tree->MinLeafSize() + 2);
-    std::vector<double> margins(tree->MaxLeafSize() - 2 * tree->MinLeafSize() + 2);
-    std::vector<double> overlapedAreas(tree->MaxLeafSize() - 2 * tree->MinLeafSize() + 2);
-    for (size_t i = 0; i < areas.size(); i++) {
-      areas[i] = 0.0;
-      margins[i] = 0.0;
-      overlapedAreas[i] = 0.0;
-    }
-    for (size_t i = 0; i < areas.size(); i++) {
-      // The ith arrangement is obtained by placing the first tree->MinLeafSize() + i
-      // points in one rectangle and the rest in another.  Then we calculate the three
-      // scores for that distribution.
-
-      size_t cutOff = tree->MinLeafSize() + i;
-      // We'll calculate the max and min in each dimension by hand to save time.
-      std::vector<double> maxG1(tree->Bound().Dim());
-      std::vector<double> minG1(maxG1.size());
-      std::vector<double> maxG2(maxG1.size());
-      std::vector<double> minG2(maxG1.size());
-      for (size_t k = 0; k < tree->Bound().Dim(); k++) {
-        minG1[k] = maxG1[k] = tree->LocalDataset().col(sorted[0].n)[k];
-        minG2[k] = maxG2[k] = tree->LocalDataset().col(sorted[sorted.size() - 1].n)[k];
-        for (size_t l = 1; l < tree->Count() - 1; l++) {
-          if (l < cutOff) {
-            if (tree->LocalDataset().col(sorted[l].n)[k] < minG1[k])
-              minG1[k] = tree->LocalDataset().col(sorted[l].n)[k];
-            else if (tree->LocalDataset().col(sorted[l].n)[k] > maxG1[k])
-              maxG1[k] = tree->LocalDataset().col(sorted[l].n)[k];
-          } else {
-            if (tree->LocalDataset().col(sorted[l].n)[k] < minG2[k])
-              minG2[k] = tree->LocalDataset().col(sorted[l].n)[k];
-            else if (tree->LocalDataset().col(sorted[l].n)[k] > maxG2[k])
-              maxG2[k] = tree->LocalDataset().col(sorted[l].n)[k];
-          }
-        }
-      }
-      double area1 = 1.0, area2 = 1.0;
-      double oArea = 1.0;
-      for (size_t k = 0; k < maxG1.size(); k++) {
-        margins[i] += maxG1[k] - minG1[k] + maxG2[k] - minG2[k];
-        area1 *= maxG1[k] - minG1[k];
-        area2 *= maxG2[k] - minG2[k];
-        oArea *= maxG1[k] < minG2[k] || maxG2[k] < minG1[k] ? 0.0 : std::min(maxG1[k], maxG2[k]) - std::max(minG1[k], minG2[k]);
-      }
-      areas[i] += area1 + area2;
-      overlapedAreas[i] += oArea;
-      axisScore += margins[i];
-    }
+    // The ith arrangement is obtained by placing the first tree->MinLeafSize() + i
+    // points in one rectangle and the rest in another.
+    const double axisScore = EvaluateDistributions(workspace, tree->MinLeafSize());
 
     if (axisScore < bestAxisScore) {
       bestAxisScore = axisScore;
@@ -175,13 +133,8 @@ void XTreeSplit<DescentType, StatisticType, MatType>::SplitLeafNode(
     }
   }
 
-  std::vector<sortStruct> sorted(tree->Count());
-  for (size_t i = 0; i < sorted.size(); i++) {
-    sorted[i].d = tree->LocalDataset().col(i)[bestAxis];
-    sorted[i].n = i;
-  }
-
-  std::sort(sorted.begin(), sorted.end(), structComp);
+  SortEntries(workspace, bestAxis, false);
+  const std::vector<sortStruct>& sorted = workspace.sorted;
 
   RectangleTree<XTreeSplit<DescentType, StatisticType, MatType>, DescentType, StatisticType, MatType> *treeOne = new
           RectangleTree<XTreeSplit<DescentType, StatisticType, MatType>, DescentType, StatisticType, MatType>(tree->Parent());
@@ -265,7 +218,6 @@ bool XTreeSplit<DescentType, StatisticType, MatType>::SplitNonLeafNode(
 
     copy->Parent() = tree;
     tree->NumChildren() = 0;
-    tree->NullifyData();
     tree->Children()[(tree->NumChildren())++] = copy;
     XTreeSplit<DescentType, StatisticType, MatType>::SplitNonLeafNode(copy, relevels);
     return true;
@@ -327,223 +279,69 @@ bool XTreeSplit<DescentType, StatisticType, MatType>::SplitNonLeafNode(
   double overlapBestAreaAxis = 0;
   double areaBestAreaAxis = 0;
 
-  for (size_t j = 0; j < tree->Bound().Dim(); j++) {
-    double axisScore = 0.0;
-
-    // We'll do Bound().Lo() now and use Bound().Hi() later.
-    std::vector<sortStruct> sorted(tree->NumChildren());
-    for (size_t i = 0; i < sorted.size(); i++) {
-      sorted[i].d = tree->Children()[i]->Bound()[j].Lo();
-      sorted[i].n = i;
-    }
-
-    std::sort(sorted.begin(), sorted.end(), structComp);
-
-    // We'll store each of the three scores for each distribution.
-    std::vector<double> areas(tree->MaxNumChildren() - 2 * tree->MinNumChildren() + 2);
-    std::vector<double> margins(tree->MaxNumChildren() - 2 * tree->MinNumChildren() + 2);
-    std::vector<double> overlapedAreas(tree->MaxNumChildren() - 2 * tree->MinNumChildren() + 2);
-    for (size_t i = 0; i < areas.size(); i++) {
-      areas[i] = 0.0;
-      margins[i] = 0.0;
-      overlapedAreas[i] = 0.0;
-    }
-
-    for (size_t i = 0; i < areas.size(); i++) {
-      // The ith arrangement is obtained by placing the first tree->MinNumChildren() + i
-      // points in one rectangle and the rest in another.  Then we calculate the three
-      // scores for that distribution.
-
-      size_t cutOff = tree->MinNumChildren() + i;
-      // We'll calculate the max and min in each dimension by hand to save time.
-      std::vector<double> maxG1(tree->Bound().Dim());
-      std::vector<double> minG1(maxG1.size());
-      std::vector<double> maxG2(maxG1.size());
-      std::vector<double> minG2(maxG1.size());
-      for (size_t k = 0; k < tree->Bound().Dim(); k++) {
-        minG1[k] = tree->Children()[sorted[0].n]->Bound()[k].Lo();
-        maxG1[k] = tree->Children()[sorted[0].n]->Bound()[k].Hi();
-        minG2[k] = tree->Children()[sorted[sorted.size() - 1].n]->Bound()[k].Lo();
-        maxG2[k] = tree->Children()[sorted[sorted.size() - 1].n]->Bound()[k].Hi();
-        for (size_t l = 1; l < tree->NumChildren() - 1; l++) {
-          if (l < cutOff) {
-            if (tree->Children()[sorted[l].n]->Bound()[k].Lo() < minG1[k])
-              minG1[k] = tree->Children()[sorted[l].n]->Bound()[k].Lo();
-            else if (tree->Children()[sorted[l].n]->Bound()[k].Hi() > maxG1[k])
-              maxG1[k] = tree->Children()[sorted[l].n]->Bound()[k].Hi();
-          } else {
-            if (tree->Children()[sorted[l].n]->Bound()[k].Lo() < minG2[k])
-              minG2[k] = tree->Children()[sorted[l].n]->Bound()[k].Lo();
-            else if (tree->Children()[sorted[l].n]->Bound()[k].Hi() > maxG2[k])
-              maxG2[k] = tree->Children()[sorted[l].n]->Bound()[k].Hi();
-          }
-        }
-      }
-      double area1 = 1.0, area2 = 1.0;
-      double oArea = 1.0;
-      for (size_t k = 0; k < maxG1.size(); k++) {
-        margins[i] += maxG1[k] - minG1[k] + maxG2[k] - minG2[k];
-        area1 *= maxG1[k] - minG1[k];
-        area2 *= maxG2[k] - minG2[k];
-        oArea *= maxG1[k] < minG2[k] || maxG2[k] < minG1[k] ? 0.0 : std::min(maxG1[k], maxG2[k]) - std::max(minG1[k], minG2[k]);
-      }
-      areas[i] += area1 + area2;
-      overlapedAreas[i] += oArea;
-      axisScore += margins[i];
-    }
-    if (axisScore < bestAxisScore) {
-      bestAxisScore = axisScore;
-      bestAxis = j;
-      double bestOverlapIndexOnBestAxis = 0;
-      double bestAreaIndexOnBestAxis = 0;
-      for (size_t i = 1; i < areas.size(); i++) {
-        if (overlapedAreas[i] < overlapedAreas[bestOverlapIndexOnBestAxis]) {
-          tiedOnOverlap = false;
-          bestAreaIndexOnBestAxis = i;
-          bestOverlapIndexOnBestAxis = i;
-          overlapBestOverlapAxis = overlapedAreas[i];
-          areaBestOverlapAxis = areas[i];
-        } else if (overlapedAreas[i] == overlapedAreas[bestOverlapIndexOnBestAxis]) {
-          tiedOnOverlap = true;
-          if (areas[i] < areas[bestAreaIndexOnBestAxis]) {
-            bestAreaIndexOnBestAxis = i;
-            overlapBestAreaAxis = overlapedAreas[i];
-            areaBestAreaAxis = areas[i];
-          }
-        }
-      }
-    }
-
-    // Track the minOverlapSplit data
-    if(minOverlapSplitDimension != tree->Bound().Dim() &&
-       j == minOverlapSplitDimension) {
-      for(size_t i = 0; i < overlapedAreas.size(); i++) {
-        if(overlapedAreas[i] < bestScoreMinOverlapSplit) {
-          bestScoreMinOverlapSplit = overlapedAreas[i];
-          bestIndexMinOverlapSplit = i;
-          areaOfBestMinOverlapSplit = areas[i];
-        }
-      }
+  // The entries to split are the bounds of the children.
+  SplitWorkspace workspace(tree->Bound().Dim(), tree->NumChildren(), tree->MaxNumChildren() - 2 * tree->MinNumChildren() + 2);
+  for (size_t i = 0; i < tree->NumChildren(); i++) {
+    for (size_t k = 0; k < tree->Bound().Dim(); k++) {
+      workspace.lo(k, i) = tree->Children()[i]->Bound()[k].Lo();
+      workspace.hi(k, i) = tree->Children()[i]->Bound()[k].Hi();
     }
   }
 
-  //Now we do the same thing using Bound().Hi() and choose the best of the two.
-  for (size_t j = 0; j < tree->Bound().Dim(); j++) {
-    double axisScore = 0.0;
-
-    // We'll do Bound().Lo() now and use Bound().Hi() later.
-    std::vector<sortStruct> sorted(tree->NumChildren());
-    for (size_t i = 0; i < sorted.size(); i++) {
-      sorted[i].d = tree->Children()[i]->Bound()[j].Hi();
-      sorted[i].n = i;
-    }
-
-    std::sort(sorted.begin(), sorted.end(), structComp);
+  const std::vector<double>& areas = workspace.areas;
+  const std::vector<double>& overlapedAreas = workspace.overlapedAreas;
 
-    // We'll store each of the three scores for each distribution.
-    std::vector<double> areas(tree->MaxNumChildren() - 2 * tree->MinNumChildren() + 2);
-    std::vector<double> margins(tree->MaxNumChildren() - 2 * tree->MinNumChildren() + 2);
-    std::vector<double> overlapedAreas(tree->MaxNumChildren() - 2 * tree->MinNumChildren() + 2);
-    for (size_t i = 0; i < areas.size(); i++) {
-      areas[i] = 0.0;
-      margins[i] = 0.0;
-      overlapedAreas[i] = 0.0;
-    }
+  // We sort by Bound().Lo() first and by Bound().Hi() second, and choose the best of the two.
+  for (size_t s = 0; s < 2; s++) {
+    const bool useHi = (s == 1);
+    for (size_t j = 0; j < tree->Bound().Dim(); j++) {
+      SortEntries(workspace, j, useHi);
 
-    for (size_t i = 0; i < areas.size(); i++) {
       // The ith arrangement is obtained by placing the first tree->MinNumChildren() + i
-      // points in one rectangle and the rest in another.  Then we calculate the three
-      // scores for that distribution.
-
-      size_t cutOff = tree->MinNumChildren() + i;
-      // We'll calculate the max and min in each dimension by hand to save time.
-      std::vector<double> maxG1(tree->Bound().Dim());
-      std::vector<double> minG1(maxG1.size());
-      std::vector<double> maxG2(maxG1.size());
-      std::vector<double> minG2(maxG1.size());
-      for (size_t k = 0; k < tree->Bound().Dim(); k++) {
-        minG1[k] = tree->Children()[sorted[0].n]->Bound()[k].Lo();
-        maxG1[k] = tree->Children()[sorted[0].n]->Bound()[k].Hi();
-        minG2[k] = tree->Children()[sorted[sorted.size() - 1].n]->Bound()[k].Lo();
-        maxG2[k] = tree->Children()[sorted[sorted.size() - 1].n]->Bound()[k].Hi();
-        for (size_t l = 1; l < tree->NumChildren() - 1; l++) {
-          if (l < cutOff) {
-            if (tree->Children()[sorted[l].n]->Bound()[k].Lo() < minG1[k])
-              minG1[k] = tree->Children()[sorted[l].n]->Bound()[k].Lo();
-            else if (tree->Children()[sorted[l].n]->Bound()[k].Hi() > maxG1[k])
-              maxG1[k] = tree->Children()[sorted[l].n]->Bound()[k].Hi();
-          } else {
-            if (tree->Children()[sorted[l].n]->Bound()[k].Lo() < minG2[k])
-              minG2[k] = tree->Children()[sorted[l].n]->Bound()[k].Lo();
-            else if (tree->Children()[sorted[l].n]->Bound()[k].Hi() > maxG2[k])
-              maxG2[k] = tree->Children()[sorted[l].n]->Bound()[k].Hi();
-          }
-        }
-      }
-      double area1 = 1.0, area2 = 1.0;
-      double oArea = 1.0;
-      for (size_t k = 0; k < maxG1.size(); k++) {
-        margins[i] += maxG1[k] - minG1[k] + maxG2[k] - minG2[k];
-        area1 *= maxG1[k] - minG1[k];
-        area2 *= maxG2[k] - minG2[k];
-        oArea *= maxG1[k] < minG2[k] || maxG2[k] < minG1[k] ? 0.0 : std::min(maxG1[k], maxG2[k]) - std::max(minG1[k], minG2[k]);
-      }
-      areas[i] += area1 + area2;
-      overlapedAreas[i] += oArea;
-      axisScore += margins[i];
-    }
-    if (axisScore < bestAxisScore) {
-      bestAxisScore = axisScore;
-      bestAxis = j;
-      lowIsBest = false;
-      double bestOverlapIndexOnBestAxis = 0;
-      double bestAreaIndexOnBestAxis = 0;
-      for (size_t i = 1; i < areas.size(); i++) {
-        if (overlapedAreas[i] < overlapedAreas[bestOverlapIndexOnBestAxis]) {
-          tiedOnOverlap = false;
-          bestAreaIndexOnBestAxis = i;
-          bestOverlapIndexOnBestAxis = i;
-          overlapBestOverlapAxis = overlapedAreas[i];
-          areaBestOverlapAxis = areas[i];
-        } else if (overlapedAreas[i] == overlapedAreas[bestOverlapIndexOnBestAxis]) {
-          tiedOnOverlap = true;
-          if (areas[i] < areas[bestAreaIndexOnBestAxis]) {
+      // children in one rectangle and the rest in another.
+      const double axisScore = EvaluateDistributions(workspace, tree->MinNumChildren());
+
+      if (axisScore < bestAxisScore) {
+        bestAxisScore = axisScore;
+        bestAxis = j;
+        lowIsBest = !useHi;
+        double bestOverlapIndexOnBestAxis = 0;
+        double bestAreaIndexOnBestAxis = 0;
+        for (size_t i = 1; i < areas.size(); i++) {
+          if (overlapedAreas[i] < overlapedAreas[bestOverlapIndexOnBestAxis]) {
+            tiedOnOverlap = false;
             bestAreaIndexOnBestAxis = i;
-            overlapBestAreaAxis = overlapedAreas[i];
-            areaBestAreaAxis = areas[i];
+            bestOverlapIndexOnBestAxis = i;
+            overlapBestOverlapAxis = overlapedAreas[i];
+            areaBestOverlapAxis = areas[i];
+          } else if (overlapedAreas[i] == overlapedAreas[bestOverlapIndexOnBestAxis]) {
+            tiedOnOverlap = true;
+            if (areas[i] < areas[bestAreaIndexOnBestAxis]) {
+              bestAreaIndexOnBestAxis = i;
+              overlapBestAreaAxis = overlapedAreas[i];
+              areaBestAreaAxis = areas[i];
+            }
           }
         }
       }
-    }
 
-    // Track the minOverlapSplit data
-    if(minOverlapSplitDimension != tree->Bound().Dim() &&
-       j == minOverlapSplitDimension) {
-      for(size_t i = 0; i < overlapedAreas.size(); i++) {
-        if(overlapedAreas[i] < bestScoreMinOverlapSplit) {
-          minOverlapSplitUsesHi = true;
-          bestScoreMinOverlapSplit = overlapedAreas[i];
-          bestIndexMinOverlapSplit = i;
-          areaOfBestMinOverlapSplit = areas[i];
+      // Track the minOverlapSplit data
+      if(minOverlapSplitDimension != tree->Bound().Dim() &&
+         j == minOverlapSplitDimension) {
+        for(size_t i = 0; i < overlapedAreas.size(); i++) {
+          if(overlapedAreas[i] < bestScoreMinOverlapSplit) {
+            minOverlapSplitUsesHi = useHi;
+            bestScoreMinOverlapSplit = overlapedAreas[i];
+            bestIndexMinOverlapSplit = i;
+            areaOfBestMinOverlapSplit = areas[i];
+          }
         }
       }
     }
   }
 
-  std::vector<sortStruct> sorted(tree->NumChildren());
-  if (lowIsBest) {
-    for (size_t i = 0; i < sorted.size(); i++) {
-      sorted[i].d = tree->Children()[i]->Bound()[bestAxis].Lo();
-      sorted[i].n = i;
-    }
-  } else {
-    for (size_t i = 0; i < sorted.size(); i++) {
-      sorted[i].d = tree->Children()[i]->Bound()[bestAxis].Hi();
-      sorted[i].n = i;
-    }
-  }
-
-  std::sort(sorted.begin(), sorted.end(), structComp);
+  SortEntries(workspace, bestAxis, !lowIsBest);
+  const std::vector<sortStruct>& sorted = workspace.sorted;
 
   RectangleTree<XTreeSplit<DescentType, StatisticType, MatType>, DescentType, StatisticType, MatType> *treeOne = new
           RectangleTree<XTreeSplit<DescentType, StatisticType, MatType>, DescentType, StatisticType, MatType>(tree->Parent());
@@ -579,19 +377,8 @@ bool XTreeSplit<DescentType, StatisticType, MatType>::SplitNonLeafNode(
   if(useMinOverlapSplit) {
     // If there is a dimension that might work, try that.
     if(minOverlapSplitDimension != tree->Bound().Dim() && bestScoreMinOverlapSplit / areaOfBestMinOverlapSplit < MAX_OVERLAP) {
-      std::vector<sortStruct> sorted2(tree->NumChildren());
-      if (minOverlapSplitUsesHi) {
-        for (size_t i = 0; i < sorted2.size(); i++) {
-          sorted2[i].d = tree->Children()[i]->Bound()[bestAxis].Hi();
-          sorted2[i].n = i;
-        }
-      } else {
-        for (size_t i = 0; i < sorted2.size(); i++) {
-          sorted2[i].d = tree->Children()[i]->Bound()[bestAxis].Lo();
-          sorted2[i].n = i;
-        }
-      }
-      std::sort(sorted2.begin(), sorted2.end(), structComp);
+      // The children are sorted along the minimal overlap dimension instead.
+      SortEntries(workspace, minOverlapSplitDimension, minOverlapSplitUsesHi);
       for (size_t i = 0; i < tree->NumChildren(); i++) {
         if (i < bestIndexMinOverlapSplit + tree->MinNumChildren())
           InsertNodeIntoTree(treeOne, tree->Children()[sorted[i].n]);
@@ -618,10 +405,10 @@ bool XTreeSplit<DescentType, StatisticType, MatType>::SplitNonLeafNode(
         tree->Parent()->NumChildren() = tree->NumChildren();
         for(size_t i = 0; i < tree->NumChildren(); i++) {
           tree->Parent()->Children()[i] = tree->Children()[i];
+          tree->Parent()->Children()[i]->Parent() = tree->Parent();
         }
         delete treeOne;
         delete treeTwo;
-        tree->NullifyData();
         tree->SoftDelete();
         return false;
       }
@@ -696,6 +483,134 @@ bool XTreeSplit<DescentType, StatisticType, MatType>::SplitNonLeafNode(
   return false;
 }
 
+/**
+ * Sort the entries by one corner along the given axis.
+ */
+template<typename DescentType,
+         typename StatisticType,
+         typename MatType>
+void XTreeSplit<DescentType, StatisticType, MatType>::SortEntries(
+    SplitWorkspace& workspace,
+    const size_t axis,
+    const bool useHi)
+{
+  const arma::mat& corners = (useHi) ? workspace.hi : workspace.lo;
+  for (size_t i = 0; i < workspace.sorted.size(); i++)
+  {
+    workspace.sorted[i].d = corners(axis, i);
+    workspace.sorted[i].n = i;
+  }
+
+  std::sort(workspace.sorted.begin(), workspace.sorted.end(), structComp);
+}
+
+/**
+ * Compute the bounding box of every prefix and every suffix of the sorted
+ * entries, and then the scores of each distribution from them.
+ */
+template<typename DescentType,
+         typename StatisticType,
+         typename MatType>
+double XTreeSplit<DescentType, StatisticType, MatType>::
+    EvaluateDistributions(SplitWorkspace& workspace, const size_t minSize)
+{
+  const std::vector<sortStruct>& sorted = workspace.sorted;
+  const size_t n = sorted.size();
+  const size_t dim = workspace.lo.n_rows;
+
+  for (size_t k = 0; k < dim; k++)
+  {
+    workspace.prefixLo(k, 0) = workspace.lo(k, sorted[0].n);
+    workspace.prefixHi(k, 0) = workspace.hi(k, sorted[0].n);
+    workspace.suffixLo(k, n - 1) = workspace.lo(k, sorted[n - 1].n);
+    workspace.suffixHi(k, n - 1) = workspace.hi(k, sorted[n - 1].n);
+  }
+
+  for (size_t l = 1; l < n; l++)
+  {
+    for (size_t k = 0; k < dim; k++)
+    {
+      workspace.prefixLo(k, l) = std::min(workspace.prefixLo(k, l - 1),
+          workspace.lo(k, sorted[l].n));
+      workspace.prefixHi(k, l) = std::max(workspace.prefixHi(k, l - 1),
+          workspace.hi(k, sorted[l].n));
+      workspace.suffixLo(k, n - 1 - l) = std::min(workspace.suffixLo(k, n - l),
+          workspace.lo(k, sorted[n - 1 - l].n));
+      workspace.suffixHi(k, n - 1 - l) = std::max(workspace.suffixHi(k, n - l),
+          workspace.hi(k, sorted[n - 1 - l].n));
+    }
+  }
+
+  double axisScore = 0.0;
+  for (size_t i = 0; i < workspace.areas.size(); i++)
+  {
+    // The first group is the entries before cutOff, and the second group is
+    // the rest; each group gets at least one entry.
+    const size_t cutOff = std::min(std::max(minSize + i, (size_t) 1), n - 1);
+
+    double margin = 0.0;
+    double area1 = 1.0, area2 = 1.0;
+    double oArea = 1.0;
+    for (size_t k = 0; k < dim; k++)
+    {
+      const double minG1 = workspace.prefixLo(k, cutOff - 1);
+      const double maxG1 = workspace.prefixHi(k, cutOff - 1);
+      const double minG2 = workspace.suffixLo(k, cutOff);
+      const double maxG2 = workspace.suffixHi(k, cutOff);
+
+      margin += maxG1 - minG1 + maxG2 - minG2;
+      area1 *= maxG1 - minG1;
+      area2 *= maxG2 - minG2;
+      oArea *= (maxG1 < minG2 || maxG2 < minG1) ? 0.0 :
+          (std::min(maxG1, maxG2) - std::max(minG1, minG2));
+    }
+
+    workspace.areas[i] = area1 + area2;
+    workspace.overlapedAreas[i] = oArea;
+    axisScore += margin;
+  }
+
+  return axisScore;
+}
+
+/**
+ * Take the points out of the leaf, then shrink the bounds once for all of them
+ * with CondenseTree(), rather than once for each point.
+ */
+template<typename DescentType,
+         typename StatisticType,
+         typename MatType>
+void XTreeSplit<DescentType, StatisticType, MatType>::
+    RemovePointsForReinsertion(TreeType* tree,
+                               const std::vector<size_t>& points,
+                               std::vector<bool>& relevels)
+{
+  for (size_t i = 0; i < points.size(); i++)
+  {
+    size_t j = 0;
+    while (tree->Points()[j] != points[i])
+      j++;
+    tree->Points()[j] = tree->Points()[--tree->Count()];
+  }
+
+  // If the leaf is now too small, CondenseTree() removes it and reinserts its
+  // points.
+  if (tree->Count() < tree->MinLeafSize())
+  {
+    tree->CondenseTree(arma::vec(), relevels, false);
+    return;
+  }
+
+  tree->Bound().Clear();
+  for (size_t i = 0; i < tree->Count(); i++)
+    tree->Bound() |= tree->Dataset().col(tree->Points()[i]);
+  tree->Stat() = StatisticType(*tree);
+
+  // This shrinks the bounds of the ancestors as far as needed, and
+  // reinitializes their statistics.
+  tree->Parent()->CondenseTree(arma::vec(), relevels, false);
+}
+
 /**
  * Insert a node into another node.  Expanding the bounds and updating the numberOfChildren.
  */
@@ -707,8 +622,14 @@ void XTreeSplit<DescentType, StatisticType, MatType>::InsertNodeIntoTree(
         RectangleTree<XTreeSplit<DescentType, StatisticType, MatType>, DescentType, StatisticType, MatType>* srcNode)
 {
   destTree->Bound() |= srcNode->Bound();
-  destTree->Children().push_back(srcNode);
-  destTree->NumChildren()++;
+
+  // A group from the split of a supernode can have more children than a normal
+  // node; then the node grows into a supernode too.
+  if (destTree->NumChildren() == destTree->MaxNumChildren()) {
+    destTree->MaxNumChildren() *= 2;
+    destTree->Children().resize(destTree->MaxNumChildren() + 1);
+  }
+  destTree->Children()[destTree->NumChildren()++] = srcNode;
 }
 
 }; // namespace tree
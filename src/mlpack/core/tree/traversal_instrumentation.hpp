@@ -0,0 +1,277 @@
+/**
+ * @file traversal_instrumentation.hpp
+ *
+ * Instrumentation policies for tree traversals.  Algorithms which take an
+ * InstrumentationType template parameter run their traversals through an
+ * InstrumentedRules object, which reports each Score(), Rescore() and
+ * BaseCase() call to the instrumentation policy.  NoTraversalInstrumentation
+ * does nothing and compiles away entirely; TraversalInstrumentation collects
+ * detailed counters, at the cost of reading the clock and walking up the tree
+ * on every call.
+ */
+#ifndef __MLPACK_CORE_TREE_TRAVERSAL_INSTRUMENTATION_HPP
+#define __MLPACK_CORE_TREE_TRAVERSAL_INSTRUMENTATION_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace tree {
+
+/**
+ * An instrumentation policy which records nothing.  This is the default for
+ * every algorithm which supports instrumentation; every call on it is empty
+ * and inline, so the traversal compiles to the same code as it would without
+ * instrumentation.
+ */
+class NoTraversalInstrumentation
+{
+ public:
+  //! Get the time a call started at; nothing is timed, so this is 0.
+  uint64_t Start() const { return 0; }
+
+  //! Record a call to Score(); nothing is recorded.
+  template<typename TreeType>
+  void Score(const TreeType* /* queryNode */,
+             const TreeType& /* referenceNode */,
+             const double /* score */,
+             const uint64_t /* start */) { }
+
+  //! Record a call to Rescore(); nothing is recorded.
+  template<typename TreeType>
+  void Rescore(const TreeType* /* queryNode */,
+               const TreeType& /* referenceNode */,
+               const double /* oldScore */,
+               const double /* score */) { }
+
+  //! Record base case evaluations; nothing is recorded.
+  void BaseCases(const size_t /* count */, const uint64_t /* start */) { }
+
+  //! Add the counters of another object; there are none.
+  void Merge(const NoTraversalInstrumentation& /* other */) { }
+
+  //! Reset the counters; there are none.
+  void Reset() { }
+};
+
+/**
+ * An instrumentation policy which records what a traversal spends its time on:
+ * the number of node combinations scored and pruned at each depth of the tree,
+ * how often Rescore() turns a visit into a prune, how many points are in the
+ * reference leaves that are reached, and the time spent in Score() and in
+ * BaseCase().
+ *
+ * For dual-tree traversals, the depth of a node combination is the depth of
+ * the deeper of the two nodes.  Depths are found by walking up the tree, and
+ * times are measured with Timers::GetTimeNanoseconds() around every call, so
+ * this slows the traversal down noticeably; the times are best used to compare
+ * Score() with BaseCase(), rather than as absolute values.
+ *
+ * @code
+ * NeighborSearch<NearestNeighborSort, EuclideanDistance, KDTree,
+ *     TraversalInstrumentation> knn(data);
+ * knn.Search(5, neighbors, distances);
+ * const arma::Col<size_t>& prunes = knn.Instrumentation().PrunesByDepth();
+ * @endcode
+ */
+class TraversalInstrumentation
+{
+ public:
+  //! Create the object with all counters set to zero.
+  TraversalInstrumentation() { Reset(); }
+
+  //! Get the time a call started at.
+  uint64_t Start() const { return Timers::GetTimeNanoseconds(); }
+
+  /**
+   * Record a call to Score().
+   *
+   * @param queryNode Query node, or NULL if a single query point was scored.
+   * @param referenceNode Reference node.
+   * @param score The score that was returned.
+   * @param start The time the call started at, from Start().
+   */
+  template<typename TreeType>
+  void Score(const TreeType* queryNode,
+             const TreeType& referenceNode,
+             const double score,
+             const uint64_t start)
+  {
+    scoreTime += Timers::GetTimeNanoseconds() - start;
+
+    size_t depth = Depth(referenceNode);
+    if (queryNode != NULL)
+      depth = std::max(depth, Depth(*queryNode));
+
+    ++scores;
+    Increment(visitsByDepth, depth);
+    if (score == DBL_MAX)
+    {
+      ++prunes;
+      Increment(prunesByDepth, depth);
+    }
+    else if (referenceNode.IsLeaf())
+    {
+      ++leafVisits;
+      leafPoints += referenceNode.NumPoints();
+    }
+  }
+
+  /**
+   * Record a call to Rescore().
+   *
+   * @param queryNode Query node, or NULL if a single query point was rescored.
+   * @param referenceNode Reference node.
+   * @param oldScore The score before Rescore() was called.
+   * @param score The score that was returned.
+   */
+  template<typename TreeType>
+  void Rescore(const TreeType* queryNode,
+               const TreeType& referenceNode,
+               const double oldScore,
+               const double score)
+  {
+    ++rescores;
+    if ((score == DBL_MAX) && (oldScore != DBL_MAX))
+    {
+      size_t depth = Depth(referenceNode);
+      if (queryNode != NULL)
+        depth = std::max(depth, Depth(*queryNode));
+
+      ++rescorePrunes;
+      Increment(prunesByDepth, depth);
+    }
+  }
+
+  /**
+   * Record base case evaluations.
+   *
+   * @param count Number of base cases that were evaluated.
+   * @param start The time the evaluations started at, from Start().
+   */
+  void BaseCases(const size_t count, const uint64_t start)
+  {
+    baseCaseTime += Timers::GetTimeNanoseconds() - start;
+    baseCases += count;
+  }
+
+  //! Add the counters of another object (i.e. from another thread) to these.
+  void Merge(const TraversalInstrumentation& other)
+  {
+    scores += other.scores;
+    prunes += other.prunes;
+    rescores += other.rescores;
+    rescorePrunes += other.rescorePrunes;
+    baseCases += other.baseCases;
+    leafVisits += other.leafVisits;
+    leafPoints += other.leafPoints;
+    scoreTime += other.scoreTime;
+    baseCaseTime += other.baseCaseTime;
+    Add(visitsByDepth, other.visitsByDepth);
+    Add(prunesByDepth, other.prunesByDepth);
+  }
+
+  //! Set all the counters to zero.
+  void Reset()
+  {
+    scores = 0;
+    prunes = 0;
+    rescores = 0;
+    rescorePrunes = 0;
+    baseCases = 0;
+    leafVisits = 0;
+    leafPoints = 0;
+    scoreTime = 0;
+    baseCaseTime = 0;
+    visitsByDepth.reset();
+    prunesByDepth.reset();
+  }
+
+  //! Get the number of calls to Score().
+  size_t Scores() const { return scores; }
+  //! Get the number of calls to Score() which pruned.
+  size_t Prunes() const { return prunes; }
+  //! Get the number of calls to Rescore().
+  size_t Rescores() const { return rescores; }
+  //! Get the number of calls to Rescore() which pruned a combination that
+  //! Score() did not.
+  size_t RescorePrunes() const { return rescorePrunes; }
+  //! Get the number of base cases evaluated.
+  size_t BaseCases() const { return baseCases; }
+
+  //! Get the number of node combinations scored at each depth.
+  const arma::Col<size_t>& VisitsByDepth() const { return visitsByDepth; }
+  //! Get the number of prunes (by Score() or Rescore()) at each depth.
+  const arma::Col<size_t>& PrunesByDepth() const { return prunesByDepth; }
+
+  //! Get the number of times a reference leaf was scored and not pruned.
+  size_t LeafVisits() const { return leafVisits; }
+  //! Get the total number of points in the reference leaves that were reached.
+  size_t LeafPoints() const { return leafPoints; }
+  //! Get the average number of points in the reference leaves that were
+  //! reached; this is best compared with the leaf size of the tree.
+  double LeafUtilization() const
+  {
+    return (leafVisits == 0) ? 0.0 : (double) leafPoints / leafVisits;
+  }
+
+  //! Get the time spent in Score(), in nanoseconds.
+  uint64_t ScoreNanoseconds() const { return scoreTime; }
+  //! Get the time spent in BaseCase(), in nanoseconds.
+  uint64_t BaseCaseNanoseconds() const { return baseCaseTime; }
+
+ private:
+  //! The number of calls to Score().
+  size_t scores;
+  //! The number of calls to Score() which pruned.
+  size_t prunes;
+  //! The number of calls to Rescore().
+  size_t rescores;
+  //! The number of calls to Rescore() which pruned.
+  size_t rescorePrunes;
+  //! The number of base cases evaluated.
+  size_t baseCases;
+  //! The number of reference leaves reached.
+  size_t leafVisits;
+  //! The number of points in the reference leaves reached.
+  size_t leafPoints;
+  //! The time spent in Score().
+  uint64_t scoreTime;
+  //! The time spent in BaseCase().
+  uint64_t baseCaseTime;
+  //! The number of node combinations scored at each depth.
+  arma::Col<size_t> visitsByDepth;
+  //! The number of prunes at each depth.
+  arma::Col<size_t> prunesByDepth;
+
+  //! Find the depth of a node by walking up to the root.
+  template<typename TreeType>
+  static size_t Depth(const TreeType& node)
+  {
+    size_t depth = 0;
+    for (const TreeType* n = node.Parent(); n != NULL; n = n->Parent())
+      ++depth;
+    return depth;
+  }
+
+  //! Increment the counter for the given depth, growing the vector if needed.
+  static void Increment(arma::Col<size_t>& counts, const size_t depth)
+  {
+    if (depth >= counts.n_elem)
+      counts.resize(depth + 1); // New elements are zero.
+    ++counts[depth];
+  }
+
+  //! Add one vector of counters to another, which may be shorter.
+  static void Add(arma::Col<size_t>& counts, const arma::Col<size_t>& other)
+  {
+    if (other.n_elem > counts.n_elem)
+      counts.resize(other.n_elem);
+    if (other.n_elem > 0)
+      counts.subvec(0, other.n_elem - 1) += other;
+  }
+};
+
+}; // namespace tree
+}; // namespace mlpack
+
+#endif
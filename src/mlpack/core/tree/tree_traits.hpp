@@ -94,6 +94,14 @@ class TreeTraits
    * This is true if the tree rearranges points in the dataset when it is built.
    */
   static const bool RearrangesDataset = false;
+
+  /**
+   * This is true if the tree has a constructor TreeType(const TreeType& other,
+   * MatType& data), which deep-copies the other tree so that the copy refers to
+   * the given dataset instead (which must hold the same points at the same
+   * indices, such as a copy of the dataset of the other tree).
+   */
+  static const bool CanCopyToDataset = false;
 };
 
 }; // namespace tree
@@ -0,0 +1,44 @@
+/**
+ * @file accelerator.cpp
+ *
+ * Implementation of the distance tiles for brute-force searches.
+ */
+#include "accelerator.hpp"
+
+using namespace mlpack;
+
+bool util::AcceleratorAvailable()
+{
+#ifdef MLPACK_HAS_NVBLAS
+  return true;
+#else
+  return false;
+#endif
+}
+
+size_t util::TileColumns(const size_t rows, const size_t maxBytes)
+{
+  const size_t columns = maxBytes / (std::max(rows, (size_t) 1) *
+      sizeof(double));
+  return std::max(columns, (size_t) 1);
+}
+
+void util::SquaredDistanceTile(const arma::mat& a,
+                               const arma::rowvec& aNorms,
+                               const arma::mat& b,
+                               const arma::rowvec& bNorms,
+                               arma::mat& tile,
+                               const size_t numThreads)
+{
+  // This is a single GEMM call, which is what the accelerator backend
+  // intercepts; the rest is memory-bound and is done on the host.
+  tile = -2.0 * a.t() * b;
+
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t j = 0; j < (omp_size_t) tile.n_cols; ++j)
+  {
+    double* column = tile.colptr(j);
+    for (size_t i = 0; i < tile.n_rows; ++i)
+      column[i] = std::max(column[i] + aNorms[i] + bNorms[j], 0.0);
+  }
+}
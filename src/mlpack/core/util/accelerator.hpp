@@ -0,0 +1,68 @@
+/**
+ * @file accelerator.hpp
+ *
+ * Distance tiles for brute-force searches, computed with large matrix
+ * multiplications so that they can be offloaded to an accelerator.
+ */
+#ifndef __MLPACK_CORE_UTIL_ACCELERATOR_HPP
+#define __MLPACK_CORE_UTIL_ACCELERATOR_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace util {
+
+//! The default largest size of a distance tile, in bytes (256MB).
+const size_t DefaultTileBytes = 256 * 1024 * 1024;
+
+/**
+ * Get whether mlpack was built with an accelerator backend (the CMake option
+ * USE_NVBLAS, which links NVBLAS ahead of the BLAS library, so that large
+ * matrix multiplications are run on a GPU).  Without one, the offloaded code
+ * paths (for instance NeighborSearch::Offload() and NaiveKMeans::Offload())
+ * still work, but their matrix multiplications are run by the BLAS library on
+ * the CPU.
+ */
+bool AcceleratorAvailable();
+
+/**
+ * Get the number of columns of a distance tile with the given number of rows
+ * which fits in the given number of bytes (at least 1).  An accelerator only
+ * pays for the transfer of the operands if the tiles are large, so the tiles
+ * are sized by memory rather than by the size of the CPU caches.
+ *
+ * @param rows Number of rows of the tile.
+ * @param maxBytes Largest size of the tile in bytes.
+ */
+size_t TileColumns(const size_t rows, const size_t maxBytes = DefaultTileBytes);
+
+/**
+ * Compute the squared Euclidean distances between each column of a and each
+ * column of b with the ||a||^2 + ||b||^2 - 2 a^T b expansion, so that the
+ * work is one matrix multiplication (which an accelerator backend runs on the
+ * device).  tile(i, j) is the squared distance between a.col(i) and b.col(j);
+ * negative values (from rounding error) are clamped to 0.
+ *
+ * The expansion loses precision when the distances are small next to the
+ * norms, so the points should be centered (on any common point) first, and
+ * callers that need exact distances should compute the distances of the points
+ * they choose again directly.
+ *
+ * @param a First set of points.
+ * @param aNorms Squared norms of the columns of a.
+ * @param b Second set of points.
+ * @param bNorms Squared norms of the columns of b.
+ * @param tile Matrix to store the distances in (it is resized).
+ * @param numThreads Number of threads to add the norms with.
+ */
+void SquaredDistanceTile(const arma::mat& a,
+                         const arma::rowvec& aNorms,
+                         const arma::mat& b,
+                         const arma::rowvec& bNorms,
+                         arma::mat& tile,
+                         const size_t numThreads = 1);
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
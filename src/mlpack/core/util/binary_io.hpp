@@ -0,0 +1,143 @@
+/**
+ * @file binary_io.hpp
+ *
+ * Simple helpers for writing plain values, std::vectors and Armadillo
+ * matrices to (and reading them back from) binary streams.  These are used to
+ * store built trees and models so that they do not need to be rebuilt on every
+ * run.  No attempt is made to handle differing endianness or word sizes; files
+ * are only meant to be read back on the same kind of machine that wrote them.
+ */
+#ifndef __MLPACK_CORE_UTIL_BINARY_IO_HPP
+#define __MLPACK_CORE_UTIL_BINARY_IO_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <mlpack/core/util/log.hpp>
+#include <iostream>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * Write a plain-old-data value to the given binary stream.
+ *
+ * @param stream Stream to write to.
+ * @param value Value to write.
+ */
+template<typename T>
+void WriteBinary(std::ostream& stream, const T& value)
+{
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/**
+ * Read a plain-old-data value from the given binary stream.  If the stream
+ * ends before the value is read, a fatal error is thrown.
+ *
+ * @param stream Stream to read from.
+ * @param value Value to read into.
+ */
+template<typename T>
+void ReadBinary(std::istream& stream, T& value)
+{
+  stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+  if (!stream)
+    Log::Fatal << "ReadBinary(): unexpected end of stream." << std::endl;
+}
+
+//! Write a std::string, preceded by its length.
+inline void WriteBinary(std::ostream& stream, const std::string& str)
+{
+  WriteBinary(stream, (size_t) str.size());
+  stream.write(str.data(), str.size());
+}
+
+//! Read a std::string written by WriteBinary().
+inline void ReadBinary(std::istream& stream, std::string& str)
+{
+  size_t size;
+  ReadBinary(stream, size);
+  str.resize(size);
+  if (size > 0)
+  {
+    stream.read(&str[0], size);
+    if (!stream)
+      Log::Fatal << "ReadBinary(): unexpected end of stream." << std::endl;
+  }
+}
+
+//! Write a std::vector of plain-old-data values, preceded by its length.
+template<typename T>
+void WriteBinary(std::ostream& stream, const std::vector<T>& vector)
+{
+  WriteBinary(stream, (size_t) vector.size());
+  if (vector.size() > 0)
+    stream.write(reinterpret_cast<const char*>(&vector[0]),
+        sizeof(T) * vector.size());
+}
+
+//! Read a std::vector written by WriteBinary().
+template<typename T>
+void ReadBinary(std::istream& stream, std::vector<T>& vector)
+{
+  size_t size;
+  ReadBinary(stream, size);
+  vector.resize(size);
+  if (size > 0)
+  {
+    stream.read(reinterpret_cast<char*>(&vector[0]), sizeof(T) * size);
+    if (!stream)
+      Log::Fatal << "ReadBinary(): unexpected end of stream." << std::endl;
+  }
+}
+
+//! Write an Armadillo matrix, preceded by its dimensions.
+template<typename eT>
+void WriteBinary(std::ostream& stream, const arma::Mat<eT>& matrix)
+{
+  WriteBinary(stream, (size_t) matrix.n_rows);
+  WriteBinary(stream, (size_t) matrix.n_cols);
+  if (matrix.n_elem > 0)
+    stream.write(reinterpret_cast<const char*>(matrix.memptr()),
+        sizeof(eT) * matrix.n_elem);
+}
+
+//! Read an Armadillo matrix written by WriteBinary().
+template<typename eT>
+void ReadBinary(std::istream& stream, arma::Mat<eT>& matrix)
+{
+  size_t rows, cols;
+  ReadBinary(stream, rows);
+  ReadBinary(stream, cols);
+  matrix.set_size(rows, cols);
+  if (matrix.n_elem > 0)
+  {
+    stream.read(reinterpret_cast<char*>(matrix.memptr()),
+        sizeof(eT) * matrix.n_elem);
+    if (!stream)
+      Log::Fatal << "ReadBinary(): unexpected end of stream." << std::endl;
+  }
+}
+
+//! Write an Armadillo column vector, preceded by its dimensions.
+template<typename eT>
+void WriteBinary(std::ostream& stream, const arma::Col<eT>& vector)
+{
+  WriteBinary(stream, static_cast<const arma::Mat<eT>&>(vector));
+}
+
+//! Read an Armadillo column vector written by WriteBinary().
+template<typename eT>
+void ReadBinary(std::istream& stream, arma::Col<eT>& vector)
+{
+  arma::Mat<eT> matrix;
+  ReadBinary(stream, matrix);
+  if (matrix.n_cols > 1)
+    Log::Fatal << "ReadBinary(): stored matrix is not a column vector."
+        << std::endl;
+  vector = arma::vectorise(matrix);
+}
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
@@ -8,8 +8,11 @@
 #include <boost/program_options.hpp>
 #include <boost/any.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include "cli.hpp"
 #include "log.hpp"
@@ -65,16 +68,13 @@ CLI::~CLI()
     Print();
 
     Log::Info << "Program timers:" << std::endl;
-    std::map<std::string, timeval>::iterator it;
-    for (it = timer.GetAllTimers().begin(); it != timer.GetAllTimers().end();
-        ++it)
-    {
-      std::string i = (*it).first;
-      Log::Info << "  " << i << ": ";
-      timer.PrintTimer((*it).first);
-    }
+    timer.PrintAllTimers();
   }
 
+  // Save everything for other programs to read, if the user asked.
+  if (HasParam("metrics_file") && !HasParam("help") && !HasParam("info"))
+    WriteMetrics(GetParam<std::string>("metrics_file"));
+
   // Notify the user if we are debugging, but only if we actually parsed the
   // options.  This way this output doesn't show up inexplicably for someone who
   // may not have wanted it there (i.e. in Boost unit tests).
@@ -224,6 +224,15 @@ void CLI::DefaultMessages()
     Log::Info.ignoreInput = false;
   }
 
+  // Record the peak memory of each timer, to print or save with the timers.
+  if (HasParam("verbose") || HasParam("metrics_file"))
+    Timer::EnableMemoryTracking();
+
+  // Hardware counters cost a system call per counter at every timer start and
+  // stop, so they are only recorded if asked for.
+  if (HasParam("perf_counters"))
+    Timer::EnableCounters();
+
   // Notify the user if we are debugging.  This is not done in the constructor
   // because the output streams may not be set up yet.  We also don't want this
   // message twice if the user just asked for help or information.
@@ -446,6 +455,80 @@ void CLI::RemoveDuplicateFlags(po::basic_parsed_options<char>& bpo)
   }
 }
 
+/**
+ * Parses the options of one request to a program running as a server, starting
+ * from the values given on the command line.
+ */
+std::string CLI::ParseRequest(const std::string& request)
+{
+  CLI& cli = GetSingleton();
+
+  // Restore the options given in the last request to the values they had
+  // before it.
+  gmap_t::iterator it;
+  for (it = cli.commandLineValues.begin(); it != cli.commandLineValues.end();
+      ++it)
+    cli.globalValues[it->first] = it->second;
+  cli.commandLineValues.clear();
+
+  // Split the request into arguments at whitespace outside of quotes.
+  std::vector<std::string> arguments;
+  std::string argument;
+  bool inArgument = false;
+  bool quoted = false;
+  for (size_t i = 0; i < request.size(); ++i)
+  {
+    const char c = request[i];
+    if (c == '"')
+    {
+      quoted = !quoted;
+      inArgument = true;
+    }
+    else if (!quoted && (c == ' ' || c == '\t' || c == '\r' || c == '\n'))
+    {
+      if (inArgument)
+        arguments.push_back(argument);
+      argument.clear();
+      inArgument = false;
+    }
+    else
+    {
+      argument += c;
+      inArgument = true;
+    }
+  }
+  if (quoted)
+    return "unterminated quote in request";
+  if (inArgument)
+    arguments.push_back(argument);
+
+  // Options given more than once are an error (boost reports them).
+  po::variables_map requestMap;
+  try
+  {
+    po::store(po::command_line_parser(arguments).options(cli.desc).run(),
+        requestMap);
+    po::notify(requestMap);
+  }
+  catch (std::exception& ex)
+  {
+    return ex.what();
+  }
+
+  // Override the values given on the command line with those of the request,
+  // saving them for the next request.
+  po::variables_map::iterator i;
+  for (i = requestMap.begin(); i != requestMap.end(); ++i)
+  {
+    ParamData& param = cli.globalValues[i->first];
+    cli.commandLineValues[i->first] = param;
+    param.value = i->second.value();
+    param.wasPassed = true;
+  }
+
+  return "";
+}
+
 /**
  * Parses a stream for arguments
  *
@@ -476,6 +559,142 @@ void CLI::ParseStream(std::istream& stream)
   Timer::Start("total_time");
 }
 
+//! Write the given string as a JSON string.
+static void WriteJSONString(std::ostream& stream, const std::string& str)
+{
+  stream << '"';
+  for (size_t i = 0; i < str.size(); ++i)
+  {
+    const unsigned char c = (unsigned char) str[i];
+    if (c == '"' || c == '\\')
+      stream << '\\' << str[i];
+    else if (c == '\n')
+      stream << "\\n";
+    else if (c == '\t')
+      stream << "\\t";
+    else if (c < 0x20)
+      stream << "\\u00" << "0123456789abcdef"[c >> 4]
+          << "0123456789abcdef"[c & 0xf];
+    else
+      stream << str[i];
+  }
+  stream << '"';
+}
+
+//! Write the given number as JSON, which has no infinities or NaNs; these are
+//! written as null.
+static void WriteJSONNumber(std::ostream& stream, const double value)
+{
+  if (value != value || value == std::numeric_limits<double>::infinity() ||
+      value == -std::numeric_limits<double>::infinity())
+    stream << "null";
+  else
+    stream << value;
+}
+
+/* Writes the parameters, timers and metrics to a file. */
+void CLI::WriteMetrics(const std::string& filename)
+{
+  // This is called while the program exits, so failing is not fatal.
+  std::ofstream stream(filename.c_str());
+  if (!stream.is_open())
+  {
+    Log::Warn << "Cannot open '" << filename << "' to save the metrics to."
+        << std::endl;
+    return;
+  }
+  stream.precision(std::numeric_limits<double>::digits10 + 2);
+
+  CLI& cli = GetSingleton();
+  stream << "{" << std::endl;
+  stream << "  \"program\": ";
+  WriteJSONString(stream, cli.programName);
+  stream << "," << std::endl << "  \"version\": ";
+  WriteJSONString(stream, util::GetVersion());
+
+  // The parameters, with the same types Print() handles.
+  stream << "," << std::endl << "  \"parameters\": {";
+  gmap_t::iterator iter;
+  for (iter = cli.globalValues.begin(); iter != cli.globalValues.end(); ++iter)
+  {
+    const std::string& key = iter->first;
+    const ParamData& data = iter->second;
+
+    stream << (iter == cli.globalValues.begin() ? "" : ",") << std::endl
+        << "    ";
+    WriteJSONString(stream, key);
+    stream << ": ";
+    if (data.tname == TYPENAME(std::string))
+      WriteJSONString(stream, GetParam<std::string>(key));
+    else if (data.tname == TYPENAME(int))
+      stream << GetParam<int>(key);
+    else if (data.tname == TYPENAME(bool))
+      stream << (HasParam(key) ? "true" : "false");
+    else if (data.tname == TYPENAME(float))
+      WriteJSONNumber(stream, GetParam<float>(key));
+    else if (data.tname == TYPENAME(double))
+      WriteJSONNumber(stream, GetParam<double>(key));
+    else
+      stream << "null";
+  }
+  stream << std::endl << "  }," << std::endl;
+
+  // The timers, with their parents and (if they were tracked) their peak memory
+  // and hardware counters.
+  stream << "  \"timers\": {";
+  const std::map<std::string, timeval> timers = cli.timer.GetAllTimers();
+  std::map<std::string, timeval>::const_iterator t;
+  for (t = timers.begin(); t != timers.end(); ++t)
+  {
+    stream << (t == timers.begin() ? "" : ",") << std::endl << "    ";
+    WriteJSONString(stream, t->first);
+    stream << ": { \"seconds\": "
+        << (cli.timer.GetTimerNanoseconds(t->first) / 1e9)
+        << ", \"threads\": " << cli.timer.GetTimerThreads(t->first)
+        << ", \"parent\": ";
+    WriteJSONString(stream, cli.timer.GetParent(t->first));
+    if (cli.timer.MemoryTracking())
+      stream << ", \"peak_memory\": "
+          << cli.timer.GetTimerPeakMemory(t->first);
+    if (cli.timer.CounterTracking())
+    {
+      stream << ", \"counters\": {";
+      const std::map<std::string, uint64_t> counters =
+          cli.timer.GetTimerCounters(t->first);
+      std::map<std::string, uint64_t>::const_iterator c;
+      for (c = counters.begin(); c != counters.end(); ++c)
+      {
+        stream << (c == counters.begin() ? " " : ", ");
+        WriteJSONString(stream, c->first);
+        stream << ": " << c->second;
+      }
+      stream << " }";
+    }
+    stream << " }";
+  }
+  stream << std::endl << "  }," << std::endl;
+
+  stream << "  \"metrics\": {";
+  const std::map<std::string, double> metrics = Metric::GetAll();
+  std::map<std::string, double>::const_iterator m;
+  for (m = metrics.begin(); m != metrics.end(); ++m)
+  {
+    stream << (m == metrics.begin() ? "" : ",") << std::endl << "    ";
+    WriteJSONString(stream, m->first);
+    stream << ": ";
+    WriteJSONNumber(stream, m->second);
+  }
+  stream << std::endl << "  }";
+
+  if (cli.timer.MemoryTracking())
+  {
+    stream << "," << std::endl << "  \"peak_memory\": "
+        << cli.timer.GetPeakMemory() << "," << std::endl
+        << "  \"current_memory\": " << Timer::ResidentMemory();
+  }
+  stream << std::endl << "}" << std::endl;
+}
+
 /* Prints out the current hierarchy. */
 void CLI::Print()
 {
@@ -742,3 +961,9 @@ PARAM_STRING("info", "Get help on a specific module or option.", "", "");
 PARAM_FLAG("verbose", "Display informational messages and the full list of "
     "parameters and timers at the end of execution.", "v");
 PARAM_FLAG("version", "Display the version of mlpack.", "V");
+PARAM_STRING("metrics_file", "If specified, save the parameters, timers, "
+    "metrics (such as dataset sizes and the number of base cases computed) and "
+    "peak memory of the run to this file as JSON.", "", "");
+PARAM_FLAG("perf_counters", "Record hardware performance counters (cycles, "
+    "instructions, last-level cache misses and branch misses) with the timers, "
+    "to print with --verbose or save with --metrics_file (Linux only).", "");
@@ -18,6 +18,7 @@
 #include <boost/program_options.hpp>
 
 #include "timers.hpp"
+#include "metrics.hpp"
 #include "cli_deleter.hpp" // To make sure we can delete the singleton.
 #include "version.hpp"
 
@@ -642,11 +643,37 @@ class CLI
    */
   static void ParseStream(std::istream& stream);
 
+  /**
+   * Parses the options of one request to a program which runs as a server (so
+   * that it keeps its data, trees and models in memory between requests).  A
+   * request holds options like those of the command line, separated by
+   * whitespace; double quotes can be used around values with spaces.  All of
+   * the options are first reset to the values they had after
+   * ParseCommandLine(), so options which are not given in the request keep
+   * those values, and a request never sees the options of the one before it.
+   *
+   * Unlike ParseCommandLine(), this does not terminate the program if the
+   * request can't be parsed; the error is returned instead, and the options
+   * keep the values given on the command line.
+   *
+   * @param request The options of the request.
+   * @return An empty string on success, or a description of the error.
+   */
+  static std::string ParseRequest(const std::string& request);
+
   /**
    * Print out the current hierarchy.
    */
   static void Print();
 
+  /**
+   * Write the parameters, timers and metrics of this run to the given file, as
+   * JSON.  This is done at the end of a program run with --metrics_file.
+   *
+   * @param filename File to write to.
+   */
+  static void WriteMetrics(const std::string& filename);
+
   /**
    * Print out the help info of the hierarchy.
    */
@@ -690,6 +717,10 @@ class CLI
   //! True, if CLI was used to parse command line options.
   bool didParse;
 
+  //! The values which the options given in the last request parsed by
+  //! ParseRequest() had before it.
+  gmap_t commandLineValues;
+
   //! Hold the name of the program for --version.
   std::string programName;
 
@@ -699,6 +730,12 @@ class CLI
   //! So that Timer::Start() and Timer::Stop() can access the timer variable.
   friend class Timer;
 
+  //! The metrics of this run.
+  std::map<std::string, double> metrics;
+
+  //! So that Metric::Add() and Metric::Set() can access the metrics.
+  friend class Metric;
+
  public:
   //! Pointer to the ProgramDoc object.
   util::ProgramDoc *doc;
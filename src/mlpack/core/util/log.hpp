@@ -43,7 +43,15 @@ namespace mlpack {
  *
  * Any messages sent to Log::Debug will not be shown when compiling in non-debug
  * mode.  Messages to Log::Info will only be shown when the --verbose flag is
- * given to the program (or rather, the CLI class).
+ * given to the program (or rather, the CLI class).  Output sent to a stream
+ * which will not show it is discarded without being formatted, so logging in
+ * loops is cheap when the stream is muted; but the arguments are still
+ * evaluated, so if computing them is expensive, check the stream first:
+ *
+ * @code
+ * if (!Log::Info.ignoreInput)
+ *   Log::Info << "Objective: " << ExpensiveObjective() << "." << std::endl;
+ * @endcode
  *
  * @see PrefixedOutStream, NullOutStream, CLI
  */
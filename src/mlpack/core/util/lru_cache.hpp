@@ -0,0 +1,147 @@
+/**
+ * @file lru_cache.hpp
+ *
+ * A cache which keeps the most recently used values, for programs which answer
+ * the same requests again and again.
+ */
+#ifndef __MLPACK_CORE_UTIL_LRU_CACHE_HPP
+#define __MLPACK_CORE_UTIL_LRU_CACHE_HPP
+
+#include <mlpack/prereqs.hpp>
+
+#include <list>
+#include <boost/unordered_map.hpp>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * A fixed-size cache of values, which drops the least recently used value when
+ * it is full.  Keys are found in a hash table, so KeyType must be hashable
+ * with boost::hash (this includes std::vector of numbers, so a query point can
+ * be its own key).  Finding and inserting take constant time.
+ *
+ * For example, a server which answers queries can keep the results of the
+ * most recent ones:
+ *
+ * @code
+ * LRUCache<std::vector<double>, arma::vec> cache(10000);
+ * const arma::vec* result = cache.Find(query);
+ * if (result == NULL)
+ *   cache.Insert(query, Answer(query));
+ * @endcode
+ *
+ * The cache is not thread-safe.  The values are kept as they are when they are
+ * inserted, so the cache must be cleared (with Clear()) whenever something
+ * they depend on (an index, or the settings of a search) changes.
+ *
+ * @tparam KeyType Type of the keys.
+ * @tparam ValueType Type of the cached values.
+ */
+template<typename KeyType, typename ValueType>
+class LRUCache
+{
+ public:
+  /**
+   * Create an empty cache.
+   *
+   * @param capacity Maximum number of values to keep; if 0, nothing is kept.
+   */
+  LRUCache(const size_t capacity = 0) :
+      capacity(capacity),
+      hits(0),
+      misses(0)
+  { }
+
+  /**
+   * Find the value of the given key, and make it the most recently used.  The
+   * returned pointer is valid until the next call to Insert() or Clear().
+   *
+   * @param key Key to find.
+   * @return The value, or NULL if the key is not in the cache.
+   */
+  const ValueType* Find(const KeyType& key)
+  {
+    typename IndexType::iterator it = index.find(key);
+    if (it == index.end())
+    {
+      ++misses;
+      return NULL;
+    }
+
+    ++hits;
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->second;
+  }
+
+  /**
+   * Insert (or replace) the value of the given key, dropping the least
+   * recently used value if the cache is full.
+   *
+   * @param key Key to insert.
+   * @param value Value of the key.
+   */
+  void Insert(const KeyType& key, const ValueType& value)
+  {
+    if (capacity == 0)
+      return;
+
+    typename IndexType::iterator it = index.find(key);
+    if (it != index.end())
+    {
+      it->second->second = value;
+      entries.splice(entries.begin(), entries, it->second);
+      return;
+    }
+
+    if (entries.size() == capacity)
+    {
+      index.erase(entries.back().first);
+      entries.pop_back();
+    }
+
+    entries.push_front(std::make_pair(key, value));
+    index[key] = entries.begin();
+  }
+
+  //! Remove all values from the cache.  The counts of hits and misses are
+  //! kept.
+  void Clear()
+  {
+    entries.clear();
+    index.clear();
+  }
+
+  //! Get the number of values in the cache.
+  size_t Size() const { return entries.size(); }
+  //! Get the maximum number of values in the cache.
+  size_t Capacity() const { return capacity; }
+
+  //! Get the number of calls to Find() which found their key.
+  size_t Hits() const { return hits; }
+  //! Get the number of calls to Find() which did not find their key.
+  size_t Misses() const { return misses; }
+
+ private:
+  //! The type of the list of entries.
+  typedef std::list<std::pair<KeyType, ValueType> > ListType;
+  //! The type of the index from keys to entries.
+  typedef boost::unordered_map<KeyType, typename ListType::iterator>
+      IndexType;
+
+  //! The keys and values, the most recently used first.
+  ListType entries;
+  //! The entry of each key.
+  IndexType index;
+  //! The maximum number of entries.
+  size_t capacity;
+  //! The number of calls to Find() which found their key.
+  size_t hits;
+  //! The number of calls to Find() which did not find their key.
+  size_t misses;
+};
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * @file metrics.cpp
+ *
+ * Implementation of metrics.
+ */
+#include "metrics.hpp"
+#include "cli.hpp"
+
+using namespace mlpack;
+
+/**
+ * Add to the given metric.
+ */
+void Metric::Add(const std::string& name, const double value)
+{
+  std::map<std::string, double>& metrics = CLI::GetSingleton().metrics;
+
+  #pragma omp critical(mlpack_metrics)
+  metrics[name] += value;
+}
+
+/**
+ * Set the given metric.
+ */
+void Metric::Set(const std::string& name, const double value)
+{
+  std::map<std::string, double>& metrics = CLI::GetSingleton().metrics;
+
+  #pragma omp critical(mlpack_metrics)
+  metrics[name] = value;
+}
+
+/**
+ * Get the given metric.
+ */
+double Metric::Get(const std::string& name)
+{
+  const std::map<std::string, double>& metrics = CLI::GetSingleton().metrics;
+
+  double value = 0.0;
+  #pragma omp critical(mlpack_metrics)
+  {
+    std::map<std::string, double>::const_iterator it = metrics.find(name);
+    if (it != metrics.end())
+      value = it->second;
+  }
+
+  return value;
+}
+
+/**
+ * Get every metric.
+ */
+std::map<std::string, double> Metric::GetAll()
+{
+  const std::map<std::string, double>& metrics = CLI::GetSingleton().metrics;
+
+  std::map<std::string, double> copy;
+  #pragma omp critical(mlpack_metrics)
+  copy = metrics;
+
+  return copy;
+}
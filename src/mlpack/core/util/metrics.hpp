@@ -0,0 +1,59 @@
+/**
+ * @file metrics.hpp
+ *
+ * Named statistics of a run of a program, which are written with the timers and
+ * the parameters to the file given with --metrics_file.
+ */
+#ifndef __MLPACK_CORE_UTILITIES_METRICS_HPP
+#define __MLPACK_CORE_UTILITIES_METRICS_HPP
+
+#include <map>
+#include <string>
+
+namespace mlpack {
+
+/**
+ * Metrics are named numbers which describe a run of a program, such as the size
+ * of a dataset or the number of base cases a search computed.  Like timers,
+ * they are collected while the program runs; at the end of a program run with
+ * --metrics_file, they are written to that file (as JSON) with the timers and
+ * the parameters, so that runs can be compared without parsing their logs.
+ * Names use '/' to group related metrics, as timer names do (for instance,
+ * "neighbor_search/base_cases").
+ *
+ * Metrics may be set and added to from any thread.
+ */
+class Metric
+{
+ public:
+  /**
+   * Add the given value to the given metric.  A metric which has not been set
+   * starts at 0, so this can be used to count things over several calls.
+   *
+   * @param name Name of the metric.
+   * @param value Value to add to the metric.
+   */
+  static void Add(const std::string& name, const double value);
+
+  /**
+   * Set the given metric to the given value.
+   *
+   * @param name Name of the metric.
+   * @param value Value of the metric.
+   */
+  static void Set(const std::string& name, const double value);
+
+  /**
+   * Get the value of the given metric, or 0 if it has not been set.
+   *
+   * @param name Name of the metric.
+   */
+  static double Get(const std::string& name);
+
+  //! Get a copy of every metric.
+  static std::map<std::string, double> GetAll();
+};
+
+}; // namespace mlpack
+
+#endif // __MLPACK_CORE_UTILITIES_METRICS_HPP
@@ -0,0 +1,293 @@
+/**
+ * @file model_selection.hpp
+ *
+ * A harness for choosing the parameters of a model by k-fold cross-validation,
+ * which evaluates every configuration on every fold in parallel.
+ */
+#ifndef __MLPACK_CORE_UTIL_MODEL_SELECTION_HPP
+#define __MLPACK_CORE_UTIL_MODEL_SELECTION_HPP
+
+#include <mlpack/prereqs.hpp>
+#include "log.hpp"
+#include "timers.hpp"
+
+namespace mlpack {
+namespace util {
+
+/**
+ * Choose between several configurations of a model (values of k for k-means,
+ * of lambda for LARS, of the rank for CF, and so on) by k-fold
+ * cross-validation.  Every configuration is trained and scored on every fold,
+ * and these fits are independent, so they are run in parallel with OpenMP;
+ * each fit should then run on one thread (nested parallelism is off by
+ * default, so the parallel loops of the methods themselves run serially).
+ *
+ * The points are the columns of a data matrix, optionally with a matrix of
+ * responses (labels, or regression targets) with one column for each point.
+ * The fits do not copy the data: Run() makes one copy of the (shuffled) points
+ * followed by a second copy of them, and then the test set of each fold and its
+ * training set (the points after the test set, wrapping around to the points
+ * before it) are both contiguous ranges of columns, which are given to the
+ * evaluator as aliases.  So the data is held twice no matter how many folds
+ * and configurations there are.  (Since the training set wraps around, its
+ * points are not in the same order as in the data; most methods do not care.)
+ *
+ * The EvaluatorType class trains a model and scores it; it must have the
+ * function
+ *
+ * @code
+ * double Evaluate(const size_t configuration,
+ *                 const arma::mat& trainData,
+ *                 const arma::mat& trainResponses,
+ *                 const arma::mat& testData,
+ *                 const arma::mat& testResponses) const;
+ * @endcode
+ *
+ * which trains the given configuration on the training set and returns its
+ * score on the test set.  It is called from several threads at once, so it
+ * must not change anything shared.  If there are no responses, the response
+ * matrices are empty.  For example, to choose the regularization of ridge
+ * regression by the mean squared error on held-out points:
+ *
+ * @code
+ * class RidgeEvaluator
+ * {
+ *  public:
+ *   RidgeEvaluator(const arma::vec& lambdas) : lambdas(lambdas) { }
+ *
+ *   double Evaluate(const size_t configuration,
+ *                   const arma::mat& trainData,
+ *                   const arma::mat& trainResponses,
+ *                   const arma::mat& testData,
+ *                   const arma::mat& testResponses) const
+ *   {
+ *     LinearRegression lr(trainData, trainResponses.row(0).t(),
+ *         lambdas[configuration]);
+ *     arma::vec predictions;
+ *     lr.Predict(testData, predictions);
+ *     return arma::mean(arma::square(predictions - testResponses.row(0).t()));
+ *   }
+ *
+ *  private:
+ *   const arma::vec& lambdas;
+ * };
+ *
+ * RidgeEvaluator evaluator(lambdas);
+ * ModelSelection<RidgeEvaluator> selection(evaluator, lambdas.n_elem, 10);
+ * selection.Run(predictors, responses);
+ * const double bestLambda = lambdas[selection.Best()];
+ * @endcode
+ *
+ * After Run(), Scores() and Times() hold the score and the time taken (in
+ * seconds) of each configuration on each fold, and the mean and standard
+ * deviation of the scores and the total time of each configuration are printed
+ * to Log::Info.
+ *
+ * @tparam EvaluatorType Type of the class which trains and scores models.
+ */
+template<typename EvaluatorType>
+class ModelSelection
+{
+ public:
+  /**
+   * Set up the cross-validation of the given number of configurations.
+   *
+   * @param evaluator Evaluator which trains and scores the configurations.
+   * @param numConfigurations Number of configurations to evaluate; they are
+   *     numbered from 0 to numConfigurations - 1.
+   * @param folds Number of folds.
+   * @param shuffle If true, the points are shuffled before they are split into
+   *     folds.
+   */
+  ModelSelection(const EvaluatorType& evaluator,
+                 const size_t numConfigurations,
+                 const size_t folds = 5,
+                 const bool shuffle = true) :
+      evaluator(evaluator),
+      numConfigurations(numConfigurations),
+      folds(folds),
+      shuffle(shuffle),
+      threads(0)
+  {
+    if (folds < 2)
+      Log::Fatal << "ModelSelection: there must be at least 2 folds (" << folds
+          << " given)." << std::endl;
+  }
+
+  /**
+   * Evaluate every configuration on every fold of the given data.
+   *
+   * @param data Points to evaluate the configurations on (one per column).
+   * @param responses Responses of the points (one column for each point), or
+   *     an empty matrix if there are none.
+   */
+  void Run(const arma::mat& data, const arma::mat& responses = arma::mat())
+  {
+    if (data.n_cols < folds)
+      Log::Fatal << "ModelSelection::Run(): cannot split " << data.n_cols
+          << " points into " << folds << " folds." << std::endl;
+    if (!responses.is_empty() && responses.n_cols != data.n_cols)
+      Log::Fatal << "ModelSelection::Run(): there are " << responses.n_cols
+          << " responses for " << data.n_cols << " points." << std::endl;
+
+    Timer::Start("model_selection");
+
+    const size_t n = data.n_cols;
+    const arma::uvec order = shuffle ?
+        arma::shuffle(arma::linspace<arma::uvec>(0, n - 1, n)) :
+        arma::linspace<arma::uvec>(0, n - 1, n);
+    Repeat(data, order, repeatedData);
+    Repeat(responses, order, repeatedResponses);
+
+    scores.zeros(numConfigurations, folds);
+    times.zeros(numConfigurations, folds);
+
+    #ifdef _OPENMP
+    const int numThreads = (threads == 0) ? omp_get_max_threads() :
+        (int) threads;
+    #else
+    const int numThreads = 1;
+    #endif
+
+    // Each configuration on each fold is one task; they can take very
+    // different times, so they are handed out one at a time.
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 1)
+    for (omp_size_t task = 0; task < (omp_size_t) (numConfigurations * folds);
+        ++task)
+    {
+      const size_t configuration = task / folds;
+      const size_t fold = task % folds;
+
+      // The test set is [begin, end); the training set follows it.
+      const size_t begin = fold * n / folds;
+      const size_t end = (fold + 1) * n / folds;
+
+      const size_t trainSize = n + begin - end;
+      const size_t testSize = end - begin;
+      const arma::mat trainData(Column(repeatedData, end),
+          repeatedData.n_rows, trainSize, false, true);
+      const arma::mat testData(Column(repeatedData, begin),
+          repeatedData.n_rows, testSize, false, true);
+      const arma::mat trainResponses(Column(repeatedResponses, end),
+          repeatedResponses.n_rows, repeatedResponses.is_empty() ? 0 :
+          trainSize, false, true);
+      const arma::mat testResponses(Column(repeatedResponses, begin),
+          repeatedResponses.n_rows, repeatedResponses.is_empty() ? 0 :
+          testSize, false, true);
+
+      const double start = Timer::Now();
+      scores(configuration, fold) = evaluator.Evaluate(configuration,
+          trainData, trainResponses, testData, testResponses);
+      times(configuration, fold) = Timer::Now() - start;
+    }
+
+    Timer::Stop("model_selection");
+
+    // The copies of the data are not needed anymore.
+    repeatedData.reset();
+    repeatedResponses.reset();
+
+    for (size_t c = 0; c < numConfigurations; ++c)
+    {
+      Log::Info << "Configuration " << c << ": mean score "
+          << arma::mean(scores.row(c)) << " (standard deviation "
+          << arma::stddev(scores.row(c)) << "), " << arma::accu(times.row(c))
+          << "s." << std::endl;
+    }
+  }
+
+  /**
+   * Get the configuration with the best mean score over the folds of the last
+   * call to Run().
+   *
+   * @param higherIsBetter If true, the best score is the highest (as for an
+   *     accuracy); otherwise it is the lowest (as for an error).
+   */
+  size_t Best(const bool higherIsBetter = false) const
+  {
+    const arma::vec means = MeanScores();
+    arma::uword best;
+    if (higherIsBetter)
+      means.max(best);
+    else
+      means.min(best);
+
+    return (size_t) best;
+  }
+
+  //! Get the mean score of each configuration over the folds.
+  arma::vec MeanScores() const { return arma::mean(scores, 1); }
+
+  //! Get the score of each configuration (rows) on each fold (columns).
+  const arma::mat& Scores() const { return scores; }
+  //! Get the time, in seconds, of each configuration (rows) on each fold
+  //! (columns).
+  const arma::mat& Times() const { return times; }
+
+  //! Get the number of configurations.
+  size_t NumConfigurations() const { return numConfigurations; }
+  //! Get the number of folds.
+  size_t Folds() const { return folds; }
+
+  //! Get the number of threads to run fits on (0 means the OpenMP default).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads to run fits on (0 means the OpenMP default).
+  size_t& Threads() { return threads; }
+
+ private:
+  /**
+   * Fill out with the columns of in in the given order, followed by the same
+   * columns again.  An empty matrix stays empty.
+   */
+  static void Repeat(const arma::mat& in,
+                     const arma::uvec& order,
+                     arma::mat& out)
+  {
+    if (in.is_empty())
+    {
+      out.reset();
+      return;
+    }
+
+    const size_t n = in.n_cols;
+    out.set_size(in.n_rows, 2 * n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      out.col(i) = in.col(order[i]);
+      out.col(n + i) = out.col(i);
+    }
+  }
+
+  //! Get a pointer to the given column of the given matrix, to make an alias
+  //! of it (or NULL, if the matrix is empty).
+  static double* Column(const arma::mat& m, const size_t col)
+  {
+    return m.is_empty() ? NULL : const_cast<double*>(m.colptr(col));
+  }
+
+  //! The evaluator which trains and scores the configurations.
+  const EvaluatorType& evaluator;
+  //! The number of configurations.
+  size_t numConfigurations;
+  //! The number of folds.
+  size_t folds;
+  //! Whether to shuffle the points before splitting them into folds.
+  bool shuffle;
+  //! The number of threads to run fits on (0 means the OpenMP default).
+  size_t threads;
+
+  //! The score of each configuration on each fold.
+  arma::mat scores;
+  //! The time of each configuration on each fold.
+  arma::mat times;
+
+  //! The shuffled points, twice over (only held during Run()).
+  arma::mat repeatedData;
+  //! The shuffled responses, twice over (only held during Run()).
+  arma::mat repeatedResponses;
+};
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * @file numa.cpp
+ *
+ * Implementation of the NUMA utilities.  The NUMA nodes are found in sysfs, so
+ * that mlpack does not need to depend on libnuma.
+ */
+#include "numa.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#ifdef __linux__
+  #include <dirent.h>
+  #include <sched.h>
+#endif
+
+using namespace mlpack;
+
+#ifdef __linux__
+/**
+ * Get one more than the largest number in the names of the entries "node<n>"
+ * of the given directory, or 0 if there are none (or the directory cannot be
+ * read).
+ */
+static size_t NodeEntries(const std::string& path)
+{
+  DIR* dir = opendir(path.c_str());
+  if (dir == NULL)
+    return 0;
+
+  size_t nodes = 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (strncmp(entry->d_name, "node", 4) != 0 ||
+        !isdigit((unsigned char) entry->d_name[4]))
+      continue;
+
+    const size_t node = strtoul(entry->d_name + 4, NULL, 10);
+    nodes = std::max(nodes, node + 1);
+  }
+
+  closedir(dir);
+  return nodes;
+}
+#endif
+
+size_t util::NUMANodes()
+{
+#ifdef __linux__
+  const size_t nodes = NodeEntries("/sys/devices/system/node");
+  return (nodes == 0) ? 1 : nodes;
+#else
+  return 1;
+#endif
+}
+
+size_t util::CurrentNUMANode()
+{
+#if defined(__linux__) && defined(_GNU_SOURCE)
+  const int cpu = sched_getcpu();
+  if (cpu < 0)
+    return 0;
+
+  // The directory of each CPU holds a link named after the node it belongs to.
+  std::ostringstream path;
+  path << "/sys/devices/system/cpu/cpu" << cpu;
+  const size_t nodes = NodeEntries(path.str());
+  return (nodes == 0) ? 0 : nodes - 1;
+#else
+  return 0;
+#endif
+}
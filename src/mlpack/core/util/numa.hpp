@@ -0,0 +1,68 @@
+/**
+ * @file numa.hpp
+ *
+ * Utilities for placing data in the memory of the NUMA nodes which use it.
+ */
+#ifndef __MLPACK_CORE_UTIL_NUMA_HPP
+#define __MLPACK_CORE_UTIL_NUMA_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * Get the number of NUMA nodes of this machine (more precisely, one more than
+ * the largest node number, since nodes may be numbered with gaps).  This is 1
+ * if the machine is not a NUMA machine, or if the nodes cannot be found (they
+ * are only found on Linux).
+ */
+size_t NUMANodes();
+
+/**
+ * Get the NUMA node of the CPU which the calling thread is running on, or 0 if
+ * it cannot be found.  The thread may be moved to another CPU at any time, so
+ * this is a hint; it is exact if the threads are bound to CPUs (for instance,
+ * with OMP_PROC_BIND=true).  This reads from sysfs, so it should not be called
+ * in an inner loop.
+ */
+size_t CurrentNUMANode();
+
+/**
+ * Copy a matrix into newly allocated memory, with the columns split into
+ * contiguous blocks which are copied by different OpenMP threads.  The
+ * operating system places each page of memory on the NUMA node of the thread
+ * which first writes to it, so the copy is spread over the nodes of the
+ * threads instead of being placed on the node of the calling thread (as a
+ * plain copy would be).  Small matrices are copied by the calling thread.
+ *
+ * @param in Matrix to copy.
+ * @param out Matrix to copy into; its old memory is released.
+ */
+template<typename eT>
+void FirstTouchCopy(const arma::Mat<eT>& in, arma::Mat<eT>& out)
+{
+  // The memory of out must be new; pages which were already written stay on
+  // the node where they are.
+  out.reset();
+  out.set_size(in.n_rows, in.n_cols);
+
+  #pragma omp parallel for schedule(static) if (in.n_elem >= 262144)
+  for (omp_size_t i = 0; i < (omp_size_t) in.n_cols; ++i)
+    std::copy(in.colptr(i), in.colptr(i) + in.n_rows, out.colptr(i));
+}
+
+/**
+ * Copy any other kind of matrix (such as a sparse matrix) with its own copy
+ * operator.
+ */
+template<typename MatType>
+void FirstTouchCopy(const MatType& in, MatType& out)
+{
+  out = in;
+}
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
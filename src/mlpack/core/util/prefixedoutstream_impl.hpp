@@ -18,7 +18,9 @@ namespace util {
 template<typename T>
 PrefixedOutStream& PrefixedOutStream::operator<<(const T& s)
 {
-  CallBaseLogic<T>(s);
+  // Don't call ToString() for a stream that won't print it.
+  if (!ignoreInput || fatal)
+    CallBaseLogic<T>(s);
   return *this;
 }
 
@@ -62,6 +64,12 @@ void PrefixedOutStream::CallBaseLogic(const T& s,
 template<typename T>
 void PrefixedOutStream::BaseLogic(const T& val)
 {
+  // A muted stream prints nothing, so there is no need to convert the value to
+  // a string (which may be expensive in tight loops).  Fatal streams still need
+  // to find newlines, though, so they can terminate.
+  if (ignoreInput && !fatal)
+    return;
+
   // We will use this to track whether or not we need to terminate at the end of
   // this call (only for streams which terminate after a newline).
   bool newlined = false;
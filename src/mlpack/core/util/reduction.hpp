@@ -0,0 +1,166 @@
+/**
+ * @file reduction.hpp
+ *
+ * Helpers for parallel sums whose results do not depend on the number of
+ * threads.
+ */
+#ifndef __MLPACK_CORE_UTIL_REDUCTION_HPP
+#define __MLPACK_CORE_UTIL_REDUCTION_HPP
+
+#include <mlpack/prereqs.hpp>
+
+namespace mlpack {
+namespace util {
+
+//! The largest number of blocks that ReductionBlocks() splits items into.
+const size_t MaxReductionBlocks = 64;
+
+/**
+ * Get the number of blocks to split n items into for a parallel sum.  Floating
+ * point addition is not associative, so a sum depends on how it is split and
+ * in what order the parts are added.  The number of blocks given here depends
+ * only on n, so if each block is summed in order (by whichever thread) and the
+ * sums of the blocks are added with TreeReduce(), the result is the same, to
+ * the bit, with any number of threads.
+ *
+ * Block b holds the items [b * n / blocks, (b + 1) * n / blocks).  There are
+ * at most MaxReductionBlocks blocks, which bounds the memory used for their
+ * partial sums, and each block has at least minBlockSize items (unless there
+ * are fewer items), so small sums are not split into blocks too small to be
+ * worth a thread.
+ *
+ * @param n Number of items to sum.
+ * @param minBlockSize Smallest number of items to give a block.
+ */
+inline size_t ReductionBlocks(const size_t n, const size_t minBlockSize = 1024)
+{
+  const size_t blocks = (n + minBlockSize - 1) / minBlockSize;
+  return std::max(std::min(blocks, MaxReductionBlocks), (size_t) 1);
+}
+
+/**
+ * Add up the partial sums of the blocks of a parallel sum in a fixed order,
+ * which is a balanced binary tree: partials[i] += partials[i + 1] for each even
+ * i, then partials[i] += partials[i + 2] for each multiple i of 4, and so on.
+ * The sum is left in partials[0]; the other partial sums are overwritten.
+ * Pairwise summation also has a smaller rounding error than adding the partial
+ * sums one after another.
+ *
+ * T can be any type with operator+= (a number, or an Armadillo object).
+ *
+ * @param partials Partial sums to add up; must not be empty.
+ */
+template<typename T>
+void TreeReduce(std::vector<T>& partials)
+{
+  for (size_t stride = 1; stride < partials.size(); stride *= 2)
+    for (size_t i = 0; i + stride < partials.size(); i += 2 * stride)
+      partials[i] += partials[i + stride];
+}
+
+/**
+ * Add up the partial sums of the blocks of a parallel sum as the blocks are
+ * finished, in the same order as TreeReduce() (so the result is the same, to
+ * the bit), but without keeping every partial sum until the end.  When a block
+ * is finished, its partial sum is added to its neighbor in the tree of
+ * TreeReduce() if that neighbor is finished too, and then freed; otherwise it
+ * is left for the neighbor to add when it finishes.  So if blocks are started
+ * in order (as with a dynamic schedule), only about as many partial sums as
+ * there are threads, plus the log of the number of blocks, are held at once,
+ * instead of one for every block.
+ *
+ * @code
+ * std::vector<arma::mat> sums(blocks);
+ * util::TreeReducer<arma::mat> reducer(sums);
+ *
+ * #pragma omp parallel for schedule(dynamic)
+ * for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+ * {
+ *   sums[b].zeros(d, k);
+ *   // ... sum block b into sums[b] ...
+ *   reducer.Finish(b);
+ * }
+ * // The sum is now in sums[0].
+ * @endcode
+ *
+ * T can be any type with operator+= and a default constructor that holds (or
+ * frees) nothing.
+ */
+template<typename T>
+class TreeReducer
+{
+ public:
+  /**
+   * Prepare to add up the given partial sums; they must not be touched, other
+   * than to sum a block into its own partial sum before Finish() is called for
+   * the block.
+   *
+   * @param partials Partial sums to add up; must not be empty.
+   */
+  TreeReducer(std::vector<T>& partials) :
+      partials(partials),
+      finished(partials.size(), 0)
+  { /* Nothing to do. */ }
+
+  /**
+   * Mark the given block as finished and add its partial sum to as many
+   * finished neighbors as possible.  This may be called from any thread.  Once
+   * every block is finished, the sum is in partials[0] and the other partial
+   * sums are freed.
+   *
+   * @param block Index of the finished block.
+   */
+  void Finish(const size_t block)
+  {
+    // partials[index] always holds the sum of the blocks
+    // [index, index + stride), and TreeReduce() adds it to (or adds to it) the
+    // partial sum of the other half of the range [index, index + 2 * stride)
+    // rounded down to a multiple of 2 * stride.
+    size_t index = block;
+    for (size_t stride = 1; stride < partials.size(); stride *= 2)
+    {
+      size_t left, right;
+      if (index % (2 * stride) == 0)
+      {
+        left = index;
+        right = index + stride;
+        if (right >= partials.size())
+          continue; // Nothing is added to this partial sum at this level.
+      }
+      else
+      {
+        left = index - stride;
+        right = index;
+      }
+
+      // Whichever of the two halves finishes last adds them.
+      const size_t other = (index == left) ? right : left;
+      bool add;
+      #pragma omp critical(TreeReducerFinish)
+      {
+        add = (finished[other] == stride);
+        if (!add)
+          finished[index] = stride;
+      }
+
+      if (!add)
+        return;
+
+      partials[left] += partials[right];
+      partials[right] = T();
+      index = left;
+    }
+  }
+
+ private:
+  //! The partial sums.
+  std::vector<T>& partials;
+  //! For each partial sum, the number of blocks it held when it was left for
+  //! its neighbor to add (or 0).
+  std::vector<size_t> finished;
+};
+
+}; // namespace util
+}; // namespace mlpack
+
+#endif
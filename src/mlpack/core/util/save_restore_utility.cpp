@@ -4,15 +4,54 @@
  * @author Michael Fox
  *
  * The SaveRestoreUtility provides helper functions in saving and
- *   restoring models.  The current output file type is XML.
+ *   restoring models.  Models are stored as XML, or as a compact binary
+ *   archive when the filename ends in ".bin".
  */
 #include <mlpack/core.hpp>
+#include <algorithm>
+#include <fstream>
 
 using namespace mlpack;
 using namespace mlpack::util;
 
+namespace {
+
+//! The first bytes of a binary archive; the last one is the format version.
+const char archiveMagic[8] = { 'M', 'L', 'P', 'A', 'C', 'K', 'S', '1' };
+
+//! Convert a matrix to the string form used in XML files.
+std::string MatrixToString(const arma::mat& mat)
+{
+  std::ostringstream output;
+  size_t columns = mat.n_cols;
+  size_t rows = mat.n_rows;
+  for (size_t r = 0; r < rows; ++r)
+  {
+    for (size_t c = 0; c < columns - 1; ++c)
+    {
+      output << std::setprecision(15) << mat(r, c) << ",";
+    }
+    output << std::setprecision(15) << mat(r, columns - 1) << std::endl;
+  }
+  return output.str();
+}
+
+} // anonymous namespace
+
 bool SaveRestoreUtility::ReadFile(const std::string& filename)
 {
+  // Binary archives are recognized by their header.
+  {
+    std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+    char magic[sizeof(archiveMagic)];
+    if (stream.read(magic, sizeof(magic)) &&
+        std::equal(magic, magic + sizeof(magic), archiveMagic))
+    {
+      ReadArchive(stream);
+      return true;
+    }
+  }
+
   xmlDocPtr xmlDocTree = NULL;
   if (NULL == (xmlDocTree = xmlReadFile(filename.c_str(), NULL, 0)))
   {
@@ -28,6 +67,7 @@ bool SaveRestoreUtility::ReadFile(const std::string& filename)
 void SaveRestoreUtility::ReadFile(xmlNode* n)
 {
   parameters.clear();
+  matrices.clear();
   xmlNodePtr current = NULL;
   for (current = n; current; current = current->next)
   {
@@ -49,6 +89,19 @@ void SaveRestoreUtility::ReadFile(xmlNode* n)
 
 bool SaveRestoreUtility::WriteFile(const std::string& filename)
 {
+  const std::string extension = ".bin";
+  if (filename.size() >= extension.size() && filename.compare(filename.size()
+      - extension.size(), extension.size(), extension) == 0)
+  {
+    std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!stream.is_open())
+      return false;
+
+    stream.write(archiveMagic, sizeof(archiveMagic));
+    WriteArchive(stream);
+    return stream.good();
+  }
+
   bool success = false;
   xmlDocPtr xmlDocTree = xmlNewDoc(BAD_CAST "1.0");
   xmlNodePtr root = xmlNewNode(NULL, BAD_CAST "root");
@@ -64,8 +117,14 @@ bool SaveRestoreUtility::WriteFile(const std::string& filename)
 
 void SaveRestoreUtility::WriteFile(xmlNode* n)
 {
+  // Matrices are only converted to strings now.
+  std::map<std::string, std::string> strings(parameters);
+  for (std::map<std::string, arma::mat>::const_iterator it = matrices.begin();
+       it != matrices.end(); ++it)
+    strings[it->first] = MatrixToString(it->second);
+
   for (std::map<std::string, std::string>::reverse_iterator it =
-	    parameters.rbegin(); it != parameters.rend(); ++it)
+	    strings.rbegin(); it != strings.rend(); ++it)
   {
     xmlNewChild(n, NULL, BAD_CAST(*it).first.c_str(),
         BAD_CAST(*it).second.c_str());
@@ -79,9 +138,74 @@ void SaveRestoreUtility::WriteFile(xmlNode* n)
   }
 }
 
+void SaveRestoreUtility::WriteArchive(std::ostream& stream) const
+{
+  util::WriteBinary(stream, (size_t) parameters.size());
+  for (std::map<std::string, std::string>::const_iterator it =
+       parameters.begin(); it != parameters.end(); ++it)
+  {
+    util::WriteBinary(stream, it->first);
+    util::WriteBinary(stream, it->second);
+  }
+
+  util::WriteBinary(stream, (size_t) matrices.size());
+  for (std::map<std::string, arma::mat>::const_iterator it = matrices.begin();
+       it != matrices.end(); ++it)
+  {
+    util::WriteBinary(stream, it->first);
+    util::WriteBinary(stream, it->second);
+  }
+
+  util::WriteBinary(stream, (size_t) children.size());
+  for (std::map<std::string, SaveRestoreUtility>::const_iterator it =
+       children.begin(); it != children.end(); ++it)
+  {
+    util::WriteBinary(stream, it->first);
+    it->second.WriteArchive(stream);
+  }
+}
+
+void SaveRestoreUtility::ReadArchive(std::istream& stream)
+{
+  parameters.clear();
+  matrices.clear();
+  children.clear();
+
+  size_t count;
+  std::string name;
+
+  util::ReadBinary(stream, count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    util::ReadBinary(stream, name);
+    util::ReadBinary(stream, parameters[name]);
+  }
+
+  // The matrix elements are read straight into the matrix memory.
+  util::ReadBinary(stream, count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    util::ReadBinary(stream, name);
+    util::ReadBinary(stream, matrices[name]);
+  }
+
+  util::ReadBinary(stream, count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    util::ReadBinary(stream, name);
+    children[name].ReadArchive(stream);
+  }
+}
+
 arma::mat& SaveRestoreUtility::LoadParameter(arma::mat& matrix,
                                              const std::string& name) const
 {
+  // Matrices saved with SaveParameter() or read from a binary archive need no
+  // parsing.
+  std::map<std::string, arma::mat>::const_iterator matIt = matrices.find(name);
+  if (matIt != matrices.end())
+    return matrix = matIt->second;
+
   std::map<std::string, std::string>::const_iterator it = parameters.find(name);
   if (it != parameters.end())
   {
@@ -177,23 +301,14 @@ void SaveRestoreUtility::SaveParameter(const char c, const std::string& name)
   std::ostringstream output;
   output << temp;
   parameters[name] = output.str();
+  matrices.erase(name);
 }
 
 void SaveRestoreUtility::SaveParameter(const arma::mat& mat,
                                        const std::string& name)
 {
-  std::ostringstream output;
-  size_t columns = mat.n_cols;
-  size_t rows = mat.n_rows;
-  for (size_t r = 0; r < rows; ++r)
-  {
-    for (size_t c = 0; c < columns - 1; ++c)
-    {
-      output << std::setprecision(15) << mat(r, c) << ",";
-    }
-    output << std::setprecision(15) << mat(r, columns - 1) << std::endl;
-  }
-  parameters[name] = output.str();
+  matrices[name] = mat;
+  parameters.erase(name);
 }
 
 // Special template specializations for vectors.
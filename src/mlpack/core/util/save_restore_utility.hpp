@@ -3,7 +3,8 @@
  * @author Neil Slagle
  *
  * The SaveRestoreUtility provides helper functions in saving and
- *   restoring models.  The current output file type is XML.
+ *   restoring models.  Models are stored as XML, or as a compact binary
+ *   archive when the filename ends in ".bin".
  *
  * @experimental
  */
@@ -32,6 +33,13 @@ class SaveRestoreUtility
    */
   std::map<std::string, std::string> parameters;
 
+  /**
+   * matrices contains a list of names and matrices.  These are not converted
+   * to strings unless they are written to XML, so that binary archives can
+   * store them as raw blocks.
+   */
+  std::map<std::string, arma::mat> matrices;
+
   /**
    * children contains a list of names in string format and child
    * models in the model hierarchy in SaveRestoreUtility format
@@ -49,15 +57,26 @@ class SaveRestoreUtility
   ~SaveRestoreUtility() { parameters.clear(); }
 
   /**
-   * ReadFile reads an XML tree from a file.
+   * ReadFile reads a model from a file.  Binary archives written by
+   * WriteFile() are detected from their header; any other file is read as XML.
    */
   bool ReadFile(const std::string& filename);
 
   /**
-   * WriteFile writes the XML tree to a file.
+   * WriteFile writes the model to a file.  If the filename ends in ".bin", a
+   * binary archive is written, in which matrices are stored as raw blocks that
+   * are read back without any parsing; otherwise the model is written as XML.
+   * Binary archives are only meant to be read on the same kind of machine that
+   * wrote them.
    */
   bool WriteFile(const std::string& filename);
 
+  /**
+   * Return whether a parameter with the given name is in the parameters map.
+   */
+  bool HasParameter(const std::string& name) const
+  { return parameters.count(name) > 0 || matrices.count(name) > 0; }
+
   /**
    * LoadParameter loads a parameter from the parameters map.
    */
@@ -135,6 +154,18 @@ class SaveRestoreUtility
    */
   void ReadFile(xmlNode* n);
 
+  /**
+   * WriteArchive writes the parameters, matrices and children (recursively) to
+   * a binary stream.
+   */
+  void WriteArchive(std::ostream& stream) const;
+
+  /**
+   * ReadArchive reads the parameters, matrices and children (recursively) from
+   * a binary stream written by WriteArchive().
+   */
+  void ReadArchive(std::istream& stream);
+
 };
 
 //! Specialization for arma::vec.
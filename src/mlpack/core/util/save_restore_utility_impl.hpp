@@ -71,6 +71,7 @@ void SaveRestoreUtility::SaveParameter(const T& t, const std::string& name)
   // store this as an actual binary number.
   output << std::setprecision(15) << t;
   parameters[name] = output.str();
+  matrices.erase(name);
 }
 
 template<typename T>
@@ -85,6 +86,7 @@ void SaveRestoreUtility::SaveParameter(const std::vector<T>& t,
   std::string vectorAsStr = output.str();
   vectorAsStr.erase(vectorAsStr.length() - 1);
   parameters[name] = vectorAsStr;
+  matrices.erase(name);
 }
 
     
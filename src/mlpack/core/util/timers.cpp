@@ -9,22 +9,86 @@
 #include "cli.hpp"
 #include "log.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <map>
 #include <string>
+#include <fstream>
+#include <sstream>
+
+#ifdef MLPACK_HAS_PERF_EVENT
+  #include <linux/perf_event.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
 
 using namespace mlpack;
 
-// On Windows machines, we need to define timersub.
-#ifdef _WIN32
-inline void timersub(const timeval* tvp, const timeval* uvp, timeval* vvp)
+// The number of nanoseconds in a second.
+static const uint64_t nsPerSecond = 1000000000;
+
+// Each thread keeps its timers in its own storage, so that starting and
+// stopping timers doesn't need any locking.  The owner is the id of the Timers
+// object the storage belongs to; a thread whose storage belongs to some other
+// (possibly destroyed) Timers object makes new storage.
+static void* localTimers = NULL;
+static size_t localOwner = 0;
+#pragma omp threadprivate(localTimers, localOwner)
+
+// The id to give to the next Timers object.
+static size_t nextTimersId = 1;
+
+// Reset the highest resident memory of the process to its current resident
+// memory, so that the next reading of it only covers the time after this.  This
+// needs Linux 4.0 or later; returns false if it is not possible.
+static bool ResetPeakMemory()
 {
-  vvp->tv_sec = tvp->tv_sec - uvp->tv_sec;
-  vvp->tv_usec = tvp->tv_usec - uvp->tv_usec;
-  if (vvp->tv_usec < 0)
-  {
-     --vvp->tv_sec;
-     vvp->tv_usec += 1000000;
-  }
+#ifdef __linux__
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  if (!clearRefs.is_open())
+    return false;
+
+  clearRefs << "5";
+  clearRefs.close();
+  return !clearRefs.fail();
+#else
+  return false;
+#endif
+}
+
+// The names of the hardware counters, as they are returned by
+// Timer::GetCounters() and saved in the metrics file, and as they are printed.
+static const char* counterNames[] = { "cycles", "instructions", "llc_misses",
+    "branch_misses" };
+static const char* counterDescriptions[] = { "cycles", "instructions",
+    "LLC misses", "branch misses" };
+
+#ifdef MLPACK_HAS_PERF_EVENT
+// The perf_event configuration of each hardware counter.
+static const uint64_t counterConfigs[] = { PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES };
+
+// Open a counter of the given hardware event for the calling process (in user
+// space only, which unprivileged users may count), which also counts the
+// threads created later.  Returns -1 on failure.
+static int OpenCounter(const uint64_t config)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // The times are read so that the count can be scaled if the kernel had to
+  // share the hardware counters with other events.
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
 }
 #endif
 
@@ -52,20 +116,525 @@ timeval Timer::Get(const std::string& name)
   return CLI::GetSingleton().timer.GetTimer(name);
 }
 
+/**
+ * Get the given timer in nanoseconds.
+ */
+uint64_t Timer::GetNanoseconds(const std::string& name)
+{
+  return CLI::GetSingleton().timer.GetTimerNanoseconds(name);
+}
+
+/**
+ * Get the number of threads which used the given timer.
+ */
+size_t Timer::GetThreads(const std::string& name)
+{
+  return CLI::GetSingleton().timer.GetTimerThreads(name);
+}
+
+/**
+ * Get the parent of the given timer.
+ */
+std::string Timer::Parent(const std::string& name)
+{
+  return CLI::GetSingleton().timer.GetParent(name);
+}
+
+/**
+ * Get the current time in seconds.
+ */
+double Timer::Now()
+{
+  return Timers::GetTimeNanoseconds() / 1e9;
+}
+
+/**
+ * Enable or disable memory tracking.
+ */
+void Timer::EnableMemoryTracking(const bool enable)
+{
+  CLI::GetSingleton().timer.EnableMemoryTracking(enable);
+}
+
+/**
+ * Get the peak memory of the given timer.
+ */
+size_t Timer::GetPeakMemory(const std::string& name)
+{
+  return CLI::GetSingleton().timer.GetTimerPeakMemory(name);
+}
+
+/**
+ * Get the current resident memory.
+ */
+size_t Timer::ResidentMemory()
+{
+  size_t current, peak;
+  Timers::ReadMemory(current, peak);
+  return current;
+}
+
+/**
+ * Get the highest resident memory so far.
+ */
+size_t Timer::PeakResidentMemory()
+{
+  return CLI::GetSingleton().timer.GetPeakMemory();
+}
+
+/**
+ * Enable or disable hardware counters.
+ */
+void Timer::EnableCounters(const bool enable)
+{
+  CLI::GetSingleton().timer.EnableCounters(enable);
+}
+
+/**
+ * Get the hardware counters of the given timer.
+ */
+std::map<std::string, uint64_t> Timer::GetCounters(const std::string& name)
+{
+  return CLI::GetSingleton().timer.GetTimerCounters(name);
+}
+
+Timers::Timers() :
+    trackMemory(false),
+    processPeak(0),
+    lastPeak(0),
+    peakReset(false),
+    trackCounters(false)
+{
+  #pragma omp critical(mlpack_timers)
+  id = nextTimersId++;
+
+  for (size_t i = 0; i < NumCounters; ++i)
+    counterFds[i] = -1;
+}
+
+Timers::~Timers()
+{
+  for (size_t i = 0; i < threadTimers.size(); ++i)
+    delete threadTimers[i];
+
+#ifdef MLPACK_HAS_PERF_EVENT
+  for (size_t i = 0; i < NumCounters; ++i)
+    if (counterFds[i] >= 0)
+      close(counterFds[i]);
+#endif
+}
+
 std::map<std::string, timeval>& Timers::GetAllTimers()
 {
+  Merge();
   return timers;
 }
 
 timeval Timers::GetTimer(const std::string& timerName)
 {
-  std::string name(timerName);
-  return timers[name];
+  Merge();
+  return timers[timerName];
+}
+
+uint64_t Timers::GetTimerNanoseconds(const std::string& timerName)
+{
+  Merge();
+  const timeval& t = timers[timerName];
+  return (uint64_t) t.tv_sec * nsPerSecond + (uint64_t) t.tv_usec * 1000;
+}
+
+std::string Timers::GetParent(const std::string& timerName)
+{
+  Merge();
+  std::map<std::string, std::string>::const_iterator it =
+      parents.find(timerName);
+  return (it == parents.end()) ? std::string() : it->second;
+}
+
+size_t Timers::GetTimerThreads(const std::string& timerName)
+{
+  Merge();
+  std::map<std::string, size_t>::const_iterator it =
+      threadCounts.find(timerName);
+  return (it == threadCounts.end()) ? 0 : it->second;
+}
+
+Timers::ThreadTimers& Timers::LocalTimers()
+{
+  if ((localTimers == NULL) || (localOwner != id))
+  {
+    ThreadTimers* local = new ThreadTimers();
+
+    #pragma omp critical(mlpack_timers)
+    threadTimers.push_back(local);
+
+    localTimers = local;
+    localOwner = id;
+  }
+
+  return *static_cast<ThreadTimers*>(localTimers);
+}
+
+void Timers::Merge()
+{
+  const uint64_t now = GetTimeNanoseconds();
+
+  // The timers of each thread are read without locking, since starting and
+  // stopping timers doesn't lock them; so this must only be called when no
+  // other thread is using timers (for instance, after a parallel region has
+  // joined).  Only the list of threads is locked, since a new thread may add
+  // itself to it.
+  std::vector<ThreadTimers*> allTimers;
+  #pragma omp critical(mlpack_timers)
+  allTimers = threadTimers;
+
+  std::map<std::string, uint64_t> totals;
+  parents.clear();
+  threadCounts.clear();
+  for (size_t i = 0; i < allTimers.size(); ++i)
+  {
+    const ThreadTimers& local = *allTimers[i];
+
+    std::map<std::string, uint64_t>::const_iterator it;
+    for (it = local.totals.begin(); it != local.totals.end(); ++it)
+    {
+      totals[it->first] += it->second;
+      ++threadCounts[it->first];
+    }
+
+    // Timers which are still running count up to now.
+    for (it = local.starts.begin(); it != local.starts.end(); ++it)
+    {
+      totals[it->first] += now - it->second;
+      if (local.totals.count(it->first) == 0)
+        ++threadCounts[it->first];
+    }
+
+    // The first thread to use a timer decides its parent.  A thread can't
+    // create a cycle on its own, because a timer's parent is always started
+    // before it, but two threads could nest the same timers differently.
+    std::map<std::string, std::string>::const_iterator p;
+    for (p = local.parents.begin(); p != local.parents.end(); ++p)
+    {
+      if (parents.count(p->first) == 1)
+        continue;
+
+      std::string ancestor = p->second;
+      while (!ancestor.empty() && ancestor != p->first)
+      {
+        std::map<std::string, std::string>::const_iterator a =
+            parents.find(ancestor);
+        ancestor = (a == parents.end()) ? std::string() : a->second;
+      }
+
+      parents[p->first] = ancestor.empty() ? p->second : std::string();
+    }
+  }
+
+  timers.clear();
+  std::map<std::string, uint64_t>::const_iterator it;
+  for (it = totals.begin(); it != totals.end(); ++it)
+  {
+    timeval t;
+    t.tv_sec = (long) (it->second / nsPerSecond);
+    t.tv_usec = (long) ((it->second % nsPerSecond) / 1000);
+    timers[it->first] = t;
+  }
+}
+
+void Timers::EnableMemoryTracking(const bool enable)
+{
+  #pragma omp critical(mlpack_timers_memory)
+  {
+    if (enable && !trackMemory)
+    {
+      // The timers running on this thread are tracked from now on.
+      const size_t current = UpdateMemoryPeaks();
+      const std::vector<std::string>& active = LocalTimers().active;
+      for (size_t i = 0; i < active.size(); ++i)
+      {
+        std::pair<size_t, size_t>& running = memoryActive[active[i]];
+        if (running.first++ == 0)
+          running.second = current;
+      }
+    }
+    else if (!enable)
+    {
+      memoryActive.clear();
+    }
+
+    trackMemory = enable;
+  }
+}
+
+size_t Timers::GetTimerPeakMemory(const std::string& timerName)
+{
+  size_t peak = 0;
+  #pragma omp critical(mlpack_timers_memory)
+  {
+    std::map<std::string, size_t>::const_iterator it =
+        memoryPeaks.find(timerName);
+    if (it != memoryPeaks.end())
+      peak = it->second;
+
+    // A running timer has reached at least the memory of its last reading.
+    std::map<std::string, std::pair<size_t, size_t> >::const_iterator a =
+        memoryActive.find(timerName);
+    if (a != memoryActive.end())
+      peak = std::max(peak, a->second.second);
+  }
+
+  return peak;
+}
+
+size_t Timers::GetPeakMemory()
+{
+  size_t peak = 0;
+  #pragma omp critical(mlpack_timers_memory)
+  {
+    size_t current;
+    ReadMemory(current, peak);
+    peak = std::max(peak, processPeak);
+  }
+
+  return peak;
+}
+
+void Timers::ReadMemory(size_t& current, size_t& peak)
+{
+  current = 0;
+  peak = 0;
+
+#ifdef __linux__
+  // Each line is a name, a value and its unit ("kB" for these two).
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+  {
+    size_t* value = NULL;
+    if (line.compare(0, 6, "VmRSS:") == 0)
+      value = &current;
+    else if (line.compare(0, 6, "VmHWM:") == 0)
+      value = &peak;
+    else
+      continue;
+
+    std::istringstream stream(line.substr(6));
+    size_t kilobytes = 0;
+    stream >> kilobytes;
+    *value = kilobytes * 1024;
+  }
+#endif
+}
+
+size_t Timers::UpdateMemoryPeaks()
+{
+  size_t current, peak;
+  ReadMemory(current, peak);
+  processPeak = std::max(processPeak, std::max(current, peak));
+
+  // If the highest memory could not be reset last time, it is the highest
+  // since the program started, so it was only reached while the running
+  // timers ran if it has grown since the last reading.
+  size_t seen = current;
+  if (peakReset || peak > lastPeak)
+    seen = std::max(seen, peak);
+
+  std::map<std::string, std::pair<size_t, size_t> >::iterator it;
+  for (it = memoryActive.begin(); it != memoryActive.end(); ++it)
+    it->second.second = std::max(it->second.second, seen);
+
+  peakReset = ResetPeakMemory();
+  lastPeak = peakReset ? current : peak;
+  return current;
+}
+
+void Timers::EnableCounters(const bool enable)
+{
+  if (enable && !trackCounters)
+  {
+    if (!OpenCounters())
+    {
+      Log::Warn << "Hardware performance counters are not available";
+#ifdef MLPACK_HAS_PERF_EVENT
+      Log::Warn << " (" << strerror(errno) << "; see "
+          << "/proc/sys/kernel/perf_event_paranoid)";
+#endif
+      Log::Warn << "." << std::endl;
+      return;
+    }
+
+    // The timers running on this thread are counted from now on.
+    ThreadTimers& local = LocalTimers();
+    std::vector<uint64_t> values;
+    ReadCounters(values);
+    for (size_t i = 0; i < local.active.size(); ++i)
+      local.counterStarts[local.active[i]] = values;
+  }
+
+  trackCounters = enable;
+}
+
+bool Timers::OpenCounters()
+{
+  bool opened = false;
+#ifdef MLPACK_HAS_PERF_EVENT
+  for (size_t i = 0; i < NumCounters; ++i)
+  {
+    if (counterFds[i] < 0)
+      counterFds[i] = OpenCounter(counterConfigs[i]);
+    opened |= (counterFds[i] >= 0);
+  }
+#endif
+  return opened;
+}
+
+void Timers::ReadCounters(std::vector<uint64_t>& values) const
+{
+  values.assign(NumCounters, 0);
+
+#ifdef MLPACK_HAS_PERF_EVENT
+  for (size_t i = 0; i < NumCounters; ++i)
+  {
+    if (counterFds[i] < 0)
+      continue;
+
+    // The count, the time the counter was enabled, and the time it was
+    // counting.
+    uint64_t data[3];
+    if (read(counterFds[i], data, sizeof(data)) != (ssize_t) sizeof(data) ||
+        data[2] == 0)
+      continue;
+
+    values[i] = (data[2] < data[1]) ?
+        (uint64_t) ((double) data[0] * data[1] / data[2]) : data[0];
+  }
+#endif
+}
+
+std::map<std::string, uint64_t> Timers::GetTimerCounters(
+    const std::string& timerName)
+{
+  std::vector<uint64_t> totals(NumCounters, 0);
+  for (size_t i = 0; i < threadTimers.size(); ++i)
+  {
+    std::map<std::string, std::vector<uint64_t> >::const_iterator it =
+        threadTimers[i]->counterTotals.find(timerName);
+    if (it == threadTimers[i]->counterTotals.end())
+      continue;
+
+    for (size_t c = 0; c < NumCounters; ++c)
+      totals[c] += it->second[c];
+  }
+
+  std::map<std::string, uint64_t> counters;
+  for (size_t c = 0; c < NumCounters; ++c)
+    if (counterFds[c] >= 0)
+      counters[counterNames[c]] = totals[c];
+
+  return counters;
+}
+
+void Timers::PrintCounters(const std::map<std::string, uint64_t>& counters)
+{
+  for (size_t c = 0; c < NumCounters; ++c)
+  {
+    std::map<std::string, uint64_t>::const_iterator it =
+        counters.find(counterNames[c]);
+    if (it != counters.end())
+      Log::Info << "; " << it->second << " " << counterDescriptions[c];
+  }
+
+  // Instructions per cycle is the usual summary of how well the CPU is used.
+  std::map<std::string, uint64_t>::const_iterator cycles =
+      counters.find("cycles");
+  std::map<std::string, uint64_t>::const_iterator instructions =
+      counters.find("instructions");
+  if (cycles != counters.end() && instructions != counters.end() &&
+      cycles->second > 0)
+  {
+    std::ostringstream convert;
+    convert.setf(std::ios::fixed);
+    convert.precision(2);
+    convert << (double) instructions->second / cycles->second;
+    Log::Info << "; " << convert.str() << " instructions per cycle";
+  }
+}
+
+void Timers::PrintMemory(const size_t bytes)
+{
+  // Format the value separately, so the state of Log::Info is not changed.
+  std::ostringstream convert;
+  convert.setf(std::ios::fixed);
+  convert.precision(1);
+  if (bytes >= ((size_t) 1 << 30))
+    convert << (double) bytes / ((size_t) 1 << 30) << " GB";
+  else
+    convert << (double) bytes / ((size_t) 1 << 20) << " MB";
+
+  Log::Info << convert.str();
+}
+
+void Timers::PrintAllTimers()
+{
+  Merge();
+
+  std::map<std::string, timeval>::const_iterator it;
+  for (it = timers.begin(); it != timers.end(); ++it)
+    if (parents[it->first].empty())
+      PrintTimerTree(it->first, 0);
+
+  if (trackMemory)
+  {
+    size_t current, peak;
+    ReadMemory(current, peak);
+    if (current > 0)
+    {
+      Log::Info << "Peak memory: ";
+      PrintMemory(GetPeakMemory());
+      Log::Info << "; current memory: ";
+      PrintMemory(current);
+      Log::Info << "." << std::endl;
+    }
+  }
+}
+
+void Timers::PrintTimerTree(const std::string& timerName, const size_t depth)
+{
+  Log::Info << std::string(2 * (depth + 1), ' ') << timerName << ": ";
+  PrintTime(timers[timerName]);
+  // The times of every thread are added, so this isn't the wall time.
+  if (threadCounts[timerName] > 1)
+    Log::Info << " (CPU time summed over " << threadCounts[timerName]
+        << " threads)";
+  if (trackMemory)
+  {
+    const size_t peak = GetTimerPeakMemory(timerName);
+    if (peak > 0)
+    {
+      Log::Info << "; peak memory ";
+      PrintMemory(peak);
+    }
+  }
+  if (trackCounters)
+    PrintCounters(GetTimerCounters(timerName));
+  Log::Info << std::endl;
+
+  std::map<std::string, std::string>::const_iterator it;
+  for (it = parents.begin(); it != parents.end(); ++it)
+    if (it->second == timerName)
+      PrintTimerTree(it->first, depth + 1);
 }
 
 void Timers::PrintTimer(const std::string& timerName)
 {
-  timeval& t = timers[timerName];
+  Merge();
+  PrintTime(timers[timerName]);
+  Log::Info << std::endl;
+}
+
+void Timers::PrintTime(const timeval& t)
+{
   Log::Info << t.tv_sec << "." << std::setw(6) << std::setfill('0')
       << t.tv_usec << "s";
 
@@ -114,28 +683,31 @@ void Timers::PrintTimer(const std::string& timerName)
 
     Log::Info << ")";
   }
-
-  Log::Info << std::endl;
 }
 
 void Timers::GetTime(timeval* tv)
+{
+  const uint64_t ns = GetTimeNanoseconds();
+  tv->tv_sec = (long) (ns / nsPerSecond);
+  tv->tv_usec = (long) ((ns % nsPerSecond) / 1000);
+}
+
+uint64_t Timers::GetTimeNanoseconds()
 {
 #if defined(__MACH__) && defined(__APPLE__)
-  
+
   static mach_timebase_info_data_t info;
-  
+
   // If this is the first time we've run, get the timebase.
   // We can use denom == 0 to indicate that sTimebaseInfo is
   // uninitialised.
   if (info.denom == 0) {
     (void) mach_timebase_info(&info);
   }
-  
+
   // Hope that the multiplication doesn't overflow.
-  uint64_t nsecs = mach_absolute_time() * info.numer / info.denom;  
-  tv->tv_sec = nsecs / 1e9;
-  tv->tv_usec = (nsecs / 1e3) - (tv->tv_sec * 1e6);
-  
+  return mach_absolute_time() * info.numer / info.denom;
+
 #elif defined(_POSIX_VERSION)
 #if defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0)
 
@@ -151,79 +723,79 @@ void Timers::GetTime(timeval* tv)
 #else
   static const clockid_t id = ((clockid_t) - 1);
 #endif // CLOCK
-  
+
   struct timespec ts;
-  
+
   // Returns the current value tp for the specified clock_id.
-  if (clock_gettime(id, &ts) != -1 && id != ((clockid_t) - 1))
-  {
-    tv->tv_sec = ts.tv_sec;
-    tv->tv_usec = ts.tv_nsec / 1e3;
-  }
-  
-  // Fallback for the clock_gettime function.
-  gettimeofday(tv, NULL);
-  
+  if (id != ((clockid_t) - 1) && clock_gettime(id, &ts) != -1)
+    return (uint64_t) ts.tv_sec * nsPerSecond + (uint64_t) ts.tv_nsec;
+
 #endif  // _POSIX_TIMERS
+
+  // Fallback for the clock_gettime function.
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t) tv.tv_sec * nsPerSecond + (uint64_t) tv.tv_usec * 1000;
+
 #elif defined(_WIN32)
-   
+
   static double frequency = 0.0;
   static LARGE_INTEGER offset;
-  
+
   // If this is the first time we've run, get the frequency.
   // We use frequency == 0.0 to indicate that
   // QueryPerformanceFrequency is uninitialised.
   if (frequency == 0.0)
   {
     LARGE_INTEGER pF;
-    if (!QueryPerformanceFrequency(&pF))
-    {
-      // Fallback for the QueryPerformanceCounter function.
-      FileTimeToTimeVal(tv);
-    }
-    else
+    if (QueryPerformanceFrequency(&pF))
     {
       QueryPerformanceCounter(&offset);
-      frequency = (double)pF.QuadPart / 1000000.0;
+      frequency = (double) pF.QuadPart / 1e9;
     }
   }
-  
-  if (frequency != 0.0)
+
+  if (frequency == 0.0)
   {
-    LARGE_INTEGER pC;
-    // Get the current performance-counter value.
-    QueryPerformanceCounter(&pC);
-    
-    pC.QuadPart -= offset.QuadPart;
-    double microseconds = (double)pC.QuadPart / frequency;
-    pC.QuadPart = microseconds;
-    tv->tv_sec = (long)pC.QuadPart / 1000000;
-    tv->tv_usec = (long)(pC.QuadPart % 1000000);
+    // Fallback for the QueryPerformanceCounter function.
+    timeval tv;
+    FileTimeToTimeVal(&tv);
+    return (uint64_t) tv.tv_sec * nsPerSecond + (uint64_t) tv.tv_usec * 1000;
   }
-  
+
+  // Get the current performance-counter value.
+  LARGE_INTEGER pC;
+  QueryPerformanceCounter(&pC);
+  return (uint64_t) ((double) (pC.QuadPart - offset.QuadPart) / frequency);
+
 #endif
 }
 
 void Timers::StartTimer(const std::string& timerName)
 {
-  timeval tmp;
-  tmp.tv_sec = 0;
-  tmp.tv_usec = 0;
+  ThreadTimers& local = LocalTimers();
+
+  // The parent of a timer is whatever was running when it was first started.
+  if (local.parents.count(timerName) == 0)
+    local.parents[timerName] = local.active.empty() ? std::string() :
+        local.active.back();
+  local.active.push_back(timerName);
 
-  GetTime(&tmp);
-  
-  // Check to see if the timer already exists.  If it does, we'll subtract the
-  // old value.  
-  if (timers.count(timerName) == 1)
+  if (trackMemory)
   {
-    timeval tmpDelta;
-    
-    timersub(&tmp, &timers[timerName], &tmpDelta);
-    
-    tmp = tmpDelta;
+    #pragma omp critical(mlpack_timers_memory)
+    {
+      const size_t current = UpdateMemoryPeaks();
+      std::pair<size_t, size_t>& running = memoryActive[timerName];
+      if (running.first++ == 0)
+        running.second = current;
+    }
   }
-  
-  timers[timerName] = tmp;
+
+  // Read the counters and the clock last, so the bookkeeping isn't timed.
+  if (trackCounters)
+    ReadCounters(local.counterStarts[timerName]);
+  local.starts[timerName] = GetTimeNanoseconds();
 }
 
 #ifdef _WIN32
@@ -247,11 +819,69 @@ void Timers::FileTimeToTimeVal(timeval* tv)
 
 void Timers::StopTimer(const std::string& timerName)
 {
-  timeval delta, b, a = timers[timerName];
-  
-  GetTime(&b);
+  const uint64_t now = GetTimeNanoseconds();
+  std::vector<uint64_t> counters;
+  if (trackCounters)
+    ReadCounters(counters);
+  ThreadTimers& local = LocalTimers();
+
+  std::map<std::string, uint64_t>::iterator it = local.starts.find(timerName);
+  if (it == local.starts.end())
+    return;
 
-  // Calculate the delta time.
-  timersub(&b, &a, &delta);
-  timers[timerName] = delta;
+  local.totals[timerName] += now - it->second;
+  local.starts.erase(it);
+
+  std::map<std::string, std::vector<uint64_t> >::iterator c =
+      local.counterStarts.find(timerName);
+  if (c != local.counterStarts.end())
+  {
+    if (trackCounters)
+    {
+      std::vector<uint64_t>& totals = local.counterTotals[timerName];
+      totals.resize(NumCounters, 0);
+      for (size_t i = 0; i < NumCounters; ++i)
+        totals[i] += counters[i] - c->second[i];
+    }
+    local.counterStarts.erase(c);
+  }
+
+  // Timers don't have to be stopped in the reverse order they were started in.
+  for (size_t i = local.active.size(); i > 0; --i)
+  {
+    if (local.active[i - 1] == timerName)
+    {
+      local.active.erase(local.active.begin() + (i - 1));
+      break;
+    }
+  }
+
+  if (trackMemory)
+  {
+    size_t current = 0, peak = 0;
+    #pragma omp critical(mlpack_timers_memory)
+    {
+      current = UpdateMemoryPeaks();
+      std::map<std::string, std::pair<size_t, size_t> >::iterator running =
+          memoryActive.find(timerName);
+      if (running != memoryActive.end())
+      {
+        peak = running->second.second;
+        memoryPeaks[timerName] = std::max(memoryPeaks[timerName], peak);
+        if (--running->second.first == 0)
+          memoryActive.erase(running);
+      }
+    }
+
+    // Report each stage as it finishes, so that if the program is killed for
+    // running out of memory, the log shows how far it got.
+    if (peak > 0)
+    {
+      Log::Info << "Timer '" << timerName << "' stopped; peak memory ";
+      PrintMemory(peak);
+      Log::Info << ", current memory ";
+      PrintMemory(current);
+      Log::Info << "." << std::endl;
+    }
+  }
 }
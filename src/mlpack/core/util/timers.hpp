@@ -10,14 +10,17 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #if defined(__unix__) || defined(__unix)
+  #include <stdint.h>     // uint64_t
   #include <time.h>       // clock_gettime()
   #include <sys/time.h>   // timeval, gettimeofday()
   #include <unistd.h>     // flags like  _POSIX_VERSION
 #elif defined(__MACH__) && defined(__APPLE__)
   #include <mach/mach_time.h>   // mach_timebase_info,
                                 // mach_absolute_time()
+  #include <stdint.h>           // uint64_t
 
   // TEMPORARY
   #include <time.h>       // clock_gettime()
@@ -54,6 +57,20 @@ namespace mlpack {
  * The timer class provides a way for MLPACK methods to be timed.  The three
  * methods contained in this class allow a named timer to be started and
  * stopped, and its value to be obtained.
+ *
+ * Timers may be started and stopped from any thread; each thread keeps its own
+ * timers, and the time spent by every thread is summed when the value of a
+ * timer is obtained.  A timer which is started while another timer is running
+ * on the same thread is recorded as a child of that timer, and the timers are
+ * printed as a hierarchy at the end of the program.  The ScopedTimer class
+ * starts a timer for the lifetime of a scope.
+ *
+ * If memory tracking is enabled (the CLI enables it with --verbose), the
+ * highest resident memory of the process while each timer runs is recorded
+ * too, and printed with the timers.  This is only available on Linux.
+ * Likewise, hardware performance counters (cycles, instructions, cache misses
+ * and branch misses) can be recorded for each timer; the CLI enables them with
+ * --perf_counters.
  */
 class Timer
 {
@@ -64,37 +81,169 @@ class Timer
    * both runs -- that is, MLPACK timers are additive for each time they are
    * run, and do not reset.
    *
-   * @note Undefined behavior will occur if a timer is started twice.
+   * @note Undefined behavior will occur if a timer is started twice on the
+   *     same thread.
    *
    * @param name Name of timer to be started.
    */
   static void Start(const std::string& name);
 
   /**
-   * Stop the given timer.
-   *
-   * @note Undefined behavior will occur if a timer is started twice.
+   * Stop the given timer.  Nothing happens if the timer is not running on the
+   * calling thread.
    *
    * @param name Name of timer to be stopped.
    */
   static void Stop(const std::string& name);
 
   /**
-   * Get the value of the given timer.
+   * Get the value of the given timer, summed over all threads; for a timer run
+   * by several threads at once, this is their total time rather than the wall
+   * time.  This must not be called while other threads are starting or
+   * stopping timers.
    *
    * @param name Name of timer to return value of.
    */
   static timeval Get(const std::string& name);
+
+  /**
+   * Get the value of the given timer in nanoseconds, summed over all threads.
+   * This should not be called while other threads are starting or stopping
+   * timers.
+   *
+   * @param name Name of timer to return value of.
+   */
+  static uint64_t GetNanoseconds(const std::string& name);
+
+  /**
+   * Get the number of threads which have used the given timer.  If it is more
+   * than one, the value of the timer is the sum of their times.  This must not
+   * be called while other threads are starting or stopping timers.
+   *
+   * @param name Name of timer to return the number of threads of.
+   */
+  static size_t GetThreads(const std::string& name);
+
+  /**
+   * Get the name of the timer which was running when the given timer was first
+   * started, or an empty string if there was none.
+   *
+   * @param name Name of timer to return parent of.
+   */
+  static std::string Parent(const std::string& name);
+
+  /**
+   * Get the current time in seconds, from the same clock the timers use.  The
+   * value is only meaningful relative to another call, so this is useful for
+   * measuring intervals and deadlines without creating a named timer.
+   */
+  static double Now();
+
+  /**
+   * Enable or disable memory tracking.  While it is enabled, the highest
+   * resident memory of the process is recorded for each timer while it runs,
+   * and reported when the timer is stopped.  Timers already running on the
+   * calling thread are tracked from now on.  Memory tracking is only available
+   * on Linux; elsewhere, every memory value is 0.
+   *
+   * This reads /proc at every start and stop of a timer, so it should not be
+   * enabled when timers are started and stopped in tight loops.
+   *
+   * @param enable Whether to track memory.
+   */
+  static void EnableMemoryTracking(const bool enable = true);
+
+  /**
+   * Get the highest resident memory of the process while the given timer was
+   * running, in bytes, or 0 if memory tracking was not enabled while it ran.
+   *
+   * @param name Name of timer to return the peak memory of.
+   */
+  static size_t GetPeakMemory(const std::string& name);
+
+  //! Get the current resident memory of the process, in bytes (0 if it is not
+  //! available).
+  static size_t ResidentMemory();
+
+  /**
+   * Enable or disable hardware performance counters.  While they are enabled,
+   * the number of CPU cycles, instructions, last-level cache misses and branch
+   * misses are recorded for each run of each timer, and printed and saved with
+   * the timers.  Timers already running on the calling thread are counted from
+   * now on.  The counters are read with perf_event_open(), so they are only
+   * available on Linux; if they cannot be opened (for instance, because
+   * /proc/sys/kernel/perf_event_paranoid forbids it), a warning is printed and
+   * nothing is recorded.
+   *
+   * The counters count the events of the whole process, including threads
+   * which are created after they are enabled (such as the OpenMP threads, if
+   * this is called before the first parallel region), but not threads which
+   * already exist.  So a timer running on the main thread counts the work of
+   * the parallel regions inside it, and timers running at the same time on
+   * different threads each count the events of all threads.  Every counter is
+   * read at every start and stop of a timer (a system call each), so counters
+   * should not be enabled when timers are started and stopped in tight loops.
+   *
+   * @param enable Whether to record the counters.
+   */
+  static void EnableCounters(const bool enable = true);
+
+  /**
+   * Get the hardware counters of the given timer, summed over all of its
+   * completed runs on every thread.  The counters are "cycles",
+   * "instructions", "llc_misses" and "branch_misses"; counters which are not
+   * available are left out, so the map is empty if counters were not enabled.
+   *
+   * @param name Name of timer to return the counters of.
+   */
+  static std::map<std::string, uint64_t> GetCounters(const std::string& name);
+
+  //! Get the highest resident memory of the process so far, in bytes (0 if it
+  //! is not available).
+  static size_t PeakResidentMemory();
+};
+
+/**
+ * Time the lifetime of a scope with the given timer: the timer is started when
+ * the ScopedTimer is created, and stopped when it is destroyed.
+ *
+ * @code
+ * {
+ *   ScopedTimer t("tree_building");
+ *   tree = new TreeType(data);
+ * } // "tree_building" is stopped here.
+ * @endcode
+ */
+class ScopedTimer
+{
+ public:
+  //! Start the given timer.
+  ScopedTimer(const std::string& name) : name(name) { Timer::Start(name); }
+
+  //! Stop the timer.
+  ~ScopedTimer() { Timer::Stop(name); }
+
+ private:
+  //! The name of the timer.
+  std::string name;
+
+  //! Copying would stop the timer twice.
+  ScopedTimer(const ScopedTimer& other);
+  ScopedTimer& operator=(const ScopedTimer& other);
 };
 
 class Timers
 {
  public:
-  //! Nothing to do for the constructor.
-  Timers() { }
+  //! Set up the timers; there are none to begin with.
+  Timers();
+
+  //! Free the timers of each thread.
+  ~Timers();
 
   /**
-   * Returns a copy of all the timers used via this interface.
+   * Returns a copy of all the timers used via this interface, summed over all
+   * threads.
    */
   std::map<std::string, timeval>& GetAllTimers();
 
@@ -105,6 +254,30 @@ class Timers
    */
   timeval GetTimer(const std::string& timerName);
 
+  /**
+   * Returns the value of the timer specified, in nanoseconds.
+   *
+   * @param timerName The name of the timer in question.
+   */
+  uint64_t GetTimerNanoseconds(const std::string& timerName);
+
+  /**
+   * Returns the name of the parent of the timer specified, or an empty string
+   * if it has none.
+   *
+   * @param timerName The name of the timer in question.
+   */
+  std::string GetParent(const std::string& timerName);
+
+  /**
+   * Returns the number of threads which have used the timer specified.  If it
+   * is more than one, the value of the timer is the sum of their times, not
+   * the wall time.
+   *
+   * @param timerName The name of the timer in question.
+   */
+  size_t GetTimerThreads(const std::string& timerName);
+
   /**
    * Prints the specified timer.  If it took longer than a minute to complete
    * the timer will be displayed in days, hours, and minutes as well.
@@ -114,28 +287,196 @@ class Timers
   void PrintTimer(const std::string& timerName);
 
   /**
-   * Initializes a timer, available like a normal value specified on
-   * the command line.  Timers are of type timeval.  If a timer is started, then
+   * Prints every timer, with each timer indented below the timer which was
+   * running when it was started.
+   */
+  void PrintAllTimers();
+
+  /**
+   * Initializes a timer, available like a normal value specified on
+   * the command line.  Timers are of type timeval.  If a timer is started, then
    * stopped, then re-started, then stopped, the final timer value will be the
    * length of both runs of the timer.
-   *
-   * @param timerName The name of the timer in question.
-   */
+   *
+   * @param timerName The name of the timer in question.
+   */
   void StartTimer(const std::string& timerName);
 
   /**
-   * Halts the timer, and replaces it's value with
-   * the delta time from it's start
-   *
-   * @param timerName The name of the timer in question.
-   */
+   * Halts the timer, and adds the time since it was started to its value.
+   *
+   * @param timerName The name of the timer in question.
+   */
   void StopTimer(const std::string& timerName);
 
+  //! Enable or disable memory tracking; see Timer::EnableMemoryTracking().
+  void EnableMemoryTracking(const bool enable);
+
+  //! Return whether memory tracking is enabled.
+  bool MemoryTracking() const { return trackMemory; }
+
+  /**
+   * Returns the highest resident memory of the process while the timer
+   * specified was running, in bytes.
+   *
+   * @param timerName The name of the timer in question.
+   */
+  size_t GetTimerPeakMemory(const std::string& timerName);
+
+  //! Returns the highest resident memory of the process so far, in bytes.
+  size_t GetPeakMemory();
+
+  //! Enable or disable hardware counters; see Timer::EnableCounters().
+  void EnableCounters(const bool enable);
+
+  //! Return whether hardware counters are recorded.
+  bool CounterTracking() const { return trackCounters; }
+
+  /**
+   * Returns the hardware counters of the timer specified, by name.
+   *
+   * @param timerName The name of the timer in question.
+   */
+  std::map<std::string, uint64_t> GetTimerCounters(
+      const std::string& timerName);
+
+  /**
+   * Read the current and the highest resident memory of the process, in bytes,
+   * from /proc/self/status.  Both are 0 where this is not available.  The
+   * highest resident memory is the highest since it was last reset.
+   *
+   * @param current Variable to store the current resident memory in.
+   * @param peak Variable to store the highest resident memory in.
+   */
+  static void ReadMemory(size_t& current, size_t& peak);
+
+  /**
+   * Get the current time from the clock used by the timers.
+   *
+   * @param tv Structure to store the time in.
+   */
+  static void GetTime(timeval* tv);
+
+  /**
+   * Get the current time in nanoseconds from the clock used by the timers.
+   * This is a monotonic clock where the platform provides one.
+   */
+  static uint64_t GetTimeNanoseconds();
+
  private:
+  //! The timers of a single thread.
+  struct ThreadTimers
+  {
+    //! The accumulated time of each stopped run, in nanoseconds.
+    std::map<std::string, uint64_t> totals;
+    //! The time each running timer was started at.
+    std::map<std::string, uint64_t> starts;
+    //! The running timers, innermost last.
+    std::vector<std::string> active;
+    //! The timer running when each timer was first started.
+    std::map<std::string, std::string> parents;
+    //! The accumulated hardware counters of each stopped run.
+    std::map<std::string, std::vector<uint64_t> > counterTotals;
+    //! The hardware counters when each running timer was started.
+    std::map<std::string, std::vector<uint64_t> > counterStarts;
+  };
+
+  //! The timers of each thread which has used them.
+  std::vector<ThreadTimers*> threadTimers;
+
+  //! Identifies this object, so threads can tell if their timers are stale.
+  size_t id;
+
+  //! The merged timers, refreshed by Merge().
   std::map<std::string, timeval> timers;
 
-  void FileTimeToTimeVal(timeval* tv);
-  void GetTime(timeval* tv);
+  //! The merged timer hierarchy, refreshed by Merge().
+  std::map<std::string, std::string> parents;
+
+  //! The number of threads which used each timer, refreshed by Merge().
+  std::map<std::string, size_t> threadCounts;
+
+  //! Whether the memory of each timer is tracked.
+  bool trackMemory;
+
+  //! The highest resident memory while each stopped timer ran.
+  std::map<std::string, size_t> memoryPeaks;
+
+  //! The timers running on any thread while memory is tracked: the number of
+  //! threads running each, and the highest resident memory since it started.
+  std::map<std::string, std::pair<size_t, size_t> > memoryActive;
+
+  //! The highest resident memory of the process seen so far.
+  size_t processPeak;
+
+  //! The highest resident memory read last time, since the last reset.
+  size_t lastPeak;
+
+  //! Whether the highest resident memory was reset at the last reading.
+  bool peakReset;
+
+  //! The number of hardware counters.
+  static const size_t NumCounters = 4;
+
+  //! The file descriptors of the hardware counters (-1 if not open).
+  int counterFds[NumCounters];
+
+  //! Whether hardware counters are recorded.
+  bool trackCounters;
+
+  /**
+   * Open the hardware counters which are not open yet.  Returns false if none
+   * of them could be opened.
+   */
+  bool OpenCounters();
+
+  /**
+   * Read the current values of the hardware counters (0 for counters which are
+   * not open).
+   *
+   * @param values Vector to store the values in.
+   */
+  void ReadCounters(std::vector<uint64_t>& values) const;
+
+  //! Print the given hardware counters of a timer.
+  void PrintCounters(const std::map<std::string, uint64_t>& counters);
+
+  /**
+   * Read the memory of the process, raise the peak of every running timer to
+   * the highest memory since the last reading, and reset the highest memory
+   * of the process if possible, so that the next reading only covers the time
+   * after this one.  Returns the current resident memory.  This must be called
+   * in the mlpack_timers_memory critical section.
+   */
+  size_t UpdateMemoryPeaks();
+
+  //! Print the given amount of memory.
+  void PrintMemory(const size_t bytes);
+
+  //! Get the timers of the calling thread, creating them if necessary.
+  ThreadTimers& LocalTimers();
+
+  /**
+   * Sum the timers of every thread into timers and parents.  The timers of
+   * other threads are read without locking them, so this (and everything that
+   * calls it) must only be called while no other thread is starting or
+   * stopping timers, such as after a parallel region has joined.  The sum over
+   * several threads is their total time (CPU time, if they were busy), not the
+   * wall time.
+   */
+  void Merge();
+
+  //! Print the given timer and its children.
+  void PrintTimerTree(const std::string& timerName, const size_t depth);
+
+  //! Print the given time.
+  void PrintTime(const timeval& t);
+
+  static void FileTimeToTimeVal(timeval* tv);
+
+  //! Copying would free the thread timers twice.
+  Timers(const Timers& other);
+  Timers& operator=(const Timers& other);
 };
 
 }; // namespace mlpack
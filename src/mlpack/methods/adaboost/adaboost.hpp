@@ -60,13 +60,25 @@ class AdaBoost
   double tolerance;
 
   /**
-   * Classification Function. 
+   * Classification Function.  Each label is the class with the largest sum of
+   * the weights (alpha) of the weak learners which vote for it.  The test
+   * points are split into blocks, which are classified in parallel; all of the
+   * weak learners are evaluated on a block before the next one, and the votes
+   * are added up in place, so the memory used does not grow with the number
+   * of weak learners.  The weak learners' Classify() must be safe to call from
+   * several threads at once.
+   *
    * @param test Testing data.
-   * @param predictedLabels Vector to store the predicted labels of the 
-   *                         test set.
+   * @param predictedLabels Vector to store the predicted labels of the
+   *                         test set (it is resized).
    */
   void Classify(const MatType& test, arma::Row<size_t>& predictedLabels);
 
+  //! Get the weak learners of each boosting round.
+  const std::vector<WeakLearner>& WeakLearners() const { return wl; }
+  //! Get the weight (alpha) of each weak learner.
+  const std::vector<double>& Alpha() const { return alpha; }
+
 private:
   /**
    *  This function helps in building the Weight Distribution matrix
@@ -99,23 +99,15 @@ AdaBoost<MatType, WeakLearner>::AdaBoost(
     // Now from predictedLabels, build ht, the weak hypothesis
     // buildClassificationMatrix(ht, predictedLabels);
 
-    // Now, start calculation of alpha(t) using ht
-
+    // Now, start calculation of alpha(t) using ht.  The weight of each point
+    // (the sum of its row of D) was already computed by BuildWeightMatrix(),
+    // so this is only a pass over the points.
     for (size_t j = 0;j < D.n_rows; j++) // instead of D, ht
     {
       if (predictedLabels(j) == labels(j))
-      {
-        // for (int k = 0;k < numClasses; k++)
-        //   rt += D(j,k);
-        rt += arma::accu(D.row(j));
-      }
-
+        rt += weights(j);
       else
-      {
-        // for (int k = 0;k < numClasses; k++)
-        //   rt -= D(j,k);
-        rt -= arma::accu(D.row(j));
-      }
+        rt -= weights(j);
     }
     // end calculation of rt
 
@@ -134,43 +126,36 @@ AdaBoost<MatType, WeakLearner>::AdaBoost(
     alpha.push_back(alphat);
     wl.push_back(w);
 
-    // now start modifying weights
-    for (size_t j = 0;j < D.n_rows; j++)
+    // now start modifying weights.  Each point's row of D and of sumFinalH is
+    // updated independently, so the points are split across threads; the
+    // contribution of each point to zt is summed afterwards in order, so that
+    // the result does not depend on the number of threads.
+    const double expo = exp(alphat);
+    arma::vec rowZt(D.n_rows);
+    #pragma omp parallel for
+    for (omp_size_t j = 0; j < (omp_size_t) D.n_rows; j++)
     {
-      double expo = exp(alphat);
-      if (predictedLabels(j) == labels(j))
+      const bool correct = (predictedLabels(j) == labels(j));
+      rowZt[j] = 0.0;
+      for (size_t k = 0;k < D.n_cols; k++)
       {
-          for (size_t k = 0;k < D.n_cols; k++)
-          {
-            // we calculate zt, the normalization constant
-            zt += D(j,k) / expo; // * exp(-1 * alphat * yt(j,k) * ht(j,k));
-            D(j,k) = D(j,k) / expo;
-
-            // adding to the matrix of FinalHypothesis
-            // sumFinalH(j,k) += (alphat * ht(j,k));
-            if (k == labels(j))
-              sumFinalH(j,k) += (alphat);// * ht(j,k));
-            else
-              sumFinalH(j,k) -= (alphat);
-          }
-      }
-      else
-      {
-        for (size_t k = 0;k < D.n_cols; k++)
-          {
-            // we calculate zt, the normalization constant
-            zt += D(j,k) * expo;
-            D(j,k) = D(j,k) * expo;
-
-            // adding to the matrix of FinalHypothesis
-            if (k == labels(j))
-              sumFinalH(j,k) += (alphat);// * ht(j,k));
-            else
-              sumFinalH(j,k) -= (alphat);
-          }
+        // we calculate zt, the normalization constant
+        // (D(j,k) * exp(-1 * alphat * yt(j,k) * ht(j,k))).
+        D(j,k) = correct ? (D(j,k) / expo) : (D(j,k) * expo);
+        rowZt[j] += D(j,k);
+
+        // adding to the matrix of FinalHypothesis
+        // sumFinalH(j,k) += (alphat * ht(j,k));
+        if (k == labels(j))
+          sumFinalH(j,k) += (alphat);// * ht(j,k));
+        else
+          sumFinalH(j,k) -= (alphat);
       }
     }
 
+    for (size_t j = 0; j < D.n_rows; j++)
+      zt += rowZt[j];
+
     // normalization of D
     D = D / zt;
 
@@ -205,28 +190,41 @@ void AdaBoost<MatType, WeakLearner>::Classify(
     const MatType& test,
     arma::Row<size_t>& predictedLabels)
 {
-  arma::Row<size_t> tempPredictedLabels(predictedLabels.n_cols);
-  arma::mat cMatrix(numClasses, test.n_cols);
+  predictedLabels.set_size(test.n_cols);
+
+  // Each block of points is copied once, and every weak learner classifies the
+  // copy into the same row of labels; the votes of the block take
+  // (numClasses x blockSize) memory per thread.  The votes of each point are
+  // added in the order of the weak learners, so the result does not depend on
+  // the number of threads.
+  const size_t blockSize = 1024;
+  const size_t numBlocks = (test.n_cols + blockSize - 1) / blockSize;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) numBlocks; ++b)
+  {
+    const size_t begin = b * blockSize;
+    const size_t end = std::min((size_t) test.n_cols, begin + blockSize);
 
-  cMatrix.zeros();
-  predictedLabels.zeros();
+    const MatType block = test.cols(begin, end - 1);
+    arma::Row<size_t> blockLabels(block.n_cols);
+    arma::mat votes(numClasses, block.n_cols);
+    votes.zeros();
 
-  for (size_t i = 0;i < wl.size(); i++)
-  {
-    wl[i].Classify(test, tempPredictedLabels);
+    for (size_t i = 0; i < wl.size(); i++)
+    {
+      wl[i].Classify(block, blockLabels);
 
-    for (size_t j = 0; j < tempPredictedLabels.n_cols; j++)
-      cMatrix(tempPredictedLabels(j), j) += (alpha[i] * tempPredictedLabels(j));
-  }
-  
-  arma::colvec cMRow;
-  arma::uword max_index;
+      for (size_t j = 0; j < blockLabels.n_cols; j++)
+        votes(blockLabels(j), j) += alpha[i];
+    }
 
-  for (size_t i = 0; i < predictedLabels.n_cols; i++)
-  {
-    cMRow = cMatrix.col(i);
-    cMRow.max(max_index);
-    predictedLabels(i) = max_index;
+    arma::uword maxIndex;
+    for (size_t j = 0; j < votes.n_cols; j++)
+    {
+      votes.unsafe_col(j).max(maxIndex);
+      predictedLabels(begin + j) = maxIndex;
+    }
   }
 }
 
@@ -244,12 +242,13 @@ void AdaBoost<MatType, WeakLearner>::BuildWeightMatrix(
     const arma::mat& D,
     arma::rowvec& weights)
 {
-  size_t i, j;
   weights.fill(0.0);
 
-  for (i = 0; i < D.n_rows; i++)
+  // The weight of each point is independent of the others.
+  #pragma omp parallel for
+  for (omp_size_t i = 0; i < (omp_size_t) D.n_rows; i++)
   {
-    for (j = 0; j < D.n_cols; j++)
+    for (size_t j = 0; j < D.n_cols; j++)
       weights(i) += D(i, j);
   }
 }
@@ -17,9 +17,11 @@
 
 #include <mlpack/methods/amf/update_rules/nmf_mult_dist.hpp>
 #include <mlpack/methods/amf/update_rules/nmf_als.hpp>
+#include <mlpack/methods/amf/update_rules/sparse_als.hpp>
 #include <mlpack/methods/amf/update_rules/svd_batch_learning.hpp>
 #include <mlpack/methods/amf/update_rules/svd_incomplete_incremental_learning.hpp>
 #include <mlpack/methods/amf/update_rules/svd_complete_incremental_learning.hpp>
+#include <mlpack/methods/amf/update_rules/svd_parallel_incremental_learning.hpp>
 
 #include <mlpack/methods/amf/init_rules/random_init.hpp>
 
@@ -136,6 +138,30 @@ typedef amf::AMF<amf::SimpleResidueTermination,
                  amf::RandomInitialization, 
                  amf::NMFALSUpdate> NMFALSFactorizer;
 
+/**
+ * SparseALSFactorizer factorizes the given sparse matrix V into two matrices W
+ * and H by alternating least squares over only the observed (nonzero) entries
+ * of V; the rows of W and the columns of H are solved in parallel.
+ *
+ * @see SparseALSUpdate
+ */
+typedef amf::AMF<amf::SimpleToleranceTermination<arma::sp_mat>,
+                 amf::RandomInitialization,
+                 amf::SparseALSUpdate> SparseALSFactorizer;
+
+/**
+ * SparseSVDParallelIncrementalFactorizer factorizes the given sparse matrix V
+ * into two matrices W and H by stochastic gradient descent over the nonzero
+ * entries of V, with DSGD's stratified blocks processed in parallel; each
+ * iteration is one pass over the data.
+ *
+ * @see SVDParallelIncrementalLearning
+ */
+typedef amf::AMF<amf::SimpleToleranceTermination<arma::sp_mat>,
+                 amf::RandomInitialization,
+                 amf::SVDParallelIncrementalLearning>
+        SparseSVDParallelIncrementalFactorizer;
+
 //! Add simple typedefs 
 #ifdef MLPACK_USE_CXX11
 
@@ -62,8 +62,11 @@ class SimpleResidueTermination
    */
   bool IsConverged(arma::mat& W, arma::mat& H)
   {
-    // Calculate the norm and compute the residue
-    const double norm = arma::norm(W * H, "fro");
+    // Calculate the norm and compute the residue.  The squared Frobenius norm
+    // of WH is trace((W^T W)(H H^T)), which only needs r x r products, so WH is
+    // never formed.
+    const double norm = std::sqrt(std::max(arma::accu((trans(W) * W) %
+        (H * trans(H))), 0.0));
     residue = fabs(normOld - norm) / normOld;
 
     // Store the norm.
@@ -20,19 +20,40 @@ namespace amf {
  * Secondary termination criterion terminates algorithm when iteration count
  * goes above the threshold.
  *
+ * The residue is the RMSE over the nonzero entries of V; each entry of WH that
+ * is needed is computed as a dot product, so WH is never formed.  On large
+ * problems the check can be made cheaper still: with sampleSize, the RMSE is
+ * estimated from that many nonzero entries of V, sampled once when the
+ * factorization starts, and with checkInterval, the residue is only computed
+ * every checkInterval iterations.
+ *
  * @see AMF
  */
 template <class MatType>
 class SimpleToleranceTermination
 {
  public:
-  //! empty constructor
+  /**
+   * Create the termination policy.
+   *
+   * @param tolerance Tolerance on the relative decrease of the residue.
+   * @param maxIterations Maximum number of iterations.
+   * @param reverseStepTolerance Number of successive iterations that are
+   *      allowed to not meet the tolerance.
+   * @param sampleSize Number of nonzero entries the residue is computed from
+   *      (0 means all of them).
+   * @param checkInterval Number of iterations between residue computations.
+   */
   SimpleToleranceTermination(const double tolerance = 1e-5,
                              const size_t maxIterations = 10000,
-                             const size_t reverseStepTolerance = 3)
+                             const size_t reverseStepTolerance = 3,
+                             const size_t sampleSize = 0,
+                             const size_t checkInterval = 1)
             : tolerance(tolerance),
               maxIterations(maxIterations),
-              reverseStepTolerance(reverseStepTolerance) {}
+              reverseStepTolerance(reverseStepTolerance),
+              sampleSize(sampleSize),
+              checkInterval(checkInterval) {}
 
   /**
    * Initializes the termination policy before stating the factorization.
@@ -53,6 +74,34 @@ class SimpleToleranceTermination
     c_indexOld = 0;
 
     reverseStepCount = 0;
+
+    // Choose the entries that the residue is estimated from, if it is not
+    // computed from all of them.
+    sampleLocations.reset();
+    sampleValues.reset();
+    if (sampleSize == 0)
+      return;
+
+    const arma::sp_mat nonzeros(V);
+    if (sampleSize >= nonzeros.n_nonzero)
+      return;
+
+    std::vector<size_t> samples(sampleSize);
+    for (size_t i = 0; i < sampleSize; ++i)
+      samples[i] = math::RandInt(nonzeros.n_nonzero);
+    std::sort(samples.begin(), samples.end());
+
+    sampleLocations.set_size(2, sampleSize);
+    sampleValues.set_size(sampleSize);
+    size_t col = 0;
+    for (size_t i = 0; i < sampleSize; ++i)
+    {
+      while (nonzeros.col_ptrs[col + 1] <= samples[i])
+        ++col;
+      sampleLocations(0, i) = nonzeros.row_indices[samples[i]];
+      sampleLocations(1, i) = col;
+      sampleValues[i] = nonzeros.values[samples[i]];
+    }
   }
 
   /**
@@ -63,29 +112,31 @@ class SimpleToleranceTermination
    */
   bool IsConverged(arma::mat& W, arma::mat& H)
   {
-    arma::mat WH;
-
-    WH = W * H;
+    // Between checks, only count the iteration.
+    if (checkInterval > 1 && iteration % checkInterval != 0 &&
+        iteration < maxIterations)
+    {
+      iteration++;
+      return false;
+    }
 
     // compute residue
     residueOld = residue;
-    size_t n = V->n_rows;
-    size_t m = V->n_cols;
     double sum = 0;
     size_t count = 0;
-    for(size_t i = 0;i < n;i++)
+    if (sampleValues.n_elem > 0)
     {
-        for(size_t j = 0;j < m;j++)
-        {
-            double temp = 0;
-            if((temp = (*V)(i,j)) != 0)
-            {
-                temp = (temp - WH(i, j));
-                temp = temp * temp;
-                sum += temp;
-                count++;
-            }
-        }
+      for (size_t i = 0; i < sampleValues.n_elem; ++i)
+      {
+        const double temp = sampleValues[i] - arma::dot(
+            W.row(sampleLocations(0, i)), H.col(sampleLocations(1, i)));
+        sum += temp * temp;
+      }
+      count = sampleValues.n_elem;
+    }
+    else
+    {
+      SquaredError(*V, W, H, sum, count);
     }
     residue = sum / count;
     residue = sqrt(residue);
@@ -152,7 +203,58 @@ class SimpleToleranceTermination
   const double& Tolerance() const { return tolerance; }
   double& Tolerance() { return tolerance; }
 
+  //! Access the number of entries the residue is estimated from (0 is all).
+  const size_t& SampleSize() const { return sampleSize; }
+  size_t& SampleSize() { return sampleSize; }
+
+  //! Access the number of iterations between residue computations.
+  const size_t& CheckInterval() const { return checkInterval; }
+  size_t& CheckInterval() { return checkInterval; }
+
  private:
+  //! Sum the squared errors of WH at the nonzero entries of the sparse matrix
+  //! V.
+  static void SquaredError(const arma::sp_mat& V,
+                           const arma::mat& W,
+                           const arma::mat& H,
+                           double& sum,
+                           size_t& count)
+  {
+    for (size_t j = 0; j < V.n_cols; ++j)
+    {
+      for (size_t k = V.col_ptrs[j]; k < V.col_ptrs[j + 1]; ++k)
+      {
+        const double temp = V.values[k] -
+            arma::dot(W.row(V.row_indices[k]), H.col(j));
+        sum += temp * temp;
+      }
+    }
+    count = V.n_nonzero;
+  }
+
+  //! Sum the squared errors of WH at the nonzero entries of the dense matrix
+  //! V.
+  template<typename DenseMatType>
+  static void SquaredError(const DenseMatType& V,
+                           const arma::mat& W,
+                           const arma::mat& H,
+                           double& sum,
+                           size_t& count)
+  {
+    for (size_t j = 0; j < V.n_cols; ++j)
+    {
+      for (size_t i = 0; i < V.n_rows; ++i)
+      {
+        if (V(i, j) != 0)
+        {
+          const double temp = V(i, j) - arma::dot(W.row(i), H.col(j));
+          sum += temp * temp;
+          count++;
+        }
+      }
+    }
+  }
+
   //! tolerance
   double tolerance;
   //! iteration threshold
@@ -174,6 +276,15 @@ class SimpleToleranceTermination
   //! successive residue drops
   size_t reverseStepCount;
 
+  //! number of nonzero entries to estimate the residue from (0 means all)
+  size_t sampleSize;
+  //! number of iterations between residue computations
+  size_t checkInterval;
+  //! locations (row, column) of the sampled entries
+  arma::umat sampleLocations;
+  //! values of the sampled entries
+  arma::vec sampleValues;
+
   //! indicates whether a copy of information is available which corresponds to
   //! minimum residue point
   bool isCopy;
@@ -19,6 +19,10 @@ namespace amf {
  * that the Frobenius norm \f$ \sqrt{\sum_i \sum_j(V-WH)^2} \f$ is
  * non-increasing between subsequent iterations. Both of the update rules
  * for W and H are defined in this file.
+ *
+ * Neither rule needs WH itself: only \f$ VH^T \f$ and \f$ W^TV \f$ (which
+ * are sparse-dense products when V is sparse) and the small r x r products
+ * \f$ HH^T \f$ and \f$ W^TW \f$ are computed.
  */
 class NMFMultiplicativeDistanceUpdate
 {
@@ -50,7 +54,9 @@ class NMFMultiplicativeDistanceUpdate
                              arma::mat& W,
                              const arma::mat& H)
   {
-    W = (W % (V * H.t())) / (W * H * H.t());
+    // The r x r product H H^T is formed first, so that W H (which is as large
+    // as V, and dense even if V is sparse) is never needed.
+    W = (W % (V * H.t())) / (W * (H * H.t()));
   }
 
   /**
@@ -70,7 +76,7 @@ class NMFMultiplicativeDistanceUpdate
                              const arma::mat& W,
                              arma::mat& H)
   {
-    H = (H % (W.t() * V)) / (W.t() * W * H);
+    H = (H % (W.t() * V)) / ((W.t() * W) * H);
   }
 };
 
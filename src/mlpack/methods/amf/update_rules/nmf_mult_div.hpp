@@ -20,9 +20,11 @@ namespace amf {
  * is non-increasing between subsequent iterations. Both of the update rules
  * for W and H are defined in this file.
  *
- * This set of update rules is not meant to work with sparse matrices.  Using
- * sparse matrices often causes NaNs in the output, so other choices of update
- * rules are better in that situation.
+ * When V is an arma::sp_mat, only the nonzero entries of V contribute to the
+ * numerators, so \f$ (WH)_{ij} \f$ is only evaluated at those entries and WH
+ * is never formed; each update then takes time proportional to the number of
+ * nonzeros of V times the rank.  For dense matrices, all of WH is computed,
+ * and a zero entry in WH gives NaNs in the output.
  */
 class NMFMultiplicativeDivergenceUpdate
 {
@@ -79,6 +81,26 @@ class NMFMultiplicativeDivergenceUpdate
     }
   }
 
+  /**
+   * The update rule for the basis matrix W, for a sparse input matrix.  This
+   * is the same as the rule above, but \f$ V_{i\mu}/(WH)_{i\mu} \f$ is only
+   * computed at the nonzero entries of V.
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix to be updated.
+   * @param H Encoding matrix.
+   */
+  inline static void WUpdate(const arma::sp_mat& V,
+                             arma::mat& W,
+                             const arma::mat& H)
+  {
+    const arma::sp_mat ratio = Ratio(V, W, H);
+    const arma::rowvec hSums = trans(arma::sum(H, 1));
+
+    W %= ratio * trans(H);
+    W.each_row() /= hSums;
+  }
+
   /**
    * The update rule for the encoding matrix H. The formula used is
    * \f[
@@ -120,6 +142,53 @@ class NMFMultiplicativeDivergenceUpdate
       }
     }
   }
+
+  /**
+   * The update rule for the encoding matrix H, for a sparse input matrix.
+   * This is the same as the rule above, but \f$ V_{i\mu}/(WH)_{i\mu} \f$ is
+   * only computed at the nonzero entries of V.
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix.
+   * @param H Encoding matrix to updated.
+   */
+  inline static void HUpdate(const arma::sp_mat& V,
+                             const arma::mat& W,
+                             arma::mat& H)
+  {
+    const arma::sp_mat ratio = Ratio(V, W, H);
+    const arma::colvec wSums = trans(arma::sum(W, 0));
+
+    H %= trans(W) * ratio;
+    H.each_col() /= wSums;
+  }
+
+ private:
+  /**
+   * Return the sparse matrix with the same nonzero pattern as V, whose entries
+   * are \f$ V_{ij} / (WH)_{ij} \f$.  Only the needed entries of WH are
+   * computed.
+   */
+  static arma::sp_mat Ratio(const arma::sp_mat& V,
+                            const arma::mat& W,
+                            const arma::mat& H)
+  {
+    arma::umat locations(2, V.n_nonzero);
+    arma::vec values(V.n_nonzero);
+    for (size_t j = 0; j < V.n_cols; ++j)
+    {
+      for (size_t k = V.col_ptrs[j]; k < V.col_ptrs[j + 1]; ++k)
+      {
+        const size_t i = V.row_indices[k];
+        locations(0, k) = i;
+        locations(1, k) = j;
+        values[k] = V.values[k] / arma::dot(W.row(i), H.col(j));
+      }
+    }
+
+    // The locations are already sorted, by column and then by row.
+    return arma::sp_mat(locations, values, V.n_rows, V.n_cols, false);
+  }
 };
 
 }; // namespace amf
@@ -0,0 +1,174 @@
+/**
+ * @file sparse_als.hpp
+ *
+ * Alternating least squares update rule for AMF (Alternating Matrix
+ * Factorization) that only uses the observed entries of the input matrix.
+ */
+#ifndef __MLPACK_METHODS_AMF_UPDATE_RULES_SPARSE_ALS_HPP
+#define __MLPACK_METHODS_AMF_UPDATE_RULES_SPARSE_ALS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace amf {
+
+/**
+ * This class implements the weighted-lambda-regularized alternating least
+ * squares described in the paper 'Large-scale Parallel Collaborative Filtering
+ * for the Netflix Prize' by Y. Zhou, D. Wilkinson, R. Schreiber and R. Pan.
+ * Unlike NMFALSUpdate, the zero entries of V are taken to be missing, not
+ * zero: each row i of W is the solution of
+ *
+ * \f[
+ * (\sum_{j \in R_i} h_j h_j^T + \lambda n_i I) w_i = \sum_{j \in R_i} V_{ij} h_j
+ * \f]
+ *
+ * where \f$ R_i \f$ is the set of the \f$ n_i \f$ observed entries of row i of
+ * V, and each column of H is found in the same way.  Every one of these r x r
+ * systems is independent of the others, so the rows (and then the columns)
+ * are solved in parallel when OpenMP is available.  A row or column with no
+ * observed entries is set to zero.  The factors are not constrained to be
+ * non-negative.
+ *
+ * This is mostly meant for sparse matrices (arma::sp_mat), where each update
+ * takes time linear in the number of ratings instead of in the size of V.
+ */
+class SparseALSUpdate
+{
+ public:
+  /**
+   * Create the update rule with the given regularization.
+   *
+   * @param lambda Regularization constant; it is scaled by the number of
+   *      observed entries of each row and column.
+   * @param threads Number of threads to use (0 means all available cores).
+   */
+  SparseALSUpdate(const double lambda = 0.01, const size_t threads = 0) :
+      lambda(lambda),
+      threads(threads)
+  { }
+
+  /**
+   * Initialize the update rule before a new factorization.  This stores the
+   * observed entries of the dataset by row and by column.
+   *
+   * @param dataset Input matrix to be factorized.
+   * @param rank Rank of factorization.
+   */
+  template<typename MatType>
+  void Initialize(const MatType& dataset, const size_t rank)
+  {
+    (void) rank;
+
+    ratings = arma::sp_mat(dataset);
+    ratingsByRow = trans(ratings);
+  }
+
+  /**
+   * The update rule for the basis matrix W; each row of W is solved with H
+   * held constant.
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix to be updated.
+   * @param H Encoding matrix.
+   */
+  template<typename MatType>
+  inline void WUpdate(const MatType& /* V */,
+                      arma::mat& W,
+                      const arma::mat& H)
+  {
+    arma::mat wt(H.n_rows, ratingsByRow.n_cols);
+    Solve(ratingsByRow, H, wt);
+    W = trans(wt);
+  }
+
+  /**
+   * The update rule for the encoding matrix H; each column of H is solved with
+   * W held constant.
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix.
+   * @param H Encoding matrix to be updated.
+   */
+  template<typename MatType>
+  inline void HUpdate(const MatType& /* V */,
+                      const arma::mat& W,
+                      arma::mat& H)
+  {
+    H.set_size(W.n_cols, ratings.n_cols);
+    Solve(ratings, trans(W), H);
+  }
+
+  //! Get the regularization constant.
+  double Lambda() const { return lambda; }
+  //! Modify the regularization constant.
+  double& Lambda() { return lambda; }
+
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+ private:
+  /**
+   * Solve the regularized normal equations of each column of the given
+   * ratings.  Column j of the result is found from the columns of factors
+   * indexed by the observed entries of column j of the ratings.
+   */
+  void Solve(const arma::sp_mat& observed,
+             const arma::mat& factors,
+             arma::mat& result) const
+  {
+#ifdef _OPENMP
+    const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+    const size_t numThreads = 1;
+#endif
+
+    const size_t r = factors.n_rows;
+
+    // The number of ratings in each column can differ a lot, so the columns are
+    // handed out dynamically.
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 64)
+    for (omp_size_t j = 0; j < (omp_size_t) observed.n_cols; ++j)
+    {
+      const size_t begin = observed.col_ptrs[j];
+      const size_t end = observed.col_ptrs[j + 1];
+      if (begin == end)
+      {
+        result.col(j).zeros();
+        continue;
+      }
+
+      arma::mat a = (lambda * (end - begin)) * arma::eye<arma::mat>(r, r);
+      arma::vec b = arma::zeros<arma::vec>(r);
+      for (size_t k = begin; k < end; ++k)
+      {
+        const arma::vec f = factors.unsafe_col(observed.row_indices[k]);
+        a += f * trans(f);
+        b += observed.values[k] * f;
+      }
+
+      // a is symmetric positive definite when lambda is positive.
+      arma::vec x;
+      if (!arma::solve(x, a, b))
+        x = pinv(a) * b;
+      result.col(j) = x;
+    }
+  }
+
+  //! Regularization constant.
+  double lambda;
+  //! Number of threads to use.
+  size_t threads;
+
+  //! The observed entries of the dataset, by column.
+  arma::sp_mat ratings;
+  //! The observed entries of the dataset, by row.
+  arma::sp_mat ratingsByRow;
+}; // class SparseALSUpdate
+
+}; // namespace amf
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,212 @@
+/**
+ * @file svd_parallel_incremental_learning.hpp
+ *
+ * Parallel SVD incremental learning used in AMF (Alternating Matrix
+ * Factorization), with stratified blocks of the input matrix.
+ */
+#ifndef __MLPACK_METHODS_AMF_UPDATE_RULES_SVD_PARALLEL_INCREMENTAL_LEARNING_HPP
+#define __MLPACK_METHODS_AMF_UPDATE_RULES_SVD_PARALLEL_INCREMENTAL_LEARNING_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace amf {
+
+/**
+ * This class computes SVD by complete incremental learning (stochastic gradient
+ * descent over the nonzero entries of V, as in SVDCompleteIncrementalLearning)
+ * with the entries processed in parallel.  The scheduling is that of DSGD,
+ * described in the paper 'Large-Scale Matrix Factorization with Distributed
+ * Stochastic Gradient Descent' by R. Gemulla, E. Nijkamp, P. J. Haas and
+ * Y. Sismanis: the rows and the columns of V are split into p blocks each, and
+ * an epoch is p rounds.  In round s, block b of rows is processed with block
+ * (b + s) mod p of columns, for every b in parallel; these p blocks of V share
+ * no row of W and no column of H, so no locks are needed and nothing is
+ * updated by two threads at once.
+ *
+ * Every call to WUpdate() is one epoch over all of the nonzero entries of V,
+ * which updates both W and H; HUpdate() then stores the new H.  So one AMF
+ * iteration is one pass over the data, and the usual termination policies
+ * (SimpleToleranceTermination or ValidationRMSETermination, without the
+ * incremental wrappers) can be used.
+ *
+ * The result depends on the number of blocks but not on the number of threads
+ * or their scheduling, since the entries of each block are always visited in
+ * the same order.
+ *
+ * @see SVDCompleteIncrementalLearning
+ */
+class SVDParallelIncrementalLearning
+{
+ public:
+  /**
+   * Create the update rule.
+   *
+   * @param u Step size.
+   * @param kw Regularization constant for the W matrix.
+   * @param kh Regularization constant for the H matrix.
+   * @param blocks Number of blocks the rows and columns are split into (0
+   *      means one per thread).
+   * @param threads Number of threads to use (0 means all available cores).
+   */
+  SVDParallelIncrementalLearning(const double u = 0.01,
+                                 const double kw = 0,
+                                 const double kh = 0,
+                                 const size_t blocks = 0,
+                                 const size_t threads = 0) :
+      u(u),
+      kw(kw),
+      kh(kh),
+      blocks(blocks),
+      threads(threads)
+  { }
+
+  /**
+   * Initialize parameters before factorization.  This stores the nonzero
+   * entries of the dataset, grouped by block.
+   *
+   * @param dataset Input matrix to be factorized.
+   * @param rank Rank of factorization.
+   */
+  template<typename MatType>
+  void Initialize(const MatType& dataset, const size_t rank)
+  {
+    (void) rank;
+
+    ratings = arma::sp_mat(dataset);
+
+#ifdef _OPENMP
+    numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+    numThreads = 1;
+#endif
+    numBlocks = (blocks == 0) ? numThreads : blocks;
+    numBlocks = std::max(std::min(numBlocks, (size_t) std::min(
+        ratings.n_rows, ratings.n_cols)), (size_t) 1);
+
+    // Split the entries into the numBlocks x numBlocks blocks, keeping them in
+    // column-major order within each block.
+    blockEntries.clear();
+    blockEntries.resize(numBlocks * numBlocks);
+    entryCols.set_size(ratings.n_nonzero);
+    for (size_t j = 0; j < ratings.n_cols; ++j)
+    {
+      const size_t colBlock = j * numBlocks / ratings.n_cols;
+      for (size_t k = ratings.col_ptrs[j]; k < ratings.col_ptrs[j + 1]; ++k)
+      {
+        const size_t rowBlock = ratings.row_indices[k] * numBlocks /
+            ratings.n_rows;
+        blockEntries[rowBlock * numBlocks + colBlock].push_back(k);
+        entryCols[k] = j;
+      }
+    }
+  }
+
+  /**
+   * Run one epoch of stochastic gradient descent over all of the nonzero
+   * entries of V.  W is updated, and the new H is kept until HUpdate().
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix to be updated.
+   * @param H Encoding matrix.
+   */
+  template<typename MatType>
+  inline void WUpdate(const MatType& /* V */,
+                      arma::mat& W,
+                      const arma::mat& H)
+  {
+    // The rows of W are used as columns, so that they are contiguous.
+    wt = trans(W);
+    h = H;
+
+    for (size_t s = 0; s < numBlocks; ++s)
+    {
+      // The blocks of this round touch disjoint rows of W and columns of H.
+      #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 1)
+      for (omp_size_t b = 0; b < (omp_size_t) numBlocks; ++b)
+      {
+        const std::vector<size_t>& entries =
+            blockEntries[b * numBlocks + (b + s) % numBlocks];
+        for (size_t e = 0; e < entries.size(); ++e)
+        {
+          const size_t k = entries[e];
+          double* w = wt.colptr(ratings.row_indices[k]);
+          double* hCol = h.colptr(entryCols[k]);
+
+          double error = ratings.values[k];
+          for (size_t i = 0; i < wt.n_rows; ++i)
+            error -= w[i] * hCol[i];
+
+          for (size_t i = 0; i < wt.n_rows; ++i)
+          {
+            const double oldW = w[i];
+            w[i] += u * (error * hCol[i] - kw * oldW);
+            hCol[i] += u * (error * oldW - kh * hCol[i]);
+          }
+        }
+      }
+    }
+
+    W = trans(wt);
+  }
+
+  /**
+   * Store the H found by the last call to WUpdate().
+   *
+   * @param V Input matrix to be factorized.
+   * @param W Basis matrix.
+   * @param H Encoding matrix to be updated.
+   */
+  template<typename MatType>
+  inline void HUpdate(const MatType& /* V */,
+                      const arma::mat& /* W */,
+                      arma::mat& H)
+  {
+    H = h;
+  }
+
+  //! Get the number of blocks (0 means one per thread).
+  size_t Blocks() const { return blocks; }
+  //! Modify the number of blocks (0 means one per thread).
+  size_t& Blocks() { return blocks; }
+
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+ private:
+  //! Step size.
+  double u;
+  //! Regularization parameter for the W matrix.
+  double kw;
+  //! Regularization parameter for the H matrix.
+  double kh;
+  //! Number of blocks requested.
+  size_t blocks;
+  //! Number of threads requested.
+  size_t threads;
+
+  //! Number of threads used.
+  size_t numThreads;
+  //! Number of blocks used.
+  size_t numBlocks;
+
+  //! The nonzero entries of the dataset.
+  arma::sp_mat ratings;
+  //! The column of each nonzero entry.
+  arma::Col<size_t> entryCols;
+  //! The indices of the nonzero entries of each block, by row block and then
+  //! column block.
+  std::vector<std::vector<size_t> > blockEntries;
+
+  //! W, transposed, during an epoch.
+  arma::mat wt;
+  //! H during an epoch.
+  arma::mat h;
+}; // class SVDParallelIncrementalLearning
+
+}; // namespace amf
+}; // namespace mlpack
+
+#endif
@@ -13,9 +13,12 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <mlpack/methods/fastmks/fastmks.hpp>
+#include <mlpack/core/kernels/linear_kernel.hpp>
 #include <mlpack/methods/amf/amf.hpp>
 #include <mlpack/methods/amf/update_rules/nmf_als.hpp>
 #include <mlpack/methods/amf/termination_policies/simple_residue_termination.hpp>
+#include <algorithm>
 #include <set>
 #include <map>
 #include <iostream>
@@ -94,7 +97,30 @@ class CF
      FactorizerType factorizer = FactorizerType(),
      const size_t numUsersForSimilarity = 5,
      const size_t rank = 0);
-   
+
+  /**
+   * Load a CF model that was previously stored with Save(): the factors, the
+   * rated items of each user and the tree used to find neighborhoods.  No
+   * factorization is done, so this is the constructor to use for serving
+   * recommendations with a model built earlier.  If the stream does not hold a
+   * CF model, a fatal error is thrown.
+   *
+   * @param stream Binary stream to load the model from.
+   */
+  CF(std::istream& stream);
+
+  //! Delete the CF object, and the tree built on the users.
+  ~CF();
+
+  /**
+   * Store the model (the factors, the rated items of each user and the tree
+   * used to find neighborhoods) in the given binary stream, so that it can be
+   * loaded later without factorizing the data again.  The factorizer itself is
+   * not stored.
+   *
+   * @param stream Binary stream to store the model in.
+   */
+  void Save(std::ostream& stream) const;
   /*void ApplyFactorizer(arma::mat& data, const typename boost::enable_if_c<
       FactorizerTraits<FactorizerType>::IsCleaned == false, int*>::type);
       
@@ -131,6 +157,25 @@ class CF
     return rank;
   }
 
+  /**
+   * Set whether or not to find the best items for each user with FastMKS
+   * (maximum inner product search with a linear kernel, on a cover tree built
+   * on the item factors) instead of scoring every item.  This is sublinear in
+   * the number of items, but because rated items can't be recommended, the
+   * search is for numRecs plus the largest number of items rated by any
+   * queried user, so it helps most when no queried user has rated many items.
+   */
+  void UseFastMKS(const bool useFastMKS)
+  {
+    this->useFastMKS = useFastMKS;
+  }
+
+  //! Gets whether or not FastMKS is used to find the best items.
+  bool UseFastMKS() const
+  {
+    return useFastMKS;
+  }
+
   //! Sets factorizer for NMF
   void Factorizer(const FactorizerType& f)
   {
@@ -141,8 +186,12 @@ class CF
   const arma::mat& W() const { return w; }
   //! Get the Item Matrix.
   const arma::mat& H() const { return h; }
-  //! Get the Rating Matrix.
-  const arma::mat& Rating() const { return rating; }
+  /**
+   * Compute the full rating matrix, W * H.  This is an items x users dense
+   * matrix, so it may be far too large to hold for big data sets;
+   * GetRecommendations() never forms it.
+   */
+  arma::mat Rating() const { return w * h; }
   //! Get the cleaned data matrix.
   const arma::sp_mat& CleanedData() const { return cleanedData; }
 
@@ -158,6 +207,11 @@ class CF
   /**
    * Generates the given number of recommendations for the specified users.
    *
+   * The neighborhood of each user is found by the distance between the
+   * estimated ratings of the users (their columns of W * H), but this is done
+   * in the rank-dimensional space of H, and only a block of items x users
+   * ratings is computed at a time, so the full rating matrix is never formed.
+   *
    * @param numRecs Number of Recommendations
    * @param recommendations Matrix to save recommendations
    * @param users Users for which recommendations are to be generated
@@ -166,29 +220,128 @@ class CF
                           arma::Mat<size_t>& recommendations,
                           arma::Col<size_t>& users);
 
+  /**
+   * Fold new or changed ratings into the model without factorizing the data
+   * again.  The ratings are added to the cleaned data (replacing any earlier
+   * ratings of the same items by the same users; a rating of 0 removes a
+   * rating), and then the factor column of each affected user is solved for
+   * against the fixed item factors W, using only the user's rated items:
+   *
+   *   h_u = (W_u^T W_u + lambda I)^-1 W_u^T r_u.
+   *
+   * New users and items may be given.  New items get their factors (the rows
+   * of W) in the same way, from the users that rated them; and if sweeps is
+   * nonzero, that many local ALS sweeps are done, each solving first for the
+   * affected items and then for the affected users.  The rest of the model is
+   * unchanged, so this is meant for keeping a model fresh between full
+   * refactorizations.
+   *
+   * @param ratings (user, item, rating) table of new ratings, in the same form
+   *     as the data given to the constructor.
+   * @param sweeps Number of local ALS sweeps to do after folding in.
+   * @param lambda Regularization of each least-squares solve.
+   */
+  void FoldIn(const arma::mat& ratings,
+              const size_t sweeps = 0,
+              const double lambda = 0.01);
+
   /**
    * Returns a string representation of this object.
    */
   std::string ToString() const;
 
+  //! The type of tree built on the users to find their neighborhoods.
+  typedef tree::BinarySpaceTree<bound::HRectBound<2>,
+      neighbor::NeighborSearchStat<neighbor::NearestNeighborSort> >
+      UserTreeType;
+
  private:
   //! Number of users for similarity.
   size_t numUsersForSimilarity;
   //! Rank used for matrix factorization.
   size_t rank;
+  //! Whether or not to find the best items with FastMKS.
+  bool useFastMKS;
   //! Instantiated factorizer object.
   FactorizerType factorizer;
   //! User matrix.
   arma::mat w;
   //! Item matrix.
   arma::mat h;
-  //! Rating matrix.
-  arma::mat rating;
   //! Cleaned data matrix.
   arma::sp_mat cleanedData;
+  //! The users, in the space where distances between users are distances
+  //! between their estimated ratings (see BuildUserTree()); the columns are
+  //! in the order of the user tree.
+  arma::mat userSpace;
+  //! The tree built on userSpace.
+  UserTreeType* userTree;
+  //! Original index of each column of userSpace.
+  std::vector<size_t> oldFromNewUsers;
+  //! Column of userSpace of each user.
+  std::vector<size_t> newFromOldUsers;
+
+  //! The CF object holds a tree, so it can't be copied.
+  CF(const CF& other);
+  CF& operator=(const CF& other);
   //! Converts the User, Item, Value Matrix to User-Item Table
   void CleanData(const arma::mat& data);
 
+  /**
+   * Solve for the factors of the given users against the fixed item factors,
+   * using only the items each user has rated (see FoldIn()).
+   *
+   * @param users Users to solve for.
+   * @param lambda Regularization of each least-squares solve.
+   */
+  void SolveUsers(const std::vector<size_t>& users, const double lambda);
+
+  /**
+   * Solve for the factors of the given items against the fixed user factors,
+   * using only the users that rated each item (see FoldIn()).
+   *
+   * @param ratingsByItem Transpose of the cleaned data (one column per item).
+   * @param items Items to solve for.
+   * @param lambda Regularization of each least-squares solve.
+   */
+  void SolveItems(const arma::sp_mat& ratingsByItem,
+                  const std::vector<size_t>& items,
+                  const double lambda);
+
+  /**
+   * Build the space in which neighborhoods of users are found, and the tree on
+   * it.  The estimated ratings of user u are column u of W * H, so the squared
+   * distance between the ratings of users a and b is
+   *   (h_a - h_b)^T (W^T W) (h_a - h_b).
+   * With the eigendecomposition W^T W = V diag(lambda) V^T, this is the
+   * squared distance between columns a and b of diag(sqrt(lambda)) V^T H,
+   * which is only rank x users; so the neighborhoods can be found without ever
+   * forming the items x users rating matrix.
+   */
+  void BuildUserTree();
+
+  /**
+   * Load the model from a stream written by Save().
+   *
+   * @param stream Binary stream to load the model from.
+   */
+  void Load(std::istream& stream);
+
+  /**
+   * Find the best unrated items for each user by maximum inner product search
+   * of their averaged neighborhood factors among the item factors (the rows of
+   * W).
+   *
+   * @param numRecs Number of recommendations.
+   * @param recommendations Matrix to save recommendations into.
+   * @param users Users for which recommendations are to be generated.
+   * @param averageFactors Averaged neighborhood factors of each user.
+   */
+  void FastMKSRecommendations(const size_t numRecs,
+                              arma::Mat<size_t>& recommendations,
+                              const arma::Col<size_t>& users,
+                              const arma::mat& averageFactors) const;
+
   /**
    * Helper function to insert a point into the recommendation matrices.
    *
@@ -63,7 +63,9 @@ CF<FactorizerType>::CF(arma::mat& data,
                        const size_t rank) :
     numUsersForSimilarity(numUsersForSimilarity),
     rank(rank),
-    factorizer(factorizer)
+    useFastMKS(false),
+    factorizer(factorizer),
+    userTree(NULL)
 {
   // Validate neighbourhood size.
   if(numUsersForSimilarity < 1)
@@ -94,6 +96,29 @@ CF<FactorizerType>::CF(arma::mat& data,
   // Operations independent of the query:
   // Decompose the sparse data matrix to user and data matrices.
   ApplyFactorizer<FactorizerType>(data, cleanedData, factorizer, this->rank, w, h);
+
+  // Build the tree used to find the neighborhoods of users.
+  BuildUserTree();
+}
+
+/**
+ * Load the CF object from a stream written by Save().
+ */
+template<typename FactorizerType>
+CF<FactorizerType>::CF(std::istream& stream) :
+    numUsersForSimilarity(5),
+    rank(0),
+    useFastMKS(false),
+    userTree(NULL)
+{
+  Load(stream);
+}
+
+template<typename FactorizerType>
+CF<FactorizerType>::~CF()
+{
+  if (userTree)
+    delete userTree;
 }
 
 template<typename FactorizerType>
@@ -116,40 +141,47 @@ void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
                                             arma::Mat<size_t>& recommendations,
                                             arma::Col<size_t>& users)
 {
-  // Generate new table by multiplying approximate values.
-  rating = w * h;
-
-  // Now, we will use the decomposed w and h matrices to estimate what the user
-  // would have rated items as, and then pick the best items.
-
-  // Temporarily store feature vector of queried users.
-  arma::mat query(rating.n_rows, users.n_elem);
-
   // Select feature vectors of queried users.
+  arma::mat query(userSpace.n_rows, users.n_elem);
   for (size_t i = 0; i < users.n_elem; i++)
-    query.col(i) = rating.col(users(i));
+    query.col(i) = userSpace.col(newFromOldUsers[users(i)]);
 
   // Temporary storage for neighborhood of the queried users.
   arma::Mat<size_t> neighborhood;
 
-  // Calculate the neighborhood of the queried users.
-  // This should be a templatized option.
-  neighbor::AllkNN a(rating, query);
+  // Calculate the neighborhood of the queried users with the user tree, which
+  // was built only once.  The neighbors are columns of userSpace.  (If the tree
+  // is a single leaf, there are too few users for a tree search to work.)
   arma::mat resultingDistances; // Temporary storage.
-  a.Search(numUsersForSimilarity, neighborhood, resultingDistances);
+  if (userTree->IsLeaf())
+  {
+    neighbor::AllkNN a(userSpace, query, true /* naive */);
+    a.Search(numUsersForSimilarity, neighborhood, resultingDistances);
+  }
+  else
+  {
+    neighbor::AllkNN a(userTree, NULL, userSpace, query, true /* single */);
+    a.Search(numUsersForSimilarity, neighborhood, resultingDistances);
+  }
 
-  // Temporary storage for storing the average rating for each user in their
-  // neighborhood.
-  arma::mat averages = arma::zeros<arma::mat>(rating.n_rows, query.n_cols);
+  // The average rating of each item in the neighborhood of a user is W times
+  // the average of the neighbors' columns of H.
+  arma::mat averageFactors = arma::zeros<arma::mat>(h.n_rows, query.n_cols);
 
   // Iterate over each query user.
   for (size_t i = 0; i < neighborhood.n_cols; ++i)
   {
     // Iterate over each neighbor of the query user.
     for (size_t j = 0; j < neighborhood.n_rows; ++j)
-      averages.col(i) += rating.col(neighborhood(j, i));
+      averageFactors.col(i) += h.col(oldFromNewUsers[neighborhood(j, i)]);
     // Normalize average.
-    averages.col(i) /= neighborhood.n_rows;
+    averageFactors.col(i) /= neighborhood.n_rows;
+  }
+
+  if (useFastMKS)
+  {
+    FastMKSRecommendations(numRecs, recommendations, users, averageFactors);
+    return;
   }
 
   // Generate recommendations for each query user by finding the maximum numRecs
@@ -158,17 +190,30 @@ void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
   recommendations.fill(cleanedData.n_rows); // Invalid item number.
   arma::mat values(numRecs, users.n_elem);
   values.fill(-DBL_MAX); // The smallest possible value.
+
+  // Estimate the ratings for a block of users at a time, keeping the block to
+  // a few million ratings.
+  const size_t blockSize = std::max((size_t) 1, std::min((size_t) users.n_elem,
+      (size_t) (1 << 22) / std::max((size_t) w.n_rows, (size_t) 1)));
+  arma::mat averages;
   for (size_t i = 0; i < users.n_elem; i++)
   {
+    const size_t blockIndex = i % blockSize;
+    if (blockIndex == 0)
+      averages = w * averageFactors.cols(i, std::min(i + blockSize,
+          (size_t) users.n_elem) - 1);
+
+    // Rule out the items that the user has already rated.
+    for (size_t k = cleanedData.col_ptrs[users(i)];
+         k < cleanedData.col_ptrs[users(i) + 1]; ++k)
+      averages(cleanedData.row_indices[k], blockIndex) = -DBL_MAX;
+
     // Look through the averages column corresponding to the current user.
     for (size_t j = 0; j < averages.n_rows; ++j)
     {
-      // Ensure that the user hasn't already rated the item.
-      if (cleanedData(j, users(i)) != 0.0)
-        continue; // The user already rated the item.
-
-      // Is the estimated value better than the worst candidate?
-      const double value = averages(j, i);
+      // Is the estimated value better than the worst candidate?  (Rated items
+      // never are.)
+      const double value = averages(j, blockIndex);
       if (value > values(values.n_rows - 1, i))
       {
         // It should be inserted.  Which position?
@@ -188,12 +233,247 @@ void CF<FactorizerType>::GetRecommendations(const size_t numRecs,
 
     // If we were not able to come up with enough recommendations, issue a
     // warning.
-    if (recommendations(values.n_rows - 1, i) == cleanedData.n_rows + 1)
+    if (recommendations(values.n_rows - 1, i) == cleanedData.n_rows)
       Log::Warn << "Could not provide " << values.n_rows << " recommendations "
           << "for user " << users(i) << " (not enough un-rated items)!" << std::endl;
   }
 }
 
+template<typename FactorizerType>
+void CF<FactorizerType>::FastMKSRecommendations(
+    const size_t numRecs,
+    arma::Mat<size_t>& recommendations,
+    const arma::Col<size_t>& users,
+    const arma::mat& averageFactors) const
+{
+  // The estimated rating of item j for a user is the inner product of row j of
+  // W with the averaged factors of the user.  Rated items will be skipped, so
+  // search for enough items to be left with numRecs for every user.
+  size_t maxRated = 0;
+  for (size_t i = 0; i < users.n_elem; ++i)
+    maxRated = std::max(maxRated, (size_t) (cleanedData.col_ptrs[users(i) + 1]
+        - cleanedData.col_ptrs[users(i)]));
+  const size_t k = std::min((size_t) w.n_rows, numRecs + maxRated);
+
+  const arma::mat items = trans(w);
+  fastmks::FastMKS<kernel::LinearKernel> mks(items, averageFactors);
+  arma::Mat<size_t> indices;
+  arma::mat products;
+  mks.Search(k, indices, products);
+
+  recommendations.set_size(numRecs, users.n_elem);
+  recommendations.fill(cleanedData.n_rows); // Invalid item number.
+  for (size_t i = 0; i < users.n_elem; ++i)
+  {
+    // The results are in decreasing order; take the best unrated items.
+    size_t found = 0;
+    for (size_t j = 0; j < k && found < numRecs; ++j)
+    {
+      if (products(j, i) == -DBL_MAX)
+        break; // No more results.
+      if (cleanedData(indices(j, i), users(i)) != 0.0)
+        continue; // The user already rated the item.
+
+      recommendations(found++, i) = indices(j, i);
+    }
+
+    if (found < numRecs)
+      Log::Warn << "Could not provide " << numRecs << " recommendations "
+          << "for user " << users(i) << " (not enough un-rated items)!"
+          << std::endl;
+  }
+}
+
+//! A (user, item) pair and its rating.
+typedef std::pair<std::pair<size_t, size_t>, double> RatingEntry;
+
+//! Order ratings by user and then item only, so that a stable sort keeps
+//! repeated ratings of the same item in their original order.
+struct RatingOrder
+{
+  bool operator()(const RatingEntry& a, const RatingEntry& b) const
+  {
+    return a.first < b.first;
+  }
+};
+
+template<typename FactorizerType>
+void CF<FactorizerType>::FoldIn(const arma::mat& ratings,
+                                const size_t sweeps,
+                                const double lambda)
+{
+  // Sort the new ratings by (user, item) so they can be merged with the
+  // columns of the cleaned data; later ratings of the same item by the same
+  // user replace earlier ones.
+  std::vector<RatingEntry> newRatings(ratings.n_cols);
+  size_t numUsers = cleanedData.n_cols;
+  size_t numItems = cleanedData.n_rows;
+  for (size_t i = 0; i < ratings.n_cols; ++i)
+  {
+    const size_t user = (size_t) ratings(0, i);
+    const size_t item = (size_t) ratings(1, i);
+    newRatings[i] = RatingEntry(std::make_pair(user, item), ratings(2, i));
+    numUsers = std::max(numUsers, user + 1);
+    numItems = std::max(numItems, item + 1);
+  }
+  std::stable_sort(newRatings.begin(), newRatings.end(), RatingOrder());
+
+  // Merge them into the cleaned data, column by column.
+  std::vector<arma::uword> rows, cols;
+  std::vector<double> values;
+  rows.reserve(cleanedData.n_nonzero + newRatings.size());
+  cols.reserve(cleanedData.n_nonzero + newRatings.size());
+  values.reserve(cleanedData.n_nonzero + newRatings.size());
+  size_t next = 0;
+  for (size_t user = 0; user < numUsers; ++user)
+  {
+    size_t k = (user < cleanedData.n_cols) ? cleanedData.col_ptrs[user] : 0;
+    const size_t end = (user < cleanedData.n_cols) ?
+        cleanedData.col_ptrs[user + 1] : 0;
+    while (k < end || (next < newRatings.size() &&
+        newRatings[next].first.first == user))
+    {
+      const bool hasNew = (next < newRatings.size() &&
+          newRatings[next].first.first == user);
+      const size_t oldItem = (k < end) ? cleanedData.row_indices[k] : numItems;
+      const size_t newItem = hasNew ? newRatings[next].first.second : numItems;
+
+      double value;
+      size_t item;
+      if (newItem <= oldItem)
+      {
+        // Skip to the last new rating of this item.
+        while (next + 1 < newRatings.size() &&
+            newRatings[next + 1].first == newRatings[next].first)
+          ++next;
+        item = newItem;
+        value = newRatings[next++].second;
+        if (oldItem == newItem)
+          ++k; // The old rating is replaced.
+      }
+      else
+      {
+        item = oldItem;
+        value = cleanedData.values[k++];
+      }
+
+      if (value != 0.0)
+      {
+        rows.push_back(item);
+        cols.push_back(user);
+        values.push_back(value);
+      }
+    }
+  }
+
+  arma::umat locations(2, values.size());
+  arma::vec ratingValues(values.size());
+  for (size_t i = 0; i < values.size(); ++i)
+  {
+    locations(0, i) = rows[i];
+    locations(1, i) = cols[i];
+    ratingValues[i] = values[i];
+  }
+  cleanedData = arma::sp_mat(locations, ratingValues, numItems, numUsers);
+
+  // New users and items start with zero factors.
+  const size_t oldItems = w.n_rows;
+  if (numItems > w.n_rows)
+    w.resize(numItems, w.n_cols);
+  if (numUsers > h.n_cols)
+    h.resize(h.n_rows, numUsers);
+
+  // Collect the affected users and items.
+  std::vector<size_t> users, items;
+  for (size_t i = 0; i < newRatings.size(); ++i)
+  {
+    if (users.empty() || users.back() != newRatings[i].first.first)
+      users.push_back(newRatings[i].first.first);
+    items.push_back(newRatings[i].first.second);
+  }
+  std::sort(items.begin(), items.end());
+  items.erase(std::unique(items.begin(), items.end()), items.end());
+
+  SolveUsers(users, lambda);
+
+  // New items need factors; and then any sweeps.
+  const size_t numSweeps = (numItems > oldItems) ? std::max(sweeps,
+      (size_t) 1) : sweeps;
+  if (numSweeps > 0)
+  {
+    const arma::sp_mat ratingsByItem = trans(cleanedData);
+    for (size_t s = 0; s < numSweeps; ++s)
+    {
+      SolveItems(ratingsByItem, items, lambda);
+      SolveUsers(users, lambda);
+    }
+  }
+
+  // The factors changed, so the neighborhoods must be found again.
+  BuildUserTree();
+}
+
+template<typename FactorizerType>
+void CF<FactorizerType>::SolveUsers(const std::vector<size_t>& users,
+                                    const double lambda)
+{
+  const size_t r = w.n_cols;
+  for (size_t u = 0; u < users.size(); ++u)
+  {
+    const size_t user = users[u];
+
+    // With no ratings, the solution is zero.
+    if (cleanedData.col_ptrs[user] == cleanedData.col_ptrs[user + 1])
+    {
+      h.col(user).zeros();
+      continue;
+    }
+
+    arma::mat a = lambda * arma::eye<arma::mat>(r, r);
+    arma::vec b = arma::zeros<arma::vec>(r);
+    for (size_t k = cleanedData.col_ptrs[user];
+         k < cleanedData.col_ptrs[user + 1]; ++k)
+    {
+      const arma::vec item = trans(w.row(cleanedData.row_indices[k]));
+      a += item * trans(item);
+      b += cleanedData.values[k] * item;
+    }
+
+    h.col(user) = arma::solve(a, b);
+  }
+}
+
+template<typename FactorizerType>
+void CF<FactorizerType>::SolveItems(const arma::sp_mat& ratingsByItem,
+                                    const std::vector<size_t>& items,
+                                    const double lambda)
+{
+  const size_t r = h.n_rows;
+  for (size_t i = 0; i < items.size(); ++i)
+  {
+    const size_t item = items[i];
+
+    // With no ratings, the solution is zero.
+    if (ratingsByItem.col_ptrs[item] == ratingsByItem.col_ptrs[item + 1])
+    {
+      w.row(item).zeros();
+      continue;
+    }
+
+    arma::mat a = lambda * arma::eye<arma::mat>(r, r);
+    arma::vec b = arma::zeros<arma::vec>(r);
+    for (size_t k = ratingsByItem.col_ptrs[item];
+         k < ratingsByItem.col_ptrs[item + 1]; ++k)
+    {
+      const arma::vec user = h.unsafe_col(ratingsByItem.row_indices[k]);
+      a += user * trans(user);
+      b += ratingsByItem.values[k] * user;
+    }
+
+    w.row(item) = trans(arma::solve(a, b));
+  }
+}
+
 template<typename FactorizerType>
 void CF<FactorizerType>::CleanData(const arma::mat& data)
 {
@@ -217,6 +497,117 @@ void CF<FactorizerType>::CleanData(const arma::mat& data)
   cleanedData = arma::sp_mat(locations, values, maxItemID, maxUserID);
 }
 
+template<typename FactorizerType>
+void CF<FactorizerType>::BuildUserTree()
+{
+  arma::vec eigval;
+  arma::mat eigvec;
+  arma::eig_sym(eigval, eigvec, trans(w) * w);
+  for (size_t i = 0; i < eigval.n_elem; ++i)
+    eigval[i] = (eigval[i] > 0.0) ? std::sqrt(eigval[i]) : 0.0;
+  userSpace = diagmat(eigval) * trans(eigvec) * h;
+
+  if (userTree)
+    delete userTree;
+  userTree = new UserTreeType(userSpace, oldFromNewUsers, newFromOldUsers);
+}
+
+template<typename FactorizerType>
+void CF<FactorizerType>::Save(std::ostream& stream) const
+{
+  const size_t magic = 0x4346444d; // "CFMD".
+  const size_t version = 1;
+  util::WriteBinary(stream, magic);
+  util::WriteBinary(stream, version);
+
+  util::WriteBinary(stream, numUsersForSimilarity);
+  util::WriteBinary(stream, rank);
+  util::WriteBinary(stream, w);
+  util::WriteBinary(stream, h);
+
+  // The rated items are stored as the arrays of the sparse matrix.
+  util::WriteBinary(stream, (size_t) cleanedData.n_rows);
+  util::WriteBinary(stream, (size_t) cleanedData.n_cols);
+  util::WriteBinary(stream, std::vector<size_t>(cleanedData.col_ptrs,
+      cleanedData.col_ptrs + cleanedData.n_cols + 1));
+  util::WriteBinary(stream, std::vector<size_t>(cleanedData.row_indices,
+      cleanedData.row_indices + cleanedData.n_nonzero));
+  util::WriteBinary(stream, std::vector<double>(cleanedData.values,
+      cleanedData.values + cleanedData.n_nonzero));
+
+  // The tree is loaded from the user space in its original order.
+  arma::mat originalUserSpace(userSpace.n_rows, userSpace.n_cols);
+  for (size_t i = 0; i < userSpace.n_cols; ++i)
+    originalUserSpace.col(oldFromNewUsers[i]) = userSpace.col(i);
+  util::WriteBinary(stream, originalUserSpace);
+  userTree->Save(stream, oldFromNewUsers);
+
+  if (!stream)
+    Log::Fatal << "CF::Save(): error writing to stream." << std::endl;
+}
+
+template<typename FactorizerType>
+void CF<FactorizerType>::Load(std::istream& stream)
+{
+  size_t magic, version;
+  util::ReadBinary(stream, magic);
+  util::ReadBinary(stream, version);
+  if (magic != 0x4346444d /* "CFMD" */ || version != 1)
+    Log::Fatal << "CF: stream does not hold a stored CF model." << std::endl;
+
+  util::ReadBinary(stream, numUsersForSimilarity);
+  util::ReadBinary(stream, rank);
+  util::ReadBinary(stream, w);
+  util::ReadBinary(stream, h);
+
+  size_t items, users;
+  std::vector<size_t> colPtrs, rowIndices;
+  std::vector<double> values;
+  util::ReadBinary(stream, items);
+  util::ReadBinary(stream, users);
+  util::ReadBinary(stream, colPtrs);
+  util::ReadBinary(stream, rowIndices);
+  util::ReadBinary(stream, values);
+
+  // Make sure the pieces fit together, so a corrupt file can't make
+  // GetRecommendations() read out of bounds.
+  bool valid = (w.n_rows == items) && (w.n_cols == h.n_rows) &&
+      (h.n_cols == users) && (colPtrs.size() == users + 1) &&
+      (colPtrs[0] == 0) && (colPtrs[users] == rowIndices.size()) &&
+      (rowIndices.size() == values.size());
+  for (size_t i = 0; valid && i < users; ++i)
+    valid = (colPtrs[i] <= colPtrs[i + 1]);
+  for (size_t i = 0; valid && i < rowIndices.size(); ++i)
+    valid = (rowIndices[i] < items);
+  if (!valid)
+    Log::Fatal << "CF: stored model is corrupt." << std::endl;
+
+  arma::umat locations(2, values.size());
+  arma::vec ratings(values.size());
+  for (size_t c = 0; c < users; ++c)
+  {
+    for (size_t i = colPtrs[c]; i < colPtrs[c + 1]; ++i)
+    {
+      locations(0, i) = rowIndices[i];
+      locations(1, i) = c;
+      ratings[i] = values[i];
+    }
+  }
+  cleanedData = arma::sp_mat(locations, ratings, items, users);
+
+  util::ReadBinary(stream, userSpace);
+  if (userSpace.n_cols != users)
+    Log::Fatal << "CF: stored model is corrupt." << std::endl;
+
+  if (userTree)
+    delete userTree;
+  userTree = new UserTreeType(userSpace, oldFromNewUsers, stream);
+
+  newFromOldUsers.resize(oldFromNewUsers.size());
+  for (size_t i = 0; i < oldFromNewUsers.size(); ++i)
+    newFromOldUsers[oldFromNewUsers[i]] = i;
+}
+
 /**
  * Helper function to insert a point into the recommendation matrices.
  *
@@ -11,6 +11,10 @@
 #include <mlpack/methods/regularized_svd/regularized_svd.hpp>
 #include "cf.hpp"
 
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
 using namespace mlpack;
 using namespace mlpack::cf;
 using namespace mlpack::amf;
@@ -28,7 +32,17 @@ PROGRAM_INFO("Collaborating Filtering", "This program performs collaborative "
     "specified with the --recommendations (-r) parameter, and the number of "
     "similar users (the size of the neighborhood) to be considered when "
     "generating recommendations can be specified with the --neighborhood (-n) "
-    "option."
+    "option.  With --fastmks (-f), the best items for each user are found "
+    "with a max-kernel search on a tree of the item factors, instead of by "
+    "scoring every item."
+    "\n\n"
+    "The factorized model can be saved with --save_model, and loaded again "
+    "with --model_file instead of giving --input_file, so that no "
+    "factorization is needed.  With --serve (-S), batches of users are read "
+    "from standard input, one batch per line (user indices separated by commas "
+    "or whitespace), and for each batch one line of recommended items per user "
+    "is written to standard output as soon as the batch is done; this is meant "
+    "for a long-running process serving recommendations from a saved model."
     "\n\n"
     "The input file should contain a 3-column matrix of ratings, where the "
     "first column is the user, the second column is the item, and the third "
@@ -39,10 +53,14 @@ PROGRAM_INFO("Collaborating Filtering", "This program performs collaborative "
     "The following optimization algorithms can be used with --algorithm (-a) "
     "parameter: "
     "\n"
-    "RegSVD -- Regularized SVD using a SGD optimizer ");
+    "RegSVD -- Regularized SVD using a SGD optimizer "
+    "\n"
+    "ALS -- Alternating least squares over only the observed ratings "
+    "\n"
+    "SVDParallelIncremental -- SGD over the ratings, in parallel blocks ");
 
 // Parameters for program.
-PARAM_STRING_REQ("input_file", "Input dataset to perform CF on.", "i");
+PARAM_STRING("input_file", "Input dataset to perform CF on.", "i", "");
 PARAM_STRING("query_file", "List of users for which recommendations are to "
     "be generated (if unspecified, then recommendations are generated for all "
     "users).", "q", "");
@@ -59,16 +77,90 @@ PARAM_INT("neighborhood", "Size of the neighborhood of similar users to "
     "consider for each query user.", "n", 5);
 
 PARAM_INT("rank", "Rank of decomposed matrices.", "R", 2);
+PARAM_FLAG("fastmks", "Find the best items for each user with FastMKS (max-"
+    "kernel search with a linear kernel) instead of scoring every item.", "f");
 
-template<typename Factorizer>
-void ComputeRecommendations(Factorizer factorizer,
-                            arma::mat& dataset,
-                            const size_t numRecs,
-                            const size_t neighbourhood,
-                            const size_t rank,
-                            arma::Mat<size_t>& recommendations)
+PARAM_STRING("model_file", "If specified, load the CF model from this file "
+    "(saved earlier with --save_model) instead of factorizing --input_file.",
+    "m", "");
+PARAM_STRING("save_model", "If specified, save the CF model to this file, so "
+    "later runs can load it with --model_file.", "", "");
+PARAM_FLAG("serve", "Read batches of users from standard input, and write "
+    "their recommendations to standard output.", "S");
+
+/**
+ * Read batches of users from stdin, one per line, and write the
+ * recommendations of each user of the batch to stdout, one line per user.
+ */
+template<typename CFType>
+void Serve(CFType& c, const size_t numRecs)
 {
-  CF<Factorizer> c(dataset, factorizer, neighbourhood, rank);
+  Log::Info << "Serving recommendations; reading batches of users from "
+      << "standard input." << endl;
+
+  const size_t numUsers = c.CleanedData().n_cols;
+  string line;
+  while (getline(cin, line))
+  {
+    std::replace(line.begin(), line.end(), ',', ' ');
+    istringstream lineStream(line);
+    vector<size_t> batch;
+    size_t user;
+    while (lineStream >> user)
+      batch.push_back(user);
+
+    if (!lineStream.eof())
+    {
+      Log::Warn << "Ignoring malformed batch '" << line << "'." << endl;
+      continue;
+    }
+
+    bool valid = true;
+    for (size_t i = 0; i < batch.size(); ++i)
+      valid = valid && (batch[i] < numUsers);
+    if (!valid)
+    {
+      Log::Warn << "Ignoring batch '" << line << "'; there are only "
+          << numUsers << " users." << endl;
+      continue;
+    }
+
+    if (batch.empty())
+      continue;
+
+    arma::Col<size_t> users(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i)
+      users[i] = batch[i];
+
+    arma::Mat<size_t> recommendations;
+    c.GetRecommendations(numRecs, recommendations, users);
+    for (size_t i = 0; i < recommendations.n_cols; ++i)
+    {
+      for (size_t j = 0; j < recommendations.n_rows; ++j)
+        cout << ((j == 0) ? "" : ", ") << recommendations(j, i);
+      cout << "\n";
+    }
+    cout << flush;
+  }
+}
+
+/**
+ * Generate the recommendations for the query users (or all users) with the
+ * given model, or serve them if --serve was given.  Returns false if the
+ * recommendations were served, and so are not to be saved.
+ */
+template<typename CFType>
+bool Recommend(CFType& c,
+               const size_t numRecs,
+               arma::Mat<size_t>& recommendations)
+{
+  c.UseFastMKS(CLI::HasParam("fastmks"));
+
+  if (CLI::HasParam("serve"))
+  {
+    Serve(c, numRecs);
+    return false;
+  }
 
   // Reading users.
   const string queryFile = CLI::GetParam<string>("query_file");
@@ -89,20 +181,40 @@ void ComputeRecommendations(Factorizer factorizer,
     Log::Info << "Generating recommendations for all users." << endl;
     c.GetRecommendations(numRecs, recommendations);
   }
+
+  return true;
+}
+
+template<typename Factorizer>
+bool ComputeRecommendations(Factorizer factorizer,
+                            arma::mat& dataset,
+                            const size_t numRecs,
+                            const size_t neighbourhood,
+                            const size_t rank,
+                            arma::Mat<size_t>& recommendations)
+{
+  CF<Factorizer> c(dataset, factorizer, neighbourhood, rank);
+
+  const string saveModel = CLI::GetParam<string>("save_model");
+  if (saveModel != "")
+  {
+    ofstream modelStream(saveModel.c_str(), ios::binary);
+    if (!modelStream.is_open())
+      Log::Fatal << "Cannot open '" << saveModel << "' for writing." << endl;
+    c.Save(modelStream);
+  }
+
+  return Recommend(c, numRecs, recommendations);
 }
-                            
-#define CR(x) ComputeRecommendations(x, dataset, numRecs, neighborhood, rank, recommendations)
+
+#define CR(x) save = ComputeRecommendations(x, dataset, numRecs, \
+    neighborhood, rank, recommendations)
 
 int main(int argc, char** argv)
 {
   // Parse command line options.
   CLI::ParseCommandLine(argc, argv);
 
-  // Read from the input file.
-  const string inputFile = CLI::GetParam<string>("input_file");
-  arma::mat dataset;
-  data::Load(inputFile, dataset, true);
-
   // Recommendation matrix.
   arma::Mat<size_t> recommendations;
 
@@ -110,12 +222,37 @@ int main(int argc, char** argv)
   const size_t numRecs = (size_t) CLI::GetParam<int>("recommendations");
   const size_t neighborhood = (size_t) CLI::GetParam<int>("neighborhood");
   const size_t rank = (size_t) CLI::GetParam<int>("rank");
+  const string outputFile = CLI::GetParam<string>("output_file");
+
+  // If a model was given, no factorization is needed.
+  const string modelFile = CLI::GetParam<string>("model_file");
+  if (modelFile != "")
+  {
+    ifstream modelStream(modelFile.c_str(), ios::binary);
+    if (!modelStream.is_open())
+      Log::Fatal << "Cannot open model file '" << modelFile << "'." << endl;
+
+    CF<> c(modelStream);
+    c.NumUsersForSimilarity(neighborhood);
+    if (Recommend(c, numRecs, recommendations))
+      data::Save(outputFile, recommendations);
+
+    return 0;
+  }
+
+  // Read from the input file.
+  const string inputFile = CLI::GetParam<string>("input_file");
+  if (inputFile == "")
+    Log::Fatal << "Either --input_file or --model_file must be given." << endl;
+  arma::mat dataset;
+  data::Load(inputFile, dataset, true);
 
   // Perform decomposition to prepare for recommendations.
   Log::Info << "Performing CF matrix decomposition on dataset..." << endl;
   
   const string algo = CLI::GetParam<string>("algorithm");
-  
+  bool save = true;
+
   if(algo == "NMF") 
     CR(NMFALSFactorizer());  
   else if(algo == "SVDBatch") 
@@ -124,9 +261,13 @@ int main(int argc, char** argv)
     CR(SparseSVDIncompleteIncrementalFactorizer());
   else if(algo == "SVDCompleteIncremental")
     CR(SparseSVDCompleteIncrementalFactorizer());
+  else if(algo == "SVDParallelIncremental")
+    CR(SparseSVDParallelIncrementalFactorizer());
   else if(algo == "RegSVD")
     CR(RegularizedSVD<>());
+  else if(algo == "ALS")
+    CR(SparseALSFactorizer());
 
-  const string outputFile = CLI::GetParam<string>("output_file");
-  data::Save(outputFile, recommendations);
+  if (save)
+    data::Save(outputFile, recommendations);
 }
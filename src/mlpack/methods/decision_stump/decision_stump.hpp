@@ -23,6 +23,13 @@ namespace decision_stump {
  * last bin has range up to \infty (split[i + 1] does not exist in that case).
  * Points that are below the first bin will take the label of the first bin.
  *
+ * Optionally, each dimension of the training data can be quantized once into
+ * a fixed number of histogram bins (of roughly equal numbers of points).  Each
+ * stump then finds its split by scanning per-bin class histograms instead of
+ * sorting every attribute, which is O(n d) for n points and d dimensions.  This
+ * is most useful for boosting, where the stumps trained from a prototype with
+ * the alternate constructor all reuse the prototype's quantization.
+ *
  * @tparam MatType Type of matrix that is being used (sparse or dense).
  */
 template <typename MatType = arma::mat>
@@ -37,11 +44,14 @@ class DecisionStump
    * @param labels Labels of training data.
    * @param classes Number of distinct classes in labels.
    * @param inpBucketSize Minimum size of bucket when splitting.
+   * @param histogramBins If nonzero, quantize each dimension of the data into
+   *     (at most) this many bins, and find splits with histograms.
    */
   DecisionStump(const MatType& data,
                 const arma::Row<size_t>& labels,
                 const size_t classes,
-                size_t inpBucketSize);
+                size_t inpBucketSize,
+                const size_t histogramBins = 0);
 
   /**
    * Classification function. After training, classify test, and put the
@@ -56,7 +66,9 @@ class DecisionStump
   /**
    * Alternate constructor which copies parameters bucketSize and numClass from
    * an already initiated decision stump, other. It appropriately sets the
-   * weight vector.
+   * weight vector.  If other was built with histogram bins, the new stump is
+   * trained with other's quantization of the data, so data must be the same
+   * dataset other was built on.
    *
    * @param other The other initiated Decision Stump object from
    *      which we copy the values.
@@ -85,6 +97,9 @@ class DecisionStump
   //! Modify the labels for each split bin (be careful!).
   arma::Col<size_t>& BinLabels() { return binLabels; }
 
+  //! Get the number of histogram bins (0 if splits are found by sorting).
+  size_t HistogramBins() const { return histogramBins; }
+
  private:
   //! Stores the number of classes.
   size_t numClass;
@@ -101,6 +116,18 @@ class DecisionStump
   //! Stores the labels for each splitting bin.
   arma::Col<size_t> binLabels;
 
+  //! The maximum number of histogram bins per dimension (0 if not used).
+  size_t histogramBins;
+
+  //! The histogram bin of each training point; column i holds dimension i.
+  arma::Mat<size_t> binnedData;
+
+  //! The smallest value in each histogram bin; column i holds dimension i.
+  arma::mat binMinimums;
+
+  //! The number of histogram bins used in each dimension.
+  arma::Col<size_t> dimensionBins;
+
   /**
    * Sets up attribute as if it were splitting on it and finds entropy when
    * splitting on attribute.
@@ -168,6 +195,53 @@ class DecisionStump
   void Train(const MatType& data, const arma::Row<size_t>& labels,
              const arma::rowvec& weightD);
 
+  /**
+   * Quantize each dimension of the data into at most histogramBins bins of
+   * roughly equal numbers of points, storing the results in binnedData,
+   * binMinimums, and dimensionBins.  Identical values always share a bin.
+   *
+   * @param data Dataset to quantize.
+   */
+  void BinData(const MatType& data);
+
+  /**
+   * Train the decision stump with histograms, using the given quantization of
+   * the data (which may belong to another decision stump).
+   *
+   * @param binned Histogram bin of each point in each dimension.
+   * @param minimums Smallest value in each histogram bin of each dimension.
+   * @param bins Number of histogram bins used in each dimension.
+   * @param labels Labels for dataset.
+   * @param weightD Weight of each point, if isWeight is true.
+   */
+  template <bool isWeight>
+  void HistogramTrain(const arma::Mat<size_t>& binned,
+                      const arma::mat& minimums,
+                      const arma::Col<size_t>& bins,
+                      const arma::Row<size_t>& labels,
+                      const arma::rowvec& weightD);
+
+  /**
+   * Split the histogram bins of one quantized attribute into buckets, and
+   * return the entropy of that split.  Buckets are grown bin by bin, and each
+   * is closed once it holds at least bucketSize points and the most frequent
+   * class changes at the next bin.
+   *
+   * @param binned Histogram bin of each point in this attribute.
+   * @param numBins Number of histogram bins used by this attribute.
+   * @param labels Labels for dataset.
+   * @param weightD Weight of each point, if isWeight is true.
+   * @param bucketBins Vector to store the first bin of each bucket in.
+   * @param bucketLabels Vector to store the label of each bucket in.
+   */
+  template <bool isWeight>
+  double HistogramSplitAttribute(const arma::Col<size_t>& binned,
+                                 const size_t numBins,
+                                 const arma::Row<size_t>& labels,
+                                 const arma::rowvec& weightD,
+                                 arma::Col<size_t>& bucketBins,
+                                 arma::Col<size_t>& bucketLabels);
+
 };
 
 }; // namespace decision_stump
@@ -21,19 +21,32 @@ namespace decision_stump {
  * @param labels Labels of data.
  * @param classes Number of distinct classes in labels.
  * @param inpBucketSize Minimum size of bucket when splitting.
+ * @param histogramBins If nonzero, the number of histogram bins to use.
  */
 template<typename MatType>
 DecisionStump<MatType>::DecisionStump(const MatType& data,
                                       const arma::Row<size_t>& labels,
                                       const size_t classes,
-                                      size_t inpBucketSize)
+                                      size_t inpBucketSize,
+                                      const size_t histogramBins) :
+    histogramBins(histogramBins)
 {
   numClass = classes;
   bucketSize = inpBucketSize;
 
   arma::rowvec weightD;
 
-  Train<false>(data, labels, weightD);
+  if (histogramBins > 0)
+  {
+    // Quantize the data once; stumps built from this one will reuse it.
+    BinData(data);
+    HistogramTrain<false>(binnedData, binMinimums, dimensionBins, labels,
+        weightD);
+  }
+  else
+  {
+    Train<false>(data, labels, weightD);
+  }
 }
 
 /**
@@ -50,32 +63,43 @@ void DecisionStump<MatType>::Train(const MatType& data, const arma::Row<size_t>&
 {
   // If classLabels are not all identical, proceed with training.
   int bestAtt = 0;
-  double entropy;
   const double rootEntropy = CalculateEntropy<size_t, isWeight>(
       labels.subvec(0, labels.n_elem - 1), 0, weightD);
 
-  double gain, bestGain = 0.0;
-  for (size_t i = 0; i < data.n_rows; i++)
+  // Each attribute is evaluated independently, so the evaluation is split
+  // across threads; the gain of each is stored so that the best attribute can
+  // then be chosen in order, exactly as a serial scan would.
+  arma::vec gains(data.n_rows);
+  arma::Col<size_t> distinct(data.n_rows);
+  #pragma omp parallel for schedule(dynamic)
+  for (omp_size_t i = 0; i < (omp_size_t) data.n_rows; i++)
   {
     // Go through each attribute of the data.
-    if (IsDistinct<double>(data.row(i)))
+    distinct[i] = IsDistinct<double>(data.row(i));
+    if (distinct[i])
     {
       // For each attribute with non-identical values, treat it as a potential
       // splitting attribute and calculate entropy if split on it.
-      entropy = SetupSplitAttribute<isWeight>(data.row(i), labels, weightD);
+      const double entropy = SetupSplitAttribute<isWeight>(data.row(i), labels,
+          weightD);
 
-      gain = rootEntropy - entropy;
-      // Find the attribute with the best entropy so that the gain is
-      // maximized.
+      gains[i] = rootEntropy - entropy;
+    }
+  }
 
-      // if (entropy < bestEntropy)
-      // Instead of the above rule, we are maximizing gain, which was
-      // what is returned from SetupSplitAttribute.
-      if (gain < bestGain)
-      {
-        bestAtt = i;
-        bestGain = gain;
-      }
+  double bestGain = 0.0;
+  for (size_t i = 0; i < data.n_rows; i++)
+  {
+    // Find the attribute with the best entropy so that the gain is
+    // maximized.
+
+    // if (entropy < bestEntropy)
+    // Instead of the above rule, we are maximizing gain, which was
+    // what is returned from SetupSplitAttribute.
+    if (distinct[i] && gains[i] < bestGain)
+    {
+      bestAtt = i;
+      bestGain = gains[i];
     }
   }
   splitAttribute = bestAtt;
@@ -96,22 +120,20 @@ template<typename MatType>
 void DecisionStump<MatType>::Classify(const MatType& test,
                                       arma::Row<size_t>& predictedLabels)
 {
-  for (size_t i = 0; i < test.n_cols; i++)
-  {
-    // Determine which bin the test point falls into.
-    // Assume first that it falls into the first bin, then proceed through the
-    // bins until it is known which bin it falls into.
-    size_t bin = 0;
-    const double val = test(splitAttribute, i);
-
-    while (bin < split.n_elem - 1)
-    {
-      if (val < split(bin + 1))
-        break;
+  predictedLabels.set_size(test.n_cols);
 
-      ++bin;
-    }
+  // The bins are sorted, so the bin of a point is the number of bins after the
+  // first whose lower end is not above its value.  (A NaN value falls into the
+  // last bin, as no comparison with it is true.)  Each point is independent of
+  // the others, so large sets are split between the threads.
+  const double* binsBegin = split.memptr() + 1;
+  const double* binsEnd = split.memptr() + split.n_elem;
 
+  #pragma omp parallel for if (test.n_cols >= 4096)
+  for (omp_size_t i = 0; i < (omp_size_t) test.n_cols; i++)
+  {
+    const double val = test(splitAttribute, i);
+    const size_t bin = std::upper_bound(binsBegin, binsEnd, val) - binsBegin;
     predictedLabels(i) = binLabels(bin);
   }
 }
@@ -138,11 +160,210 @@ DecisionStump<MatType>::DecisionStump(
 {
   numClass = other.numClass;
   bucketSize = other.bucketSize;
+  histogramBins = other.histogramBins;
 
   // weightD = weights;
   // tempD = weightD;
 
-  Train<true>(data, labels, weights);
+  if (histogramBins > 0)
+  {
+    // The quantization is only borrowed from other; it is not copied, so that
+    // boosted stumps stay small.
+    if (other.binnedData.n_rows != data.n_cols)
+      Log::Fatal << "DecisionStump::DecisionStump(): the other decision stump "
+          << "holds no quantization of this data; it must be built on the same "
+          << "data with the first constructor." << std::endl;
+
+    HistogramTrain<true>(other.binnedData, other.binMinimums,
+        other.dimensionBins, labels, weights);
+  }
+  else
+  {
+    Train<true>(data, labels, weights);
+  }
+}
+
+/**
+ * Quantize each dimension of the data into histogram bins.
+ *
+ * @param data Dataset to quantize.
+ */
+template <typename MatType>
+void DecisionStump<MatType>::BinData(const MatType& data)
+{
+  binnedData.set_size(data.n_cols, data.n_rows);
+  binMinimums.zeros(histogramBins, data.n_rows);
+  dimensionBins.set_size(data.n_rows);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (omp_size_t i = 0; i < (omp_size_t) data.n_rows; ++i)
+  {
+    const arma::rowvec attribute = data.row(i);
+    const arma::uvec order = arma::stable_sort_index(attribute.t());
+
+    // Walk through the points in sorted order, moving to the next bin once
+    // enough points have been seen, but never between two identical values.
+    size_t bin = 0;
+    binMinimums(0, i) = attribute[order[0]];
+    for (size_t r = 0; r < order.n_elem; ++r)
+    {
+      const double value = attribute[order[r]];
+      if ((r > 0) && (value != attribute[order[r - 1]]) &&
+          ((r * histogramBins) / order.n_elem > bin))
+      {
+        ++bin;
+        binMinimums(bin, i) = value;
+      }
+
+      binnedData(order[r], i) = bin;
+    }
+
+    dimensionBins[i] = bin + 1;
+  }
+}
+
+/**
+ * Train the decision stump with histograms of the quantized data.
+ *
+ * @param binned Histogram bin of each point in each dimension.
+ * @param minimums Smallest value in each histogram bin of each dimension.
+ * @param bins Number of histogram bins used in each dimension.
+ * @param labels Labels for dataset.
+ * @param weightD Weight of each point, if isWeight is true.
+ */
+template <typename MatType>
+template <bool isWeight>
+void DecisionStump<MatType>::HistogramTrain(const arma::Mat<size_t>& binned,
+                                            const arma::mat& minimums,
+                                            const arma::Col<size_t>& bins,
+                                            const arma::Row<size_t>& labels,
+                                            const arma::rowvec& weightD)
+{
+  // As in Train(), the attributes are evaluated in parallel and the best one is
+  // then chosen in order.  Only attributes with more than one bin (that is,
+  // with non-identical values) are candidates.
+  arma::vec entropies(binned.n_cols);
+  #pragma omp parallel for schedule(dynamic)
+  for (omp_size_t i = 0; i < (omp_size_t) binned.n_cols; ++i)
+  {
+    if (bins[i] > 1)
+    {
+      arma::Col<size_t> bucketBins, bucketLabels;
+      entropies[i] = HistogramSplitAttribute<isWeight>(binned.unsafe_col(i),
+          bins[i], labels, weightD, bucketBins, bucketLabels);
+    }
+  }
+
+  // The root entropy is the same for every attribute, so maximizing the gain is
+  // the same as maximizing the entropy returned for the split.
+  splitAttribute = 0;
+  bool found = false;
+  for (size_t i = 0; i < binned.n_cols; ++i)
+  {
+    if ((bins[i] > 1) && (!found || entropies[i] > entropies[splitAttribute]))
+    {
+      splitAttribute = i;
+      found = true;
+    }
+  }
+
+  // Build the bins of the stump from the buckets of the chosen attribute.
+  arma::Col<size_t> bucketBins;
+  HistogramSplitAttribute<isWeight>(binned.unsafe_col(splitAttribute),
+      bins[splitAttribute], labels, weightD, bucketBins, binLabels);
+
+  split.set_size(bucketBins.n_elem);
+  for (size_t i = 0; i < bucketBins.n_elem; ++i)
+    split[i] = minimums(bucketBins[i], splitAttribute);
+
+  MergeRanges();
+}
+
+/**
+ * Split the histogram bins of one quantized attribute into buckets and return
+ * the entropy of the split.
+ *
+ * @param binned Histogram bin of each point in this attribute.
+ * @param numBins Number of histogram bins used by this attribute.
+ * @param labels Labels for dataset.
+ * @param weightD Weight of each point, if isWeight is true.
+ * @param bucketBins Vector to store the first bin of each bucket in.
+ * @param bucketLabels Vector to store the label of each bucket in.
+ */
+template <typename MatType>
+template <bool isWeight>
+double DecisionStump<MatType>::HistogramSplitAttribute(
+    const arma::Col<size_t>& binned,
+    const size_t numBins,
+    const arma::Row<size_t>& labels,
+    const arma::rowvec& weightD,
+    arma::Col<size_t>& bucketBins,
+    arma::Col<size_t>& bucketLabels)
+{
+  // Build the histograms: the number of points in each bin, and the mass
+  // (weight, or count) of each class in each bin.
+  arma::Col<size_t> counts(numBins);
+  counts.zeros();
+  arma::mat mass(numClass, numBins);
+  mass.zeros();
+  for (size_t j = 0; j < binned.n_elem; ++j)
+  {
+    ++counts[binned[j]];
+    mass(labels[j], binned[j]) += (isWeight) ? weightD[j] : 1.0;
+  }
+
+  // The most frequent class in each bin.
+  arma::Col<size_t> binMajority(numBins);
+  arma::uword index;
+  for (size_t b = 0; b < numBins; ++b)
+  {
+    mass.unsafe_col(b).max(index);
+    binMajority[b] = index;
+  }
+
+  bucketBins.set_size(numBins);
+  bucketLabels.set_size(numBins);
+  size_t numBuckets = 0;
+
+  double entropy = 0.0;
+  arma::vec bucketMass(numClass);
+  bucketMass.zeros();
+  size_t bucketCount = 0;
+  size_t bucketBegin = 0;
+  for (size_t b = 0; b < numBins; ++b)
+  {
+    bucketMass += mass.col(b);
+    bucketCount += counts[b];
+
+    if ((b == numBins - 1) || ((bucketCount >= bucketSize) &&
+        (binMajority[b] != binMajority[b + 1])))
+    {
+      // Close this bucket.
+      const double totalMass = arma::accu(bucketMass);
+      double bucketEntropy = 0.0;
+      for (size_t c = 0; c < numClass; ++c)
+      {
+        const double p1 = (totalMass > 0.0) ? (bucketMass[c] / totalMass) : 0.0;
+        bucketEntropy += (p1 == 0) ? 0 : p1 * std::log(p1);
+      }
+
+      entropy += ((double) bucketCount / binned.n_elem) * bucketEntropy;
+
+      bucketMass.max(index);
+      bucketBins[numBuckets] = bucketBegin;
+      bucketLabels[numBuckets] = index;
+      ++numBuckets;
+
+      bucketMass.zeros();
+      bucketCount = 0;
+      bucketBegin = b + 1;
+    }
+  }
+
+  bucketBins.resize(numBuckets);
+  bucketLabels.resize(numBuckets);
+
+  return entropy / std::log(2.0);
 }
 
 /**
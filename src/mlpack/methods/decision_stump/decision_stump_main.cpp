@@ -18,7 +18,10 @@ PROGRAM_INFO("Decision Stump",
     "and will split into multiple buckets.  The dimension and bins are selected"
     " by maximizing the information gain of the split.  Optionally, the minimum"
     " number of training points in each bin can be specified with the "
-    "--bin_size (-b) parameter.\n"
+    "--bin_size (-b) parameter.  For large datasets, each dimension can instead"
+    " be quantized into a fixed number of histogram bins, given with the "
+    "--histogram_bins (-H) parameter, so that splits are found without sorting."
+    "\n"
     "\n"
     "The decision stump is parameterized by a splitting dimension and a vector "
     "of values that denote the splitting values of each bin.\n"
@@ -46,6 +49,8 @@ PARAM_STRING("output_file", "The file in which the predicted labels for the "
 
 PARAM_INT("bin_size", "The minimum number of training points in each "
     "decision stump bin.", "b", 6);
+PARAM_INT("histogram_bins", "If nonzero, quantize each dimension into this "
+    "many histogram bins and find splits with histograms.", "H", 0);
 
 int main(int argc, char *argv[])
 {
@@ -84,6 +89,11 @@ int main(int argc, char *argv[])
   const size_t inpBucketSize = CLI::GetParam<int>("bucket_size");
   const size_t numClasses = labels.max() + 1;
 
+  if (CLI::GetParam<int>("histogram_bins") < 0)
+    Log::Fatal << "Number of histogram bins (--histogram_bins) must be "
+        << "nonnegative!" << std::endl;
+  const size_t histogramBins = CLI::GetParam<int>("histogram_bins");
+
   // Load the test file.
   const string testingDataFilename = CLI::GetParam<std::string>("test_file");
   mat testingData;
@@ -96,7 +106,7 @@ int main(int argc, char *argv[])
 
   Timer::Start("training");
   DecisionStump<> ds(trainingData, labels.t(), numClasses,
-                     inpBucketSize);
+                     inpBucketSize, histogramBins);
   Timer::Stop("training");
 
   Row<size_t> predictedLabels(testingData.n_cols);
@@ -115,10 +115,13 @@ int main(int argc, char *argv[])
 
     // Compute density estimates for each point in the training set.
     Timer::Start("det_estimation_time");
-    for (size_t i = 0; i < trainingData.n_cols; i++)
-      fprintf(fp, "%lg\n", dtreeOpt->ComputeValue(trainingData.unsafe_col(i)));
+    arma::vec estimates;
+    dtreeOpt->ComputeValues(trainingData, estimates);
     Timer::Stop("det_estimation_time");
 
+    for (size_t i = 0; i < estimates.n_elem; i++)
+      fprintf(fp, "%lg\n", estimates[i]);
+
     fclose(fp);
   }
 
@@ -137,10 +140,13 @@ int main(int argc, char *argv[])
       fp = fopen(CLI::GetParam<string>("test_set_estimates_file").c_str(), "w");
 
       Timer::Start("det_test_set_estimation");
-      for (size_t i = 0; i < testData.n_cols; i++)
-        fprintf(fp, "%lg\n", dtreeOpt->ComputeValue(testData.unsafe_col(i)));
+      arma::vec estimates;
+      dtreeOpt->ComputeValues(testData, estimates);
       Timer::Stop("det_test_set_estimation");
 
+      for (size_t i = 0; i < estimates.n_elem; i++)
+        fprintf(fp, "%lg\n", estimates[i]);
+
       fclose(fp);
     }
   }
@@ -129,11 +129,10 @@ DTree* mlpack::det::Trainer(arma::mat& dataset,
     std::ofstream outfile(unprunedTreeOutput.c_str());
     if (outfile.good())
     {
-      for (size_t i = 0; i < dataset.n_cols; ++i)
-      {
-        arma::vec testPoint = dataset.unsafe_col(i);
-        outfile << dtree->ComputeValue(testPoint) << std::endl;
-      }
+      arma::vec values;
+      dtree->ComputeValues(dataset, values);
+      for (size_t i = 0; i < values.n_elem; ++i)
+        outfile << values[i] << std::endl;
     }
     else
     {
@@ -170,34 +169,41 @@ DTree* mlpack::det::Trainer(arma::mat& dataset,
 
   delete dtree;
 
-  arma::mat cvData(dataset);
   size_t testSize = dataset.n_cols / folds;
 
-  std::vector<double> regularizationConstants;
-  regularizationConstants.resize(prunedSequence.size(), 0);
+  // Each fold accumulates its own contribution to the regularization
+  // constants, so the folds can be evaluated in parallel; the contributions are
+  // summed in fold order afterwards, which gives the same result as a serial
+  // evaluation.
+  std::vector<std::vector<double> > foldConstants(folds,
+      std::vector<double>(prunedSequence.size(), 0.0));
 
   // Go through each fold.
-  for (size_t fold = 0; fold < folds; fold++)
+  #pragma omp parallel for schedule(dynamic)
+  for (omp_size_t fold = 0; fold < (omp_size_t) folds; fold++)
   {
+    std::vector<double>& constants = foldConstants[fold];
+
     // Break up data into train and test sets.
     size_t start = fold * testSize;
-    size_t end = std::min((fold + 1) * testSize, (size_t) cvData.n_cols);
+    size_t end = std::min((fold + 1) * testSize, (size_t) dataset.n_cols);
 
-    arma::mat test = cvData.cols(start, end - 1);
-    arma::mat train(cvData.n_rows, cvData.n_cols - test.n_cols);
+    arma::mat test = dataset.cols(start, end - 1);
+    arma::mat train(dataset.n_rows, dataset.n_cols - test.n_cols);
 
-    if (start == 0 && end < cvData.n_cols)
+    if (start == 0 && end < dataset.n_cols)
     {
-      train.cols(0, train.n_cols - 1) = cvData.cols(end, cvData.n_cols - 1);
+      train.cols(0, train.n_cols - 1) = dataset.cols(end, dataset.n_cols - 1);
     }
-    else if (start > 0 && end == cvData.n_cols)
+    else if (start > 0 && end == dataset.n_cols)
     {
-      train.cols(0, train.n_cols - 1) = cvData.cols(0, start - 1);
+      train.cols(0, train.n_cols - 1) = dataset.cols(0, start - 1);
     }
     else
     {
-      train.cols(0, start - 1) = cvData.cols(0, start - 1);
-      train.cols(start, train.n_cols - 1) = cvData.cols(end, cvData.n_cols - 1);
+      train.cols(0, start - 1) = dataset.cols(0, start - 1);
+      train.cols(start, train.n_cols - 1) = dataset.cols(end,
+          dataset.n_cols - 1);
     }
 
     // Initialize the tree.
@@ -209,9 +215,10 @@ DTree* mlpack::det::Trainer(arma::mat& dataset,
       cvOldFromNew[i] = i;
 
     // Grow the tree.
-    oldAlpha = 0.0;
-    alpha = cvDTree->Grow(train, cvOldFromNew, useVolumeReg, maxLeafSize,
-        minLeafSize);
+    cvDTree->Grow(train, cvOldFromNew, useVolumeReg, maxLeafSize, minLeafSize);
+
+    // Density estimates of the test points.
+    arma::vec testValues;
 
     // Sequentially prune with all the values of available alphas and adding
     // values for test values.  Don't enter this loop if there are less than two
@@ -220,38 +227,40 @@ DTree* mlpack::det::Trainer(arma::mat& dataset,
          i < ((prunedSequence.size() < 2) ? 0 : prunedSequence.size() - 2); ++i)
     {
       // Compute test values for this state of the tree.
+      cvDTree->ComputeValues(test, testValues);
       double cvVal = 0.0;
-      for (size_t j = 0; j < test.n_cols; j++)
-      {
-        arma::vec testPoint = test.unsafe_col(j);
-        cvVal += cvDTree->ComputeValue(testPoint);
-      }
+      for (size_t j = 0; j < testValues.n_elem; j++)
+        cvVal += testValues[j];
 
       // Update the cv regularization constant.
-      regularizationConstants[i] += 2.0 * cvVal / (double) dataset.n_cols;
+      constants[i] += 2.0 * cvVal / (double) dataset.n_cols;
 
       // Determine the new alpha value and prune accordingly.
-      oldAlpha = 0.5 * (prunedSequence[i + 1].first +
+      const double foldAlpha = 0.5 * (prunedSequence[i + 1].first +
           prunedSequence[i + 2].first);
-      alpha = cvDTree->PruneAndUpdate(oldAlpha, train.n_cols, useVolumeReg);
+      cvDTree->PruneAndUpdate(foldAlpha, train.n_cols, useVolumeReg);
     }
 
     // Compute test values for this state of the tree.
+    cvDTree->ComputeValues(test, testValues);
     double cvVal = 0.0;
-    for (size_t i = 0; i < test.n_cols; ++i)
-    {
-      arma::vec testPoint = test.unsafe_col(i);
-      cvVal += cvDTree->ComputeValue(testPoint);
-    }
+    for (size_t i = 0; i < testValues.n_elem; ++i)
+      cvVal += testValues[i];
 
     if (prunedSequence.size() > 2)
-      regularizationConstants[prunedSequence.size() - 2] += 2.0 * cvVal /
+      constants[prunedSequence.size() - 2] += 2.0 * cvVal /
           (double) dataset.n_cols;
 
     test.reset();
     delete cvDTree;
   }
 
+  std::vector<double> regularizationConstants;
+  regularizationConstants.resize(prunedSequence.size(), 0);
+  for (size_t fold = 0; fold < folds; fold++)
+    for (size_t i = 0; i < prunedSequence.size(); ++i)
+      regularizationConstants[i] += foldConstants[fold][i];
+
   double optimalAlpha = -1.0;
   long double cvBestError = -std::numeric_limits<long double>::max();
 
@@ -130,7 +130,8 @@ bool DTree::FindSplit(const arma::mat& data,
                       double& splitValue,
                       double& leftError,
                       double& rightError,
-                      const size_t minLeafSize) const
+                      const size_t minLeafSize,
+                      const arma::Mat<size_t>* sortedIndices) const
 {
   // Ensure the dimensionality of the data is the same as the dimensionality of
   // the bounding rectangle.
@@ -165,11 +166,19 @@ bool DTree::FindSplit(const arma::mat& data,
     // Find the log volume of all the other dimensions.
     double volumeWithoutDim = logVolume - std::log(max - min);
 
-    // Get the values for the dimension.
-    arma::rowvec dimVec = data.row(dim).subvec(start, end - 1);
-
-    // Sort the values in ascending order.
-    dimVec = arma::sort(dimVec);
+    // Get the values for the dimension, in ascending order.
+    arma::rowvec dimVec;
+    if (sortedIndices != NULL)
+    {
+      dimVec.set_size(points);
+      for (size_t i = 0; i < points; ++i)
+        dimVec[i] = data(dim, (*sortedIndices)(start + i, dim));
+    }
+    else
+    {
+      dimVec = data.row(dim).subvec(start, end - 1);
+      dimVec = arma::sort(dimVec);
+    }
 
     // Find the best split for this dimension.  We need to figure out why
     // there are spikes if this minLeafSize is enforced here...
@@ -271,6 +280,37 @@ double DTree::Grow(arma::mat& data,
                    const bool useVolReg,
                    const size_t maxLeafSize,
                    const size_t minLeafSize)
+{
+  // Sort the points in each dimension once; the sorted lists are partitioned
+  // along with the points at each split.
+  arma::Mat<size_t> sortedIndices(end, data.n_rows);
+  for (size_t dim = 0; dim < data.n_rows; ++dim)
+  {
+    const arma::vec values = trans(data.row(dim).subvec(start, end - 1));
+    const arma::uvec order = arma::sort_index(values);
+    for (size_t i = 0; i < order.n_elem; ++i)
+      sortedIndices(start + i, dim) = start + order[i];
+  }
+
+  // The children of large nodes are grown as OpenMP tasks, which need an
+  // enclosing parallel region.
+  double alpha = 0.0;
+  #pragma omp parallel if ((end - start) >= ParallelGrowThreshold)
+  {
+    #pragma omp single
+    alpha = GrowNode(data, oldFromNew, sortedIndices, useVolReg, maxLeafSize,
+        minLeafSize);
+  }
+
+  return alpha;
+}
+
+double DTree::GrowNode(arma::mat& data,
+                       arma::Col<size_t>& oldFromNew,
+                       arma::Mat<size_t>& sortedIndices,
+                       const bool useVolReg,
+                       const size_t maxLeafSize,
+                       const size_t minLeafSize)
 {
   Log::Assert(data.n_rows == maxVals.n_elem);
   Log::Assert(data.n_rows == minVals.n_elem);
@@ -293,12 +333,48 @@ double DTree::Grow(arma::mat& data,
     size_t dim;
     double splitValueTmp;
     double leftError, rightError;
-    if (FindSplit(data, dim, splitValueTmp, leftError, rightError, minLeafSize))
+    if (FindSplit(data, dim, splitValueTmp, leftError, rightError, minLeafSize,
+        &sortedIndices))
     {
       // Move the data around for the children to have points in a node lie
-      // contiguously (to increase efficiency during the training).
+      // contiguously (to increase efficiency during the training).  SplitData()
+      // moves the entries of oldFromNew along with the points, so filling this
+      // node's range of it with column indices first tells us where each point
+      // came from.
+      const arma::Col<size_t> nodeOldFromNew = oldFromNew.subvec(start,
+          end - 1);
+      for (size_t i = start; i < end; ++i)
+        oldFromNew[i] = i;
+
       const size_t splitIndex = SplitData(data, dim, splitValueTmp, oldFromNew);
 
+      arma::Col<size_t> newFromOld(end - start);
+      for (size_t i = start; i < end; ++i)
+      {
+        newFromOld[oldFromNew[i] - start] = i;
+        oldFromNew[i] = nodeOldFromNew[oldFromNew[i] - start];
+      }
+
+      // Partition the sorted lists of every dimension into the lists of the
+      // two children, keeping them sorted.
+      arma::Col<size_t> partitioned(end - start);
+      for (size_t d = 0; d < data.n_rows; ++d)
+      {
+        size_t leftIndex = 0;
+        size_t rightIndex = splitIndex - start;
+        for (size_t i = start; i < end; ++i)
+        {
+          const size_t column = newFromOld[sortedIndices(i, d) - start];
+          if (column < splitIndex)
+            partitioned[leftIndex++] = column;
+          else
+            partitioned[rightIndex++] = column;
+        }
+
+        for (size_t i = start; i < end; ++i)
+          sortedIndices(i, d) = partitioned[i - start];
+      }
+
       // Make max and min vals for the children.
       arma::vec maxValsL(maxVals);
       arma::vec maxValsR(maxVals);
@@ -316,10 +392,17 @@ double DTree::Grow(arma::mat& data,
       left = new DTree(maxValsL, minValsL, start, splitIndex, leftError);
       right = new DTree(maxValsR, minValsR, splitIndex, end, rightError);
 
-      leftG = left->Grow(data, oldFromNew, useVolReg, maxLeafSize,
-          minLeafSize);
-      rightG = right->Grow(data, oldFromNew, useVolReg, maxLeafSize,
-          minLeafSize);
+      // The children hold disjoint ranges of the dataset and of oldFromNew, so
+      // for large nodes they can be grown at the same time.
+      #pragma omp task shared(data, oldFromNew, sortedIndices, leftG) \
+          if ((end - start) >= ParallelGrowThreshold)
+      leftG = left->GrowNode(data, oldFromNew, sortedIndices, useVolReg,
+          maxLeafSize, minLeafSize);
+      #pragma omp task shared(data, oldFromNew, sortedIndices, rightG) \
+          if ((end - start) >= ParallelGrowThreshold)
+      rightG = right->GrowNode(data, oldFromNew, sortedIndices, useVolReg,
+          maxLeafSize, minLeafSize);
+      #pragma omp taskwait
 
       // Store values of R(T~) and |T~|.
       subtreeLeaves = left->SubtreeLeaves() + right->SubtreeLeaves();
@@ -570,6 +653,90 @@ double DTree::ComputeValue(const arma::vec& query) const
 }
 
 
+void DTree::ComputeValues(const arma::mat& queries, arma::vec& values) const
+{
+  Log::Assert(queries.n_rows == maxVals.n_elem);
+
+  std::vector<FlatNode> nodes;
+  Flatten(nodes);
+
+  values.set_size(queries.n_cols);
+
+  // Process the points in blocks; each block is routed down the tree together.
+  const size_t blockSize = 4096;
+  const size_t numBlocks = (queries.n_cols + blockSize - 1) / blockSize;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (omp_size_t block = 0; block < (omp_size_t) numBlocks; ++block)
+  {
+    const size_t blockBegin = block * blockSize;
+    const size_t blockEnd = std::min(blockBegin + blockSize,
+        (size_t) queries.n_cols);
+
+    // Points outside the range of the root have zero density.
+    std::vector<size_t> indices;
+    indices.reserve(blockEnd - blockBegin);
+    for (size_t i = blockBegin; i < blockEnd; ++i)
+    {
+      if (root && !WithinRange(queries.unsafe_col(i)))
+        values[i] = 0.0;
+      else
+        indices.push_back(i);
+    }
+
+    if (!indices.empty())
+      RouteQueries(nodes, 0, queries, indices, 0, indices.size(), values);
+  }
+}
+
+void DTree::Flatten(std::vector<FlatNode>& nodes) const
+{
+  const size_t index = nodes.size();
+  nodes.push_back(FlatNode());
+
+  if (subtreeLeaves == 1) // If we are a leaf...
+  {
+    nodes[index].right = 0;
+    nodes[index].density = std::exp(std::log(ratio) - logVolume);
+    return;
+  }
+
+  nodes[index].splitDim = splitDim;
+  nodes[index].splitValue = splitValue;
+
+  left->Flatten(nodes);
+  nodes[index].right = nodes.size();
+  right->Flatten(nodes);
+}
+
+void DTree::RouteQueries(const std::vector<FlatNode>& nodes,
+                         const size_t node,
+                         const arma::mat& queries,
+                         std::vector<size_t>& indices,
+                         const size_t begin,
+                         const size_t end,
+                         arma::vec& values)
+{
+  const FlatNode& flatNode = nodes[node];
+  if (flatNode.right == 0)
+  {
+    for (size_t i = begin; i < end; ++i)
+      values[indices[i]] = flatNode.density;
+    return;
+  }
+
+  // Move the queries which go left to the front of the range.
+  size_t middle = begin;
+  for (size_t i = begin; i < end; ++i)
+    if (queries(flatNode.splitDim, indices[i]) <= flatNode.splitValue)
+      std::swap(indices[i], indices[middle++]);
+
+  if (middle > begin)
+    RouteQueries(nodes, node + 1, queries, indices, begin, middle, values);
+  if (middle < end)
+    RouteQueries(nodes, flatNode.right, queries, indices, middle, end, values);
+}
+
 void DTree::WriteTree(FILE *fp, const size_t level) const
 {
   if (subtreeLeaves > 1)
@@ -106,7 +106,9 @@ class DTree
 
   /**
    * Greedily expand the tree.  The points in the dataset will be reordered
-   * during tree growth.
+   * during tree growth.  The children of a node hold disjoint ranges of the
+   * dataset, so if OpenMP is enabled, the subtrees of large nodes are grown
+   * concurrently.
    *
    * @param data Dataset to build tree on.
    * @param oldFromNew Mappings from old points to new points.
@@ -139,6 +141,18 @@ class DTree
    */
   double ComputeValue(const arma::vec& query) const;
 
+  /**
+   * Compute the density estimate of every point in the given matrix.  This
+   * gives the same results as calling ComputeValue() on each column, but the
+   * tree is first flattened into a contiguous array of nodes, and blocks of
+   * points are routed down it together by partitioning their indices at each
+   * split.  If OpenMP is enabled, blocks are processed in parallel.
+   *
+   * @param queries Points to estimate the density of (one per column).
+   * @param values Vector to store the density estimates in.
+   */
+  void ComputeValues(const arma::mat& queries, arma::vec& values) const;
+
   /**
    * Print the tree in a depth-first manner (this function is called
    * recursively).
@@ -288,14 +302,18 @@ class DTree
   // Utility methods.
 
   /**
-   * Find the dimension to split on.
+   * Find the dimension to split on.  If sortedIndices is given, column d of it
+   * must hold the columns of the points in this node (in the range [start,
+   * end)), sorted by their values in dimension d; otherwise the values of each
+   * dimension are sorted here.
    */
   bool FindSplit(const arma::mat& data,
                  size_t& splitDim,
                  double& splitValue,
                  double& leftError,
                  double& rightError,
-                 const size_t minLeafSize = 5) const;
+                 const size_t minLeafSize = 5,
+                 const arma::Mat<size_t>* sortedIndices = NULL) const;
 
   /**
    * Split the data, returning the number of points left of the split.
@@ -305,6 +323,61 @@ class DTree
                    const double splitValue,
                    arma::Col<size_t>& oldFromNew) const;
 
+  //! A node of the flattened tree used by ComputeValues().
+  struct FlatNode
+  {
+    //! The splitting dimension (internal nodes only).
+    size_t splitDim;
+    //! The split value (internal nodes only).
+    double splitValue;
+    //! The index of the right child, or 0 for a leaf.  The left child of an
+    //! internal node always directly follows it.
+    size_t right;
+    //! The density of the node (leaves only).
+    double density;
+  };
+
+  /**
+   * Append the subtree rooted at this node to the given flattened tree, in
+   * depth-first order.
+   */
+  void Flatten(std::vector<FlatNode>& nodes) const;
+
+  /**
+   * Route the queries with indices in [begin, end) down the flattened subtree
+   * rooted at the given node, storing the density of the leaf each one falls
+   * into.  The order of the indices is changed.
+   */
+  static void RouteQueries(const std::vector<FlatNode>& nodes,
+                           const size_t node,
+                           const arma::mat& queries,
+                           std::vector<size_t>& indices,
+                           const size_t begin,
+                           const size_t end,
+                           arma::vec& values);
+
+  /**
+   * Nodes with at least this many points grow their two children as separate
+   * OpenMP tasks; below this size, the overhead of a task is larger than the
+   * work saved.
+   */
+  static const size_t ParallelGrowThreshold = 1000;
+
+  /**
+   * Greedily expand the subtree rooted at this node; the children of large
+   * nodes are grown as OpenMP tasks.  Grow() calls this from inside a parallel
+   * region.  The points of each node are kept sorted in every dimension in
+   * sortedIndices (see FindSplit()), which is partitioned along with the data
+   * at each split, so no node has to sort its points.  The other parameters
+   * are the same as for Grow().
+   */
+  double GrowNode(arma::mat& data,
+                  arma::Col<size_t>& oldFromNew,
+                  arma::Mat<size_t>& sortedIndices,
+                  const bool useVolReg,
+                  const size_t maxLeafSize,
+                  const size_t minLeafSize);
+
 };
 
 }; // namespace det
@@ -27,6 +27,7 @@
 #include <mlpack/core/metrics/lmetric.hpp>
 
 #include <mlpack/core/tree/binary_space_tree.hpp>
+#include <mlpack/core/tree/instrumented_rules.hpp>
 
 namespace mlpack {
 namespace emst /** Euclidean Minimum Spanning Trees. */ {
@@ -68,10 +69,13 @@ namespace emst /** Euclidean Minimum Spanning Trees. */ {
  * tree type needs to compute bounds using the same metric as the type
  * specified here.
  * @tparam TreeType Type of tree to use.  Should use DTBStat as a statistic.
+ * @tparam InstrumentationType Policy to record details of the tree traversals
+ *     with; see tree::TraversalInstrumentation.  The default records nothing.
  */
 template<
   typename MetricType = metric::EuclideanDistance,
-  typename TreeType = tree::BinarySpaceTree<bound::HRectBound<2>, DTBStat>
+  typename TreeType = tree::BinarySpaceTree<bound::HRectBound<2>, DTBStat>,
+  typename InstrumentationType = tree::NoTraversalInstrumentation
 >
 class DualTreeBoruvka
 {
@@ -110,6 +114,12 @@ class DualTreeBoruvka
   //! The instantiated metric.
   MetricType metric;
 
+  //! The number of threads to use (0 means all available).
+  size_t threads;
+
+  //! The details of the tree traversals.
+  InstrumentationType instrumentation;
+
   //! For sorting the edge list after the computation.
   struct SortEdgesHelper
   {
@@ -165,10 +175,27 @@ class DualTreeBoruvka
    * index of the edge; the second row will contain the greater index of the
    * edge; and the third row will contain the distance between the two edges.
    *
+   * If mlpack was compiled with OpenMP, the search for the nearest neighbor of
+   * each component in every round is split over the number of threads given
+   * by Threads(), each of which traverses a disjoint subtree of the query tree
+   * (or a block of query points, in naive mode).  Each thread keeps its own
+   * candidate edge for each component, and these are merged after each round.
+   *
    * @param results Matrix which results will be stored in.
    */
   void ComputeMST(arma::mat& results);
 
+  //! Get the number of threads used (0 means all available threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available threads).  This
+  //! has no effect if mlpack was compiled without OpenMP.
+  size_t& Threads() { return threads; }
+
+  //! Get the details of the tree traversals recorded by ComputeMST().
+  const InstrumentationType& Instrumentation() const { return instrumentation; }
+  //! Modify the details of the tree traversals (i.e. to reset them).
+  InstrumentationType& Instrumentation() { return instrumentation; }
+
   /**
    * Returns a string representation of this object.
    */
@@ -181,15 +208,25 @@ class DualTreeBoruvka
   void AddEdge(const size_t e1, const size_t e2, const double distance);
 
   /**
-   * Adds all the edges found in one iteration to the list of neighbors.
+   * Adds all the edges found in one iteration to the list of neighbors, then
+   * flattens the union-find structure using the given number of threads.
    */
-  void AddAllEdges();
+  void AddAllEdges(const size_t numThreads);
 
   /**
    * Unpermute the edge list and output it to results.
    */
   void EmitResults(arma::mat& results);
 
+  /**
+   * Split the tree into at least 4 * numThreads disjoint subtrees (where the
+   * tree is large enough), which can be used as independent query trees.  The
+   * nodes above the subtrees are stored in upperNodes, in breadth-first order.
+   */
+  void SplitTree(const size_t numThreads,
+                 std::vector<TreeType*>& queryNodes,
+                 std::vector<TreeType*>& upperNodes);
+
   /**
    * This function resets the values in the nodes of the tree nearest neighbor
    * distance, and checks for fully connected nodes.
@@ -197,9 +234,19 @@ class DualTreeBoruvka
   void CleanupHelper(TreeType* tree);
 
   /**
-   * The values stored in the tree must be reset on each iteration.
+   * Reset the statistic of a single node, whose children must already have
+   * been reset, and set its component if all of its descendants share one.
+   */
+  void ResetNode(TreeType* tree);
+
+  /**
+   * The values stored in the tree must be reset on each iteration.  The
+   * subtrees in queryNodes are reset in parallel, then the nodes in upperNodes
+   * are reset from the bottom up.
    */
-  void Cleanup();
+  void Cleanup(const std::vector<TreeType*>& queryNodes,
+               const std::vector<TreeType*>& upperNodes,
+               const size_t numThreads);
 
 }; // class DualTreeBoruvka
 
@@ -40,8 +40,10 @@ TreeType* BuildTree(
  * Takes in a reference to the data set.  Copies the data, builds the tree,
  * and initializes all of the member variables.
  */
-template<typename MetricType, typename TreeType>
-DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::DualTreeBoruvka(
     const typename TreeType::Mat& dataset,
     const bool naive,
     const MetricType metric) :
@@ -50,7 +52,8 @@ DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
     naive(naive),
     connections(dataset.n_cols),
     totalDist(0.0),
-    metric(metric)
+    metric(metric),
+    threads(0)
 {
   Timer::Start("emst/tree_building");
 
@@ -74,8 +77,10 @@ DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
   neighborsDistances.fill(DBL_MAX);
 } // Constructor
 
-template<typename MetricType, typename TreeType>
-DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::DualTreeBoruvka(
     TreeType* tree,
     const typename TreeType::Mat& dataset,
     const MetricType metric) :
@@ -85,7 +90,8 @@ DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
     naive(false),
     connections(data.n_cols),
     totalDist(0.0),
-    metric(metric)
+    metric(metric),
+    threads(0)
 {
   edges.reserve(data.n_cols - 1); // Fill with EdgePairs.
 
@@ -95,8 +101,10 @@ DualTreeBoruvka<MetricType, TreeType>::DualTreeBoruvka(
   neighborsDistances.fill(DBL_MAX);
 }
 
-template<typename MetricType, typename TreeType>
-DualTreeBoruvka<MetricType, TreeType>::~DualTreeBoruvka()
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::~DualTreeBoruvka()
 {
   if (ownTree)
     delete tree;
@@ -106,44 +114,123 @@ DualTreeBoruvka<MetricType, TreeType>::~DualTreeBoruvka()
  * Iteratively find the nearest neighbor of each component until the MST is
  * complete.
  */
-template<typename MetricType, typename TreeType>
-void DualTreeBoruvka<MetricType, TreeType>::ComputeMST(arma::mat& results)
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::
+ComputeMST(arma::mat& results)
 {
   Timer::Start("emst/mst_computation");
 
   totalDist = 0; // Reset distance.
 
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // The rules only modify the statistics of query nodes, so traversals of
+  // disjoint query subtrees against the whole tree can run at the same time.
+  std::vector<TreeType*> queryNodes;
+  std::vector<TreeType*> upperNodes;
+  if (!naive)
+    SplitTree(numThreads, queryNodes, upperNodes);
+
   typedef DTBRules<MetricType, TreeType> RuleType;
-  RuleType rules(data, connections, neighborsDistances, neighborsInComponent,
-                 neighborsOutComponent, metric);
+  typedef tree::InstrumentedRules<RuleType, InstrumentationType>
+      InstrumentedRuleType;
+  size_t baseCases = 0;
+  size_t scores = 0;
+
+  // Each thread keeps its own candidate edge for each component, so that no
+  // thread reads a candidate while another one writes it.  They are merged
+  // into neighborsDistances (and the other candidate lists) after the
+  // traversals of each round.
+  std::vector<arma::vec> threadDistances(numThreads);
+  std::vector<arma::Col<size_t> > threadInComponent(numThreads);
+  std::vector<arma::Col<size_t> > threadOutComponent(numThreads);
+  for (size_t t = 0; t < numThreads; ++t)
+  {
+    threadDistances[t].set_size(data.n_cols);
+    threadDistances[t].fill(DBL_MAX);
+    threadInComponent[t].set_size(data.n_cols);
+    threadOutComponent[t].set_size(data.n_cols);
+  }
+
   while (edges.size() < (data.n_cols - 1))
   {
-    if (naive)
+    #pragma omp parallel num_threads(numThreads) reduction(+:baseCases, scores)
     {
-      // Full O(N^2) traversal.
-      for (size_t i = 0; i < data.n_cols; ++i)
-        for (size_t j = 0; j < data.n_cols; ++j)
-          rules.BaseCase(i, j);
+#ifdef _OPENMP
+      const size_t thread = (size_t) omp_get_thread_num();
+#else
+      const size_t thread = 0;
+#endif
+      RuleType rules(data, connections, threadDistances[thread],
+          threadInComponent[thread], threadOutComponent[thread], metric);
+
+      if (naive)
+      {
+        // Full O(N^2) traversal.
+        #pragma omp for schedule(dynamic, 16)
+        for (omp_size_t i = 0; i < (omp_size_t) data.n_cols; ++i)
+          for (size_t j = 0; j < data.n_cols; ++j)
+            rules.BaseCase(i, j);
+      }
+      else
+      {
+        InstrumentationType threadInstrumentation;
+        InstrumentedRuleType instrumentedRules(rules, threadInstrumentation);
+        typename TreeType::template DualTreeTraverser<InstrumentedRuleType>
+            traverser(instrumentedRules);
+
+        #pragma omp for schedule(dynamic)
+        for (omp_size_t i = 0; i < (omp_size_t) queryNodes.size(); ++i)
+          traverser.Traverse(*queryNodes[i], *tree);
+
+        #pragma omp critical(dtb_instrumentation)
+        instrumentation.Merge(threadInstrumentation);
+      }
+
+      baseCases += rules.BaseCases();
+      scores += rules.Scores();
     }
-    else
+
+    // Keep the closest candidate for each component (that of the first thread,
+    // if several are equally close), and reset the candidates of the threads
+    // for the next round.
+    #pragma omp parallel for num_threads(numThreads)
+    for (omp_size_t c = 0; c < (omp_size_t) data.n_cols; ++c)
     {
-      typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
-      traverser.Traverse(*tree, *tree);
+      for (size_t t = 0; t < numThreads; ++t)
+      {
+        if (threadDistances[t][c] < neighborsDistances[c])
+        {
+          neighborsDistances[c] = threadDistances[t][c];
+          neighborsInComponent[c] = threadInComponent[t][c];
+          neighborsOutComponent[c] = threadOutComponent[t][c];
+        }
+
+        threadDistances[t][c] = DBL_MAX;
+      }
     }
 
-    AddAllEdges();
+    AddAllEdges(numThreads);
 
-    Cleanup();
+    Cleanup(queryNodes, upperNodes, numThreads);
 
     Log::Info << edges.size() << " edges found so far." << std::endl;
     if (!naive)
     {
-      Log::Info << rules.BaseCases() << " cumulative base cases." << std::endl;
-      Log::Info << rules.Scores() << " cumulative node combinations scored."
+      Log::Info << baseCases << " cumulative base cases." << std::endl;
+      Log::Info << scores << " cumulative node combinations scored."
           << std::endl;
     }
   }
 
+  Metric::Add("emst/base_cases", baseCases);
+  Metric::Add("emst/scores", scores);
   Timer::Stop("emst/mst_computation");
 
   EmitResults(results);
@@ -151,11 +238,54 @@ void DualTreeBoruvka<MetricType, TreeType>::ComputeMST(arma::mat& results)
   Log::Info << "Total spanning tree length: " << totalDist << std::endl;
 }
 
+/**
+ * Split the tree into disjoint subtrees, to be used as independent query trees.
+ */
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::SplitTree(
+    const size_t numThreads,
+    std::vector<TreeType*>& queryNodes,
+    std::vector<TreeType*>& upperNodes)
+{
+  // Replace nodes by their children, level by level, until there are enough
+  // subtrees to balance the work between threads.  Every point is held by
+  // exactly one subtree, so the results for a point (and the statistics of
+  // each query node) are only modified by one thread at a time.
+  queryNodes.assign(1, tree);
+  upperNodes.clear();
+  bool expanded = (numThreads > 1);
+  while (expanded && (queryNodes.size() < 4 * numThreads))
+  {
+    expanded = false;
+    std::vector<TreeType*> children;
+    for (size_t i = 0; i < queryNodes.size(); ++i)
+    {
+      if (queryNodes[i]->NumChildren() == 0)
+      {
+        children.push_back(queryNodes[i]);
+        continue;
+      }
+
+      for (size_t j = 0; j < queryNodes[i]->NumChildren(); ++j)
+        children.push_back(&queryNodes[i]->Child(j));
+      upperNodes.push_back(queryNodes[i]);
+      expanded = true;
+    }
+
+    queryNodes.swap(children);
+  }
+}
+
 /**
  * Adds a single edge to the edge list
  */
-template<typename MetricType, typename TreeType>
-void DualTreeBoruvka<MetricType, TreeType>::AddEdge(const size_t e1,
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::
+AddEdge(const size_t e1,
                                         const size_t e2,
                                         const double distance)
 {
@@ -171,14 +301,24 @@ void DualTreeBoruvka<MetricType, TreeType>::AddEdge(const size_t e1,
 /**
  * Adds all the edges found in one iteration to the list of neighbors.
  */
-template<typename MetricType, typename TreeType>
-void DualTreeBoruvka<MetricType, TreeType>::AddAllEdges()
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::AddAllEdges(
+    const size_t numThreads)
 {
+  // Components are indexed by their root, so only the roots hold a candidate
+  // edge.  Collect them before any components are merged.
+  std::vector<size_t> roots;
   for (size_t i = 0; i < data.n_cols; i++)
+    if (connections.Find(i) == i)
+      roots.push_back(i);
+
+  for (size_t i = 0; i < roots.size(); i++)
   {
-    size_t component = connections.Find(i);
-    size_t inEdge = neighborsInComponent[component];
-    size_t outEdge = neighborsOutComponent[component];
+    const size_t component = roots[i];
+    const size_t inEdge = neighborsInComponent[component];
+    const size_t outEdge = neighborsOutComponent[component];
     if (connections.Find(inEdge) != connections.Find(outEdge))
     {
       //totalDist = totalDist + dist;
@@ -188,13 +328,20 @@ void DualTreeBoruvka<MetricType, TreeType>::AddAllEdges()
       connections.Union(inEdge, outEdge);
     }
   }
+
+  // The next traversal (and Cleanup()) only read the components, from several
+  // threads at once, so point each element straight at its root.
+  connections.Flatten(numThreads);
 } // AddAllEdges
 
 /**
  * Unpermute the edge list (if necessary) and output it to results.
  */
-template<typename MetricType, typename TreeType>
-void DualTreeBoruvka<MetricType, TreeType>::EmitResults(arma::mat& results)
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::
+EmitResults(arma::mat& results)
 {
   // Sort the edges.
   std::sort(edges.begin(), edges.end(), SortFun);
@@ -243,23 +390,42 @@ void DualTreeBoruvka<MetricType, TreeType>::EmitResults(arma::mat& results)
  * This function resets the values in the nodes of the tree nearest neighbor
  * distance and checks for fully connected nodes.
  */
-template<typename MetricType, typename TreeType>
-void DualTreeBoruvka<MetricType, TreeType>::CleanupHelper(TreeType* tree)
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::
+CleanupHelper(TreeType* tree)
+{
+  // Recurse into all children.
+  for (size_t i = 0; i < tree->NumChildren(); ++i)
+    CleanupHelper(&tree->Child(i));
+
+  ResetNode(tree);
+}
+
+/**
+ * Reset the statistic of a single node whose children have already been reset.
+ */
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::
+ResetNode(TreeType* tree)
 {
   // Reset the statistic information.
   tree->Stat().MaxNeighborDistance() = DBL_MAX;
   tree->Stat().MinNeighborDistance() = DBL_MAX;
   tree->Stat().Bound() = DBL_MAX;
 
-  // Recurse into all children.
-  for (size_t i = 0; i < tree->NumChildren(); ++i)
-    CleanupHelper(&tree->Child(i));
+  // Nodes are reset from several threads at once, so the components must be
+  // looked up without path compression.
+  const UnionFind& components = connections;
 
   // Get the component of the first child or point.  Then we will check to see
   // if all other components of children and points are the same.
   const int component = (tree->NumChildren() != 0) ?
       tree->Child(0).Stat().ComponentMembership() :
-      connections.Find(tree->Point(0));
+      components.Find(tree->Point(0));
 
   // Check components of children.
   for (size_t i = 0; i < tree->NumChildren(); ++i)
@@ -268,7 +434,7 @@ void DualTreeBoruvka<MetricType, TreeType>::CleanupHelper(TreeType* tree)
 
   // Check components of points.
   for (size_t i = 0; i < tree->NumPoints(); ++i)
-    if (connections.Find(tree->Point(i)) != size_t(component))
+    if (components.Find(tree->Point(i)) != size_t(component))
       return;
 
   // If we made it this far, all components are the same.
@@ -278,19 +444,36 @@ void DualTreeBoruvka<MetricType, TreeType>::CleanupHelper(TreeType* tree)
 /**
  * The values stored in the tree must be reset on each iteration.
  */
-template<typename MetricType, typename TreeType>
-void DualTreeBoruvka<MetricType, TreeType>::Cleanup()
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::Cleanup(
+    const std::vector<TreeType*>& queryNodes,
+    const std::vector<TreeType*>& upperNodes,
+    const size_t numThreads)
 {
-  for (size_t i = 0; i < data.n_cols; i++)
-    neighborsDistances[i] = DBL_MAX;
+  neighborsDistances.fill(DBL_MAX);
 
   if (!naive)
-    CleanupHelper(tree);
+  {
+    // The subtrees are disjoint, so they can be reset independently.  The
+    // nodes above them were stored in breadth-first order, so walking them
+    // backwards resets every child before its parent.
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+    for (omp_size_t i = 0; i < (omp_size_t) queryNodes.size(); ++i)
+      CleanupHelper(queryNodes[i]);
+
+    for (size_t i = upperNodes.size(); i > 0; --i)
+      ResetNode(upperNodes[i - 1]);
+  }
 }
 
 // convert the object to a string
-template<typename MetricType, typename TreeType>
-std::string DualTreeBoruvka<MetricType, TreeType>::ToString() const
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+std::string DualTreeBoruvka<MetricType, TreeType, InstrumentationType>::
+ToString() const
 {
   std::ostringstream convert;
   convert << "DualTreeBoruvka [" << this << "]" << std::endl;
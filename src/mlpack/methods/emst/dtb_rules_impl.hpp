@@ -13,7 +13,7 @@ namespace emst {
 template<typename MetricType, typename TreeType>
 DTBRules<MetricType, TreeType>::
 DTBRules(const arma::mat& dataSet,
-         UnionFind& connections,
+         const UnionFind& connections,
          arma::vec& neighborsDistances,
          arma::Col<size_t>& neighborsInComponent,
          arma::Col<size_t>& neighborsOutComponent,
@@ -52,6 +52,9 @@ double DTBRules<MetricType, TreeType>::BaseCase(const size_t queryIndex,
     double distance = metric.Evaluate(dataSet.col(queryIndex),
                                       dataSet.col(referenceIndex));
 
+    // The candidates belong to this thread only (DualTreeBoruvka merges the
+    // candidates of all the threads after the traversals), so no other thread
+    // reads or writes them.
     if (distance < neighborsDistances[queryComponentIndex])
     {
       Log::Assert(queryIndex != referenceIndex);
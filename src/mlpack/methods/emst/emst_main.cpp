@@ -21,6 +21,7 @@
  */
 
 #include "dtb.hpp"
+#include "single_linkage.hpp"
 
 #include <mlpack/core.hpp>
 
@@ -31,7 +32,15 @@ PROGRAM_INFO("Fast Euclidean Minimum Spanning Tree", "This program can compute "
     "The output is saved in a three-column matrix, where each row indicates an "
     "edge.  The first column corresponds to the lesser index of the edge; the "
     "second column corresponds to the greater index of the edge; and the third "
-    "column corresponds to the distance between the two points.");
+    "column corresponds to the distance between the two points."
+    "\n\n"
+    "The minimum spanning tree also gives the single-linkage hierarchical "
+    "clustering of the points.  If --dendrogram_file is specified, the "
+    "dendrogram is saved with one merge per row: the two merged clusters "
+    "(points are clusters 0 to N - 1, and the cluster created by row i is "
+    "N + i), the merge distance, and the size of the new cluster.  A flat "
+    "clustering can be saved to --assignments_file, by cutting the dendrogram "
+    "into --clusters clusters or at the distance given by --cut_distance.");
 
 PARAM_STRING_REQ("input_file", "Data input file.", "i");
 PARAM_STRING("output_file", "Data output file.  Stored as an edge list.", "o",
@@ -40,6 +49,19 @@ PARAM_FLAG("naive", "Compute the MST using O(n^2) naive algorithm.", "n");
 PARAM_INT("leaf_size", "Leaf size in the kd-tree.  One-element leaves give the "
     "empirically best performance, but at the cost of greater memory "
     "requirements.", "l", 1);
+PARAM_INT("threads", "Number of threads to use (0 uses all available cores; "
+    "ignored if mlpack was built without OpenMP).", "t", 0);
+
+PARAM_STRING("dendrogram_file", "If specified, save the single-linkage "
+    "dendrogram to this file.", "d", "");
+PARAM_STRING("assignments_file", "If specified, save single-linkage cluster "
+    "assignments to this file (requires --clusters or --cut_distance).", "a",
+    "");
+PARAM_INT("clusters", "Number of single-linkage clusters to cut the dendrogram "
+    "into.", "k", 0);
+PARAM_DOUBLE("cut_distance", "Cut the single-linkage dendrogram at this "
+    "distance: points connected by edges no longer than this are in the same "
+    "cluster.", "c", 0.0);
 
 using namespace mlpack;
 using namespace mlpack::emst;
@@ -55,19 +77,48 @@ int main(int argc, char* argv[])
   arma::mat dataPoints;
   data::Load(dataFilename, dataPoints, true);
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t threads = (size_t) CLI::GetParam<int>("threads");
+
+  // Sanity checks on the clustering options.
+  const string assignmentsFile = CLI::GetParam<string>("assignments_file");
+  if (assignmentsFile != "" &&
+      CLI::HasParam("clusters") == CLI::HasParam("cut_distance"))
+  {
+    Log::Fatal << "Exactly one of --clusters and --cut_distance must be "
+        << "specified with --assignments_file." << endl;
+  }
+  if (assignmentsFile == "" &&
+      (CLI::HasParam("clusters") || CLI::HasParam("cut_distance")))
+  {
+    Log::Warn << "--assignments_file is not specified, so no clustering will "
+        << "be saved." << endl;
+  }
+  if (CLI::HasParam("clusters") && (CLI::GetParam<int>("clusters") <= 0 ||
+      (size_t) CLI::GetParam<int>("clusters") > dataPoints.n_cols))
+  {
+    Log::Fatal << "Invalid number of clusters (" << CLI::GetParam<int>(
+        "clusters") << ")!  Must be between 1 and the number of points ("
+        << dataPoints.n_cols << ")." << endl;
+  }
+
+  // The edge list, sorted by distance, with the original point indices.
+  arma::mat mst;
+
   // Do naive computation if necessary.
   if (CLI::GetParam<bool>("naive"))
   {
     Log::Info << "Running naive algorithm." << endl;
 
     DualTreeBoruvka<> naive(dataPoints, true);
+    naive.Threads() = threads;
 
-    arma::mat naiveResults;
-    naive.ComputeMST(naiveResults);
-
-    const string outputFilename = CLI::GetParam<string>("output_file");
-
-    data::Save(outputFilename, naiveResults, true);
+    naive.ComputeMST(mst);
   }
   else
   {
@@ -92,6 +143,7 @@ int main(int argc, char* argv[])
     Timer::Stop("tree_building");
 
     DualTreeBoruvka<> dtb(&tree, dataPoints, metric);
+    dtb.Threads() = threads;
 
     // Run the DTB algorithm.
     Log::Info << "Calculating minimum spanning tree." << endl;
@@ -99,7 +151,7 @@ int main(int argc, char* argv[])
     dtb.ComputeMST(results);
 
     // Unmap the results.
-    arma::mat unmappedResults(results.n_rows, results.n_cols);
+    mst.set_size(results.n_rows, results.n_cols);
     for (size_t i = 0; i < results.n_cols; ++i)
     {
       const size_t indexA = oldFromNew[size_t(results(0, i))];
@@ -107,21 +159,52 @@ int main(int argc, char* argv[])
 
       if (indexA < indexB)
       {
-        unmappedResults(0, i) = indexA;
-        unmappedResults(1, i) = indexB;
+        mst(0, i) = indexA;
+        mst(1, i) = indexB;
       }
       else
       {
-        unmappedResults(0, i) = indexB;
-        unmappedResults(1, i) = indexA;
+        mst(0, i) = indexB;
+        mst(1, i) = indexA;
       }
 
-      unmappedResults(2, i) = results(2, i);
+      mst(2, i) = results(2, i);
     }
+  }
+
+  // Output the results.
+  const string outputFilename = CLI::GetParam<string>("output_file");
+
+  data::Save(outputFilename, mst, true);
 
-    // Output the results.
-    const string outputFilename = CLI::GetParam<string>("output_file");
+  // Compute the single-linkage clustering, if requested.
+  SingleLinkage linkage(mst);
+
+  const string dendrogramFile = CLI::GetParam<string>("dendrogram_file");
+  if (dendrogramFile != "")
+  {
+    arma::mat dendrogram;
+    linkage.Dendrogram(dendrogram);
+    data::Save(dendrogramFile, dendrogram, true);
+  }
+
+  if (assignmentsFile != "")
+  {
+    arma::Col<size_t> assignments;
+    if (CLI::HasParam("clusters"))
+    {
+      linkage.Cluster((size_t) CLI::GetParam<int>("clusters"), assignments);
+    }
+    else
+    {
+      const size_t clusters = linkage.ClusterByDistance(
+          CLI::GetParam<double>("cut_distance"), assignments);
+      Log::Info << clusters << " clusters at distance "
+          << CLI::GetParam<double>("cut_distance") << "." << endl;
+    }
 
-    data::Save(outputFilename, unmappedResults, true);
+    // Save one label per line.
+    arma::Mat<size_t> output = trans(assignments);
+    data::Save(assignmentsFile, output, true);
   }
 }
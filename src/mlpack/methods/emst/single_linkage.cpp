@@ -0,0 +1,111 @@
+/**
+ * @file single_linkage.cpp
+ *
+ * Implementation of single-linkage clustering from a minimum spanning tree.
+ */
+#include "single_linkage.hpp"
+
+using namespace mlpack;
+using namespace mlpack::emst;
+
+SingleLinkage::SingleLinkage(const arma::mat& mst) : mst(mst)
+{
+  if (mst.n_rows != 3)
+    Log::Fatal << "SingleLinkage::SingleLinkage(): the minimum spanning tree "
+        << "must have 3 rows (found " << mst.n_rows << ")!" << std::endl;
+}
+
+void SingleLinkage::Dendrogram(arma::mat& dendrogram) const
+{
+  const size_t points = mst.n_cols + 1;
+  UnionFind connections(points);
+
+  // The dendrogram cluster and the size of each component, indexed by the
+  // root of the component.
+  arma::Col<size_t> clusters(points);
+  arma::Col<size_t> sizes(points);
+  for (size_t i = 0; i < points; ++i)
+  {
+    clusters[i] = i;
+    sizes[i] = 1;
+  }
+
+  dendrogram.set_size(4, mst.n_cols);
+  for (size_t i = 0; i < mst.n_cols; ++i)
+  {
+    const size_t rootA = connections.Find((size_t) mst(0, i));
+    const size_t rootB = connections.Find((size_t) mst(1, i));
+    Log::Assert(rootA != rootB, "SingleLinkage::Dendrogram(): the edge list "
+        "is not a spanning tree.");
+
+    const size_t size = sizes[rootA] + sizes[rootB];
+    dendrogram(0, i) = std::min(clusters[rootA], clusters[rootB]);
+    dendrogram(1, i) = std::max(clusters[rootA], clusters[rootB]);
+    dendrogram(2, i) = mst(2, i);
+    dendrogram(3, i) = size;
+
+    connections.Union(rootA, rootB);
+    const size_t root = connections.Find(rootA);
+    clusters[root] = points + i;
+    sizes[root] = size;
+  }
+}
+
+void SingleLinkage::Cluster(const size_t clusters,
+                            arma::Col<size_t>& assignments) const
+{
+  const size_t points = mst.n_cols + 1;
+  if (clusters == 0 || clusters > points)
+    Log::Fatal << "SingleLinkage::Cluster(): the number of clusters must be "
+        << "between 1 and " << points << " (got " << clusters << ")!"
+        << std::endl;
+
+  // Each of the shortest (points - clusters) edges merges two clusters.
+  UnionFind connections(points);
+  for (size_t i = 0; i < points - clusters; ++i)
+    connections.Union((size_t) mst(0, i), (size_t) mst(1, i));
+
+  Label(connections, assignments);
+}
+
+size_t SingleLinkage::ClusterByDistance(const double distance,
+                                        arma::Col<size_t>& assignments) const
+{
+  // The edges are sorted, so stop at the first one which is too long.
+  UnionFind connections(mst.n_cols + 1);
+  for (size_t i = 0; (i < mst.n_cols) && (mst(2, i) <= distance); ++i)
+    connections.Union((size_t) mst(0, i), (size_t) mst(1, i));
+
+  return Label(connections, assignments);
+}
+
+size_t SingleLinkage::Label(UnionFind& connections,
+                            arma::Col<size_t>& assignments) const
+{
+  const size_t points = mst.n_cols + 1;
+
+  // The label given to each root, or 'points' if it has not been seen yet.
+  arma::Col<size_t> labels(points);
+  labels.fill(points);
+
+  assignments.set_size(points);
+  size_t numLabels = 0;
+  for (size_t i = 0; i < points; ++i)
+  {
+    const size_t root = connections.Find(i);
+    if (labels[root] == points)
+      labels[root] = numLabels++;
+
+    assignments[i] = labels[root];
+  }
+
+  return numLabels;
+}
+
+std::string SingleLinkage::ToString() const
+{
+  std::ostringstream convert;
+  convert << "SingleLinkage [" << this << "]" << std::endl;
+  convert << "  Points: " << (mst.n_cols + 1) << std::endl;
+  return convert.str();
+}
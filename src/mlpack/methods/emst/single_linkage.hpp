@@ -0,0 +1,104 @@
+/**
+ * @file single_linkage.hpp
+ *
+ * Single-linkage hierarchical clustering, computed from a Euclidean minimum
+ * spanning tree.  Merging the points along the edges of the MST, in order of
+ * increasing length, gives exactly the single-linkage dendrogram, so no further
+ * distance computations are necessary.
+ */
+#ifndef __MLPACK_METHODS_EMST_SINGLE_LINKAGE_HPP
+#define __MLPACK_METHODS_EMST_SINGLE_LINKAGE_HPP
+
+#include <mlpack/core.hpp>
+
+#include "union_find.hpp"
+
+namespace mlpack {
+namespace emst {
+
+/**
+ * Derive single-linkage clusterings from a minimum spanning tree, as returned
+ * by DualTreeBoruvka::ComputeMST().  Each clustering is a single pass over
+ * (a prefix of) the edge list, using a UnionFind structure.
+ *
+ * @code
+ * extern arma::mat data;
+ * DualTreeBoruvka<> dtb(data);
+ * arma::mat mst;
+ * dtb.ComputeMST(mst);
+ *
+ * SingleLinkage linkage(mst);
+ * arma::Col<size_t> assignments;
+ * linkage.Cluster(5, assignments); // Cut the dendrogram into 5 clusters.
+ * @endcode
+ */
+class SingleLinkage
+{
+ public:
+  /**
+   * Prepare to cluster using the given minimum spanning tree.  This must be a
+   * 3 x (N - 1) edge list for N points, sorted by increasing distance, in the
+   * format returned by DualTreeBoruvka::ComputeMST().  The matrix is not
+   * copied, so it must remain valid while this object is used.
+   *
+   * @param mst Minimum spanning tree, sorted by edge length.
+   */
+  SingleLinkage(const arma::mat& mst);
+
+  /**
+   * Compute the single-linkage dendrogram, in the same format as SciPy's
+   * linkage matrices (but stored column-major, one merge per column).  Points
+   * are clusters 0 to (N - 1), and the cluster created by merge i is cluster
+   * (N + i).  Column i holds the lesser and greater indices of the two merged
+   * clusters, the distance at which they were merged, and the number of points
+   * in the new cluster.
+   *
+   * @param dendrogram Matrix to store the 4 x (N - 1) dendrogram in.
+   */
+  void Dendrogram(arma::mat& dendrogram) const;
+
+  /**
+   * Cut the dendrogram into the given number of clusters.  Cluster labels are
+   * numbered from 0 in order of the first point of each cluster.
+   *
+   * @param clusters Number of clusters (between 1 and N).
+   * @param assignments Vector to store the cluster of each point in.
+   */
+  void Cluster(const size_t clusters, arma::Col<size_t>& assignments) const;
+
+  /**
+   * Cut the dendrogram at the given distance: two points are in the same
+   * cluster if they are connected by a chain of points, each within the given
+   * distance of the next.  Cluster labels are numbered from 0 in order of the
+   * first point of each cluster.
+   *
+   * @param distance Largest edge length which joins two clusters.
+   * @param assignments Vector to store the cluster of each point in.
+   * @return The number of clusters.
+   */
+  size_t ClusterByDistance(const double distance,
+                           arma::Col<size_t>& assignments) const;
+
+  //! Get the minimum spanning tree.
+  const arma::mat& MST() const { return mst; }
+
+  /**
+   * Returns a string representation of this object.
+   */
+  std::string ToString() const;
+
+ private:
+  //! The minimum spanning tree, sorted by edge length.
+  const arma::mat& mst;
+
+  /**
+   * Label the components of the given union-find structure in order of their
+   * first point, and return the number of components.
+   */
+  size_t Label(UnionFind& connections, arma::Col<size_t>& assignments) const;
+};
+
+}; // namespace emst
+}; // namespace mlpack
+
+#endif
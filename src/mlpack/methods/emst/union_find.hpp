@@ -62,6 +62,43 @@ class UnionFind
     }
   }
 
+  /**
+   * Returns the component containing an element, without compressing the path
+   * to it.  This does not modify the structure, so it is safe to call from
+   * several threads at once; after Flatten() it takes constant time.
+   *
+   * @param x the component to be found
+   * @return The index of the component containing x
+   */
+  size_t Find(const size_t x) const
+  {
+    size_t root = x;
+    while (parent[root] != root)
+      root = parent[root];
+
+    return root;
+  }
+
+  /**
+   * Point every element directly at the root of its component, so that
+   * subsequent calls to Find() take constant time.  The roots are all found
+   * before any are written, so the work is split over the given number of
+   * threads.
+   *
+   * @param numThreads Number of threads to use.
+   */
+  void Flatten(const size_t numThreads = 1)
+  {
+    const UnionFind& constThis = *this;
+    arma::Col<size_t> roots(parent.n_elem);
+
+    #pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (omp_size_t i = 0; i < (omp_size_t) parent.n_elem; ++i)
+      roots[i] = constThis.Find(i);
+
+    parent = roots;
+  }
+
   /**
    * Union the components containing x and y.
    *
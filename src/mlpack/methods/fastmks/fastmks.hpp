@@ -12,6 +12,8 @@
 #include <mlpack/core/metrics/ip_metric.hpp>
 #include "fastmks_stat.hpp"
 #include <mlpack/core/tree/cover_tree.hpp>
+#include <mlpack/core/tree/instrumented_rules.hpp>
+#include <mlpack/core/tree/priority_single_tree_traverser.hpp>
 
 namespace mlpack {
 namespace fastmks /** Fast max-kernel search. */ {
@@ -45,11 +47,14 @@ namespace fastmks /** Fast max-kernel search. */ {
  * @tparam KernelType Type of kernel to run FastMKS with.
  * @tparam TreeType Type of tree to run FastMKS with; it must have metric
  *     IPMetric<KernelType>.
+ * @tparam InstrumentationType Policy to record details of the tree traversals
+ *     with; see tree::TraversalInstrumentation.  The default records nothing.
  */
 template<
     typename KernelType,
     typename TreeType = tree::CoverTree<metric::IPMetric<KernelType>,
-        tree::FirstPointIsRoot, FastMKSStat>
+        tree::FirstPointIsRoot, FastMKSStat>,
+    typename InstrumentationType = tree::NoTraversalInstrumentation
 >
 class FastMKS
 {
@@ -166,6 +171,12 @@ class FastMKS
    * product to point 4 in the query set will be stored in row 0 and column 4 of
    * the indices matrix.
    *
+   * If mlpack was compiled with OpenMP, the search is run in parallel with the
+   * number of threads given by Threads(); dual-tree search splits the query
+   * tree into disjoint subtrees which are traversed independently.  Naive
+   * search computes the kernel between blocks of points at once, which is much
+   * faster for kernels that provide a batch Evaluate() (see KernelTraits).
+   *
    * @param k The number of maximum kernels to find.
    * @param indices Matrix to store resulting indices of max-kernel search in.
    * @param products Matrix to store resulting max-kernel values in.
@@ -179,6 +190,56 @@ class FastMKS
   //! Modify the inner-product metric induced by the given kernel.
   metric::IPMetric<KernelType>& Metric() { return metric; }
 
+  //! Get the number of threads used for search (0 means all available
+  //! threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for search (0 means all available
+  //! threads).  This has no effect if mlpack was compiled without OpenMP.
+  size_t& Threads() { return threads; }
+
+  //! Get the allowed relative error of the kernel values (0 means exact
+  //! search).
+  double Epsilon() const { return epsilon; }
+  //! Modify the allowed relative error of the kernel values.  With an epsilon
+  //! greater than 0, tree-based search returns kernel values within a factor
+  //! of (1 + epsilon) of the true maximum kernel values, which prunes many more
+  //! nodes.  Naive search is always exact.
+  double& Epsilon() { return epsilon; }
+
+  //! Get the largest number of base cases to evaluate for each query point in
+  //! single-tree search (0 means no limit).
+  size_t MaxBaseCases() const { return maxBaseCases; }
+  //! Modify the largest number of base cases to evaluate for each query point
+  //! in single-tree search (0 means no limit).  If this or TimeLimit() is set,
+  //! single-tree search is an anytime search: the reference tree is traversed
+  //! best-first for each query point, and the traversal stops when the budget
+  //! runs out, leaving the best candidates found so far (slots never filled
+  //! keep an invalid index).  Use Exact() to find which results are guaranteed
+  //! to be exact.  The budgets are not used by naive or dual-tree search.
+  size_t& MaxBaseCases() { return maxBaseCases; }
+
+  //! Get the number of seconds to spend on each query point in single-tree
+  //! search (0 means no limit).
+  double TimeLimit() const { return timeLimit; }
+  //! Modify the number of seconds to spend on each query point in single-tree
+  //! search (0 means no limit); see MaxBaseCases().
+  double& TimeLimit() { return timeLimit; }
+
+  //! Get whether the results of every query point of the last search are
+  //! guaranteed to be exact (up to Epsilon()).
+  bool Exact() const { return (inexactQueries == 0); }
+  //! Get whether the results of the given query point of the last search are
+  //! guaranteed to be exact (up to Epsilon()).
+  bool Exact(const size_t queryIndex) const
+  {
+    return exactQueries.empty() || (exactQueries[queryIndex] != 0);
+  }
+
+  //! Get the details of the tree traversals recorded during searches.
+  const InstrumentationType& Instrumentation() const { return instrumentation; }
+  //! Modify the details of the tree traversals (i.e. to reset them).
+  InstrumentationType& Instrumentation() { return instrumentation; }
+
   /**
    * Returns a string representation of this object.
    */
@@ -207,6 +268,25 @@ class FastMKS
   //! The instantiated inner-product metric induced by the given kernel.
   metric::IPMetric<KernelType> metric;
 
+  //! The number of threads to use for search (0 means all available).
+  size_t threads;
+
+  //! Allowed relative error of the kernel values (0 means exact search).
+  double epsilon;
+
+  //! The largest number of base cases for each query point (0 is no limit).
+  size_t maxBaseCases;
+  //! The time limit for each query point in seconds (0 is no limit).
+  double timeLimit;
+  //! Whether the results of each query point of the last search are exact
+  //! (empty if no budget was used).
+  std::vector<char> exactQueries;
+  //! The number of query points of the last search with inexact results.
+  size_t inexactQueries;
+
+  //! The details of the tree traversals.
+  InstrumentationType instrumentation;
+
   //! Utility function.  Copied too many times from too many places.
   void InsertNeighbor(arma::Mat<size_t>& indices,
                       arma::mat& products,
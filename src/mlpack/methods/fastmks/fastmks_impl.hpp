@@ -13,23 +13,32 @@
 #include "fastmks_rules.hpp"
 
 #include <mlpack/core/kernels/gaussian_kernel.hpp>
+#include <mlpack/core/kernels/kernel_matrix.hpp>
 #include <queue>
 
 namespace mlpack {
 namespace fastmks {
 
 // Single dataset, no instantiated kernel.
-template<typename KernelType, typename TreeType>
-FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
-                                       const bool single,
-                                       const bool naive) :
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+FastMKS<KernelType, TreeType, InstrumentationType>::
+FastMKS(const arma::mat& referenceSet,
+        const bool single,
+        const bool naive) :
     referenceSet(referenceSet),
     querySet(referenceSet),
     referenceTree(NULL),
     queryTree(NULL),
     treeOwner(true),
     single(single),
-    naive(naive)
+    naive(naive),
+    threads(0),
+    epsilon(0.0),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   Timer::Start("tree_building");
 
@@ -43,18 +52,26 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
 }
 
 // Two datasets, no instantiated kernel.
-template<typename KernelType, typename TreeType>
-FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
-                                       const arma::mat& querySet,
-                                       const bool single,
-                                       const bool naive) :
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+FastMKS<KernelType, TreeType, InstrumentationType>::
+FastMKS(const arma::mat& referenceSet,
+        const arma::mat& querySet,
+        const bool single,
+        const bool naive) :
     referenceSet(referenceSet),
     querySet(querySet),
     referenceTree(NULL),
     queryTree(NULL),
     treeOwner(true),
     single(single),
-    naive(naive)
+    naive(naive),
+    threads(0),
+    epsilon(0.0),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   Timer::Start("tree_building");
 
@@ -69,11 +86,14 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
 }
 
 // One dataset, instantiated kernel.
-template<typename KernelType, typename TreeType>
-FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
-                                       KernelType& kernel,
-                                       const bool single,
-                                       const bool naive) :
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+FastMKS<KernelType, TreeType, InstrumentationType>::
+FastMKS(const arma::mat& referenceSet,
+        KernelType& kernel,
+        const bool single,
+        const bool naive) :
     referenceSet(referenceSet),
     querySet(referenceSet),
     referenceTree(NULL),
@@ -81,7 +101,12 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     treeOwner(true),
     single(single),
     naive(naive),
-    metric(kernel)
+    metric(kernel),
+    threads(0),
+    epsilon(0.0),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   Timer::Start("tree_building");
 
@@ -96,12 +121,15 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
 }
 
 // Two datasets, instantiated kernel.
-template<typename KernelType, typename TreeType>
-FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
-                                       const arma::mat& querySet,
-                                       KernelType& kernel,
-                                       const bool single,
-                                       const bool naive) :
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+FastMKS<KernelType, TreeType, InstrumentationType>::
+FastMKS(const arma::mat& referenceSet,
+        const arma::mat& querySet,
+        KernelType& kernel,
+        const bool single,
+        const bool naive) :
     referenceSet(referenceSet),
     querySet(querySet),
     referenceTree(NULL),
@@ -109,7 +137,12 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     treeOwner(true),
     single(single),
     naive(naive),
-    metric(kernel)
+    metric(kernel),
+    threads(0),
+    epsilon(0.0),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   Timer::Start("tree_building");
 
@@ -124,11 +157,14 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
 }
 
 // One dataset, pre-built tree.
-template<typename KernelType, typename TreeType>
-FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
-                                       TreeType* referenceTree,
-                                       const bool single,
-                                       const bool naive) :
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+FastMKS<KernelType, TreeType, InstrumentationType>::
+FastMKS(const arma::mat& referenceSet,
+        TreeType* referenceTree,
+        const bool single,
+        const bool naive) :
     referenceSet(referenceSet),
     querySet(referenceSet),
     referenceTree(referenceTree),
@@ -136,7 +172,12 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     treeOwner(false),
     single(single),
     naive(naive),
-    metric(referenceTree->Metric())
+    metric(referenceTree->Metric()),
+    threads(0),
+    epsilon(0.0),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   // The query tree cannot be the same as the reference tree.
   if (referenceTree)
@@ -144,13 +185,16 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
 }
 
 // Two datasets, pre-built trees.
-template<typename KernelType, typename TreeType>
-FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
-                                       TreeType* referenceTree,
-                                       const arma::mat& querySet,
-                                       TreeType* queryTree,
-                                       const bool single,
-                                       const bool naive) :
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+FastMKS<KernelType, TreeType, InstrumentationType>::
+FastMKS(const arma::mat& referenceSet,
+        TreeType* referenceTree,
+        const arma::mat& querySet,
+        TreeType* queryTree,
+        const bool single,
+        const bool naive) :
     referenceSet(referenceSet),
     querySet(querySet),
     referenceTree(referenceTree),
@@ -158,13 +202,20 @@ FastMKS<KernelType, TreeType>::FastMKS(const arma::mat& referenceSet,
     treeOwner(false),
     single(single),
     naive(naive),
-    metric(referenceTree->Metric())
+    metric(referenceTree->Metric()),
+    threads(0),
+    epsilon(0.0),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   // Nothing to do.
 }
 
-template<typename KernelType, typename TreeType>
-FastMKS<KernelType, TreeType>::~FastMKS()
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+FastMKS<KernelType, TreeType, InstrumentationType>::~FastMKS()
 {
   // If we created the trees, we must delete them.
   if (treeOwner)
@@ -182,40 +233,89 @@ FastMKS<KernelType, TreeType>::~FastMKS()
   }
 }
 
-template<typename KernelType, typename TreeType>
-void FastMKS<KernelType, TreeType>::Search(const size_t k,
-                                           arma::Mat<size_t>& indices,
-                                           arma::mat& products)
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+void FastMKS<KernelType, TreeType, InstrumentationType>::
+Search(const size_t k,
+       arma::Mat<size_t>& indices,
+       arma::mat& products)
 {
+  if (epsilon < 0)
+  {
+    Log::Fatal << "FastMKS::Search(): epsilon must be non-negative (got "
+        << epsilon << ")!" << std::endl;
+  }
+
   // No remapping will be necessary because we are using the cover tree.
   indices.set_size(k, querySet.n_cols);
+  indices.fill(size_t() - 1);
   products.set_size(k, querySet.n_cols);
   products.fill(-DBL_MAX);
 
+  // With a budget, single-tree search is an anytime search.
+  const bool anytime = (maxBaseCases != 0) || (timeLimit > 0.0);
+  exactQueries.clear();
+  inexactQueries = 0;
+  if (anytime && !single)
+  {
+    Log::Warn << "FastMKS::Search(): budgets are only used by single-tree "
+        << "search; the search will be exact." << std::endl;
+  }
+
   Timer::Start("computing_products");
 
   // Naive implementation.
   if (naive)
   {
-    // Simple double loop.  Stupid, slow, but a good benchmark.
-    for (size_t q = 0; q < querySet.n_cols; ++q)
+#ifdef _OPENMP
+    const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+    const size_t numThreads = 1;
+#endif
+
+    // Compute the kernel between blocks of reference points and blocks of
+    // query points at once, so that kernels with a batch Evaluate() can use
+    // matrix multiplications; then insert the results for each query point.
+    const size_t blockSize = 1024;
+    arma::mat blockProducts;
+    for (size_t qBegin = 0; qBegin < querySet.n_cols; qBegin += blockSize)
     {
-      for (size_t r = 0; r < referenceSet.n_cols; ++r)
+      const size_t qEnd = std::min(qBegin + blockSize,
+          (size_t) querySet.n_cols);
+      const arma::mat queryBlock = querySet.cols(qBegin, qEnd - 1);
+
+      for (size_t rBegin = 0; rBegin < referenceSet.n_cols;
+          rBegin += blockSize)
       {
-        if ((&querySet == &referenceSet) && (q == r))
-          continue;
+        const size_t rEnd = std::min(rBegin + blockSize,
+            (size_t) referenceSet.n_cols);
+        const arma::mat referenceBlock = referenceSet.cols(rBegin, rEnd - 1);
 
-        const double eval = metric.Kernel().Evaluate(querySet.unsafe_col(q),
-            referenceSet.unsafe_col(r));
+        kernel::KernelMatrix(metric.Kernel(), referenceBlock, queryBlock,
+            blockProducts, numThreads);
 
-        size_t insertPosition;
-        for (insertPosition = 0; insertPosition < indices.n_rows;
-            ++insertPosition)
-          if (eval > products(insertPosition, q))
-            break;
+        // Each query point's results are only modified by one thread.
+        #pragma omp parallel for num_threads(numThreads) schedule(static)
+        for (omp_size_t q = qBegin; q < (omp_size_t) qEnd; ++q)
+        {
+          for (size_t r = rBegin; r < rEnd; ++r)
+          {
+            if ((&querySet == &referenceSet) && ((size_t) q == r))
+              continue;
 
-        if (insertPosition < indices.n_rows)
-          InsertNeighbor(indices, products, q, insertPosition, r, eval);
+            const double eval = blockProducts(r - rBegin, (size_t) q - qBegin);
+
+            size_t insertPosition;
+            for (insertPosition = 0; insertPosition < indices.n_rows;
+                ++insertPosition)
+              if (eval > products(insertPosition, q))
+                break;
+
+            if (insertPosition < indices.n_rows)
+              InsertNeighbor(indices, products, q, insertPosition, r, eval);
+          }
+        }
       }
     }
 
@@ -227,42 +327,164 @@ void FastMKS<KernelType, TreeType>::Search(const size_t k,
   // Single-tree implementation.
   if (single)
   {
-    // Create rules object (this will store the results).  This constructor
-    // precalculates each self-kernel value.
+#ifdef _OPENMP
+    const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+    const size_t numThreads = 1;
+#endif
+
+    // The query points are split between the threads, each of which has its
+    // own rules and traverser.  The rules cache the last kernel evaluation in
+    // the statistic of each reference node, so each thread also needs its own
+    // copy of the reference tree.
     typedef FastMKSRules<KernelType, TreeType> RuleType;
-    RuleType rules(referenceSet, querySet, indices, products, metric.Kernel());
+    typedef tree::InstrumentedRules<RuleType, InstrumentationType>
+        InstrumentedRuleType;
+    size_t numPrunes = 0;
+    size_t baseCases = 0;
+    size_t scores = 0;
+    if (anytime)
+      exactQueries.assign(querySet.n_cols, 1);
 
-    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
+    #pragma omp parallel num_threads(numThreads) \
+        reduction(+:numPrunes, baseCases, scores)
+    {
+      TreeType* threadTree = (numThreads > 1) ? new TreeType(*referenceTree) :
+          referenceTree;
+
+      // Create rules object (this will store the results).  This constructor
+      // precalculates each self-kernel value.
+      RuleType rules(referenceSet, querySet, indices, products,
+          metric.Kernel(), epsilon);
+      InstrumentationType threadInstrumentation;
+      InstrumentedRuleType instrumentedRules(rules, threadInstrumentation);
+
+      if (anytime)
+      {
+        // Traverse best-first, so the budget is spent on the best nodes.
+        tree::PrioritySingleTreeTraverser<TreeType, InstrumentedRuleType>
+            traverser(instrumentedRules, maxBaseCases, timeLimit);
+
+        #pragma omp for schedule(dynamic, 16)
+        for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+        {
+          traverser.Traverse(i, *threadTree);
+          exactQueries[i] = traverser.Exact() ? 1 : 0;
+        }
+
+        numPrunes += traverser.NumPrunes();
+      }
+      else
+      {
+        typename TreeType::template SingleTreeTraverser<InstrumentedRuleType>
+            traverser(instrumentedRules);
+
+        #pragma omp for schedule(dynamic, 16)
+        for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+          traverser.Traverse(i, *threadTree);
+
+        // Save the number of pruned nodes.
+        numPrunes += traverser.NumPrunes();
+      }
+      baseCases += rules.BaseCases();
+      scores += rules.Scores();
 
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      traverser.Traverse(i, *referenceTree);
+      #pragma omp critical(fastmks_instrumentation)
+      instrumentation.Merge(threadInstrumentation);
 
-    // Save the number of pruned nodes.
-    const size_t numPrunes = traverser.NumPrunes();
+      if (threadTree != referenceTree)
+        delete threadTree;
+    }
 
     Log::Info << "Pruned " << numPrunes << " nodes." << std::endl;
 
-    Log::Info << rules.BaseCases() << " base cases." << std::endl;
-    Log::Info << rules.Scores() << " scores." << std::endl;
+    Log::Info << baseCases << " base cases." << std::endl;
+    Log::Info << scores << " scores." << std::endl;
 
+    if (anytime)
+    {
+      inexactQueries = std::count(exactQueries.begin(), exactQueries.end(), 0);
+      Log::Info << inexactQueries << " query points ran out of budget before "
+          << "their results were exact." << std::endl;
+    }
+
+    Metric::Add("fastmks/base_cases", baseCases);
+    Metric::Add("fastmks/scores", scores);
     Timer::Stop("computing_products");
     return;
   }
 
   // Dual-tree implementation.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Split the query tree into disjoint subtrees, which are then traversed
+  // independently.  A node's point is also held by its first child, so
+  // replacing a node by its children keeps every query point covered exactly
+  // once, and the results for each query point are only modified by the
+  // thread which owns its subtree.  Dual-tree scoring only modifies the
+  // statistics of query nodes, so the reference tree can be shared.
+  std::vector<TreeType*> queryNodes(1, queryTree);
+  bool expanded = (numThreads > 1);
+  while (expanded && (queryNodes.size() < 4 * numThreads))
+  {
+    expanded = false;
+    std::vector<TreeType*> children;
+    for (size_t i = 0; i < queryNodes.size(); ++i)
+    {
+      if (queryNodes[i]->NumChildren() == 0)
+      {
+        children.push_back(queryNodes[i]);
+        continue;
+      }
+
+      for (size_t j = 0; j < queryNodes[i]->NumChildren(); ++j)
+        children.push_back(&queryNodes[i]->Child(j));
+      expanded = true;
+    }
+
+    queryNodes.swap(children);
+  }
+
   typedef FastMKSRules<KernelType, TreeType> RuleType;
-  RuleType rules(referenceSet, querySet, indices, products, metric.Kernel());
+  typedef tree::InstrumentedRules<RuleType, InstrumentationType>
+      InstrumentedRuleType;
+  size_t numPrunes = 0;
+  size_t baseCases = 0;
+  size_t scores = 0;
+
+  #pragma omp parallel num_threads(numThreads) \
+      reduction(+:numPrunes, baseCases, scores)
+  {
+    RuleType rules(referenceSet, querySet, indices, products, metric.Kernel(),
+        epsilon);
+    InstrumentationType threadInstrumentation;
+    InstrumentedRuleType instrumentedRules(rules, threadInstrumentation);
+
+    typename TreeType::template DualTreeTraverser<InstrumentedRuleType>
+        traverser(instrumentedRules);
 
-  typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
+    #pragma omp for schedule(dynamic)
+    for (omp_size_t i = 0; i < (omp_size_t) queryNodes.size(); ++i)
+      traverser.Traverse(*queryNodes[i], *referenceTree);
 
-  traverser.Traverse(*queryTree, *referenceTree);
+    numPrunes += traverser.NumPrunes();
+    baseCases += rules.BaseCases();
+    scores += rules.Scores();
 
-  const size_t numPrunes = traverser.NumPrunes();
+    #pragma omp critical(fastmks_instrumentation)
+    instrumentation.Merge(threadInstrumentation);
+  }
 
   Log::Info << "Pruned " << numPrunes << " nodes." << std::endl;
-  Log::Info << rules.BaseCases() << " base cases." << std::endl;
-  Log::Info << rules.Scores() << " scores." << std::endl;
+  Log::Info << baseCases << " base cases." << std::endl;
+  Log::Info << scores << " scores." << std::endl;
 
+  Metric::Add("fastmks/base_cases", baseCases);
+  Metric::Add("fastmks/scores", scores);
   Timer::Stop("computing_products");
   return;
 }
@@ -275,13 +497,16 @@ void FastMKS<KernelType, TreeType>::Search(const size_t k,
  * @param neighbor Index of reference point which is being inserted.
  * @param distance Distance from query point to reference point.
  */
-template<typename KernelType, typename TreeType>
-void FastMKS<KernelType, TreeType>::InsertNeighbor(arma::Mat<size_t>& indices,
-                                                   arma::mat& products,
-                                                   const size_t queryIndex,
-                                                   const size_t pos,
-                                                   const size_t neighbor,
-                                                   const double distance)
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+void FastMKS<KernelType, TreeType, InstrumentationType>::
+InsertNeighbor(arma::Mat<size_t>& indices,
+               arma::mat& products,
+               const size_t queryIndex,
+               const size_t pos,
+               const size_t neighbor,
+               const double distance)
 {
   // We only memmove() if there is actually a need to shift something.
   if (pos < (products.n_rows - 1))
@@ -301,8 +526,10 @@ void FastMKS<KernelType, TreeType>::InsertNeighbor(arma::Mat<size_t>& indices,
 }
 
 // Return string of object.
-template<typename KernelType, typename TreeType>
-std::string FastMKS<KernelType, TreeType>::ToString() const
+template<typename KernelType,
+         typename TreeType,
+         typename InstrumentationType>
+std::string FastMKS<KernelType, TreeType, InstrumentationType>::ToString() const
 {
   std::ostringstream convert;
   convert << "FastMKS [" << this << "]" << std::endl;
@@ -8,6 +8,8 @@
 
 #include "fastmks.hpp"
 
+#include <fstream>
+
 using namespace std;
 using namespace mlpack;
 using namespace mlpack::fastmks;
@@ -56,9 +58,21 @@ PARAM_STRING("kernel", "Kernel type to use: 'linear', 'polynomial', 'cosine', "
 PARAM_FLAG("naive", "If true, O(n^2) naive mode is used for computation.", "N");
 PARAM_FLAG("single", "If true, single-tree search is used (as opposed to "
     "dual-tree search.", "S");
+PARAM_INT("threads", "Number of threads to use for search (0 uses all "
+    "available cores; ignored if mlpack was built without OpenMP).", "t", 0);
+PARAM_DOUBLE("epsilon", "If greater than 0, find approximate maximum kernels: "
+    "each returned kernel value is within a factor of (1 + epsilon) of the "
+    "true value.  This can be much faster.  Ignored with --naive.", "e", 0.0);
 
-// Cover tree parameter.
+// Cover tree parameters.
 PARAM_DOUBLE("base", "Base to use during cover tree construction.", "b", 2.0);
+PARAM_STRING("reference_tree_file", "If specified, load the reference tree "
+    "from this file (saved earlier with --save_reference_tree) instead of "
+    "building it.  The tree must have been built with the same kernel and "
+    "kernel parameters.", "", "");
+PARAM_STRING("save_reference_tree", "If specified, save the built reference "
+    "tree to this file, so later runs can load it with --reference_tree_file.",
+    "", "");
 
 // Kernel parameters.
 PARAM_DOUBLE("degree", "Degree of polynomial kernel.", "d", 2.0);
@@ -68,6 +82,45 @@ PARAM_DOUBLE("bandwidth", "Bandwidth (for Gaussian, Epanechnikov, and "
     "triangular kernels).", "w", 1.0);
 PARAM_DOUBLE("scale", "Scale of kernel (for hyptan kernel).", "s", 1.0);
 
+//! Build the reference tree, or load it if --reference_tree_file was given, and
+//! save it if --save_reference_tree was given.
+template<typename TreeType, typename MetricType>
+TreeType* BuildReferenceTree(const arma::mat& referenceData,
+                             MetricType& metric,
+                             const double base)
+{
+  TreeType* tree = NULL;
+  const string treeFile = CLI::GetParam<string>("reference_tree_file");
+  if (treeFile != "")
+  {
+    Log::Info << "Loading reference tree from '" << treeFile << "'..." << endl;
+    ifstream treeStream(treeFile.c_str(), ios::binary);
+    if (!treeStream.is_open())
+      Log::Fatal << "Cannot open reference tree file '" << treeFile << "'."
+          << endl;
+
+    Timer::Start("tree_loading");
+    tree = new TreeType(referenceData, treeStream, &metric);
+    Timer::Stop("tree_loading");
+  }
+  else
+  {
+    tree = new TreeType(referenceData, metric, base);
+  }
+
+  const string saveFile = CLI::GetParam<string>("save_reference_tree");
+  if (saveFile != "")
+  {
+    Log::Info << "Saving reference tree to '" << saveFile << "'." << endl;
+    ofstream treeStream(saveFile.c_str(), ios::binary);
+    if (!treeStream.is_open())
+      Log::Fatal << "Cannot open '" << saveFile << "' for writing." << endl;
+    tree->Save(treeStream);
+  }
+
+  return tree;
+}
+
 //! Run FastMKS on a single dataset for the given kernel type.
 template<typename KernelType>
 void RunFastMKS(const arma::mat& referenceData,
@@ -83,13 +136,17 @@ void RunFastMKS(const arma::mat& referenceData,
   typedef CoverTree<IPMetric<KernelType>, FirstPointIsRoot, FastMKSStat>
       TreeType;
   IPMetric<KernelType> metric(kernel);
-  TreeType tree(referenceData, metric, base);
+  TreeType* tree = BuildReferenceTree<TreeType>(referenceData, metric, base);
 
   // Create FastMKS object.
-  FastMKS<KernelType> fastmks(referenceData, &tree, (single && !naive), naive);
+  FastMKS<KernelType> fastmks(referenceData, tree, (single && !naive), naive);
 
   // Now search with it.
+  fastmks.Threads() = (size_t) CLI::GetParam<int>("threads");
+  fastmks.Epsilon() = CLI::GetParam<double>("epsilon");
   fastmks.Search(k, indices, products);
+
+  delete tree;
 }
 
 //! Run FastMKS for a given query and reference set using the given kernel type.
@@ -108,15 +165,20 @@ void RunFastMKS(const arma::mat& referenceData,
   typedef CoverTree<IPMetric<KernelType>, FirstPointIsRoot, FastMKSStat>
       TreeType;
   IPMetric<KernelType> metric(kernel);
-  TreeType referenceTree(referenceData, metric, base);
+  TreeType* referenceTree = BuildReferenceTree<TreeType>(referenceData, metric,
+      base);
   TreeType queryTree(queryData, metric, base);
 
   // Create FastMKS object.
-  FastMKS<KernelType> fastmks(referenceData, &referenceTree, queryData,
+  FastMKS<KernelType> fastmks(referenceData, referenceTree, queryData,
       &queryTree, (single && !naive), naive);
 
   // Now search with it.
+  fastmks.Threads() = (size_t) CLI::GetParam<int>("threads");
+  fastmks.Epsilon() = CLI::GetParam<double>("epsilon");
   fastmks.Search(k, indices, products);
+
+  delete referenceTree;
 }
 
 int main(int argc, char** argv)
@@ -186,6 +248,20 @@ int main(int argc, char** argv)
         << "specified)." << endl;
   }
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+
+  // Sanity check on epsilon.
+  if (CLI::GetParam<double>("epsilon") < 0)
+  {
+    Log::Fatal << "Invalid epsilon: " << CLI::GetParam<double>("epsilon")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+
   // Naive mode overrides single mode.
   if (naive && single)
   {
@@ -22,11 +22,25 @@ template<typename KernelType, typename TreeType>
 class FastMKSRules
 {
  public:
+  /**
+   * Construct the rules.  If epsilon is greater than 0, the search is
+   * approximate: nodes are pruned when they cannot hold a point which improves
+   * on the current k'th best kernel value by more than a factor of
+   * (1 + epsilon) (see Relax()).
+   *
+   * @param referenceSet Set of reference points.
+   * @param querySet Set of query points.
+   * @param indices Matrix to store the result indices in.
+   * @param products Matrix to store the result kernel values in.
+   * @param kernel Instantiated kernel.
+   * @param epsilon Allowed relative error of the kernel values.
+   */
   FastMKSRules(const arma::mat& referenceSet,
                const arma::mat& querySet,
                arma::Mat<size_t>& indices,
                arma::mat& products,
-               KernelType& kernel);
+               KernelType& kernel,
+               const double epsilon = 0.0);
 
   //! Compute the base case (kernel value) between two points.
   double BaseCase(const size_t queryIndex, const size_t referenceIndex);
@@ -122,9 +136,20 @@ class FastMKSRules
   //! The last kernel evaluation resulting from BaseCase().
   double lastKernel;
 
+  //! Allowed relative error of the kernel values (0 means exact search).
+  double epsilon;
+
   //! Calculate the bound for a given query node.
   double CalculateBound(TreeType& queryNode) const;
 
+  /**
+   * Return the given pruning bound, relaxed for approximate search: a node is
+   * only recursed into if it could hold a point with kernel value greater than
+   * the returned value, so each kernel value that is found is within a factor
+   * of (1 + epsilon) of the true value.
+   */
+  double Relax(const double bestKernel) const;
+
   //! Utility function to insert neighbor into list of results.
   void InsertNeighbor(const size_t queryIndex,
                       const size_t pos,
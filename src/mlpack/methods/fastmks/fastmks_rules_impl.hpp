@@ -18,7 +18,8 @@ FastMKSRules<KernelType, TreeType>::FastMKSRules(const arma::mat& referenceSet,
                                                  const arma::mat& querySet,
                                                  arma::Mat<size_t>& indices,
                                                  arma::mat& products,
-                                                 KernelType& kernel) :
+                                                 KernelType& kernel,
+                                                 const double epsilon) :
     referenceSet(referenceSet),
     querySet(querySet),
     indices(indices),
@@ -27,6 +28,7 @@ FastMKSRules<KernelType, TreeType>::FastMKSRules(const arma::mat& referenceSet,
     lastQueryIndex(-1),
     lastReferenceIndex(-1),
     lastKernel(0.0),
+    epsilon(epsilon),
     baseCases(0),
     scores(0)
 {
@@ -101,7 +103,7 @@ double FastMKSRules<KernelType, TreeType>::Score(const size_t queryIndex,
                                                  TreeType& referenceNode)
 {
   // Compare with the current best.
-  const double bestKernel = products(products.n_rows - 1, queryIndex);
+  const double bestKernel = Relax(products(products.n_rows - 1, queryIndex));
 
   // See if we can perform a parent-child prune.
   const double furthestDist = referenceNode.FurthestDescendantDistance();
@@ -197,7 +199,7 @@ double FastMKSRules<KernelType, TreeType>::Score(TreeType& queryNode,
 {
   // Update and get the query node's bound.
   queryNode.Stat().Bound() = CalculateBound(queryNode);
-  const double bestKernel = queryNode.Stat().Bound();
+  const double bestKernel = Relax(queryNode.Stat().Bound());
 
   // First, see if we can make a parent-child or parent-parent prune.  These
   // four bounds on the maximum kernel value are looser than the bound normally
@@ -385,7 +387,7 @@ double FastMKSRules<KernelType, TreeType>::Rescore(const size_t queryIndex,
                                                    TreeType& /*referenceNode*/,
                                                    const double oldScore) const
 {
-  const double bestKernel = products(products.n_rows - 1, queryIndex);
+  const double bestKernel = Relax(products(products.n_rows - 1, queryIndex));
 
   return ((1.0 / oldScore) > bestKernel) ? oldScore : DBL_MAX;
 }
@@ -396,7 +398,7 @@ double FastMKSRules<KernelType, TreeType>::Rescore(TreeType& queryNode,
                                                    const double oldScore) const
 {
   queryNode.Stat().Bound() = CalculateBound(queryNode);
-  const double bestKernel = queryNode.Stat().Bound();
+  const double bestKernel = Relax(queryNode.Stat().Bound());
 
   return ((1.0 / oldScore) > bestKernel) ? oldScore : DBL_MAX;
 }
@@ -472,6 +474,17 @@ double FastMKSRules<KernelType, TreeType>::CalculateBound(TreeType& queryNode)
   return (interA > interB) ? interA : interB;
 }
 
+template<typename KernelType, typename TreeType>
+inline double FastMKSRules<KernelType, TreeType>::Relax(
+    const double bestKernel) const
+{
+  // Nothing can be pruned until there is a candidate.
+  if (bestKernel == -DBL_MAX)
+    return -DBL_MAX;
+
+  return bestKernel + epsilon * std::abs(bestKernel);
+}
+
 /**
  * Helper function to insert a point into the neighbors and distances matrices.
  *
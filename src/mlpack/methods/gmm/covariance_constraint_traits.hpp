@@ -0,0 +1,35 @@
+/**
+ * @file covariance_constraint_traits.hpp
+ *
+ * This provides the CovarianceConstraintTraits class, a template class to get
+ * information about covariance constraint policies.
+ */
+#ifndef __MLPACK_METHODS_GMM_COVARIANCE_CONSTRAINT_TRAITS_HPP
+#define __MLPACK_METHODS_GMM_COVARIANCE_CONSTRAINT_TRAITS_HPP
+
+namespace mlpack {
+namespace gmm {
+
+/**
+ * This is a template class that can provide information about covariance
+ * constraint policies.  By default, this class will provide the weakest
+ * possible assumptions on constraints, and each constraint should override
+ * values as necessary.  If a constraint doesn't need to override a value, then
+ * there's no need to write a CovarianceConstraintTraits specialization for that
+ * class.
+ */
+template<typename CovarianceConstraintPolicy>
+class CovarianceConstraintTraits
+{
+ public:
+  /**
+   * If true, then the constraint only keeps the diagonal of the covariance, so
+   * fitting algorithms need not compute the off-diagonal elements.
+   */
+  static const bool IsDiagonal = false;
+};
+
+}; // namespace gmm
+}; // namespace mlpack
+
+#endif
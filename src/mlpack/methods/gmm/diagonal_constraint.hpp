@@ -8,6 +8,7 @@
 #define __MLPACK_METHODS_GMM_DIAGONAL_CONSTRAINT_HPP
 
 #include <mlpack/core.hpp>
+#include "covariance_constraint_traits.hpp"
 
 namespace mlpack {
 namespace gmm {
@@ -27,6 +28,15 @@ class DiagonalConstraint
   }
 };
 
+//! DiagonalConstraint only keeps the diagonal.
+template<>
+class CovarianceConstraintTraits<DiagonalConstraint>
+{
+ public:
+  //! Only the diagonal of the covariance is needed.
+  static const bool IsDiagonal = true;
+};
+
 }; // namespace gmm
 }; // namespace mlpack
 
@@ -15,6 +15,7 @@
 #include <mlpack/methods/kmeans/kmeans.hpp>
 // Default covariance matrix constraint.
 #include "positive_definite_constraint.hpp"
+#include "covariance_constraint_traits.hpp"
 
 namespace mlpack {
 namespace gmm {
@@ -53,11 +54,15 @@ class EMFit
    * @param forcePositive Check for positive-definiteness of each covariance
    *     matrix at each iteration.
    * @param clusterer Object which will perform the initial clustering.
+   * @param constraint Object which applies constraints to the covariances.
+   * @param threads Number of threads to use for the E-step and M-step (0 uses
+   *     all available cores).
    */
   EMFit(const size_t maxIterations = 300,
         const double tolerance = 1e-10,
         InitialClusteringType clusterer = InitialClusteringType(),
-        CovarianceConstraintPolicy constraint = CovarianceConstraintPolicy());
+        CovarianceConstraintPolicy constraint = CovarianceConstraintPolicy(),
+        const size_t threads = 0);
 
   /**
    * Fit the observations to a Gaussian mixture model (GMM) using the EM
@@ -122,6 +127,11 @@ class EMFit
   //! Modify the tolerance for the convergence of the EM algorithm.
   double& Tolerance() { return tolerance; }
 
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
  private:
   /**
    * Run the clusterer, and then turn the cluster assignments into Gaussians.
@@ -137,6 +147,42 @@ class EMFit
                          std::vector<distribution::GaussianDistribution>& dists,
                          arma::vec& weights);
 
+  /**
+   * Calculate the conditional probability of each Gaussian given each
+   * observation (the E-step).  The observations are split into blocks, and
+   * each Gaussian is evaluated on each block in parallel.
+   *
+   * @param observations List of observations.
+   * @param dists Current Gaussians.
+   * @param weights Current a priori weights.
+   * @param condProb Matrix to store the conditional probabilities in; row i
+   *     holds the probabilities of observation i.
+   */
+  void ConditionalProbabilities(
+      const arma::mat& observations,
+      const std::vector<distribution::GaussianDistribution>& dists,
+      const arma::vec& weights,
+      arma::mat& condProb) const;
+
+  /**
+   * Update the means and covariances of the Gaussians from the given
+   * conditional probabilities (the M-step).  The weighted sums over each block
+   * of observations are computed in parallel, and then added together.  A
+   * Gaussian with no probability of having any points is not updated.
+   *
+   * @param observations List of observations.
+   * @param condProb Conditional probabilities of each Gaussian for each
+   *     observation.
+   * @param dists Gaussians to update.
+   * @param probRowSums Vector to store the sum of the conditional probabilities
+   *     of each Gaussian in.
+   */
+  void UpdateDistributions(
+      const arma::mat& observations,
+      const arma::mat& condProb,
+      std::vector<distribution::GaussianDistribution>& dists,
+      arma::vec& probRowSums);
+
   /**
    * Calculate the log-likelihood of a model.  Yes, this is reimplemented in the
    * GMM code.  Intuition suggests that the log-likelihood is not the best way
@@ -160,6 +206,8 @@ class EMFit
   InitialClusteringType clusterer;
   //! Object which applies constraints to the covariance matrix.
   CovarianceConstraintPolicy constraint;
+  //! The number of threads to use.
+  size_t threads;
 };
 
 }; // namespace gmm
@@ -20,11 +20,13 @@ EMFit<InitialClusteringType, CovarianceConstraintPolicy>::EMFit(
     const size_t maxIterations,
     const double tolerance,
     InitialClusteringType clusterer,
-    CovarianceConstraintPolicy constraint) :
+    CovarianceConstraintPolicy constraint,
+    const size_t threads) :
     maxIterations(maxIterations),
     tolerance(tolerance),
     clusterer(clusterer),
-    constraint(constraint)
+    constraint(constraint),
+    threads(threads)
 { /* Nothing to do. */ }
 
 template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
@@ -55,50 +57,12 @@ void EMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
 
     // Calculate the conditional probabilities of choosing a particular
     // Gaussian given the observations and the present theta value.
-    for (size_t i = 0; i < dists.size(); i++)
-    {
-      // Store conditional probabilities into condProb vector for each
-      // Gaussian.  First we make an alias of the condProb vector.
-      arma::vec condProbAlias = condProb.unsafe_col(i);
-      dists[i].Probability(observations, condProbAlias);
-      condProbAlias *= weights[i];
-    }
-
-    // Normalize row-wise.
-    for (size_t i = 0; i < condProb.n_rows; i++)
-    {
-      // Avoid dividing by zero; if the probability for everything is 0, we
-      // don't want to make it NaN.
-      const double probSum = accu(condProb.row(i));
-      if (probSum != 0.0)
-        condProb.row(i) /= probSum;
-    }
+    ConditionalProbabilities(observations, dists, weights, condProb);
 
-    // Store the sum of the probability of each state over all the observations.
-    arma::vec probRowSums = trans(arma::sum(condProb, 0 /* columnwise */));
-
-    // Calculate the new value of the means using the updated conditional
-    // probabilities.
-    for (size_t i = 0; i < dists.size(); i++)
-    {
-      // Don't update if there's no probability of the Gaussian having points.
-      if (probRowSums[i] != 0)
-        dists[i].Mean() = (observations * condProb.col(i)) / probRowSums[i];
-
-      // Calculate the new value of the covariances using the updated
-      // conditional probabilities and the updated means.
-      arma::mat tmp = observations - (dists[i].Mean() *
-          arma::ones<arma::rowvec>(observations.n_cols));
-      arma::mat tmpB = tmp % (arma::ones<arma::vec>(observations.n_rows) *
-          trans(condProb.col(i)));
-
-      // Don't update if there's no probability of the Gaussian having points.
-      if (probRowSums[i] != 0.0)
-        dists[i].Covariance() = (tmp * trans(tmpB)) / probRowSums[i];
-
-      // Apply covariance constraint.
-      constraint.ApplyConstraint(dists[i].Covariance());
-    }
+    // Calculate the new means and covariances, and store the sum of the
+    // probability of each state over all the observations.
+    arma::vec probRowSums;
+    UpdateDistributions(observations, condProb, dists, probRowSums);
 
     // Calculate the new values for omega using the updated conditional
     // probabilities.
@@ -137,54 +101,17 @@ void EMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
   {
     // Calculate the conditional probabilities of choosing a particular
     // Gaussian given the observations and the present theta value.
-    for (size_t i = 0; i < dists.size(); i++)
-    {
-      // Store conditional probabilities into condProb vector for each
-      // Gaussian.  First we make an alias of the condProb vector.
-      arma::vec condProbAlias = condProb.unsafe_col(i);
-      dists[i].Probability(observations, condProbAlias);
-      condProbAlias *= weights[i];
-    }
+    ConditionalProbabilities(observations, dists, weights, condProb);
 
-    // Normalize row-wise.
-    for (size_t i = 0; i < condProb.n_rows; i++)
-    {
-      // Avoid dividing by zero; if the probability for everything is 0, we
-      // don't want to make it NaN.
-      const double probSum = accu(condProb.row(i));
-      if (probSum != 0.0)
-        condProb.row(i) /= probSum;
-    }
+    // Each point only counts as much as the probability of it being from this
+    // mixture model.
+    for (size_t i = 0; i < condProb.n_cols; ++i)
+      condProb.col(i) %= probabilities;
 
-    // This will store the sum of probabilities of each state over all the
-    // observations.
-    arma::vec probRowSums(dists.size());
-
-    // Calculate the new value of the means using the updated conditional
-    // probabilities.
-    for (size_t i = 0; i < dists.size(); i++)
-    {
-      // Calculate the sum of probabilities of points, which is the
-      // conditional probability of each point being from Gaussian i
-      // multiplied by the probability of the point being from this mixture
-      // model.
-      probRowSums[i] = accu(condProb.col(i) % probabilities);
-
-      dists[i].Mean() = (observations * (condProb.col(i) % probabilities)) /
-        probRowSums[i];
-
-      // Calculate the new value of the covariances using the updated
-      // conditional probabilities and the updated means.
-      arma::mat tmp = observations - (dists[i].Mean() *
-          arma::ones<arma::rowvec>(observations.n_cols));
-      arma::mat tmpB = tmp % (arma::ones<arma::vec>(observations.n_rows) *
-          trans(condProb.col(i) % probabilities));
-
-      dists[i].Covariance() = (tmp * trans(tmpB)) / probRowSums[i];
-
-      // Apply covariance constraint.
-      constraint.ApplyConstraint(dists[i].Covariance());
-    }
+    // Calculate the new means and covariances, and store the sum of
+    // probabilities of each state over all the observations.
+    arma::vec probRowSums;
+    UpdateDistributions(observations, condProb, dists, probRowSums);
 
     // Calculate the new values for omega using the updated conditional
     // probabilities.
@@ -198,6 +125,168 @@ void EMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
   }
 }
 
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void EMFit<InitialClusteringType, CovarianceConstraintPolicy>::
+ConditionalProbabilities(
+    const arma::mat& observations,
+    const std::vector<distribution::GaussianDistribution>& dists,
+    const arma::vec& weights,
+    arma::mat& condProb) const
+{
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Each task is one Gaussian on one contiguous block of the observations, so
+  // that there is enough work for all threads even with few Gaussians.
+  const size_t blocks = std::max(std::min(numThreads,
+      (size_t) observations.n_cols), (size_t) 1);
+  const size_t tasks = blocks * dists.size();
+  condProb.set_size(observations.n_cols, dists.size());
+
+  // Factor the covariances now, so that the threads only read the factors.
+  for (size_t i = 0; i < dists.size(); ++i)
+    dists[i].FactorCovariance();
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t t = 0; t < (omp_size_t) tasks; ++t)
+  {
+    const size_t i = t % dists.size();
+    const size_t b = t / dists.size();
+    const size_t begin = b * observations.n_cols / blocks;
+    const size_t end = (b + 1) * observations.n_cols / blocks;
+    if (begin == end)
+      continue;
+
+    // An alias of the block of observations; it is not modified.
+    const arma::mat block(const_cast<double*>(observations.colptr(begin)),
+        observations.n_rows, end - begin, false, true);
+    arma::vec probabilities;
+    dists[i].Probability(block, probabilities);
+    condProb.submat(begin, i, end - 1, i) = weights[i] * probabilities;
+  }
+
+  // Normalize row-wise.
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t i = 0; i < (omp_size_t) condProb.n_rows; i++)
+  {
+    // Avoid dividing by zero; if the probability for everything is 0, we
+    // don't want to make it NaN.
+    const double probSum = accu(condProb.row(i));
+    if (probSum != 0.0)
+      condProb.row(i) /= probSum;
+  }
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void EMFit<InitialClusteringType, CovarianceConstraintPolicy>::
+UpdateDistributions(const arma::mat& observations,
+                    const arma::mat& condProb,
+                    std::vector<distribution::GaussianDistribution>& dists,
+                    arma::vec& probRowSums)
+{
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // The observations are split into contiguous blocks (as many as
+  // util::ReductionBlocks() gives), and the sufficient statistics of each
+  // block are computed separately.  They are added with util::TreeReduce(), so
+  // the result does not depend on the number of threads.
+  const size_t blocks = util::ReductionBlocks(observations.n_cols);
+  const size_t d = observations.n_rows;
+
+  // First find the weighted sums of the observations, to get the new means.
+  std::vector<arma::mat> blockMeans(blocks);
+  std::vector<arma::vec> blockSums(blocks);
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+  {
+    arma::mat& sums = blockMeans[b];
+    arma::vec& probSums = blockSums[b];
+
+    const size_t begin = b * observations.n_cols / blocks;
+    const size_t end = (b + 1) * observations.n_cols / blocks;
+    if (begin == end)
+    {
+      sums.zeros(d, dists.size());
+      probSums.zeros(dists.size());
+      continue;
+    }
+
+    sums = observations.cols(begin, end - 1) *
+        condProb.rows(begin, end - 1);
+    probSums = trans(arma::sum(condProb.rows(begin, end - 1), 0));
+  }
+
+  util::TreeReduce(blockMeans);
+  util::TreeReduce(blockSums);
+  const arma::mat& means = blockMeans[0];
+  probRowSums.swap(blockSums[0]);
+
+  // Don't update if there's no probability of the Gaussian having points.
+  for (size_t i = 0; i < dists.size(); ++i)
+    if (probRowSums[i] != 0.0)
+      dists[i].Mean() = means.col(i) / probRowSums[i];
+
+  // Now find the weighted sums of the outer products of the observations
+  // around the new means, to get the new covariances.  If the constraint only
+  // keeps the diagonal, only the diagonal is computed, which costs O(d) per
+  // point instead of O(d^2).
+  const bool diagonal =
+      CovarianceConstraintTraits<CovarianceConstraintPolicy>::IsDiagonal;
+  std::vector<std::vector<arma::mat> > covariances(dists.size(),
+      std::vector<arma::mat>(blocks));
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+  {
+    const size_t begin = b * observations.n_cols / blocks;
+    const size_t end = (b + 1) * observations.n_cols / blocks;
+    for (size_t i = 0; i < dists.size(); ++i)
+    {
+      if (begin == end)
+      {
+        covariances[i][b].zeros(d, diagonal ? 1 : d);
+        continue;
+      }
+
+      const arma::mat tmp = observations.cols(begin, end - 1) -
+          (dists[i].Mean() * arma::ones<arma::rowvec>(end - begin));
+      const arma::mat tmpB = tmp % (arma::ones<arma::vec>(d) *
+          trans(condProb.submat(begin, i, end - 1, i)));
+      if (diagonal)
+        covariances[i][b] = arma::sum(tmp % tmpB, 1);
+      else
+        covariances[i][b] = tmp * trans(tmpB);
+    }
+  }
+
+  for (size_t i = 0; i < dists.size(); ++i)
+  {
+    // Don't update if there's no probability of the Gaussian having points.
+    if (probRowSums[i] != 0.0)
+    {
+      util::TreeReduce(covariances[i]);
+      const arma::mat& covariance = covariances[i][0];
+      if (diagonal)
+        dists[i].Covariance() = arma::diagmat(covariance / probRowSums[i]);
+      else
+        dists[i].Covariance() = covariance / probRowSums[i];
+    }
+
+    // Apply covariance constraint.
+    constraint.ApplyConstraint(dists[i].Covariance());
+  }
+}
+
 template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
 void EMFit<InitialClusteringType, CovarianceConstraintPolicy>::
 InitialClustering(const arma::mat& observations,
@@ -218,6 +307,10 @@ InitialClustering(const arma::mat& observations,
     dists[i].Covariance().zeros();
   }
 
+  // If the constraint only keeps the diagonal, only the diagonal is computed.
+  const bool diagonal =
+      CovarianceConstraintTraits<CovarianceConstraintPolicy>::IsDiagonal;
+
   // From the assignments, generate our means, covariances, and weights.
   for (size_t i = 0; i < observations.n_cols; ++i)
   {
@@ -227,8 +320,12 @@ InitialClustering(const arma::mat& observations,
     dists[cluster].Mean() += observations.col(i);
 
     // Add this to the relevant covariance.
-    dists[cluster].Covariance() += observations.col(i) *
-        trans(observations.col(i));
+    if (diagonal)
+      dists[cluster].Covariance().diag() += (observations.col(i) %
+          observations.col(i));
+    else
+      dists[cluster].Covariance() += observations.col(i) *
+          trans(observations.col(i));
 
     // Now add one to the weights (we will normalize).
     weights[cluster]++;
@@ -244,7 +341,10 @@ InitialClustering(const arma::mat& observations,
   {
     const size_t cluster = assignments[i];
     const arma::vec normObs = observations.col(i) - dists[cluster].Mean();
-    dists[cluster].Covariance() += normObs * normObs.t();
+    if (diagonal)
+      dists[cluster].Covariance().diag() += (normObs % normObs);
+    else
+      dists[cluster].Covariance() += normObs * normObs.t();
   }
 
   for (size_t i = 0; i < dists.size(); ++i)
@@ -267,14 +367,40 @@ double EMFit<InitialClusteringType, CovarianceConstraintPolicy>::LogLikelihood(
 {
   double logLikelihood = 0;
 
-  arma::vec phis;
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // As in ConditionalProbabilities(), each task is one Gaussian on one block of
+  // the observations.
+  const size_t blocks = std::max(std::min(numThreads,
+      (size_t) observations.n_cols), (size_t) 1);
+  const size_t tasks = blocks * dists.size();
   arma::mat likelihoods(dists.size(), observations.n_cols);
-  
+
   for (size_t i = 0; i < dists.size(); ++i)
+    dists[i].FactorCovariance();
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t t = 0; t < (omp_size_t) tasks; ++t)
   {
-    dists[i].Probability(observations, phis);
-    likelihoods.row(i) = weights(i) * trans(phis);
+    const size_t i = t % dists.size();
+    const size_t b = t / dists.size();
+    const size_t begin = b * observations.n_cols / blocks;
+    const size_t end = (b + 1) * observations.n_cols / blocks;
+    if (begin == end)
+      continue;
+
+    const arma::mat block(const_cast<double*>(observations.colptr(begin)),
+        observations.n_rows, end - begin, false, true);
+    arma::vec phis;
+    dists[i].Probability(block, phis);
+    likelihoods.submat(i, begin, i, end - 1) = weights(i) * trans(phis);
   }
+
   // Now sum over every point.
   for (size_t j = 0; j < observations.n_cols; ++j)
   {
@@ -283,7 +409,7 @@ double EMFit<InitialClusteringType, CovarianceConstraintPolicy>::LogLikelihood(
           << "outlier." << std::endl;
     logLikelihood += log(accu(likelihoods.col(j)));
   }
-  
+
   return logLikelihood;
 }
 
@@ -88,6 +88,17 @@ class GMM
   //! Vector of a priori weights for each Gaussian.
   arma::vec weights;
 
+  //! Running average of the responsibilities of each Gaussian, for Update().
+  arma::vec onlineWeights;
+  //! Running average of the responsibility-weighted observations.
+  arma::mat onlineMeans;
+  //! Running average of the responsibility-weighted outer products.
+  std::vector<arma::mat> onlineSecondMoments;
+  //! The number of calls to Update() since the running averages were reset.
+  size_t updates;
+  //! The number of threads used to run trials (0 means all available).
+  size_t threads;
+
  public:
   /**
    * Create an empty Gaussian Mixture Model, with zero gaussians.
@@ -95,6 +106,8 @@ class GMM
   GMM() :
       gaussians(0),
       dimensionality(0),
+      updates(0),
+      threads(0),
       localFitter(FittingType()),
       fitter(localFitter)
   {
@@ -140,6 +153,8 @@ class GMM
       dimensionality((!dists.empty()) ? dists[0].Mean().n_elem : 0),
       dists(dists),
       weights(weights),
+      updates(0),
+      threads(0),
       localFitter(FittingType()),
       fitter(localFitter) { /* Nothing to do. */ }
 
@@ -159,6 +174,8 @@ class GMM
       dimensionality((!dists.empty()) ? dists[0].Mean().n_elem : 0),
       dists(dists),
       weights(weights),
+      updates(0),
+      threads(0),
       fitter(fitter) { /* Nothing to do. */ }
 
   /**
@@ -221,6 +238,22 @@ class GMM
   //! resize the means, covariances, and weights yourself.
   size_t& Gaussians() { return gaussians; }
 
+  /**
+   * Get the number of threads used to run the trials of Estimate() and to
+   * evaluate the model on many observations (0 means all available threads).
+   * Each trial runs on one thread, and draws its random numbers from the random
+   * object of that thread (see math::RandGen()), so for a given seed the result
+   * depends on the number of threads.  The fitter of each trial runs serially
+   * inside the trial, unless nested parallelism is enabled.  The results of
+   * Probability(), LogProbability() and Classify() on a matrix do not depend on
+   * the number of threads.
+   */
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used to run the trials of Estimate() and to
+  //! evaluate the model (0 means all available threads).  This has no effect
+  //! if mlpack was compiled without OpenMP.
+  size_t& Threads() { return threads; }
+
   //! Return the dimensionality of the model.
   size_t Dimensionality() const { return dimensionality; }
   //! Modify the dimensionality of the model.  Careful!  You will have to update
@@ -280,12 +313,22 @@ class GMM
 
   /**
    * Return the probability that the given observation came from this
-   * distribution.
+   * distribution.  This is exp(LogProbability(observation)).
    *
    * @param observation Observation to evaluate the probability of.
    */
   double Probability(const arma::vec& observation) const;
 
+  /**
+   * Return the log-probability of the given observation under this
+   * distribution.  The sum over the Gaussians is done in log space, so this
+   * does not underflow for an observation that is far from every Gaussian.
+   * To evaluate many observations, the matrix overload is much faster.
+   *
+   * @param observation Observation to evaluate the log-probability of.
+   */
+  double LogProbability(const arma::vec& observation) const;
+
   /**
    * Return the probability that the given observation came from the given
    * Gaussian component in this distribution.
@@ -296,6 +339,37 @@ class GMM
   double Probability(const arma::vec& observation,
                      const size_t component) const;
 
+  /**
+   * Calculate the probability that each of the given observations (the
+   * columns of the matrix) came from this distribution.  This is the
+   * exponential of LogProbability(), and is computed in the same way.
+   *
+   * @param observations Observations to evaluate the probability of.
+   * @param probabilities Vector to store the probabilities in (it is only
+   *     reallocated if it does not have one element per observation).
+   */
+  void Probability(const arma::mat& observations,
+                   arma::vec& probabilities) const;
+
+  /**
+   * Calculate the log-probability of each of the given observations (the
+   * columns of the matrix) under this distribution.  The sum over the
+   * Gaussians is done in log space, so this does not underflow for
+   * observations that are far from every Gaussian.
+   *
+   * The observations are split into blocks (see EvaluationBlockSize), which
+   * are evaluated in parallel (see Threads()); each Gaussian is evaluated on a
+   * whole block at once, with its cached Cholesky factor, so the memory used
+   * is proportional to the size of a block rather than to the number of
+   * observations.
+   *
+   * @param observations Observations to evaluate the log-probability of.
+   * @param logProbabilities Vector to store the log-probabilities in (it is
+   *     only reallocated if it does not have one element per observation).
+   */
+  void LogProbability(const arma::mat& observations,
+                      arma::vec& logProbabilities) const;
+
   /**
    * Return a randomly generated observation according to the probability
    * distribution defined by this object.
@@ -311,6 +385,8 @@ class GMM
    * The fitting will be performed 'trials' times; from these trials, the model
    * with the greatest log-likelihood will be selected.  By default, only one
    * trial is performed.  The log-likelihood of the best fitting is returned.
+   * The trials are run in parallel (see Threads()), each with its own copy of
+   * the fitter.
    *
    * Optionally, the existing model can be used as an initial model for the
    * estimation by setting 'useExistingModel' to true.  If the fitting procedure
@@ -339,6 +415,8 @@ class GMM
    * The fitting will be performed 'trials' times; from these trials, the model
    * with the greatest log-likelihood will be selected.  By default, only one
    * trial is performed.  The log-likelihood of the best fitting is returned.
+   * The trials are run in parallel (see Threads()), each with its own copy of
+   * the fitter.
    *
    * Optionally, the existing model can be used as an initial model for the
    * estimation by setting 'useExistingModel' to true.  If the fitting procedure
@@ -372,12 +450,73 @@ class GMM
    * double priorWeight = gmm.Weights()[2];
    * @endcode
    *
+   * The observations are evaluated in parallel blocks, as by
+   * LogProbability().
+   *
    * @param observations List of observations to classify.
-   * @param labels Object which will be filled with labels.
+   * @param labels Object which will be filled with labels (it is only
+   *     reallocated if it does not have one element per observation).
    */
   void Classify(const arma::mat& observations,
                 arma::Col<size_t>& labels) const;
 
+  //! The number of observations in each block evaluated by LogProbability(),
+  //! Probability() and Classify().
+  static const size_t EvaluationBlockSize = 4096;
+
+  /**
+   * Fold a mini-batch of observations into the model with one step of online
+   * (stepwise) EM.  The model keeps running averages of the sufficient
+   * statistics of each Gaussian (its responsibility, and the
+   * responsibility-weighted sums of the observations and of their outer
+   * products), so the memory used does not depend on how many observations
+   * have been seen.  Each call computes the statistics of the batch under the
+   * current model, mixes them into the running averages with the given step
+   * size, and recomputes the weights, means and covariances from the averages.
+   *
+   * The running averages start from the current model at the first call, and
+   * after Estimate(), Load() or ResetUpdates().  Call ResetUpdates() after
+   * changing the components or weights by hand.  The covariances are kept
+   * positive definite with PositiveDefiniteConstraint; use the other overload
+   * to give a different constraint.
+   *
+   * @param observations Mini-batch of observations.
+   * @param stepSize Weight of the batch in the running averages, in (0, 1].
+   *     If 0, the decreasing step size (t + 2)^-0.6 is used, where t is the
+   *     number of updates since the running averages were reset.
+   * @return The log-likelihood of the batch under the model before the update.
+   */
+  double Update(const arma::mat& observations, const double stepSize = 0.0);
+
+  /**
+   * Fold a mini-batch of observations into the model with one step of online
+   * EM, as above, applying the given covariance constraint to the updated
+   * covariances.  If the constraint only keeps the diagonal (see
+   * CovarianceConstraintTraits), only the diagonal of the second moments is
+   * accumulated, in O(d) per point; keep using the same constraint until the
+   * running averages are reset.
+   *
+   * @param observations Mini-batch of observations.
+   * @param stepSize Weight of the batch in the running averages, in (0, 1],
+   *     or 0 for the decreasing step size.
+   * @param constraint Constraint to apply to the covariances.
+   * @return The log-likelihood of the batch under the model before the update.
+   */
+  template<typename CovarianceConstraintPolicy>
+  double Update(const arma::mat& observations,
+                const double stepSize,
+                const CovarianceConstraintPolicy& constraint);
+
+  /**
+   * Forget the running averages used by Update(); the next call to Update()
+   * starts from the current model.
+   */
+  void ResetUpdates() { onlineWeights.reset(); updates = 0; }
+
+  //! Get the number of calls to Update() since the running averages were
+  //! reset.
+  size_t Updates() const { return updates; }
+
   /**
    * Returns a string representation of this object.
    */
@@ -402,6 +541,50 @@ class GMM
                        const std::vector<distribution::GaussianDistribution>& distsL,
                        const arma::vec& weights) const;
 
+  /**
+   * Run the given number of trials of the fitter (at least two) in parallel,
+   * and keep the model with the greatest log-likelihood.  This is used by
+   * Estimate().
+   *
+   * @param observations Observations of the model.
+   * @param probabilities Probability of each observation, or NULL if each
+   *     observation is certain.
+   * @param trials Number of trials to perform.
+   * @param useExistingModel If true, each trial starts from the existing model.
+   * @return The log-likelihood of the best fit.
+   */
+  double EstimateTrials(const arma::mat& observations,
+                        const arma::vec* probabilities,
+                        const size_t trials,
+                        const bool useExistingModel);
+
+  /**
+   * Factor the covariance of each Gaussian (so that they can be evaluated from
+   * several threads at once), and compute the log of each weight.
+   *
+   * @param logWeights Vector to store the log of each weight in.
+   * @return The number of threads to evaluate the model with.
+   */
+  size_t PrepareEvaluation(arma::vec& logWeights) const;
+
+  /**
+   * Compute the weighted log-probability of each observation of a block under
+   * each Gaussian: logPhis(j, i) is log(weights[i]) plus the log-probability
+   * of observation (begin + j) under Gaussian i.  PrepareEvaluation() must
+   * have been called.
+   *
+   * @param observations All of the observations.
+   * @param begin Index of the first observation of the block.
+   * @param end One past the index of the last observation of the block.
+   * @param logWeights Log of each weight.
+   * @param logPhis Matrix to store the log-probabilities in.
+   */
+  void BlockLogProbabilities(const arma::mat& observations,
+                             const size_t begin,
+                             const size_t end,
+                             const arma::vec& logWeights,
+                             arma::mat& logPhis) const;
+
   //! Locally-stored fitting object; in case the user did not pass one.
   FittingType localFitter;
 
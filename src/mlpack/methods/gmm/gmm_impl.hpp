@@ -30,6 +30,8 @@ GMM<FittingType>::GMM(const size_t gaussians, const size_t dimensionality) :
     dimensionality(dimensionality),
     dists(gaussians, distribution::GaussianDistribution(dimensionality)),
     weights(gaussians),
+    updates(0),
+    threads(0),
     localFitter(FittingType()),
     fitter(localFitter)
 {
@@ -55,6 +57,8 @@ GMM<FittingType>::GMM(const size_t gaussians,
     dimensionality(dimensionality),
     dists(gaussians, distribution::GaussianDistribution(dimensionality)),
     weights(gaussians),
+    updates(0),
+    threads(0),
     fitter(fitter)
 {
   // Set equal weights.  Technically this model is still valid, but only barely.
@@ -70,6 +74,11 @@ GMM<FittingType>::GMM(const GMM<OtherFittingType>& other) :
     dimensionality(other.dimensionality),
     dists(other.dists),
     weights(other.weights),
+    onlineWeights(other.onlineWeights),
+    onlineMeans(other.onlineMeans),
+    onlineSecondMoments(other.onlineSecondMoments),
+    updates(other.updates),
+    threads(other.Threads()),
     localFitter(FittingType()),
     fitter(localFitter) { /* Nothing to do. */ }
 
@@ -80,6 +89,11 @@ GMM<FittingType>::GMM(const GMM<FittingType>& other) :
     dimensionality(other.dimensionality),
     dists(other.dists),
     weights(other.weights),
+    onlineWeights(other.onlineWeights),
+    onlineMeans(other.onlineMeans),
+    onlineSecondMoments(other.onlineSecondMoments),
+    updates(other.updates),
+    threads(other.threads),
     localFitter(other.fitter),
     fitter(localFitter) { /* Nothing to do. */ }
 
@@ -92,6 +106,11 @@ GMM<FittingType>& GMM<FittingType>::operator=(
   dimensionality = other.dimensionality;
   dists = other.dists;
   weights = other.weights;
+  onlineWeights = other.onlineWeights;
+  onlineMeans = other.onlineMeans;
+  onlineSecondMoments = other.onlineSecondMoments;
+  updates = other.updates;
+  threads = other.Threads();
 
   return *this;
 }
@@ -103,6 +122,11 @@ GMM<FittingType>& GMM<FittingType>::operator=(const GMM<FittingType>& other)
   dimensionality = other.dimensionality;
   dists = other.dists;
   weights = other.weights;
+  onlineWeights = other.onlineWeights;
+  onlineMeans = other.onlineMeans;
+  onlineSecondMoments = other.onlineSecondMoments;
+  updates = other.updates;
+  threads = other.threads;
   localFitter = other.fitter;
 
   return *this;
@@ -178,21 +202,40 @@ void GMM<FittingType>::Load(const util::SaveRestoreUtility& sr)
       o << "gaussian" << i;
       dists[i].Load(sr.Children().at(o.str()));
     }
+
+    ResetUpdates();
 }
 
+template<typename FittingType>
+const size_t GMM<FittingType>::EvaluationBlockSize;
+
 /**
  * Return the probability of the given observation being from this GMM.
  */
 template<typename FittingType>
 double GMM<FittingType>::Probability(const arma::vec& observation) const
+{
+  return std::exp(LogProbability(observation));
+}
+
+/**
+ * Return the log-probability of the given observation being from this GMM.
+ */
+template<typename FittingType>
+double GMM<FittingType>::LogProbability(const arma::vec& observation) const
 {
   // Sum the probability for each Gaussian in our mixture (and we have to
-  // multiply by the prior for each Gaussian too).
-  double sum = 0;
+  // multiply by the prior for each Gaussian too), in log space.
+  arma::vec logPhis(gaussians);
   for (size_t i = 0; i < gaussians; i++)
-    sum += weights[i] * dists[i].Probability(observation);
+    logPhis[i] = std::log(weights[i]) + dists[i].LogProbability(observation);
 
-  return sum;
+  const double maxLog = (gaussians == 0) ?
+      -std::numeric_limits<double>::infinity() : logPhis.max();
+  if (maxLog == -std::numeric_limits<double>::infinity())
+    return maxLog;
+
+  return maxLog + std::log(arma::accu(arma::exp(logPhis - maxLog)));
 }
 
 /**
@@ -208,6 +251,65 @@ double GMM<FittingType>::Probability(const arma::vec& observation,
   return weights[component] * dists[component].Probability(observation);
 }
 
+/**
+ * Return the probability of each of the given observations being from this
+ * GMM.
+ */
+template<typename FittingType>
+void GMM<FittingType>::Probability(const arma::mat& observations,
+                                   arma::vec& probabilities) const
+{
+  LogProbability(observations, probabilities);
+  probabilities = arma::exp(probabilities);
+}
+
+/**
+ * Return the log-probability of each of the given observations being from this
+ * GMM.
+ */
+template<typename FittingType>
+void GMM<FittingType>::LogProbability(const arma::mat& observations,
+                                      arma::vec& logProbabilities) const
+{
+  logProbabilities.set_size(observations.n_cols);
+
+  arma::vec logWeights;
+  const size_t numThreads = PrepareEvaluation(logWeights);
+
+  const size_t blockSize = EvaluationBlockSize;
+  const size_t numBlocks = (observations.n_cols + blockSize - 1) / blockSize;
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) numBlocks; ++b)
+  {
+    const size_t begin = b * blockSize;
+    const size_t end = std::min(begin + blockSize,
+        (size_t) observations.n_cols);
+
+    // Column i holds the weighted log-probabilities under Gaussian i.
+    arma::mat logPhis;
+    BlockLogProbabilities(observations, begin, end, logWeights, logPhis);
+
+    for (size_t j = 0; j < logPhis.n_rows; ++j)
+    {
+      double maxLog = -std::numeric_limits<double>::infinity();
+      for (size_t i = 0; i < gaussians; ++i)
+        maxLog = std::max(maxLog, logPhis(j, i));
+
+      if (maxLog == -std::numeric_limits<double>::infinity())
+      {
+        logProbabilities[begin + j] = maxLog;
+        continue;
+      }
+
+      double sum = 0.0;
+      for (size_t i = 0; i < gaussians; ++i)
+        sum += std::exp(logPhis(j, i) - maxLog);
+      logProbabilities[begin + j] = maxLog + std::log(sum);
+    }
+  }
+}
+
 /**
  * Return a randomly generated observation according to the probability
  * distribution defined by this object.
@@ -230,8 +332,7 @@ arma::vec GMM<FittingType>::Random() const
     }
   }
 
-  return trans(chol(dists[gaussian].Covariance())) *
-      arma::randn<arma::vec>(dimensionality) + dists[gaussian].Mean();
+  return dists[gaussian].Random();
 }
 
 /**
@@ -258,61 +359,17 @@ double GMM<FittingType>::Estimate(const arma::mat& observations,
     if (trials == 0)
       return -DBL_MAX; // It's what they asked for...
 
-    // If each trial must start from the same initial location, we must save it.
-    std::vector<distribution::GaussianDistribution> distsOrig;
-    arma::vec weightsOrig;
-    if (useExistingModel)
-    {
-      distsOrig = dists;
-      weightsOrig = weights;
-    }
-
-    // We need to keep temporary copies.  We'll do the first training into the
-    // actual model position, so that if it's the best we don't need to copy it.
-    fitter.Estimate(observations, dists, weights,
+    bestLikelihood = EstimateTrials(observations, NULL, trials,
         useExistingModel);
-
-    bestLikelihood = LogLikelihood(observations, dists, weights);
-
-    Log::Info << "GMM::Estimate(): Log-likelihood of trial 0 is "
-        << bestLikelihood << "." << std::endl;
-
-    // Now the temporary model.
-    std::vector<distribution::GaussianDistribution> distsTrial(gaussians,
-        distribution::GaussianDistribution(dimensionality));
-    arma::vec weightsTrial(gaussians);
-
-    for (size_t trial = 1; trial < trials; ++trial)
-    {
-      if (useExistingModel)
-      {
-        distsTrial = distsOrig;
-        weightsTrial = weightsOrig;
-      }
-
-      fitter.Estimate(observations, distsTrial, weightsTrial, useExistingModel);
-
-      // Check to see if the log-likelihood of this one is better.
-      double newLikelihood = LogLikelihood(observations, distsTrial,
-          weightsTrial);
-
-      Log::Info << "GMM::Estimate(): Log-likelihood of trial " << trial
-          << " is " << newLikelihood << "." << std::endl;
-
-      if (newLikelihood > bestLikelihood)
-      {
-        // Save new likelihood and copy new model.
-        bestLikelihood = newLikelihood;
-
-        dists = distsTrial;
-        weights = weightsTrial;
-      }
-    }
   }
 
   // Report final log-likelihood and return it.
   Log::Info << "GMM::Estimate(): log-likelihood of trained GMM is "
       << bestLikelihood << "." << std::endl;
+
+  // The running averages of Update() belong to the old model.
+  ResetUpdates();
+
   return bestLikelihood;
 }
 
@@ -342,63 +399,79 @@ double GMM<FittingType>::Estimate(const arma::mat& observations,
     if (trials == 0)
       return -DBL_MAX; // It's what they asked for...
 
-    // If each trial must start from the same initial location, we must save it.
-    std::vector<distribution::GaussianDistribution> distsOrig;
-    arma::vec weightsOrig;
-    if (useExistingModel)
-    {
-      distsOrig = dists;
-      weightsOrig = weights;
-    }
-
-    // We need to keep temporary copies.  We'll do the first training into the
-    // actual model position, so that if it's the best we don't need to copy it.
-    fitter.Estimate(observations, probabilities, dists, weights,
+    bestLikelihood = EstimateTrials(observations, &probabilities, trials,
         useExistingModel);
+  }
 
-    bestLikelihood = LogLikelihood(observations, dists, weights);
-
-    Log::Debug << "GMM::Estimate(): Log-likelihood of trial 0 is "
-        << bestLikelihood << "." << std::endl;
+  // Report final log-likelihood and return it.
+  Log::Info << "GMM::Estimate(): log-likelihood of trained GMM is "
+      << bestLikelihood << "." << std::endl;
 
-    // Now the temporary model.
-    std::vector<distribution::GaussianDistribution> distsTrial(gaussians,
-        distribution::GaussianDistribution(dimensionality));
-    arma::vec weightsTrial(gaussians);
+  // The running averages of Update() belong to the old model.
+  ResetUpdates();
 
-    for (size_t trial = 1; trial < trials; ++trial)
-    {
-      if (useExistingModel)
-      {
-        distsTrial = distsOrig;
-        weightsTrial = weightsOrig;
-      }
-
-      fitter.Estimate(observations, distsTrial, weightsTrial,
-          useExistingModel);
+  return bestLikelihood;
+}
 
-      // Check to see if the log-likelihood of this one is better.
-      double newLikelihood = LogLikelihood(observations, distsTrial,
-          weightsTrial);
+/**
+ * Run several trials of the fitter in parallel, and keep the best model.
+ */
+template<typename FittingType>
+double GMM<FittingType>::EstimateTrials(const arma::mat& observations,
+                                        const arma::vec* probabilities,
+                                        const size_t trials,
+                                        const bool useExistingModel)
+{
+  // Each trial fits its own model; they all start from the existing model, if
+  // that was asked for.
+  std::vector<std::vector<distribution::GaussianDistribution> > trialDists(
+      trials, useExistingModel ? dists :
+      std::vector<distribution::GaussianDistribution>(gaussians,
+      distribution::GaussianDistribution(dimensionality)));
+  std::vector<arma::vec> trialWeights(trials, useExistingModel ? weights :
+      arma::vec(gaussians));
+  arma::vec likelihoods(trials);
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
 
-      Log::Debug << "GMM::Estimate(): Log-likelihood of trial " << trial
-          << " is " << newLikelihood << "." << std::endl;
+  // The trials are independent.  Each one gets its own copy of the fitter (and
+  // so of its initial clustering object), and, inside the parallel region, the
+  // random numbers come from the random object of its thread.
+  #pragma omp parallel for num_threads(numThreads) schedule(static, 1)
+  for (omp_size_t trial = 0; trial < (omp_size_t) trials; ++trial)
+  {
+    FittingType trialFitter(fitter);
+    if (probabilities != NULL)
+      trialFitter.Estimate(observations, *probabilities, trialDists[trial],
+          trialWeights[trial], useExistingModel);
+    else
+      trialFitter.Estimate(observations, trialDists[trial],
+          trialWeights[trial], useExistingModel);
+
+    likelihoods[trial] = LogLikelihood(observations, trialDists[trial],
+        trialWeights[trial]);
+  }
 
-      if (newLikelihood > bestLikelihood)
-      {
-        // Save new likelihood and copy new model.
-        bestLikelihood = newLikelihood;
+  // Keep the best trial (the first one, if there are ties).
+  size_t bestTrial = 0;
+  for (size_t trial = 0; trial < trials; ++trial)
+  {
+    Log::Info << "GMM::Estimate(): Log-likelihood of trial " << trial
+        << " is " << likelihoods[trial] << "." << std::endl;
 
-        dists = distsTrial;
-        weights = weightsTrial;
-      }
-    }
+    if (likelihoods[trial] > likelihoods[bestTrial])
+      bestTrial = trial;
   }
 
-  // Report final log-likelihood and return it.
-  Log::Info << "GMM::Estimate(): log-likelihood of trained GMM is "
-      << bestLikelihood << "." << std::endl;
-  return bestLikelihood;
+  dists.swap(trialDists[bestTrial]);
+  weights = trialWeights[bestTrial];
+
+  return likelihoods[bestTrial];
 }
 
 /**
@@ -409,27 +482,89 @@ template<typename FittingType>
 void GMM<FittingType>::Classify(const arma::mat& observations,
                                 arma::Col<size_t>& labels) const
 {
-  // This is not the best way to do this!
-
-  // We should not have to fill this with values, because each one should be
-  // overwritten.
   labels.set_size(observations.n_cols);
-  for (size_t i = 0; i < observations.n_cols; ++i)
+
+  arma::vec logWeights;
+  const size_t numThreads = PrepareEvaluation(logWeights);
+
+  const size_t blockSize = EvaluationBlockSize;
+  const size_t numBlocks = (observations.n_cols + blockSize - 1) / blockSize;
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) numBlocks; ++b)
   {
-    // Find maximum probability component.
-    double probability = 0;
-    for (size_t j = 0; j < gaussians; ++j)
+    const size_t begin = b * blockSize;
+    const size_t end = std::min(begin + blockSize,
+        (size_t) observations.n_cols);
+
+    arma::mat logPhis;
+    BlockLogProbabilities(observations, begin, end, logWeights, logPhis);
+
+    // Now find the maximum probability component of each observation.
+    // Working with logs means that points far from every component are still
+    // labeled correctly.
+    for (size_t j = 0; j < logPhis.n_rows; ++j)
     {
-      double newProb = Probability(observations.unsafe_col(i), j);
-      if (newProb >= probability)
+      double logProbability = -std::numeric_limits<double>::infinity();
+      labels[begin + j] = 0;
+      for (size_t i = 0; i < gaussians; ++i)
       {
-        probability = newProb;
-        labels[i] = j;
+        if (logPhis(j, i) >= logProbability)
+        {
+          logProbability = logPhis(j, i);
+          labels[begin + j] = i;
+        }
       }
     }
   }
 }
 
+/**
+ * Prepare the Gaussians to be evaluated from several threads.
+ */
+template<typename FittingType>
+size_t GMM<FittingType>::PrepareEvaluation(arma::vec& logWeights) const
+{
+  // The first evaluation of a Gaussian after its covariance changes updates its
+  // cached factorization, so that has to happen before the threads start.
+  logWeights.set_size(gaussians);
+  for (size_t i = 0; i < gaussians; ++i)
+  {
+    dists[i].FactorCovariance();
+    logWeights[i] = std::log(weights[i]);
+  }
+
+#ifdef _OPENMP
+  return (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  return 1;
+#endif
+}
+
+/**
+ * Compute the weighted log-probabilities of a block of observations under each
+ * Gaussian.
+ */
+template<typename FittingType>
+void GMM<FittingType>::BlockLogProbabilities(const arma::mat& observations,
+                                             const size_t begin,
+                                             const size_t end,
+                                             const arma::vec& logWeights,
+                                             arma::mat& logPhis) const
+{
+  // Alias the block of observations instead of copying it.
+  const arma::mat block(const_cast<double*>(observations.colptr(begin)),
+      observations.n_rows, end - begin, false, true);
+
+  logPhis.set_size(end - begin, gaussians);
+  arma::vec phis;
+  for (size_t i = 0; i < gaussians; ++i)
+  {
+    dists[i].LogProbability(block, phis);
+    logPhis.col(i) = phis + logWeights[i];
+  }
+}
+
 /**
  * Get the log-likelihood of this data's fit to the model.
  */
@@ -455,6 +590,135 @@ double GMM<FittingType>::LogLikelihood(
   return loglikelihood;
 }
 
+/**
+ * Fold a mini-batch of observations into the model with one step of online EM.
+ */
+template<typename FittingType>
+double GMM<FittingType>::Update(const arma::mat& observations,
+                                const double stepSize)
+{
+  return Update(observations, stepSize, PositiveDefiniteConstraint());
+}
+
+/**
+ * Fold a mini-batch of observations into the model with one step of online EM,
+ * with the given covariance constraint.
+ */
+template<typename FittingType>
+template<typename CovarianceConstraintPolicy>
+double GMM<FittingType>::Update(const arma::mat& observations,
+                                const double stepSize,
+                                const CovarianceConstraintPolicy& constraint)
+{
+  if (observations.n_cols == 0)
+    return 0.0;
+
+  // Start the running averages from the current model, if necessary.
+  if (onlineWeights.n_elem != gaussians)
+  {
+    onlineWeights = weights;
+    onlineMeans.set_size(dimensionality, gaussians);
+    onlineSecondMoments.resize(gaussians);
+    for (size_t i = 0; i < gaussians; ++i)
+    {
+      onlineMeans.col(i) = weights[i] * dists[i].Mean();
+      onlineSecondMoments[i] = weights[i] * (dists[i].Covariance() +
+          dists[i].Mean() * trans(dists[i].Mean()));
+    }
+
+    updates = 0;
+  }
+
+  const double eta = (stepSize > 0.0) ? stepSize :
+      std::pow(updates + 2.0, -0.6);
+
+  // The E-step on the batch: the responsibilities under the current model,
+  // computed in log space so that far-away points don't underflow.
+  arma::mat logProbabilities(observations.n_cols, gaussians);
+  arma::vec logProbability;
+  for (size_t i = 0; i < gaussians; ++i)
+  {
+    dists[i].LogProbability(observations, logProbability);
+    logProbabilities.col(i) = logProbability + std::log(weights[i]);
+  }
+
+  double logLikelihood = 0.0;
+  arma::mat responsibilities(observations.n_cols, gaussians);
+  for (size_t j = 0; j < observations.n_cols; ++j)
+  {
+    const arma::rowvec row = logProbabilities.row(j);
+    const double maxLog = row.max();
+    if (maxLog == -std::numeric_limits<double>::infinity())
+    {
+      // No component can have generated this point.
+      responsibilities.row(j).zeros();
+      logLikelihood += maxLog;
+      continue;
+    }
+
+    const double logSum = maxLog + std::log(arma::accu(arma::exp(row -
+        maxLog)));
+    responsibilities.row(j) = arma::exp(row - logSum);
+    logLikelihood += logSum;
+  }
+
+  // Mix the averages over the batch into the running averages.
+  const double n = observations.n_cols;
+  onlineWeights = (1.0 - eta) * onlineWeights + (eta / n) *
+      trans(arma::sum(responsibilities, 0));
+  onlineMeans = (1.0 - eta) * onlineMeans + (eta / n) * (observations *
+      responsibilities);
+
+  // If the constraint only keeps the diagonal, only the diagonal of the second
+  // moments is needed, in O(d) per point.
+  const bool diagonal =
+      CovarianceConstraintTraits<CovarianceConstraintPolicy>::IsDiagonal;
+
+  for (size_t i = 0; i < gaussians; ++i)
+  {
+    onlineSecondMoments[i] *= (1.0 - eta);
+    if (diagonal)
+    {
+      onlineSecondMoments[i].diag() += (eta / n) * ((observations %
+          observations) * responsibilities.col(i));
+    }
+    else
+    {
+      arma::mat weighted = observations;
+      for (size_t j = 0; j < weighted.n_cols; ++j)
+        weighted.col(j) *= responsibilities(j, i);
+      onlineSecondMoments[i] += (eta / n) * (weighted * trans(observations));
+    }
+
+    // The M-step.  Don't update if the Gaussian has no responsibility.
+    if (onlineWeights[i] > 0.0)
+    {
+      dists[i].Mean() = onlineMeans.col(i) / onlineWeights[i];
+      if (diagonal)
+      {
+        arma::vec variances = onlineSecondMoments[i].diag() /
+            onlineWeights[i] - (dists[i].Mean() % dists[i].Mean());
+        for (size_t j = 0; j < variances.n_elem; ++j)
+          if (variances[j] <= 1e-50)
+            variances[j] = 1e-50;
+        dists[i].Covariance() = arma::diagmat(variances);
+      }
+      else
+      {
+        dists[i].Covariance() = onlineSecondMoments[i] / onlineWeights[i] -
+            dists[i].Mean() * trans(dists[i].Mean());
+      }
+
+      constraint.ApplyConstraint(dists[i].Covariance());
+    }
+  }
+
+  weights = onlineWeights / arma::accu(onlineWeights);
+  ++updates;
+
+  return logLikelihood;
+}
+
 /**
 * Returns a string representation of this object.
 */
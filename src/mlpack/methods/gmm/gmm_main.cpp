@@ -50,6 +50,9 @@ PARAM_FLAG("no_force_positive", "Do not force the covariance matrices to be "
     "positive definite.", "P");
 PARAM_INT("max_iterations", "Maximum number of iterations of EM algorithm "
     "(passing 0 will run until convergence).", "n", 250);
+PARAM_INT("threads", "Number of threads to use for the EM algorithm (0 uses "
+    "all available cores; ignored if mlpack was built without OpenMP).", "j",
+    0);
 
 // Parameters for dataset modification.
 PARAM_DOUBLE("noise", "Variance of zero-mean Gaussian noise to add to data.",
@@ -100,6 +103,12 @@ int main(int argc, char* argv[])
   const size_t maxIterations = (size_t) CLI::GetParam<int>("max_iterations");
   const double tolerance = CLI::GetParam<double>("tolerance");
   const bool forcePositive = !CLI::HasParam("no_force_positive");
+  const int threads = CLI::GetParam<int>("threads");
+  if (threads < 0)
+  {
+    Log::Fatal << "Invalid number of threads (" << threads << "); must be "
+        << "greater than or equal to 0." << std::endl;
+  }
 
   // This gets a bit weird because we need different types depending on whether
   // --refined_start is specified.
@@ -128,6 +137,7 @@ int main(int argc, char* argv[])
     if (forcePositive)
     {
       EMFit<KMeansType> em(maxIterations, tolerance, k);
+      em.Threads() = (size_t) threads;
 
       GMM<EMFit<KMeansType> > gmm(size_t(gaussians), dataPoints.n_rows, em);
 
@@ -142,6 +152,7 @@ int main(int argc, char* argv[])
     else
     {
       EMFit<KMeansType, NoConstraint> em(maxIterations, tolerance, k);
+      em.Threads() = (size_t) threads;
 
       GMM<EMFit<KMeansType, NoConstraint> > gmm(size_t(gaussians),
           dataPoints.n_rows, em);
@@ -161,6 +172,7 @@ int main(int argc, char* argv[])
     if (forcePositive)
     {
       EMFit<> em(maxIterations, tolerance);
+      em.Threads() = (size_t) threads;
 
       // Calculate mixture of Gaussians.
       GMM<> gmm(size_t(gaussians), dataPoints.n_rows, em);
@@ -177,6 +189,7 @@ int main(int argc, char* argv[])
     {
       // Use no constraints on the covariance matrix.
       EMFit<KMeans<>, NoConstraint> em(maxIterations, tolerance);
+      em.Threads() = (size_t) threads;
 
       // Calculate mixture of Gaussians.
       GMM<EMFit<KMeans<>, NoConstraint> > gmm(size_t(gaussians),
@@ -0,0 +1,254 @@
+/**
+ * @file mrkd_em_fit.hpp
+ *
+ * Utility class to fit a GMM using the EM algorithm, accelerated with a
+ * multi-resolution kd-tree.  Can be used by GMM::Estimate<>() in place of
+ * EMFit.
+ */
+#ifndef __MLPACK_METHODS_GMM_MRKD_EM_FIT_HPP
+#define __MLPACK_METHODS_GMM_MRKD_EM_FIT_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/tree/binary_space_tree.hpp>
+#include <mlpack/core/tree/mrkd_statistic.hpp>
+
+// Default clustering mechanism.
+#include <mlpack/methods/kmeans/kmeans.hpp>
+// Default covariance matrix constraint.
+#include "positive_definite_constraint.hpp"
+
+namespace mlpack {
+namespace gmm {
+
+/**
+ * This class fits a GMM to observations with the EM algorithm, like EMFit, but
+ * each E-step is a traversal of a multi-resolution kd-tree (mrkd-tree) built
+ * on the observations, after the approach of Moore:
+ *
+ * @code
+ * @inproceedings{moore1999very,
+ *   title={Very fast EM-based mixture model clustering using multiresolution
+ *       kd-trees},
+ *   author={Moore, Andrew W.},
+ *   booktitle={Advances in Neural Information Processing Systems 11
+ *       (NIPS 1998)},
+ *   pages={543--549},
+ *   year={1999}
+ * }
+ * @endcode
+ *
+ * Each node of the tree caches the weight, the center of mass and the scatter
+ * matrix of its points (in tree::MRKDStatistic).  During the E-step, the
+ * Mahalanobis distance from each Gaussian to any point in a node is bounded
+ * using the distance to the center of mass and the radius of the node, which
+ * gives bounds on the responsibility of each Gaussian for the points of the
+ * node.  If every responsibility is determined to within the given tolerance
+ * (Tau()), the whole node is assigned the responsibilities of its center of
+ * mass, and its cached statistics are added to the M-step sums without
+ * looking at its points.  Otherwise the children are visited, and the points
+ * of leaves are handled exactly.  Smaller values of Tau() give models closer
+ * to those of EMFit, at the cost of visiting more nodes.
+ *
+ * The log-likelihood used for the convergence check is computed in the same
+ * approximate way.  This works best for low to moderate dimensionality, where
+ * kd-tree nodes are small compared to the Gaussians.
+ *
+ * The clustering mechanism and the covariance constraint are used in the same
+ * way as in EMFit.
+ *
+ * @tparam InitialClusteringType Type of clusterer used for the initial model.
+ * @tparam CovarianceConstraintPolicy Constraint applied to each covariance.
+ */
+template<typename InitialClusteringType = kmeans::KMeans<>,
+         typename CovarianceConstraintPolicy = PositiveDefiniteConstraint>
+class MRKDEMFit
+{
+ public:
+  //! The type of tree used.
+  typedef tree::BinarySpaceTree<bound::HRectBound<2>, tree::MRKDStatistic>
+      TreeType;
+
+  /**
+   * Construct the MRKDEMFit object.  Setting the maximum number of iterations
+   * to 0 means that the EM algorithm will iterate until convergence (with the
+   * given tolerance).
+   *
+   * @param maxIterations Maximum number of iterations for EM.
+   * @param tolerance Log-likelihood tolerance required for convergence.
+   * @param tau Maximum difference between the bounds of a responsibility for a
+   *     node to be handled as a whole.
+   * @param leafSize Maximum number of points in each leaf of the tree.
+   * @param clusterer Object which will perform the initial clustering.
+   * @param constraint Object which applies constraints to the covariances.
+   */
+  MRKDEMFit(const size_t maxIterations = 300,
+            const double tolerance = 1e-10,
+            const double tau = 0.01,
+            const size_t leafSize = 20,
+            InitialClusteringType clusterer = InitialClusteringType(),
+            CovarianceConstraintPolicy constraint =
+                CovarianceConstraintPolicy());
+
+  /**
+   * Fit the observations to a Gaussian mixture model (GMM) using the EM
+   * algorithm.  The size of the vectors (indicating the number of components)
+   * must already be set.  Optionally, if useInitialModel is set to true, then
+   * the model given in the dists and weights parameters is used as the initial
+   * model, instead of using the InitialClusteringType::Cluster() option.
+   *
+   * @param observations List of observations to train on.
+   * @param dists Vector of Gaussians to store the trained model in.
+   * @param weights Vector to store a priori weights in.
+   * @param useInitialModel If true, the given model is used for the initial
+   *      clustering.
+   */
+  void Estimate(const arma::mat& observations,
+                std::vector<distribution::GaussianDistribution>& dists,
+                arma::vec& weights,
+                const bool useInitialModel = false);
+
+  /**
+   * Fit the observations to a Gaussian mixture model (GMM) using the EM
+   * algorithm, taking into account the probabilities of each point being from
+   * this mixture.  The size of the vectors (indicating the number of
+   * components) must already be set.
+   *
+   * @param observations List of observations to train on.
+   * @param probabilities Probability of each point being from this model.
+   * @param dists Vector of Gaussians to store the trained model in.
+   * @param weights Vector to store a priori weights in.
+   * @param useInitialModel If true, the given model is used for the initial
+   *      clustering.
+   */
+  void Estimate(const arma::mat& observations,
+                const arma::vec& probabilities,
+                std::vector<distribution::GaussianDistribution>& dists,
+                arma::vec& weights,
+                const bool useInitialModel = false);
+
+  //! Get the clusterer.
+  const InitialClusteringType& Clusterer() const { return clusterer; }
+  //! Modify the clusterer.
+  InitialClusteringType& Clusterer() { return clusterer; }
+
+  //! Get the covariance constraint policy class.
+  const CovarianceConstraintPolicy& Constraint() const { return constraint; }
+  //! Modify the covariance constraint policy class.
+  CovarianceConstraintPolicy& Constraint() { return constraint; }
+
+  //! Get the maximum number of iterations of the EM algorithm.
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of iterations of the EM algorithm.
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get the tolerance for the convergence of the EM algorithm.
+  double Tolerance() const { return tolerance; }
+  //! Modify the tolerance for the convergence of the EM algorithm.
+  double& Tolerance() { return tolerance; }
+
+  //! Get the responsibility tolerance for handling a node as a whole.
+  double Tau() const { return tau; }
+  //! Modify the responsibility tolerance for handling a node as a whole.
+  double& Tau() { return tau; }
+
+  //! Get the maximum number of points in each leaf of the tree.
+  size_t LeafSize() const { return leafSize; }
+  //! Modify the maximum number of points in each leaf of the tree.
+  size_t& LeafSize() { return leafSize; }
+
+  //! Get the number of nodes handled as a whole in the last call to
+  //! Estimate().
+  size_t Prunes() const { return prunes; }
+
+ private:
+  /**
+   * The sums collected by one E-step, from which the M-step computes the new
+   * model.  The sums for each Gaussian are taken around its current mean.
+   */
+  struct Sums
+  {
+    //! Total responsibility of each Gaussian.
+    arma::vec responsibilities;
+    //! Responsibility-weighted sum of the offsets from each mean.
+    arma::mat offsets;
+    //! Responsibility-weighted sum of the outer products of the offsets.
+    std::vector<arma::mat> scatters;
+    //! The (approximate) log-likelihood.
+    double logLikelihood;
+  };
+
+  /**
+   * Run the EM algorithm on the given tree, whose statistics have been
+   * computed with the given point weights.
+   */
+  void Estimate(TreeType& tree,
+                const arma::vec& pointWeights,
+                std::vector<distribution::GaussianDistribution>& dists,
+                arma::vec& weights);
+
+  /**
+   * Run one E-step on the given tree: collect the sums for the M-step, and the
+   * log-likelihood of the current model.
+   */
+  void EStep(const TreeType& tree,
+             const arma::vec& pointWeights,
+             const std::vector<distribution::GaussianDistribution>& dists,
+             const arma::vec& weights,
+             Sums& sums);
+
+  /**
+   * Compute the statistics of the given node and its descendants, using the
+   * given weight for each point (in the order of the tree's dataset).
+   */
+  void BuildStatistics(TreeType& node, const arma::vec& pointWeights);
+
+  /**
+   * Collect the E-step sums for the points of the given node.
+   *
+   * @param node Node to visit.
+   * @param dists Current Gaussians.
+   * @param logWeights Log of the current a priori weights.
+   * @param logPeaks Log-density of each Gaussian at its mean.
+   * @param invSqrtEigenvalues For each Gaussian, one over the square root of
+   *     the smallest eigenvalue of its covariance.
+   * @param pointWeights Weight of each point of the tree's dataset.
+   * @param sums Sums to add to.
+   */
+  void Traverse(const TreeType& node,
+                const std::vector<distribution::GaussianDistribution>& dists,
+                const arma::vec& logWeights,
+                const arma::vec& logPeaks,
+                const arma::vec& invSqrtEigenvalues,
+                const arma::vec& pointWeights,
+                Sums& sums);
+
+  /**
+   * Run the clusterer, and then turn the cluster assignments into Gaussians.
+   */
+  void InitialClustering(const arma::mat& observations,
+                         std::vector<distribution::GaussianDistribution>& dists,
+                         arma::vec& weights);
+
+  //! Maximum iterations of EM algorithm.
+  size_t maxIterations;
+  //! Tolerance for convergence of EM.
+  double tolerance;
+  //! Responsibility tolerance for handling a node as a whole.
+  double tau;
+  //! Maximum number of points in each leaf.
+  size_t leafSize;
+  //! Object which will perform the clustering.
+  InitialClusteringType clusterer;
+  //! Object which applies constraints to the covariance matrix.
+  CovarianceConstraintPolicy constraint;
+  //! The number of nodes handled as a whole in the last call to Estimate().
+  size_t prunes;
+};
+
+}; // namespace gmm
+}; // namespace mlpack
+
+// Include implementation.
+#include "mrkd_em_fit_impl.hpp"
+
+#endif
@@ -0,0 +1,438 @@
+/**
+ * @file mrkd_em_fit_impl.hpp
+ *
+ * Implementation of the mrkd-tree accelerated EM algorithm for fitting GMMs.
+ */
+#ifndef __MLPACK_METHODS_GMM_MRKD_EM_FIT_IMPL_HPP
+#define __MLPACK_METHODS_GMM_MRKD_EM_FIT_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "mrkd_em_fit.hpp"
+
+namespace mlpack {
+namespace gmm {
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::MRKDEMFit(
+    const size_t maxIterations,
+    const double tolerance,
+    const double tau,
+    const size_t leafSize,
+    InitialClusteringType clusterer,
+    CovarianceConstraintPolicy constraint) :
+    maxIterations(maxIterations),
+    tolerance(tolerance),
+    tau(tau),
+    leafSize(leafSize),
+    clusterer(clusterer),
+    constraint(constraint),
+    prunes(0)
+{ /* Nothing to do. */ }
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
+    const arma::mat& observations,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights,
+    const bool useInitialModel)
+{
+  // Only perform initial clustering if the user wanted it.
+  if (!useInitialModel)
+    InitialClustering(observations, dists, weights);
+
+  // The tree reorders the points, so it is built on a copy.
+  arma::mat data(observations);
+  std::vector<size_t> oldFromNew;
+  TreeType tree(data, oldFromNew, leafSize);
+
+  const arma::vec pointWeights = arma::ones<arma::vec>(data.n_cols);
+  BuildStatistics(tree, pointWeights);
+  Estimate(tree, pointWeights, dists, weights);
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
+    const arma::mat& observations,
+    const arma::vec& probabilities,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights,
+    const bool useInitialModel)
+{
+  if (!useInitialModel)
+    InitialClustering(observations, dists, weights);
+
+  arma::mat data(observations);
+  std::vector<size_t> oldFromNew;
+  TreeType tree(data, oldFromNew, leafSize);
+
+  // Each point is weighted by the probability of it being from this model.
+  arma::vec pointWeights(data.n_cols);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    pointWeights[i] = probabilities[oldFromNew[i]];
+
+  BuildStatistics(tree, pointWeights);
+  Estimate(tree, pointWeights, dists, weights);
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Estimate(
+    TreeType& tree,
+    const arma::vec& pointWeights,
+    std::vector<distribution::GaussianDistribution>& dists,
+    arma::vec& weights)
+{
+  prunes = 0;
+  const double totalWeight = tree.Stat().Weight();
+
+  // Each E-step gives both the log-likelihood of the current model and the
+  // sums that the M-step needs to compute the next one.
+  Sums sums;
+  EStep(tree, pointWeights, dists, weights, sums);
+  double l = sums.logLikelihood;
+
+  Log::Debug << "MRKDEMFit::Estimate(): initial clustering log-likelihood: "
+      << l << std::endl;
+
+  double lOld = -DBL_MAX;
+
+  // Iterate to update the model until no more improvement is found.
+  size_t iteration = 1;
+  while (std::abs(l - lOld) > tolerance && iteration != maxIterations)
+  {
+    Log::Info << "MRKDEMFit::Estimate(): iteration " << iteration << ", "
+        << "log-likelihood " << l << "." << std::endl;
+
+    // The M-step.  The sums are taken around the old means, so the new mean is
+    // the old mean plus the average offset.
+    for (size_t i = 0; i < dists.size(); ++i)
+    {
+      // Don't update if there's no probability of the Gaussian having points.
+      if (sums.responsibilities[i] != 0.0)
+      {
+        const arma::vec shift = sums.offsets.col(i) /
+            sums.responsibilities[i];
+        dists[i].Mean() += shift;
+        dists[i].Covariance() = sums.scatters[i] / sums.responsibilities[i] -
+            shift * trans(shift);
+      }
+
+      // Apply covariance constraint.
+      constraint.ApplyConstraint(dists[i].Covariance());
+    }
+
+    weights = sums.responsibilities / totalWeight;
+
+    // The E-step, which also gives the new log-likelihood.
+    lOld = l;
+    EStep(tree, pointWeights, dists, weights, sums);
+    l = sums.logLikelihood;
+
+    iteration++;
+  }
+
+  Log::Info << "MRKDEMFit::Estimate(): " << prunes << " nodes handled as a "
+      << "whole." << std::endl;
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::EStep(
+    const TreeType& tree,
+    const arma::vec& pointWeights,
+    const std::vector<distribution::GaussianDistribution>& dists,
+    const arma::vec& weights,
+    Sums& sums)
+{
+  const size_t dimensionality = tree.Dataset().n_rows;
+
+  sums.responsibilities.zeros(dists.size());
+  sums.offsets.zeros(dimensionality, dists.size());
+  sums.scatters.assign(dists.size(),
+      arma::zeros<arma::mat>(dimensionality, dimensionality));
+  sums.logLikelihood = 0.0;
+
+  // The Mahalanobis distance between two points is at most their Euclidean
+  // distance divided by the square root of the smallest eigenvalue of the
+  // covariance; this bounds the density over a node.
+  const arma::vec logWeights = arma::log(weights);
+  arma::vec logPeaks(dists.size());
+  arma::vec invSqrtEigenvalues(dists.size());
+  for (size_t i = 0; i < dists.size(); ++i)
+  {
+    logPeaks[i] = dists[i].LogProbability(dists[i].Mean());
+
+    const arma::vec eigenvalues = arma::eig_sym(dists[i].Covariance());
+    const double minEigenvalue = (eigenvalues.n_elem == 0) ? 0.0 :
+        eigenvalues.min();
+    invSqrtEigenvalues[i] = (minEigenvalue > 0.0) ?
+        1.0 / std::sqrt(minEigenvalue) :
+        std::numeric_limits<double>::infinity();
+  }
+
+  Traverse(tree, dists, logWeights, logPeaks, invSqrtEigenvalues, pointWeights,
+      sums);
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::
+BuildStatistics(TreeType& node, const arma::vec& pointWeights)
+{
+  tree::MRKDStatistic& stat = node.Stat();
+  const arma::mat& dataset = node.Dataset();
+
+  stat.Begin() = node.Begin();
+  stat.Count() = node.Count();
+
+  if (node.IsLeaf())
+  {
+    stat.Weight() = 0.0;
+    stat.SumOfSquaredNorms() = 0.0;
+    arma::vec sum = arma::zeros<arma::vec>(dataset.n_rows);
+    for (size_t i = node.Begin(); i < node.Begin() + node.Count(); ++i)
+    {
+      stat.Weight() += pointWeights[i];
+      stat.SumOfSquaredNorms() += pointWeights[i] *
+          arma::dot(dataset.col(i), dataset.col(i));
+      sum += pointWeights[i] * dataset.col(i);
+    }
+
+    // If all the points have zero weight, the plain mean is still a good center
+    // for the bounds.
+    if (stat.Weight() > 0.0)
+      stat.CenterOfMass() = sum / stat.Weight();
+    else if (node.Count() > 0)
+      stat.CenterOfMass() = arma::mean(dataset.cols(node.Begin(),
+          node.Begin() + node.Count() - 1), 1);
+    else
+      stat.CenterOfMass() = sum;
+
+    stat.Scatter().zeros(dataset.n_rows, dataset.n_rows);
+    stat.Radius() = 0.0;
+    for (size_t i = node.Begin(); i < node.Begin() + node.Count(); ++i)
+    {
+      const arma::vec diff = dataset.col(i) - stat.CenterOfMass();
+      stat.Scatter() += pointWeights[i] * (diff * trans(diff));
+      stat.Radius() = std::max(stat.Radius(), arma::norm(diff, 2));
+    }
+
+    return;
+  }
+
+  BuildStatistics(*node.Left(), pointWeights);
+  BuildStatistics(*node.Right(), pointWeights);
+
+  // Combine the statistics of the children; the scatter matrices are moved to
+  // the new center of mass.
+  const tree::MRKDStatistic& left = node.Left()->Stat();
+  const tree::MRKDStatistic& right = node.Right()->Stat();
+
+  stat.Weight() = left.Weight() + right.Weight();
+  stat.SumOfSquaredNorms() = left.SumOfSquaredNorms() +
+      right.SumOfSquaredNorms();
+  if (stat.Weight() > 0.0)
+    stat.CenterOfMass() = (left.Weight() * left.CenterOfMass() +
+        right.Weight() * right.CenterOfMass()) / stat.Weight();
+  else
+    stat.CenterOfMass() = (left.Count() * left.CenterOfMass() +
+        right.Count() * right.CenterOfMass()) / node.Count();
+
+  const arma::vec leftDiff = left.CenterOfMass() - stat.CenterOfMass();
+  const arma::vec rightDiff = right.CenterOfMass() - stat.CenterOfMass();
+  stat.Scatter() = left.Scatter() + left.Weight() * (leftDiff *
+      trans(leftDiff)) + right.Scatter() + right.Weight() * (rightDiff *
+      trans(rightDiff));
+  stat.Radius() = std::max(left.Radius() + arma::norm(leftDiff, 2),
+      right.Radius() + arma::norm(rightDiff, 2));
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::Traverse(
+    const TreeType& node,
+    const std::vector<distribution::GaussianDistribution>& dists,
+    const arma::vec& logWeights,
+    const arma::vec& logPeaks,
+    const arma::vec& invSqrtEigenvalues,
+    const arma::vec& pointWeights,
+    Sums& sums)
+{
+  const tree::MRKDStatistic& stat = node.Stat();
+
+  // Points without weight contribute nothing.
+  if (stat.Weight() == 0.0)
+    return;
+
+  // For each Gaussian, bound the weighted log-density over the ball around the
+  // center of mass that holds all the points of the node.
+  arma::vec logCenter(dists.size());
+  arma::vec logMin(dists.size());
+  arma::vec logMax(dists.size());
+  for (size_t i = 0; i < dists.size(); ++i)
+  {
+    const double logDensity = dists[i].LogProbability(stat.CenterOfMass());
+    const double distance = std::sqrt(std::max(0.0,
+        2.0 * (logPeaks[i] - logDensity)));
+    const double spread = stat.Radius() * invSqrtEigenvalues[i];
+    const double minDistance = std::max(0.0, distance - spread);
+    const double maxDistance = distance + spread;
+
+    logCenter[i] = logWeights[i] + logDensity;
+    logMax[i] = logWeights[i] + logPeaks[i] - 0.5 * minDistance * minDistance;
+    logMin[i] = logWeights[i] + logPeaks[i] - 0.5 * maxDistance * maxDistance;
+  }
+
+  // The node can be handled as a whole if no responsibility can change by more
+  // than tau over the node.
+  const double maxLogCenter = logCenter.max();
+  const double shift = logMax.max();
+  bool prune = (maxLogCenter != -std::numeric_limits<double>::infinity());
+  if (prune)
+  {
+    const arma::vec pMax = arma::exp(logMax - shift);
+    const arma::vec pMin = arma::exp(logMin - shift);
+    const double sumMax = arma::accu(pMax);
+    const double sumMin = arma::accu(pMin);
+    for (size_t i = 0; i < dists.size(); ++i)
+    {
+      const double rMin = (pMin[i] > 0.0) ? pMin[i] / (pMin[i] +
+          std::max(0.0, sumMax - pMax[i])) : 0.0;
+      const double rMax = (pMax[i] > 0.0) ? pMax[i] / (pMax[i] +
+          std::max(0.0, sumMin - pMin[i])) : 0.0;
+      if (rMax - rMin > tau)
+      {
+        prune = false;
+        break;
+      }
+    }
+  }
+
+  if (prune)
+  {
+    ++prunes;
+
+    // Give every point the responsibilities of the center of mass.  The sums
+    // over the points then follow from the statistics of the node.
+    const double logSum = maxLogCenter + std::log(arma::accu(
+        arma::exp(logCenter - maxLogCenter)));
+    const arma::vec responsibilities = arma::exp(logCenter - logSum);
+    for (size_t i = 0; i < dists.size(); ++i)
+    {
+      if (responsibilities[i] == 0.0)
+        continue;
+
+      const arma::vec diff = stat.CenterOfMass() - dists[i].Mean();
+      sums.responsibilities[i] += responsibilities[i] * stat.Weight();
+      sums.offsets.col(i) += (responsibilities[i] * stat.Weight()) * diff;
+      sums.scatters[i] += responsibilities[i] * (stat.Scatter() +
+          stat.Weight() * (diff * trans(diff)));
+    }
+
+    sums.logLikelihood += stat.Weight() * logSum;
+    return;
+  }
+
+  if (!node.IsLeaf())
+  {
+    Traverse(*node.Left(), dists, logWeights, logPeaks, invSqrtEigenvalues,
+        pointWeights, sums);
+    Traverse(*node.Right(), dists, logWeights, logPeaks, invSqrtEigenvalues,
+        pointWeights, sums);
+    return;
+  }
+
+  // Handle each point of the leaf exactly.
+  const arma::mat& dataset = node.Dataset();
+  const arma::mat points(const_cast<double*>(dataset.colptr(node.Begin())),
+      dataset.n_rows, node.Count(), false, true);
+
+  arma::mat logProbabilities(node.Count(), dists.size());
+  arma::vec logProbability;
+  for (size_t i = 0; i < dists.size(); ++i)
+  {
+    dists[i].LogProbability(points, logProbability);
+    logProbabilities.col(i) = logProbability + logWeights[i];
+  }
+
+  for (size_t j = 0; j < node.Count(); ++j)
+  {
+    const double weight = pointWeights[node.Begin() + j];
+    if (weight == 0.0)
+      continue;
+
+    const arma::rowvec row = logProbabilities.row(j);
+    const double maxLog = row.max();
+    if (maxLog == -std::numeric_limits<double>::infinity())
+    {
+      // No Gaussian can have generated this point.
+      sums.logLikelihood += maxLog;
+      continue;
+    }
+
+    const double logSum = maxLog + std::log(arma::accu(arma::exp(row -
+        maxLog)));
+    for (size_t i = 0; i < dists.size(); ++i)
+    {
+      const double responsibility = weight * std::exp(row[i] - logSum);
+      if (responsibility == 0.0)
+        continue;
+
+      const arma::vec diff = points.col(j) - dists[i].Mean();
+      sums.responsibilities[i] += responsibility;
+      sums.offsets.col(i) += responsibility * diff;
+      sums.scatters[i] += responsibility * (diff * trans(diff));
+    }
+
+    sums.logLikelihood += weight * logSum;
+  }
+}
+
+template<typename InitialClusteringType, typename CovarianceConstraintPolicy>
+void MRKDEMFit<InitialClusteringType, CovarianceConstraintPolicy>::
+InitialClustering(const arma::mat& observations,
+                  std::vector<distribution::GaussianDistribution>& dists,
+                  arma::vec& weights)
+{
+  // Assignments from clustering.
+  arma::Col<size_t> assignments;
+
+  // Run clustering algorithm.
+  clusterer.Cluster(observations, dists.size(), assignments);
+
+  // Now calculate the means, covariances, and weights.
+  weights.zeros();
+  for (size_t i = 0; i < dists.size(); ++i)
+  {
+    dists[i].Mean().zeros();
+    dists[i].Covariance().zeros();
+  }
+
+  for (size_t i = 0; i < observations.n_cols; ++i)
+  {
+    dists[assignments[i]].Mean() += observations.col(i);
+    weights[assignments[i]]++;
+  }
+
+  for (size_t i = 0; i < dists.size(); ++i)
+    dists[i].Mean() /= (weights[i] > 1) ? weights[i] : 1;
+
+  for (size_t i = 0; i < observations.n_cols; ++i)
+  {
+    const size_t cluster = assignments[i];
+    const arma::vec normObs = observations.col(i) - dists[cluster].Mean();
+    dists[cluster].Covariance() += normObs * normObs.t();
+  }
+
+  for (size_t i = 0; i < dists.size(); ++i)
+  {
+    dists[i].Covariance() /= (weights[i] > 1) ? weights[i] : 1;
+
+    // Apply constraints to covariance matrix.
+    constraint.ApplyConstraint(dists[i].Covariance());
+  }
+
+  // Finally, normalize weights.
+  weights /= accu(weights);
+}
+
+}; // namespace gmm
+}; // namespace mlpack
+
+#endif
@@ -152,6 +152,13 @@ class HMM
    * log-likelihood of the model between iterations is less than the tolerance,
    * the Baum-Welch algorithm terminates.
    *
+   * The forward-backward passes over the sequences are run in parallel, with
+   * Threads() threads (if mlpack was built with OpenMP); the result does not
+   * depend on the number of threads, up to rounding.  If there are at least
+   * as many states as threads, the emission distributions of the states are
+   * also fit in parallel; distributions whose fit is random (such as GMMs)
+   * then give results that depend on the number of threads.
+   *
    * @note
    * Train() can be called multiple times with different sequences; each time it
    * is called, it uses the current parameters of the HMM as a starting point
@@ -173,6 +180,9 @@ class HMM
    * The number of rows in each matrix should be equal to the dimensionality of
    * the HMM (which is set in the constructor).
    *
+   * If there are at least as many states as Threads(), the emission
+   * distributions of the states are fit in parallel.
+   *
    * @note
    * Train() can be called multiple times with different sequences; each time it
    * is called, it uses the current parameters of the HMM as a starting point
@@ -261,6 +271,18 @@ class HMM
    */
   double LogLikelihood(const arma::mat& dataSeq) const;
 
+  /**
+   * Compute the log-likelihood of each of the given data sequences.  The
+   * sequences are scored in parallel with Threads() threads (if mlpack was
+   * built with OpenMP).
+   *
+   * @param dataSeq Vector of data sequences to evaluate the likelihood of.
+   * @param logLikelihoods Vector to store the log-likelihood of each sequence
+   *     in.
+   */
+  void LogLikelihood(const std::vector<arma::mat>& dataSeq,
+                     arma::vec& logLikelihoods) const;
+
   /**
    * HMM filtering. Computes the k-step-ahead expected emission at each time
    * conditioned only on prior observations. That is
@@ -316,6 +338,13 @@ class HMM
   //! Modify the tolerance of the Baum-Welch algorithm.
   double& Tolerance() { return tolerance; }
 
+  //! Get the number of threads used by Train() and LogLikelihood() (0 means
+  //! all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used by Train() and LogLikelihood() (0
+  //! means all available cores).
+  size_t& Threads() { return threads; }
+
   /**
    * Returns a string representation of this object.
    */
@@ -347,6 +376,24 @@ class HMM
                arma::vec& scales,
                arma::mat& forwardProb) const;
 
+  /**
+   * The Forward algorithm, using emission log-probabilities that were already
+   * computed with LogEmissionProbabilities().  Each step is one matrix-vector
+   * product with the transition matrix.  The emission log-probabilities of each
+   * time step are shifted by their maximum before they are exponentiated, and
+   * the scaling factors are returned as logs, so nothing underflows even when
+   * every emission probability is tiny.
+   *
+   * @param logEmissionProb Log-probability of each observation under each
+   *     state.
+   * @param logScales Vector in which the logs of the scaling factors will be
+   *     saved.
+   * @param forwardProb Matrix in which forward probabilities will be saved.
+   */
+  void ScaledForward(const arma::mat& logEmissionProb,
+                     arma::vec& logScales,
+                     arma::mat& forwardProb) const;
+
   /**
    * The Backward algorithm (part of the Forward-Backward algorithm).  Computes
    * backward probabilities for each state for each observation in the given
@@ -362,6 +409,95 @@ class HMM
                 const arma::vec& scales,
                 arma::mat& backwardProb) const;
 
+  /**
+   * The Backward algorithm, using emission log-probabilities that were already
+   * computed with LogEmissionProbabilities() and the log scaling factors found
+   * by ScaledForward().
+   *
+   * @param logEmissionProb Log-probability of each observation under each
+   *     state.
+   * @param logScales Logs of the scaling factors.
+   * @param backwardProb Matrix in which backward probabilities will be saved.
+   */
+  void ScaledBackward(const arma::mat& logEmissionProb,
+                      const arma::vec& logScales,
+                      arma::mat& backwardProb) const;
+
+  /**
+   * The Forward algorithm with the given transition matrix, which is either
+   * the transition matrix itself or a sparse copy of it (arma::sp_mat).  With
+   * a sparse copy each step costs O(nonzeros) instead of O(states^2).
+   *
+   * @param transitionMatrix Transition matrix to use.
+   * @param logEmissionProb Log-probability of each observation under each
+   *     state.
+   * @param logScales Vector in which the logs of the scaling factors will be
+   *     saved.
+   * @param forwardProb Matrix in which forward probabilities will be saved.
+   */
+  template<typename MatType>
+  void ScaledForward(const MatType& transitionMatrix,
+                     const arma::mat& logEmissionProb,
+                     arma::vec& logScales,
+                     arma::mat& forwardProb) const;
+
+  /**
+   * The Backward algorithm with the given transpose of the transition matrix,
+   * which is either dense or a sparse copy (arma::sp_mat).
+   *
+   * @param transposedTransition Transpose of the transition matrix.
+   * @param logEmissionProb Log-probability of each observation under each
+   *     state.
+   * @param logScales Logs of the scaling factors.
+   * @param backwardProb Matrix in which backward probabilities will be saved.
+   */
+  template<typename MatType>
+  void ScaledBackward(const MatType& transposedTransition,
+                      const arma::mat& logEmissionProb,
+                      const arma::vec& logScales,
+                      arma::mat& backwardProb) const;
+
+  /**
+   * Return whether the transition matrix has few enough nonzero elements (at
+   * most a quarter of them, with at least 16 states) that the forward-backward
+   * and Viterbi steps should use a sparse copy of it.  Left-to-right and banded
+   * topologies are like this.
+   */
+  bool UseSparseTransition() const;
+
+  /**
+   * Compute the log-probability of each observation of the given sequence
+   * under the emission distribution of each state.  The returned matrix has
+   * rows equal to the number of hidden states and columns equal to the number
+   * of observations.  Distributions that can evaluate a whole matrix of
+   * observations at once (such as GaussianDistribution and GMM) are only
+   * called once per state, and those that can compute log-probabilities
+   * directly are asked for them.  For DiscreteDistribution, the column of
+   * log-probabilities of each symbol is computed the first time the symbol
+   * appears in the sequence, and copied to each later time step with that
+   * symbol.
+   *
+   * @param dataSeq Data sequence to compute probabilities for.
+   * @param logEmissionProb Matrix in which emission log-probabilities will be
+   *     saved.
+   */
+  void LogEmissionProbabilities(const arma::mat& dataSeq,
+                                arma::mat& logEmissionProb) const;
+
+  /**
+   * Turn one column of emission log-probabilities into probabilities shifted
+   * by their maximum, so that the largest is 1.
+   *
+   * @param logEmissionProb Log-probability of each observation under each
+   *     state.
+   * @param t Time step to convert.
+   * @param shiftedProb Vector in which the shifted probabilities will be saved.
+   * @return The shift (the maximum log-probability).
+   */
+  double ShiftedEmission(const arma::mat& logEmissionProb,
+                         const size_t t,
+                         arma::vec& shiftedProb) const;
+
   //! Set of emission probability distributions; one for each state.
   std::vector<Distribution> emission;
 
@@ -377,6 +513,10 @@ class HMM
 
   //! Tolerance of Baum-Welch algorithm.
   double tolerance;
+
+  //! Number of threads used by Train() and LogLikelihood(); 0 means all
+  //! available cores.
+  size_t threads;
 };
 
 }; // namespace hmm
@@ -12,9 +12,69 @@
 // Just in case...
 #include "hmm.hpp"
 
+#include <mlpack/core/util/sfinae_utility.hpp>
+
 namespace mlpack {
 namespace hmm {
 
+//! Detect whether a distribution can evaluate a whole matrix of observations.
+HAS_MEM_FUNC(Probability, HasBatchProbability);
+
+//! Compute the probabilities of all observations with one call, for
+//! distributions that support it.
+template<typename Distribution>
+inline typename boost::enable_if_c<HasBatchProbability<Distribution,
+    void (Distribution::*)(const arma::mat&, arma::vec&) const>::value>::type
+BatchProbability(const Distribution& distribution,
+                 const arma::mat& dataSeq,
+                 arma::vec& probabilities)
+{
+  distribution.Probability(dataSeq, probabilities);
+}
+
+//! Compute the probabilities of all observations one at a time, for
+//! distributions that can only evaluate a single observation.
+template<typename Distribution>
+inline typename boost::disable_if_c<HasBatchProbability<Distribution,
+    void (Distribution::*)(const arma::mat&, arma::vec&) const>::value>::type
+BatchProbability(const Distribution& distribution,
+                 const arma::mat& dataSeq,
+                 arma::vec& probabilities)
+{
+  probabilities.set_size(dataSeq.n_cols);
+  for (size_t t = 0; t < dataSeq.n_cols; ++t)
+    probabilities[t] = distribution.Probability(dataSeq.unsafe_col(t));
+}
+
+//! Detect whether a distribution can compute the log-probabilities of a whole
+//! matrix of observations.
+HAS_MEM_FUNC(LogProbability, HasBatchLogProbability);
+
+//! Compute the log-probabilities of all observations with one call, for
+//! distributions that support it.
+template<typename Distribution>
+inline typename boost::enable_if_c<HasBatchLogProbability<Distribution,
+    void (Distribution::*)(const arma::mat&, arma::vec&) const>::value>::type
+BatchLogProbability(const Distribution& distribution,
+                    const arma::mat& dataSeq,
+                    arma::vec& logProbabilities)
+{
+  distribution.LogProbability(dataSeq, logProbabilities);
+}
+
+//! Compute the log-probabilities of all observations from their probabilities,
+//! for distributions that cannot compute log-probabilities directly.
+template<typename Distribution>
+inline typename boost::disable_if_c<HasBatchLogProbability<Distribution,
+    void (Distribution::*)(const arma::mat&, arma::vec&) const>::value>::type
+BatchLogProbability(const Distribution& distribution,
+                    const arma::mat& dataSeq,
+                    arma::vec& logProbabilities)
+{
+  BatchProbability(distribution, dataSeq, logProbabilities);
+  logProbabilities = arma::log(logProbabilities);
+}
+
 /**
  * Create the Hidden Markov Model with the given number of hidden states and the
  * given number of emission states.
@@ -27,7 +87,8 @@ HMM<Distribution>::HMM(const size_t states,
     transition(arma::ones<arma::mat>(states, states) / (double) states),
     initial(arma::ones<arma::vec>(states) / (double) states),
     dimensionality(emissions.Dimensionality()),
-    tolerance(tolerance)
+    tolerance(tolerance),
+    threads(0)
 { /* nothing to do */ }
 
 /**
@@ -42,7 +103,8 @@ HMM<Distribution>::HMM(const arma::vec& initial,
     emission(emission),
     transition(transition),
     initial(initial),
-    tolerance(tolerance)
+    tolerance(tolerance),
+    threads(0)
 {
   // Set the dimensionality, if we can.
   if (emission.size() > 0)
@@ -81,83 +143,194 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
   // Maximum iterations?
   size_t iterations = 1000;
 
-  // Find length of all sequences and ensure they are the correct size.
-  size_t totalLength = 0;
+  // Find length of all sequences and ensure they are the correct size.  The
+  // observations of each sequence start at column offsets[seq] of the emission
+  // list.
+  std::vector<size_t> offsets(dataSeq.size() + 1, 0);
   for (size_t seq = 0; seq < dataSeq.size(); seq++)
   {
-    totalLength += dataSeq[seq].n_cols;
+    offsets[seq + 1] = offsets[seq] + dataSeq[seq].n_cols;
 
     if (dataSeq[seq].n_rows != dimensionality)
       Log::Fatal << "HMM::Train(): data sequence " << seq << " has "
           << "dimensionality " << dataSeq[seq].n_rows << " (expected "
           << dimensionality << " dimensions)." << std::endl;
   }
+  const size_t totalLength = offsets[dataSeq.size()];
 
   // These are used later for training of each distribution.  We initialize it
-  // all now so we don't have to do any allocation later on.
+  // all now so we don't have to do any allocation later on.  The observations
+  // don't change, so they are only copied once.
   std::vector<arma::vec> emissionProb(transition.n_cols,
       arma::vec(totalLength));
   arma::mat emissionList(dimensionality, totalLength);
+  for (size_t seq = 0; seq < dataSeq.size(); seq++)
+    if (dataSeq[seq].n_cols > 0)
+      emissionList.cols(offsets[seq], offsets[seq + 1] - 1) = dataSeq[seq];
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // The sequences are split into contiguous blocks, with about the same number
+  // of observations in each block; there are as many blocks as
+  // util::ReductionBlocks() gives for the observations (but no more than there
+  // are sequences).  Each block sums into its own copies, which are added with
+  // util::TreeReduce(), so the result does not depend on the number of
+  // threads.
+  const size_t blocks = std::max(std::min(util::ReductionBlocks(totalLength),
+      dataSeq.size()), (size_t) 1);
+  std::vector<size_t> blockStart(blocks + 1, dataSeq.size());
+  blockStart[0] = 0;
+  for (size_t b = 1, seq = 0; b < blocks; ++b)
+  {
+    while (seq < dataSeq.size() && offsets[seq] < b * totalLength / blocks)
+      ++seq;
+    blockStart[b] = std::max(seq, blockStart[b - 1]);
+  }
 
   // This should be the Baum-Welch algorithm (EM for HMM estimation). This
   // follows the procedure outlined in Elliot, Aggoun, and Moore's book "Hidden
   // Markov Models: Estimation and Control", pp. 36-40.
   for (size_t iter = 0; iter < iterations; iter++)
   {
-    // Clear new transition matrix and emission probabilities.
-    arma::vec newInitial(transition.n_rows);
-    newInitial.zeros();
-    arma::mat newTransition(transition.n_rows, transition.n_cols);
-    newTransition.zeros();
-
-    // Reset log likelihood.
-    loglik = 0;
-
-    // Sum over time.
-    size_t sumTime = 0;
+    // The new initial probabilities and transition matrix of each block.
+    std::vector<arma::vec> blockInitial(blocks);
+    std::vector<arma::mat> blockTransition(blocks);
+    std::vector<double> blockLoglik(blocks, 0.0);
+
+    // Each step of the recursions is a product with the transition matrix or
+    // its transpose; if few transitions are possible, sparse copies are used.
+    const bool sparse = UseSparseTransition();
+    const arma::mat transposed = trans(transition);
+    const arma::sp_mat sparseTransition = sparse ? arma::sp_mat(transition) :
+        arma::sp_mat();
+    const arma::sp_mat sparseTransposed = sparse ? arma::sp_mat(transposed) :
+        arma::sp_mat();
+
+    // With sparse transitions only the nonzero elements of the new transition
+    // matrix are accumulated, in the order of sparseTransition's elements.
+    std::vector<arma::vec> blockNonzeros(blocks);
+
+    // The emission distributions may cache work (such as factorizations)
+    // during their first evaluation after they change; do that here, before
+    // the threads share them.
+    if (totalLength > 0)
+    {
+      arma::mat logEmissionFirst;
+      LogEmissionProbabilities(emissionList.cols(0, 0), logEmissionFirst);
+    }
 
     // Loop over each sequence.
-    for (size_t seq = 0; seq < dataSeq.size(); seq++)
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+    for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
     {
-      arma::mat stateProb;
-      arma::mat forward;
-      arma::mat backward;
-      arma::vec scales;
-
-      // Add the log-likelihood of this sequence.  This is the E-step.
-      loglik += Estimate(dataSeq[seq], stateProb, forward, backward, scales);
-
-      // Now re-estimate the parameters.  This is the M-step.
-      //   pi_i = sum_d ((1 / P(seq[d])) sum_t (f(i, 0) b(i, 0))
-      //   T_ij = sum_d ((1 / P(seq[d])) sum_t (f(i, t) T_ij E_i(seq[d][t]) b(i,
-      //           t + 1)))
-      //   E_ij = sum_d ((1 / P(seq[d])) sum_{t | seq[d][t] = j} f(i, t) b(i, t)
-      // We store the new estimates in a different matrix.
-      for (size_t t = 0; t < dataSeq[seq].n_cols; t++)
+      arma::vec& initialSum = blockInitial[b];
+      arma::mat& transitionSum = blockTransition[b];
+      initialSum.zeros(transition.n_rows);
+      transitionSum.zeros(transition.n_rows, transition.n_cols);
+      arma::vec& nonzeroSum = blockNonzeros[b];
+      nonzeroSum.zeros(sparseTransition.n_nonzero);
+
+      for (size_t seq = blockStart[b]; seq < blockStart[b + 1]; seq++)
       {
-        for (size_t j = 0; j < transition.n_cols; j++)
+        const size_t length = dataSeq[seq].n_cols;
+        if (length == 0)
+          continue;
+
+        arma::mat stateProb;
+        arma::mat forward;
+        arma::mat backward;
+        arma::vec logScales;
+
+        // Evaluate every emission distribution on the whole sequence once;
+        // this is used by both the E-step and the M-step.
+        arma::mat logEmissionSeqProb;
+        LogEmissionProbabilities(dataSeq[seq], logEmissionSeqProb);
+
+        // Add the log-likelihood of this sequence.  This is the E-step.
+        if (sparse)
         {
-          // Add to estimate of initial probability for state j.
-          newInitial[j] = stateProb(j, 0);
-
-          if (t < dataSeq[seq].n_cols - 1)
+          ScaledForward(sparseTransition, logEmissionSeqProb, logScales,
+              forward);
+          ScaledBackward(sparseTransposed, logEmissionSeqProb, logScales,
+              backward);
+        }
+        else
+        {
+          ScaledForward(transition, logEmissionSeqProb, logScales, forward);
+          ScaledBackward(transposed, logEmissionSeqProb, logScales, backward);
+        }
+        stateProb = forward % backward;
+        blockLoglik[b] += accu(logScales);
+
+        // Now re-estimate the parameters.  This is the M-step.
+        //   pi_i = sum_d ((1 / P(seq[d])) sum_t (f(i, 0) b(i, 0))
+        //   T_ij = sum_d ((1 / P(seq[d])) sum_t (f(i, t) T_ij E_i(seq[d][t])
+        //           b(i, t + 1)))
+        //   E_ij = sum_d ((1 / P(seq[d])) sum_{t | seq[d][t] = j} f(i, t)
+        //           b(i, t)
+        // We store the new estimates in a different matrix.
+        initialSum += stateProb.col(0);
+
+        // Estimate of T_ij (probability of transition from state j to state
+        // i), as one outer product per time step.  We postpone multiplication
+        // of the old T_ij until later.  The emission probabilities and the
+        // scale are both shifted by the same amount, so the shift cancels.
+        arma::vec shiftedProb;
+        for (size_t t = 0; t + 1 < length; t++)
+        {
+          const double shift = ShiftedEmission(logEmissionSeqProb, t + 1,
+              shiftedProb);
+          const double scale = std::exp(logScales[t + 1] - shift);
+          const arma::vec weighted = (backward.col(t + 1) % shiftedProb) /
+              scale;
+          if (sparse)
           {
-            // Estimate of T_ij (probability of transition from state j to state
-            // i).  We postpone multiplication of the old T_ij until later.
-            for (size_t i = 0; i < transition.n_rows; i++)
-              newTransition(i, j) += forward(j, t) * backward(i, t + 1) *
-                  emission[i].Probability(dataSeq[seq].unsafe_col(t + 1)) /
-                  scales[t + 1];
+            // Only the possible transitions (from j to i) can change.
+            for (size_t j = 0; j < sparseTransition.n_cols; ++j)
+              for (size_t k = sparseTransition.col_ptrs[j];
+                  k < sparseTransition.col_ptrs[j + 1]; ++k)
+                nonzeroSum[k] += weighted[sparseTransition.row_indices[k]] *
+                    forward(j, t);
+          }
+          else
+          {
+            transitionSum += weighted * trans(forward.col(t));
           }
-
-          // Add to list of emission observations, for Distribution::Estimate().
-          emissionList.col(sumTime) = dataSeq[seq].col(t);
-          emissionProb[j][sumTime] = stateProb(j, t);
         }
-        sumTime++;
+
+        // Add to the weights of the emission observations, for
+        // Distribution::Estimate().  Each sequence has its own columns.
+        for (size_t j = 0; j < transition.n_cols; j++)
+          emissionProb[j].subvec(offsets[seq], offsets[seq + 1] - 1) =
+              trans(stateProb.row(j));
       }
     }
 
+    // Merge the sums of the blocks.
+    util::TreeReduce(blockInitial);
+    util::TreeReduce(blockTransition);
+    util::TreeReduce(blockLoglik);
+    util::TreeReduce(blockNonzeros);
+    arma::vec newInitial;
+    arma::mat newTransition;
+    newInitial.swap(blockInitial[0]);
+    newTransition.swap(blockTransition[0]);
+    loglik = blockLoglik[0];
+
+    if (sparse)
+    {
+      for (size_t j = 0; j < sparseTransition.n_cols; ++j)
+        for (size_t k = sparseTransition.col_ptrs[j];
+            k < sparseTransition.col_ptrs[j + 1]; ++k)
+          newTransition(sparseTransition.row_indices[k], j) +=
+              blockNonzeros[0][k];
+    }
+
     // Normalize the new initial probabilities.
     if (dataSeq.size() == 0)
       initial = newInitial / dataSeq.size();
@@ -172,8 +345,18 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq)
     for (size_t i = 0; i < transition.n_cols; i++)
       transition.col(i) /= accu(transition.col(i));
 
-    // Now estimate emission probabilities.
-    for (size_t state = 0; state < transition.n_cols; state++)
+    // Now estimate emission probabilities.  Each state's distribution is fit
+    // independently, so the states are split between the threads.  Fitting a
+    // distribution may draw random numbers (GMM does); inside the parallel
+    // loop these come from the random object of each thread (see
+    // math::RandGen()), and the static schedule keeps the result the same for
+    // a given number of threads.  With fewer states than threads, the states
+    // are fit one at a time, so that a distribution that can use threads
+    // itself (such as a GMM fit with EMFit) gets all of them.
+    const size_t emissionThreads = (transition.n_cols >= numThreads) ?
+        numThreads : 1;
+    #pragma omp parallel for num_threads(emissionThreads) schedule(static, 1)
+    for (omp_size_t state = 0; state < (omp_size_t) transition.n_cols; state++)
       emission[state].Estimate(emissionList, emissionProb[state]);
 
     Log::Debug << "Iteration " << iter << ": log-likelihood " << loglik
@@ -259,8 +442,18 @@ void HMM<Distribution>::Train(const std::vector<arma::mat>& dataSeq,
       transition.col(col) /= sum;
   }
 
-  // Estimate emission matrix.
-  for (size_t state = 0; state < transition.n_cols; state++)
+  // Estimate emission matrix.  The states are independent, so they are split
+  // between the threads, as in the other overload of Train().
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+  const size_t emissionThreads = (transition.n_cols >= numThreads) ?
+      numThreads : 1;
+
+  #pragma omp parallel for num_threads(emissionThreads) schedule(static, 1)
+  for (omp_size_t state = 0; state < (omp_size_t) transition.n_cols; state++)
   {
     // Generate full sequence of observations for this state from the list of
     // emissions that are from this state.
@@ -287,15 +480,20 @@ double HMM<Distribution>::Estimate(const arma::mat& dataSeq,
                                    arma::vec& scales) const
 {
   // First run the forward-backward algorithm.
-  Forward(dataSeq, scales, forwardProb);
-  Backward(dataSeq, scales, backwardProb);
+  arma::mat logEmissionProb;
+  arma::vec logScales;
+  LogEmissionProbabilities(dataSeq, logEmissionProb);
+  ScaledForward(logEmissionProb, logScales, forwardProb);
+  ScaledBackward(logEmissionProb, logScales, backwardProb);
 
   // Now assemble the state probability matrix based on the forward and backward
   // probabilities.
   stateProb = forwardProb % backwardProb;
 
-  // Finally assemble the log-likelihood and return it.
-  return accu(log(scales));
+  // Finally assemble the log-likelihood and return it.  The scales themselves
+  // may underflow for very unlikely observations; their logs do not.
+  scales = arma::exp(logScales);
+  return accu(logScales);
 }
 
 /**
@@ -383,17 +581,30 @@ double HMM<Distribution>::Predict(const arma::mat& dataSeq,
   // will be using the rows of the transition matrix.
   arma::mat logTrans(log(trans(transition)));
 
+  // Evaluate every emission distribution on the whole sequence at once.
+  arma::mat logEmissionProb;
+  LogEmissionProbabilities(dataSeq, logEmissionProb);
+
   // The calculation of the first state is slightly different; the probability
   // of the first state being state j is the maximum probability that the state
   // came to be j from another state.
   logStateProb.col(0).zeros();
   for (size_t state = 0; state < transition.n_rows; state++)
   {
-    logStateProb(state, 0) = log(initial[state] *
-        emission[state].Probability(dataSeq.unsafe_col(0)));
+    logStateProb(state, 0) = log(initial[state]) + logEmissionProb(state, 0);
     stateSeqBack(state, 0) = state;
   }
 
+  // If few transitions are possible, only look at the possible previous
+  // states of each state: column j of the sparse transposed transition matrix
+  // holds the states that can transition to state j.
+  const bool sparse = UseSparseTransition();
+  const arma::sp_mat predecessors = sparse ? arma::sp_mat(arma::mat(
+      trans(transition))) : arma::sp_mat();
+  arma::vec logPredecessors(predecessors.n_nonzero);
+  for (size_t k = 0; k < predecessors.n_nonzero; ++k)
+    logPredecessors[k] = std::log(predecessors.values[k]);
+
   // Store the best first state.
   arma::uword index;
   for (size_t t = 1; t < dataSeq.n_cols; t++)
@@ -403,10 +614,30 @@ double HMM<Distribution>::Predict(const arma::mat& dataSeq,
     // of being the previous state.
     for (size_t j = 0; j < transition.n_rows; j++)
     {
-      arma::vec prob = logStateProb.col(t - 1) + logTrans.col(j);
-      logStateProb(j, t) = prob.max(index) +
-          log(emission[j].Probability(dataSeq.unsafe_col(t)));
+      if (sparse)
+      {
+        double best = -std::numeric_limits<double>::infinity();
+        index = 0;
+        for (size_t k = predecessors.col_ptrs[j];
+            k < predecessors.col_ptrs[j + 1]; ++k)
+        {
+          const double prob = logStateProb(predecessors.row_indices[k], t - 1)
+              + logPredecessors[k];
+          if (prob > best)
+          {
+            best = prob;
+            index = predecessors.row_indices[k];
+          }
+        }
+        logStateProb(j, t) = best + logEmissionProb(j, t);
         stateSeqBack(j, t) = index;
+      }
+      else
+      {
+        arma::vec prob = logStateProb.col(t - 1) + logTrans.col(j);
+        logStateProb(j, t) = prob.max(index) + logEmissionProb(j, t);
+        stateSeqBack(j, t) = index;
+      }
     }
   }
 
@@ -426,13 +657,49 @@ double HMM<Distribution>::Predict(const arma::mat& dataSeq,
 template<typename Distribution>
 double HMM<Distribution>::LogLikelihood(const arma::mat& dataSeq) const
 {
+  arma::mat logEmissionProb;
   arma::mat forward;
-  arma::vec scales;
+  arma::vec logScales;
+
+  LogEmissionProbabilities(dataSeq, logEmissionProb);
+  ScaledForward(logEmissionProb, logScales, forward);
 
-  Forward(dataSeq, scales, forward);
+  // The log-likelihood is the sum of the log scales for each time step.
+  return accu(logScales);
+}
+
+/**
+ * Compute the log-likelihood of each of several sequences.
+ */
+template<typename Distribution>
+void HMM<Distribution>::LogLikelihood(const std::vector<arma::mat>& dataSeq,
+                                      arma::vec& logLikelihoods) const
+{
+  logLikelihoods.set_size(dataSeq.size());
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Let the emission distributions cache their work before the threads share
+  // them (see Train()).
+  for (size_t seq = 0; seq < dataSeq.size(); ++seq)
+  {
+    if (dataSeq[seq].n_cols > 0)
+    {
+      arma::mat logEmissionFirst;
+      LogEmissionProbabilities(dataSeq[seq].cols(0, 0), logEmissionFirst);
+      break;
+    }
+  }
 
-  // The log-likelihood is the log of the scales for each time step.
-  return accu(log(scales));
+  // Each sequence is independent, so they can be handed out dynamically;
+  // their lengths may differ a lot.
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t seq = 0; seq < (omp_size_t) dataSeq.size(); ++seq)
+    logLikelihoods[seq] = LogLikelihood(dataSeq[seq]);
 }
 
 /**
@@ -477,6 +744,92 @@ void HMM<Distribution>::Smooth(const arma::mat& dataSeq,
     smoothSeq += emission[i].Mean() * stateProb.row(i);
 }
 
+/**
+ * Evaluate the log of each emission distribution on each observation of a
+ * sequence.
+ */
+template<typename Distribution>
+void HMM<Distribution>::LogEmissionProbabilities(
+    const arma::mat& dataSeq,
+    arma::mat& logEmissionProb) const
+{
+  logEmissionProb.set_size(transition.n_rows, dataSeq.n_cols);
+
+  arma::vec logProbabilities;
+  for (size_t state = 0; state < transition.n_rows; state++)
+  {
+    BatchLogProbability(emission[state], dataSeq, logProbabilities);
+    logEmissionProb.row(state) = trans(logProbabilities);
+  }
+}
+
+/**
+ * Evaluate the log of each discrete emission distribution on each observation
+ * of a sequence.  Each observation is a symbol, so the log-probabilities of all
+ * states for a symbol are computed once and gathered for every time step with
+ * that symbol.
+ */
+template<>
+inline void HMM<distribution::DiscreteDistribution>::LogEmissionProbabilities(
+    const arma::mat& dataSeq,
+    arma::mat& logEmissionProb) const
+{
+  const size_t states = transition.n_rows;
+  logEmissionProb.set_size(states, dataSeq.n_cols);
+
+  size_t symbols = 0;
+  for (size_t state = 0; state < states; ++state)
+    symbols = std::max(symbols,
+        (size_t) emission[state].Probabilities().n_elem);
+
+  // The time step at which each symbol was first seen; its column of
+  // logEmissionProb is then the column of log-probabilities of the symbol.
+  std::vector<size_t> firstSeen(symbols, dataSeq.n_cols);
+  for (size_t t = 0; t < dataSeq.n_cols; ++t)
+  {
+    // This is the same conversion as DiscreteDistribution::Probability().
+    const size_t obs = size_t(dataSeq(0, t) + 0.5);
+
+    if (obs < symbols && firstSeen[obs] < t)
+    {
+      logEmissionProb.col(t) = logEmissionProb.col(firstSeen[obs]);
+      continue;
+    }
+
+    for (size_t state = 0; state < states; ++state)
+    {
+      const arma::vec& probabilities = emission[state].Probabilities();
+      // Observations a distribution doesn't know about are left to it.
+      logEmissionProb(state, t) = std::log((obs < probabilities.n_elem) ?
+          probabilities[obs] :
+          emission[state].Probability(dataSeq.unsafe_col(t)));
+    }
+
+    if (obs < symbols)
+      firstSeen[obs] = t;
+  }
+}
+
+/**
+ * Exponentiate one column of emission log-probabilities, shifted by their
+ * maximum.
+ */
+template<typename Distribution>
+double HMM<Distribution>::ShiftedEmission(const arma::mat& logEmissionProb,
+                                          const size_t t,
+                                          arma::vec& shiftedProb) const
+{
+  double shift = logEmissionProb.col(t).max();
+
+  // If no state can emit this observation, the scale will be zero, just as it
+  // would be without the shift.
+  if (shift == -std::numeric_limits<double>::infinity())
+    shift = 0.0;
+
+  shiftedProb = arma::exp(logEmissionProb.col(t) - shift);
+  return shift;
+}
+
 /**
  * The Forward procedure (part of the Forward-Backward algorithm).
  */
@@ -484,41 +837,69 @@ template<typename Distribution>
 void HMM<Distribution>::Forward(const arma::mat& dataSeq,
                                 arma::vec& scales,
                                 arma::mat& forwardProb) const
+{
+  arma::mat logEmissionProb;
+  arma::vec logScales;
+  LogEmissionProbabilities(dataSeq, logEmissionProb);
+  ScaledForward(logEmissionProb, logScales, forwardProb);
+  scales = arma::exp(logScales);
+}
+
+template<typename Distribution>
+void HMM<Distribution>::ScaledForward(const arma::mat& logEmissionProb,
+                                      arma::vec& logScales,
+                                      arma::mat& forwardProb) const
+{
+  if (UseSparseTransition())
+    ScaledForward(arma::sp_mat(transition), logEmissionProb, logScales,
+        forwardProb);
+  else
+    ScaledForward(transition, logEmissionProb, logScales, forwardProb);
+}
+
+template<typename Distribution>
+template<typename MatType>
+void HMM<Distribution>::ScaledForward(const MatType& transitionMatrix,
+                                      const arma::mat& logEmissionProb,
+                                      arma::vec& logScales,
+                                      arma::mat& forwardProb) const
 {
   // Our goal is to calculate the forward probabilities:
   //  P(X_k | o_{1:k}) for all possible states X_k, for each time point k.
-  forwardProb.zeros(transition.n_rows, dataSeq.n_cols);
-  scales.zeros(dataSeq.n_cols);
+  forwardProb.zeros(transition.n_rows, logEmissionProb.n_cols);
+  logScales.zeros(logEmissionProb.n_cols);
+  if (logEmissionProb.n_cols == 0)
+    return;
 
   // The first entry in the forward algorithm uses the initial state
   // probabilities.  Note that MATLAB assumes that the starting state (at
   // t = -1) is state 0; this is not our assumption here.  To force that
   // behavior, you could append a single starting state to every single data
   // sequence and that should produce results in line with MATLAB.
-  for (size_t state = 0; state < transition.n_rows; state++)
-    forwardProb(state, 0) = initial(state) *
-        emission[state].Probability(dataSeq.unsafe_col(0));
+  arma::vec shiftedProb;
+  double shift = ShiftedEmission(logEmissionProb, 0, shiftedProb);
+  forwardProb.col(0) = initial % shiftedProb;
 
   // Then normalize the column.
-  scales[0] = accu(forwardProb.col(0));
-  forwardProb.col(0) /= scales[0];
-
-  // Now compute the probabilities for each successive observation.
-  for (size_t t = 1; t < dataSeq.n_cols; t++)
+  double scale = accu(forwardProb.col(0));
+  forwardProb.col(0) /= scale;
+  logScales[0] = std::log(scale) + shift;
+
+  // Now compute the probabilities for each successive observation.  The
+  // forward probability of state j at time t is the sum over all states of the
+  // probability of the previous state transitioning to the current state and
+  // emitting the given observation; for all states at once, that is one
+  // matrix-vector product.
+  for (size_t t = 1; t < logEmissionProb.n_cols; t++)
   {
-    for (size_t j = 0; j < transition.n_rows; j++)
-    {
-      // The forward probability of state j at time t is the sum over all states
-      // of the probability of the previous state transitioning to the current
-      // state and emitting the given observation.
-      forwardProb(j, t) = accu(forwardProb.col(t - 1) %
-          trans(transition.row(j))) *
-          emission[j].Probability(dataSeq.unsafe_col(t));
-    }
+    shift = ShiftedEmission(logEmissionProb, t, shiftedProb);
+    forwardProb.col(t) = transitionMatrix * forwardProb.unsafe_col(t - 1);
+    forwardProb.col(t) %= shiftedProb;
 
     // Normalize probability.
-    scales[t] = accu(forwardProb.col(t));
-    forwardProb.col(t) /= scales[t];
+    scale = accu(forwardProb.col(t));
+    forwardProb.col(t) /= scale;
+    logScales[t] = std::log(scale) + shift;
   }
 }
 
@@ -526,33 +907,74 @@ template<typename Distribution>
 void HMM<Distribution>::Backward(const arma::mat& dataSeq,
                                  const arma::vec& scales,
                                  arma::mat& backwardProb) const
+{
+  arma::mat logEmissionProb;
+  LogEmissionProbabilities(dataSeq, logEmissionProb);
+  const arma::vec logScales = arma::log(scales);
+  ScaledBackward(logEmissionProb, logScales, backwardProb);
+}
+
+template<typename Distribution>
+void HMM<Distribution>::ScaledBackward(const arma::mat& logEmissionProb,
+                                       const arma::vec& logScales,
+                                       arma::mat& backwardProb) const
+{
+  const arma::mat transposed = trans(transition);
+  if (UseSparseTransition())
+    ScaledBackward(arma::sp_mat(transposed), logEmissionProb, logScales,
+        backwardProb);
+  else
+    ScaledBackward(transposed, logEmissionProb, logScales, backwardProb);
+}
+
+template<typename Distribution>
+template<typename MatType>
+void HMM<Distribution>::ScaledBackward(const MatType& transposedTransition,
+                                       const arma::mat& logEmissionProb,
+                                       const arma::vec& logScales,
+                                       arma::mat& backwardProb) const
 {
   // Our goal is to calculate the backward probabilities:
   //  P(X_k | o_{k + 1:T}) for all possible states X_k, for each time point k.
-  backwardProb.zeros(transition.n_rows, dataSeq.n_cols);
+  backwardProb.zeros(transition.n_rows, logEmissionProb.n_cols);
+  if (logEmissionProb.n_cols == 0)
+    return;
 
   // The last element probability is 1.
-  backwardProb.col(dataSeq.n_cols - 1).fill(1);
-
-  // Now step backwards through all other observations.
-  for (size_t t = dataSeq.n_cols - 2; t + 1 > 0; t--)
+  backwardProb.col(logEmissionProb.n_cols - 1).fill(1);
+
+  // Now step backwards through all other observations.  The backward
+  // probability of state j at time t is the sum over all states of the
+  // probability of the next state having been a transition from the current
+  // state multiplied by the probability of each of those states emitting the
+  // given observation, normalized by the weights from the forward algorithm.
+  // The emission probabilities and the scale are shifted by the same amount.
+  arma::vec shiftedProb;
+  for (size_t t = logEmissionProb.n_cols - 2; t + 1 > 0; t--)
   {
-    for (size_t j = 0; j < transition.n_rows; j++)
-    {
-      // The backward probability of state j at time t is the sum over all state
-      // of the probability of the next state having been a transition from the
-      // current state multiplied by the probability of each of those states
-      // emitting the given observation.
-      for (size_t state = 0; state < transition.n_rows; state++)
-        backwardProb(j, t) += transition(state, j) * backwardProb(state, t + 1)
-            * emission[state].Probability(dataSeq.unsafe_col(t + 1));
-
-      // Normalize by the weights from the forward algorithm.
-      backwardProb(j, t) /= scales[t + 1];
-    }
+    const double shift = ShiftedEmission(logEmissionProb, t + 1, shiftedProb);
+    const double scale = std::exp(logScales[t + 1] - shift);
+    const arma::vec weighted = (backwardProb.col(t + 1) % shiftedProb) / scale;
+    backwardProb.col(t) = transposedTransition * weighted;
   }
 }
 
+/**
+ * Return whether the forward-backward and Viterbi steps should use a sparse
+ * copy of the transition matrix.
+ */
+template<typename Distribution>
+bool HMM<Distribution>::UseSparseTransition() const
+{
+  // Sparse matrix-vector products only pay off when most transitions are
+  // impossible and there are enough states.
+  if (transition.n_rows < 16)
+    return false;
+
+  const size_t nonzeros = arma::accu(transition != 0.0);
+  return (4 * nonzeros <= transition.n_elem);
+}
+
 template<typename Distribution>
 std::string HMM<Distribution>::ToString() const
 {
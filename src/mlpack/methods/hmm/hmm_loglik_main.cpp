@@ -11,13 +11,28 @@
 
 #include <mlpack/methods/gmm/gmm.hpp>
 
+#include <fstream>
+
 PROGRAM_INFO("Hidden Markov Model (HMM) Sequence Log-Likelihood", "This "
     "utility takes an already-trained HMM (--model_file) and evaluates the "
     "log-likelihood of a given sequence of observations (--input_file).  The "
-    "computed log-likelihood is given directly to stdout.");
+    "computed log-likelihood is given directly to stdout."
+    "\n\n"
+    "If --batch is given, the input file is instead expected to contain a list "
+    "of files, one per line, each holding one sequence of observations.  The "
+    "model is loaded once, the sequences are scored in parallel (with "
+    "--threads threads, if mlpack was built with OpenMP), and one "
+    "log-likelihood is printed per sequence, in the order of the list.  If "
+    "--output_file is given, the log-likelihoods are saved there instead.");
 
 PARAM_STRING_REQ("input_file", "File containing observations,", "i");
 PARAM_STRING_REQ("model_file", "File containing HMM (XML).", "m");
+PARAM_FLAG("batch", "If true, input_file is expected to contain a list of "
+    "files to score, one per line.", "b");
+PARAM_STRING("output_file", "File to save log-likelihoods to (optional; by "
+    "default they are printed).", "o", "");
+PARAM_INT("threads", "Number of threads to use in batch mode (0 uses all "
+    "available cores; ignored if mlpack was built without OpenMP).", "j", 0);
 
 using namespace mlpack;
 using namespace mlpack::hmm;
@@ -35,9 +50,43 @@ int main(int argc, char** argv)
   // Load observations.
   const string inputFile = CLI::GetParam<string>("input_file");
   const string modelFile = CLI::GetParam<string>("model_file");
+  const bool batch = CLI::HasParam("batch");
+  const int threads = CLI::GetParam<int>("threads");
+
+  if (threads < 0)
+    Log::Fatal << "Invalid number of threads (" << threads << "); must be "
+        << "nonnegative." << endl;
 
-  mat dataSeq;
-  data::Load(inputFile, dataSeq, true);
+  vector<mat> dataSeq;
+  if (batch)
+  {
+    // The input file contains a list of files to read.
+    Log::Info << "Reading list of sequences from '" << inputFile << "'."
+        << endl;
+
+    ifstream f(inputFile.c_str());
+    if (!f.is_open())
+      Log::Fatal << "Could not open '" << inputFile << "' for reading." << endl;
+
+    // Every sequence has to be scored, so that the output lines up with the
+    // list; a sequence which cannot be loaded is a fatal error.
+    string line;
+    while (getline(f, line))
+    {
+      if (line.empty())
+        continue;
+
+      dataSeq.push_back(mat());
+      data::Load(line, dataSeq.back(), true);
+    }
+
+    Log::Info << dataSeq.size() << " sequences to score." << endl;
+  }
+  else
+  {
+    dataSeq.push_back(mat());
+    data::Load(inputFile, dataSeq.back(), true);
+  }
 
   // Load model, but first we have to determine its type.
   SaveRestoreUtility sr;
@@ -45,50 +94,58 @@ int main(int argc, char** argv)
   string type;
   sr.LoadParameter(type, "hmm_type");
 
-  double loglik = 0;
+  vec loglik;
   if (type == "discrete")
   {
     HMM<DiscreteDistribution> hmm(1, DiscreteDistribution(1));
 
     LoadHMM(hmm, sr);
+    hmm.Threads() = (size_t) threads;
 
     // Verify only one row in observations.
-    if (dataSeq.n_cols == 1)
-      dataSeq = trans(dataSeq);
+    for (size_t i = 0; i < dataSeq.size(); ++i)
+    {
+      if (dataSeq[i].n_cols == 1)
+        dataSeq[i] = trans(dataSeq[i]);
 
-    if (dataSeq.n_rows > 1)
-      Log::Fatal << "Only one-dimensional discrete observations allowed for "
-          << "discrete HMMs!" << endl;
+      if (dataSeq[i].n_rows > 1)
+        Log::Fatal << "Only one-dimensional discrete observations allowed for "
+            << "discrete HMMs!" << endl;
+    }
 
-    loglik = hmm.LogLikelihood(dataSeq);
+    hmm.LogLikelihood(dataSeq, loglik);
   }
   else if (type == "gaussian")
   {
     HMM<GaussianDistribution> hmm(1, GaussianDistribution(1));
 
     LoadHMM(hmm, sr);
+    hmm.Threads() = (size_t) threads;
 
     // Verify correct dimensionality.
-    if (dataSeq.n_rows != hmm.Emission()[0].Mean().n_elem)
-      Log::Fatal << "Observation dimensionality (" << dataSeq.n_rows << ") "
-          << "does not match HMM Gaussian dimensionality ("
-          << hmm.Emission()[0].Mean().n_elem << ")!" << endl;
+    for (size_t i = 0; i < dataSeq.size(); ++i)
+      if (dataSeq[i].n_rows != hmm.Emission()[0].Mean().n_elem)
+        Log::Fatal << "Observation dimensionality (" << dataSeq[i].n_rows
+            << ") does not match HMM Gaussian dimensionality ("
+            << hmm.Emission()[0].Mean().n_elem << ")!" << endl;
 
-    loglik = hmm.LogLikelihood(dataSeq);
+    hmm.LogLikelihood(dataSeq, loglik);
   }
   else if (type == "gmm")
   {
     HMM<GMM<> > hmm(1, GMM<>(1, 1));
 
     LoadHMM(hmm, sr);
+    hmm.Threads() = (size_t) threads;
 
     // Verify correct dimensionality.
-    if (dataSeq.n_rows != hmm.Emission()[0].Dimensionality())
-      Log::Fatal << "Observation dimensionality (" << dataSeq.n_rows << ") "
-          << "does not match HMM Gaussian dimensionality ("
-          << hmm.Emission()[0].Dimensionality() << ")!" << endl;
+    for (size_t i = 0; i < dataSeq.size(); ++i)
+      if (dataSeq[i].n_rows != hmm.Emission()[0].Dimensionality())
+        Log::Fatal << "Observation dimensionality (" << dataSeq[i].n_rows
+            << ") does not match HMM Gaussian dimensionality ("
+            << hmm.Emission()[0].Dimensionality() << ")!" << endl;
 
-    loglik = hmm.LogLikelihood(dataSeq);
+    hmm.LogLikelihood(dataSeq, loglik);
   }
   else
   {
@@ -96,5 +153,15 @@ int main(int argc, char** argv)
         << "'!" << endl;
   }
 
-  cout << loglik << endl;
+  const string outputFile = CLI::GetParam<string>("output_file");
+  if (outputFile == "")
+  {
+    for (size_t i = 0; i < loglik.n_elem; ++i)
+      cout << loglik[i] << endl;
+  }
+  else
+  {
+    // One line per sequence, like the printed output.
+    data::Save(outputFile, loglik, true, false);
+  }
 }
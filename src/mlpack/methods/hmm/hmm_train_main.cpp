@@ -47,6 +47,9 @@ PARAM_STRING("output_file", "File to save trained HMM to (XML).", "o",
     "output_hmm.xml");
 PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
 PARAM_DOUBLE("tolerance", "Tolerance of the Baum-Welch algorithm.", "T", 1e-5);
+PARAM_INT("threads", "Number of threads to use for the Baum-Welch algorithm "
+    "(0 uses all available cores; ignored if mlpack was built without "
+    "OpenMP).", "j", 0);
 
 using namespace mlpack;
 using namespace mlpack::hmm;
@@ -77,6 +80,12 @@ int main(int argc, char** argv)
   const int states = CLI::GetParam<int>("states");
   const bool batch = CLI::HasParam("batch");
   const double tolerance = CLI::GetParam<double>("tolerance");
+  const int threads = CLI::GetParam<int>("threads");
+  if (threads < 0)
+  {
+    Log::Fatal << "Invalid number of threads (" << threads << "); must be "
+        << "greater than or equal to 0." << endl;
+  }
 
   // Validate number of states.
   if (states == 0 && modelFile == "")
@@ -243,6 +252,7 @@ int main(int argc, char** argv)
     }
 
     // Do we have labels?
+    hmm.Threads() = (size_t) threads;
     if (labelsFile == "")
       hmm.Train(trainSeq); // Unsupervised training.
     else
@@ -286,6 +296,7 @@ int main(int argc, char** argv)
             << dimensionality << ")!" << endl;
 
     // Now run the training.
+    hmm.Threads() = (size_t) threads;
     if (labelsFile == "")
       hmm.Train(trainSeq); // Unsupervised training.
     else
@@ -339,6 +350,7 @@ int main(int argc, char** argv)
             << dimensionality << ")!" << endl;
 
     // Now run the training.
+    hmm.Threads() = (size_t) threads;
     if (labelsFile == "")
     {
       Log::Warn << "Unlabeled training of GMM HMMs is almost certainly not "
@@ -9,19 +9,37 @@
 
 #include "hmm.hpp"
 #include "hmm_util.hpp"
+#include "online_viterbi.hpp"
 
 #include <mlpack/methods/gmm/gmm.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
 PROGRAM_INFO("Hidden Markov Model (HMM) Viterbi State Prediction", "This "
     "utility takes an already-trained HMM (--model_file) and evaluates the "
     "most probably hidden state sequence of a given sequence of observations "
     "(--input_file), using the Viterbi algorithm.  The computed state sequence "
-    "is saved to the specified output file (--output_file).");
+    "is saved to the specified output file (--output_file)."
+    "\n\n"
+    "If --stream is given, observations are instead read one per line (with "
+    "whitespace- or comma-separated values) from the input file, which may be "
+    "'-' for standard input, and decoded with a fixed-lag online Viterbi "
+    "decoder.  Each state is written to the output file (or standard output if "
+    "it is '-') as soon as it is decided, which is after --lag further "
+    "observations have been read.  This uses memory proportional to the lag, "
+    "not to the length of the sequence, so it can be used on streams that do "
+    "not end.");
 
 PARAM_STRING_REQ("input_file", "File containing observations,", "i");
 PARAM_STRING_REQ("model_file", "File containing HMM (XML).", "m");
 PARAM_STRING("output_file", "File to save predicted state sequence to.", "o",
     "output.csv");
+PARAM_FLAG("stream", "If set, decode the input as a stream, one observation "
+    "per line.", "S");
+PARAM_INT("lag", "Number of observations of look-ahead before a state is "
+    "decided in streaming mode.", "l", 100);
 
 using namespace mlpack;
 using namespace mlpack::hmm;
@@ -31,17 +49,105 @@ using namespace mlpack::gmm;
 using namespace arma;
 using namespace std;
 
+/**
+ * Decode the observations in the given stream, one per line, with a fixed-lag
+ * online Viterbi decoder, and write each state to the output stream as soon as
+ * it is decided.
+ */
+template<typename Distribution>
+void StreamViterbi(const HMM<Distribution>& hmm,
+                   const size_t dimensionality,
+                   const size_t lag,
+                   istream& input,
+                   ostream& output)
+{
+  OnlineViterbi<Distribution> decoder(hmm, lag);
+  vector<size_t> states;
+  vec observation(dimensionality);
+
+  string line;
+  size_t lineNumber = 0;
+  while (getline(input, line))
+  {
+    ++lineNumber;
+    replace(line.begin(), line.end(), ',', ' ');
+
+    istringstream lineStream(line);
+    size_t dim = 0;
+    double value;
+    while (lineStream >> value)
+    {
+      if (dim < dimensionality)
+        observation[dim] = value;
+      ++dim;
+    }
+
+    // Skip blank lines.
+    if (dim == 0)
+      continue;
+
+    if (dim != dimensionality)
+      Log::Fatal << "Observation on line " << lineNumber << " has " << dim
+          << " values, but the HMM expects " << dimensionality << "!" << endl;
+
+    decoder.Step(observation, states);
+    for (size_t i = 0; i < states.size(); ++i)
+      output << states[i] << endl;
+    states.clear();
+  }
+
+  decoder.Finish(states);
+  for (size_t i = 0; i < states.size(); ++i)
+    output << states[i] << endl;
+}
+
+/**
+ * Run StreamViterbi() on the input and output files given on the command line,
+ * where '-' stands for standard input or output.
+ */
+template<typename Distribution>
+void StreamViterbi(const HMM<Distribution>& hmm, const size_t dimensionality)
+{
+  const string inputFile = CLI::GetParam<string>("input_file");
+  const string outputFile = CLI::GetParam<string>("output_file");
+  const int lag = CLI::GetParam<int>("lag");
+  if (lag < 0)
+    Log::Fatal << "Invalid lag (" << lag << "); must be nonnegative." << endl;
+
+  ifstream inputStream;
+  if (inputFile != "-")
+  {
+    inputStream.open(inputFile.c_str());
+    if (!inputStream.is_open())
+      Log::Fatal << "Cannot open input file '" << inputFile << "'!" << endl;
+  }
+
+  ofstream outputStream;
+  if (outputFile != "-")
+  {
+    outputStream.open(outputFile.c_str());
+    if (!outputStream.is_open())
+      Log::Fatal << "Cannot open output file '" << outputFile << "'!" << endl;
+  }
+
+  StreamViterbi(hmm, dimensionality, (size_t) lag,
+      (inputFile == "-") ? cin : static_cast<istream&>(inputStream),
+      (outputFile == "-") ? cout : static_cast<ostream&>(outputStream));
+}
+
 int main(int argc, char** argv)
 {
   // Parse command line options.
   CLI::ParseCommandLine(argc, argv);
 
-  // Load observations.
   const string inputFile = CLI::GetParam<string>("input_file");
   const string modelFile = CLI::GetParam<string>("model_file");
+  const bool stream = CLI::HasParam("stream");
 
+  // Load observations, unless they are to be streamed.
   mat dataSeq;
-  data::Load(inputFile, dataSeq, true);
+  if (!stream)
+    data::Load(inputFile, dataSeq, true);
 
   // Load model, but first we have to determine its type.
   SaveRestoreUtility sr;
@@ -56,6 +162,12 @@ int main(int argc, char** argv)
 
     LoadHMM(hmm, sr);
 
+    if (stream)
+    {
+      StreamViterbi(hmm, 1);
+      return 0;
+    }
+
     // Verify only one row in observations.
     if (dataSeq.n_cols == 1)
       dataSeq = trans(dataSeq);
@@ -72,6 +184,12 @@ int main(int argc, char** argv)
 
     LoadHMM(hmm, sr);
 
+    if (stream)
+    {
+      StreamViterbi(hmm, hmm.Emission()[0].Mean().n_elem);
+      return 0;
+    }
+
     // Verify correct dimensionality.
     if (dataSeq.n_rows != hmm.Emission()[0].Mean().n_elem)
       Log::Fatal << "Observation dimensionality (" << dataSeq.n_rows << ") "
@@ -86,6 +204,12 @@ int main(int argc, char** argv)
 
     LoadHMM(hmm, sr);
 
+    if (stream)
+    {
+      StreamViterbi(hmm, hmm.Emission()[0].Dimensionality());
+      return 0;
+    }
+
     // Verify correct dimensionality.
     if (dataSeq.n_rows != hmm.Emission()[0].Dimensionality())
       Log::Fatal << "Observation dimensionality (" << dataSeq.n_rows << ") "
@@ -0,0 +1,123 @@
+/**
+ * @file online_viterbi.hpp
+ *
+ * Definition of OnlineViterbi, a fixed-lag Viterbi decoder for observation
+ * streams that are too long (or never end) to decode with HMM::Predict().
+ */
+#ifndef __MLPACK_METHODS_HMM_ONLINE_VITERBI_HPP
+#define __MLPACK_METHODS_HMM_ONLINE_VITERBI_HPP
+
+#include <mlpack/core.hpp>
+#include "hmm.hpp"
+
+namespace mlpack {
+namespace hmm {
+
+/**
+ * A fixed-lag Viterbi decoder.  Observations are given one at a time with
+ * Step().  Once more than Lag() observations are waiting, the state of the
+ * oldest one is decided by tracing back from the currently most probable state;
+ * so each state is decided with Lag() observations of look-ahead.  Only the
+ * back-pointers of the waiting observations are kept, so the memory used is
+ * O(states * lag) no matter how long the stream is.  At the end of a stream,
+ * Finish() decides the remaining states with a full traceback.
+ *
+ * With a lag at least as long as the sequence, the decoded states are exactly
+ * those of HMM::Predict().  With a shorter lag, a decided state may
+ * occasionally differ from the one a full traceback would pick, when paths
+ * take longer than the lag to merge.
+ *
+ * @code
+ * OnlineViterbi<GaussianDistribution> decoder(hmm, 50);
+ * std::vector<size_t> states;
+ * while (...)
+ *   decoder.Step(observation, states); // Appends any newly decided states.
+ * decoder.Finish(states);
+ * @endcode
+ *
+ * @tparam Distribution Emission distribution type of the HMM.
+ */
+template<typename Distribution>
+class OnlineViterbi
+{
+ public:
+  /**
+   * Create a decoder for the given HMM.  The HMM must not be changed or
+   * destroyed while the decoder is used.
+   *
+   * @param hmm HMM to decode with.
+   * @param lag Number of observations of look-ahead before a state is decided;
+   *     with 0, each state is decided as soon as its observation arrives.
+   */
+  OnlineViterbi(const HMM<Distribution>& hmm, const size_t lag = 100);
+
+  /**
+   * Consume one observation.  If this leaves more than Lag() observations
+   * waiting, the state of the oldest one is appended to 'states'.
+   *
+   * @param observation Next observation of the stream.
+   * @param states Vector to append decided states to.
+   */
+  void Step(const arma::vec& observation, std::vector<size_t>& states);
+
+  /**
+   * Decide the states of all the waiting observations, append them to
+   * 'states', and reset the decoder for a new stream.
+   *
+   * @param states Vector to append decided states to.
+   * @return The log-likelihood of the most probable path of the whole stream.
+   */
+  double Finish(std::vector<size_t>& states);
+
+  //! Forget the current stream and start a new one.
+  void Reset();
+
+  //! Get the number of observations of look-ahead.
+  size_t Lag() const { return lag; }
+  //! Get the number of observations consumed in the current stream.
+  size_t Observations() const { return observations; }
+  //! Get the number of observations whose state has not been decided yet.
+  size_t Pending() const { return observations - decided; }
+
+ private:
+  /**
+   * Trace back from the most probable current state to the given time.
+   *
+   * @param time Time to trace back to; must not be before the oldest waiting
+   *     observation.
+   * @param path If non-NULL, filled with the states from 'time' to the last
+   *     observation.
+   * @return The state at the given time.
+   */
+  size_t TraceBack(const size_t time, std::vector<size_t>* path) const;
+
+  //! The HMM to decode with.
+  const HMM<Distribution>& hmm;
+  //! Number of observations of look-ahead.
+  size_t lag;
+
+  //! Log of the transposed transition matrix; column j holds the log
+  //! probability of reaching state j from each state.
+  arma::mat logTrans;
+  //! Log-probability of the most probable path ending in each state, minus
+  //! 'offset'.
+  arma::vec logDelta;
+  //! Amount subtracted from logDelta so far, to keep it from drifting.
+  double offset;
+  //! Ring buffer of back-pointers; column (t % (lag + 1)) holds the best
+  //! previous state of each state at time t.
+  arma::Mat<size_t> backPointers;
+
+  //! Number of observations consumed.
+  size_t observations;
+  //! Number of observations whose state has been decided.
+  size_t decided;
+};
+
+}; // namespace hmm
+}; // namespace mlpack
+
+// Include implementation.
+#include "online_viterbi_impl.hpp"
+
+#endif
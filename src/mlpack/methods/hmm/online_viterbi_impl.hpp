@@ -0,0 +1,139 @@
+/**
+ * @file online_viterbi_impl.hpp
+ *
+ * Implementation of the fixed-lag Viterbi decoder.
+ */
+#ifndef __MLPACK_METHODS_HMM_ONLINE_VITERBI_IMPL_HPP
+#define __MLPACK_METHODS_HMM_ONLINE_VITERBI_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "online_viterbi.hpp"
+
+namespace mlpack {
+namespace hmm {
+
+template<typename Distribution>
+OnlineViterbi<Distribution>::OnlineViterbi(const HMM<Distribution>& hmm,
+                                           const size_t lag) :
+    hmm(hmm),
+    lag(lag),
+    logTrans(arma::log(arma::trans(hmm.Transition()))),
+    backPointers(hmm.Transition().n_rows, lag + 1)
+{
+  Reset();
+}
+
+template<typename Distribution>
+void OnlineViterbi<Distribution>::Reset()
+{
+  logDelta.zeros(hmm.Transition().n_rows);
+  offset = 0.0;
+  observations = 0;
+  decided = 0;
+}
+
+template<typename Distribution>
+void OnlineViterbi<Distribution>::Step(const arma::vec& observation,
+                                       std::vector<size_t>& states)
+{
+  const size_t numStates = hmm.Transition().n_rows;
+
+  // Evaluate each emission distribution on the observation.
+  const arma::mat point(const_cast<double*>(observation.memptr()),
+      observation.n_elem, 1, false, true);
+  arma::vec logEmission(numStates);
+  arma::vec logProbability;
+  for (size_t state = 0; state < numStates; ++state)
+  {
+    BatchLogProbability(hmm.Emission()[state], point, logProbability);
+    logEmission[state] = logProbability[0];
+  }
+
+  const size_t slot = observations % (lag + 1);
+  if (observations == 0)
+  {
+    logDelta = arma::log(hmm.Initial()) + logEmission;
+    for (size_t state = 0; state < numStates; ++state)
+      backPointers(state, slot) = state;
+  }
+  else
+  {
+    // Given that we are in state j, we use state with the highest probability
+    // of being the previous state.
+    arma::vec newDelta(numStates);
+    arma::uword index;
+    for (size_t j = 0; j < numStates; ++j)
+    {
+      const arma::vec prob = logDelta + logTrans.col(j);
+      newDelta[j] = prob.max(index) + logEmission[j];
+      backPointers(j, slot) = index;
+    }
+    logDelta = newDelta;
+  }
+
+  // Keep the largest log-probability at zero, so that it doesn't drift off
+  // over a long stream.
+  const double shift = logDelta.max();
+  if (shift != -std::numeric_limits<double>::infinity())
+  {
+    logDelta -= shift;
+    offset += shift;
+  }
+
+  ++observations;
+
+  // Decide the oldest waiting observation, if there are too many.
+  if (observations - decided > lag)
+  {
+    states.push_back(TraceBack(decided, NULL));
+    ++decided;
+  }
+}
+
+template<typename Distribution>
+double OnlineViterbi<Distribution>::Finish(std::vector<size_t>& states)
+{
+  if (observations == 0)
+    return 0.0;
+
+  // With no lag, every state has been decided already.
+  if (decided < observations)
+  {
+    std::vector<size_t> path;
+    TraceBack(decided, &path);
+    states.insert(states.end(), path.begin(), path.end());
+  }
+
+  const double logLikelihood = logDelta.max() + offset;
+  Reset();
+  return logLikelihood;
+}
+
+template<typename Distribution>
+size_t OnlineViterbi<Distribution>::TraceBack(const size_t time,
+                                              std::vector<size_t>* path) const
+{
+  arma::uword index;
+  logDelta.max(index);
+  size_t state = index;
+
+  if (path != NULL)
+    path->assign(observations - time, 0);
+
+  for (size_t t = observations - 1; t > time; --t)
+  {
+    if (path != NULL)
+      (*path)[t - time] = state;
+    state = backPointers(state, t % (lag + 1));
+  }
+
+  if (path != NULL)
+    (*path)[0] = state;
+
+  return state;
+}
+
+}; // namespace hmm
+}; // namespace mlpack
+
+#endif
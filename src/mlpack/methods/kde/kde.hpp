@@ -0,0 +1,212 @@
+/**
+ * @file kde.hpp
+ *
+ * Defines the KDE class, which performs kernel density estimation with trees.
+ */
+#ifndef __MLPACK_METHODS_KDE_KDE_HPP
+#define __MLPACK_METHODS_KDE_KDE_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
+#include <mlpack/core/kernels/gaussian_kernel.hpp>
+#include <mlpack/core/tree/binary_space_tree.hpp>
+
+namespace mlpack {
+namespace kde /** Kernel density estimation. */ {
+
+/**
+ * The KDE class estimates the density of a reference set at query points:
+ *
+ * @f[
+ * f(q) = \frac{1}{N C} \sum_{r} K(d(q, r))
+ * @f]
+ *
+ * where N is the number of reference points and C is the normalizer of the
+ * kernel for the dimensionality of the data.  It is implemented in the style of
+ * a generalized tree-independent dual-tree algorithm (see the KDERules class):
+ * whenever the kernel varies little enough between a query node and a
+ * reference node, the contribution of the whole reference node is
+ * approximated, so that each estimate is within
+ *
+ * @f[
+ * |\hat{f}(q) - f(q)| \le \epsilon_r f(q) + \epsilon_a
+ * @f]
+ *
+ * of the true density, where @f$\epsilon_r@f$ is the relative error tolerance
+ * and @f$\epsilon_a@f$ is the absolute error tolerance.  With both tolerances
+ * 0, the result is exact (up to floating-point error), but little is pruned.
+ *
+ * The kernel must be a non-increasing function of the distance, and must
+ * provide Evaluate(distance) and Normalizer(dimension); this holds for
+ * kernel::GaussianKernel and kernel::EpanechnikovKernel.  The tree must hold each point in exactly one leaf,
+ * like tree::BinarySpaceTree and tree::RectangleTree; tree::CoverTree is not
+ * supported.
+ *
+ * @tparam KernelType Kernel to estimate the density with.
+ * @tparam MetricType Metric to compute the distances with.
+ * @tparam TreeType Type of tree to use.
+ */
+template<typename KernelType = kernel::GaussianKernel,
+         typename MetricType = metric::EuclideanDistance,
+         typename TreeType = tree::BinarySpaceTree<bound::HRectBound<2>,
+                                                   tree::EmptyStatistic> >
+class KDE
+{
+ public:
+  /**
+   * Initialize the KDE object with the given reference set, and build the
+   * reference tree (unless naive mode is used).  The reference set is copied
+   * if the tree rearranges it.
+   *
+   * @param referenceSet Reference dataset.
+   * @param relError Relative error tolerance of each estimate.
+   * @param absError Absolute error tolerance of each estimate.
+   * @param kernel Instantiated kernel (holding the bandwidth).
+   * @param naive Whether the computation should be done in O(n^2) naive mode.
+   * @param singleMode Whether single-tree computation should be used (as
+   *      opposed to dual-tree computation).
+   * @param metric Instantiated distance metric.
+   */
+  KDE(const typename TreeType::Mat& referenceSet,
+      const double relError = 0.05,
+      const double absError = 0.0,
+      const KernelType kernel = KernelType(),
+      const bool naive = false,
+      const bool singleMode = false,
+      const MetricType metric = MetricType());
+
+  /**
+   * Initialize the KDE object with the given pre-constructed reference tree.
+   * It is assumed that the points in referenceSet correspond to the points in
+   * referenceTree; the estimates are in the order of the points of the tree.
+   *
+   * @param referenceTree Pre-built tree for reference points.
+   * @param referenceSet Set of reference points corresponding to referenceTree.
+   * @param relError Relative error tolerance of each estimate.
+   * @param absError Absolute error tolerance of each estimate.
+   * @param kernel Instantiated kernel (holding the bandwidth).
+   * @param singleMode Whether single-tree computation should be used (as
+   *      opposed to dual-tree computation).
+   * @param metric Instantiated distance metric.
+   */
+  KDE(TreeType* referenceTree,
+      const typename TreeType::Mat& referenceSet,
+      const double relError = 0.05,
+      const double absError = 0.0,
+      const KernelType kernel = KernelType(),
+      const bool singleMode = false,
+      const MetricType metric = MetricType());
+
+  /**
+   * Destroy the KDE object.  If the reference tree was built, it is deleted.
+   */
+  ~KDE();
+
+  /**
+   * Estimate the density of the reference set at each of the given query
+   * points.  In dual-tree mode, a tree is built on a copy of the query set.
+   *
+   * If mlpack was compiled with OpenMP, naive and single-tree computation are
+   * run in parallel with the number of threads given by Threads().
+   *
+   * @param querySet Points to estimate the density at.
+   * @param estimations Vector to store the estimates in (one per query point).
+   */
+  void Evaluate(const typename TreeType::Mat& querySet,
+                arma::vec& estimations);
+
+  /**
+   * Estimate the density of the reference set at each of the reference points
+   * (each point counts itself, so this is the density that Evaluate() would
+   * give with the reference set as the query set).  In dual-tree mode, the
+   * reference tree is also used as the query tree.
+   *
+   * @param estimations Vector to store the estimates in (one per reference
+   *     point).
+   */
+  void Evaluate(arma::vec& estimations);
+
+  //! Get the relative error tolerance.
+  double RelativeError() const { return relError; }
+  //! Modify the relative error tolerance.
+  double& RelativeError() { return relError; }
+
+  //! Get the absolute error tolerance.
+  double AbsoluteError() const { return absError; }
+  //! Modify the absolute error tolerance.
+  double& AbsoluteError() { return absError; }
+
+  //! Get the kernel.
+  const KernelType& Kernel() const { return kernel; }
+  //! Modify the kernel.
+  KernelType& Kernel() { return kernel; }
+
+  //! Get the number of pruned nodes during the last evaluation.
+  size_t NumPrunes() const { return numPrunes; }
+
+  //! Get the number of threads used for naive and single-tree computation (0
+  //! means all available threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for naive and single-tree computation
+  //! (0 means all available threads).  This has no effect if mlpack was
+  //! compiled without OpenMP.
+  size_t& Threads() { return threads; }
+
+ private:
+  //! Copy of reference matrix; used when a tree is built internally.
+  typename TreeType::Mat referenceCopy;
+
+  //! Reference set (data should be accessed using this).
+  const typename TreeType::Mat& referenceSet;
+
+  //! Reference tree (NULL in naive mode).
+  TreeType* referenceTree;
+
+  //! Mappings to old reference indices (used when this object builds trees).
+  std::vector<size_t> oldFromNewReferences;
+
+  //! If true, this object is responsible for deleting the reference tree.
+  bool treeOwner;
+
+  //! The relative error tolerance.
+  double relError;
+  //! The absolute error tolerance.
+  double absError;
+
+  //! If true, O(n^2) naive computation is used.
+  bool naive;
+  //! If true, single-tree computation is used.
+  bool singleMode;
+
+  //! Instantiated kernel.
+  KernelType kernel;
+  //! Instantiated distance metric.
+  MetricType metric;
+
+  //! The number of pruned nodes during the last evaluation.
+  size_t numPrunes;
+
+  //! The number of threads to use (0 means all available).
+  size_t threads;
+
+  /**
+   * Compute the kernel sums of the given query points (not mapped, and not
+   * normalized).
+   *
+   * @param querySet Query points.
+   * @param queryTree Tree built on the query points, or NULL in naive and
+   *     single-tree mode.
+   * @param sums Vector to store the sums in.
+   */
+  void ComputeSums(const typename TreeType::Mat& querySet,
+                   TreeType* queryTree,
+                   arma::vec& sums);
+};
+
+}; // namespace kde
+}; // namespace mlpack
+
+// Include implementation.
+#include "kde_impl.hpp"
+
+#endif
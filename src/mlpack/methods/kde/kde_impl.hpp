@@ -0,0 +1,284 @@
+/**
+ * @file kde_impl.hpp
+ *
+ * Implementation of the KDE class.
+ */
+#ifndef __MLPACK_METHODS_KDE_KDE_IMPL_HPP
+#define __MLPACK_METHODS_KDE_KDE_IMPL_HPP
+
+// Just in case it hasn't been included.
+#include "kde.hpp"
+
+// The rules for traversal.
+#include "kde_rules.hpp"
+
+namespace mlpack {
+namespace kde {
+
+//! Call the tree constructor that does mapping.
+template<typename TreeType>
+TreeType* BuildTree(
+    typename TreeType::Mat& dataset,
+    std::vector<size_t>& oldFromNew,
+    typename boost::enable_if_c<
+        tree::TreeTraits<TreeType>::RearrangesDataset == true, TreeType*
+    >::type = 0)
+{
+  return new TreeType(dataset, oldFromNew);
+}
+
+//! Call the tree constructor that does not do mapping.
+template<typename TreeType>
+TreeType* BuildTree(
+    const typename TreeType::Mat& dataset,
+    const std::vector<size_t>& /* oldFromNew */,
+    const typename boost::enable_if_c<
+        tree::TreeTraits<TreeType>::RearrangesDataset == false, TreeType*
+    >::type = 0)
+{
+  return new TreeType(dataset);
+}
+
+template<typename KernelType, typename MetricType, typename TreeType>
+KDE<KernelType, MetricType, TreeType>::KDE(
+    const typename TreeType::Mat& referenceSetIn,
+    const double relError,
+    const double absError,
+    const KernelType kernel,
+    const bool naive,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceSet(tree::TreeTraits<TreeType>::RearrangesDataset ? referenceCopy
+        : referenceSetIn),
+    referenceTree(NULL),
+    treeOwner(!naive), // If in naive mode, we are not building any trees.
+    relError(relError),
+    absError(absError),
+    naive(naive),
+    singleMode(!naive && singleMode), // Naive overrides single mode.
+    kernel(kernel),
+    metric(metric),
+    numPrunes(0),
+    threads(0)
+{
+  if (tree::TreeTraits<TreeType>::HasSelfChildren)
+    Log::Fatal << "KDE::KDE(): trees with self-children (such as the cover "
+        << "tree) are not supported!" << std::endl;
+  if (relError < 0.0 || absError < 0.0)
+    Log::Fatal << "KDE::KDE(): error tolerances must be nonnegative!"
+        << std::endl;
+
+  // If in naive mode, then we do not need to build trees.
+  if (!naive)
+  {
+    Timer::Start("kde/tree_building");
+
+    // Copy the dataset, if it will be modified during tree building.
+    if (tree::TreeTraits<TreeType>::RearrangesDataset)
+      referenceCopy = referenceSetIn;
+
+    // The const_cast is safe; if RearrangesDataset == false, then it'll be
+    // casted back to const anyway, and if not, referenceSet points to
+    // referenceCopy, which isn't const.
+    referenceTree = BuildTree<TreeType>(
+        const_cast<typename TreeType::Mat&>(referenceSet),
+        oldFromNewReferences);
+
+    Timer::Stop("kde/tree_building");
+  }
+}
+
+template<typename KernelType, typename MetricType, typename TreeType>
+KDE<KernelType, MetricType, TreeType>::KDE(
+    TreeType* referenceTree,
+    const typename TreeType::Mat& referenceSet,
+    const double relError,
+    const double absError,
+    const KernelType kernel,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceSet(referenceSet),
+    referenceTree(referenceTree),
+    treeOwner(false),
+    relError(relError),
+    absError(absError),
+    naive(false),
+    singleMode(singleMode),
+    kernel(kernel),
+    metric(metric),
+    numPrunes(0),
+    threads(0)
+{
+  if (tree::TreeTraits<TreeType>::HasSelfChildren)
+    Log::Fatal << "KDE::KDE(): trees with self-children (such as the cover "
+        << "tree) are not supported!" << std::endl;
+  if (relError < 0.0 || absError < 0.0)
+    Log::Fatal << "KDE::KDE(): error tolerances must be nonnegative!"
+        << std::endl;
+}
+
+template<typename KernelType, typename MetricType, typename TreeType>
+KDE<KernelType, MetricType, TreeType>::~KDE()
+{
+  if (treeOwner && referenceTree)
+    delete referenceTree;
+}
+
+template<typename KernelType, typename MetricType, typename TreeType>
+void KDE<KernelType, MetricType, TreeType>::Evaluate(
+    const typename TreeType::Mat& querySetIn,
+    arma::vec& estimations)
+{
+  if (querySetIn.n_rows != referenceSet.n_rows)
+  {
+    Log::Fatal << "KDE::Evaluate(): query points have " << querySetIn.n_rows
+        << " dimensions, but the reference points have "
+        << referenceSet.n_rows << "!" << std::endl;
+  }
+
+  if (naive || singleMode)
+  {
+    ComputeSums(querySetIn, NULL, estimations);
+  }
+  else
+  {
+    // Build the query tree on a copy of the query set, if the tree rearranges
+    // the dataset.
+    Timer::Start("kde/tree_building");
+    typename TreeType::Mat queryCopy;
+    if (tree::TreeTraits<TreeType>::RearrangesDataset)
+      queryCopy = querySetIn;
+    const typename TreeType::Mat& querySet =
+        tree::TreeTraits<TreeType>::RearrangesDataset ? queryCopy : querySetIn;
+
+    std::vector<size_t> oldFromNewQueries;
+    TreeType* queryTree = BuildTree<TreeType>(
+        const_cast<typename TreeType::Mat&>(querySet), oldFromNewQueries);
+    Timer::Stop("kde/tree_building");
+
+    arma::vec sums;
+    ComputeSums(querySet, queryTree, sums);
+    delete queryTree;
+
+    // Map the estimates back to the original query points, if necessary.
+    if (tree::TreeTraits<TreeType>::RearrangesDataset)
+    {
+      estimations.set_size(sums.n_elem);
+      for (size_t i = 0; i < sums.n_elem; ++i)
+        estimations[oldFromNewQueries[i]] = sums[i];
+    }
+    else
+    {
+      estimations.swap(sums);
+    }
+  }
+
+  estimations /= referenceSet.n_cols * kernel.Normalizer(referenceSet.n_rows);
+}
+
+template<typename KernelType, typename MetricType, typename TreeType>
+void KDE<KernelType, MetricType, TreeType>::Evaluate(arma::vec& estimations)
+{
+  arma::vec sums;
+  ComputeSums(referenceSet, (naive || singleMode) ? NULL : referenceTree,
+      sums);
+
+  // Map the estimates back to the original reference points, if necessary.
+  if (treeOwner && tree::TreeTraits<TreeType>::RearrangesDataset)
+  {
+    estimations.set_size(sums.n_elem);
+    for (size_t i = 0; i < sums.n_elem; ++i)
+      estimations[oldFromNewReferences[i]] = sums[i];
+  }
+  else
+  {
+    estimations.swap(sums);
+  }
+
+  estimations /= referenceSet.n_cols * kernel.Normalizer(referenceSet.n_rows);
+}
+
+template<typename KernelType, typename MetricType, typename TreeType>
+void KDE<KernelType, MetricType, TreeType>::ComputeSums(
+    const typename TreeType::Mat& querySet,
+    TreeType* queryTree,
+    arma::vec& sums)
+{
+  Timer::Start("kde/computing_densities");
+
+  sums.zeros(querySet.n_cols);
+  numPrunes = 0;
+
+  // The tolerances apply to the normalized density, and the rules work on the
+  // sum of the kernel values, so the absolute tolerance of each kernel value
+  // is scaled by the normalizer.
+  const double kernelAbsError = absError *
+      kernel.Normalizer(referenceSet.n_rows);
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  typedef KDERules<MetricType, KernelType, TreeType> RuleType;
+
+  if (naive)
+  {
+    // The naive brute-force solution.  Each query point is handled by one
+    // thread.
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 16)
+    for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+    {
+      double sum = 0.0;
+      for (size_t j = 0; j < referenceSet.n_cols; ++j)
+        sum += kernel.Evaluate(metric.Evaluate(querySet.unsafe_col(i),
+            referenceSet.unsafe_col(j)));
+      sums[i] = sum;
+    }
+  }
+  else if (queryTree == NULL)
+  {
+    // The query points are split between the threads, each of which has its
+    // own rules and traverser.  Each query point's sum is only touched by one
+    // thread.
+    size_t totalPrunes = 0;
+
+    #pragma omp parallel num_threads(numThreads) reduction(+:totalPrunes)
+    {
+      RuleType rules(referenceSet, querySet, sums, relError, kernelAbsError,
+          metric, kernel);
+      typename TreeType::template SingleTreeTraverser<RuleType>
+          traverser(rules);
+
+      #pragma omp for schedule(dynamic, 16)
+      for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+        traverser.Traverse(i, *referenceTree);
+
+      totalPrunes += traverser.NumPrunes();
+    }
+
+    numPrunes = totalPrunes;
+  }
+  else // Dual-tree recursion.
+  {
+    RuleType rules(referenceSet, querySet, sums, relError, kernelAbsError,
+        metric, kernel);
+    typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
+
+    traverser.Traverse(*queryTree, *referenceTree);
+
+    numPrunes = traverser.NumPrunes();
+  }
+
+  Timer::Stop("kde/computing_densities");
+
+  Log::Info << "Number of pruned nodes during computation: " << numPrunes
+      << "." << std::endl;
+}
+
+}; // namespace kde
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * @file kde_main.cpp
+ *
+ * Executable which estimates the density of a dataset at a set of points with
+ * kernel density estimation.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/core/kernels/epanechnikov_kernel.hpp>
+
+#include <string>
+
+#include "kde.hpp"
+
+using namespace std;
+using namespace mlpack;
+using namespace mlpack::kde;
+using namespace mlpack::kernel;
+
+// Information about the program itself.
+PROGRAM_INFO("Kernel Density Estimation",
+    "This program estimates the density of a reference set at a set of query "
+    "points with kernel density estimation, using trees to approximate the "
+    "contributions of groups of reference points which are all at similar "
+    "distances from groups of query points.  Each estimate is within "
+    "rel_error times the true density, plus abs_error, of the true density.  "
+    "You may specify a separate set of query points, or just a reference set, "
+    "in which case the density is estimated at each reference point."
+    "\n\n"
+    "For example, the following will estimate the density of the points in "
+    "'input.csv' with a Gaussian kernel of bandwidth 0.5 at each point of "
+    "'queries.csv', and store the estimates in 'density.csv':"
+    "\n\n"
+    "$ kde -r input.csv -q queries.csv -b 0.5 -o density.csv"
+    "\n\n"
+    "The output file has one row for each query point.  The supported kernels "
+    "are 'gaussian' and 'epanechnikov'.");
+
+// Define our input parameters that this program will take.
+PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
+    "r");
+PARAM_STRING("query_file", "File containing query points (optional).", "q", "");
+PARAM_STRING("output_file", "File to output the density estimates into.", "o",
+    "");
+
+PARAM_STRING("kernel", "Kernel to use ('gaussian' or 'epanechnikov').", "k",
+    "gaussian");
+PARAM_DOUBLE("bandwidth", "Bandwidth of the kernel.", "b", 1.0);
+PARAM_DOUBLE("rel_error", "Relative error tolerance of each estimate.", "e",
+    0.05);
+PARAM_DOUBLE("abs_error", "Absolute error tolerance of each estimate.", "E",
+    0.0);
+
+PARAM_FLAG("naive", "If true, O(n^2) naive mode is used for computation.", "N");
+PARAM_FLAG("single_mode", "If true, single-tree computation is used (as "
+    "opposed to dual-tree computation).", "S");
+PARAM_INT("threads", "Number of threads to use for naive and single-tree "
+    "computation (0 uses all available cores; ignored if mlpack was built "
+    "without OpenMP).", "t", 0);
+
+/**
+ * Estimate the density with the given kernel, at the query points if there
+ * are any and at the reference points otherwise.
+ */
+template<typename KernelType>
+void RunKDE(const arma::mat& referenceData,
+            const arma::mat& queryData,
+            const KernelType& kernel,
+            arma::vec& estimations)
+{
+  KDE<KernelType> kde(referenceData, CLI::GetParam<double>("rel_error"),
+      CLI::GetParam<double>("abs_error"), kernel, CLI::HasParam("naive"),
+      CLI::HasParam("single_mode"));
+  kde.Threads() = (size_t) CLI::GetParam<int>("threads");
+
+  if (queryData.n_elem > 0)
+    kde.Evaluate(queryData, estimations);
+  else
+    kde.Evaluate(estimations);
+}
+
+int main(int argc, char *argv[])
+{
+  // Give CLI the command line parameters the user passed in.
+  CLI::ParseCommandLine(argc, argv);
+
+  // Get all the parameters.
+  const string referenceFile = CLI::GetParam<string>("reference_file");
+  const string queryFile = CLI::GetParam<string>("query_file");
+  const string outputFile = CLI::GetParam<string>("output_file");
+  const string kernelType = CLI::GetParam<string>("kernel");
+  const double bandwidth = CLI::GetParam<double>("bandwidth");
+
+  if (bandwidth <= 0.0)
+  {
+    Log::Fatal << "Invalid bandwidth: " << bandwidth << ".  Must be greater "
+        << "than 0." << endl;
+  }
+
+  if (CLI::GetParam<double>("rel_error") < 0.0 ||
+      CLI::GetParam<double>("abs_error") < 0.0)
+  {
+    Log::Fatal << "Invalid error tolerance: --rel_error and --abs_error must "
+        << "be greater than or equal to 0." << endl;
+  }
+
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+
+  if (CLI::HasParam("naive") && CLI::HasParam("single_mode"))
+  {
+    Log::Warn << "--single_mode ignored because --naive is present." << endl;
+  }
+
+  arma::mat referenceData;
+  data::Load(referenceFile, referenceData, true);
+  Log::Info << "Loaded reference data from '" << referenceFile << "' ("
+      << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
+
+  arma::mat queryData;
+  if (queryFile != "")
+  {
+    data::Load(queryFile, queryData, true);
+    Log::Info << "Loaded query data from '" << queryFile << "' ("
+        << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+  }
+
+  arma::vec estimations;
+  if (kernelType == "gaussian")
+  {
+    RunKDE(referenceData, queryData, GaussianKernel(bandwidth), estimations);
+  }
+  else if (kernelType == "epanechnikov")
+  {
+    RunKDE(referenceData, queryData, EpanechnikovKernel(bandwidth),
+        estimations);
+  }
+  else
+  {
+    Log::Fatal << "Invalid kernel type: '" << kernelType << "'; must be "
+        << "'gaussian' or 'epanechnikov'." << endl;
+  }
+
+  // Save output.
+  if (outputFile != "")
+    data::Save(outputFile, estimations);
+}
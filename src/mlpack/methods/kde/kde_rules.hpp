@@ -0,0 +1,153 @@
+/**
+ * @file kde_rules.hpp
+ *
+ * Rules for kernel density estimation, so that it can be done with arbitrary
+ * tree types.
+ */
+#ifndef __MLPACK_METHODS_KDE_KDE_RULES_HPP
+#define __MLPACK_METHODS_KDE_KDE_RULES_HPP
+
+#include "../neighbor_search/ns_traversal_info.hpp"
+
+namespace mlpack {
+namespace kde {
+
+/**
+ * The rules for kernel density estimation.  Each query point accumulates the
+ * sum of the kernel values between it and every reference point.  A reference
+ * node is pruned when the kernel varies little enough over the distances
+ * between the query point (or node) and the reference node: every reference
+ * point in it is then credited with the midpoint of the smallest and largest
+ * possible kernel values.
+ *
+ * The kernel must be a non-increasing function of the distance, and must
+ * provide Evaluate(distance).
+ */
+template<typename MetricType, typename KernelType, typename TreeType>
+class KDERules
+{
+ public:
+  /**
+   * Construct the KDERules object.  This is usually done from within the KDE
+   * class at evaluation time.
+   *
+   * The approximation error of the sum of each query point is at most
+   * relError times the sum plus absError times the number of reference points.
+   *
+   * @param referenceSet Set of reference data.
+   * @param querySet Set of query data.
+   * @param sums Vector to add the kernel sums of the query points to.
+   * @param relError Relative error tolerance.
+   * @param absError Absolute error tolerance of each kernel value.
+   * @param metric Instantiated metric.
+   * @param kernel Instantiated kernel.
+   */
+  KDERules(const typename TreeType::Mat& referenceSet,
+           const typename TreeType::Mat& querySet,
+           arma::vec& sums,
+           const double relError,
+           const double absError,
+           MetricType& metric,
+           KernelType& kernel);
+
+  /**
+   * Compute the base case between the given query point and reference point.
+   *
+   * @param queryIndex Index of query point.
+   * @param referenceIndex Index of reference point.
+   */
+  double BaseCase(const size_t queryIndex, const size_t referenceIndex);
+
+  /**
+   * Get the score for recursion order.  DBL_MAX indicates that the node should
+   * not be recursed into, because its contribution has been approximated.
+   *
+   * @param queryIndex Index of query point.
+   * @param referenceNode Candidate node to be recursed into.
+   */
+  double Score(const size_t queryIndex, TreeType& referenceNode);
+
+  /**
+   * Re-evaluate the score for recursion order.  A node that was not pruned by
+   * Score() is never pruned later, so this returns the old score.
+   *
+   * @param queryIndex Index of query point.
+   * @param referenceNode Candidate node to be recursed into.
+   * @param oldScore Old score produced by Score() (or Rescore()).
+   */
+  double Rescore(const size_t queryIndex,
+                 TreeType& referenceNode,
+                 const double oldScore) const;
+
+  /**
+   * Get the score for recursion order.  DBL_MAX indicates that the node
+   * combination should not be recursed into, because its contribution has been
+   * approximated.
+   *
+   * @param queryNode Candidate query node to recurse into.
+   * @param referenceNode Candidate reference node to recurse into.
+   */
+  double Score(TreeType& queryNode, TreeType& referenceNode);
+
+  /**
+   * Re-evaluate the score for recursion order.  A node combination that was
+   * not pruned by Score() is never pruned later, so this returns the old
+   * score.
+   *
+   * @param queryNode Candidate query node to recurse into.
+   * @param referenceNode Candidate reference node to recurse into.
+   * @param oldScore Old score produced by Score() (or Rescore()).
+   */
+  double Rescore(TreeType& queryNode,
+                 TreeType& referenceNode,
+                 const double oldScore) const;
+
+  typedef neighbor::NeighborSearchTraversalInfo<TreeType> TraversalInfoType;
+
+  const TraversalInfoType& TraversalInfo() const { return traversalInfo; }
+  TraversalInfoType& TraversalInfo() { return traversalInfo; }
+
+ private:
+  //! The reference set.
+  const typename TreeType::Mat& referenceSet;
+
+  //! The query set.
+  const typename TreeType::Mat& querySet;
+
+  //! The kernel sums of the query points.
+  arma::vec& sums;
+
+  //! The relative error tolerance.
+  const double relError;
+  //! The absolute error tolerance of each kernel value.
+  const double absError;
+
+  //! The instantiated metric.
+  MetricType& metric;
+  //! The instantiated kernel.
+  KernelType& kernel;
+
+  //! The last query index.
+  size_t lastQueryIndex;
+  //! The last reference index.
+  size_t lastReferenceIndex;
+
+  /**
+   * If the kernel varies little enough over the given range of distances,
+   * store the approximate contribution of numReferences reference points at
+   * those distances and return true; otherwise, return false.
+   */
+  bool Approximate(const math::Range& distances,
+                   const size_t numReferences,
+                   double& contribution) const;
+
+  TraversalInfoType traversalInfo;
+};
+
+}; // namespace kde
+}; // namespace mlpack
+
+// Include implementation.
+#include "kde_rules_impl.hpp"
+
+#endif
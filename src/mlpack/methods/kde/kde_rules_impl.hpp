@@ -0,0 +1,146 @@
+/**
+ * @file kde_rules_impl.hpp
+ *
+ * Implementation of rules for kernel density estimation with generic trees.
+ */
+#ifndef __MLPACK_METHODS_KDE_KDE_RULES_IMPL_HPP
+#define __MLPACK_METHODS_KDE_KDE_RULES_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kde_rules.hpp"
+
+namespace mlpack {
+namespace kde {
+
+template<typename MetricType, typename KernelType, typename TreeType>
+KDERules<MetricType, KernelType, TreeType>::KDERules(
+    const typename TreeType::Mat& referenceSet,
+    const typename TreeType::Mat& querySet,
+    arma::vec& sums,
+    const double relError,
+    const double absError,
+    MetricType& metric,
+    KernelType& kernel) :
+    referenceSet(referenceSet),
+    querySet(querySet),
+    sums(sums),
+    relError(relError),
+    absError(absError),
+    metric(metric),
+    kernel(kernel),
+    lastQueryIndex(querySet.n_cols),
+    lastReferenceIndex(referenceSet.n_cols)
+{
+  // Nothing to do.
+}
+
+//! The base case.  Evaluate the kernel between the two points and add it to the
+//! sum of the query point.
+template<typename MetricType, typename KernelType, typename TreeType>
+inline force_inline
+double KDERules<MetricType, KernelType, TreeType>::BaseCase(
+    const size_t queryIndex,
+    const size_t referenceIndex)
+{
+  // If we have just performed this base case, don't do it again.
+  if ((lastQueryIndex == queryIndex) && (lastReferenceIndex == referenceIndex))
+    return 0.0;
+
+  const double distance = metric.Evaluate(querySet.unsafe_col(queryIndex),
+      referenceSet.unsafe_col(referenceIndex));
+  sums[queryIndex] += kernel.Evaluate(distance);
+
+  lastQueryIndex = queryIndex;
+  lastReferenceIndex = referenceIndex;
+
+  return distance;
+}
+
+//! Single-tree scoring function.
+template<typename MetricType, typename KernelType, typename TreeType>
+double KDERules<MetricType, KernelType, TreeType>::Score(
+    const size_t queryIndex,
+    TreeType& referenceNode)
+{
+  const math::Range distances = referenceNode.RangeDistance(
+      querySet.unsafe_col(queryIndex));
+
+  double contribution;
+  if (Approximate(distances, referenceNode.NumDescendants(), contribution))
+  {
+    sums[queryIndex] += contribution;
+    return DBL_MAX;
+  }
+
+  // Nearer nodes are visited first; the order does not change the result.
+  return distances.Lo();
+}
+
+//! Single-tree rescoring function.
+template<typename MetricType, typename KernelType, typename TreeType>
+double KDERules<MetricType, KernelType, TreeType>::Rescore(
+    const size_t /* queryIndex */,
+    TreeType& /* referenceNode */,
+    const double oldScore) const
+{
+  // If it wasn't pruned before, it isn't pruned now.
+  return oldScore;
+}
+
+//! Dual-tree scoring function.
+template<typename MetricType, typename KernelType, typename TreeType>
+double KDERules<MetricType, KernelType, TreeType>::Score(
+    TreeType& queryNode,
+    TreeType& referenceNode)
+{
+  const math::Range distances = referenceNode.RangeDistance(&queryNode);
+
+  // The same approximation holds for every point in the query node.
+  double contribution;
+  if (Approximate(distances, referenceNode.NumDescendants(), contribution))
+  {
+    for (size_t i = 0; i < queryNode.NumDescendants(); ++i)
+      sums[queryNode.Descendant(i)] += contribution;
+    return DBL_MAX;
+  }
+
+  traversalInfo.LastQueryNode() = &queryNode;
+  traversalInfo.LastReferenceNode() = &referenceNode;
+  return distances.Lo();
+}
+
+//! Dual-tree rescoring function.
+template<typename MetricType, typename KernelType, typename TreeType>
+double KDERules<MetricType, KernelType, TreeType>::Rescore(
+    TreeType& /* queryNode */,
+    TreeType& /* referenceNode */,
+    const double oldScore) const
+{
+  // If it wasn't pruned before, it isn't pruned now.
+  return oldScore;
+}
+
+template<typename MetricType, typename KernelType, typename TreeType>
+bool KDERules<MetricType, KernelType, TreeType>::Approximate(
+    const math::Range& distances,
+    const size_t numReferences,
+    double& contribution) const
+{
+  // The kernel is non-increasing, so it lies between these bounds for every
+  // pair of points.  Using the midpoint for each reference point makes an error
+  // of at most half the difference, which is allowed if it is no more than
+  // relError times the smallest possible kernel value (and thus the true
+  // value), plus absError.
+  const double maxKernel = kernel.Evaluate(distances.Lo());
+  const double minKernel = kernel.Evaluate(distances.Hi());
+  if (maxKernel - minKernel > 2.0 * (relError * minKernel + absError))
+    return false;
+
+  contribution = numReferences * (maxKernel + minKernel) / 2.0;
+  return true;
+}
+
+}; // namespace kde
+}; // namespace mlpack
+
+#endif
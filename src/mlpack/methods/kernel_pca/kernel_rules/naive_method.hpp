@@ -9,6 +9,7 @@
 #define __MLPACK_METHODS_KERNEL_PCA_NAIVE_METHOD_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/core/kernels/kernel_matrix.hpp>
 
 namespace mlpack {
 namespace kpca {
@@ -34,52 +35,45 @@ class NaiveKernelRule
                                   const size_t /* unused */,
                                   KernelType kernel = KernelType())
   {
-    // Construct the kernel matrix.
-    arma::mat kernelMatrix;
-    // Resize the kernel matrix to the right size.
-    kernelMatrix.set_size(data.n_cols, data.n_cols);
-
-    // Note that we only need to calculate the upper triangular part of the 
-    // kernel matrix, since it is symmetric. This helps minimize the number of
+    // Construct the kernel matrix.  Only its upper triangular part is
+    // evaluated, since it is symmetric; this helps minimize the number of
     // kernel evaluations.
-    for (size_t i = 0; i < data.n_cols; ++i)
-    {
-      for (size_t j = i; j < data.n_cols; ++j)
-      {
-        // Evaluate the kernel on these two points.
-        kernelMatrix(i, j) = kernel.Evaluate(data.unsafe_col(i),
-                                             data.unsafe_col(j));
-      }
-    }
-
-    // Copy to the lower triangular part of the matrix.
-    for (size_t i = 1; i < data.n_cols; ++i)
-      for (size_t j = 0; j < i; ++j)
-        kernelMatrix(i, j) = kernelMatrix(j, i);
+    arma::mat kernelMatrix;
+    kernel::KernelMatrix(kernel, data, kernelMatrix);
 
     // For PCA the data has to be centered, even if the data is centered. But it
     // is not guaranteed that the data, when mapped to the kernel space, is also
     // centered. Since we actually never work in the feature space we cannot
     // center the data. So, we perform a "psuedo-centering" using the kernel
-    // matrix.
-    arma::rowvec rowMean = arma::sum(kernelMatrix, 0) / kernelMatrix.n_cols;
-    kernelMatrix.each_col() -= arma::sum(kernelMatrix, 1) / kernelMatrix.n_cols;
-    kernelMatrix.each_row() -= rowMean;
-    kernelMatrix += arma::sum(rowMean) / kernelMatrix.n_cols;
+    // matrix.  Because the kernel matrix is symmetric, its row and column means
+    // are the same, so the centering can be done in place with one vector of
+    // means and no other temporaries.
+    const arma::rowvec rowMean = arma::sum(kernelMatrix, 0) /
+        kernelMatrix.n_cols;
+    const double mean = arma::accu(rowMean) / kernelMatrix.n_cols;
+    for (size_t j = 0; j < kernelMatrix.n_cols; ++j)
+      for (size_t i = 0; i < kernelMatrix.n_rows; ++i)
+        kernelMatrix(i, j) += mean - rowMean[i] - rowMean[j];
 
     // Eigendecompose the centered kernel matrix.
     arma::eig_sym(eigval, eigvec, kernelMatrix);
 
-    // Swap the eigenvalues since they are ordered backwards (we need largest to
-    // smallest).
+    // The kernel matrix is not needed anymore.
+    kernelMatrix.reset();
+
+    // Swap the eigenvalues and eigenvectors since they are ordered backwards
+    // (we need largest to smallest).
     for (size_t i = 0; i < floor(eigval.n_elem / 2.0); ++i)
+    {
       eigval.swap_rows(i, (eigval.n_elem - 1) - i);
+      eigvec.swap_cols(i, (eigvec.n_cols - 1) - i);
+    }
 
-    // Flip the coefficients to produce the same effect.
-    eigvec = arma::fliplr(eigvec);
-
-    transformedData = eigvec.t() * kernelMatrix;
-    transformedData.each_col() /= arma::sqrt(eigval);
+    // The projection of the data is eigvec' * K / sqrt(eigval).  Since
+    // K = eigvec * diagmat(eigval) * eigvec', this is just
+    // sqrt(eigval) % eigvec', and no product with K is needed.
+    transformedData = eigvec.t();
+    transformedData.each_col() %= arma::sqrt(eigval);
   }
 };
 
@@ -24,6 +24,10 @@ class NystroemKernelRule
   public:
     /**
      * Construct the kernel matrix approximation using the nystroem method.
+     * If a cache is given, the landmarks and kernel blocks it holds are reused
+     * (and it is filled if it holds too few), so that calls with the same data
+     * and kernel but a different rank don't select landmarks or evaluate the
+     * kernel again; see kernel::NystroemCache.
      *
      * @param data Input data points.
      * @param transformedData Matrix to output results into.
@@ -31,17 +35,19 @@ class NystroemKernelRule
      * @param eigvec KPCA eigenvectors will be written to this matrix.
      * @param rank Rank to be used for matrix approximation.
      * @param kernel Kernel to be used for computation.
+     * @param cache Cache of landmarks and kernel blocks, or NULL.
      */
     static void ApplyKernelMatrix(const arma::mat& data,
                                   arma::mat& transformedData,
                                   arma::vec& eigval,
                                   arma::mat& eigvec,
                                   const size_t rank,
-                                  KernelType kernel = KernelType())
+                                  KernelType kernel = KernelType(),
+                                  kernel::NystroemCache* cache = NULL)
     {
       arma::mat G, v;
       kernel::NystroemMethod<KernelType, PointSelectionPolicy> nm(data, kernel,
-                                                        rank);
+                                                        rank, cache);
       nm.Apply(G);
       transformedData = G.t() * G;
 
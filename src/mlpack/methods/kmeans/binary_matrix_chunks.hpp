@@ -0,0 +1,122 @@
+/**
+ * @file binary_matrix_chunks.hpp
+ *
+ * Definition of BinaryMatrixChunks, which reads a matrix stored in a binary
+ * stream one block of columns at a time, so that algorithms like ChunkedKMeans
+ * can work on datasets that do not fit in memory.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_BINARY_MATRIX_CHUNKS_HPP
+#define __MLPACK_METHODS_KMEANS_BINARY_MATRIX_CHUNKS_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/binary_io.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * Read a matrix of doubles from a binary stream in chunks of consecutive
+ * columns.  The matrix must be stored in the format written by
+ * util::WriteBinary(): the number of rows and the number of columns (both as
+ * size_t), followed by the elements in column-major order.  Since columns are
+ * contiguous, each pass over the matrix is a single sequential read of the
+ * stream, and only one chunk is held in memory at a time.
+ *
+ * This is an example of the chunk source interface that ChunkedKMeans takes:
+ *
+ * @code
+ * size_t Rows() const; // Dimensionality of the points.
+ * size_t Cols() const; // Total number of points.
+ * void Reset(); // Go back to the first chunk.
+ * bool NextChunk(arma::mat& chunk); // Get the next chunk; false at the end.
+ * @endcode
+ *
+ * The stream must be seekable, since Reset() returns to the first column.
+ */
+class BinaryMatrixChunks
+{
+ public:
+  /**
+   * Prepare to read the matrix stored in the given stream (starting at its
+   * current position).  The stream must stay valid while this object is used.
+   * If the header can't be read, a fatal error is thrown.
+   *
+   * @param stream Stream holding the matrix.
+   * @param chunkSize Maximum number of columns in each chunk.
+   */
+  BinaryMatrixChunks(std::istream& stream, const size_t chunkSize = 100000) :
+      stream(stream),
+      chunkSize(chunkSize),
+      position(0)
+  {
+    if (chunkSize == 0)
+      Log::Fatal << "BinaryMatrixChunks: chunk size must be greater than 0!"
+          << std::endl;
+
+    util::ReadBinary(stream, rows);
+    util::ReadBinary(stream, cols);
+    start = stream.tellg();
+  }
+
+  //! Get the number of rows (the dimensionality of each point).
+  size_t Rows() const { return rows; }
+  //! Get the number of columns (the number of points).
+  size_t Cols() const { return cols; }
+
+  //! Get the maximum number of columns in each chunk.
+  size_t ChunkSize() const { return chunkSize; }
+
+  //! Go back to the first chunk.
+  void Reset()
+  {
+    stream.clear();
+    stream.seekg(start);
+    position = 0;
+  }
+
+  /**
+   * Read the next chunk of columns.  Returns false (and leaves the chunk
+   * unmodified) if all columns have been read already.  If the stream ends
+   * early, a fatal error is thrown.
+   *
+   * @param chunk Matrix to read the chunk into.
+   */
+  bool NextChunk(arma::mat& chunk)
+  {
+    if (position == cols)
+      return false;
+
+    const size_t n = std::min(chunkSize, cols - position);
+    chunk.set_size(rows, n);
+    if (chunk.n_elem > 0)
+    {
+      stream.read(reinterpret_cast<char*>(chunk.memptr()),
+          sizeof(double) * chunk.n_elem);
+      if (!stream)
+        Log::Fatal << "BinaryMatrixChunks::NextChunk(): unexpected end of "
+            << "stream." << std::endl;
+    }
+
+    position += n;
+    return true;
+  }
+
+ private:
+  //! The stream holding the matrix.
+  std::istream& stream;
+  //! The position of the first element in the stream.
+  std::streampos start;
+  //! The number of rows of the matrix.
+  size_t rows;
+  //! The number of columns of the matrix.
+  size_t cols;
+  //! The maximum number of columns in each chunk.
+  size_t chunkSize;
+  //! The index of the first column of the next chunk.
+  size_t position;
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,195 @@
+/**
+ * @file chunked_kmeans.hpp
+ *
+ * An implementation of k-means clustering for datasets that do not fit in
+ * memory, which only looks at one chunk of the dataset at a time.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_CHUNKED_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_CHUNKED_KMEANS_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * Out-of-core k-means clustering.  Instead of taking the dataset as a matrix,
+ * this takes a chunk source (such as BinaryMatrixChunks), which gives the
+ * points one chunk of columns at a time.  Each Lloyd iteration makes one
+ * sequential pass over the chunks: the points of each chunk are assigned to
+ * their closest centroid (in parallel), and the sums and counts of the
+ * points of each cluster are accumulated.  The new centroids are computed
+ * from those sums after the pass, so only one chunk and the centroids need to
+ * be in memory (two, in fact: the next chunk is read while the current one is
+ * processed, with data::Pipeline).  The result is that of the naive Lloyd
+ * iteration on the whole dataset, up to the order in which the sums are added.
+ *
+ * A chunk source must implement the following:
+ *
+ * @code
+ * size_t Rows() const; // Dimensionality of the points.
+ * size_t Cols() const; // Total number of points.
+ * void Reset(); // Go back to the first chunk.
+ * bool NextChunk(arma::mat& chunk); // Get the next chunk; false at the end.
+ * @endcode
+ *
+ * Since the whole dataset is never available, an empty cluster keeps its
+ * centroid from the previous iteration instead of using an EmptyClusterPolicy.
+ *
+ * @code
+ * std::ifstream f("data.bin", std::ios::binary);
+ * BinaryMatrixChunks chunks(f, 100000);
+ *
+ * arma::mat centroids;
+ * ChunkedKMeans<> k;
+ * k.Cluster(chunks, 10, centroids);
+ * @endcode
+ *
+ * @tparam MetricType The distance metric to use for this KMeans; see
+ *     metric::LMetric for an example.
+ */
+template<typename MetricType = metric::EuclideanDistance>
+class ChunkedKMeans
+{
+ public:
+  /**
+   * Create a ChunkedKMeans object.
+   *
+   * @param maxIterations Maximum number of iterations allowed before giving up
+   *     (0 is valid, but the algorithm may never terminate).
+   * @param metric Optional MetricType object; for when the metric has state
+   *     it needs to store.
+   * @param threads Number of threads to use (0 uses all available cores).
+   */
+  ChunkedKMeans(const size_t maxIterations = 1000,
+                const MetricType metric = MetricType(),
+                const size_t threads = 0);
+
+  /**
+   * Find the centroids of the given number of clusters in the points given by
+   * the chunk source.  If initialGuess is false, the initial centroids are
+   * distinct points of the dataset chosen at random, which takes one extra
+   * pass over the chunks.
+   *
+   * @tparam ChunkSourceType Type of the chunk source.
+   * @param source Source of the chunks of the dataset.
+   * @param clusters Number of clusters to compute.
+   * @param centroids Matrix in which centroids are stored.
+   * @param initialGuess If true, then it is assumed that centroids contains the
+   *      initial cluster centroids.
+   */
+  template<typename ChunkSourceType>
+  void Cluster(ChunkSourceType& source,
+               const size_t clusters,
+               arma::mat& centroids,
+               const bool initialGuess = false);
+
+  /**
+   * Assign each point given by the chunk source to its closest centroid, in
+   * one pass over the chunks.
+   *
+   * @tparam ChunkSourceType Type of the chunk source.
+   * @param source Source of the chunks of the dataset.
+   * @param centroids Centroids of the clusters.
+   * @param assignments Vector to store cluster assignments into.
+   */
+  template<typename ChunkSourceType>
+  void Assign(ChunkSourceType& source,
+              const arma::mat& centroids,
+              arma::Col<size_t>& assignments);
+
+  //! Get the maximum number of iterations.
+  size_t MaxIterations() const { return maxIterations; }
+  //! Set the maximum number of iterations.
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get the distance metric.
+  const MetricType& Metric() const { return metric; }
+  //! Modify the distance metric.
+  MetricType& Metric() { return metric; }
+
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+ private:
+  /**
+   * Assign each point of the chunk to its closest centroid, and add it to the
+   * sum and count of that cluster.
+   *
+   * @param chunk Chunk of points.
+   * @param centroids Current centroids.
+   * @param sums Sums of the points of each cluster.
+   * @param counts Number of points of each cluster.
+   * @param assignments If not NULL, the cluster of each point of the chunk is
+   *     stored here.
+   */
+  void Accumulate(const arma::mat& chunk,
+                  const arma::mat& centroids,
+                  arma::mat& sums,
+                  arma::Col<size_t>& counts,
+                  size_t* assignments);
+
+  //! Pipeline stage which reads the next chunk from a chunk source.
+  template<typename ChunkSourceType>
+  class ChunkLoader
+  {
+   public:
+    ChunkLoader(ChunkSourceType& source) : source(source) { }
+
+    bool operator()(arma::mat& chunk) { return source.NextChunk(chunk); }
+
+   private:
+    ChunkSourceType& source;
+  };
+
+  //! Pipeline stage which calls Accumulate() on each chunk, in order.
+  class ChunkAccumulator
+  {
+   public:
+    ChunkAccumulator(ChunkedKMeans& kmeans,
+                     const arma::mat& centroids,
+                     arma::mat& sums,
+                     arma::Col<size_t>& counts,
+                     size_t* assignments) :
+        kmeans(kmeans),
+        centroids(centroids),
+        sums(sums),
+        counts(counts),
+        assignments(assignments),
+        offset(0)
+    { }
+
+    void operator()(arma::mat& chunk, data::NoOutput& /* output */)
+    {
+      kmeans.Accumulate(chunk, centroids, sums, counts,
+          (assignments == NULL) ? NULL : assignments + offset);
+      offset += chunk.n_cols;
+    }
+
+   private:
+    ChunkedKMeans& kmeans;
+    const arma::mat& centroids;
+    arma::mat& sums;
+    arma::Col<size_t>& counts;
+    size_t* assignments;
+    size_t offset;
+  };
+
+  //! Maximum number of iterations before giving up.
+  size_t maxIterations;
+  //! Instantiated distance metric.
+  MetricType metric;
+  //! The number of threads to use.
+  size_t threads;
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "chunked_kmeans_impl.hpp"
+
+#endif
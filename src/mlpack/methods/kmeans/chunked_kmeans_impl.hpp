@@ -0,0 +1,224 @@
+/**
+ * @file chunked_kmeans_impl.hpp
+ *
+ * Implementation of out-of-core k-means clustering.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_CHUNKED_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_CHUNKED_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "chunked_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType>
+ChunkedKMeans<MetricType>::ChunkedKMeans(const size_t maxIterations,
+                                         const MetricType metric,
+                                         const size_t threads) :
+    maxIterations(maxIterations),
+    metric(metric),
+    threads(threads)
+{
+  // Nothing to do.
+}
+
+template<typename MetricType>
+template<typename ChunkSourceType>
+void ChunkedKMeans<MetricType>::Cluster(ChunkSourceType& source,
+                                        const size_t clusters,
+                                        arma::mat& centroids,
+                                        const bool initialGuess)
+{
+  const size_t rows = source.Rows();
+  const size_t cols = source.Cols();
+
+  if (clusters > cols)
+    Log::Fatal << "ChunkedKMeans::Cluster(): more clusters requested than "
+        << "points given." << std::endl;
+  else if (clusters == 0)
+    Log::Fatal << "ChunkedKMeans::Cluster(): zero clusters requested.  This "
+        << "probably isn't going to work.  Giving up." << std::endl;
+
+  arma::mat chunk;
+  if (initialGuess)
+  {
+    if (centroids.n_cols != clusters)
+      Log::Fatal << "ChunkedKMeans::Cluster(): wrong number of initial cluster "
+        << "centroids (" << centroids.n_cols << ", should be " << clusters
+        << ")!" << std::endl;
+
+    if (centroids.n_rows != rows)
+      Log::Fatal << "ChunkedKMeans::Cluster(): initial cluster centroids have "
+        << "wrong dimensionality (" << centroids.n_rows << ", should be "
+        << rows << ")!" << std::endl;
+  }
+  else
+  {
+    // Choose distinct random points, and collect them in one pass.
+    std::vector<size_t> indices;
+    while (indices.size() < clusters)
+    {
+      while (indices.size() < clusters)
+        indices.push_back((size_t) math::RandInt(cols));
+      std::sort(indices.begin(), indices.end());
+      indices.erase(std::unique(indices.begin(), indices.end()),
+          indices.end());
+    }
+
+    centroids.set_size(rows, clusters);
+    size_t next = 0;
+    size_t offset = 0;
+    source.Reset();
+    while (next < clusters && source.NextChunk(chunk))
+    {
+      for (; next < clusters && indices[next] < offset + chunk.n_cols; ++next)
+        centroids.col(next) = chunk.col(indices[next] - offset);
+      offset += chunk.n_cols;
+    }
+  }
+
+  arma::mat sums;
+  arma::Col<size_t> counts;
+  size_t iteration = 0;
+  double cNorm;
+
+  // The next chunk is read while the current one is accumulated.
+  data::Pipeline<arma::mat, data::NoOutput> pipeline;
+  ChunkLoader<ChunkSourceType> loader(source);
+  data::NoOutput writer;
+
+  do
+  {
+    sums.zeros(rows, clusters);
+    counts.zeros(clusters);
+
+    source.Reset();
+    ChunkAccumulator accumulator(*this, centroids, sums, counts, NULL);
+    pipeline.Run(loader, accumulator, writer);
+
+    // Compute the new centroids and how far they moved.  An empty cluster keeps
+    // its old centroid.
+    cNorm = 0.0;
+    for (size_t i = 0; i < clusters; ++i)
+    {
+      if (counts[i] == 0)
+      {
+        Log::Info << "Cluster " << i << " is empty.\n";
+        continue;
+      }
+
+      sums.col(i) /= counts[i];
+      cNorm += std::pow(metric.Evaluate(centroids.col(i), sums.col(i)), 2.0);
+      centroids.col(i) = sums.col(i);
+    }
+    cNorm = std::sqrt(cNorm);
+
+    iteration++;
+    Log::Info << "ChunkedKMeans::Cluster(): iteration " << iteration
+        << ", residual " << cNorm << ".\n";
+
+  } while (cNorm > 1e-5 && iteration != maxIterations);
+
+  if (iteration != maxIterations)
+  {
+    Log::Info << "ChunkedKMeans::Cluster(): converged after " << iteration
+        << " iterations." << std::endl;
+  }
+  else
+  {
+    Log::Info << "ChunkedKMeans::Cluster(): terminated after limit of "
+        << iteration << " iterations." << std::endl;
+  }
+}
+
+template<typename MetricType>
+template<typename ChunkSourceType>
+void ChunkedKMeans<MetricType>::Assign(ChunkSourceType& source,
+                                       const arma::mat& centroids,
+                                       arma::Col<size_t>& assignments)
+{
+  assignments.set_size(source.Cols());
+
+  arma::mat sums;
+  arma::Col<size_t> counts;
+  sums.zeros(centroids.n_rows, centroids.n_cols);
+  counts.zeros(centroids.n_cols);
+
+  source.Reset();
+  data::Pipeline<arma::mat, data::NoOutput> pipeline;
+  ChunkLoader<ChunkSourceType> loader(source);
+  ChunkAccumulator accumulator(*this, centroids, sums, counts,
+      assignments.memptr());
+  data::NoOutput writer;
+  pipeline.Run(loader, accumulator, writer);
+}
+
+template<typename MetricType>
+void ChunkedKMeans<MetricType>::Accumulate(const arma::mat& chunk,
+                                           const arma::mat& centroids,
+                                           arma::mat& sums,
+                                           arma::Col<size_t>& counts,
+                                           size_t* assignments)
+{
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // As in NaiveKMeans, the points are split into contiguous blocks (as many as
+  // util::ReductionBlocks() gives), whose sums are added in the fixed order of
+  // util::TreeReduce() by a util::TreeReducer as the blocks finish, so the
+  // result does not depend on the number of threads.  The sum of the chunk is
+  // then added to the sums of the chunks before it.
+  const size_t blocks = util::ReductionBlocks(chunk.n_cols);
+  std::vector<arma::mat> blockSums(blocks);
+  std::vector<arma::Col<size_t> > blockCounts(blocks);
+  util::TreeReducer<arma::mat> sumReducer(blockSums);
+  util::TreeReducer<arma::Col<size_t> > countReducer(blockCounts);
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+  {
+    arma::mat& blockSum = blockSums[b];
+    arma::Col<size_t>& blockCount = blockCounts[b];
+    blockSum.zeros(centroids.n_rows, centroids.n_cols);
+    blockCount.zeros(centroids.n_cols);
+
+    const size_t begin = b * chunk.n_cols / blocks;
+    const size_t end = (b + 1) * chunk.n_cols / blocks;
+    for (size_t i = begin; i < end; ++i)
+    {
+      double minDistance = std::numeric_limits<double>::infinity();
+      size_t closestCluster = 0;
+      for (size_t j = 0; j < centroids.n_cols; ++j)
+      {
+        const double distance = metric.Evaluate(chunk.col(i),
+            centroids.col(j));
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closestCluster = j;
+        }
+      }
+
+      blockSum.col(closestCluster) += chunk.col(i);
+      blockCount[closestCluster]++;
+      if (assignments != NULL)
+        assignments[i] = closestCluster;
+    }
+
+    sumReducer.Finish(b);
+    countReducer.Finish(b);
+  }
+
+  sums += blockSums[0];
+  counts += blockCounts[0];
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
@@ -54,11 +54,23 @@ class DTNNKMeans
                  arma::mat& newCentroids,
                  arma::Col<size_t>& counts);
 
+  /**
+   * Prepare for a new k-means run on the same dataset.  The tree is kept, but
+   * the bounds stored in it, which only hold for the centroids of the current
+   * run, are cleared.
+   */
+  void Reset();
+
   //! Return the number of distance calculations.
   size_t DistanceCalculations() const { return distanceCalculations; }
   //! Modify the number of distance calculations.
   size_t& DistanceCalculations() { return distanceCalculations; }
 
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
  private:
   //! The original dataset reference.
   const MatType& datasetOrig; // Maybe not necessary.
@@ -75,8 +87,14 @@ class DTNNKMeans
   //! Track distance calculations.
   size_t distanceCalculations;
 
+  //! The number of threads to use.
+  size_t threads;
+
   //! Update the bounds in the tree before the next iteration.
   void UpdateTree(TreeType& node, const double tolerance);
+
+  //! Clear the bounds in the tree.
+  void ResetTree(TreeType& node);
 };
 
 //! A template typedef for the DTNNKMeans algorithm with the default tree type
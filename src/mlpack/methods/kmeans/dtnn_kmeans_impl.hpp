@@ -49,7 +49,8 @@ DTNNKMeans<MetricType, MatType, TreeType>::DTNNKMeans(const MatType& dataset,
     dataset(tree::TreeTraits<TreeType>::RearrangesDataset ? datasetCopy :
         datasetOrig),
     metric(metric),
-    distanceCalculations(0)
+    distanceCalculations(0),
+    threads(0)
 {
   Timer::Start("tree_building");
 
@@ -88,6 +89,7 @@ double DTNNKMeans<MetricType, MatType, TreeType>::Iterate(
   typedef neighbor::NeighborSearch<neighbor::NearestNeighborSort, MetricType,
       TreeType> AllkNNType;
   AllkNNType allknn(centroidTree, tree, centroids, dataset, false, metric);
+  allknn.Threads() = threads;
 
   // This is a lot of overhead.  We don't need the distances.
   arma::mat distances;
@@ -95,21 +97,49 @@ double DTNNKMeans<MetricType, MatType, TreeType>::Iterate(
   allknn.Search(1, assignments, distances);
   distanceCalculations += allknn.BaseCases() + allknn.Scores();
 
-  // From the assignments, calculate the new centroids and counts.
-  for (size_t i = 0; i < dataset.n_cols; ++i)
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // From the assignments, calculate the new centroids and counts.  The points
+  // are split into contiguous blocks (as many as util::ReductionBlocks()
+  // gives), whose sums are added in the fixed order of util::TreeReduce() by a
+  // util::TreeReducer as the blocks finish, so the result does not depend on
+  // the number of threads.
+  const size_t blocks = util::ReductionBlocks(dataset.n_cols);
+  std::vector<arma::mat> blockCentroids(blocks);
+  std::vector<arma::Col<size_t> > blockCounts(blocks);
+  util::TreeReducer<arma::mat> centroidReducer(blockCentroids);
+  util::TreeReducer<arma::Col<size_t> > countReducer(blockCounts);
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
   {
-    if (tree::TreeTraits<TreeType>::RearrangesDataset)
-    {
-      newCentroids.col(oldFromNewCentroids[assignments[i]]) += dataset.col(i);
-      ++counts(oldFromNewCentroids[assignments[i]]);
-    }
-    else
+    arma::mat& sums = blockCentroids[b];
+    arma::Col<size_t>& sizes = blockCounts[b];
+    sums.zeros(centroids.n_rows, centroids.n_cols);
+    sizes.zeros(centroids.n_cols);
+
+    const size_t begin = b * dataset.n_cols / blocks;
+    const size_t end = (b + 1) * dataset.n_cols / blocks;
+    for (size_t i = begin; i < end; ++i)
     {
-      newCentroids.col(assignments[i]) += dataset.col(i);
-      ++counts(assignments[i]);
+      const size_t cluster = (tree::TreeTraits<TreeType>::RearrangesDataset) ?
+          oldFromNewCentroids[assignments[i]] : assignments[i];
+      sums.col(cluster) += dataset.col(i);
+      ++sizes(cluster);
     }
+
+    centroidReducer.Finish(b);
+    countReducer.Finish(b);
   }
 
+  newCentroids.swap(blockCentroids[0]);
+  counts.swap(blockCounts[0]);
+
   // Now, calculate how far the clusters moved, after normalizing them.
   double residual = 0.0;
   double maxMovement = 0.0;
@@ -142,6 +172,13 @@ double DTNNKMeans<MetricType, MatType, TreeType>::Iterate(
   return std::sqrt(residual);
 }
 
+template<typename MetricType, typename MatType, typename TreeType>
+void DTNNKMeans<MetricType, MatType, TreeType>::Reset()
+{
+  ResetTree(*tree);
+  distanceCalculations = 0;
+}
+
 template<typename MetricType, typename MatType, typename TreeType>
 void DTNNKMeans<MetricType, MatType, TreeType>::UpdateTree(
     TreeType& node,
@@ -158,6 +195,18 @@ void DTNNKMeans<MetricType, MatType, TreeType>::UpdateTree(
     UpdateTree(node.Child(i), tolerance);
 }
 
+template<typename MetricType, typename MatType, typename TreeType>
+void DTNNKMeans<MetricType, MatType, TreeType>::ResetTree(TreeType& node)
+{
+  node.Stat().FirstBound() = DBL_MAX;
+  node.Stat().SecondBound() = DBL_MAX;
+  node.Stat().Bound() = DBL_MAX;
+  node.Stat().LastDistanceNode() = NULL;
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+    ResetTree(node.Child(i));
+}
+
 } // namespace kmeans
 } // namespace mlpack
 
@@ -29,11 +29,23 @@ class DualTreeKMeans
                  arma::mat& newCentroids,
                  arma::Col<size_t>& counts);
 
+  /**
+   * Prepare for a new k-means run on the same dataset.  The tree is kept, but
+   * everything that is remembered from earlier iterations (in the tree and for
+   * each point) is cleared.
+   */
+  void Reset();
+
   //! Return the number of distance calculations.
   size_t DistanceCalculations() const { return distanceCalculations; }
   //! Modify the number of distance calculations.
   size_t& DistanceCalculations() { return distanceCalculations; }
 
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
  private:
   //! The original dataset reference.
   const MatType& datasetOrig;
@@ -57,6 +69,37 @@ class DualTreeKMeans
 
   //! Track distance calculations.
   size_t distanceCalculations;
+
+  //! The number of threads to use.
+  size_t threads;
+
+  //! Clear the pruning information stored in the tree.
+  void ResetTree(TreeType& node);
+
+  /**
+   * Run the dual-tree traversal in parallel.  The tree on the points is split
+   * near its root into disjoint subtrees, and each of those is traversed
+   * against the whole centroid tree as an independent task.  All the state the
+   * rules keep for the points and for the nodes is owned by the subtree that
+   * holds them, so the only thing the tasks share is the new centroids and
+   * counts; each thread sums into its own copies, which are added together at
+   * the end.
+   *
+   * @param centroidTree Tree built on the centroids.
+   * @param centroids Current cluster centroids.
+   * @param newCentroids New cluster centroids (sums, not yet normalized).
+   * @param counts Counts of the new clusters.
+   * @param oldFromNewCentroids Mappings of the centroid tree.
+   * @param visited Number of base cases for each point (already zeroed).
+   * @param numThreads Number of threads to use.
+   */
+  void ParallelTraverse(TreeType& centroidTree,
+                        const arma::mat& centroids,
+                        arma::mat& newCentroids,
+                        arma::Col<size_t>& counts,
+                        const std::vector<size_t>& oldFromNewCentroids,
+                        arma::Col<size_t>& visited,
+                        const size_t numThreads);
 };
 
 template<typename MetricType, typename MatType>
@@ -23,7 +23,8 @@ DualTreeKMeans<MetricType, MatType, TreeType>::DualTreeKMeans(
         datasetOrig),
     metric(metric),
     iteration(0),
-    distanceCalculations(0)
+    distanceCalculations(0),
+    threads(0)
 {
   distances.set_size(dataset.n_cols);
   distances.fill(DBL_MAX);
@@ -68,20 +69,41 @@ double DualTreeKMeans<MetricType, MatType, TreeType>::Iterate(
   TreeType* centroidTree = BuildTree<TreeType>(
       const_cast<typename TreeType::Mat&>(centroids), oldFromNewCentroids);
 
-  // Now run the dual-tree algorithm.
-  typedef DualTreeKMeansRules<MetricType, TreeType> RulesType;
-  RulesType rules(dataset, centroids, newCentroids, counts, oldFromNewCentroids,
-      iteration, clusterDistances, distances, assignments, distanceIteration,
-      metric);
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Nothing has been visited yet.
+  arma::Col<size_t> visited;
+  visited.zeros(dataset.n_cols);
+
+  // Now run the dual-tree algorithm.  Trees whose nodes share points with their
+  // children can't be split into disjoint subtrees, so they are always
+  // traversed serially.
+  if (numThreads > 1 && !tree::TreeTraits<TreeType>::HasSelfChildren)
+  {
+    ParallelTraverse(*centroidTree, centroids, newCentroids, counts,
+        oldFromNewCentroids, visited, numThreads);
+  }
+  else
+  {
+    typedef DualTreeKMeansRules<MetricType, TreeType> RulesType;
+    RulesType rules(dataset, centroids, newCentroids, counts,
+        oldFromNewCentroids, iteration, clusterDistances, distances,
+        assignments, visited, distanceIteration, metric);
 
-  // Use the dual-tree traverser.
-//typename TreeType::template DualTreeTraverser<RulesType> traverser(rules);
-  typename TreeType::template BreadthFirstDualTreeTraverser<RulesType>
-      traverser(rules);
+    // Use the dual-tree traverser.
+//  typename TreeType::template DualTreeTraverser<RulesType> traverser(rules);
+    typename TreeType::template BreadthFirstDualTreeTraverser<RulesType>
+        traverser(rules);
 
-  traverser.Traverse(*centroidTree, *tree);
+    traverser.Traverse(*centroidTree, *tree);
 
-  distanceCalculations += rules.DistanceCalculations();
+    distanceCalculations += rules.DistanceCalculations();
+  }
 
   // Now, calculate how far the clusters moved, after normalizing them.
   double residual = 0.0;
@@ -112,6 +134,119 @@ double DualTreeKMeans<MetricType, MatType, TreeType>::Iterate(
   return std::sqrt(residual);
 }
 
+template<typename MetricType, typename MatType, typename TreeType>
+void DualTreeKMeans<MetricType, MatType, TreeType>::Reset()
+{
+  distances.fill(DBL_MAX);
+  assignments.zeros();
+  distanceIteration.zeros();
+  clusterDistances.reset();
+  iteration = 0;
+  distanceCalculations = 0;
+
+  ResetTree(*tree);
+}
+
+template<typename MetricType, typename MatType, typename TreeType>
+void DualTreeKMeans<MetricType, MatType, TreeType>::ResetTree(TreeType& node)
+{
+  node.Stat().ClosestQueryNode() = NULL;
+  node.Stat().MinQueryNodeDistance() = DBL_MAX;
+  node.Stat().MaxQueryNodeDistance() = DBL_MAX;
+  node.Stat().ClustersPruned() = 0;
+  node.Stat().Iteration() = size_t() - 1;
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+    ResetTree(node.Child(i));
+}
+
+template<typename MetricType, typename MatType, typename TreeType>
+void DualTreeKMeans<MetricType, MatType, TreeType>::ParallelTraverse(
+    TreeType& centroidTree,
+    const arma::mat& centroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& counts,
+    const std::vector<size_t>& oldFromNewCentroids,
+    arma::Col<size_t>& visited,
+    const size_t numThreads)
+{
+  typedef DualTreeKMeansRules<MetricType, TreeType> RulesType;
+
+  // Expand the top of the tree breadth-first until we have enough tasks that
+  // the dynamic schedule can balance subtrees of uneven size.  A node is only
+  // expanded if none of its children are leaves, because the rules need a
+  // reference node to be scored before its base cases, and the root of a task
+  // is never scored.
+  const size_t minTasks = 8 * numThreads;
+  std::vector<TreeType*> tasks;
+  tasks.push_back(tree);
+  bool expanded = true;
+  while (expanded && (tasks.size() < minTasks))
+  {
+    expanded = false;
+    std::vector<TreeType*> nextTasks;
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+      bool expandable = !tasks[i]->IsLeaf();
+      for (size_t c = 0; expandable && c < tasks[i]->NumChildren(); ++c)
+        if (tasks[i]->Child(c).IsLeaf())
+          expandable = false;
+
+      if (!expandable)
+      {
+        nextTasks.push_back(tasks[i]);
+        continue;
+      }
+
+      for (size_t c = 0; c < tasks[i]->NumChildren(); ++c)
+        nextTasks.push_back(&tasks[i]->Child(c));
+      expanded = true;
+    }
+
+    tasks.swap(nextTasks);
+  }
+
+  // The children of the root of each task inherit its pruning state, so the
+  // root of each task must look just like the root of the whole tree, which is
+  // never scored: nothing pruned and no closest centroid node.
+  for (size_t i = 0; i < tasks.size(); ++i)
+  {
+    tasks[i]->Stat().ClustersPruned() = 0;
+    tasks[i]->Stat().ClosestQueryNode() = NULL;
+  }
+
+  size_t calculations = 0;
+  #pragma omp parallel num_threads(numThreads) reduction(+:calculations)
+  {
+    arma::mat threadCentroids;
+    threadCentroids.zeros(centroids.n_rows, centroids.n_cols);
+    arma::Col<size_t> threadCounts;
+    threadCounts.zeros(centroids.n_cols);
+
+    #pragma omp for schedule(dynamic)
+    for (omp_size_t i = 0; i < (omp_size_t) tasks.size(); ++i)
+    {
+      RulesType rules(dataset, centroids, threadCentroids, threadCounts,
+          oldFromNewCentroids, iteration, clusterDistances, distances,
+          assignments, visited, distanceIteration, metric);
+      typename TreeType::template BreadthFirstDualTreeTraverser<RulesType>
+          traverser(rules);
+
+      traverser.Traverse(centroidTree, *tasks[i]);
+
+      calculations += rules.DistanceCalculations();
+    }
+
+    #pragma omp critical(dual_tree_kmeans_reduce)
+    {
+      newCentroids += threadCentroids;
+      counts += threadCounts;
+    }
+  }
+
+  distanceCalculations += calculations;
+}
+
 } // namespace kmeans
 } // namespace mlpack
 
@@ -23,6 +23,7 @@ class DualTreeKMeansRules
                       const arma::vec& clusterDistances,
                       arma::vec& distances,
                       arma::Col<size_t>& assignments,
+                      arma::Col<size_t>& visited,
                       arma::Col<size_t>& distanceIteration,
                       MetricType& metric);
 
@@ -58,7 +59,7 @@ class DualTreeKMeansRules
   const arma::vec& clusterDistances;
   arma::vec& distances;
   arma::Col<size_t>& assignments;
-  arma::Col<size_t> visited;
+  arma::Col<size_t>& visited;
   arma::Col<size_t>& distanceIteration;
   MetricType& metric;
 
@@ -24,6 +24,7 @@ DualTreeKMeansRules<MetricType, TreeType>::DualTreeKMeansRules(
     const arma::vec& clusterDistances,
     arma::vec& distances,
     arma::Col<size_t>& assignments,
+    arma::Col<size_t>& visited,
     arma::Col<size_t>& distanceIteration,
     MetricType& metric) :
     dataset(dataset),
@@ -35,12 +36,12 @@ DualTreeKMeansRules<MetricType, TreeType>::DualTreeKMeansRules(
     clusterDistances(clusterDistances),
     distances(distances),
     assignments(assignments),
+    visited(visited),
     distanceIteration(distanceIteration),
     metric(metric),
     distanceCalculations(0)
 {
-  // Nothing has been visited yet.
-  visited.zeros(dataset.n_cols);
+  // Nothing to do; 'visited' is zeroed by the caller.
 }
 
 template<typename MetricType, typename TreeType>
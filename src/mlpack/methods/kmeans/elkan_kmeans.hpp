@@ -33,6 +33,11 @@ class ElkanKMeans
 
   size_t DistanceCalculations() const { return distanceCalculations; }
 
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
  private:
   //! The dataset.
   const MatType& dataset;
@@ -51,9 +56,13 @@ class ElkanKMeans
   arma::vec upperBounds;
   //! Lower bounds on the distance between each point and each cluster.
   arma::mat lowerBounds;
+  //! The centroids returned by the last iteration.
+  arma::mat lastCentroids;
 
   //! Track distance calculations.
   size_t distanceCalculations;
+  //! The number of threads to use.
+  size_t threads;
 };
 
 } // namespace kmeans
@@ -34,6 +34,11 @@ class HamerlyKMeans
 
   size_t DistanceCalculations() const { return distanceCalculations; }
 
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
  private:
   //! The dataset.
   const MatType& dataset;
@@ -49,9 +54,13 @@ class HamerlyKMeans
   arma::vec lowerBounds;
   //! Assignments for each point.
   arma::Col<size_t> assignments;
+  //! The centroids returned by the last iteration.
+  arma::mat lastCentroids;
 
   //! Track distance calculations.
   size_t distanceCalculations;
+  //! The number of threads to use.
+  size_t threads;
 };
 
 } // namespace kmeans
@@ -18,7 +18,8 @@ HamerlyKMeans<MetricType, MatType>::HamerlyKMeans(const MatType& dataset,
                                                   MetricType& metric) :
     dataset(dataset),
     metric(metric),
-    distanceCalculations(0)
+    distanceCalculations(0),
+    threads(0)
 {
   // Nothing to do.
 }
@@ -37,6 +38,26 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     assignments.zeros(dataset.n_cols);
     minClusterDistances.set_size(centroids.n_cols);
   }
+  else if (arma::any(arma::vectorise(centroids != lastCentroids)))
+  {
+    // The centroids were changed since the last iteration (by an empty cluster
+    // policy, or by distributed k-means), so the bounds must also account for
+    // how far they were moved.
+    arma::vec changes(centroids.n_cols);
+    double furthestChange = 0.0;
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+    {
+      changes(c) = metric.Evaluate(lastCentroids.col(c), centroids.col(c));
+      furthestChange = std::max(furthestChange, changes(c));
+    }
+    distanceCalculations += centroids.n_cols;
+
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      upperBounds(i) += changes(assignments[i]);
+      lowerBounds(i) -= furthestChange;
+    }
+  }
 
   // Reset new centroids.
   newCentroids.zeros(centroids.n_rows, centroids.n_cols);
@@ -60,64 +81,103 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     }
   }
 
-  for (size_t i = 0; i < dataset.n_cols; ++i)
+  // The points are split into contiguous blocks (as many as
+  // util::ReductionBlocks() gives), each of which sums into its own copies of
+  // the centroids and counts; these are added in the fixed order of
+  // util::TreeReduce() by a util::TreeReducer as the blocks finish, so the
+  // result does not depend on the number of threads, and only a few copies are
+  // held at once.  The bounds of each point are only touched by the block
+  // holding that point.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+  const size_t blocks = util::ReductionBlocks(dataset.n_cols);
+  std::vector<arma::mat> blockCentroids(blocks);
+  std::vector<arma::Col<size_t> > blockCounts(blocks);
+  util::TreeReducer<arma::mat> centroidReducer(blockCentroids);
+  util::TreeReducer<arma::Col<size_t> > countReducer(blockCounts);
+  size_t calculations = 0;
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic) \
+      reduction(+:calculations)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
   {
-    const double m = std::max(minClusterDistances(assignments[i]),
-                              lowerBounds(i));
-
-    // First bound test.
-    if (upperBounds(i) <= m)
+    arma::mat& sums = blockCentroids[b];
+    arma::Col<size_t>& sizes = blockCounts[b];
+    sums.zeros(centroids.n_rows, centroids.n_cols);
+    sizes.zeros(centroids.n_cols);
+
+    const size_t begin = b * dataset.n_cols / blocks;
+    const size_t end = (b + 1) * dataset.n_cols / blocks;
+    for (size_t i = begin; i < end; ++i)
     {
-      newCentroids.col(assignments[i]) += dataset.col(i);
-      ++counts(assignments[i]);
-      continue;
-    }
-
-    // Tighten upper bound.
-    upperBounds(i) = metric.Evaluate(dataset.col(i),
-                                     centroids.col(assignments[i]));
-    ++distanceCalculations;
+      const double m = std::max(minClusterDistances(assignments[i]),
+                                lowerBounds(i));
 
-    // Second bound test.
-    if (upperBounds(i) <= m)
-    {
-      newCentroids.col(assignments[i]) += dataset.col(i);
-      ++counts(assignments[i]);
-      continue;
-    }
-
-    // The bounds failed.  So test against all other clusters.
-    // This is Hamerly's Point-All-Ctrs() function from the paper.
-    // We have to reset the lower bound first.
-    lowerBounds(i) = DBL_MAX;
-    for (size_t c = 0; c < centroids.n_cols; ++c)
-    {
-      if (c == assignments[i])
+      // First bound test.
+      if (upperBounds(i) <= m)
+      {
+        sums.col(assignments[i]) += dataset.col(i);
+        ++sizes(assignments[i]);
         continue;
+      }
 
-      const double dist = metric.Evaluate(dataset.col(i), centroids.col(c));
+      // Tighten upper bound.
+      upperBounds(i) = metric.Evaluate(dataset.col(i),
+                                       centroids.col(assignments[i]));
+      ++calculations;
 
-      // Is this a better cluster?  At this point, upperBounds[i] = d(i, c(i)).
-      if (dist < upperBounds(i))
+      // Second bound test.
+      if (upperBounds(i) <= m)
       {
-        // lowerBounds holds the second closest cluster.
-        lowerBounds(i) = upperBounds(i);
-        upperBounds(i) = dist;
-        assignments[i] = c;
+        sums.col(assignments[i]) += dataset.col(i);
+        ++sizes(assignments[i]);
+        continue;
       }
-      else if (dist < lowerBounds(i))
+
+      // The bounds failed.  So test against all other clusters.
+      // This is Hamerly's Point-All-Ctrs() function from the paper.
+      // We have to reset the lower bound first.
+      lowerBounds(i) = DBL_MAX;
+      for (size_t c = 0; c < centroids.n_cols; ++c)
       {
-        // This is a closer second-closest cluster.
-        lowerBounds(i) = dist;
+        if (c == assignments[i])
+          continue;
+
+        const double dist = metric.Evaluate(dataset.col(i), centroids.col(c));
+
+        // Is this a better cluster?  At this point,
+        // upperBounds[i] = d(i, c(i)).
+        if (dist < upperBounds(i))
+        {
+          // lowerBounds holds the second closest cluster.
+          lowerBounds(i) = upperBounds(i);
+          upperBounds(i) = dist;
+          assignments[i] = c;
+        }
+        else if (dist < lowerBounds(i))
+        {
+          // This is a closer second-closest cluster.
+          lowerBounds(i) = dist;
+        }
       }
+      calculations += centroids.n_cols - 1;
+
+      // Update new centroids.
+      sums.col(assignments[i]) += dataset.col(i);
+      ++sizes(assignments[i]);
     }
-    distanceCalculations += centroids.n_cols - 1;
 
-    // Update new centroids.
-    newCentroids.col(assignments[i]) += dataset.col(i);
-    ++counts(assignments[i]);
+    centroidReducer.Finish(b);
+    countReducer.Finish(b);
   }
 
+  newCentroids.swap(blockCentroids[0]);
+  counts.swap(blockCounts[0]);
+  distanceCalculations += calculations;
+
   // Normalize centroids and calculate cluster movement (contains parts of
   // Move-Centers() and Update-Bounds()).
   double furthestMovement = 0.0;
@@ -152,7 +212,8 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
   }
 
   // Now update bounds (lines 3-8 of Update-Bounds()).
-  for (size_t i = 0; i < dataset.n_cols; ++i)
+  #pragma omp parallel for num_threads(numThreads)
+  for (omp_size_t i = 0; i < (omp_size_t) dataset.n_cols; ++i)
   {
     upperBounds(i) += centroidMovements(assignments[i]);
     if (assignments[i] == furthestMovingCluster)
@@ -161,6 +222,8 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
       lowerBounds(i) -= furthestMovement;
   }
 
+  lastCentroids = newCentroids;
+
   return std::sqrt(centroidMovement);
 }
 
@@ -13,6 +13,7 @@
 #include "random_partition.hpp"
 #include "max_variance_new_cluster.hpp"
 #include "naive_kmeans.hpp"
+#include "local_communicator.hpp"
 
 #include <mlpack/core/tree/binary_space_tree.hpp>
 
@@ -50,18 +51,41 @@ namespace kmeans /** K-Means clustering. */ {
  *     default constructor and 'void Cluster(const arma::mat&, const size_t,
  *     arma::Col<size_t>&)'.
  * @tparam EmptyClusterPolicy Policy for what to do on an empty cluster; must
- *     implement a default constructor and 'void EmptyCluster(const arma::mat&,
- *     arma::Col<size_t&)'.
- * @tparam LloydStepType Implementation of single Lloyd step to use.
+ *     implement a default constructor and 'size_t EmptyCluster(const MatType&,
+ *     const size_t, arma::mat&, arma::Col<size_t>&, MetricType&)'.
+ * @tparam LloydStepType Implementation of single Lloyd step to use.  If it has
+ *     a 'void Assign(const arma::mat&, arma::Col<size_t>&)' method (as
+ *     SparseKMeans does), that is also used to find the final assignments of
+ *     the points.
+ * @tparam MatType Type of matrix (arma::mat or arma::sp_mat).
+ * @tparam CommunicatorType Communicator used when the dataset is split over
+ *     several processes; see LocalCommunicator (the default, for one process)
+ *     and MPICommunicator.
+ *
+ * If the communicator has more than one process, each process gives its own
+ * points to Cluster().  Each process runs the Lloyd step on its own points,
+ * and after every step the sums and counts of the clusters are summed over all
+ * of the processes, so every process gets the same new centroids: the ones
+ * that the Lloyd step would give on the whole dataset.  The initial partition
+ * is found on each process's own points and combined the same way; initial
+ * centroids given by the caller must be the same on every process.  Empty
+ * clusters are handled by the EmptyClusterPolicy of process 0 (on its own
+ * points), and the result is broadcast.  Lloyd step types with a Reset() method
+ * (the tree-based ones) keep pruning information which does not hold after the
+ * centroids are combined, so they are reset after each step; ElkanKMeans and
+ * HamerlyKMeans adjust their bounds instead.  Every process must call
+ * Cluster() with the same number of clusters and the same options.
  *
  * @see RandomPartition, RefinedStart, AllowEmptyClusters,
- *      MaxVarianceNewCluster, NaiveKMeans, ElkanKMeans
+ *      MaxVarianceNewCluster, NaiveKMeans, ElkanKMeans, SparseKMeans,
+ *      YinyangKMeans
  */
 template<typename MetricType = metric::EuclideanDistance,
          typename InitialPartitionPolicy = RandomPartition,
          typename EmptyClusterPolicy = MaxVarianceNewCluster,
          template<class, class> class LloydStepType = NaiveKMeans,
-         typename MatType = arma::mat>
+         typename MatType = arma::mat,
+         typename CommunicatorType = LocalCommunicator>
 class KMeans
 {
  public:
@@ -77,11 +101,35 @@ class KMeans
    *     specially initialized partitioning policy is required.
    * @param emptyClusterAction Optional EmptyClusterPolicy object; for when a
    *     specially initialized empty cluster policy is required.
+   * @param threads Number of threads to use for each Lloyd iteration (0 uses
+   *     all available cores).  This is only used by Lloyd step types that have
+   *     a Threads() method (all of the ones in mlpack except
+   *     PellegMooreKMeans).
+   * @param communicator Optional CommunicatorType object; for when the dataset
+   *     is split over several processes.
    */
   KMeans(const size_t maxIterations = 1000,
          const MetricType metric = MetricType(),
          const InitialPartitionPolicy partitioner = InitialPartitionPolicy(),
-         const EmptyClusterPolicy emptyClusterAction = EmptyClusterPolicy());
+         const EmptyClusterPolicy emptyClusterAction = EmptyClusterPolicy(),
+         const size_t threads = 0,
+         const CommunicatorType communicator = CommunicatorType());
+
+  /**
+   * Copy the given K-Means object.  The cached Lloyd step (see
+   * CacheLloydStep()) is not copied.
+   */
+  KMeans(const KMeans& other);
+
+  /**
+   * Copy the given K-Means object.  The cached Lloyd step (see
+   * CacheLloydStep()) is not copied, and any cached Lloyd step of this object
+   * is released.
+   */
+  KMeans& operator=(const KMeans& other);
+
+  //! Release the cached Lloyd step, if there is one.
+  ~KMeans();
 
 
   /**
@@ -168,6 +216,50 @@ class KMeans
   //! Modify the empty cluster policy.
   EmptyClusterPolicy& EmptyClusterAction() { return emptyClusterAction; }
 
+  //! Get the communicator.
+  const CommunicatorType& Communicator() const { return communicator; }
+  //! Modify the communicator.
+  CommunicatorType& Communicator() { return communicator; }
+
+  //! Get the number of threads used for each Lloyd iteration.
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for each Lloyd iteration.
+  size_t& Threads() { return threads; }
+
+  //! Get whether the Lloyd iterations offload their distance computations.
+  bool Offload() const { return offload; }
+  //! Modify whether the Lloyd iterations offload their distance computations.
+  //! This is only used by Lloyd step types that have an Offload() method (in
+  //! mlpack, NaiveKMeans; see NaiveKMeans::Offload()).
+  bool& Offload() { return offload; }
+
+  //! Get the number of groups of centroids kept by the Lloyd iterations (0
+  //! means the default of the step type).
+  size_t Groups() const { return groups; }
+  //! Modify the number of groups of centroids kept by the Lloyd iterations.
+  //! This is only used by Lloyd step types that have a Groups() method (in
+  //! mlpack, YinyangKMeans; see YinyangKMeans::Groups()).
+  size_t& Groups() { return groups; }
+
+  /**
+   * Get whether the Lloyd step object is kept between calls to Cluster().
+   * The tree-based step types (PellegMooreKMeans, DTNNKMeans and
+   * DualTreeKMeans) build a tree on the dataset when they are created, so if
+   * Cluster() is called many times on the same dataset (for instance with
+   * different numbers of clusters), keeping the step object means the tree is
+   * only built once.  Only step types with a Reset() method are kept.  The
+   * step object is reused when Cluster() is given the same matrix object as
+   * the last time, so if this is enabled, the contents of that matrix must
+   * not be changed between calls; call ClearCache() if they are.  By default
+   * this is disabled.
+   */
+  bool CacheLloydStep() const { return cacheLloydStep; }
+  //! Modify whether the Lloyd step object is kept between calls to Cluster().
+  bool& CacheLloydStep() { return cacheLloydStep; }
+
+  //! Release the cached Lloyd step, if there is one.
+  void ClearCache();
+
   // Returns a string representation of this object.
   std::string ToString() const;
 
@@ -180,6 +272,38 @@ class KMeans
   InitialPartitionPolicy partitioner;
   //! Instantiated empty cluster policy.
   EmptyClusterPolicy emptyClusterAction;
+  //! Number of threads used for each Lloyd iteration (0 means all cores).
+  size_t threads;
+  //! Whether the Lloyd iterations offload their distance computations.
+  bool offload;
+  //! The number of groups of centroids kept by the Lloyd iterations.
+  size_t groups;
+  //! Instantiated communicator.
+  CommunicatorType communicator;
+  //! Whether to keep the Lloyd step object between calls to Cluster().
+  bool cacheLloydStep;
+  //! The Lloyd step object kept from the last call to Cluster(), if any.
+  LloydStepType<MetricType, MatType>* cachedLloydStep;
+  //! The dataset the cached Lloyd step object was created with.
+  const MatType* cachedData;
+  //! The number of rows of the dataset when the step object was cached.
+  size_t cachedRows;
+  //! The number of columns of the dataset when the step object was cached.
+  size_t cachedCols;
+
+  /**
+   * Combine the centroids and counts of this process with those of the other
+   * processes, so that each centroid becomes the mean of the points of its
+   * cluster over all of the processes, and each count the total.  Clusters
+   * that are empty on every process are filled with DBL_MAX, as the Lloyd
+   * steps do.  This does nothing if there is only one process.
+   *
+   * @param centroids Centroids of this process's points (any value for empty
+   *     clusters); overwritten with the combined centroids.
+   * @param counts Counts of this process's points; overwritten with the
+   *     combined counts.
+   */
+  void CombineCentroids(arma::mat& centroids, arma::Col<size_t>& counts);
 };
 
 }; // namespace kmeans
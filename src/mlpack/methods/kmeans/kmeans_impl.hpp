@@ -9,10 +9,121 @@
 
 #include <mlpack/core/tree/mrkd_statistic.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
+#include <mlpack/core/util/sfinae_utility.hpp>
 
 namespace mlpack {
 namespace kmeans {
 
+HAS_MEM_FUNC(Threads, HasThreads);
+
+//! Set the number of threads of a Lloyd step type that supports threading.
+template<typename LloydStepType>
+inline typename boost::enable_if_c<HasThreads<LloydStepType,
+    size_t& (LloydStepType::*)()>::value>::type
+SetLloydStepThreads(LloydStepType& lloydStep, const size_t threads)
+{
+  lloydStep.Threads() = threads;
+}
+
+//! Lloyd step types without a Threads() method run as they always do.
+template<typename LloydStepType>
+inline typename boost::disable_if_c<HasThreads<LloydStepType,
+    size_t& (LloydStepType::*)()>::value>::type
+SetLloydStepThreads(LloydStepType& /* lloydStep */, const size_t /* threads */)
+{ }
+
+HAS_MEM_FUNC(Offload, HasOffload);
+
+//! Set whether a Lloyd step type that supports it offloads its distance
+//! computations.
+template<typename LloydStepType>
+inline typename boost::enable_if_c<HasOffload<LloydStepType,
+    bool& (LloydStepType::*)()>::value>::type
+SetLloydStepOffload(LloydStepType& lloydStep, const bool offload)
+{
+  lloydStep.Offload() = offload;
+}
+
+//! Lloyd step types without an Offload() method run as they always do.
+template<typename LloydStepType>
+inline typename boost::disable_if_c<HasOffload<LloydStepType,
+    bool& (LloydStepType::*)()>::value>::type
+SetLloydStepOffload(LloydStepType& /* lloydStep */, const bool /* offload */)
+{ }
+
+HAS_MEM_FUNC(Groups, HasGroups);
+
+//! Set the number of groups of centroids of a Lloyd step type that groups them.
+template<typename LloydStepType>
+inline typename boost::enable_if_c<HasGroups<LloydStepType,
+    size_t& (LloydStepType::*)()>::value>::type
+SetLloydStepGroups(LloydStepType& lloydStep, const size_t groups)
+{
+  lloydStep.Groups() = groups;
+}
+
+//! Lloyd step types without a Groups() method run as they always do.
+template<typename LloydStepType>
+inline typename boost::disable_if_c<HasGroups<LloydStepType,
+    size_t& (LloydStepType::*)()>::value>::type
+SetLloydStepGroups(LloydStepType& /* lloydStep */, const size_t /* groups */)
+{ }
+
+HAS_MEM_FUNC(Reset, HasReset);
+
+//! Reset a Lloyd step type that supports it, so it can be used for a new run.
+template<typename LloydStepType>
+inline typename boost::enable_if_c<HasReset<LloydStepType,
+    void (LloydStepType::*)()>::value, bool>::type
+ResetLloydStep(LloydStepType& lloydStep)
+{
+  lloydStep.Reset();
+  return true;
+}
+
+//! Lloyd step types without a Reset() method can't be used for a new run.
+template<typename LloydStepType>
+inline typename boost::disable_if_c<HasReset<LloydStepType,
+    void (LloydStepType::*)()>::value, bool>::type
+ResetLloydStep(LloydStepType& /* lloydStep */)
+{
+  return false;
+}
+
+HAS_MEM_FUNC(Assign, HasAssign);
+
+//! Find the final assignments of the points with a Lloyd step type that can do
+//! it faster than the metric can (such as SparseKMeans).
+template<typename LloydStepType, typename MatType, typename MetricType>
+inline typename boost::enable_if_c<HasAssign<LloydStepType,
+    void (LloydStepType::*)(const arma::mat&, arma::Col<size_t>&)>::value,
+    bool>::type
+LloydStepAssign(const MatType& data,
+                MetricType& metric,
+                const size_t threads,
+                const arma::mat& centroids,
+                arma::Col<size_t>& assignments)
+{
+  LloydStepType lloydStep(data, metric);
+  SetLloydStepThreads(lloydStep, threads);
+  lloydStep.Assign(centroids, assignments);
+  return true;
+}
+
+//! Other Lloyd step types leave the final assignments to the metric.
+template<typename LloydStepType, typename MatType, typename MetricType>
+inline typename boost::disable_if_c<HasAssign<LloydStepType,
+    void (LloydStepType::*)(const arma::mat&, arma::Col<size_t>&)>::value,
+    bool>::type
+LloydStepAssign(const MatType& /* data */,
+                MetricType& /* metric */,
+                const size_t /* threads */,
+                const arma::mat& /* centroids */,
+                arma::Col<size_t>& /* assignments */)
+{
+  return false;
+}
+
 /**
  * Construct the K-Means object.
  */
@@ -20,25 +131,148 @@ template<typename MetricType,
          typename InitialPartitionPolicy,
          typename EmptyClusterPolicy,
          template<class, class> class LloydStepType,
-         typename MatType>
+         typename MatType,
+         typename CommunicatorType>
 KMeans<
     MetricType,
     InitialPartitionPolicy,
     EmptyClusterPolicy,
     LloydStepType,
-    MatType>::
+    MatType,
+    CommunicatorType>::
 KMeans(const size_t maxIterations,
        const MetricType metric,
        const InitialPartitionPolicy partitioner,
-       const EmptyClusterPolicy emptyClusterAction) :
+       const EmptyClusterPolicy emptyClusterAction,
+       const size_t threads,
+       const CommunicatorType communicator) :
     maxIterations(maxIterations),
     metric(metric),
     partitioner(partitioner),
-    emptyClusterAction(emptyClusterAction)
+    emptyClusterAction(emptyClusterAction),
+    threads(threads),
+    offload(false),
+    groups(0),
+    communicator(communicator),
+    cacheLloydStep(false),
+    cachedLloydStep(NULL),
+    cachedData(NULL),
+    cachedRows(0),
+    cachedCols(0)
+{
+  // Nothing to do.
+}
+
+template<typename MetricType,
+         typename InitialPartitionPolicy,
+         typename EmptyClusterPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType,
+         typename CommunicatorType>
+KMeans<
+    MetricType,
+    InitialPartitionPolicy,
+    EmptyClusterPolicy,
+    LloydStepType,
+    MatType,
+    CommunicatorType>::
+KMeans(const KMeans& other) :
+    maxIterations(other.maxIterations),
+    metric(other.metric),
+    partitioner(other.partitioner),
+    emptyClusterAction(other.emptyClusterAction),
+    threads(other.threads),
+    offload(other.offload),
+    groups(other.groups),
+    communicator(other.communicator),
+    cacheLloydStep(other.cacheLloydStep),
+    cachedLloydStep(NULL),
+    cachedData(NULL),
+    cachedRows(0),
+    cachedCols(0)
 {
   // Nothing to do.
 }
 
+template<typename MetricType,
+         typename InitialPartitionPolicy,
+         typename EmptyClusterPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType,
+         typename CommunicatorType>
+KMeans<
+    MetricType,
+    InitialPartitionPolicy,
+    EmptyClusterPolicy,
+    LloydStepType,
+    MatType,
+    CommunicatorType>&
+KMeans<
+    MetricType,
+    InitialPartitionPolicy,
+    EmptyClusterPolicy,
+    LloydStepType,
+    MatType,
+    CommunicatorType>::
+operator=(const KMeans& other)
+{
+  if (this != &other)
+  {
+    // The cached step holds a reference to our metric, so it has to go.
+    ClearCache();
+
+    maxIterations = other.maxIterations;
+    metric = other.metric;
+    partitioner = other.partitioner;
+    emptyClusterAction = other.emptyClusterAction;
+    threads = other.threads;
+    offload = other.offload;
+    groups = other.groups;
+    communicator = other.communicator;
+    cacheLloydStep = other.cacheLloydStep;
+  }
+
+  return *this;
+}
+
+template<typename MetricType,
+         typename InitialPartitionPolicy,
+         typename EmptyClusterPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType,
+         typename CommunicatorType>
+KMeans<
+    MetricType,
+    InitialPartitionPolicy,
+    EmptyClusterPolicy,
+    LloydStepType,
+    MatType,
+    CommunicatorType>::
+~KMeans()
+{
+  ClearCache();
+}
+
+template<typename MetricType,
+         typename InitialPartitionPolicy,
+         typename EmptyClusterPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType,
+         typename CommunicatorType>
+void KMeans<
+    MetricType,
+    InitialPartitionPolicy,
+    EmptyClusterPolicy,
+    LloydStepType,
+    MatType,
+    CommunicatorType>::
+ClearCache()
+{
+  delete cachedLloydStep;
+  cachedLloydStep = NULL;
+  cachedData = NULL;
+}
+
 /**
  * Perform k-means clustering on the data, returning a list of cluster
  * assignments.  This just forward to the other function, which returns the
@@ -49,13 +283,15 @@ template<typename MetricType,
          typename InitialPartitionPolicy,
          typename EmptyClusterPolicy,
          template<class, class> class LloydStepType,
-         typename MatType>
+         typename MatType,
+         typename CommunicatorType>
 inline void KMeans<
     MetricType,
     InitialPartitionPolicy,
     EmptyClusterPolicy,
     LloydStepType,
-    MatType>::
+    MatType,
+    CommunicatorType>::
 Cluster(const MatType& data,
         const size_t clusters,
         arma::Col<size_t>& assignments,
@@ -73,13 +309,15 @@ template<typename MetricType,
          typename InitialPartitionPolicy,
          typename EmptyClusterPolicy,
          template<class, class> class LloydStepType,
-         typename MatType>
+         typename MatType,
+         typename CommunicatorType>
 void KMeans<
     MetricType,
     InitialPartitionPolicy,
     EmptyClusterPolicy,
     LloydStepType,
-    MatType>::
+    MatType,
+    CommunicatorType>::
 Cluster(const MatType& data,
         const size_t clusters,
         arma::mat& centroids,
@@ -130,6 +368,8 @@ Cluster(const MatType& data,
     for (size_t i = 0; i < clusters; ++i)
       if (counts[i] != 0)
         centroids.col(i) /= counts[i];
+
+    CombineCentroids(centroids, counts);
   }
 
   // Counts of points in each cluster.
@@ -137,34 +377,84 @@ Cluster(const MatType& data,
 
   size_t iteration = 0;
 
-  LloydStepType<MetricType, MatType> lloydStep(data, metric);
+  // Reuse the cached Lloyd step if it was created with this dataset and can be
+  // reset for a new run; otherwise create a new one.
+  LloydStepType<MetricType, MatType>* lloydStepPtr = NULL;
+  if (cacheLloydStep && cachedLloydStep != NULL && cachedData == &data &&
+      cachedRows == data.n_rows && cachedCols == data.n_cols &&
+      ResetLloydStep(*cachedLloydStep))
+  {
+    lloydStepPtr = cachedLloydStep;
+  }
+  else
+  {
+    ClearCache();
+    lloydStepPtr = new LloydStepType<MetricType, MatType>(data, metric);
+  }
+  LloydStepType<MetricType, MatType>& lloydStep = *lloydStepPtr;
+  SetLloydStepThreads(lloydStep, threads);
+  SetLloydStepOffload(lloydStep, offload);
+  SetLloydStepGroups(lloydStep, groups);
+  const size_t startDistanceCalculations = lloydStep.DistanceCalculations();
   arma::mat centroidsOther;
   double cNorm;
 
+  const bool distributed = (communicator.Size() > 1);
+  arma::Col<size_t> localCounts;
+
   do
   {
     // We have two centroid matrices.  We don't want to copy anything, so,
     // depending on the iteration number, we use a different centroid matrix...
-    if (iteration % 2 == 0)
-      cNorm = lloydStep.Iterate(centroids, centroidsOther, counts);
-    else
-      cNorm = lloydStep.Iterate(centroidsOther, centroids, counts);
+    const arma::mat& oldCentroids = (iteration % 2 == 0) ? centroids :
+        centroidsOther;
+    arma::mat& newCentroids = (iteration % 2 == 0) ? centroidsOther :
+        centroids;
+    cNorm = lloydStep.Iterate(oldCentroids, newCentroids, counts);
+
+    if (distributed)
+    {
+      // Combine the results of all of the processes, and find how far the
+      // combined centroids moved.
+      localCounts = counts;
+      CombineCentroids(newCentroids, counts);
+      cNorm = 0.0;
+      for (size_t i = 0; i < clusters; ++i)
+        cNorm += std::pow(metric.Evaluate(oldCentroids.col(i),
+            newCentroids.col(i)), 2.0);
+      cNorm = std::sqrt(cNorm);
+
+      // The pruning information of the tree-based steps was computed with
+      // this process's centroids, which are not the combined ones.
+      ResetLloydStep(lloydStep);
+    }
 
     // If we are not allowing empty clusters, then check that all of our
-    // clusters have points.
+    // clusters have points.  With several processes, only process 0 handles
+    // them (with its own counts), and sends the result to the others.
+    bool empty = false;
     for (size_t i = 0; i < clusters; i++)
     {
       if (counts[i] == 0)
       {
         Log::Info << "Cluster " << i << " is empty.\n";
-        if (iteration % 2 == 0)
-          emptyClusterAction.EmptyCluster(data, i, centroidsOther, counts,
+        empty = true;
+        if (!distributed)
+          emptyClusterAction.EmptyCluster(data, i, newCentroids, counts,
+              metric);
+        else if (communicator.Rank() == 0)
+          emptyClusterAction.EmptyCluster(data, i, newCentroids, localCounts,
               metric);
-        else
-          emptyClusterAction.EmptyCluster(data, i, centroids, counts, metric);
       }
     }
 
+    if (distributed && empty)
+    {
+      arma::vec values(newCentroids.memptr(), newCentroids.n_elem, false,
+          true);
+      communicator.Broadcast(values);
+    }
+
     iteration++;
     Log::Info << "KMeans::Cluster(): iteration " << iteration << ", residual "
         << cNorm << ".\n";
@@ -189,6 +479,24 @@ Cluster(const MatType& data,
   }
   Log::Info << lloydStep.DistanceCalculations() << " distance calculations."
       << std::endl;
+  Metric::Add("kmeans/iterations", iteration);
+  Metric::Add("kmeans/distance_calculations",
+      lloydStep.DistanceCalculations() - startDistanceCalculations);
+
+  // Keep the Lloyd step for the next call, if that was asked for and it can be
+  // reset.
+  typedef LloydStepType<MetricType, MatType> StepType;
+  if (cacheLloydStep && HasReset<StepType, void (StepType::*)()>::value)
+  {
+    cachedLloydStep = lloydStepPtr;
+    cachedData = &data;
+    cachedRows = data.n_rows;
+    cachedCols = data.n_cols;
+  }
+  else
+  {
+    delete lloydStepPtr;
+  }
 }
 
 /**
@@ -199,13 +507,15 @@ template<typename MetricType,
          typename InitialPartitionPolicy,
          typename EmptyClusterPolicy,
          template<class, class> class LloydStepType,
-         typename MatType>
+         typename MatType,
+         typename CommunicatorType>
 void KMeans<
     MetricType,
     InitialPartitionPolicy,
     EmptyClusterPolicy,
     LloydStepType,
-    MatType>::
+    MatType,
+    CommunicatorType>::
 Cluster(const MatType& data,
         const size_t clusters,
         arma::Col<size_t>& assignments,
@@ -234,12 +544,18 @@ Cluster(const MatType& data,
     for (size_t i = 0; i < clusters; ++i)
       if (counts[i] != 0)
         centroids.col(i) /= counts[i];
+
+    CombineCentroids(centroids, counts);
   }
 
   Cluster(data, clusters, centroids,
       initialAssignmentGuess || initialCentroidGuess);
 
   // Calculate final assignments.
+  if (LloydStepAssign<LloydStepType<MetricType, MatType> >(data, metric,
+      threads, centroids, assignments))
+    return;
+
   assignments.set_size(data.n_cols);
   for (size_t i = 0; i < data.n_cols; ++i)
   {
@@ -267,16 +583,67 @@ template<typename MetricType,
          typename InitialPartitionPolicy,
          typename EmptyClusterPolicy,
          template<class, class> class LloydStepType,
-         typename MatType>
+         typename MatType,
+         typename CommunicatorType>
+void KMeans<
+    MetricType,
+    InitialPartitionPolicy,
+    EmptyClusterPolicy,
+    LloydStepType,
+    MatType,
+    CommunicatorType>::
+CombineCentroids(arma::mat& centroids, arma::Col<size_t>& counts)
+{
+  if (communicator.Size() <= 1)
+    return;
+
+  // Sum the sums of the points of each cluster, followed by the counts, in one
+  // message.
+  const size_t dims = centroids.n_rows;
+  arma::vec values(centroids.n_elem + centroids.n_cols);
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+  {
+    if (counts[i] > 0)
+      values.subvec(i * dims, (i + 1) * dims - 1) = (double) counts[i] *
+          centroids.col(i);
+    else
+      values.subvec(i * dims, (i + 1) * dims - 1).zeros();
+    values[centroids.n_elem + i] = (double) counts[i];
+  }
+
+  communicator.Sum(values);
+
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+  {
+    counts[i] = (size_t) (values[centroids.n_elem + i] + 0.5);
+    if (counts[i] > 0)
+      centroids.col(i) = values.subvec(i * dims, (i + 1) * dims - 1) /
+          values[centroids.n_elem + i];
+    else
+      centroids.col(i).fill(DBL_MAX);
+  }
+}
+
+template<typename MetricType,
+         typename InitialPartitionPolicy,
+         typename EmptyClusterPolicy,
+         template<class, class> class LloydStepType,
+         typename MatType,
+         typename CommunicatorType>
 std::string KMeans<MetricType,
     InitialPartitionPolicy,
     EmptyClusterPolicy,
     LloydStepType,
-    MatType>::ToString() const
+    MatType,
+    CommunicatorType>::ToString() const
 {
   std::ostringstream convert;
   convert << "KMeans [" << this << "]" << std::endl;
   convert << "  Max Iterations: " << maxIterations << std::endl;
+  convert << "  Threads: " << threads << std::endl;
+  convert << "  Offload: " << (offload ? "true" : "false") << std::endl;
+  convert << "  Groups: " << groups << std::endl;
+  convert << "  Processes: " << communicator.Size() << std::endl;
   convert << "  Metric: " << std::endl;
   convert << mlpack::util::Indent(metric.ToString(), 2);
   convert << std::endl;
@@ -6,14 +6,27 @@
  */
 #include <mlpack/core.hpp>
 
+#include <fstream>
+
 #include "kmeans.hpp"
 #include "allow_empty_clusters.hpp"
 #include "refined_start.hpp"
+#include "kmeans_plus_plus.hpp"
+#include "scalable_kmeans_plus_plus.hpp"
 #include "elkan_kmeans.hpp"
 #include "hamerly_kmeans.hpp"
+#include "yinyang_kmeans.hpp"
+#include "mini_batch_kmeans.hpp"
 #include "pelleg_moore_kmeans.hpp"
 #include "dtnn_kmeans.hpp"
 #include "dual_tree_kmeans.hpp"
+#include "chunked_kmeans.hpp"
+#include "binary_matrix_chunks.hpp"
+#include "lloyd_step_selection.hpp"
+
+#if defined(__linux__)
+  #include <unistd.h>
+#endif
 
 using namespace mlpack;
 using namespace mlpack::kmeans;
@@ -35,12 +48,40 @@ PROGRAM_INFO("K-Means Clustering", "This program performs K-Means clustering "
     "to be used in each sample, the --percentage parameter is used (it should "
     "be a value between 0.0 and 1.0)."
     "\n\n"
+    "Initial points can also be chosen with k-means++ by specifying the "
+    "--kmeans_plus_plus (-K) option, which picks each initial centroid with "
+    "probability proportional to its squared distance to the centroids chosen "
+    "so far.  For a large number of clusters, the --scalable_kmeans_plus_plus "
+    "(-B) option (k-means||) needs far fewer passes over the dataset; it "
+    "performs --rounds sampling rounds, each of which chooses about "
+    "--oversampling times the number of clusters candidate points."
+    "\n\n"
+    "Datasets that do not fit in memory can be clustered with the "
+    "--binary_input (-b) option.  The input file must then hold the number of "
+    "rows and the number of columns (as 64-bit unsigned integers, in the "
+    "native byte order), followed by the elements as doubles in column-major "
+    "order.  Each iteration reads the file sequentially in chunks of "
+    "--chunk_size points, so only one chunk is held in memory.  In this mode "
+    "the initial centroids are random points (or --initial_centroids), the "
+    "naive algorithm is used, empty clusters keep their old centroid, and only "
+    "labels are written to --output_file."
+    "\n\n"
     "There are several options available for the algorithm used for each Lloyd "
     "iteration, specified with the --algorithm (-a) option.  The standard O(kN)"
     " approach can be used ('naive').  Other options include the Pelleg-Moore "
     "tree-based algorithm ('pelleg-moore'), Elkan's triangle-inequality based "
-    "algorithm ('elkan'), and Hamerly's modification to Elkan's algorithm "
-    "('hamerly')."
+    "algorithm ('elkan'), Hamerly's modification to Elkan's algorithm "
+    "('hamerly'), Yinyang k-means ('yinyang'), which keeps Elkan's bounds for "
+    "groups of clusters (--groups of them) instead of every cluster, so it "
+    "needs much less memory for many clusters, and mini-batch k-means "
+    "('minibatch'), which only looks at a random batch of 1000 points in each "
+    "iteration and gives an approximate result for much less work on large "
+    "datasets.  With 'auto', one of "
+    "'naive', 'elkan', 'hamerly', 'dualtree' and 'dtnn' is chosen from the "
+    "size and dimensionality of the dataset and the number of clusters; "
+    "'elkan' keeps a bound for every point and cluster, so it is only chosen "
+    "if those fit in --memory_limit megabytes (or, if that is 0, in the free "
+    "memory, on Linux)."
     "\n\n"
     "As of October 2014, the --overclustering option has been removed.  If you "
     "want this support back, let us know -- file a bug at "
@@ -76,24 +117,56 @@ PARAM_INT("samplings", "Number of samplings to perform for refined start (use "
 PARAM_DOUBLE("percentage", "Percentage of dataset to use for each refined start"
     " sampling (use when --refined_start is specified).", "p", 0.02);
 
+// Parameters for k-means++ and k-means||.
+PARAM_FLAG("kmeans_plus_plus", "Use the k-means++ initial point strategy by "
+    "Arthur and Vassilvitskii to choose initial points.", "K");
+PARAM_FLAG("scalable_kmeans_plus_plus", "Use the k-means|| initial point "
+    "strategy by Bahmani et al. to choose initial points.", "B");
+PARAM_DOUBLE("oversampling", "Oversampling factor for k-means|| (use when "
+    "--scalable_kmeans_plus_plus is specified).", "O", 2.0);
+PARAM_INT("rounds", "Number of sampling rounds for k-means|| (use when "
+    "--scalable_kmeans_plus_plus is specified).", "R", 5);
+
 PARAM_STRING("algorithm", "Algorithm to use for the Lloyd iteration ('naive', "
-    "'pelleg-moore', 'elkan', 'hamerly', or 'dtnn').", "a", "naive");
+    "'pelleg-moore', 'elkan', 'hamerly', 'yinyang', 'minibatch', 'dtnn', "
+    "'dtnn-covertree', 'dualtree', or 'auto').", "a", "naive");
+PARAM_INT("groups", "Number of groups of clusters for the 'yinyang' algorithm "
+    "(0 uses one group for every 10 clusters).", "g", 0);
+PARAM_INT("memory_limit", "Memory available for the bounds of the Lloyd "
+    "iteration, in megabytes, used when --algorithm is 'auto' (0 uses the free "
+    "memory, if it can be found).", "M", 0);
+PARAM_FLAG("binary_input", "The input file is a binary matrix, which is "
+    "clustered one chunk at a time without loading it into memory.", "b");
+PARAM_INT("chunk_size", "Number of points read at a time when --binary_input "
+    "is specified.", "z", 100000);
+
+PARAM_INT("threads", "Number of threads to use for the 'naive', 'elkan', "
+    "'hamerly', 'yinyang', 'minibatch', 'dtnn' and 'dualtree' algorithms and "
+    "for the initial partition (0 uses all available cores; ignored if mlpack "
+    "was built without OpenMP).", "t", 0);
+PARAM_FLAG("offload", "If true, the 'naive' algorithm computes the distances "
+    "in large tiles with matrix multiplications, which are run on a GPU if "
+    "mlpack was built with USE_NVBLAS.", "G");
+
+// Run out-of-core k-means on a binary input file.
+void RunChunkedKMeans();
 
 // Given the type of initial partition policy, figure out the empty cluster
 // policy and run k-means.
 template<typename InitialPartitionPolicy>
-void FindEmptyClusterPolicy(const InitialPartitionPolicy& ipp);
+void FindEmptyClusterPolicy(const InitialPartitionPolicy& ipp,
+                            arma::mat& dataset);
 
 // Given the initial partitionining policy and empty cluster policy, figure out
 // the Lloyd iteration step type and run k-means.
 template<typename InitialPartitionPolicy, typename EmptyClusterPolicy>
-void FindLloydStepType(const InitialPartitionPolicy& ipp);
+void FindLloydStepType(const InitialPartitionPolicy& ipp, arma::mat& dataset);
 
-// Given the template parameters, sanitize/load input and run k-means.
+// Given the template parameters, sanitize input and run k-means.
 template<typename InitialPartitionPolicy,
          typename EmptyClusterPolicy,
          template<class, class> class LloydStepType>
-void RunKMeans(const InitialPartitionPolicy& ipp);
+void RunKMeans(const InitialPartitionPolicy& ipp, arma::mat& dataset);
 
 int main(int argc, char** argv)
 {
@@ -105,9 +178,31 @@ int main(int argc, char** argv)
   else
     math::RandomSeed((size_t) std::time(NULL));
 
+  // Out-of-core clustering doesn't use any of the policies below.
+  if (CLI::HasParam("binary_input"))
+  {
+    RunChunkedKMeans();
+    return 0;
+  }
+
   // Now, start building the KMeans type that we'll be using.  Start with the
   // initial partition policy.  The call to FindEmptyClusterPolicy<> results in
   // a call to RunKMeans<> and the algorithm is completed.
+  const size_t initialPolicies = (CLI::HasParam("refined_start") ? 1 : 0) +
+      (CLI::HasParam("kmeans_plus_plus") ? 1 : 0) +
+      (CLI::HasParam("scalable_kmeans_plus_plus") ? 1 : 0);
+  if (initialPolicies > 1)
+    Log::Fatal << "Only one of --refined_start, --kmeans_plus_plus, and "
+        << "--scalable_kmeans_plus_plus may be specified!" << endl;
+
+  // The thread count is checked again in RunKMeans<>.
+  const size_t threads = (size_t) std::max(CLI::GetParam<int>("threads"), 0);
+
+  // Load our dataset; it is needed before the Lloyd step type is chosen, for
+  // --algorithm auto.
+  arma::mat dataset;
+  data::Load(CLI::GetParam<string>("inputFile"), dataset, true);
+
   if (CLI::HasParam("refined_start"))
   {
     const int samplings = CLI::GetParam<int>("samplings");
@@ -120,59 +215,116 @@ int main(int argc, char** argv)
       Log::Fatal << "Percentage for sampling (" << percentage << ") must be "
           << "greater than 0.0 and less than or equal to 1.0!" << endl;
 
-    FindEmptyClusterPolicy<RefinedStart>(RefinedStart(samplings, percentage));
+    FindEmptyClusterPolicy<RefinedStart>(RefinedStart(samplings, percentage,
+        threads), dataset);
+  }
+  else if (CLI::HasParam("kmeans_plus_plus"))
+  {
+    FindEmptyClusterPolicy<KMeansPlusPlus>(KMeansPlusPlus(threads), dataset);
+  }
+  else if (CLI::HasParam("scalable_kmeans_plus_plus"))
+  {
+    const double oversampling = CLI::GetParam<double>("oversampling");
+    const int rounds = CLI::GetParam<int>("rounds");
+
+    if (oversampling <= 0.0)
+      Log::Fatal << "Oversampling factor (" << oversampling << ") must be "
+          << "greater than 0.0!" << endl;
+    if (rounds < 0)
+      Log::Fatal << "Number of rounds (" << rounds << ") must be greater than "
+          << "or equal to 0!" << endl;
+
+    FindEmptyClusterPolicy<ScalableKMeansPlusPlus>(ScalableKMeansPlusPlus(
+        oversampling, (size_t) rounds, threads), dataset);
   }
   else
   {
-    FindEmptyClusterPolicy<RandomPartition>(RandomPartition());
+    FindEmptyClusterPolicy<RandomPartition>(RandomPartition(), dataset);
   }
 }
 
 // Given the type of initial partition policy, figure out the empty cluster
 // policy and run k-means.
 template<typename InitialPartitionPolicy>
-void FindEmptyClusterPolicy(const InitialPartitionPolicy& ipp)
+void FindEmptyClusterPolicy(const InitialPartitionPolicy& ipp,
+                            arma::mat& dataset)
 {
   if (CLI::HasParam("allow_empty_clusters"))
-    FindLloydStepType<InitialPartitionPolicy, AllowEmptyClusters>(ipp);
+    FindLloydStepType<InitialPartitionPolicy, AllowEmptyClusters>(ipp,
+        dataset);
   else
-    FindLloydStepType<InitialPartitionPolicy, MaxVarianceNewCluster>(ipp);
+    FindLloydStepType<InitialPartitionPolicy, MaxVarianceNewCluster>(ipp,
+        dataset);
 }
 
 // Given the initial partitionining policy and empty cluster policy, figure out
 // the Lloyd iteration step type and run k-means.
 template<typename InitialPartitionPolicy, typename EmptyClusterPolicy>
-void FindLloydStepType(const InitialPartitionPolicy& ipp)
+void FindLloydStepType(const InitialPartitionPolicy& ipp, arma::mat& dataset)
 {
-  const string algorithm = CLI::GetParam<string>("algorithm");
+  string algorithm = CLI::GetParam<string>("algorithm");
+  if (algorithm == "auto")
+  {
+    // Limit the memory used for bounds to the given limit, or to the memory
+    // that is free right now if we can find out.
+    size_t memoryLimit = 0;
+    if (CLI::GetParam<int>("memory_limit") > 0)
+    {
+      memoryLimit = (size_t) CLI::GetParam<int>("memory_limit") * 1024 * 1024;
+    }
+    else
+    {
+#if defined(__linux__)
+      memoryLimit = (size_t) sysconf(_SC_AVPHYS_PAGES) *
+          (size_t) sysconf(_SC_PAGESIZE);
+#endif
+    }
+
+    algorithm = SelectLloydStep(dataset.n_cols, dataset.n_rows,
+        (size_t) std::max(CLI::GetParam<int>("clusters"), 0), memoryLimit);
+    Log::Info << "Using the '" << algorithm << "' algorithm for the Lloyd "
+        << "iterations." << endl;
+  }
+
   if (algorithm == "elkan")
-    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, ElkanKMeans>(ipp);
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, ElkanKMeans>(ipp,
+        dataset);
   else if (algorithm == "hamerly")
-    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, HamerlyKMeans>(ipp);
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, HamerlyKMeans>(ipp,
+        dataset);
+  else if (algorithm == "yinyang")
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, YinyangKMeans>(ipp,
+        dataset);
   else if (algorithm == "pelleg-moore")
     RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
-        PellegMooreKMeans>(ipp);
+        PellegMooreKMeans>(ipp, dataset);
   else if (algorithm == "dtnn")
     RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
-        DefaultDTNNKMeans>(ipp);
+        DefaultDTNNKMeans>(ipp, dataset);
   else if (algorithm == "dtnn-covertree")
     RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
-        CoverTreeDTNNKMeans>(ipp);
+        CoverTreeDTNNKMeans>(ipp, dataset);
   else if (algorithm == "dualtree")
     RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
-        DefaultDualTreeKMeans>(ipp);
+        DefaultDualTreeKMeans>(ipp, dataset);
+  else if (algorithm == "minibatch")
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
+        MiniBatchKMeans>(ipp, dataset);
   else if (algorithm == "naive")
-    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, NaiveKMeans>(ipp);
+    RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, NaiveKMeans>(ipp,
+        dataset);
   else
     Log::Fatal << "Unknown algorithm: '" << algorithm << "'.  Supported options"
-        << " are 'naive', 'pelleg-moore', 'elkan', and 'hamerly'." << endl;
+        << " are 'naive', 'pelleg-moore', 'elkan', 'hamerly', 'yinyang', "
+        << "'dtnn', 'dtnn-covertree', 'dualtree', 'minibatch', and 'auto'."
+        << endl;
 }
 
-// Given the template parameters, sanitize/load input and run k-means.
+// Given the template parameters, sanitize input and run k-means.
 template<typename InitialPartitionPolicy,
          typename EmptyClusterPolicy,
          template<class, class> class LloydStepType>
-void RunKMeans(const InitialPartitionPolicy& ipp)
+void RunKMeans(const InitialPartitionPolicy& ipp, arma::mat& dataset)
 {
   // Now, do validation of input options.
   const string inputFile = CLI::GetParam<string>("inputFile");
@@ -190,6 +342,38 @@ void RunKMeans(const InitialPartitionPolicy& ipp)
         ")! Must be greater than or equal to 0." << endl;
   }
 
+  const int threads = CLI::GetParam<int>("threads");
+  if (threads < 0)
+  {
+    Log::Fatal << "Invalid number of threads (" << threads << ")! Must be "
+        << "greater than or equal to 0." << endl;
+  }
+
+  const int groups = CLI::GetParam<int>("groups");
+  if (groups < 0)
+  {
+    Log::Fatal << "Invalid number of groups (" << groups << ")! Must be "
+        << "greater than or equal to 0." << endl;
+  }
+  else if (groups > clusters)
+  {
+    Log::Warn << "--groups (" << groups << ") is greater than the number of "
+        << "clusters; " << clusters << " groups will be used." << endl;
+  }
+
+  const bool offload = CLI::HasParam("offload");
+  if (offload && CLI::GetParam<string>("algorithm") != "naive" &&
+      CLI::GetParam<string>("algorithm") != "auto")
+  {
+    Log::Warn << "--offload is ignored because it is only used by the 'naive' "
+        << "algorithm." << endl;
+  }
+  else if (offload && !util::AcceleratorAvailable())
+  {
+    Log::Warn << "mlpack was built without an accelerator backend, so the "
+        << "offloaded matrix multiplications will run on the CPU." << endl;
+  }
+
   // Make sure we have an output file if we're not doing the work in-place.
   if (!CLI::HasParam("in_place") && !CLI::HasParam("output_file") &&
       !CLI::HasParam("centroid_file"))
@@ -198,10 +382,6 @@ void RunKMeans(const InitialPartitionPolicy& ipp)
         << "no results will be saved." << std::endl;
   }
 
-  // Load our dataset.
-  arma::mat dataset;
-  data::Load(inputFile, dataset, true); // Fatal upon failure.
-
   arma::mat centroids;
 
   const bool initialCentroidGuess = CLI::HasParam("initial_centroids");
@@ -222,7 +402,10 @@ void RunKMeans(const InitialPartitionPolicy& ipp)
   KMeans<metric::EuclideanDistance,
          InitialPartitionPolicy,
          EmptyClusterPolicy,
-         LloydStepType> kmeans(maxIterations, metric::EuclideanDistance(), ipp);
+         LloydStepType> kmeans(maxIterations, metric::EuclideanDistance(), ipp,
+                               EmptyClusterPolicy(), (size_t) threads);
+  kmeans.Offload() = offload;
+  kmeans.Groups() = (size_t) groups;
 
   if (CLI::HasParam("output_file") || CLI::HasParam("in_place"))
   {
@@ -283,3 +466,91 @@ void RunKMeans(const InitialPartitionPolicy& ipp)
   if (CLI::HasParam("centroid_file"))
     data::Save(CLI::GetParam<std::string>("centroid_file"), centroids);
 }
+
+// Run out-of-core k-means on a binary input file.
+void RunChunkedKMeans()
+{
+  const string inputFile = CLI::GetParam<string>("inputFile");
+  const int clusters = CLI::GetParam<int>("clusters");
+  if (clusters < 1)
+  {
+    Log::Fatal << "Invalid number of clusters requested (" << clusters << ")! "
+        << "Must be greater than or equal to 1." << endl;
+  }
+
+  const int maxIterations = CLI::GetParam<int>("max_iterations");
+  if (maxIterations < 0)
+  {
+    Log::Fatal << "Invalid value for maximum iterations (" << maxIterations <<
+        ")! Must be greater than or equal to 0." << endl;
+  }
+
+  const int threads = CLI::GetParam<int>("threads");
+  if (threads < 0)
+  {
+    Log::Fatal << "Invalid number of threads (" << threads << ")! Must be "
+        << "greater than or equal to 0." << endl;
+  }
+
+  const int chunkSize = CLI::GetParam<int>("chunk_size");
+  if (chunkSize < 1)
+  {
+    Log::Fatal << "Invalid chunk size (" << chunkSize << ")! Must be greater "
+        << "than or equal to 1." << endl;
+  }
+
+  if (CLI::HasParam("in_place"))
+    Log::Fatal << "--in_place can't be used with --binary_input!" << endl;
+  if (CLI::HasParam("refined_start") || CLI::HasParam("kmeans_plus_plus") ||
+      CLI::HasParam("scalable_kmeans_plus_plus"))
+    Log::Warn << "Initial partition policies are ignored when --binary_input "
+        << "is specified." << endl;
+  if (CLI::GetParam<string>("algorithm") != "naive")
+    Log::Warn << "--algorithm is ignored when --binary_input is specified."
+        << endl;
+  if (CLI::HasParam("offload"))
+    Log::Warn << "--offload is ignored when --binary_input is specified."
+        << endl;
+
+  if (!CLI::HasParam("output_file") && !CLI::HasParam("centroid_file"))
+  {
+    Log::Warn << "--output_file and --centroid_file are not set; no results "
+        << "will be saved." << std::endl;
+  }
+
+  ifstream stream(inputFile.c_str(), ios::binary);
+  if (!stream.is_open())
+    Log::Fatal << "Cannot open file '" << inputFile << "'." << endl;
+  BinaryMatrixChunks chunks(stream, (size_t) chunkSize);
+
+  arma::mat centroids;
+  const bool initialCentroidGuess = CLI::HasParam("initial_centroids");
+  if (initialCentroidGuess)
+  {
+    string initialCentroidsFile = CLI::GetParam<string>("initial_centroids");
+    data::Load(initialCentroidsFile, centroids, true);
+    Log::Info << "Using initial centroid guesses from '" <<
+        initialCentroidsFile << "'." << endl;
+  }
+
+  ChunkedKMeans<> kmeans(maxIterations, metric::EuclideanDistance(),
+      (size_t) threads);
+
+  Timer::Start("clustering");
+  kmeans.Cluster(chunks, clusters, centroids, initialCentroidGuess);
+  Timer::Stop("clustering");
+
+  if (CLI::HasParam("output_file"))
+  {
+    arma::Col<size_t> assignments;
+    Timer::Start("assignment");
+    kmeans.Assign(chunks, centroids, assignments);
+    Timer::Stop("assignment");
+
+    arma::Mat<size_t> output = trans(assignments);
+    data::Save(CLI::GetParam<string>("output_file"), output);
+  }
+
+  if (CLI::HasParam("centroid_file"))
+    data::Save(CLI::GetParam<string>("centroid_file"), centroids);
+}
@@ -0,0 +1,123 @@
+/**
+ * @file kmeans_plus_plus.hpp
+ *
+ * An implementation of the k-means++ seeding strategy of Arthur and
+ * Vassilvitskii, which chooses initial centroids that are spread out over the
+ * dataset.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The k-means++ approach for choosing initial points for k-means clustering.
+ * The first centroid is a random point, and each further centroid is a point
+ * chosen with probability proportional to its squared distance to the closest
+ * centroid chosen so far.  The expected cost of the resulting clustering is
+ * within a factor of O(log k) of the optimum, and Lloyd's algorithm usually
+ * needs far fewer iterations from such a start than from a random partition.
+ * This is an implementation of the following paper:
+ *
+ * @code
+ * @inproceedings{arthur2007k,
+ *   title={k-means++: The advantages of careful seeding},
+ *   author={Arthur, David and Vassilvitskii, Sergei},
+ *   booktitle={Proceedings of the Eighteenth Annual ACM-SIAM Symposium on
+ *       Discrete Algorithms (SODA '07)},
+ *   pages={1027--1035},
+ *   year={2007}
+ * }
+ * @endcode
+ *
+ * Choosing each centroid takes a pass over the whole dataset, so for large
+ * numbers of clusters, ScalableKMeansPlusPlus may be a better choice.
+ */
+class KMeansPlusPlus
+{
+ public:
+  /**
+   * Create the KMeansPlusPlus object, optionally specifying the number of
+   * threads used to update the distances to the chosen centroids.
+   *
+   * @param threads Number of threads to use (0 uses all available cores).
+   */
+  KMeansPlusPlus(const size_t threads = 0) : threads(threads) { }
+
+  /**
+   * Partition the given dataset into the given number of clusters by choosing
+   * centroids with k-means++ and assigning each point to its closest centroid.
+   *
+   * @tparam MatType Type of data (arma::mat or arma::sp_mat).
+   * @param data Dataset to partition.
+   * @param clusters Number of clusters to split dataset into.
+   * @param assignments Vector to store cluster assignments into.  Values will
+   *     be between 0 and (clusters - 1).
+   */
+  template<typename MatType>
+  void Cluster(const MatType& data,
+               const size_t clusters,
+               arma::Col<size_t>& assignments) const;
+
+  /**
+   * Choose centroids among the points of the given dataset with k-means++,
+   * where each point is also given a weight, and assign each point to its
+   * closest centroid.  The first centroid is chosen with probability
+   * proportional to its weight, and each further one with probability
+   * proportional to its weight times its squared distance to the closest
+   * centroid so far.
+   *
+   * @tparam MatType Type of data (arma::mat or arma::sp_mat).
+   * @param data Dataset to choose centroids from.
+   * @param clusters Number of centroids to choose.
+   * @param weights Weight of each point, or an empty vector if all points have
+   *     the same weight.
+   * @param assignments Vector to store cluster assignments into.  Values will
+   *     be between 0 and (clusters - 1).
+   */
+  template<typename MatType>
+  void Cluster(const MatType& data,
+               const size_t clusters,
+               const arma::vec& weights,
+               arma::Col<size_t>& assignments) const;
+
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+ private:
+  //! The number of threads to use.
+  size_t threads;
+};
+
+/**
+ * Update the squared distance from each point to its closest centroid, and the
+ * index of that centroid, after new centroids have been chosen.  The update
+ * is done in parallel over the points.
+ *
+ * @param data Dataset.
+ * @param centroids Indices of the points that are centroids.
+ * @param first Index in centroids of the first new centroid.
+ * @param distances Squared distance from each point to its closest centroid.
+ * @param closest Index in centroids of the closest centroid to each point.
+ * @param threads Number of threads to use (0 uses all available cores).
+ */
+template<typename MatType>
+void UpdateClosestCentroids(const MatType& data,
+                            const std::vector<size_t>& centroids,
+                            const size_t first,
+                            arma::vec& distances,
+                            arma::Col<size_t>& closest,
+                            const size_t threads);
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "kmeans_plus_plus_impl.hpp"
+
+#endif
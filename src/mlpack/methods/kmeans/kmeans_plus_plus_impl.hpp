@@ -0,0 +1,135 @@
+/**
+ * @file kmeans_plus_plus_impl.hpp
+ *
+ * Implementation of the k-means++ seeding strategy.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_PLUS_PLUS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kmeans_plus_plus.hpp"
+
+#include <mlpack/core/metrics/lmetric.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MatType>
+void UpdateClosestCentroids(const MatType& data,
+                            const std::vector<size_t>& centroids,
+                            const size_t first,
+                            arma::vec& distances,
+                            arma::Col<size_t>& closest,
+                            const size_t threads)
+{
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Each point is only written by the thread that handles it.
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t i = 0; i < (omp_size_t) data.n_cols; ++i)
+  {
+    for (size_t c = first; c < centroids.size(); ++c)
+    {
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(
+          data.col(i), data.col(centroids[c]));
+      if (distance < distances[i])
+      {
+        distances[i] = distance;
+        closest[i] = c;
+      }
+    }
+  }
+}
+
+template<typename MatType>
+void KMeansPlusPlus::Cluster(const MatType& data,
+                             const size_t clusters,
+                             arma::Col<size_t>& assignments) const
+{
+  Cluster(data, clusters, arma::vec(), assignments);
+}
+
+template<typename MatType>
+void KMeansPlusPlus::Cluster(const MatType& data,
+                             const size_t clusters,
+                             const arma::vec& weights,
+                             arma::Col<size_t>& assignments) const
+{
+  if (weights.n_elem != 0 && weights.n_elem != data.n_cols)
+    Log::Fatal << "KMeansPlusPlus::Cluster(): number of weights ("
+        << weights.n_elem << ") does not match the number of points ("
+        << data.n_cols << ")!" << std::endl;
+
+  std::vector<size_t> centroids;
+  arma::vec distances(data.n_cols);
+  distances.fill(DBL_MAX);
+  assignments.zeros(data.n_cols);
+
+  if (clusters == 0 || data.n_cols == 0)
+    return;
+
+  // The first centroid is a random point, chosen with probability
+  // proportional to its weight.
+  size_t first = (size_t) math::RandInt(data.n_cols);
+  const double totalWeight = arma::accu(weights);
+  if (weights.n_elem != 0 && totalWeight > 0.0)
+  {
+    const double target = math::Random() * totalWeight;
+    double sum = 0.0;
+    for (size_t i = 0; i < data.n_cols; ++i)
+    {
+      sum += weights[i];
+      if (sum > target)
+      {
+        first = i;
+        break;
+      }
+    }
+  }
+
+  centroids.push_back(first);
+  UpdateClosestCentroids(data, centroids, 0, distances, assignments, threads);
+
+  while (centroids.size() < clusters)
+  {
+    // Pick a point with probability proportional to its (weighted) squared
+    // distance to the closest centroid.  If every point is at a centroid
+    // already, any point will do.
+    const double total = (weights.n_elem == 0) ? arma::accu(distances) :
+        arma::dot(weights, distances);
+
+    size_t next = data.n_cols - 1;
+    if (total > 0.0)
+    {
+      const double target = math::Random() * total;
+      double sum = 0.0;
+      for (size_t i = 0; i < data.n_cols; ++i)
+      {
+        sum += (weights.n_elem == 0) ? distances[i] : weights[i] * distances[i];
+        if (sum > target)
+        {
+          next = i;
+          break;
+        }
+      }
+    }
+    else
+    {
+      next = (size_t) math::RandInt(data.n_cols);
+    }
+
+    centroids.push_back(next);
+    UpdateClosestCentroids(data, centroids, centroids.size() - 1, distances,
+        assignments, threads);
+  }
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
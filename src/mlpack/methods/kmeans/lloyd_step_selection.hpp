@@ -0,0 +1,82 @@
+/**
+ * @file lloyd_step_selection.hpp
+ *
+ * A heuristic for choosing the Lloyd step type which is likely to be fastest
+ * for a given k-means problem.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_LLOYD_STEP_SELECTION_HPP
+#define __MLPACK_METHODS_KMEANS_LLOYD_STEP_SELECTION_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * Get the memory that ElkanKMeans needs for its bounds, in bytes: a k x n
+ * matrix of lower bounds, a k x k matrix of distances between centroids, and
+ * an upper bound and assignment for each point.
+ *
+ * @param points Number of points in the dataset.
+ * @param clusters Number of clusters.
+ */
+inline double ElkanKMeansMemory(const size_t points, const size_t clusters)
+{
+  return sizeof(double) * ((double) clusters * points +
+      (double) clusters * clusters + points) + sizeof(size_t) * (double) points;
+}
+
+/**
+ * Choose the Lloyd step type which is likely to be fastest for clustering the
+ * given number of points into the given number of clusters, and which fits in
+ * the given amount of memory.  The name returned is the name of the step type
+ * for the --algorithm option of the kmeans program: one of 'naive', 'elkan',
+ * 'hamerly', 'dualtree' or 'dtnn'.  The rules are:
+ *
+ *  - small problems (fewer than 100000 point-centroid pairs) use 'naive', since
+ *    the other step types cost more to set up than they save;
+ *  - if there are nearly as many clusters as points (at least one for every 10
+ *    points) in no more than 20 dimensions, 'dtnn' is used, since it finds the
+ *    nearest centroid of each point with a dual-tree search;
+ *  - with many clusters (at least 20) in low dimensions (at most 10), the
+ *    dual-tree step type 'dualtree' prunes most of the work;
+ *  - otherwise, trees do not prune well, so a bound-based step type is used:
+ *    'elkan' for many clusters (at least 20), as long as its k x n matrix of
+ *    bounds fits in the memory limit, and 'hamerly' (which keeps two bounds
+ *    per point) otherwise.
+ *
+ * The thresholds come from timing each step type with mlpack_kmeans_benchmark;
+ * they are only a guide, and the benchmark should be run on the data at hand
+ * if the choice matters.
+ *
+ * @param points Number of points in the dataset.
+ * @param dimensions Dimensionality of the dataset.
+ * @param clusters Number of clusters.
+ * @param memoryLimit Memory available for the bounds of the step type, in
+ *     bytes; 0 means there is no limit.
+ */
+inline std::string SelectLloydStep(const size_t points,
+                                   const size_t dimensions,
+                                   const size_t clusters,
+                                   const size_t memoryLimit = 0)
+{
+  if ((double) points * clusters < 100000.0)
+    return "naive";
+
+  if (clusters * 10 >= points && dimensions <= 20)
+    return "dtnn";
+
+  if (clusters >= 20 && dimensions <= 10)
+    return "dualtree";
+
+  if (clusters >= 20 && (memoryLimit == 0 ||
+      ElkanKMeansMemory(points, clusters) <= (double) memoryLimit))
+    return "elkan";
+
+  return "hamerly";
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
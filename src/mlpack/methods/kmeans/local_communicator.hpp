@@ -0,0 +1,56 @@
+/**
+ * @file local_communicator.hpp
+ *
+ * The communicator used by K-Means when all of the data is held by one
+ * process.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_LOCAL_COMMUNICATOR_HPP
+#define __MLPACK_METHODS_KMEANS_LOCAL_COMMUNICATOR_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The default communicator for KMeans, for when the whole dataset is held by
+ * this process.  There is nothing to communicate, so every operation does
+ * nothing, and K-Means runs exactly as it would without a communicator.
+ *
+ * A communicator lets KMeans run on a dataset which is split over several
+ * processes (see MPICommunicator).  It must implement the following:
+ *
+ * @code
+ * // The index of this process and the number of processes.
+ * size_t Rank() const;
+ * size_t Size() const;
+ *
+ * // Replace each value with its sum over all of the processes.
+ * void Sum(arma::vec& values);
+ *
+ * // Replace the values with those of process 0.
+ * void Broadcast(arma::vec& values);
+ * @endcode
+ *
+ * Each of Sum() and Broadcast() is collective: every process must call it, in
+ * the same order, with the same number of values.
+ */
+class LocalCommunicator
+{
+ public:
+  //! Get the index of this process (always 0).
+  size_t Rank() const { return 0; }
+  //! Get the number of processes (always 1).
+  size_t Size() const { return 1; }
+
+  //! Sum the values over all of the processes; there is only this one.
+  void Sum(arma::vec& /* values */) { }
+
+  //! Broadcast the values from process 0, which is this one.
+  void Broadcast(arma::vec& /* values */) { }
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
@@ -11,18 +11,30 @@
 
 #include <mlpack/core.hpp>
 
+#include <vector>
+
 namespace mlpack {
 namespace kmeans {
 
 /**
  * When an empty cluster is detected, this class takes the point furthest from
  * the centroid of the cluster with maximum variance as a new cluster.
+ *
+ * Finding the cluster with maximum variance takes a pass over the dataset, to
+ * assign each point to its nearest centroid.  The assignments, the distances,
+ * and the variances are kept, and as long as EmptyCluster() is called again
+ * with the same dataset and the centroids it left behind (that is, for the
+ * other empty clusters of the same iteration), they are updated for the point
+ * that was moved instead of being computed again.  Each further empty cluster
+ * then costs time linear in the size of the cluster the point is taken from.
+ * The updated variances ignore the small change of the centroid the point was
+ * taken from.
  */
 class MaxVarianceNewCluster
 {
  public:
   //! Default constructor required by EmptyClusterPolicy.
-  MaxVarianceNewCluster() { }
+  MaxVarianceNewCluster() : cachedData(NULL), cachedCols(0) { }
 
   /**
    * Take the point furthest from the centroid of the cluster with maximum
@@ -33,16 +45,36 @@ class MaxVarianceNewCluster
    * @param emptyCluster Index of cluster which is empty.
    * @param centroids Centroids of each cluster (one per column).
    * @param clusterCounts Number of points in each cluster.
-   * @param assignments Cluster assignments of each point.
+   * @param metric Metric to use.
    *
    * @return Number of points changed.
    */
   template<typename MetricType, typename MatType>
-  static size_t EmptyCluster(const MatType& data,
-                             const size_t emptyCluster,
-                             arma::mat& centroids,
-                             arma::Col<size_t>& clusterCounts,
-                             MetricType& metric);
+  size_t EmptyCluster(const MatType& data,
+                      const size_t emptyCluster,
+                      arma::mat& centroids,
+                      arma::Col<size_t>& clusterCounts,
+                      MetricType& metric);
+
+ private:
+  //! The dataset the cached assignments are for.
+  const void* cachedData;
+  //! The number of points of that dataset.
+  size_t cachedCols;
+  //! The centroids as they were left by the last call to EmptyCluster().
+  arma::mat cachedCentroids;
+  //! The distance of each point to the centroid of its cluster.
+  arma::vec distances;
+  //! The sum of the distances of the points of each cluster.
+  arma::vec distanceSums;
+  //! The points of each cluster.
+  std::vector<std::vector<size_t> > clusterPoints;
+
+  //! Assign each point to its nearest centroid, and compute the distance sums.
+  template<typename MetricType, typename MatType>
+  void Precalculate(const MatType& data,
+                    const arma::mat& centroids,
+                    MetricType& metric);
 };
 
 }; // namespace kmeans
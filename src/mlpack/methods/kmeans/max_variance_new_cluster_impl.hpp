@@ -23,66 +23,50 @@ size_t MaxVarianceNewCluster::EmptyCluster(const MatType& data,
                                            arma::Col<size_t>& clusterCounts,
                                            MetricType& metric)
 {
-  // First, we need to find the cluster with maximum variance (by which I mean
-  // the sum of the covariance matrices).
-  arma::vec variances;
-  variances.zeros(clusterCounts.n_elem); // Start with 0.
-  arma::Col<size_t> assignments(data.n_cols);
-
-  // Add the variance of each point's distance away from the cluster.  I think
-  // this is the sensible thing to do.
-  for (size_t i = 0; i < data.n_cols; ++i)
+  // The cached assignments can be used if nothing has changed since the last
+  // call, which is the case for the other empty clusters of an iteration.
+  if (cachedData != (const void*) &data || cachedCols != data.n_cols ||
+      clusterPoints.size() != centroids.n_cols ||
+      cachedCentroids.n_rows != centroids.n_rows ||
+      cachedCentroids.n_cols != centroids.n_cols ||
+      !arma::all(arma::vectorise(cachedCentroids == centroids)))
   {
-    // Find the closest centroid to this point.
-    double minDistance = std::numeric_limits<double>::infinity();
-    size_t closestCluster = centroids.n_cols; // Invalid value.
-
-    for (size_t j = 0; j < centroids.n_cols; j++)
-    {
-      const double distance = metric.Evaluate(data.col(i), centroids.col(j));
-
-      if (distance < minDistance)
-      {
-        minDistance = distance;
-        closestCluster = j;
-      }
-    }
-
-    assignments[i] = closestCluster;
-    variances[closestCluster] += metric.Evaluate(data.col(i),
-        centroids.col(closestCluster));
+    Precalculate(data, centroids, metric);
   }
 
-  // Divide by the number of points in the cluster to produce the variance.
-  // Although a -nan will occur here for the empty cluster(s), this doesn't
-  // matter because variances.max() won't pick it up.  If the number of points
-  // in the cluster is 1, we ensure that cluster is not selected by forcing the
-  // variance to 0.
+  // Now find the cluster with maximum variance (by which I mean the mean
+  // distance of its points to its centroid).  A cluster with only one point
+  // can't give a point away, so it has no variance here.
+  size_t maxVarCluster = centroids.n_cols;
+  double maxVariance = -DBL_MAX;
   for (size_t i = 0; i < clusterCounts.n_elem; ++i)
-    variances[i] /= (clusterCounts[i] == 1) ? DBL_MAX : clusterCounts[i];
-
-  // Now find the cluster with maximum variance.
-  arma::uword maxVarCluster;
-  variances.max(maxVarCluster);
-
-  // Now, inside this cluster, find the point which is furthest away.
-  size_t furthestPoint = data.n_cols;
-  double maxDistance = -DBL_MAX;
-  for (size_t i = 0; i < data.n_cols; ++i)
   {
-    if (assignments[i] == maxVarCluster)
+    const double variance = (clusterCounts[i] <= 1) ? 0.0 :
+        distanceSums[i] / clusterCounts[i];
+    if (variance > maxVariance)
     {
-      const double distance = metric.Evaluate(data.col(i),
-          centroids.col(maxVarCluster));
-
-      if (distance > maxDistance)
-      {
-        maxDistance = distance;
-        furthestPoint = i;
-      }
+      maxVariance = variance;
+      maxVarCluster = i;
     }
   }
 
+  if (maxVarCluster == centroids.n_cols || clusterCounts[maxVarCluster] <= 1 ||
+      clusterPoints[maxVarCluster].empty())
+  {
+    Log::Debug << "No point could be assigned to empty cluster " << emptyCluster
+        << ".\n";
+    cachedCentroids = centroids;
+    return 0;
+  }
+
+  // Now, inside this cluster, find the point which is furthest away.
+  std::vector<size_t>& points = clusterPoints[maxVarCluster];
+  size_t furthestIndex = 0;
+  for (size_t i = 1; i < points.size(); ++i)
+    if (distances[points[i]] > distances[points[furthestIndex]])
+      furthestIndex = i;
+  const size_t furthestPoint = points[furthestIndex];
+
   // Take that point and add it to the empty cluster.
   centroids.col(maxVarCluster) *= (double(clusterCounts[maxVarCluster]) /
       double(clusterCounts[maxVarCluster] - 1));
@@ -91,7 +75,14 @@ size_t MaxVarianceNewCluster::EmptyCluster(const MatType& data,
   clusterCounts[maxVarCluster]--;
   clusterCounts[emptyCluster]++;
   centroids.col(emptyCluster) = arma::vec(data.col(furthestPoint));
-  assignments[furthestPoint] = emptyCluster;
+
+  // Update the cached assignments for the moved point.
+  distanceSums[maxVarCluster] -= distances[furthestPoint];
+  points[furthestIndex] = points.back();
+  points.pop_back();
+  distances[furthestPoint] = 0.0;
+  clusterPoints[emptyCluster].push_back(furthestPoint);
+  cachedCentroids = centroids;
 
   // Output some debugging information.
   Log::Debug << "Point " << furthestPoint << " assigned to empty cluster " <<
@@ -100,6 +91,46 @@ size_t MaxVarianceNewCluster::EmptyCluster(const MatType& data,
   return 1; // We only changed one point.
 }
 
+/**
+ * Assign each point to its nearest centroid, and compute the sum of the
+ * distances of the points of each cluster.
+ */
+template<typename MetricType, typename MatType>
+void MaxVarianceNewCluster::Precalculate(const MatType& data,
+                                         const arma::mat& centroids,
+                                         MetricType& metric)
+{
+  distances.set_size(data.n_cols);
+  distanceSums.zeros(centroids.n_cols);
+  clusterPoints.clear();
+  clusterPoints.resize(centroids.n_cols);
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    // Find the closest centroid to this point.
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = 0;
+
+    for (size_t j = 0; j < centroids.n_cols; j++)
+    {
+      const double distance = metric.Evaluate(data.col(i), centroids.col(j));
+
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    distances[i] = minDistance;
+    distanceSums[closestCluster] += minDistance;
+    clusterPoints[closestCluster].push_back(i);
+  }
+
+  cachedData = (const void*) &data;
+  cachedCols = data.n_cols;
+}
+
 }; // namespace kmeans
 }; // namespace mlpack
 
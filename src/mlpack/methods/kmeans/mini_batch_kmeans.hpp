@@ -0,0 +1,107 @@
+/**
+ * @file mini_batch_kmeans.hpp
+ *
+ * An implementation of mini-batch k-means (Sculley, 2010), which can be used as
+ * the Lloyd step type of KMeans.  This is the best choice for very large
+ * datasets, where even the fastest exact steps take too long to make many full
+ * passes over the data.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_HPP
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * This is a stochastic approximation of a step of Lloyd's algorithm, from the
+ * following paper:
+ *
+ * @code
+ * @inproceedings{sculley2010web,
+ *   title={Web-scale k-means clustering},
+ *   author={Sculley, D.},
+ *   booktitle={Proceedings of the 19th International Conference on World Wide
+ *       Web (WWW '10)},
+ *   pages={1177--1178},
+ *   year={2010}
+ * }
+ * @endcode
+ *
+ * Instead of assigning every point in the dataset, each iteration samples a
+ * small batch of points, assigns them to their closest centroids, and moves
+ * each of those centroids towards its points.  Each centroid has its own
+ * learning rate, which is one over the number of points it has been given so
+ * far, so each centroid is the running mean of all the sampled points that
+ * were assigned to it.  The counts returned by Iterate() are these running
+ * totals, not the number of points that are currently assigned to each
+ * centroid.  Because each iteration only looks at a batch, the residual gets
+ * small much faster than with a full pass, but the result is approximate.
+ *
+ * @param MetricType Type of metric used with this implementation.
+ * @param MatType Matrix type (arma::mat or arma::sp_mat).
+ */
+template<typename MetricType, typename MatType>
+class MiniBatchKMeans
+{
+ public:
+  /**
+   * Construct the MiniBatchKMeans object with the given dataset and metric.
+   *
+   * @param dataset Dataset.
+   * @param metric Instantiated metric.
+   */
+  MiniBatchKMeans(const MatType& dataset, MetricType& metric);
+
+  /**
+   * Sample a batch of points, and move the given centroids towards the sampled
+   * points, storing the result in the newCentroids matrix.
+   *
+   * @param centroids Current cluster centroids.
+   * @param newCentroids New cluster centroids.
+   * @param counts Number of points each centroid has been given so far, to be
+   *     overwritten.
+   */
+  double Iterate(const arma::mat& centroids,
+                 arma::mat& newCentroids,
+                 arma::Col<size_t>& counts);
+
+  size_t DistanceCalculations() const { return distanceCalculations; }
+
+  //! Get the number of points sampled in each iteration.
+  size_t BatchSize() const { return batchSize; }
+  //! Modify the number of points sampled in each iteration.
+  size_t& BatchSize() { return batchSize; }
+
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+ private:
+  //! The dataset.
+  const MatType& dataset;
+  //! The instantiated metric.
+  MetricType& metric;
+
+  //! The number of points sampled in each iteration.
+  size_t batchSize;
+  //! The number of sampled points that each centroid has been given so far.
+  arma::Col<size_t> clusterCounts;
+  //! The points sampled in the current iteration.
+  arma::Col<size_t> batch;
+  //! The closest centroid to each point of the current batch.
+  arma::Col<size_t> batchAssignments;
+
+  //! Number of distance calculations.
+  size_t distanceCalculations;
+  //! The number of threads to use.
+  size_t threads;
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+// Include implementation.
+#include "mini_batch_kmeans_impl.hpp"
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file mini_batch_kmeans_impl.hpp
+ *
+ * An implementation of mini-batch k-means (Sculley, 2010).
+ */
+#ifndef __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_MINI_BATCH_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "mini_batch_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename MatType>
+MiniBatchKMeans<MetricType, MatType>::MiniBatchKMeans(const MatType& dataset,
+                                                      MetricType& metric) :
+    dataset(dataset),
+    metric(metric),
+    batchSize(1000),
+    distanceCalculations(0),
+    threads(0)
+{ /* Nothing to do. */ }
+
+// Run a single iteration.
+template<typename MetricType, typename MatType>
+double MiniBatchKMeans<MetricType, MatType>::Iterate(
+    const arma::mat& centroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& counts)
+{
+  // If this is the first iteration, no centroid has been given any points yet.
+  if (clusterCounts.n_elem != centroids.n_cols)
+    clusterCounts.zeros(centroids.n_cols);
+
+  // Sample the batch.  A batch size of 0 means the whole dataset is sampled.
+  const size_t size = (batchSize == 0 || batchSize > dataset.n_cols) ?
+      dataset.n_cols : batchSize;
+  batch.set_size(size);
+  for (size_t i = 0; i < size; ++i)
+    batch[i] = (size_t) math::RandInt(dataset.n_cols);
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Find the closest centroid to each point of the batch.  The centroids are
+  // not moved until all the points are assigned, so this can be done in
+  // parallel.
+  batchAssignments.set_size(size);
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t i = 0; i < (omp_size_t) size; ++i)
+  {
+    double minDistance = std::numeric_limits<double>::infinity();
+    size_t closestCluster = centroids.n_cols; // Invalid value.
+
+    for (size_t j = 0; j < centroids.n_cols; ++j)
+    {
+      const double distance = metric.Evaluate(dataset.col(batch[i]),
+          centroids.col(j));
+
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closestCluster = j;
+      }
+    }
+
+    Log::Assert(closestCluster != centroids.n_cols);
+    batchAssignments[i] = closestCluster;
+  }
+  distanceCalculations += centroids.n_cols * size;
+
+  // Now move each centroid towards its points, with a learning rate of one over
+  // the number of points the centroid has been given.
+  newCentroids = centroids;
+  for (size_t i = 0; i < size; ++i)
+  {
+    const size_t cluster = batchAssignments[i];
+    const double rate = 1.0 / (double) (++clusterCounts[cluster]);
+    newCentroids.col(cluster) = (1.0 - rate) * newCentroids.col(cluster) +
+        rate * arma::vec(dataset.col(batch[i]));
+  }
+
+  counts = clusterCounts;
+
+  // Calculate how far the centroids moved in this iteration.
+  double cNorm = 0.0;
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+  {
+    cNorm += std::pow(metric.Evaluate(centroids.col(i), newCentroids.col(i)),
+        2.0);
+  }
+  distanceCalculations += centroids.n_cols;
+
+  return std::sqrt(cNorm);
+}
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
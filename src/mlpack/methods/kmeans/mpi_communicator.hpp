@@ -0,0 +1,95 @@
+/**
+ * @file mpi_communicator.hpp
+ *
+ * A communicator for K-Means which sums and broadcasts over the processes of
+ * an MPI communicator.  It is only available if mlpack was built with MPI (the
+ * CMake option USE_MPI).
+ */
+#ifndef __MLPACK_METHODS_KMEANS_MPI_COMMUNICATOR_HPP
+#define __MLPACK_METHODS_KMEANS_MPI_COMMUNICATOR_HPP
+
+#include <mlpack/core.hpp>
+
+#ifdef MLPACK_HAS_MPI
+
+#include <mpi.h>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * A communicator for KMeans which runs K-Means on a dataset that is split over
+ * the processes of an MPI communicator.  Each process gives its own points to
+ * KMeans::Cluster(), and every process gets the same centroids back.  For
+ * example:
+ *
+ * @code
+ * MPI_Init(&argc, &argv);
+ * extern arma::mat localData; // The points of this process.
+ *
+ * KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+ *     HamerlyKMeans, arma::mat, MPICommunicator> k(1000,
+ *     metric::EuclideanDistance(), RandomPartition(), MaxVarianceNewCluster(),
+ *     0, MPICommunicator(MPI_COMM_WORLD));
+ * arma::mat centroids;
+ * k.Cluster(localData, 10, centroids);
+ *
+ * MPI_Finalize();
+ * @endcode
+ */
+class MPICommunicator
+{
+ public:
+  /**
+   * Create the communicator for the processes of the given MPI communicator.
+   *
+   * @param communicator MPI communicator (MPI_COMM_WORLD by default).
+   */
+  MPICommunicator(MPI_Comm communicator = MPI_COMM_WORLD) :
+      communicator(communicator)
+  { }
+
+  //! Get the index of this process.
+  size_t Rank() const
+  {
+    int rank;
+    MPI_Comm_rank(communicator, &rank);
+    return (size_t) rank;
+  }
+
+  //! Get the number of processes.
+  size_t Size() const
+  {
+    int size;
+    MPI_Comm_size(communicator, &size);
+    return (size_t) size;
+  }
+
+  //! Replace each value with its sum over all of the processes.
+  void Sum(arma::vec& values)
+  {
+    MPI_Allreduce(MPI_IN_PLACE, values.memptr(), (int) values.n_elem,
+        MPI_DOUBLE, MPI_SUM, communicator);
+  }
+
+  //! Replace the values with those of process 0.
+  void Broadcast(arma::vec& values)
+  {
+    MPI_Bcast(values.memptr(), (int) values.n_elem, MPI_DOUBLE, 0,
+        communicator);
+  }
+
+  //! Get the MPI communicator.
+  MPI_Comm Communicator() const { return communicator; }
+
+ private:
+  //! The MPI communicator.
+  MPI_Comm communicator;
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif // MLPACK_HAS_MPI
+
+#endif
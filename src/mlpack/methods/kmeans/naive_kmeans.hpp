@@ -46,6 +46,24 @@ class NaiveKMeans
 
   size_t DistanceCalculations() const { return distanceCalculations; }
 
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+  //! Get whether the distance computations are offloaded.
+  bool Offload() const { return offload; }
+  //! Modify whether the distance computations are offloaded.  If true and the
+  //! metric is the Euclidean (or squared Euclidean) distance, the closest
+  //! centroid of each point is found from large tiles of distances, each
+  //! computed with one matrix multiplication (see util::SquaredDistanceTile()),
+  //! which is run on a GPU if mlpack was built with an accelerator backend (see
+  //! util::AcceleratorAvailable()).  A point which is almost equally close to
+  //! two centroids may then be assigned to the other one, because of the
+  //! rounding error of the matrix multiplication.  With other metrics this has
+  //! no effect.
+  bool& Offload() { return offload; }
+
  private:
   //! The dataset.
   const MatType& dataset;
@@ -54,6 +72,35 @@ class NaiveKMeans
 
   //! Number of distance calculations.
   size_t distanceCalculations;
+  //! The number of threads to use.
+  size_t threads;
+  //! Whether the distance computations are offloaded.
+  bool offload;
+
+  /**
+   * Find the closest centroid to each point with the distance tiles of
+   * util::SquaredDistanceTile(), for the Euclidean and squared Euclidean
+   * distances.
+   *
+   * @param metric Instantiated metric (not used).
+   * @param centroids Current cluster centroids.
+   * @param assignments Vector to store the closest centroid of each point in.
+   * @param numThreads Number of threads to use on the CPU.
+   * @return true.
+   */
+  template<bool TakeRoot>
+  bool OffloadAssignments(metric::LMetric<2, TakeRoot>& metric,
+                          const arma::mat& centroids,
+                          arma::Col<size_t>& assignments,
+                          const size_t numThreads);
+
+  //! Other metrics are not offloaded, so this returns false.
+  template<typename MT>
+  bool OffloadAssignments(MT& /* metric */,
+                          const arma::mat& /* centroids */,
+                          arma::Col<size_t>& /* assignments */,
+                          const size_t /* numThreads */)
+  { return false; }
 };
 
 } // namespace kmeans
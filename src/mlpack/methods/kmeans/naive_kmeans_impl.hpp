@@ -20,7 +20,9 @@ NaiveKMeans<MetricType, MatType>::NaiveKMeans(const MatType& dataset,
                                               MetricType& metric) :
     dataset(dataset),
     metric(metric),
-    distanceCalculations(0)
+    distanceCalculations(0),
+    threads(0),
+    offload(false)
 { /* Nothing to do. */ }
 
 // Run a single iteration.
@@ -32,31 +34,81 @@ double NaiveKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
   newCentroids.zeros(centroids.n_rows, centroids.n_cols);
   counts.zeros(centroids.n_cols);
 
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // The points are split into contiguous blocks (as many as
+  // util::ReductionBlocks() gives), each of which sums into its own copies of
+  // the centroids and counts; these are added in the fixed order of
+  // util::TreeReduce() by a util::TreeReducer as the blocks finish, so the
+  // result does not depend on the number of threads, and only a few copies are
+  // held at once.
+  const size_t blocks = util::ReductionBlocks(dataset.n_cols);
+  std::vector<arma::mat> blockCentroids(blocks);
+  std::vector<arma::Col<size_t> > blockCounts(blocks);
+  util::TreeReducer<arma::mat> centroidReducer(blockCentroids);
+  util::TreeReducer<arma::Col<size_t> > countReducer(blockCounts);
+
+  // If the distance computations are offloaded, the closest centroids are all
+  // found first; the sums are then made in the same way.
+  arma::Col<size_t> assignments;
+  const bool offloaded = offload &&
+      OffloadAssignments(metric, centroids, assignments, numThreads);
+
   // Find the closest centroid to each point and update the new centroids.
-  for (size_t i = 0; i < dataset.n_cols; i++)
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
   {
-    // Find the closest centroid to this point.
-    double minDistance = std::numeric_limits<double>::infinity();
-    size_t closestCluster = centroids.n_cols; // Invalid value.
+    arma::mat& sums = blockCentroids[b];
+    arma::Col<size_t>& sizes = blockCounts[b];
+    sums.zeros(centroids.n_rows, centroids.n_cols);
+    sizes.zeros(centroids.n_cols);
 
-    for (size_t j = 0; j < centroids.n_cols; j++)
+    const size_t begin = b * dataset.n_cols / blocks;
+    const size_t end = (b + 1) * dataset.n_cols / blocks;
+    for (size_t i = begin; i < end; i++)
     {
-      const double distance = metric.Evaluate(dataset.col(i), centroids.col(j));
-
-      if (distance < minDistance)
+      // Find the closest centroid to this point.
+      size_t closestCluster = centroids.n_cols; // Invalid value.
+      if (offloaded)
       {
-        minDistance = distance;
-        closestCluster = j;
+        closestCluster = assignments[i];
       }
-    }
+      else
+      {
+        double minDistance = std::numeric_limits<double>::infinity();
+        for (size_t j = 0; j < centroids.n_cols; j++)
+        {
+          const double distance = metric.Evaluate(dataset.col(i),
+              centroids.col(j));
 
-    Log::Assert(closestCluster != centroids.n_cols);
+          if (distance < minDistance)
+          {
+            minDistance = distance;
+            closestCluster = j;
+          }
+        }
+      }
 
-    // We now have the minimum distance centroid index.  Update that centroid.
-    newCentroids.col(closestCluster) += arma::vec(dataset.col(i));
-    counts(closestCluster)++;
+      Log::Assert(closestCluster != centroids.n_cols);
+
+      // We now have the minimum distance centroid index.  Update that
+      // centroid.
+      sums.col(closestCluster) += arma::vec(dataset.col(i));
+      sizes(closestCluster)++;
+    }
+
+    centroidReducer.Finish(b);
+    countReducer.Finish(b);
   }
 
+  newCentroids.swap(blockCentroids[0]);
+  counts.swap(blockCounts[0]);
+
   // Now normalize the centroid.
   for (size_t i = 0; i < centroids.n_cols; ++i)
     if (counts(i) != 0)
@@ -78,6 +130,68 @@ double NaiveKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
   return std::sqrt(cNorm);
 }
 
+template<typename MetricType, typename MatType>
+template<bool TakeRoot>
+bool NaiveKMeans<MetricType, MatType>::OffloadAssignments(
+    metric::LMetric<2, TakeRoot>& /* metric */,
+    const arma::mat& centroids,
+    arma::Col<size_t>& assignments,
+    const size_t numThreads)
+{
+  // Empty clusters may have been left with invalid centroids (filled with
+  // DBL_MAX), which would overflow the expansion; no point is closest to them
+  // anyway, so they are left out.
+  std::vector<size_t> valid;
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+    if (centroids(0, i) != DBL_MAX)
+      valid.push_back(i);
+  if (valid.empty())
+    return false;
+
+  // Center the points on the mean of the centroids, so that the matrix
+  // multiplication loses less precision.
+  arma::mat centeredCentroids(centroids.n_rows, valid.size());
+  for (size_t i = 0; i < valid.size(); ++i)
+    centeredCentroids.col(i) = centroids.col(valid[i]);
+  const arma::vec center = arma::mean(centeredCentroids, 1);
+  centeredCentroids.each_col() -= center;
+  const arma::rowvec centroidNorms = arma::sum(arma::square(centeredCentroids),
+      0);
+
+  assignments.set_size(dataset.n_cols);
+  const size_t tileSize = std::min((size_t) dataset.n_cols,
+      util::TileColumns(valid.size()));
+
+  // tile(i, j) is the squared distance between centroid valid[i] and point
+  // begin + j; the squared distances have the same minimum as the distances.
+  arma::mat tile;
+  for (size_t begin = 0; begin < dataset.n_cols; begin += tileSize)
+  {
+    const size_t end = std::min(begin + tileSize, (size_t) dataset.n_cols);
+
+    arma::mat points(dataset.cols(begin, end - 1));
+    points.each_col() -= center;
+    const arma::rowvec pointNorms = arma::sum(arma::square(points), 0);
+
+    util::SquaredDistanceTile(centeredCentroids, centroidNorms, points,
+        pointNorms, tile, numThreads);
+
+    #pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (omp_size_t j = 0; j < (omp_size_t) tile.n_cols; ++j)
+    {
+      const double* distances = tile.colptr(j);
+      size_t closestCluster = 0;
+      for (size_t i = 1; i < tile.n_rows; ++i)
+        if (distances[i] < distances[closestCluster])
+          closestCluster = i;
+
+      assignments[begin + j] = valid[closestCluster];
+    }
+  }
+
+  return true;
+}
+
 } // namespace kmeans
 } // namespace mlpack
 
@@ -59,6 +59,11 @@ class PellegMooreKMeans
                  arma::mat& newCentroids,
                  arma::Col<size_t>& counts);
 
+  /**
+   * Prepare for a new k-means run on the same dataset, keeping the tree.
+   */
+  void Reset() { distanceCalculations = 0; }
+
   //! Return the number of distance calculations.
   size_t DistanceCalculations() const { return distanceCalculations; }
   //! Modify the number of distance calculations.
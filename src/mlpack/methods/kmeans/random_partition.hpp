@@ -41,8 +41,22 @@ class RandomPartition
                              arma::Col<size_t>& assignments)
   {
     // Implementation is so simple we'll put it here in the header file.
-    assignments = arma::shuffle(arma::linspace<arma::Col<size_t> >(0,
-        (clusters - 1), data.n_cols));
+    assignments = arma::linspace<arma::Col<size_t> >(0, (clusters - 1),
+        data.n_cols);
+
+#ifdef _OPENMP
+    // Armadillo's random number generator may be shared by all threads, so in
+    // a parallel region (such as the trials of GMM::Estimate()) shuffle with
+    // the random object of the calling thread instead.
+    if (omp_in_parallel())
+    {
+      for (size_t i = assignments.n_elem; i > 1; --i)
+        std::swap(assignments[i - 1], assignments[math::RandInt(i)]);
+      return;
+    }
+#endif
+
+    assignments = arma::shuffle(assignments);
   }
 };
 
@@ -28,18 +28,28 @@ namespace kmeans {
  *   volume={66},
  *   year={1998}
  * }
+ *
+ * The samplings are independent, so they are run in parallel (see Threads()).
+ * Inside the parallel region each thread draws its samples from its own
+ * random object (see math::RandGen()), so the result depends on the number of
+ * threads.
  */
 class RefinedStart
 {
  public:
   /**
    * Create the RefinedStart object, optionally specifying parameters for the
-   * number of samplings to perform and the percentage of the dataset to use in
-   * each sampling.
+   * number of samplings to perform, the percentage of the dataset to use in
+   * each sampling, and the number of threads to run the samplings with.
+   *
+   * @param samplings Number of samplings to perform.
+   * @param percentage Percentage of the dataset to use in each sampling.
+   * @param threads Number of threads to use (0 uses all available cores).
    */
   RefinedStart(const size_t samplings = 100,
-               const double percentage = 0.02) :
-      samplings(samplings), percentage(percentage) { }
+               const double percentage = 0.02,
+               const size_t threads = 0) :
+      samplings(samplings), percentage(percentage), threads(threads) { }
 
   /**
    * Partition the given dataset into the given number of clusters according to
@@ -66,11 +76,21 @@ class RefinedStart
   //! Modify the percentage of the data used by each subsampling.
   double& Percentage() { return percentage; }
 
+  //! Get the number of threads the samplings are run with (0 means all
+  //! available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads the samplings are run with (0 means all
+  //! available cores).  This has no effect if mlpack was compiled without
+  //! OpenMP.
+  size_t& Threads() { return threads; }
+
  private:
   //! The number of samplings to perform.
   size_t samplings;
   //! The percentage of the data to use for each subsampling.
   double percentage;
+  //! The number of threads to use.
+  size_t threads;
 };
 
 }; // namespace kmeans
@@ -23,54 +23,75 @@ void RefinedStart::Cluster(const MatType& data,
 {
   math::RandomSeed(std::time(NULL));
 
-  // This will hold the sampled datasets.
   const size_t numPoints = size_t(percentage * data.n_cols);
-  MatType sampledData(data.n_rows, numPoints);
-  // vector<bool> is packed so each bool is 1 bit.
-  std::vector<bool> pointsUsed(data.n_cols, false);
   arma::mat sampledCentroids(data.n_rows, samplings * clusters);
 
-  // We will use these objects repeatedly for clustering.
-  arma::Col<size_t> sampledAssignments;
-  arma::mat centroids;
-  KMeans<> kmeans;
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
 
-  for (size_t i = 0; i < samplings; ++i)
+  // The samplings are independent; each thread writes only the centroids of
+  // the samplings it runs.
+  #pragma omp parallel num_threads(numThreads)
   {
-    // First, assemble the sampled dataset.
-    size_t curSample = 0;
-    while (curSample < numPoints)
+    // This will hold the sampled datasets.
+    MatType sampledData(data.n_rows, numPoints);
+    // vector<bool> is packed so each bool is 1 bit.
+    std::vector<bool> pointsUsed(data.n_cols, false);
+
+    // We will use these objects repeatedly for clustering.
+    arma::Col<size_t> sampledAssignments;
+    arma::mat centroids;
+    KMeans<> kmeans;
+    kmeans.Threads() = 1;
+
+    #pragma omp for schedule(static, 1)
+    for (omp_size_t i = 0; i < (omp_size_t) samplings; ++i)
     {
-      // Pick a random point in [0, numPoints).
-      size_t sample = (size_t) math::RandInt(data.n_cols);
-
-      if (!pointsUsed[sample])
+      // First, assemble the sampled dataset.
+      size_t curSample = 0;
+      while (curSample < numPoints)
       {
-        // This point isn't used yet.  So we'll put it in our sample.
-        pointsUsed[sample] = true;
-        sampledData.col(curSample) = data.col(sample);
-        ++curSample;
+        // Pick a random point in [0, numPoints).
+        size_t sample = (size_t) math::RandInt(data.n_cols);
+
+        if (!pointsUsed[sample])
+        {
+          // This point isn't used yet.  So we'll put it in our sample.
+          pointsUsed[sample] = true;
+          sampledData.col(curSample) = data.col(sample);
+          ++curSample;
+        }
       }
-    }
 
-    // Now, using the sampled dataset, run k-means.  In the case of an empty
-    // cluster, we re-initialize that cluster as the point furthest away from
-    // the cluster with maximum variance.  This is not *exactly* what the paper
-    // implements, but it is quite similar, and we'll call it "good enough".
-    kmeans.Cluster(sampledData, clusters, sampledAssignments, centroids);
+      // Now, using the sampled dataset, run k-means.  In the case of an empty
+      // cluster, we re-initialize that cluster as the point furthest away from
+      // the cluster with maximum variance.  This is not *exactly* what the
+      // paper implements, but it is quite similar, and we'll call it "good
+      // enough".
+      kmeans.Cluster(sampledData, clusters, sampledAssignments, centroids);
 
-    // Store the sampled centroids.
-    sampledCentroids.cols(i * clusters, (i + 1) * clusters - 1) = centroids;
+      // Store the sampled centroids.
+      sampledCentroids.cols((size_t) i * clusters,
+          ((size_t) i + 1) * clusters - 1) = centroids;
 
-    pointsUsed.assign(data.n_cols, false);
+      pointsUsed.assign(data.n_cols, false);
+    }
   }
 
   // Now, we run k-means on the sampled centroids to get our final clusters.
+  arma::Col<size_t> sampledAssignments;
+  arma::mat centroids;
+  KMeans<> kmeans;
+  kmeans.Threads() = threads;
   kmeans.Cluster(sampledCentroids, clusters, sampledAssignments, centroids);
 
   // Turn the final centroids into assignments.
   assignments.set_size(data.n_cols);
-  for (size_t i = 0; i < data.n_cols; ++i)
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t i = 0; i < (omp_size_t) data.n_cols; ++i)
   {
     // Find the closest centroid to this point.
     double minDistance = std::numeric_limits<double>::infinity();
@@ -0,0 +1,108 @@
+/**
+ * @file scalable_kmeans_plus_plus.hpp
+ *
+ * An implementation of the k-means|| (scalable k-means++) seeding strategy of
+ * Bahmani et al.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_SCALABLE_KMEANS_PLUS_PLUS_HPP
+#define __MLPACK_METHODS_KMEANS_SCALABLE_KMEANS_PLUS_PLUS_HPP
+
+#include <mlpack/core.hpp>
+#include "kmeans_plus_plus.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The k-means|| approach for choosing initial points for k-means clustering.
+ * Instead of choosing one centroid per pass over the dataset like k-means++,
+ * a small number of rounds is made, and in each round every point is chosen
+ * as a candidate independently, with probability proportional to its squared
+ * distance to the closest candidate so far.  About (oversampling * clusters)
+ * candidates are chosen in each round.  Each candidate is then weighted by the
+ * number of points closest to it, and the weighted candidates are reduced to
+ * the requested number of centroids with k-means++.  The distance updates in
+ * each round are done in parallel.  This is an implementation of the
+ * following paper:
+ *
+ * @code
+ * @article{bahmani2012scalable,
+ *   title={Scalable k-means++},
+ *   author={Bahmani, Bahman and Moseley, Benjamin and Vattani, Andrea and
+ *       Kumar, Ravi and Vassilvitskii, Sergei},
+ *   journal={Proceedings of the VLDB Endowment},
+ *   volume={5},
+ *   number={7},
+ *   pages={622--633},
+ *   year={2012}
+ * }
+ * @endcode
+ */
+class ScalableKMeansPlusPlus
+{
+ public:
+  /**
+   * Create the ScalableKMeansPlusPlus object, optionally specifying the
+   * oversampling factor, the number of rounds, and the number of threads.
+   *
+   * @param oversampling Expected number of candidates chosen in each round,
+   *     as a multiple of the number of clusters.
+   * @param rounds Number of sampling rounds.
+   * @param threads Number of threads to use (0 uses all available cores).
+   */
+  ScalableKMeansPlusPlus(const double oversampling = 2.0,
+                         const size_t rounds = 5,
+                         const size_t threads = 0) :
+      oversampling(oversampling),
+      rounds(rounds),
+      threads(threads)
+  {
+    // Nothing to do.
+  }
+
+  /**
+   * Partition the given dataset into the given number of clusters by choosing
+   * centroids with k-means|| and assigning each point to its closest centroid.
+   *
+   * @tparam MatType Type of data (arma::mat or arma::sp_mat).
+   * @param data Dataset to partition.
+   * @param clusters Number of clusters to split dataset into.
+   * @param assignments Vector to store cluster assignments into.  Values will
+   *     be between 0 and (clusters - 1).
+   */
+  template<typename MatType>
+  void Cluster(const MatType& data,
+               const size_t clusters,
+               arma::Col<size_t>& assignments) const;
+
+  //! Get the oversampling factor.
+  double Oversampling() const { return oversampling; }
+  //! Modify the oversampling factor.
+  double& Oversampling() { return oversampling; }
+
+  //! Get the number of sampling rounds.
+  size_t Rounds() const { return rounds; }
+  //! Modify the number of sampling rounds.
+  size_t& Rounds() { return rounds; }
+
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+ private:
+  //! The expected number of candidates per round, per cluster.
+  double oversampling;
+  //! The number of sampling rounds.
+  size_t rounds;
+  //! The number of threads to use.
+  size_t threads;
+};
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+// Include implementation.
+#include "scalable_kmeans_plus_plus_impl.hpp"
+
+#endif
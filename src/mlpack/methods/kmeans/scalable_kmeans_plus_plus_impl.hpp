@@ -0,0 +1,98 @@
+/**
+ * @file scalable_kmeans_plus_plus_impl.hpp
+ *
+ * Implementation of the k-means|| seeding strategy.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_SCALABLE_KMEANS_PLUS_PLUS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_SCALABLE_KMEANS_PLUS_PLUS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "scalable_kmeans_plus_plus.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MatType>
+void ScalableKMeansPlusPlus::Cluster(const MatType& data,
+                                     const size_t clusters,
+                                     arma::Col<size_t>& assignments) const
+{
+  // The closest candidate to each point, and the squared distance to it.
+  std::vector<size_t> candidates;
+  arma::vec distances(data.n_cols);
+  distances.fill(DBL_MAX);
+  arma::Col<size_t> closest(data.n_cols);
+  closest.zeros();
+  assignments.zeros(data.n_cols);
+
+  if (clusters == 0 || data.n_cols == 0)
+    return;
+
+  // Marks the points that are already candidates.
+  std::vector<char> isCandidate(data.n_cols, 0);
+
+  // The first candidate is a random point.
+  candidates.push_back((size_t) math::RandInt(data.n_cols));
+  isCandidate[candidates[0]] = 1;
+  UpdateClosestCentroids(data, candidates, 0, distances, closest, threads);
+
+  const double sampled = oversampling * clusters;
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    const double cost = arma::accu(distances);
+    if (cost == 0.0)
+      break; // Every point is a candidate already.
+
+    // Sampling is done serially so that the results only depend on the random
+    // seed and not on the number of threads.
+    const size_t first = candidates.size();
+    for (size_t i = 0; i < data.n_cols; ++i)
+    {
+      if (!isCandidate[i] && math::Random() * cost < sampled * distances[i])
+      {
+        candidates.push_back(i);
+        isCandidate[i] = 1;
+      }
+    }
+
+    UpdateClosestCentroids(data, candidates, first, distances, closest,
+        threads);
+  }
+
+  // If too few candidates were chosen, fill up with random points.
+  const size_t wanted = std::min(clusters, (size_t) data.n_cols);
+  while (candidates.size() < wanted)
+  {
+    const size_t point = (size_t) math::RandInt(data.n_cols);
+    if (!isCandidate[point])
+    {
+      candidates.push_back(point);
+      isCandidate[point] = 1;
+      UpdateClosestCentroids(data, candidates, candidates.size() - 1,
+          distances, closest, threads);
+    }
+  }
+
+  // Weight each candidate by the number of points closest to it.
+  arma::mat candidateSet(data.n_rows, candidates.size());
+  arma::vec weights(candidates.size());
+  weights.zeros();
+  for (size_t c = 0; c < candidates.size(); ++c)
+    candidateSet.col(c) = data.col(candidates[c]);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    ++weights[closest[i]];
+
+  // Reduce the candidates to the final centroids, and give each point the
+  // centroid of its closest candidate.
+  arma::Col<size_t> candidateAssignments;
+  KMeansPlusPlus(threads).Cluster(candidateSet, clusters, weights,
+      candidateAssignments);
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+    assignments[i] = candidateAssignments[closest[i]];
+}
+
+}; // namespace kmeans
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ * @file sparse_kmeans.hpp
+ *
+ * A step of the Lloyd algorithm for k-means clustering of sparse data, whose
+ * cost depends on the number of nonzero elements of the points instead of
+ * their dimensionality.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_SPARSE_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_SPARSE_KMEANS_HPP
+
+#include <mlpack/core/metrics/lmetric.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * An implementation of a single iteration of Lloyd's algorithm for sparse data
+ * (such as TF-IDF vectors of documents), to be used as the LloydStepType of
+ * KMeans with MatType = arma::sp_mat.  The centroids are dense, but for the
+ * Euclidean and squared Euclidean distances nothing is done with all of their
+ * dimensions for each point: since
+ *
+ * @f[
+ * || x - c ||^2 = || x ||^2 + || c ||^2 - 2 x^T c,
+ * @f]
+ *
+ * the closest centroid to x is the one with the smallest
+ * @f$ || c ||^2 - 2 x^T c @f$.  The squared norms of the centroids are computed
+ * once for each iteration, and the dot products with a point only need its
+ * nonzero elements, so an iteration takes O(k * nnz) time instead of
+ * O(k * n * d).  Adding the points to the new centroids also only needs their
+ * nonzero elements; the points of each cluster are added straight into its new
+ * centroid (the clusters are split between the threads), so no dense space is
+ * needed other than the centroids.  Because of the rounding error of the
+ * expansion, a point which is almost equally close to two centroids may be
+ * assigned to the other one.
+ *
+ * KMeans also uses Assign() to find the final assignments of the points, so
+ * that whole clustering scales with the number of nonzero elements.
+ *
+ * With other metrics, the closest centroids are found with the metric, as
+ * NaiveKMeans does; only the update of the centroids uses the sparsity.
+ *
+ * @code
+ * KMeans<metric::SquaredEuclideanDistance, RandomPartition,
+ *     MaxVarianceNewCluster, SparseKMeans, arma::sp_mat> kmeans;
+ * kmeans.Cluster(documents, 100, assignments);
+ * @endcode
+ *
+ * @tparam MetricType Type of metric used with this implementation.
+ * @tparam MatType Sparse matrix type (arma::sp_mat).
+ */
+template<typename MetricType, typename MatType>
+class SparseKMeans
+{
+ public:
+  /**
+   * Construct the SparseKMeans object with the given dataset and metric.
+   *
+   * @param dataset Dataset.
+   * @param metric Instantiated metric.
+   */
+  SparseKMeans(const MatType& dataset, MetricType& metric);
+
+  /**
+   * Run a single iteration of the Lloyd algorithm, updating the given centroids
+   * into the newCentroids matrix.
+   *
+   * @param centroids Current cluster centroids.
+   * @param newCentroids New cluster centroids.
+   * @param counts Current counts, to be overwritten with new counts.
+   */
+  double Iterate(const arma::mat& centroids,
+                 arma::mat& newCentroids,
+                 arma::Col<size_t>& counts);
+
+  /**
+   * Find the closest centroid to each point of the dataset.
+   *
+   * @param centroids Cluster centroids.
+   * @param assignments Vector to store the closest centroid of each point in.
+   */
+  void Assign(const arma::mat& centroids, arma::Col<size_t>& assignments);
+
+  size_t DistanceCalculations() const { return distanceCalculations; }
+
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+ private:
+  //! The dataset.
+  const MatType& dataset;
+  //! The instantiated metric.
+  MetricType& metric;
+
+  //! Number of distance calculations.
+  size_t distanceCalculations;
+  //! The number of threads to use.
+  size_t threads;
+
+  //! The current centroids, transposed, so that the elements of all the
+  //! centroids in one dimension are contiguous.
+  arma::mat centroidsT;
+  //! The squared norms of the current centroids (DBL_MAX for the invalid
+  //! centroids of empty clusters).
+  arma::vec centroidNorms;
+
+  //! Compute centroidsT and centroidNorms for the given centroids.
+  void PrepareCentroids(const arma::mat& centroids);
+
+  /**
+   * Find the closest centroid to the given point from its dot products with the
+   * centroids, for the Euclidean and squared Euclidean distances.
+   *
+   * @param metric Instantiated metric (not used).
+   * @param centroids Current cluster centroids.
+   * @param point Index of the point.
+   * @param dots Buffer for the dot products (one for each centroid).
+   */
+  template<bool TakeRoot>
+  size_t ClosestCentroid(metric::LMetric<2, TakeRoot>& metric,
+                         const arma::mat& centroids,
+                         const size_t point,
+                         arma::vec& dots) const;
+
+  //! Find the closest centroid to the given point with any other metric.
+  template<typename MT>
+  size_t ClosestCentroid(MT& metric,
+                         const arma::mat& centroids,
+                         const size_t point,
+                         arma::vec& dots) const;
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+// Include implementation.
+#include "sparse_kmeans_impl.hpp"
+
+#endif
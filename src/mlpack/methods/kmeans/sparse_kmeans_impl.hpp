@@ -0,0 +1,210 @@
+/**
+ * @file sparse_kmeans_impl.hpp
+ *
+ * Implementation of the SparseKMeans step of the Lloyd algorithm.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_SPARSE_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_SPARSE_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "sparse_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename MatType>
+SparseKMeans<MetricType, MatType>::SparseKMeans(const MatType& dataset,
+                                                MetricType& metric) :
+    dataset(dataset),
+    metric(metric),
+    distanceCalculations(0),
+    threads(0)
+{ /* Nothing to do. */ }
+
+// Run a single iteration.
+template<typename MetricType, typename MatType>
+double SparseKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
+                                                  arma::mat& newCentroids,
+                                                  arma::Col<size_t>& counts)
+{
+  newCentroids.zeros(centroids.n_rows, centroids.n_cols);
+  counts.zeros(centroids.n_cols);
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Find the closest centroid to each point first.  Then the points of each
+  // cluster are added up in order by whichever thread takes the cluster, so the
+  // result does not depend on the number of threads, and the only dense space
+  // needed is newCentroids itself (one copy of the centroids for each block of
+  // points would be far too much for data with millions of dimensions).
+  arma::Col<size_t> assignments;
+  Assign(centroids, assignments);
+
+  // Sort the points by cluster (stably, with a counting sort).
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    counts[assignments[i]]++;
+
+  arma::Col<size_t> offsets(centroids.n_cols + 1);
+  offsets[0] = 0;
+  for (size_t c = 0; c < centroids.n_cols; ++c)
+    offsets[c + 1] = offsets[c] + counts[c];
+
+  arma::Col<size_t> order(dataset.n_cols);
+  arma::Col<size_t> next = offsets.subvec(0, centroids.n_cols - 1);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    order[next[assignments[i]]++] = i;
+
+  // Only the nonzero elements of each point change its centroid.
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t c = 0; c < (omp_size_t) centroids.n_cols; ++c)
+  {
+    double* sums = newCentroids.colptr(c);
+    for (size_t j = offsets[c]; j < offsets[c + 1]; ++j)
+    {
+      const size_t i = order[j];
+      for (typename MatType::const_iterator it = dataset.begin_col(i);
+           it != dataset.end_col(i); ++it)
+        sums[it.row()] += (*it);
+    }
+  }
+
+  // Now normalize the centroid.
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+    if (counts(i) != 0)
+      newCentroids.col(i) /= counts(i);
+    else
+      newCentroids.col(i).fill(DBL_MAX); // Invalid value.
+
+  // Calculate cluster distortion for this iteration.
+  double cNorm = 0.0;
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+  {
+    cNorm += std::pow(metric.Evaluate(centroids.col(i), newCentroids.col(i)),
+        2.0);
+  }
+  distanceCalculations += centroids.n_cols;
+
+  return std::sqrt(cNorm);
+}
+
+template<typename MetricType, typename MatType>
+void SparseKMeans<MetricType, MatType>::Assign(const arma::mat& centroids,
+                                               arma::Col<size_t>& assignments)
+{
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  PrepareCentroids(centroids);
+  assignments.set_size(dataset.n_cols);
+
+  #pragma omp parallel num_threads(numThreads)
+  {
+    arma::vec dots(centroids.n_cols);
+
+    #pragma omp for schedule(static)
+    for (omp_size_t i = 0; i < (omp_size_t) dataset.n_cols; ++i)
+    {
+      assignments[i] = ClosestCentroid(metric, centroids, i, dots);
+      Log::Assert(assignments[i] != centroids.n_cols);
+    }
+  }
+
+  distanceCalculations += centroids.n_cols * dataset.n_cols;
+}
+
+template<typename MetricType, typename MatType>
+void SparseKMeans<MetricType, MatType>::PrepareCentroids(
+    const arma::mat& centroids)
+{
+  centroidsT = centroids.t();
+  centroidNorms.set_size(centroids.n_cols);
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+  {
+    // Empty clusters may have been left with invalid centroids (filled with
+    // DBL_MAX), which would overflow the norm; no point is closest to them.
+    if (centroids(0, i) == DBL_MAX)
+    {
+      centroidsT.row(i).zeros();
+      centroidNorms[i] = DBL_MAX;
+    }
+    else
+    {
+      centroidNorms[i] = arma::dot(centroids.col(i), centroids.col(i));
+    }
+  }
+}
+
+template<typename MetricType, typename MatType>
+template<bool TakeRoot>
+size_t SparseKMeans<MetricType, MatType>::ClosestCentroid(
+    metric::LMetric<2, TakeRoot>& /* metric */,
+    const arma::mat& centroids,
+    const size_t point,
+    arma::vec& dots) const
+{
+  // Each nonzero element of the point adds to the dot product with every
+  // centroid; the elements of the centroids in that dimension are a column of
+  // centroidsT.
+  dots.zeros();
+  for (typename MatType::const_iterator it = dataset.begin_col(point);
+       it != dataset.end_col(point); ++it)
+  {
+    const double value = (*it);
+    const double* dimension = centroidsT.colptr(it.row());
+    for (size_t j = 0; j < centroids.n_cols; ++j)
+      dots[j] += value * dimension[j];
+  }
+
+  // The squared norm of the point is the same for every centroid, so it is
+  // left out.
+  size_t closestCluster = centroids.n_cols; // Invalid value.
+  double minDistance = DBL_MAX;
+  for (size_t j = 0; j < centroids.n_cols; ++j)
+  {
+    const double distance = centroidNorms[j] - 2.0 * dots[j];
+    if (distance < minDistance)
+    {
+      minDistance = distance;
+      closestCluster = j;
+    }
+  }
+
+  return closestCluster;
+}
+
+template<typename MetricType, typename MatType>
+template<typename MT>
+size_t SparseKMeans<MetricType, MatType>::ClosestCentroid(
+    MT& metric,
+    const arma::mat& centroids,
+    const size_t point,
+    arma::vec& /* dots */) const
+{
+  size_t closestCluster = centroids.n_cols; // Invalid value.
+  double minDistance = std::numeric_limits<double>::infinity();
+  for (size_t j = 0; j < centroids.n_cols; ++j)
+  {
+    const double distance = metric.Evaluate(dataset.col(point),
+        centroids.col(j));
+
+    if (distance < minDistance)
+    {
+      minDistance = distance;
+      closestCluster = j;
+    }
+  }
+
+  return closestCluster;
+}
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file yinyang_kmeans.hpp
+ *
+ * An implementation of Yinyang k-means, which keeps lower bounds on the
+ * distances to groups of centroids instead of to every centroid, so that large
+ * numbers of clusters can be pruned with little memory.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_YINYANG_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_YINYANG_KMEANS_HPP
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * An implementation of a single iteration of the Lloyd algorithm with the
+ * group filter of Yinyang k-means:
+ *
+ * @code
+ * @inproceedings{ding2015yinyang,
+ *   title={Yinyang K-Means: A Drop-In Replacement of the Classic K-Means with
+ *       Consistent Speedup},
+ *   author={Ding, Yufei and Zhao, Yue and Shen, Xipeng and Musuvathi, Madanlal
+ *       and Mytkowicz, Todd},
+ *   booktitle={Proceedings of the 32nd International Conference on Machine
+ *       Learning (ICML '15)},
+ *   pages={579--587},
+ *   year={2015}
+ * }
+ * @endcode
+ *
+ * ElkanKMeans keeps a lower bound on the distance between every point and
+ * every centroid, which takes O(k * n) memory and is too much for large k.
+ * Here the centroids are split into g groups (by clustering the initial
+ * centroids), and each point keeps one lower bound for each group: a bound on
+ * its distance to every centroid of the group other than its own.  So only
+ * O(g * n) memory is needed.  After each iteration, the bound for a group is
+ * lowered by the most that any of its centroids moved.  A point whose upper
+ * bound is below all of its group bounds keeps its centroid; otherwise, only
+ * the groups whose bounds are below the (tightened) upper bound are searched.
+ * With g = k this prunes like Elkan's algorithm; with g = 1 it is close to
+ * Hamerly's.  The default number of groups is k / 10, as suggested by the
+ * paper.
+ *
+ * The paper's local filter (which prunes single centroids inside a searched
+ * group) is not used, since it needs the distance moved by each centroid for
+ * each point.
+ *
+ * @tparam MetricType Type of metric used with this implementation.
+ * @tparam MatType Matrix type (arma::mat or arma::sp_mat).
+ */
+template<typename MetricType, typename MatType>
+class YinyangKMeans
+{
+ public:
+  /**
+   * Construct the YinyangKMeans object, which must store several sets of
+   * bounds.
+   */
+  YinyangKMeans(const MatType& dataset, MetricType& metric);
+
+  /**
+   * Run a single iteration of Yinyang k-means, updating the given centroids
+   * into the newCentroids matrix.
+   *
+   * @param centroids Current cluster centroids.
+   * @param newCentroids New cluster centroids.
+   * @param counts Current counts, to be overwritten with new counts.
+   */
+  double Iterate(const arma::mat& centroids,
+                 arma::mat& newCentroids,
+                 arma::Col<size_t>& counts);
+
+  size_t DistanceCalculations() const { return distanceCalculations; }
+
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
+  //! Get the number of groups of centroids (0 means k / 10, or 1 if that is
+  //! 0).
+  size_t Groups() const { return groups; }
+  //! Modify the number of groups of centroids (0 means k / 10, or 1 if that is
+  //! 0).  This is used when the groups are formed, in the first iteration; it
+  //! can be at most the number of clusters.
+  size_t& Groups() { return groups; }
+
+ private:
+  //! The dataset.
+  const MatType& dataset;
+  //! The instantiated metric.
+  MetricType& metric;
+
+  //! The number of groups to form (0 means the default).
+  size_t groups;
+  //! The group of each centroid.
+  arma::Col<size_t> centroidGroups;
+  //! The centroids in each group.
+  std::vector<std::vector<size_t> > groupMembers;
+
+  //! Holds the index of the cluster that owns each point.
+  arma::Col<size_t> assignments;
+  //! Upper bounds on the distance between each point and its closest cluster.
+  arma::vec upperBounds;
+  //! Lower bounds on the distance between each point and the centroids of
+  //! each group, other than the centroid it is assigned to.
+  arma::mat lowerBounds;
+  //! The centroids returned by the last iteration.
+  arma::mat lastCentroids;
+
+  //! Track distance calculations.
+  size_t distanceCalculations;
+  //! The number of threads to use.
+  size_t threads;
+
+  /**
+   * Split the centroids into groups, with a few iterations of the Lloyd
+   * algorithm on the centroids themselves.
+   */
+  void GroupCentroids(const arma::mat& centroids);
+
+  /**
+   * Move the bounds of every point by the given distances moved by each
+   * centroid.
+   */
+  void MoveBounds(const arma::vec& moveDistances, const size_t numThreads);
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+// Include implementation.
+#include "yinyang_kmeans_impl.hpp"
+
+#endif
@@ -0,0 +1,297 @@
+/**
+ * @file yinyang_kmeans_impl.hpp
+ *
+ * Implementation of the YinyangKMeans step of the Lloyd algorithm.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_YINYANG_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_YINYANG_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "yinyang_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename MatType>
+YinyangKMeans<MetricType, MatType>::YinyangKMeans(const MatType& dataset,
+                                                  MetricType& metric) :
+    dataset(dataset),
+    metric(metric),
+    groups(0),
+    distanceCalculations(0),
+    threads(0)
+{ /* Nothing to do. */ }
+
+// Run a single iteration.
+template<typename MetricType, typename MatType>
+double YinyangKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
+                                                   arma::mat& newCentroids,
+                                                   arma::Col<size_t>& counts)
+{
+  newCentroids.zeros(centroids.n_rows, centroids.n_cols);
+  counts.zeros(centroids.n_cols);
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // If this is the first iteration, form the groups and reset all the bounds.
+  // A lower bound of 0 holds for anything, and an upper bound of DBL_MAX means
+  // that every group is searched.
+  if (centroidGroups.n_elem != centroids.n_cols ||
+      assignments.n_elem != dataset.n_cols)
+  {
+    GroupCentroids(centroids);
+
+    lowerBounds.zeros(groupMembers.size(), dataset.n_cols);
+    upperBounds.set_size(dataset.n_cols);
+    upperBounds.fill(DBL_MAX);
+    assignments.zeros(dataset.n_cols);
+  }
+  else if (arma::any(arma::vectorise(centroids != lastCentroids)))
+  {
+    // The centroids were changed since the last iteration (by an empty cluster
+    // policy, or by distributed k-means), so the bounds must also account for
+    // how far they were moved.
+    arma::vec changes(centroids.n_cols);
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+      changes(c) = metric.Evaluate(lastCentroids.col(c), centroids.col(c));
+    distanceCalculations += centroids.n_cols;
+
+    MoveBounds(changes, numThreads);
+  }
+
+  // As in ElkanKMeans, each block of points sums into its own copies of the
+  // centroids and counts, which a util::TreeReducer adds as the blocks finish,
+  // so the result does not depend on the number of threads.  The bounds of each
+  // point are only touched by the block holding that point.
+  const size_t numGroups = groupMembers.size();
+  const size_t blocks = util::ReductionBlocks(dataset.n_cols);
+  std::vector<arma::mat> blockCentroids(blocks);
+  std::vector<arma::Col<size_t> > blockCounts(blocks);
+  util::TreeReducer<arma::mat> centroidReducer(blockCentroids);
+  util::TreeReducer<arma::Col<size_t> > countReducer(blockCounts);
+  size_t calculations = 0;
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic) \
+      reduction(+:calculations)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+  {
+    arma::mat& sums = blockCentroids[b];
+    arma::Col<size_t>& sizes = blockCounts[b];
+    sums.zeros(centroids.n_rows, centroids.n_cols);
+    sizes.zeros(centroids.n_cols);
+
+    // The closest and second closest distances in each searched group.
+    std::vector<char> searched(numGroups);
+    std::vector<double> groupMin(numGroups);
+    std::vector<size_t> groupMinIndex(numGroups);
+    std::vector<double> groupSecond(numGroups);
+
+    const size_t begin = b * dataset.n_cols / blocks;
+    const size_t end = (b + 1) * dataset.n_cols / blocks;
+    for (size_t i = begin; i < end; ++i)
+    {
+      double* bounds = lowerBounds.colptr(i);
+      const size_t assignment = assignments[i];
+
+      double globalBound = DBL_MAX;
+      for (size_t g = 0; g < numGroups; ++g)
+        globalBound = std::min(globalBound, bounds[g]);
+
+      // Global filter: if no group can hold a closer centroid, the point stays
+      // where it is.  Otherwise, tighten the upper bound and try again.
+      if (upperBounds(i) > globalBound)
+      {
+        const double distance = metric.Evaluate(dataset.col(i),
+            centroids.col(assignment));
+        ++calculations;
+        upperBounds(i) = distance;
+
+        if (distance > globalBound)
+        {
+          // Group filter: search only the groups whose bound is below the
+          // distance to the closest centroid found so far.
+          size_t closest = assignment;
+          double closestDistance = distance;
+          for (size_t g = 0; g < numGroups; ++g)
+          {
+            searched[g] = (bounds[g] < closestDistance);
+            if (!searched[g])
+              continue;
+
+            groupMin[g] = DBL_MAX;
+            groupMinIndex[g] = centroids.n_cols; // Invalid value.
+            groupSecond[g] = DBL_MAX;
+            for (size_t j = 0; j < groupMembers[g].size(); ++j)
+            {
+              const size_t c = groupMembers[g][j];
+              double d = distance;
+              if (c != assignment)
+              {
+                d = metric.Evaluate(dataset.col(i), centroids.col(c));
+                ++calculations;
+              }
+
+              if (d < groupMin[g])
+              {
+                groupSecond[g] = groupMin[g];
+                groupMin[g] = d;
+                groupMinIndex[g] = c;
+              }
+              else if (d < groupSecond[g])
+              {
+                groupSecond[g] = d;
+              }
+            }
+
+            if (groupMin[g] < closestDistance)
+            {
+              closestDistance = groupMin[g];
+              closest = groupMinIndex[g];
+            }
+          }
+
+          // The bound of each searched group is now exact for every centroid
+          // of the group but the new assignment.
+          for (size_t g = 0; g < numGroups; ++g)
+            if (searched[g])
+              bounds[g] = (groupMinIndex[g] == closest) ? groupSecond[g] :
+                  groupMin[g];
+
+          // If the point moved, its old centroid is now one of the others in
+          // its group.
+          const size_t oldGroup = centroidGroups[assignment];
+          if (closest != assignment && !searched[oldGroup])
+            bounds[oldGroup] = std::min(bounds[oldGroup], distance);
+
+          assignments[i] = closest;
+          upperBounds(i) = closestDistance;
+        }
+      }
+
+      sums.col(assignments[i]) += arma::vec(dataset.col(i));
+      sizes[assignments[i]]++;
+    }
+
+    centroidReducer.Finish(b);
+    countReducer.Finish(b);
+  }
+
+  newCentroids.swap(blockCentroids[0]);
+  counts.swap(blockCounts[0]);
+  distanceCalculations += calculations;
+
+  // Now, normalize and calculate the distance each cluster has moved.
+  arma::vec moveDistances(centroids.n_cols);
+  double cNorm = 0.0; // Cluster movement for residual.
+  for (size_t c = 0; c < centroids.n_cols; ++c)
+  {
+    if (counts[c] > 0)
+      newCentroids.col(c) /= counts[c];
+    else
+      newCentroids.col(c).fill(DBL_MAX); // Fill with invalid value.
+
+    moveDistances(c) = metric.Evaluate(newCentroids.col(c), centroids.col(c));
+    cNorm += std::pow(moveDistances(c), 2.0);
+    distanceCalculations++;
+  }
+
+  MoveBounds(moveDistances, numThreads);
+  lastCentroids = newCentroids;
+
+  return std::sqrt(cNorm);
+}
+
+template<typename MetricType, typename MatType>
+void YinyangKMeans<MetricType, MatType>::GroupCentroids(
+    const arma::mat& centroids)
+{
+  const size_t k = centroids.n_cols;
+  size_t numGroups = (groups == 0) ? (k / 10) : groups;
+  numGroups = std::max(std::min(numGroups, k), (size_t) 1);
+
+  // Start from centroids spread over the list, and run a few Lloyd iterations.
+  arma::mat groupCentroids(centroids.n_rows, numGroups);
+  for (size_t g = 0; g < numGroups; ++g)
+    groupCentroids.col(g) = centroids.col(g * k / numGroups);
+
+  centroidGroups.zeros(k);
+  for (size_t iteration = 0; iteration < 5; ++iteration)
+  {
+    for (size_t c = 0; c < k; ++c)
+    {
+      double minDistance = DBL_MAX;
+      for (size_t g = 0; g < numGroups; ++g)
+      {
+        const double distance = metric.Evaluate(centroids.col(c),
+            groupCentroids.col(g));
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          centroidGroups[c] = g;
+        }
+      }
+    }
+    distanceCalculations += k * numGroups;
+
+    // An empty group keeps its old centroid.
+    arma::mat sums;
+    sums.zeros(centroids.n_rows, numGroups);
+    arma::Col<size_t> sizes;
+    sizes.zeros(numGroups);
+    for (size_t c = 0; c < k; ++c)
+    {
+      sums.col(centroidGroups[c]) += centroids.col(c);
+      sizes[centroidGroups[c]]++;
+    }
+
+    for (size_t g = 0; g < numGroups; ++g)
+      if (sizes[g] > 0)
+        groupCentroids.col(g) = sums.col(g) / sizes[g];
+  }
+
+  groupMembers.clear();
+  groupMembers.resize(numGroups);
+  for (size_t c = 0; c < k; ++c)
+    groupMembers[centroidGroups[c]].push_back(c);
+
+  Log::Info << "YinyangKMeans: split " << k << " centroids into " << numGroups
+      << " groups." << std::endl;
+}
+
+template<typename MetricType, typename MatType>
+void YinyangKMeans<MetricType, MatType>::MoveBounds(
+    const arma::vec& moveDistances,
+    const size_t numThreads)
+{
+  // The bound of a group drops by the most that any of its centroids moved.
+  arma::vec groupMoves;
+  groupMoves.zeros(groupMembers.size());
+  for (size_t c = 0; c < moveDistances.n_elem; ++c)
+    groupMoves[centroidGroups[c]] = std::max(groupMoves[centroidGroups[c]],
+        moveDistances[c]);
+
+  #pragma omp parallel for num_threads(numThreads)
+  for (omp_size_t i = 0; i < (omp_size_t) dataset.n_cols; ++i)
+  {
+    // A bound that drops below 0 holds no information, and one that cannot be
+    // computed (because an invalid centroid moved an infinite distance) must
+    // not be used, so both are set to 0.
+    double* bounds = lowerBounds.colptr(i);
+    for (size_t g = 0; g < groupMoves.n_elem; ++g)
+    {
+      const double bound = bounds[g] - groupMoves[g];
+      bounds[g] = (bound > 0.0) ? bound : 0.0;
+    }
+
+    upperBounds(i) += moveDistances(assignments[i]);
+  }
+}
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -19,7 +19,10 @@ LARS::LARS(const bool useCholesky,
     lambda1(lambda1),
     elasticNet((lambda1 != 0) && (lambda2 != 0)),
     lambda2(lambda2),
-    tolerance(tolerance)
+    tolerance(tolerance),
+    cacheGram(true),
+    storePath(true),
+    threads(0)
 { /* Nothing left to do. */ }
 
 LARS::LARS(const bool useCholesky,
@@ -33,7 +36,10 @@ LARS::LARS(const bool useCholesky,
     lambda1(lambda1),
     elasticNet((lambda1 != 0) && (lambda2 != 0)),
     lambda2(lambda2),
-    tolerance(tolerance)
+    tolerance(tolerance),
+    cacheGram(true),
+    storePath(true),
+    threads(0)
 { /* Nothing left to do */ }
 
 void LARS::Regress(const arma::mat& matX,
@@ -51,7 +57,8 @@ void LARS::Regress(const arma::mat& matX,
     dataTrans = trans(matX);
 
   // Compute X' * y.
-  arma::vec vecXTy = trans(dataRef) * y;
+  arma::vec vecXTy;
+  ComputeCorrelations(dataRef, y, vecXTy);
 
   // Set up active set variables.  In the beginning, the active set has size 0
   // (all dimensions are inactive).
@@ -80,20 +87,21 @@ void LARS::Regress(const arma::mat& matX,
     }
   }
 
-  betaPath.push_back(beta);
-  lambdaPath.push_back(maxCorr);
+  AddToPath(beta, maxCorr);
 
   // If the maximum correlation is too small, there is no reason to continue.
   if (maxCorr < lambda1)
   {
-    lambdaPath[0] = lambda1;
+    lambdaPath.back() = lambda1;
     Timer::Stop("lars_regression");
     return;
   }
 
   // Compute the Gram matrix.  If this is the elastic net problem, we will add
-  // lambda2 * I_n to the matrix.
-  if (matGram.n_elem == 0)
+  // lambda2 * I_n to the matrix.  If the Gram matrix is not cached, only the
+  // entries that are needed are computed from the data as we go.
+  matGramActive.reset();
+  if ((matGram.n_elem == 0) && cacheGram)
   {
     // In this case, matGram should reference matGramInternal.
     matGramInternal = trans(dataRef) * dataRef;
@@ -121,16 +129,31 @@ void LARS::Regress(const arma::mat& matX,
     {
       if (useCholesky)
       {
-        // vec newGramCol = vec(activeSet.size());
-        // for (size_t i = 0; i < activeSet.size(); i++)
-        // {
-        //   newGramCol[i] = dot(matX.col(activeSet[i]), matX.col(changeInd));
-        // }
-        // This is equivalent to the above 5 lines.
-        arma::vec newGramCol = matGram.elem(changeInd * dataRef.n_cols +
-            arma::conv_to<arma::uvec>::from(activeSet));
-
-        CholeskyInsert(matGram(changeInd, changeInd), newGramCol);
+        arma::vec newGramCol;
+        double sqNormNewX;
+        if (matGram.n_elem != 0)
+        {
+          // vec newGramCol = vec(activeSet.size());
+          // for (size_t i = 0; i < activeSet.size(); i++)
+          // {
+          //   newGramCol[i] = dot(matX.col(activeSet[i]), matX.col(changeInd));
+          // }
+          // This is equivalent to the above 5 lines.
+          newGramCol = matGram.elem(changeInd * dataRef.n_cols +
+              arma::conv_to<arma::uvec>::from(activeSet));
+          sqNormNewX = matGram(changeInd, changeInd);
+        }
+        else
+        {
+          ComputeGramColumn(dataRef, changeInd, newGramCol);
+          sqNormNewX = dot(dataRef.col(changeInd), dataRef.col(changeInd));
+        }
+
+        CholeskyInsert(sqNormNewX, newGramCol);
+      }
+      else if (matGram.n_elem == 0)
+      {
+        GramInsert(dataRef, changeInd);
       }
 
       // Add variable to active set.
@@ -188,10 +211,14 @@ void LARS::Regress(const arma::mat& matX,
     }
     else
     {
-      arma::mat matGramActive = arma::mat(activeSet.size(), activeSet.size());
-      for (size_t i = 0; i < activeSet.size(); i++)
-        for (size_t j = 0; j < activeSet.size(); j++)
-          matGramActive(i, j) = matGram(activeSet[i], activeSet[j]);
+      // Without a cached Gram matrix, matGramActive is already up to date.
+      if (matGram.n_elem != 0)
+      {
+        matGramActive.set_size(activeSet.size(), activeSet.size());
+        for (size_t i = 0; i < activeSet.size(); i++)
+          for (size_t j = 0; j < activeSet.size(); j++)
+            matGramActive(i, j) = matGram(activeSet[i], activeSet[j]);
+      }
 
       // Check for singularity.
       arma::mat matS = s * arma::ones<arma::mat>(1, activeSet.size());
@@ -208,6 +235,8 @@ void LARS::Regress(const arma::mat& matX,
       {
         // Singularity, so remove variable from active set, add to ignores set,
         // and look for new variable to add.
+        if (matGram.n_elem == 0)
+          GramDelete(activeSet.size() - 1);
         Deactivate(activeSet.size() - 1);
         Ignore(changeInd);
         Log::Warn << "Encountered singularity when adding variable "
@@ -226,14 +255,15 @@ void LARS::Regress(const arma::mat& matX,
     if ((activeSet.size() + ignoreSet.size()) < dataRef.n_cols)
     {
       // Compute correlations with direction.
+      arma::vec dirCorr;
+      ComputeCorrelations(dataRef, yHatDirection, dirCorr);
       for (size_t ind = 0; ind < dataRef.n_cols; ind++)
       {
         if (isActive[ind] || isIgnored[ind])
           continue;
 
-        double dirCorr = dot(dataRef.col(ind), yHatDirection);
-        double val1 = (maxCorr - corr(ind)) / (normalization - dirCorr);
-        double val2 = (maxCorr + corr(ind)) / (normalization + dirCorr);
+        double val1 = (maxCorr - corr(ind)) / (normalization - dirCorr(ind));
+        double val2 = (maxCorr + corr(ind)) / (normalization + dirCorr(ind));
         if ((val1 > 0) && (val1 < gamma))
           gamma = val1;
         if ((val2 > 0) && (val2 < gamma))
@@ -282,18 +312,19 @@ void LARS::Regress(const arma::mat& matX,
         beta(activeSet[changeInd]) = 0;
     }
 
-    betaPath.push_back(beta);
-
     if (lassocond)
     {
       // Index is in position changeInd in activeSet.
       if (useCholesky)
         CholeskyDelete(changeInd);
+      else if (matGram.n_elem == 0)
+        GramDelete(changeInd);
 
       Deactivate(changeInd);
     }
 
-    corr = vecXTy - trans(dataRef) * yHat;
+    ComputeCorrelations(dataRef, yHat, corr);
+    corr = vecXTy - corr;
     if (elasticNet)
       corr -= lambda2 * beta;
 
@@ -303,7 +334,7 @@ void LARS::Regress(const arma::mat& matX,
 
     curLambda /= ((double) activeSet.size());
 
-    lambdaPath.push_back(curLambda);
+    AddToPath(beta, curLambda);
 
     // Time to stop for LASSO?
     if (lasso)
@@ -341,6 +372,85 @@ void LARS::Ignore(const size_t varInd)
   ignoreSet.push_back(varInd);
 }
 
+void LARS::ComputeCorrelations(const arma::mat& matX,
+                               const arma::vec& v,
+                               arma::vec& correlations) const
+{
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  if (numThreads == 1)
+  {
+    correlations = trans(matX) * v;
+    return;
+  }
+
+  // Each dimension is independent, so the columns are split among the threads.
+  correlations.set_size(matX.n_cols);
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t i = 0; i < (omp_size_t) matX.n_cols; ++i)
+    correlations[i] = dot(matX.col(i), v);
+}
+
+void LARS::ComputeGramColumn(const arma::mat& matX,
+                             const size_t varInd,
+                             arma::vec& newGramCol) const
+{
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  newGramCol.set_size(activeSet.size());
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t i = 0; i < (omp_size_t) activeSet.size(); ++i)
+    newGramCol[i] = dot(matX.col(activeSet[i]), matX.col(varInd));
+}
+
+void LARS::GramInsert(const arma::mat& matX, const size_t varInd)
+{
+  arma::vec newGramCol;
+  ComputeGramColumn(matX, varInd, newGramCol);
+
+  const size_t n = matGramActive.n_rows;
+  matGramActive.resize(n + 1, n + 1);
+  for (size_t i = 0; i < n; ++i)
+  {
+    matGramActive(i, n) = newGramCol[i];
+    matGramActive(n, i) = newGramCol[i];
+  }
+
+  // For the elastic net, the Gram matrix has lambda2 * I_n added to it.
+  matGramActive(n, n) = dot(matX.col(varInd), matX.col(varInd));
+  if (elasticNet)
+    matGramActive(n, n) += lambda2;
+}
+
+void LARS::GramDelete(const size_t activeVarInd)
+{
+  matGramActive.shed_row(activeVarInd);
+  matGramActive.shed_col(activeVarInd);
+}
+
+void LARS::AddToPath(const arma::vec& beta, const double lambda)
+{
+  // InterpolateBeta() needs the last two solutions, so those are always kept.
+  while (!storePath && (betaPath.size() >= 2))
+  {
+    betaPath.erase(betaPath.begin());
+    lambdaPath.erase(lambdaPath.begin());
+  }
+
+  betaPath.push_back(beta);
+  lambdaPath.push_back(lambda);
+}
+
 void LARS::ComputeYHatDirection(const arma::mat& matX,
                                 const arma::vec& betaDirection,
                                 arma::vec& yHatDirection)
@@ -485,6 +595,9 @@ std::string LARS::ToString() const
   convert << "  Gram Matrix: " << matGram.n_rows << "x" << matGram.n_cols;
   convert << std::endl;
   convert << "  Tolerance: " << tolerance << std::endl;
+  convert << "  Cache Gram Matrix: " << cacheGram << std::endl;
+  convert << "  Store Path: " << storePath << std::endl;
+  convert << "  Threads: " << threads << std::endl;
   return convert.str();
 }
 
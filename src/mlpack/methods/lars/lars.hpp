@@ -80,6 +80,14 @@ namespace regression {
  *   publisher={Royal Statistical Society}
  * }
  * @endcode
+ *
+ * For data with very many dimensions, the full Gram matrix \f$ X^T X \f$ may not
+ * fit in memory.  If CacheGram() is set to false (and no Gram matrix is given),
+ * only the Gram entries of the active set are computed, from the data, as
+ * dimensions enter and leave it.  The correlations \f$ X^T r \f$ are computed
+ * in parallel with Threads() threads if OpenMP is available, and if only the
+ * solution for lambda1 is needed, StorePath() can be set to false so that the
+ * whole solution path is not kept.
  */
 class LARS
 {
@@ -140,16 +148,33 @@ class LARS
   const std::vector<size_t>& ActiveSet() const { return activeSet; }
 
   //! Access the set of coefficients after each iteration; the solution is the
-  //! last element.
+  //! last element.  If StorePath() is false, only the last two are kept.
   const std::vector<arma::vec>& BetaPath() const { return betaPath; }
 
   //! Access the set of values for lambda1 after each iteration; the solution is
-  //! the last element.
+  //! the last element.  If StorePath() is false, only the last two are kept.
   const std::vector<double>& LambdaPath() const { return lambdaPath; }
 
   //! Access the upper triangular cholesky factor
   const arma::mat& MatUtriCholFactor() const { return matUtriCholFactor; }
 
+  //! Get whether the full Gram matrix is computed when none was given.
+  bool CacheGram() const { return cacheGram; }
+  //! Modify whether the full Gram matrix is computed when none was given.
+  bool& CacheGram() { return cacheGram; }
+
+  //! Get whether every solution on the path is stored (otherwise, only the
+  //! last two are).
+  bool StorePath() const { return storePath; }
+  //! Modify whether every solution on the path is stored (otherwise, only the
+  //! last two are).
+  bool& StorePath() { return storePath; }
+
+  //! Get the number of threads used to compute correlations (0 uses all).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used to compute correlations (0 uses all).
+  size_t& Threads() { return threads; }
+
   // Returns a string representation of this object.
   std::string ToString() const;
 
@@ -163,6 +188,10 @@ class LARS
   //! Upper triangular cholesky factor; initially 0x0 matrix.
   arma::mat matUtriCholFactor;
 
+  //! Gram matrix of the active set, if the full Gram matrix is not cached and
+  //! Cholesky decomposition is not used.
+  arma::mat matGramActive;
+
   //! Whether or not to use Cholesky decomposition when solving linear system.
   bool useCholesky;
 
@@ -179,6 +208,15 @@ class LARS
   //! Tolerance for main loop.
   double tolerance;
 
+  //! Whether or not to compute the full Gram matrix when none was given.
+  bool cacheGram;
+
+  //! Whether or not to store the whole solution path.
+  bool storePath;
+
+  //! Number of threads to use (0 uses all available).
+  size_t threads;
+
   //! Solution path.
   std::vector<arma::vec> betaPath;
 
@@ -220,6 +258,50 @@ class LARS
    */
   void Ignore(const size_t varInd);
 
+  /**
+   * Compute the correlation of every dimension (column) of matX with the given
+   * vector, in parallel.
+   *
+   * @param matX Row-major data.
+   * @param v Vector in output space.
+   * @param correlations Vector to store the correlations in.
+   */
+  void ComputeCorrelations(const arma::mat& matX,
+                           const arma::vec& v,
+                           arma::vec& correlations) const;
+
+  /**
+   * Compute the Gram matrix entries between dimension varInd and every
+   * dimension in the active set, directly from the data.
+   *
+   * @param matX Row-major data.
+   * @param varInd Dimension to compute the Gram entries of.
+   * @param newGramCol Vector to store the Gram entries in.
+   */
+  void ComputeGramColumn(const arma::mat& matX,
+                         const size_t varInd,
+                         arma::vec& newGramCol) const;
+
+  /**
+   * Add dimension varInd to the Gram matrix of the active set.  This must be
+   * called before the dimension is added to the active set.
+   *
+   * @param matX Row-major data.
+   * @param varInd Dimension to add.
+   */
+  void GramInsert(const arma::mat& matX, const size_t varInd);
+
+  /**
+   * Remove the activeVarInd'th dimension from the Gram matrix of the active
+   * set.
+   *
+   * @param activeVarInd Index of dimension in active set.
+   */
+  void GramDelete(const size_t activeVarInd);
+
+  //! Store the given solution and its value of lambda_1 on the solution path.
+  void AddToPath(const arma::vec& beta, const double lambda);
+
   // compute "equiangular" direction in output space
   void ComputeYHatDirection(const arma::mat& matX,
                             const arma::vec& betaDirection,
@@ -43,6 +43,12 @@ PARAM_DOUBLE("lambda2", "Regularization parameter for l2-norm penalty.", "L",
     0);
 PARAM_FLAG("use_cholesky", "Use Cholesky decomposition during computation "
     "rather than explicitly computing the full Gram matrix.", "c");
+PARAM_FLAG("no_gram_cache", "Do not compute the full Gram matrix; instead, "
+    "compute only the entries needed for the active set from the data.  This "
+    "saves memory for data with many dimensions.", "G");
+PARAM_INT("threads", "Number of threads to use to compute correlations (0 "
+    "uses all available cores; ignored if mlpack was built without OpenMP).",
+    "t", 0);
 
 using namespace arma;
 using namespace std;
@@ -58,6 +64,13 @@ int main(int argc, char* argv[])
   double lambda2 = CLI::GetParam<double>("lambda2");
   bool useCholesky = CLI::HasParam("use_cholesky");
 
+  const int threads = CLI::GetParam<int>("threads");
+  if (threads < 0)
+  {
+    Log::Fatal << "Invalid number of threads (" << threads << ")! Must be "
+        << "greater than or equal to 0." << endl;
+  }
+
   // Load covariates.  We can avoid LARS transposing our data by choosing to not
   // transpose this data.
   const string matXFilename = CLI::GetParam<string>("input_file");
@@ -83,6 +96,10 @@ int main(int argc, char* argv[])
 
   // Do LARS.
   LARS lars(useCholesky, lambda1, lambda2);
+  lars.CacheGram() = !CLI::HasParam("no_gram_cache");
+  lars.Threads() = (size_t) threads;
+  // Only the final solution is saved, so the rest of the path is not needed.
+  lars.StorePath() = false;
   vec beta;
   lars.Regress(matX, matY.unsafe_col(0), beta, false /* do not transpose */);
 
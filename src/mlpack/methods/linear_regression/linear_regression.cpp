@@ -17,7 +17,8 @@ LinearRegression::LinearRegression(const arma::mat& predictors,
                                    const arma::vec& weights
                                    ) :
     lambda(lambda),
-    intercept(intercept)
+    intercept(intercept),
+    threads(0)
 {
   /*
    * We want to calculate the a_i coefficients of:
@@ -79,7 +80,8 @@ LinearRegression::LinearRegression(const arma::mat& predictors,
 }
 
 LinearRegression::LinearRegression(const std::string& filename) :
-    lambda(0.0)
+    lambda(0.0),
+    threads(0)
 {
   arma::mat parameter;
   data::Load(filename, parameter, true);
@@ -88,9 +90,129 @@ LinearRegression::LinearRegression(const std::string& filename) :
 
 LinearRegression::LinearRegression(const LinearRegression& linearRegression) :
     parameters(linearRegression.parameters),
-    lambda(linearRegression.lambda)
+    lambda(linearRegression.lambda),
+    intercept(linearRegression.intercept),
+    xTx(linearRegression.xTx),
+    xTy(linearRegression.xTy),
+    threads(linearRegression.threads)
 { /* Nothing to do. */ }
 
+void LinearRegression::Update(const arma::mat& predictors,
+                              const arma::vec& responses,
+                              const arma::vec& weights)
+{
+  const size_t dimensionality = predictors.n_rows + (intercept ? 1 : 0);
+  if (xTx.n_elem == 0)
+  {
+    xTx.zeros(dimensionality, dimensionality);
+    xTy.zeros(dimensionality);
+  }
+  else if (xTx.n_rows != dimensionality)
+  {
+    Log::Fatal << "LinearRegression::Update(): the data has "
+        << predictors.n_rows << " dimensions, but earlier data had "
+        << (xTx.n_rows - (intercept ? 1 : 0)) << "!" << std::endl;
+  }
+
+  if (predictors.n_cols == 0)
+    return;
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // The points are split into contiguous blocks (as many as
+  // util::ReductionBlocks() gives).  Each block is summed separately and the
+  // sums are added with util::TreeReduce(), so the result does not depend on
+  // the number of threads.
+  const size_t blocks = util::ReductionBlocks(predictors.n_cols);
+  std::vector<arma::mat> blockXTX(blocks);
+  std::vector<arma::vec> blockXTY(blocks);
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+  {
+    const size_t begin = b * predictors.n_cols / blocks;
+    const size_t end = (b + 1) * predictors.n_cols / blocks;
+
+    arma::mat p = predictors.cols(begin, end - 1);
+    arma::vec r = responses.subvec(begin, end - 1);
+    if (intercept)
+      p.insert_rows(0, arma::ones<arma::mat>(1, p.n_cols));
+
+    if (weights.n_elem > 0)
+    {
+      const arma::vec sqrtWeights = sqrt(weights.subvec(begin, end - 1));
+      p = p * diagmat(sqrtWeights);
+      r = sqrtWeights % r;
+    }
+
+    blockXTX[b] = p * trans(p);
+    blockXTY[b] = p * r;
+  }
+
+  util::TreeReduce(blockXTX);
+  util::TreeReduce(blockXTY);
+  xTx += blockXTX[0];
+  xTy += blockXTY[0];
+}
+
+void LinearRegression::Merge(const LinearRegression& other)
+{
+  if (other.xTx.n_elem == 0)
+    return;
+
+  if (other.intercept != intercept)
+  {
+    Log::Fatal << "LinearRegression::Merge(): cannot merge a model with an "
+        << "intercept and a model without one!" << std::endl;
+  }
+
+  if (xTx.n_elem == 0)
+  {
+    xTx = other.xTx;
+    xTy = other.xTy;
+  }
+  else if (xTx.n_rows != other.xTx.n_rows)
+  {
+    Log::Fatal << "LinearRegression::Merge(): the models have different "
+        << "dimensionalities!" << std::endl;
+  }
+  else
+  {
+    xTx += other.xTx;
+    xTy += other.xTy;
+  }
+}
+
+void LinearRegression::Solve()
+{
+  if (xTx.n_elem == 0)
+  {
+    Log::Fatal << "LinearRegression::Solve(): no data has been given to "
+        << "Update()!" << std::endl;
+  }
+
+  // Ridge regression adds lambda * I to X^T X, but the intercept is not
+  // penalized.
+  arma::mat a = xTx;
+  if (lambda != 0.0)
+  {
+    a.diag() += lambda;
+    if (intercept)
+      a(0, 0) -= lambda;
+  }
+
+  if (!arma::solve(parameters, a, xTy))
+  {
+    Log::Fatal << "LinearRegression::Solve(): X^T X is singular; try ridge "
+        << "regression (a positive Lambda())." << std::endl;
+  }
+}
+
 void LinearRegression::Predict(const arma::mat& points, arma::vec& predictions)
     const
 {
@@ -157,5 +279,6 @@ std::string LinearRegression::ToString() const
   std::ostringstream convert;
   convert << "Linear Regression [" << this << "]" << std::endl;
   convert << "  Lambda: " << lambda << std::endl;
+  convert << "  Intercept: " << intercept << std::endl;
   return convert.str();
 }
@@ -17,6 +17,21 @@ namespace regression /** Regression methods. */ {
  * A simple linear regression algorithm using ordinary least squares.
  * Optionally, this class can perform ridge regression, if the lambda parameter
  * is set to a number greater than zero.
+ *
+ * For datasets that do not fit in memory, the model can also be trained on one
+ * chunk of data at a time: Update() adds each chunk to the normal equations
+ * \f$ X^T X B = X^T y \f$, Merge() combines normal equations that were
+ * accumulated separately (for instance, on different machines), and Solve()
+ * computes the parameters from them.  Only \f$ X^T X \f$ and \f$ X^T y \f$
+ * are stored, so the memory used does not depend on the number of points.
+ *
+ * @code
+ * LinearRegression lr;
+ * lr.Lambda() = 0.1; // Optional.
+ * for (size_t i = 0; i < chunks; ++i)
+ *   lr.Update(predictors[i], responses[i]);
+ * lr.Solve();
+ * @endcode
  */
 class LinearRegression
 {
@@ -54,7 +69,7 @@ class LinearRegression
   /**
    * Empty constructor.
    */
-  LinearRegression() { }
+  LinearRegression() : lambda(0.0), intercept(true), threads(0) { }
 
   /**
    * Calculate y_i for each data point in points.
@@ -84,6 +99,35 @@ class LinearRegression
   double ComputeError(const arma::mat& points,
                       const arma::vec& responses) const;
 
+  /**
+   * Add a chunk of data to the normal equations of the model, without solving
+   * them; call Solve() once all the data has been added.  The points of the
+   * chunk are split among Threads() threads (if OpenMP is available).
+   *
+   * @param predictors X, matrix of data points in this chunk.
+   * @param responses y, the measured data for each point in this chunk.
+   * @param weights Observation weights for this chunk (optional).
+   */
+  void Update(const arma::mat& predictors,
+              const arma::vec& responses,
+              const arma::vec& weights = arma::vec());
+
+  /**
+   * Add the normal equations accumulated by another model with Update() to the
+   * normal equations of this model.  Both models must have the same
+   * dimensionality and the same Intercept() setting.
+   *
+   * @param other Model to merge into this one.
+   */
+  void Merge(const LinearRegression& other);
+
+  /**
+   * Compute the parameters from the normal equations accumulated with Update()
+   * and Merge(), using the current value of Lambda().  More data may be added
+   * afterwards, and Solve() called again.
+   */
+  void Solve();
+
   //! Return the parameters (the b vector).
   const arma::vec& Parameters() const { return parameters; }
   //! Modify the parameters (the b vector).
@@ -94,6 +138,27 @@ class LinearRegression
   //! Modify the Tikhonov regularization parameter for ridge regression.
   double& Lambda() { return lambda; }
 
+  //! Return whether the first parameter is an intercept.
+  bool Intercept() const { return intercept; }
+  //! Modify whether the first parameter is an intercept (this must be set
+  //! before Update() is first called).
+  bool& Intercept() { return intercept; }
+
+  //! Return the accumulated X^T X (with the intercept, if any, first).
+  const arma::mat& XTX() const { return xTx; }
+  //! Modify the accumulated X^T X (with the intercept, if any, first).
+  arma::mat& XTX() { return xTx; }
+
+  //! Return the accumulated X^T y (with the intercept, if any, first).
+  const arma::vec& XTY() const { return xTy; }
+  //! Modify the accumulated X^T y (with the intercept, if any, first).
+  arma::vec& XTY() { return xTy; }
+
+  //! Get the number of threads used by Update() (0 uses all available).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used by Update() (0 uses all available).
+  size_t& Threads() { return threads; }
+
   // Returns a string representation of this object. 
   std::string ToString() const;
 
@@ -110,6 +175,12 @@ class LinearRegression
   double lambda;
   //! Indicates whether first parameter is intercept.
   bool intercept;
+  //! The X^T X accumulated by Update() and Merge().
+  arma::mat xTx;
+  //! The X^T y accumulated by Update() and Merge().
+  arma::vec xTy;
+  //! The number of threads used by Update() (0 uses all available).
+  size_t threads;
 };
 
 }; // namespace linear_regression
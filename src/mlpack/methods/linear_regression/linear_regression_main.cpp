@@ -5,6 +5,13 @@
  * Main function for least-squares linear regression.
  */
 #include <mlpack/core.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
 #include "linear_regression.hpp"
 
 PROGRAM_INFO("Simple Linear Regression and Prediction",
@@ -23,7 +30,12 @@ PROGRAM_INFO("Simple Linear Regression and Prediction",
     "   y' = X' * b\n\n"
     "and these predicted responses, y', are saved to a file "
     "(--output_predictions).  This type of regression is related to least-angle"
-    " regression, which mlpack implements with the 'lars' executable.");
+    " regression, which mlpack implements with the 'lars' executable.\n"
+    "\n"
+    "If the training data is too large to load at once, --chunk_size can be "
+    "specified; then --input_file (and --input_responses, if given) are read "
+    "in chunks of that many points, and only X'X and X'y are kept in memory.  "
+    "This requires CSV or text files with one point per line.");
 
 PARAM_STRING("input_file", "File containing X (regressors).", "i", "");
 PARAM_STRING("input_responses", "Optional file containing y (responses). If "
@@ -43,11 +55,199 @@ PARAM_STRING("output_predictions", "If --test_file is specified, this file is "
 PARAM_DOUBLE("lambda", "Tikhonov regularization for ridge regression.  If 0, "
     "the method reduces to linear regression.", "l", 0.0);
 
+PARAM_INT("chunk_size", "If greater than 0, the training data is read and "
+    "added to the model this many points at a time.", "c", 0);
+PARAM_INT("threads", "Number of threads to use for --chunk_size training (0 "
+    "uses all available cores; ignored if mlpack was built without OpenMP).",
+    "T", 0);
+
 using namespace mlpack;
 using namespace mlpack::regression;
 using namespace arma;
 using namespace std;
 
+/**
+ * Read up to chunkSize points from a CSV or whitespace-separated text stream,
+ * one point per line, into the columns of chunk.  Blank lines are skipped.
+ *
+ * @param stream Stream to read from.
+ * @param filename Name of the file being read (used in error messages).
+ * @param dimensionality Number of values each point must have; if 0, it is set
+ *      to the number of values of the first point.
+ * @param chunkSize Maximum number of points to read.
+ * @param pointsRead Number of points read so far (used in error messages, and
+ *      updated).
+ * @param chunk Matrix to store the points in.
+ * @return false if there were no points left to read.
+ */
+bool ReadChunk(istream& stream,
+               const string& filename,
+               size_t& dimensionality,
+               const size_t chunkSize,
+               size_t& pointsRead,
+               arma::mat& chunk)
+{
+  chunk.set_size(dimensionality, chunkSize);
+  size_t points = 0;
+  string line;
+  vector<double> values;
+  while (points < chunkSize && getline(stream, line))
+  {
+    replace(line.begin(), line.end(), ',', ' ');
+    istringstream lineStream(line);
+
+    values.clear();
+    double value;
+    while (lineStream >> value)
+      values.push_back(value);
+
+    if (values.empty())
+      continue;
+
+    if (dimensionality == 0)
+    {
+      dimensionality = values.size();
+      chunk.set_size(dimensionality, chunkSize);
+    }
+
+    if (values.size() != dimensionality)
+      Log::Fatal << "Point " << pointsRead + points << " in '" << filename
+          << "' has " << values.size() << " values, but earlier points have "
+          << dimensionality << "." << endl;
+
+    for (size_t i = 0; i < dimensionality; ++i)
+      chunk(i, points) = values[i];
+    ++points;
+  }
+
+  chunk.resize(dimensionality, points);
+  pointsRead += points;
+
+  return (points > 0);
+}
+
+//! One chunk of training points and their responses.
+struct TrainingChunk
+{
+  arma::mat points;
+  arma::vec responses;
+};
+
+/**
+ * Pipeline stage which reads the next chunk of training points (and
+ * responses, if they are in a separate file).
+ */
+class TrainingChunkLoader
+{
+ public:
+  TrainingChunkLoader(istream& trainStream,
+                      const string& trainName,
+                      istream& responseStream,
+                      const string& responseName,
+                      const size_t chunkSize) :
+      trainStream(trainStream),
+      trainName(trainName),
+      responseStream(responseStream),
+      responseName(responseName),
+      chunkSize(chunkSize),
+      dimensionality(0),
+      responseDimensionality(1),
+      pointsRead(0),
+      responsesRead(0)
+  { }
+
+  bool operator()(TrainingChunk& chunk)
+  {
+    if (!ReadChunk(trainStream, trainName, dimensionality, chunkSize,
+        pointsRead, chunk.points))
+      return false;
+
+    if (responseName.empty())
+    {
+      // The responses are the last column of the file.
+      chunk.responses = trans(chunk.points.row(chunk.points.n_rows - 1));
+      chunk.points.shed_row(chunk.points.n_rows - 1);
+    }
+    else
+    {
+      ReadChunk(responseStream, responseName, responseDimensionality,
+          chunk.points.n_cols, responsesRead, responseChunk);
+      if (responsesRead != pointsRead)
+        Log::Fatal << "The responses must have the same number of rows as the "
+            "training file.\n";
+
+      chunk.responses = trans(responseChunk);
+    }
+
+    return true;
+  }
+
+  //! Get the number of points read so far.
+  size_t PointsRead() const { return pointsRead; }
+
+ private:
+  istream& trainStream;
+  const string& trainName;
+  istream& responseStream;
+  const string& responseName;
+  size_t chunkSize;
+  size_t dimensionality;
+  size_t responseDimensionality;
+  size_t pointsRead;
+  size_t responsesRead;
+  arma::mat responseChunk;
+};
+
+//! Pipeline stage which adds a chunk of training points to the model.
+class TrainingChunkUpdater
+{
+ public:
+  TrainingChunkUpdater(LinearRegression& lr) : lr(lr) { }
+
+  void operator()(TrainingChunk& chunk, data::NoOutput& /* output */)
+  {
+    lr.Update(chunk.points, chunk.responses);
+  }
+
+ private:
+  LinearRegression& lr;
+};
+
+/**
+ * Train the model on the training data (and responses, if they are in a
+ * separate file), reading chunkSize points at a time.  The next chunk is read
+ * while the model is updated with the current one (see data::Pipeline).
+ */
+void StreamingRegression(LinearRegression& lr,
+                         const string& trainName,
+                         const string& responseName,
+                         const size_t chunkSize)
+{
+  ifstream trainStream(trainName.c_str());
+  if (!trainStream.is_open())
+    Log::Fatal << "Cannot open training file '" << trainName << "'!" << endl;
+
+  ifstream responseStream;
+  if (!responseName.empty())
+  {
+    responseStream.open(responseName.c_str());
+    if (!responseStream.is_open())
+      Log::Fatal << "Cannot open responses file '" << responseName << "'!"
+          << endl;
+  }
+
+  TrainingChunkLoader loader(trainStream, trainName, responseStream,
+      responseName, chunkSize);
+  TrainingChunkUpdater updater(lr);
+  data::NoOutput writer;
+
+  data::Pipeline<TrainingChunk, data::NoOutput> pipeline;
+  pipeline.Run(loader, updater, writer);
+
+  lr.Solve();
+  Log::Info << "Trained on " << loader.PointsRead() << " points." << endl;
+}
+
 int main(int argc, char* argv[])
 {
   // Handle parameters
@@ -61,11 +261,26 @@ int main(int argc, char* argv[])
   const string trainName = CLI::GetParam<string>("input_file");
   const double lambda = CLI::GetParam<double>("lambda");
 
+  const int chunkSize = CLI::GetParam<int>("chunk_size");
+  if (chunkSize < 0)
+  {
+    Log::Fatal << "Invalid chunk size (" << chunkSize << ")! Must be greater "
+        << "than or equal to 0." << endl;
+  }
+
+  const int threads = CLI::GetParam<int>("threads");
+  if (threads < 0)
+  {
+    Log::Fatal << "Invalid number of threads (" << threads << ")! Must be "
+        << "greater than or equal to 0." << endl;
+  }
+
   mat regressors;
   mat responses;
 
   LinearRegression lr;
   lr.Lambda() = lambda;
+  lr.Threads() = (size_t) threads;
 
   bool computeModel = false;
 
@@ -98,8 +313,19 @@ int main(int argc, char* argv[])
         << "--test_file." << endl;
   }
 
+  // An input file was given and we need to generate the model, a chunk at a
+  // time.
+  if (computeModel && chunkSize > 0)
+  {
+    Timer::Start("regression");
+    StreamingRegression(lr, trainName, responseName, (size_t) chunkSize);
+    Timer::Stop("regression");
+
+    // Save the parameters.
+    data::Save(outputFile, lr.Parameters(), true);
+  }
   // An input file was given and we need to generate the model.
-  if (computeModel)
+  else if (computeModel)
   {
     Timer::Start("load_regressors");
     data::Load(trainName, regressors, true);
@@ -82,10 +82,13 @@ class LocalCoordinateCoding
    * @param data Data matrix.
    * @param atoms Number of atoms in dictionary.
    * @param lambda Regularization parameter for weighted l1-norm penalty.
+   * @param threads Number of threads to use for the coding step (0 uses all
+   *     available threads).
    */
   LocalCoordinateCoding(const arma::mat& data,
                         const size_t atoms,
-                        const double lambda);
+                        const double lambda,
+                        const size_t threads = 0);
 
   /**
    * Run local coordinate coding.
@@ -99,7 +102,8 @@ class LocalCoordinateCoding
               const double objTolerance = 0.01);
 
   /**
-   * Code each point via distance-weighted LARS.
+   * Code each point via distance-weighted LARS.  The points are coded in
+   * parallel with Threads() threads if OpenMP is available.
    */
   void OptimizeCode();
 
@@ -130,6 +134,14 @@ class LocalCoordinateCoding
   //! Modify the codes.
   arma::mat& Codes() { return codes; }
 
+  //! Get the number of threads used for the coding step (0 means all
+  //! available threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for the coding step (0 means all
+  //! available threads).  This has no effect if mlpack was compiled without
+  //! OpenMP.
+  size_t& Threads() { return threads; }
+
   // Returns a string representation of this object. 
   std::string ToString() const;
 
@@ -148,6 +160,9 @@ class LocalCoordinateCoding
 
   //! l1 regularization term.
   double lambda;
+
+  //! Number of threads used for the coding step (0 means all available).
+  size_t threads;
 };
 
 }; // namespace lcc
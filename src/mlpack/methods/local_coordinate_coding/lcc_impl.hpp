@@ -17,11 +17,13 @@ template<typename DictionaryInitializer>
 LocalCoordinateCoding<DictionaryInitializer>::LocalCoordinateCoding(
     const arma::mat& data,
     const size_t atoms,
-    const double lambda) :
+    const double lambda,
+    const size_t threads) :
     atoms(atoms),
     data(data),
     codes(atoms, data.n_cols),
-    lambda(lambda)
+    lambda(lambda),
+    threads(threads)
 {
   // Initialize the dictionary.
   DictionaryInitializer::Initialize(data, atoms, dictionary);
@@ -102,29 +104,52 @@ void LocalCoordinateCoding<DictionaryInitializer>::OptimizeCode()
       * data);
 
   arma::mat dictGram = trans(dictionary) * dictionary;
-  arma::mat dictGramTD(dictGram.n_rows, dictGram.n_cols);
 
-  for (size_t i = 0; i < data.n_cols; i++)
-  {
-    // report progress
-    if ((i % 100) == 0)
-    {
-      Log::Debug << "Optimization at point " << i << "." << std::endl;
-    }
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
 
-    arma::vec invW = invSqDists.unsafe_col(i);
-    arma::mat dictPrime = dictionary * diagmat(invW);
+  Log::Debug << "Coding " << data.n_cols << " points with " << numThreads
+      << " threads." << std::endl;
 
-    arma::mat dictGramTD = diagmat(invW) * dictGram * diagmat(invW);
+  // The code of each point is independent of the others, so the points are
+  // split among the threads.  Each thread has its own workspace for the
+  // weighted dictionary and its Gram matrix, which are overwritten in place for
+  // each point instead of being allocated again.
+  #pragma omp parallel num_threads(numThreads)
+  {
+    arma::mat dictPrime(dictionary.n_rows, dictionary.n_cols);
+    arma::mat dictGramTD(dictGram.n_rows, dictGram.n_cols);
 
-    bool useCholesky = false;
-    regression::LARS lars(useCholesky, dictGramTD, 0.5 * lambda);
+    #pragma omp for schedule(dynamic, 16)
+    for (omp_size_t i = 0; i < (omp_size_t) data.n_cols; ++i)
+    {
+      // Weight the dictionary and its Gram matrix by the inverse squared
+      // distances of the atoms from this point; this is dictionary * W and
+      // W * dictGram * W, with W = diagmat(invW).
+      arma::vec invW = invSqDists.unsafe_col(i);
+      for (size_t j = 0; j < atoms; ++j)
+      {
+        dictPrime.col(j) = invW[j] * dictionary.col(j);
+        dictGramTD.col(j) = (invW[j] * dictGram.col(j)) % invW;
+      }
 
-    // Run LARS for this point, by making an alias of the point and passing
-    // that.
-    arma::vec beta = codes.unsafe_col(i);
-    lars.Regress(dictPrime, data.unsafe_col(i), beta, false);
-    beta %= invW; // Remember, beta is an alias of codes.col(i).
+      // LARS keeps its active set between calls to Regress(), so each point
+      // gets a fresh LARS object; it only holds a reference to dictGramTD.  It
+      // uses one thread, since the threads are already busy.
+      bool useCholesky = false;
+      regression::LARS lars(useCholesky, dictGramTD, 0.5 * lambda);
+      lars.Threads() = 1;
+
+      // Run LARS for this point, by making an alias of the point and passing
+      // that.
+      arma::vec beta = codes.unsafe_col(i);
+      lars.Regress(dictPrime, data.unsafe_col(i), beta, false);
+      beta %= invW; // Remember, beta is an alias of codes.col(i).
+    }
   }
 }
 
@@ -315,6 +340,7 @@ std::string LocalCoordinateCoding<DictionaryInitializer>::ToString() const
   convert << "  Number of Atoms: " << atoms << std::endl;
   convert << "  Data: " << data.n_rows << "x" << data.n_cols << std::endl;
   convert << "  Lambda: " << lambda << std::endl;
+  convert << "  Threads: " << threads << std::endl;
   return convert.str();
 }
 
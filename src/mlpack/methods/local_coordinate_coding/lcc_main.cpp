@@ -62,6 +62,9 @@ PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
 
 PARAM_DOUBLE("objective_tolerance", "Tolerance for objective function.", "o",
     0.01);
+PARAM_INT("threads", "Number of threads to use for the coding step (0 uses "
+    "all available cores; ignored if mlpack was built without OpenMP).", "t",
+    0);
 
 using namespace arma;
 using namespace std;
@@ -94,6 +97,14 @@ int main(int argc, char* argv[])
 
   const double objTolerance = CLI::GetParam<double>("objective_tolerance");
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t threads = (size_t) CLI::GetParam<int>("threads");
+
   mat input;
   data::Load(inputFile, input, true);
 
@@ -111,7 +122,8 @@ int main(int argc, char* argv[])
   // If there is an initial dictionary, be sure we do not initialize one.
   if (initialDictionaryFile != "")
   {
-    LocalCoordinateCoding<NothingInitializer> lcc(input, atoms, lambda);
+    LocalCoordinateCoding<NothingInitializer> lcc(input, atoms, lambda,
+        threads);
 
     // Load initial dictionary directly into LCC object.
     data::Load(initialDictionaryFile, lcc.Dictionary(), true);
@@ -143,7 +155,7 @@ int main(int argc, char* argv[])
   else
   {
     // No initial dictionary.
-    LocalCoordinateCoding<> lcc(input, atoms, lambda);
+    LocalCoordinateCoding<> lcc(input, atoms, lambda, threads);
 
     // Run LCC.
     lcc.Encode(maxIterations, objTolerance);
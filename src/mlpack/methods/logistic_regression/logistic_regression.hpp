@@ -16,8 +16,17 @@
 namespace mlpack {
 namespace regression {
 
+/**
+ * An implementation of L2-regularized logistic regression for two-class
+ * classification.  The model is trained with the given optimizer type, and the
+ * predictors may be dense or sparse.
+ *
+ * @tparam OptimizerType Optimizer to train the model with.
+ * @tparam MatType Type of the predictors matrix (arma::mat or arma::sp_mat).
+ */
 template<
-  template<typename> class OptimizerType = mlpack::optimization::L_BFGS
+  template<typename> class OptimizerType = mlpack::optimization::L_BFGS,
+  typename MatType = arma::mat
 >
 class LogisticRegression
 {
@@ -32,7 +41,7 @@ class LogisticRegression
    * @param responses Outputs resulting from input training variables.
    * @param lambda L2-regularization parameter.
    */
-  LogisticRegression(const arma::mat& predictors,
+  LogisticRegression(const MatType& predictors,
                      const arma::vec& responses,
                      const double lambda = 0);
 
@@ -47,7 +56,7 @@ class LogisticRegression
    * @param initialPoint Initial model to train with.
    * @param lambda L2-regularization parameter.
    */
-  LogisticRegression(const arma::mat& predictors,
+  LogisticRegression(const MatType& predictors,
                      const arma::vec& responses,
                      const arma::mat& initialPoint,
                      const double lambda = 0);
@@ -63,7 +72,8 @@ class LogisticRegression
    *
    * @param optimizer Instantiated optimizer with instantiated error function.
    */
-  LogisticRegression(OptimizerType<LogisticRegressionFunction>& optimizer);
+  LogisticRegression(
+      OptimizerType<LogisticRegressionFunction<MatType> >& optimizer);
 
   /**
    * Construct a logistic regression model from the given parameters, without
@@ -86,18 +96,51 @@ class LogisticRegression
   //! Modify the lambda value for L2-regularization.
   double& Lambda() { return lambda; }
 
+  //! Get the number of threads used for prediction (0 means all available
+  //! cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for prediction (0 means all available
+  //! cores).  This has no effect if mlpack was compiled without OpenMP.
+  size_t& Threads() { return threads; }
+
+  /**
+   * Compute the probability that the response to a single point is 1.  No
+   * memory is allocated, so this is suited to scoring single points with low
+   * latency.
+   *
+   * @tparam VecType Type of the point (arma::vec, or a column of a matrix).
+   * @param point Predictors of the point.
+   * @return Probability that the response is 1.
+   */
+  template<typename VecType>
+  double PredictProbability(const VecType& point) const;
+
+  /**
+   * Compute the probability that the response to each of the given predictors
+   * is 1.  The points are split into blocks of consecutive points which are
+   * handed out to Threads() threads (if mlpack was built with OpenMP).  No
+   * memory is allocated except for the output, and only if it does not already
+   * have one element for each point.
+   *
+   * @param predictors Input predictors.
+   * @param probabilities Vector to store the probability of each point in.
+   */
+  void PredictProbabilities(const MatType& predictors,
+                            arma::vec& probabilities) const;
+
   /**
    * Predict the responses to a given set of predictors.  The responses will be
    * either 0 or 1.  Optionally, specify the decision boundary; logistic
    * regression returns a value between 0 and 1.  If the value is greater than
    * the decision boundary, the response is taken to be 1; otherwise, it is 0.
-   * By default the decision boundary is 0.5.
+   * By default the decision boundary is 0.5.  Like PredictProbabilities(), this
+   * runs in parallel and does not allocate memory other than the output.
    *
    * @param predictors Input predictors.
    * @param responses Vector to put output predictions of responses into.
    * @param decisionBoundary Decision boundary (default 0.5).
    */
-  void Predict(const arma::mat& predictors,
+  void Predict(const MatType& predictors,
                arma::vec& responses,
                const double decisionBoundary = 0.5) const;
 
@@ -115,7 +158,7 @@ class LogisticRegression
    * @param decisionBoundary Decision boundary (default 0.5).
    * @return Percentage of responses that are predicted correctly.
    */
-  double ComputeAccuracy(const arma::mat& predictors,
+  double ComputeAccuracy(const MatType& predictors,
                          const arma::vec& responses,
                          const double decisionBoundary = 0.5) const;
 
@@ -127,7 +170,7 @@ class LogisticRegression
    * @param predictors Input predictors.
    * @param responses Vector of responses.
    */
-  double ComputeError(const arma::mat& predictors,
+  double ComputeError(const MatType& predictors,
                       const arma::vec& responses) const;
 
   // Returns a string representation of this object. 
@@ -138,6 +181,22 @@ class LogisticRegression
   arma::vec parameters;
   //! L2-regularization penalty parameter.
   double lambda;
+  //! Number of threads used for prediction.
+  size_t threads;
+
+  //! Compute the linear function of the parameters at the given (dense)
+  //! point, the argument of the sigmoid.
+  double LinearScore(const arma::mat& predictors, const size_t point) const;
+  //! Compute the linear function of the parameters at the given (sparse)
+  //! point, visiting only its nonzero predictors.
+  double LinearScore(const arma::sp_mat& predictors, const size_t point) const;
+
+  //! Make sure the predictors have the dimensionality of the model.
+  void CheckDimensionality(const MatType& predictors,
+                           const char* function) const;
+
+  //! Get the number of consecutive points each thread predicts at a time.
+  static size_t BlockSize(const size_t dimensionality);
 };
 
 }; // namespace regression
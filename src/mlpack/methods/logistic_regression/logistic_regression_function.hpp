@@ -18,15 +18,32 @@ namespace regression {
  * The log-likelihood function for the logistic regression objective function.
  * This is used by various mlpack optimizers to train a logistic regression
  * model.
+ *
+ * The objective and gradient over all of the points (which L-BFGS uses) are
+ * computed with one matrix-vector product each, and the sigmoids of the points
+ * are then found in parallel when OpenMP is available.  The sigmoids found for
+ * the last parameters are kept, so a call to Gradient() with the parameters
+ * Evaluate() was just called with (or the other way around) does not compute
+ * them again.  Because of this, those two functions should not be called on
+ * the same object from several threads at once; the functions of a single
+ * point can be.
+ *
+ * The predictors may be dense (arma::mat) or sparse (arma::sp_mat).  With
+ * sparse predictors, the functions of a single point only visit the nonzero
+ * features of the point, and the full-batch functions use sparse
+ * matrix-vector products.
+ *
+ * @tparam MatType Type of the predictors matrix (arma::mat or arma::sp_mat).
  */
+template<typename MatType = arma::mat>
 class LogisticRegressionFunction
 {
  public:
-  LogisticRegressionFunction(const arma::mat& predictors,
+  LogisticRegressionFunction(const MatType& predictors,
                              const arma::vec& responses,
                              const double lambda = 0);
 
-  LogisticRegressionFunction(const arma::mat& predictors,
+  LogisticRegressionFunction(const MatType& predictors,
                              const arma::vec& responses,
                              const arma::mat& initialPoint,
                              const double lambda = 0);
@@ -41,16 +58,21 @@ class LogisticRegressionFunction
   //! Modify the regularization parameter (lambda).
   double& Lambda() { return lambda; }
 
+  //! Get the number of threads used (0 means all available cores).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used (0 means all available cores).
+  size_t& Threads() { return threads; }
+
   //! Return the matrix of predictors.
-  const arma::mat& Predictors() const { return predictors; }
+  const MatType& Predictors() const { return predictors; }
   //! Return the vector of responses.
   const arma::vec& Responses() const { return responses; }
 
   /**
    * Evaluate the logistic regression log-likelihood function with the given
-   * parameters.  Note that if a point has 0 probability of being classified
-   * directly with the given parameters, then Evaluate() will return nan (this
-   * is kind of a corner case and should not happen for reasonable models).
+   * parameters.  The log-likelihood of each point is computed as
+   * log(1 + exp(-x)) (with log1p()), so it stays finite even for points that
+   * are classified wrongly with very high confidence.
    *
    * The optimum (minimum) of this function is 0.0, and occurs when each point
    * is classified correctly with very high probability.
@@ -98,6 +120,56 @@ class LogisticRegressionFunction
                 const size_t i,
                 arma::mat& gradient) const;
 
+  /**
+   * Evaluate the gradient of the logistic regression log-likelihood function
+   * with the given parameters, with respect to the batchSize points starting
+   * at begin.  This is the sum of the gradients of each of those points, but
+   * it is computed with matrix operations, so it is faster than summing them;
+   * SGD uses it for mini-batches.
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param begin Index of the first point of the batch.
+   * @param batchSize Number of points in the batch.
+   * @param gradient Vector to output gradient into.
+   */
+  void Gradient(const arma::mat& parameters,
+                const size_t begin,
+                const size_t batchSize,
+                arma::mat& gradient) const;
+
+  /**
+   * Evaluate the gradient of the logistic regression log-likelihood function
+   * with respect to only one point, as a sparse vector that is nonzero only for
+   * the intercept and the nonzero features of the point.  Unlike the other
+   * overloads, this does not include the L2 regularization; SGD applies it
+   * lazily, using Regularization(), so that a step with a point only touches
+   * the parameters in its Support().
+   *
+   * @param parameters Vector of logistic regression parameters.
+   * @param i Index of point to use for objective function gradient evaluation.
+   * @param gradient Sparse vector to output gradient into.
+   */
+  void Gradient(const arma::mat& parameters,
+                const size_t i,
+                arma::sp_mat& gradient) const;
+
+  /**
+   * Get the indices of the parameters the objective of point i depends on,
+   * in increasing order: the intercept and the nonzero features of the point.
+   *
+   * @param i Index of point.
+   * @param indices Vector to output the indices into.
+   */
+  void Support(const size_t i, arma::uvec& indices) const;
+
+  /**
+   * Get the L2 regularization coefficient of each parameter in the objective
+   * of one point: lambda / n for each feature, and 0 for the intercept.
+   *
+   * @param lambdas Vector to output the coefficients into.
+   */
+  void Regularization(arma::mat& lambdas) const;
+
   //! Return the initial point for the optimization.
   const arma::mat& GetInitialPoint() const { return initialPoint; }
 
@@ -108,14 +180,68 @@ class LogisticRegressionFunction
   //! The initial point, from which to start the optimization.
   arma::mat initialPoint;
   //! The matrix of data points (predictors).
-  const arma::mat& predictors;
+  const MatType& predictors;
   //! The vector of responses to the input data points.
   const arma::vec& responses;
   //! The regularization parameter for L2-regularization.
   double lambda;
+  //! The number of threads to use.
+  size_t threads;
+
+  //! The parameters the sigmoids were last computed with.
+  mutable arma::mat cachedParameters;
+  //! The sigmoid of each point with the cached parameters.
+  mutable arma::vec sigmoids;
+  //! The negative log-likelihood (without regularization) with the cached
+  //! parameters.
+  mutable double loss;
+
+  /**
+   * Compute the sigmoid of every point and the negative log-likelihood with the
+   * given parameters, unless they were computed with them already.
+   */
+  void Precompute(const arma::mat& parameters) const;
+
+  //! Compute the exponent of the sigmoid of point i of dense predictors.
+  static double Exponent(const arma::mat& predictors,
+                         const size_t i,
+                         const arma::mat& parameters);
+  //! Compute the exponent of the sigmoid of point i of sparse predictors.
+  static double Exponent(const arma::sp_mat& predictors,
+                         const size_t i,
+                         const arma::mat& parameters);
+
+  //! Add scale times point i of dense predictors to the feature part of the
+  //! gradient.
+  static void AddPoint(const arma::mat& predictors,
+                       const size_t i,
+                       const double scale,
+                       arma::mat& gradient);
+  //! Add scale times point i of sparse predictors to the feature part of the
+  //! gradient.
+  static void AddPoint(const arma::sp_mat& predictors,
+                       const size_t i,
+                       const double scale,
+                       arma::mat& gradient);
+
+  //! Get the indices and values of the nonzero features of point i of dense
+  //! predictors.
+  static void Nonzeros(const arma::mat& predictors,
+                       const size_t i,
+                       arma::uvec& features,
+                       arma::vec& values);
+  //! Get the indices and values of the nonzero features of point i of sparse
+  //! predictors.
+  static void Nonzeros(const arma::sp_mat& predictors,
+                       const size_t i,
+                       arma::uvec& features,
+                       arma::vec& values);
 };
 
 }; // namespace regression
 }; // namespace mlpack
 
+// Include implementation.
+#include "logistic_regression_function_impl.hpp"
+
 #endif // __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_FUNCTION_HPP
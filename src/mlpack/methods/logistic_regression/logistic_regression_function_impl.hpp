@@ -0,0 +1,362 @@
+/**
+ * @file logistic_regression_function_impl.hpp
+ * @author Sumedh Ghaisas
+ *
+ * Implementation of hte LogisticRegressionFunction class.
+ */
+#ifndef __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_FUNCTION_IMPL_HPP
+#define __MLPACK_METHODS_LOGISTIC_REGRESSION_LOGISTIC_REGRESSION_FUNCTION_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "logistic_regression_function.hpp"
+
+namespace mlpack {
+namespace regression {
+
+template<typename MatType>
+LogisticRegressionFunction<MatType>::LogisticRegressionFunction(
+    const MatType& predictors,
+    const arma::vec& responses,
+    const double lambda) :
+    predictors(predictors),
+    responses(responses),
+    lambda(lambda),
+    threads(0),
+    loss(0)
+{
+  initialPoint = arma::zeros<arma::mat>(predictors.n_rows + 1, 1);
+}
+
+template<typename MatType>
+LogisticRegressionFunction<MatType>::LogisticRegressionFunction(
+    const MatType& predictors,
+    const arma::vec& responses,
+    const arma::mat& initialPoint,
+    const double lambda) :
+    initialPoint(initialPoint),
+    predictors(predictors),
+    responses(responses),
+    lambda(lambda),
+    threads(0),
+    loss(0)
+{
+  //to check if initialPoint is compatible with predictors
+  if (initialPoint.n_rows != (predictors.n_rows + 1) ||
+      initialPoint.n_cols != 1)
+    this->initialPoint = arma::zeros<arma::mat>(predictors.n_rows + 1, 1);
+}
+
+/**
+ * Compute the sigmoids of all of the points, and the negative log-likelihood,
+ * unless the parameters are the ones they were last computed with.
+ */
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::Precompute(
+    const arma::mat& parameters) const
+{
+  if (cachedParameters.n_elem == parameters.n_elem &&
+      arma::accu(cachedParameters != parameters) == 0)
+    return;
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // The intercept term is parameters(0, 0) and does not need to be multiplied
+  // by any of the predictors.
+  const arma::vec exponents = parameters(0, 0) + predictors.t() *
+      parameters.col(0).subvec(1, parameters.n_elem - 1);
+
+  // -log(sig(x)) = log(1 + exp(-x)) and -log(1 - sig(x)) = log(1 + exp(x)),
+  // and log(1 + exp(s)) = max(s, 0) + log(1 + exp(-|s|)) does not overflow.
+  // The loss is summed in blocks which are added with util::TreeReduce(), so
+  // it does not depend on the number of threads.
+  sigmoids.set_size(exponents.n_elem);
+  const size_t blocks = util::ReductionBlocks(exponents.n_elem);
+  std::vector<double> results(blocks, 0.0);
+  #pragma omp parallel for num_threads(numThreads) schedule(static)
+  for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+  {
+    const size_t end = (b + 1) * exponents.n_elem / blocks;
+    for (size_t i = b * exponents.n_elem / blocks; i < end; ++i)
+    {
+      sigmoids[i] = 1.0 / (1.0 + std::exp(-exponents[i]));
+      const double s = (responses[i] == 1) ? -exponents[i] : exponents[i];
+      results[b] += std::max(s, 0.0) + std::log1p(std::exp(-std::abs(s)));
+    }
+  }
+
+  util::TreeReduce(results);
+  loss = results[0];
+  cachedParameters = parameters;
+}
+
+/**
+ * Evaluate the logistic regression objective function given the estimated
+ * parameters.
+ */
+template<typename MatType>
+double LogisticRegressionFunction<MatType>::Evaluate(
+    const arma::mat& parameters) const
+{
+  // The objective function is the log-likelihood function (w is the parameters
+  // vector for the model; y is the responses; x is the predictors; sig() is the
+  // sigmoid function):
+  //   f(w) = sum(y log(sig(w'x)) + (1 - y) log(sig(1 - w'x))).
+  // We want to minimize this function.  L2-regularization is just lambda
+  // multiplied by the squared l2-norm of the parameters then divided by two.
+
+  // For the regularization, we ignore the first term, which is the intercept
+  // term.
+  const double regularization = 0.5 * lambda *
+      arma::dot(parameters.col(0).subvec(1, parameters.n_elem - 1),
+                parameters.col(0).subvec(1, parameters.n_elem - 1));
+
+  // Often the objective function and the regularization as given are divided
+  // by the number of features, but this doesn't actually affect the
+  // optimization result, so we'll just ignore those terms for computational
+  // efficiency.
+  Precompute(parameters);
+  return loss + regularization;
+}
+
+/**
+ * Evaluate the logistic regression objective function, but with only one point.
+ * This is useful for optimizers that use a separable objective function, such
+ * as SGD.
+ */
+template<typename MatType>
+double LogisticRegressionFunction<MatType>::Evaluate(
+    const arma::mat& parameters,
+    const size_t i) const
+{
+  // Calculate the regularization term.  We must divide by the number of points,
+  // so that sum(Evaluate(parameters, [1:points])) == Evaluate(parameters).
+  const double regularization = lambda * (1.0 / (2.0 * predictors.n_cols)) *
+      arma::dot(parameters.col(0).subvec(1, parameters.n_elem - 1),
+                parameters.col(0).subvec(1, parameters.n_elem - 1));
+
+  // Calculate sigmoid.
+  const double exponent = Exponent(predictors, i, parameters);
+  const double sigmoid = 1.0 / (1.0 + std::exp(-exponent));
+
+  if (responses[i] == 1)
+    return -log(sigmoid) + regularization;
+  else
+    return -log(1.0 - sigmoid) + regularization;
+}
+
+//! Evaluate the gradient of the logistic regression objective function.
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::Gradient(
+    const arma::mat& parameters,
+    arma::mat& gradient) const
+{
+  // Regularization term.
+  arma::mat regularization;
+  regularization = lambda * parameters.col(0).subvec(1, parameters.n_elem - 1);
+
+  // The sigmoids are usually left from Evaluate() at the same parameters.
+  Precompute(parameters);
+  const arma::vec errors = responses - sigmoids;
+
+  gradient.set_size(parameters.n_elem);
+  gradient[0] = -arma::accu(errors);
+  gradient.col(0).subvec(1, parameters.n_elem - 1) = -predictors * errors +
+      regularization;
+}
+
+/**
+ * Evaluate the individual gradients of the logistic regression objective
+ * function with respect to individual points.  This is useful for optimizers
+ * that use a separable objective function, such as SGD.
+ */
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::Gradient(
+    const arma::mat& parameters,
+    const size_t i,
+    arma::mat& gradient) const
+{
+  const double sigmoid = 1.0 / (1.0 + std::exp(-Exponent(predictors, i,
+      parameters)));
+
+  // Start with the regularization term, then add the point.
+  gradient.set_size(parameters.n_elem, 1);
+  gradient[0] = -(responses[i] - sigmoid);
+  gradient.col(0).subvec(1, parameters.n_elem - 1) = lambda *
+      parameters.col(0).subvec(1, parameters.n_elem - 1) / predictors.n_cols;
+  AddPoint(predictors, i, -(responses[i] - sigmoid), gradient);
+}
+
+/**
+ * Evaluate the summed gradients of the logistic regression objective function
+ * with respect to a batch of consecutive points.  This is useful for optimizers
+ * that take mini-batch steps, such as SGD with a batch size.
+ */
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::Gradient(
+    const arma::mat& parameters,
+    const size_t begin,
+    const size_t batchSize,
+    arma::mat& gradient) const
+{
+  // Each point contributes 1 / n of the regularization.
+  arma::mat regularization;
+  regularization = lambda * parameters.col(0).subvec(1, parameters.n_elem - 1)
+      * ((double) batchSize / predictors.n_cols);
+
+  const size_t end = begin + batchSize - 1;
+  const arma::vec sigmoids = 1 / (1 + arma::exp(-parameters(0, 0)
+      - predictors.cols(begin, end).t() * parameters.col(0).subvec(1,
+      parameters.n_elem - 1)));
+  const arma::vec errors = responses.subvec(begin, end) - sigmoids;
+
+  gradient.set_size(parameters.n_elem);
+  gradient[0] = -arma::accu(errors);
+  gradient.col(0).subvec(1, parameters.n_elem - 1) =
+      -predictors.cols(begin, end) * errors + regularization;
+}
+
+/**
+ * Evaluate the gradient of the logistic regression objective function with
+ * respect to one point, without the regularization, as a sparse vector.  Only
+ * the nonzero features of the point are used.
+ */
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::Gradient(
+    const arma::mat& parameters,
+    const size_t i,
+    arma::sp_mat& gradient) const
+{
+  arma::uvec features;
+  arma::vec values;
+  Nonzeros(predictors, i, features, values);
+
+  // Feature j is parameter j + 1.
+  double exponent = parameters[0];
+  for (size_t k = 0; k < features.n_elem; ++k)
+    exponent += values[k] * parameters[features[k] + 1];
+  const double error = responses[i] - 1.0 / (1.0 + std::exp(-exponent));
+
+  arma::umat locations = arma::zeros<arma::umat>(2, features.n_elem + 1);
+  arma::vec gradientValues(features.n_elem + 1);
+  gradientValues[0] = -error;
+  for (size_t k = 0; k < features.n_elem; ++k)
+  {
+    locations(0, k + 1) = features[k] + 1;
+    gradientValues[k + 1] = -values[k] * error;
+  }
+
+  gradient = arma::sp_mat(locations, gradientValues, parameters.n_elem, 1);
+}
+
+//! Get the parameters the objective of point i depends on.
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::Support(const size_t i,
+                                                  arma::uvec& indices) const
+{
+  arma::uvec features;
+  arma::vec values;
+  Nonzeros(predictors, i, features, values);
+  indices.set_size(features.n_elem + 1);
+  indices[0] = 0;
+  if (features.n_elem > 0)
+    indices.subvec(1, features.n_elem) = features + 1;
+}
+
+//! Get the L2 regularization coefficient of each parameter for one point.
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::Regularization(arma::mat& lambdas)
+    const
+{
+  lambdas.set_size(predictors.n_rows + 1, 1);
+  lambdas.fill(lambda / predictors.n_cols);
+  lambdas[0] = 0;
+}
+
+template<typename MatType>
+double LogisticRegressionFunction<MatType>::Exponent(
+    const arma::mat& predictors,
+    const size_t i,
+    const arma::mat& parameters)
+{
+  return parameters(0, 0) + arma::dot(predictors.col(i),
+      parameters.col(0).subvec(1, parameters.n_elem - 1));
+}
+
+template<typename MatType>
+double LogisticRegressionFunction<MatType>::Exponent(
+    const arma::sp_mat& predictors,
+    const size_t i,
+    const arma::mat& parameters)
+{
+  // Only the nonzero features of the point are visited.
+  double exponent = parameters(0, 0);
+  for (arma::sp_mat::const_iterator it = predictors.begin_col(i);
+       it != predictors.end_col(i); ++it)
+    exponent += (*it) * parameters[it.row() + 1];
+
+  return exponent;
+}
+
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::AddPoint(
+    const arma::mat& predictors,
+    const size_t i,
+    const double scale,
+    arma::mat& gradient)
+{
+  gradient.col(0).subvec(1, gradient.n_elem - 1) += scale * predictors.col(i);
+}
+
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::AddPoint(
+    const arma::sp_mat& predictors,
+    const size_t i,
+    const double scale,
+    arma::mat& gradient)
+{
+  for (arma::sp_mat::const_iterator it = predictors.begin_col(i);
+       it != predictors.end_col(i); ++it)
+    gradient[it.row() + 1] += scale * (*it);
+}
+
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::Nonzeros(
+    const arma::mat& predictors,
+    const size_t i,
+    arma::uvec& features,
+    arma::vec& values)
+{
+  features = arma::find(predictors.col(i));
+  values.set_size(features.n_elem);
+  for (size_t k = 0; k < features.n_elem; ++k)
+    values[k] = predictors(features[k], i);
+}
+
+template<typename MatType>
+void LogisticRegressionFunction<MatType>::Nonzeros(
+    const arma::sp_mat& predictors,
+    const size_t i,
+    arma::uvec& features,
+    arma::vec& values)
+{
+  const size_t count = predictors.col_ptrs[i + 1] - predictors.col_ptrs[i];
+  features.set_size(count);
+  values.set_size(count);
+
+  size_t k = 0;
+  for (arma::sp_mat::const_iterator it = predictors.begin_col(i);
+       it != predictors.end_col(i); ++it, ++k)
+  {
+    features[k] = it.row();
+    values[k] = (*it);
+  }
+}
+
+}; // namespace regression
+}; // namespace mlpack
+
+#endif
@@ -14,16 +14,19 @@
 namespace mlpack {
 namespace regression {
 
-template<template<typename> class OptimizerType>
-LogisticRegression<OptimizerType>::LogisticRegression(
-    const arma::mat& predictors,
+template<template<typename> class OptimizerType, typename MatType>
+LogisticRegression<OptimizerType, MatType>::LogisticRegression(
+    const MatType& predictors,
     const arma::vec& responses,
     const double lambda) :
     parameters(arma::zeros<arma::vec>(predictors.n_rows + 1)),
-    lambda(lambda)
+    lambda(lambda),
+    threads(0)
 {
-  LogisticRegressionFunction errorFunction(predictors, responses, lambda);
-  OptimizerType<LogisticRegressionFunction> optimizer(errorFunction);
+  LogisticRegressionFunction<MatType> errorFunction(predictors, responses,
+      lambda);
+  OptimizerType<LogisticRegressionFunction<MatType> >
+      optimizer(errorFunction);
 
   // Train the model.
   Timer::Start("logistic_regression_optimization");
@@ -34,18 +37,21 @@ LogisticRegression<OptimizerType>::LogisticRegression(
       << "trained model is " << out << "." << std::endl;
 }
 
-template<template<typename> class OptimizerType>
-LogisticRegression<OptimizerType>::LogisticRegression(
-    const arma::mat& predictors,
+template<template<typename> class OptimizerType, typename MatType>
+LogisticRegression<OptimizerType, MatType>::LogisticRegression(
+    const MatType& predictors,
     const arma::vec& responses,
     const arma::mat& initialPoint,
     const double lambda) :
     parameters(arma::zeros<arma::vec>(predictors.n_rows + 1)),
-    lambda(lambda)
+    lambda(lambda),
+    threads(0)
 {
-  LogisticRegressionFunction errorFunction(predictors, responses, lambda);
+  LogisticRegressionFunction<MatType> errorFunction(predictors, responses,
+      lambda);
   errorFunction.InitialPoint() = initialPoint;
-  OptimizerType<LogisticRegressionFunction> optimizer(errorFunction);
+  OptimizerType<LogisticRegressionFunction<MatType> >
+      optimizer(errorFunction);
 
   // Train the model.
   Timer::Start("logistic_regression_optimization");
@@ -56,11 +62,12 @@ LogisticRegression<OptimizerType>::LogisticRegression(
       << "trained model is " << out << "." << std::endl;
 }
 
-template<template<typename> class OptimizerType>
-LogisticRegression<OptimizerType>::LogisticRegression(
-    OptimizerType<LogisticRegressionFunction>& optimizer) :
+template<template<typename> class OptimizerType, typename MatType>
+LogisticRegression<OptimizerType, MatType>::LogisticRegression(
+    OptimizerType<LogisticRegressionFunction<MatType> >& optimizer) :
     parameters(optimizer.Function().GetInitialPoint()),
-    lambda(optimizer.Function().Lambda())
+    lambda(optimizer.Function().Lambda()),
+    threads(0)
 {
   Timer::Start("logistic_regression_optimization");
   const double out = optimizer.Optimize(parameters);
@@ -70,44 +77,137 @@ LogisticRegression<OptimizerType>::LogisticRegression(
       << "trained model is " << out << "." << std::endl;
 }
 
-template<template<typename> class OptimizerType>
-LogisticRegression<OptimizerType>::LogisticRegression(
+template<template<typename> class OptimizerType, typename MatType>
+LogisticRegression<OptimizerType, MatType>::LogisticRegression(
     const arma::vec& parameters,
     const double lambda) :
     parameters(parameters),
-    lambda(lambda)
+    lambda(lambda),
+    threads(0)
 {
   // Nothing to do.
 }
 
-template<template<typename> class OptimizerType>
-void LogisticRegression<OptimizerType>::Predict(const arma::mat& predictors,
-                                                arma::vec& responses,
-                                                const double decisionBoundary)
-    const
+template<template<typename> class OptimizerType, typename MatType>
+template<typename VecType>
+double LogisticRegression<OptimizerType, MatType>::PredictProbability(
+    const VecType& point) const
+{
+  double score = parameters[0];
+  for (size_t i = 0; i < point.n_elem; ++i)
+    score += parameters[i + 1] * point[i];
+
+  return 1.0 / (1.0 + std::exp(-score));
+}
+
+template<template<typename> class OptimizerType, typename MatType>
+void LogisticRegression<OptimizerType, MatType>::PredictProbabilities(
+    const MatType& predictors,
+    arma::vec& probabilities) const
 {
+  CheckDimensionality(predictors, "PredictProbabilities");
+  probabilities.set_size(predictors.n_cols);
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+  const size_t blockSize = BlockSize(predictors.n_rows);
+
+  #pragma omp parallel for num_threads(numThreads) schedule(static, blockSize)
+  for (omp_size_t i = 0; i < (omp_size_t) predictors.n_cols; ++i)
+    probabilities[i] = 1.0 / (1.0 + std::exp(-LinearScore(predictors, i)));
+}
+
+template<template<typename> class OptimizerType, typename MatType>
+void LogisticRegression<OptimizerType, MatType>::Predict(
+    const MatType& predictors,
+    arma::vec& responses,
+    const double decisionBoundary) const
+{
+  CheckDimensionality(predictors, "Predict");
+  responses.set_size(predictors.n_cols);
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+  const size_t blockSize = BlockSize(predictors.n_rows);
+
   // Calculate sigmoid function for each point.  The (1.0 - decisionBoundary)
   // term correctly sets an offset so that floor() returns 0 or 1 correctly.
-  responses = arma::floor((1.0 / (1.0 + arma::exp(-parameters(0)
-      - predictors.t() * parameters.subvec(1, parameters.n_elem - 1))))
-      + (1.0 - decisionBoundary));
+  #pragma omp parallel for num_threads(numThreads) schedule(static, blockSize)
+  for (omp_size_t i = 0; i < (omp_size_t) predictors.n_cols; ++i)
+    responses[i] = std::floor(1.0 / (1.0 + std::exp(-LinearScore(predictors,
+        i))) + (1.0 - decisionBoundary));
 }
 
-template <template<typename> class OptimizerType>
-double LogisticRegression<OptimizerType>::ComputeError(
+template<template<typename> class OptimizerType, typename MatType>
+double LogisticRegression<OptimizerType, MatType>::LinearScore(
     const arma::mat& predictors,
+    const size_t point) const
+{
+  const double* x = predictors.colptr(point);
+  double score = parameters[0];
+  for (size_t i = 0; i < predictors.n_rows; ++i)
+    score += parameters[i + 1] * x[i];
+
+  return score;
+}
+
+template<template<typename> class OptimizerType, typename MatType>
+double LogisticRegression<OptimizerType, MatType>::LinearScore(
+    const arma::sp_mat& predictors,
+    const size_t point) const
+{
+  double score = parameters[0];
+  for (arma::sp_mat::const_iterator it = predictors.begin_col(point);
+       it != predictors.end_col(point); ++it)
+    score += parameters[it.row() + 1] * (*it);
+
+  return score;
+}
+
+template<template<typename> class OptimizerType, typename MatType>
+void LogisticRegression<OptimizerType, MatType>::CheckDimensionality(
+    const MatType& predictors,
+    const char* function) const
+{
+  if (predictors.n_rows + 1 != parameters.n_elem)
+  {
+    Log::Fatal << "LogisticRegression::" << function << "(): predictors have "
+        << predictors.n_rows << " dimensions, but the model has "
+        << parameters.n_elem - 1 << "!" << std::endl;
+  }
+}
+
+template<template<typename> class OptimizerType, typename MatType>
+size_t LogisticRegression<OptimizerType, MatType>::BlockSize(
+    const size_t dimensionality)
+{
+  // Blocks of about 32k predictors (256kB of dense points) fit in the L2 cache
+  // of most processors, and keep each thread on consecutive memory.
+  return std::max((size_t) 1, (size_t) 32768 / std::max(dimensionality,
+      (size_t) 1));
+}
+
+template<template<typename> class OptimizerType, typename MatType>
+double LogisticRegression<OptimizerType, MatType>::ComputeError(
+    const MatType& predictors,
     const arma::vec& responses) const
 {
   // Construct a new error function.
-  LogisticRegressionFunction newErrorFunction(predictors, responses,
+  LogisticRegressionFunction<MatType> newErrorFunction(predictors, responses,
       lambda);
 
   return newErrorFunction.Evaluate(parameters);
 }
 
-template <template<typename> class OptimizerType>
-double LogisticRegression<OptimizerType>::ComputeAccuracy(
-    const arma::mat& predictors,
+template<template<typename> class OptimizerType, typename MatType>
+double LogisticRegression<OptimizerType, MatType>::ComputeAccuracy(
+    const MatType& predictors,
     const arma::vec& responses,
     const double decisionBoundary) const
 {
@@ -124,8 +224,8 @@ double LogisticRegression<OptimizerType>::ComputeAccuracy(
   return (double) (count * 100) / responses.n_rows;
 }
 
-template <template<typename> class OptimizerType>
-std::string LogisticRegression<OptimizerType>::ToString() const
+template<template<typename> class OptimizerType, typename MatType>
+std::string LogisticRegression<OptimizerType, MatType>::ToString() const
 {
   std::ostringstream convert;
   convert << "Logistic Regression [" << this << "]" << std::endl;
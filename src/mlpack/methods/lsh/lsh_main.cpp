@@ -61,9 +61,22 @@ PARAM_DOUBLE("hash_width", "The hash width for the first-level hashing in the "
     "hash width for its use.", "H", 0.0);
 PARAM_INT("second_hash_size", "The size of the second level hash table.", "M",
     99901);
-PARAM_INT("bucket_size", "The size of a bucket in the second level hash.", "B",
-    500);
+PARAM_INT("bucket_size", "The maximum number of points in a bucket of the "
+    "second level hash; if 0, buckets are not limited.", "B", 0);
 PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
+PARAM_INT("num_probes", "Number of additional buckets to probe in each hash "
+    "table (multi-probe LSH).  Probing more buckets gives better recall with "
+    "fewer tables.", "T", 0);
+PARAM_INT("threads", "Number of threads to use for building the hash and for "
+    "search (0 uses all available cores; ignored if mlpack was built without "
+    "OpenMP).", "t", 0);
+PARAM_STRING("index_file", "If specified, load the hash tables from this file "
+    "(saved earlier with --save_index) instead of building them.  The "
+    "reference dataset must be the one the index was built on; --projections, "
+    "--tables, --hash_width, --second_hash_size and --bucket_size are then "
+    "ignored.", "", "");
+PARAM_STRING("save_index", "If specified, save the built hash tables to this "
+    "file, so later runs can load them with --index_file.", "", "");
 
 int main(int argc, char *argv[])
 {
@@ -105,6 +118,21 @@ int main(int argc, char *argv[])
   const size_t numTables = CLI::GetParam<int>("tables");
   const double hashWidth = CLI::GetParam<double>("hash_width");
 
+  if (CLI::GetParam<int>("num_probes") < 0)
+  {
+    Log::Fatal << "Invalid number of probes: "
+        << CLI::GetParam<int>("num_probes") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+  const size_t numProbes = (size_t) CLI::GetParam<int>("num_probes");
+
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t threads = (size_t) CLI::GetParam<int>("threads");
+
   arma::Mat<size_t> neighbors;
   arma::mat distances;
 
@@ -124,22 +152,48 @@ int main(int argc, char *argv[])
     Log::Info << "Using LSH with " << numProj << " projections (K) and " <<
         numTables << " tables (L) with hash width(r): " << hashWidth << endl;
 
-  Timer::Start("hash_building");
+  const string indexFile = CLI::GetParam<string>("index_file");
+  const string saveIndex = CLI::GetParam<string>("save_index");
 
   LSHSearch<>* allkann;
 
-  if (CLI::GetParam<string>("query_file") != "")
-    allkann = new LSHSearch<>(referenceData, queryData, numProj, numTables,
-                              hashWidth, secondHashSize, bucketSize);
+  if (indexFile != "")
+  {
+    ifstream indexStream(indexFile.c_str(), ios::binary);
+    if (!indexStream.is_open())
+      Log::Fatal << "Cannot open index file '" << indexFile << "'." << endl;
+
+    if (CLI::GetParam<string>("query_file") != "")
+      allkann = new LSHSearch<>(referenceData, queryData, indexStream);
+    else
+      allkann = new LSHSearch<>(referenceData, indexStream);
+  }
   else
-    allkann = new LSHSearch<>(referenceData, numProj, numTables, hashWidth,
-                              secondHashSize, bucketSize);
+  {
+    Timer::Start("hash_building");
 
-  Timer::Stop("hash_building");
+    if (CLI::GetParam<string>("query_file") != "")
+      allkann = new LSHSearch<>(referenceData, queryData, numProj, numTables,
+                                hashWidth, secondHashSize, bucketSize, threads);
+    else
+      allkann = new LSHSearch<>(referenceData, numProj, numTables, hashWidth,
+                                secondHashSize, bucketSize, threads);
+
+    Timer::Stop("hash_building");
+  }
+
+  if (saveIndex != "")
+  {
+    ofstream indexStream(saveIndex.c_str(), ios::binary);
+    if (!indexStream.is_open())
+      Log::Fatal << "Cannot open '" << saveIndex << "' for writing." << endl;
+    allkann->Save(indexStream);
+  }
 
   Log::Info << "Computing " << k << " distance approximate nearest neighbors "
       << endl;
-  allkann->Search(k, neighbors, distances);
+  allkann->Threads() = threads;
+  allkann->Search(k, neighbors, distances, 0, numProbes);
 
   Log::Info << "Neighbors computed." << endl;
 
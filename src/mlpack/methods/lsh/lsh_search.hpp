@@ -27,6 +27,8 @@
 #include <vector>
 #include <string>
 
+#include <boost/type_traits/is_same.hpp>
+
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/methods/neighbor_search/sort_policies/nearest_neighbor_sort.hpp>
 
@@ -61,9 +63,12 @@ class LSHSearch
    *     upper bound on the nearest-neighbor distance in general.
    * @param secondHashSize The size of the second hash table. This should be a
    *     large prime number.
-   * @param bucketSize The size of the bucket in the second hash table. This is
-   *     the maximum number of points that can be hashed into single bucket.
-   *     Default values are already provided here.
+   * @param bucketSize The maximum number of points that are stored in a single
+   *     bucket of the second hash table; further points hashed into a full
+   *     bucket are dropped (with a warning).  If 0 (the default), buckets can
+   *     hold any number of points.
+   * @param threads Number of threads used to build the hash and to search (0
+   *     means all available threads); see Threads().
    */
   LSHSearch(const arma::mat& referenceSet,
             const arma::mat& querySet,
@@ -71,7 +76,8 @@ class LSHSearch
             const size_t numTables,
             const double hashWidth = 0.0,
             const size_t secondHashSize = 99901,
-            const size_t bucketSize = 500);
+            const size_t bucketSize = 0,
+            const size_t threads = 0);
 
   /**
    * This function initializes the LSH class. It builds the hash on the
@@ -89,16 +95,55 @@ class LSHSearch
    *     upper bound on the nearest-neighbor distance in general.
    * @param secondHashSize The size of the second hash table. This should be a
    *     large prime number.
-   * @param bucketSize The size of the bucket in the second hash table. This is
-   *     the maximum number of points that can be hashed into single bucket.
-   *     Default values are already provided here.
+   * @param bucketSize The maximum number of points that are stored in a single
+   *     bucket of the second hash table; further points hashed into a full
+   *     bucket are dropped (with a warning).  If 0 (the default), buckets can
+   *     hold any number of points.
+   * @param threads Number of threads used to build the hash and to search (0
+   *     means all available threads); see Threads().
    */
   LSHSearch(const arma::mat& referenceSet,
             const size_t numProj,
             const size_t numTables,
             const double hashWidth = 0.0,
             const size_t secondHashSize = 99901,
-            const size_t bucketSize = 500);
+            const size_t bucketSize = 0,
+            const size_t threads = 0);
+
+  /**
+   * Load the hash tables of an LSHSearch object that were previously stored
+   * with Save(), instead of building them.  The given reference set must be the
+   * same one the hash tables were built on.  Because the random projections
+   * are stored too, a loaded object gives exactly the same results as the
+   * object that was saved.
+   *
+   * @param referenceSet Set of reference points.
+   * @param querySet Set of query points.
+   * @param stream Binary stream to load the hash tables from.
+   */
+  LSHSearch(const arma::mat& referenceSet,
+            const arma::mat& querySet,
+            std::istream& stream);
+
+  /**
+   * Load the hash tables of an LSHSearch object that were previously stored
+   * with Save(), using the reference set as the query set too.
+   *
+   * @param referenceSet Set of reference points and the set of queries.
+   * @param stream Binary stream to load the hash tables from.
+   */
+  LSHSearch(const arma::mat& referenceSet, std::istream& stream);
+
+  /**
+   * Store the complete state of the hash tables (the projections, offsets,
+   * second hash weights and bucket contents) to the given binary stream, so
+   * that it can be loaded later without rebuilding.  The reference set itself
+   * is not stored.  The arrays are written one after another without any
+   * per-element encoding, so loading is just a few large reads.
+   *
+   * @param stream Binary stream to store the hash tables in.
+   */
+  void Save(std::ostream& stream) const;
 
   /**
    * Compute the nearest neighbors and store the output in the given matrices.
@@ -106,6 +151,10 @@ class LSHSearch
    * the number of points in the query dataset and k is the number of neighbors
    * being searched for.
    *
+   * The queries are hashed in batches, with one matrix multiplication per
+   * batch; if mlpack was compiled with OpenMP, the queries of each batch are
+   * searched in parallel with the number of threads given by Threads().
+   *
    * @param k Number of neighbors to search for.
    * @param resultingNeighbors Matrix storing lists of neighbors for each query
    *     point.
@@ -117,11 +166,27 @@ class LSHSearch
    *     available without having to build hashing for every table size.
    *     By default, this is set to zero in which case all tables are
    *     considered.
+   * @param numProbes The number of additional buckets to probe in each table
+   *     (multi-probe LSH).  Besides the bucket the query hashes to, the
+   *     buckets of the 'numProbes' most likely perturbations of the query's
+   *     key are searched, which gives much better recall for the same number
+   *     of tables.  By default, this is set to zero in which case only the
+   *     query's own bucket is searched.
    */
   void Search(const size_t k,
               arma::Mat<size_t>& resultingNeighbors,
               arma::mat& distances,
-              const size_t numTablesToSearch = 0);
+              const size_t numTablesToSearch = 0,
+              const size_t numProbes = 0);
+
+  //! Get the number of threads used for search (0 means all available
+  //! threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for search (0 means all available
+  //! threads).  This has no effect if mlpack was compiled without OpenMP.  The
+  //! hash is built by the constructor, so pass the number of threads there to
+  //! limit the threads used for building it.
+  size_t& Threads() { return threads; }
 
   // Returns a string representation of this object. 
   std::string ToString() const;
@@ -143,19 +208,59 @@ class LSHSearch
   void BuildHash();
 
   /**
-   * This function takes a query and hashes it into each of the hash tables to
-   * get keys for the query and then the key is hashed to a bucket of the second
-   * hash table and all the points (if any) in those buckets are collected as
-   * the potential neighbor candidates.
+   * Load the hash tables from a stream written by Save(), and check that they
+   * were built on a reference set of the right size.
    *
-   * @param queryIndex The index of the query currently being processed.
-   * @param referenceIndices The list of neighbor candidates obtained from
-   *    hashing the query into all the hash tables and eventually into
-   *    multiple buckets of the second hash table.
+   * @param stream Binary stream to load the hash tables from.
    */
-  void ReturnIndicesFromTable(const size_t queryIndex,
-                              arma::uvec& referenceIndices,
-                              size_t numTablesToSearch);
+  void Load(std::istream& stream);
+
+  /**
+   * This function takes the projections of a query into each of the hash
+   * tables, which give the keys for the query, and then each key is hashed to a
+   * bucket of the second hash table and all the points (if any) in those
+   * buckets are collected as the potential neighbor candidates.
+   *
+   * @param projection The projections of the query into the first
+   *    'numTablesToSearch' tables (one block of 'numProj' values per table),
+   *    offset and divided by the hash width.
+   * @param referenceIndices The distinct neighbor candidates obtained from
+   *    hashing the query into all the hash tables and eventually into multiple
+   *    buckets of the second hash table, in the order they were found.
+   * @param visited Scratch space with one entry per reference point, used to
+   *    skip candidates that were already found; it should hold zeros before
+   *    the first call and be reused for later calls.
+   * @param epoch Counter paired with 'visited'; it should be zero before the
+   *    first call and be reused for later calls.
+   * @param numTablesToSearch The number of tables to search.
+   * @param numProbes The number of additional buckets to probe in each table.
+   */
+  void ReturnIndicesFromTable(const arma::vec& projection,
+                              std::vector<size_t>& referenceIndices,
+                              std::vector<arma::u32>& visited,
+                              arma::u32& epoch,
+                              const size_t numTablesToSearch,
+                              const size_t numProbes) const;
+
+  /**
+   * Find the keys next to a query's key in one table which are the most likely
+   * to hold the query's neighbors, and return their second-level hash values
+   * (before the modulo).  This is the query-directed probing sequence of
+   * multi-probe LSH (Lv et al., 2007): each of the 'numProj' key coordinates
+   * can be moved down or up by one, and a set of such moves is scored by the
+   * sum of the squared distances from the query's projections to the
+   * boundaries they cross.  The sets are generated in order of increasing
+   * score with a heap, so only as many sets as are needed are looked at.
+   *
+   * @param projection The query's projections in the table, offset and divided
+   *     by the hash width (i.e. the key before flooring).
+   * @param numProbes The number of perturbed keys to return.
+   * @param probeHashes The second-level hash values of the perturbed keys, in
+   *     order of decreasing likelihood.
+   */
+  void ProbeHashes(const arma::vec& projection,
+                   const size_t numProbes,
+                   std::vector<double>& probeHashes) const;
 
   /**
    * This is a helper function that computes the distance of the query to the
@@ -188,13 +293,14 @@ class LSHSearch
   const arma::mat& querySet;
 
   //! The number of projections
-  const size_t numProj;
+  size_t numProj;
 
   //! The number of hash tables
-  const size_t numTables;
+  size_t numTables;
 
-  //! The std::vector containing the projection matrix of each table
-  std::vector<arma::mat> projections; // should be [numProj x dims] x numTables
+  //! The projections of all tables; the projections of table i are columns
+  //! [i * numProj, (i + 1) * numProj).
+  arma::mat projections; // should be dims x (numProj * numTables)
 
   //! The list of the offset 'b' for each of the projection for each table
   arma::mat offsets; // should be numProj x numTables
@@ -203,33 +309,36 @@ class LSHSearch
   double hashWidth;
 
   //! The big prime representing the size of the second hash
-  const size_t secondHashSize;
+  size_t secondHashSize;
 
   //! The weights of the second hash
   arma::vec secondHashWeights;
 
-  //! The bucket size of the second hash
-  const size_t bucketSize;
+  //! The maximum number of points in a bucket of the second hash (0 means no
+  //! limit).
+  size_t bucketSize;
 
   //! Instantiation of the metric.
   metric::SquaredEuclideanDistance metric;
 
-  //! The final hash table; should be (< secondHashSize) x bucketSize.
-  arma::Mat<size_t> secondHashTable;
-
-  //! The number of elements present in each hash bucket; should be
-  //! secondHashSize.
-  arma::Col<size_t> bucketContentSize;
+  //! The final hash table: the point IDs of every bucket, stored one bucket
+  //! after another.
+  arma::Col<arma::u32> secondHashTable;
 
-  //! For a particular hash value, points to the row in secondHashTable
-  //! corresponding to this value.  Should be secondHashSize.
-  arma::Col<size_t> bucketRowInHashTable;
+  //! The position in secondHashTable of the first point of each bucket; the
+  //! points of bucket i are in [bucketOffsets[i], bucketOffsets[i + 1]).
+  //! Should be secondHashSize + 1.
+  arma::Col<size_t> bucketOffsets;
 
   //! The pointer to the nearest neighbor distances.
   arma::mat* distancePtr;
 
   //! The pointer to the nearest neighbor indices.
   arma::Mat<size_t>* neighborPtr;
+
+  //! The number of threads to use for building the hash and for search (0
+  //! means all available).
+  size_t threads;
 }; // class LSHSearch
 
 }; // namespace neighbor
@@ -9,6 +9,9 @@
 
 #include <mlpack/core.hpp>
 
+#include <functional>
+#include <queue>
+
 namespace mlpack {
 namespace neighbor {
 
@@ -21,14 +24,16 @@ LSHSearch(const arma::mat& referenceSet,
           const size_t numTables,
           const double hashWidthIn,
           const size_t secondHashSize,
-          const size_t bucketSize) :
+          const size_t bucketSize,
+          const size_t threads) :
   referenceSet(referenceSet),
   querySet(querySet),
   numProj(numProj),
   numTables(numTables),
   hashWidth(hashWidthIn),
   secondHashSize(secondHashSize),
-  bucketSize(bucketSize)
+  bucketSize(bucketSize),
+  threads(threads)
 {
   if (hashWidth == 0.0) // The user has not provided any value.
   {
@@ -57,14 +62,16 @@ LSHSearch(const arma::mat& referenceSet,
           const size_t numTables,
           const double hashWidthIn,
           const size_t secondHashSize,
-          const size_t bucketSize) :
+          const size_t bucketSize,
+          const size_t threads) :
   referenceSet(referenceSet),
   querySet(referenceSet),
   numProj(numProj),
   numTables(numTables),
   hashWidth(hashWidthIn),
   secondHashSize(secondHashSize),
-  bucketSize(bucketSize)
+  bucketSize(bucketSize),
+  threads(threads)
 {
   if (hashWidth == 0.0) // The user has not provided any value.
   {
@@ -86,6 +93,117 @@ LSHSearch(const arma::mat& referenceSet,
   BuildHash();
 }
 
+template<typename SortPolicy>
+LSHSearch<SortPolicy>::
+LSHSearch(const arma::mat& referenceSet,
+          const arma::mat& querySet,
+          std::istream& stream) :
+  referenceSet(referenceSet),
+  querySet(querySet),
+  threads(0)
+{
+  Timer::Start("hash_loading");
+  Load(stream);
+  Timer::Stop("hash_loading");
+}
+
+template<typename SortPolicy>
+LSHSearch<SortPolicy>::
+LSHSearch(const arma::mat& referenceSet, std::istream& stream) :
+  referenceSet(referenceSet),
+  querySet(referenceSet),
+  threads(0)
+{
+  Timer::Start("hash_loading");
+  Load(stream);
+  Timer::Stop("hash_loading");
+}
+
+template<typename SortPolicy>
+void LSHSearch<SortPolicy>::Save(std::ostream& stream) const
+{
+  const size_t magic = 0x4c534853; // "LSHS".
+  const size_t version = 1;
+  util::WriteBinary(stream, magic);
+  util::WriteBinary(stream, version);
+  util::WriteBinary(stream, (size_t) referenceSet.n_rows);
+  util::WriteBinary(stream, (size_t) referenceSet.n_cols);
+
+  util::WriteBinary(stream, numProj);
+  util::WriteBinary(stream, numTables);
+  util::WriteBinary(stream, hashWidth);
+  util::WriteBinary(stream, secondHashSize);
+  util::WriteBinary(stream, bucketSize);
+
+  util::WriteBinary(stream, projections);
+  util::WriteBinary(stream, offsets);
+  util::WriteBinary(stream, secondHashWeights);
+  util::WriteBinary(stream, bucketOffsets);
+  util::WriteBinary(stream, secondHashTable);
+
+  if (!stream)
+    Log::Fatal << "LSHSearch::Save(): error writing to stream." << std::endl;
+}
+
+template<typename SortPolicy>
+void LSHSearch<SortPolicy>::Load(std::istream& stream)
+{
+  // Check the header, so that we don't try to load something that isn't an LSH
+  // index (or an index built on a different dataset).
+  size_t magic, version, rows, cols;
+  util::ReadBinary(stream, magic);
+  util::ReadBinary(stream, version);
+  if (magic != 0x4c534853 /* "LSHS" */ || version != 1)
+    Log::Fatal << "LSHSearch: stream does not hold a stored LSH index."
+        << std::endl;
+
+  util::ReadBinary(stream, rows);
+  util::ReadBinary(stream, cols);
+  if (rows != referenceSet.n_rows || cols != referenceSet.n_cols)
+    Log::Fatal << "LSHSearch: stored index was built on a " << rows << " x "
+        << cols << " dataset, but the given dataset is " << referenceSet.n_rows
+        << " x " << referenceSet.n_cols << "." << std::endl;
+
+  util::ReadBinary(stream, numProj);
+  util::ReadBinary(stream, numTables);
+  util::ReadBinary(stream, hashWidth);
+  util::ReadBinary(stream, secondHashSize);
+  util::ReadBinary(stream, bucketSize);
+
+  util::ReadBinary(stream, projections);
+  util::ReadBinary(stream, offsets);
+  util::ReadBinary(stream, secondHashWeights);
+  util::ReadBinary(stream, bucketOffsets);
+  util::ReadBinary(stream, secondHashTable);
+
+  // Make sure the pieces fit together, so a corrupt file can't make Search()
+  // read out of bounds.
+  if (projections.n_rows != rows || projections.n_cols != numProj * numTables ||
+      offsets.n_rows != numProj || offsets.n_cols != numTables ||
+      secondHashWeights.n_elem != numProj ||
+      bucketOffsets.n_elem != secondHashSize + 1 ||
+      bucketOffsets[secondHashSize] != secondHashTable.n_elem ||
+      (secondHashTable.n_elem > 0 && arma::max(secondHashTable) >= cols))
+  {
+    Log::Fatal << "LSHSearch: stored LSH index is inconsistent." << std::endl;
+  }
+
+  // Each bucket is the range [bucketOffsets[i], bucketOffsets[i + 1]) of
+  // 'secondHashTable', so the offsets must start at 0 and never decrease (the
+  // last one was checked above).
+  if (secondHashSize == 0 || bucketOffsets[0] != 0)
+    Log::Fatal << "LSHSearch: stored LSH index is inconsistent." << std::endl;
+  for (size_t i = 0; i < secondHashSize; ++i)
+  {
+    if (bucketOffsets[i + 1] < bucketOffsets[i])
+      Log::Fatal << "LSHSearch: stored LSH index has malformed buckets."
+          << std::endl;
+  }
+
+  Log::Info << "Loaded LSH index with " << numProj << " projections and "
+      << numTables << " tables (hash width " << hashWidth << ")." << std::endl;
+}
+
 template<typename SortPolicy>
 void LSHSearch<SortPolicy>::
 InsertNeighbor(const size_t queryIndex,
@@ -120,8 +238,13 @@ BaseCase(const size_t queryIndex, const size_t referenceIndex)
   if ((&querySet == &referenceSet) && (queryIndex == referenceIndex))
     return 0.0;
 
-  double distance = metric.Evaluate(querySet.unsafe_col(queryIndex),
-                                    referenceSet.unsafe_col(referenceIndex));
+  // When searching for nearest neighbors, a candidate is only of use if it is
+  // closer than the k'th best so far, so its distance can be abandoned once it
+  // is past that.
+  const double bound = boost::is_same<SortPolicy, NearestNeighborSort>::value ?
+      (*distancePtr)(distancePtr->n_rows - 1, queryIndex) : DBL_MAX;
+  double distance = metric.EvaluateBounded(querySet.unsafe_col(queryIndex),
+      referenceSet.unsafe_col(referenceIndex), bound);
 
   // If this distance is better than any of the current candidates, the
   // SortDistance() function will give us the position to insert it into.
@@ -139,65 +262,151 @@ BaseCase(const size_t queryIndex, const size_t referenceIndex)
 
 template<typename SortPolicy>
 void LSHSearch<SortPolicy>::
-ReturnIndicesFromTable(const size_t queryIndex,
-                       arma::uvec& referenceIndices,
-                       size_t numTablesToSearch)
+ProbeHashes(const arma::vec& projection,
+            const size_t numProbes,
+            std::vector<double>& probeHashes) const
 {
-  // Decide on the number of tables to look into.
-  if (numTablesToSearch == 0) // If no user input is given, search all.
-    numTablesToSearch = numTables;
-
-  // Sanity check to make sure that the existing number of tables is not
-  // exceeded.
-  if (numTablesToSearch > numTables)
-    numTablesToSearch = numTables;
-
-  // Hash the query in each of the 'numTablesToSearch' hash tables using the
-  // 'numProj' projections for each table. This gives us 'numTablesToSearch'
-  // keys for the query where each key is a 'numProj' dimensional integer
-  // vector.
-
-  // Compute the projection of the query in each table.
-  arma::mat allProjInTables(numProj, numTablesToSearch);
-  for (size_t i = 0; i < numTablesToSearch; i++)
+  probeHashes.clear();
+  if (numProbes == 0)
+    return;
+
+  const arma::vec key = arma::floor(projection);
+  const double keyHash = arma::dot(secondHashWeights, key);
+
+  // Score each single move of one coordinate of the key: moving coordinate i
+  // down by one costs the squared distance from the projection to the lower
+  // boundary of its slot, and moving it up costs the squared distance to the
+  // upper boundary.  Move j < numProj moves coordinate j down; move
+  // j >= numProj moves coordinate (j - numProj) up.
+  std::vector<std::pair<double, size_t> > moves(2 * numProj);
+  for (size_t i = 0; i < numProj; ++i)
   {
-    allProjInTables.unsafe_col(i) = projections[i].t() *
-        querySet.unsafe_col(queryIndex);
+    const double lower = projection[i] - key[i];
+    moves[i] = std::make_pair(lower * lower, i);
+    moves[i + numProj] = std::make_pair((1 - lower) * (1 - lower),
+        i + numProj);
   }
-  allProjInTables += offsets.cols(0, numTablesToSearch - 1);
-  allProjInTables /= hashWidth;
+  std::sort(moves.begin(), moves.end());
+
+  // A perturbation set is a sorted list of positions in 'moves'.  Starting from
+  // the set {0}, each set generates the set with its last position shifted by
+  // one and the set extended by the next position; this enumerates every set
+  // exactly once, in order of increasing score.
+  typedef std::pair<double, std::vector<size_t> > ScoredSet;
+  std::priority_queue<ScoredSet, std::vector<ScoredSet>,
+      std::greater<ScoredSet> > heap;
+  heap.push(ScoredSet(moves[0].first, std::vector<size_t>(1, 0)));
+
+  std::vector<bool> moved(numProj);
+  while (probeHashes.size() < numProbes && !heap.empty())
+  {
+    const ScoredSet current = heap.top();
+    heap.pop();
 
-  // Compute the hash value of each key of the query into a bucket of the
-  // 'secondHashTable' using the 'secondHashWeights'.
-  arma::rowvec hashVec = secondHashWeights.t() * arma::floor(allProjInTables);
+    const std::vector<size_t>& positions = current.second;
+    const size_t last = positions.back();
+    if (last + 1 < moves.size())
+    {
+      ScoredSet shifted(current);
+      shifted.first += moves[last + 1].first - moves[last].first;
+      shifted.second.back() = last + 1;
+      heap.push(shifted);
+
+      ScoredSet expanded(current);
+      expanded.first += moves[last + 1].first;
+      expanded.second.push_back(last + 1);
+      heap.push(expanded);
+    }
 
-  for (size_t i = 0; i < hashVec.n_elem; i++)
-    hashVec[i] = (double) ((size_t) hashVec[i] % secondHashSize);
+    // A set is only a valid perturbation if it moves each coordinate at most
+    // once.
+    std::fill(moved.begin(), moved.end(), false);
+    bool valid = true;
+    double hash = keyHash;
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+      const size_t move = moves[positions[i]].second;
+      const size_t coordinate = (move < numProj) ? move : move - numProj;
+      if (moved[coordinate])
+      {
+        valid = false;
+        break;
+      }
+      moved[coordinate] = true;
 
-  Log::Assert(hashVec.n_elem == numTablesToSearch);
+      if (move < numProj)
+        hash -= secondHashWeights[coordinate];
+      else
+        hash += secondHashWeights[coordinate];
+    }
 
-  // For all the buckets that the query is hashed into, sequentially
-  // collect the indices in those buckets.
-  arma::Col<size_t> refPointsConsidered;
-  refPointsConsidered.zeros(referenceSet.n_cols);
+    if (valid)
+      probeHashes.push_back(hash);
+  }
+}
 
-  for (size_t i = 0; i < hashVec.n_elem; i++) // For all tables.
+template<typename SortPolicy>
+void LSHSearch<SortPolicy>::
+ReturnIndicesFromTable(const arma::vec& projection,
+                       std::vector<size_t>& referenceIndices,
+                       std::vector<arma::u32>& visited,
+                       arma::u32& epoch,
+                       const size_t numTablesToSearch,
+                       const size_t numProbes) const
+{
+  // A point has already been found for this query if its entry in 'visited'
+  // equals the current epoch, so starting a new query only takes a new epoch
+  // instead of clearing 'visited'.  Only when the counter wraps around does
+  // 'visited' need to be cleared.
+  if (++epoch == 0)
   {
-    size_t hashInd = (size_t) hashVec[i];
+    std::fill(visited.begin(), visited.end(), 0);
+    epoch = 1;
+  }
 
-    if (bucketContentSize[hashInd] > 0)
+  referenceIndices.clear();
+  std::vector<double> probeHashes;
+  for (size_t i = 0; i < numTablesToSearch; i++) // For all tables.
+  {
+    // The query's projections in table i; flooring these gives the query's
+    // 'numProj' dimensional integer key in that table.
+    const double* tableProjection = projection.memptr() + i * numProj;
+
+    // Compute the hash value of the key into a bucket of the 'secondHashTable'
+    // using the 'secondHashWeights'.
+    double hash = 0;
+    for (size_t j = 0; j < numProj; j++)
+      hash += secondHashWeights[j] * std::floor(tableProjection[j]);
+
+    // With multi-probe LSH, also look at the buckets of the most likely
+    // perturbations of the query's key in this table.
+    if (numProbes > 0)
+    {
+      const arma::vec tableVec(const_cast<double*>(tableProjection), numProj,
+          false, true);
+      ProbeHashes(tableVec, numProbes, probeHashes);
+    }
+
+    // Sequentially collect the indices in the buckets, skipping the ones that
+    // were already found.  This only takes time proportional to the number of
+    // candidates, not to the size of the reference set.
+    for (size_t p = 0; p <= probeHashes.size(); p++)
     {
-      // Pick the indices in the bucket corresponding to 'hashInd'.
-      size_t tableRow = bucketRowInHashTable[hashInd];
-      assert(tableRow < secondHashSize);
-      assert(tableRow < secondHashTable.n_rows);
+      const double bucketHash = (p == 0) ? hash : probeHashes[p - 1];
+      const size_t hashInd = (size_t) bucketHash % secondHashSize;
 
-      for (size_t j = 0; j < bucketContentSize[hashInd]; j++)
-        refPointsConsidered[secondHashTable(tableRow, j)]++;
+      for (size_t j = bucketOffsets[hashInd]; j < bucketOffsets[hashInd + 1];
+           j++)
+      {
+        const arma::u32 index = secondHashTable[j];
+        if (visited[index] != epoch)
+        {
+          visited[index] = epoch;
+          referenceIndices.push_back(index);
+        }
+      }
     }
   }
-
-  referenceIndices = arma::find(refPointsConsidered > 0);
 }
 
 
@@ -206,7 +415,8 @@ void LSHSearch<SortPolicy>::
 Search(const size_t k,
        arma::Mat<size_t>& resultingNeighbors,
        arma::mat& distances,
-       const size_t numTablesToSearch)
+       size_t numTablesToSearch,
+       const size_t numProbes)
 {
   neighborPtr = &resultingNeighbors;
   distancePtr = &distances;
@@ -217,26 +427,95 @@ Search(const size_t k,
   distancePtr->fill(SortPolicy::WorstDistance());
   neighborPtr->fill(referenceSet.n_cols);
 
+  // Decide on the number of tables to look into.
+  if (numTablesToSearch == 0) // If no user input is given, search all.
+    numTablesToSearch = numTables;
+
+  // Sanity check to make sure that the existing number of tables is not
+  // exceeded.
+  if (numTablesToSearch > numTables)
+    numTablesToSearch = numTables;
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
   size_t avgIndicesReturned = 0;
 
   Timer::Start("computing_neighbors");
 
-  // Go through every query point sequentially.
-  for (size_t i = 0; i < querySet.n_cols; i++)
+  // The projections and offsets of the tables that are searched.
+  const arma::mat tableProjections = projections.cols(0,
+      numTablesToSearch * numProj - 1);
+  const arma::vec tableOffsets = arma::vectorise(offsets.cols(0,
+      numTablesToSearch - 1));
+
+  // Each thread deduplicates the candidates of its queries with its own epoch
+  // array (see ReturnIndicesFromTable()).  The arrays and candidate buffers are
+  // allocated once for each Search() (by the thread that uses them, in the
+  // first batch) and reused for every batch, so without multi-probe, searching
+  // a query allocates nothing once its thread's buffer has grown.
+  std::vector<std::vector<size_t> > threadIndices(numThreads);
+  std::vector<std::vector<arma::u32> > threadVisited(numThreads);
+  std::vector<arma::u32> threadEpochs(numThreads, 0);
+
+  // The queries are processed in batches.  The projections of a whole batch
+  // into all the tables are computed with one matrix multiplication, and then
+  // the queries of the batch are hashed and searched in parallel; each query
+  // only writes to its own column of the results.
+  const size_t batchSize = 1024;
+  for (size_t begin = 0; begin < querySet.n_cols; begin += batchSize)
   {
-    // Hash every query into every hash table and eventually into the
-    // 'secondHashTable' to obtain the neighbor candidates.
-    arma::uvec refIndices;
-    ReturnIndicesFromTable(i, refIndices, numTablesToSearch);
-
-    // An informative book-keeping for the number of neighbor candidates
-    // returned on average.
-    avgIndicesReturned += refIndices.n_elem;
-
-    // Sequentially go through all the candidates and save the best 'k'
-    // candidates.
-    for (size_t j = 0; j < refIndices.n_elem; j++)
-      BaseCase(i, (size_t) refIndices[j]);
+    const size_t end = std::min(begin + batchSize, (size_t) querySet.n_cols);
+
+    arma::mat batchProjections = tableProjections.t() *
+        querySet.cols(begin, end - 1);
+    batchProjections.each_col() += tableOffsets;
+    batchProjections /= hashWidth;
+
+    size_t batchIndices = 0;
+    #pragma omp parallel num_threads(numThreads) reduction(+:batchIndices)
+    {
+#ifdef _OPENMP
+      const size_t thread = (size_t) omp_get_thread_num();
+#else
+      const size_t thread = 0;
+#endif
+      std::vector<size_t>& refIndices = threadIndices[thread];
+      std::vector<arma::u32>& visited = threadVisited[thread];
+      // The epoch changes with every query, so it is kept in a local variable
+      // while the batch is searched; the entries of neighbouring threads share
+      // a cache line.
+      arma::u32 epoch = threadEpochs[thread];
+      if (visited.size() != referenceSet.n_cols)
+        visited.assign(referenceSet.n_cols, 0);
+
+      #pragma omp for schedule(dynamic, 16)
+      for (omp_size_t i = 0; i < (omp_size_t) (end - begin); i++)
+      {
+        // Hash the query into every hash table and eventually into the
+        // 'secondHashTable' to obtain the neighbor candidates.
+        ReturnIndicesFromTable(batchProjections.unsafe_col(i), refIndices,
+            visited, epoch, numTablesToSearch, numProbes);
+
+        // An informative book-keeping for the number of neighbor candidates
+        // returned on average.
+        batchIndices += refIndices.size();
+
+        // Sequentially go through all the candidates and save the best 'k'
+        // candidates.
+        for (size_t j = 0; j < refIndices.size(); j++)
+          BaseCase(begin + i, refIndices[j]);
+      }
+
+      // Keep the epoch for the next batch, since 'visited' is kept too.
+      threadEpochs[thread] = epoch;
+    }
+
+    avgIndicesReturned += batchIndices;
   }
 
   Timer::Stop("computing_neighbors");
@@ -271,30 +550,25 @@ BuildHash()
   secondHashWeights = arma::floor(arma::randu(numProj) *
                                   (double) secondHashSize);
 
-  // The 'secondHashTable' is initially an empty matrix of size
-  // ('secondHashSize' x 'bucketSize'). But by only filling the buckets
-  // as points land in them allows us to shrink the size of the
-  // 'secondHashTable' at the end of the hashing.
-
-  // Fill the second hash table n = referenceSet.n_cols.  This is because no
-  // point has index 'n' so the presence of this in the bucket denotes that
-  // there are no more points in this bucket.
-  secondHashTable.set_size(secondHashSize, bucketSize);
-  secondHashTable.fill(referenceSet.n_cols);
-
-  // Keep track of the size of each bucket in the hash.  At the end of hashing
-  // most buckets will be empty.
-  bucketContentSize.zeros(secondHashSize);
-
-  // Instead of putting the points in the row corresponding to the bucket, we
-  // chose the next empty row and keep track of the row in which the bucket
-  // lies. This allows us to stack together and slice out the empty buckets at
-  // the end of the hashing.
-  bucketRowInHashTable.set_size(secondHashSize);
-  bucketRowInHashTable.fill(secondHashSize);
+  // The 'secondHashTable' is stored in compressed form: the points of all
+  // buckets are held contiguously in one array, and 'bucketOffsets' holds the
+  // position of the first point of each bucket (with one extra entry at the
+  // end).  So the memory used scales with the number of points and tables, not
+  // with 'secondHashSize' times the largest bucket, and buckets can hold any
+  // number of points.  Building it takes two passes: the bucket of every point
+  // in every table is found first and the buckets are counted, and then the
+  // points are put in place.  Point indices are stored in 32 bits.
+  if (referenceSet.n_cols >= (size_t) std::numeric_limits<arma::u32>::max())
+  {
+    Log::Fatal << "LSHSearch::BuildHash(): too many reference points ("
+        << referenceSet.n_cols << "); at most "
+        << std::numeric_limits<arma::u32>::max() - 1 << " are supported."
+        << std::endl;
+  }
 
-  // Keep track of number of non-empty rows in the 'secondHashTable'.
-  size_t numRowsInTable = 0;
+  // The bucket of each point in each table; point j of table i is at
+  // i * referenceSet.n_cols + j.
+  std::vector<arma::u32> pointBuckets(numTables * referenceSet.n_cols);
 
   // Step II: The offsets for all projections in all tables.
   // Since the 'offsets' are in [0, hashWidth], we obtain the 'offsets'
@@ -302,92 +576,120 @@ BuildHash()
   offsets.randu(numProj, numTables);
   offsets *= hashWidth;
 
-  // Step III: Create each hash table in the first level hash one by one and
-  // putting them directly into the 'secondHashTable' for memory efficiency.
+  // Step III: Obtain the 'numProj' projections for each table.  The
+  // projections of table i are columns [i * numProj, (i + 1) * numProj) of
+  // 'projections', so that the keys of a point in all tables can be computed
+  // with one matrix multiplication.
+
+  // For L2 metric, 2-stable distributions are used, and
+  // the normal Z ~ N(0, 1) is a 2-stable distribution.
+  projections.set_size(referenceSet.n_rows, numProj * numTables);
   for (size_t i = 0; i < numTables; i++)
   {
-    // Step IV: Obtain the 'numProj' projections for each table.
-
-    // For L2 metric, 2-stable distributions are used, and
-    // the normal Z ~ N(0, 1) is a 2-stable distribution.
     arma::mat projMat;
     projMat.randn(referenceSet.n_rows, numProj);
+    projections.cols(i * numProj, (i + 1) * numProj - 1) = projMat;
+  }
+  const arma::vec allOffsets = arma::vectorise(offsets);
 
-    // Save the projection matrix for querying.
-    projections.push_back(projMat);
-
-    // Step V: create the 'numProj'-dimensional key for each point in each
-    // table.
-
-    // The following code performs the task of hashing each point to a
-    // 'numProj'-dimensional integer key.  Hence you get a ('numProj' x
-    // 'referenceSet.n_cols') key matrix.
-    //
-    // For a single table, let the 'numProj' projections be denoted by 'proj_i'
-    // and the corresponding offset be 'offset_i'.  Then the key of a single
-    // point is obtained as:
-    // key = { floor( (<proj_i, point> + offset_i) / 'hashWidth' ) forall i }
-    arma::mat offsetMat = arma::repmat(offsets.unsafe_col(i), 1,
-                                       referenceSet.n_cols);
-    arma::mat hashMat = projMat.t() * referenceSet;
-    hashMat += offsetMat;
-    hashMat /= hashWidth;
-
-    // Step VI: Putting the points in the 'secondHashTable' by hashing the key.
-    // Now we hash every key, point ID to its corresponding bucket.
-    arma::rowvec secondHashVec = secondHashWeights.t()
-      * arma::floor(hashMat);
-
-    // This gives us the bucket for the corresponding point ID.
-    for (size_t j = 0; j < secondHashVec.n_elem; j++)
-      secondHashVec[j] = (double)((size_t) secondHashVec[j] % secondHashSize);
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
 
-    Log::Assert(secondHashVec.n_elem == referenceSet.n_cols);
+  // Step IV: create the 'numProj'-dimensional key for each point in each
+  // table.
+  //
+  // For a single table, let the 'numProj' projections be denoted by 'proj_i'
+  // and the corresponding offset be 'offset_i'.  Then the key of a single
+  // point is obtained as:
+  // key = { floor( (<proj_i, point> + offset_i) / 'hashWidth' ) forall i }
+  //
+  // This is done for blocks of points at a time, so that the projections of
+  // the block into every table are one matrix multiplication, while the
+  // ('numProj' * 'numTables' x block size) key matrix stays small.
+  const size_t blockSize = 4096;
+  for (size_t begin = 0; begin < referenceSet.n_cols; begin += blockSize)
+  {
+    const size_t end = std::min(begin + blockSize,
+        (size_t) referenceSet.n_cols);
 
-    // Insert the point in the corresponding row to its bucket in the
-    // 'secondHashTable'.
-    for (size_t j = 0; j < secondHashVec.n_elem; j++)
+    arma::mat hashMat = projections.t() * referenceSet.cols(begin, end - 1);
+    hashMat.each_col() += allOffsets;
+    hashMat /= hashWidth;
+    hashMat = arma::floor(hashMat);
+
+    // Step V: Hash every key to its bucket in the 'secondHashTable', as
+    // <key, 'secondHashWeights'> % 'secondHashSize'.  The keys are integers,
+    // so the sum is exact regardless of the order it is taken in.  The points
+    // of the block are hashed in parallel.
+    #pragma omp parallel for num_threads(numThreads)
+    for (omp_size_t j = 0; j < (omp_size_t) (end - begin); j++)
     {
-      // This is the bucket number.
-      size_t hashInd = (size_t) secondHashVec[j];
-      // The point ID is 'j'.
-
-      // If this is currently an empty bucket, start a new row keep track of
-      // which row corresponds to the bucket.
-      if (bucketContentSize[hashInd] == 0)
+      for (size_t i = 0; i < numTables; i++)
       {
-        // Start a new row for hash.
-        bucketRowInHashTable[hashInd] = numRowsInTable;
-        secondHashTable(numRowsInTable, 0) = j;
+        const double* key = hashMat.colptr(j) + i * numProj;
+        double hash = 0.0;
+        for (size_t p = 0; p < numProj; p++)
+          hash += secondHashWeights[p] * key[p];
 
-        numRowsInTable++;
+        pointBuckets[i * referenceSet.n_cols + begin + j] =
+            (arma::u32) ((size_t) hash % secondHashSize);
       }
+    }
+  }
 
-      else
-      {
-        // If bucket is already present in the 'secondHashTable', find the
-        // corresponding row and insert the point ID in this row unless the
-        // bucket is full, in which case, do nothing.
-        if (bucketContentSize[hashInd] < bucketSize)
-          secondHashTable(bucketRowInHashTable[hashInd],
-                          bucketContentSize[hashInd]) = j;
-      }
+  // Step VI: Count the points in each bucket.  If the bucket size is limited,
+  // only the first 'bucketSize' points to arrive in a bucket are stored.
+  arma::Col<size_t> bucketCounts;
+  bucketCounts.zeros(secondHashSize);
+  size_t numDropped = 0;
+  for (size_t i = 0; i < pointBuckets.size(); i++)
+  {
+    if (bucketSize == 0 || bucketCounts[pointBuckets[i]] < bucketSize)
+      bucketCounts[pointBuckets[i]]++;
+    else
+      numDropped++;
+  }
 
-      // Increment the count of the points in this bucket.
-      if (bucketContentSize[hashInd] < bucketSize)
-        bucketContentSize[hashInd]++;
-    } // Loop over all points in the reference set.
-  } // Loop over tables.
+  if (numDropped > 0)
+    Log::Warn << numDropped << " points were not stored because their bucket "
+        << "was full (bucket size " << bucketSize << ")." << std::endl;
+
+  bucketOffsets.set_size(secondHashSize + 1);
+  bucketOffsets[0] = 0;
+  for (size_t i = 0; i < secondHashSize; i++)
+    bucketOffsets[i + 1] = bucketOffsets[i] + bucketCounts[i];
+
+  // Step VII: Put the point IDs in their buckets, in the same order as they
+  // were counted.  'bucketCounts' is reused as the fill position of each
+  // bucket.
+  secondHashTable.set_size(bucketOffsets[secondHashSize]);
+  bucketCounts = bucketOffsets.subvec(0, secondHashSize - 1);
+  for (size_t i = 0; i < pointBuckets.size(); i++)
+  {
+    const size_t hashInd = pointBuckets[i];
+    if (bucketCounts[hashInd] < bucketOffsets[hashInd + 1])
+      secondHashTable[bucketCounts[hashInd]++] =
+          (arma::u32) (i % referenceSet.n_cols);
+  }
 
-  // Step VII: Condensing the 'secondHashTable'.
+  size_t numBuckets = 0;
   size_t maxBucketSize = 0;
-  for (size_t i = 0; i < bucketContentSize.n_elem; i++)
-    if (bucketContentSize[i] > maxBucketSize)
-      maxBucketSize = bucketContentSize[i];
+  for (size_t i = 0; i < secondHashSize; i++)
+  {
+    const size_t count = bucketOffsets[i + 1] - bucketOffsets[i];
+    if (count > 0)
+      numBuckets++;
+    if (count > maxBucketSize)
+      maxBucketSize = count;
+  }
 
-  Log::Info << "Final hash table size: (" << numRowsInTable << " x "
-            << maxBucketSize << ")" << std::endl;
-  secondHashTable.resize(numRowsInTable, maxBucketSize);
+  Log::Info << "Final hash table size: " << secondHashTable.n_elem
+      << " points in " << numBuckets << " buckets (largest bucket: "
+      << maxBucketSize << " points)." << std::endl;
 }
 
 template<typename SortPolicy>
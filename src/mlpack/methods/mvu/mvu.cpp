@@ -36,19 +36,27 @@ void MVU::Unfold(const size_t newDim,
   LRSDP mvuSolver(numNeighbors * data.n_cols + 1, outputData);
 
   // Set up the objective.  Because we are maximizing the trace of (R R^T),
-  // we'll instead state it as min(-I_n * (R R^T)), meaning C() is -I_n.
-  mvuSolver.C().eye(data.n_cols, data.n_cols);
-  mvuSolver.C() *= -1;
+  // we'll instead state it as min(-I_n * (R R^T)), meaning C() is -I_n.  This
+  // is stored sparsely, so that no n x n matrix is needed.
+  mvuSolver.CMode() = 1;
+  mvuSolver.C().set_size(3, data.n_cols);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    mvuSolver.C()(0, i) = i;
+    mvuSolver.C()(1, i) = i;
+    mvuSolver.C()(2, i) = -1;
+  }
 
   // Now set up each of the constraints.
-  // The first constraint is trace(ones * R * R^T) = 0.
+  // The first constraint is trace(ones * R * R^T) = 0.  The matrix of ones is
+  // e e^T, so it is stored in low-rank form as the vector e.
   mvuSolver.B()[0] = 0;
-  mvuSolver.A()[0].ones(data.n_cols, data.n_cols);
+  mvuSolver.A()[0].ones(data.n_cols, 1);
 
-  // All of our other constraints will be sparse except the first.  So set that
-  // vector of modes accordingly.
+  // All of our other constraints will be sparse except the first, which is
+  // low-rank.  So set that vector of modes accordingly.
   mvuSolver.AModes().ones();
-  mvuSolver.AModes()[0] = 0;
+  mvuSolver.AModes()[0] = 2;
 
   // Now all of the other constraints.  We first have to run AllkNN to get the
   // list of nearest neighbors.
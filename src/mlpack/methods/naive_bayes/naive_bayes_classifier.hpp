@@ -37,20 +37,80 @@ namespace naive_bayes /** The Naive Bayes Classifier. */ {
  *
  * nbc.Classify(testing_data, results);
  * @endcode
+ *
+ * @tparam MatType Type of the data (arma::mat or arma::sp_mat).  With sparse
+ *     data, training and classification only touch the nonzero elements.
  */
 template<typename MatType = arma::mat>
 class NaiveBayesClassifier
 {
  private:
   //! Sample mean for each class.
-  MatType means;
+  arma::mat means;
 
   //! Sample variances for each class.
-  MatType variances;
+  arma::mat variances;
 
   //! Class probabilities.
   arma::vec probabilities;
 
+  //! Number of training points seen in each class.
+  arma::vec counts;
+
+  //! Sum of squared deviations from the class mean, for each class; this is
+  //! the accumulator from which the variances are computed.
+  arma::mat squaredDeviations;
+
+  //! Recompute the variances and class probabilities from the accumulators.
+  void UpdateModel();
+
+  //! Get the given point of dense data.
+  static void GetPoint(const arma::mat& data,
+                       const size_t index,
+                       arma::vec& point)
+  { point = data.col(index); }
+  //! Get the given point of sparse data, as a dense vector.
+  static void GetPoint(const arma::sp_mat& data,
+                       const size_t index,
+                       arma::vec& point);
+
+  //! Add each point to the sum of its class in means.
+  void AddClassSums(const arma::mat& data, const arma::Col<size_t>& labels);
+  //! Add each point to the sum of its class in means, using only the nonzero
+  //! elements.
+  void AddClassSums(const arma::sp_mat& data, const arma::Col<size_t>& labels);
+
+  //! Add the squared deviation of each point from the mean of its class to
+  //! variances.
+  void AddSquaredDeviations(const arma::mat& data,
+                            const arma::Col<size_t>& labels);
+  //! Add the squared deviation of each point from the mean of its class to
+  //! variances, using only the nonzero elements.
+  void AddSquaredDeviations(const arma::sp_mat& data,
+                            const arma::Col<size_t>& labels);
+
+  /**
+   * Compute the data-dependent part of the log-likelihood of the points in
+   * columns [begin, end) under each class, which is the quadratic form
+   * x^T D x - 2 mu^T D x for the diagonal inverse covariance D of each class.
+   * This is done with two matrix products, one row of scores per class and one
+   * column per point.
+   */
+  static void BlockScores(const arma::mat& data,
+                          const size_t begin,
+                          const size_t end,
+                          const arma::mat& invVarTrans,
+                          const arma::mat& weightedMeansTrans,
+                          arma::mat& scores);
+  //! Compute the data-dependent part of the log-likelihood of the points in
+  //! columns [begin, end) under each class, using only the nonzero elements.
+  static void BlockScores(const arma::sp_mat& data,
+                          const size_t begin,
+                          const size_t end,
+                          const arma::mat& invVarTrans,
+                          const arma::mat& weightedMeansTrans,
+                          arma::mat& scores);
+
  public:
   /**
    * Initializes the classifier as per the input and then trains it by
@@ -77,9 +137,46 @@ class NaiveBayesClassifier
                        const size_t classes,
                        const bool incrementalVariance = false);
 
+  /**
+   * Initialize an empty classifier, which can then be trained a chunk at a time
+   * with Train(), or by merging other classifiers into it with Merge().
+   *
+   * @param dimensionality Dimensionality of the data.
+   * @param classes Number of classes in this classifier.
+   */
+  NaiveBayesClassifier(const size_t dimensionality = 0,
+                       const size_t classes = 0);
+
+  /**
+   * Update the classifier with another chunk of training data, without
+   * revisiting any data it has already seen.  The means and variances of the
+   * chunk are computed with the two-pass algorithm, and are then combined with
+   * the current model as in Welford's algorithm (generalized to chunks by
+   * Chan et al.), so training one chunk at a time gives the same model as
+   * training on all of the data at once, up to floating-point error.
+   *
+   * @param data Training data points.
+   * @param labels Labels corresponding to training data points.
+   */
+  void Train(const MatType& data, const arma::Col<size_t>& labels);
+
+  /**
+   * Merge another classifier, trained on different data with the same
+   * dimensionality and number of classes, into this one.  The result is the
+   * model that would have been trained on the data of both.  This allows
+   * chunks of a dataset to be trained on separately (for instance, by
+   * different workers) and then combined.
+   *
+   * @param other Classifier to merge into this one.
+   */
+  void Merge(const NaiveBayesClassifier& other);
+
   /**
    * Given a bunch of data points, this function evaluates the class of each of
-   * those data points, and puts it in the vector 'results'.
+   * those data points, and puts it in the vector 'results'.  The points are
+   * classified in blocks, each with two matrix products against precomputed
+   * inverse variances, and the blocks are split between threads when OpenMP is
+   * available.
    *
    * @code
    * arma::mat test_data; // each column is a test point
@@ -94,19 +191,22 @@ class NaiveBayesClassifier
   void Classify(const MatType& data, arma::Col<size_t>& results);
 
   //! Get the sample means for each class.
-  const MatType& Means() const { return means; }
+  const arma::mat& Means() const { return means; }
   //! Modify the sample means for each class.
-  MatType& Means() { return means; }
+  arma::mat& Means() { return means; }
 
   //! Get the sample variances for each class.
-  const MatType& Variances() const { return variances; }
+  const arma::mat& Variances() const { return variances; }
   //! Modify the sample variances for each class.
-  MatType& Variances() { return variances; }
+  arma::mat& Variances() { return variances; }
 
   //! Get the prior probabilities for each class.
   const arma::vec& Probabilities() const { return probabilities; }
   //! Modify the prior probabilities for each class.
   arma::vec& Probabilities() { return probabilities; }
+
+  //! Get the number of training points seen in each class.
+  const arma::vec& Counts() const { return counts; }
 };
 
 }; // namespace naive_bayes
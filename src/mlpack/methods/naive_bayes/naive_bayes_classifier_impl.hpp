@@ -42,20 +42,16 @@ NaiveBayesClassifier<MatType>::NaiveBayesClassifier(
   if (incrementalVariance)
   {
     // Use incremental algorithm.
+    arma::vec point;
     for (size_t j = 0; j < data.n_cols; ++j)
     {
       const size_t label = labels[j];
       ++probabilities[label];
 
-      arma::vec delta = data.col(j) - means.col(label);
+      GetPoint(data, j, point);
+      arma::vec delta = point - means.col(label);
       means.col(label) += delta / probabilities[label];
-      variances.col(label) += delta % (data.col(j) - means.col(label));
-    }
-
-    for (size_t i = 0; i < classes; ++i)
-    {
-      if (probabilities[i] > 2)
-        variances.col(i) /= (probabilities[i] - 1);
+      variances.col(label) += delta % (point - means.col(label));
     }
   }
   else
@@ -68,11 +64,8 @@ NaiveBayesClassifier<MatType>::NaiveBayesClassifier(
 
     // Calculate the means.
     for (size_t j = 0; j < data.n_cols; ++j)
-    {
-      const size_t label = labels[j];
-      ++probabilities[label];
-      means.col(label) += data.col(j);
-    }
+      ++probabilities[labels[j]];
+    AddClassSums(data, labels);
 
     // Normalize means.
     for (size_t i = 0; i < classes; ++i)
@@ -80,24 +73,86 @@ NaiveBayesClassifier<MatType>::NaiveBayesClassifier(
         means.col(i) /= probabilities[i];
 
     // Calculate variances.
-    for (size_t j = 0; j < data.n_cols; ++j)
-    {
-      const size_t label = labels[j];
-      variances.col(label) += square(data.col(j) - means.col(label));
-    }
+    AddSquaredDeviations(data, labels);
+  }
 
-    // Normalize variances.
-    for (size_t i = 0; i < classes; ++i)
-      if (probabilities[i] > 1)
-        variances.col(i) /= (probabilities[i] - 1);
+  // At this point probabilities holds the number of points in each class, and
+  // variances holds the sums of squared deviations; keep these, so that the
+  // model can be updated later.
+  counts = probabilities;
+  squaredDeviations = variances;
+  UpdateModel();
+}
+
+template<typename MatType>
+NaiveBayesClassifier<MatType>::NaiveBayesClassifier(
+    const size_t dimensionality,
+    const size_t classes)
+{
+  probabilities.zeros(classes);
+  means.zeros(dimensionality, classes);
+  variances.zeros(dimensionality, classes);
+  counts.zeros(classes);
+  squaredDeviations.zeros(dimensionality, classes);
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::Train(const MatType& data,
+                                          const arma::Col<size_t>& labels)
+{
+  // Train a model on this chunk alone, then merge it in.
+  NaiveBayesClassifier chunk(data, labels, means.n_cols);
+  Merge(chunk);
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::Merge(const NaiveBayesClassifier& other)
+{
+  if ((other.means.n_rows != means.n_rows) ||
+      (other.means.n_cols != means.n_cols))
+    Log::Fatal << "NaiveBayesClassifier::Merge(): cannot merge a classifier "
+        << "with " << other.means.n_rows << " dimensions and "
+        << other.means.n_cols << " classes into one with " << means.n_rows
+        << " dimensions and " << means.n_cols << " classes!" << std::endl;
+
+  for (size_t i = 0; i < means.n_cols; ++i)
+  {
+    const double otherCount = other.counts[i];
+    if (otherCount == 0.0)
+      continue;
+
+    // Combine the means and the sums of squared deviations of the two sets of
+    // points; see Chan, Golub, and LeVeque (1979).
+    const double count = counts[i] + otherCount;
+    const arma::vec delta = other.means.col(i) - means.col(i);
+    squaredDeviations.col(i) += other.squaredDeviations.col(i) +
+        (delta % delta) * (counts[i] * otherCount / count);
+    means.col(i) += delta * (otherCount / count);
+    counts[i] = count;
   }
 
+  UpdateModel();
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::UpdateModel()
+{
+  // Normalize variances.
+  variances = squaredDeviations;
+  for (size_t i = 0; i < counts.n_elem; ++i)
+    if (counts[i] > 1)
+      variances.col(i) /= (counts[i] - 1);
+
   // Ensure that the variances are invertible.
   for (size_t i = 0; i < variances.n_elem; ++i)
     if (variances[i] == 0.0)
       variances[i] = 1e-50;
 
-  probabilities /= data.n_cols;
+  const double total = arma::accu(counts);
+  if (total > 0.0)
+    probabilities = counts / total;
+  else
+    probabilities.zeros(counts.n_elem);
 }
 
 template<typename MatType>
@@ -108,46 +163,141 @@ void NaiveBayesClassifier<MatType>::Classify(const MatType& data,
   // training data.
   Log::Assert(data.n_rows == means.n_rows);
 
-  arma::vec probs = arma::log(probabilities);
-  arma::mat invVar = 1.0 / variances;
-
-  arma::mat testProbs = arma::repmat(probs.t(), data.n_cols, 1);
-
   results.set_size(data.n_cols); // No need to fill with anything yet.
 
   Log::Info << "Running Naive Bayes classifier on " << data.n_cols
       << " data points with " << data.n_rows << " features each." << std::endl;
 
-  // Calculate the joint probability for each of the data points for each of the
-  // means.n_cols.
+  // Expand the log-likelihood of each class, which is an adaptation of
+  // gmm::phi() for the case where the covariance is a diagonal matrix D, into
+  // -0.5 (x^T D x - 2 mu^T D x) plus a constant.  The constant holds the log
+  // prior, the log normalizer, and -0.5 mu^T D mu.
+  const arma::mat invVar = 1.0 / variances;
+  const arma::mat invVarTrans = trans(invVar);
+  const arma::mat weightedMeansTrans = trans(means % invVar);
 
-  // Loop over every class.
-  for (size_t i = 0; i < means.n_cols; i++)
+  arma::vec constants(means.n_cols);
+  for (size_t i = 0; i < means.n_cols; ++i)
   {
-    // This is an adaptation of gmm::phi() for the case where the covariance is
-    // a diagonal matrix.
-    arma::mat diffs = data - arma::repmat(means.col(i), 1, data.n_cols);
-    arma::mat rhs = -0.5 * arma::diagmat(invVar.col(i)) * diffs;
-    arma::vec exponents(diffs.n_cols);
-    for (size_t j = 0; j < diffs.n_cols; ++j)
-      exponents(j) = std::exp(arma::accu(diffs.col(j) % rhs.unsafe_col(j)));
-
-    testProbs.col(i) += log(pow(2 * M_PI, (double) data.n_rows / -2.0) *
-        pow(det(arma::diagmat(invVar.col(i))), -0.5) * exponents);
+    constants[i] = std::log(probabilities[i]) - 0.5 * data.n_rows *
+        std::log(2 * M_PI) - 0.5 * arma::accu(arma::log(variances.col(i))) -
+        0.5 * arma::accu(means.col(i) % trans(weightedMeansTrans.row(i)));
   }
 
-  // Now calculate the label.
-  for (size_t i = 0; i < data.n_cols; ++i)
+  // Classify the points a block at a time, so that the scores never take more
+  // than (classes x blockSize) memory per thread.
+  const size_t blockSize = 1024;
+  const size_t numBlocks = (data.n_cols + blockSize - 1) / blockSize;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (omp_size_t block = 0; block < (omp_size_t) numBlocks; ++block)
   {
-    // Find the index of the class with maximum probability for this point.
-    arma::uword maxIndex = 0;
-    arma::vec pointProbs = testProbs.row(i).t();
-    pointProbs.max(maxIndex);
+    const size_t begin = block * blockSize;
+    const size_t end = std::min((size_t) data.n_cols, begin + blockSize);
+
+    arma::mat scores;
+    BlockScores(data, begin, end, invVarTrans, weightedMeansTrans, scores);
+
+    // Find the index of the class with maximum probability for each point.
+    for (size_t j = 0; j < scores.n_cols; ++j)
+    {
+      arma::uword maxIndex = 0;
+      const arma::vec pointProbs = constants - 0.5 * scores.unsafe_col(j);
+      pointProbs.max(maxIndex);
 
-    results[i] = maxIndex;
+      results[begin + j] = maxIndex;
+    }
   }
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::GetPoint(const arma::sp_mat& data,
+                                             const size_t index,
+                                             arma::vec& point)
+{
+  point.zeros(data.n_rows);
+  for (arma::sp_mat::const_iterator it = data.begin_col(index);
+       it != data.end_col(index); ++it)
+    point[it.row()] = *it;
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::AddClassSums(
+    const arma::mat& data,
+    const arma::Col<size_t>& labels)
+{
+  for (size_t j = 0; j < data.n_cols; ++j)
+    means.col(labels[j]) += data.col(j);
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::AddClassSums(
+    const arma::sp_mat& data,
+    const arma::Col<size_t>& labels)
+{
+  for (arma::sp_mat::const_iterator it = data.begin(); it != data.end(); ++it)
+    means(it.row(), labels[it.col()]) += *it;
+}
 
-  return;
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::AddSquaredDeviations(
+    const arma::mat& data,
+    const arma::Col<size_t>& labels)
+{
+  for (size_t j = 0; j < data.n_cols; ++j)
+  {
+    const size_t label = labels[j];
+    variances.col(label) += square(data.col(j) - means.col(label));
+  }
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::AddSquaredDeviations(
+    const arma::sp_mat& data,
+    const arma::Col<size_t>& labels)
+{
+  // Every point of a class is first taken to be zero, which deviates from the
+  // mean by the mean itself; the nonzero elements are then corrected.  This is
+  // still the two-pass algorithm, so it loses no precision.
+  for (size_t i = 0; i < means.n_cols; ++i)
+    variances.col(i) += probabilities[i] * (means.col(i) % means.col(i));
+
+  for (arma::sp_mat::const_iterator it = data.begin(); it != data.end(); ++it)
+  {
+    const double mean = means(it.row(), labels[it.col()]);
+    const double deviation = (*it) - mean;
+    variances(it.row(), labels[it.col()]) += deviation * deviation -
+        mean * mean;
+  }
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::BlockScores(
+    const arma::mat& data,
+    const size_t begin,
+    const size_t end,
+    const arma::mat& invVarTrans,
+    const arma::mat& weightedMeansTrans,
+    arma::mat& scores)
+{
+  const arma::mat block = data.cols(begin, end - 1);
+  scores = invVarTrans * arma::square(block) - 2 * weightedMeansTrans * block;
+}
+
+template<typename MatType>
+void NaiveBayesClassifier<MatType>::BlockScores(
+    const arma::sp_mat& data,
+    const size_t begin,
+    const size_t end,
+    const arma::mat& invVarTrans,
+    const arma::mat& weightedMeansTrans,
+    arma::mat& scores)
+{
+  // Expand (x - mu)^T D (x - mu) as for dense data, so that only the nonzero
+  // elements of each point are used.
+  const arma::sp_mat block = data.cols(begin, end - 1);
+  const arma::sp_mat squares = block % block;
+  scores = invVarTrans * squares - 2 * weightedMeansTrans * block;
 }
 
 }; // namespace naive_bayes
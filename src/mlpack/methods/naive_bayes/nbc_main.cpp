@@ -11,6 +11,8 @@
 
 #include "naive_bayes_classifier.hpp"
 
+#include <algorithm>
+
 PROGRAM_INFO("Parametric Naive Bayes Classifier",
     "This program trains the Naive Bayes classifier on the given labeled "
     "training set and then uses the trained classifier to classify the points "
@@ -22,7 +24,11 @@ PROGRAM_INFO("Parametric Naive Bayes Classifier",
     "\n\n"
     "The '--incremental_variance' option can be used to force the training to "
     "use an incremental algorithm for calculating variance.  This is slower, "
-    "but can help avoid loss of precision in some cases.");
+    "but can help avoid loss of precision in some cases."
+    "\n\n"
+    "Sparse data can be given as libsvm files (.svm or .libsvm), which hold "
+    "their own labels, or as Matrix Market files (.mtx) together with "
+    "--labels_file; it is then never stored as a dense matrix.");
 
 PARAM_STRING_REQ("train_file", "A file containing the training set.", "t");
 PARAM_STRING_REQ("test_file", "A file containing the test set.", "T");
@@ -39,32 +45,135 @@ using namespace mlpack::naive_bayes;
 using namespace std;
 using namespace arma;
 
+// Train on the given data, classify the test data, and save the results.
+template<typename MatType>
+void RunNBC(const MatType& trainingData,
+            const Col<size_t>& labels,
+            const vec& mappings,
+            const MatType& testingData)
+{
+  if (testingData.n_rows != trainingData.n_rows)
+    Log::Fatal << "Test data dimensionality (" << testingData.n_rows << ") "
+        << "must be the same as training data (" << trainingData.n_rows
+        << ")!" << std::endl;
+
+  const bool incrementalVariance = CLI::HasParam("incremental_variance");
+
+  // Create and train the classifier.
+  Timer::Start("training");
+  NaiveBayesClassifier<MatType> nbc(trainingData, labels, mappings.n_elem,
+      incrementalVariance);
+  Timer::Stop("training");
+
+  // Time the running of the Naive Bayes Classifier.
+  Col<size_t> results;
+  Timer::Start("testing");
+  nbc.Classify(testingData, results);
+  Timer::Stop("testing");
+
+  // Un-normalize labels to prepare output.
+  vec rawResults;
+  data::RevertLabels(results, mappings, rawResults);
+
+  // Output results.  Don't transpose: one result per line.
+  const string outputFilename = CLI::GetParam<string>("output");
+  data::Save(outputFilename, rawResults, true, false);
+}
+
+// Return whether the file holds a sparse matrix, judging by its extension.
+bool SparseFile(const string& filename)
+{
+  const size_t ext = filename.rfind('.');
+  if (ext == string::npos)
+    return false;
+
+  string extension = filename.substr(ext + 1);
+  transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  return (extension == "svm" || extension == "libsvm" || extension == "mtx");
+}
+
+// Give the sparse matrix the given number of rows, keeping its elements.
+void AddRows(sp_mat& matrix, const size_t rows)
+{
+  if (matrix.n_rows == rows)
+    return;
+
+  umat locations(2, matrix.n_nonzero);
+  vec values(matrix.n_nonzero);
+  size_t i = 0;
+  for (sp_mat::const_iterator it = matrix.begin(); it != matrix.end(); ++it)
+  {
+    locations(0, i) = it.row();
+    locations(1, i) = it.col();
+    values[i++] = *it;
+  }
+
+  matrix = sp_mat(locations, values, rows, matrix.n_cols);
+}
+
+// Load labels from the given file.
+void LoadLabels(const string& labelsFilename, Col<size_t>& labels,
+                vec& mappings)
+{
+  mat rawLabels;
+  data::Load(labelsFilename, rawLabels, true, false);
+
+  // Do the labels need to be transposed?
+  if (rawLabels.n_rows == 1)
+    rawLabels = rawLabels.t();
+
+  data::NormalizeLabels(rawLabels.unsafe_col(0), labels, mappings);
+}
+
 int main(int argc, char* argv[])
 {
   CLI::ParseCommandLine(argc, argv);
 
   // Check input parameters.
   const string trainingDataFilename = CLI::GetParam<string>("train_file");
-  mat trainingData;
-  data::Load(trainingDataFilename, trainingData, true);
+  const string testingDataFilename = CLI::GetParam<std::string>("test_file");
+  const string labelsFilename = CLI::GetParam<string>("labels_file");
 
   // Normalize labels.
   Col<size_t> labels;
   vec mappings;
 
-  // Did the user pass in labels?
-  const string labelsFilename = CLI::GetParam<string>("labels_file");
-  if (labelsFilename != "")
+  if (SparseFile(trainingDataFilename))
   {
-    // Load labels.
-    mat rawLabels;
-    data::Load(labelsFilename, rawLabels, true, false);
+    sp_mat trainingData;
+    if (labelsFilename != "")
+    {
+      data::Load(trainingDataFilename, trainingData, true);
+      LoadLabels(labelsFilename, labels, mappings);
+    }
+    else
+    {
+      // libsvm files have their own labels.
+      vec rawLabels;
+      data::LoadLibSVM(trainingDataFilename, trainingData, rawLabels, true);
+      data::NormalizeLabels(rawLabels, labels, mappings);
+    }
+
+    sp_mat testingData;
+    data::Load(testingDataFilename, testingData, true);
+
+    // A libsvm file only has as many rows as its largest index.
+    const size_t dimensionality = max(trainingData.n_rows,
+        testingData.n_rows);
+    AddRows(trainingData, dimensionality);
+    AddRows(testingData, dimensionality);
+
+    RunNBC(trainingData, labels, mappings, testingData);
+    return 0;
+  }
 
-    // Do the labels need to be transposed?
-    if (rawLabels.n_rows == 1)
-      rawLabels = rawLabels.t();
+  mat trainingData;
+  data::Load(trainingDataFilename, trainingData, true);
 
-    data::NormalizeLabels(rawLabels.unsafe_col(0), labels, mappings);
+  // Did the user pass in labels?
+  if (labelsFilename != "")
+  {
+    LoadLabels(labelsFilename, labels, mappings);
   }
   else
   {
@@ -77,34 +186,8 @@ int main(int argc, char* argv[])
     trainingData.shed_row(trainingData.n_rows - 1);
   }
 
-  const string testingDataFilename = CLI::GetParam<std::string>("test_file");
   mat testingData;
   data::Load(testingDataFilename, testingData, true);
 
-  if (testingData.n_rows != trainingData.n_rows)
-    Log::Fatal << "Test data dimensionality (" << testingData.n_rows << ") "
-        << "must be the same as training data (" << trainingData.n_rows
-        << ")!" << std::endl;
-
-  const bool incrementalVariance = CLI::HasParam("incremental_variance");
-
-  // Create and train the classifier.
-  Timer::Start("training");
-  NaiveBayesClassifier<> nbc(trainingData, labels, mappings.n_elem,
-      incrementalVariance);
-  Timer::Stop("training");
-
-  // Time the running of the Naive Bayes Classifier.
-  Col<size_t> results;
-  Timer::Start("testing");
-  nbc.Classify(testingData, results);
-  Timer::Stop("testing");
-
-  // Un-normalize labels to prepare output.
-  vec rawResults;
-  data::RevertLabels(results, mappings, rawResults);
-
-  // Output results.  Don't transpose: one result per line.
-  const string outputFilename = CLI::GetParam<string>("output");
-  data::Save(outputFilename, rawResults, true, false);
+  RunNBC(trainingData, labels, mappings, testingData);
 }
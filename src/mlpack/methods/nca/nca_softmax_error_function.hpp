@@ -9,6 +9,7 @@
 #define __MLPACK_METHODS_NCA_NCA_SOFTMAX_ERROR_FUNCTION_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/methods/range_search/range_search.hpp>
 
 namespace mlpack {
 namespace nca {
@@ -32,6 +33,15 @@ namespace nca {
  * optimizers use, overloads of Evaluate() and Gradient() are given which only
  * operate on one point in the dataset.  This is useful for optimizers like
  * stochastic gradient descent (see mlpack::optimization::SGD).
+ *
+ * The non-separable Evaluate() and Gradient() consider all O(n^2) pairs of
+ * points.  If Cutoff() is set, pairs of points farther apart than the cutoff
+ * in the projected space are ignored, since their exp(-d(A x_i, A x_k)) terms
+ * are negligible, and the remaining pairs are found with a range search on a
+ * kd-tree built on the projected dataset.  This makes each evaluation close to
+ * linear in the number of points, at the cost of a small error in the
+ * objective and gradient.  Truncation is only available for the Euclidean and
+ * squared Euclidean distances.
  */
 template<typename MetricType = metric::SquaredEuclideanDistance>
 class SoftmaxErrorFunction
@@ -97,6 +107,22 @@ class SoftmaxErrorFunction
                 const size_t i,
                 arma::mat& gradient);
 
+  /**
+   * Evaluate the gradient of the softmax function for the given covariance
+   * matrix on the batchSize points starting at begin.  This is the sum of the
+   * separable gradients of those points, but the dataset is only stretched
+   * once for the whole batch; SGD uses it for mini-batches.
+   *
+   * @param covariance Covariance matrix of Mahalanobis distance.
+   * @param begin Index of the first point of the batch.
+   * @param batchSize Number of points in the batch.
+   * @param gradient Matrix to store the calculated gradient in.
+   */
+  void Gradient(const arma::mat& covariance,
+                const size_t begin,
+                const size_t batchSize,
+                arma::mat& gradient);
+
   /**
    * Get the initial point.
    */
@@ -108,6 +134,15 @@ class SoftmaxErrorFunction
    */
   size_t NumFunctions() const { return dataset.n_cols; }
 
+  //! Get the largest d(A x_i, A x_k) of a pair of points that is not ignored
+  //! by the non-separable Evaluate() and Gradient() (0 means no pair is).
+  double Cutoff() const { return cutoff; }
+  //! Modify the largest d(A x_i, A x_k) of a pair of points that is not
+  //! ignored by the non-separable Evaluate() and Gradient() (0 means no pair
+  //! is).  A cutoff of c drops terms smaller than exp(-c) times the largest
+  //! possible term.
+  double& Cutoff() { return cutoff; }
+
   // convert the obkect into a string
   std::string ToString() const;
 
@@ -133,6 +168,14 @@ class SoftmaxErrorFunction
   //! False if nothing has ever been precalculated (only at construction time).
   bool precalculated;
 
+  //! The largest distance of a pair of points that is not ignored (0 for no
+  //! truncation).
+  double cutoff;
+  //! The cutoff used by the last precalculation.
+  double lastCutoff;
+  //! The pairs of points within the cutoff of each other, when truncating.
+  range::RangeSearchResults neighborhoods;
+
   /**
    * Precalculate the denominators and numerators that will make up the p_ij,
    * but only if the coordinates matrix is different than the last coordinates
@@ -147,6 +190,31 @@ class SoftmaxErrorFunction
    * @param coordinates Coordinates matrix to use for precalculation.
    */
   void Precalculate(const arma::mat& coordinates);
+
+  /**
+   * Find the pairs of points within the cutoff of each other in the stretched
+   * dataset, and store them in neighborhoods.
+   */
+  void FindNeighborhoods();
+
+  //! Get the Euclidean distance that corresponds to the given value of an
+  //! L2 metric (the distance itself or its square).
+  template<bool TakeRoot>
+  static double SearchRadius(const metric::LMetric<2, TakeRoot>& metric,
+                             const double cutoff);
+  //! Other metrics cannot be truncated; this is a fatal error.
+  template<typename OtherMetricType>
+  static double SearchRadius(const OtherMetricType& metric,
+                             const double cutoff);
+
+  /**
+   * Add the term of point i to the sum that the separable gradient is 2 * A
+   * times (negated), using the stretched dataset computed by the caller.
+   *
+   * @param i Index of point.
+   * @param sum Sum to add the term of point i to.
+   */
+  void AddPointGradientTerm(const size_t i, arma::mat& sum);
 };
 
 }; // namespace nca
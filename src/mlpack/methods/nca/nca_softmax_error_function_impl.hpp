@@ -22,7 +22,9 @@ SoftmaxErrorFunction<MetricType>::SoftmaxErrorFunction(
     dataset(dataset),
     labels(labels),
     metric(metric),
-    precalculated(false)
+    precalculated(false),
+    cutoff(0.0),
+    lastCutoff(0.0)
 { /* nothing to do */ }
 
 //! The non-separable implementation, which uses Precalculate() to save time.
@@ -98,12 +100,25 @@ void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
   //     (((p_i - (1 / p_i)) p_ik) + ((p_k - (1 / p_k)) p_ki)) x_ik x_ik^T
   //   otherwise, add
   //     (p_i p_ik + p_k p_ki) x_ik x_ik^T
+  //
+  // With a cutoff, only the pairs in the neighborhoods found by Precalculate()
+  // are visited; the others are taken to have p_ik = p_ki = 0.
   arma::mat sum;
   sum.zeros(stretchedDataset.n_rows, stretchedDataset.n_rows);
   for (size_t i = 0; i < stretchedDataset.n_cols; i++)
   {
-    for (size_t k = (i + 1); k < stretchedDataset.n_cols; k++)
+    const size_t numPairs = (cutoff > 0.0) ? neighborhoods.NumResults(i) :
+        stretchedDataset.n_cols - (i + 1);
+    for (size_t n = 0; n < numPairs; n++)
     {
+      const size_t k = (cutoff > 0.0) ? neighborhoods.Neighbor(i, n) :
+          (i + 1 + n);
+
+      // Each pair is in the neighborhoods of both of its points; only take it
+      // once.
+      if (k <= i)
+        continue;
+
       // Calculate p_ik and p_ki first.
       double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
                                          stretchedDataset.unsafe_col(k)));
@@ -131,6 +146,40 @@ template<typename MetricType>
 void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
                                                 const size_t i,
                                                 arma::mat& gradient)
+{
+  // Compute the stretched dataset.
+  stretchedDataset = coordinates * dataset;
+
+  arma::mat sum;
+  sum.zeros(coordinates.n_cols, coordinates.n_cols);
+  AddPointGradientTerm(i, sum);
+
+  // Multiply by 2 * A.  We negate it though, because our optimizer is a
+  // minimizer.
+  gradient = -2 * coordinates * sum;
+}
+
+//! The separable implementation for a batch of points.
+template<typename MetricType>
+void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
+                                                const size_t begin,
+                                                const size_t batchSize,
+                                                arma::mat& gradient)
+{
+  // The stretched dataset is only computed once for the whole batch.
+  stretchedDataset = coordinates * dataset;
+
+  arma::mat sum;
+  sum.zeros(coordinates.n_cols, coordinates.n_cols);
+  for (size_t i = begin; i < begin + batchSize; ++i)
+    AddPointGradientTerm(i, sum);
+
+  gradient = -2 * coordinates * sum;
+}
+
+template<typename MetricType>
+void SoftmaxErrorFunction<MetricType>::AddPointGradientTerm(const size_t i,
+                                                            arma::mat& sum)
 {
   // We will need to calculate p_i before this evaluation is done, so these two
   // variables will hold the information necessary for that.
@@ -142,11 +191,8 @@ void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
   arma::mat firstTerm;
   arma::mat secondTerm;
 
-  firstTerm.zeros(coordinates.n_rows, coordinates.n_cols);
-  secondTerm.zeros(coordinates.n_rows, coordinates.n_cols);
-
-  // Compute the stretched dataset.
-  stretchedDataset = coordinates * dataset;
+  firstTerm.zeros(sum.n_rows, sum.n_cols);
+  secondTerm.zeros(sum.n_rows, sum.n_cols);
 
   for (size_t k = 0; k < dataset.n_cols; ++k)
   {
@@ -175,25 +221,18 @@ void SoftmaxErrorFunction<MetricType>::Gradient(const arma::mat& coordinates,
   }
 
   // Calculate p_i.
-  double p = 0;
   if (denominator == 0)
   {
     Log::Warn << "Denominator of p_" << i << " is 0!" << std::endl;
     // If the denominator is zero, then all p_ik should be zero and there is
     // no gradient contribution from this point.
-    gradient.zeros(coordinates.n_rows, coordinates.n_rows);
     return;
   }
-  else
-  {
-    p = numerator / denominator;
-    firstTerm /= denominator;
-    secondTerm /= denominator;
-  }
 
-  // Now multiply the first term by p_i, and add the two together and multiply
-  // all by 2 * A.  We negate it though, because our optimizer is a minimizer.
-  gradient = -2 * coordinates * (p * firstTerm - secondTerm);
+  const double p = numerator / denominator;
+
+  // Now multiply the first term by p_i, and add the two together.
+  sum += (p * firstTerm - secondTerm) / denominator;
 }
 
 template<typename MetricType>
@@ -211,11 +250,12 @@ void SoftmaxErrorFunction<MetricType>::Precalculate(
 
   // Make sure the calculation is necessary.
   if ((accu(coordinates == lastCoordinates) == coordinates.n_elem) &&
-      precalculated)
+      precalculated && (cutoff == lastCutoff))
     return; // No need to calculate; we already have this stuff saved.
 
   // Coordinates are different; save the new ones, and stretch the dataset.
   lastCoordinates = coordinates;
+  lastCutoff = cutoff;
   stretchedDataset = coordinates * dataset;
 
   // For each point i, we must evaluate the softmax function:
@@ -224,12 +264,28 @@ void SoftmaxErrorFunction<MetricType>::Precalculate(
   // We will do this by keeping track of the denominators for each i as well as
   // the numerators (the sum for all j in class of i).  This will be on the
   // order of O((n * (n + 1)) / 2), which really isn't all that great.
+  //
+  // With a cutoff, only the pairs of points within the cutoff of each other
+  // are considered, and they are found with a range search.
+  if (cutoff > 0.0)
+    FindNeighborhoods();
+
   p.zeros(stretchedDataset.n_cols);
   denominators.zeros(stretchedDataset.n_cols);
   for (size_t i = 0; i < stretchedDataset.n_cols; i++)
   {
-    for (size_t j = (i + 1); j < stretchedDataset.n_cols; j++)
+    const size_t numPairs = (cutoff > 0.0) ? neighborhoods.NumResults(i) :
+        stretchedDataset.n_cols - (i + 1);
+    for (size_t n = 0; n < numPairs; n++)
     {
+      const size_t j = (cutoff > 0.0) ? neighborhoods.Neighbor(i, n) :
+          (i + 1 + n);
+
+      // Each pair is in the neighborhoods of both of its points; only take it
+      // once.
+      if (j <= i)
+        continue;
+
       // Evaluate exp(-d(x_i, x_j)).
       double eval = exp(-metric.Evaluate(stretchedDataset.unsafe_col(i),
                                          stretchedDataset.unsafe_col(j)));
@@ -267,6 +323,40 @@ void SoftmaxErrorFunction<MetricType>::Precalculate(
   precalculated = true;
 }
 
+template<typename MetricType>
+void SoftmaxErrorFunction<MetricType>::FindNeighborhoods()
+{
+  // The range search builds a kd-tree on (a copy of) the stretched dataset,
+  // and gives the neighbors of each point with their original indices.
+  const double radius = SearchRadius(metric, cutoff);
+  range::RangeSearch<> rangeSearch(stretchedDataset);
+  rangeSearch.Search(math::Range(0.0, radius), neighborhoods);
+
+  Log::Debug << "SoftmaxErrorFunction: " << neighborhoods.TotalResults() / 2
+      << " pairs of points are within the cutoff of " << cutoff << "."
+      << std::endl;
+}
+
+template<typename MetricType>
+template<bool TakeRoot>
+double SoftmaxErrorFunction<MetricType>::SearchRadius(
+    const metric::LMetric<2, TakeRoot>& /* metric */,
+    const double cutoff)
+{
+  return TakeRoot ? cutoff : std::sqrt(cutoff);
+}
+
+template<typename MetricType>
+template<typename OtherMetricType>
+double SoftmaxErrorFunction<MetricType>::SearchRadius(
+    const OtherMetricType& /* metric */,
+    const double /* cutoff */)
+{
+  Log::Fatal << "SoftmaxErrorFunction: a cutoff can only be used with the "
+      << "Euclidean or squared Euclidean distance." << std::endl;
+  return 0.0;
+}
+
 template<typename MetricType>
 std::string SoftmaxErrorFunction<MetricType>::ToString() const{
   std::ostringstream convert;
@@ -276,6 +366,7 @@ std::string SoftmaxErrorFunction<MetricType>::ToString() const{
   convert << "  Labels: " << labels.n_elem << std::endl;
   //convert << "Metric: " << metric << std::endl;
   convert << "  Precalculated: " << precalculated << std::endl;
+  convert << "  Cutoff: " << cutoff << std::endl;
   return convert.str();
 }
 
@@ -54,6 +54,9 @@ PARAM_FLAG("single_mode", "If true, single-tree search is used (as opposed to "
     "dual-tree search).", "s");
 PARAM_FLAG("r_tree", "If true, use an R-Tree to perform the search "
     "(experimental, may be slow.).", "T");
+PARAM_INT("threads", "Number of threads to use for tree-based search (0 uses "
+    "all available cores; ignored if mlpack was built without OpenMP).", "t",
+    0);
 
 int main(int argc, char *argv[])
 {
@@ -97,6 +100,14 @@ int main(int argc, char *argv[])
   }
   size_t leafSize = lsInt;
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t threads = (size_t) CLI::GetParam<int>("threads");
+
   // Naive mode overrides single mode.
   if (singleMode && naive)
   {
@@ -168,6 +179,7 @@ int main(int argc, char *argv[])
     }
 
     Log::Info << "Computing " << k << " furthest neighbors..." << endl;
+    allkfn->Threads() = threads;
     allkfn->Search(k, neighbors, distances);
 
     Log::Info << "Neighbors computed." << endl;
@@ -182,12 +194,13 @@ int main(int argc, char *argv[])
     // Map the points back to their original locations.
     if ((CLI::GetParam<string>("query_file") != "") && !singleMode)
       Unmap(neighbors, distances, oldFromNewRefs, oldFromNewQueries, neighborsOut,
-          distancesOut);
+          distancesOut, false, threads);
     else if ((CLI::GetParam<string>("query_file") != "") && singleMode)
-      Unmap(neighbors, distances, oldFromNewRefs, neighborsOut, distancesOut);
+      Unmap(neighbors, distances, oldFromNewRefs, neighborsOut, distancesOut,
+          false, threads);
     else
       Unmap(neighbors, distances, oldFromNewRefs, oldFromNewRefs, neighborsOut,
-          distancesOut);
+          distancesOut, false, threads);
 
     // Clean up.
     if (queryTree)
@@ -219,7 +232,7 @@ int main(int argc, char *argv[])
        tree::RStarTreeDescentHeuristic,
        NeighborSearchStat<FurthestNeighborSort>,
        arma::mat>
-    refTree(referenceData, leafSize, leafSize * 0.4, 5, 2, 0);
+    refTree(referenceData, leafSize, leafSize * 0.4, 5, 2, 0, true);
 
     RectangleTree<tree::RStarTreeSplit<tree::RStarTreeDescentHeuristic, NeighborSearchStat<FurthestNeighborSort>, arma::mat>,
        tree::RStarTreeDescentHeuristic,
@@ -246,7 +259,7 @@ int main(int argc, char *argv[])
         queryTree = new RectangleTree<tree::RStarTreeSplit<tree::RStarTreeDescentHeuristic, NeighborSearchStat<FurthestNeighborSort>, arma::mat>,
         tree::RStarTreeDescentHeuristic,
         NeighborSearchStat<FurthestNeighborSort>,
-        arma::mat>(queryData, leafSize, leafSize * 0.4, 5, 2, 0);
+        arma::mat>(queryData, leafSize, leafSize * 0.4, 5, 2, 0, true);
         
         Timer::Stop("tree_building");
       }
@@ -273,6 +286,7 @@ int main(int argc, char *argv[])
     //arma::Mat<size_t> neighborsOut;
     
     Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+    allkfn->Threads() = threads;
     allkfn->Search(k, neighbors, distances);
     
     Log::Info << "Neighbors computed." << endl;
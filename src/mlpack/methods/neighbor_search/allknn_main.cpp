@@ -11,9 +11,17 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+
+#ifndef _WIN32
+  #include <sys/stat.h>
+#endif
 
 #include "neighbor_search.hpp"
+#include "autotune.hpp"
 #include "unmap.hpp"
+#include "distributed_knn.hpp"
 
 using namespace std;
 using namespace mlpack;
@@ -53,6 +61,9 @@ PARAM_STRING("query_file", "File containing query points (optional).", "q", "");
 
 PARAM_INT("leaf_size", "Leaf size for tree building.", "l", 20);
 PARAM_FLAG("naive", "If true, O(n^2) naive mode is used for computation.", "N");
+PARAM_FLAG("offload", "If true (with --naive), the distances are computed in "
+    "large tiles with matrix multiplications, which are run on a GPU if mlpack "
+    "was built with USE_NVBLAS.", "G");
 PARAM_FLAG("single_mode", "If true, single-tree search is used (as opposed to "
     "dual-tree search).", "S");
 PARAM_FLAG("cover_tree", "If true, use cover trees to perform the search "
@@ -62,6 +73,972 @@ PARAM_FLAG("r_tree", "If true, use an R-Tree to perform the search "
 PARAM_FLAG("random_basis", "Before tree-building, project the data onto a "
     "random orthogonal basis.", "R");
 PARAM_INT("seed", "Random seed (if 0, std::time(NULL) is used).", "s", 0);
+PARAM_INT("threads", "Number of threads to use for tree-based search (0 uses "
+    "all available cores; ignored if mlpack was built without OpenMP).", "t",
+    0);
+PARAM_FLAG("replicate_reference", "If true, on machines with more than one "
+    "NUMA node, each node searches its own copy of the reference tree, so that "
+    "parallel searches read it from local memory.  This is meant for reference "
+    "sets which are small compared to the query set; it is ignored with cover "
+    "trees.", "");
+PARAM_FLAG("single_precision", "If true, the kd-tree search is done with single "
+    "precision (float) data, which halves the memory used by the data and the "
+    "tree.", "");
+PARAM_STRING("reference_tree_file", "If specified, load the reference tree "
+    "from this file (saved earlier with --save_reference_tree) instead of "
+    "building it.  Only kd-trees and cover trees can be loaded.", "", "");
+PARAM_STRING("save_reference_tree", "If specified, save the built reference "
+    "tree to this file, so later runs can load it with --reference_tree_file.",
+    "", "");
+PARAM_INT("query_chunk_size", "If greater than 0, the query file is read and "
+    "searched in chunks of this many points, and the results are appended to "
+    "the output files after each chunk, so the query set never has to fit in "
+    "memory.  The query file and the output files must be CSV or text files.  "
+    "Only supported with kd-trees.", "", 0);
+PARAM_DOUBLE("epsilon", "If greater than 0, find approximate nearest "
+    "neighbors: each returned neighbor distance is within a factor of "
+    "(1 + epsilon) of the true distance.  This can be much faster, especially "
+    "in high dimensions.  Ignored with --naive.", "e", 0.0);
+PARAM_FLAG("symmetric", "If true and no query file is given, dual-tree search "
+    "visits each pair of points once and updates the neighbors of both, which "
+    "roughly halves the number of distance calculations.  This search is "
+    "serial, and is ignored with cover trees.", "");
+PARAM_FLAG("autotune", "If true, choose the tree type (kd-tree, cover tree or "
+    "R-tree) and leaf size by timing the search on a sample of the data with "
+    "each of a small grid of configurations, and use the fastest.  Overrides "
+    "--leaf_size, --cover_tree and --r_tree.", "");
+PARAM_INT("autotune_sample_size", "Number of reference points (and query "
+    "points) to sample for --autotune.", "", 5000);
+PARAM_FLAG("distributed", "If true, the program must be run with mpirun, and "
+    "the reference set is split spatially over the MPI processes, each of "
+    "which holds one partition in a kd-tree; queries are only sent to the "
+    "partitions which can hold their neighbors.  If a file name contains '%r', "
+    "each process reads (or writes) its own file, with '%r' replaced by its "
+    "rank; otherwise each process reads the whole file and keeps its share of "
+    "the points, and process 0 writes the results.  Only kd-trees are "
+    "supported, and mlpack must be built with MPI (the CMake option USE_MPI).",
+    "");
+PARAM_INT("partition_sample_size", "Number of reference points to sample to "
+    "build the partitioning for --distributed.", "", 10000);
+PARAM_STRING("server", "If specified, run as a server which keeps the "
+    "reference set and its kd-tree in memory: after the reference tree is "
+    "built, requests are read from this file (a named pipe, or '-' for "
+    "standard input), one per line, until it ends or a request is 'quit'.  A "
+    "named pipe is opened again each time its writer closes it.  Each request "
+    "holds options like those of the command line (--query_file, --k, "
+    "--neighbors_file, --distances_file, --epsilon and --single_mode are "
+    "used); options which are not given keep their values from the command "
+    "line.  After each request, a line with 'ok' or 'error: ' and the reason "
+    "is written to standard output.  Only kd-trees are supported.", "", "");
+PARAM_INT("cache_size", "With --server, keep the results of up to this many "
+    "recently queried points; a query point which is in the cache again is "
+    "answered from it instead of being searched.  The cache is cleared when "
+    "--k or --epsilon changes.", "", 0);
+
+//! Build (or load) the kd reference tree, and save it if requested.
+template<typename TreeType>
+TreeType* BuildKDReferenceTree(typename TreeType::Mat& referenceData,
+                               std::vector<size_t>& oldFromNewRefs,
+                               const size_t leafSize)
+{
+  const string referenceTreeFile =
+      CLI::GetParam<string>("reference_tree_file");
+  const string saveReferenceTree = CLI::GetParam<string>("save_reference_tree");
+
+  TreeType* refTree = NULL;
+  if (referenceTreeFile != "")
+  {
+    Log::Info << "Loading reference tree from '" << referenceTreeFile
+        << "'..." << endl;
+    ifstream treeStream(referenceTreeFile.c_str(), ios::binary);
+    if (!treeStream.is_open())
+      Log::Fatal << "Cannot open reference tree file '" << referenceTreeFile
+          << "'." << endl;
+
+    Timer::Start("tree_loading");
+    refTree = new TreeType(referenceData, oldFromNewRefs, treeStream);
+    Timer::Stop("tree_loading");
+  }
+  else
+  {
+    Log::Info << "Building reference tree..." << endl;
+    Timer::Start("tree_building");
+    refTree = new TreeType(referenceData, oldFromNewRefs, leafSize);
+    Timer::Stop("tree_building");
+  }
+
+  if (saveReferenceTree != "")
+  {
+    Log::Info << "Saving reference tree to '" << saveReferenceTree << "'."
+        << endl;
+    ofstream treeStream(saveReferenceTree.c_str(), ios::binary);
+    if (!treeStream.is_open())
+      Log::Fatal << "Cannot open '" << saveReferenceTree << "' for "
+          << "writing." << endl;
+    refTree->Save(treeStream, oldFromNewRefs);
+  }
+
+  // Store the reference tree contiguously, since it is traversed many
+  // times during the search.
+  refTree->Compact();
+
+  return refTree;
+}
+
+//! Run kd-tree search, for either double or single precision data.
+template<typename MatType>
+void KDTreeSearch(MatType& referenceData,
+                  MatType& queryData,
+                  size_t leafSize,
+                  const size_t k,
+                  const bool naive,
+                  const bool singleMode,
+                  const size_t threads,
+                  const double epsilon,
+                  const bool symmetric,
+                  arma::Mat<size_t>& neighbors,
+                  arma::mat& distances)
+{
+  typedef BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort>, MatType> TreeType;
+
+  const string queryFile = CLI::GetParam<string>("query_file");
+
+  // Because we may construct it differently, we need a pointer.
+  NeighborSearch<NearestNeighborSort, metric::EuclideanDistance, TreeType>*
+      allknn = NULL;
+
+  // Mappings for when we build the tree.
+  std::vector<size_t> oldFromNewRefs;
+
+  // Build trees by hand, so we can save memory: if we pass a tree to
+  // NeighborSearch, it does not copy the matrix.
+  TreeType* refTree = BuildKDReferenceTree<TreeType>(referenceData,
+      oldFromNewRefs, leafSize);
+
+  TreeType* queryTree = NULL; // Empty for now.
+
+  std::vector<size_t> oldFromNewQueries;
+
+  if (CLI::GetParam<string>("query_file") != "")
+  {
+    if (naive && leafSize < queryData.n_cols)
+      leafSize = queryData.n_cols;
+
+    Log::Info << "Loaded query data from '" << queryFile << "' ("
+        << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+
+    Log::Info << "Building query tree..." << endl;
+
+    // Build trees by hand, so we can save memory: if we pass a tree to
+    // NeighborSearch, it does not copy the matrix.
+    if (!singleMode)
+    {
+      Timer::Start("tree_building");
+
+      queryTree = new TreeType(queryData, oldFromNewQueries, leafSize);
+
+      Timer::Stop("tree_building");
+    }
+
+    allknn = new NeighborSearch<NearestNeighborSort,
+        metric::EuclideanDistance, TreeType>(refTree, queryTree,
+        referenceData, queryData, singleMode);
+
+    Log::Info << "Tree built." << endl;
+  }
+  else
+  {
+    allknn = new NeighborSearch<NearestNeighborSort,
+        metric::EuclideanDistance, TreeType>(refTree, referenceData,
+        singleMode);
+
+    Log::Info << "Trees built." << endl;
+  }
+
+  arma::mat distancesOut;
+  arma::Mat<size_t> neighborsOut;
+
+  Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+  allknn->Threads() = threads;
+  allknn->ReplicateReference() = CLI::HasParam("replicate_reference");
+  allknn->Epsilon() = epsilon;
+  allknn->Symmetric() = symmetric;
+  allknn->Search(k, neighborsOut, distancesOut);
+
+  Log::Info << "Neighbors computed." << endl;
+
+  // We have to map back to the original indices from before the tree
+  // construction.
+  Log::Info << "Re-mapping indices..." << endl;
+
+  // Map the results back to the correct places.
+  if ((CLI::GetParam<string>("query_file") != "") && !singleMode)
+    Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewQueries,
+        neighbors, distances, false, threads);
+  else if ((CLI::GetParam<string>("query_file") != "") && singleMode)
+    Unmap(neighborsOut, distancesOut, oldFromNewRefs, neighbors, distances,
+        false, threads);
+  else
+    Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewRefs,
+        neighbors, distances, false, threads);
+
+  // Clean up.
+  if (queryTree)
+    delete queryTree;
+
+  delete allknn;
+  delete refTree;
+}
+
+//! Get the Armadillo file type to append streamed results to the given file.
+arma::file_type StreamingFileType(const string& filename)
+{
+  const size_t ext = filename.rfind('.');
+  const string extension = (ext == string::npos) ? "" :
+      filename.substr(ext + 1);
+
+  if (extension != "csv" && extension != "txt")
+    Log::Fatal << "--query_chunk_size requires CSV or text (.csv or .txt) "
+        << "files, but '" << filename << "' is neither." << endl;
+
+  return (extension == "csv") ? arma::csv_ascii : arma::raw_ascii;
+}
+
+/**
+ * Read up to chunkSize points from a CSV or whitespace-separated text stream,
+ * one point per line, into the columns of chunk.  Blank lines are skipped.
+ *
+ * @param stream Stream to read from.
+ * @param dimensionality Number of dimensions each point must have.
+ * @param chunkSize Maximum number of points to read.
+ * @param pointsRead Number of points read so far (used in error messages, and
+ *      updated).
+ * @param chunk Matrix to store the points in.
+ * @return false if there were no points left to read.
+ */
+bool ReadQueryChunk(istream& stream,
+                    const size_t dimensionality,
+                    const size_t chunkSize,
+                    size_t& pointsRead,
+                    arma::mat& chunk)
+{
+  chunk.set_size(dimensionality, chunkSize);
+  size_t points = 0;
+  string line;
+  while (points < chunkSize && getline(stream, line))
+  {
+    replace(line.begin(), line.end(), ',', ' ');
+    istringstream lineStream(line);
+
+    size_t dimension = 0;
+    double value;
+    while (lineStream >> value)
+    {
+      if (dimension < dimensionality)
+        chunk(dimension, points) = value;
+      ++dimension;
+    }
+
+    if (dimension == 0)
+      continue;
+
+    if (dimension != dimensionality)
+      Log::Fatal << "Query point " << pointsRead + points << " has "
+          << dimension << " dimensions, but the reference set has "
+          << dimensionality << "." << endl;
+
+    ++points;
+  }
+
+  chunk.resize(dimensionality, points);
+  pointsRead += points;
+
+  return (points > 0);
+}
+
+/**
+ * Pipeline stage which reads the query file a chunk at a time.
+ */
+class QueryChunkLoader
+{
+ public:
+  QueryChunkLoader(istream& stream,
+                   const size_t dimensionality,
+                   const size_t chunkSize) :
+      stream(stream),
+      dimensionality(dimensionality),
+      chunkSize(chunkSize),
+      pointsRead(0)
+  { }
+
+  bool operator()(arma::mat& chunk)
+  {
+    return ReadQueryChunk(stream, dimensionality, chunkSize, pointsRead, chunk);
+  }
+
+ private:
+  istream& stream;
+  size_t dimensionality;
+  size_t chunkSize;
+  size_t pointsRead;
+};
+
+/**
+ * The results for one chunk of query points.  Points are stored as rows, as
+ * they are in the output files.
+ */
+struct QueryChunkResults
+{
+  arma::mat distances;
+  arma::Mat<size_t> neighbors;
+};
+
+/**
+ * Pipeline stage which searches a chunk of query points with the reference
+ * tree.  It is the only stage which uses Timer and Log.
+ */
+template<typename TreeType, typename MatType>
+class QueryChunkSearcher
+{
+ public:
+  QueryChunkSearcher(TreeType* refTree,
+                     MatType& referenceData,
+                     const std::vector<size_t>& oldFromNewRefs,
+                     const arma::mat& basis,
+                     const size_t leafSize,
+                     const size_t k,
+                     const bool naive,
+                     const bool singleMode,
+                     const size_t threads,
+                     const double epsilon) :
+      refTree(refTree),
+      referenceData(referenceData),
+      oldFromNewRefs(oldFromNewRefs),
+      basis(basis),
+      leafSize(leafSize),
+      k(k),
+      naive(naive),
+      singleMode(singleMode),
+      threads(threads),
+      epsilon(epsilon),
+      pointsDone(0)
+  { }
+
+  void operator()(arma::mat& chunk, QueryChunkResults& results)
+  {
+    if (basis.n_elem > 0)
+      chunk = basis * chunk;
+
+    MatType queryData = arma::conv_to<MatType>::from(chunk);
+
+    // Build the query tree for this chunk.
+    TreeType* queryTree = NULL;
+    std::vector<size_t> oldFromNewQueries;
+    if (!singleMode)
+    {
+      const size_t queryLeafSize = (naive && leafSize < queryData.n_cols) ?
+          queryData.n_cols : leafSize;
+
+      Timer::Start("tree_building");
+      queryTree = new TreeType(queryData, oldFromNewQueries, queryLeafSize);
+      Timer::Stop("tree_building");
+    }
+
+    NeighborSearch<NearestNeighborSort, metric::EuclideanDistance, TreeType>
+        allknn(refTree, queryTree, referenceData, queryData, singleMode);
+    allknn.Threads() = threads;
+    allknn.ReplicateReference() = CLI::HasParam("replicate_reference");
+    allknn.Epsilon() = epsilon;
+
+    arma::Mat<size_t> neighborsOut;
+    arma::mat distancesOut;
+    allknn.Search(k, neighborsOut, distancesOut);
+
+    // The results are transposed by the writer as they are saved.
+    if (singleMode)
+      Unmap(neighborsOut, distancesOut, oldFromNewRefs, results.neighbors,
+          results.distances, false, threads);
+    else
+      Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewQueries,
+          results.neighbors, results.distances, false, threads);
+
+    pointsDone += queryData.n_cols;
+    Log::Info << pointsDone << " query points done." << endl;
+
+    delete queryTree;
+  }
+
+ private:
+  TreeType* refTree;
+  MatType& referenceData;
+  const std::vector<size_t>& oldFromNewRefs;
+  const arma::mat& basis;
+  size_t leafSize;
+  size_t k;
+  bool naive;
+  bool singleMode;
+  size_t threads;
+  double epsilon;
+  size_t pointsDone;
+};
+
+/**
+ * Pipeline stage which appends the results of each chunk to the output files.
+ * Because it runs at the same time as the search, it may not use Log, so an
+ * error is remembered and reported once the pipeline has finished.
+ */
+class QueryChunkWriter
+{
+ public:
+  QueryChunkWriter(ostream& distancesStream,
+                   const arma::file_type distancesType,
+                   ostream& neighborsStream,
+                   const arma::file_type neighborsType) :
+      distancesStream(distancesStream),
+      distancesType(distancesType),
+      neighborsStream(neighborsStream),
+      neighborsType(neighborsType),
+      distancesFailed(false),
+      neighborsFailed(false)
+  { }
+
+  void operator()(QueryChunkResults& results)
+  {
+    if (!distancesFailed)
+      distancesFailed = !data::SaveChunk(distancesStream, results.distances,
+          distancesType);
+    if (!neighborsFailed)
+      neighborsFailed = !data::SaveChunk(neighborsStream, results.neighbors,
+          neighborsType);
+  }
+
+  //! Get whether writing the distances failed.
+  bool DistancesFailed() const { return distancesFailed; }
+  //! Get whether writing the neighbors failed.
+  bool NeighborsFailed() const { return neighborsFailed; }
+
+ private:
+  ostream& distancesStream;
+  arma::file_type distancesType;
+  ostream& neighborsStream;
+  arma::file_type neighborsType;
+  bool distancesFailed;
+  bool neighborsFailed;
+};
+
+/**
+ * Run kd-tree search with queries read from the query file in chunks of
+ * chunkSize points.  The reference tree is built once; each chunk gets its own
+ * query tree (unless single-tree search is used), and the results for each
+ * chunk are appended to the output files as soon as they are computed.  The
+ * next chunk is read and the previous results are written while a chunk is
+ * searched (see data::Pipeline).
+ */
+template<typename MatType>
+void StreamingKDTreeSearch(MatType& referenceData,
+                           const arma::mat& basis,
+                           const size_t chunkSize,
+                           size_t leafSize,
+                           const size_t k,
+                           const bool naive,
+                           const bool singleMode,
+                           const size_t threads,
+                           const double epsilon)
+{
+  typedef BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort>, MatType> TreeType;
+
+  const string queryFile = CLI::GetParam<string>("query_file");
+  const string distancesFile = CLI::GetParam<string>("distances_file");
+  const string neighborsFile = CLI::GetParam<string>("neighbors_file");
+
+  // Check the file types before doing any work.
+  StreamingFileType(queryFile);
+  const arma::file_type distancesType = StreamingFileType(distancesFile);
+  const arma::file_type neighborsType = StreamingFileType(neighborsFile);
+
+  ifstream queryStream(queryFile.c_str());
+  if (!queryStream.is_open())
+    Log::Fatal << "Cannot open query file '" << queryFile << "'." << endl;
+  ofstream distancesStream(distancesFile.c_str());
+  if (!distancesStream.is_open())
+    Log::Fatal << "Cannot open '" << distancesFile << "' for writing." << endl;
+  ofstream neighborsStream(neighborsFile.c_str());
+  if (!neighborsStream.is_open())
+    Log::Fatal << "Cannot open '" << neighborsFile << "' for writing." << endl;
+
+  std::vector<size_t> oldFromNewRefs;
+  TreeType* refTree = BuildKDReferenceTree<TreeType>(referenceData,
+      oldFromNewRefs, leafSize);
+
+  Log::Info << "Computing " << k << " nearest neighbors of the points in '"
+      << queryFile << "', " << chunkSize << " points at a time..." << endl;
+
+  QueryChunkLoader loader(queryStream, referenceData.n_rows, chunkSize);
+  QueryChunkSearcher<TreeType, MatType> searcher(refTree, referenceData,
+      oldFromNewRefs, basis, leafSize, k, naive, singleMode, threads, epsilon);
+  QueryChunkWriter writer(distancesStream, distancesType, neighborsStream,
+      neighborsType);
+
+  data::Pipeline<arma::mat, QueryChunkResults> pipeline;
+  pipeline.Run(loader, searcher, writer);
+
+  if (writer.DistancesFailed())
+    Log::Fatal << "Writing to '" << distancesFile << "' failed." << endl;
+  if (writer.NeighborsFailed())
+    Log::Fatal << "Writing to '" << neighborsFile << "' failed." << endl;
+
+  delete refTree;
+}
+
+//! Return true if the given file is a named pipe.
+bool IsNamedPipe(const string& filename)
+{
+#ifndef _WIN32
+  struct stat fileInfo;
+  return (stat(filename.c_str(), &fileInfo) == 0) && S_ISFIFO(fileInfo.st_mode);
+#else
+  return false;
+#endif
+}
+
+//! The neighbors and distances of one query point, kept by QueryCache.
+struct CachedNeighbors
+{
+  arma::Col<size_t> neighbors;
+  arma::vec distances;
+};
+
+/**
+ * The results of the most recent query points answered by the server (see
+ * --cache_size), and the search settings they were found with.  The reference
+ * tree of the server never changes, so only a change of settings clears it.
+ */
+template<typename ElemType>
+struct QueryCache
+{
+  QueryCache(const size_t capacity) : results(capacity), k(0), epsilon(0.0) { }
+
+  //! The results, keyed by the query point.
+  util::LRUCache<std::vector<ElemType>, CachedNeighbors> results;
+  //! The number of neighbors the results hold.
+  size_t k;
+  //! The epsilon the results were found with.
+  double epsilon;
+};
+
+/**
+ * Answer one request of the server with the resident reference tree.  Returns
+ * an empty string on success, or the reason the request failed; nothing in
+ * here may terminate the program.
+ */
+template<typename TreeType, typename MatType>
+string AnswerRequest(const string& request,
+                     TreeType* refTree,
+                     MatType& referenceData,
+                     const std::vector<size_t>& oldFromNewRefs,
+                     const arma::mat& basis,
+                     const size_t leafSize,
+                     const size_t threads,
+                     QueryCache<typename MatType::elem_type>& cache)
+{
+  const string error = CLI::ParseRequest(request);
+  if (error != "")
+    return error;
+
+  const string queryFile = CLI::GetParam<string>("query_file");
+  const string distancesFile = CLI::GetParam<string>("distances_file");
+  const string neighborsFile = CLI::GetParam<string>("neighbors_file");
+  const int k = CLI::GetParam<int>("k");
+  const double epsilon = CLI::GetParam<double>("epsilon");
+  const bool singleMode = CLI::HasParam("single_mode");
+
+  ostringstream reason;
+  if (k < 1 || (size_t) k > referenceData.n_cols)
+  {
+    reason << "invalid k " << k << "; must be between 1 and the number of "
+        << "reference points (" << referenceData.n_cols << ")";
+    return reason.str();
+  }
+  if (epsilon < 0)
+  {
+    reason << "invalid epsilon " << epsilon;
+    return reason.str();
+  }
+
+  MatType queryData;
+  if (queryFile != "")
+  {
+    arma::mat points;
+    Timer::Start("loading_data");
+    const bool loaded = data::Load(queryFile, points);
+    Timer::Stop("loading_data");
+    if (!loaded)
+      return "cannot load query file '" + queryFile + "'";
+    if (points.n_rows != referenceData.n_rows)
+    {
+      reason << "query points have " << points.n_rows << " dimensions, but "
+          << "reference points have " << referenceData.n_rows;
+      return reason.str();
+    }
+
+    if (basis.n_elem > 0)
+      points = basis * points;
+    queryData = arma::conv_to<MatType>::from(points);
+  }
+
+  // With the cache, the points which were queried recently are answered from
+  // it, and only the other points are searched.  The cached results are only
+  // valid for the k and epsilon they were found with.
+  typedef typename MatType::elem_type ElemType;
+  const bool useCache = (queryFile != "" && cache.results.Capacity() > 0);
+  const size_t numQueries = queryData.n_cols;
+  std::vector<size_t> searched;
+  arma::Mat<size_t> cachedNeighbors;
+  arma::mat cachedDistances;
+  if (useCache)
+  {
+    if (cache.k != (size_t) k || cache.epsilon != epsilon)
+    {
+      cache.results.Clear();
+      cache.k = k;
+      cache.epsilon = epsilon;
+    }
+
+    cachedNeighbors.set_size(k, numQueries);
+    cachedDistances.set_size(k, numQueries);
+    for (size_t i = 0; i < numQueries; ++i)
+    {
+      const std::vector<ElemType> key(queryData.colptr(i),
+          queryData.colptr(i) + queryData.n_rows);
+      const CachedNeighbors* result = cache.results.Find(key);
+      if (result == NULL)
+      {
+        searched.push_back(i);
+        continue;
+      }
+
+      cachedNeighbors.col(i) = result->neighbors;
+      cachedDistances.col(i) = result->distances;
+    }
+
+    if (searched.size() < numQueries)
+    {
+      MatType searchedData(queryData.n_rows, searched.size());
+      for (size_t i = 0; i < searched.size(); ++i)
+        searchedData.col(i) = queryData.col(searched[i]);
+      queryData.swap(searchedData);
+    }
+  }
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  if (!useCache || !searched.empty())
+  {
+    // Only the query tree is built for each request.
+    TreeType* queryTree = NULL;
+    std::vector<size_t> oldFromNewQueries;
+    NeighborSearch<NearestNeighborSort, metric::EuclideanDistance, TreeType>*
+        allknn = NULL;
+    if (queryFile == "")
+    {
+      allknn = new NeighborSearch<NearestNeighborSort,
+          metric::EuclideanDistance, TreeType>(refTree, referenceData,
+          singleMode);
+    }
+    else
+    {
+      if (!singleMode)
+      {
+        Timer::Start("tree_building");
+        queryTree = new TreeType(queryData, oldFromNewQueries, leafSize);
+        Timer::Stop("tree_building");
+      }
+
+      allknn = new NeighborSearch<NearestNeighborSort,
+          metric::EuclideanDistance, TreeType>(refTree, queryTree,
+          referenceData, queryData, singleMode);
+    }
+
+    arma::Mat<size_t> neighborsOut;
+    arma::mat distancesOut;
+    allknn->Threads() = threads;
+    allknn->ReplicateReference() = CLI::HasParam("replicate_reference");
+    allknn->Epsilon() = epsilon;
+    allknn->Search((size_t) k, neighborsOut, distancesOut);
+
+    if (queryFile != "" && !singleMode)
+      Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewQueries,
+          neighbors, distances, false, threads);
+    else if (queryFile != "")
+      Unmap(neighborsOut, distancesOut, oldFromNewRefs, neighbors, distances,
+          false, threads);
+    else
+      Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewRefs,
+          neighbors, distances, false, threads);
+
+    delete allknn;
+    delete queryTree;
+  }
+
+  if (useCache)
+  {
+    // Add the searched points to the cache, and put their results with the
+    // cached ones.
+    for (size_t i = 0; i < searched.size(); ++i)
+    {
+      CachedNeighbors result;
+      result.neighbors = neighbors.col(i);
+      result.distances = distances.col(i);
+      cache.results.Insert(std::vector<ElemType>(queryData.colptr(i),
+          queryData.colptr(i) + queryData.n_rows), result);
+
+      cachedNeighbors.col(searched[i]) = result.neighbors;
+      cachedDistances.col(searched[i]) = result.distances;
+    }
+
+    neighbors.swap(cachedNeighbors);
+    distances.swap(cachedDistances);
+  }
+
+  if (!data::Save(distancesFile, distances))
+    return "cannot save distances to '" + distancesFile + "'";
+  if (!data::Save(neighborsFile, neighbors))
+    return "cannot save neighbors to '" + neighborsFile + "'";
+
+  return "";
+}
+
+/**
+ * Run as a server: build (or load) the kd reference tree once, and then answer
+ * each request read from the --server file with it, so that each request only
+ * pays for loading its queries and searching them.
+ */
+template<typename MatType>
+void ServeKDTreeSearch(MatType& referenceData,
+                       const arma::mat& basis,
+                       const size_t leafSize,
+                       const size_t threads)
+{
+  typedef BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort>, MatType> TreeType;
+
+  const string serverFile = CLI::GetParam<string>("server");
+  const int cacheSize = CLI::GetParam<int>("cache_size");
+  if (cacheSize < 0)
+    Log::Fatal << "Invalid cache size: " << cacheSize << ".  Must be greater "
+        << "than or equal to 0." << endl;
+  QueryCache<typename MatType::elem_type> cache(cacheSize);
+
+  std::vector<size_t> oldFromNewRefs;
+  TreeType* refTree = BuildKDReferenceTree<TreeType>(referenceData,
+      oldFromNewRefs, leafSize);
+
+  Log::Info << "Serving requests from '" << serverFile << "'..." << endl;
+
+  bool quit = false;
+  size_t requests = 0;
+  while (!quit)
+  {
+    ifstream fileStream;
+    if (serverFile != "-")
+    {
+      fileStream.open(serverFile.c_str());
+      if (!fileStream.is_open())
+        Log::Fatal << "Cannot open '" << serverFile << "' for reading." << endl;
+    }
+    istream& requestStream = (serverFile == "-") ? cin : fileStream;
+
+    string request;
+    while (getline(requestStream, request))
+    {
+      // Skip empty lines.
+      const size_t begin = request.find_first_not_of(" \t\r");
+      if (begin == string::npos)
+        continue;
+      if (request.substr(begin, request.find_last_not_of(" \t\r") - begin +
+          1) == "quit")
+      {
+        quit = true;
+        break;
+      }
+
+      Timer::Start("requests");
+      const string error = AnswerRequest(request, refTree, referenceData,
+          oldFromNewRefs, basis, leafSize, threads, cache);
+      Timer::Stop("requests");
+      ++requests;
+
+      if (error == "")
+        cout << "ok" << endl;
+      else
+        cout << "error: " << error << endl;
+    }
+
+    // Only a named pipe can have another writer after this one.
+    if (serverFile == "-" || !IsNamedPipe(serverFile))
+      break;
+  }
+
+  Log::Info << "Answered " << requests << " requests." << endl;
+  if (cache.results.Capacity() > 0)
+    Log::Info << cache.results.Hits() << " query points were answered from "
+        << "the cache, and " << cache.results.Misses() << " were searched."
+        << endl;
+
+  delete refTree;
+}
+
+#ifdef MLPACK_HAS_MPI
+//! Replace each '%r' in the file name with the rank of this process.
+string RankFileName(const string& filename, const int rank)
+{
+  ostringstream rankString;
+  rankString << rank;
+
+  string result = filename;
+  size_t position;
+  while ((position = result.find("%r")) != string::npos)
+    result.replace(position, 2, rankString.str());
+
+  return result;
+}
+
+//! Load the points of this process: either its own file, or its share of the
+//! whole file.
+void LoadLocalPoints(const string& filename, arma::mat& data, const int rank,
+                     const int size)
+{
+  if (filename.find("%r") != string::npos)
+  {
+    data::Load(RankFileName(filename, rank), data, true);
+    return;
+  }
+
+  arma::mat allData;
+  data::Load(filename, allData, true);
+  const size_t begin = (allData.n_cols * rank) / size;
+  const size_t end = (allData.n_cols * (rank + 1)) / size;
+  data = (end > begin) ? arma::mat(allData.cols(begin, end - 1)) :
+      arma::mat(allData.n_rows, 0);
+}
+
+/**
+ * Search with the reference set split over the MPI processes.  Each process
+ * searches its own query points (or its own reference points, if there is no
+ * query file, leaving out each point itself).
+ */
+void DistributedSearch(const size_t k,
+                       const size_t leafSize,
+                       const size_t threads)
+{
+  MPI_Init(NULL, NULL);
+  int rank, size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  const string queryFile = CLI::GetParam<string>("query_file");
+  const string distancesFile = CLI::GetParam<string>("distances_file");
+  const string neighborsFile = CLI::GetParam<string>("neighbors_file");
+
+  arma::mat referenceData;
+  LoadLocalPoints(CLI::GetParam<string>("reference_file"), referenceData, rank,
+      size);
+  arma::mat queryData;
+  if (queryFile != "")
+    LoadLocalPoints(queryFile, queryData, rank, size);
+
+  Log::Info << "Process " << rank << " of " << size << " has "
+      << referenceData.n_cols << " reference points." << endl;
+
+  DistributedKNN knn(referenceData, MPI_COMM_WORLD,
+      (size_t) CLI::GetParam<int>("partition_sample_size"), leafSize);
+  knn.Threads() = threads;
+
+  // Without a query set, each point finds itself, so search for one more
+  // neighbor and leave it out.
+  const size_t searchK = (queryFile == "") ? k + 1 : k;
+  if (searchK > knn.NumReferences())
+  {
+    Log::Fatal << "Invalid k: " << k << "; must be greater than 0 and less "
+        << "than " << ((queryFile == "") ? "" : "or equal to ") << "the number "
+        << "of reference points (" << knn.NumReferences() << ")." << endl;
+  }
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+  knn.Search((queryFile == "") ? referenceData : queryData, searchK, neighbors,
+      distances);
+  Log::Info << "Neighbors computed; " << knn.ExtraSearches() << " queries "
+      << "were searched in partitions other than their own." << endl;
+
+  if (queryFile == "")
+  {
+    arma::Mat<size_t> neighborsOut(k, neighbors.n_cols);
+    arma::mat distancesOut(k, neighbors.n_cols);
+    for (size_t i = 0; i < neighbors.n_cols; ++i)
+    {
+      // Leave out the point itself (or the last neighbor, if the point is one
+      // of several at the same place and was not among the results).
+      const size_t self = knn.ReferenceOffset() + i;
+      for (size_t j = 0, out = 0; j < searchK && out < k; ++j)
+      {
+        if (neighbors(j, i) == self)
+          continue;
+        neighborsOut(out, i) = neighbors(j, i);
+        distancesOut(out++, i) = distances(j, i);
+      }
+    }
+    neighbors.swap(neighborsOut);
+    distances.swap(distancesOut);
+  }
+
+  if (distancesFile.find("%r") != string::npos &&
+      neighborsFile.find("%r") != string::npos)
+  {
+    data::Save(RankFileName(distancesFile, rank), distances);
+    data::Save(RankFileName(neighborsFile, rank), neighbors);
+  }
+  else
+  {
+    // Gather the results at process 0, in the order of the processes.
+    int localValues = (int) (k * neighbors.n_cols);
+    std::vector<int> counts(size), displs(size, 0);
+    MPI_Gather(&localValues, 1, MPI_INT, &counts[0], 1, MPI_INT, 0,
+        MPI_COMM_WORLD);
+    for (int p = 1; p < size; ++p)
+      displs[p] = displs[p - 1] + counts[p - 1];
+    const size_t totalValues = (rank == 0) ? displs[size - 1] +
+        counts[size - 1] : 0;
+
+    std::vector<unsigned long long> localNeighbors(neighbors.begin(),
+        neighbors.end());
+    std::vector<unsigned long long> allNeighbors(totalValues);
+    arma::mat allDistances(k, totalValues / k);
+    MPI_Gatherv(localNeighbors.empty() ? NULL : &localNeighbors[0],
+        localValues, MPI_UNSIGNED_LONG_LONG,
+        allNeighbors.empty() ? NULL : &allNeighbors[0], &counts[0], &displs[0],
+        MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(distances.memptr(), localValues, MPI_DOUBLE,
+        allDistances.memptr(), &counts[0], &displs[0], MPI_DOUBLE, 0,
+        MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+      arma::Mat<size_t> allNeighborsOut(k, totalValues / k);
+      for (size_t i = 0; i < totalValues; ++i)
+        allNeighborsOut[i] = (size_t) allNeighbors[i];
+
+      data::Save(distancesFile, allDistances);
+      data::Save(neighborsFile, allNeighborsOut);
+    }
+  }
+
+  MPI_Finalize();
+}
+#endif
 
 int main(int argc, char *argv[])
 {
@@ -80,6 +1057,10 @@ int main(int argc, char *argv[])
   const string distancesFile = CLI::GetParam<string>("distances_file");
   const string neighborsFile = CLI::GetParam<string>("neighbors_file");
 
+  const string referenceTreeFile =
+      CLI::GetParam<string>("reference_tree_file");
+  const string saveReferenceTree = CLI::GetParam<string>("save_reference_tree");
+
   int lsInt = CLI::GetParam<int>("leaf_size");
 
   size_t k = CLI::GetParam<int>("k");
@@ -87,6 +1068,67 @@ int main(int argc, char *argv[])
   bool naive = CLI::HasParam("naive");
   bool singleMode = CLI::HasParam("single_mode");
   const bool randomBasis = CLI::HasParam("random_basis");
+  bool autotune = CLI::HasParam("autotune");
+
+  // The tree type may be changed by autotuning.  cover_tree overrides r_tree.
+  bool coverTree = CLI::HasParam("cover_tree");
+  bool rTree = CLI::HasParam("r_tree") && !coverTree;
+
+  if (CLI::HasParam("distributed"))
+  {
+    if (naive || coverTree || rTree || autotune ||
+        CLI::GetParam<int>("query_chunk_size") != 0 || randomBasis ||
+        referenceTreeFile != "" || saveReferenceTree != "")
+    {
+      Log::Fatal << "--distributed only supports kd-trees, and cannot be used "
+          << "with --naive, --query_chunk_size, --autotune, --random_basis, "
+          << "--reference_tree_file or --save_reference_tree." << endl;
+    }
+    if (lsInt < 1 || CLI::GetParam<int>("threads") < 0 ||
+        CLI::GetParam<int>("partition_sample_size") < 1)
+    {
+      Log::Fatal << "Invalid leaf size, number of threads or partition sample "
+          << "size." << endl;
+    }
+
+#ifdef MLPACK_HAS_MPI
+    DistributedSearch(k, (size_t) lsInt,
+        (size_t) CLI::GetParam<int>("threads"));
+    return 0;
+#else
+    Log::Fatal << "--distributed requires mlpack to be built with MPI (the "
+        << "CMake option USE_MPI)." << endl;
+#endif
+  }
+
+  const bool server = (CLI::GetParam<string>("server") != "");
+  if (server && (coverTree || rTree || autotune ||
+      CLI::GetParam<int>("query_chunk_size") != 0 ||
+      CLI::HasParam("distributed") || CLI::HasParam("symmetric")))
+  {
+    Log::Fatal << "--server only supports kd-trees, and cannot be used with "
+        << "--cover_tree, --r_tree, --autotune, --query_chunk_size, "
+        << "--distributed or --symmetric." << endl;
+  }
+
+  // Sanity check on the query chunk size.
+  if (CLI::GetParam<int>("query_chunk_size") < 0)
+  {
+    Log::Fatal << "Invalid query chunk size: "
+        << CLI::GetParam<int>("query_chunk_size") << ".  Must be greater than "
+        << "or equal to 0." << endl;
+  }
+  const size_t chunkSize = (size_t) CLI::GetParam<int>("query_chunk_size");
+
+  if (chunkSize > 0 && queryFile == "")
+    Log::Fatal << "--query_chunk_size requires --query_file." << endl;
+
+  if (chunkSize > 0 &&
+      (CLI::HasParam("cover_tree") || CLI::HasParam("r_tree")))
+  {
+    Log::Fatal << "--query_chunk_size is only supported for kd-trees."
+        << endl;
+  }
 
   arma::mat referenceData;
   arma::mat queryData; // So it doesn't go out of scope.
@@ -95,7 +1137,9 @@ int main(int argc, char *argv[])
   Log::Info << "Loaded reference data from '" << referenceFile << "' ("
       << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
 
-  if (queryFile != "")
+  // When streaming, the query points are read later, a chunk at a time; a
+  // server reads the query points of each request.
+  if (queryFile != "" && chunkSize == 0 && !server)
   {
     data::Load(queryFile, queryData, true);
     Log::Info << "Loaded query data from '" << queryFile << "' ("
@@ -119,6 +1163,24 @@ int main(int argc, char *argv[])
   }
   size_t leafSize = lsInt;
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t threads = (size_t) CLI::GetParam<int>("threads");
+
+  // Sanity check on epsilon.
+  const double epsilon = CLI::GetParam<double>("epsilon");
+  if (epsilon < 0)
+  {
+    Log::Fatal << "Invalid epsilon: " << epsilon << ".  Must be greater than "
+        << "or equal to 0." << endl;
+  }
+
+  const bool symmetric = CLI::HasParam("symmetric");
+
   // Naive mode overrides single mode.
   if (singleMode && naive)
   {
@@ -131,10 +1193,60 @@ int main(int argc, char *argv[])
     Log::Warn << "--cover_tree overrides --r_tree." << endl;
   }
   
+  if (CLI::HasParam("r_tree") && !CLI::HasParam("cover_tree") &&
+      (referenceTreeFile != "" || saveReferenceTree != ""))
+  {
+    Log::Fatal << "--reference_tree_file and --save_reference_tree are not "
+        << "supported with --r_tree." << endl;
+  }
+
+  if (autotune && naive)
+  {
+    Log::Warn << "--autotune ignored because --naive is present." << endl;
+    autotune = false;
+  }
+
+  bool offload = CLI::HasParam("offload");
+  if (offload && !naive)
+  {
+    Log::Warn << "--offload ignored because --naive is not present." << endl;
+    offload = false;
+  }
+
+  if (offload && (chunkSize > 0 || server ||
+      CLI::HasParam("single_precision")))
+  {
+    Log::Warn << "--offload ignored because it is not supported with "
+        << "--query_chunk_size, --server or --single_precision." << endl;
+    offload = false;
+  }
+
+  if (offload && !util::AcceleratorAvailable())
+  {
+    Log::Warn << "mlpack was built without an accelerator backend, so the "
+        << "offloaded matrix multiplications will run on the CPU." << endl;
+  }
+
+  if (autotune && (chunkSize > 0 || referenceTreeFile != "" ||
+      saveReferenceTree != ""))
+  {
+    Log::Fatal << "--autotune cannot be used with --query_chunk_size, "
+        << "--reference_tree_file or --save_reference_tree." << endl;
+  }
+
+  if (CLI::GetParam<int>("autotune_sample_size") < 1)
+  {
+    Log::Fatal << "Invalid autotune sample size: "
+        << CLI::GetParam<int>("autotune_sample_size") << ".  Must be greater "
+        << "than 0." << endl;
+  }
+
   if (naive)
     leafSize = referenceData.n_cols;
 
-  // See if we want to project onto a random basis.
+  // See if we want to project onto a random basis.  It is kept, so that query
+  // chunks can be projected as they are read.
+  arma::mat basis;
   if (randomBasis)
   {
     // Generate the random basis.
@@ -163,105 +1275,160 @@ int main(int argc, char *argv[])
         if (arma::det(q) >= 0)
         {
           referenceData = q * referenceData;
-          if (queryFile != "")
+          if (queryFile != "" && chunkSize == 0)
             queryData = q * queryData;
+          basis = q;
           break;
         }
       }
     }
   }
 
-  arma::Mat<size_t> neighbors;
-  arma::mat distances;
-
-  if (!CLI::HasParam("cover_tree"))
+  if (server)
   {
-    if(!CLI::HasParam("r_tree"))
+    if (CLI::HasParam("single_precision"))
     {
-      // Because we may construct it differently, we need a pointer.
-      AllkNN* allknn = NULL;
+      arma::fmat floatReferenceData =
+          arma::conv_to<arma::fmat>::from(referenceData);
+      referenceData.reset();
 
-      // Mappings for when we build the tree.
-      std::vector<size_t> oldFromNewRefs;
+      ServeKDTreeSearch(floatReferenceData, basis, leafSize, threads);
+    }
+    else
+    {
+      ServeKDTreeSearch(referenceData, basis, leafSize, threads);
+    }
 
-      // Build trees by hand, so we can save memory: if we pass a tree to
-      // NeighborSearch, it does not copy the matrix.
-      Log::Info << "Building reference tree..." << endl;
-      Timer::Start("tree_building");
+    return 0;
+  }
 
-      BinarySpaceTree<bound::HRectBound<2>,
-	  NeighborSearchStat<NearestNeighborSort> >
-	  refTree(referenceData, oldFromNewRefs, leafSize);
-      BinarySpaceTree<bound::HRectBound<2>,
-	  NeighborSearchStat<NearestNeighborSort> >*
-	  queryTree = NULL; // Empty for now.
+  // Choose the tree type and leaf size by timing the search on a sample of
+  // the data.
+  if (autotune)
+  {
+    std::vector<size_t> leafSizes;
+    for (size_t size = 5; size <= 80; size *= 2)
+      leafSizes.push_back(size);
+
+    Log::Info << "Autotuning the tree type and leaf size..." << endl;
+    Timer::Start("autotuning");
+    string treeType;
+    AutotuneKNN(referenceData, queryData, k, singleMode,
+        (size_t) CLI::GetParam<int>("autotune_sample_size"), leafSizes,
+        treeType, leafSize, threads, epsilon);
+    Timer::Stop("autotuning");
+
+    coverTree = (treeType == "cover");
+    rTree = (treeType == "r");
+    if (coverTree)
+      Log::Info << "Autotuning chose cover trees." << endl;
+    else
+      Log::Info << "Autotuning chose " << (rTree ? "R-trees" : "kd-trees")
+          << " with leaf size " << leafSize << "." << endl;
+  }
 
-      Timer::Stop("tree_building");
+  if (CLI::HasParam("single_precision") && (coverTree || rTree))
+  {
+    Log::Warn << "--single_precision ignored because it is only supported for "
+        << "kd-trees." << endl;
+  }
 
-      std::vector<size_t> oldFromNewQueries;
+  // The offloaded brute-force search is done by NeighborSearch itself, without
+  // trees, so that it can compute the distances in large tiles.
+  if (offload)
+  {
+    typedef NeighborSearch<NearestNeighborSort, metric::EuclideanDistance>
+        KNNType;
+    KNNType* allknn = (queryFile != "") ?
+        new KNNType(referenceData, queryData, true) :
+        new KNNType(referenceData, true);
+
+    Log::Info << "Computing " << k << " nearest neighbors with offloaded "
+        << "brute-force search..." << endl;
+    allknn->Threads() = threads;
+    allknn->Offload() = true;
+
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    allknn->Search(k, neighbors, distances);
 
-      if (CLI::GetParam<string>("query_file") != "")
-      {
-	if (naive && leafSize < queryData.n_cols)
-	  leafSize = queryData.n_cols;
+    Log::Info << "Neighbors computed." << endl;
+    delete allknn;
 
-	Log::Info << "Loaded query data from '" << queryFile << "' ("
-	    << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+    data::Save(distancesFile, distances);
+    data::Save(neighborsFile, neighbors);
+    return 0;
+  }
 
-	Log::Info << "Building query tree..." << endl;
+  // Cover trees and R trees do not rearrange the dataset, so the points of
+  // each node would be scattered through memory.  Sort the points along a
+  // Hilbert curve first, so that nearby points are near each other in memory,
+  // and map the results back at the end.  This is not done if the reference
+  // tree is loaded or saved, because the tree refers to the original order.
+  const bool reorder = (coverTree || rTree) && referenceTreeFile == "" &&
+      saveReferenceTree == "";
+  std::vector<size_t> oldFromNewRefs;
+  std::vector<size_t> oldFromNewQueries;
+  if (reorder)
+  {
+    Timer::Start("reordering");
+    data::HilbertOrder(referenceData, oldFromNewRefs);
+    data::Reorder(referenceData, oldFromNewRefs);
+    if (queryFile != "")
+    {
+      data::HilbertOrder(queryData, oldFromNewQueries);
+      data::Reorder(queryData, oldFromNewQueries);
+    }
+    Timer::Stop("reordering");
+  }
 
-	// Build trees by hand, so we can save memory: if we pass a tree to
-	// NeighborSearch, it does not copy the matrix.
-	if (!singleMode)
-	{
-	  Timer::Start("tree_building");
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
 
-	  queryTree = new BinarySpaceTree<bound::HRectBound<2>,
-	      NeighborSearchStat<NearestNeighborSort> >(queryData,
-	      oldFromNewQueries, leafSize);
+  if (!coverTree)
+  {
+    if (!rTree)
+    {
+      if (chunkSize > 0)
+      {
+        // The results are written as each chunk is finished, so there is
+        // nothing left to save afterwards.
+        if (CLI::HasParam("single_precision"))
+        {
+          arma::fmat floatReferenceData =
+              arma::conv_to<arma::fmat>::from(referenceData);
+          referenceData.reset();
 
-	  Timer::Stop("tree_building");
-	}
+          StreamingKDTreeSearch(floatReferenceData, basis, chunkSize,
+              leafSize, k, naive, singleMode, threads, epsilon);
+        }
+        else
+        {
+          StreamingKDTreeSearch(referenceData, basis, chunkSize, leafSize, k,
+              naive, singleMode, threads, epsilon);
+        }
 
-	allknn = new AllkNN(&refTree, queryTree, referenceData, queryData,
-	    singleMode);
+        return 0;
+      }
 
-	Log::Info << "Tree built." << endl;
+      if (CLI::HasParam("single_precision"))
+      {
+        // Convert the data to single precision; the trees and the search then
+        // work entirely on the converted data.
+        arma::fmat floatReferenceData =
+            arma::conv_to<arma::fmat>::from(referenceData);
+        arma::fmat floatQueryData = arma::conv_to<arma::fmat>::from(queryData);
+        referenceData.reset();
+        queryData.reset();
+
+        KDTreeSearch(floatReferenceData, floatQueryData, leafSize, k, naive,
+            singleMode, threads, epsilon, symmetric, neighbors, distances);
       }
       else
       {
-	allknn = new AllkNN(&refTree, referenceData, singleMode);
-
-	Log::Info << "Trees built." << endl;
+        KDTreeSearch(referenceData, queryData, leafSize, k, naive, singleMode,
+            threads, epsilon, symmetric, neighbors, distances);
       }
-
-      arma::mat distancesOut;
-      arma::Mat<size_t> neighborsOut;
-
-      Log::Info << "Computing " << k << " nearest neighbors..." << endl;
-      allknn->Search(k, neighborsOut, distancesOut);
-
-      Log::Info << "Neighbors computed." << endl;
-
-      // We have to map back to the original indices from before the tree
-      // construction.
-      Log::Info << "Re-mapping indices..." << endl;
-
-      // Map the results back to the correct places.
-      if ((CLI::GetParam<string>("query_file") != "") && !singleMode)
-	Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewQueries,
-	    neighbors, distances);
-      else if ((CLI::GetParam<string>("query_file") != "") && singleMode)
-	Unmap(neighborsOut, distancesOut, oldFromNewRefs, neighbors, distances);
-      else
-	Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewRefs,
-	    neighbors, distances);
-
-      // Clean up.
-      if (queryTree)
-	delete queryTree;
-
-      delete allknn;
     } else { // R tree.
       // Make sure to notify the user that they are using an r tree.
       Log::Info << "Using R tree for nearest-neighbor calculation." << endl;
@@ -282,7 +1449,7 @@ int main(int argc, char *argv[])
          tree::RStarTreeDescentHeuristic,
          NeighborSearchStat<NearestNeighborSort>,
          arma::mat>
-      refTree(referenceData, leafSize, leafSize * 0.4, 5, 2, 0);
+      refTree(referenceData, leafSize, leafSize * 0.4, 5, 2, 0, true);
 
       RectangleTree<tree::RStarTreeSplit<tree::RStarTreeDescentHeuristic, NeighborSearchStat<NearestNeighborSort>, arma::mat>,
          tree::RStarTreeDescentHeuristic,
@@ -306,7 +1473,7 @@ int main(int argc, char *argv[])
           queryTree = new RectangleTree<tree::RStarTreeSplit<tree::RStarTreeDescentHeuristic, NeighborSearchStat<NearestNeighborSort>, arma::mat>,
           tree::RStarTreeDescentHeuristic,
           NeighborSearchStat<NearestNeighborSort>,
-          arma::mat>(queryData, leafSize, leafSize * 0.4, 5, 2, 0);
+          arma::mat>(queryData, leafSize, leafSize * 0.4, 5, 2, 0, true);
 
           Timer::Stop("tree_building");
         }
@@ -333,6 +1500,10 @@ int main(int argc, char *argv[])
       //arma::Mat<size_t> neighborsOut;
 
       Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+      allknn->Threads() = threads;
+      allknn->ReplicateReference() = CLI::HasParam("replicate_reference");
+      allknn->Epsilon() = epsilon;
+      allknn->Symmetric() = symmetric;
       allknn->Search(k, neighbors, distances);
 
       Log::Info << "Neighbors computed." << endl;
@@ -347,15 +1518,47 @@ int main(int argc, char *argv[])
     // Make sure to notify the user that they are using cover trees.
     Log::Info << "Using cover trees for nearest-neighbor calculation." << endl;
 
-    // Build our reference tree.
-    Log::Info << "Building reference tree..." << endl;
-    Timer::Start("tree_building");
+    // Build (or load) our reference tree.
     CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
-        NeighborSearchStat<NearestNeighborSort> > referenceTree(referenceData,
-        1.3);
+        NeighborSearchStat<NearestNeighborSort> >* referenceTree = NULL;
+    if (referenceTreeFile != "")
+    {
+      Log::Info << "Loading reference tree from '" << referenceTreeFile
+          << "'..." << endl;
+      ifstream treeStream(referenceTreeFile.c_str(), ios::binary);
+      if (!treeStream.is_open())
+        Log::Fatal << "Cannot open reference tree file '" << referenceTreeFile
+            << "'." << endl;
+
+      Timer::Start("tree_loading");
+      referenceTree = new CoverTree<metric::LMetric<2, true>,
+          tree::FirstPointIsRoot, NeighborSearchStat<NearestNeighborSort> >(
+          referenceData, treeStream);
+      Timer::Stop("tree_loading");
+    }
+    else
+    {
+      Log::Info << "Building reference tree..." << endl;
+      Timer::Start("tree_building");
+      referenceTree = new CoverTree<metric::LMetric<2, true>,
+          tree::FirstPointIsRoot, NeighborSearchStat<NearestNeighborSort> >(
+          referenceData, 1.3);
+      Timer::Stop("tree_building");
+    }
+
+    if (saveReferenceTree != "")
+    {
+      Log::Info << "Saving reference tree to '" << saveReferenceTree << "'."
+          << endl;
+      ofstream treeStream(saveReferenceTree.c_str(), ios::binary);
+      if (!treeStream.is_open())
+        Log::Fatal << "Cannot open '" << saveReferenceTree << "' for writing."
+            << endl;
+      referenceTree->Save(treeStream);
+    }
+
     CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
         NeighborSearchStat<NearestNeighborSort> >* queryTree = NULL;
-    Timer::Stop("tree_building");
 
     NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>,
         CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
@@ -377,18 +1580,21 @@ int main(int argc, char *argv[])
 
       allknn = new NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>,
           CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
-          NeighborSearchStat<NearestNeighborSort> > >(&referenceTree, queryTree,
+          NeighborSearchStat<NearestNeighborSort> > >(referenceTree, queryTree,
           referenceData, queryData, singleMode);
     }
     else
     {
       allknn = new NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>,
           CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
-          NeighborSearchStat<NearestNeighborSort> > >(&referenceTree,
+          NeighborSearchStat<NearestNeighborSort> > >(referenceTree,
           referenceData, singleMode);
     }
 
     Log::Info << "Computing " << k << " nearest neighbors..." << endl;
+    allknn->Threads() = threads;
+    allknn->ReplicateReference() = CLI::HasParam("replicate_reference");
+    allknn->Epsilon() = epsilon;
     allknn->Search(k, neighbors, distances);
 
     Log::Info << "Neighbors computed." << endl;
@@ -397,6 +1603,18 @@ int main(int argc, char *argv[])
 
     if (queryTree)
       delete queryTree;
+    delete referenceTree;
+  }
+
+  if (reorder)
+  {
+    arma::Mat<size_t> neighborsOut;
+    arma::mat distancesOut;
+    Unmap(neighbors, distances, oldFromNewRefs,
+        (queryFile != "") ? oldFromNewQueries : oldFromNewRefs, neighborsOut,
+        distancesOut, false, threads);
+    neighbors.swap(neighborsOut);
+    distances.swap(distancesOut);
   }
 
   // Save put.
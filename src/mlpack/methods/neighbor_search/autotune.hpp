@@ -0,0 +1,239 @@
+/**
+ * @file autotune.hpp
+ *
+ * Autotuning for k-nearest-neighbor search: time the search on a sample of the
+ * data with each of a small grid of tree types and leaf sizes, and choose the
+ * fastest configuration.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_AUTOTUNE_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_AUTOTUNE_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/tree/cover_tree.hpp>
+
+#include <vector>
+#include <string>
+
+#include "neighbor_search.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Sample the given number of columns of the given matrix uniformly at random,
+ * without replacement.  If the matrix has no more columns than that, it is
+ * copied.
+ *
+ * @param data Matrix to sample columns from.
+ * @param samples Number of columns to sample.
+ * @param sample Matrix to store the sampled columns in.
+ */
+inline void SampleColumns(const arma::mat& data,
+                          const size_t samples,
+                          arma::mat& sample)
+{
+  if (samples >= data.n_cols)
+  {
+    sample = data;
+    return;
+  }
+
+  // A partial Fisher-Yates shuffle of the indices.
+  std::vector<size_t> indices(data.n_cols);
+  for (size_t i = 0; i < indices.size(); ++i)
+    indices[i] = i;
+
+  sample.set_size(data.n_rows, samples);
+  for (size_t i = 0; i < samples; ++i)
+  {
+    const size_t j = (size_t) math::RandInt((int) i, (int) data.n_cols);
+    std::swap(indices[i], indices[j]);
+    sample.col(i) = data.col(indices[i]);
+  }
+}
+
+/**
+ * Time a k-nearest-neighbor search with already-built trees.  If the query set
+ * is empty, the reference set is also used as the query set.  The query tree
+ * is ignored (and may be NULL) in single-tree mode or if the query set is
+ * empty.
+ *
+ * @return The time the search took, in seconds.
+ */
+template<typename TreeType>
+double TimeKNNSearch(TreeType* referenceTree,
+                     TreeType* queryTree,
+                     const typename TreeType::Mat& referenceData,
+                     const typename TreeType::Mat& queryData,
+                     const size_t k,
+                     const bool singleMode,
+                     const size_t threads,
+                     const double epsilon)
+{
+  typedef NeighborSearch<NearestNeighborSort, metric::EuclideanDistance,
+      TreeType> SearchType;
+
+  const double start = Timer::Now();
+
+  SearchType* search = NULL;
+  if (queryData.n_cols > 0)
+    search = new SearchType(referenceTree, queryTree, referenceData, queryData,
+        singleMode);
+  else
+    search = new SearchType(referenceTree, referenceData, singleMode);
+
+  search->Threads() = threads;
+  search->Epsilon() = epsilon;
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  search->Search(k, neighbors, distances);
+
+  delete search;
+
+  return Timer::Now() - start;
+}
+
+/**
+ * Choose the tree type and leaf size for k-nearest-neighbor search which are
+ * likely to be fastest for the given data.  A sample of the reference set (and
+ * of the query set, if one is given) is taken, and the trees are built and the
+ * search is run on the samples with kd-trees and R*-trees of each of the given
+ * leaf sizes, and with cover trees (which have no leaf size).  The time taken
+ * by each configuration, including building the trees, is printed to
+ * Log::Info, and the configuration which took the least time is returned.
+ *
+ * The samples are a smaller version of the full problem, so this is only a
+ * guide: the relative speed of the configurations can change with the size of
+ * the dataset.  Because the runs are timed, the choice can differ between runs
+ * on the same data if two configurations are close.
+ *
+ * @param referenceData Reference dataset.
+ * @param queryData Query dataset; if it is empty, the reference set is used as
+ *     the query set.
+ * @param k Number of nearest neighbors to find.
+ * @param singleMode Whether single-tree search is used.
+ * @param sampleSize Maximum number of points to sample from the reference set
+ *     and from the query set.
+ * @param leafSizes Leaf sizes to try for kd-trees and R*-trees.
+ * @param treeType Set to the fastest tree type: "kd", "cover" or "r".
+ * @param leafSize Set to the fastest leaf size (unchanged for cover trees).
+ * @param threads Number of threads to search with (0 uses the default).
+ * @param epsilon Relative error allowed in the search.
+ */
+inline void AutotuneKNN(const arma::mat& referenceData,
+                        const arma::mat& queryData,
+                        const size_t k,
+                        const bool singleMode,
+                        const size_t sampleSize,
+                        const std::vector<size_t>& leafSizes,
+                        std::string& treeType,
+                        size_t& leafSize,
+                        const size_t threads = 0,
+                        const double epsilon = 0.0)
+{
+  typedef tree::BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > KDTreeType;
+  typedef tree::CoverTree<metric::LMetric<2, true>, tree::FirstPointIsRoot,
+      NeighborSearchStat<NearestNeighborSort> > CoverTreeType;
+  typedef tree::RectangleTree<tree::RStarTreeSplit<
+      tree::RStarTreeDescentHeuristic, NeighborSearchStat<NearestNeighborSort>,
+      arma::mat>, tree::RStarTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>, arma::mat> RTreeType;
+
+  arma::mat referenceSample;
+  SampleColumns(referenceData, sampleSize, referenceSample);
+  arma::mat querySample;
+  if (queryData.n_cols > 0)
+    SampleColumns(queryData, sampleSize, querySample);
+
+  // The sample may have fewer points than k.
+  const size_t sampleK = std::min(k, (size_t) referenceSample.n_cols);
+  const bool buildQueryTree = (querySample.n_cols > 0) && !singleMode;
+
+  Log::Info << "Autotuning on " << referenceSample.n_cols << " reference "
+      << "points";
+  if (querySample.n_cols > 0)
+    Log::Info << " and " << querySample.n_cols << " query points";
+  Log::Info << "." << std::endl;
+
+  double bestTime = DBL_MAX;
+
+  // Cover trees have no leaf size, so they are only tried once.
+  {
+    const double start = Timer::Now();
+    CoverTreeType referenceTree(referenceSample, 1.3);
+    CoverTreeType* queryTree = buildQueryTree ?
+        new CoverTreeType(querySample, 1.3) : NULL;
+    const double buildTime = Timer::Now() - start;
+
+    const double time = buildTime + TimeKNNSearch(&referenceTree, queryTree,
+        referenceSample, querySample, sampleK, singleMode, threads, epsilon);
+    delete queryTree;
+
+    Log::Info << "  cover tree: " << time << "s." << std::endl;
+    if (time < bestTime)
+    {
+      bestTime = time;
+      treeType = "cover";
+    }
+  }
+
+  for (size_t i = 0; i < leafSizes.size(); ++i)
+  {
+    // The kd-trees rearrange the data, so they are built on copies.
+    {
+      const double start = Timer::Now();
+      arma::mat references(referenceSample);
+      arma::mat queries(querySample);
+      std::vector<size_t> oldFromNew;
+      KDTreeType referenceTree(references, oldFromNew, leafSizes[i]);
+      KDTreeType* queryTree = buildQueryTree ?
+          new KDTreeType(queries, oldFromNew, leafSizes[i]) : NULL;
+      const double buildTime = Timer::Now() - start;
+
+      const double time = buildTime + TimeKNNSearch(&referenceTree, queryTree,
+          references, queries, sampleK, singleMode, threads, epsilon);
+      delete queryTree;
+
+      Log::Info << "  kd-tree, leaf size " << leafSizes[i] << ": " << time
+          << "s." << std::endl;
+      if (time < bestTime)
+      {
+        bestTime = time;
+        treeType = "kd";
+        leafSize = leafSizes[i];
+      }
+    }
+
+    // The R*-trees are built the same way as by the allknn program.
+    {
+      const double start = Timer::Now();
+      arma::mat references(referenceSample);
+      arma::mat queries(querySample);
+      RTreeType referenceTree(references, leafSizes[i], leafSizes[i] * 0.4, 5,
+          2, 0, true);
+      RTreeType* queryTree = buildQueryTree ? new RTreeType(queries,
+          leafSizes[i], leafSizes[i] * 0.4, 5, 2, 0, true) : NULL;
+      const double buildTime = Timer::Now() - start;
+
+      const double time = buildTime + TimeKNNSearch(&referenceTree, queryTree,
+          references, queries, sampleK, singleMode, threads, epsilon);
+      delete queryTree;
+
+      Log::Info << "  R*-tree, leaf size " << leafSizes[i] << ": " << time
+          << "s." << std::endl;
+      if (time < bestTime)
+      {
+        bestTime = time;
+        treeType = "r";
+        leafSize = leafSizes[i];
+      }
+    }
+  }
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file candidate_heap.hpp
+ *
+ * Functions for keeping the candidate neighbors of a query point in a binary
+ * heap instead of a sorted list, which is faster when many neighbors are
+ * searched for.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_CANDIDATE_HEAP_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_CANDIDATE_HEAP_HPP
+
+#include <mlpack/core.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Offer a candidate to the k candidates of a query point, held as a binary heap
+ * in which the worst candidate (by SortPolicy::IsBetter()) is first.  If the
+ * new candidate is better than the worst one, it replaces it and is moved down
+ * the heap; this takes O(log k) time, where keeping the candidates sorted takes
+ * O(k).  Slots which have not been filled hold SortPolicy::WorstDistance(), so
+ * they are the first to be replaced.
+ *
+ * Unlike SortPolicy::SortDistance(), a candidate which ties with the worst
+ * candidate is not inserted.
+ *
+ * @param distances Distances of the candidates (k elements).
+ * @param neighbors Indices of the candidates (k elements).
+ * @param k Number of candidates.
+ * @param neighbor Index of the new candidate.
+ * @param distance Distance of the new candidate.
+ * @return Whether the new candidate was inserted.
+ */
+template<typename SortPolicy>
+inline bool HeapInsert(double* distances,
+                       size_t* neighbors,
+                       const size_t k,
+                       const size_t neighbor,
+                       const double distance)
+{
+  if (!SortPolicy::IsBetter(distance, distances[0]))
+    return false;
+
+  // Move the hole at the top down until both children of it are better than
+  // the new candidate.
+  size_t hole = 0;
+  while (true)
+  {
+    size_t child = 2 * hole + 1;
+    if (child >= k)
+      break;
+    if ((child + 1 < k) &&
+        SortPolicy::IsBetter(distances[child], distances[child + 1]))
+      ++child; // The right child is worse.
+    if (!SortPolicy::IsBetter(distance, distances[child]))
+      break;
+
+    distances[hole] = distances[child];
+    neighbors[hole] = neighbors[child];
+    hole = child;
+  }
+
+  distances[hole] = distance;
+  neighbors[hole] = neighbor;
+  return true;
+}
+
+//! Order candidates by SortPolicy::IsBetter() on their distances.
+template<typename SortPolicy>
+struct CandidateComparator
+{
+  bool operator()(const std::pair<double, size_t>& a,
+                  const std::pair<double, size_t>& b) const
+  {
+    return SortPolicy::IsBetter(a.first, b.first);
+  }
+};
+
+/**
+ * Sort the k candidates of a query point so that the best is first, as
+ * SortPolicy::SortDistance() expects.  This is used to turn a heap built by
+ * HeapInsert() into the usual sorted list.  Candidates with equal distances
+ * keep their relative order.
+ *
+ * @param distances Distances of the candidates (k elements).
+ * @param neighbors Indices of the candidates (k elements).
+ * @param k Number of candidates.
+ */
+template<typename SortPolicy>
+void SortCandidates(double* distances, size_t* neighbors, const size_t k)
+{
+  std::vector<std::pair<double, size_t> > candidates(k);
+  for (size_t i = 0; i < k; ++i)
+    candidates[i] = std::make_pair(distances[i], neighbors[i]);
+
+  std::stable_sort(candidates.begin(), candidates.end(),
+      CandidateComparator<SortPolicy>());
+
+  for (size_t i = 0; i < k; ++i)
+  {
+    distances[i] = candidates[i].first;
+    neighbors[i] = candidates[i].second;
+  }
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
@@ -0,0 +1,575 @@
+/**
+ * @file distributed_knn.cpp
+ *
+ * Implementation of the DistributedKNN class.
+ */
+#include "distributed_knn.hpp"
+#include "neighbor_search.hpp"
+
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+DistributedKNN::DistributedKNN(const arma::mat& referenceSet,
+                               const size_t numPartitions,
+                               const size_t sampleSize,
+                               const size_t leafSize) :
+    sampleTree(NULL),
+    numReferences(referenceSet.n_cols),
+    referenceOffset(0),
+    leafSize(leafSize),
+    blockSize(100000),
+    threads(0),
+    extraSearches(0),
+    distributed(false),
+    rank(0)
+{
+  if (numPartitions == 0)
+    Log::Fatal << "DistributedKNN::DistributedKNN(): the number of partitions "
+        << "must be greater than 0!" << std::endl;
+  if (referenceSet.n_cols == 0)
+    Log::Fatal << "DistributedKNN::DistributedKNN(): the reference set is empty!"
+        << std::endl;
+
+  Timer::Start("tree_building");
+
+  // Sample the reference set without replacement.
+  const size_t numSamples = std::min(std::max(sampleSize, (size_t) 1),
+      (size_t) referenceSet.n_cols);
+  arma::uvec order = arma::shuffle(arma::linspace<arma::uvec>(0,
+      referenceSet.n_cols - 1, referenceSet.n_cols));
+  sample.set_size(referenceSet.n_rows, numSamples);
+  for (size_t i = 0; i < numSamples; ++i)
+    sample.col(i) = referenceSet.col(order[i]);
+
+  BuildPartitioning(numPartitions);
+
+  // Send each point to its partition.
+  partitions.resize(NumPartitions());
+  std::vector<size_t> assignments(referenceSet.n_cols);
+  for (size_t i = 0; i < referenceSet.n_cols; ++i)
+  {
+    assignments[i] = Partition(referenceSet.unsafe_col(i));
+    ++partitionSizes[assignments[i]];
+  }
+
+  for (size_t p = 0; p < partitions.size(); ++p)
+  {
+    partitions[p].points.set_size(referenceSet.n_rows, partitionSizes[p]);
+    partitions[p].indices.reserve(partitionSizes[p]);
+  }
+  for (size_t i = 0; i < referenceSet.n_cols; ++i)
+  {
+    LocalPartition& partition = partitions[assignments[i]];
+    partition.points.col(partition.indices.size()) = referenceSet.col(i);
+    partition.indices.push_back(i);
+  }
+
+  for (size_t p = 0; p < partitions.size(); ++p)
+  {
+    BuildPartitionTree(partitions[p]);
+    if (partitionSizes[p] > 0)
+      partitionBounds[p] |= partitions[p].points;
+  }
+
+  Timer::Stop("tree_building");
+}
+
+#ifdef MLPACK_HAS_MPI
+DistributedKNN::DistributedKNN(const arma::mat& localReferenceSet,
+                               MPI_Comm communicator,
+                               const size_t sampleSize,
+                               const size_t leafSize) :
+    sampleTree(NULL),
+    numReferences(0),
+    referenceOffset(0),
+    leafSize(leafSize),
+    blockSize(100000),
+    threads(0),
+    extraSearches(0),
+    distributed(true),
+    communicator(communicator)
+{
+  int mpiRank, mpiSize;
+  MPI_Comm_rank(communicator, &mpiRank);
+  MPI_Comm_size(communicator, &mpiSize);
+  rank = (size_t) mpiRank;
+  const size_t size = (size_t) mpiSize;
+
+  Timer::Start("tree_building");
+
+  // Number the reference points in the order of the processes.
+  unsigned long long localCount = localReferenceSet.n_cols;
+  unsigned long long offset = 0;
+  unsigned long long total = 0;
+  MPI_Exscan(&localCount, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+      communicator);
+  MPI_Allreduce(&localCount, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+      communicator);
+  referenceOffset = (rank == 0) ? 0 : (size_t) offset;
+  numReferences = (size_t) total;
+  if (numReferences == 0)
+    Log::Fatal << "DistributedKNN::DistributedKNN(): the reference set is empty!"
+        << std::endl;
+
+  // The dimensionality of a process without points is not known from its data.
+  unsigned long long localDims = localReferenceSet.n_rows;
+  unsigned long long dims = 0;
+  MPI_Allreduce(&localDims, &dims, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX,
+      communicator);
+
+  // Each process samples its share of the sample, and every process gathers
+  // all of it, so that they all build the same partitioning.
+  const size_t localSamples = std::min((size_t) localReferenceSet.n_cols,
+      (size_t) std::ceil((double) sampleSize * localReferenceSet.n_cols /
+      numReferences));
+  arma::mat localSample(dims, localSamples);
+  if (localSamples > 0)
+  {
+    arma::uvec order = arma::shuffle(arma::linspace<arma::uvec>(0,
+        localReferenceSet.n_cols - 1, localReferenceSet.n_cols));
+    for (size_t i = 0; i < localSamples; ++i)
+      localSample.col(i) = localReferenceSet.col(order[i]);
+  }
+
+  int sendCount = (int) localSample.n_elem;
+  std::vector<int> recvCounts(size), recvDispls(size);
+  MPI_Allgather(&sendCount, 1, MPI_INT, &recvCounts[0], 1, MPI_INT,
+      communicator);
+  size_t totalSample = 0;
+  for (size_t p = 0; p < size; ++p)
+  {
+    recvDispls[p] = (int) totalSample;
+    totalSample += recvCounts[p];
+  }
+  sample.set_size(dims, totalSample / dims);
+  MPI_Allgatherv(localSample.memptr(), sendCount, MPI_DOUBLE, sample.memptr(),
+      &recvCounts[0], &recvDispls[0], MPI_DOUBLE, communicator);
+
+  BuildPartitioning(size);
+
+  // Order the local points by their partitions, and send them to the
+  // processes of the partitions, with their global indices.
+  std::vector<size_t> assignments(localReferenceSet.n_cols);
+  std::vector<int> pointCounts(size, 0);
+  for (size_t i = 0; i < localReferenceSet.n_cols; ++i)
+  {
+    assignments[i] = Partition(localReferenceSet.unsafe_col(i));
+    ++pointCounts[assignments[i]];
+  }
+
+  std::vector<int> pointDispls(size, 0);
+  for (size_t p = 1; p < size; ++p)
+    pointDispls[p] = pointDispls[p - 1] + pointCounts[p - 1];
+
+  arma::mat sendPoints(dims, localReferenceSet.n_cols);
+  std::vector<unsigned long long> sendIndices(localReferenceSet.n_cols);
+  std::vector<int> filled(pointDispls);
+  for (size_t i = 0; i < localReferenceSet.n_cols; ++i)
+  {
+    const size_t position = filled[assignments[i]]++;
+    sendPoints.col(position) = localReferenceSet.col(i);
+    sendIndices[position] = referenceOffset + i;
+  }
+
+  std::vector<int> recvPointCounts(size);
+  MPI_Alltoall(&pointCounts[0], 1, MPI_INT, &recvPointCounts[0], 1, MPI_INT,
+      communicator);
+  std::vector<int> recvPointDispls(size, 0);
+  for (size_t p = 1; p < size; ++p)
+    recvPointDispls[p] = recvPointDispls[p - 1] + recvPointCounts[p - 1];
+  const size_t numReceived = recvPointDispls[size - 1] +
+      recvPointCounts[size - 1];
+
+  partitions.resize(NumPartitions());
+  LocalPartition& local = partitions[rank];
+  std::vector<unsigned long long> recvIndices(numReceived);
+  MPI_Alltoallv(sendIndices.empty() ? NULL : &sendIndices[0], &pointCounts[0],
+      &pointDispls[0], MPI_UNSIGNED_LONG_LONG,
+      recvIndices.empty() ? NULL : &recvIndices[0], &recvPointCounts[0],
+      &recvPointDispls[0], MPI_UNSIGNED_LONG_LONG, communicator);
+  local.indices.assign(recvIndices.begin(), recvIndices.end());
+
+  // The points are sent as dims doubles each.
+  for (size_t p = 0; p < size; ++p)
+  {
+    pointCounts[p] *= dims;
+    pointDispls[p] *= dims;
+    recvPointCounts[p] *= dims;
+    recvPointDispls[p] *= dims;
+  }
+  local.points.set_size(dims, numReceived);
+  MPI_Alltoallv(sendPoints.memptr(), &pointCounts[0], &pointDispls[0],
+      MPI_DOUBLE, local.points.memptr(), &recvPointCounts[0],
+      &recvPointDispls[0], MPI_DOUBLE, communicator);
+  sendPoints.reset();
+
+  BuildPartitionTree(local);
+
+  // Every process needs the size and the bounding box of every partition.
+  unsigned long long localSize = numReceived;
+  std::vector<unsigned long long> sizes(size);
+  MPI_Allgather(&localSize, 1, MPI_UNSIGNED_LONG_LONG, &sizes[0], 1,
+      MPI_UNSIGNED_LONG_LONG, communicator);
+
+  bound::HRectBound<2> localBound(dims);
+  if (numReceived > 0)
+    localBound |= local.points;
+  std::vector<double> localRanges(2 * dims);
+  for (size_t d = 0; d < dims; ++d)
+  {
+    localRanges[2 * d] = localBound[d].Lo();
+    localRanges[2 * d + 1] = localBound[d].Hi();
+  }
+  std::vector<double> ranges(2 * dims * size);
+  MPI_Allgather(&localRanges[0], 2 * dims, MPI_DOUBLE, &ranges[0], 2 * dims,
+      MPI_DOUBLE, communicator);
+
+  for (size_t p = 0; p < size; ++p)
+  {
+    partitionSizes[p] = (size_t) sizes[p];
+    for (size_t d = 0; d < dims; ++d)
+      partitionBounds[p][d] = math::Range(ranges[2 * (p * dims + d)],
+          ranges[2 * (p * dims + d) + 1]);
+  }
+
+  Timer::Stop("tree_building");
+}
+#endif
+
+DistributedKNN::~DistributedKNN()
+{
+  for (size_t p = 0; p < partitions.size(); ++p)
+    delete partitions[p].tree;
+  delete sampleTree;
+}
+
+void DistributedKNN::Search(const arma::mat& querySet,
+                            const size_t k,
+                            arma::Mat<size_t>& neighbors,
+                            arma::mat& distances)
+{
+  if (k == 0)
+    Log::Fatal << "DistributedKNN::Search(): k must be greater than 0!"
+        << std::endl;
+  if (querySet.n_cols > 0 && querySet.n_rows != sample.n_rows)
+  {
+    Log::Fatal << "DistributedKNN::Search(): query points have "
+        << querySet.n_rows << " dimensions, but the reference points have "
+        << sample.n_rows << "!" << std::endl;
+  }
+
+  Timer::Start("distributed_search");
+
+  neighbors.set_size(k, querySet.n_cols);
+  neighbors.fill(size_t() - 1);
+  distances.set_size(k, querySet.n_cols);
+  distances.fill(DBL_MAX);
+  extraSearches = 0;
+
+  // With MPI, every process has to take part in the same number of exchanges,
+  // even if it has fewer blocks of queries.
+  const size_t step = std::max(blockSize, (size_t) 1);
+  size_t numBlocks = (querySet.n_cols + step - 1) / step;
+#ifdef MLPACK_HAS_MPI
+  if (distributed)
+  {
+    unsigned long long localBlocks = numBlocks, maxBlocks = 0;
+    MPI_Allreduce(&localBlocks, &maxBlocks, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX,
+        communicator);
+    numBlocks = (size_t) maxBlocks;
+  }
+#endif
+
+  for (size_t block = 0; block < numBlocks; ++block)
+  {
+    const size_t begin = std::min(block * step, (size_t) querySet.n_cols);
+    const size_t end = std::min(begin + step, (size_t) querySet.n_cols);
+    // This process may have run out of queries, but still has to take part.
+    const arma::mat queries = (end > begin) ?
+        arma::mat(querySet.cols(begin, end - 1)) : arma::mat(sample.n_rows, 0);
+    arma::Mat<size_t> blockNeighbors(neighbors.memptr() + begin * k, k,
+        end - begin, false, true);
+    arma::mat blockDistances(distances.memptr() + begin * k, k, end - begin,
+        false, true);
+
+    // First search each query in its own partition.
+    std::vector<std::vector<size_t> > routes(NumPartitions());
+    std::vector<size_t> home(queries.n_cols);
+    for (size_t i = 0; i < queries.n_cols; ++i)
+    {
+      home[i] = Partition(queries.unsafe_col(i));
+      routes[home[i]].push_back(i);
+    }
+    SearchRouted(queries, routes, k, blockNeighbors, blockDistances);
+
+    // Then search it in every other partition which may hold a point nearer
+    // than its k'th candidate.
+    for (size_t p = 0; p < routes.size(); ++p)
+      routes[p].clear();
+    for (size_t i = 0; i < queries.n_cols; ++i)
+    {
+      for (size_t p = 0; p < NumPartitions(); ++p)
+      {
+        if (p == home[i] || partitionSizes[p] == 0)
+          continue;
+        if (partitionBounds[p].MinDistance(queries.unsafe_col(i)) <
+            blockDistances(k - 1, i))
+        {
+          routes[p].push_back(i);
+          ++extraSearches;
+        }
+      }
+    }
+    SearchRouted(queries, routes, k, blockNeighbors, blockDistances);
+  }
+
+  Timer::Stop("distributed_search");
+}
+
+size_t DistributedKNN::Partition(const arma::vec& point) const
+{
+  const TreeType* node = sampleTree;
+  std::map<const TreeType*, size_t>::const_iterator it;
+  while ((it = nodePartitions.find(node)) == nodePartitions.end())
+  {
+    // Go to the child whose bound is nearer (the one that contains the point,
+    // if either does).
+    if (node->Left()->Bound().MinDistance(point) <=
+        node->Right()->Bound().MinDistance(point))
+      node = node->Left();
+    else
+      node = node->Right();
+  }
+
+  return it->second;
+}
+
+void DistributedKNN::BuildPartitioning(const size_t numPartitions)
+{
+  // Leaves of one point, so that any node with more than one distinct point
+  // can be split.
+  sampleTree = new TreeType(sample, 1);
+
+  std::vector<const TreeType*> nodes(1, sampleTree);
+  while (nodes.size() < numPartitions)
+  {
+    // Split the node with the most sample points.
+    size_t largest = nodes.size();
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+      if (!nodes[i]->IsLeaf() && (largest == nodes.size() ||
+          nodes[i]->Count() > nodes[largest]->Count()))
+        largest = i;
+    }
+
+    if (largest == nodes.size())
+      break; // No node can be split.
+
+    const TreeType* node = nodes[largest];
+    nodes[largest] = node->Left();
+    nodes.push_back(node->Right());
+  }
+
+  if (nodes.size() < numPartitions)
+  {
+    Log::Warn << "DistributedKNN: the sample only allows " << nodes.size()
+        << " partitions; the others will be empty." << std::endl;
+  }
+
+  nodePartitions.clear();
+  for (size_t p = 0; p < nodes.size(); ++p)
+    nodePartitions[nodes[p]] = p;
+
+  partitionSizes.assign(numPartitions, 0);
+  partitionBounds.assign(numPartitions, bound::HRectBound<2>(sample.n_rows));
+}
+
+void DistributedKNN::BuildPartitionTree(LocalPartition& partition)
+{
+  partition.tree = NULL;
+  if (partition.points.n_cols == 0)
+    return;
+
+  std::vector<size_t> oldFromNew;
+  partition.tree = new TreeType(partition.points, oldFromNew, leafSize);
+
+  // The tree rearranged the points, so rearrange their indices too.
+  std::vector<size_t> indices(partition.indices.size());
+  for (size_t i = 0; i < indices.size(); ++i)
+    indices[i] = partition.indices[oldFromNew[i]];
+  partition.indices.swap(indices);
+}
+
+void DistributedKNN::SearchPartition(const LocalPartition& partition,
+                                     const arma::mat& queries,
+                                     const size_t k,
+                                     arma::Mat<size_t>& neighbors,
+                                     arma::mat& distances) const
+{
+  neighbors.set_size(k, queries.n_cols);
+  neighbors.fill(size_t() - 1);
+  distances.set_size(k, queries.n_cols);
+  distances.fill(DBL_MAX);
+  if (partition.tree == NULL || queries.n_cols == 0)
+    return;
+
+  // Single-tree search with the partition's tree; since the tree is not owned
+  // by the NeighborSearch object, the indices are in the order of the tree.
+  const size_t partitionK = std::min(k, (size_t) partition.points.n_cols);
+  NeighborSearch<NearestNeighborSort, metric::EuclideanDistance, TreeType>
+      search(partition.tree, NULL, partition.points, queries, true);
+  search.Threads() = threads;
+
+  arma::Mat<size_t> partitionNeighbors;
+  arma::mat partitionDistances;
+  search.Search(partitionK, partitionNeighbors, partitionDistances);
+
+  for (size_t i = 0; i < queries.n_cols; ++i)
+  {
+    for (size_t j = 0; j < partitionK; ++j)
+    {
+      if (partitionNeighbors(j, i) >= partition.indices.size())
+        continue;
+      neighbors(j, i) = partition.indices[partitionNeighbors(j, i)];
+      distances(j, i) = partitionDistances(j, i);
+    }
+  }
+}
+
+void DistributedKNN::SearchRouted(
+    const arma::mat& queries,
+    const std::vector<std::vector<size_t> >& routes,
+    const size_t k,
+    arma::Mat<size_t>& neighbors,
+    arma::mat& distances)
+{
+  if (!distributed)
+  {
+    for (size_t p = 0; p < routes.size(); ++p)
+    {
+      if (routes[p].empty())
+        continue;
+
+      arma::mat routed(queries.n_rows, routes[p].size());
+      for (size_t i = 0; i < routes[p].size(); ++i)
+        routed.col(i) = queries.col(routes[p][i]);
+
+      arma::Mat<size_t> partitionNeighbors;
+      arma::mat partitionDistances;
+      SearchPartition(partitions[p], routed, k, partitionNeighbors,
+          partitionDistances);
+
+      for (size_t i = 0; i < routes[p].size(); ++i)
+        MergeNeighbors(neighbors.colptr(routes[p][i]),
+            distances.colptr(routes[p][i]), partitionNeighbors.colptr(i),
+            partitionDistances.colptr(i), k);
+    }
+
+    return;
+  }
+
+#ifdef MLPACK_HAS_MPI
+  // Send the routed queries to the processes of their partitions.
+  const size_t size = routes.size();
+  const size_t dims = sample.n_rows;
+  std::vector<int> sendCounts(size), sendDispls(size, 0);
+  for (size_t p = 0; p < size; ++p)
+  {
+    sendCounts[p] = (int) routes[p].size();
+    if (p > 0)
+      sendDispls[p] = sendDispls[p - 1] + sendCounts[p - 1];
+  }
+  const size_t numSent = sendDispls[size - 1] + sendCounts[size - 1];
+
+  std::vector<int> recvCounts(size), recvDispls(size, 0);
+  MPI_Alltoall(&sendCounts[0], 1, MPI_INT, &recvCounts[0], 1, MPI_INT,
+      communicator);
+  for (size_t p = 1; p < size; ++p)
+    recvDispls[p] = recvDispls[p - 1] + recvCounts[p - 1];
+  const size_t numReceived = recvDispls[size - 1] + recvCounts[size - 1];
+
+  arma::mat sendQueries(dims, numSent);
+  for (size_t p = 0, position = 0; p < size; ++p)
+    for (size_t i = 0; i < routes[p].size(); ++i, ++position)
+      sendQueries.col(position) = queries.col(routes[p][i]);
+
+  std::vector<int> valueSendCounts(size), valueSendDispls(size);
+  std::vector<int> valueRecvCounts(size), valueRecvDispls(size);
+  for (size_t p = 0; p < size; ++p)
+  {
+    valueSendCounts[p] = sendCounts[p] * dims;
+    valueSendDispls[p] = sendDispls[p] * dims;
+    valueRecvCounts[p] = recvCounts[p] * dims;
+    valueRecvDispls[p] = recvDispls[p] * dims;
+  }
+  arma::mat receivedQueries(dims, numReceived);
+  MPI_Alltoallv(sendQueries.memptr(), &valueSendCounts[0], &valueSendDispls[0],
+      MPI_DOUBLE, receivedQueries.memptr(), &valueRecvCounts[0],
+      &valueRecvDispls[0], MPI_DOUBLE, communicator);
+
+  // Search them in the local partition.
+  arma::Mat<size_t> localNeighbors;
+  arma::mat localDistances;
+  SearchPartition(partitions[rank], receivedQueries, k, localNeighbors,
+      localDistances);
+  std::vector<unsigned long long> sendNeighbors(localNeighbors.begin(),
+      localNeighbors.end());
+
+  // Send the results back; k values for each query, in the reverse direction.
+  for (size_t p = 0; p < size; ++p)
+  {
+    valueSendCounts[p] = recvCounts[p] * k;
+    valueSendDispls[p] = recvDispls[p] * k;
+    valueRecvCounts[p] = sendCounts[p] * k;
+    valueRecvDispls[p] = sendDispls[p] * k;
+  }
+  std::vector<unsigned long long> recvNeighbors(numSent * k);
+  arma::mat recvDistances(k, numSent);
+  MPI_Alltoallv(sendNeighbors.empty() ? NULL : &sendNeighbors[0],
+      &valueSendCounts[0], &valueSendDispls[0], MPI_UNSIGNED_LONG_LONG,
+      recvNeighbors.empty() ? NULL : &recvNeighbors[0], &valueRecvCounts[0],
+      &valueRecvDispls[0], MPI_UNSIGNED_LONG_LONG, communicator);
+  MPI_Alltoallv(localDistances.memptr(), &valueSendCounts[0],
+      &valueSendDispls[0], MPI_DOUBLE, recvDistances.memptr(),
+      &valueRecvCounts[0], &valueRecvDispls[0], MPI_DOUBLE, communicator);
+
+  // Merge the results, which are in the order the queries were sent.
+  std::vector<size_t> resultNeighbors(k);
+  for (size_t p = 0, position = 0; p < size; ++p)
+  {
+    for (size_t i = 0; i < routes[p].size(); ++i, ++position)
+    {
+      for (size_t j = 0; j < k; ++j)
+        resultNeighbors[j] = (size_t) recvNeighbors[position * k + j];
+      MergeNeighbors(neighbors.colptr(routes[p][i]),
+          distances.colptr(routes[p][i]), &resultNeighbors[0],
+          recvDistances.colptr(position), k);
+    }
+  }
+#endif
+}
+
+void DistributedKNN::MergeNeighbors(size_t* neighbors,
+                                    double* distances,
+                                    const size_t* newNeighbors,
+                                    const double* newDistances,
+                                    const size_t k)
+{
+  const std::vector<size_t> oldNeighbors(neighbors, neighbors + k);
+  const std::vector<double> oldDistances(distances, distances + k);
+
+  size_t a = 0, b = 0;
+  for (size_t i = 0; i < k; ++i)
+  {
+    if (oldDistances[a] <= newDistances[b])
+    {
+      neighbors[i] = oldNeighbors[a];
+      distances[i] = oldDistances[a++];
+    }
+    else
+    {
+      neighbors[i] = newNeighbors[b];
+      distances[i] = newDistances[b++];
+    }
+  }
+}
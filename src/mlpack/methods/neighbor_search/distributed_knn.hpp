@@ -0,0 +1,265 @@
+/**
+ * @file distributed_knn.hpp
+ *
+ * Defines the DistributedKNN class, which splits the reference set into
+ * spatial partitions, each searched with its own kd-tree, and routes each
+ * query only to the partitions which can hold its nearest neighbors.  The
+ * partitions can be held by the processes of an MPI job, so that the reference
+ * set does not have to fit on one machine.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_DISTRIBUTED_KNN_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_DISTRIBUTED_KNN_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/tree/binary_space_tree.hpp>
+
+#include <map>
+#include <vector>
+
+#ifdef MLPACK_HAS_MPI
+  #include <mpi.h>
+#endif
+
+#include "neighbor_search_stat.hpp"
+#include "sort_policies/nearest_neighbor_sort.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Exact Euclidean k-nearest-neighbor search over a reference set which is split
+ * into spatial partitions.
+ *
+ * The partitions are the regions of the top levels of a kd-tree built on a
+ * random sample of the reference set: the node of the tree with the most
+ * sample points is split until there are as many nodes as partitions, and
+ * each reference point belongs to the node it is routed to by descending the
+ * tree, going to the child whose bound is nearer at each level.  Each
+ * partition builds a kd-tree on its points and keeps the bounding box of its
+ * points.
+ *
+ * Queries are searched in blocks.  Each query is first searched in the
+ * partition it belongs to, which gives it k candidate neighbors, and is then
+ * sent to each other partition whose bounding box is nearer than its k'th
+ * candidate.  The results of all of the partitions are merged, so the final
+ * results are exact.  Since the partitions are spatial, most queries are only
+ * searched in one or two partitions.
+ *
+ * If mlpack was built with MPI (the CMake option USE_MPI), the partitions can
+ * be spread over the processes of an MPI communicator, one partition for each
+ * process.  Each process gives its own part of the reference set (in any
+ * order) to the constructor; the sample is gathered by all of the processes,
+ * which build the same partitioning, and the points are then sent to the
+ * processes of their partitions.  Each process then searches its own part of
+ * the queries: the query blocks are sent to the processes of the partitions
+ * they are routed to, and the results are sent back and merged.  Reference
+ * points are numbered in the order of the processes, so point i of process p
+ * has the index of i plus the number of reference points held by processes 0
+ * through p - 1.  Every MPI message is limited to 2^31 - 1 values, which
+ * limits the number of reference points any process can send to another at
+ * construction time.
+ *
+ * Without MPI, or with the in-process constructor, all of the partitions are
+ * held and searched by this object; this gives the same results, and is
+ * mostly useful for testing.
+ *
+ * The search of each partition is single-tree and runs in parallel with the
+ * number of threads given by Threads(), if mlpack was compiled with OpenMP.
+ */
+class DistributedKNN
+{
+ public:
+  //! The type of tree used for each partition, and for the partitioning.
+  typedef tree::BinarySpaceTree<bound::HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+
+  /**
+   * Split the given reference set into the given number of partitions, all of
+   * which are held by this object.  The reference set is copied into the
+   * partitions.
+   *
+   * @param referenceSet Set of reference points.
+   * @param numPartitions Number of partitions.
+   * @param sampleSize Number of points to sample to build the partitioning.
+   * @param leafSize Leaf size of the kd-tree of each partition.
+   */
+  DistributedKNN(const arma::mat& referenceSet,
+                 const size_t numPartitions,
+                 const size_t sampleSize = 10000,
+                 const size_t leafSize = 20);
+
+#ifdef MLPACK_HAS_MPI
+  /**
+   * Split the reference set held by all of the processes of the given
+   * communicator into one partition for each process.  This must be called by
+   * every process of the communicator (it is collective), and so must every
+   * call to Search().
+   *
+   * @param localReferenceSet The reference points of this process.
+   * @param communicator The communicator of the processes.
+   * @param sampleSize Number of points to sample (over all of the processes)
+   *     to build the partitioning.
+   * @param leafSize Leaf size of the kd-tree of each partition.
+   */
+  DistributedKNN(const arma::mat& localReferenceSet,
+                 MPI_Comm communicator,
+                 const size_t sampleSize = 10000,
+                 const size_t leafSize = 20);
+#endif
+
+  //! Delete the trees.
+  ~DistributedKNN();
+
+  /**
+   * Find the k nearest neighbors of each query point.  With MPI, each process
+   * gives its own query points, and gets the results of its own query points,
+   * with the global indices of the reference points.  Neighbors which could
+   * not be found (if k is larger than the reference set) have the index
+   * (size_t() - 1) and the distance DBL_MAX.
+   *
+   * @param querySet Set of query points.
+   * @param k Number of neighbors to search for.
+   * @param neighbors Matrix to store the neighbor indices in (k x queries).
+   * @param distances Matrix to store the distances in (k x queries).
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances);
+
+  //! Get the number of partitions.
+  size_t NumPartitions() const { return partitionSizes.size(); }
+  //! Get the number of reference points in the given partition.
+  size_t PartitionSize(const size_t partition) const
+  { return partitionSizes[partition]; }
+  //! Get the bounding box of the points of the given partition.
+  const bound::HRectBound<2>& PartitionBound(const size_t partition) const
+  { return partitionBounds[partition]; }
+
+  //! Get the index of the partition the given point belongs to.
+  size_t Partition(const arma::vec& point) const;
+
+  //! Get the total number of reference points.
+  size_t NumReferences() const { return numReferences; }
+  //! Get the global index of the first reference point of this process (0
+  //! without MPI).
+  size_t ReferenceOffset() const { return referenceOffset; }
+
+  //! Get the number of queries sent to partitions other than their own by the
+  //! last call to Search() (with MPI, the queries of this process only).
+  size_t ExtraSearches() const { return extraSearches; }
+
+  //! Get the number of queries searched at once.
+  size_t BlockSize() const { return blockSize; }
+  //! Modify the number of queries searched at once.  With MPI, this bounds
+  //! the size of the messages during the search.
+  size_t& BlockSize() { return blockSize; }
+
+  //! Get the number of threads used to search each partition (0 means all
+  //! available threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used to search each partition (0 means all
+  //! available threads).  This has no effect if mlpack was compiled without
+  //! OpenMP.
+  size_t& Threads() { return threads; }
+
+ private:
+  //! The points of a partition, with the kd-tree built on them.
+  struct LocalPartition
+  {
+    LocalPartition() : tree(NULL) { }
+
+    //! The points, in the order of the tree.
+    arma::mat points;
+    //! The global index of each point.
+    std::vector<size_t> indices;
+    //! The tree (NULL if the partition is not held by this process).
+    TreeType* tree;
+  };
+
+  //! The sample the partitioning is built on.
+  arma::mat sample;
+  //! The kd-tree of the sample; its top levels are the partitioning.
+  TreeType* sampleTree;
+  //! The partition of each node of the sample tree which is a partition.
+  std::map<const TreeType*, size_t> nodePartitions;
+
+  //! The partitions held by this process (all of them without MPI).
+  std::vector<LocalPartition> partitions;
+  //! The number of points of each partition.
+  std::vector<size_t> partitionSizes;
+  //! The bounding box of the points of each partition.
+  std::vector<bound::HRectBound<2> > partitionBounds;
+
+  //! The total number of reference points.
+  size_t numReferences;
+  //! The global index of the first reference point of this process.
+  size_t referenceOffset;
+  //! The leaf size of the kd-trees.
+  size_t leafSize;
+  //! The number of queries searched at once.
+  size_t blockSize;
+  //! The number of threads to use (0 means all available).
+  size_t threads;
+  //! The number of queries sent to partitions other than their own.
+  size_t extraSearches;
+
+  //! Whether the partitions are spread over MPI processes.
+  bool distributed;
+#ifdef MLPACK_HAS_MPI
+  //! The communicator of the processes.
+  MPI_Comm communicator;
+#endif
+  //! The rank of this process (0 without MPI).
+  size_t rank;
+
+  /**
+   * Build the partitioning from the sample: split the largest node of the
+   * sample tree until there are numPartitions nodes (or no node can be split).
+   */
+  void BuildPartitioning(const size_t numPartitions);
+
+  //! Build the tree of a partition on its points, and map the indices of the
+  //! points to the order of the tree.
+  void BuildPartitionTree(LocalPartition& partition);
+
+  /**
+   * Search the given queries in a partition held by this process.  The results
+   * have the global indices of the reference points.
+   */
+  void SearchPartition(const LocalPartition& partition,
+                       const arma::mat& queries,
+                       const size_t k,
+                       arma::Mat<size_t>& neighbors,
+                       arma::mat& distances) const;
+
+  /**
+   * Search each query in the partitions it is routed to, and merge the results
+   * into the results of the query.
+   *
+   * @param queries The block of queries.
+   * @param routes The indices of the queries to search in each partition.
+   * @param k Number of neighbors.
+   * @param neighbors Results of the block, to merge into.
+   * @param distances Distances of the block, to merge into.
+   */
+  void SearchRouted(const arma::mat& queries,
+                    const std::vector<std::vector<size_t> >& routes,
+                    const size_t k,
+                    arma::Mat<size_t>& neighbors,
+                    arma::mat& distances);
+
+  /**
+   * Merge two sorted lists of k neighbors into the first.
+   */
+  static void MergeNeighbors(size_t* neighbors,
+                             double* distances,
+                             const size_t* newNeighbors,
+                             const double* newDistances,
+                             const size_t k);
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
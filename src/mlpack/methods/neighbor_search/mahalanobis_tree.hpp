@@ -0,0 +1,52 @@
+/**
+ * @file mahalanobis_tree.hpp
+ *
+ * Build a tree for neighbor search with a Mahalanobis distance (such as one
+ * learned by NCA) in the space transformed by the distance, so that the search
+ * can use the Euclidean distance.
+ */
+#ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_MAHALANOBIS_TREE_HPP
+#define __MLPACK_METHODS_NEIGHBOR_SEARCH_MAHALANOBIS_TREE_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/mahalanobis_distance.hpp>
+
+#include "neighbor_search.hpp"
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Transform the given dataset with the given Mahalanobis distance (see
+ * metric::MahalanobisDistance::Transform()) and build a tree on the transformed
+ * points.  Searching the tree with the Euclidean distance then gives the
+ * neighbors under the Mahalanobis distance, and each distance evaluation
+ * during the search takes O(d) time instead of O(d^2).  The query set must be
+ * transformed by the same distance; the distances returned by the search are
+ * the rooted Mahalanobis distances.
+ *
+ * The tree holds a reference to the transformed dataset, which must outlive it.
+ * If the tree rearranges the dataset, the transformed dataset is rearranged and
+ * oldFromNew is filled with the mappings; otherwise oldFromNew is not modified.
+ *
+ * @param distance Mahalanobis distance to transform the dataset with.
+ * @param data Dataset to transform.
+ * @param transformed Matrix to store the transformed dataset in.
+ * @param oldFromNew Vector to store the mappings of the points in.
+ * @return The new tree, which the caller must delete.
+ */
+template<typename TreeType, bool TakeRoot>
+TreeType* BuildMahalanobisTree(
+    const metric::MahalanobisDistance<TakeRoot>& distance,
+    const arma::mat& data,
+    arma::mat& transformed,
+    std::vector<size_t>& oldFromNew)
+{
+  distance.Transform(data, transformed);
+  return BuildTree<TreeType>(transformed, oldFromNew);
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
@@ -14,6 +14,8 @@
 
 #include <mlpack/core/tree/binary_space_tree.hpp>
 #include <mlpack/core/tree/rectangle_tree.hpp>
+#include <mlpack/core/tree/instrumented_rules.hpp>
+#include <mlpack/core/tree/priority_single_tree_traverser.hpp>
 
 #include <mlpack/core/metrics/lmetric.hpp>
 #include "neighbor_search_stat.hpp"
@@ -41,11 +43,21 @@ namespace neighbor /** Neighbor-search routines.  These include
  * @tparam SortPolicy The sort policy for distances; see NearestNeighborSort.
  * @tparam MetricType The metric to use for computation.
  * @tparam TreeType The tree type to use.
+ * @tparam InstrumentationType Policy to record details of the tree traversals
+ *     with; see tree::TraversalInstrumentation.  The default records nothing.
+ * @tparam DualTreeTraversalType The dual-tree traverser to use; the default is
+ *     the depth-first DualTreeTraverser of the tree type.  For k-nearest
+ *     neighbor search with small k, the best-first
+ *     TreeType::BestFirstDualTreeTraverser (available for binary space trees
+ *     and cover trees) may compute fewer base cases.
  */
 template<typename SortPolicy = NearestNeighborSort,
          typename MetricType = mlpack::metric::SquaredEuclideanDistance,
          typename TreeType = tree::BinarySpaceTree<bound::HRectBound<2>,
-             NeighborSearchStat<SortPolicy> > >
+             NeighborSearchStat<SortPolicy> >,
+         typename InstrumentationType = tree::NoTraversalInstrumentation,
+         template<typename RuleType> class DualTreeTraversalType =
+             TreeType::template DualTreeTraverser>
 class NeighborSearch
 {
  public:
@@ -57,8 +69,11 @@ class NeighborSearch
    * (i.e. the distance::MahalanobisDistance class).
    *
    * This method will copy the matrices to internal copies, which are rearranged
-   * during tree-building.  You can avoid this extra copy by pre-constructing
-   * the trees and passing them using a diferent constructor.
+   * during tree-building.  The copies are made in naive and single-tree mode
+   * too, so the given matrices do not have to outlive this object.  You can
+   * avoid this extra copy by pre-constructing the trees and passing them using
+   * a diferent constructor, or by letting the trees rearrange the given
+   * matrices in place, with the constructor which takes the permutations.
    *
    * @param referenceSet Set of reference points.
    * @param querySet Set of query points.
@@ -101,6 +116,58 @@ class NeighborSearch
                  const bool singleMode = false,
                  const MetricType metric = MetricType());
 
+  /**
+   * Initialize the NeighborSearch object, building the trees on the given
+   * datasets themselves instead of on copies of them.  Tree-building rearranges
+   * the points of the matrices in place, so no copy of either dataset is ever
+   * made; this is the constructor to use for datasets which are too large to
+   * be held twice.  The permutations made by tree-building are stored in
+   * oldFromNewReferences and oldFromNewQueries (point i of the rearranged
+   * matrix was point oldFromNew[i] of the given matrix), so the caller can
+   * still find its points; the results of Search() are given in terms of the
+   * original indices, as with the other constructors.
+   *
+   * The matrices must not be modified or destroyed while this object exists.
+   * If singleMode is true, no query tree is built, so the query set is not
+   * rearranged; for trees which do not rearrange their dataset (see
+   * TreeTraits::RearrangesDataset), neither matrix is.  In both cases the
+   * permutation given back is the identity.  Naive mode is not available as an
+   * option for this constructor, since naive search builds no trees.
+   *
+   * @param referenceSet Set of reference points; rearranged in place.
+   * @param querySet Set of query points; rearranged in place.
+   * @param oldFromNewReferences Filled with the permutation of the reference
+   *      points.
+   * @param oldFromNewQueries Filled with the permutation of the query points.
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  NeighborSearch(typename TreeType::Mat& referenceSet,
+                 typename TreeType::Mat& querySet,
+                 std::vector<size_t>& oldFromNewReferences,
+                 std::vector<size_t>& oldFromNewQueries,
+                 const bool singleMode = false,
+                 const MetricType metric = MetricType());
+
+  /**
+   * Initialize the NeighborSearch object with one dataset, which is used as
+   * both the query and the reference dataset, building the tree on the dataset
+   * itself instead of on a copy of it.  The points of the matrix are rearranged
+   * in place, and the permutation is stored in oldFromNewReferences; see the
+   * constructor above for details.
+   *
+   * @param referenceSet Set of reference points; rearranged in place.
+   * @param oldFromNewReferences Filled with the permutation of the points.
+   * @param singleMode If true, single-tree search will be used (as opposed to
+   *      dual-tree search).
+   * @param metric An optional instance of the MetricType class.
+   */
+  NeighborSearch(typename TreeType::Mat& referenceSet,
+                 std::vector<size_t>& oldFromNewReferences,
+                 const bool singleMode = false,
+                 const MetricType metric = MetricType());
+
   /**
    * Initialize the NeighborSearch object with the given datasets and
    * pre-constructed trees.  It is assumed that the points in referenceSet and
@@ -182,6 +249,9 @@ class NeighborSearch
    * number of points in the query dataset and k is the number of neighbors
    * being searched for.
    *
+   * If mlpack was compiled with OpenMP, naive, single-tree and dual-tree
+   * search are run in parallel with the number of threads given by Threads().
+   *
    * @param k Number of neighbors to search for.
    * @param resultingNeighbors Matrix storing lists of neighbors for each query
    *     point.
@@ -192,6 +262,33 @@ class NeighborSearch
               arma::Mat<size_t>& resultingNeighbors,
               arma::mat& distances);
 
+  /**
+   * Add the given points to the reference set, so that they are considered by
+   * subsequent calls to Search().  The points are appended to the matrix the
+   * reference tree was built on and then inserted into the tree, so no rebuild
+   * is necessary; the new points get the indices referenceSet.n_cols through
+   * referenceSet.n_cols + points.n_cols - 1.
+   *
+   * This is only possible for trees that support dynamic insertion and do not
+   * rearrange the dataset (i.e. tree::RectangleTree), and only when the
+   * reference tree was passed to the constructor and built on referenceSet.
+   *
+   * @param points Points to add to the reference set.
+   */
+  void Insert(const typename TreeType::Mat& points);
+
+  /**
+   * Remove the reference points with the given indices from the reference
+   * tree, so that they are no longer returned by subsequent calls to Search().
+   * The points stay in the reference set, so the indices of the other
+   * reference points do not change.  The same restrictions as with Insert()
+   * apply.  If no separate query set was given, removed points are still part
+   * of the query set; their columns in the results should be ignored.
+   *
+   * @param indices Indices of reference points to remove.
+   */
+  void Remove(const arma::Col<size_t>& indices);
+
   //! Returns a string representation of this object.
   std::string ToString() const;
 
@@ -206,9 +303,111 @@ class NeighborSearch
   //! Modify the number of node combination scores.
   size_t& Scores() { return scores; }
 
+  //! Get the number of threads used for search (0 means all available
+  //! threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for search (0 means all
+  //! available threads).  This has no effect if mlpack was compiled without
+  //! OpenMP.
+  size_t& Threads() { return threads; }
+
+  //! Get whether naive search offloads its distance computations.
+  bool Offload() const { return offload; }
+  //! Modify whether naive search offloads its distance computations.  If
+  //! true, naive search with the Euclidean (or squared Euclidean) distance
+  //! computes the distances in large tiles, each with one matrix
+  //! multiplication (see util::SquaredDistanceTile()), which are run on a GPU
+  //! if mlpack was built with an accelerator backend (see
+  //! util::AcceleratorAvailable()); the best candidates of each tile are then
+  //! chosen by the threads on the CPU.  This has no effect on tree-based search
+  //! or with other metrics.
+  bool& Offload() { return offload; }
+
+  //! Get whether monochromatic dual-tree search visits each pair of points
+  //! once.
+  bool Symmetric() const { return symmetric; }
+  //! Modify whether monochromatic dual-tree search visits each pair of points
+  //! once.  When there is no separate query set, each pair of nodes is then
+  //! visited only once, each base case offers each point as a candidate of the
+  //! other, and a pair is only pruned if it can improve the candidates of
+  //! neither node, which roughly halves the number of base cases.  This search
+  //! is serial and does not record instrumentation.  It needs trees which hold
+  //! points only in their leaves, so it is not used with trees whose nodes
+  //! share points with their children (i.e. the cover tree).
+  bool& Symmetric() { return symmetric; }
+
+  //! Get the smallest k for which the candidate neighbors are kept in heaps
+  //! during the search (0 means never; the default is 64).
+  size_t HeapThreshold() const { return heapThreshold; }
+  //! Modify the smallest k for which the candidate neighbors are kept in heaps
+  //! during the search (0 means never).  Inserting a candidate into a heap
+  //! takes O(log k) time instead of O(k) for a sorted list, but the lists must
+  //! be sorted at the end, and a candidate which ties with the k'th candidate
+  //! is not inserted, so ties may be broken differently.
+  size_t& HeapThreshold() { return heapThreshold; }
+
+  //! Get the largest number of base cases to evaluate for each query point in
+  //! single-tree search (0 means no limit).
+  size_t MaxBaseCases() const { return maxBaseCases; }
+  //! Modify the largest number of base cases to evaluate for each query point
+  //! in single-tree search (0 means no limit).  If this or TimeLimit() is set,
+  //! single-tree search is an anytime search: the reference tree is traversed
+  //! best-first for each query point (see tree::PrioritySingleTreeTraverser),
+  //! and the traversal stops when the budget runs out, leaving the best
+  //! candidates found so far (slots never filled keep an invalid index).  Use
+  //! Exact() to find which results are guaranteed to be exact.  The budgets
+  //! are not used by naive or dual-tree search.
+  size_t& MaxBaseCases() { return maxBaseCases; }
+
+  //! Get the number of seconds to spend on each query point in single-tree
+  //! search (0 means no limit).
+  double TimeLimit() const { return timeLimit; }
+  //! Modify the number of seconds to spend on each query point in single-tree
+  //! search (0 means no limit); see MaxBaseCases().
+  double& TimeLimit() { return timeLimit; }
+
+  //! Get whether the results of every query point of the last search are
+  //! guaranteed to be exact (up to Epsilon()).
+  bool Exact() const { return (inexactQueries == 0); }
+  //! Get whether the results of the given query point of the last search are
+  //! guaranteed to be exact (up to Epsilon()).  They are not if an anytime
+  //! search ran out of budget before it could rule out the rest of the tree.
+  bool Exact(const size_t queryIndex) const
+  {
+    return exactQueries.empty() || (exactQueries[queryIndex] != 0);
+  }
+
+  //! Get the allowed relative error of the neighbor distances (0 means exact
+  //! search).
+  double Epsilon() const { return epsilon; }
+  //! Modify the allowed relative error of the neighbor distances.  With an
+  //! epsilon greater than 0, tree-based search returns neighbors whose
+  //! distances are within a factor of (1 + epsilon) of the true distances (or
+  //! (1 - epsilon) for furthest neighbor search), which prunes many more nodes.
+  //! Naive search is always exact.
+  double& Epsilon() { return epsilon; }
+
+  //! Get whether each NUMA node searches its own copy of the reference tree.
+  bool ReplicateReference() const { return replicateReference; }
+  //! Modify whether each NUMA node searches its own copy of the reference
+  //! tree.  If this is true, and a parallel single-tree or dual-tree search
+  //! runs on a machine with more than one NUMA node, the first thread on each
+  //! node copies the reference tree and reference set, so that the threads of
+  //! the node read them from local memory instead of over the interconnect.
+  //! The copies are made at the start of each search and deleted at its end,
+  //! so this is only worthwhile for reference sets which are small compared to
+  //! the work of the search.  Trees which cannot be copied to another dataset
+  //! (see TreeTraits::CanCopyToDataset) are not copied.
+  bool& ReplicateReference() { return replicateReference; }
+
+  //! Get the details of the tree traversals recorded during searches.
+  const InstrumentationType& Instrumentation() const { return instrumentation; }
+  //! Modify the details of the tree traversals (i.e. to reset them).
+  InstrumentationType& Instrumentation() { return instrumentation; }
+
  private:
   //! Copy of reference dataset (if we need it, because tree building modifies
-  //! it).
+  //! it and the caller did not let it be modified in place).
   typename TreeType::Mat referenceCopy;
   //! Copy of query dataset (if we need it, because tree building modifies it).
   typename TreeType::Mat queryCopy;
@@ -246,6 +445,247 @@ class NeighborSearch
   //! The total number of scores (applicable for non-naive search).
   size_t scores;
 
+  //! The number of threads to use for search (0 means all available).
+  size_t threads;
+
+  //! If true, naive search offloads its distance computations.
+  bool offload;
+
+  //! The allowed relative error for approximate search.
+  double epsilon;
+
+  //! The smallest k for which heaps of candidates are used (0 means never).
+  size_t heapThreshold;
+
+  //! If true, monochromatic dual-tree search visits each pair of points once.
+  bool symmetric;
+
+  //! If true, each NUMA node searches its own copy of the reference tree.
+  bool replicateReference;
+  //! The copies of the reference set for each NUMA node (during a search).
+  std::vector<typename TreeType::Mat*> replicaSets;
+  //! The copies of the reference tree for each NUMA node (during a search).
+  std::vector<TreeType*> replicaTrees;
+
+  //! The largest number of base cases for each query point (0 is no limit).
+  size_t maxBaseCases;
+  //! The time limit for each query point in seconds (0 is no limit).
+  double timeLimit;
+  //! Whether the results of each query point of the last search are exact
+  //! (empty if no budget was used).
+  std::vector<char> exactQueries;
+  //! The number of query points of the last search with inexact results.
+  size_t inexactQueries;
+
+  //! The details of the tree traversals.
+  InstrumentationType instrumentation;
+
+  /**
+   * Perform the dual-tree search in parallel.  The query tree is split near
+   * its root into a set of disjoint subtrees, and each of those is traversed
+   * against the entire reference tree as an independent task with its own
+   * NeighborSearchRules object.  Because the query subtrees hold disjoint sets
+   * of points, no two tasks ever write to the same column of the output
+   * matrices, and the results are identical to the serial search.
+   *
+   * @param neighbors Matrix to store neighbor indices in (already sized).
+   * @param distances Matrix to store neighbor distances in (already sized).
+   * @param numThreads Number of threads to use.
+   * @param heap Whether to keep the candidates in heaps.
+   */
+  void ParallelDualTreeSearch(arma::Mat<size_t>& neighbors,
+                              arma::mat& distances,
+                              const size_t numThreads,
+                              const bool heap);
+
+  /**
+   * Prepare a copy of the reference tree for each NUMA node, if
+   * ReplicateReference() is set, the search uses more than one thread, and the
+   * machine has more than one NUMA node.  The copies are made by
+   * LocalReferenceTree().
+   *
+   * @param numThreads Number of threads the search uses.
+   */
+  void ReplicateReferenceTree(const size_t numThreads);
+
+  /**
+   * Get the copy of the reference tree for the NUMA node of the calling thread
+   * (making it, if this is the first thread of the node to ask), or the
+   * reference tree itself if there are no copies.  This is called from inside
+   * the parallel region of a search.
+   *
+   * @param localSet Set to the reference set the returned tree refers to.
+   */
+  TreeType* LocalReferenceTree(const typename TreeType::Mat*& localSet);
+
+  //! Delete the copies of the reference tree.
+  void ClearReplicas();
+
+  /**
+   * Perform the naive search in parallel: every query point is compared with
+   * every reference point by the base cases of its own NeighborSearchRules
+   * object, and the query points are split between the threads.
+   *
+   * @param metric Instantiated metric.
+   * @param queries Query dataset.
+   * @param references Reference dataset.
+   * @param neighbors Matrix to store neighbor indices in (already sized).
+   * @param distances Matrix to store neighbor distances in (already sized).
+   * @param numThreads Number of threads to use.
+   * @param heap Whether to keep the candidates in heaps.
+   */
+  template<typename MT, typename MatType>
+  void NaiveSearch(MT& metric,
+                   const MatType& queries,
+                   const MatType& references,
+                   arma::Mat<size_t>& neighbors,
+                   arma::mat& distances,
+                   const size_t numThreads,
+                   const bool heap);
+
+  /**
+   * Perform the naive search for the Euclidean distance (and the squared
+   * Euclidean distance) with matrix multiplications.  The query points are
+   * split into blocks, which are shared between the threads; the distances
+   * between a block of query points and a block of reference points are
+   * computed at once with the ||a||^2 + ||b||^2 - 2 a^T b expansion (one GEMM
+   * call), and the best k of each block are merged into the results.  The
+   * blocks are small enough that the block of distances stays in cache.
+   *
+   * The expansion is computed on centered copies of the points, but it still
+   * loses precision for points that are close together, so the distances of
+   * the chosen neighbors are computed again directly.  Only candidates whose
+   * distances differ by less than the rounding error of the expansion can be
+   * chosen in a different order than the base cases would choose them.
+   *
+   * @param metric Instantiated metric (not used).
+   * @param queries Query dataset.
+   * @param references Reference dataset.
+   * @param neighbors Matrix to store neighbor indices in (already sized).
+   * @param distances Matrix to store neighbor distances in (already sized).
+   * @param numThreads Number of threads to use.
+   * @param heap Whether to keep the candidates in heaps.
+   */
+  template<bool TakeRoot>
+  void NaiveSearch(metric::LMetric<2, TakeRoot>& metric,
+                   const arma::mat& queries,
+                   const arma::mat& references,
+                   arma::Mat<size_t>& neighbors,
+                   arma::mat& distances,
+                   const size_t numThreads,
+                   const bool heap);
+
+  /**
+   * Perform the naive search for the Euclidean distance (and the squared
+   * Euclidean distance) in the large tiles of util::SquaredDistanceTile(), so
+   * that the matrix multiplications can be offloaded to an accelerator (see
+   * Offload()).  Each tile holds the distances between as many query points
+   * and reference points as fit in util::DefaultTileBytes; its matrix
+   * multiplication is done by one call, and the best k of each column are
+   * then merged into the results by the threads.  The distances of the chosen
+   * neighbors are computed again directly, as in the blocked CPU search.
+   *
+   * @param queries Query dataset.
+   * @param references Reference dataset.
+   * @param neighbors Matrix to store neighbor indices in (already sized).
+   * @param distances Matrix to store neighbor distances in (already sized).
+   * @param numThreads Number of threads to use.
+   * @param heap Whether to keep the candidates in heaps.
+   */
+  template<bool TakeRoot>
+  void OffloadSearch(const arma::mat& queries,
+                     const arma::mat& references,
+                     arma::Mat<size_t>& neighbors,
+                     arma::mat& distances,
+                     const size_t numThreads,
+                     const bool heap);
+
+  /**
+   * Offer the reference points of one column of a block of squared distances
+   * as candidate neighbors of the given query point.
+   *
+   * @param blockDist Squared distances to the reference points.
+   * @param n Number of reference points in the block.
+   * @param referenceBegin Index of the first reference point of the block.
+   * @param query Index of the query point.
+   * @param sameSet Whether the query set is the reference set (so the query
+   *     point is not its own neighbor).
+   * @param neighbors Matrix of neighbor indices.
+   * @param distances Matrix of neighbor distances.
+   * @param heap Whether the candidates are kept in heaps.
+   */
+  void InsertBlockCandidates(const double* blockDist,
+                             const size_t n,
+                             const size_t referenceBegin,
+                             const size_t query,
+                             const bool sameSet,
+                             arma::Mat<size_t>& neighbors,
+                             arma::mat& distances,
+                             const bool heap);
+
+  /**
+   * Compute the distances of the chosen neighbors of the given query point
+   * again directly (the expansion used by the blocked searches loses
+   * precision), and put them back in order (heaps are sorted by Search()).
+   * Slots that were never filled stay at the end.
+   */
+  template<bool TakeRoot>
+  void RefineCandidates(const arma::mat& queries,
+                        const arma::mat& references,
+                        const size_t query,
+                        arma::Mat<size_t>& neighbors,
+                        arma::mat& distances,
+                        const bool heap);
+
+  /**
+   * Run the monochromatic dual-tree search on the given pair of nodes, which
+   * must either be the same node or hold disjoint sets of points, so that each
+   * unordered pair of points is visited once (see Symmetric()).  The first
+   * bound of each node's statistic holds the worst k'th candidate distance of
+   * its descendants, and is brought up to date before returning.
+   *
+   * @param a First node.
+   * @param b Second node.
+   * @param rules Rules used for the base cases.
+   */
+  template<typename RuleType>
+  void SymmetricTraverse(TreeType& a, TreeType& b, RuleType& rules);
+
+  /**
+   * Set the first bound of the given node's statistic to the worst k'th
+   * candidate distance of its points and the first bounds of its children.
+   *
+   * @param node Node to update.
+   * @param rules Rules holding the candidates.
+   */
+  template<typename RuleType>
+  void UpdateSymmetricBound(TreeType& node, const RuleType& rules);
+
+  /**
+   * Mark the bounds cached in the statistics of the given node and all of its
+   * descendants as out of date, so that the NeighborSearchRules recalculate
+   * them before they are used.  The bounds are reset to the worst distance,
+   * since bounds left from an earlier search (perhaps with a different k) are
+   * not valid for this one.
+   *
+   * @param node Root of the subtree to mark.
+   */
+  void InvalidateBounds(TreeType& node);
+
+  /**
+   * Make sure the reference tree can be modified by Insert() or Remove();
+   * otherwise, issue a fatal error.
+   *
+   * @param caller Name of the calling function, for the error message.
+   */
+  void CheckDynamicTree(const std::string& caller) const;
+
+  /**
+   * If the query tree is a copy of the reference tree (because no query set
+   * was given), replace it with a new copy after the reference tree changed.
+   */
+  void UpdateQueryTree();
+
 }; // class NeighborSearch
 
 }; // namespace neighbor
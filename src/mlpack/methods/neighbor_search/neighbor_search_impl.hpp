@@ -39,9 +39,95 @@ TreeType* BuildTree(
   return new TreeType(dataset);
 }
 
+//! Give the caller the permutation made by tree-building, or the identity if
+//! the points of the dataset were not moved.
+inline void ExportPermutation(const std::vector<size_t>& oldFromNew,
+                              const size_t n,
+                              std::vector<size_t>& out)
+{
+  if (oldFromNew.size() == n)
+  {
+    out = oldFromNew;
+    return;
+  }
+
+  out.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    out[i] = i;
+}
+
+//! Copy the tree so that the copy refers to the given dataset.
+template<typename TreeType>
+TreeType* CopyTree(
+    const TreeType& tree,
+    typename TreeType::Mat& dataset,
+    typename boost::enable_if_c<
+        tree::TreeTraits<TreeType>::CanCopyToDataset == true, TreeType*
+    >::type = 0)
+{
+  return new TreeType(tree, dataset);
+}
+
+//! Trees which cannot refer to another dataset are not copied.
+template<typename TreeType>
+TreeType* CopyTree(
+    const TreeType& /* tree */,
+    typename TreeType::Mat& /* dataset */,
+    const typename boost::enable_if_c<
+        tree::TreeTraits<TreeType>::CanCopyToDataset == false, TreeType*
+    >::type = 0)
+{
+  return NULL;
+}
+
+/**
+ * Move column i of both matrices to column oldFromNew[i], in place.  This
+ * follows the cycles of the permutation, so only a bit per column and one
+ * column of each matrix are needed as extra storage (instead of a full copy of
+ * both matrices).
+ *
+ * @param neighbors Matrix of neighbor indices to permute.
+ * @param distances Matrix of distances to permute.
+ * @param oldFromNew Mapping from current column to new column.
+ */
+inline void PermuteColumns(arma::Mat<size_t>& neighbors,
+                           arma::mat& distances,
+                           const std::vector<size_t>& oldFromNew)
+{
+  std::vector<bool> done(neighbors.n_cols, false);
+  arma::Col<size_t> neighborTemp(neighbors.n_rows);
+  arma::vec distanceTemp(distances.n_rows);
+
+  for (size_t start = 0; start < neighbors.n_cols; ++start)
+  {
+    if (done[start] || oldFromNew[start] == start)
+      continue;
+
+    // Carry the column around the cycle that starts here, swapping it with the
+    // column at its destination each time.
+    neighborTemp = neighbors.col(start);
+    distanceTemp = distances.col(start);
+    size_t current = start;
+    do
+    {
+      done[current] = true;
+      current = oldFromNew[current];
+      std::swap_ranges(neighborTemp.begin(), neighborTemp.end(),
+          neighbors.colptr(current));
+      std::swap_ranges(distanceTemp.begin(), distanceTemp.end(),
+          distances.colptr(current));
+    } while (current != start);
+  }
+}
+
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::
 NeighborSearch(const typename TreeType::Mat& referenceSetIn,
                const typename TreeType::Mat& querySetIn,
                const bool naive,
@@ -59,7 +145,16 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
     singleMode(!naive && singleMode), // No single mode if naive.
     metric(metric),
     baseCases(0),
-    scores(0)
+    scores(0),
+    threads(0),
+    offload(false),
+    epsilon(0.0),
+    heapThreshold(64),
+    symmetric(false),
+    replicateReference(false),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   // C++11 will allow us to call out to other constructors so we can avoid this
   // copypasta problem.
@@ -67,11 +162,12 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
   // We'll time tree building, but only if we are building trees.
   Timer::Start("tree_building");
 
-  // Copy the datasets, if they will be modified during tree building.
+  // Copy the datasets, if they will be modified during tree building.  The
+  // copies are made by all threads, so they are spread over the NUMA nodes.
   if (tree::TreeTraits<TreeType>::RearrangesDataset)
   {
-    referenceCopy = referenceSetIn;
-    queryCopy = querySetIn;
+    util::FirstTouchCopy(referenceSetIn, referenceCopy);
+    util::FirstTouchCopy(querySetIn, queryCopy);
   }
 
   // If not in naive mode, then we need to build trees.
@@ -94,8 +190,13 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
 }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::
 NeighborSearch(const typename TreeType::Mat& referenceSetIn,
                const bool naive,
                const bool singleMode,
@@ -112,14 +213,24 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
     singleMode(!naive && singleMode), // No single mode if naive.
     metric(metric),
     baseCases(0),
-    scores(0)
+    scores(0),
+    threads(0),
+    offload(false),
+    epsilon(0.0),
+    heapThreshold(64),
+    symmetric(false),
+    replicateReference(false),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   // We'll time tree building, but only if we are building trees.
   Timer::Start("tree_building");
 
-  // Copy the dataset, if it will be modified during tree building.
+  // Copy the dataset, if it will be modified during tree building.  The copy
+  // is made by all threads, so it is spread over the NUMA nodes.
   if (tree::TreeTraits<TreeType>::RearrangesDataset)
-    referenceCopy = referenceSetIn;
+    util::FirstTouchCopy(referenceSetIn, referenceCopy);
 
   // If not in naive mode, then we may need to construct trees.
   if (!naive)
@@ -139,9 +250,107 @@ NeighborSearch(const typename TreeType::Mat& referenceSetIn,
   Timer::Stop("tree_building");
 }
 
+// Construct the object, building the trees on the given datasets in place.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::NeighborSearch(
+    typename TreeType::Mat& referenceSetIn,
+    typename TreeType::Mat& querySetIn,
+    std::vector<size_t>& oldFromNewReferencesOut,
+    std::vector<size_t>& oldFromNewQueriesOut,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(querySetIn),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(true),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    baseCases(0),
+    scores(0),
+    threads(0),
+    offload(false),
+    epsilon(0.0),
+    heapThreshold(64),
+    symmetric(false),
+    replicateReference(false),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
+{
+  Timer::Start("tree_building");
+
+  referenceTree = BuildTree<TreeType>(referenceSetIn, oldFromNewReferences);
+  if (!singleMode)
+    queryTree = BuildTree<TreeType>(querySetIn, oldFromNewQueries);
+
+  ExportPermutation(oldFromNewReferences, referenceSetIn.n_cols,
+      oldFromNewReferencesOut);
+  ExportPermutation(oldFromNewQueries, querySetIn.n_cols, oldFromNewQueriesOut);
+
+  Timer::Stop("tree_building");
+}
+
+// Construct the object, building the tree on the given dataset in place.
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::NeighborSearch(
+    typename TreeType::Mat& referenceSetIn,
+    std::vector<size_t>& oldFromNewReferencesOut,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(referenceSetIn),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(false),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    baseCases(0),
+    scores(0),
+    threads(0),
+    offload(false),
+    epsilon(0.0),
+    heapThreshold(64),
+    symmetric(false),
+    replicateReference(false),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
+{
+  Timer::Start("tree_building");
+
+  referenceTree = BuildTree<TreeType>(referenceSetIn, oldFromNewReferences);
+  if (!singleMode)
+    queryTree = new TreeType(*referenceTree);
+
+  ExportPermutation(oldFromNewReferences, referenceSetIn.n_cols,
+      oldFromNewReferencesOut);
+
+  Timer::Stop("tree_building");
+}
+
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::NeighborSearch(
     TreeType* referenceTree,
     TreeType* queryTree,
     const typename TreeType::Mat& referenceSet,
@@ -158,14 +367,28 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
     singleMode(singleMode),
     metric(metric),
     baseCases(0),
-    scores(0)
+    scores(0),
+    threads(0),
+    offload(false),
+    epsilon(0.0),
+    heapThreshold(64),
+    symmetric(false),
+    replicateReference(false),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   // Nothing else to initialize.
 }
 
 // Construct the object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::NeighborSearch(
     TreeType* referenceTree,
     const typename TreeType::Mat& referenceSet,
     const bool singleMode,
@@ -180,7 +403,16 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
     singleMode(singleMode),
     metric(metric),
     baseCases(0),
-    scores(0)
+    scores(0),
+    threads(0),
+    offload(false),
+    epsilon(0.0),
+    heapThreshold(64),
+    symmetric(false),
+    replicateReference(false),
+    maxBaseCases(0),
+    timeLimit(0.0),
+    inexactQueries(0)
 {
   Timer::Start("tree_building");
 
@@ -195,8 +427,13 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::NeighborSearch(
  * The tree is the only member we may be responsible for deleting.  The others
  * will take care of themselves.
  */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-NeighborSearch<SortPolicy, MetricType, TreeType>::~NeighborSearch()
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::~NeighborSearch()
 {
   if (treeOwner)
   {
@@ -216,47 +453,72 @@ NeighborSearch<SortPolicy, MetricType, TreeType>::~NeighborSearch()
  * Computes the best neighbors and stores them in resultingNeighbors and
  * distances.
  */
-template<typename SortPolicy, typename MetricType, typename TreeType>
-void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::Search(
     const size_t k,
     arma::Mat<size_t>& resultingNeighbors,
     arma::mat& distances)
 {
-  Timer::Start("computing_neighbors");
-
-  // If we have built the trees ourselves, then we will have to map all the
-  // indices back to their original indices when this computation is finished.
-  // To avoid an extra copy, we will store the neighbors and distances in a
-  // separate matrix.
-  arma::Mat<size_t>* neighborPtr = &resultingNeighbors;
-  arma::mat* distancePtr = &distances;
-
-  // Mapping is only necessary if the tree rearranges points.
-  if (tree::TreeTraits<TreeType>::RearrangesDataset)
+  if (epsilon < 0)
   {
-    if (treeOwner && !(singleMode && hasQuerySet))
-      distancePtr = new arma::mat; // Query indices need to be mapped.
-
-    if (treeOwner)
-      neighborPtr = new arma::Mat<size_t>; // All indices need mapping.
+    Log::Fatal << "NeighborSearch::Search(): epsilon must be non-negative (got "
+        << epsilon << ")!" << std::endl;
   }
 
-  // Set the size of the neighbor and distance matrices.
-  neighborPtr->set_size(k, querySet.n_cols);
-  neighborPtr->fill(size_t() - 1);
-  distancePtr->set_size(k, querySet.n_cols);
-  distancePtr->fill(SortPolicy::WorstDistance());
+  Timer::Start("computing_neighbors");
+  const size_t searchBaseCases = baseCases;
+  const size_t searchScores = scores;
+
+  // The results are computed directly in the output matrices.  If we have built
+  // the trees ourselves, the indices are mapped back to the original indices in
+  // place when the computation is finished, so no copy of the results is
+  // needed.
+  resultingNeighbors.set_size(k, querySet.n_cols);
+  resultingNeighbors.fill(size_t() - 1);
+  distances.set_size(k, querySet.n_cols);
+  distances.fill(SortPolicy::WorstDistance());
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
 
   // Create the helper object for the tree traversal.
   typedef NeighborSearchRules<SortPolicy, MetricType, TreeType> RuleType;
-  RuleType rules(referenceSet, querySet, *neighborPtr, *distancePtr, metric);
+  typedef tree::InstrumentedRules<RuleType, InstrumentationType>
+      InstrumentedRuleType;
+
+  // For large k, the candidates are kept in heaps, which are sorted when the
+  // search is finished.
+  const bool heap = (heapThreshold != 0) && (k >= heapThreshold);
+
+  // The rules cache the bounds of each query node in its statistic, and the
+  // cached bounds from an earlier search must not be taken as current.
+  if (!naive && !singleMode)
+    InvalidateBounds(*queryTree);
+
+  // With a budget, single-tree search is an anytime search.
+  const bool anytime = (maxBaseCases != 0) || (timeLimit > 0.0);
+  exactQueries.clear();
+  inexactQueries = 0;
+  if (anytime && !singleMode)
+  {
+    Log::Warn << "NeighborSearch::Search(): budgets are only used by "
+        << "single-tree search; the search will be exact." << std::endl;
+  }
 
   if (naive)
   {
-    // The naive brute-force traversal.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      for (size_t j = 0; j < referenceSet.n_cols; ++j)
-        rules.BaseCase(i, j);
+    // The naive brute-force search.
+    NaiveSearch(metric, querySet, referenceSet, resultingNeighbors, distances,
+        numThreads, heap);
 
     baseCases += querySet.n_cols * referenceSet.n_cols;
   }
@@ -266,12 +528,88 @@ void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
     // If this is the case, it is suggested that you use the naive method.
     Log::Assert(!(referenceTree->IsLeaf()));
 
-    // Create the traverser.
-    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
+    // The query points are split between the threads.  Each thread has its own
+    // rules and traverser; the only thing shared is the output matrices, and
+    // each column of those is only written by one thread.  But if the first
+    // point of each node is the centroid, the rules cache the last distance
+    // evaluation in the reference tree's statistics, so then each thread needs
+    // its own copy of the reference tree.
+    const bool copyTree = (numThreads > 1) &&
+        tree::TreeTraits<TreeType>::FirstPointIsCentroid;
+    size_t totalBaseCases = 0;
+    size_t totalScores = 0;
+    ReplicateReferenceTree(numThreads);
+    if (anytime)
+      exactQueries.assign(querySet.n_cols, 1);
+
+    #pragma omp parallel num_threads(numThreads) \
+        reduction(+:totalBaseCases, totalScores)
+    {
+      const typename TreeType::Mat* localSet;
+      TreeType* localTree = LocalReferenceTree(localSet);
+      TreeType* threadTree = copyTree ? new TreeType(*localTree) : localTree;
+      RuleType rules(*localSet, querySet, resultingNeighbors, distances,
+          metric, epsilon, heap);
+      InstrumentationType threadInstrumentation;
+      InstrumentedRuleType instrumentedRules(rules, threadInstrumentation);
+
+      if (anytime)
+      {
+        // Traverse best-first, so the budget is spent on the best nodes.
+        tree::PrioritySingleTreeTraverser<TreeType, InstrumentedRuleType>
+            traverser(instrumentedRules, maxBaseCases, timeLimit);
+
+        #pragma omp for schedule(dynamic, 16)
+        for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+        {
+          traverser.Traverse(i, *threadTree);
+          exactQueries[i] = traverser.Exact() ? 1 : 0;
+        }
+      }
+      else
+      {
+        // Create the traverser.
+        typename TreeType::template SingleTreeTraverser<InstrumentedRuleType>
+            traverser(instrumentedRules);
+
+        // Now have it traverse for each point.
+        #pragma omp for schedule(dynamic, 16)
+        for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+          traverser.Traverse(i, *threadTree);
+      }
+
+      totalScores += rules.Scores();
+      totalBaseCases += rules.BaseCases();
+
+      #pragma omp critical(neighbor_search_instrumentation)
+      instrumentation.Merge(threadInstrumentation);
+
+      if (copyTree)
+        delete threadTree;
+    }
 
-    // Now have it traverse for each point.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      traverser.Traverse(i, *referenceTree);
+    ClearReplicas();
+    scores += totalScores;
+    baseCases += totalBaseCases;
+
+    Log::Info << totalScores << " node combinations were scored.\n";
+    Log::Info << totalBaseCases << " base cases were calculated.\n";
+
+    if (anytime)
+    {
+      inexactQueries = std::count(exactQueries.begin(), exactQueries.end(), 0);
+      Log::Info << inexactQueries << " query points ran out of budget before "
+          << "their results were exact.\n";
+    }
+  }
+  else if (symmetric && !hasQuerySet &&
+      !tree::TreeTraits<TreeType>::HasSelfChildren)
+  {
+    // Each pair of points is visited once, so the query tree (a copy of the
+    // reference tree) is traversed against itself.
+    RuleType rules(referenceSet, querySet, resultingNeighbors, distances,
+        metric, epsilon, heap);
+    SymmetricTraverse(*queryTree, *queryTree, rules);
 
     scores += rules.Scores();
     baseCases += rules.BaseCases();
@@ -279,10 +617,21 @@ void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
     Log::Info << rules.Scores() << " node combinations were scored.\n";
     Log::Info << rules.BaseCases() << " base cases were calculated.\n";
   }
+  else if ((numThreads > 1) && !tree::TreeTraits<TreeType>::HasSelfChildren)
+  {
+    // The parallel search splits the query tree into disjoint subtrees, which
+    // isn't possible for trees where a node shares its point with its first
+    // child (i.e. the cover tree), so those are always searched serially.
+    ParallelDualTreeSearch(resultingNeighbors, distances, numThreads, heap);
+  }
   else // Dual-tree recursion.
   {
+    RuleType rules(referenceSet, querySet, resultingNeighbors, distances,
+        metric, epsilon, heap);
+    InstrumentedRuleType instrumentedRules(rules, instrumentation);
+
     // Create the traverser.
-    typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
+    DualTreeTraversalType<InstrumentedRuleType> traverser(instrumentedRules);
 
     traverser.Traverse(*queryTree, *referenceTree);
 
@@ -293,82 +642,697 @@ void NeighborSearch<SortPolicy, MetricType, TreeType>::Search(
     Log::Info << rules.BaseCases() << " base cases were calculated.\n";
   }
 
+  if (heap)
+  {
+    #pragma omp parallel for num_threads(numThreads)
+    for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+      SortCandidates<SortPolicy>(distances.colptr(i),
+          resultingNeighbors.colptr(i), k);
+  }
+
+  Metric::Add("neighbor_search/base_cases", baseCases - searchBaseCases);
+  Metric::Add("neighbor_search/scores", scores - searchScores);
   Timer::Stop("computing_neighbors");
 
   // Now, do we need to do mapping of indices?
   if (!treeOwner || !tree::TreeTraits<TreeType>::RearrangesDataset)
+    return; // No mapping needed.  We are done.
+
+  // Map indices of neighbors (leaving slots that were never filled alone).
+  #pragma omp parallel for num_threads(numThreads)
+  for (omp_size_t i = 0; i < (omp_size_t) resultingNeighbors.n_elem; ++i)
+    if (resultingNeighbors[i] < oldFromNewReferences.size())
+      resultingNeighbors[i] = oldFromNewReferences[resultingNeighbors[i]];
+
+  // Move each query point's results to the query point's original column.  In
+  // single-tree mode with a query set, no query tree was built.
+  if (!hasQuerySet)
   {
-    // No mapping needed.  We are done.
-    return;
+    PermuteColumns(resultingNeighbors, distances, oldFromNewReferences);
+
+    if (!exactQueries.empty())
+    {
+      std::vector<char> mappedExact(exactQueries.size());
+      for (size_t i = 0; i < exactQueries.size(); ++i)
+        mappedExact[oldFromNewReferences[i]] = exactQueries[i];
+      exactQueries.swap(mappedExact);
+    }
   }
-  else if (treeOwner && hasQuerySet && !singleMode) // Map both sets.
+  else if (!singleMode)
   {
-    // Set size of output matrices correctly.
-    resultingNeighbors.set_size(k, querySet.n_cols);
-    distances.set_size(k, querySet.n_cols);
+    PermuteColumns(resultingNeighbors, distances, oldFromNewQueries);
+  }
+} // Search
 
-    for (size_t i = 0; i < distances.n_cols; i++)
-    {
-      // Map distances (copy a column).
-      distances.col(oldFromNewQueries[i]) = distancePtr->col(i);
 
-      // Map indices of neighbors.
-      for (size_t j = 0; j < distances.n_rows; j++)
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::ParallelDualTreeSearch(
+    arma::Mat<size_t>& neighbors,
+    arma::mat& distances,
+    const size_t numThreads,
+    const bool heap)
+{
+  typedef NeighborSearchRules<SortPolicy, MetricType, TreeType> RuleType;
+  typedef tree::InstrumentedRules<RuleType, InstrumentationType>
+      InstrumentedRuleType;
+
+  // Expand the top of the query tree breadth-first until we have enough tasks
+  // that the dynamic schedule can balance subtrees of uneven size.
+  const size_t minTasks = 8 * numThreads;
+  std::vector<TreeType*> tasks;
+  tasks.push_back(queryTree);
+  bool expanded = true;
+  while (expanded && (tasks.size() < minTasks))
+  {
+    expanded = false;
+    std::vector<TreeType*> nextTasks;
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+      if (tasks[i]->IsLeaf())
       {
-        resultingNeighbors(j, oldFromNewQueries[i]) =
-            oldFromNewReferences[(*neighborPtr)(j, i)];
+        nextTasks.push_back(tasks[i]);
+        continue;
       }
+
+      for (size_t c = 0; c < tasks[i]->NumChildren(); ++c)
+        nextTasks.push_back(&tasks[i]->Child(c));
+      expanded = true;
     }
 
-    // Finished with temporary matrices.
-    delete neighborPtr;
-    delete distancePtr;
+    tasks.swap(nextTasks);
   }
-  else if (treeOwner && !hasQuerySet)
+
+  // Each task gets its own rules (and thus its own traversal info and base
+  // case cache).  The only shared state is the output matrices, and each query
+  // point is owned by exactly one task.
+  size_t totalBaseCases = 0;
+  size_t totalScores = 0;
+  ReplicateReferenceTree(numThreads);
+
+  #pragma omp parallel num_threads(numThreads) \
+      reduction(+:totalBaseCases, totalScores)
   {
-    resultingNeighbors.set_size(k, querySet.n_cols);
-    distances.set_size(k, querySet.n_cols);
+    const typename TreeType::Mat* localSet;
+    TreeType* localTree = LocalReferenceTree(localSet);
 
-    for (size_t i = 0; i < distances.n_cols; i++)
+    #pragma omp for schedule(dynamic)
+    for (omp_size_t i = 0; i < (omp_size_t) tasks.size(); ++i)
     {
-      // Map distances (copy a column).
-      distances.col(oldFromNewReferences[i]) = distancePtr->col(i);
+      RuleType rules(*localSet, querySet, neighbors, distances, metric,
+          epsilon, heap);
+      InstrumentationType taskInstrumentation;
+      InstrumentedRuleType instrumentedRules(rules, taskInstrumentation);
+      DualTreeTraversalType<InstrumentedRuleType> traverser(instrumentedRules);
 
-      // Map indices of neighbors.
-      for (size_t j = 0; j < distances.n_rows; j++)
-      {
-        resultingNeighbors(j, oldFromNewReferences[i]) =
-            oldFromNewReferences[(*neighborPtr)(j, i)];
-      }
+      traverser.Traverse(*tasks[i], *localTree);
+
+      totalBaseCases += rules.BaseCases();
+      totalScores += rules.Scores();
+
+      #pragma omp critical(neighbor_search_instrumentation)
+      instrumentation.Merge(taskInstrumentation);
+    }
+  }
+
+  ClearReplicas();
+  scores += totalScores;
+  baseCases += totalBaseCases;
+
+  Log::Info << totalScores << " node combinations were scored.\n";
+  Log::Info << totalBaseCases << " base cases were calculated.\n";
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::ReplicateReferenceTree(
+    const size_t numThreads)
+{
+  if (!replicateReference || (numThreads < 2) ||
+      !tree::TreeTraits<TreeType>::CanCopyToDataset)
+    return;
+
+  const size_t nodes = util::NUMANodes();
+  if (nodes < 2)
+    return;
+
+  // The copies are made by the first thread which asks for one on each node.
+  replicaSets.assign(nodes, NULL);
+  replicaTrees.assign(nodes, NULL);
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+TreeType* NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::LocalReferenceTree(
+    const typename TreeType::Mat*& localSet)
+{
+  if (replicaTrees.empty())
+  {
+    localSet = &referenceSet;
+    return referenceTree;
+  }
+
+  const size_t node = std::min(util::CurrentNUMANode(),
+      replicaTrees.size() - 1);
+
+  // The thread which makes the copy of a node writes all of its memory, so the
+  // copy is placed on that node.  Copies are only made of small trees, so the
+  // other threads can afford to wait for it.
+  #pragma omp critical(neighbor_search_replicas)
+  {
+    if (replicaTrees[node] == NULL)
+    {
+      replicaSets[node] = new typename TreeType::Mat(referenceSet);
+      replicaTrees[node] = CopyTree(*referenceTree, *replicaSets[node]);
     }
+  }
+
+  localSet = replicaSets[node];
+  return replicaTrees[node];
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::ClearReplicas()
+{
+  for (size_t i = 0; i < replicaTrees.size(); ++i)
+  {
+    delete replicaTrees[i];
+    delete replicaSets[i];
+  }
+
+  replicaTrees.clear();
+  replicaSets.clear();
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+template<typename MT, typename MatType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::NaiveSearch(
+    MT& /* metric */,
+    const MatType& queries,
+    const MatType& references,
+    arma::Mat<size_t>& neighbors,
+    arma::mat& distances,
+    const size_t numThreads,
+    const bool heap)
+{
+  typedef NeighborSearchRules<SortPolicy, MetricType, TreeType> RuleType;
+
+  // Each thread has its own rules, and each column of the output matrices is
+  // only written by the thread that owns the query point.
+  #pragma omp parallel num_threads(numThreads)
+  {
+    RuleType rules(referenceSet, querySet, neighbors, distances, metric, 0.0,
+        heap);
 
-    // Finished with temporary matrices.
-    delete neighborPtr;
-    delete distancePtr;
+    #pragma omp for schedule(dynamic, 16)
+    for (omp_size_t i = 0; i < (omp_size_t) queries.n_cols; ++i)
+      for (size_t j = 0; j < references.n_cols; ++j)
+        rules.BaseCase(i, j);
   }
-  else if (treeOwner && hasQuerySet && singleMode) // Map only references.
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+template<bool TakeRoot>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::NaiveSearch(
+    metric::LMetric<2, TakeRoot>& /* metric */,
+    const arma::mat& queries,
+    const arma::mat& references,
+    arma::Mat<size_t>& neighbors,
+    arma::mat& distances,
+    const size_t numThreads,
+    const bool heap)
+{
+  if (offload)
+  {
+    OffloadSearch<TakeRoot>(queries, references, neighbors, distances,
+        numThreads, heap);
+    return;
+  }
+
+  // The block of distances between 128 query points and 512 reference points
+  // takes 512kB.
+  const size_t queryBlockSize = 128;
+  const size_t referenceBlockSize = 512;
+
+  const bool sameSet = (&queries == &references);
+
+  // The distances do not change if both sets are moved by the same amount, so
+  // center them on the reference set; the smaller the norms, the less
+  // precision the expansion loses.
+  const arma::vec center = arma::mean(references, 1);
+  arma::mat centeredReferences = references;
+  centeredReferences.each_col() -= center;
+  const arma::rowvec referenceNorms = arma::sum(
+      arma::square(centeredReferences), 0);
+
+  const size_t numQueryBlocks = (queries.n_cols + queryBlockSize - 1) /
+      queryBlockSize;
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t b = 0; b < (omp_size_t) numQueryBlocks; ++b)
   {
-    // Set size of neighbor indices matrix correctly.
-    resultingNeighbors.set_size(k, querySet.n_cols);
+    const size_t queryBegin = b * queryBlockSize;
+    const size_t queryEnd = std::min(queryBegin + queryBlockSize,
+        (size_t) queries.n_cols);
+
+    arma::mat queryBlock = queries.cols(queryBegin, queryEnd - 1);
+    queryBlock.each_col() -= center;
+    const arma::rowvec queryNorms = arma::sum(arma::square(queryBlock), 0);
 
-    // Map indices of neighbors.
-    for (size_t i = 0; i < resultingNeighbors.n_cols; i++)
+    // block(i, j) is the squared distance between reference point
+    // referenceBegin + i and query point queryBegin + j.
+    arma::mat block;
+    for (size_t referenceBegin = 0; referenceBegin < references.n_cols;
+         referenceBegin += referenceBlockSize)
     {
-      for (size_t j = 0; j < resultingNeighbors.n_rows; j++)
-      {
-        resultingNeighbors(j, i) = oldFromNewReferences[(*neighborPtr)(j, i)];
-      }
+      const size_t referenceEnd = std::min(referenceBegin + referenceBlockSize,
+          (size_t) references.n_cols);
+
+      block = -2.0 * centeredReferences.cols(referenceBegin,
+          referenceEnd - 1).t() * queryBlock;
+      block.each_col() += referenceNorms.subvec(referenceBegin,
+          referenceEnd - 1).t();
+      block.each_row() += queryNorms;
+
+      // The squared distances are in the same order as the distances, so the
+      // root (if any) is left until the end.
+      for (size_t j = 0; j < block.n_cols; ++j)
+        InsertBlockCandidates(block.colptr(j), block.n_rows, referenceBegin,
+            queryBegin + j, sameSet, neighbors, distances, heap);
     }
 
-    // Finished with temporary matrix.
-    delete neighborPtr;
+    for (size_t query = queryBegin; query < queryEnd; ++query)
+      RefineCandidates<TakeRoot>(queries, references, query, neighbors,
+          distances, heap);
+  }
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+template<bool TakeRoot>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::OffloadSearch(
+    const arma::mat& queries,
+    const arma::mat& references,
+    arma::Mat<size_t>& neighbors,
+    arma::mat& distances,
+    const size_t numThreads,
+    const bool heap)
+{
+  const bool sameSet = (&queries == &references);
+
+  // Center both sets on the reference set, as the blocked search does.
+  const arma::vec center = arma::mean(references, 1);
+  arma::mat centeredReferences = references;
+  centeredReferences.each_col() -= center;
+  arma::rowvec referenceNorms = arma::sum(arma::square(centeredReferences), 0);
+
+  // A tile holds all of the reference points if they fit with at least 256
+  // query points, and as many query points as fit with them.
+  const size_t referenceTileSize = std::min((size_t) references.n_cols,
+      util::TileColumns(256));
+  const size_t queryTileSize = std::min((size_t) queries.n_cols,
+      util::TileColumns(referenceTileSize));
+
+  arma::mat tile;
+  for (size_t queryBegin = 0; queryBegin < queries.n_cols;
+       queryBegin += queryTileSize)
+  {
+    const size_t queryEnd = std::min(queryBegin + queryTileSize,
+        (size_t) queries.n_cols);
+
+    arma::mat queryTile = queries.cols(queryBegin, queryEnd - 1);
+    queryTile.each_col() -= center;
+    const arma::rowvec queryNorms = arma::sum(arma::square(queryTile), 0);
+
+    for (size_t referenceBegin = 0; referenceBegin < references.n_cols;
+         referenceBegin += referenceTileSize)
+    {
+      const size_t referenceEnd = std::min(referenceBegin + referenceTileSize,
+          (size_t) references.n_cols);
+
+      // Alias the reference points of the tile instead of copying them.
+      const arma::mat referenceTile(centeredReferences.colptr(referenceBegin),
+          centeredReferences.n_rows, referenceEnd - referenceBegin, false,
+          true);
+      const arma::rowvec referenceTileNorms(referenceNorms.memptr() +
+          referenceBegin, referenceEnd - referenceBegin, false, true);
+
+      util::SquaredDistanceTile(referenceTile, referenceTileNorms, queryTile,
+          queryNorms, tile, numThreads);
+
+      #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 16)
+      for (omp_size_t j = 0; j < (omp_size_t) tile.n_cols; ++j)
+        InsertBlockCandidates(tile.colptr(j), tile.n_rows, referenceBegin,
+            queryBegin + j, sameSet, neighbors, distances, heap);
+    }
+
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 16)
+    for (omp_size_t query = (omp_size_t) queryBegin;
+         query < (omp_size_t) queryEnd; ++query)
+      RefineCandidates<TakeRoot>(queries, references, query, neighbors,
+          distances, heap);
+  }
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::InsertBlockCandidates(
+    const double* blockDist,
+    const size_t n,
+    const size_t referenceBegin,
+    const size_t query,
+    const bool sameSet,
+    arma::Mat<size_t>& neighbors,
+    arma::mat& distances,
+    const bool heap)
+{
+  const size_t k = neighbors.n_rows;
+  arma::vec queryDist = distances.unsafe_col(query);
+  arma::Col<size_t> queryIndices = neighbors.unsafe_col(query);
+  for (size_t i = 0; i < n; ++i)
+  {
+    const size_t ref = referenceBegin + i;
+    if (sameSet && (query == ref))
+      continue;
+
+    const double distance = std::max(blockDist[i], 0.0);
+    if (heap)
+    {
+      HeapInsert<SortPolicy>(queryDist.memptr(), queryIndices.memptr(), k, ref,
+          distance);
+      continue;
+    }
+
+    const size_t pos = SortPolicy::SortDistance(queryDist, queryIndices,
+        distance);
+    if (pos == (size_t() - 1))
+      continue;
+
+    for (size_t l = k - 1; l > pos; --l)
+    {
+      queryDist[l] = queryDist[l - 1];
+      queryIndices[l] = queryIndices[l - 1];
+    }
+    queryDist[pos] = distance;
+    queryIndices[pos] = ref;
+  }
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+template<bool TakeRoot>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::RefineCandidates(
+    const arma::mat& queries,
+    const arma::mat& references,
+    const size_t query,
+    arma::Mat<size_t>& neighbors,
+    arma::mat& distances,
+    const bool heap)
+{
+  const size_t k = neighbors.n_rows;
+  for (size_t l = 0; l < k; ++l)
+  {
+    const size_t ref = neighbors(l, query);
+    if (ref != (size_t() - 1))
+      distances(l, query) = metric::LMetric<2, TakeRoot>::Evaluate(
+          queries.col(query), references.col(ref));
+  }
+
+  if (!heap)
+    SortCandidates<SortPolicy>(distances.colptr(query), neighbors.colptr(query),
+        k);
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+template<typename RuleType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::SymmetricTraverse(
+    TreeType& a,
+    TreeType& b,
+    RuleType& rules)
+{
+  if (&a == &b)
+  {
+    // Every pair within the node: the pairs within each child, and the pairs
+    // between each two children.
+    if (a.IsLeaf())
+    {
+      for (size_t i = 0; i < a.NumPoints(); ++i)
+        for (size_t j = i + 1; j < a.NumPoints(); ++j)
+          rules.SymmetricBaseCase(a.Point(i), a.Point(j));
+    }
+    else
+    {
+      for (size_t i = 0; i < a.NumChildren(); ++i)
+        SymmetricTraverse(a.Child(i), a.Child(i), rules);
+      for (size_t i = 0; i < a.NumChildren(); ++i)
+        for (size_t j = i + 1; j < a.NumChildren(); ++j)
+          SymmetricTraverse(a.Child(i), a.Child(j), rules);
+    }
+
+    UpdateSymmetricBound(a, rules);
+    return;
+  }
+
+  // The pair can only be pruned if it can improve the candidates of neither
+  // node.
+  ++rules.Scores();
+  const double distance = SortPolicy::BestNodeToNodeDistance(&a, &b);
+  if (!SortPolicy::IsBetter(distance,
+          SortPolicy::Relax(a.Stat().FirstBound(), epsilon)) &&
+      !SortPolicy::IsBetter(distance,
+          SortPolicy::Relax(b.Stat().FirstBound(), epsilon)))
+    return;
+
+  if (a.IsLeaf() && b.IsLeaf())
+  {
+    for (size_t i = 0; i < a.NumPoints(); ++i)
+      for (size_t j = 0; j < b.NumPoints(); ++j)
+        rules.SymmetricBaseCase(a.Point(i), b.Point(j));
+  }
+  else
+  {
+    // Split the larger node, and visit its children best first.
+    const bool splitA = !a.IsLeaf() &&
+        (b.IsLeaf() || (a.NumDescendants() >= b.NumDescendants()));
+    TreeType& split = splitA ? a : b;
+    TreeType& other = splitA ? b : a;
+
+    std::vector<std::pair<double, size_t> > order(split.NumChildren());
+    for (size_t i = 0; i < split.NumChildren(); ++i)
+      order[i] = std::make_pair(SortPolicy::BestNodeToNodeDistance(
+          &split.Child(i), &other), i);
+    std::sort(order.begin(), order.end(), CandidateComparator<SortPolicy>());
+
+    for (size_t i = 0; i < order.size(); ++i)
+      SymmetricTraverse(split.Child(order[i].second), other, rules);
+  }
+
+  UpdateSymmetricBound(a, rules);
+  UpdateSymmetricBound(b, rules);
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+template<typename RuleType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::UpdateSymmetricBound(
+    TreeType& node,
+    const RuleType& rules)
+{
+  double bound = SortPolicy::BestDistance();
+  for (size_t i = 0; i < node.NumPoints(); ++i)
+  {
+    const double distance = rules.WorstCandidate(node.Point(i));
+    if (SortPolicy::IsBetter(bound, distance))
+      bound = distance;
+  }
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+  {
+    const double childBound = node.Child(i).Stat().FirstBound();
+    if (SortPolicy::IsBetter(bound, childBound))
+      bound = childBound;
+  }
+
+  node.Stat().FirstBound() = bound;
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::InvalidateBounds(
+    TreeType& node)
+{
+  node.Stat().FirstBound() = SortPolicy::WorstDistance();
+  node.Stat().SecondBound() = SortPolicy::WorstDistance();
+  node.Stat().Bound() = SortPolicy::WorstDistance();
+  node.Stat().BoundUpdates() = 0;
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+    InvalidateBounds(node.Child(i));
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::Insert(
+    const typename TreeType::Mat& points)
+{
+  CheckDynamicTree("Insert");
+  if (points.n_rows != referenceSet.n_rows)
+  {
+    Log::Fatal << "NeighborSearch::Insert(): dimensionality of new points ("
+        << points.n_rows << ") does not match dimensionality of reference set ("
+        << referenceSet.n_rows << ")!" << std::endl;
   }
-} // Search
 
+  Timer::Start("tree_building");
+
+  // The tree holds a reference to the dataset object, so growing the matrix in
+  // place keeps the tree (and referenceSet) valid.
+  typename TreeType::Mat& dataset = referenceTree->Dataset();
+  const size_t oldSize = dataset.n_cols;
+  dataset.insert_cols(oldSize, points);
+
+  for (size_t i = 0; i < points.n_cols; ++i)
+    referenceTree->InsertPoint(oldSize + i);
+
+  UpdateQueryTree();
+
+  Timer::Stop("tree_building");
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::Remove(
+    const arma::Col<size_t>& indices)
+{
+  CheckDynamicTree("Remove");
+
+  Timer::Start("tree_building");
+
+  for (size_t i = 0; i < indices.n_elem; ++i)
+  {
+    if (indices[i] >= referenceSet.n_cols)
+    {
+      Log::Fatal << "NeighborSearch::Remove(): index " << indices[i]
+          << " is out of range (there are " << referenceSet.n_cols
+          << " reference points)!" << std::endl;
+    }
+
+    if (!referenceTree->DeletePoint(indices[i]))
+      Log::Warn << "NeighborSearch::Remove(): reference point " << indices[i]
+          << " is not in the reference tree." << std::endl;
+  }
+
+  UpdateQueryTree();
+
+  Timer::Stop("tree_building");
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::CheckDynamicTree(
+    const std::string& caller) const
+{
+  if (naive || referenceTree == NULL)
+  {
+    Log::Fatal << "NeighborSearch::" << caller << "(): the reference set can "
+        << "only be modified when a reference tree is used!" << std::endl;
+  }
+
+  if (tree::TreeTraits<TreeType>::RearrangesDataset ||
+      (&referenceTree->Dataset() != &referenceSet))
+  {
+    Log::Fatal << "NeighborSearch::" << caller << "(): the reference set can "
+        << "only be modified if the reference tree was built on it and does "
+        << "not rearrange it!" << std::endl;
+  }
+}
+
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+void NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::UpdateQueryTree()
+{
+  if (!hasQuerySet && queryTree != NULL)
+  {
+    delete queryTree;
+    queryTree = new TreeType(*referenceTree);
+  }
+}
 
 //Return a String of the Object.
-template<typename SortPolicy, typename MetricType, typename TreeType>
-std::string NeighborSearch<SortPolicy, MetricType, TreeType>::ToString() const
+template<typename SortPolicy,
+         typename MetricType,
+         typename TreeType,
+         typename InstrumentationType,
+         template<typename> class DualTreeTraversalType>
+std::string NeighborSearch<SortPolicy, MetricType, TreeType,
+    InstrumentationType, DualTreeTraversalType>::ToString() const
 {
   std::ostringstream convert;
   convert << "NeighborSearch [" << this << "]" << std::endl;
@@ -8,7 +8,11 @@
 #ifndef __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_SEARCH_RULES_HPP
 #define __MLPACK_METHODS_NEIGHBOR_SEARCH_NEIGHBOR_SEARCH_RULES_HPP
 
+#include <boost/type_traits/is_same.hpp>
+
 #include "ns_traversal_info.hpp"
+#include "candidate_heap.hpp"
+#include "sort_policies/nearest_neighbor_sort.hpp"
 
 namespace mlpack {
 namespace neighbor {
@@ -17,11 +21,32 @@ template<typename SortPolicy, typename MetricType, typename TreeType>
 class NeighborSearchRules
 {
  public:
+  /**
+   * Construct the rules.  If epsilon is greater than 0, the search is
+   * approximate: nodes are pruned when they cannot hold a point which improves
+   * on the current k'th candidate by more than a factor of (1 + epsilon)
+   * (see SortPolicy::Relax()).
+   *
+   * If heap is true, the candidates of each query point are kept in a binary
+   * heap with the worst candidate first (see HeapInsert()) instead of a sorted
+   * list, which makes each insertion O(log k) instead of O(k); the caller must
+   * sort each column with SortCandidates() when the search is finished.
+   *
+   * @param referenceSet Set of reference points.
+   * @param querySet Set of query points.
+   * @param neighbors Matrix to store the neighbor indices in.
+   * @param distances Matrix to store the neighbor distances in.
+   * @param metric Instantiated metric.
+   * @param epsilon Allowed relative error of the neighbor distances.
+   * @param heap Whether to keep the candidates in a heap.
+   */
   NeighborSearchRules(const typename TreeType::Mat& referenceSet,
                       const typename TreeType::Mat& querySet,
                       arma::Mat<size_t>& neighbors,
                       arma::mat& distances,
-                      MetricType& metric);
+                      MetricType& metric,
+                      const double epsilon = 0.0,
+                      const bool heap = false);
   /**
    * Get the distance from the query point to the reference point.
    * This will update the "neighbor" matrix with the new point if appropriate
@@ -32,6 +57,41 @@ class NeighborSearchRules
    */
   double BaseCase(const size_t queryIndex, const size_t referenceIndex);
 
+  /**
+   * Run the base case between the query point and each reference point in the
+   * contiguous range [referenceBegin, referenceEnd).  This gives the same
+   * results as calling BaseCase() for each reference point, but all of the
+   * distances are calculated at once, which is much faster for the leaves of
+   * trees that store their points contiguously (such as BinarySpaceTree).
+   *
+   * @param queryIndex Index of query point.
+   * @param referenceBegin Index of first reference point.
+   * @param referenceEnd Index one past the last reference point.
+   */
+  void BaseCaseRange(const size_t queryIndex,
+                     const size_t referenceBegin,
+                     const size_t referenceEnd);
+
+  /**
+   * Get the distance between two different points of the dataset, when the
+   * query set and the reference set are the same, and offer each point as a
+   * candidate neighbor of the other.  This counts as one base case, and does
+   * the work of both BaseCase(queryIndex, referenceIndex) and
+   * BaseCase(referenceIndex, queryIndex).
+   *
+   * @param queryIndex Index of the first point.
+   * @param referenceIndex Index of the second point.
+   */
+  double SymmetricBaseCase(const size_t queryIndex,
+                           const size_t referenceIndex);
+
+  //! Get the distance of the k'th candidate of the given query point.
+  double WorstCandidate(const size_t queryIndex) const
+  {
+    return heap ? distances(0, queryIndex) :
+        distances(distances.n_rows - 1, queryIndex);
+  }
+
   /**
    * Get the score for recursion order.  A low score indicates priority for
    * recursion, while DBL_MAX indicates that the node should not be recursed
@@ -116,6 +176,12 @@ class NeighborSearchRules
   //! The instantiated metric.
   MetricType& metric;
 
+  //! The allowed relative error for approximate search (0 for exact search).
+  double epsilon;
+
+  //! If true, the candidates are kept in a heap instead of a sorted list.
+  bool heap;
+
   //! The last query point BaseCase() was called with.
   size_t lastQueryIndex;
   //! The last reference point BaseCase() was called with.
@@ -128,15 +194,109 @@ class NeighborSearchRules
   //! The number of scores that have been performed.
   size_t scores;
 
+  //! The number of times a candidate list has changed, plus one (so that it is
+  //! never the 0 that marks a cached bound as out of date).  The bounds cached
+  //! in a query node's statistic are current if this has not changed since
+  //! they were calculated.
+  size_t updates;
+
   //! Traversal info for the parent combination; this is updated by the
   //! traversal before each call to Score().
   TraversalInfoType traversalInfo;
 
+  //! Buffer holding the reference points for BaseCaseRange(), held in the
+  //! class so that it isn't continually being reallocated.
+  arma::mat rangeBlock;
+  //! Buffer holding the distances calculated by BaseCaseRange().
+  arma::rowvec rangeDistances;
+
   /**
-   * Recalculate the bound for a given query node.
+   * Whether the distance of a base case may be abandoned as soon as it is
+   * clear that the reference point will not be a candidate.  The distance given
+   * for such a base case is only a lower bound, so this is only done when
+   * searching for nearest neighbors, and not with trees whose first point is
+   * the centroid, which reuse the base case with that point as the distance to
+   * the node.
+   */
+  static const bool AbandonEarly =
+      boost::is_same<SortPolicy, NearestNeighborSort>::value &&
+      !tree::TreeTraits<TreeType>::FirstPointIsCentroid;
+
+  /**
+   * Calculate the distance between a query point and a reference point for a
+   * base case.  This overload calls the metric.
+   *
+   * @param bound Distance past which the reference point is of no use.
+   */
+  template<typename MT, typename MatType>
+  double BaseCaseDistance(MT& metric,
+                          const MatType& queries,
+                          const MatType& references,
+                          const size_t queryIndex,
+                          const size_t referenceIndex,
+                          const double bound);
+
+  /**
+   * Calculate the distance between a query point and a reference point for a
+   * base case.  This overload is used for L_p distances on dense data; if
+   * AbandonEarly is set, the distance is abandoned once it is past the bound
+   * (see LMetric::EvaluateBounded()).
+   *
+   * @param bound Distance past which the reference point is of no use.
+   */
+  template<int Power, bool TakeRoot>
+  double BaseCaseDistance(metric::LMetric<Power, TakeRoot>& metric,
+                          const arma::mat& queries,
+                          const arma::mat& references,
+                          const size_t queryIndex,
+                          const size_t referenceIndex,
+                          const double bound);
+
+  /**
+   * Calculate the distances between the query point and each reference point
+   * in the given range, storing them in rangeDistances.  This overload calls
+   * the metric once for each pair of points.
+   */
+  template<typename MT, typename MatType>
+  void RangeDistances(MT& metric,
+                      const MatType& queries,
+                      const MatType& references,
+                      const size_t queryIndex,
+                      const size_t referenceBegin,
+                      const size_t referenceEnd);
+
+  /**
+   * Calculate the distances between the query point and each reference point
+   * in the given range, storing them in rangeDistances.  This overload is used
+   * for the Euclidean distance on dense data, and does the whole range with a
+   * few vectorized Armadillo operations.
+   */
+  template<bool TakeRoot>
+  void RangeDistances(metric::LMetric<2, TakeRoot>& metric,
+                      const arma::mat& queries,
+                      const arma::mat& references,
+                      const size_t queryIndex,
+                      const size_t referenceBegin,
+                      const size_t referenceEnd);
+
+  /**
+   * Recalculate the bound for a given query node, or return the cached bound if
+   * no candidate has changed since it was last calculated.
    */
   double CalculateBound(TreeType& queryNode) const;
 
+  /**
+   * Offer a candidate to the list of the given query point, inserting it if it
+   * is better than the k'th candidate.
+   *
+   * @param queryIndex Index of point whose neighbors we are inserting into.
+   * @param neighbor Index of reference point which is being inserted.
+   * @param distance Distance from query point to reference point.
+   */
+  void AddCandidate(const size_t queryIndex,
+                    const size_t neighbor,
+                    const double distance);
+
   /**
    * Insert a point into the neighbors and distances matrices; this is a helper
    * function.
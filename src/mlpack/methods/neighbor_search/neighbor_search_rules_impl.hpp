@@ -19,16 +19,21 @@ NeighborSearchRules<SortPolicy, MetricType, TreeType>::NeighborSearchRules(
     const typename TreeType::Mat& querySet,
     arma::Mat<size_t>& neighbors,
     arma::mat& distances,
-    MetricType& metric) :
+    MetricType& metric,
+    const double epsilon,
+    const bool heap) :
     referenceSet(referenceSet),
     querySet(querySet),
     neighbors(neighbors),
     distances(distances),
     metric(metric),
+    epsilon(epsilon),
+    heap(heap),
     lastQueryIndex(querySet.n_cols),
     lastReferenceIndex(referenceSet.n_cols),
     baseCases(0),
-    scores(0)
+    scores(0),
+    updates(1)
 {
   // We must set the traversal info last query and reference node pointers to
   // something that is both invalid (i.e. not a tree node) and not NULL.  We'll
@@ -51,20 +56,11 @@ BaseCase(const size_t queryIndex, const size_t referenceIndex)
   if ((lastQueryIndex == queryIndex) && (lastReferenceIndex == referenceIndex))
     return lastBaseCase;
 
-  double distance = metric.Evaluate(querySet.col(queryIndex),
-                                    referenceSet.col(referenceIndex));
+  double distance = BaseCaseDistance(metric, querySet, referenceSet,
+      queryIndex, referenceIndex, WorstCandidate(queryIndex));
   ++baseCases;
 
-  // If this distance is better than any of the current candidates, the
-  // SortDistance() function will give us the position to insert it into.
-  arma::vec queryDist = distances.unsafe_col(queryIndex);
-  arma::Col<size_t> queryIndices = neighbors.unsafe_col(queryIndex);
-  const size_t insertPosition = SortPolicy::SortDistance(queryDist,
-      queryIndices, distance);
-
-  // SortDistance() returns (size_t() - 1) if we shouldn't add it.
-  if (insertPosition != (size_t() - 1))
-    InsertNeighbor(queryIndex, insertPosition, referenceIndex, distance);
+  AddCandidate(queryIndex, referenceIndex, distance);
 
   // Cache this information for the next time BaseCase() is called.
   lastQueryIndex = queryIndex;
@@ -74,6 +70,156 @@ BaseCase(const size_t queryIndex, const size_t referenceIndex)
   return distance;
 }
 
+template<typename SortPolicy, typename MetricType, typename TreeType>
+inline void NeighborSearchRules<SortPolicy, MetricType, TreeType>::
+BaseCaseRange(const size_t queryIndex,
+              const size_t referenceBegin,
+              const size_t referenceEnd)
+{
+  if (referenceEnd <= referenceBegin)
+    return;
+
+  // If base cases can be abandoned early, do the reference points one at a
+  // time, so that each one is checked against the bound left by the ones
+  // before it.  Points with few dimensions are not worth abandoning (see
+  // LMetric::EvaluateBounded()), so they are still done all at once.
+  if (AbandonEarly && (querySet.n_rows >=
+      2 * metric::LMetric<2>::EarlyAbandonBlockSize))
+  {
+    for (size_t ref = referenceBegin; ref < referenceEnd; ++ref)
+    {
+      if ((&querySet == &referenceSet) && (queryIndex == ref))
+        continue;
+      if ((lastQueryIndex == queryIndex) && (lastReferenceIndex == ref))
+        continue;
+
+      const double distance = BaseCaseDistance(metric, querySet, referenceSet,
+          queryIndex, ref, WorstCandidate(queryIndex));
+      ++baseCases;
+      AddCandidate(queryIndex, ref, distance);
+
+      if (ref == referenceEnd - 1)
+      {
+        lastQueryIndex = queryIndex;
+        lastReferenceIndex = ref;
+        lastBaseCase = distance;
+      }
+    }
+
+    return;
+  }
+
+  RangeDistances(metric, querySet, referenceSet, queryIndex, referenceBegin,
+      referenceEnd);
+
+  for (size_t ref = referenceBegin; ref < referenceEnd; ++ref)
+  {
+    // Skip the query point itself and any base case we have already done, as
+    // BaseCase() does.
+    if ((&querySet == &referenceSet) && (queryIndex == ref))
+      continue;
+    if ((lastQueryIndex == queryIndex) && (lastReferenceIndex == ref))
+      continue;
+
+    ++baseCases;
+    AddCandidate(queryIndex, ref, rangeDistances[ref - referenceBegin]);
+  }
+
+  // Cache the last base case, as BaseCase() would have.
+  lastQueryIndex = queryIndex;
+  lastReferenceIndex = referenceEnd - 1;
+  lastBaseCase = rangeDistances[referenceEnd - 1 - referenceBegin];
+}
+
+template<typename SortPolicy, typename MetricType, typename TreeType>
+inline force_inline
+double NeighborSearchRules<SortPolicy, MetricType, TreeType>::
+SymmetricBaseCase(const size_t queryIndex, const size_t referenceIndex)
+{
+  // The distance is only of use if it is within the bound of either point.
+  const double distance = BaseCaseDistance(metric, querySet, referenceSet,
+      queryIndex, referenceIndex, std::max(WorstCandidate(queryIndex),
+      WorstCandidate(referenceIndex)));
+  ++baseCases;
+
+  AddCandidate(queryIndex, referenceIndex, distance);
+  AddCandidate(referenceIndex, queryIndex, distance);
+
+  return distance;
+}
+
+template<typename SortPolicy, typename MetricType, typename TreeType>
+template<typename MT, typename MatType>
+inline force_inline
+double NeighborSearchRules<SortPolicy, MetricType, TreeType>::
+BaseCaseDistance(MT& metric,
+                 const MatType& queries,
+                 const MatType& references,
+                 const size_t queryIndex,
+                 const size_t referenceIndex,
+                 const double /* bound */)
+{
+  return metric.Evaluate(queries.col(queryIndex),
+                         references.col(referenceIndex));
+}
+
+template<typename SortPolicy, typename MetricType, typename TreeType>
+template<int Power, bool TakeRoot>
+inline force_inline
+double NeighborSearchRules<SortPolicy, MetricType, TreeType>::
+BaseCaseDistance(metric::LMetric<Power, TakeRoot>& metric,
+                 const arma::mat& queries,
+                 const arma::mat& references,
+                 const size_t queryIndex,
+                 const size_t referenceIndex,
+                 const double bound)
+{
+  if (!AbandonEarly)
+    return metric.Evaluate(queries.unsafe_col(queryIndex),
+                           references.unsafe_col(referenceIndex));
+
+  return metric.EvaluateBounded(queries.unsafe_col(queryIndex),
+      references.unsafe_col(referenceIndex), bound);
+}
+
+template<typename SortPolicy, typename MetricType, typename TreeType>
+template<typename MT, typename MatType>
+inline void NeighborSearchRules<SortPolicy, MetricType, TreeType>::
+RangeDistances(MT& metric,
+               const MatType& queries,
+               const MatType& references,
+               const size_t queryIndex,
+               const size_t referenceBegin,
+               const size_t referenceEnd)
+{
+  rangeDistances.set_size(referenceEnd - referenceBegin);
+  for (size_t ref = referenceBegin; ref < referenceEnd; ++ref)
+    rangeDistances[ref - referenceBegin] = metric.Evaluate(
+        queries.col(queryIndex), references.col(ref));
+}
+
+template<typename SortPolicy, typename MetricType, typename TreeType>
+template<bool TakeRoot>
+inline void NeighborSearchRules<SortPolicy, MetricType, TreeType>::
+RangeDistances(metric::LMetric<2, TakeRoot>& /* metric */,
+               const arma::mat& queries,
+               const arma::mat& references,
+               const size_t queryIndex,
+               const size_t referenceBegin,
+               const size_t referenceEnd)
+{
+  // The points of the range are contiguous in memory, so subtract the query
+  // point from all of them at once and sum the squared differences of each
+  // column.  This is not done with the ||a||^2 + ||b||^2 - 2 a^T b expansion,
+  // which loses too much precision for points that are close together.
+  rangeBlock = references.cols(referenceBegin, referenceEnd - 1);
+  rangeBlock.each_col() -= queries.col(queryIndex);
+  rangeDistances = arma::sum(arma::square(rangeBlock), 0);
+
+  if (TakeRoot)
+    rangeDistances = arma::sqrt(rangeDistances);
+}
+
 template<typename SortPolicy, typename MetricType, typename TreeType>
 inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Score(
     const size_t queryIndex,
@@ -110,7 +256,8 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Score(
   }
 
   // Compare against the best k'th distance for this query point so far.
-  const double bestDistance = distances(distances.n_rows - 1, queryIndex);
+  const double bestDistance = SortPolicy::Relax(WorstCandidate(queryIndex),
+      epsilon);
 
   return (SortPolicy::IsBetter(distance, bestDistance)) ? distance : DBL_MAX;
 }
@@ -126,7 +273,8 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Rescore(
     return oldScore;
 
   // Just check the score again against the distances.
-  const double bestDistance = distances(distances.n_rows - 1, queryIndex);
+  const double bestDistance = SortPolicy::Relax(WorstCandidate(queryIndex),
+      epsilon);
 
   return (SortPolicy::IsBetter(oldScore, bestDistance)) ? oldScore : DBL_MAX;
 }
@@ -139,7 +287,8 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Score(
   ++scores; // Count number of Score() calls.
 
   // Update our bound.
-  const double bestDistance = CalculateBound(queryNode);
+  const double bestDistance = SortPolicy::Relax(CalculateBound(queryNode),
+      epsilon);
 
   // Use the traversal info to see if a parent-child or parent-parent prune is
   // possible.  This is a looser bound than we could make, but it might be
@@ -175,7 +324,7 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Score(
     const double lastRefDescDist =
         traversalInfo.LastReferenceNode()->MinimumBoundDistance();
     adjustedScore = SortPolicy::CombineWorst(score, lastQueryDescDist);
-    adjustedScore = SortPolicy::CombineWorst(score, lastRefDescDist);
+    adjustedScore = SortPolicy::CombineWorst(adjustedScore, lastRefDescDist);
   }
 
   // Assemble an adjusted score.  For nearest neighbor search, this adjusted
@@ -302,7 +451,8 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::Rescore(
     return oldScore;
 
   // Update our bound.
-  const double bestDistance = CalculateBound(queryNode);
+  const double bestDistance = SortPolicy::Relax(CalculateBound(queryNode),
+      epsilon);
 
   return (SortPolicy::IsBetter(oldScore, bestDistance)) ? oldScore : DBL_MAX;
 }
@@ -340,13 +490,23 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::
   // Then, to assemble the final bound, since both bounds are valid, we simply
   // take the better of the two.
 
+  // Both bounds only depend on the candidate distances of the descendant points
+  // and on the bounds cached in the children and the parent, so if no candidate
+  // has changed since the bounds of this node were last calculated, the cached
+  // bound is returned.  The children or the parent may have tightened their own
+  // bounds since then, so recalculating could give a slightly better bound, but
+  // the cached one is still valid, and this saves looping over the points and
+  // children every time the node is scored or rescored.
+  if (queryNode.Stat().BoundUpdates() == updates)
+    return queryNode.Stat().Bound();
+
   double worstDistance = SortPolicy::BestDistance();
   double bestDistance = SortPolicy::WorstDistance();
 
   // Loop over points held in the node.
   for (size_t i = 0; i < queryNode.NumPoints(); ++i)
   {
-    const double distance = distances(distances.n_rows - 1, queryNode.Point(i));
+    const double distance = WorstCandidate(queryNode.Point(i));
     if (SortPolicy::IsBetter(worstDistance, distance))
       worstDistance = distance;
     if (SortPolicy::IsBetter(distance, bestDistance))
@@ -397,11 +557,38 @@ inline double NeighborSearchRules<SortPolicy, MetricType, TreeType>::
   // Cache bounds for later.
   queryNode.Stat().FirstBound() = worstDistance;
   queryNode.Stat().SecondBound() = bestDistance;
+  queryNode.Stat().Bound() = SortPolicy::IsBetter(worstDistance, bestDistance) ?
+      worstDistance : bestDistance;
+  queryNode.Stat().BoundUpdates() = updates;
 
-  if (SortPolicy::IsBetter(worstDistance, bestDistance))
-    return worstDistance;
-  else
-    return bestDistance;
+  return queryNode.Stat().Bound();
+}
+
+template<typename SortPolicy, typename MetricType, typename TreeType>
+inline force_inline
+void NeighborSearchRules<SortPolicy, MetricType, TreeType>::AddCandidate(
+    const size_t queryIndex,
+    const size_t neighbor,
+    const double distance)
+{
+  if (heap)
+  {
+    if (HeapInsert<SortPolicy>(distances.colptr(queryIndex),
+        neighbors.colptr(queryIndex), distances.n_rows, neighbor, distance))
+      ++updates;
+    return;
+  }
+
+  // If this distance is better than any of the current candidates, the
+  // SortDistance() function will give us the position to insert it into.
+  arma::vec queryDist = distances.unsafe_col(queryIndex);
+  arma::Col<size_t> queryIndices = neighbors.unsafe_col(queryIndex);
+  const size_t insertPosition = SortPolicy::SortDistance(queryDist,
+      queryIndices, distance);
+
+  // SortDistance() returns (size_t() - 1) if we shouldn't add it.
+  if (insertPosition != (size_t() - 1))
+    InsertNeighbor(queryIndex, insertPosition, neighbor, distance);
 }
 
 /**
@@ -434,6 +621,10 @@ void NeighborSearchRules<SortPolicy, MetricType, TreeType>::InsertNeighbor(
   // Now put the new information in the right index.
   distances(pos, queryIndex) = distance;
   neighbors(pos, queryIndex) = neighbor;
+
+  // The k'th candidate distance of the query point has changed, so any cached
+  // bounds may be out of date.
+  ++updates;
 }
 
 }; // namespace neighbor
@@ -31,6 +31,10 @@ class NeighborSearchStat
   double secondBound;
   //! The better of the two bounds.
   double bound;
+  //! The number of candidate updates the NeighborSearchRules had made when the
+  //! bounds were last calculated, or 0 if they are out of date.  If no
+  //! candidate has changed since then, the bounds are still current.
+  size_t boundUpdates;
 
   //! The last distance evaluation node.
   void* lastDistanceNode;
@@ -46,6 +50,7 @@ class NeighborSearchStat
       firstBound(SortPolicy::WorstDistance()),
       secondBound(SortPolicy::WorstDistance()),
       bound(SortPolicy::WorstDistance()),
+      boundUpdates(0),
       lastDistanceNode(NULL),
       lastDistance(0.0) { }
 
@@ -58,6 +63,7 @@ class NeighborSearchStat
       firstBound(SortPolicy::WorstDistance()),
       secondBound(SortPolicy::WorstDistance()),
       bound(SortPolicy::WorstDistance()),
+      boundUpdates(0),
       lastDistanceNode(NULL),
       lastDistance(0.0) { }
 
@@ -73,6 +79,10 @@ class NeighborSearchStat
   double Bound() const { return bound; }
   //! Modify the overall bound (it should be the better of the two bounds).
   double& Bound() { return bound; }
+  //! Get the number of candidate updates when the bounds were calculated.
+  size_t BoundUpdates() const { return boundUpdates; }
+  //! Modify the number of candidate updates when the bounds were calculated.
+  size_t& BoundUpdates() { return boundUpdates; }
   //! Get the last distance evaluation node.
   void* LastDistanceNode() const { return lastDistanceNode; }
   //! Modify the last distance evaluation node.
@@ -145,6 +145,25 @@ class FurthestNeighborSort
    */
   static inline double CombineWorst(const double a, const double b)
   { return std::max(a - b, 0.0); }
+
+  /**
+   * Return the given pruning bound, relaxed for approximate search with the
+   * given epsilon: a node is only recursed into if it could hold a point that
+   * is further than the returned value, so each neighbor that is found is
+   * within a factor of (1 - epsilon) of the true neighbor distance.  For
+   * epsilon of 1 or more, any neighbor is acceptable.
+   *
+   * @param value Bound on the distance to relax.
+   * @param epsilon Allowed relative error (0 means exact search).
+   */
+  static inline double Relax(const double value, const double epsilon)
+  {
+    if (value == 0.0)
+      return 0.0;
+    if (value == DBL_MAX || epsilon >= 1)
+      return DBL_MAX;
+    return value / (1 - epsilon);
+  }
 };
 
 }; // namespace neighbor
@@ -150,6 +150,22 @@ class NearestNeighborSort
       return DBL_MAX;
     return a + b;
   }
+
+  /**
+   * Return the given pruning bound, relaxed for approximate search with the
+   * given epsilon: a node is only recursed into if it could hold a point that
+   * is closer than the returned value, so each neighbor that is found is
+   * within a factor of (1 + epsilon) of the true neighbor distance.
+   *
+   * @param value Bound on the distance to relax.
+   * @param epsilon Allowed relative error (0 means exact search).
+   */
+  static inline double Relax(const double value, const double epsilon)
+  {
+    if (value == DBL_MAX)
+      return DBL_MAX;
+    return value / (1 + epsilon);
+  }
 };
 
 }; // namespace neighbor
@@ -9,6 +9,39 @@
 namespace mlpack {
 namespace neighbor {
 
+//! Get the number of threads to unmap with.
+static size_t UnmapThreads(const size_t threads)
+{
+#ifdef _OPENMP
+  return (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  (void) threads;
+  return 1;
+#endif
+}
+
+/**
+ * Unmap one column of results: copy (or take the square root of) the distances
+ * and map the indices of the neighbors into the given output columns.
+ */
+static inline void UnmapColumn(const size_t* neighbors,
+                               const double* distances,
+                               const size_t n,
+                               const std::vector<size_t>& referenceMap,
+                               size_t* neighborsOut,
+                               double* distancesOut,
+                               const bool squareRoot)
+{
+  for (size_t j = 0; j < n; ++j)
+  {
+    distancesOut[j] = squareRoot ? std::sqrt(distances[j]) : distances[j];
+
+    // Slots that were never filled keep their invalid index.
+    neighborsOut[j] = (neighbors[j] < referenceMap.size()) ?
+        referenceMap[neighbors[j]] : neighbors[j];
+  }
+}
+
 // Useful in the dual-tree setting.
 void Unmap(const arma::Mat<size_t>& neighbors,
            const arma::mat& distances,
@@ -16,25 +49,22 @@ void Unmap(const arma::Mat<size_t>& neighbors,
            const std::vector<size_t>& queryMap,
            arma::Mat<size_t>& neighborsOut,
            arma::mat& distancesOut,
-           const bool squareRoot)
+           const bool squareRoot,
+           const size_t threads)
 {
   // Set matrices to correct size.
   neighborsOut.set_size(neighbors.n_rows, neighbors.n_cols);
   distancesOut.set_size(distances.n_rows, distances.n_cols);
 
-  // Unmap distances.
-  for (size_t i = 0; i < distances.n_cols; ++i)
+  // Map each column to the correct place.  Each output column is written by
+  // exactly one iteration, since queryMap is a permutation.
+  #pragma omp parallel for num_threads(UnmapThreads(threads)) \
+      schedule(static) if (neighbors.n_elem >= 65536)
+  for (omp_size_t i = 0; i < (omp_size_t) neighbors.n_cols; ++i)
   {
-    // Map columns to the correct place.  The ternary operator does not work
-    // here...
-    if (squareRoot)
-      distancesOut.col(queryMap[i]) = sqrt(distances.col(i));
-    else
-      distancesOut.col(queryMap[i]) = distances.col(i);
-
-    // Map indices of neighbors.
-    for (size_t j = 0; j < distances.n_rows; ++j)
-      neighborsOut(j, queryMap[i]) = referenceMap[neighbors(j, i)];
+    UnmapColumn(neighbors.colptr(i), distances.colptr(i), neighbors.n_rows,
+        referenceMap, neighborsOut.colptr(queryMap[i]),
+        distancesOut.colptr(queryMap[i]), squareRoot);
   }
 }
 
@@ -44,20 +74,22 @@ void Unmap(const arma::Mat<size_t>& neighbors,
            const std::vector<size_t>& referenceMap,
            arma::Mat<size_t>& neighborsOut,
            arma::mat& distancesOut,
-           const bool squareRoot)
+           const bool squareRoot,
+           const size_t threads)
 {
   // Set matrices to correct size.
   neighborsOut.set_size(neighbors.n_rows, neighbors.n_cols);
+  distancesOut.set_size(distances.n_rows, distances.n_cols);
 
-  // Take square root of distances, if necessary.
-  if (squareRoot)
-    distancesOut = sqrt(distances);
-  else
-    distancesOut = distances;
-
-  // Map neighbors back to original locations.
-  for (size_t j = 0; j < neighbors.n_elem; ++j)
-    neighborsOut[j] = referenceMap[neighbors[j]];
+  // The columns stay where they are; only the neighbors are mapped.
+  #pragma omp parallel for num_threads(UnmapThreads(threads)) \
+      schedule(static) if (neighbors.n_elem >= 65536)
+  for (omp_size_t i = 0; i < (omp_size_t) neighbors.n_cols; ++i)
+  {
+    UnmapColumn(neighbors.colptr(i), distances.colptr(i), neighbors.n_rows,
+        referenceMap, neighborsOut.colptr(i), distancesOut.colptr(i),
+        squareRoot);
+  }
 }
 
 }; // namespace neighbor
@@ -19,6 +19,11 @@ namespace neighbor {
  * unmap the entries in each row of neighbors.  This is useful for the dual-tree
  * case.
  *
+ * The columns are unmapped in parallel (if mlpack was compiled with OpenMP),
+ * and the square root of the distances, if requested, is taken in the same
+ * pass.  Entries of neighbors which are not valid indices into referenceMap
+ * (such as slots which were never filled) are left as they are.
+ *
  * @param neighbors Matrix of neighbors resulting from neighbor search.
  * @param distances Matrix of distances resulting from neighbor search.
  * @param referenceMap Mapping of reference set to old points.
@@ -26,6 +31,7 @@ namespace neighbor {
  * @param neighborsOut Matrix to store unmapped neighbors into.
  * @param distancesOut Matrix to store unmapped distances into.
  * @param squareRoot If true, take the square root of the distances.
+ * @param threads Number of threads to use (0 means all available).
  */
 void Unmap(const arma::Mat<size_t>& neighbors,
            const arma::mat& distances,
@@ -33,7 +39,8 @@ void Unmap(const arma::Mat<size_t>& neighbors,
            const std::vector<size_t>& queryMap,
            arma::Mat<size_t>& neighborsOut,
            arma::mat& distancesOut,
-           const bool squareRoot = false);
+           const bool squareRoot = false,
+           const size_t threads = 0);
 
 /**
  * Assuming that the datasets have been mapped using referenceMap (such as
@@ -41,19 +48,23 @@ void Unmap(const arma::Mat<size_t>& neighbors,
  * neighbors matrices into neighborsOut and distancesOut, and also unmap the
  * entries in each row of neighbors.  This is useful for the single-tree case.
  *
+ * As above, this is done in parallel, in one pass over the results.
+ *
  * @param neighbors Matrix of neighbors resulting from neighbor search.
  * @param distances Matrix of distances resulting from neighbor search.
  * @param referenceMap Mapping of reference set to old points.
  * @param neighborsOut Matrix to store unmapped neighbors into.
  * @param distancesOut Matrix to store unmapped distances into.
  * @param squareRoot If true, take the square root of the distances.
+ * @param threads Number of threads to use (0 means all available).
  */
 void Unmap(const arma::Mat<size_t>& neighbors,
            const arma::mat& distances,
            const std::vector<size_t>& referenceMap,
            arma::Mat<size_t>& neighborsOut,
            arma::mat& distancesOut,
-           const bool squareRoot = false);
+           const bool squareRoot = false,
+           const size_t threads = 0);
 
 }; // namespace neighbor
 }; // namespace mlpack
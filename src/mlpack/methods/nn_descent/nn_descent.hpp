@@ -0,0 +1,205 @@
+/**
+ * @file nn_descent.hpp
+ *
+ * Defines the NNDescent class, which builds an approximate k-nearest-neighbor
+ * graph of a dataset with the NN-descent algorithm.
+ *
+ * The details of this method can be found in the following paper:
+ *
+ * @inproceedings{dong2011efficient,
+ *   title={Efficient k-nearest neighbor graph construction for generic
+ *       similarity measures},
+ *   author={Dong, W. and Moses, C. and Li, K.},
+ *   booktitle={Proceedings of the 20th International Conference on World Wide
+ *       Web (WWW '11)},
+ *   pages={577--586},
+ *   year={2011},
+ *   organization={ACM}
+ * }
+ */
+#ifndef __MLPACK_METHODS_NN_DESCENT_NN_DESCENT_HPP
+#define __MLPACK_METHODS_NN_DESCENT_NN_DESCENT_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
+
+#include <vector>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * Build an approximate k-nearest-neighbor graph of a dataset (the k nearest
+ * neighbors of every point of the dataset, excluding the point itself) with
+ * NN-descent.  Each point starts with k neighbors, which are random or given
+ * (for instance, the results of LSHSearch or RASearch), and each iteration
+ * improves the lists by the principle that a neighbor of a neighbor is likely
+ * to be a neighbor: for each point, every pair of its neighbors and reverse
+ * neighbors (points that have it as a neighbor) is compared, and each point of
+ * the pair is offered as a neighbor of the other (the "local join").  Only
+ * pairs with at least one neighbor that is new since the last iteration are
+ * compared, and at most sampleRate * k new neighbors and reverse neighbors of
+ * each point take part in an iteration.  The search stops when fewer than
+ * tolerance * k * n neighbors were changed in an iteration, or after
+ * maxIterations iterations.
+ *
+ * The results are in the same format as the results of NeighborSearch: column
+ * i holds the neighbors of point i, sorted so that the nearest is first.
+ *
+ * If mlpack was compiled with OpenMP, each iteration runs in parallel with the
+ * number of threads given by Threads().  The neighbor lists are protected by a
+ * fixed number of locks, so the results can vary from run to run with more
+ * than one thread, even with the same random seed.
+ *
+ * @tparam MetricType The metric to use for computation.
+ */
+template<typename MetricType = metric::EuclideanDistance>
+class NNDescent
+{
+ public:
+  /**
+   * Prepare to build the k-nearest-neighbor graph of the given dataset.  The
+   * dataset is not copied, so it must outlive this object.
+   *
+   * @param dataset Dataset to build the graph of.
+   * @param maxIterations Maximum number of iterations.
+   * @param sampleRate Fraction of the k new neighbors (and reverse neighbors)
+   *     of each point which take part in each local join.
+   * @param tolerance The search stops when fewer than tolerance * k * n
+   *     neighbors were changed in an iteration.
+   * @param metric An optional instance of the MetricType class.
+   */
+  NNDescent(const arma::mat& dataset,
+            const size_t maxIterations = 20,
+            const double sampleRate = 1.0,
+            const double tolerance = 0.001,
+            const MetricType metric = MetricType());
+
+  /**
+   * Build the approximate k-nearest-neighbor graph, starting from random
+   * neighbors.  k must be less than the number of points.
+   *
+   * @param k Number of neighbors of each point.
+   * @param neighbors Matrix to store the neighbor indices in (k x n).
+   * @param distances Matrix to store the neighbor distances in (k x n).
+   */
+  void Build(const size_t k,
+             arma::Mat<size_t>& neighbors,
+             arma::mat& distances);
+
+  /**
+   * Build the approximate k-nearest-neighbor graph, starting from the given
+   * neighbors, such as the results of LSHSearch or RASearch run on the dataset
+   * with itself as the query set.  initialNeighbors may have any number of
+   * rows; entries which are not valid indices, which are the point itself, or
+   * which repeat a neighbor are ignored, and points with fewer than k initial
+   * neighbors get random ones.  k must be less than the number of points.
+   *
+   * @param k Number of neighbors of each point.
+   * @param initialNeighbors Initial neighbors of each point (one column for
+   *     each point).
+   * @param neighbors Matrix to store the neighbor indices in (k x n).
+   * @param distances Matrix to store the neighbor distances in (k x n).
+   */
+  void Build(const size_t k,
+             const arma::Mat<size_t>& initialNeighbors,
+             arma::Mat<size_t>& neighbors,
+             arma::mat& distances);
+
+  //! Get the maximum number of iterations.
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of iterations.
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Get the fraction of new neighbors which take part in each local join.
+  double SampleRate() const { return sampleRate; }
+  //! Modify the fraction of new neighbors which take part in each local join.
+  double& SampleRate() { return sampleRate; }
+
+  //! Get the tolerance for convergence.
+  double Tolerance() const { return tolerance; }
+  //! Modify the tolerance for convergence.
+  double& Tolerance() { return tolerance; }
+
+  //! Get the number of threads used to build the graph (0 means all available
+  //! threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used to build the graph (0 means all
+  //! available threads).  This has no effect if mlpack was compiled without
+  //! OpenMP.
+  size_t& Threads() { return threads; }
+
+  //! Get the number of iterations performed by the last call to Build().
+  size_t Iterations() const { return iterations; }
+
+  //! Get the number of distance evaluations performed by the last call to
+  //! Build().
+  size_t DistanceEvaluations() const { return distanceEvaluations; }
+
+ private:
+  //! The dataset.
+  const arma::mat& dataset;
+
+  //! The maximum number of iterations.
+  size_t maxIterations;
+  //! The fraction of new neighbors which take part in each local join.
+  double sampleRate;
+  //! The tolerance for convergence.
+  double tolerance;
+  //! The number of threads to use (0 means all available).
+  size_t threads;
+
+  //! Instantiation of the metric.
+  MetricType metric;
+
+  //! The number of iterations performed by the last call to Build().
+  size_t iterations;
+  //! The number of distance evaluations performed by the last call to Build().
+  size_t distanceEvaluations;
+
+  /**
+   * Run NN-descent on the initial neighbor lists, which must be full.
+   *
+   * @param neighbors Neighbor lists (sorted).
+   * @param distances Distances of the neighbors.
+   * @param isNew Whether each neighbor is new since it took part in a local
+   *     join (same layout as neighbors).
+   */
+  void Descend(arma::Mat<size_t>& neighbors,
+               arma::mat& distances,
+               std::vector<char>& isNew);
+
+  /**
+   * Offer a neighbor to the sorted list of the given point.  It is inserted
+   * (and marked as new) if it is nearer than the furthest neighbor of the list
+   * and not already in the list.
+   *
+   * @param point Index of the point whose list is updated.
+   * @param neighbor Index of the neighbor.
+   * @param distance Distance between the point and the neighbor.
+   * @param neighbors Neighbor lists.
+   * @param distances Distances of the neighbors.
+   * @param isNew Whether each neighbor is new.
+   * @return Whether the neighbor was inserted.
+   */
+  static bool Insert(const size_t point,
+                     const size_t neighbor,
+                     const double distance,
+                     arma::Mat<size_t>& neighbors,
+                     arma::mat& distances,
+                     std::vector<char>& isNew);
+
+  /**
+   * Keep a random sample of the given number of elements of the vector (or
+   * all of them, if there are not more).
+   */
+  static void Sample(std::vector<size_t>& elements, const size_t count);
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+// Include implementation.
+#include "nn_descent_impl.hpp"
+
+#endif
@@ -0,0 +1,307 @@
+/**
+ * @file nn_descent_impl.hpp
+ *
+ * Implementation of the NNDescent class.
+ */
+#ifndef __MLPACK_METHODS_NN_DESCENT_NN_DESCENT_IMPL_HPP
+#define __MLPACK_METHODS_NN_DESCENT_NN_DESCENT_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "nn_descent.hpp"
+
+#include <algorithm>
+
+namespace mlpack {
+namespace neighbor {
+
+template<typename MetricType>
+NNDescent<MetricType>::NNDescent(const arma::mat& dataset,
+                                 const size_t maxIterations,
+                                 const double sampleRate,
+                                 const double tolerance,
+                                 const MetricType metric) :
+    dataset(dataset),
+    maxIterations(maxIterations),
+    sampleRate(sampleRate),
+    tolerance(tolerance),
+    threads(0),
+    metric(metric),
+    iterations(0),
+    distanceEvaluations(0)
+{
+  if (sampleRate <= 0.0 || sampleRate > 1.0)
+  {
+    Log::Fatal << "NNDescent::NNDescent(): sample rate must be in (0, 1] (got "
+        << sampleRate << ")!" << std::endl;
+  }
+}
+
+template<typename MetricType>
+void NNDescent<MetricType>::Build(const size_t k,
+                                  arma::Mat<size_t>& neighbors,
+                                  arma::mat& distances)
+{
+  // No initial neighbors; every point gets random ones.
+  arma::Mat<size_t> initialNeighbors;
+  Build(k, initialNeighbors, neighbors, distances);
+}
+
+template<typename MetricType>
+void NNDescent<MetricType>::Build(const size_t k,
+                                  const arma::Mat<size_t>& initialNeighbors,
+                                  arma::Mat<size_t>& neighbors,
+                                  arma::mat& distances)
+{
+  const size_t n = dataset.n_cols;
+  if (k == 0 || k >= n)
+  {
+    Log::Fatal << "NNDescent::Build(): k must be greater than 0 and less than "
+        << "the number of points (" << n << "); got " << k << "!" << std::endl;
+  }
+  if (initialNeighbors.n_elem > 0 && initialNeighbors.n_cols != n)
+  {
+    Log::Fatal << "NNDescent::Build(): initial neighbors have "
+        << initialNeighbors.n_cols << " columns, but there are " << n
+        << " points!" << std::endl;
+  }
+
+  Timer::Start("nn_descent");
+
+  neighbors.set_size(k, n);
+  neighbors.fill(size_t() - 1);
+  distances.set_size(k, n);
+  distances.fill(DBL_MAX);
+  std::vector<char> isNew(k * n, 1);
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Fill the lists with the initial neighbors, and then with random points.
+  size_t evaluations = 0;
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 256) \
+      reduction(+:evaluations)
+  for (omp_size_t i = 0; i < (omp_size_t) n; ++i)
+  {
+    for (size_t j = 0; j < initialNeighbors.n_rows; ++j)
+    {
+      const size_t neighbor = initialNeighbors(j, i);
+      if (neighbor >= n || neighbor == (size_t) i)
+        continue;
+
+      Insert(i, neighbor, metric.Evaluate(dataset.col(i),
+          dataset.col(neighbor)), neighbors, distances, isNew);
+      ++evaluations;
+    }
+
+    while (neighbors(k - 1, i) == (size_t() - 1))
+    {
+      const size_t neighbor = (size_t) math::RandInt(n);
+      if (neighbor == (size_t) i)
+        continue;
+
+      Insert(i, neighbor, metric.Evaluate(dataset.col(i),
+          dataset.col(neighbor)), neighbors, distances, isNew);
+      ++evaluations;
+    }
+  }
+
+  distanceEvaluations = evaluations;
+  Descend(neighbors, distances, isNew);
+
+  Timer::Stop("nn_descent");
+}
+
+template<typename MetricType>
+void NNDescent<MetricType>::Descend(arma::Mat<size_t>& neighbors,
+                                    arma::mat& distances,
+                                    std::vector<char>& isNew)
+{
+  const size_t k = neighbors.n_rows;
+  const size_t n = neighbors.n_cols;
+  const size_t sampleSize = std::max((size_t) 1,
+      (size_t) (sampleRate * k + 0.5));
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+
+  // Each list is protected by one of a fixed number of locks, so that the
+  // number of locks does not grow with the dataset.
+  const size_t numLocks = 1024;
+  std::vector<omp_lock_t> locks(numLocks);
+  for (size_t i = 0; i < numLocks; ++i)
+    omp_init_lock(&locks[i]);
+#else
+  const size_t numThreads = 1;
+#endif
+
+  std::vector<std::vector<size_t> > oldLists(n);
+  std::vector<std::vector<size_t> > newLists(n);
+  std::vector<std::vector<size_t> > oldReverse(n);
+  std::vector<std::vector<size_t> > newReverse(n);
+
+  for (iterations = 0; iterations < maxIterations; ++iterations)
+  {
+    // Split each list into its old neighbors and a sample of its new
+    // neighbors; the sampled neighbors are no longer new.
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 256)
+    for (omp_size_t i = 0; i < (omp_size_t) n; ++i)
+    {
+      oldLists[i].clear();
+      newLists[i].clear();
+      for (size_t j = 0; j < k; ++j)
+      {
+        if (isNew[i * k + j])
+          newLists[i].push_back(j);
+        else
+          oldLists[i].push_back(neighbors(j, i));
+      }
+
+      Sample(newLists[i], sampleSize);
+      for (size_t j = 0; j < newLists[i].size(); ++j)
+      {
+        isNew[i * k + newLists[i][j]] = 0;
+        newLists[i][j] = neighbors(newLists[i][j], i);
+      }
+    }
+
+    // Collect the reverse neighbors.
+    for (size_t i = 0; i < n; ++i)
+    {
+      oldReverse[i].clear();
+      newReverse[i].clear();
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+      for (size_t j = 0; j < oldLists[i].size(); ++j)
+        oldReverse[oldLists[i][j]].push_back(i);
+      for (size_t j = 0; j < newLists[i].size(); ++j)
+        newReverse[newLists[i][j]].push_back(i);
+    }
+
+    // Add a sample of the reverse neighbors to each list, and run the local
+    // join: each pair of points in the lists of a point, of which at least one
+    // is new, is compared.
+    size_t updates = 0;
+    size_t evaluations = 0;
+    #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 64) \
+        reduction(+:updates, evaluations)
+    for (omp_size_t i = 0; i < (omp_size_t) n; ++i)
+    {
+      std::vector<size_t> oldJoin(oldLists[i]);
+      std::vector<size_t> newJoin(newLists[i]);
+      std::vector<size_t> reverse(oldReverse[i]);
+      Sample(reverse, sampleSize);
+      oldJoin.insert(oldJoin.end(), reverse.begin(), reverse.end());
+      reverse = newReverse[i];
+      Sample(reverse, sampleSize);
+      newJoin.insert(newJoin.end(), reverse.begin(), reverse.end());
+
+      // A point can be both a neighbor and a reverse neighbor.
+      std::sort(oldJoin.begin(), oldJoin.end());
+      oldJoin.erase(std::unique(oldJoin.begin(), oldJoin.end()),
+          oldJoin.end());
+      std::sort(newJoin.begin(), newJoin.end());
+      newJoin.erase(std::unique(newJoin.begin(), newJoin.end()),
+          newJoin.end());
+
+      for (size_t a = 0; a < newJoin.size(); ++a)
+      {
+        for (size_t b = a + 1; b < newJoin.size() + oldJoin.size(); ++b)
+        {
+          const size_t u = newJoin[a];
+          const size_t v = (b < newJoin.size()) ? newJoin[b] :
+              oldJoin[b - newJoin.size()];
+          if (u == v)
+            continue;
+
+          const double distance = metric.Evaluate(dataset.col(u),
+              dataset.col(v));
+          ++evaluations;
+
+#ifdef _OPENMP
+          omp_set_lock(&locks[u % numLocks]);
+#endif
+          updates += Insert(u, v, distance, neighbors, distances, isNew);
+#ifdef _OPENMP
+          omp_unset_lock(&locks[u % numLocks]);
+          omp_set_lock(&locks[v % numLocks]);
+#endif
+          updates += Insert(v, u, distance, neighbors, distances, isNew);
+#ifdef _OPENMP
+          omp_unset_lock(&locks[v % numLocks]);
+#endif
+        }
+      }
+    }
+
+    distanceEvaluations += evaluations;
+    Log::Info << "NNDescent iteration " << iterations << ": " << updates
+        << " neighbors changed." << std::endl;
+
+    if (updates < tolerance * k * n)
+    {
+      ++iterations;
+      break;
+    }
+  }
+
+#ifdef _OPENMP
+  for (size_t i = 0; i < numLocks; ++i)
+    omp_destroy_lock(&locks[i]);
+#endif
+}
+
+template<typename MetricType>
+bool NNDescent<MetricType>::Insert(const size_t point,
+                                   const size_t neighbor,
+                                   const double distance,
+                                   arma::Mat<size_t>& neighbors,
+                                   arma::mat& distances,
+                                   std::vector<char>& isNew)
+{
+  const size_t k = neighbors.n_rows;
+  double* pointDistances = distances.colptr(point);
+  size_t* pointNeighbors = neighbors.colptr(point);
+  char* pointIsNew = &isNew[point * k];
+
+  if (distance >= pointDistances[k - 1])
+    return false;
+  for (size_t i = 0; i < k; ++i)
+    if (pointNeighbors[i] == neighbor)
+      return false;
+
+  size_t pos = k - 1;
+  while ((pos > 0) && (pointDistances[pos - 1] > distance))
+  {
+    pointDistances[pos] = pointDistances[pos - 1];
+    pointNeighbors[pos] = pointNeighbors[pos - 1];
+    pointIsNew[pos] = pointIsNew[pos - 1];
+    --pos;
+  }
+
+  pointDistances[pos] = distance;
+  pointNeighbors[pos] = neighbor;
+  pointIsNew[pos] = 1;
+  return true;
+}
+
+template<typename MetricType>
+void NNDescent<MetricType>::Sample(std::vector<size_t>& elements,
+                                   const size_t count)
+{
+  if (elements.size() <= count)
+    return;
+
+  // A partial Fisher-Yates shuffle.
+  for (size_t i = 0; i < count; ++i)
+    std::swap(elements[i], elements[i + math::RandInt(elements.size() - i)]);
+  elements.resize(count);
+}
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
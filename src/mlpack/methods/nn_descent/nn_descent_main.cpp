@@ -0,0 +1,145 @@
+/**
+ * @file nn_descent_main.cpp
+ *
+ * Executable which builds an approximate k-nearest-neighbor graph of a dataset
+ * with NN-descent.
+ */
+#include <time.h>
+
+#include <mlpack/core.hpp>
+
+#include <string>
+
+#include "nn_descent.hpp"
+
+using namespace std;
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+// Information about the program itself.
+PROGRAM_INFO("Approximate k-Nearest-Neighbor Graph with NN-descent",
+    "This program builds an approximate k-nearest-neighbor graph of a dataset: "
+    "the k nearest neighbors of each point of the dataset (excluding the point "
+    "itself).  It uses NN-descent, which starts from random neighbors and "
+    "repeatedly compares the neighbors of the neighbors of each point, and is "
+    "much faster than exact search in high dimensions."
+    "\n\n"
+    "For example, the following will find 10 neighbors of each point in "
+    "'input.csv' and store the distances in 'distances.csv' and the neighbors "
+    "in 'neighbors.csv':"
+    "\n\n"
+    "$ nn_descent -k 10 -r input.csv -d distances.csv -n neighbors.csv"
+    "\n\n"
+    "The output files are organized as those of allknn: row i and column j in "
+    "the neighbors output file is the index of the i'th nearest neighbor of "
+    "the point with index j, and row i and column j in the distances output "
+    "file is the distance between those two points."
+    "\n\n"
+    "The search can start from other approximate results instead of random "
+    "neighbors, such as the neighbors file of lsh or allkrann run on the same "
+    "dataset with no query file; give it with --initial_neighbors_file."
+    "\n\n"
+    "Because the starting neighbors and the samples are random, results may "
+    "be different from run to run.  Thus, the --seed option can be specified "
+    "to set the random seed.");
+
+// Define our input parameters that this program will take.
+PARAM_STRING_REQ("reference_file", "File containing the dataset.", "r");
+PARAM_STRING("distances_file", "File to output distances into.", "d", "");
+PARAM_STRING("neighbors_file", "File to output neighbors into.", "n", "");
+
+PARAM_INT_REQ("k", "Number of nearest neighbors to find.", "k");
+
+PARAM_STRING("initial_neighbors_file", "File containing initial neighbors of "
+    "each point (one column per point), such as the output of lsh or "
+    "allkrann.", "I", "");
+PARAM_INT("max_iterations", "Maximum number of iterations.", "m", 20);
+PARAM_DOUBLE("sample_rate", "Fraction of the new neighbors of each point that "
+    "are compared in each iteration.", "p", 1.0);
+PARAM_DOUBLE("tolerance", "Stop when fewer than tolerance * k * n neighbors "
+    "change in an iteration.", "e", 0.001);
+PARAM_INT("threads", "Number of threads to use (0 uses all available cores; "
+    "ignored if mlpack was built without OpenMP).", "t", 0);
+PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
+
+int main(int argc, char *argv[])
+{
+  // Give CLI the command line parameters the user passed in.
+  CLI::ParseCommandLine(argc, argv);
+
+  if (CLI::GetParam<int>("seed") != 0)
+    math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
+  else
+    math::RandomSeed((size_t) time(NULL));
+
+  // Get all the parameters.
+  const string referenceFile = CLI::GetParam<string>("reference_file");
+  const string distancesFile = CLI::GetParam<string>("distances_file");
+  const string neighborsFile = CLI::GetParam<string>("neighbors_file");
+  const string initialFile = CLI::GetParam<string>("initial_neighbors_file");
+
+  arma::mat referenceData;
+  data::Load(referenceFile, referenceData, true);
+
+  Log::Info << "Loaded reference data from '" << referenceFile << "' ("
+      << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
+
+  // Sanity check on k value: must be greater than 0, must be less than the
+  // number of points.
+  const int k = CLI::GetParam<int>("k");
+  if (k <= 0 || (size_t) k >= referenceData.n_cols)
+  {
+    Log::Fatal << "Invalid k: " << k << "; must be greater than 0 and less "
+        << "than the number of points (" << referenceData.n_cols << ")."
+        << endl;
+  }
+
+  if (CLI::GetParam<int>("max_iterations") < 0)
+  {
+    Log::Fatal << "Invalid number of iterations: "
+        << CLI::GetParam<int>("max_iterations") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+
+  const double sampleRate = CLI::GetParam<double>("sample_rate");
+  if (sampleRate <= 0.0 || sampleRate > 1.0)
+  {
+    Log::Fatal << "Invalid sample rate: " << sampleRate << ".  Must be greater "
+        << "than 0 and at most 1." << endl;
+  }
+
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+
+  arma::Mat<size_t> initialNeighbors;
+  if (initialFile != "")
+  {
+    data::Load(initialFile, initialNeighbors, true);
+    Log::Info << "Loaded initial neighbors from '" << initialFile << "' ("
+        << initialNeighbors.n_rows << " x " << initialNeighbors.n_cols << ")."
+        << endl;
+  }
+
+  NNDescent<> nnDescent(referenceData,
+      (size_t) CLI::GetParam<int>("max_iterations"), sampleRate,
+      CLI::GetParam<double>("tolerance"));
+  nnDescent.Threads() = (size_t) CLI::GetParam<int>("threads");
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+
+  Log::Info << "Building the " << k << "-nearest-neighbor graph..." << endl;
+  nnDescent.Build((size_t) k, initialNeighbors, neighbors, distances);
+  Log::Info << "Graph built in " << nnDescent.Iterations() << " iterations ("
+      << nnDescent.DistanceEvaluations() << " distance evaluations)." << endl;
+
+  // Save output.
+  if (distancesFile != "")
+    data::Save(distancesFile, distances);
+
+  if (neighborsFile != "")
+    data::Save(neighborsFile, neighbors);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file nystroem_cache.hpp
+ *
+ * A cache of the landmarks selected by the Nystroem method and the kernel
+ * blocks computed from them, so that they can be reused by later calls with
+ * the same dataset and kernel.
+ */
+#ifndef __MLPACK_METHODS_NYSTROEM_METHOD_NYSTROEM_CACHE_HPP
+#define __MLPACK_METHODS_NYSTROEM_METHOD_NYSTROEM_CACHE_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kernel {
+
+/**
+ * Hold the landmarks selected by the Nystroem method for a dataset, the kernel
+ * matrix between the landmarks (the mini-kernel), and the kernel matrix
+ * between every point of the dataset and the landmarks (the semi-kernel).
+ * Selecting the landmarks (for instance with k-means) and computing the
+ * semi-kernel are the expensive parts of the method, so when the same cache is
+ * given to several NystroemMethod objects (or several calls to the
+ * NystroemKernelRule of KernelPCA), only the first call does this work.
+ *
+ * If a call asks for no more landmarks than the cache holds, the first
+ * landmarks in the cache and the leading blocks of the kernel matrices are
+ * used, so an approximation of any lower rank is free once the cache has been
+ * filled.  If a call asks for more landmarks, they are selected again and the
+ * cache is refilled.  Note that a lower rank approximation from the cache uses
+ * a subset of the landmarks that were selected for the higher rank, which is
+ * not necessarily the set the selection policy would choose for the lower rank
+ * (for instance, a subset of k-means centroids instead of the centroids of a
+ * smaller clustering).
+ *
+ * The cache only checks that the size of the dataset matches, so it must not
+ * be used with a different dataset of the same size or with a different
+ * kernel; call Clear() first.
+ */
+class NystroemCache
+{
+ public:
+  //! Create an empty cache.
+  NystroemCache() { }
+
+  //! Empty the cache.
+  void Clear()
+  {
+    landmarks.reset();
+    miniKernel.reset();
+    semiKernel.reset();
+  }
+
+  //! Get the number of landmarks held by the cache.
+  size_t Rank() const { return landmarks.n_cols; }
+
+  /**
+   * Return whether the cache holds at least the given number of landmarks for
+   * a dataset of the given size.
+   *
+   * @param data Dataset the landmarks are for.
+   * @param rank Number of landmarks needed.
+   */
+  bool Holds(const arma::mat& data, const size_t rank) const
+  {
+    return (landmarks.n_cols >= rank) && (landmarks.n_rows == data.n_rows) &&
+        (semiKernel.n_rows == data.n_cols);
+  }
+
+  //! Get the landmarks (one per column).
+  const arma::mat& Landmarks() const { return landmarks; }
+  //! Modify the landmarks (one per column).
+  arma::mat& Landmarks() { return landmarks; }
+
+  //! Get the kernel matrix between the landmarks.
+  const arma::mat& MiniKernel() const { return miniKernel; }
+  //! Modify the kernel matrix between the landmarks.
+  arma::mat& MiniKernel() { return miniKernel; }
+
+  //! Get the kernel matrix between the points and the landmarks.
+  const arma::mat& SemiKernel() const { return semiKernel; }
+  //! Modify the kernel matrix between the points and the landmarks.
+  arma::mat& SemiKernel() { return semiKernel; }
+
+ private:
+  //! The selected landmarks.
+  arma::mat landmarks;
+  //! The kernel matrix between the landmarks.
+  arma::mat miniKernel;
+  //! The kernel matrix between the points and the landmarks.
+  arma::mat semiKernel;
+};
+
+}; // namespace kernel
+}; // namespace mlpack
+
+#endif
@@ -12,6 +12,7 @@
 
 #include <mlpack/core.hpp>
 #include "kmeans_selection.hpp"
+#include "nystroem_cache.hpp"
 
 namespace mlpack {
 namespace kernel {
@@ -25,17 +26,24 @@ class NystroemMethod
  public:
   /**
    * Create the NystroemMethod object. The constructor here does not really do
-   * anything.
+   * anything.  If a cache is given, the landmarks and kernel blocks it holds
+   * are used by Apply() when possible, and it is filled otherwise; see
+   * NystroemCache.  The cache must outlive this object.
    *
    * @param data Data matrix.
    * @param kernel Kernel to be used for computation.
    * @param rank Rank to be used for matrix approximation.
+   * @param cache Cache of landmarks and kernel blocks, or NULL.
    */
-  NystroemMethod(const arma::mat& data, KernelType& kernel, const size_t rank);
+  NystroemMethod(const arma::mat& data,
+                 KernelType& kernel,
+                 const size_t rank,
+                 NystroemCache* cache = NULL);
 
   /**
    * Apply the low-rank factorization to obtain an output matrix G such that
-   * K' = G * G^T.
+   * K' = G * G^T.  If the cache holds at least rank landmarks for the data,
+   * no landmarks are selected and no kernel evaluations are done.
    *
    * @param output Matrix to store kernel approximation into.
    */
@@ -63,13 +71,32 @@ class NystroemMethod
                        arma::mat& miniKernel, 
                        arma::mat& semiKernel);
 
+  //! Get the cache of landmarks and kernel blocks (NULL if none is used).
+  NystroemCache* Cache() const { return cache; }
+  //! Modify the cache of landmarks and kernel blocks (NULL if none is used).
+  NystroemCache*& Cache() { return cache; }
+
  private:
+  //! Store the selected points in the given matrix, and delete them.
+  void GetLandmarks(const arma::mat* selectedData, arma::mat& landmarks);
+
+  //! Store the points with the selected indices in the given matrix.
+  void GetLandmarks(const arma::Col<size_t>& selectedPoints,
+                    arma::mat& landmarks);
+
+  //! Compute the output matrix from the mini-kernel and semi-kernel matrices.
+  void Factorize(const arma::mat& miniKernel,
+                 const arma::mat& semiKernel,
+                 arma::mat& output);
+
   //! The reference dataset.
   const arma::mat& data;
   //! The locally stored kernel, if it is necessary.
   KernelType& kernel;
   //! Rank used for matrix approximation.
   const size_t rank;
+  //! The cache of landmarks and kernel blocks, or NULL.
+  NystroemCache* cache;
 };
 
 }; // namespace kernel
@@ -11,6 +11,8 @@
 // In case it hasn't been included yet.
 #include "nystroem_method.hpp"
 
+#include <mlpack/core/kernels/kernel_matrix.hpp>
+
 namespace mlpack {
 namespace kernel {
 
@@ -18,10 +20,12 @@ template<typename KernelType, typename PointSelectionPolicy>
 NystroemMethod<KernelType, PointSelectionPolicy>::NystroemMethod(
     const arma::mat& data,
     KernelType& kernel,
-    const size_t rank) :
+    const size_t rank,
+    NystroemCache* cache) :
     data(data),
     kernel(kernel),
-    rank(rank)
+    rank(rank),
+    cache(cache)
 { }
 
 template<typename KernelType, typename PointSelectionPolicy>
@@ -31,17 +35,12 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
     arma::mat& semiKernel)
 {
   // Assemble mini-kernel matrix.
-  for (size_t i = 0; i < rank; ++i)
-    for (size_t j = 0; j < rank; ++j)
-      miniKernel(i, j) = kernel.Evaluate(selectedData->col(i),
-                                         selectedData->col(j));
+  KernelMatrix(kernel, *selectedData, miniKernel);
 
   // Construct semi-kernel matrix with interactions between selected data and
   // all points.
-  for (size_t i = 0; i < data.n_cols; ++i)
-    for (size_t j = 0; j < rank; ++j)
-      semiKernel(i, j) = kernel.Evaluate(data.col(i), 
-                                         selectedData->col(j));
+  KernelMatrix(kernel, data, *selectedData, semiKernel);
+
   // Clean the memory.
   delete selectedData;
 }
@@ -52,29 +51,78 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
     arma::mat& miniKernel,
     arma::mat& semiKernel)
 {
-  // Assemble mini-kernel matrix.
+  arma::mat selectedData(data.n_rows, rank);
   for (size_t i = 0; i < rank; ++i)
-    for (size_t j = 0; j < rank; ++j)
-      miniKernel(i, j) = kernel.Evaluate(data.col(selectedPoints(i)),
-                                         data.col(selectedPoints(j)));
+    selectedData.col(i) = data.col(selectedPoints(i));
+
+  // Assemble mini-kernel matrix.
+  KernelMatrix(kernel, selectedData, miniKernel);
 
   // Construct semi-kernel matrix with interactions between selected points and
   // all points.
-  for (size_t i = 0; i < data.n_cols; ++i)
-    for (size_t j = 0; j < rank; ++j)
-      semiKernel(i, j) = kernel.Evaluate(data.col(i),
-                                         data.col(selectedPoints(j)));
+  KernelMatrix(kernel, data, selectedData, semiKernel);
+}
+
+template<typename KernelType, typename PointSelectionPolicy>
+void NystroemMethod<KernelType, PointSelectionPolicy>::GetLandmarks(
+    const arma::mat* selectedData,
+    arma::mat& landmarks)
+{
+  landmarks = *selectedData;
+
+  // Clean the memory.
+  delete selectedData;
+}
+
+template<typename KernelType, typename PointSelectionPolicy>
+void NystroemMethod<KernelType, PointSelectionPolicy>::GetLandmarks(
+    const arma::Col<size_t>& selectedPoints,
+    arma::mat& landmarks)
+{
+  landmarks.set_size(data.n_rows, rank);
+  for (size_t i = 0; i < rank; ++i)
+    landmarks.col(i) = data.col(selectedPoints(i));
 }
 
 template<typename KernelType, typename PointSelectionPolicy>
 void NystroemMethod<KernelType, PointSelectionPolicy>::Apply(arma::mat& output)
 {
-  arma::mat miniKernel(rank, rank);
-  arma::mat semiKernel(data.n_cols, rank);
+  if (cache == NULL)
+  {
+    arma::mat miniKernel(rank, rank);
+    arma::mat semiKernel(data.n_cols, rank);
 
-  GetKernelMatrix(PointSelectionPolicy::Select(data, rank), miniKernel,
-                  semiKernel);
+    GetKernelMatrix(PointSelectionPolicy::Select(data, rank), miniKernel,
+                    semiKernel);
 
+    Factorize(miniKernel, semiKernel, output);
+    return;
+  }
+
+  // Select the landmarks and compute the kernel blocks, unless the cache
+  // already holds enough of them.
+  if (!cache->Holds(data, rank))
+  {
+    cache->Clear();
+    GetLandmarks(PointSelectionPolicy::Select(data, rank), cache->Landmarks());
+    KernelMatrix(kernel, cache->Landmarks(), cache->MiniKernel());
+    KernelMatrix(kernel, data, cache->Landmarks(), cache->SemiKernel());
+  }
+
+  // Use the leading blocks if the cache holds more landmarks than needed.
+  if (cache->Rank() == rank)
+    Factorize(cache->MiniKernel(), cache->SemiKernel(), output);
+  else
+    Factorize(cache->MiniKernel().submat(0, 0, rank - 1, rank - 1),
+        cache->SemiKernel().cols(0, rank - 1), output);
+}
+
+template<typename KernelType, typename PointSelectionPolicy>
+void NystroemMethod<KernelType, PointSelectionPolicy>::Factorize(
+    const arma::mat& miniKernel,
+    const arma::mat& semiKernel,
+    arma::mat& output)
+{
   // Singular value decomposition mini-kernel matrix.
   arma::mat U, V;
   arma::vec s;
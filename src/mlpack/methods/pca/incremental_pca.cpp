@@ -0,0 +1,107 @@
+/**
+ * @file incremental_pca.cpp
+ *
+ * Implementation of the IncrementalPCA class.
+ */
+#include "incremental_pca.hpp"
+
+using namespace std;
+using namespace mlpack;
+using namespace mlpack::pca;
+
+IncrementalPCA::IncrementalPCA(const size_t rank) :
+    rank(rank),
+    points(0)
+{
+  if (rank == 0)
+    Log::Fatal << "IncrementalPCA::IncrementalPCA(): rank cannot be zero!"
+        << endl;
+}
+
+void IncrementalPCA::Update(const arma::mat& block)
+{
+  if (block.n_cols == 0)
+    return;
+
+  if ((points > 0) && (block.n_rows != mean.n_elem))
+  {
+    Log::Fatal << "IncrementalPCA::Update(): the block has " << block.n_rows
+        << " dimensions, but earlier blocks had " << mean.n_elem << "!"
+        << endl;
+  }
+
+  Timer::Start("pca");
+
+  const size_t newPoints = points + block.n_cols;
+  const arma::vec blockMean = arma::mean(block, 1);
+
+  // The scatter matrix of all the points seen so far is approximated by
+  //   V S^2 V^T + C C^T + (n m / (n + m)) (mean - blockMean)(...)^T,
+  // where C is the centered block; so it is the outer product of the matrix
+  // below with itself.
+  arma::mat stacked(block.n_rows, singularValues.n_elem + block.n_cols +
+      ((points > 0) ? 1 : 0));
+  if (singularValues.n_elem > 0)
+  {
+    stacked.cols(0, singularValues.n_elem - 1) = eigvec *
+        arma::diagmat(singularValues);
+  }
+
+  arma::mat centered = block;
+  centered.each_col() -= blockMean;
+  stacked.cols(singularValues.n_elem, singularValues.n_elem + block.n_cols -
+      1) = centered;
+
+  if (points > 0)
+  {
+    stacked.col(stacked.n_cols - 1) = std::sqrt(double(points) * block.n_cols /
+        newPoints) * (mean - blockMean);
+    mean = (points * mean + block.n_cols * blockMean) / newPoints;
+  }
+  else
+  {
+    mean = blockMean;
+  }
+
+  arma::mat u, v;
+  arma::vec s;
+  arma::svd_econ(u, s, v, stacked, 'l');
+
+  const size_t kept = std::min(rank, (size_t) s.n_elem);
+  eigvec = u.cols(0, kept - 1);
+  singularValues = s.subvec(0, kept - 1);
+  points = newPoints;
+
+  Timer::Stop("pca");
+}
+
+void IncrementalPCA::Transform(const arma::mat& data,
+                               arma::mat& transformedData) const
+{
+  if (points == 0)
+    Log::Fatal << "IncrementalPCA::Transform(): no data has been given to "
+        << "Update()!" << endl;
+
+  arma::mat centered = data;
+  centered.each_col() -= mean;
+  transformedData = arma::trans(eigvec) * centered;
+}
+
+arma::vec IncrementalPCA::EigenValues() const
+{
+  // The covariance matrix is X * X' / (N - 1).
+  if (points < 2)
+    return arma::zeros<arma::vec>(singularValues.n_elem);
+
+  return (singularValues % singularValues) / (points - 1);
+}
+
+std::string IncrementalPCA::ToString() const
+{
+  std::ostringstream convert;
+  convert << "Incremental Principal Component Analysis [" << this << "]"
+      << std::endl;
+  convert << "  Rank: " << rank << std::endl;
+  convert << "  Points: " << points << std::endl;
+  return convert.str();
+}
@@ -0,0 +1,118 @@
+/**
+ * @file incremental_pca.hpp
+ *
+ * Defines the IncrementalPCA class, which computes the principal components of
+ * a dataset one block of points at a time.
+ */
+#ifndef __MLPACK_METHODS_PCA_INCREMENTAL_PCA_HPP
+#define __MLPACK_METHODS_PCA_INCREMENTAL_PCA_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace pca {
+
+/**
+ * This class computes the largest principal components of a dataset which is
+ * given one block of points at a time, so that the whole dataset never has to
+ * be in memory.  Only the mean and the rank largest principal components (with
+ * their singular values) are stored; each call to Update() combines them with
+ * the new block, in time and memory linear in the dimensionality.  This is the
+ * incremental SVD of Ross et al., with the mean update that keeps the result
+ * the same as that of PCA on the whole dataset when no components are
+ * truncated:
+ *
+ * @code
+ * @article{ross2008incremental,
+ *   title={Incremental learning for robust visual tracking},
+ *   author={Ross, D. A. and Lim, J. and Lin, R.-S. and Yang, M.-H.},
+ *   journal={International Journal of Computer Vision},
+ *   volume={77},
+ *   number={1--3},
+ *   pages={125--141},
+ *   year={2008}
+ * }
+ * @endcode
+ *
+ * If the data has more than rank significant components, the components found
+ * are approximate; the approximation is better with larger blocks.  An example
+ * of use is below:
+ *
+ * @code
+ * IncrementalPCA pca(50); // Keep 50 components.
+ * for (size_t i = 0; i < blocks; ++i)
+ *   pca.Update(block[i]);
+ *
+ * arma::mat transformedData;
+ * pca.Transform(data, transformedData);
+ * @endcode
+ */
+class IncrementalPCA
+{
+ public:
+  /**
+   * Create the IncrementalPCA object, which will keep the given number of
+   * principal components.
+   *
+   * @param rank Number of principal components to keep.
+   */
+  IncrementalPCA(const size_t rank);
+
+  /**
+   * Update the principal components with a block of points.  Every block must
+   * have the same dimensionality.
+   *
+   * @param block Matrix of points (one point per column).
+   */
+  void Update(const arma::mat& block);
+
+  /**
+   * Project the given data onto the principal components found so far.  It is
+   * safe to pass the same matrix reference for both data and transformedData.
+   *
+   * @param data Data matrix.
+   * @param transformedData Matrix to store the projected data in.
+   */
+  void Transform(const arma::mat& data, arma::mat& transformedData) const;
+
+  //! Get the number of principal components to keep.
+  size_t Rank() const { return rank; }
+
+  //! Get the number of points seen so far.
+  size_t Points() const { return points; }
+
+  //! Get the mean of the points seen so far.
+  const arma::vec& Mean() const { return mean; }
+
+  //! Get the principal components found so far (one per column).
+  const arma::mat& EigenVectors() const { return eigvec; }
+
+  //! Get the eigenvalues (variances) of the principal components found so far.
+  arma::vec EigenValues() const;
+
+  // Returns a string representation of this object.
+  std::string ToString() const;
+
+ private:
+  //! The number of principal components to keep.
+  size_t rank;
+
+  //! The number of points seen so far.
+  size_t points;
+
+  //! The mean of the points seen so far.
+  arma::vec mean;
+
+  //! The principal components found so far.
+  arma::mat eigvec;
+
+  //! The singular values of the centered data that correspond to each
+  //! principal component.
+  arma::vec singularValues;
+
+}; // class IncrementalPCA
+
+}; // namespace pca
+}; // namespace mlpack
+
+#endif
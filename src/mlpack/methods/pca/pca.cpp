@@ -13,7 +13,10 @@ using namespace mlpack;
 using namespace mlpack::pca;
 
 PCA::PCA(const bool scaleData) :
-    scaleData(scaleData)
+    scaleData(scaleData),
+    randomized(false),
+    oversampling(10),
+    powerIterations(2)
 { }
 
 /**
@@ -31,6 +34,63 @@ void PCA::Apply(const arma::mat& data,
 {
   Timer::Start("pca");
 
+  // When there are more points than dimensions, the eigenvectors of the
+  // covariance matrix are found directly.  The centered data is never formed:
+  // the covariance and the mean are accumulated in one blocked pass, and the
+  // centering is folded into the projection.
+  if (data.n_rows < data.n_cols)
+  {
+    arma::mat covariance;
+    arma::vec mean;
+    math::Covariance(data, covariance, mean);
+
+    arma::vec stdDev;
+    if (scaleData)
+    {
+      // Scaling the data is when we reduce the variance of each dimension to
+      // 1.  We do this by dividing each dimension by its standard deviation,
+      // which scales the covariance by the standard deviations of both of its
+      // dimensions.
+      stdDev = arma::sqrt(covariance.diag());
+
+      // If there are any zeroes, make them very small.
+      for (size_t i = 0; i < stdDev.n_elem; ++i)
+        if (stdDev[i] == 0)
+          stdDev[i] = 1e-50;
+
+      covariance /= stdDev * arma::trans(stdDev);
+    }
+
+    arma::eig_sym(eigVal, coeff, covariance);
+
+    // Swap the eigenvalues and eigenvectors since they are ordered backwards
+    // (we need largest to smallest).
+    for (size_t i = 0; i < eigVal.n_elem / 2; ++i)
+    {
+      eigVal.swap_rows(i, (eigVal.n_elem - 1) - i);
+      coeff.swap_cols(i, (coeff.n_cols - 1) - i);
+    }
+
+    // Rounding can make eigenvalues which should be zero slightly negative.
+    for (size_t i = 0; i < eigVal.n_elem; ++i)
+      if (eigVal[i] < 0)
+        eigVal[i] = 0;
+
+    // Project the samples to the principals: coeff' * D^-1 (X - mean), where D
+    // holds the standard deviations (if we are scaling).  It is safe for
+    // transformedData to be the same matrix as data here.
+    arma::mat projection = coeff;
+    if (scaleData)
+      projection.each_col() /= stdDev;
+
+    const arma::vec projectedMean = arma::trans(projection) * mean;
+    transformedData = arma::trans(projection) * data;
+    transformedData.each_col() -= projectedMean;
+
+    Timer::Stop("pca");
+    return;
+  }
+
   // This matrix will store the right singular values; we do not need them.
   arma::mat v;
 
@@ -52,18 +112,9 @@ void PCA::Apply(const arma::mat& data,
     centeredData /= arma::repmat(stdDev, 1, centeredData.n_cols);
   }
 
-  // Do singular value decomposition.  Use the economical singular value
-  // decomposition if the columns are much larger than the rows.
-  if (data.n_rows < data.n_cols)
-  {
-    // Do economical singular value decomposition and compute only the left
-    // singular vectors.
-    arma::svd_econ(coeff, eigVal, v, centeredData, 'l');
-  }
-  else
-  {
-    arma::svd(coeff, eigVal, v, centeredData);
-  }
+  // Do singular value decomposition.  There are at least as many dimensions as
+  // points, so the centered copy is no bigger than the decomposition itself.
+  arma::svd(coeff, eigVal, v, centeredData);
 
   // Now we must square the singular values to get the eigenvalues.
   // In addition we must divide by the number of points, because the covariance
@@ -113,6 +164,9 @@ double PCA::Apply(arma::mat& data, const size_t newDimension) const
         << "be greater than the existing dimensionality of the data ("
         << data.n_rows << ")!" << endl;
 
+  if (randomized)
+    return RandomizedApply(data, newDimension);
+
   arma::mat coeffs;
   arma::vec eigVal;
 
@@ -172,6 +226,90 @@ double PCA::Apply(arma::mat& data, const double varRetained) const
   return varSum;
 }
 
+/**
+ * Reduce the dimensionality of the data with randomized PCA.  Let A be the
+ * centered (and possibly scaled) data.  A basis Q for the range of A is found
+ * by multiplying A with a random matrix (followed by a few power iterations, to
+ * sharpen the spectrum), and then the small matrix Q^T A is decomposed exactly.
+ */
+double PCA::RandomizedApply(arma::mat& data, const size_t newDimension) const
+{
+  Timer::Start("pca");
+
+  // A = D^-1 (X - mean 1^T), where D holds the standard deviations of each
+  // dimension (or is the identity if we are not scaling).
+  const arma::vec mean = arma::mean(data, 1);
+  arma::vec variances = arma::var(data, 0, 1 /* for each dimension */);
+  arma::vec invStdDev;
+  if (scaleData)
+  {
+    invStdDev = arma::sqrt(variances);
+
+    // If there are any zeroes, make them very small.
+    for (size_t i = 0; i < invStdDev.n_elem; ++i)
+    {
+      if (invStdDev[i] == 0)
+        invStdDev[i] = 1e-50;
+      else
+        variances[i] = 1.0;
+    }
+
+    invStdDev = 1.0 / invStdDev;
+  }
+  const double totalVariance = arma::accu(variances);
+
+  const size_t samples = std::min(newDimension + oversampling,
+      (size_t) std::min(data.n_rows, data.n_cols));
+
+  // Y = A * omega, for a Gaussian random matrix omega.
+  arma::mat omega = arma::randn<arma::mat>(data.n_cols, samples);
+  arma::mat y = data * omega - mean * arma::sum(omega, 0);
+  if (scaleData)
+    y.each_col() %= invStdDev;
+
+  arma::mat q, r;
+  for (size_t i = 0; i < powerIterations; ++i)
+  {
+    // Y = A A^T Q, orthonormalizing in between for stability.
+    arma::qr_econ(q, r, y);
+    if (scaleData)
+      q.each_col() %= invStdDev;
+
+    arma::mat z = arma::trans(data) * q;
+    z.each_row() -= arma::trans(mean) * q;
+    arma::qr_econ(q, r, z);
+
+    y = data * q - mean * arma::sum(q, 0);
+    if (scaleData)
+      y.each_col() %= invStdDev;
+  }
+  arma::qr_econ(q, r, y);
+
+  // B = Q^T A is small; its singular value decomposition gives the principal
+  // components.
+  if (scaleData)
+    q.each_col() %= invStdDev;
+  arma::mat b = arma::trans(q) * data;
+  b.each_col() -= arma::trans(q) * mean;
+
+  arma::mat u, v;
+  arma::vec eigVal;
+  arma::svd_econ(u, eigVal, v, b, 'l');
+
+  // Now we must square the singular values to get the eigenvalues.
+  eigVal %= eigVal / (data.n_cols - 1);
+
+  // Project the samples to the principal components.  Because the columns of
+  // Q span the columns of A, U^T Q^T A = U^T B.
+  const size_t dimensions = std::min(newDimension, (size_t) u.n_cols);
+  data = arma::trans(u.cols(0, dimensions - 1)) * b;
+
+  Timer::Stop("pca");
+
+  // Calculate the total amount of variance retained.
+  return arma::accu(eigVal.subvec(0, dimensions - 1)) / totalVariance;
+}
+
 // return a string of this object.
 std::string PCA::ToString() const
 {
@@ -179,5 +317,11 @@ std::string PCA::ToString() const
   convert << "Principal Component Analysis  [" << this << "]" << std::endl;
   if (scaleData)  
     convert << "  Scaling Data: TRUE" << std::endl;
+  if (randomized)
+  {
+    convert << "  Randomized: TRUE" << std::endl;
+    convert << "  Oversampling: " << oversampling << std::endl;
+    convert << "  Power Iterations: " << powerIterations << std::endl;
+  }
   return convert.str();
 }
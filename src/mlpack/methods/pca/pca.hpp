@@ -19,6 +19,27 @@ namespace pca {
  * or transforming data into a better basis.  Further information on PCA can be
  * found in almost any statistics or machine learning textbook, and all over the
  * internet.
+ *
+ * When only a few principal components are kept, Randomized() may be set so
+ * that Apply(data, newDimension) uses a randomized range finder instead of a
+ * full singular value decomposition:
+ *
+ * @code
+ * @article{halko2011finding,
+ *   title={Finding structure with randomness: Probabilistic algorithms for
+ *       constructing approximate matrix decompositions},
+ *   author={Halko, N. and Martinsson, P.-G. and Tropp, J. A.},
+ *   journal={SIAM Review},
+ *   volume={53},
+ *   number={2},
+ *   pages={217--288},
+ *   year={2011}
+ * }
+ * @endcode
+ *
+ * The data is then never copied or centered explicitly, and the running time
+ * is linear in the number of components kept.  For data that does not fit in
+ * memory, see IncrementalPCA.
  */
 class PCA
 {
@@ -64,6 +85,9 @@ class PCA
    * retained; this is a value between 0 and 1.  For instance, a value of 0.9
    * indicates that 90% of the variance present in the data was retained.
    *
+   * If Randomized() is true, the principal components are found approximately
+   * with a randomized range finder.
+   *
    * @param data Data matrix.
    * @param newDimension New dimension of the data.
    * @return Amount of the variance of the data retained (between 0 and 1).
@@ -100,6 +124,23 @@ class PCA
   //! the data when PCA is performed.
   bool& ScaleData() { return scaleData; }
 
+  //! Get whether or not Apply(data, newDimension) uses randomized PCA.
+  bool Randomized() const { return randomized; }
+  //! Modify whether or not Apply(data, newDimension) uses randomized PCA.
+  bool& Randomized() { return randomized; }
+
+  //! Get the number of extra dimensions sampled by randomized PCA.
+  size_t Oversampling() const { return oversampling; }
+  //! Modify the number of extra dimensions sampled by randomized PCA.
+  size_t& Oversampling() { return oversampling; }
+
+  //! Get the number of power iterations performed by randomized PCA.
+  size_t PowerIterations() const { return powerIterations; }
+  //! Modify the number of power iterations performed by randomized PCA (more
+  //! iterations are slower, but more accurate when the spectrum decays
+  //! slowly).
+  size_t& PowerIterations() { return powerIterations; }
+
   // Returns a string representation of this object. 
   std::string ToString() const;
 
@@ -108,6 +149,26 @@ class PCA
   //! performed.
   bool scaleData;
 
+  //! Whether or not to use randomized PCA for Apply(data, newDimension).
+  bool randomized;
+
+  //! Number of extra dimensions sampled by randomized PCA.
+  size_t oversampling;
+
+  //! Number of power iterations performed by randomized PCA.
+  size_t powerIterations;
+
+  /**
+   * Reduce the dimensionality of the data with randomized PCA.  The
+   * (possibly scaled) centered data is never formed; each product with it is
+   * computed from the data and its mean.
+   *
+   * @param data Data matrix.
+   * @param newDimension New dimension of the data.
+   * @return Amount of the variance of the data retained (between 0 and 1).
+   */
+  double RandomizedApply(arma::mat& data, const size_t newDimension) const;
+
 }; // class PCA
 
 }; // namespace pca
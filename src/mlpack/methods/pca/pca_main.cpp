@@ -17,7 +17,12 @@ PROGRAM_INFO("Principal Components Analysis", "This program performs principal "
     "components analysis on the given dataset.  It will transform the data "
     "onto its principal components, optionally performing dimensionality "
     "reduction by ignoring the principal components with the smallest "
-    "eigenvalues.");
+    "eigenvalues.\n"
+    "\n"
+    "If --randomized is specified along with --new_dimensionality, the "
+    "principal components are found approximately with a randomized range "
+    "finder, which is much faster than a full decomposition when few "
+    "dimensions are kept.");
 
 // Parameters for program.
 PARAM_STRING_REQ("input_file", "Input dataset to perform PCA on.", "i");
@@ -30,6 +35,10 @@ PARAM_DOUBLE("var_to_retain", "Amount of variance to retain; should be between "
 PARAM_FLAG("scale", "If set, the data will be scaled before running PCA, such "
     "that the variance of each feature is 1.", "s");
 
+PARAM_FLAG("randomized", "If set, use randomized PCA (this requires -d).", "r");
+PARAM_INT("power_iterations", "Number of power iterations for randomized PCA.",
+    "P", 2);
+
 int main(int argc, char** argv)
 {
   // Parse commandline.
@@ -59,6 +68,19 @@ int main(int argc, char** argv)
 
   // Perform PCA.
   PCA p(scale);
+
+  if (CLI::HasParam("randomized"))
+  {
+    if (CLI::GetParam<int>("new_dimensionality") == 0)
+      Log::Fatal << "--randomized requires --new_dimensionality (-d)." << endl;
+    if (CLI::GetParam<int>("power_iterations") < 0)
+      Log::Fatal << "Invalid number of power iterations ("
+          << CLI::GetParam<int>("power_iterations") << ")!  Must be greater "
+          << "than or equal to 0." << endl;
+
+    p.Randomized() = true;
+    p.PowerIterations() = (size_t) CLI::GetParam<int>("power_iterations");
+  }
   Log::Info << "Performing PCA on dataset..." << endl;
   double varRetained;
   if (CLI::GetParam<double>("var_to_retain") != 0)
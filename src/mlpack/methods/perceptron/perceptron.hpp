@@ -21,6 +21,12 @@ namespace perceptron {
  * network).  It converges if the supplied training dataset is linearly
  * separable.
  *
+ * Training can optionally be split into several shards of the data, which are
+ * trained on in parallel with iterative parameter mixing (McDonald, Hall and
+ * Mann, 2010): in each iteration, every shard makes one pass over its points
+ * starting from the current weights, and the weights of the shards are then
+ * averaged.  This also converges for linearly separable data.
+ *
  * @tparam LearnPolicy Options of SimpleWeightUpdate and GradientDescent.
  * @tparam WeightInitializationPolicy Option of ZeroInitialization and
  *      RandomInitialization.
@@ -40,12 +46,20 @@ class Perceptron
    * @param labels Labels of dataset.
    * @param iterations Maximum number of iterations for the perceptron learning
    *     algorithm.
+   * @param shards Number of shards of the data to train on in parallel with
+   *     parameter mixing; 1 trains the ordinary sequential perceptron, and 0
+   *     uses one shard for each available core.
    */
-  Perceptron(const MatType& data, const arma::Row<size_t>& labels, int iterations);
+  Perceptron(const MatType& data,
+             const arma::Row<size_t>& labels,
+             int iterations,
+             const size_t shards = 1);
 
   /**
    * Classification function. After training, use the weightVectors matrix to
-   * classify test, and put the predicted classes in predictedLabels.
+   * classify test, and put the predicted classes in predictedLabels.  The
+   * test points are scored in blocks with a single matrix product each, and
+   * the blocks are split between threads.
    *
    * @param test Testing data or data to classify.
    * @param predictedLabels Vector to store the predicted classes after
@@ -55,7 +69,7 @@ class Perceptron
 
   /**
    *  Alternate constructor which copies parameters from an already initiated 
-   *  perceptron.
+   *  perceptron (including the number of shards).
    *  
    *  @param other The other initiated Perceptron object from which we copy the
    *               values from.
@@ -69,6 +83,9 @@ private:
   //! To store the number of iterations
   size_t iter;
 
+  //! Number of shards trained on in parallel (0 means one per core).
+  size_t shards;
+
   //! Stores the class labels for the input data.
   arma::Row<size_t> classLabels;
 
@@ -84,6 +101,21 @@ private:
    *  @param D Cost matrix. Stores the cost of mispredicting instances
    */
   void Train(const arma::rowvec& D);
+
+  /**
+   * Make one pass of the perceptron learning algorithm over the training points
+   * in [begin, end), updating the given weights.
+   *
+   * @param weights Weight vectors to update.
+   * @param begin Index of the first point to train on.
+   * @param end One past the index of the last point to train on.
+   * @param D Cost matrix. Stores the cost of mispredicting instances
+   * @return Whether every point was already classified correctly.
+   */
+  bool TrainPass(arma::mat& weights,
+                 const size_t begin,
+                 const size_t end,
+                 const arma::rowvec& D) const;
 };
 
 } // namespace perceptron
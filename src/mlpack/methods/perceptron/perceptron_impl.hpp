@@ -22,6 +22,8 @@ namespace perceptron {
  * @param labels Labels of dataset.
  * @param iterations Maximum number of iterations for the perceptron learning
  *      algorithm.
+ * @param shards Number of shards to train on in parallel (0 means one per
+ *      core).
  */
 template<
     typename LearnPolicy,
@@ -31,7 +33,9 @@ template<
 Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::Perceptron(
     const MatType& data,
     const arma::Row<size_t>& labels,
-    int iterations)
+    int iterations,
+    const size_t shards) :
+    shards(shards)
 {
   WeightInitializationPolicy WIP;
   WIP.Initialize(weightVectors, arma::max(labels) + 1, data.n_rows + 1);
@@ -66,16 +70,27 @@ void Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::Classify(
     const MatType& test,
     arma::Row<size_t>& predictedLabels)
 {
-  arma::mat tempLabelMat;
-  arma::uword maxIndexRow, maxIndexCol;
+  // Score the points a block at a time, so that the scores never take more
+  // than (classes x blockSize) memory per thread.
+  const size_t blockSize = 1024;
+  const size_t numBlocks = (test.n_cols + blockSize - 1) / blockSize;
 
-  for (size_t i = 0; i < test.n_cols; i++)
+  #pragma omp parallel for schedule(dynamic)
+  for (omp_size_t block = 0; block < (omp_size_t) numBlocks; ++block)
   {
-    tempLabelMat = weightVectors.submat(0, 1, weightVectors.n_rows - 1,
-                                        weightVectors.n_cols - 1) * 
-                                        test.col(i) + weightVectors.col(0);
-    tempLabelMat.max(maxIndexRow, maxIndexCol);
-    predictedLabels(0, i) = maxIndexRow;
+    const size_t begin = block * blockSize;
+    const size_t end = std::min((size_t) test.n_cols, begin + blockSize);
+
+    arma::mat tempLabelMat = weightVectors.cols(1, weightVectors.n_cols - 1) *
+        test.cols(begin, end - 1);
+    tempLabelMat.each_col() += weightVectors.col(0);
+
+    arma::uword maxIndexRow;
+    for (size_t i = begin; i < end; i++)
+    {
+      tempLabelMat.unsafe_col(i - begin).max(maxIndexRow);
+      predictedLabels(0, i) = maxIndexRow;
+    }
   }
   // predictedLabels.print("These are the labels predicted by the perceptron");
 }
@@ -98,6 +113,7 @@ Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::Perceptron(
   classLabels = labels;
   trainData = data;
   iter = other.iter;
+  shards = other.shards;
 
   // Insert a row of ones at the top of the training data set.
   MatType zOnes(1, data.n_cols);
@@ -123,43 +139,98 @@ template<
 void Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::Train(
      const arma::rowvec& D)
 {
-  size_t j, i = 0;
+  size_t i = 0;
   bool converged = false;
-  size_t tempLabel;
-  arma::uword maxIndexRow, maxIndexCol;
-  arma::mat tempLabelMat;
 
-  LearnPolicy LP;
+#ifdef _OPENMP
+  const size_t numShards = std::min((size_t) trainData.n_cols, (shards == 0) ?
+      (size_t) omp_get_max_threads() : shards);
+#else
+  const size_t numShards = std::min((size_t) trainData.n_cols, (shards == 0) ?
+      1 : shards);
+#endif
 
   while ((i < iter) && (!converged))
   {
     // This outer loop is for each iteration, and we use the 'converged'
     // variable for noting whether or not convergence has been reached.
     i++;
+
+    if (numShards <= 1)
+    {
+      converged = TrainPass(weightVectors, 0, trainData.n_cols, D);
+      continue;
+    }
+
+    // Train each shard from the current weights, then mix their weights.  The
+    // shards are fixed, so the result does not depend on the number of threads.
+    std::vector<arma::mat> shardWeights(numShards, weightVectors);
+    std::vector<char> shardConverged(numShards);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (omp_size_t s = 0; s < (omp_size_t) numShards; ++s)
+    {
+      const size_t begin = (s * trainData.n_cols) / numShards;
+      const size_t end = ((s + 1) * trainData.n_cols) / numShards;
+      shardConverged[s] = TrainPass(shardWeights[s], begin, end, D);
+    }
+
     converged = true;
+    weightVectors.zeros();
+    for (size_t s = 0; s < numShards; ++s)
+    {
+      weightVectors += shardWeights[s];
+      converged = converged && shardConverged[s];
+    }
+    weightVectors /= numShards;
+  }
+}
 
-    // Now this inner loop is for going through the dataset in each iteration.
-    for (j = 0; j < trainData.n_cols; j++)
+/**
+ * Make one pass of the perceptron learning algorithm over the training points
+ * in [begin, end).
+ */
+template<
+    typename LearnPolicy,
+    typename WeightInitializationPolicy,
+    typename MatType
+>
+bool Perceptron<LearnPolicy, WeightInitializationPolicy, MatType>::TrainPass(
+    arma::mat& weights,
+    const size_t begin,
+    const size_t end,
+    const arma::rowvec& D) const
+{
+  bool converged = true;
+  size_t tempLabel;
+  arma::uword maxIndexRow, maxIndexCol;
+  arma::mat tempLabelMat;
+
+  LearnPolicy LP;
+
+  // Now this inner loop is for going through the dataset in each iteration.
+  for (size_t j = begin; j < end; j++)
+  {
+    // Multiply for each variable and check whether the current weight vector
+    // correctly classifies this.
+    tempLabelMat = weights * trainData.col(j);
+
+    tempLabelMat.max(maxIndexRow, maxIndexCol);
+
+    // Check whether prediction is correct.
+    if (maxIndexRow != classLabels(0, j))
     {
-      // Multiply for each variable and check whether the current weight vector
-      // correctly classifies this.
-      tempLabelMat = weightVectors * trainData.col(j);
-
-      tempLabelMat.max(maxIndexRow, maxIndexCol);
-      
-      // Check whether prediction is correct.
-      if (maxIndexRow != classLabels(0, j))
-      {
-        // Due to incorrect prediction, convergence set to false.
-        converged = false;
-        tempLabel = classLabels(0, j);
-        // Send maxIndexRow for knowing which weight to update, send j to know
-        // the value of the vector to update it with.  Send tempLabel to know
-        // the correct class.
-        LP.UpdateWeights(trainData, weightVectors, j, tempLabel, maxIndexRow, D);
-      }
+      // Due to incorrect prediction, convergence set to false.
+      converged = false;
+      tempLabel = classLabels(0, j);
+      // Send maxIndexRow for knowing which weight to update, send j to know
+      // the value of the vector to update it with.  Send tempLabel to know
+      // the correct class.
+      LP.UpdateWeights(trainData, weights, j, tempLabel, maxIndexRow, D);
     }
   }
+
+  return converged;
 }
 
 }; // namespace perceptron
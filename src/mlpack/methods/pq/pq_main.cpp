@@ -0,0 +1,202 @@
+/**
+ * @file pq_main.cpp
+ *
+ * Executable which computes approximate nearest neighbors with a product
+ * quantization index.
+ */
+#include <time.h>
+
+#include <mlpack/core.hpp>
+
+#include <string>
+
+#include "pq_search.hpp"
+
+using namespace std;
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+// Information about the program itself.
+PROGRAM_INFO("All K-Approximate-Nearest-Neighbor Search with Product "
+    "Quantization",
+    "This program will calculate the k approximate-nearest-neighbors of a set "
+    "of points using product quantization.  The reference points are "
+    "compressed to one byte per subquantizer (--subquantizers), and the "
+    "distances to the query points are estimated from the compressed points.  "
+    "You may specify a separate set of reference points and query points, or "
+    "just a reference set which will be used as both the reference and query "
+    "set (in which case each point will usually be its own nearest neighbor)."
+    "\n\n"
+    "For example, the following will return 5 neighbors from the data for each "
+    "point in 'input.csv' and store the distances in 'distances.csv' and the "
+    "neighbors in the file 'neighbors.csv':"
+    "\n\n"
+    "$ pq -k 5 -r input.csv -d distances.csv -n neighbors.csv"
+    "\n\n"
+    "The output files are organized such that row i and column j in the "
+    "neighbors output file corresponds to the index of the point in the "
+    "reference set which is the i'th nearest neighbor from the point in the "
+    "query set with index j.  Row i and column j in the distances output file "
+    "corresponds to the estimated distance between those two points."
+    "\n\n"
+    "If --lists is greater than 0, the reference points are also clustered "
+    "into that many lists, and only the --probes lists nearest to each query "
+    "point are searched.  The quantizers can be learned from a random sample "
+    "of the reference points with --training_size."
+    "\n\n"
+    "Because the k-means clusterings are random, results may be different from "
+    "run to run.  Thus, the --seed option can be specified to set the random "
+    "seed.");
+
+// Define our input parameters that this program will take.
+PARAM_STRING_REQ("reference_file", "File containing the reference dataset.",
+    "r");
+PARAM_STRING("distances_file", "File to output distances into.", "d", "");
+PARAM_STRING("neighbors_file", "File to output neighbors into.", "n", "");
+
+PARAM_INT_REQ("k", "Number of nearest neighbors to find.", "k");
+
+PARAM_STRING("query_file", "File containing query points (optional).", "q", "");
+
+PARAM_INT("subquantizers", "Number of subquantizers (bytes per point).", "M",
+    8);
+PARAM_INT("lists", "Number of lists of the inverted file (0 searches every "
+    "point).", "L", 0);
+PARAM_INT("probes", "Number of lists to search for each query point.", "p", 1);
+PARAM_INT("max_iterations", "Maximum number of iterations of each k-means "
+    "clustering.", "m", 25);
+PARAM_INT("training_size", "Number of random reference points to learn the "
+    "quantizers from (0 uses all of them).", "T", 0);
+PARAM_INT("threads", "Number of threads to use (0 uses all available cores; "
+    "ignored if mlpack was built without OpenMP).", "t", 0);
+PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
+
+int main(int argc, char *argv[])
+{
+  // Give CLI the command line parameters the user passed in.
+  CLI::ParseCommandLine(argc, argv);
+
+  if (CLI::GetParam<int>("seed") != 0)
+    math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
+  else
+    math::RandomSeed((size_t) time(NULL));
+
+  // Get all the parameters.
+  const string referenceFile = CLI::GetParam<string>("reference_file");
+  const string distancesFile = CLI::GetParam<string>("distances_file");
+  const string neighborsFile = CLI::GetParam<string>("neighbors_file");
+
+  arma::mat referenceData;
+  arma::mat queryData; // So it doesn't go out of scope.
+  data::Load(referenceFile, referenceData, true);
+
+  Log::Info << "Loaded reference data from '" << referenceFile << "' ("
+      << referenceData.n_rows << " x " << referenceData.n_cols << ")." << endl;
+
+  // Sanity check on k value: must be greater than 0, must be less than the
+  // number of reference points.
+  const int k = CLI::GetParam<int>("k");
+  if (k <= 0 || (size_t) k > referenceData.n_cols)
+  {
+    Log::Fatal << "Invalid k: " << k << "; must be greater than 0 and less "
+        << "than or equal to the number of reference points ("
+        << referenceData.n_cols << ")." << endl;
+  }
+
+  const int subquantizers = CLI::GetParam<int>("subquantizers");
+  if (subquantizers <= 0 || (size_t) subquantizers > referenceData.n_rows)
+  {
+    Log::Fatal << "Invalid number of subquantizers: " << subquantizers
+        << "; must be greater than 0 and no greater than the dimensionality "
+        << "of the data (" << referenceData.n_rows << ")." << endl;
+  }
+
+  if (CLI::GetParam<int>("lists") < 0)
+  {
+    Log::Fatal << "Invalid number of lists: " << CLI::GetParam<int>("lists")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+
+  if (CLI::GetParam<int>("probes") <= 0)
+  {
+    Log::Fatal << "Invalid number of probes: " << CLI::GetParam<int>("probes")
+        << ".  Must be greater than 0." << endl;
+  }
+
+  if (CLI::GetParam<int>("max_iterations") < 0)
+  {
+    Log::Fatal << "Invalid number of iterations: "
+        << CLI::GetParam<int>("max_iterations") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+
+  if (CLI::GetParam<int>("training_size") < 0)
+  {
+    Log::Fatal << "Invalid training size: "
+        << CLI::GetParam<int>("training_size") << ".  Must be greater than or "
+        << "equal to 0." << endl;
+  }
+
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+
+  if (CLI::GetParam<string>("query_file") != "")
+  {
+    string queryFile = CLI::GetParam<string>("query_file");
+
+    data::Load(queryFile, queryData, true);
+    Log::Info << "Loaded query data from '" << queryFile << "' ("
+              << queryData.n_rows << " x " << queryData.n_cols << ")." << endl;
+  }
+
+  PQSearch pq((size_t) subquantizers, (size_t) CLI::GetParam<int>("lists"),
+      (size_t) CLI::GetParam<int>("max_iterations"));
+  pq.Threads() = (size_t) CLI::GetParam<int>("threads");
+
+  // Learn the quantizers, possibly from a random sample of the points.
+  const size_t trainingSize = (size_t) CLI::GetParam<int>("training_size");
+  if (trainingSize > 0 && trainingSize < referenceData.n_cols)
+  {
+    const arma::uvec order = arma::shuffle(arma::linspace<arma::uvec>(0,
+        referenceData.n_cols - 1, referenceData.n_cols));
+    arma::mat trainingData(referenceData.n_rows, trainingSize);
+    for (size_t i = 0; i < trainingSize; ++i)
+      trainingData.col(i) = referenceData.col(order[i]);
+
+    Log::Info << "Training on " << trainingSize << " random reference points."
+        << endl;
+    pq.Train(trainingData);
+  }
+  else
+  {
+    pq.Train(referenceData);
+  }
+
+  Log::Info << "Encoding " << referenceData.n_cols << " reference points with "
+      << subquantizers << " subquantizers." << endl;
+  pq.Add(referenceData);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+
+  Log::Info << "Computing " << k << " distance approximate nearest neighbors "
+      << endl;
+  if (CLI::GetParam<string>("query_file") != "")
+    pq.Search(queryData, (size_t) k, neighbors, distances,
+        (size_t) CLI::GetParam<int>("probes"));
+  else
+    pq.Search(referenceData, (size_t) k, neighbors, distances,
+        (size_t) CLI::GetParam<int>("probes"));
+
+  Log::Info << "Neighbors computed." << endl;
+
+  // Save output.
+  if (distancesFile != "")
+    data::Save(distancesFile, distances);
+
+  if (neighborsFile != "")
+    data::Save(neighborsFile, neighbors);
+}
@@ -0,0 +1,285 @@
+/**
+ * @file pq_search.cpp
+ *
+ * Implementation of the PQSearch class.
+ */
+#include "pq_search.hpp"
+
+#include <mlpack/core/metrics/lmetric.hpp>
+#include <mlpack/methods/kmeans/kmeans.hpp>
+#include <mlpack/methods/neighbor_search/candidate_heap.hpp>
+#include <mlpack/methods/neighbor_search/sort_policies/nearest_neighbor_sort.hpp>
+
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+PQSearch::PQSearch(const size_t numSubquantizers,
+                   const size_t numLists,
+                   const size_t maxIterations) :
+    numSubquantizers(numSubquantizers),
+    numLists(numLists),
+    maxIterations(maxIterations),
+    threads(0),
+    dimensionality(0),
+    numCentroids(0),
+    size(0)
+{
+  if (numSubquantizers == 0)
+    Log::Fatal << "PQSearch::PQSearch(): the number of subquantizers must be "
+        << "greater than 0!" << std::endl;
+}
+
+void PQSearch::Train(const arma::mat& data)
+{
+  if (numSubquantizers > data.n_rows)
+  {
+    Log::Fatal << "PQSearch::Train(): there are more subquantizers ("
+        << numSubquantizers << ") than dimensions (" << data.n_rows << ")!"
+        << std::endl;
+  }
+  if (data.n_cols == 0 || numLists > data.n_cols)
+  {
+    Log::Fatal << "PQSearch::Train(): there must be at least one point and at "
+        << "least as many points as lists (" << numLists << "); got "
+        << data.n_cols << "!" << std::endl;
+  }
+
+  Timer::Start("pq_training");
+
+  dimensionality = data.n_rows;
+  subspaceBegin.resize(numSubquantizers + 1);
+  for (size_t m = 0; m <= numSubquantizers; ++m)
+    subspaceBegin[m] = m * dimensionality / numSubquantizers;
+
+  // Quantize the residuals relative to the centroids of the lists.  Without an
+  // inverted file, there is one list with a zero centroid.
+  arma::mat residuals(data);
+  if (numLists > 0)
+  {
+    kmeans::KMeans<> kmeans(maxIterations);
+    arma::Col<size_t> assignments;
+    kmeans.Cluster(data, numLists, assignments, listCentroids);
+
+    for (size_t i = 0; i < data.n_cols; ++i)
+      residuals.col(i) -= listCentroids.col(assignments[i]);
+  }
+  else
+  {
+    listCentroids.zeros(dimensionality, 1);
+  }
+
+  // Each code is one byte per subspace.
+  numCentroids = std::min((size_t) 256, (size_t) data.n_cols);
+  codebooks.resize(numSubquantizers);
+  for (size_t m = 0; m < numSubquantizers; ++m)
+  {
+    const arma::mat subspace = residuals.rows(subspaceBegin[m],
+        subspaceBegin[m + 1] - 1);
+    kmeans::KMeans<> kmeans(maxIterations);
+    kmeans.Cluster(subspace, numCentroids, codebooks[m]);
+  }
+
+  // Empty the index.
+  listCodes.assign(listCentroids.n_cols, std::vector<unsigned char>());
+  listIndices.assign(listCentroids.n_cols, std::vector<size_t>());
+  size = 0;
+
+  Timer::Stop("pq_training");
+}
+
+void PQSearch::Add(const arma::mat& points)
+{
+  if (dimensionality == 0)
+    Log::Fatal << "PQSearch::Add(): Train() must be called first!" << std::endl;
+  if (points.n_rows != dimensionality)
+  {
+    Log::Fatal << "PQSearch::Add(): points have " << points.n_rows
+        << " dimensions, but the index has " << dimensionality << "!"
+        << std::endl;
+  }
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Encode the points in parallel, and then append them to their lists.
+  std::vector<size_t> lists(points.n_cols);
+  std::vector<unsigned char> codes(points.n_cols * numSubquantizers);
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 256)
+  for (omp_size_t i = 0; i < (omp_size_t) points.n_cols; ++i)
+  {
+    const arma::vec point = points.col(i);
+    lists[i] = NearestList(point);
+    Encode(point - listCentroids.col(lists[i]), &codes[i * numSubquantizers]);
+  }
+
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    listCodes[lists[i]].insert(listCodes[lists[i]].end(),
+        codes.begin() + i * numSubquantizers,
+        codes.begin() + (i + 1) * numSubquantizers);
+    listIndices[lists[i]].push_back(size + i);
+  }
+
+  size += points.n_cols;
+}
+
+void PQSearch::Search(const arma::mat& querySet,
+                      const size_t k,
+                      arma::Mat<size_t>& neighbors,
+                      arma::mat& distances,
+                      const size_t numProbes) const
+{
+  if (querySet.n_rows != dimensionality)
+  {
+    Log::Fatal << "PQSearch::Search(): query points have " << querySet.n_rows
+        << " dimensions, but the index has " << dimensionality << "!"
+        << std::endl;
+  }
+
+  Timer::Start("computing_neighbors");
+
+  neighbors.set_size(k, querySet.n_cols);
+  neighbors.fill(size_t() - 1);
+  distances.set_size(k, querySet.n_cols);
+  distances.fill(DBL_MAX);
+
+  const size_t probes = std::min(std::max(numProbes, (size_t) 1),
+      (size_t) listCentroids.n_cols);
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 16)
+  for (omp_size_t q = 0; q < (omp_size_t) querySet.n_cols; ++q)
+  {
+    // Order the lists by the distances between the query and their centroids.
+    arma::vec listDistances(listCentroids.n_cols);
+    for (size_t l = 0; l < listCentroids.n_cols; ++l)
+      listDistances[l] = metric::SquaredEuclideanDistance::Evaluate(
+          querySet.col(q), listCentroids.col(l));
+    const arma::uvec order = arma::sort_index(listDistances);
+
+    // table(c, m) is the squared distance between the residual of the query
+    // and centroid c of subspace m, so the entries for a subspace are
+    // contiguous.
+    arma::mat table(numCentroids, numSubquantizers);
+    double* queryDistances = distances.colptr(q);
+    size_t* queryNeighbors = neighbors.colptr(q);
+    for (size_t p = 0; p < probes; ++p)
+    {
+      const size_t l = order[p];
+      if (listIndices[l].empty())
+        continue;
+
+      const arma::vec residual = querySet.col(q) - listCentroids.col(l);
+      for (size_t m = 0; m < numSubquantizers; ++m)
+      {
+        const arma::vec sub = residual.subvec(subspaceBegin[m],
+            subspaceBegin[m + 1] - 1);
+        for (size_t c = 0; c < numCentroids; ++c)
+          table(c, m) = metric::SquaredEuclideanDistance::Evaluate(sub,
+              codebooks[m].col(c));
+      }
+
+      // Each estimated distance is a sum of one table entry per subspace.  The
+      // four partial sums are independent, so the lookups can overlap.
+      const double* t = table.memptr();
+      const unsigned char* code = &listCodes[l][0];
+      for (size_t i = 0; i < listIndices[l].size(); ++i,
+           code += numSubquantizers)
+      {
+        double d0 = 0.0, d1 = 0.0, d2 = 0.0, d3 = 0.0;
+        size_t m = 0;
+        for (; m + 4 <= numSubquantizers; m += 4)
+        {
+          d0 += t[m * numCentroids + code[m]];
+          d1 += t[(m + 1) * numCentroids + code[m + 1]];
+          d2 += t[(m + 2) * numCentroids + code[m + 2]];
+          d3 += t[(m + 3) * numCentroids + code[m + 3]];
+        }
+        for (; m < numSubquantizers; ++m)
+          d0 += t[m * numCentroids + code[m]];
+
+        HeapInsert<NearestNeighborSort>(queryDistances, queryNeighbors, k,
+            listIndices[l][i], (d0 + d1) + (d2 + d3));
+      }
+    }
+
+    SortCandidates<NearestNeighborSort>(queryDistances, queryNeighbors, k);
+    for (size_t j = 0; j < k; ++j)
+      if (queryNeighbors[j] != (size_t() - 1))
+        queryDistances[j] = std::sqrt(queryDistances[j]);
+  }
+
+  Timer::Stop("computing_neighbors");
+}
+
+void PQSearch::Decode(const size_t index, arma::vec& point) const
+{
+  for (size_t l = 0; l < listIndices.size(); ++l)
+  {
+    for (size_t i = 0; i < listIndices[l].size(); ++i)
+    {
+      if (listIndices[l][i] != index)
+        continue;
+
+      point = listCentroids.col(l);
+      const unsigned char* code = &listCodes[l][i * numSubquantizers];
+      for (size_t m = 0; m < numSubquantizers; ++m)
+        point.subvec(subspaceBegin[m], subspaceBegin[m + 1] - 1) +=
+            codebooks[m].col(code[m]);
+      return;
+    }
+  }
+
+  Log::Fatal << "PQSearch::Decode(): there is no point " << index
+      << " in the index!" << std::endl;
+}
+
+size_t PQSearch::NearestList(const arma::vec& point) const
+{
+  size_t nearest = 0;
+  double nearestDistance = DBL_MAX;
+  for (size_t l = 0; l < listCentroids.n_cols; ++l)
+  {
+    const double distance = metric::SquaredEuclideanDistance::Evaluate(point,
+        listCentroids.col(l));
+    if (distance < nearestDistance)
+    {
+      nearest = l;
+      nearestDistance = distance;
+    }
+  }
+
+  return nearest;
+}
+
+void PQSearch::Encode(const arma::vec& residual, unsigned char* code) const
+{
+  for (size_t m = 0; m < numSubquantizers; ++m)
+  {
+    const arma::vec sub = residual.subvec(subspaceBegin[m],
+        subspaceBegin[m + 1] - 1);
+
+    size_t nearest = 0;
+    double nearestDistance = DBL_MAX;
+    for (size_t c = 0; c < numCentroids; ++c)
+    {
+      const double distance = metric::SquaredEuclideanDistance::Evaluate(sub,
+          codebooks[m].col(c));
+      if (distance < nearestDistance)
+      {
+        nearest = c;
+        nearestDistance = distance;
+      }
+    }
+
+    code[m] = (unsigned char) nearest;
+  }
+}
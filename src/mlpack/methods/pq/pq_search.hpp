@@ -0,0 +1,187 @@
+/**
+ * @file pq_search.hpp
+ *
+ * Defines the PQSearch class, which performs approximate nearest neighbor
+ * search on points compressed with product quantization, optionally with an
+ * inverted file of k-means clusters so that only a few clusters are searched
+ * for each query.
+ *
+ * The details of this method can be found in the following paper:
+ *
+ * @article{jegou2011product,
+ *   title={Product quantization for nearest neighbor search},
+ *   author={J{\'e}gou, H. and Douze, M. and Schmid, C.},
+ *   journal={IEEE Transactions on Pattern Analysis and Machine Intelligence},
+ *   volume={33},
+ *   number={1},
+ *   pages={117--128},
+ *   year={2011}
+ * }
+ */
+#ifndef __MLPACK_METHODS_PQ_PQ_SEARCH_HPP
+#define __MLPACK_METHODS_PQ_PQ_SEARCH_HPP
+
+#include <mlpack/core.hpp>
+
+#include <vector>
+
+namespace mlpack {
+namespace neighbor {
+
+/**
+ * An index of points compressed with product quantization, for approximate
+ * Euclidean nearest neighbor search.  The dimensions are split into
+ * numSubquantizers groups (subspaces), and the part of each point in each
+ * subspace is replaced by the nearest of 256 centroids found by k-means in
+ * that subspace, so each point is stored as one byte per subspace.  Only the
+ * codes are kept, not the points.
+ *
+ * If numLists is greater than 0, the points are first clustered by k-means
+ * into numLists lists (an inverted file), and each point is quantized relative
+ * to the centroid of its list.  A search then only looks at the numProbes
+ * lists whose centroids are nearest to the query.
+ *
+ * The distance between a query and a code is estimated asymmetrically: the
+ * query is not quantized.  For each query (and list), a table of the squared
+ * distances between the query and every centroid of every subspace is
+ * computed, and the distance to each code is the sum of one entry of the table
+ * for each subspace.
+ *
+ * The centroids are learned with Train(), usually on a sample of the data, and
+ * the points are encoded and added with Add(), which can be called many times
+ * (for instance, with chunks of a dataset that does not fit in memory).  The
+ * points are numbered in the order they are added.
+ *
+ * If mlpack was compiled with OpenMP, Add() and Search() run in parallel with
+ * the number of threads given by Threads().
+ */
+class PQSearch
+{
+ public:
+  /**
+   * Create an empty index; Train() must be called before points are added.
+   *
+   * @param numSubquantizers Number of subspaces (and bytes per point); must be
+   *     no greater than the dimensionality of the data.
+   * @param numLists Number of lists of the inverted file, or 0 to search all of
+   *     the points for each query.
+   * @param maxIterations Maximum number of iterations of each k-means
+   *     clustering done by Train().
+   */
+  PQSearch(const size_t numSubquantizers,
+           const size_t numLists = 0,
+           const size_t maxIterations = 25);
+
+  /**
+   * Learn the centroids of the lists and of each subspace from the given
+   * points, and empty the index.  There must be at least as many points as
+   * lists.
+   *
+   * @param data Points to learn the centroids from.
+   */
+  void Train(const arma::mat& data);
+
+  /**
+   * Encode the given points and add them to the index.  They get the indices
+   * Size() through Size() + points.n_cols - 1.
+   *
+   * @param points Points to add.
+   */
+  void Add(const arma::mat& points);
+
+  /**
+   * Find the (approximate) k nearest neighbors of each query point among the
+   * points of the index.  Points which are not found (if the searched lists
+   * hold fewer than k points) have the index (size_t() - 1) and the distance
+   * DBL_MAX.
+   *
+   * @param querySet Query points.
+   * @param k Number of neighbors to search for.
+   * @param neighbors Matrix to store the neighbor indices in (k x queries).
+   * @param distances Matrix to store the estimated distances in.
+   * @param numProbes Number of lists to search for each query.
+   */
+  void Search(const arma::mat& querySet,
+              const size_t k,
+              arma::Mat<size_t>& neighbors,
+              arma::mat& distances,
+              const size_t numProbes = 1) const;
+
+  /**
+   * Reconstruct the given point of the index from its code (the centroid of
+   * its list plus the centroids its code selects).  The lists are searched for
+   * the point, so this takes time linear in the size of the index.
+   *
+   * @param index Index of the point.
+   * @param point Vector to store the reconstructed point in.
+   */
+  void Decode(const size_t index, arma::vec& point) const;
+
+  //! Get the number of points in the index.
+  size_t Size() const { return size; }
+
+  //! Get the number of subspaces.
+  size_t NumSubquantizers() const { return numSubquantizers; }
+  //! Get the number of lists of the inverted file (0 if there is none).
+  size_t NumLists() const { return numLists; }
+
+  //! Get the centroids of the lists (a single zero centroid if there is no
+  //! inverted file).
+  const arma::mat& ListCentroids() const { return listCentroids; }
+  //! Get the centroids of the given subspace.
+  const arma::mat& Codebook(const size_t subspace) const
+  { return codebooks[subspace]; }
+
+  //! Get the number of threads used for adding and searching (0 means all
+  //! available threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for adding and searching (0 means all
+  //! available threads).  This has no effect if mlpack was compiled without
+  //! OpenMP.
+  size_t& Threads() { return threads; }
+
+ private:
+  //! The number of subspaces.
+  size_t numSubquantizers;
+  //! The number of lists of the inverted file (0 if there is none).
+  size_t numLists;
+  //! The maximum number of iterations of each k-means clustering.
+  size_t maxIterations;
+  //! The number of threads to use (0 means all available).
+  size_t threads;
+
+  //! The dimensionality of the points (0 before Train()).
+  size_t dimensionality;
+  //! The first dimension of each subspace, and the dimensionality at the end.
+  std::vector<size_t> subspaceBegin;
+  //! The number of centroids of each subspace (at most 256).
+  size_t numCentroids;
+
+  //! The centroids of the lists.
+  arma::mat listCentroids;
+  //! The centroids of each subspace.
+  std::vector<arma::mat> codebooks;
+
+  //! The codes of the points of each list (numSubquantizers bytes per point).
+  std::vector<std::vector<unsigned char> > listCodes;
+  //! The indices of the points of each list.
+  std::vector<std::vector<size_t> > listIndices;
+  //! The number of points in the index.
+  size_t size;
+
+  //! Return the index of the list centroid nearest to the given point.
+  size_t NearestList(const arma::vec& point) const;
+
+  /**
+   * Encode the given residual (a point minus the centroid of its list).
+   *
+   * @param residual Residual to encode.
+   * @param code Array to store the numSubquantizers bytes of the code in.
+   */
+  void Encode(const arma::vec& residual, unsigned char* code) const;
+};
+
+}; // namespace neighbor
+}; // namespace mlpack
+
+#endif
@@ -17,12 +17,14 @@ Radical::Radical(const double noiseStdDev,
                  const size_t replicates,
                  const size_t angles,
                  const size_t sweeps,
-                 const size_t m) :
+                 const size_t m,
+                 const size_t threads) :
     noiseStdDev(noiseStdDev),
     replicates(replicates),
     angles(angles),
     sweeps(sweeps),
-    m(m)
+    m(m),
+    threads(threads)
 {
   // Nothing to do here.
 }
@@ -38,7 +40,8 @@ void Radical::CopyAndPerturb(mat& xNew, const mat& x) const
 
 double Radical::Vasicek(vec& z) const
 {
-  z = sort(z);
+  // Sort in place, so that no temporary is allocated.
+  std::sort(z.begin(), z.end());
 
   // Apparently slower.
   /*
@@ -63,26 +66,39 @@ double Radical::DoRadical2D(const mat& matX)
 {
   CopyAndPerturb(perturbed, matX);
 
-  mat::fixed<2, 2> matJacobi;
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
 
   vec values(angles);
 
-  for (size_t i = 0; i < angles; i++)
+  // The entropy of each rotation is independent of the others, so the angles
+  // are split among the threads.  Each thread rotates the perturbed data into
+  // its own pair of buffers, which Vasicek() then sorts in place, so nothing is
+  // allocated per angle.
+  #pragma omp parallel num_threads(numThreads)
   {
-    const double theta = (i / (double) angles) * M_PI / 2.0;
-    const double cosTheta = cos(theta);
-    const double sinTheta = sin(theta);
+    const vec perturbedX1 = perturbed.unsafe_col(0);
+    const vec perturbedX2 = perturbed.unsafe_col(1);
+    vec candidateY1(perturbed.n_rows);
+    vec candidateY2(perturbed.n_rows);
 
-    matJacobi(0, 0) = cosTheta;
-    matJacobi(1, 0) = -sinTheta;
-    matJacobi(0, 1) = sinTheta;
-    matJacobi(1, 1) = cosTheta;
+    #pragma omp for schedule(static)
+    for (omp_size_t i = 0; i < (omp_size_t) angles; i++)
+    {
+      const double theta = (i / (double) angles) * M_PI / 2.0;
+      const double cosTheta = cos(theta);
+      const double sinTheta = sin(theta);
 
-    candidate = perturbed * matJacobi;
-    vec candidateY1 = candidate.unsafe_col(0);
-    vec candidateY2 = candidate.unsafe_col(1);
+      // This is perturbed * [cos(theta) sin(theta); -sin(theta) cos(theta)].
+      candidateY1 = cosTheta * perturbedX1 - sinTheta * perturbedX2;
+      candidateY2 = sinTheta * perturbedX1 + cosTheta * perturbedX2;
 
-    values(i) = Vasicek(candidateY1) + Vasicek(candidateY2);
+      values(i) = Vasicek(candidateY1) + Vasicek(candidateY2);
+    }
   }
 
   uword indOpt;
@@ -127,8 +143,6 @@ void Radical::DoRadical(const mat& matXT, mat& matY, mat& matW)
 
   mat matYSubspace(nPoints, 2);
 
-  mat matJ = eye(nDims, nDims);
-
   for (size_t sweepNum = 0; sweepNum < sweeps; sweepNum++)
   {
     Log::Info << "RADICAL: sweep " << sweepNum << "." << std::endl;
@@ -148,19 +162,14 @@ void Radical::DoRadical(const mat& matXT, mat& matY, mat& matW)
         const double cosThetaOpt = cos(thetaOpt);
         const double sinThetaOpt = sin(thetaOpt);
 
-        // Set elements of transformation matrix.
-        matJ(i, i) = cosThetaOpt;
-        matJ(j, i) = -sinThetaOpt;
-        matJ(i, j) = sinThetaOpt;
-        matJ(j, j) = cosThetaOpt;
-
-        matY *= matJ;
-
-        // Unset elements of transformation matrix, so matJ = eye() again.
-        matJ(i, i) = 1;
-        matJ(j, i) = 0;
-        matJ(i, j) = 0;
-        matJ(j, j) = 1;
+        // Rotate dimensions i and j of matY.  This is matY * matJ, where matJ
+        // is the identity except for matJ(i, i) = matJ(j, j) = cos(thetaOpt)
+        // and matJ(i, j) = -matJ(j, i) = sin(thetaOpt); only the two rotated
+        // columns change, so the full product isn't needed.
+        matY.col(i) = cosThetaOpt * matYSubspace.col(0) -
+            sinThetaOpt * matYSubspace.col(1);
+        matY.col(j) = sinThetaOpt * matYSubspace.col(0) +
+            cosThetaOpt * matYSubspace.col(1);
       }
     }
   }
@@ -194,5 +203,6 @@ std::string Radical::ToString() const
   convert << "  Number of Replicates: " << replicates << std::endl;
   convert << "  Number of Angles: " << angles << std::endl;
   convert << "  M value: " << m << std::endl;
+  convert << "  Threads: " << threads << std::endl;
   return convert.str();
 }
@@ -29,6 +29,9 @@ PARAM_INT("angles", "Number of angles to consider in brute-force search "
     "during Radical2D.", "a", 150);
 PARAM_INT("sweeps", "Number of sweeps; each sweep calls Radical2D once for "
     "each pair of dimensions.", "S", 0);
+PARAM_INT("threads", "Number of threads to use for the angle search (0 uses "
+    "all available cores; ignored if mlpack was built without OpenMP).", "t",
+    0);
 PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
 PARAM_FLAG("objective", "If set, an estimate of the final objective function "
     "is printed.", "O");
@@ -66,8 +69,16 @@ int main(int argc, char* argv[])
     nSweeps = matX.n_rows - 1;
   }
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t threads = (size_t) CLI::GetParam<int>("threads");
+
   // Run RADICAL.
-  Radical rad(noiseStdDev, nReplicates, nAngles, nSweeps);
+  Radical rad(noiseStdDev, nReplicates, nAngles, nSweeps, 0, threads);
   mat matY;
   mat matW;
   rad.DoRadical(matX, matY, matW);
@@ -11,7 +11,9 @@
 #include <mlpack/core.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/core/tree/binary_space_tree.hpp>
+#include <mlpack/core/tree/instrumented_rules.hpp>
 #include "range_search_stat.hpp"
+#include "range_search_results.hpp"
 
 namespace mlpack {
 namespace range /** Range-search routines. */ {
@@ -21,10 +23,16 @@ namespace range /** Range-search routines. */ {
  * is implemented in the style of a generalized tree-independent dual-tree
  * algorithm; for more details on the actual algorithm, see the RangeSearchRules
  * class.
+ *
+ * @tparam MetricType Metric to use for range search calculations.
+ * @tparam TreeType Type of tree to use.
+ * @tparam InstrumentationType Policy to record details of the tree traversals
+ *     with; see tree::TraversalInstrumentation.  The default records nothing.
  */
 template<typename MetricType = mlpack::metric::EuclideanDistance,
          typename TreeType = tree::BinarySpaceTree<bound::HRectBound<2>,
-                                                   RangeSearchStat> >
+                                                   RangeSearchStat>,
+         typename InstrumentationType = tree::NoTraversalInstrumentation>
 class RangeSearch
 {
  public:
@@ -36,8 +44,11 @@ class RangeSearch
    * distance metric holds data.
    *
    * This method will copy the matrices to internal copies, which are rearranged
-   * during tree-building.  You can avoid this extra copy by pre-constructing
-   * the trees and passing them using a different constructor.
+   * during tree-building.  The copies are made in naive and single-tree mode
+   * too, so the given matrices do not have to outlive this object.  You can
+   * avoid this extra copy by pre-constructing the trees and passing them using
+   * a different constructor, or by letting the trees rearrange the given
+   * matrices in place, with the constructor which takes the permutations.
    *
    * @param referenceSet Reference dataset.
    * @param querySet Query dataset.
@@ -77,6 +88,56 @@ class RangeSearch
               const bool singleMode = false,
               const MetricType metric = MetricType());
 
+  /**
+   * Initialize the RangeSearch object, building the trees on the given datasets
+   * themselves instead of on copies of them.  Tree-building rearranges the
+   * points of the matrices in place, so no copy of either dataset is ever made;
+   * this is the constructor to use for datasets which are too large to be held
+   * twice.  The permutations made by tree-building are stored in
+   * oldFromNewReferences and oldFromNewQueries (point i of the rearranged
+   * matrix was point oldFromNew[i] of the given matrix), and the results of
+   * Search() are given in terms of the original indices, as with the other
+   * constructors.
+   *
+   * The matrices must not be modified or destroyed while this object exists.
+   * If singleMode is true, the query set is not rearranged (no query tree is
+   * built), and trees which do not rearrange their dataset leave both matrices
+   * as they are; the permutation given back is then the identity.  Naive mode
+   * builds no trees, so it is not an option here.
+   *
+   * @param referenceSet Reference dataset; rearranged in place.
+   * @param querySet Query dataset; rearranged in place.
+   * @param oldFromNewReferences Filled with the permutation of the reference
+   *      points.
+   * @param oldFromNewQueries Filled with the permutation of the query points.
+   * @param singleMode Whether single-tree computation should be used (as
+   *      opposed to dual-tree computation).
+   * @param metric Instantiated distance metric.
+   */
+  RangeSearch(typename TreeType::Mat& referenceSet,
+              typename TreeType::Mat& querySet,
+              std::vector<size_t>& oldFromNewReferences,
+              std::vector<size_t>& oldFromNewQueries,
+              const bool singleMode = false,
+              const MetricType metric = MetricType());
+
+  /**
+   * Initialize the RangeSearch object with only a reference set, which will
+   * also be used as a query set, building the tree on the reference set itself
+   * instead of on a copy of it.  The points are rearranged in place and the
+   * permutation is stored in oldFromNewReferences; see the constructor above.
+   *
+   * @param referenceSet Reference dataset; rearranged in place.
+   * @param oldFromNewReferences Filled with the permutation of the points.
+   * @param singleMode Whether single-tree computation should be used (as
+   *      opposed to dual-tree computation).
+   * @param metric Instantiated distance metric.
+   */
+  RangeSearch(typename TreeType::Mat& referenceSet,
+              std::vector<size_t>& oldFromNewReferences,
+              const bool singleMode = false,
+              const MetricType metric = MetricType());
+
   /**
    * Initialize the RangeSearch object with the given datasets and
    * pre-constructed trees.  It is assumed that the points in referenceSet and
@@ -171,6 +232,9 @@ class RangeSearch
    *
    * - neighbors[i] and distances[i] are not sorted in any particular order.
    *
+   * If mlpack was compiled with OpenMP, single-tree search is run in parallel
+   * with the number of threads given by Threads().
+   *
    * @param range Range of distances in which to search.
    * @param neighbors Object which will hold the list of neighbors for each
    *      point which fell into the given range, for each query point.
@@ -181,11 +245,108 @@ class RangeSearch
               std::vector<std::vector<size_t> >& neighbors,
               std::vector<std::vector<double> >& distances);
 
+  /**
+   * Search for all points in the given range, storing the results in the given
+   * RangeSearchResults object.  This holds the same information as the
+   * vector-of-vectors overload, but in two flat arrays, which avoids a pair of
+   * heap allocations for every query point.
+   *
+   * @param range Range of distances in which to search.
+   * @param results Object which will hold the neighbors and distances of each
+   *      query point.
+   */
+  void Search(const math::Range& range, RangeSearchResults& results);
+
+  /**
+   * Search for all points in the given range, giving the results of each query
+   * point to the given sink as soon as they are known.  This allows results to
+   * be written out (or otherwise consumed) while the search is running, so the
+   * full set of results never needs to be held in memory.  The sink must have
+   * the function
+   *
+   * @code
+   * void Results(const size_t queryIndex,
+   *              std::vector<size_t>& neighbors,
+   *              std::vector<double>& distances);
+   * @endcode
+   *
+   * which is called exactly once for each query point that is in the query
+   * tree, in no particular order, with the indices and distances of the
+   * reference points in range.  The indices are already mapped back to the
+   * original datasets, if this object built the trees.  The sink may take the
+   * contents of the vectors (i.e. with std::vector::swap()).  Calls to the sink
+   * are never concurrent.
+   *
+   * @param range Range of distances in which to search.
+   * @param sink Object which is given the results of each query point.
+   */
+  template<typename SinkType>
+  void Search(const math::Range& range, SinkType& sink);
+
+  /**
+   * Count the reference points in the given range of each query point, without
+   * storing the points themselves.  This is much faster than Search() when
+   * only the counts are needed (i.e. for two-point correlations), because
+   * reference nodes that are entirely in range are counted as a whole instead
+   * of being visited, and the output is one number per query point.  If no
+   * query set was given, a point is not counted in its own range, as with
+   * Search().
+   *
+   * If mlpack was compiled with OpenMP, single-tree counting is run in
+   * parallel with the number of threads given by Threads().
+   *
+   * @param range Range of distances in which to count.
+   * @param counts Vector to store the number of reference points in range of
+   *      each query point in.
+   */
+  void Count(const math::Range& range, arma::Col<size_t>& counts);
+
+  /**
+   * Add the given points to the reference set, so that they are considered by
+   * subsequent calls to Search().  The points are appended to the matrix the
+   * reference tree was built on and then inserted into the tree, so no rebuild
+   * is necessary; the new points get the indices referenceSet.n_cols through
+   * referenceSet.n_cols + points.n_cols - 1.
+   *
+   * This is only possible for trees that support dynamic insertion and do not
+   * rearrange the dataset (i.e. tree::RectangleTree), and only when the
+   * reference tree was passed to the constructor and built on referenceSet.
+   *
+   * @param points Points to add to the reference set.
+   */
+  void Insert(const typename TreeType::Mat& points);
+
+  /**
+   * Remove the reference points with the given indices from the reference
+   * tree, so that they are no longer returned by subsequent calls to Search().
+   * The points stay in the reference set, so the indices of the other
+   * reference points do not change.  The same restrictions as with Insert()
+   * apply.  If no separate query set was given, removed points are still part
+   * of the query set; their results should be ignored.
+   *
+   * @param indices Indices of reference points to remove.
+   */
+  void Remove(const arma::Col<size_t>& indices);
+
+  //! Get the number of threads used for single-tree search (0 means all
+  //! available threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for single-tree search (0 means all
+  //! available threads).  This has no effect if mlpack was compiled without
+  //! OpenMP.
+  size_t& Threads() { return threads; }
+
+  //! Get the details of the tree traversals recorded during searches.
+  const InstrumentationType& Instrumentation() const { return instrumentation; }
+  //! Modify the details of the tree traversals (i.e. to reset them).
+  InstrumentationType& Instrumentation() { return instrumentation; }
+
   // Returns a string representation of this object. 
   std::string ToString() const;
 
  private:
-  //! Copy of reference matrix; used when a tree is built internally.
+  //! Copy of reference matrix; used when a tree is built internally on a
+  //! matrix which may not be rearranged.
   typename TreeType::Mat referenceCopy;
   //! Copy of query matrix; used when a tree is built internally.
   typename TreeType::Mat queryCopy;
@@ -221,6 +382,65 @@ class RangeSearch
 
   //! The number of pruned nodes during computation.
   size_t numPrunes;
+
+  //! The number of threads to use for search (0 means all available).
+  size_t threads;
+
+  //! The details of the tree traversals.
+  InstrumentationType instrumentation;
+
+  /**
+   * Make sure the reference tree can be modified by Insert() or Remove();
+   * otherwise, issue a fatal error.
+   *
+   * @param caller Name of the calling function, for the error message.
+   */
+  void CheckDynamicTree(const std::string& caller) const;
+
+  /**
+   * If the query tree is a copy of the reference tree (because no query set
+   * was given), replace it with a new copy after the reference tree changed.
+   */
+  void UpdateQueryTree();
+
+  /**
+   * Map the results of the given query point back to the original indices, if
+   * necessary, give them to the sink, and release their memory.
+   *
+   * @param queryIndex Index of the query point (in the rearranged query set).
+   * @param queryNeighbors Neighbors of the query point.
+   * @param queryDistances Distances of the query point.
+   * @param sink Object which is given the results.
+   */
+  template<typename SinkType>
+  void EmitResults(const size_t queryIndex,
+                   std::vector<size_t>& queryNeighbors,
+                   std::vector<double>& queryDistances,
+                   SinkType& sink);
+
+  /**
+   * A sink which stores the results of each query point in a vector of vectors,
+   * as the original Search() overload returns them.
+   */
+  class VectorResultSink
+  {
+   public:
+    VectorResultSink(std::vector<std::vector<size_t> >& neighbors,
+                     std::vector<std::vector<double> >& distances) :
+        neighbors(neighbors), distances(distances) { }
+
+    void Results(const size_t queryIndex,
+                 std::vector<size_t>& queryNeighbors,
+                 std::vector<double>& queryDistances)
+    {
+      neighbors[queryIndex].swap(queryNeighbors);
+      distances[queryIndex].swap(queryDistances);
+    }
+
+   private:
+    std::vector<std::vector<size_t> >& neighbors;
+    std::vector<std::vector<double> >& distances;
+  };
 };
 
 }; // namespace range
@@ -39,8 +39,27 @@ TreeType* BuildTree(
   return new TreeType(dataset);
 }
 
-template<typename MetricType, typename TreeType>
-RangeSearch<MetricType, TreeType>::RangeSearch(
+//! Give the caller the permutation made by tree-building, or the identity if
+//! the points of the dataset were not moved.
+inline void ExportPermutation(const std::vector<size_t>& oldFromNew,
+                              const size_t n,
+                              std::vector<size_t>& out)
+{
+  if (oldFromNew.size() == n)
+  {
+    out = oldFromNew;
+    return;
+  }
+
+  out.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    out[i] = i;
+}
+
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+RangeSearch<MetricType, TreeType, InstrumentationType>::RangeSearch(
     const typename TreeType::Mat& referenceSetIn,
     const typename TreeType::Mat& querySetIn,
     const bool naive,
@@ -55,7 +74,8 @@ RangeSearch<MetricType, TreeType>::RangeSearch(
     naive(naive),
     singleMode(!naive && singleMode), // Naive overrides single mode.
     metric(metric),
-    numPrunes(0)
+    numPrunes(0),
+    threads(0)
 {
   // Build the trees.
   Timer::Start("range_search/tree_building");
@@ -85,8 +105,10 @@ RangeSearch<MetricType, TreeType>::RangeSearch(
   Timer::Stop("range_search/tree_building");
 }
 
-template<typename MetricType, typename TreeType>
-RangeSearch<MetricType, TreeType>::RangeSearch(
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+RangeSearch<MetricType, TreeType, InstrumentationType>::RangeSearch(
     const typename TreeType::Mat& referenceSetIn,
     const bool naive,
     const bool singleMode,
@@ -101,7 +123,8 @@ RangeSearch<MetricType, TreeType>::RangeSearch(
     naive(naive),
     singleMode(!naive && singleMode), // Naive overrides single mode.
     metric(metric),
-    numPrunes(0)
+    numPrunes(0),
+    threads(0)
 {
   // Build the trees.
   Timer::Start("range_search/tree_building");
@@ -126,8 +149,79 @@ RangeSearch<MetricType, TreeType>::RangeSearch(
   Timer::Stop("range_search/tree_building");
 }
 
-template<typename MetricType, typename TreeType>
-RangeSearch<MetricType, TreeType>::RangeSearch(
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+RangeSearch<MetricType, TreeType, InstrumentationType>::RangeSearch(
+    typename TreeType::Mat& referenceSetIn,
+    typename TreeType::Mat& querySetIn,
+    std::vector<size_t>& oldFromNewReferencesOut,
+    std::vector<size_t>& oldFromNewQueriesOut,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(querySetIn),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(true),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    numPrunes(0),
+    threads(0)
+{
+  // Build the trees on the given datasets, which rearranges them in place.
+  Timer::Start("range_search/tree_building");
+
+  referenceTree = BuildTree<TreeType>(referenceSetIn, oldFromNewReferences);
+  if (!singleMode)
+    queryTree = BuildTree<TreeType>(querySetIn, oldFromNewQueries);
+
+  ExportPermutation(oldFromNewReferences, referenceSetIn.n_cols,
+      oldFromNewReferencesOut);
+  ExportPermutation(oldFromNewQueries, querySetIn.n_cols, oldFromNewQueriesOut);
+
+  Timer::Stop("range_search/tree_building");
+}
+
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+RangeSearch<MetricType, TreeType, InstrumentationType>::RangeSearch(
+    typename TreeType::Mat& referenceSetIn,
+    std::vector<size_t>& oldFromNewReferencesOut,
+    const bool singleMode,
+    const MetricType metric) :
+    referenceSet(referenceSetIn),
+    querySet(referenceSetIn),
+    referenceTree(NULL),
+    queryTree(NULL),
+    treeOwner(true),
+    hasQuerySet(false),
+    naive(false),
+    singleMode(singleMode),
+    metric(metric),
+    numPrunes(0),
+    threads(0)
+{
+  // Build the tree on the given dataset, which rearranges it in place.
+  Timer::Start("range_search/tree_building");
+
+  referenceTree = BuildTree<TreeType>(referenceSetIn, oldFromNewReferences);
+  if (!singleMode)
+    queryTree = new TreeType(*referenceTree);
+
+  ExportPermutation(oldFromNewReferences, referenceSetIn.n_cols,
+      oldFromNewReferencesOut);
+
+  Timer::Stop("range_search/tree_building");
+}
+
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+RangeSearch<MetricType, TreeType, InstrumentationType>::RangeSearch(
     TreeType* referenceTree,
     TreeType* queryTree,
     const typename TreeType::Mat& referenceSet,
@@ -143,13 +237,16 @@ RangeSearch<MetricType, TreeType>::RangeSearch(
     naive(false),
     singleMode(singleMode),
     metric(metric),
-    numPrunes(0)
+    numPrunes(0),
+    threads(0)
 {
   // Nothing else to initialize.
 }
 
-template<typename MetricType, typename TreeType>
-RangeSearch<MetricType, TreeType>::RangeSearch(
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+RangeSearch<MetricType, TreeType, InstrumentationType>::RangeSearch(
     TreeType* referenceTree,
     const typename TreeType::Mat& referenceSet,
     const bool singleMode,
@@ -163,15 +260,18 @@ RangeSearch<MetricType, TreeType>::RangeSearch(
     naive(false),
     singleMode(singleMode),
     metric(metric),
-    numPrunes(0)
+    numPrunes(0),
+    threads(0)
 {
   // If doing dual-tree range search, we must clone the reference tree.
   if (!singleMode)
     queryTree = new TreeType(*referenceTree);
 }
 
-template<typename MetricType, typename TreeType>
-RangeSearch<MetricType, TreeType>::~RangeSearch()
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+RangeSearch<MetricType, TreeType, InstrumentationType>::~RangeSearch()
 {
   if (treeOwner)
   {
@@ -186,47 +286,228 @@ RangeSearch<MetricType, TreeType>::~RangeSearch()
     delete queryTree;
 }
 
-template<typename MetricType, typename TreeType>
-void RangeSearch<MetricType, TreeType>::Search(
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void RangeSearch<MetricType, TreeType, InstrumentationType>::Search(
     const math::Range& range,
     std::vector<std::vector<size_t> >& neighbors,
     std::vector<std::vector<double> >& distances)
+{
+  neighbors.clear(); // Just in case there was anything in it.
+  neighbors.resize(querySet.n_cols);
+  distances.clear();
+  distances.resize(querySet.n_cols);
+
+  VectorResultSink sink(neighbors, distances);
+  Search(range, sink);
+}
+
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void RangeSearch<MetricType, TreeType, InstrumentationType>::
+Search(const math::Range& range,
+       RangeSearchResults& results)
+{
+  results.Reset(querySet.n_cols);
+  Search<RangeSearchResults>(range, results);
+}
+
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+template<typename SinkType>
+void RangeSearch<MetricType, TreeType, InstrumentationType>::
+Search(const math::Range& range,
+       SinkType& sink)
 {
   Timer::Start("range_search/computing_neighbors");
 
   // Set size of prunes to 0.
   numPrunes = 0;
 
-  // If we have built the trees ourselves, then we will have to map all the
-  // indices back to their original indices when this computation is finished.
-  // To avoid extra copies, we will store the unmapped neighbors and distances
-  // in a separate object.
-  std::vector<std::vector<size_t> >* neighborPtr = &neighbors;
-  std::vector<std::vector<double> >* distancePtr = &distances;
+  // The rules collect the results of each query point in these vectors.  Once
+  // the results of a query point are final, they are handed to the sink and
+  // the memory is released, so only the results that are still being computed
+  // are held here.
+  std::vector<std::vector<size_t> > neighbors(querySet.n_cols);
+  std::vector<std::vector<double> > distances(querySet.n_cols);
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
 
-  // Mapping is only necessary if the tree rearranges points.
-  if (tree::TreeTraits<TreeType>::RearrangesDataset)
+  // Create the helper object for the traversal.
+  typedef RangeSearchRules<MetricType, TreeType> RuleType;
+  typedef tree::InstrumentedRules<RuleType, InstrumentationType>
+      InstrumentedRuleType;
+
+  if (naive)
+  {
+    RuleType rules(referenceSet, querySet, range, neighbors, distances,
+        metric);
+
+    // The naive brute-force solution.
+    for (size_t i = 0; i < querySet.n_cols; ++i)
+    {
+      for (size_t j = 0; j < referenceSet.n_cols; ++j)
+        rules.BaseCase(i, j);
+
+      EmitResults(i, neighbors[i], distances[i], sink);
+    }
+  }
+  else if (singleMode)
   {
-    if (treeOwner && !(singleMode && hasQuerySet))
-      distancePtr = new std::vector<std::vector<double> >; // Query indices need to be mapped.
+    // The query points are split between the threads, each of which has its
+    // own rules and traverser.  Each query point's result vectors are only
+    // touched by one thread.  If the first point of each node is the centroid,
+    // the rules cache the last distance evaluation in the reference tree's
+    // statistics, so then each thread needs its own copy of the reference tree.
+    const bool copyTree = (numThreads > 1) &&
+        tree::TreeTraits<TreeType>::FirstPointIsCentroid;
+    size_t totalPrunes = 0;
+
+    #pragma omp parallel num_threads(numThreads) reduction(+:totalPrunes)
+    {
+      TreeType* threadTree = copyTree ? new TreeType(*referenceTree) :
+          referenceTree;
+      RuleType rules(referenceSet, querySet, range, neighbors, distances,
+          metric);
+      InstrumentationType threadInstrumentation;
+      InstrumentedRuleType instrumentedRules(rules, threadInstrumentation);
+
+      // Create the traverser.
+      typename TreeType::template SingleTreeTraverser<InstrumentedRuleType>
+          traverser(instrumentedRules);
+
+      // Now have it traverse for each point.  The sink is not required to be
+      // thread-safe, so only one thread at a time may give it results.
+      #pragma omp for schedule(dynamic, 16)
+      for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+      {
+        traverser.Traverse(i, *threadTree);
+
+        #pragma omp critical(range_search_sink)
+        EmitResults(i, neighbors[i], distances[i], sink);
+      }
+
+      totalPrunes += traverser.NumPrunes();
+
+      #pragma omp critical(range_search_instrumentation)
+      instrumentation.Merge(threadInstrumentation);
 
-    if (treeOwner)
-      neighborPtr = new std::vector<std::vector<size_t> >; // All indices need mapping.
+      if (copyTree)
+        delete threadTree;
+    }
+
+    numPrunes = totalPrunes;
   }
+  else // Dual-tree recursion.
+  {
+    // Split the query tree into a number of subtrees, so that the results of
+    // each subtree can be handed off once that subtree is done, instead of
+    // holding the results of every query point until the end.  If points can
+    // be held in more than one node of the tree (i.e. the cover tree), the
+    // results of a point are only final when the whole tree is done, so the
+    // tree is not split.
+    std::vector<TreeType*> subtrees(1, queryTree);
+    if (!TreeType::HasSelfChildren())
+    {
+      const size_t minSubtrees = 64;
+      size_t next = 0;
+      while (subtrees.size() < minSubtrees && next < subtrees.size())
+      {
+        TreeType* node = subtrees[next];
+        if (node->NumChildren() == 0)
+        {
+          ++next;
+          continue;
+        }
+
+        // Replace the node with its children.
+        subtrees[next] = &node->Child(0);
+        for (size_t i = 1; i < node->NumChildren(); ++i)
+          subtrees.push_back(&node->Child(i));
+      }
+    }
 
-  // Resize each vector.
-  neighborPtr->clear(); // Just in case there was anything in it.
-  neighborPtr->resize(querySet.n_cols);
-  distancePtr->clear();
-  distancePtr->resize(querySet.n_cols);
+    for (size_t s = 0; s < subtrees.size(); ++s)
+    {
+      RuleType rules(referenceSet, querySet, range, neighbors, distances,
+          metric);
+      InstrumentedRuleType instrumentedRules(rules, instrumentation);
+
+      // Create the traverser.
+      typename TreeType::template DualTreeTraverser<InstrumentedRuleType>
+          traverser(instrumentedRules);
+
+      traverser.Traverse(*subtrees[s], *referenceTree);
+
+      numPrunes += traverser.NumPrunes();
+
+      // If the tree was not split, every query point is done.  This avoids
+      // Descendant(), which is slow for the cover tree.
+      if (subtrees.size() == 1)
+      {
+        for (size_t i = 0; i < querySet.n_cols; ++i)
+          EmitResults(i, neighbors[i], distances[i], sink);
+        continue;
+      }
+
+      const size_t numDescendants = subtrees[s]->NumDescendants();
+      for (size_t i = 0; i < numDescendants; ++i)
+      {
+        const size_t queryIndex = subtrees[s]->Descendant(i);
+        EmitResults(queryIndex, neighbors[queryIndex], distances[queryIndex],
+            sink);
+      }
+    }
+  }
+
+  Timer::Stop("range_search/computing_neighbors");
+
+  // Output number of prunes.
+  Log::Info << "Number of pruned nodes during computation: " << numPrunes
+      << "." << std::endl;
+}
+
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void RangeSearch<MetricType, TreeType, InstrumentationType>::Count(
+    const math::Range& range,
+    arma::Col<size_t>& counts)
+{
+  Timer::Start("range_search/computing_neighbors");
+
+  numPrunes = 0;
+
+  // The rules add to these counts, and never touch the result vectors.
+  arma::Col<size_t> treeCounts(querySet.n_cols);
+  treeCounts.zeros();
+  std::vector<std::vector<size_t> > neighbors;
+  std::vector<std::vector<double> > distances;
+
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
 
-  // Create the helper object for the traversal.
   typedef RangeSearchRules<MetricType, TreeType> RuleType;
-  RuleType rules(referenceSet, querySet, range, *neighborPtr, *distancePtr,
-      metric);
+  typedef tree::InstrumentedRules<RuleType, InstrumentationType>
+      InstrumentedRuleType;
 
   if (naive)
   {
+    RuleType rules(referenceSet, querySet, range, neighbors, distances, metric,
+        &treeCounts);
+
     // The naive brute-force solution.
     for (size_t i = 0; i < querySet.n_cols; ++i)
       for (size_t j = 0; j < referenceSet.n_cols; ++j)
@@ -234,110 +515,211 @@ void RangeSearch<MetricType, TreeType>::Search(
   }
   else if (singleMode)
   {
-    // Create the traverser.
-    typename TreeType::template SingleTreeTraverser<RuleType> traverser(rules);
+    // As in Search(), each thread has its own rules and traverser (and its own
+    // copy of the reference tree, if the rules cache distances in it).  Each
+    // query point's count is only touched by one thread.
+    const bool copyTree = (numThreads > 1) &&
+        tree::TreeTraits<TreeType>::FirstPointIsCentroid;
+    size_t totalPrunes = 0;
+
+    #pragma omp parallel num_threads(numThreads) reduction(+:totalPrunes)
+    {
+      TreeType* threadTree = copyTree ? new TreeType(*referenceTree) :
+          referenceTree;
+      RuleType rules(referenceSet, querySet, range, neighbors, distances,
+          metric, &treeCounts);
+      InstrumentationType threadInstrumentation;
+      InstrumentedRuleType instrumentedRules(rules, threadInstrumentation);
 
-    // Now have it traverse for each point.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      traverser.Traverse(i, *referenceTree);
+      typename TreeType::template SingleTreeTraverser<InstrumentedRuleType>
+          traverser(instrumentedRules);
 
-    numPrunes = traverser.NumPrunes();
+      #pragma omp for schedule(dynamic, 16)
+      for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+        traverser.Traverse(i, *threadTree);
+
+      totalPrunes += traverser.NumPrunes();
+
+      #pragma omp critical(range_search_instrumentation)
+      instrumentation.Merge(threadInstrumentation);
+
+      if (copyTree)
+        delete threadTree;
+    }
+
+    numPrunes = totalPrunes;
   }
   else // Dual-tree recursion.
   {
-    // Create the traverser.
-    typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
+    RuleType rules(referenceSet, querySet, range, neighbors, distances, metric,
+        &treeCounts);
+    InstrumentedRuleType instrumentedRules(rules, instrumentation);
+
+    typename TreeType::template DualTreeTraverser<InstrumentedRuleType>
+        traverser(instrumentedRules);
 
     traverser.Traverse(*queryTree, *referenceTree);
 
     numPrunes = traverser.NumPrunes();
   }
 
+  // Unless the tree has self-children, the rules count each query point in its
+  // own range, so take it out again if the datasets are the same.
+  if (!hasQuerySet && !tree::TreeTraits<TreeType>::HasSelfChildren &&
+      range.Contains(0.0))
+    treeCounts -= 1;
+
+  // Map the counts back to the original query indices, if necessary.
+  if (treeOwner && tree::TreeTraits<TreeType>::RearrangesDataset &&
+      (!hasQuerySet || !singleMode))
+  {
+    const std::vector<size_t>& oldFromNew = hasQuerySet ? oldFromNewQueries :
+        oldFromNewReferences;
+    counts.set_size(treeCounts.n_elem);
+    for (size_t i = 0; i < treeCounts.n_elem; ++i)
+      counts[oldFromNew[i]] = treeCounts[i];
+  }
+  else
+  {
+    counts = treeCounts;
+  }
+
   Timer::Stop("range_search/computing_neighbors");
 
   // Output number of prunes.
   Log::Info << "Number of pruned nodes during computation: " << numPrunes
       << "." << std::endl;
+}
 
-  // Map points back to original indices, if necessary.
-
-  if (!treeOwner || !tree::TreeTraits<TreeType>::RearrangesDataset)
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+template<typename SinkType>
+void RangeSearch<MetricType, TreeType, InstrumentationType>::EmitResults(
+    const size_t queryIndex,
+    std::vector<size_t>& queryNeighbors,
+    std::vector<double>& queryDistances,
+    SinkType& sink)
+{
+  // Map points back to original indices, if necessary.  Mapping is only
+  // necessary if we built the trees and the tree rearranges points.
+  size_t originalIndex = queryIndex;
+  if (treeOwner && tree::TreeTraits<TreeType>::RearrangesDataset)
   {
-    // No mapping needed.  We are done.
-    return;
+    for (size_t j = 0; j < queryNeighbors.size(); ++j)
+      queryNeighbors[j] = oldFromNewReferences[queryNeighbors[j]];
+
+    // In single-tree mode with a query set, no query tree was built.
+    if (!hasQuerySet)
+      originalIndex = oldFromNewReferences[queryIndex];
+    else if (!singleMode)
+      originalIndex = oldFromNewQueries[queryIndex];
   }
-  else if (treeOwner && hasQuerySet && !singleMode) // Map both sets.
-  {
-    neighbors.clear();
-    neighbors.resize(querySet.n_cols);
-    distances.clear();
-    distances.resize(querySet.n_cols);
 
-    for (size_t i = 0; i < distances.size(); i++)
-    {
-      // Map distances (copy a column).
-      size_t queryMapping = oldFromNewQueries[i];
-      distances[queryMapping] = (*distancePtr)[i];
+  sink.Results(originalIndex, queryNeighbors, queryDistances);
 
-      // Copy each neighbor individually, because we need to map it.
-      neighbors[queryMapping].resize(distances[queryMapping].size());
-      for (size_t j = 0; j < distances[queryMapping].size(); j++)
-      {
-        neighbors[queryMapping][j] = oldFromNewReferences[(*neighborPtr)[i][j]];
-      }
-    }
+  // Release the memory; the sink may have taken the contents already.
+  std::vector<size_t>().swap(queryNeighbors);
+  std::vector<double>().swap(queryDistances);
+}
 
-    // Finished with temporary objects.
-    delete neighborPtr;
-    delete distancePtr;
-  }
-  else if (treeOwner && !hasQuerySet)
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void RangeSearch<MetricType, TreeType, InstrumentationType>::Insert(
+    const typename TreeType::Mat& points)
+{
+  CheckDynamicTree("Insert");
+  if (points.n_rows != referenceSet.n_rows)
   {
-    neighbors.clear();
-    neighbors.resize(querySet.n_cols);
-    distances.clear();
-    distances.resize(querySet.n_cols);
+    Log::Fatal << "RangeSearch::Insert(): dimensionality of new points ("
+        << points.n_rows << ") does not match dimensionality of reference set ("
+        << referenceSet.n_rows << ")!" << std::endl;
+  }
 
-    for (size_t i = 0; i < distances.size(); i++)
-    {
-      // Map distances (copy a column).
-      size_t refMapping = oldFromNewReferences[i];
-      distances[refMapping] = (*distancePtr)[i];
+  Timer::Start("range_search/tree_building");
 
-      // Copy each neighbor individually, because we need to map it.
-      neighbors[refMapping].resize(distances[refMapping].size());
-      for (size_t j = 0; j < distances[refMapping].size(); j++)
-      {
-        neighbors[refMapping][j] = oldFromNewReferences[(*neighborPtr)[i][j]];
-      }
+  // The tree holds a reference to the dataset object, so growing the matrix in
+  // place keeps the tree (and referenceSet) valid.
+  typename TreeType::Mat& dataset = referenceTree->Dataset();
+  const size_t oldSize = dataset.n_cols;
+  dataset.insert_cols(oldSize, points);
+
+  for (size_t i = 0; i < points.n_cols; ++i)
+    referenceTree->InsertPoint(oldSize + i);
+
+  UpdateQueryTree();
+
+  Timer::Stop("range_search/tree_building");
+}
+
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void RangeSearch<MetricType, TreeType, InstrumentationType>::
+Remove(const arma::Col<size_t>& indices)
+{
+  CheckDynamicTree("Remove");
+
+  Timer::Start("range_search/tree_building");
+
+  for (size_t i = 0; i < indices.n_elem; ++i)
+  {
+    if (indices[i] >= referenceSet.n_cols)
+    {
+      Log::Fatal << "RangeSearch::Remove(): index " << indices[i]
+          << " is out of range (there are " << referenceSet.n_cols
+          << " reference points)!" << std::endl;
     }
 
-    // Finished with temporary objects.
-    delete neighborPtr;
-    delete distancePtr;
+    if (!referenceTree->DeletePoint(indices[i]))
+      Log::Warn << "RangeSearch::Remove(): reference point " << indices[i]
+          << " is not in the reference tree." << std::endl;
   }
-  else if (treeOwner && hasQuerySet && singleMode) // Map only references.
+
+  UpdateQueryTree();
+
+  Timer::Stop("range_search/tree_building");
+}
+
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void RangeSearch<MetricType, TreeType, InstrumentationType>::CheckDynamicTree(
+    const std::string& caller) const
+{
+  if (naive || referenceTree == NULL)
   {
-    neighbors.clear();
-    neighbors.resize(querySet.n_cols);
+    Log::Fatal << "RangeSearch::" << caller << "(): the reference set can "
+        << "only be modified when a reference tree is used!" << std::endl;
+  }
 
-    // Map indices of neighbors.
-    for (size_t i = 0; i < neighbors.size(); i++)
-    {
-      neighbors[i].resize((*neighborPtr)[i].size());
-      for (size_t j = 0; j < neighbors[i].size(); j++)
-      {
-        neighbors[i][j] = oldFromNewReferences[(*neighborPtr)[i][j]];
-      }
-    }
+  if (tree::TreeTraits<TreeType>::RearrangesDataset ||
+      (&referenceTree->Dataset() != &referenceSet))
+  {
+    Log::Fatal << "RangeSearch::" << caller << "(): the reference set can "
+        << "only be modified if the reference tree was built on it and does "
+        << "not rearrange it!" << std::endl;
+  }
+}
 
-    // Finished with temporary object.
-    delete neighborPtr;
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+void RangeSearch<MetricType, TreeType, InstrumentationType>::UpdateQueryTree()
+{
+  if (!hasQuerySet && queryTree != NULL)
+  {
+    delete queryTree;
+    queryTree = new TreeType(*referenceTree);
   }
 }
 
-template<typename MetricType, typename TreeType>
-std::string RangeSearch<MetricType, TreeType>::ToString() const
+template<typename MetricType,
+         typename TreeType,
+         typename InstrumentationType>
+std::string RangeSearch<MetricType, TreeType, InstrumentationType>::
+ToString() const
 {
   std::ostringstream convert;
   convert << "Range Search  [" << this << "]" << std::endl;
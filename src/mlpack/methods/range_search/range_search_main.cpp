@@ -12,6 +12,8 @@
 
 #include "range_search.hpp"
 
+#include <fstream>
+
 using namespace std;
 using namespace mlpack;
 using namespace mlpack::range;
@@ -64,8 +66,50 @@ PARAM_FLAG("single_mode", "If true, single-tree search is used (as opposed to "
     "dual-tree search).", "s");
 PARAM_FLAG("cover_tree", "If true, use a cover tree for range searching "
     "(instead of a kd-tree).", "c");
+PARAM_INT("threads", "Number of threads to use for single-tree search (0 uses "
+    "all available cores; ignored if mlpack was built without OpenMP).", "t",
+    0);
+PARAM_STRING("reference_tree_file", "If specified, load the reference tree "
+    "from this file (saved earlier with --save_reference_tree) instead of "
+    "building it.", "", "");
+PARAM_STRING("save_reference_tree", "If specified, save the built reference "
+    "tree to this file, so later runs can load it with --reference_tree_file.",
+    "", "");
 
 typedef RangeSearch<> RSType;
+
+/**
+ * A sink for RangeSearch::Search() which maps the indices of the results back
+ * to the original datasets (the trees are built by hand here, so RangeSearch
+ * does not do that) before storing them.
+ */
+class MappingSink
+{
+ public:
+  MappingSink(RangeSearchResults& results,
+              const vector<size_t>& oldFromNewRefs,
+              const vector<size_t>& oldFromNewQueries) :
+      results(results),
+      oldFromNewRefs(oldFromNewRefs),
+      oldFromNewQueries(oldFromNewQueries) { }
+
+  void Results(const size_t queryIndex,
+               vector<size_t>& neighbors,
+               vector<double>& distances)
+  {
+    for (size_t j = 0; j < neighbors.size(); ++j)
+      neighbors[j] = oldFromNewRefs[neighbors[j]];
+
+    results.Results(oldFromNewQueries[queryIndex], neighbors, distances);
+  }
+
+ private:
+  RangeSearchResults& results;
+  const vector<size_t>& oldFromNewRefs;
+  //! This is oldFromNewRefs if there is no query set.
+  const vector<size_t>& oldFromNewQueries;
+};
+
 typedef CoverTree<metric::EuclideanDistance, tree::FirstPointIsRoot,
     RangeSearchStat> CoverTreeType;
 typedef RangeSearch<metric::EuclideanDistance, CoverTreeType> RSCoverType;
@@ -81,6 +125,10 @@ int main(int argc, char *argv[])
   string distancesFile = CLI::GetParam<string>("distances_file");
   string neighborsFile = CLI::GetParam<string>("neighbors_file");
 
+  const string referenceTreeFile =
+      CLI::GetParam<string>("reference_tree_file");
+  const string saveReferenceTree = CLI::GetParam<string>("save_reference_tree");
+
   int lsInt = CLI::GetParam<int>("leaf_size");
 
   double max = CLI::GetParam<double>("max");
@@ -112,6 +160,14 @@ int main(int argc, char *argv[])
   }
   size_t leafSize = lsInt;
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t threads = (size_t) CLI::GetParam<int>("threads");
+
   // Naive mode overrides single mode.
   if (singleMode && naive)
   {
@@ -127,8 +183,7 @@ int main(int argc, char *argv[])
     coverTree = false;
   }
 
-  vector<vector<size_t> > neighbors;
-  vector<vector<double> > distances;
+  RangeSearchResults results;
 
   // The cover tree implies different types, so we must split this section.
   if (coverTree)
@@ -138,13 +193,42 @@ int main(int argc, char *argv[])
     // This is significantly simpler than kd-tree construction because the data
     // matrix is not modified.
     RSCoverType* rangeSearch = NULL;
-    CoverTreeType referenceTree(referenceData);
+    CoverTreeType* referenceTree = NULL;
+    if (referenceTreeFile != "")
+    {
+      Log::Info << "Loading reference tree from '" << referenceTreeFile
+          << "'..." << endl;
+      ifstream treeStream(referenceTreeFile.c_str(), ios::binary);
+      if (!treeStream.is_open())
+        Log::Fatal << "Cannot open reference tree file '" << referenceTreeFile
+            << "'." << endl;
+
+      Timer::Start("tree_loading");
+      referenceTree = new CoverTreeType(referenceData, treeStream);
+      Timer::Stop("tree_loading");
+    }
+    else
+    {
+      referenceTree = new CoverTreeType(referenceData);
+    }
+
+    if (saveReferenceTree != "")
+    {
+      Log::Info << "Saving reference tree to '" << saveReferenceTree << "'."
+          << endl;
+      ofstream treeStream(saveReferenceTree.c_str(), ios::binary);
+      if (!treeStream.is_open())
+        Log::Fatal << "Cannot open '" << saveReferenceTree << "' for writing."
+            << endl;
+      referenceTree->Save(treeStream);
+    }
+
     CoverTreeType* queryTree = NULL;
 
     if (CLI::GetParam<string>("query_file") == "")
     {
       // Single dataset.
-      rangeSearch = new RSCoverType(&referenceTree, referenceData, singleMode);
+      rangeSearch = new RSCoverType(referenceTree, referenceData, singleMode);
     }
     else
     {
@@ -153,18 +237,20 @@ int main(int argc, char *argv[])
       data::Load(queryFile, queryData, true);
       queryTree = new CoverTreeType(queryData);
 
-      rangeSearch = new RSCoverType(&referenceTree, queryTree, referenceData,
+      rangeSearch = new RSCoverType(referenceTree, queryTree, referenceData,
           queryData, singleMode);
     }
 
     Log::Info << "Trees built." << endl;
 
     const math::Range r(min, max);
-    rangeSearch->Search(r, neighbors, distances);
+    rangeSearch->Threads() = threads;
+    rangeSearch->Search(r, results);
 
     if (queryTree)
       delete queryTree;
     delete rangeSearch;
+    delete referenceTree;
   }
   else
   {
@@ -176,16 +262,44 @@ int main(int argc, char *argv[])
 
     // Build trees by hand, so we can save memory: if we pass a tree to
     // NeighborSearch, it does not copy the matrix.
-    Log::Info << "Building reference tree..." << endl;
-    Timer::Start("tree_building");
+    BinarySpaceTree<bound::HRectBound<2>, RangeSearchStat>* refTree = NULL;
+    if (referenceTreeFile != "")
+    {
+      Log::Info << "Loading reference tree from '" << referenceTreeFile
+          << "'..." << endl;
+      ifstream treeStream(referenceTreeFile.c_str(), ios::binary);
+      if (!treeStream.is_open())
+        Log::Fatal << "Cannot open reference tree file '" << referenceTreeFile
+            << "'." << endl;
+
+      Timer::Start("tree_loading");
+      refTree = new BinarySpaceTree<bound::HRectBound<2>, RangeSearchStat>(
+          referenceData, oldFromNewRefs, treeStream);
+      Timer::Stop("tree_loading");
+    }
+    else
+    {
+      Log::Info << "Building reference tree..." << endl;
+      Timer::Start("tree_building");
+      refTree = new BinarySpaceTree<bound::HRectBound<2>, RangeSearchStat>(
+          referenceData, oldFromNewRefs, leafSize);
+      Timer::Stop("tree_building");
+    }
+
+    if (saveReferenceTree != "")
+    {
+      Log::Info << "Saving reference tree to '" << saveReferenceTree << "'."
+          << endl;
+      ofstream treeStream(saveReferenceTree.c_str(), ios::binary);
+      if (!treeStream.is_open())
+        Log::Fatal << "Cannot open '" << saveReferenceTree << "' for writing."
+            << endl;
+      refTree->Save(treeStream, oldFromNewRefs);
+    }
 
-    BinarySpaceTree<bound::HRectBound<2>, RangeSearchStat>
-        refTree(referenceData, oldFromNewRefs, leafSize);
     BinarySpaceTree<bound::HRectBound<2>, RangeSearchStat>*
         queryTree = NULL; // Empty for now.
 
-    Timer::Stop("tree_building");
-
     vector<size_t> oldFromNewQueries;
 
     if (CLI::GetParam<string>("query_file") != "")
@@ -209,14 +323,14 @@ int main(int argc, char *argv[])
 
       Timer::Stop("tree_building");
 
-      rangeSearch = new RSType(&refTree, queryTree, referenceData, queryData,
+      rangeSearch = new RSType(refTree, queryTree, referenceData, queryData,
           singleMode);
 
       Log::Info << "Tree built." << endl;
     }
     else
     {
-      rangeSearch = new RSType(&refTree, referenceData, singleMode);
+      rangeSearch = new RSType(refTree, referenceData, singleMode);
 
       Log::Info << "Trees built." << endl;
     }
@@ -224,59 +338,24 @@ int main(int argc, char *argv[])
     Log::Info << "Computing neighbors within range [" << min << ", " << max
         << "]." << endl;
 
-    // Collect the results in these vectors before remapping.
-    vector<vector<double> > distancesOut;
-    vector<vector<size_t> > neighborsOut;
+    // We have to map back to the original indices from before the tree
+    // construction; the sink does that as the results come in.
+    const bool hasQuerySet = (CLI::GetParam<string>("query_file") != "");
+    MappingSink sink(results, oldFromNewRefs,
+        hasQuerySet ? oldFromNewQueries : oldFromNewRefs);
 
     const math::Range r(min, max);
-    rangeSearch->Search(r, neighborsOut, distancesOut);
+    results.Reset(hasQuerySet ? queryData.n_cols : referenceData.n_cols);
+    rangeSearch->Threads() = threads;
+    rangeSearch->Search(r, sink);
 
     Log::Info << "Neighbors computed." << endl;
 
-    // We have to map back to the original indices from before the tree
-    // construction.
-    Log::Info << "Re-mapping indices..." << endl;
-
-    distances.resize(distancesOut.size());
-    neighbors.resize(neighborsOut.size());
-
-    // Do the actual remapping.
-    if (CLI::GetParam<string>("query_file") != "")
-    {
-      for (size_t i = 0; i < distances.size(); ++i)
-      {
-        // Map distances (copy a column).
-        distances[oldFromNewQueries[i]] = distancesOut[i];
-
-        // Map indices of neighbors.
-        neighbors[oldFromNewQueries[i]].resize(neighborsOut[i].size());
-        for (size_t j = 0; j < distancesOut[i].size(); ++j)
-        {
-          neighbors[oldFromNewQueries[i]][j] =
-              oldFromNewRefs[neighborsOut[i][j]];
-        }
-      }
-    }
-    else
-    {
-      for (size_t i = 0; i < distances.size(); ++i)
-      {
-        // Map distances (copy a column).
-        distances[oldFromNewRefs[i]] = distancesOut[i];
-
-        // Map indices of neighbors.
-        neighbors[oldFromNewRefs[i]].resize(neighborsOut[i].size());
-        for (size_t j = 0; j < distancesOut[i].size(); ++j)
-        {
-          neighbors[oldFromNewRefs[i]][j] = oldFromNewRefs[neighborsOut[i][j]];
-        }
-      }
-    }
-
     // Clean up.
     if (queryTree)
       delete queryTree;
     delete rangeSearch;
+    delete refTree;
   }
 
   // Save output.  We have to do this by hand.
@@ -289,17 +368,18 @@ int main(int argc, char *argv[])
   else
   {
     // Loop over each point.
-    for (size_t i = 0; i < distances.size(); ++i)
+    for (size_t i = 0; i < results.NumQueries(); ++i)
     {
       // Store the distances of each point.  We may have 0 points to store, so
       // we must account for that possibility.
-      for (size_t j = 0; j + 1 < distances[i].size(); ++j)
+      const size_t numResults = results.NumResults(i);
+      for (size_t j = 0; j + 1 < numResults; ++j)
       {
-        distancesStr << distances[i][j] << ", ";
+        distancesStr << results.Distance(i, j) << ", ";
       }
 
-      if (distances[i].size() > 0)
-        distancesStr << distances[i][distances[i].size() - 1];
+      if (numResults > 0)
+        distancesStr << results.Distance(i, numResults - 1);
 
       distancesStr << endl;
     }
@@ -316,17 +396,18 @@ int main(int argc, char *argv[])
   else
   {
     // Loop over each point.
-    for (size_t i = 0; i < neighbors.size(); ++i)
+    for (size_t i = 0; i < results.NumQueries(); ++i)
     {
       // Store the neighbors of each point.  We may have 0 points to store, so
       // we must account for that possibility.
-      for (size_t j = 0; j + 1 < neighbors[i].size(); ++j)
+      const size_t numResults = results.NumResults(i);
+      for (size_t j = 0; j + 1 < numResults; ++j)
       {
-        neighborsStr << neighbors[i][j] << ", ";
+        neighborsStr << results.Neighbor(i, j) << ", ";
       }
 
-      if (neighbors[i].size() > 0)
-        neighborsStr << neighbors[i][neighbors[i].size() - 1];
+      if (numResults > 0)
+        neighborsStr << results.Neighbor(i, numResults - 1);
 
       neighborsStr << endl;
     }
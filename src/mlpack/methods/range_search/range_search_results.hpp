@@ -0,0 +1,108 @@
+/**
+ * @file range_search_results.hpp
+ *
+ * Definition of RangeSearchResults, a compact container for the results of a
+ * range search.
+ */
+#ifndef __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RESULTS_HPP
+#define __MLPACK_METHODS_RANGE_SEARCH_RANGE_SEARCH_RESULTS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace range {
+
+/**
+ * A compact container for range search results.  Instead of holding one
+ * std::vector of neighbors and one of distances for each query point (which
+ * means two heap allocations per query point), all the neighbor indices and
+ * distances are held in two flat arrays, and each query point only stores the
+ * offset and the number of its results.  The results of each query point are
+ * contiguous, but the query points are stored in the order in which they were
+ * finished, which is not necessarily the order of the query set.
+ *
+ * This can be passed directly to RangeSearch::Search().  It is also an example
+ * of the sink interface that RangeSearch::Search() takes: RangeSearch calls
+ * Results() once for each query point, as soon as the results of that query
+ * point are known.
+ */
+class RangeSearchResults
+{
+ public:
+  //! Create an empty results object.
+  RangeSearchResults() { }
+
+  /**
+   * Remove all results, and prepare to store results for the given number of
+   * query points.  Each query point starts out with no results.
+   *
+   * @param numQueries Number of query points.
+   */
+  void Reset(const size_t numQueries)
+  {
+    offsets.assign(numQueries, 0);
+    counts.assign(numQueries, 0);
+    neighbors.clear();
+    distances.clear();
+  }
+
+  /**
+   * Store the results of a query point.  Each query point should only be given
+   * once.  The given vectors are not modified.
+   *
+   * @param queryIndex Index of the query point.
+   * @param queryNeighbors Indices of the reference points in range.
+   * @param queryDistances Distances to the reference points in range.
+   */
+  void Results(const size_t queryIndex,
+               std::vector<size_t>& queryNeighbors,
+               std::vector<double>& queryDistances)
+  {
+    offsets[queryIndex] = neighbors.size();
+    counts[queryIndex] = queryNeighbors.size();
+    neighbors.insert(neighbors.end(), queryNeighbors.begin(),
+        queryNeighbors.end());
+    distances.insert(distances.end(), queryDistances.begin(),
+        queryDistances.end());
+  }
+
+  //! Get the number of query points.
+  size_t NumQueries() const { return counts.size(); }
+  //! Get the total number of results, over all query points.
+  size_t TotalResults() const { return neighbors.size(); }
+
+  //! Get the number of results of the given query point.
+  size_t NumResults(const size_t queryIndex) const
+  { return counts[queryIndex]; }
+
+  //! Get the index of the i'th neighbor of the given query point.
+  size_t Neighbor(const size_t queryIndex, const size_t i) const
+  { return neighbors[offsets[queryIndex] + i]; }
+  //! Get the distance to the i'th neighbor of the given query point.
+  double Distance(const size_t queryIndex, const size_t i) const
+  { return distances[offsets[queryIndex] + i]; }
+
+  //! Get the offset of the results of the given query point in Neighbors() and
+  //! Distances().
+  size_t Offset(const size_t queryIndex) const { return offsets[queryIndex]; }
+
+  //! Get the flat array of neighbor indices.
+  const std::vector<size_t>& Neighbors() const { return neighbors; }
+  //! Get the flat array of distances.
+  const std::vector<double>& Distances() const { return distances; }
+
+ private:
+  //! The offset of the results of each query point.
+  std::vector<size_t> offsets;
+  //! The number of results of each query point.
+  std::vector<size_t> counts;
+  //! The indices of the neighbors of all query points.
+  std::vector<size_t> neighbors;
+  //! The distances to the neighbors of all query points.
+  std::vector<double> distances;
+};
+
+}; // namespace range
+}; // namespace mlpack
+
+#endif
@@ -27,13 +27,20 @@ class RangeSearchRules
    * @param neighbors Vector to store resulting neighbors in.
    * @param distances Vector to store resulting distances in.
    * @param metric Instantiated metric.
+   * @param counts If not NULL, only the number of reference points in range of
+   *     each query point is computed, and added to this vector; neighbors and
+   *     distances are not touched.  Reference nodes entirely in range are then
+   *     counted without visiting their points.  If the tree does not have
+   *     self-children, each query point is counted in its own range even if
+   *     the datasets are the same, so the caller must subtract it.
    */
   RangeSearchRules(const arma::mat& referenceSet,
                    const arma::mat& querySet,
                    const math::Range& range,
                    std::vector<std::vector<size_t> >& neighbors,
                    std::vector<std::vector<double> >& distances,
-                   MetricType& metric);
+                   MetricType& metric,
+                   arma::Col<size_t>* counts = NULL);
 
   /**
    * Compute the base case between the given query point and reference point.
@@ -117,14 +124,19 @@ class RangeSearchRules
   //! The instantiated metric.
   MetricType& metric;
 
+  //! The counts of the query points, if only counting (NULL otherwise).
+  arma::Col<size_t>* counts;
+  //! If true, a point is counted in its own range; see the constructor.
+  bool countSelf;
+
   //! The last query index.
   size_t lastQueryIndex;
   //! The last reference index.
   size_t lastReferenceIndex;
 
-  //! Add all the points in the given node to the results for the given query
-  //! point.  If the base case has already been calculated, we make sure to not
-  //! add that to the results twice.
+  //! Add all the points in the given node to the results (or the count) for
+  //! the given query point.  If the base case has already been calculated, we
+  //! make sure to not add that to the results twice.
   void AddResult(const size_t queryIndex,
                  TreeType& referenceNode);
 
@@ -20,13 +20,17 @@ RangeSearchRules<MetricType, TreeType>::RangeSearchRules(
     const math::Range& range,
     std::vector<std::vector<size_t> >& neighbors,
     std::vector<std::vector<double> >& distances,
-    MetricType& metric) :
+    MetricType& metric,
+    arma::Col<size_t>* counts) :
     referenceSet(referenceSet),
     querySet(querySet),
     range(range),
     neighbors(neighbors),
     distances(distances),
     metric(metric),
+    counts(counts),
+    countSelf((counts != NULL) &&
+        !tree::TreeTraits<TreeType>::HasSelfChildren),
     lastQueryIndex(querySet.n_cols),
     lastReferenceIndex(referenceSet.n_cols)
 {
@@ -42,7 +46,10 @@ double RangeSearchRules<MetricType, TreeType>::BaseCase(
     const size_t referenceIndex)
 {
   // If the datasets are the same, don't return the point as in its own range.
-  if ((&referenceSet == &querySet) && (queryIndex == referenceIndex))
+  // When counting, the point may be counted like any other, because whole
+  // nodes are then counted without checking whether they hold the query point.
+  if (!countSelf && (&referenceSet == &querySet) &&
+      (queryIndex == referenceIndex))
     return 0.0;
 
   // If we have just performed this base case, don't do it again.
@@ -58,8 +65,15 @@ double RangeSearchRules<MetricType, TreeType>::BaseCase(
 
   if (range.Contains(distance))
   {
-    neighbors[queryIndex].push_back(referenceIndex);
-    distances[queryIndex].push_back(distance);
+    if (counts != NULL)
+    {
+      ++(*counts)[queryIndex];
+    }
+    else
+    {
+      neighbors[queryIndex].push_back(referenceIndex);
+      distances[queryIndex].push_back(distance);
+    }
   }
 
   return distance;
@@ -224,6 +238,26 @@ void RangeSearchRules<MetricType, TreeType>::AddResult(const size_t queryIndex,
     baseCaseMod = 1;
   }
 
+  // When counting, there is no need to look at the points, unless the query
+  // point may be among them and must not be counted.  With self-children, the
+  // base case between a point and itself can be evaluated more than once, so
+  // counting it and taking it out afterwards would not be reliable.
+  if (counts != NULL)
+  {
+    if (countSelf || (&referenceSet != &querySet))
+    {
+      (*counts)[queryIndex] += referenceNode.NumDescendants() - baseCaseMod;
+    }
+    else
+    {
+      for (size_t i = baseCaseMod; i < referenceNode.NumDescendants(); ++i)
+        if (queryIndex != referenceNode.Descendant(i))
+          ++(*counts)[queryIndex];
+    }
+
+    return;
+  }
+
   // Resize distances and neighbors vectors appropriately.  We have to use
   // reserve() and not resize(), because we don't know if we will encounter the
   // case where the datasets and points are the same (and we skip in that case).
@@ -14,6 +14,7 @@
 #include <fstream>
 #include <iostream>
 
+#include <mlpack/methods/neighbor_search/unmap.hpp>
 #include "ra_search.hpp"
 
 using namespace std;
@@ -76,6 +77,12 @@ PARAM_FLAG("first_leaf_exact", "The flag to trigger sampling only after "
            "exactly exploring the first leaf.", "X");
 PARAM_INT("single_sample_limit", "The limit on the maximum number of "
     "samples (and hence the largest node you can approximate).", "S", 20);
+PARAM_INT("threads", "Number of threads to use for search (0 uses all "
+    "available cores; ignored if mlpack was built without OpenMP).", "T", 0);
+PARAM_DOUBLE("time_limit", "If nonzero, stop refining the search after this "
+    "many seconds and output the neighbors found so far; neighbors that were "
+    "never found are given as the largest index and the worst distance.", "m",
+    0.0);
 
 int main(int argc, char *argv[])
 {
@@ -101,6 +108,22 @@ int main(int argc, char *argv[])
   bool sampleAtLeaves = CLI::HasParam("sample_at_leaves");
   bool firstLeafExact = CLI::HasParam("first_leaf_exact");
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t threads = (size_t) CLI::GetParam<int>("threads");
+
+  // Sanity check on the time limit.
+  const double timeLimit = CLI::GetParam<double>("time_limit");
+  if (timeLimit < 0.0)
+  {
+    Log::Fatal << "Invalid time limit: " << timeLimit << ".  Must be greater "
+        << "than or equal to 0." << endl;
+  }
+
   arma::mat referenceData;
   arma::mat queryData; // So it doesn't go out of scope.
   data::Load(referenceFile, referenceData, true);
@@ -160,6 +183,8 @@ int main(int argc, char *argv[])
     Log::Info << "Computing " << k << " nearest neighbors " << "with " <<
       tau << "% rank approximation..." << endl;
 
+    allkrann->Threads() = threads;
+    allkrann->TimeLimit() = timeLimit;
     allkrann->Search(k, neighbors, distances, tau, alpha);
 
     Log::Info << "Neighbors computed." << endl;
@@ -233,6 +258,8 @@ int main(int argc, char *argv[])
 
       Log::Info << "Computing " << k << " nearest neighbors " << "with " <<
         tau << "% rank approximation..." << endl;
+      allkrann->Threads() = threads;
+      allkrann->TimeLimit() = timeLimit;
       allkrann->Search(k, neighborsOut, distancesOut,
                        tau, alpha, sampleAtLeaves,
                        firstLeafExact, singleSampleLimit);
@@ -243,40 +270,14 @@ int main(int argc, char *argv[])
       // construction.
       Log::Info << "Re-mapping indices..." << endl;
 
-      neighbors.set_size(neighborsOut.n_rows, neighborsOut.n_cols);
-      distances.set_size(distancesOut.n_rows, distancesOut.n_cols);
-
-      // Do the actual remapping.
+      // Do the actual remapping.  Neighbors that were never found (because of
+      // the time limit) keep their invalid index.
       if (CLI::GetParam<string>("query_file") != "")
-      {
-        for (size_t i = 0; i < distancesOut.n_cols; ++i)
-        {
-          // Map distances (copy a column).
-          distances.col(oldFromNewQueries[i]) = distancesOut.col(i);
-
-          // Map indices of neighbors.
-          for (size_t j = 0; j < distancesOut.n_rows; ++j)
-          {
-            neighbors(j, oldFromNewQueries[i])
-              = oldFromNewRefs[neighborsOut(j, i)];
-          }
-        }
-      }
+        Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewQueries,
+            neighbors, distances, false, threads);
       else
-      {
-        for (size_t i = 0; i < distancesOut.n_cols; ++i)
-        {
-          // Map distances (copy a column).
-          distances.col(oldFromNewRefs[i]) = distancesOut.col(i);
-
-          // Map indices of neighbors.
-          for (size_t j = 0; j < distancesOut.n_rows; ++j)
-          {
-            neighbors(j, oldFromNewRefs[i])
-              = oldFromNewRefs[neighborsOut(j, i)];
-          }
-        }
-      }
+        Unmap(neighborsOut, distancesOut, oldFromNewRefs, oldFromNewRefs,
+            neighbors, distances, false, threads);
 
       // Clean up.
       if (queryTree)
@@ -219,6 +219,12 @@ class RASearch
    *     if there exists one.  This defaults to 'false' for now.
    * @param singleSampleLimit The limit on the largest node that can be
    *     approximated by sampling. This defaults to 20.
+   *
+   * If mlpack was compiled with OpenMP, the search is run with Threads()
+   * threads.  If TimeLimit() is nonzero, the search stops refining once that
+   * many seconds have passed and returns the neighbors found so far; then
+   * DeadlineReached() is true, and any neighbor slot that was never filled
+   * holds index (size_t() - 1) and the worst possible distance.
    */
   void Search(const size_t k,
               arma::Mat<size_t>& resultingNeighbors,
@@ -238,6 +244,20 @@ class RASearch
    */
   void ResetQueryTree();
 
+  //! Get the number of threads used for search (0 means all available).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for search (0 means all available).
+  //! This has no effect if mlpack was compiled without OpenMP.
+  size_t& Threads() { return threads; }
+
+  //! Get the time limit for search, in seconds (0 means no limit).
+  double TimeLimit() const { return timeLimit; }
+  //! Modify the time limit for search, in seconds (0 means no limit).
+  double& TimeLimit() { return timeLimit; }
+
+  //! Get whether the last search was stopped early by the time limit.
+  bool DeadlineReached() const { return deadlineReached; }
+
   // Returns a string representation of this object.
   std::string ToString() const;
 
@@ -279,11 +299,27 @@ class RASearch
   //! Total number of pruned nodes during the neighbor search.
   size_t numberOfPrunes;
 
+  //! The number of threads to use for search (0 means all available).
+  size_t threads;
+
+  //! The time limit for search, in seconds (0 means no limit).
+  double timeLimit;
+
+  //! Whether the last search was stopped early by the time limit.
+  bool deadlineReached;
+
   /**
    * @param treeNode The node of the tree whose RAQueryStat is reset
    *     and whose children are to be explored recursively.
    */
   void ResetRAQueryStat(TreeType* treeNode);
+
+  /**
+   * Map the index of a neighbor in the reference tree back to its index in the
+   * original reference set, leaving an invalid index (from a slot that was
+   * never filled) alone.
+   */
+  size_t MapNeighbor(const size_t neighbor) const;
 }; // class RASearch
 
 }; // namespace neighbor
@@ -9,6 +9,7 @@
 #define __MLPACK_METHODS_RANN_RA_SEARCH_IMPL_HPP
 
 #include <mlpack/core.hpp>
+#include <mlpack/methods/neighbor_search/unmap.hpp>
 
 #include "ra_search_rules.hpp"
 
@@ -62,7 +63,10 @@ RASearch(const typename TreeType::Mat& referenceSetIn,
     naive(naive),
     singleMode(!naive && singleMode), // No single mode if naive.
     metric(metric),
-    numberOfPrunes(0)
+    numberOfPrunes(0),
+    threads(0),
+    timeLimit(0.0),
+    deadlineReached(false)
 {
   // We'll time tree building.
   Timer::Start("tree_building");
@@ -107,7 +111,10 @@ RASearch(const typename TreeType::Mat& referenceSetIn,
     naive(naive),
     singleMode(!naive && singleMode), // No single mode if naive.
     metric(metric),
-    numberOfPrunes(0)
+    numberOfPrunes(0),
+    threads(0),
+    timeLimit(0.0),
+    deadlineReached(false)
 {
   // We'll time tree building.
   Timer::Start("tree_building");
@@ -142,7 +149,10 @@ RASearch(TreeType* referenceTree,
     naive(false),
     singleMode(singleMode),
     metric(metric),
-    numberOfPrunes(0)
+    numberOfPrunes(0),
+    threads(0),
+    timeLimit(0.0),
+    deadlineReached(false)
 // Nothing else to initialize.
 {  }
 
@@ -162,7 +172,10 @@ RASearch(TreeType* referenceTree,
     naive(false),
     singleMode(singleMode),
     metric(metric),
-    numberOfPrunes(0)
+    numberOfPrunes(0),
+    threads(0),
+    timeLimit(0.0),
+    deadlineReached(false)
 // Nothing else to initialize.
 { }
 
@@ -217,169 +230,222 @@ Search(const size_t k,
       neighborPtr = new arma::Mat<size_t>; // All indices need mapping.
   }
 
-  // Set the size of the neighbor and distance matrices.
+  // Set the size of the neighbor and distance matrices.  A slot is only left
+  // unfilled if the time limit is reached, in which case it keeps an invalid
+  // index.
   neighborPtr->set_size(k, querySet.n_cols);
+  neighborPtr->fill(size_t() - 1);
   distancePtr->set_size(k, querySet.n_cols);
   distancePtr->fill(SortPolicy::WorstDistance());
 
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  const double deadline = (timeLimit > 0.0) ? (Timer::Now() + timeLimit) : 0.0;
   size_t numPrunes = 0;
+  size_t numDistComputations = 0;
+  bool reachedDeadline = false;
+
+  // The rules are built once here, and then each thread works with its own
+  // copy of them.  Each copy shares the output matrices, but every query point
+  // is only ever handled by one thread.
+  typedef RASearchRules<SortPolicy, MetricType, TreeType> RuleType;
+  RuleType rules(referenceSet, querySet, *neighborPtr, *distancePtr, metric,
+      tau, alpha, false, sampleAtLeaves, firstLeafExact, singleSampleLimit,
+      deadline);
 
   if (naive)
   {
     // We don't need to run the base case on every possible combination of
     // points; we can achieve the rank approximation guarantee with probability
     // alpha by sampling the reference set.
-    typedef RASearchRules<SortPolicy, MetricType, TreeType> RuleType;
-    RuleType rules(referenceSet, querySet, *neighborPtr, *distancePtr,
-                   metric, tau, alpha, naive, sampleAtLeaves, firstLeafExact,
-                   singleSampleLimit);
 
     // Find how many samples from the reference set we need and sample uniformly
-    // from the reference set without replacement.
+    // from the reference set without replacement.  Every query point gets its
+    // own samples, followed by one set of samples shared by all of them.  These
+    // are all drawn here, in order, so that the results for a given random seed
+    // do not depend on the number of threads.
     const size_t numSamples = rules.MinimumSamplesReqd(referenceSet.n_cols, k,
         tau, alpha);
+    std::vector<arma::uvec> querySamples(querySet.n_cols);
+    for (size_t i = 0; i < querySet.n_cols; ++i)
+      rules.ObtainDistinctSamples(numSamples, referenceSet.n_cols,
+          querySamples[i]);
+
     arma::uvec distinctSamples;
     rules.ObtainDistinctSamples(numSamples, referenceSet.n_cols,
         distinctSamples);
 
     // Run the base case on each combination of query point and sampled
     // reference point.
-    for (size_t i = 0; i < querySet.n_cols; ++i)
-      for (size_t j = 0; j < distinctSamples.n_elem; ++j)
-        rules.BaseCase(i, (size_t) distinctSamples[j]);
+    #pragma omp parallel num_threads(numThreads) \
+        reduction(+:numDistComputations) reduction(||:reachedDeadline)
+    {
+      RuleType threadRules(rules);
+
+      #pragma omp for schedule(dynamic, 16)
+      for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+      {
+        if ((deadline != 0.0) && (reachedDeadline || Timer::Now() >= deadline))
+        {
+          reachedDeadline = true;
+          continue;
+        }
+
+        for (size_t j = 0; j < querySamples[i].n_elem; ++j)
+          threadRules.BaseCase(i, (size_t) querySamples[i][j]);
+        for (size_t j = 0; j < distinctSamples.n_elem; ++j)
+          threadRules.BaseCase(i, (size_t) distinctSamples[j]);
+      }
+
+      numDistComputations += threadRules.NumDistComputations();
+    }
   }
   else if (singleMode)
   {
-    // Create the helper object for the tree traversal.  Initialization of
-    // RASearchRules already implicitly performs the naive tree traversal.
-    typedef RASearchRules<SortPolicy, MetricType, TreeType> RuleType;
-    RuleType rules(referenceSet, querySet, *neighborPtr, *distancePtr,
-                   metric, tau, alpha, naive, sampleAtLeaves, firstLeafExact,
-                   singleSampleLimit);
-
     // If the reference root node is a leaf, then the sampling has already been
     // done in the RASearchRules constructor.  This happens when naive = true.
     if (!referenceTree->IsLeaf())
     {
       Log::Info << "Performing single-tree traversal..." << std::endl;
 
-      // Create the traverser.
-      typename TreeType::template SingleTreeTraverser<RuleType>
-        traverser(rules);
+      // The query points are split between the threads.
+      #pragma omp parallel num_threads(numThreads) \
+          reduction(+:numPrunes, numDistComputations) \
+          reduction(||:reachedDeadline)
+      {
+        RuleType threadRules(rules);
+
+        // Create the traverser.
+        typename TreeType::template SingleTreeTraverser<RuleType>
+          traverser(threadRules);
 
-      // Now have it traverse for each point.
-      for (size_t i = 0; i < querySet.n_cols; ++i)
-        traverser.Traverse(i, *referenceTree);
+        // Now have it traverse for each point.
+        #pragma omp for schedule(dynamic, 16)
+        for (omp_size_t i = 0; i < (omp_size_t) querySet.n_cols; ++i)
+          traverser.Traverse(i, *referenceTree);
 
-      numPrunes = traverser.NumPrunes();
+        numPrunes += traverser.NumPrunes();
+        numDistComputations += threadRules.NumDistComputations();
+        reachedDeadline = reachedDeadline || threadRules.DeadlineReached();
+      }
 
       Log::Info << "Single-tree traversal complete." << std::endl;
       Log::Info << "Average number of distance calculations per query point: "
-          << (rules.NumDistComputations() / querySet.n_cols) << "."
-          << std::endl;
+          << (numDistComputations / querySet.n_cols) << "." << std::endl;
     }
   }
   else // Dual-tree recursion.
   {
     Log::Info << "Performing dual-tree traversal..." << std::endl;
 
-    typedef RASearchRules<SortPolicy, MetricType, TreeType> RuleType;
-    RuleType rules(referenceSet, querySet, *neighborPtr, *distancePtr,
-                   metric, tau, alpha, sampleAtLeaves, firstLeafExact,
-                   singleSampleLimit);
-
-    typename TreeType::template DualTreeTraverser<RuleType> traverser(rules);
-
-    if (queryTree)
+    TreeType* queryRoot = (queryTree != NULL) ? queryTree : referenceTree;
+    Log::Info << "Query statistic pre-search: "
+        << queryRoot->Stat().NumSamplesMade() << std::endl;
+
+    // Split the query tree into disjoint subtrees near its root, so that the
+    // threads can traverse them independently.  This isn't possible for trees
+    // where a node shares its point with its first child (i.e. the cover
+    // tree), so those are always searched serially.
+    std::vector<TreeType*> tasks;
+    tasks.push_back(queryRoot);
+    if (!tree::TreeTraits<TreeType>::HasSelfChildren)
     {
-      Log::Info << "Query statistic pre-search: "
-          << queryTree->Stat().NumSamplesMade() << std::endl;
-      traverser.Traverse(*queryTree, *referenceTree);
+      bool expanded = true;
+      while ((numThreads > 1) && expanded && (tasks.size() < 8 * numThreads))
+      {
+        expanded = false;
+        std::vector<TreeType*> nextTasks;
+        for (size_t i = 0; i < tasks.size(); ++i)
+        {
+          if (tasks[i]->IsLeaf())
+          {
+            nextTasks.push_back(tasks[i]);
+            continue;
+          }
+
+          for (size_t c = 0; c < tasks[i]->NumChildren(); ++c)
+            nextTasks.push_back(&tasks[i]->Child(c));
+          expanded = true;
+        }
+
+        tasks.swap(nextTasks);
+      }
     }
-    else
+
+    #pragma omp parallel num_threads(numThreads) \
+        reduction(+:numPrunes, numDistComputations) \
+        reduction(||:reachedDeadline)
     {
-      Log::Info << "Query statistic pre-search: "
-          << referenceTree->Stat().NumSamplesMade() << std::endl;
-      traverser.Traverse(*referenceTree, *referenceTree);
-    }
+      RuleType threadRules(rules);
 
-    numPrunes = traverser.NumPrunes();
+      #pragma omp for schedule(dynamic)
+      for (omp_size_t i = 0; i < (omp_size_t) tasks.size(); ++i)
+      {
+        typename TreeType::template DualTreeTraverser<RuleType>
+            traverser(threadRules);
+        traverser.Traverse(*tasks[i], *referenceTree);
+        numPrunes += traverser.NumPrunes();
+      }
+
+      numDistComputations += threadRules.NumDistComputations();
+      reachedDeadline = reachedDeadline || threadRules.DeadlineReached();
+    }
 
     Log::Info << "Dual-tree traversal complete." << std::endl;
     Log::Info << "Average number of distance calculations per query point: "
-        << (rules.NumDistComputations() / querySet.n_cols) << "." << std::endl;
+        << (numDistComputations / querySet.n_cols) << "." << std::endl;
   }
 
+  deadlineReached = reachedDeadline;
+  if (deadlineReached)
+    Log::Warn << "RASearch::Search(): time limit of " << timeLimit << "s "
+        << "reached; returning the neighbors found so far." << std::endl;
+
   Timer::Stop("computing_neighbors");
   Log::Info << "Pruned " << numPrunes << " nodes." << std::endl;
 
   // Now, do we need to do mapping of indices?
   if (!treeOwner || !tree::TreeTraits<TreeType>::RearrangesDataset)
-  {
-    // No mapping needed.  We are done.
-    return;
-  }
-  else if (treeOwner && hasQuerySet && !singleMode) // Map both sets.
-  {
-    // Set size of output matrices correctly.
-    resultingNeighbors.set_size(k, querySet.n_cols);
-    distances.set_size(k, querySet.n_cols);
-
-    for (size_t i = 0; i < distances.n_cols; i++)
-    {
-      // Map distances (copy a column).
-      distances.col(oldFromNewQueries[i]) = distancePtr->col(i);
+    return; // No mapping needed.  We are done.
 
-      // Map indices of neighbors.
-      for (size_t j = 0; j < distances.n_rows; j++)
-      {
-        resultingNeighbors(j, oldFromNewQueries[i]) =
-            oldFromNewReferences[(*neighborPtr)(j, i)];
-      }
-    }
-
-    // Finished with temporary matrices.
-    delete neighborPtr;
-    delete distancePtr;
-  }
-  else if (treeOwner && !hasQuerySet)
+  // Map the results back to the original indices, in parallel.  Slots that
+  // were never filled keep their invalid index.
+  if (hasQuerySet && singleMode)
   {
-    // No query tree -- map both references and queries.
+    // No query tree was built, so only the neighbors need mapping.
     resultingNeighbors.set_size(k, querySet.n_cols);
-    distances.set_size(k, querySet.n_cols);
 
-    for (size_t i = 0; i < distances.n_cols; i++)
-    {
-      // Map distances (copy a column).
-      distances.col(oldFromNewReferences[i]) = distancePtr->col(i);
-
-      // Map indices of neighbors.
-      for (size_t j = 0; j < distances.n_rows; j++)
-      {
-        resultingNeighbors(j, oldFromNewReferences[i]) =
-            oldFromNewReferences[(*neighborPtr)(j, i)];
-      }
-    }
+    #pragma omp parallel for num_threads(numThreads)
+    for (omp_size_t i = 0; i < (omp_size_t) resultingNeighbors.n_elem; ++i)
+      resultingNeighbors[i] = MapNeighbor((*neighborPtr)[i]);
   }
-  else if (treeOwner && hasQuerySet && singleMode) // Map only references.
+  else
   {
-    // Set size of neighbor indices matrix correctly.
-    resultingNeighbors.set_size(k, querySet.n_cols);
-
-    // Map indices of neighbors.
-    for (size_t i = 0; i < resultingNeighbors.n_cols; i++)
-    {
-      for (size_t j = 0; j < resultingNeighbors.n_rows; j++)
-      {
-        resultingNeighbors(j, i) = oldFromNewReferences[(*neighborPtr)(j, i)];
-      }
-    }
-
-    // Finished with temporary matrix.
-    delete neighborPtr;
+    // Without a query set, the queries are the (rearranged) reference points.
+    Unmap(*neighborPtr, *distancePtr, oldFromNewReferences,
+        hasQuerySet ? oldFromNewQueries : oldFromNewReferences,
+        resultingNeighbors, distances, false, numThreads);
+    delete distancePtr;
   }
+
+  // Finished with temporary matrices.
+  delete neighborPtr;
 } // Search
 
+template<typename SortPolicy, typename MetricType, typename TreeType>
+size_t RASearch<SortPolicy, MetricType, TreeType>::MapNeighbor(
+    const size_t neighbor) const
+{
+  // Slots that were never filled keep their invalid index.
+  return (neighbor < oldFromNewReferences.size()) ?
+      oldFromNewReferences[neighbor] : neighbor;
+}
+
 template<typename SortPolicy, typename MetricType, typename TreeType>
 void RASearch<SortPolicy, MetricType, TreeType>::ResetQueryTree()
 {
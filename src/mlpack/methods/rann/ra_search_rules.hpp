@@ -19,6 +19,8 @@ template<typename SortPolicy, typename MetricType, typename TreeType>
 class RASearchRules
 {
  public:
+  // If deadline is nonzero, it is a time given by Timer::Now(); once it has
+  // passed, every remaining node combination is pruned.
   RASearchRules(const arma::mat& referenceSet,
                 const arma::mat& querySet,
                 arma::Mat<size_t>& neighbors,
@@ -29,7 +31,8 @@ class RASearchRules
                 const bool naive = false,
                 const bool sampleAtLeaves = false,
                 const bool firstLeafExact = false,
-                const size_t singleSampleLimit = 20);
+                const size_t singleSampleLimit = 20,
+                const double deadline = 0.0);
 
 
 
@@ -179,6 +182,9 @@ class RASearchRules
 
 
   size_t NumDistComputations() { return numDistComputations; }
+
+  //! Get whether the deadline passed and the search was cut short.
+  bool DeadlineReached() const { return pastDeadline; }
   size_t NumEffectiveSamples()
   {
     if (numSamplesMade.n_elem == 0)
@@ -231,6 +237,19 @@ class RASearchRules
 
   TraversalInfoType traversalInfo;
 
+  //! Time (from Timer::Now()) at which to stop the search; 0 means never.
+  double deadline;
+
+  //! Number of times the deadline has been checked.
+  size_t deadlineChecks;
+
+  //! Whether the deadline has passed.
+  bool pastDeadline;
+
+  //! Check whether the deadline has passed (reading the clock only
+  //! occasionally).
+  bool PastDeadline();
+
   /**
    * Insert a point into the neighbors and distances matrices; this is a helper
    * function.
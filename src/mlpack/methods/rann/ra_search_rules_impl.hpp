@@ -25,7 +25,8 @@ RASearchRules(const arma::mat& referenceSet,
               const bool naive,
               const bool sampleAtLeaves,
               const bool firstLeafExact,
-              const size_t singleSampleLimit) :
+              const size_t singleSampleLimit,
+              const double deadline) :
   referenceSet(referenceSet),
   querySet(querySet),
   neighbors(neighbors),
@@ -33,7 +34,10 @@ RASearchRules(const arma::mat& referenceSet,
   metric(metric),
   sampleAtLeaves(sampleAtLeaves),
   firstLeafExact(firstLeafExact),
-  singleSampleLimit(singleSampleLimit)
+  singleSampleLimit(singleSampleLimit),
+  deadline(deadline),
+  deadlineChecks(0),
+  pastDeadline(false)
 {
   // Validate tau to make sure that the rank approximation is greater than the
   // number of neighbors requested.
@@ -100,6 +104,20 @@ ObtainDistinctSamples(const size_t numSamples,
 
 
 
+template<typename SortPolicy, typename MetricType, typename TreeType>
+inline bool RASearchRules<SortPolicy, MetricType, TreeType>::PastDeadline()
+{
+  if ((deadline == 0.0) || pastDeadline)
+    return pastDeadline;
+
+  // Reading the clock on every call would be too expensive, so only check it
+  // every so often.
+  if ((++deadlineChecks % 64) == 0)
+    pastDeadline = (Timer::Now() >= deadline);
+
+  return pastDeadline;
+}
+
 template<typename SortPolicy, typename MetricType, typename TreeType>
 size_t RASearchRules<SortPolicy, MetricType, TreeType>::
 MinimumSamplesReqd(const size_t n,
@@ -327,6 +345,10 @@ inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
     const double distance,
     const double bestDistance)
 {
+  // Once the deadline has passed, prune everything that is left.
+  if (PastDeadline())
+    return DBL_MAX;
+
   // If this is better than the best distance we've seen so far, maybe there
   // will be something down this node.  Also check if enough samples are already
   // made for this query.
@@ -422,6 +444,10 @@ Rescore(const size_t queryIndex,
         TreeType& referenceNode,
         const double oldScore)
 {
+  // Once the deadline has passed, prune everything that is left.
+  if (PastDeadline())
+    return DBL_MAX;
+
   // If we are already pruning, still prune.
   if (oldScore == DBL_MAX)
     return oldScore;
@@ -593,6 +619,10 @@ inline double RASearchRules<SortPolicy, MetricType, TreeType>::Score(
     const double distance,
     const double bestDistance)
 {
+  // Once the deadline has passed, prune everything that is left.
+  if (PastDeadline())
+    return DBL_MAX;
+
   // Update the number of samples made for this node -- propagate up from child
   // nodes if child nodes have made samples that the parent node is not aware
   // of.  Remember, we must propagate down samples made to the child nodes if
@@ -770,6 +800,10 @@ Rescore(TreeType& queryNode,
         TreeType& referenceNode,
         const double oldScore)
 {
+  // Once the deadline has passed, prune everything that is left.
+  if (PastDeadline())
+    return DBL_MAX;
+
   if (oldScore == DBL_MAX)
     return oldScore;
 
@@ -83,6 +83,28 @@ class RegularizedSVD
              const size_t rank,
              arma::mat& u,
              arma::mat& v);
+
+  /**
+   * Obtains the user and item matrices using the provided data, starting the
+   * optimization from the given user and item matrices instead of random ones
+   * (a warm start).  This is useful to update a decomposition when new ratings
+   * arrive: starting from the old decomposition, far fewer iterations are
+   * needed.  The rank is that of the initial matrices.  The data may have new
+   * users and items, which are initialized randomly; the returned matrices
+   * then have rows or columns for them.  The initial matrices may be the same
+   * objects as the output matrices.
+   *
+   * @param data Rating data matrix.
+   * @param initialU Item matrix to start from.
+   * @param initialV User matrix to start from.
+   * @param u Item matrix obtained on decomposition.
+   * @param v User matrix obtained on decomposition.
+   */
+  void Apply(const arma::mat& data,
+             const arma::mat& initialU,
+             const arma::mat& initialV,
+             arma::mat& u,
+             arma::mat& v);
                  
  private:
   //! Number of optimization iterations.
@@ -91,6 +113,14 @@ class RegularizedSVD
   double alpha;
   //! Regularization parameter for the optimization.
   double lambda;
+
+  /**
+   * Optimize the given function from its initial point, and extract the user
+   * and item matrices.
+   */
+  void Optimize(RegularizedSVDFunction& rSVDFunc,
+                arma::mat& u,
+                arma::mat& v);
 };
 
 }; // namespace svd
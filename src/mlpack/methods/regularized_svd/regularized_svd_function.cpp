@@ -25,6 +25,34 @@ RegularizedSVDFunction::RegularizedSVDFunction(const arma::mat& data,
   initialPoint.randu(rank, numUsers + numItems);
 }
 
+RegularizedSVDFunction::RegularizedSVDFunction(const arma::mat& data,
+                                               const arma::mat& u,
+                                               const arma::mat& v,
+                                               const double lambda) :
+    data(data),
+    rank(u.n_cols),
+    lambda(lambda)
+{
+  if (v.n_rows != rank)
+  {
+    Log::Fatal << "RegularizedSVDFunction::RegularizedSVDFunction(): rank of "
+        << "item matrix (" << rank << ") does not match rank of user matrix ("
+        << v.n_rows << ")!" << std::endl;
+  }
+
+  // Number of users and items; there may be new ones in the data.
+  numUsers = std::max((size_t) max(data.row(0)) + 1, (size_t) v.n_cols);
+  numItems = std::max((size_t) max(data.row(1)) + 1, (size_t) u.n_rows);
+
+  // New users and items are initialized randomly, and the rest start from the
+  // given factors.
+  initialPoint.randu(rank, numUsers + numItems);
+  if (v.n_cols > 0)
+    initialPoint.cols(0, v.n_cols - 1) = v;
+  if (u.n_rows > 0)
+    initialPoint.cols(numUsers, numUsers + u.n_rows - 1) = trans(u);
+}
+
 double RegularizedSVDFunction::Evaluate(const arma::mat& parameters) const
 {
   // The cost for the optimization is as follows:
@@ -116,6 +144,32 @@ void RegularizedSVDFunction::Gradient(const arma::mat& parameters,
   }
 }
 
+void RegularizedSVDFunction::Gradient(const arma::mat& parameters,
+                                      const size_t begin,
+                                      const size_t batchSize,
+                                      arma::mat& gradient) const
+{
+  // This is the same as the full gradient, but only over the given examples.
+  gradient.zeros(rank, numUsers + numItems);
+
+  for (size_t i = begin; i < begin + batchSize; i++)
+  {
+    // Indices for accessing the the correct parameter columns.
+    const size_t user = data(0, i);
+    const size_t item = data(1, i) + numUsers;
+
+    // Prediction error for the example.
+    const double rating = data(2, i);
+    double ratingError = rating - arma::dot(parameters.col(user),
+                                            parameters.col(item));
+
+    gradient.col(user) += 2 * (lambda * parameters.col(user) -
+                               ratingError * parameters.col(item));
+    gradient.col(item) += 2 * (lambda * parameters.col(item) -
+                               ratingError * parameters.col(user));
+  }
+}
+
 }; // namespace svd
 }; // namespace mlpack
 
@@ -124,7 +178,8 @@ namespace mlpack {
 namespace optimization {
 
 template<>
-double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(arma::mat& parameters)
+double StochasticGradientDescent<mlpack::svd::RegularizedSVDFunction,
+    VanillaUpdate>::Optimize(arma::mat& parameters)
 {
   // Find the number of functions to use.
   const size_t numFunctions = function.NumFunctions();
@@ -136,8 +191,19 @@ double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(arma::mat& parameters)
   // Calculate the first objective function.
   for(size_t i = 0; i < numFunctions; i++)
     overallObjective += function.Evaluate(parameters, i);
-    
-  const arma::mat data = function.Dataset();
+
+  const arma::mat& data = function.Dataset();
+  const size_t numUsers = function.NumUsers();
+
+  // If the functions are shuffled, the order is shuffled in place at the start
+  // of each pass, so it is only allocated once.
+  std::vector<size_t> visitationOrder;
+  if (shuffle)
+  {
+    visitationOrder.resize(numFunctions);
+    for (size_t i = 0; i < numFunctions; i++)
+      visitationOrder[i] = i;
+  }
 
   // Now iterate!
   for(size_t i = 1; i != maxIterations; i++, currentFunction++)
@@ -148,16 +214,25 @@ double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(arma::mat& parameters)
       // Reset the counter variables.
       overallObjective = 0;
       currentFunction = 0;
+
+      // Fisher-Yates shuffle.
+      if (shuffle)
+      {
+        for (size_t j = numFunctions - 1; j > 0; j--)
+          std::swap(visitationOrder[j],
+              visitationOrder[math::RandInt((int) j + 1)]);
+      }
     }
 
-    const size_t numUsers = function.NumUsers();
+    const size_t example = shuffle ? visitationOrder[currentFunction] :
+        currentFunction;
 
     // Indices for accessing the the correct parameter columns.
-    const size_t user = data(0, currentFunction);
-    const size_t item = data(1, currentFunction) + numUsers;
+    const size_t user = data(0, example);
+    const size_t item = data(1, example) + numUsers;
 
     // Prediction error for the example.
-    const double rating = data(2, currentFunction);
+    const double rating = data(2, example);
     double ratingError = rating - arma::dot(parameters.col(user),
                                             parameters.col(item));
                                             
@@ -171,7 +246,7 @@ double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(arma::mat& parameters)
                                         ratingError * parameters.col(user));
 
     // Now add that to the overall objective function.
-    overallObjective += function.Evaluate(parameters, currentFunction);
+    overallObjective += function.Evaluate(parameters, example);
   }
 
   return overallObjective;
@@ -30,6 +30,25 @@ class RegularizedSVDFunction
   RegularizedSVDFunction(const arma::mat& data,
                          const size_t rank,
                          const double lambda);
+
+  /**
+   * Constructor for RegularizedSVDFunction class which starts from given
+   * factors, such as those from an earlier decomposition of older data (a warm
+   * start).  The rank is the number of columns of the item matrix.  The data
+   * may have more users or items than the factors (for instance, if new users
+   * have been added since); their parameters are initialized randomly, as in
+   * the other constructor.  The factors of users and items that do not appear
+   * in the data are kept.
+   *
+   * @param data Dataset for which SVD is calculated.
+   * @param u Item matrix to start from (one row per item).
+   * @param v User matrix to start from (one column per user).
+   * @param lambda Regularization parameter used for optimization.
+   */
+  RegularizedSVDFunction(const arma::mat& data,
+                         const arma::mat& u,
+                         const arma::mat& v,
+                         const double lambda);
   
   /**
    * Evaluates the cost function over all examples in the data.
@@ -57,6 +76,21 @@ class RegularizedSVDFunction
    */
   void Gradient(const arma::mat& parameters,
                 arma::mat& gradient) const;
+
+  /**
+   * Evaluates the gradient of the cost function over the batchSize training
+   * examples starting at begin.  Only the columns of the users and items of
+   * those examples are nonzero.
+   *
+   * @param parameters Parameters(user/item matrices) of the decomposition.
+   * @param begin Index of the first training example of the batch.
+   * @param batchSize Number of training examples in the batch.
+   * @param gradient Calculated gradient for the parameters.
+   */
+  void Gradient(const arma::mat& parameters,
+                const size_t begin,
+                const size_t batchSize,
+                arma::mat& gradient) const;
   
   //! Return the initial point for the optimization.
   const arma::mat& GetInitialPoint() const { return initialPoint; }
@@ -101,13 +135,15 @@ namespace mlpack {
 namespace optimization {
 
   /**
-   * Template specialization for SGD optimizer. Used because the gradient
-   * affects only a small number of parameters per example, and thus the normal
-   * abstraction does not work as fast as we might like it to.
+   * Template specialization for the plain SGD optimizer. Used because the
+   * gradient affects only a small number of parameters per example, and thus
+   * the normal abstraction does not work as fast as we might like it to.  Each
+   * step updates only the two columns of one example, so the batch size is not
+   * used.
    */
   template<>
-  double SGD<mlpack::svd::RegularizedSVDFunction>::Optimize(
-      arma::mat& parameters);
+  double StochasticGradientDescent<mlpack::svd::RegularizedSVDFunction,
+      VanillaUpdate>::Optimize(arma::mat& parameters);
 
 }; // namespace optimization
 }; // namespace mlpack
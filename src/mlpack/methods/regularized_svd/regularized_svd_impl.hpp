@@ -30,17 +30,38 @@ void RegularizedSVD<OptimizerType>::Apply(const arma::mat& data,
 {
   // Make the optimizer object using a RegularizedSVDFunction object.
   RegularizedSVDFunction rSVDFunc(data, rank, lambda);
+  Optimize(rSVDFunc, u, v);
+}
+
+template<template<typename> class OptimizerType>
+void RegularizedSVD<OptimizerType>::Apply(const arma::mat& data,
+                                          const arma::mat& initialU,
+                                          const arma::mat& initialV,
+                                          arma::mat& u,
+                                          arma::mat& v)
+{
+  // The function copies the initial matrices, so they may alias u and v.
+  RegularizedSVDFunction rSVDFunc(data, initialU, initialV, lambda);
+  Optimize(rSVDFunc, u, v);
+}
+
+template<template<typename> class OptimizerType>
+void RegularizedSVD<OptimizerType>::Optimize(RegularizedSVDFunction& rSVDFunc,
+                                             arma::mat& u,
+                                             arma::mat& v)
+{
   mlpack::optimization::SGD<RegularizedSVDFunction> optimizer(rSVDFunc, alpha,
-      iterations * data.n_cols);
-  
+      iterations * rSVDFunc.NumFunctions());
+
   // Get optimized parameters.
   arma::mat parameters = rSVDFunc.GetInitialPoint();
   optimizer.Optimize(parameters);
-  
+
   // Constants for extracting user and item matrices.
-  const size_t numUsers = max(data.row(0)) + 1;
-  const size_t numItems = max(data.row(1)) + 1;
-  
+  const size_t rank = rSVDFunc.Rank();
+  const size_t numUsers = rSVDFunc.NumUsers();
+  const size_t numItems = rSVDFunc.NumItems();
+
   // Extract user and item matrices from the optimized parameters.
   u = parameters.submat(0, numUsers, rank - 1, numUsers + numItems - 1).t();
   v = parameters.submat(0, 0, rank - 1, numUsers - 1);
@@ -94,12 +94,39 @@ class SoftmaxRegression
   /**
    * Predict the class labels for the provided feature points. The function
    * calculates the probabilities for every class, given a data point. It then
-   * chooses the class which has the highest probability among all.
+   * chooses the class which has the highest probability among all.  The points
+   * are split into blocks of consecutive points which are handed out to
+   * Threads() threads (if mlpack was built with OpenMP), and no memory is
+   * allocated except for the predictions, and only if they do not already
+   * have one element for each point.
    *
    * @param testData Matrix of data points for which predictions are to be made.
    * @param predictions Vector to store the predictions in.
    */
-  void Predict(const arma::mat& testData, arma::vec& predictions);
+  void Predict(const arma::mat& testData, arma::vec& predictions) const;
+
+  /**
+   * Predict the class label of a single point.  No memory is allocated, so
+   * this is suited to classifying single points with low latency.
+   *
+   * @tparam VecType Type of the point (arma::vec, or a column of a matrix).
+   * @param point Point to classify.
+   * @return The class with the highest probability.
+   */
+  template<typename VecType>
+  size_t PredictClass(const VecType& point) const;
+
+  /**
+   * Compute the probability of each class for each of the provided feature
+   * points.  Like Predict(), this runs in parallel, and does not allocate
+   * memory other than the output.
+   *
+   * @param testData Matrix of data points.
+   * @param probabilities Matrix to store the probabilities in; each column
+   *     holds the probabilities of the classes for one point.
+   */
+  void PredictProbabilities(const arma::mat& testData,
+                            arma::mat& probabilities) const;
   
   /**
    * Computes accuracy of the learned model given the feature data and the
@@ -109,7 +136,8 @@ class SoftmaxRegression
    * @param testData Matrix of data points using which predictions are made.
    * @param labels Vector of labels associated with the data.
    */
-  double ComputeAccuracy(const arma::mat& testData, const arma::vec& labels);
+  double ComputeAccuracy(const arma::mat& testData,
+                         const arma::vec& labels) const;
                     
   //! Sets the size of the input vector.
   void InputSize(const size_t input)
@@ -146,6 +174,14 @@ class SoftmaxRegression
   {
     return lambda;
   }
+
+  //! Gets the number of threads used for prediction (0 means all available
+  //! cores).
+  size_t Threads() const { return threads; }
+  //! Modifies the number of threads used for prediction (0 means all
+  //! available cores).  This has no effect if mlpack was compiled without
+  //! OpenMP.
+  size_t& Threads() { return threads; }
                     
  private:
   //! Parameters after optimization.
@@ -156,6 +192,12 @@ class SoftmaxRegression
   size_t numClasses;
   //! L2-regularization constant.
   double lambda;
+  //! Number of threads used for prediction.
+  size_t threads;
+
+  //! Make sure the test points have the dimensionality of the model.
+  void CheckDimensionality(const arma::mat& testData,
+                           const char* function) const;
 };
 
 }; // namespace regression
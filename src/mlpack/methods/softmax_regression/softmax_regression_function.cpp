@@ -18,13 +18,12 @@ SoftmaxRegressionFunction::SoftmaxRegressionFunction(const arma::mat& data,
     labels(labels),
     inputSize(inputSize),
     numClasses(numClasses),
-    lambda(lambda)
+    lambda(lambda),
+    threads(0),
+    blockSize(1024)
 {
   // Intialize the parameters to suitable values.
   initialPoint = InitializeWeights();
-  
-  // Calculate the label matrix.
-  GetGroundTruthMatrix(labels, groundTruth);
 }
 
 /**
@@ -45,8 +44,8 @@ const arma::mat SoftmaxRegressionFunction::InitializeWeights()
 
 /** 
  * This is equivalent to applying the indicator function to the training
- * labels. The output is in the form of a matrix, which leads to simpler
- * calculations in the Evaluate() and Gradient() methods.
+ * labels, in the form of a sparse matrix.  Evaluate() and Gradient() don't use
+ * it; they look up the label of each point directly.
  */
 void SoftmaxRegressionFunction::GetGroundTruthMatrix(const arma::vec& labels,
                                                      arma::sp_mat& groundTruth)
@@ -77,6 +76,85 @@ void SoftmaxRegressionFunction::GetGroundTruthMatrix(const arma::vec& labels,
                              labels.n_elem);
 }
 
+/**
+ * Computes the class probabilities of the points one block at a time, and
+ * sums the negative log likelihood and (optionally) the gradient over all of
+ * the blocks.
+ */
+double SoftmaxRegressionFunction::NegativeLogLikelihood(
+    const arma::mat& parameters,
+    arma::mat& gradient,
+    const bool computeGradient) const
+{
+  // The probabilities for each of the classes are given by:
+  // p_j = exp(theta_j' * x_i) / sum(exp(theta_k' * x_i))
+  // The sum is calculated over all the classes.
+  // x_i is the input vector for a particular training example.
+  // theta_j is the parameter vector associated with a particular class.
+  // The gradient of -log(p_{y_i}) with respect to theta_j is
+  // (p_j - 1{y_i = j}) * x_i, so the probabilities of a block are enough to
+  // find its part of both the objective and the gradient.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  const size_t points = data.n_cols;
+  const size_t block = std::max(blockSize, (size_t) 1);
+  const size_t numBlocks = (points + block - 1) / block;
+
+  // The blocks are split into groups (as many as util::ReductionBlocks()
+  // gives), each of which sums into its own objective and gradient.  These are
+  // added with util::TreeReduce(), so the result does not depend on the number
+  // of threads.
+  const size_t groups = util::ReductionBlocks(numBlocks, 1);
+  std::vector<double> groupResults(groups, 0.0);
+  std::vector<arma::mat> groupGradients(groups);
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t g = 0; g < (omp_size_t) groups; ++g)
+  {
+    if (computeGradient)
+      groupGradients[g].zeros(numClasses, inputSize);
+    arma::mat probabilities;
+
+    const size_t lastBlock = (g + 1) * numBlocks / groups;
+    for (size_t b = g * numBlocks / groups; b < lastBlock; ++b)
+    {
+      const size_t begin = b * block;
+      const size_t end = std::min(begin + block, points) - 1;
+
+      probabilities = parameters * data.cols(begin, end);
+
+      for (size_t i = 0; i < probabilities.n_cols; ++i)
+      {
+        // Shifting by the largest exponent does not change the probabilities
+        // but keeps exp() from overflowing.
+        probabilities.col(i) = arma::exp(probabilities.col(i) -
+            probabilities.col(i).max());
+        probabilities.col(i) /= arma::accu(probabilities.col(i));
+
+        const size_t label = (size_t) labels(begin + i);
+        groupResults[g] -= std::log(probabilities(label, i));
+        probabilities(label, i) -= 1.0;
+      }
+
+      if (computeGradient)
+        groupGradients[g] += probabilities * data.cols(begin, end).t();
+    }
+  }
+
+  util::TreeReduce(groupResults);
+  if (computeGradient)
+  {
+    util::TreeReduce(groupGradients);
+    gradient.swap(groupGradients[0]);
+  }
+
+  return groupResults[0];
+}
+
 /**
  * Evaluates the objective function given the parameters.
  */
@@ -91,31 +169,15 @@ double SoftmaxRegressionFunction::Evaluate(const arma::mat& parameters) const
   // 'm' is the number of training examples.
   // The cost also takes into account the regularization to control the
   // parameter weights.
-  
-  // Calculate the class probabilities for each training example. The
-  // probabilities for each of the classes are given by:
-  // p_j = exp(theta_j' * x_i) / sum(exp(theta_k' * x_i))
-  // The sum is calculated over all the classes.
-  // x_i is the input vector for a particular training example.
-  // theta_j is the parameter vector associated with a particular class.
-  arma::mat hypothesis, probabilities;
-  
-  hypothesis = arma::exp(parameters * data);
-  probabilities = hypothesis / arma::repmat(arma::sum(hypothesis, 0),
-                                            numClasses, 1);
-                                            
-  // Calculate the log likelihood and regularization terms.
-  double logLikelihood, weightDecay, cost;
-  
-  logLikelihood = arma::accu(groundTruth % arma::log(probabilities)) /
-      data.n_cols;
-  weightDecay = 0.5 * lambda * arma::accu(parameters % parameters);
-  
+  arma::mat gradient; // Not used.
+  const double logLikelihood = -NegativeLogLikelihood(parameters, gradient,
+      false) / data.n_cols;
+  const double weightDecay = 0.5 * lambda * arma::accu(parameters %
+      parameters);
+
   // The cost is the sum of the negative log likelihood and the regularization
   // terms. 
-  cost = -logLikelihood + weightDecay;
-      
-  return cost;
+  return -logLikelihood + weightDecay;
 }
 
 /**
@@ -124,19 +186,23 @@ double SoftmaxRegressionFunction::Evaluate(const arma::mat& parameters) const
 void SoftmaxRegressionFunction::Gradient(const arma::mat& parameters,
                                          arma::mat& gradient) const
 {
-  // Calculate the class probabilities for each training example. The
-  // probabilities for each of the classes are given by:
-  // p_j = exp(theta_j' * x_i) / sum(exp(theta_k' * x_i))
-  // The sum is calculated over all the classes.
-  // x_i is the input vector for a particular training example.
-  // theta_j is the parameter vector associated with a particular class.
-  arma::mat hypothesis, probabilities;
-  
-  hypothesis = arma::exp(parameters * data);
-  probabilities = hypothesis / arma::repmat(arma::sum(hypothesis, 0),
-                                            numClasses, 1);
-                                            
-  // Calculate the parameter gradients.
-  gradient = (probabilities - groundTruth) * data.t() / data.n_cols +
-      lambda * parameters;
+  // The gradient of each point is (probabilities - groundTruth) * x_i'; these
+  // are summed by NegativeLogLikelihood().
+  NegativeLogLikelihood(parameters, gradient, true);
+  gradient = gradient / data.n_cols + lambda * parameters;
+}
+
+/**
+ * Evaluates the objective function and calculates the gradient values, using
+ * the same class probabilities for both.
+ */
+double SoftmaxRegressionFunction::EvaluateWithGradient(
+    const arma::mat& parameters,
+    arma::mat& gradient) const
+{
+  const double logLikelihood = -NegativeLogLikelihood(parameters, gradient,
+      true) / data.n_cols;
+  gradient = gradient / data.n_cols + lambda * parameters;
+
+  return -logLikelihood + 0.5 * lambda * arma::accu(parameters % parameters);
 }
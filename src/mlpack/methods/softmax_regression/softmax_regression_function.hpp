@@ -13,6 +13,13 @@
 namespace mlpack {
 namespace regression {
 
+/**
+ * The objective function for softmax regression.  The class probabilities are
+ * computed for one block of columns of the data at a time, so the temporaries
+ * are only numClasses x BlockSize() no matter how many points there are.  When
+ * OpenMP is available, the blocks are split between Threads() threads, each of
+ * which sums the gradient of its own blocks.
+ */
 class SoftmaxRegressionFunction
 {
  public:
@@ -36,7 +43,8 @@ class SoftmaxRegressionFunction
   const arma::mat InitializeWeights();
   
   /**
-   * Constructs the ground truth label matrix with the passed labels.
+   * Constructs the ground truth label matrix with the passed labels.  This is
+   * not used by Evaluate() or Gradient(), which read the labels directly.
    *
    * @param labels Labels associated with the training data.
    * @param groundTruth Pointer to arma::mat which stores the computed matrix.
@@ -64,6 +72,16 @@ class SoftmaxRegressionFunction
    * @param gradient Matrix where gradient values will be stored.
    */
   void Gradient(const arma::mat& parameters, arma::mat& gradient) const;
+
+  /**
+   * Evaluates the objective function and its gradient with the given
+   * parameters.  The class probabilities are only computed once for both.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param gradient Matrix where gradient values will be stored.
+   */
+  double EvaluateWithGradient(const arma::mat& parameters,
+                              arma::mat& gradient) const;
   
   //! Return the initial point for the optimization.
   const arma::mat& GetInitialPoint() const { return initialPoint; }
@@ -103,14 +121,36 @@ class SoftmaxRegressionFunction
   {
     return lambda;
   }
+
+  //! Sets the number of threads used (0 means all available cores).
+  void Threads(const size_t t)
+  {
+    this->threads = t;
+  }
+
+  //! Gets the number of threads used (0 means all available cores).
+  size_t Threads() const
+  {
+    return threads;
+  }
+
+  //! Sets the number of points processed at a time by each thread.
+  void BlockSize(const size_t b)
+  {
+    this->blockSize = b;
+  }
+
+  //! Gets the number of points processed at a time by each thread.
+  size_t BlockSize() const
+  {
+    return blockSize;
+  }
                             
  private:
   //! Training data matrix.
   const arma::mat& data;
   //! Labels associated with the training data.
   const arma::vec& labels;
-  //! Label matrix for the provided data.
-  arma::sp_mat groundTruth;
   //! Initial parameter point.
   arma::mat initialPoint;
   //! Size of input feature vector.
@@ -119,6 +159,19 @@ class SoftmaxRegressionFunction
   size_t numClasses;
   //! L2-regularization constant.
   double lambda;
+  //! Number of threads to use (0 means all available cores).
+  size_t threads;
+  //! Number of points processed at a time by each thread.
+  size_t blockSize;
+
+  /**
+   * Compute the negative log likelihood of the data with the given parameters
+   * (without the regularization term), and, if computeGradient is true, the
+   * sum of the gradients of the points in gradient.
+   */
+  double NegativeLogLikelihood(const arma::mat& parameters,
+                               arma::mat& gradient,
+                               const bool computeGradient) const;
 };
 
 }; // namespace regression
@@ -21,7 +21,8 @@ SoftmaxRegression<OptimizerType>::SoftmaxRegression(const arma::mat& data,
                                                     const double lambda) :
     inputSize(inputSize),
     numClasses(numClasses),
-    lambda(lambda)
+    lambda(lambda),
+    threads(0)
 {
   SoftmaxRegressionFunction regressor(data, labels, inputSize, numClasses,
                                       lambda);
@@ -44,7 +45,8 @@ SoftmaxRegression<OptimizerType>::SoftmaxRegression(
     parameters(optimizer.Function().GetInitialPoint()),
     inputSize(optimizer.Function().InputSize()),
     numClasses(optimizer.Function().NumClasses()),
-    lambda(optimizer.Function().Lambda())
+    lambda(optimizer.Function().Lambda()),
+    threads(0)
 {
   // Train the model.
   Timer::Start("softmax_regression_optimization");
@@ -57,42 +59,122 @@ SoftmaxRegression<OptimizerType>::SoftmaxRegression(
 
 template<template<typename> class OptimizerType>
 void SoftmaxRegression<OptimizerType>::Predict(const arma::mat& testData,
-                                               arma::vec& predictions)
+                                               arma::vec& predictions) const
 {
-  // Calculate the probabilities for each test input.
-  arma::mat hypothesis, probabilities;
-  
-  hypothesis = arma::exp(parameters * testData);
-  probabilities = hypothesis / arma::repmat(arma::sum(hypothesis, 0),
-                                            numClasses, 1);
-  
-  // Prepare necessary data.
-  predictions.zeros(testData.n_cols);
-  double maxProbability = 0;
-  
+  CheckDimensionality(testData, "Predict");
+  predictions.set_size(testData.n_cols);
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  // Blocks of about 32k values (256kB of points) fit in the L2 cache of most
+  // processors, and keep each thread on consecutive memory.
+  const size_t blockSize = std::max((size_t) 1, (size_t) 32768 /
+      std::max((size_t) testData.n_rows, (size_t) 1));
+
   // For each test input.
-  for(size_t i = 0; i < testData.n_cols; i++)
+  #pragma omp parallel for num_threads(numThreads) schedule(static, blockSize)
+  for (omp_size_t i = 0; i < (omp_size_t) testData.n_cols; ++i)
+    predictions[i] = PredictClass(testData.unsafe_col(i));
+}
+
+template<template<typename> class OptimizerType>
+template<typename VecType>
+size_t SoftmaxRegression<OptimizerType>::PredictClass(
+    const VecType& point) const
+{
+  // The probability of each class is the exponential of its score, divided by
+  // the same normalizing sum; so the most probable class is the one with the
+  // highest score.
+  size_t prediction = 0;
+  double maxScore = -std::numeric_limits<double>::infinity();
+  for (size_t j = 0; j < numClasses; j++)
   {
-    // For each class.
-    for(size_t j = 0; j < numClasses; j++)
+    double score = 0.0;
+    for (size_t k = 0; k < point.n_elem; k++)
+      score += parameters(j, k) * point[k];
+
+    // If a higher class score is encountered, change prediction.
+    if (score > maxScore)
     {
-      // If a higher class probability is encountered, change prediction.
-      if(probabilities(j, i) > maxProbability)
-      {
-        maxProbability = probabilities(j, i);
-        predictions(i) = j;
-      }
+      maxScore = score;
+      prediction = j;
     }
-    
-    // Set maximum probability to zero for the next input.
-    maxProbability = 0;
+  }
+
+  return prediction;
+}
+
+template<template<typename> class OptimizerType>
+void SoftmaxRegression<OptimizerType>::PredictProbabilities(
+    const arma::mat& testData,
+    arma::mat& probabilities) const
+{
+  CheckDimensionality(testData, "PredictProbabilities");
+  probabilities.set_size(numClasses, testData.n_cols);
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  const size_t blockSize = std::max((size_t) 1, (size_t) 32768 /
+      std::max((size_t) testData.n_rows, (size_t) 1));
+
+  #pragma omp parallel for num_threads(numThreads) schedule(static, blockSize)
+  for (omp_size_t i = 0; i < (omp_size_t) testData.n_cols; ++i)
+  {
+    // Accumulate the scores of the classes in the output column, one feature
+    // at a time, so that the parameters are read in order.
+    double* p = probabilities.colptr(i);
+    const double* x = testData.colptr(i);
+    for (size_t j = 0; j < numClasses; j++)
+      p[j] = 0.0;
+    for (size_t k = 0; k < testData.n_rows; k++)
+    {
+      const double* weights = parameters.colptr(k);
+      for (size_t j = 0; j < numClasses; j++)
+        p[j] += weights[j] * x[k];
+    }
+
+    // Shift the scores by their maximum before exponentiating, so that they
+    // cannot overflow.
+    double maxScore = -std::numeric_limits<double>::infinity();
+    for (size_t j = 0; j < numClasses; j++)
+      maxScore = std::max(maxScore, p[j]);
+
+    double sum = 0.0;
+    for (size_t j = 0; j < numClasses; j++)
+    {
+      p[j] = std::exp(p[j] - maxScore);
+      sum += p[j];
+    }
+    for (size_t j = 0; j < numClasses; j++)
+      p[j] /= sum;
+  }
+}
+
+template<template<typename> class OptimizerType>
+void SoftmaxRegression<OptimizerType>::CheckDimensionality(
+    const arma::mat& testData,
+    const char* function) const
+{
+  if (testData.n_rows != parameters.n_cols)
+  {
+    Log::Fatal << "SoftmaxRegression::" << function << "(): test points have "
+        << testData.n_rows << " dimensions, but the model has "
+        << parameters.n_cols << "!" << std::endl;
   }
 }
 
 template<template<typename> class OptimizerType>
 double SoftmaxRegression<OptimizerType>::ComputeAccuracy(
     const arma::mat& testData,
-    const arma::vec& labels)
+    const arma::vec& labels) const
 {
   arma::vec predictions;
   
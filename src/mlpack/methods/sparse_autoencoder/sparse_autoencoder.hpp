@@ -52,7 +52,15 @@ namespace nn {
  * @endcode
  *
  * This implementation allows the use of arbitrary mlpack optimizers via the
- * OptimizerType template parameter.
+ * OptimizerType template parameter.  For large datasets, mini-batch SGD only
+ * touches a few points at each step (see SparseAutoencoderFunction):
+ *
+ * @code
+ * SparseAutoencoderFunction saf(data, vSize, hSize);
+ * SGD<SparseAutoencoderFunction> sgd(saf, 0.01, 10 * data.n_cols, 1e-5, true,
+ *     256);
+ * SparseAutoencoder<SGD> encoder3(sgd);
+ * @endcode
  *
  * @tparam OptimizerType The optimizer to use; by default this is L-BFGS.  Any
  *     mlpack optimizer can be used here.
@@ -21,7 +21,10 @@ SparseAutoencoderFunction::SparseAutoencoderFunction(const arma::mat& data,
     hiddenSize(hiddenSize),
     lambda(lambda),
     beta(beta),
-    rho(rho)
+    rho(rho),
+    threads(0),
+    blockSize(1024),
+    rhoDecay(0.99)
 {
   // Initialize the parameters to suitable values.
   initialPoint = InitializeWeights();
@@ -66,9 +69,12 @@ const arma::mat SparseAutoencoderFunction::InitializeWeights()
   return parameters;
 }
 
-/** Evaluates the objective function given the parameters.
+/** Performs the feedforward pass, and optionally the backpropagation, one
+  * block of points at a time.
   */
-double SparseAutoencoderFunction::Evaluate(const arma::mat& parameters) const
+double SparseAutoencoderFunction::Pass(const arma::mat& parameters,
+                                       arma::mat& gradient,
+                                       const bool computeGradient) const
 {
   // The objective function is the average squared reconstruction error of the
   // network. w1 and b1 are the weights and biases associated with the hidden
@@ -83,39 +89,118 @@ double SparseAutoencoderFunction::Evaluate(const arma::mat& parameters) const
   const size_t l2 = visibleSize;
   const size_t l3 = 2 * hiddenSize;
 
-  // w1, w2, b1 and b2 are not extracted separately, 'parameters' is directly
-  // used in their place to avoid copying data. The following representations
-  // are used:
-  // w1 <- parameters.submat(0, 0, l1-1, l2-1)
-  // w2 <- parameters.submat(l1, 0, l3-1, l2-1).t()
-  // b1 <- parameters.submat(0, l2, l1-1, l2)
-  // b2 <- parameters.submat(l3, 0, l3, l2-1).t()
-
-  arma::mat hiddenLayer, outputLayer;
-
-  // Compute activations of the hidden and output layers.
-  Sigmoid(parameters.submat(0, 0, l1 - 1, l2 - 1) * data +
-      arma::repmat(parameters.submat(0, l2, l1 - 1, l2), 1, data.n_cols),
-      hiddenLayer);
-
-  Sigmoid(parameters.submat(l1, 0, l3 - 1, l2 - 1).t() * hiddenLayer +
-      arma::repmat(parameters.submat(l3, 0, l3, l2 - 1).t(), 1, data.n_cols),
-      outputLayer);
-
-  arma::mat rhoCap, diff;
+  // The weights and biases are small next to the data, so they are extracted
+  // once here rather than for each block.
+  const arma::mat w1 = parameters.submat(0, 0, l1 - 1, l2 - 1);
+  const arma::mat w2 = parameters.submat(l1, 0, l3 - 1, l2 - 1).t();
+  const arma::vec b1 = parameters.submat(0, l2, l1 - 1, l2);
+  const arma::vec b2 = parameters.submat(l3, 0, l3, l2 - 1).t();
+
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  const size_t points = data.n_cols;
+  const size_t block = std::max(blockSize, (size_t) 1);
+  const size_t numBlocks = (points + block - 1) / block;
+
+  // The KL divergence term of the hidden delta values depends on the average
+  // activations of the whole hidden layer, which are not known until every
+  // block has been seen.  Its part of the gradient is diag(klDivGrad) *
+  // sum(f'(z_hidden) * [x' 1]), so that sum is kept in klTerms and scaled at
+  // the end.
+  //
+  // The blocks are split into groups (as many as util::ReductionBlocks()
+  // gives), each of which sums into its own activations and gradients.  These
+  // are added with util::TreeReduce(), so the result does not depend on the
+  // number of threads.
+  const size_t groups = util::ReductionBlocks(numBlocks, 1);
+  std::vector<double> groupSquares(groups, 0.0);
+  std::vector<arma::vec> groupHiddenSums(groups);
+  std::vector<arma::mat> groupGradients(groups), groupKLTerms(groups);
+
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+  for (omp_size_t g = 0; g < (omp_size_t) groups; ++g)
+  {
+    double& sumOfSquares = groupSquares[g];
+    arma::vec& threadHiddenSum = groupHiddenSums[g];
+    arma::mat& threadGradient = groupGradients[g];
+    arma::mat& threadKLTerms = groupKLTerms[g];
+    threadHiddenSum.zeros(l1);
+    if (computeGradient)
+    {
+      threadGradient.zeros(2 * hiddenSize + 1, visibleSize + 1);
+      threadKLTerms.zeros(l1, l2 + 1);
+    }
+    arma::mat hiddenLayer, outputLayer, diff, delOut, hiddenDerivative,
+        delHid;
+
+    const size_t lastBlock = (g + 1) * numBlocks / groups;
+    for (size_t b = g * numBlocks / groups; b < lastBlock; ++b)
+    {
+      const size_t begin = b * block;
+      const size_t end = std::min(begin + block, points) - 1;
+
+      // Compute activations of the hidden and output layers.
+      hiddenLayer = w1 * data.cols(begin, end);
+      hiddenLayer.each_col() += b1;
+      Sigmoid(hiddenLayer, hiddenLayer);
+
+      outputLayer = w2 * hiddenLayer;
+      outputLayer.each_col() += b2;
+      Sigmoid(outputLayer, outputLayer);
+
+      // Difference between the reconstructed data and the original data.
+      diff = outputLayer - data.cols(begin, end);
+      sumOfSquares += arma::accu(diff % diff);
+      threadHiddenSum += arma::sum(hiddenLayer, 1);
+
+      if (!computeGradient)
+        continue;
+
+      // The delta vector for the output layer is given by diff * f'(z), where
+      // z is the preactivation and f is the activation function. The
+      // derivative of the sigmoid function turns out to be f(z) * (1 - f(z)).
+      // For every other layer in the neural network which comes before the
+      // output layer, the delta values are given del_n = w_n' * del_(n+1) *
+      // f'(z_n).  The KL divergence term is added after the pass.
+      delOut = diff % outputLayer % (1 - outputLayer);
+      hiddenDerivative = hiddenLayer % (1 - hiddenLayer);
+      delHid = (w2.t() * delOut) % hiddenDerivative;
+
+      threadGradient.submat(0, 0, l1 - 1, l2 - 1) +=
+          delHid * data.cols(begin, end).t();
+      threadGradient.submat(l1, 0, l3 - 1, l2 - 1) +=
+          hiddenLayer * delOut.t();
+      threadGradient.submat(0, l2, l1 - 1, l2) += arma::sum(delHid, 1);
+      threadGradient.submat(l3, 0, l3, l2 - 1) += arma::sum(delOut, 1).t();
+
+      threadKLTerms.cols(0, l2 - 1) +=
+          hiddenDerivative * data.cols(begin, end).t();
+      threadKLTerms.col(l2) += arma::sum(hiddenDerivative, 1);
+    }
+  }
+
+  util::TreeReduce(groupSquares);
+  util::TreeReduce(groupHiddenSums);
+  const double sumOfSquares = groupSquares[0];
+  const arma::vec& hiddenSum = groupHiddenSums[0];
+  arma::mat klTerms;
+  if (computeGradient)
+  {
+    util::TreeReduce(groupGradients);
+    util::TreeReduce(groupKLTerms);
+    gradient.swap(groupGradients[0]);
+    klTerms.swap(groupKLTerms[0]);
+  }
 
   // Average activations of the hidden layer.
-  rhoCap = arma::sum(hiddenLayer, 1) / data.n_cols;
-  // Difference between the reconstructed data and the original data.
-  diff = outputLayer - data;
-
-  double wL2SquaredNorm;
+  const arma::vec rhoCap = hiddenSum / points;
 
   // Calculate squared L2-norms of w1 and w2.
-  wL2SquaredNorm = arma::accu(parameters.submat(0, 0, l3 - 1, l2 - 1) %
-      parameters.submat(0, 0, l3 - 1, l2 - 1));
-
-  double sumOfSquaresError, weightDecay, klDivergence, cost;
+  const double wL2SquaredNorm = arma::accu(w1 % w1) + arma::accu(w2 % w2);
 
   // Calculate the reconstruction error, the regularization cost and the KL
   // divergence cost terms. 'sumOfSquaresError' is the average squared l2-norm
@@ -123,15 +208,33 @@ double SparseAutoencoderFunction::Evaluate(const arma::mat& parameters) const
   // of the weights w1 and w2. 'klDivergence' is the cost of the hidden layer
   // activations not being low. It is given by the following formula:
   // KL = sum_over_hSize(rho*log(rho/rhoCaq) + (1-rho)*log((1-rho)/(1-rhoCap)))
-  sumOfSquaresError = 0.5 * arma::accu(diff % diff) / data.n_cols;
-  weightDecay = 0.5 * lambda * wL2SquaredNorm;
-  klDivergence = beta * arma::accu(rho * arma::log(rho / rhoCap) + (1 - rho) *
-      arma::log((1 - rho) / (1 - rhoCap)));
+  const double sumOfSquaresError = 0.5 * sumOfSquares / points;
+  const double weightDecay = 0.5 * lambda * wL2SquaredNorm;
+  const double klDivergence = beta * arma::accu(rho * arma::log(rho / rhoCap) +
+      (1 - rho) * arma::log((1 - rho) / (1 - rhoCap)));
+
+  if (computeGradient)
+  {
+    // Add the KL divergence term to the hidden layer gradients, then average
+    // over the points and account for the regularization terms.
+    const arma::vec klDivGrad = beta * (-(rho / rhoCap) + (1 - rho) /
+        (1 - rhoCap));
+    gradient.rows(0, l1 - 1) += arma::diagmat(klDivGrad) * klTerms;
+    gradient /= points;
+    gradient.submat(0, 0, l3 - 1, l2 - 1) += lambda *
+        parameters.submat(0, 0, l3 - 1, l2 - 1);
+  }
 
   // The cost is the sum of the terms calculated above.
-  cost = sumOfSquaresError + weightDecay + klDivergence;
+  return sumOfSquaresError + weightDecay + klDivergence;
+}
 
-  return cost;
+/** Evaluates the objective function given the parameters.
+  */
+double SparseAutoencoderFunction::Evaluate(const arma::mat& parameters) const
+{
+  arma::mat gradient; // Not used.
+  return Pass(parameters, gradient, false);
 }
 
 /** Calculates and stores the gradient values given a set of parameters.
@@ -139,67 +242,128 @@ double SparseAutoencoderFunction::Evaluate(const arma::mat& parameters) const
 void SparseAutoencoderFunction::Gradient(const arma::mat& parameters,
                                          arma::mat& gradient) const
 {
-  // Performs a feedforward pass of the neural network, and computes the
-  // activations of the output layer as in the Evaluate() method. It uses the
+  // Performs a feedforward pass of the neural network, and uses the
   // Backpropagation algorithm to calculate the delta values at each layer,
   // except for the input layer. The delta values are then used with input layer
   // and hidden layer activations to get the parameter gradients.
+  Pass(parameters, gradient, true);
+}
 
-  // Compute the limits for the parameters w1, w2, b1 and b2.
+/** Evaluates the objective function and calculates the gradient values with
+  * the same feedforward pass.
+  */
+double SparseAutoencoderFunction::EvaluateWithGradient(
+    const arma::mat& parameters,
+    arma::mat& gradient) const
+{
+  return Pass(parameters, gradient, true);
+}
+
+/** Computes the activations of the hidden and output layers for a range of
+  * points.
+  */
+void SparseAutoencoderFunction::Forward(const arma::mat& parameters,
+                                        const size_t begin,
+                                        const size_t end,
+                                        arma::mat& hiddenLayer,
+                                        arma::mat& outputLayer) const
+{
   const size_t l1 = hiddenSize;
   const size_t l2 = visibleSize;
   const size_t l3 = 2 * hiddenSize;
 
-  // w1, w2, b1 and b2 are not extracted separately, 'parameters' is directly
-  // used in their place to avoid copying data. The following representations
-  // are used:
-  // w1 <- parameters.submat(0, 0, l1-1, l2-1)
-  // w2 <- parameters.submat(l1, 0, l3-1, l2-1).t()
-  // b1 <- parameters.submat(0, l2, l1-1, l2)
-  // b2 <- parameters.submat(l3, 0, l3, l2-1).t()
+  hiddenLayer = parameters.submat(0, 0, l1 - 1, l2 - 1) *
+      data.cols(begin, end);
+  hiddenLayer.each_col() += arma::vec(parameters.submat(0, l2, l1 - 1, l2));
+  Sigmoid(hiddenLayer, hiddenLayer);
+
+  outputLayer = parameters.submat(l1, 0, l3 - 1, l2 - 1).t() * hiddenLayer;
+  outputLayer.each_col() += arma::vec(parameters.submat(l3, 0, l3,
+      l2 - 1).t());
+  Sigmoid(outputLayer, outputLayer);
+}
+
+/** Computes the regularization and KL divergence terms of the objective.
+  */
+double SparseAutoencoderFunction::Penalty(const arma::mat& parameters,
+                                          const arma::vec& rhoCap) const
+{
+  const size_t l2 = visibleSize;
+  const size_t l3 = 2 * hiddenSize;
+
+  const double weightDecay = 0.5 * lambda * arma::accu(arma::square(
+      parameters.submat(0, 0, l3 - 1, l2 - 1)));
+  const double klDivergence = beta * arma::accu(rho * arma::log(rho / rhoCap) +
+      (1 - rho) * arma::log((1 - rho) / (1 - rhoCap)));
 
+  return weightDecay + klDivergence;
+}
+
+/** Evaluates the part of the objective function of one point.
+  */
+double SparseAutoencoderFunction::Evaluate(const arma::mat& parameters,
+                                           const size_t i) const
+{
   arma::mat hiddenLayer, outputLayer;
+  Forward(parameters, i, i, hiddenLayer, outputLayer);
 
-  // Compute activations of the hidden and output layers.
-  Sigmoid(parameters.submat(0, 0, l1 - 1, l2 - 1) * data +
-      arma::repmat(parameters.submat(0, l2, l1 - 1, l2), 1, data.n_cols),
-      hiddenLayer);
+  const arma::vec diff = outputLayer - data.col(i);
+  const arma::vec rhoCap = (rhoCapEstimate.n_elem == hiddenSize) ?
+      rhoCapEstimate : arma::vec(hiddenLayer);
 
-  Sigmoid(parameters.submat(l1, 0, l3 - 1, l2 - 1).t() * hiddenLayer +
-      arma::repmat(parameters.submat(l3, 0, l3, l2 - 1).t(), 1, data.n_cols),
-      outputLayer);
+  return 0.5 * arma::accu(diff % diff) + Penalty(parameters, rhoCap);
+}
 
-  arma::mat rhoCap, diff;
+/** Calculates the gradient of the part of the objective function of one point.
+  */
+void SparseAutoencoderFunction::Gradient(const arma::mat& parameters,
+                                         const size_t i,
+                                         arma::mat& gradient)
+{
+  Gradient(parameters, i, 1, gradient);
+}
 
-  // Average activations of the hidden layer.
-  rhoCap = arma::sum(hiddenLayer, 1) / data.n_cols;
-  // Difference between the reconstructed data and the original data.
-  diff = outputLayer - data;
-
-  arma::mat klDivGrad, delOut, delHid;
-
-  // The delta vector for the output layer is given by diff * f'(z), where z is
-  // the preactivation and f is the activation function. The derivative of the
-  // sigmoid function turns out to be f(z) * (1 - f(z)). For every other layer
-  // in the neural network which comes before the output layer, the delta values
-  // are given del_n = w_n' * del_(n+1) * f'(z_n). Since our cost function also
-  // includes the KL divergence term, we adjust for that in the formula below.
-  klDivGrad = beta * (-(rho / rhoCap) + (1 - rho) / (1 - rhoCap));
-  delOut = diff % outputLayer % (1 - outputLayer);
-  delHid = (parameters.submat(l1, 0, l3 - 1, l2 - 1) * delOut +
-      arma::repmat(klDivGrad, 1, data.n_cols)) % hiddenLayer %
-      (1 - hiddenLayer);
+/** Calculates the summed gradient of the parts of the objective function of a
+  * mini-batch of points.
+  */
+void SparseAutoencoderFunction::Gradient(const arma::mat& parameters,
+                                         const size_t begin,
+                                         const size_t batchSize,
+                                         arma::mat& gradient)
+{
+  const size_t l1 = hiddenSize;
+  const size_t l2 = visibleSize;
+  const size_t l3 = 2 * hiddenSize;
+  const size_t end = begin + batchSize - 1;
 
-  gradient.zeros(2 * hiddenSize + 1, visibleSize + 1);
+  arma::mat hiddenLayer, outputLayer;
+  Forward(parameters, begin, end, hiddenLayer, outputLayer);
+
+  // Add the average activations of this mini-batch to the running estimate of
+  // the average activations over all of the points.
+  const arma::vec batchRhoCap = arma::mean(hiddenLayer, 1);
+  if (rhoCapEstimate.n_elem != hiddenSize)
+    rhoCapEstimate = batchRhoCap;
+  else
+    rhoCapEstimate = rhoDecay * rhoCapEstimate + (1 - rhoDecay) * batchRhoCap;
+
+  // The delta values are computed as in the full pass, but the KL divergence
+  // term uses the running estimate, and can be added to the hidden layer delta
+  // values right away.
+  const arma::mat diff = outputLayer - data.cols(begin, end);
+  const arma::mat delOut = diff % outputLayer % (1 - outputLayer);
+  arma::mat delHid = parameters.submat(l1, 0, l3 - 1, l2 - 1) * delOut;
+  delHid.each_col() += beta * (-(rho / rhoCapEstimate) + (1 - rho) /
+      (1 - rhoCapEstimate));
+  delHid %= hiddenLayer % (1 - hiddenLayer);
 
-  // Compute the gradient values using the activations and the delta values. The
-  // formula also accounts for the regularization terms in the objective.
-  // function.
-  gradient.submat(0, 0, l1 - 1, l2 - 1) = delHid * data.t() / data.n_cols +
-      lambda * parameters.submat(0, 0, l1 - 1, l2 - 1);
-  gradient.submat(l1, 0, l3 - 1, l2 - 1) =
-      (delOut * hiddenLayer.t() / data.n_cols +
-      lambda * parameters.submat(l1, 0, l3 - 1, l2 - 1).t()).t();
-  gradient.submat(0, l2, l1 - 1, l2) = arma::sum(delHid, 1) / data.n_cols;
-  gradient.submat(l3, 0, l3, l2 - 1) = (arma::sum(delOut, 1) / data.n_cols).t();
+  gradient.zeros(2 * hiddenSize + 1, visibleSize + 1);
+  gradient.submat(0, 0, l1 - 1, l2 - 1) = delHid * data.cols(begin, end).t();
+  gradient.submat(l1, 0, l3 - 1, l2 - 1) = hiddenLayer * delOut.t();
+  gradient.submat(0, l2, l1 - 1, l2) = arma::sum(delHid, 1);
+  gradient.submat(l3, 0, l3, l2 - 1) = arma::sum(delOut, 1).t();
+
+  // Each point's part of the objective has the whole regularization term.
+  gradient.submat(0, 0, l3 - 1, l2 - 1) += (batchSize * lambda) *
+      parameters.submat(0, 0, l3 - 1, l2 - 1);
 }
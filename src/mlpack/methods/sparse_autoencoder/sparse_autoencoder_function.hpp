@@ -17,6 +17,22 @@ namespace nn {
  * This is a class for the sparse autoencoder objective function. It can be used
  * to create learning models like self-taught learning, stacked autoencoders,
  * conditional random fields (CRFs), and so forth.
+ *
+ * The activations are computed for one block of columns of the data at a time,
+ * so the temporaries are only hiddenSize x BlockSize() and
+ * visibleSize x BlockSize() no matter how many points there are.  When OpenMP
+ * is available, the blocks are split between Threads() threads, each of which
+ * sums the gradient of its own blocks.
+ *
+ * The function can also be optimized with SGD (and its variants), one point or
+ * one mini-batch of points at a time, so that each step only touches a few
+ * points.  For this, the objective is split into one function for each point:
+ * the squared reconstruction error of the point, plus the regularization and
+ * KL divergence terms.  The sum of these functions is NumFunctions() times the
+ * objective given by Evaluate(parameters).  The KL divergence term depends on
+ * the average activations of the hidden layer over all of the points, which a
+ * mini-batch doesn't see; so a running average of the activations of the
+ * mini-batches is kept (see RhoCapEstimate()), and used in its place.
  */
 class SparseAutoencoderFunction
 {
@@ -65,6 +81,60 @@ class SparseAutoencoderFunction
    */
   void Gradient(const arma::mat& parameters, arma::mat& gradient) const;
 
+  /**
+   * Evaluates the objective function and its gradient with the given
+   * parameters, with a single feedforward pass over the data.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param gradient Matrix where gradient values will be stored.
+   */
+  double EvaluateWithGradient(const arma::mat& parameters,
+                              arma::mat& gradient) const;
+
+  //! Return the number of functions the objective is split into for SGD (the
+  //! number of points).
+  size_t NumFunctions() const { return data.n_cols; }
+
+  /**
+   * Evaluate the part of the objective of the given point: its squared
+   * reconstruction error, plus the regularization and the KL divergence
+   * terms.  The KL divergence term uses the running estimate of the average
+   * hidden activations, or the activations of this point if there is no
+   * estimate yet.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param i Index of the point.
+   */
+  double Evaluate(const arma::mat& parameters, const size_t i) const;
+
+  /**
+   * Evaluate the gradient of the part of the objective of the given point.
+   * This updates the running estimate of the average hidden activations.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param i Index of the point.
+   * @param gradient Matrix where gradient values will be stored.
+   */
+  void Gradient(const arma::mat& parameters,
+                const size_t i,
+                arma::mat& gradient);
+
+  /**
+   * Evaluate the sum of the gradients of the parts of the objective of the
+   * points begin, ..., begin + batchSize - 1, with one feedforward pass over
+   * them.  The running estimate of the average hidden activations is first
+   * updated with the average activations of these points.
+   *
+   * @param parameters Current values of the model parameters.
+   * @param begin Index of the first point.
+   * @param batchSize Number of points.
+   * @param gradient Matrix where gradient values will be stored.
+   */
+  void Gradient(const arma::mat& parameters,
+                const size_t begin,
+                const size_t batchSize,
+                arma::mat& gradient);
+
   /**
    * Returns the elementwise sigmoid of the passed matrix, where the sigmoid
    * function of a real number 'x' is [1 / (1 + exp(-x))].
@@ -139,6 +209,58 @@ class SparseAutoencoderFunction
     return rho;
   }
 
+  //! Sets the number of threads used (0 means all available cores).
+  void Threads(const size_t t)
+  {
+    this->threads = t;
+  }
+
+  //! Gets the number of threads used (0 means all available cores).
+  size_t Threads() const
+  {
+    return threads;
+  }
+
+  //! Sets the number of points processed at a time by each thread.
+  void BlockSize(const size_t b)
+  {
+    this->blockSize = b;
+  }
+
+  //! Gets the number of points processed at a time by each thread.
+  size_t BlockSize() const
+  {
+    return blockSize;
+  }
+
+  //! Sets the running estimate of the average hidden activations used by the
+  //! SGD functions (an empty vector restarts it from the next mini-batch).
+  void RhoCapEstimate(const arma::vec& estimate)
+  {
+    this->rhoCapEstimate = estimate;
+  }
+
+  //! Gets the running estimate of the average hidden activations used by the
+  //! SGD functions (empty until the first mini-batch).
+  const arma::vec& RhoCapEstimate() const
+  {
+    return rhoCapEstimate;
+  }
+
+  //! Sets the weight of the old running estimate of the average hidden
+  //! activations when a mini-batch is added to it.
+  void RhoDecay(const double d)
+  {
+    this->rhoDecay = d;
+  }
+
+  //! Gets the weight of the old running estimate of the average hidden
+  //! activations when a mini-batch is added to it.
+  double RhoDecay() const
+  {
+    return rhoDecay;
+  }
+
  private:
   //! The matrix of data points.
   const arma::mat& data;
@@ -154,6 +276,39 @@ class SparseAutoencoderFunction
   double beta;
   //! Sparsity parameter.
   double rho;
+  //! Number of threads to use (0 means all available cores).
+  size_t threads;
+  //! Number of points processed at a time by each thread.
+  size_t blockSize;
+  //! Running estimate of the average hidden activations, for SGD.
+  arma::vec rhoCapEstimate;
+  //! Weight of the old running estimate when a mini-batch is added to it.
+  double rhoDecay;
+
+  /**
+   * Compute the activations of the hidden and output layers for the points
+   * begin, ..., end.
+   */
+  void Forward(const arma::mat& parameters,
+               const size_t begin,
+               const size_t end,
+               arma::mat& hiddenLayer,
+               arma::mat& outputLayer) const;
+
+  /**
+   * Return the regularization and KL divergence terms of the objective, with
+   * the given average hidden activations.
+   */
+  double Penalty(const arma::mat& parameters, const arma::vec& rhoCap) const;
+
+  /**
+   * Perform the feedforward pass (and, if computeGradient is true, the
+   * backpropagation) over all of the data, one block at a time, and return the
+   * objective.  The gradient is only stored if computeGradient is true.
+   */
+  double Pass(const arma::mat& parameters,
+              arma::mat& gradient,
+              const bool computeGradient) const;
 };
 
 }; // namespace nn
@@ -47,6 +47,14 @@ namespace sparse_coding {
  * using LARS, an algorithm that can solve the LASSO or the Elastic Net (papers
  * below).
  *
+ * For large or streaming datasets, OnlineEncode() instead learns the
+ * dictionary online from mini-batches of points: each mini-batch is coded with
+ * LARS, its contribution is accumulated into two small matrices of sufficient
+ * statistics (k-by-k and d-by-k), and the dictionary is updated from those by
+ * block coordinate descent, as in the paper by Mairal et al. below.  The memory
+ * used besides the codes does not depend on the number of points, and the
+ * dictionary usually converges in far fewer passes over the data.
+ *
  * Here are those papers:
  *
  * @code
@@ -88,6 +96,17 @@ namespace sparse_coding {
  * }
  * @endcode
  *
+ * @code
+ * @article{mairal2010online,
+ *   title={Online learning for matrix factorization and sparse coding},
+ *   author={Mairal, J. and Bach, F. and Ponce, J. and Sapiro, G.},
+ *   journal={The Journal of Machine Learning Research},
+ *   volume={11},
+ *   pages={19--60},
+ *   year={2010}
+ * }
+ * @endcode
+ *
  * Before the method is run, the dictionary is initialized using the
  * DictionaryInitializationPolicy class.  Possible choices include the
  * RandomInitializer, which provides an entirely random dictionary, the
@@ -111,11 +130,14 @@ class SparseCoding
    * @param atoms Number of atoms in dictionary
    * @param lambda1 Regularization parameter for l1-norm penalty
    * @param lambda2 Regularization parameter for l2-norm penalty
+   * @param threads Number of threads to use for the coding step (0 uses all
+   *     available threads)
    */
   SparseCoding(const arma::mat& data,
                const size_t atoms,
                const double lambda1,
-               const double lambda2 = 0);
+               const double lambda2 = 0,
+               const size_t threads = 0);
 
   /**
    * Run Sparse Coding with Dictionary Learning.
@@ -133,7 +155,30 @@ class SparseCoding
               const double newtonTolerance = 1e-6);
 
   /**
-   * Sparse code each point via LARS.
+   * Run Sparse Coding with online dictionary learning.  The points are visited
+   * in a random order in mini-batches of the given size (the order is
+   * reshuffled for each pass over the data).  Each mini-batch is coded with the
+   * current dictionary, the sufficient statistics A = sum(z z^T) and
+   * B = sum(x z^T) are updated with the codes (older mini-batches are slowly
+   * forgotten, as in Mairal et al.), and the dictionary is updated by block
+   * coordinate descent on A and B, warm started from the current dictionary.
+   * When the dictionary has been learned, every point is coded with it, so
+   * Codes() holds the codes of the whole dataset.
+   *
+   * @param batchSize Number of points in each mini-batch.
+   * @param maxIterations Number of mini-batches to learn from.  If 0, one pass
+   *     over the data is made.
+   * @param dictionaryTolerance Tolerance for the block coordinate descent
+   *     dictionary update: it stops when no atom moves by more than this.
+   */
+  void OnlineEncode(const size_t batchSize = 256,
+                    const size_t maxIterations = 0,
+                    const double dictionaryTolerance = 1e-6);
+
+  /**
+   * Sparse code each point via LARS.  The Gram matrix of the dictionary is
+   * computed once, and the points are coded in parallel with Threads() threads
+   * if OpenMP is available.
    */
   void OptimizeCode();
 
@@ -176,10 +221,46 @@ class SparseCoding
   //! Modify the sparse codes.
   arma::mat& Codes() { return codes; }
 
+  //! Get the number of threads used for the coding step (0 means all
+  //! available threads).
+  size_t Threads() const { return threads; }
+  //! Modify the number of threads used for the coding step (0 means all
+  //! available threads).  This has no effect if mlpack was compiled without
+  //! OpenMP.
+  size_t& Threads() { return threads; }
+
   // Returns a string representation of this object. 
   std::string ToString() const;
 
  private:
+  /**
+   * Sparse code the given points with the current dictionary, whose Gram
+   * matrix is given, via LARS.  The points are coded in parallel with
+   * Threads() threads if OpenMP is available.
+   *
+   * @param points Points to code.
+   * @param gram Gram matrix of the dictionary.
+   * @param pointCodes Matrix to store the codes in; it must already have the
+   *     right size.
+   */
+  void OptimizeCode(const arma::mat& points,
+                    const arma::mat& gram,
+                    arma::mat& pointCodes) const;
+
+  /**
+   * Update the dictionary by block coordinate descent, given the sufficient
+   * statistics of the online dictionary learning.
+   *
+   * @param a Sum of z z^T over the codes z seen so far (k x k).
+   * @param b Sum of x z^T over the points x seen so far (d x k).
+   * @param tolerance Stop when no atom moves by more than this.
+   * @param maxIterations Maximum number of passes over the atoms.
+   */
+  void OnlineDictionaryStep(const arma::mat& a,
+                            const arma::mat& b,
+                            const double tolerance,
+                            const size_t maxIterations = 50);
+
   //! Number of atoms.
   size_t atoms;
 
@@ -197,6 +278,9 @@ class SparseCoding
 
   //! l2 regularization term.
   double lambda2;
+
+  //! Number of threads used for the coding step (0 means all available).
+  size_t threads;
 };
 
 }; // namespace sparse_coding
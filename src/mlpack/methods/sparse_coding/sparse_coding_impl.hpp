@@ -18,12 +18,14 @@ template<typename DictionaryInitializer>
 SparseCoding<DictionaryInitializer>::SparseCoding(const arma::mat& data,
                                                   const size_t atoms,
                                                   const double lambda1,
-                                                  const double lambda2) :
+                                                  const double lambda2,
+                                                  const size_t threads) :
     atoms(atoms),
     data(data),
     codes(atoms, data.n_cols),
     lambda1(lambda1),
-    lambda2(lambda2)
+    lambda2(lambda2),
+    threads(threads)
 {
   // Initialize the dictionary.
   DictionaryInitializer::Initialize(data, atoms, dictionary);
@@ -91,6 +93,87 @@ void SparseCoding<DictionaryInitializer>::Encode(const size_t maxIterations,
   Timer::Stop("sparse_coding");
 }
 
+template<typename DictionaryInitializer>
+void SparseCoding<DictionaryInitializer>::OnlineEncode(
+    const size_t batchSize,
+    const size_t maxIterations,
+    const double dictionaryTolerance)
+{
+  if (batchSize == 0)
+  {
+    Log::Fatal << "SparseCoding::OnlineEncode(): batch size must be positive!"
+        << std::endl;
+  }
+
+  Timer::Start("sparse_coding");
+
+  const size_t size = std::min(batchSize, (size_t) data.n_cols);
+  const size_t batchesPerPass = (data.n_cols + size - 1) / size;
+  const size_t iterations = (maxIterations == 0) ? batchesPerPass :
+      maxIterations;
+
+  // The sufficient statistics of the points seen so far.
+  arma::mat a = arma::zeros<arma::mat>(atoms, atoms);
+  arma::mat b = arma::zeros<arma::mat>(data.n_rows, atoms);
+
+  arma::uvec order;
+  arma::mat batch(data.n_rows, size);
+  arma::mat batchCodes(atoms, size);
+  size_t position = data.n_cols;
+  for (size_t t = 1; t <= iterations; ++t)
+  {
+    // Take the next mini-batch in the random order, reshuffling at the end of
+    // each pass.  The last mini-batch of a pass may be smaller.
+    if (position == data.n_cols)
+    {
+      order = arma::shuffle(arma::linspace<arma::uvec>(0, data.n_cols - 1,
+          data.n_cols));
+      position = 0;
+    }
+
+    const size_t points = std::min(size, (size_t) data.n_cols - position);
+    if (points != batch.n_cols)
+    {
+      batch.set_size(data.n_rows, points);
+      batchCodes.set_size(atoms, points);
+    }
+    for (size_t i = 0; i < points; ++i)
+      batch.col(i) = data.col(order[position + i]);
+    position += points;
+
+    // Code the mini-batch with the current dictionary.
+    const arma::mat gram = trans(dictionary) * dictionary;
+    OptimizeCode(batch, gram, batchCodes);
+
+    // Update the sufficient statistics.  The old statistics are weighted down
+    // so that the codes from the early, poor dictionaries are forgotten; this
+    // is the weighting suggested by Mairal et al. for mini-batches.
+    const double eta = (double) points;
+    const double theta = (t < points) ? t * eta : eta * eta + t - eta;
+    const double beta = (theta + 1 - eta) / (theta + 1);
+    a = beta * a + (batchCodes * trans(batchCodes)) / eta;
+    b = beta * b + (batch * trans(batchCodes)) / eta;
+
+    // Update the dictionary.
+    OnlineDictionaryStep(a, b, dictionaryTolerance);
+
+    Log::Debug << "Mini-batch " << t << " of " << iterations << ": "
+        << points << " points." << std::endl;
+  }
+
+  // Now code the whole dataset with the learned dictionary.
+  Log::Info << "Learned dictionary from " << iterations << " mini-batches; "
+      << "coding all points..." << std::endl;
+  OptimizeCode();
+
+  const arma::uvec adjacencies = find(codes);
+  Log::Info << "  Sparsity level: " << 100.0 * ((double) (adjacencies.n_elem))
+      / ((double) (atoms * data.n_cols)) << "%." << std::endl;
+  Log::Info << "  Objective value: " << Objective() << "." << std::endl;
+
+  Timer::Stop("sparse_coding");
+}
+
 template<typename DictionaryInitializer>
 void SparseCoding<DictionaryInitializer>::OptimizeCode()
 {
@@ -98,20 +181,75 @@ void SparseCoding<DictionaryInitializer>::OptimizeCode()
   // lambda2 > 0.
   arma::mat matGram = trans(dictionary) * dictionary;
 
-  for (size_t i = 0; i < data.n_cols; ++i)
-  {
-    // Report progress.
-    if ((i % 100) == 0)
-      Log::Debug << "Optimization at point " << i << "." << std::endl;
+  OptimizeCode(data, matGram, codes);
+}
 
-    bool useCholesky = true;
-    regression::LARS lars(useCholesky, matGram, lambda1, lambda2);
+template<typename DictionaryInitializer>
+void SparseCoding<DictionaryInitializer>::OptimizeCode(
+    const arma::mat& points,
+    const arma::mat& gram,
+    arma::mat& pointCodes) const
+{
+  // Determine how many threads we can use.
+#ifdef _OPENMP
+  const size_t numThreads = (threads == 0) ? omp_get_max_threads() : threads;
+#else
+  const size_t numThreads = 1;
+#endif
+
+  Log::Debug << "Coding " << points.n_cols << " points with " << numThreads
+      << " threads." << std::endl;
+
+  // The code of each point is independent of the others, and the Gram matrix
+  // is only read, so the points are split among the threads.  Each point gets
+  // a fresh LARS object (LARS keeps its active set between calls to Regress()),
+  // but it holds only a reference to the shared Gram matrix, so this is cheap.
+  // The LARS objects use one thread each, since the threads are already busy.
+  #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 16)
+  for (omp_size_t i = 0; i < (omp_size_t) points.n_cols; ++i)
+  {
+    const bool useCholesky = true;
+    regression::LARS lars(useCholesky, gram, lambda1, lambda2);
+    lars.Threads() = 1;
 
     // Create an alias of the code (using the same memory), and then LARS will
     // place the result directly into that; then we will not need to have an
     // extra copy.
-    arma::vec code = codes.unsafe_col(i);
-    lars.Regress(dictionary, data.unsafe_col(i), code, false);
+    arma::vec code = pointCodes.unsafe_col(i);
+    lars.Regress(dictionary, points.unsafe_col(i), code, false);
+  }
+}
+
+template<typename DictionaryInitializer>
+void SparseCoding<DictionaryInitializer>::OnlineDictionaryStep(
+    const arma::mat& a,
+    const arma::mat& b,
+    const double tolerance,
+    const size_t maxIterations)
+{
+  for (size_t t = 0; t != maxIterations; ++t)
+  {
+    double maxChange = 0;
+    for (size_t j = 0; j < atoms; ++j)
+    {
+      // An atom which hasn't been used by any code yet can't be updated.
+      if (a(j, j) == 0)
+        continue;
+
+      // Minimize over atom j with the others fixed, then project back onto the
+      // unit ball.
+      arma::vec atom = dictionary.col(j) + (b.col(j) - dictionary * a.col(j)) /
+          a(j, j);
+      const double atomNorm = arma::norm(atom, 2);
+      if (atomNorm > 1)
+        atom /= atomNorm;
+
+      maxChange = std::max(maxChange, arma::norm(atom - dictionary.col(j), 2));
+      dictionary.col(j) = atom;
+    }
+
+    if (maxChange < tolerance)
+      break;
   }
 }
 
@@ -344,6 +482,7 @@ std::string SparseCoding<DictionaryInitializer>::ToString() const
   convert << "  Atoms: " << atoms << std::endl;
   convert << "  Lambda 1: " << lambda1 << std::endl;
   convert << "  Lambda 2: " << lambda2 << std::endl;
+  convert << "  Threads: " << threads << std::endl;
   return convert.str();
 }
 
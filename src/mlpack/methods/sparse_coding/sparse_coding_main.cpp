@@ -34,7 +34,13 @@ PROGRAM_INFO("Sparse Coding", "An implementation of Sparse Coding with "
     "\n\n"
     "The maximum number of iterations may be specified with the -n option. "
     "Optionally, the input data matrix X can be normalized before coding with "
-    "the -N option.");
+    "the -N option."
+    "\n\n"
+    "For large datasets, the dictionary can instead be learned online from "
+    "mini-batches of points by specifying the mini-batch size with "
+    "--batch_size (-b); then the maximum number of iterations (-n) is the "
+    "number of mini-batches to learn from, and if it is 0, one pass over the "
+    "data is made.");
 
 PARAM_STRING_REQ("input_file", "Filename of the input data.", "i");
 PARAM_INT_REQ("atoms", "Number of atoms in the dictionary.", "k");
@@ -64,6 +70,11 @@ PARAM_DOUBLE("objective_tolerance", "Tolerance for convergence of the objective"
     " function.", "o", 0.01);
 PARAM_DOUBLE("newton_tolerance", "Tolerance for convergence of Newton method.",
     "w", 1e-6);
+PARAM_INT("batch_size", "If nonzero, learn the dictionary online from "
+    "mini-batches of this many points.", "b", 0);
+PARAM_INT("threads", "Number of threads to use for the coding step (0 uses "
+    "all available cores; ignored if mlpack was built without OpenMP).", "t",
+    0);
 
 using namespace arma;
 using namespace std;
@@ -97,6 +108,21 @@ int main(int argc, char* argv[])
   const double objTolerance = CLI::GetParam<double>("objective_tolerance");
   const double newtonTolerance = CLI::GetParam<double>("newton_tolerance");
 
+  // Sanity check on the number of threads.
+  if (CLI::GetParam<int>("threads") < 0)
+  {
+    Log::Fatal << "Invalid number of threads: " << CLI::GetParam<int>("threads")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t threads = (size_t) CLI::GetParam<int>("threads");
+
+  if (CLI::GetParam<int>("batch_size") < 0)
+  {
+    Log::Fatal << "Invalid batch size: " << CLI::GetParam<int>("batch_size")
+        << ".  Must be greater than or equal to 0." << endl;
+  }
+  const size_t batchSize = (size_t) CLI::GetParam<int>("batch_size");
+
   mat matX;
   data::Load(inputFile, matX, true);
 
@@ -114,7 +140,8 @@ int main(int argc, char* argv[])
   // If there is an initial dictionary, be sure we do not initialize one.
   if (initialDictionaryFile != "")
   {
-    SparseCoding<NothingInitializer> sc(matX, atoms, lambda1, lambda2);
+    SparseCoding<NothingInitializer> sc(matX, atoms, lambda1, lambda2,
+        threads);
 
     // Load initial dictionary directly into sparse coding object.
     data::Load(initialDictionaryFile, sc.Dictionary(), true);
@@ -135,7 +162,10 @@ int main(int argc, char* argv[])
     }
 
     // Run sparse coding.
-    sc.Encode(maxIterations, objTolerance, newtonTolerance);
+    if (batchSize > 0)
+      sc.OnlineEncode(batchSize, maxIterations);
+    else
+      sc.Encode(maxIterations, objTolerance, newtonTolerance);
 
     // Save the results.
     Log::Info << "Saving dictionary matrix to '" << dictionaryFile << "'.\n";
@@ -146,10 +176,13 @@ int main(int argc, char* argv[])
   else
   {
     // No initial dictionary.
-    SparseCoding<> sc(matX, atoms, lambda1, lambda2);
+    SparseCoding<> sc(matX, atoms, lambda1, lambda2, threads);
 
     // Run sparse coding.
-    sc.Encode(maxIterations, objTolerance, newtonTolerance);
+    if (batchSize > 0)
+      sc.OnlineEncode(batchSize, maxIterations);
+    else
+      sc.Encode(maxIterations, objTolerance, newtonTolerance);
 
     // Save the results.
     Log::Info << "Saving dictionary matrix to '" << dictionaryFile << "'.\n";
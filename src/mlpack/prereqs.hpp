@@ -13,6 +13,9 @@ problems.  It should only be necessary to include <mlpack/core.hpp> and not\
 <armadillo>."
 #endif
 
+// The options mlpack was built with (generated by CMake).
+#include <mlpack/config.hpp>
+
 // Next, standard includes.
 #include <stdlib.h>
 #include <stdio.h>
@@ -45,6 +48,19 @@ problems.  It should only be necessary to include <mlpack/core.hpp> and not\
   #define force_inline __forceinline
 #endif
 
+// Include OpenMP, if we are compiling with it.
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+// OpenMP 2.0 (which is all that Visual Studio supports) requires loop indices
+// of parallel for loops to be signed.
+#ifdef _MSC_VER
+  typedef intmax_t omp_size_t;
+#else
+  typedef size_t omp_size_t;
+#endif
+
 // Now include Armadillo through the special mlpack extensions.
 #include <mlpack/core/arma_extend/arma_extend.hpp>
 
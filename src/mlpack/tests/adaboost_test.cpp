@@ -323,6 +323,44 @@ BOOST_AUTO_TEST_CASE(HammingLossIris_DS)
   BOOST_REQUIRE(hammingLoss <= ztP);
 }
 
+/**
+ * This test case runs the AdaBoost.mh algorithm on the UCI Iris dataset, with
+ * decision stumps that find their splits with histograms.  It checks whether
+ * the hamming loss breaches the upper bound given by ztAccumulator.
+ */
+BOOST_AUTO_TEST_CASE(HammingLossIris_HistogramDS)
+{
+  arma::mat inputData;
+
+  if (!data::Load("iris.txt", inputData))
+    BOOST_FAIL("Cannot load test dataset iris.txt!");
+
+  arma::Mat<size_t> labels;
+
+  if (!data::Load("iris_labels.txt",labels))
+    BOOST_FAIL("Cannot load labels for iris_labels.txt");
+
+  const size_t numClasses = 3;
+  const size_t inpBucketSize = 6;
+  const size_t histogramBins = 16;
+
+  decision_stump::DecisionStump<> ds(inputData, labels.row(0),
+                                     numClasses, inpBucketSize, histogramBins);
+  int iterations = 50;
+  double tolerance = 1e-10;
+
+  AdaBoost<arma::mat, mlpack::decision_stump::DecisionStump<> > a(inputData,
+          labels.row(0), iterations, tolerance, ds);
+  int countError = 0;
+  for (size_t i = 0; i < labels.n_cols; i++)
+    if(labels(i) != a.finalHypothesis(i))
+      countError++;
+  double hammingLoss = (double) countError / labels.n_cols;
+
+  double ztP = a.GetztProduct();
+  BOOST_REQUIRE(hammingLoss <= ztP);
+}
+
 /**
  *  This test case runs the AdaBoost.mh algorithm on a non-linearly
  *  separable dataset.
@@ -717,4 +755,126 @@ BOOST_AUTO_TEST_CASE(ClassifyTest_IRIS)
   BOOST_REQUIRE(lError <= 0.30);
 }
 
+/**
+ * Make sure that boosting decision stumps gives exactly the same results no
+ * matter how many threads are used to train the stumps and update the weights.
+ */
+BOOST_AUTO_TEST_CASE(ParallelDeterminismVertebralColumn_DS)
+{
+  arma::mat inputData;
+
+  if (!data::Load("vc2.txt", inputData))
+    BOOST_FAIL("Cannot load test dataset vc2.txt!");
+
+  arma::Mat<size_t> labels;
+
+  if (!data::Load("vc2_labels.txt",labels))
+    BOOST_FAIL("Cannot load labels for vc2_labels.txt");
+
+  const size_t numClasses = 3;
+  const size_t inpBucketSize = 6;
+  int iterations = 50;
+  double tolerance = 1e-10;
+
+#ifdef _OPENMP
+  const int oldThreads = omp_get_max_threads();
+  omp_set_num_threads(1);
+#endif
+
+  decision_stump::DecisionStump<> serialDs(inputData, labels.row(0),
+                                           numClasses, inpBucketSize);
+  AdaBoost<arma::mat, mlpack::decision_stump::DecisionStump<> > serial(
+      inputData, labels.row(0), iterations, tolerance, serialDs);
+
+#ifdef _OPENMP
+  omp_set_num_threads(4);
+#endif
+
+  decision_stump::DecisionStump<> parallelDs(inputData, labels.row(0),
+                                             numClasses, inpBucketSize);
+  AdaBoost<arma::mat, mlpack::decision_stump::DecisionStump<> > parallel(
+      inputData, labels.row(0), iterations, tolerance, parallelDs);
+
+#ifdef _OPENMP
+  omp_set_num_threads(oldThreads);
+#endif
+
+  BOOST_REQUIRE_EQUAL(serialDs.SplitAttribute(), parallelDs.SplitAttribute());
+  BOOST_REQUIRE_EQUAL(serial.GetztProduct(), parallel.GetztProduct());
+  for (size_t i = 0; i < labels.n_cols; i++)
+    BOOST_REQUIRE_EQUAL(serial.finalHypothesis(i), parallel.finalHypothesis(i));
+}
+
+/**
+ * Make sure that the blocked, parallel Classify() gives each point the class
+ * with the largest sum of the weights of the weak learners which vote for it,
+ * no matter how many threads are used.
+ */
+BOOST_AUTO_TEST_CASE(ParallelClassifyVertebralColumn_DS)
+{
+  arma::mat inputData;
+
+  if (!data::Load("vc2.txt", inputData))
+    BOOST_FAIL("Cannot load test dataset vc2.txt!");
+
+  arma::Mat<size_t> labels;
+
+  if (!data::Load("vc2_labels.txt",labels))
+    BOOST_FAIL("Cannot load labels for vc2_labels.txt");
+
+  const size_t numClasses = 3;
+  const size_t inpBucketSize = 6;
+  int iterations = 50;
+  double tolerance = 1e-10;
+
+  decision_stump::DecisionStump<> ds(inputData, labels.row(0), numClasses,
+                                     inpBucketSize);
+  AdaBoost<arma::mat, mlpack::decision_stump::DecisionStump<> > a(
+      inputData, labels.row(0), iterations, tolerance, ds);
+
+  // Repeat the dataset so that it is split into several blocks.
+  const arma::mat testData = arma::repmat(inputData, 1, 10);
+
+  // Add up the votes of the weak learners by hand.
+  arma::mat votes(numClasses, testData.n_cols);
+  votes.zeros();
+  arma::Row<size_t> weakLabels(testData.n_cols);
+  for (size_t i = 0; i < a.WeakLearners().size(); i++)
+  {
+    decision_stump::DecisionStump<> w(a.WeakLearners()[i]);
+    w.Classify(testData, weakLabels);
+    for (size_t j = 0; j < testData.n_cols; j++)
+      votes(weakLabels(j), j) += a.Alpha()[i];
+  }
+
+#ifdef _OPENMP
+  const int oldThreads = omp_get_max_threads();
+  omp_set_num_threads(1);
+#endif
+
+  arma::Row<size_t> serialLabels;
+  a.Classify(testData, serialLabels);
+
+#ifdef _OPENMP
+  omp_set_num_threads(4);
+#endif
+
+  arma::Row<size_t> parallelLabels;
+  a.Classify(testData, parallelLabels);
+
+#ifdef _OPENMP
+  omp_set_num_threads(oldThreads);
+#endif
+
+  BOOST_REQUIRE_EQUAL(serialLabels.n_cols, testData.n_cols);
+  BOOST_REQUIRE_EQUAL(parallelLabels.n_cols, testData.n_cols);
+  for (size_t j = 0; j < testData.n_cols; j++)
+  {
+    arma::uword maxIndex;
+    votes.unsafe_col(j).max(maxIndex);
+    BOOST_REQUIRE_EQUAL(serialLabels(j), (size_t) maxIndex);
+    BOOST_REQUIRE_EQUAL(parallelLabels(j), (size_t) maxIndex);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
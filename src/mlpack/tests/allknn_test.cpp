@@ -6,8 +6,12 @@
 #include <mlpack/core.hpp>
 #include <mlpack/methods/neighbor_search/neighbor_search.hpp>
 #include <mlpack/methods/neighbor_search/unmap.hpp>
+#include <mlpack/methods/neighbor_search/autotune.hpp>
+#include <mlpack/methods/neighbor_search/mahalanobis_tree.hpp>
+#include <mlpack/methods/neighbor_search/distributed_knn.hpp>
 #include <mlpack/core/tree/cover_tree.hpp>
 #include <mlpack/core/tree/example_tree.hpp>
+#include <mlpack/core/tree/traversal_instrumentation.hpp>
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
@@ -160,6 +164,65 @@ BOOST_AUTO_TEST_CASE(SingleTreeUnmapTest)
   }
 }
 
+/**
+ * Check that Unmap() gives the same results with many threads as with one, on
+ * results large enough to be unmapped in parallel, and that slots which were
+ * never filled keep their invalid index.
+ */
+BOOST_AUTO_TEST_CASE(ParallelUnmapTest)
+{
+  const size_t k = 10;
+  const size_t n = 20000;
+
+  std::vector<size_t> refMap(n);
+  std::vector<size_t> queryMap(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    refMap[i] = i;
+    queryMap[i] = i;
+  }
+  std::random_shuffle(refMap.begin(), refMap.end());
+  std::random_shuffle(queryMap.begin(), queryMap.end());
+
+  arma::Mat<size_t> neighbors(k, n);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+    neighbors[i] = math::RandInt(n);
+  neighbors(k - 1, 7) = size_t() - 1;
+  arma::mat distances(k, n);
+  distances.randu();
+
+  arma::Mat<size_t> serialNeighbors, parallelNeighbors;
+  arma::mat serialDistances, parallelDistances;
+  Unmap(neighbors, distances, refMap, queryMap, serialNeighbors,
+      serialDistances, true, 1);
+  Unmap(neighbors, distances, refMap, queryMap, parallelNeighbors,
+      parallelDistances, true, 4);
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (size_t j = 0; j < k; ++j)
+    {
+      const size_t neighbor = (neighbors(j, i) < n) ?
+          refMap[neighbors(j, i)] : neighbors(j, i);
+      BOOST_REQUIRE_EQUAL(serialNeighbors(j, queryMap[i]), neighbor);
+      BOOST_REQUIRE_EQUAL(parallelNeighbors(j, queryMap[i]), neighbor);
+      BOOST_REQUIRE_EQUAL(parallelDistances(j, queryMap[i]),
+          sqrt(distances(j, i)));
+    }
+  }
+
+  // The single-tree version leaves the columns where they are.
+  Unmap(neighbors, distances, refMap, parallelNeighbors, parallelDistances,
+      false, 4);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    const size_t neighbor = (neighbors[i] < n) ? refMap[neighbors[i]] :
+        neighbors[i];
+    BOOST_REQUIRE_EQUAL(parallelNeighbors[i], neighbor);
+    BOOST_REQUIRE_EQUAL(parallelDistances[i], distances[i]);
+  }
+}
+
 /**
  * Simple nearest-neighbors test with small, synthetic dataset.  This is an
  * exhaustive test, which checks that each method for performing the calculation
@@ -548,6 +611,114 @@ BOOST_AUTO_TEST_CASE(DualTreeVsNaive2)
   }
 }
 
+/**
+ * Test that the parallel dual-tree search gives exactly the same results as the
+ * serial dual-tree search.  If mlpack was not compiled with OpenMP, both
+ * searches are serial, so this is trivially true.
+ */
+BOOST_AUTO_TEST_CASE(ParallelDualTreeVsSerialDualTree)
+{
+  arma::mat dataset;
+  dataset.randu(5, 2000);
+
+  AllkNN serial(dataset);
+  serial.Threads() = 1;
+  arma::Mat<size_t> serialNeighbors;
+  arma::mat serialDistances;
+  serial.Search(10, serialNeighbors, serialDistances);
+
+  AllkNN parallel(dataset);
+  parallel.Threads() = 4;
+  arma::Mat<size_t> parallelNeighbors;
+  arma::mat parallelDistances;
+  parallel.Search(10, parallelNeighbors, parallelDistances);
+
+  BOOST_REQUIRE_EQUAL(serialNeighbors.n_cols, parallelNeighbors.n_cols);
+  BOOST_REQUIRE_EQUAL(serialNeighbors.n_rows, parallelNeighbors.n_rows);
+  for (size_t i = 0; i < serialNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(serialNeighbors[i], parallelNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(serialDistances[i], parallelDistances[i], 1e-5);
+  }
+}
+
+/**
+ * Test that the parallel single-tree search gives exactly the same results as
+ * the serial single-tree search, for both kd-trees and cover trees (which need
+ * a copy of the reference tree for each thread).
+ */
+BOOST_AUTO_TEST_CASE(ParallelSingleTreeVsSerialSingleTree)
+{
+  arma::mat dataset;
+  dataset.randu(5, 2000);
+
+  AllkNN serial(dataset, false, true);
+  serial.Threads() = 1;
+  arma::Mat<size_t> serialNeighbors;
+  arma::mat serialDistances;
+  serial.Search(10, serialNeighbors, serialDistances);
+
+  AllkNN parallel(dataset, false, true);
+  parallel.Threads() = 4;
+  arma::Mat<size_t> parallelNeighbors;
+  arma::mat parallelDistances;
+  parallel.Search(10, parallelNeighbors, parallelDistances);
+
+  typedef CoverTree<LMetric<2>, FirstPointIsRoot,
+      NeighborSearchStat<NearestNeighborSort> > CoverTreeType;
+  CoverTreeType tree(dataset);
+  NeighborSearch<NearestNeighborSort, LMetric<2>, CoverTreeType>
+      coverSearch(&tree, dataset, true);
+  coverSearch.Threads() = 4;
+  arma::Mat<size_t> coverNeighbors;
+  arma::mat coverDistances;
+  coverSearch.Search(10, coverNeighbors, coverDistances);
+
+  for (size_t i = 0; i < serialNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(serialNeighbors[i], parallelNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(serialDistances[i], parallelDistances[i], 1e-5);
+    BOOST_REQUIRE_EQUAL(serialNeighbors[i], coverNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(serialDistances[i], coverDistances[i], 1e-5);
+  }
+}
+
+/**
+ * Test that searches which give each NUMA node its own copy of the reference
+ * tree give the same results as the serial search.  On machines with a single
+ * NUMA node, no copies are made.
+ */
+BOOST_AUTO_TEST_CASE(ReplicatedReferenceVsSerial)
+{
+  arma::mat dataset;
+  dataset.randu(5, 2000);
+
+  for (size_t single = 0; single < 2; ++single)
+  {
+    AllkNN serial(dataset, false, single == 1);
+    serial.Threads() = 1;
+    arma::Mat<size_t> serialNeighbors;
+    arma::mat serialDistances;
+    serial.Search(10, serialNeighbors, serialDistances);
+
+    AllkNN replicated(dataset, false, single == 1);
+    replicated.Threads() = 4;
+    replicated.ReplicateReference() = true;
+    arma::Mat<size_t> replicatedNeighbors;
+    arma::mat replicatedDistances;
+    replicated.Search(10, replicatedNeighbors, replicatedDistances);
+
+    // The copies only exist during the search, so a second search works too.
+    replicated.Search(10, replicatedNeighbors, replicatedDistances);
+
+    for (size_t i = 0; i < serialNeighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(serialNeighbors[i], replicatedNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(serialDistances[i], replicatedDistances[i], 1e-5);
+    }
+  }
+}
+
 /**
  * Test the single-tree nearest-neighbors method with the naive method.  This
  * uses only a reference dataset.
@@ -703,6 +874,45 @@ BOOST_AUTO_TEST_CASE(SingleBallTreeTest)
   }
 }
 
+/**
+ * Test dual-tree nearest neighbor search with ball trees built with BallSplit
+ * and vantage point trees against the naive method.
+ */
+BOOST_AUTO_TEST_CASE(DualBallSplitAndVPTreeTest)
+{
+  arma::mat dataset;
+  data::Load("test_data_3_1000.csv", dataset);
+
+  AllkNN naive(dataset, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  typedef BinarySpaceTree<BallBound<>, NeighborSearchStat<NearestNeighborSort>,
+      arma::mat, BallSplit<BallBound<> > > BallTreeType;
+  NeighborSearch<NearestNeighborSort, EuclideanDistance, BallTreeType>
+      ballTreeSearch(dataset);
+  arma::Mat<size_t> ballTreeNeighbors;
+  arma::mat ballTreeDistances;
+  ballTreeSearch.Search(5, ballTreeNeighbors, ballTreeDistances);
+
+  typedef BinarySpaceTree<BallBound<>, NeighborSearchStat<NearestNeighborSort>,
+      arma::mat, VPTreeSplit<BallBound<> > > VPTreeType;
+  NeighborSearch<NearestNeighborSort, EuclideanDistance, VPTreeType>
+      vpTreeSearch(dataset);
+  arma::Mat<size_t> vpTreeNeighbors;
+  arma::mat vpTreeDistances;
+  vpTreeSearch.Search(5, vpTreeNeighbors, vpTreeDistances);
+
+  for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(ballTreeNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(ballTreeDistances[i], naiveDistances[i], 1e-5);
+    BOOST_REQUIRE_EQUAL(vpTreeNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(vpTreeDistances[i], naiveDistances[i], 1e-5);
+  }
+}
+
 /**
  * Test the ball tree dual-tree nearest neighbors method against the naive
  * method.
@@ -736,6 +946,47 @@ BOOST_AUTO_TEST_CASE(DualBallTreeTest)
   }
 }
 
+/**
+ * Make sure that kd-trees and ball trees work on single precision data, and
+ * give the same results as a naive single precision search.
+ */
+BOOST_AUTO_TEST_CASE(SinglePrecisionTreeTest)
+{
+  arma::fmat dataset = arma::randu<arma::fmat>(4, 1000);
+
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort>, arma::fmat> FloatKDTree;
+  typedef BinarySpaceTree<BallBound<arma::fvec, LMetric<2, true> >,
+      NeighborSearchStat<NearestNeighborSort>, arma::fmat> FloatBallTree;
+
+  NeighborSearch<NearestNeighborSort, EuclideanDistance, FloatKDTree>
+      naive(dataset, true);
+  NeighborSearch<NearestNeighborSort, EuclideanDistance, FloatKDTree>
+      kdTree(dataset);
+  NeighborSearch<NearestNeighborSort, EuclideanDistance, FloatKDTree>
+      kdTreeSingle(dataset, false, true);
+  NeighborSearch<NearestNeighborSort, EuclideanDistance, FloatBallTree>
+      ballTree(dataset);
+
+  arma::Mat<size_t> naiveNeighbors, kdNeighbors, kdSingleNeighbors,
+      ballNeighbors;
+  arma::mat naiveDistances, kdDistances, kdSingleDistances, ballDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+  kdTree.Search(5, kdNeighbors, kdDistances);
+  kdTreeSingle.Search(5, kdSingleNeighbors, kdSingleDistances);
+  ballTree.Search(5, ballNeighbors, ballDistances);
+
+  for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(naiveNeighbors[i], kdNeighbors[i]);
+    BOOST_REQUIRE_EQUAL(naiveNeighbors[i], kdSingleNeighbors[i]);
+    BOOST_REQUIRE_EQUAL(naiveNeighbors[i], ballNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(naiveDistances[i], kdDistances[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(naiveDistances[i], kdSingleDistances[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(naiveDistances[i], ballDistances[i], 1e-5);
+  }
+}
+
 // Make sure sparse nearest neighbors works with kd trees.
 BOOST_AUTO_TEST_CASE(SparseAllkNNKDTreeTest)
 {
@@ -777,6 +1028,66 @@ BOOST_AUTO_TEST_CASE(SparseAllkNNKDTreeTest)
   }
 }
 
+/**
+ * Make sure that the batched NeighborSearchRules::BaseCaseRange() gives exactly
+ * the same results as calling BaseCase() for each reference point, both for the
+ * vectorized Euclidean distance and for another metric.
+ */
+template<typename MetricType>
+void CheckBaseCaseRange()
+{
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+  typedef NeighborSearchRules<NearestNeighborSort, MetricType, TreeType>
+      RuleType;
+
+  arma::mat querySet = arma::randu<arma::mat>(4, 20);
+  arma::mat referenceSet = arma::randu<arma::mat>(4, 100);
+  MetricType metric;
+
+  arma::Mat<size_t> neighbors(5, querySet.n_cols);
+  arma::mat distances(5, querySet.n_cols);
+  neighbors.fill(size_t() - 1);
+  distances.fill(DBL_MAX);
+  arma::Mat<size_t> rangeNeighbors(neighbors);
+  arma::mat rangeDistances(distances);
+
+  RuleType rules(referenceSet, querySet, neighbors, distances, metric);
+  RuleType rangeRules(referenceSet, querySet, rangeNeighbors, rangeDistances,
+      metric);
+
+  // Use ranges of a few different sizes, including a single point.
+  for (size_t q = 0; q < querySet.n_cols; ++q)
+  {
+    size_t begin = 0;
+    size_t width = 1;
+    while (begin < referenceSet.n_cols)
+    {
+      const size_t end = std::min(begin + width, (size_t) referenceSet.n_cols);
+      for (size_t r = begin; r < end; ++r)
+        rules.BaseCase(q, r);
+      rangeRules.BaseCaseRange(q, begin, end);
+
+      begin = end;
+      width = (width % 17) + 6;
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(rules.BaseCases(), rangeRules.BaseCases());
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], rangeNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], rangeDistances[i], 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BaseCaseRangeTest)
+{
+  CheckBaseCaseRange<EuclideanDistance>();
+  CheckBaseCaseRange<SquaredEuclideanDistance>();
+  CheckBaseCaseRange<ManhattanDistance>();
+}
+
 /*
 BOOST_AUTO_TEST_CASE(SparseAllkNNCoverTreeTest)
 {
@@ -816,4 +1127,716 @@ BOOST_AUTO_TEST_CASE(SparseAllkNNCoverTreeTest)
 }
 */
 
+/**
+ * Make sure that approximate search with epsilon returns neighbors whose
+ * distances are within a factor of (1 + epsilon) of the true distances, for
+ * both single-tree and dual-tree search.
+ */
+BOOST_AUTO_TEST_CASE(ApproximateEpsilonTest)
+{
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  const double epsilon = 0.5;
+
+  AllkNN naive(dataset, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(10, naiveNeighbors, naiveDistances);
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    AllkNN allknn(dataset, false, (mode == 1));
+    allknn.Epsilon() = epsilon;
+
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    allknn.Search(10, neighbors, distances);
+
+    for (size_t i = 0; i < distances.n_elem; ++i)
+    {
+      BOOST_REQUIRE_LE(distances[i],
+          (1 + epsilon) * naiveDistances[i] + 1e-10);
+      BOOST_REQUIRE_GE(distances[i], naiveDistances[i] - 1e-10);
+    }
+  }
+}
+
+/**
+ * Make sure that instrumenting the traversal doesn't change the results, and
+ * that the counters it collects are consistent with each other.
+ */
+BOOST_AUTO_TEST_CASE(TraversalInstrumentationTest)
+{
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+  typedef NeighborSearch<NearestNeighborSort, EuclideanDistance, TreeType,
+      TraversalInstrumentation> InstrumentedAllkNN;
+
+  AllkNN allknn(dataset);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  allknn.Search(5, neighbors, distances);
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    InstrumentedAllkNN instrumented(dataset, false, (mode == 1));
+    arma::Mat<size_t> instrumentedNeighbors;
+    arma::mat instrumentedDistances;
+    instrumented.Search(5, instrumentedNeighbors, instrumentedDistances);
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(instrumentedNeighbors[i], neighbors[i]);
+      BOOST_REQUIRE_CLOSE(instrumentedDistances[i], distances[i], 1e-5);
+    }
+
+    const TraversalInstrumentation& info = instrumented.Instrumentation();
+    BOOST_REQUIRE_GT(info.Scores(), 0);
+    BOOST_REQUIRE_GT(info.Prunes(), 0);
+    BOOST_REQUIRE_LE(info.Prunes(), info.Scores());
+    BOOST_REQUIRE_LE(info.RescorePrunes(), info.Rescores());
+    BOOST_REQUIRE_GE(info.BaseCases(), instrumented.BaseCases());
+    BOOST_REQUIRE_EQUAL(arma::accu(info.VisitsByDepth()), info.Scores());
+    BOOST_REQUIRE_EQUAL(arma::accu(info.PrunesByDepth()),
+        info.Prunes() + info.RescorePrunes());
+    BOOST_REQUIRE_GT(info.LeafVisits(), 0);
+    BOOST_REQUIRE_GT(info.LeafUtilization(), 0.0);
+
+    instrumented.Instrumentation().Reset();
+    BOOST_REQUIRE_EQUAL(instrumented.Instrumentation().Scores(), 0);
+    BOOST_REQUIRE_EQUAL(instrumented.Instrumentation().VisitsByDepth().n_elem,
+        0);
+  }
+}
+
+/**
+ * Make sure that the best-first dual-tree traverser gives the same results as
+ * the default traverser, for both kd-trees and cover trees.
+ */
+BOOST_AUTO_TEST_CASE(BestFirstDualTreeTraverserTest)
+{
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  AllkNN allknn(dataset);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  allknn.Search(5, neighbors, distances);
+
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > KDTreeType;
+  NeighborSearch<NearestNeighborSort, EuclideanDistance, KDTreeType,
+      NoTraversalInstrumentation, KDTreeType::BestFirstDualTreeTraverser>
+      kdBestFirst(dataset);
+  arma::Mat<size_t> kdNeighbors;
+  arma::mat kdDistances;
+  kdBestFirst.Search(5, kdNeighbors, kdDistances);
+
+  typedef CoverTree<LMetric<2>, FirstPointIsRoot,
+      NeighborSearchStat<NearestNeighborSort> > CoverTreeType;
+  CoverTreeType tree(dataset);
+  NeighborSearch<NearestNeighborSort, LMetric<2>, CoverTreeType,
+      NoTraversalInstrumentation, CoverTreeType::BestFirstDualTreeTraverser>
+      coverBestFirst(&tree, dataset);
+  arma::Mat<size_t> coverNeighbors;
+  arma::mat coverDistances;
+  coverBestFirst.Search(5, coverNeighbors, coverDistances);
+
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(kdNeighbors[i], neighbors[i]);
+    BOOST_REQUIRE_CLOSE(kdDistances[i], distances[i], 1e-5);
+    BOOST_REQUIRE_EQUAL(coverNeighbors[i], neighbors[i]);
+    BOOST_REQUIRE_CLOSE(coverDistances[i], distances[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure that autotuning samples distinct points, and chooses one of the
+ * configurations it was given.
+ */
+BOOST_AUTO_TEST_CASE(AutotuneKNNTest)
+{
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  // Every sampled point must be a distinct point of the dataset.
+  arma::mat sample;
+  SampleColumns(dataset, 100, sample);
+  BOOST_REQUIRE_EQUAL(sample.n_rows, dataset.n_rows);
+  BOOST_REQUIRE_EQUAL(sample.n_cols, 100);
+  std::vector<bool> sampled(dataset.n_cols, false);
+  for (size_t i = 0; i < sample.n_cols; ++i)
+  {
+    size_t j = 0;
+    while (j < dataset.n_cols && arma::any(sample.col(i) != dataset.col(j)))
+      ++j;
+    BOOST_REQUIRE_LT(j, dataset.n_cols);
+    BOOST_REQUIRE(!sampled[j]);
+    sampled[j] = true;
+  }
+
+  // A sample larger than the dataset is the whole dataset.
+  SampleColumns(dataset, 2000, sample);
+  BOOST_REQUIRE_EQUAL(sample.n_cols, dataset.n_cols);
+
+  std::vector<size_t> leafSizes;
+  leafSizes.push_back(5);
+  leafSizes.push_back(20);
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    // The second time, use a separate query set.
+    arma::mat queries;
+    if (mode == 1)
+      queries = dataset.cols(0, 199);
+
+    std::string treeType;
+    size_t leafSize = 0;
+    AutotuneKNN(dataset, queries, 3, false, 500, leafSizes, treeType,
+        leafSize);
+
+    BOOST_REQUIRE(treeType == "kd" || treeType == "cover" || treeType == "r");
+    if (treeType == "cover")
+      BOOST_REQUIRE_EQUAL(leafSize, 0);
+    else
+      BOOST_REQUIRE(leafSize == 5 || leafSize == 20);
+  }
+}
+
+/**
+ * Make sure that the bound cached in the statistic of each query node (and its
+ * descendants) is no better than the final k'th neighbor distance of any of its
+ * descendant points.
+ */
+template<typename TreeType>
+void CheckCachedBounds(const TreeType& node, const arma::mat& distances)
+{
+  for (size_t i = 0; i < node.Count(); ++i)
+  {
+    const double kthDistance = distances(distances.n_rows - 1,
+        node.Begin() + i);
+    BOOST_REQUIRE_GE(node.Stat().Bound(), kthDistance);
+    BOOST_REQUIRE_GE(node.Stat().FirstBound(), kthDistance);
+    BOOST_REQUIRE_GE(node.Stat().SecondBound(), kthDistance);
+  }
+
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+    CheckCachedBounds(node.Child(i), distances);
+}
+
+/**
+ * The bounds of each query node are cached and only recalculated when a
+ * candidate changes.  Search twice with the same trees, and make sure that the
+ * results are correct both times and the cached bounds are valid.
+ */
+BOOST_AUTO_TEST_CASE(CachedBoundsTest)
+{
+  arma::mat dataset;
+  data::Load("test_data_3_1000.csv", dataset);
+
+  arma::mat references(dataset);
+  arma::mat queries(dataset.cols(0, 299));
+
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+  std::vector<size_t> oldFromNewReferences;
+  std::vector<size_t> oldFromNewQueries;
+  TreeType referenceTree(references, oldFromNewReferences, 5);
+  TreeType queryTree(queries, oldFromNewQueries, 5);
+
+  AllkNN naive(references, queries, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  AllkNN search(&referenceTree, &queryTree, references, queries);
+  for (size_t trial = 0; trial < 2; ++trial)
+  {
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    search.Search(5, neighbors, distances);
+
+    for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], naiveNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(distances[i], naiveDistances[i], 1e-5);
+    }
+
+    CheckCachedBounds(queryTree, distances);
+  }
+}
+
+/**
+ * Searching a tree built by BuildMahalanobisTree() with the Euclidean distance
+ * should give the same results as a naive search with the Mahalanobis
+ * distance.
+ */
+BOOST_AUTO_TEST_CASE(MahalanobisTreeTest)
+{
+  arma::mat dataset;
+  data::Load("test_data_3_1000.csv", dataset);
+
+  arma::mat l = arma::randu<arma::mat>(3, 3);
+  MahalanobisDistance<true> distance(trans(l) * l +
+      0.1 * arma::eye<arma::mat>(3, 3));
+
+  NeighborSearch<NearestNeighborSort, MahalanobisDistance<true> >
+      naive(dataset, true, false, distance);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  typedef BinarySpaceTree<HRectBound<2>,
+      NeighborSearchStat<NearestNeighborSort> > TreeType;
+  arma::mat transformed;
+  std::vector<size_t> oldFromNew;
+  TreeType* tree = BuildMahalanobisTree<TreeType>(distance, dataset,
+      transformed, oldFromNew);
+
+  AllkNN search(tree, transformed);
+  arma::Mat<size_t> treeNeighbors;
+  arma::mat treeDistances;
+  search.Search(5, treeNeighbors, treeDistances);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  Unmap(treeNeighbors, treeDistances, oldFromNew, oldFromNew, neighbors,
+      distances);
+
+  for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], naiveDistances[i], 1e-5);
+  }
+
+  delete tree;
+}
+
+/**
+ * Test that the blocked naive search gives the same results as the dual-tree
+ * search, with query and reference sets that are not multiples of the block
+ * sizes and that are far from the origin (so that the norms are large compared
+ * to the distances between the points).
+ */
+BOOST_AUTO_TEST_CASE(BlockedNaiveVsDualTree)
+{
+  arma::mat referenceData;
+  referenceData.randu(20, 1100);
+  referenceData += 1000.0;
+  arma::mat queryData;
+  queryData.randu(20, 300);
+  queryData += 1000.0;
+
+  AllkNN tree(referenceData, queryData);
+  arma::Mat<size_t> treeNeighbors;
+  arma::mat treeDistances;
+  tree.Search(10, treeNeighbors, treeDistances);
+
+  AllkNN naive(referenceData, queryData, true);
+  naive.Threads() = 4;
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(10, naiveNeighbors, naiveDistances);
+
+  BOOST_REQUIRE_EQUAL(naive.BaseCases(), 1100 * 300);
+  BOOST_REQUIRE_EQUAL(naiveNeighbors.n_rows, 10);
+  BOOST_REQUIRE_EQUAL(naiveNeighbors.n_cols, 300);
+  for (size_t i = 0; i < treeNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(treeNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(treeDistances[i], naiveDistances[i], 1e-5);
+  }
+
+  // The same for a single dataset, where a point is not its own neighbor.
+  AllkNN monoTree(referenceData);
+  monoTree.Search(10, treeNeighbors, treeDistances);
+
+  AllkNN monoNaive(referenceData, true);
+  monoNaive.Search(10, naiveNeighbors, naiveDistances);
+
+  for (size_t i = 0; i < treeNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(treeNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(treeDistances[i], naiveDistances[i], 1e-5);
+  }
+}
+
+/**
+ * Test that the offloaded naive search (which computes the distances in large
+ * tiles) gives the same results as the dual-tree search, for two datasets and
+ * for a single dataset, with sorted lists and with heaps of candidates.
+ */
+BOOST_AUTO_TEST_CASE(OffloadedNaiveVsDualTree)
+{
+  arma::mat referenceData;
+  referenceData.randu(20, 1100);
+  referenceData += 1000.0;
+  arma::mat queryData;
+  queryData.randu(20, 300);
+  queryData += 1000.0;
+
+  AllkNN tree(referenceData, queryData);
+  arma::Mat<size_t> treeNeighbors;
+  arma::mat treeDistances;
+  tree.Search(10, treeNeighbors, treeDistances);
+
+  AllkNN monoTree(referenceData);
+  arma::Mat<size_t> monoTreeNeighbors;
+  arma::mat monoTreeDistances;
+  monoTree.Search(10, monoTreeNeighbors, monoTreeDistances);
+
+  for (size_t heapThreshold = 0; heapThreshold <= 5; heapThreshold += 5)
+  {
+    AllkNN naive(referenceData, queryData, true);
+    naive.Offload() = true;
+    naive.Threads() = 4;
+    naive.HeapThreshold() = heapThreshold;
+    arma::Mat<size_t> naiveNeighbors;
+    arma::mat naiveDistances;
+    naive.Search(10, naiveNeighbors, naiveDistances);
+
+    BOOST_REQUIRE_EQUAL(naive.BaseCases(), 1100 * 300);
+    BOOST_REQUIRE_EQUAL(naiveNeighbors.n_rows, 10);
+    BOOST_REQUIRE_EQUAL(naiveNeighbors.n_cols, 300);
+    for (size_t i = 0; i < treeNeighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(treeNeighbors[i], naiveNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(treeDistances[i], naiveDistances[i], 1e-5);
+    }
+
+    AllkNN monoNaive(referenceData, true);
+    monoNaive.Offload() = true;
+    monoNaive.HeapThreshold() = heapThreshold;
+    monoNaive.Search(10, naiveNeighbors, naiveDistances);
+
+    for (size_t i = 0; i < monoTreeNeighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(monoTreeNeighbors[i], naiveNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(monoTreeDistances[i], naiveDistances[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Test that keeping the candidates in heaps gives the same results as keeping
+ * them in sorted lists, for dual-tree, single-tree, and naive search.
+ */
+BOOST_AUTO_TEST_CASE(HeapCandidatesTest)
+{
+  arma::mat dataset;
+  dataset.randu(4, 1500);
+
+  for (size_t mode = 0; mode < 3; ++mode)
+  {
+    AllkNN sorted(dataset, (mode == 2), (mode == 1));
+    sorted.HeapThreshold() = 0;
+    arma::Mat<size_t> sortedNeighbors;
+    arma::mat sortedDistances;
+    sorted.Search(100, sortedNeighbors, sortedDistances);
+
+    AllkNN heap(dataset, (mode == 2), (mode == 1));
+    heap.HeapThreshold() = 50;
+    arma::Mat<size_t> heapNeighbors;
+    arma::mat heapDistances;
+    heap.Search(100, heapNeighbors, heapDistances);
+
+    for (size_t i = 0; i < sortedNeighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(sortedNeighbors[i], heapNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(sortedDistances[i], heapDistances[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Test that the symmetric monochromatic dual-tree search gives the same results
+ * as naive search and computes fewer distances than the usual dual-tree search,
+ * with sorted lists and with heaps of candidates.
+ */
+BOOST_AUTO_TEST_CASE(SymmetricDualTreeTest)
+{
+  arma::mat dataset;
+  dataset.randu(3, 2000);
+
+  for (size_t k = 5; k <= 100; k += 95)
+  {
+    AllkNN naive(dataset, true);
+    arma::Mat<size_t> naiveNeighbors;
+    arma::mat naiveDistances;
+    naive.Search(k, naiveNeighbors, naiveDistances);
+
+    AllkNN dualTree(dataset);
+    arma::Mat<size_t> dualTreeNeighbors;
+    arma::mat dualTreeDistances;
+    dualTree.Search(k, dualTreeNeighbors, dualTreeDistances);
+
+    AllkNN symmetric(dataset);
+    symmetric.Symmetric() = true;
+    arma::Mat<size_t> symmetricNeighbors;
+    arma::mat symmetricDistances;
+    symmetric.Search(k, symmetricNeighbors, symmetricDistances);
+
+    BOOST_REQUIRE_LT(symmetric.BaseCases(), dualTree.BaseCases());
+    for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(naiveNeighbors[i], symmetricNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(naiveDistances[i], symmetricDistances[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Test that kd-trees built with the fixed-dimension bound and metric give the
+ * same results as the default kd-tree, for both single-tree and dual-tree
+ * search.
+ */
+BOOST_AUTO_TEST_CASE(FixedDimensionTreeTest)
+{
+  arma::mat dataset;
+  data::Load("test_data_3_1000.csv", dataset);
+
+  AllkNN allknn(dataset);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  allknn.Search(5, neighbors, distances);
+
+  typedef BinarySpaceTree<FixedHRectBound<3>,
+      NeighborSearchStat<NearestNeighborSort> > FixedTreeType;
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    NeighborSearch<NearestNeighborSort, FixedLMetric<3>, FixedTreeType>
+        fixedSearch(dataset, false, (mode == 1));
+    arma::Mat<size_t> fixedNeighbors;
+    arma::mat fixedDistances;
+    fixedSearch.Search(5, fixedNeighbors, fixedDistances);
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(fixedNeighbors[i], neighbors[i]);
+      BOOST_REQUIRE_CLOSE(fixedDistances[i], distances[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Test that the partitioned search gives the same results as naive search, for
+ * several numbers of partitions, and that most queries are only searched in
+ * their own partition.
+ */
+BOOST_AUTO_TEST_CASE(DistributedKNNTest)
+{
+  arma::mat referenceData = arma::randu<arma::mat>(3, 2000);
+  arma::mat queryData = arma::randu<arma::mat>(3, 500);
+
+  AllkNN naive(referenceData, queryData, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  for (size_t partitions = 1; partitions <= 8; partitions *= 2)
+  {
+    DistributedKNN knn(referenceData, partitions, 500);
+    knn.BlockSize() = 128;
+
+    BOOST_REQUIRE_EQUAL(knn.NumPartitions(), partitions);
+    size_t total = 0;
+    for (size_t p = 0; p < partitions; ++p)
+      total += knn.PartitionSize(p);
+    BOOST_REQUIRE_EQUAL(total, referenceData.n_cols);
+
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    knn.Search(queryData, 5, neighbors, distances);
+
+    for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors[i], naiveNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(distances[i], naiveDistances[i], 1e-5);
+    }
+
+    BOOST_REQUIRE_LT(knn.ExtraSearches(),
+        queryData.n_cols * (partitions - 1) / 2 + 1);
+  }
+}
+
+/**
+ * Make sure that building the trees on the given matrices in place gives the
+ * same results as building them on copies, and that the permutations given
+ * back describe how the matrices were rearranged.
+ */
+BOOST_AUTO_TEST_CASE(InPlaceTreeBuildingTest)
+{
+  arma::mat reference(3, 1000);
+  reference.randu();
+  arma::mat query(3, 200);
+  query.randu();
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  AllkNN copying(reference, query);
+  copying.Search(5, neighbors, distances);
+
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    const bool singleMode = (mode == 1);
+    arma::mat inPlaceReference(reference);
+    arma::mat inPlaceQuery(query);
+    std::vector<size_t> oldFromNewReferences;
+    std::vector<size_t> oldFromNewQueries;
+    AllkNN inPlace(inPlaceReference, inPlaceQuery, oldFromNewReferences,
+        oldFromNewQueries, singleMode);
+
+    BOOST_REQUIRE_EQUAL(oldFromNewReferences.size(), reference.n_cols);
+    BOOST_REQUIRE_EQUAL(oldFromNewQueries.size(), query.n_cols);
+    for (size_t i = 0; i < reference.n_cols; ++i)
+      for (size_t d = 0; d < reference.n_rows; ++d)
+        BOOST_REQUIRE_EQUAL(inPlaceReference(d, i),
+            reference(d, oldFromNewReferences[i]));
+    for (size_t i = 0; i < query.n_cols; ++i)
+      for (size_t d = 0; d < query.n_rows; ++d)
+        BOOST_REQUIRE_EQUAL(inPlaceQuery(d, i), query(d, oldFromNewQueries[i]));
+
+    arma::Mat<size_t> inPlaceNeighbors;
+    arma::mat inPlaceDistances;
+    inPlace.Search(5, inPlaceNeighbors, inPlaceDistances);
+
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(inPlaceNeighbors[i], neighbors[i]);
+      BOOST_REQUIRE_CLOSE(inPlaceDistances[i], distances[i], 1e-5);
+    }
+  }
+
+  // Now with only one dataset.
+  AllkNN copyingMono(reference);
+  copyingMono.Search(5, neighbors, distances);
+
+  arma::mat inPlaceReference(reference);
+  std::vector<size_t> oldFromNewReferences;
+  AllkNN inPlaceMono(inPlaceReference, oldFromNewReferences);
+
+  BOOST_REQUIRE_EQUAL(oldFromNewReferences.size(), reference.n_cols);
+  for (size_t i = 0; i < reference.n_cols; ++i)
+    for (size_t d = 0; d < reference.n_rows; ++d)
+      BOOST_REQUIRE_EQUAL(inPlaceReference(d, i),
+          reference(d, oldFromNewReferences[i]));
+
+  arma::Mat<size_t> inPlaceNeighbors;
+  arma::mat inPlaceDistances;
+  inPlaceMono.Search(5, inPlaceNeighbors, inPlaceDistances);
+
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(inPlaceNeighbors[i], neighbors[i]);
+    BOOST_REQUIRE_CLOSE(inPlaceDistances[i], distances[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure that anytime single-tree search gives exact results when its
+ * budget is large enough, and that with a small budget, the results it says
+ * are exact match the naive results.
+ */
+BOOST_AUTO_TEST_CASE(AnytimeSingleTreeTest)
+{
+  arma::mat dataset(3, 1000);
+  dataset.randu();
+
+  AllkNN naive(dataset, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+  BOOST_REQUIRE(naive.Exact());
+
+  AllkNN anytime(dataset, false, true);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+
+  // A budget which is never reached.
+  anytime.MaxBaseCases() = 1000000;
+  anytime.TimeLimit() = 1000.0;
+  anytime.Search(5, neighbors, distances);
+
+  BOOST_REQUIRE(anytime.Exact());
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], naiveDistances[i], 1e-5);
+  }
+
+  // A budget of one base case stops every traversal after the first leaf.
+  anytime.MaxBaseCases() = 1;
+  anytime.TimeLimit() = 0.0;
+  anytime.Search(5, neighbors, distances);
+
+  BOOST_REQUIRE(!anytime.Exact());
+  for (size_t i = 0; i < neighbors.n_cols; ++i)
+  {
+    if (!anytime.Exact(i))
+      continue;
+
+    for (size_t j = 0; j < neighbors.n_rows; ++j)
+    {
+      BOOST_REQUIRE_EQUAL(neighbors(j, i), naiveNeighbors(j, i));
+      BOOST_REQUIRE_CLOSE(distances(j, i), naiveDistances(j, i), 1e-5);
+    }
+  }
+}
+
+/**
+ * With many dimensions, base cases are abandoned once they are past the k'th
+ * candidate; make sure that the dual-tree and single-tree searches still give
+ * the same results as the naive search.
+ */
+BOOST_AUTO_TEST_CASE(EarlyAbandonHighDimensionalTest)
+{
+  arma::mat referenceData;
+  referenceData.randu(100, 1000);
+  arma::mat queryData;
+  queryData.randu(100, 200);
+
+  AllkNN naive(referenceData, queryData, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  for (size_t singleMode = 0; singleMode < 2; ++singleMode)
+  {
+    AllkNN tree(referenceData, queryData, false, (singleMode == 1));
+    arma::Mat<size_t> treeNeighbors;
+    arma::mat treeDistances;
+    tree.Search(5, treeNeighbors, treeDistances);
+
+    for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(treeNeighbors[i], naiveNeighbors[i]);
+      BOOST_REQUIRE_CLOSE(treeDistances[i], naiveDistances[i], 1e-5);
+    }
+  }
+
+  // The monochromatic search uses symmetric base cases.
+  AllkNN monoNaive(referenceData, true);
+  monoNaive.Search(5, naiveNeighbors, naiveDistances);
+
+  AllkNN monoTree(referenceData);
+  arma::Mat<size_t> monoNeighbors;
+  arma::mat monoDistances;
+  monoTree.Search(5, monoNeighbors, monoDistances);
+
+  for (size_t i = 0; i < naiveNeighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(monoNeighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(monoDistances[i], naiveDistances[i], 1e-5);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
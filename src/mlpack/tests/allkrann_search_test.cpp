@@ -458,6 +458,114 @@ BOOST_AUTO_TEST_CASE(DualCoverTreeTest)
   BOOST_REQUIRE_LT(numQueriesFail, maxNumQueriesFail);
 }
 
+// Test that the guarantee still holds when the dual-tree search is split
+// between several threads.
+BOOST_AUTO_TEST_CASE(ParallelDualTreeSearch)
+{
+  arma::mat refData;
+  arma::mat queryData;
+
+  data::Load("rann_test_r_3_900.csv", refData, true);
+  data::Load("rann_test_q_3_100.csv", queryData, true);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+
+  RASearch<> tsdRann(refData, queryData, false, false);
+  tsdRann.Threads() = 4;
+
+  arma::Mat<size_t> qrRanks;
+  data::Load("rann_test_qr_ranks.csv", qrRanks, true, false); // No transpose.
+
+  size_t numRounds = 1000;
+  arma::Col<size_t> numSuccessRounds(queryData.n_cols);
+  numSuccessRounds.fill(0);
+
+  // 1% of 900 is 9, so the rank is expected to be less than 10.
+  size_t expectedRankErrorUB = 10;
+
+  for (size_t rounds = 0; rounds < numRounds; rounds++)
+  {
+    tsdRann.Search(1, neighbors, distances, 1.0, 0.95, false, false, 5);
+    BOOST_REQUIRE(!tsdRann.DeadlineReached());
+
+    for (size_t i = 0; i < queryData.n_cols; i++)
+      if (qrRanks(i, neighbors(0, i)) < expectedRankErrorUB)
+        numSuccessRounds[i]++;
+
+    neighbors.reset();
+    distances.reset();
+
+    tsdRann.ResetQueryTree();
+  }
+
+  size_t threshold = floor(numRounds *
+      (0.95 - (1.96 * sqrt(0.95 * 0.05 / numRounds))));
+  size_t numQueriesFail = 0;
+  for (size_t i = 0; i < queryData.n_cols; i++)
+    if (numSuccessRounds[i] < threshold)
+      numQueriesFail++;
+
+  Log::Warn << "RANN-TSD (4 threads): RANN guarantee fails on "
+      << numQueriesFail << " queries." << endl;
+
+  size_t maxNumQueriesFail = 6;
+
+  BOOST_REQUIRE_LT(numQueriesFail, maxNumQueriesFail);
+}
+
+// Make sure that a search which runs out of time returns what it has found,
+// and marks the rest of the results as invalid.
+BOOST_AUTO_TEST_CASE(TimeLimitSearch)
+{
+  arma::mat refData;
+  arma::mat queryData;
+
+  data::Load("rann_test_r_3_900.csv", refData, true);
+  data::Load("rann_test_q_3_100.csv", queryData, true);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+
+  // The deadline has passed before the first query point of the naive search
+  // is considered, so nothing should be found.
+  RASearch<> naive(refData, queryData, true);
+  naive.TimeLimit() = 1e-12;
+  naive.Search(1, neighbors, distances, 1.0);
+
+  BOOST_REQUIRE(naive.DeadlineReached());
+  for (size_t i = 0; i < queryData.n_cols; i++)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors(0, i), size_t() - 1);
+    BOOST_REQUIRE_EQUAL(distances(0, i), DBL_MAX);
+  }
+
+  // The dual-tree search may get a little further, but every result must
+  // either be a real neighbor or be marked as invalid.
+  RASearch<> tsdRann(refData, queryData, false, false);
+  tsdRann.TimeLimit() = 1e-12;
+  tsdRann.Search(3, neighbors, distances, 1.0, 0.95, false, false, 5);
+
+  BOOST_REQUIRE_EQUAL(neighbors.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(neighbors.n_cols, queryData.n_cols);
+  for (size_t i = 0; i < neighbors.n_elem; i++)
+  {
+    if (neighbors[i] == size_t() - 1)
+      BOOST_REQUIRE_EQUAL(distances[i], DBL_MAX);
+    else
+      BOOST_REQUIRE_LT(neighbors[i], refData.n_cols);
+  }
+
+  // Without a time limit, everything is found.
+  tsdRann.TimeLimit() = 0.0;
+  tsdRann.ResetQueryTree();
+  tsdRann.Search(3, neighbors, distances, 1.0, 0.95, false, false, 5);
+
+  BOOST_REQUIRE(!tsdRann.DeadlineReached());
+  for (size_t i = 0; i < neighbors.n_elem; i++)
+    BOOST_REQUIRE_LT(neighbors[i], refData.n_cols);
+}
+
 // Test single-tree rank-approximate search with ball trees.
 // This is known to not work right now.
 /*
@@ -61,5 +61,80 @@ BOOST_AUTO_TEST_CASE(GockenbachFunctionTest)
   BOOST_REQUIRE_CLOSE(coords[2], 0.015099932, 1e-3);
 }
 
+/**
+ * The Gockenbach function with the optional batch constraint methods, which
+ * count how often they are called.
+ */
+class BatchGockenbachFunction : public GockenbachFunction
+{
+ public:
+  BatchGockenbachFunction() : batchEvaluations(0), batchGradients(0) { }
+
+  void EvaluateConstraints(const arma::mat& coordinates,
+                           arma::vec& constraints)
+  {
+    ++batchEvaluations;
+    constraints.set_size(NumConstraints());
+    for (size_t i = 0; i < NumConstraints(); ++i)
+      constraints[i] = EvaluateConstraint(i, coordinates);
+  }
+
+  void GradientConstraints(const arma::mat& coordinates,
+                           const arma::vec& weights,
+                           arma::mat& gradient)
+  {
+    ++batchGradients;
+    arma::mat constraintGradient;
+    for (size_t i = 0; i < NumConstraints(); ++i)
+    {
+      GradientConstraint(i, coordinates, constraintGradient);
+      gradient += weights[i] * constraintGradient;
+    }
+  }
+
+  size_t batchEvaluations;
+  size_t batchGradients;
+};
+
+/**
+ * Make sure that the batch constraint methods are used when a function has
+ * them, and that they give the same augmented Lagrangian as the per-constraint
+ * methods.
+ */
+BOOST_AUTO_TEST_CASE(BatchConstraintsTest)
+{
+  BOOST_REQUIRE(HasEvaluateConstraints<BatchGockenbachFunction>::value);
+  BOOST_REQUIRE(HasGradientConstraints<BatchGockenbachFunction>::value);
+  BOOST_REQUIRE(!HasEvaluateConstraints<GockenbachFunction>::value);
+  BOOST_REQUIRE(!HasGradientConstraints<GockenbachFunction>::value);
+
+  GockenbachFunction f;
+  BatchGockenbachFunction batchF;
+
+  const arma::vec lambda("0.5 -2.0");
+  AugLagrangianFunction<GockenbachFunction> aug(f, lambda, 3.0);
+  AugLagrangianFunction<BatchGockenbachFunction> batchAug(batchF, lambda, 3.0);
+
+  const arma::mat coordinates("0.3; -1.2; 0.7");
+
+  BOOST_REQUIRE_CLOSE(batchAug.Evaluate(coordinates),
+      aug.Evaluate(coordinates), 1e-10);
+  BOOST_REQUIRE_EQUAL(batchF.batchEvaluations, 1);
+
+  arma::mat gradient(3, 1), batchGradient(3, 1);
+  aug.Gradient(coordinates, gradient);
+  batchAug.Gradient(coordinates, batchGradient);
+  BOOST_REQUIRE_EQUAL(batchF.batchEvaluations, 2);
+  BOOST_REQUIRE_EQUAL(batchF.batchGradients, 1);
+  for (size_t i = 0; i < 3; ++i)
+    BOOST_REQUIRE_CLOSE(batchGradient[i], gradient[i], 1e-10);
+
+  arma::mat combinedGradient;
+  BOOST_REQUIRE_CLOSE(batchAug.EvaluateWithGradient(coordinates,
+      combinedGradient), aug.Evaluate(coordinates), 1e-10);
+  for (size_t i = 0; i < 3; ++i)
+    BOOST_REQUIRE_CLOSE(combinedGradient[i], gradient[i], 1e-10);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
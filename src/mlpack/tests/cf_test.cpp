@@ -7,7 +7,9 @@
 
 #include <mlpack/core.hpp>
 #include <mlpack/methods/cf/cf.hpp>
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -175,4 +177,198 @@ BOOST_AUTO_TEST_CASE(RecommendationAccuracyTest)
   BOOST_REQUIRE_LT(failures, 100);
 }
 
+/**
+ * Make sure the recommendations, which are computed without the rating matrix,
+ * are the same as those found directly from the rating matrix W * H.
+ */
+BOOST_AUTO_TEST_CASE(RecommendationsWithoutRatingMatrixTest)
+{
+  arma::mat dataset;
+  data::Load("GroupLens100k.csv", dataset);
+
+  CF<> c(dataset);
+
+  arma::Col<size_t> users(20);
+  for (size_t i = 0; i < 20; ++i)
+    users(i) = 7 * i;
+  const size_t numRecs = 10;
+  arma::Mat<size_t> recommendations;
+  c.GetRecommendations(numRecs, recommendations, users);
+
+  // Now find the neighborhoods and the average ratings directly.
+  const arma::mat rating = c.Rating();
+  arma::mat query(rating.n_rows, users.n_elem);
+  for (size_t i = 0; i < users.n_elem; ++i)
+    query.col(i) = rating.col(users(i));
+
+  arma::Mat<size_t> neighborhood;
+  arma::mat distances;
+  neighbor::AllkNN a(rating, query);
+  a.Search(c.NumUsersForSimilarity(), neighborhood, distances);
+
+  for (size_t i = 0; i < users.n_elem; ++i)
+  {
+    arma::vec averages = arma::zeros<arma::vec>(rating.n_rows);
+    for (size_t j = 0; j < neighborhood.n_rows; ++j)
+      averages += rating.col(neighborhood(j, i));
+    averages /= neighborhood.n_rows;
+
+    // Sort the unrated items by their average rating.
+    std::vector<std::pair<double, size_t> > items;
+    for (size_t j = 0; j < averages.n_elem; ++j)
+      if (c.CleanedData()(j, users(i)) == 0.0)
+        items.push_back(std::make_pair(averages[j], j));
+    std::sort(items.rbegin(), items.rend());
+
+    // Compare the ratings of the items, in case of ties.
+    for (size_t j = 0; j < numRecs; ++j)
+      BOOST_REQUIRE_CLOSE(averages[recommendations(j, i)], items[j].first,
+          1e-5);
+  }
+}
+
+/**
+ * Make sure that the recommendations found with FastMKS are as good as those
+ * found by scoring every item.
+ */
+BOOST_AUTO_TEST_CASE(FastMKSRecommendationsTest)
+{
+  arma::mat dataset;
+  data::Load("GroupLens100k.csv", dataset);
+
+  CF<> c(dataset);
+
+  arma::Col<size_t> users(30);
+  for (size_t i = 0; i < 30; ++i)
+    users(i) = 5 * i;
+  const size_t numRecs = 8;
+  arma::Mat<size_t> recommendations;
+  c.GetRecommendations(numRecs, recommendations, users);
+
+  arma::Mat<size_t> mksRecommendations;
+  c.UseFastMKS(true);
+  c.GetRecommendations(numRecs, mksRecommendations, users);
+
+  BOOST_REQUIRE_EQUAL(mksRecommendations.n_rows, numRecs);
+  BOOST_REQUIRE_EQUAL(mksRecommendations.n_cols, users.n_elem);
+
+  // Find the average ratings of each neighborhood directly, and compare the
+  // ratings of the recommended items (in case of ties).
+  const arma::mat rating = c.Rating();
+  arma::mat query(rating.n_rows, users.n_elem);
+  for (size_t i = 0; i < users.n_elem; ++i)
+    query.col(i) = rating.col(users(i));
+
+  arma::Mat<size_t> neighborhood;
+  arma::mat distances;
+  neighbor::AllkNN a(rating, query);
+  a.Search(c.NumUsersForSimilarity(), neighborhood, distances);
+
+  for (size_t i = 0; i < users.n_elem; ++i)
+  {
+    arma::vec averages = arma::zeros<arma::vec>(rating.n_rows);
+    for (size_t j = 0; j < neighborhood.n_rows; ++j)
+      averages += rating.col(neighborhood(j, i));
+    averages /= neighborhood.n_rows;
+
+    for (size_t j = 0; j < numRecs; ++j)
+    {
+      const size_t item = mksRecommendations(j, i);
+      BOOST_REQUIRE_LT(item, rating.n_rows);
+      BOOST_REQUIRE_EQUAL((double) c.CleanedData()(item, users(i)), 0.0);
+      BOOST_REQUIRE_CLOSE(averages[item], averages[recommendations(j, i)],
+          1e-5);
+    }
+  }
+}
+
+/**
+ * Make sure a saved and loaded CF model gives the same recommendations.
+ */
+BOOST_AUTO_TEST_CASE(CFSaveLoadTest)
+{
+  arma::mat dataset;
+  data::Load("GroupLens100k.csv", dataset);
+
+  CF<> c(dataset);
+
+  std::stringstream stream;
+  c.Save(stream);
+  CF<> c2(stream);
+
+  BOOST_REQUIRE_EQUAL(c2.NumUsersForSimilarity(), c.NumUsersForSimilarity());
+  BOOST_REQUIRE_EQUAL(c2.Rank(), c.Rank());
+  BOOST_REQUIRE_EQUAL(c2.CleanedData().n_nonzero, c.CleanedData().n_nonzero);
+
+  arma::Mat<size_t> recommendations, recommendations2;
+  c.GetRecommendations(10, recommendations);
+  c2.GetRecommendations(10, recommendations2);
+
+  BOOST_REQUIRE_EQUAL(recommendations2.n_rows, recommendations.n_rows);
+  BOOST_REQUIRE_EQUAL(recommendations2.n_cols, recommendations.n_cols);
+  for (size_t i = 0; i < recommendations.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(recommendations2[i], recommendations[i]);
+}
+
+/**
+ * Make sure that ratings of a new user can be folded in, and that the folded
+ * in factors fit them.
+ */
+BOOST_AUTO_TEST_CASE(CFFoldInTest)
+{
+  arma::mat dataset;
+  data::Load("GroupLens100k.csv", dataset);
+
+  // Hold out the ratings of the last user.
+  const size_t lastUser = (size_t) arma::max(dataset.row(0));
+  arma::uvec held = arma::find(dataset.row(0) == lastUser);
+  arma::uvec kept = arma::find(dataset.row(0) != lastUser);
+  arma::mat newRatings = dataset.cols(held);
+  arma::mat oldRatings = dataset.cols(kept);
+
+  CF<> c(oldRatings);
+  const size_t oldNonzero = c.CleanedData().n_nonzero;
+  BOOST_REQUIRE_EQUAL(c.CleanedData().n_cols, lastUser);
+
+  c.FoldIn(newRatings, 2);
+
+  BOOST_REQUIRE_EQUAL(c.CleanedData().n_cols, lastUser + 1);
+  BOOST_REQUIRE_EQUAL(c.H().n_cols, lastUser + 1);
+  BOOST_REQUIRE_EQUAL(c.CleanedData().n_nonzero, oldNonzero +
+      newRatings.n_cols);
+
+  // The folded-in factors should explain the ratings much better than zero
+  // factors would.
+  double residual = 0.0, total = 0.0;
+  for (size_t i = 0; i < newRatings.n_cols; ++i)
+  {
+    const size_t item = (size_t) newRatings(1, i);
+    const double estimate = arma::dot(c.W().row(item),
+        c.H().col(lastUser));
+    residual += std::pow(newRatings(2, i) - estimate, 2.0);
+    total += std::pow(newRatings(2, i), 2.0);
+  }
+  BOOST_REQUIRE_LT(residual, 0.5 * total);
+
+  // Recommendations for the new user are not items it has rated.
+  arma::Col<size_t> users(1);
+  users[0] = lastUser;
+  arma::Mat<size_t> recommendations;
+  c.GetRecommendations(10, recommendations, users);
+  for (size_t j = 0; j < 10; ++j)
+    BOOST_REQUIRE_EQUAL((double) c.CleanedData()(recommendations(j, 0),
+        lastUser), 0.0);
+
+  // A rating of 0 removes a rating.
+  arma::mat removal(3, 1);
+  removal(0, 0) = newRatings(0, 0);
+  removal(1, 0) = newRatings(1, 0);
+  removal(2, 0) = 0.0;
+  c.FoldIn(removal);
+  BOOST_REQUIRE_EQUAL(c.CleanedData().n_nonzero, oldNonzero +
+      newRatings.n_cols - 1);
+  BOOST_REQUIRE_EQUAL((double) c.CleanedData()((size_t) newRatings(1, 0),
+      lastUser), 0.0);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
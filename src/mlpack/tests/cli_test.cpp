@@ -5,6 +5,7 @@
  * Test for the CLI input parameter system.
  */
 
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #ifndef _WIN32
@@ -90,6 +91,38 @@ BOOST_AUTO_TEST_CASE(TestPrefixedOutStreamBasic)
       BASH_GREEN "[INFO ] " BASH_CLEAR "");
 }
 
+//! A class which counts the number of times it is converted to a string.
+class CountingToString
+{
+ public:
+  CountingToString() : calls(0) { }
+
+  std::string ToString() const { ++calls; return "converted"; }
+
+  mutable size_t calls;
+};
+
+/**
+ * Make sure a muted stream prints nothing and does not bother converting what
+ * it is given to a string.
+ */
+BOOST_AUTO_TEST_CASE(TestMutedPrefixedOutStream)
+{
+  std::stringstream ss;
+  PrefixedOutStream pss(ss, BASH_GREEN "[INFO ] " BASH_CLEAR, true);
+  CountingToString c;
+
+  pss << "This is not shown: " << c << ", " << 3.5 << std::endl;
+  BOOST_REQUIRE_EQUAL(ss.str(), "");
+  BOOST_REQUIRE_EQUAL(c.calls, 0);
+
+  pss.ignoreInput = false;
+  pss << "This is shown: " << c << std::endl;
+  BOOST_REQUIRE_EQUAL(ss.str(),
+      BASH_GREEN "[INFO ] " BASH_CLEAR "This is shown: converted\n");
+  BOOST_REQUIRE_EQUAL(c.calls, 1);
+}
+
 /**
  * Tests that the various PARAM_* macros work properly.
  */
@@ -269,4 +302,183 @@ BOOST_AUTO_TEST_CASE(MultiRunTimerTest)
   BOOST_REQUIRE_GE(Timer::Get("test_timer").tv_usec, 40000);
 }
 
+/**
+ * A timer started inside another timer should be its child, and ScopedTimer
+ * should stop its timer at the end of the scope.
+ */
+BOOST_AUTO_TEST_CASE(NestedScopedTimerTest)
+{
+  {
+    ScopedTimer outer("outer_test_timer");
+    {
+      ScopedTimer inner("inner_test_timer");
+
+      #ifdef _WIN32
+      Sleep(10);
+      #else
+      usleep(10000);
+      #endif
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(Timer::Parent("inner_test_timer"), "outer_test_timer");
+  BOOST_REQUIRE_NE(Timer::Parent("outer_test_timer"), "inner_test_timer");
+
+  const uint64_t inner = Timer::GetNanoseconds("inner_test_timer");
+  BOOST_REQUIRE_GE(inner, (uint64_t) 10000000);
+  BOOST_REQUIRE_GE(Timer::GetNanoseconds("outer_test_timer"), inner);
+
+  // The timers are stopped, so they shouldn't change any more.
+  BOOST_REQUIRE_EQUAL(Timer::GetNanoseconds("inner_test_timer"), inner);
+}
+
+/**
+ * Each thread should be able to use the same timer at once, and the time of
+ * every thread should be counted.
+ */
+BOOST_AUTO_TEST_CASE(ParallelTimerTest)
+{
+  size_t runs = 0;
+
+  #pragma omp parallel num_threads(4) reduction(+:runs)
+  {
+    Timer::Start("parallel_test_timer");
+
+    #ifdef _WIN32
+    Sleep(10);
+    #else
+    usleep(10000);
+    #endif
+
+    Timer::Stop("parallel_test_timer");
+    ++runs;
+  }
+
+  BOOST_REQUIRE_GE(Timer::GetNanoseconds("parallel_test_timer"),
+      (uint64_t) runs * 10000000);
+  // The value is the time of every thread added up.
+  BOOST_REQUIRE_EQUAL(Timer::GetThreads("parallel_test_timer"), runs);
+}
+
+/**
+ * With memory tracking enabled, the peak memory of a timer should include the
+ * memory allocated while it ran.  Memory is only tracked on Linux.
+ */
+BOOST_AUTO_TEST_CASE(MemoryTrackingTimerTest)
+{
+#ifdef __linux__
+  Timer::EnableMemoryTracking();
+
+  const size_t before = Timer::ResidentMemory();
+  BOOST_REQUIRE_GT(before, 0);
+
+  // Fill the matrix so its 128MB are resident, and stop the timer while it is
+  // still allocated.
+  Timer::Start("memory_test_timer");
+  arma::mat m(4096, 4096);
+  m.fill(1.0);
+  Timer::Stop("memory_test_timer");
+  m.reset();
+
+  Timer::EnableMemoryTracking(false);
+
+  const size_t peak = Timer::GetPeakMemory("memory_test_timer");
+  BOOST_REQUIRE_GE(peak, before + 100 * 1024 * 1024);
+  BOOST_REQUIRE_GE(Timer::PeakResidentMemory(), peak);
+#endif
+}
+
+/**
+ * With hardware counters enabled, a timer around a loop should count its
+ * instructions.  The counters may not be available (in a container, or if
+ * perf_event_paranoid forbids them), in which case none are returned.
+ */
+BOOST_AUTO_TEST_CASE(PerfCountersTimerTest)
+{
+#ifdef MLPACK_HAS_PERF_EVENT
+  Timer::EnableCounters();
+
+  Timer::Start("counters_test_timer");
+  arma::vec v(100000);
+  v.fill(1.0);
+  const double sum = arma::accu(v);
+  Timer::Stop("counters_test_timer");
+
+  Timer::EnableCounters(false);
+
+  BOOST_REQUIRE_CLOSE(sum, 100000.0, 1e-5);
+  std::map<std::string, uint64_t> counters =
+      Timer::GetCounters("counters_test_timer");
+  if (counters.count("instructions"))
+    BOOST_REQUIRE_GT(counters["instructions"], 100000);
+#endif
+}
+
+/**
+ * Metrics should start at 0 and accumulate, and they should be written to the
+ * metrics file with the timers.
+ */
+BOOST_AUTO_TEST_CASE(MetricsFileTest)
+{
+  Metric::Set("test_metric", 2.0);
+  Metric::Add("test_metric", 3.0);
+  Metric::Add("added_test_metric", 1.5);
+
+  BOOST_REQUIRE_CLOSE(Metric::Get("test_metric"), 5.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(Metric::Get("added_test_metric"), 1.5, 1e-5);
+  BOOST_REQUIRE_SMALL(Metric::Get("unset_test_metric"), 1e-5);
+
+  Timer::Start("metrics_test_timer");
+  Timer::Stop("metrics_test_timer");
+
+  CLI::WriteMetrics("metrics_test.json");
+
+  std::ifstream file("metrics_test.json");
+  BOOST_REQUIRE(file.is_open());
+  std::stringstream contents;
+  contents << file.rdbuf();
+  file.close();
+  remove("metrics_test.json");
+
+  BOOST_REQUIRE_NE(contents.str().find("\"test_metric\": 5"),
+      std::string::npos);
+  BOOST_REQUIRE_NE(contents.str().find("\"added_test_metric\": 1.5"),
+      std::string::npos);
+  BOOST_REQUIRE_NE(contents.str().find("\"metrics_test_timer\": {"),
+      std::string::npos);
+}
+
+/**
+ * Make sure that ParseRequest() overrides the options given in a request, and
+ * restores them before the next one.
+ */
+BOOST_AUTO_TEST_CASE(ParseRequestTest)
+{
+  PARAM_STRING("request_string", "request string description", "", "default");
+  PARAM_INT("request_int", "request int description", "", 3);
+  PARAM_FLAG("request_flag", "request flag description", "");
+
+  BOOST_REQUIRE_EQUAL(CLI::ParseRequest("--request_string \"a b\" "
+      "--request_flag"), "");
+  BOOST_REQUIRE_EQUAL(CLI::GetParam<std::string>("request_string"), "a b");
+  BOOST_REQUIRE_EQUAL(CLI::GetParam<int>("request_int"), 3);
+  BOOST_REQUIRE_EQUAL(CLI::HasParam("request_flag"), true);
+
+  BOOST_REQUIRE_EQUAL(CLI::ParseRequest("--request_int=5"), "");
+  BOOST_REQUIRE_EQUAL(CLI::GetParam<std::string>("request_string"),
+      "default");
+  BOOST_REQUIRE_EQUAL(CLI::GetParam<int>("request_int"), 5);
+  BOOST_REQUIRE_EQUAL(CLI::HasParam("request_flag"), false);
+
+  // Errors are returned, and the options keep their earlier values.
+  BOOST_REQUIRE_NE(CLI::ParseRequest("--request_int=five"), "");
+  BOOST_REQUIRE_NE(CLI::ParseRequest("--request_nonexistent 1"), "");
+  BOOST_REQUIRE_NE(CLI::ParseRequest("--request_string \"a"), "");
+  BOOST_REQUIRE_EQUAL(CLI::GetParam<int>("request_int"), 3);
+
+  BOOST_REQUIRE_EQUAL(CLI::ParseRequest(""), "");
+  BOOST_REQUIRE_EQUAL(CLI::GetParam<std::string>("request_string"),
+      "default");
+}
+
 BOOST_AUTO_TEST_SUITE_END();
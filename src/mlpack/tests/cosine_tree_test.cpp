@@ -177,4 +177,58 @@ BOOST_AUTO_TEST_CASE(CosineTreeModifiedGramSchmidt)
   }
 }
 
+/**
+ * The Monte Carlo error estimate from the basis vectors in the queue should be
+ * the same as the estimate from the matrix of those basis vectors built by
+ * QueueBasis(), when the same samples are drawn.
+ */
+BOOST_AUTO_TEST_CASE(CosineTreeQueueBasisMonteCarloError)
+{
+  arma::mat data = arma::randu(30, 2000);
+
+  // An orthonormal basis for the queue, and two additional vectors.
+  arma::mat q, r;
+  arma::qr_econ(q, r, arma::randu<arma::mat>(30, 12));
+  arma::vec add1 = q.col(10);
+  arma::vec add2 = q.col(11);
+
+  CosineNodeQueue basisQueue;
+  CosineTree dummyTree(data, 1, 0.1);
+  for (size_t i = 0; i < 10; i++)
+  {
+    CosineTree* basisNode = new CosineTree(data);
+    arma::vec basisVector = q.col(i);
+    basisNode->BasisVector(basisVector);
+    basisNode->L2Error(arma::randu());
+    basisQueue.push(basisNode);
+  }
+
+  // The basis matrix holds every vector.
+  arma::mat queueBasis;
+  dummyTree.QueueBasis(basisQueue, queueBasis, &add1, &add2);
+  BOOST_REQUIRE_EQUAL(queueBasis.n_rows, 30);
+  BOOST_REQUIRE_EQUAL(queueBasis.n_cols, 12);
+  BOOST_REQUIRE_CLOSE(arma::accu(arma::abs(trans(queueBasis) * q)),
+      12.0, 1e-5);
+
+  // The centroid of the large root node is the mean of the columns.
+  CosineTree root(data);
+  const arma::vec mean = arma::mean(data, 1);
+  for (size_t i = 0; i < mean.n_elem; i++)
+    BOOST_REQUIRE_CLOSE(root.Centroid()[i], mean[i], 1e-5);
+
+  math::RandomSeed(20);
+  const double queueError = dummyTree.MonteCarloError(&root, basisQueue, &add1,
+      &add2);
+  math::RandomSeed(20);
+  const double matrixError = dummyTree.MonteCarloError(&root, queueBasis);
+  BOOST_REQUIRE_CLOSE(queueError, matrixError, 1e-5);
+
+  while (!basisQueue.empty())
+  {
+    delete basisQueue.top();
+    basisQueue.pop();
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
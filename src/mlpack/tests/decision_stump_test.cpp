@@ -175,6 +175,61 @@ BOOST_AUTO_TEST_CASE(PerfectMultiClassSplit)
   BOOST_CHECK_EQUAL(predictedLabels(0, 3), 3);
 }
 
+/**
+ * This tests that a decision stump trained with histogram bins finds the
+ * perfect split of non-overlapping classes, and ignores a dimension in which
+ * the classes are completely mixed.
+ */
+BOOST_AUTO_TEST_CASE(HistogramPerfectMultiClassSplit)
+{
+  const size_t numClasses = 4;
+  const size_t inpBucketSize = 3;
+  const size_t histogramBins = 8;
+
+  mat trainingData(2, 16);
+  for (size_t i = 0; i < 16; ++i)
+  {
+    trainingData(0, i) = (i % 2);
+    trainingData(1, i) = (double) i - 8.0;
+  }
+
+  // No need to normalize labels here.
+  Mat<size_t> labelsIn;
+  labelsIn << 0 << 0 << 0 << 0 << 1 << 1 << 1 << 1
+           << 2 << 2 << 2 << 2 << 3 << 3 << 3 << 3;
+
+  mat testingData;
+  testingData << 0 << 1 << 0 << 1 << endr
+              << -6.1 << -2.1 << 1.1 << 5.1;
+
+  DecisionStump<> ds(trainingData, labelsIn.row(0), numClasses, inpBucketSize,
+      histogramBins);
+
+  BOOST_REQUIRE_EQUAL(ds.HistogramBins(), histogramBins);
+  BOOST_REQUIRE_EQUAL(ds.SplitAttribute(), 1);
+
+  Row<size_t> predictedLabels(testingData.n_cols);
+  ds.Classify(testingData, predictedLabels);
+
+  BOOST_CHECK_EQUAL(predictedLabels(0, 0), 0);
+  BOOST_CHECK_EQUAL(predictedLabels(0, 1), 1);
+  BOOST_CHECK_EQUAL(predictedLabels(0, 2), 2);
+  BOOST_CHECK_EQUAL(predictedLabels(0, 3), 3);
+
+  // A weighted stump built from this one must reuse its quantization.
+  arma::rowvec weights(16);
+  weights.fill(1.0 / 16);
+  DecisionStump<> weighted(ds, trainingData, weights, labelsIn.row(0));
+
+  BOOST_REQUIRE_EQUAL(weighted.SplitAttribute(), 1);
+  weighted.Classify(testingData, predictedLabels);
+
+  BOOST_CHECK_EQUAL(predictedLabels(0, 0), 0);
+  BOOST_CHECK_EQUAL(predictedLabels(0, 1), 1);
+  BOOST_CHECK_EQUAL(predictedLabels(0, 2), 2);
+  BOOST_CHECK_EQUAL(predictedLabels(0, 3), 3);
+}
+
 /**
  * This test is for the case when reasonably overlapping, multiple classes are
  * provided in the input label set. It tests whether classification takes place
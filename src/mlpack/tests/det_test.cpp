@@ -8,6 +8,7 @@
 #include <mlpack/core.hpp>
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
+#include <stack>
 
 // This trick does not work on Windows.  We will have to comment out the tests
 // that depend on it.
@@ -144,6 +145,60 @@ BOOST_AUTO_TEST_CASE(TestSplitData)
   BOOST_REQUIRE_EQUAL(oTest[3], 2);
   BOOST_REQUIRE_EQUAL(oTest[4], 5);
 }
+
+/**
+ * Grow() keeps the points of each node sorted in every dimension instead of
+ * sorting them at each node.  Make sure that every split it makes is the same
+ * split that sorting the node's points would give.
+ */
+BOOST_AUTO_TEST_CASE(TestGrowPresortedSplits)
+{
+  arma::mat testData;
+  testData.randu(4, 3000);
+
+  arma::Col<size_t> oTest(testData.n_cols);
+  for (size_t i = 0; i < oTest.n_elem; ++i)
+    oTest[i] = i;
+
+  DTree testDTree(testData);
+  testDTree.Grow(testData, oTest, false, 10, 5);
+
+  // The permutation must still be a permutation.
+  arma::Col<size_t> sortedO = arma::sort(oTest);
+  for (size_t i = 0; i < sortedO.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(sortedO[i], i);
+
+  std::stack<DTree*> stack;
+  stack.push(&testDTree);
+  size_t internalNodes = 0;
+  while (!stack.empty())
+  {
+    DTree* node = stack.top();
+    stack.pop();
+
+    if (node->Left() == NULL)
+      continue;
+
+    size_t dim;
+    double splitValue, leftError, rightError;
+    BOOST_REQUIRE(node->FindSplit(testData, dim, splitValue, leftError,
+        rightError, 5));
+    BOOST_REQUIRE_EQUAL(dim, node->SplitDim());
+    BOOST_REQUIRE_EQUAL(splitValue, node->SplitValue());
+
+    // Every point must be on the correct side of the split.
+    for (size_t i = node->Left()->Start(); i < node->Left()->End(); ++i)
+      BOOST_REQUIRE_LE(testData(dim, i), splitValue);
+    for (size_t i = node->Right()->Start(); i < node->Right()->End(); ++i)
+      BOOST_REQUIRE_GT(testData(dim, i), splitValue);
+
+    ++internalNodes;
+    stack.push(node->Left());
+    stack.push(node->Right());
+  }
+
+  BOOST_REQUIRE_GT(internalNodes, 10);
+}
 #endif
 
 // Tests for the public functions.
@@ -277,6 +332,46 @@ BOOST_AUTO_TEST_CASE(TestComputeValue)
   BOOST_REQUIRE_CLOSE(0.0, testDTree.ComputeValue(q4), 1e-10);
 }
 
+/**
+ * Make sure that batch density estimation gives exactly the same results as
+ * estimating the density of each point separately, both before and after
+ * pruning, and for points outside the range of the tree.
+ */
+BOOST_AUTO_TEST_CASE(TestComputeValues)
+{
+  arma::mat testData;
+  testData.randu(3, 2000);
+
+  arma::Col<size_t> oTest(testData.n_cols);
+  for (size_t i = 0; i < oTest.n_elem; ++i)
+    oTest[i] = i;
+
+  DTree testDTree(testData);
+  double alpha = testDTree.Grow(testData, oTest, false, 10, 5);
+
+  // Some of the queries are outside of the range of the tree.  There are more
+  // queries than fit in one block.
+  arma::mat queries;
+  queries.randu(3, 10000);
+  queries = 1.2 * queries - 0.1;
+
+  for (size_t trial = 0; trial < 2; ++trial)
+  {
+    arma::vec values;
+    testDTree.ComputeValues(queries, values);
+
+    BOOST_REQUIRE_EQUAL(values.n_elem, queries.n_cols);
+    for (size_t i = 0; i < queries.n_cols; ++i)
+    {
+      const arma::vec query = queries.col(i);
+      BOOST_REQUIRE_EQUAL(values[i], testDTree.ComputeValue(query));
+    }
+
+    // Prune the tree and try again.
+    alpha = testDTree.PruneAndUpdate(alpha, testData.n_cols, false);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(TestVariableImportance)
 {
   arma::mat testData(3, 5);
@@ -357,4 +452,98 @@ BOOST_AUTO_TEST_CASE(TestPrintLeafMembership)
 }
 */
 
+/**
+ * Make sure that growing a tree and training with cross-validation in parallel
+ * give exactly the same results as doing so serially.  If mlpack was compiled
+ * without OpenMP, both are serial.
+ */
+BOOST_AUTO_TEST_CASE(ParallelGrowDeterminismTest)
+{
+  arma::mat dataset;
+  dataset.randu(3, 20000);
+
+  arma::mat serialData(dataset);
+  arma::mat parallelData(dataset);
+  arma::Col<size_t> serialOldFromNew(dataset.n_cols);
+  arma::Col<size_t> parallelOldFromNew(dataset.n_cols);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+  {
+    serialOldFromNew[i] = i;
+    parallelOldFromNew[i] = i;
+  }
+
+  DTree serialTree(serialData);
+  DTree parallelTree(parallelData);
+
+  arma::mat cvData = dataset.cols(0, 1999);
+
+#ifdef _OPENMP
+  const int oldThreads = omp_get_max_threads();
+  omp_set_num_threads(1);
+#endif
+
+  const double serialAlpha = serialTree.Grow(serialData, serialOldFromNew,
+      false, 10, 5);
+  DTree* serialOpt = Trainer(cvData, 5, false, 10, 5);
+
+#ifdef _OPENMP
+  omp_set_num_threads(4);
+#endif
+
+  const double parallelAlpha = parallelTree.Grow(parallelData,
+      parallelOldFromNew, false, 10, 5);
+  DTree* parallelOpt = Trainer(cvData, 5, false, 10, 5);
+
+#ifdef _OPENMP
+  omp_set_num_threads(oldThreads);
+#endif
+
+  BOOST_REQUIRE_EQUAL(serialAlpha, parallelAlpha);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(serialOldFromNew[i], parallelOldFromNew[i]);
+
+  // Check that the structure of the trees is the same.
+  std::stack<DTree*> serialStack, parallelStack;
+  serialStack.push(&serialTree);
+  parallelStack.push(&parallelTree);
+  while (!serialStack.empty())
+  {
+    DTree* serialNode = serialStack.top();
+    DTree* parallelNode = parallelStack.top();
+    serialStack.pop();
+    parallelStack.pop();
+
+    BOOST_REQUIRE_EQUAL(serialNode->Start(), parallelNode->Start());
+    BOOST_REQUIRE_EQUAL(serialNode->End(), parallelNode->End());
+    BOOST_REQUIRE_EQUAL(serialNode->SubtreeLeaves(),
+        parallelNode->SubtreeLeaves());
+    BOOST_REQUIRE_EQUAL(serialNode->Left() == NULL,
+        parallelNode->Left() == NULL);
+
+    if (serialNode->Left() != NULL)
+    {
+      BOOST_REQUIRE_EQUAL(serialNode->SplitDim(), parallelNode->SplitDim());
+      BOOST_REQUIRE_EQUAL(serialNode->SplitValue(),
+          parallelNode->SplitValue());
+
+      serialStack.push(serialNode->Left());
+      serialStack.push(serialNode->Right());
+      parallelStack.push(parallelNode->Left());
+      parallelStack.push(parallelNode->Right());
+    }
+  }
+
+  // The optimally pruned trees must also be the same.
+  BOOST_REQUIRE_EQUAL(serialOpt->SubtreeLeaves(), parallelOpt->SubtreeLeaves());
+  for (size_t i = 0; i < cvData.n_cols; ++i)
+  {
+    arma::vec point = cvData.unsafe_col(i);
+    BOOST_REQUIRE_EQUAL(serialOpt->ComputeValue(point),
+        parallelOpt->ComputeValue(point));
+  }
+
+  delete serialOpt;
+  delete parallelOpt;
+}
+
 BOOST_AUTO_TEST_SUITE_END();
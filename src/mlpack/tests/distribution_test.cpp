@@ -290,6 +290,132 @@ BOOST_AUTO_TEST_CASE(GaussianMultipointMultivariateProbabilityTest)
   BOOST_REQUIRE_CLOSE(phis(5), 4.57951032485297e-7, 1e-5);
 }
 
+/**
+ * Make sure the batched LogProbability() agrees with the density computed
+ * directly from the inverse and determinant of the covariance, and that the
+ * cached factorization is updated when the covariance is modified.
+ */
+BOOST_AUTO_TEST_CASE(GaussianLogProbabilityTest)
+{
+  arma::vec mean = "5 6 3 3 2";
+  arma::mat cov = "6 1 1 0 2; 1 7 1 0 1; 1 1 4 1 1; 0 0 1 7 0; 2 1 1 0 6";
+
+  arma::mat points;
+  points.randu(5, 50);
+  points *= 10;
+
+  GaussianDistribution g(mean, cov);
+
+  for (size_t trial = 0; trial < 2; ++trial)
+  {
+    arma::vec logPhis;
+    g.LogProbability(points, logPhis);
+    BOOST_REQUIRE_EQUAL(logPhis.n_elem, (arma::uword) 50);
+
+    for (size_t i = 0; i < points.n_cols; ++i)
+    {
+      const arma::vec diff = points.col(i) - g.Mean();
+      const double expected = -0.5 * (5 * std::log(2 * M_PI) +
+          std::log(arma::det(g.Covariance())) +
+          arma::dot(diff, arma::inv(g.Covariance()) * diff));
+
+      BOOST_REQUIRE_CLOSE(logPhis[i], expected, 1e-5);
+      BOOST_REQUIRE_CLOSE(g.LogProbability(points.col(i)), expected, 1e-5);
+      BOOST_REQUIRE_CLOSE(g.Probability(points.col(i)), std::exp(expected),
+          1e-5);
+    }
+
+    // Now change the covariance in place; the next evaluation must use it.
+    g.Covariance() *= 2.0;
+    g.Covariance().diag() += 1.0;
+  }
+}
+
+/**
+ * Make sure a diagonal covariance gives the product of the one-dimensional
+ * densities, including after it stops being diagonal.
+ */
+BOOST_AUTO_TEST_CASE(GaussianDiagonalCovarianceTest)
+{
+  arma::vec mean = "1 -2 3 0.5";
+  arma::vec variances = "0.5 2 4 1.5";
+
+  arma::mat points;
+  points.randn(4, 30);
+  points *= 3;
+
+  GaussianDistribution g(mean, arma::diagmat(variances));
+
+  arma::vec logPhis;
+  g.LogProbability(points, logPhis);
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    double expected = 0.0;
+    for (size_t j = 0; j < 4; ++j)
+    {
+      const double diff = points(j, i) - mean[j];
+      expected -= 0.5 * (std::log(2 * M_PI * variances[j]) +
+          diff * diff / variances[j]);
+    }
+
+    BOOST_REQUIRE_CLOSE(logPhis[i], expected, 1e-5);
+    BOOST_REQUIRE_CLOSE(g.LogProbability(points.col(i)), expected, 1e-5);
+  }
+
+  // Adding an off-diagonal element must switch back to the full covariance.
+  g.Covariance()(0, 1) = g.Covariance()(1, 0) = 0.3;
+  g.LogProbability(points, logPhis);
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    const arma::vec diff = points.col(i) - g.Mean();
+    const double expected = -0.5 * (4 * std::log(2 * M_PI) +
+        std::log(arma::det(g.Covariance())) +
+        arma::dot(diff, arma::inv(g.Covariance()) * diff));
+    BOOST_REQUIRE_CLOSE(logPhis[i], expected, 1e-5);
+  }
+}
+
+/**
+ * Make sure evaluating a Gaussian with a diagonal covariance does not look at
+ * the d x d covariance at all, so that it costs O(d) per point: once the
+ * covariance has been factored, overwriting it through a reference taken
+ * earlier must not change the results.
+ */
+BOOST_AUTO_TEST_CASE(GaussianDiagonalEvaluationCostTest)
+{
+  const size_t d = 1000;
+  arma::vec mean;
+  mean.randn(d);
+  arma::vec variances;
+  variances.randu(d);
+  variances += 0.5;
+
+  arma::mat points;
+  points.randn(d, 20);
+
+  GaussianDistribution g(mean, arma::diagmat(variances));
+  arma::mat& covariance = g.Covariance();
+  g.FactorCovariance();
+  covariance.fill(std::numeric_limits<double>::quiet_NaN());
+
+  const GaussianDistribution& constG = g;
+  arma::vec logPhis;
+  constG.LogProbability(points, logPhis);
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    double expected = 0.0;
+    for (size_t j = 0; j < d; ++j)
+    {
+      const double diff = points(j, i) - mean[j];
+      expected -= 0.5 * (std::log(2 * M_PI * variances[j]) +
+          diff * diff / variances[j]);
+    }
+
+    BOOST_REQUIRE_CLOSE(logPhis[i], expected, 1e-5);
+    BOOST_REQUIRE_CLOSE(constG.LogProbability(points.col(i)), expected, 1e-5);
+  }
+}
+
 /**
  * Make sure random observations follow the probability distribution correctly.
  */
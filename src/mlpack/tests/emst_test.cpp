@@ -5,6 +5,7 @@
  */
 #include <mlpack/core.hpp>
 #include <mlpack/methods/emst/dtb.hpp>
+#include <mlpack/methods/emst/single_linkage.hpp>
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
@@ -216,6 +217,35 @@ BOOST_AUTO_TEST_CASE(DualTreeVsNaive)
   }
 }
 
+/**
+ * Make sure that splitting each round over several threads gives the same
+ * results as the single-threaded naive computation.
+ */
+BOOST_AUTO_TEST_CASE(ParallelDualTreeVsNaive)
+{
+  arma::mat inputData;
+  if (!data::Load("test_data_3_1000.csv", inputData))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+
+  DualTreeBoruvka<> dtb(inputData);
+  dtb.Threads() = 4;
+  DualTreeBoruvka<> dtbNaive(inputData, true);
+  dtbNaive.Threads() = 1;
+
+  arma::mat dualResults;
+  arma::mat naiveResults;
+  dtb.ComputeMST(dualResults);
+  dtbNaive.ComputeMST(naiveResults);
+
+  BOOST_REQUIRE_EQUAL(dualResults.n_cols, naiveResults.n_cols);
+  for (size_t i = 0; i < dualResults.n_cols; i++)
+  {
+    BOOST_REQUIRE_EQUAL(dualResults(0, i), naiveResults(0, i));
+    BOOST_REQUIRE_EQUAL(dualResults(1, i), naiveResults(1, i));
+    BOOST_REQUIRE_CLOSE(dualResults(2, i), naiveResults(2, i), 1e-5);
+  }
+}
+
 /**
  * Make sure the cover tree works fine.
  */
@@ -277,4 +307,59 @@ BOOST_AUTO_TEST_CASE(BallTreeTest)
 
 }
 
+/**
+ * Check the single-linkage dendrogram and flat clusterings on a small,
+ * one-dimensional dataset.
+ */
+BOOST_AUTO_TEST_CASE(SingleLinkageTest)
+{
+  arma::mat dataset("0.0 1.0 3.0 10.0 10.5 20.0");
+
+  DualTreeBoruvka<> dtb(dataset, true);
+  arma::mat mst;
+  dtb.ComputeMST(mst);
+
+  SingleLinkage linkage(mst);
+
+  // The merges are (3, 4), (0, 1), (2, 7), (6, 8), (5, 9).
+  arma::mat dendrogram;
+  linkage.Dendrogram(dendrogram);
+  BOOST_REQUIRE_EQUAL(dendrogram.n_rows, 4);
+  BOOST_REQUIRE_EQUAL(dendrogram.n_cols, 5);
+
+  const size_t lesser[] = { 3, 0, 2, 6, 5 };
+  const size_t greater[] = { 4, 1, 7, 8, 9 };
+  const double distances[] = { 0.5, 1.0, 2.0, 7.0, 9.5 };
+  const size_t sizes[] = { 2, 2, 3, 5, 6 };
+  for (size_t i = 0; i < 5; ++i)
+  {
+    BOOST_REQUIRE_EQUAL((size_t) dendrogram(0, i), lesser[i]);
+    BOOST_REQUIRE_EQUAL((size_t) dendrogram(1, i), greater[i]);
+    BOOST_REQUIRE_CLOSE(dendrogram(2, i), distances[i], 1e-5);
+    BOOST_REQUIRE_EQUAL((size_t) dendrogram(3, i), sizes[i]);
+  }
+
+  // Cutting into three clusters and cutting at distance 2 agree.
+  const size_t expected[] = { 0, 0, 0, 1, 1, 2 };
+  arma::Col<size_t> assignments;
+  linkage.Cluster(3, assignments);
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, 6);
+  for (size_t i = 0; i < 6; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], expected[i]);
+
+  BOOST_REQUIRE_EQUAL(linkage.ClusterByDistance(2.0, assignments), 3);
+  for (size_t i = 0; i < 6; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], expected[i]);
+
+  // Extreme cuts.
+  BOOST_REQUIRE_EQUAL(linkage.ClusterByDistance(0.1, assignments), 6);
+  for (size_t i = 0; i < 6; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], i);
+
+  BOOST_REQUIRE_EQUAL(linkage.ClusterByDistance(100.0, assignments), 1);
+  linkage.Cluster(1, assignments);
+  for (size_t i = 0; i < 6; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -54,6 +54,39 @@ BOOST_AUTO_TEST_CASE(SingleTreeVsNaive)
   }
 }
 
+/**
+ * Compare parallel single-tree search and naive search.  Each thread uses its
+ * own copy of the reference tree, so this should be exact.
+ */
+BOOST_AUTO_TEST_CASE(ParallelSingleTreeVsNaive)
+{
+  arma::mat data;
+  data.randn(5, 1000);
+  LinearKernel lk;
+
+  FastMKS<LinearKernel> naive(data, lk, false, true);
+
+  arma::Mat<size_t> naiveIndices;
+  arma::mat naiveProducts;
+  naive.Search(10, naiveIndices, naiveProducts);
+
+  FastMKS<LinearKernel> single(data, lk, true);
+  single.Threads() = 4;
+
+  arma::Mat<size_t> singleIndices;
+  arma::mat singleProducts;
+  single.Search(10, singleIndices, singleProducts);
+
+  for (size_t q = 0; q < singleIndices.n_cols; ++q)
+  {
+    for (size_t r = 0; r < singleIndices.n_rows; ++r)
+    {
+      BOOST_REQUIRE_EQUAL(singleIndices(r, q), naiveIndices(r, q));
+      BOOST_REQUIRE_CLOSE(singleProducts(r, q), naiveProducts(r, q), 1e-5);
+    }
+  }
+}
+
 /**
  * Compare dual-tree and naive.
  */
@@ -88,6 +121,83 @@ BOOST_AUTO_TEST_CASE(DualTreeVsNaive)
   }
 }
 
+/**
+ * Compare parallel dual-tree search and naive search, with a separate query
+ * set.  Each thread traverses a disjoint part of the query tree, so this should
+ * be exact.
+ */
+BOOST_AUTO_TEST_CASE(ParallelDualTreeVsNaive)
+{
+  arma::mat referenceData;
+  referenceData.randn(5, 2000);
+  arma::mat queryData;
+  queryData.randn(5, 500);
+
+  FastMKS<LinearKernel> naive(referenceData, queryData, false, true);
+
+  arma::Mat<size_t> naiveIndices;
+  arma::mat naiveProducts;
+  naive.Search(10, naiveIndices, naiveProducts);
+
+  FastMKS<LinearKernel> tree(referenceData, queryData);
+  tree.Threads() = 4;
+
+  arma::Mat<size_t> treeIndices;
+  arma::mat treeProducts;
+  tree.Search(10, treeIndices, treeProducts);
+
+  for (size_t q = 0; q < treeIndices.n_cols; ++q)
+  {
+    for (size_t r = 0; r < treeIndices.n_rows; ++r)
+    {
+      BOOST_REQUIRE_EQUAL(treeIndices(r, q), naiveIndices(r, q));
+      BOOST_REQUIRE_CLOSE(treeProducts(r, q), naiveProducts(r, q), 1e-5);
+    }
+  }
+}
+
+/**
+ * Make sure that approximate single-tree and dual-tree search return kernel
+ * values within a factor of (1 + epsilon) of the true values.
+ */
+BOOST_AUTO_TEST_CASE(ApproximateVsNaive)
+{
+  // With positive data, all the kernel values are positive.
+  arma::mat data;
+  data.randu(8, 2000);
+  LinearKernel lk;
+
+  FastMKS<LinearKernel> naive(data, lk, false, true);
+
+  arma::Mat<size_t> naiveIndices;
+  arma::mat naiveProducts;
+  naive.Search(5, naiveIndices, naiveProducts);
+
+  const double epsilon = 0.1;
+  for (size_t mode = 0; mode < 2; ++mode)
+  {
+    FastMKS<LinearKernel> tree(data, lk, (mode == 0));
+    tree.Epsilon() = epsilon;
+
+    arma::Mat<size_t> treeIndices;
+    arma::mat treeProducts;
+    tree.Search(5, treeIndices, treeProducts);
+
+    for (size_t q = 0; q < treeIndices.n_cols; ++q)
+    {
+      for (size_t r = 0; r < treeIndices.n_rows; ++r)
+      {
+        // The returned value must be the kernel value of the returned point.
+        BOOST_REQUIRE_CLOSE(treeProducts(r, q), arma::dot(data.col(q),
+            data.col(treeIndices(r, q))), 1e-5);
+        BOOST_REQUIRE_LE(treeProducts(r, q), naiveProducts(r, q) * (1 + 1e-8));
+        BOOST_REQUIRE_GE(treeProducts(r, q) * (1 + epsilon),
+            naiveProducts(r, q) * (1 - 1e-8));
+      }
+    }
+  }
+}
+
 /**
  * Compare dual-tree and single-tree on a larger dataset.
  */
@@ -121,4 +231,53 @@ BOOST_AUTO_TEST_CASE(DualTreeVsSingleTree)
   }
 }
 
+/**
+ * Make sure that anytime single-tree search gives exact results when its
+ * budget is large enough, and that with a small budget, the results it says
+ * are exact match the naive results.
+ */
+BOOST_AUTO_TEST_CASE(AnytimeSingleTreeVsNaive)
+{
+  arma::mat data;
+  data.randn(5, 1000);
+  LinearKernel lk;
+
+  FastMKS<LinearKernel> naive(data, lk, false, true);
+  arma::Mat<size_t> naiveIndices;
+  arma::mat naiveProducts;
+  naive.Search(10, naiveIndices, naiveProducts);
+
+  FastMKS<LinearKernel> single(data, lk, true);
+  arma::Mat<size_t> indices;
+  arma::mat products;
+
+  // A budget which is never reached.
+  single.MaxBaseCases() = 1000000;
+  single.Search(10, indices, products);
+
+  BOOST_REQUIRE(single.Exact());
+  for (size_t i = 0; i < indices.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(indices[i], naiveIndices[i]);
+    BOOST_REQUIRE_CLOSE(products[i], naiveProducts[i], 1e-5);
+  }
+
+  // A budget of one base case stops every traversal at the root.
+  single.MaxBaseCases() = 1;
+  single.Search(10, indices, products);
+
+  BOOST_REQUIRE(!single.Exact());
+  for (size_t q = 0; q < indices.n_cols; ++q)
+  {
+    if (!single.Exact(q))
+      continue;
+
+    for (size_t r = 0; r < indices.n_rows; ++r)
+    {
+      BOOST_REQUIRE_EQUAL(indices(r, q), naiveIndices(r, q));
+      BOOST_REQUIRE_CLOSE(products(r, q), naiveProducts(r, q), 1e-5);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -8,6 +8,7 @@
 #include <mlpack/core.hpp>
 
 #include <mlpack/methods/gmm/gmm.hpp>
+#include <mlpack/methods/gmm/mrkd_em_fit.hpp>
 
 #include <mlpack/methods/gmm/no_constraint.hpp>
 #include <mlpack/methods/gmm/positive_definite_constraint.hpp>
@@ -524,6 +525,173 @@ BOOST_AUTO_TEST_CASE(GMMLoadSaveTest)
   }
 }
 
+/**
+ * Make sure that EMFit with DiagonalConstraint gives diagonal covariances which
+ * match the variances of well-separated clusters, and that they survive saving
+ * and loading.
+ */
+BOOST_AUTO_TEST_CASE(GMMDiagonalCovarianceTest)
+{
+  // Two well-separated Gaussians with diagonal covariance.
+  arma::mat data;
+  data.randn(4, 2000);
+  data.row(1) *= 2.0;
+  data.row(3) *= 0.5;
+  data.cols(1000, 1999) += 20.0;
+
+  std::vector<distribution::GaussianDistribution> dists(2,
+      distribution::GaussianDistribution(4));
+  dists[0].Mean() = data.col(0);
+  dists[1].Mean() = data.col(1000);
+  arma::vec weights("0.5 0.5");
+
+  EMFit<kmeans::KMeans<>, DiagonalConstraint> fitter;
+  fitter.Estimate(data, dists, weights, true);
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    const arma::mat& cov = dists[i].Covariance();
+    BOOST_REQUIRE(distribution::GaussianDistribution::IsDiagonal(cov));
+    BOOST_REQUIRE_CLOSE(cov(0, 0), 1.0, 15.0);
+    BOOST_REQUIRE_CLOSE(cov(1, 1), 4.0, 15.0);
+    BOOST_REQUIRE_CLOSE(cov(2, 2), 1.0, 15.0);
+    BOOST_REQUIRE_CLOSE(cov(3, 3), 0.25, 15.0);
+  }
+
+  GMM<> gmm(dists, weights);
+  gmm.Save("test-gmm-diagonal.xml");
+
+  GMM<> gmm2;
+  gmm2.Load("test-gmm-diagonal.xml");
+  remove("test-gmm-diagonal.xml");
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    for (size_t j = 0; j < 4; ++j)
+    {
+      for (size_t k = 0; k < 4; ++k)
+      {
+        if (j == k)
+          BOOST_REQUIRE_CLOSE(gmm2.Component(i).Covariance()(j, k),
+              dists[i].Covariance()(j, k), 1e-3);
+        else
+          BOOST_REQUIRE_SMALL(gmm2.Component(i).Covariance()(j, k), 1e-10);
+      }
+    }
+  }
+}
+
+/**
+ * With a step size of one, an online update on the whole dataset must be one
+ * iteration of EM; with mini-batches, the model must follow the data.
+ */
+BOOST_AUTO_TEST_CASE(GMMUpdateTest)
+{
+  arma::mat data;
+  data.randn(3, 2000);
+  data.cols(1000, 1999) += 8.0;
+
+  std::vector<distribution::GaussianDistribution> dists(2,
+      distribution::GaussianDistribution(3));
+  dists[0].Mean() = data.col(0);
+  dists[1].Mean() = data.col(1000);
+  arma::vec weights("0.5 0.5");
+
+  // One iteration of EMFit.
+  std::vector<distribution::GaussianDistribution> emDists(dists);
+  arma::vec emWeights(weights);
+  EMFit<> emFit(2);
+  emFit.Estimate(data, emDists, emWeights, true);
+
+  GMM<> gmm(dists, weights);
+  gmm.Update(data, 1.0);
+  BOOST_REQUIRE_EQUAL(gmm.Updates(), (size_t) 1);
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(gmm.Weights()[i], emWeights[i], 1e-5);
+    for (size_t j = 0; j < 3; ++j)
+    {
+      BOOST_REQUIRE_SMALL(gmm.Component(i).Mean()[j] - emDists[i].Mean()[j],
+          1e-8);
+      for (size_t k = 0; k < 3; ++k)
+        BOOST_REQUIRE_SMALL(gmm.Component(i).Covariance()(j, k) -
+            emDists[i].Covariance()(j, k), 1e-8);
+    }
+  }
+
+  // Now start from a poor model and stream shuffled mini-batches through it.
+  GMM<> online(dists, weights);
+  online.Component(0).Mean() = "1 1 1";
+  online.Component(1).Mean() = "6 6 6";
+  online.ResetUpdates();
+
+  const arma::uvec order = arma::shuffle(arma::linspace<arma::uvec>(0, 1999,
+      2000));
+  for (size_t epoch = 0; epoch < 5; ++epoch)
+  {
+    for (size_t b = 0; b < 2000; b += 100)
+    {
+      const arma::mat batch = data.cols(order.subvec(b, b + 99));
+      online.Update(batch);
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(online.Updates(), (size_t) 100);
+  for (size_t j = 0; j < 3; ++j)
+  {
+    BOOST_REQUIRE_SMALL(online.Component(0).Mean()[j], 0.2);
+    BOOST_REQUIRE_SMALL(online.Component(1).Mean()[j] - 8.0, 0.2);
+    BOOST_REQUIRE_CLOSE(online.Component(0).Covariance()(j, j), 1.0, 20.0);
+  }
+  BOOST_REQUIRE_CLOSE(online.Weights()[0], 0.5, 10.0);
+}
+
+/**
+ * With DiagonalConstraint, an online update with a step size of one must be one
+ * iteration of EM with the same constraint, and the covariances must stay
+ * diagonal.
+ */
+BOOST_AUTO_TEST_CASE(GMMDiagonalUpdateTest)
+{
+  arma::mat data;
+  data.randn(3, 2000);
+  data.row(1) *= 2.0;
+  data.cols(1000, 1999) += 8.0;
+
+  std::vector<distribution::GaussianDistribution> dists(2,
+      distribution::GaussianDistribution(3));
+  dists[0].Mean() = data.col(0);
+  dists[1].Mean() = data.col(1000);
+  arma::vec weights("0.5 0.5");
+
+  std::vector<distribution::GaussianDistribution> emDists(dists);
+  arma::vec emWeights(weights);
+  EMFit<kmeans::KMeans<>, DiagonalConstraint> emFit(2);
+  emFit.Estimate(data, emDists, emWeights, true);
+
+  GMM<> gmm(dists, weights);
+  gmm.Update(data, 1.0, DiagonalConstraint());
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(gmm.Weights()[i], emWeights[i], 1e-5);
+    for (size_t j = 0; j < 3; ++j)
+    {
+      BOOST_REQUIRE_SMALL(gmm.Component(i).Mean()[j] - emDists[i].Mean()[j],
+          1e-8);
+      for (size_t k = 0; k < 3; ++k)
+      {
+        if (j == k)
+          BOOST_REQUIRE_SMALL(gmm.Component(i).Covariance()(j, k) -
+              emDists[i].Covariance()(j, k), 1e-8);
+        else
+          BOOST_REQUIRE_EQUAL(gmm.Component(i).Covariance()(j, k), 0.0);
+      }
+    }
+  }
+}
+
 BOOST_AUTO_TEST_CASE(NoConstraintTest)
 {
   // Generate random matrices and make sure they end up the same.
@@ -759,4 +927,286 @@ BOOST_AUTO_TEST_CASE(UseExistingModelTest)
 }
 
 
+/**
+ * Make sure the batched GMM::Probability() gives the same results as
+ * evaluating each observation separately.
+ */
+BOOST_AUTO_TEST_CASE(GMMBatchProbabilityTest)
+{
+  GMM<> gmm(2, 2);
+  gmm.Component(0) = distribution::GaussianDistribution("0 0", "1 0; 0 1");
+  gmm.Component(1) = distribution::GaussianDistribution("3 3", "2 1; 1 2");
+  gmm.Weights() = "0.3 0.7";
+
+  arma::mat observations;
+  observations.randn(2, 40);
+  observations *= 3;
+
+  arma::vec probabilities;
+  gmm.Probability(observations, probabilities);
+
+  BOOST_REQUIRE_EQUAL(probabilities.n_elem, observations.n_cols);
+  for (size_t i = 0; i < observations.n_cols; ++i)
+    BOOST_REQUIRE_CLOSE(probabilities[i],
+        gmm.Probability(observations.unsafe_col(i)), 1e-5);
+}
+
+/**
+ * Make sure that the blocked, parallel LogProbability() and Classify() give the
+ * same results as evaluating each observation and component separately, with
+ * any number of threads, and that they write into outputs of the right size
+ * without reallocating them.
+ */
+BOOST_AUTO_TEST_CASE(GMMBlockedEvaluationTest)
+{
+  GMM<> gmm(3, 2);
+  gmm.Component(0) = distribution::GaussianDistribution("0 0", "1 0; 0 1");
+  gmm.Component(1) = distribution::GaussianDistribution("1 3", "3 2; 2 3");
+  gmm.Component(2) = distribution::GaussianDistribution("-2 -2",
+      "2.2 1.4; 1.4 5.1");
+  gmm.Weights() = "0.6 0.25 0.15";
+
+  // Enough observations for several blocks, some far from every component.
+  arma::mat observations;
+  observations.randn(2, 10000);
+  observations *= 4;
+  observations.col(17).fill(1000.0);
+
+  gmm.Threads() = 1;
+  arma::vec serialLogProbabilities;
+  gmm.LogProbability(observations, serialLogProbabilities);
+  arma::Col<size_t> serialLabels;
+  gmm.Classify(observations, serialLabels);
+
+  gmm.Threads() = 4;
+  arma::vec logProbabilities(observations.n_cols);
+  const double* logProbabilitiesMem = logProbabilities.memptr();
+  gmm.LogProbability(observations, logProbabilities);
+  arma::Col<size_t> labels(observations.n_cols);
+  const size_t* labelsMem = labels.memptr();
+  gmm.Classify(observations, labels);
+
+  BOOST_REQUIRE_EQUAL(logProbabilities.memptr(), logProbabilitiesMem);
+  BOOST_REQUIRE_EQUAL(labels.memptr(), labelsMem);
+
+  for (size_t j = 0; j < observations.n_cols; ++j)
+  {
+    BOOST_REQUIRE_EQUAL(serialLogProbabilities[j], logProbabilities[j]);
+    BOOST_REQUIRE_EQUAL(serialLabels[j], labels[j]);
+
+    BOOST_REQUIRE_CLOSE(logProbabilities[j],
+        gmm.LogProbability(observations.unsafe_col(j)), 1e-5);
+
+    size_t best = 0;
+    double bestLog = -std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < 3; ++i)
+    {
+      const double logPhi = std::log(gmm.Weights()[i]) +
+          gmm.Component(i).LogProbability(observations.unsafe_col(j));
+      if (logPhi >= bestLog)
+      {
+        bestLog = logPhi;
+        best = i;
+      }
+    }
+    BOOST_REQUIRE_EQUAL(labels[j], best);
+  }
+}
+
+/**
+ * Make sure that EMFit gives the same model no matter how many threads are
+ * used, both with and without probabilities for each point.
+ */
+BOOST_AUTO_TEST_CASE(ParallelEMFitTest)
+{
+  // Three well-separated Gaussians in three dimensions.
+  arma::mat data;
+  data.randn(3, 900);
+  data.cols(300, 599) += 10.0;
+  data.cols(600, 899) -= 10.0;
+
+  arma::vec probabilities;
+  probabilities.randu(data.n_cols);
+
+  // Start from a fixed model so that the initial clustering doesn't matter.
+  std::vector<distribution::GaussianDistribution> initialDists(3,
+      distribution::GaussianDistribution(3));
+  initialDists[0].Mean() = data.col(0);
+  initialDists[1].Mean() = data.col(300);
+  initialDists[2].Mean() = data.col(600);
+  arma::vec initialWeights(3);
+  initialWeights.fill(1.0 / 3.0);
+
+  for (size_t useProbabilities = 0; useProbabilities < 2; ++useProbabilities)
+  {
+    std::vector<distribution::GaussianDistribution> serialDists(initialDists);
+    arma::vec serialWeights(initialWeights);
+    EMFit<> serialFit(10);
+    serialFit.Threads() = 1;
+
+    std::vector<distribution::GaussianDistribution> parallelDists(
+        initialDists);
+    arma::vec parallelWeights(initialWeights);
+    EMFit<> parallelFit(10);
+    parallelFit.Threads() = 4;
+
+    if (useProbabilities)
+    {
+      serialFit.Estimate(data, probabilities, serialDists, serialWeights,
+          true);
+      parallelFit.Estimate(data, probabilities, parallelDists,
+          parallelWeights, true);
+    }
+    else
+    {
+      serialFit.Estimate(data, serialDists, serialWeights, true);
+      parallelFit.Estimate(data, parallelDists, parallelWeights, true);
+    }
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+      BOOST_REQUIRE_CLOSE(parallelWeights[i], serialWeights[i], 1e-5);
+
+      for (size_t j = 0; j < 3; ++j)
+      {
+        BOOST_REQUIRE_SMALL(parallelDists[i].Mean()[j] -
+            serialDists[i].Mean()[j], 1e-8);
+
+        for (size_t k = 0; k < 3; ++k)
+          BOOST_REQUIRE_SMALL(parallelDists[i].Covariance()(j, k) -
+              serialDists[i].Covariance()(j, k), 1e-8);
+      }
+    }
+  }
+}
+
+/**
+ * Make sure that the mrkd-tree accelerated fitter gives nearly the same model
+ * as EMFit, with and without probabilities, and that it skips work on
+ * well-separated data.
+ */
+BOOST_AUTO_TEST_CASE(MRKDEMFitTest)
+{
+  // Three well-separated Gaussians in three dimensions.
+  arma::mat data;
+  data.randn(3, 3000);
+  data.cols(1000, 1999) += 10.0;
+  data.cols(2000, 2999) -= 10.0;
+
+  arma::vec probabilities;
+  probabilities.randu(data.n_cols);
+
+  std::vector<distribution::GaussianDistribution> initialDists(3,
+      distribution::GaussianDistribution(3));
+  initialDists[0].Mean() = data.col(0);
+  initialDists[1].Mean() = data.col(1000);
+  initialDists[2].Mean() = data.col(2000);
+  arma::vec initialWeights(3);
+  initialWeights.fill(1.0 / 3.0);
+
+  for (size_t useProbabilities = 0; useProbabilities < 2; ++useProbabilities)
+  {
+    std::vector<distribution::GaussianDistribution> emDists(initialDists);
+    arma::vec emWeights(initialWeights);
+    EMFit<> emFit(10);
+
+    std::vector<distribution::GaussianDistribution> treeDists(initialDists);
+    arma::vec treeWeights(initialWeights);
+    MRKDEMFit<> treeFit(10, 1e-10, 1e-6);
+
+    if (useProbabilities)
+    {
+      emFit.Estimate(data, probabilities, emDists, emWeights, true);
+      treeFit.Estimate(data, probabilities, treeDists, treeWeights, true);
+    }
+    else
+    {
+      emFit.Estimate(data, emDists, emWeights, true);
+      treeFit.Estimate(data, treeDists, treeWeights, true);
+    }
+
+    BOOST_REQUIRE_GT(treeFit.Prunes(), (size_t) 0);
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+      BOOST_REQUIRE_CLOSE(treeWeights[i], emWeights[i], 1e-3);
+
+      for (size_t j = 0; j < 3; ++j)
+      {
+        BOOST_REQUIRE_SMALL(treeDists[i].Mean()[j] - emDists[i].Mean()[j],
+            1e-4);
+
+        for (size_t k = 0; k < 3; ++k)
+          BOOST_REQUIRE_SMALL(treeDists[i].Covariance()(j, k) -
+              emDists[i].Covariance()(j, k), 1e-4);
+      }
+    }
+  }
+
+  // The fitter can also be used directly by GMM.
+  GMM<MRKDEMFit<> > gmm(3, 3);
+  gmm.Estimate(data, 3);
+  arma::vec sortedWeights = arma::sort(gmm.Weights());
+  for (size_t i = 0; i < 3; ++i)
+    BOOST_REQUIRE_CLOSE(sortedWeights[i], 1.0 / 3.0, 2.0);
+}
+
+/**
+ * Make sure that running the trials of GMM::Estimate() in parallel gives the
+ * same model as running one trial, when every trial starts from the same model.
+ */
+BOOST_AUTO_TEST_CASE(ParallelGMMTrialsTest)
+{
+  // Three well-separated Gaussians in three dimensions.
+  arma::mat data;
+  data.randn(3, 900);
+  data.cols(300, 599) += 10.0;
+  data.cols(600, 899) -= 10.0;
+
+  arma::vec probabilities;
+  probabilities.randu(data.n_cols);
+
+  GMM<> initialGMM(3, 3);
+  initialGMM.Component(0).Mean() = data.col(0);
+  initialGMM.Component(1).Mean() = data.col(300);
+  initialGMM.Component(2).Mean() = data.col(600);
+  initialGMM.Weights().fill(1.0 / 3.0);
+
+  for (size_t useProbabilities = 0; useProbabilities < 2; ++useProbabilities)
+  {
+    GMM<> serialGMM(initialGMM);
+    GMM<> parallelGMM(initialGMM);
+    parallelGMM.Threads() = 0;
+
+    double serialLikelihood, parallelLikelihood;
+    if (useProbabilities)
+    {
+      serialLikelihood = serialGMM.Estimate(data, probabilities, 1, true);
+      parallelLikelihood = parallelGMM.Estimate(data, probabilities, 4, true);
+    }
+    else
+    {
+      serialLikelihood = serialGMM.Estimate(data, 1, true);
+      parallelLikelihood = parallelGMM.Estimate(data, 4, true);
+    }
+
+    BOOST_REQUIRE_CLOSE(serialLikelihood, parallelLikelihood, 1e-5);
+    for (size_t i = 0; i < 3; ++i)
+    {
+      BOOST_REQUIRE_CLOSE(serialGMM.Weights()[i], parallelGMM.Weights()[i],
+          1e-5);
+
+      for (size_t j = 0; j < 3; ++j)
+      {
+        BOOST_REQUIRE_SMALL(serialGMM.Component(i).Mean()[j] -
+            parallelGMM.Component(i).Mean()[j], 1e-5);
+
+        for (size_t k = 0; k < 3; ++k)
+          BOOST_REQUIRE_SMALL(serialGMM.Component(i).Covariance()(j, k) -
+              parallelGMM.Component(i).Covariance()(j, k), 1e-5);
+      }
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -5,6 +5,7 @@
  */
 #include <mlpack/core.hpp>
 #include <mlpack/methods/hmm/hmm.hpp>
+#include <mlpack/methods/hmm/online_viterbi.hpp>
 #include <mlpack/methods/gmm/gmm.hpp>
 
 #include <boost/test/unit_test.hpp>
@@ -1132,5 +1133,416 @@ BOOST_AUTO_TEST_CASE(DiscreteHMMLoadSaveTest)
   }
 }
 
-BOOST_AUTO_TEST_SUITE_END();
+/**
+ * Make sure the log-likelihood and the state probabilities of a Gaussian HMM
+ * are right even when every emission probability underflows, by comparing with
+ * the sum over all state paths in log space.
+ */
+BOOST_AUTO_TEST_CASE(GaussianHMMUnderflowTest)
+{
+  arma::vec initial("0.6 0.4");
+  arma::mat transition("0.7 0.4; 0.3 0.6");
+  std::vector<GaussianDistribution> emissions(2);
+  emissions[0] = GaussianDistribution(arma::vec("0.0"), arma::mat("0.01"));
+  emissions[1] = GaussianDistribution(arma::vec("1.0"), arma::mat("0.01"));
+  HMM<GaussianDistribution> hmm(initial, transition, emissions);
+
+  // Every observation is far enough away that its probability is zero in
+  // double precision, but its log-probability is not.
+  arma::mat obs("40.0 -40.5 41.0 -39.0");
+  BOOST_REQUIRE_EQUAL(emissions[0].Probability(obs.col(0)), 0.0);
+
+  // Brute force: sum over all 16 state paths.
+  std::vector<double> pathLogProbs;
+  arma::mat expectedStateProb(2, 4);
+  expectedStateProb.zeros();
+  for (size_t path = 0; path < 16; ++path)
+  {
+    double logProb = 0.0;
+    size_t last = 0;
+    for (size_t t = 0; t < 4; ++t)
+    {
+      const size_t state = (path >> t) & 1;
+      logProb += (t == 0) ? std::log(initial[state]) :
+          std::log(transition(state, last));
+      logProb += emissions[state].LogProbability(obs.col(t));
+      last = state;
+    }
+    pathLogProbs.push_back(logProb);
+  }
+
+  const double maxLogProb = *std::max_element(pathLogProbs.begin(),
+      pathLogProbs.end());
+  double sum = 0.0;
+  for (size_t path = 0; path < 16; ++path)
+    sum += std::exp(pathLogProbs[path] - maxLogProb);
+  const double expected = maxLogProb + std::log(sum);
+
+  for (size_t path = 0; path < 16; ++path)
+    for (size_t t = 0; t < 4; ++t)
+      expectedStateProb((path >> t) & 1, t) += std::exp(pathLogProbs[path] -
+          expected);
+
+  BOOST_REQUIRE_CLOSE(hmm.LogLikelihood(obs), expected, 1e-8);
+
+  arma::mat stateProb;
+  BOOST_REQUIRE_CLOSE(hmm.Estimate(obs, stateProb), expected, 1e-8);
+  for (size_t t = 0; t < 4; ++t)
+    for (size_t j = 0; j < 2; ++j)
+      BOOST_REQUIRE_SMALL(stateProb(j, t) - expectedStateProb(j, t), 1e-8);
+
+  // Viterbi must still find a path.
+  arma::Col<size_t> states;
+  BOOST_REQUIRE_SMALL(hmm.Predict(obs, states) - *std::max_element(
+      pathLogProbs.begin(), pathLogProbs.end()), 1e-5);
+}
+
+/**
+ * Make sure that Baum-Welch training gives the same model with one thread and
+ * with several threads, on sequences of different lengths.
+ */
+BOOST_AUTO_TEST_CASE(ParallelBaumWelchTest)
+{
+  HMM<GaussianDistribution> generator(2, GaussianDistribution(2));
+  generator.Transition() = arma::mat("0.8 0.3; 0.2 0.7");
+  generator.Emission()[0].Mean() = "0.0 0.0";
+  generator.Emission()[1].Mean() = "3.0 3.0";
+
+  std::vector<arma::mat> observations(25);
+  for (size_t i = 0; i < observations.size(); ++i)
+  {
+    arma::Col<size_t> states;
+    generator.Generate(20 + 7 * i, observations[i], states);
+  }
+
+  HMM<GaussianDistribution> serial(2, GaussianDistribution(2));
+  serial.Emission()[0].Mean() = "0.5 -0.5";
+  serial.Emission()[1].Mean() = "2.0 2.5";
+  HMM<GaussianDistribution> parallel(serial);
+
+  serial.Threads() = 1;
+  serial.Train(observations);
+  parallel.Threads() = 4;
+  parallel.Train(observations);
+
+  for (size_t i = 0; i < 2; ++i)
+  {
+    for (size_t j = 0; j < 2; ++j)
+    {
+      BOOST_REQUIRE_CLOSE(parallel.Transition()(i, j),
+          serial.Transition()(i, j), 1e-5);
+      BOOST_REQUIRE_CLOSE(parallel.Emission()[i].Mean()[j],
+          serial.Emission()[i].Mean()[j], 1e-5);
+      for (size_t k = 0; k < 2; ++k)
+        BOOST_REQUIRE_CLOSE(parallel.Emission()[i].Covariance()(j, k),
+            serial.Emission()[i].Covariance()(j, k), 1e-5);
+    }
+  }
+}
+
+/**
+ * Make sure that a left-to-right HMM with enough states to use the sparse
+ * transition steps gives the right log-likelihood and a consistent Viterbi
+ * path, and that training keeps impossible transitions impossible.
+ */
+BOOST_AUTO_TEST_CASE(SparseTransitionHMMTest)
+{
+  // Each of 20 states either stays or moves on to the next state.
+  const size_t states = 20;
+  HMM<GaussianDistribution> hmm(states, GaussianDistribution(1));
+  hmm.Transition().zeros();
+  for (size_t i = 0; i < states; ++i)
+  {
+    hmm.Emission()[i].Mean()[0] = (double) i;
+    hmm.Emission()[i].Covariance()(0, 0) = 0.25;
+    if (i + 1 < states)
+    {
+      hmm.Transition()(i, i) = 0.5;
+      hmm.Transition()(i + 1, i) = 0.5;
+    }
+    else
+    {
+      hmm.Transition()(i, i) = 1.0;
+    }
+  }
+  hmm.Initial().zeros();
+  hmm.Initial()[0] = 1.0;
+
+  arma::mat obs;
+  arma::Col<size_t> trueStates;
+  hmm.Generate(400, obs, trueStates);
+
+  // The forward algorithm in log space, with the dense transition matrix.
+  arma::vec logAlpha(states);
+  for (size_t i = 0; i < states; ++i)
+    logAlpha[i] = std::log(hmm.Initial()[i]) +
+        hmm.Emission()[i].LogProbability(obs.col(0));
+  for (size_t t = 1; t < obs.n_cols; ++t)
+  {
+    arma::vec next(states);
+    for (size_t j = 0; j < states; ++j)
+    {
+      const arma::vec terms = logAlpha + arma::log(trans(
+          hmm.Transition().row(j)));
+      const double maxTerm = terms.max();
+      next[j] = (maxTerm == -std::numeric_limits<double>::infinity()) ?
+          maxTerm : maxTerm + std::log(arma::accu(arma::exp(terms - maxTerm)));
+      next[j] += hmm.Emission()[j].LogProbability(obs.col(t));
+    }
+    logAlpha = next;
+  }
+  const double maxAlpha = logAlpha.max();
+  const double expected = maxAlpha + std::log(arma::accu(arma::exp(logAlpha -
+      maxAlpha)));
+
+  BOOST_REQUIRE_CLOSE(hmm.LogLikelihood(obs), expected, 1e-6);
+
+  arma::mat stateProb;
+  hmm.Estimate(obs, stateProb);
+  for (size_t t = 0; t < obs.n_cols; ++t)
+    BOOST_REQUIRE_CLOSE(arma::accu(stateProb.col(t)), 1.0, 1e-6);
+
+  // The Viterbi path must be possible, its log-likelihood must be returned, and
+  // it must be at least as likely as the true path.
+  arma::Col<size_t> predicted;
+  const double viterbi = hmm.Predict(obs, predicted);
+  double predictedLogLik = std::log(hmm.Initial()[predicted[0]]) +
+      hmm.Emission()[predicted[0]].LogProbability(obs.col(0));
+  double trueLogLik = std::log(hmm.Initial()[trueStates[0]]) +
+      hmm.Emission()[trueStates[0]].LogProbability(obs.col(0));
+  for (size_t t = 1; t < obs.n_cols; ++t)
+  {
+    predictedLogLik += std::log(hmm.Transition()(predicted[t],
+        predicted[t - 1])) + hmm.Emission()[predicted[t]].LogProbability(
+        obs.col(t));
+    trueLogLik += std::log(hmm.Transition()(trueStates[t],
+        trueStates[t - 1])) + hmm.Emission()[trueStates[t]].LogProbability(
+        obs.col(t));
+  }
+  BOOST_REQUIRE_CLOSE(viterbi, predictedLogLik, 1e-6);
+  BOOST_REQUIRE_GE(viterbi, trueLogLik - 1e-6);
+
+  // Training must keep the topology and give a stochastic matrix.
+  std::vector<arma::mat> sequences(1, obs);
+  hmm.Train(sequences);
+  for (size_t j = 0; j < states; ++j)
+  {
+    BOOST_REQUIRE_CLOSE(arma::accu(hmm.Transition().col(j)), 1.0, 1e-6);
+    for (size_t i = 0; i < states; ++i)
+      if (i != j && i != j + 1)
+        BOOST_REQUIRE_EQUAL(hmm.Transition()(i, j), 0.0);
+  }
+}
+
+/**
+ * Make sure the online Viterbi decoder gives the same states as Predict() when
+ * the lag is long enough, and nearly the same states with a short lag.
+ */
+BOOST_AUTO_TEST_CASE(OnlineViterbiTest)
+{
+  HMM<GaussianDistribution> hmm(3, GaussianDistribution(2));
+  hmm.Transition() = "0.8 0.1 0.1;"
+                     "0.1 0.8 0.1;"
+                     "0.1 0.1 0.8";
+  hmm.Initial() = "0.5 0.3 0.2";
+  hmm.Emission()[0].Mean() = "0.0 0.0";
+  hmm.Emission()[1].Mean() = "1.5 0.0";
+  hmm.Emission()[2].Mean() = "0.0 1.5";
+
+  arma::mat obs;
+  arma::Col<size_t> trueStates;
+  hmm.Generate(1000, obs, trueStates);
+
+  arma::Col<size_t> predicted;
+  const double logLikelihood = hmm.Predict(obs, predicted);
+
+  // With a lag as long as the sequence, nothing is decided until Finish().
+  OnlineViterbi<GaussianDistribution> full(hmm, obs.n_cols);
+  std::vector<size_t> states;
+  for (size_t t = 0; t < obs.n_cols; ++t)
+    full.Step(obs.col(t), states);
+  BOOST_REQUIRE_EQUAL(states.size(), 0);
+  BOOST_REQUIRE_EQUAL(full.Pending(), obs.n_cols);
+  BOOST_REQUIRE_CLOSE(full.Finish(states), logLikelihood, 1e-5);
+  BOOST_REQUIRE_EQUAL(states.size(), obs.n_cols);
+  for (size_t t = 0; t < obs.n_cols; ++t)
+    BOOST_REQUIRE_EQUAL(states[t], predicted[t]);
+  BOOST_REQUIRE_EQUAL(full.Observations(), 0);
+
+  // With a short lag, states are decided as the observations arrive.
+  OnlineViterbi<GaussianDistribution> online(hmm, 20);
+  states.clear();
+  for (size_t t = 0; t < obs.n_cols; ++t)
+  {
+    online.Step(obs.col(t), states);
+    BOOST_REQUIRE_LE(online.Pending(), 20);
+  }
+  BOOST_REQUIRE_EQUAL(states.size(), obs.n_cols - 20);
+  online.Finish(states);
+  BOOST_REQUIRE_EQUAL(states.size(), obs.n_cols);
+
+  size_t agree = 0;
+  for (size_t t = 0; t < obs.n_cols; ++t)
+    if (states[t] == predicted[t])
+      ++agree;
+  BOOST_REQUIRE_GT(agree, (size_t) (0.98 * obs.n_cols));
+
+  // With no lag, each state is decided as soon as its observation arrives, and
+  // Finish() has nothing left to decide.
+  OnlineViterbi<GaussianDistribution> greedy(hmm, 0);
+  states.clear();
+  for (size_t t = 0; t < obs.n_cols; ++t)
+  {
+    greedy.Step(obs.col(t), states);
+    BOOST_REQUIRE_EQUAL(states.size(), t + 1);
+    BOOST_REQUIRE_EQUAL(greedy.Pending(), 0);
+  }
+  BOOST_REQUIRE_CLOSE(greedy.Finish(states), logLikelihood, 1e-5);
+  BOOST_REQUIRE_EQUAL(states.size(), obs.n_cols);
+  BOOST_REQUIRE_EQUAL(states[obs.n_cols - 1], predicted[obs.n_cols - 1]);
+  BOOST_REQUIRE_EQUAL(greedy.Observations(), 0);
+}
+
+/**
+ * Make sure that scoring several sequences at once gives the same
+ * log-likelihoods as scoring them one at a time, for any number of threads.
+ */
+BOOST_AUTO_TEST_CASE(BatchLogLikelihoodTest)
+{
+  HMM<GaussianDistribution> hmm(2, GaussianDistribution(1));
+  hmm.Transition() = "0.9 0.2;"
+                     "0.1 0.8";
+  hmm.Emission()[0].Mean()[0] = -1.0;
+  hmm.Emission()[1].Mean()[0] = 2.0;
+
+  std::vector<arma::mat> sequences(15);
+  for (size_t i = 0; i < sequences.size(); ++i)
+  {
+    arma::Col<size_t> states;
+    hmm.Generate(10 + 20 * i, sequences[i], states);
+  }
+  // An empty sequence has a log-likelihood of zero.
+  sequences[3].set_size(1, 0);
+
+  for (size_t threads = 0; threads < 4; ++threads)
+  {
+    hmm.Threads() = threads;
+    arma::vec logLikelihoods;
+    hmm.LogLikelihood(sequences, logLikelihoods);
+
+    BOOST_REQUIRE_EQUAL(logLikelihoods.n_elem, sequences.size());
+    for (size_t i = 0; i < sequences.size(); ++i)
+    {
+      if (i == 3)
+        BOOST_REQUIRE_SMALL(logLikelihoods[i], 1e-10);
+      else
+        BOOST_REQUIRE_CLOSE(logLikelihoods[i],
+            hmm.LogLikelihood(sequences[i]), 1e-10);
+    }
+  }
+}
 
+/**
+ * Make sure the gathered emission probabilities of a discrete HMM give the same
+ * log-likelihood as evaluating each state's distribution at each time step.
+ */
+BOOST_AUTO_TEST_CASE(DiscreteHMMGatheredEmissionTest)
+{
+  arma::vec initial("0.5 0.2 0.3");
+  arma::mat transition("0.5 0.0 0.1;"
+                       "0.2 0.6 0.2;"
+                       "0.3 0.4 0.7");
+  std::vector<DiscreteDistribution> emission(3, DiscreteDistribution(6));
+  emission[0].Probabilities() = "0.50 0.25 0.00 0.00 0.05 0.20";
+  emission[1].Probabilities() = "0.00 0.25 0.25 0.30 0.10 0.10";
+  emission[2].Probabilities() = "0.10 0.30 0.30 0.10 0.10 0.10";
+
+  HMM<DiscreteDistribution> hmm(initial, transition, emission);
+
+  // A long sequence, so that each symbol appears many times.
+  arma::mat sequence;
+  arma::Col<size_t> states;
+  hmm.Generate(500, sequence, states);
+
+  // The scaled forward algorithm, evaluating each distribution separately.
+  arma::vec forward(3);
+  double logLikelihood = 0.0;
+  for (size_t t = 0; t < sequence.n_cols; ++t)
+  {
+    if (t == 0)
+      forward = initial;
+    else
+      forward = transition * forward;
+
+    for (size_t i = 0; i < 3; ++i)
+      forward[i] *= emission[i].Probability(sequence.unsafe_col(t));
+
+    const double scale = arma::accu(forward);
+    logLikelihood += std::log(scale);
+    forward /= scale;
+  }
+
+  BOOST_REQUIRE_CLOSE(hmm.LogLikelihood(sequence), logLikelihood, 1e-8);
+
+  // The state probabilities of each time step sum to one.
+  arma::mat stateProb;
+  hmm.Estimate(sequence, stateProb);
+  for (size_t t = 0; t < sequence.n_cols; ++t)
+    BOOST_REQUIRE_CLOSE(arma::accu(stateProb.col(t)), 1.0, 1e-8);
+}
+
+/**
+ * Make sure that fitting the emission distributions of the states in parallel
+ * gives the same model as fitting them one at a time, for both kinds of
+ * training.
+ */
+BOOST_AUTO_TEST_CASE(ParallelEmissionTrainTest)
+{
+  HMM<GaussianDistribution> generator(4, GaussianDistribution(2));
+  generator.Transition() = arma::mat("0.7 0.1 0.1 0.1;"
+                                     "0.1 0.7 0.1 0.1;"
+                                     "0.1 0.1 0.7 0.1;"
+                                     "0.1 0.1 0.1 0.7");
+  for (size_t i = 0; i < 4; ++i)
+    generator.Emission()[i].Mean().fill(4.0 * i);
+
+  std::vector<arma::mat> observations(10);
+  std::vector<arma::Col<size_t> > states(10);
+  for (size_t i = 0; i < observations.size(); ++i)
+    generator.Generate(100, observations[i], states[i]);
+
+  for (size_t labeled = 0; labeled < 2; ++labeled)
+  {
+    HMM<GaussianDistribution> serial(4, GaussianDistribution(2));
+    for (size_t i = 0; i < 4; ++i)
+      serial.Emission()[i].Mean().fill(4.0 * i + 0.5);
+    HMM<GaussianDistribution> parallel(serial);
+
+    serial.Threads() = 1;
+    parallel.Threads() = 4;
+    if (labeled)
+    {
+      serial.Train(observations, states);
+      parallel.Train(observations, states);
+    }
+    else
+    {
+      serial.Train(observations);
+      parallel.Train(observations);
+    }
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+      for (size_t j = 0; j < 2; ++j)
+      {
+        BOOST_REQUIRE_CLOSE(parallel.Emission()[i].Mean()[j],
+            serial.Emission()[i].Mean()[j], 1e-5);
+        for (size_t k = 0; k < 2; ++k)
+          BOOST_REQUIRE_CLOSE(parallel.Emission()[i].Covariance()(j, k),
+              serial.Emission()[i].Covariance()(j, k), 1e-5);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,110 @@
+/**
+ * @file kde_test.cpp
+ *
+ * Tests for the KDE class.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/core/kernels/epanechnikov_kernel.hpp>
+#include <mlpack/methods/kde/kde.hpp>
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::kde;
+using namespace mlpack::kernel;
+using namespace mlpack::tree;
+using namespace mlpack::bound;
+
+BOOST_AUTO_TEST_SUITE(KDETest);
+
+/**
+ * Make sure that naive KDE gives the density by its definition.
+ */
+BOOST_AUTO_TEST_CASE(NaiveDensityTest)
+{
+  arma::mat reference;
+  reference.randu(2, 50);
+  arma::mat queries;
+  queries.randu(2, 10);
+
+  GaussianKernel kernel(0.3);
+  KDE<> kde(reference, 0.0, 0.0, kernel, true);
+  arma::vec estimations;
+  kde.Evaluate(queries, estimations);
+
+  BOOST_REQUIRE_EQUAL(estimations.n_elem, 10);
+  for (size_t i = 0; i < queries.n_cols; ++i)
+  {
+    double density = 0.0;
+    for (size_t j = 0; j < reference.n_cols; ++j)
+      density += kernel.Evaluate(queries.unsafe_col(i),
+          reference.unsafe_col(j));
+    density /= reference.n_cols * kernel.Normalizer(2);
+
+    BOOST_REQUIRE_CLOSE(estimations[i], density, 1e-8);
+  }
+}
+
+/**
+ * Make sure that dual-tree and single-tree KDE with the Gaussian kernel are
+ * within the relative error tolerance of naive KDE, and that something was
+ * pruned.
+ */
+BOOST_AUTO_TEST_CASE(GaussianTreeVsNaiveTest)
+{
+  arma::mat reference;
+  reference.randu(3, 2000);
+  arma::mat queries;
+  queries.randu(3, 500);
+
+  GaussianKernel kernel(0.2);
+  KDE<> naive(reference, 0.0, 0.0, kernel, true);
+  arma::vec naiveEstimations;
+  naive.Evaluate(queries, naiveEstimations);
+
+  KDE<> dualTree(reference, 0.05, 0.0, kernel);
+  arma::vec dualTreeEstimations;
+  dualTree.Evaluate(queries, dualTreeEstimations);
+  BOOST_REQUIRE_GT(dualTree.NumPrunes(), 0);
+
+  KDE<> singleTree(reference, 0.05, 0.0, kernel, false, true);
+  arma::vec singleTreeEstimations;
+  singleTree.Evaluate(queries, singleTreeEstimations);
+
+  for (size_t i = 0; i < queries.n_cols; ++i)
+  {
+    BOOST_REQUIRE_LE(std::abs(dualTreeEstimations[i] - naiveEstimations[i]),
+        0.05 * naiveEstimations[i] + 1e-12);
+    BOOST_REQUIRE_LE(std::abs(singleTreeEstimations[i] - naiveEstimations[i]),
+        0.05 * naiveEstimations[i] + 1e-12);
+  }
+}
+
+/**
+ * Make sure that monochromatic KDE with the Epanechnikov kernel on a ball tree
+ * is within the absolute error tolerance of naive KDE, in the order of the
+ * original points.
+ */
+BOOST_AUTO_TEST_CASE(EpanechnikovBallTreeTest)
+{
+  arma::mat reference;
+  reference.randu(2, 1500);
+
+  EpanechnikovKernel kernel(0.25);
+  KDE<EpanechnikovKernel> naive(reference, 0.0, 0.0, kernel, true);
+  arma::vec naiveEstimations;
+  naive.Evaluate(naiveEstimations);
+
+  typedef BinarySpaceTree<BallBound<>, EmptyStatistic> TreeType;
+  KDE<EpanechnikovKernel, metric::EuclideanDistance, TreeType> ballTree(
+      reference, 0.0, 0.01, kernel);
+  arma::vec ballTreeEstimations;
+  ballTree.Evaluate(ballTreeEstimations);
+
+  BOOST_REQUIRE_EQUAL(ballTreeEstimations.n_elem, reference.n_cols);
+  for (size_t i = 0; i < reference.n_cols; ++i)
+    BOOST_REQUIRE_LE(std::abs(ballTreeEstimations[i] - naiveEstimations[i]),
+        0.01 + 1e-12);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
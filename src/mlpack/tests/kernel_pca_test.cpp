@@ -6,6 +6,8 @@
  */
 #include <mlpack/core.hpp>
 #include <mlpack/core/kernels/gaussian_kernel.hpp>
+#include <mlpack/core/kernels/linear_kernel.hpp>
+#include <mlpack/methods/pca/pca.hpp>
 #include <mlpack/methods/kernel_pca/kernel_rules/nystroem_method.hpp>
 #include <mlpack/methods/kernel_pca/kernel_pca.hpp>
 
@@ -145,4 +147,32 @@ BOOST_AUTO_TEST_CASE(CircleTransformationTestNystroem)
   BOOST_REQUIRE_EQUAL(ranges[1].Contains(ranges[2]), false);
 }
 
+/**
+ * With the linear kernel, kernel PCA projects the data onto the same principal
+ * components as PCA does (up to sign).
+ */
+BOOST_AUTO_TEST_CASE(LinearKernelPCATest)
+{
+  arma::mat dataset = arma::randn<arma::mat>(3, 3) *
+      arma::randn<arma::mat>(3, 200);
+  dataset.each_col() += arma::randu<arma::vec>(3);
+
+  arma::mat pcaData, kpcaData, eigvec;
+  arma::vec eigval;
+  pca::PCA p;
+  p.Apply(dataset, pcaData, eigval);
+
+  KernelPCA<LinearKernel> kp;
+  arma::vec kpcaEigval;
+  kp.Apply(dataset, kpcaData, kpcaEigval, eigvec);
+
+  for (size_t i = 0; i < 3; ++i)
+  {
+    const double sign = (dot(pcaData.row(i), kpcaData.row(i)) > 0) ? 1.0 :
+        -1.0;
+    for (size_t j = 0; j < 200; ++j)
+      BOOST_REQUIRE_SMALL(pcaData(i, j) - sign * kpcaData(i, j), 1e-6);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
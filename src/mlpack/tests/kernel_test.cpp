@@ -14,7 +14,9 @@
 #include <mlpack/core/kernels/linear_kernel.hpp>
 #include <mlpack/core/kernels/polynomial_kernel.hpp>
 #include <mlpack/core/kernels/spherical_kernel.hpp>
+#include <mlpack/core/kernels/triangular_kernel.hpp>
 #include <mlpack/core/kernels/pspectrum_string_kernel.hpp>
+#include <mlpack/core/kernels/kernel_matrix.hpp>
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/core/metrics/mahalanobis_distance.hpp>
 
@@ -203,6 +205,84 @@ BOOST_AUTO_TEST_CASE(md_full_covariance)
   BOOST_REQUIRE_CLOSE(md.Evaluate(b, a), 15.7, 1e-5);
 }
 
+/**
+ * The batch Evaluate() should give the same distances as Evaluate().
+ */
+BOOST_AUTO_TEST_CASE(md_batch_evaluate)
+{
+  arma::mat cov = "1.0 2.0 3.0 4.0;"
+                  "0.5 0.6 0.7 0.1;"
+                  "3.4 4.3 5.0 6.1;"
+                  "1.0 2.0 4.0 1.0;";
+  cov = trans(cov) * cov;
+  MahalanobisDistance<true> md(cov);
+
+  arma::vec a = "1.0 2.0 2.0 4.0";
+  arma::mat points = arma::randu<arma::mat>(4, 20);
+  points.col(3) = a;
+
+  arma::rowvec distances;
+  md.Evaluate(a, points, distances);
+  BOOST_REQUIRE_EQUAL(distances.n_elem, 20);
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    if (i == 3)
+      BOOST_REQUIRE_SMALL(distances[i], 1e-5);
+    else
+      BOOST_REQUIRE_CLOSE(distances[i], md.Evaluate(a, points.col(i)), 1e-5);
+  }
+}
+
+/**
+ * The Euclidean distance between points transformed by Transform() should be
+ * the Mahalanobis distance between the original points, whether the covariance
+ * is positive definite (Cholesky decomposition), only positive semidefinite
+ * (eigendecomposition), or not symmetric.
+ */
+BOOST_AUTO_TEST_CASE(md_transform)
+{
+  arma::mat l = arma::randu<arma::mat>(3, 5);
+  arma::mat covs[3];
+  covs[0] = trans(l) * l + arma::eye<arma::mat>(5, 5); // Positive definite.
+  covs[1] = trans(l) * l; // Rank 3.
+  covs[2] = covs[0];
+  covs[2](0, 1) += 1.0; // Not symmetric.
+  covs[2](1, 0) -= 1.0;
+
+  arma::mat data = arma::randu<arma::mat>(5, 30);
+  for (size_t c = 0; c < 3; ++c)
+  {
+    MahalanobisDistance<true> md(covs[c]);
+    MahalanobisDistance<false> squared(covs[c]);
+
+    arma::mat transformation;
+    md.Decompose(transformation);
+    BOOST_REQUIRE_EQUAL(transformation.n_cols, 5);
+
+    arma::mat transformed;
+    md.Transform(data, transformed);
+    BOOST_REQUIRE_EQUAL(transformed.n_cols, data.n_cols);
+
+    for (size_t i = 0; i < data.n_cols; ++i)
+    {
+      for (size_t j = i + 1; j < data.n_cols; ++j)
+      {
+        BOOST_REQUIRE_CLOSE(EuclideanDistance::Evaluate(transformed.col(i),
+            transformed.col(j)), md.Evaluate(data.col(i), data.col(j)), 1e-5);
+        BOOST_REQUIRE_CLOSE(SquaredEuclideanDistance::Evaluate(
+            transformed.col(i), transformed.col(j)),
+            squared.Evaluate(data.col(i), data.col(j)), 1e-5);
+      }
+    }
+  }
+
+  // Without a covariance matrix, the data is unchanged.
+  MahalanobisDistance<true> md;
+  arma::mat transformed;
+  md.Transform(data, transformed);
+  BOOST_REQUIRE_EQUAL(arma::accu(transformed != data), 0);
+}
+
 /**
  * Simple test case for the cosine distance.
  */
@@ -590,4 +670,203 @@ BOOST_AUTO_TEST_CASE(PSpectrumStringEvaluateTest)
   BOOST_REQUIRE_CLOSE(p.Evaluate(b, a), 11.0, 1e-5);
 }
 
+/**
+ * Make sure that the batch evaluation of the p-spectrum kernel gives the same
+ * results as evaluating it on each pair of strings, both with exact keys and
+ * with hashed keys (p > 12), and that both match a count of the substrings.
+ */
+BOOST_AUTO_TEST_CASE(PSpectrumStringBatchEvaluateTest)
+{
+  std::vector<std::vector<std::string> > datasets(2);
+  datasets[0].push_back("the quick brown fox jumps over the lazy dog");
+  datasets[0].push_back("THE QUICK BROWN FOXES JUMPED OVER THE LAZY DOGS");
+  datasets[0].push_back("a");
+  datasets[1].push_back("quick brown foxes and quick brown dogs");
+  datasets[1].push_back("jumps over 12 lazy dogs, jumps over 13 lazy foxes");
+
+  arma::mat a("0 0 0 1 1; 0 1 2 0 1");
+  arma::mat b("1 0 1; 0 1 1");
+
+  for (size_t p = 3; p <= 15; p += 12)
+  {
+    PSpectrumStringKernel kernel(datasets, p);
+
+    arma::mat k;
+    kernel.Evaluate(a, b, k);
+    BOOST_REQUIRE_EQUAL(k.n_rows, 5);
+    BOOST_REQUIRE_EQUAL(k.n_cols, 3);
+
+    for (size_t i = 0; i < a.n_cols; ++i)
+    {
+      const std::map<std::string, int>& aCounts =
+          kernel.Counts()[(size_t) a(0, i)][(size_t) a(1, i)];
+      for (size_t j = 0; j < b.n_cols; ++j)
+      {
+        const std::map<std::string, int>& bCounts =
+            kernel.Counts()[(size_t) b(0, j)][(size_t) b(1, j)];
+
+        double expected = 0.0;
+        std::map<std::string, int>::const_iterator it = aCounts.begin();
+        for (; it != aCounts.end(); ++it)
+          if (bCounts.count((*it).first))
+            expected += (*it).second * bCounts.find((*it).first)->second;
+
+        BOOST_REQUIRE_CLOSE(k(i, j) + 1.0, expected + 1.0, 1e-10);
+        BOOST_REQUIRE_CLOSE(kernel.Evaluate(a.col(i), b.col(j)) + 1.0,
+            expected + 1.0, 1e-10);
+      }
+    }
+  }
+}
+
+/**
+ * Make sure that KernelMatrix() gives the same results as evaluating the kernel
+ * on each pair of points, for both the symmetric and the general kernel matrix.
+ */
+template<typename KernelType>
+void CheckKernelMatrix(KernelType& kernel)
+{
+  // The sizes are not multiples of the block size, and one point is zero.
+  arma::mat a = arma::randu<arma::mat>(5, 300);
+  arma::mat b = arma::randu<arma::mat>(5, 150);
+  a.col(17).zeros();
+
+  arma::mat k;
+  KernelMatrix(kernel, a, b, k);
+  BOOST_REQUIRE_EQUAL(k.n_rows, 300);
+  BOOST_REQUIRE_EQUAL(k.n_cols, 150);
+  for (size_t i = 0; i < a.n_cols; ++i)
+  {
+    for (size_t j = 0; j < b.n_cols; ++j)
+    {
+      const double value = kernel.Evaluate(a.col(i), b.col(j));
+      if (std::abs(value) < 1e-10)
+        BOOST_REQUIRE_SMALL(k(i, j), 1e-10);
+      else
+        BOOST_REQUIRE_CLOSE(k(i, j), value, 1e-8);
+    }
+  }
+
+  KernelMatrix(kernel, a, k, 3);
+  BOOST_REQUIRE_EQUAL(k.n_rows, 300);
+  BOOST_REQUIRE_EQUAL(k.n_cols, 300);
+  for (size_t i = 0; i < a.n_cols; ++i)
+  {
+    for (size_t j = 0; j < a.n_cols; ++j)
+    {
+      const double value = kernel.Evaluate(a.col(i), a.col(j));
+      if (std::abs(value) < 1e-10)
+        BOOST_REQUIRE_SMALL(k(i, j), 1e-10);
+      else
+        BOOST_REQUIRE_CLOSE(k(i, j), value, 1e-8);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(KernelMatrixTest)
+{
+  LinearKernel linear;
+  CheckKernelMatrix(linear);
+
+  PolynomialKernel polynomial(3.0, 1.5);
+  CheckKernelMatrix(polynomial);
+
+  GaussianKernel gaussian(0.7);
+  CheckKernelMatrix(gaussian);
+
+  CosineDistance cosine;
+  CheckKernelMatrix(cosine);
+
+  LaplacianKernel laplacian(0.5);
+  CheckKernelMatrix(laplacian);
+
+  HyperbolicTangentKernel tangent(0.3, -0.2);
+  CheckKernelMatrix(tangent);
+
+  EpanechnikovKernel epanechnikov(1.2);
+  CheckKernelMatrix(epanechnikov);
+
+  TriangularKernel triangular(1.1);
+  CheckKernelMatrix(triangular);
+}
+
+/**
+ * Make sure the pairwise implementation of KernelMatrixRule gives the same
+ * block as the batch implementation.
+ */
+BOOST_AUTO_TEST_CASE(KernelMatrixRulePairwiseTest)
+{
+  arma::mat a = arma::randu<arma::mat>(4, 40);
+  arma::mat b = arma::randu<arma::mat>(4, 30);
+
+  GaussianKernel gaussian(0.8);
+  arma::mat batch(40, 30);
+  arma::mat pairwise(40, 30);
+  KernelMatrixRule<GaussianKernel, true>::Block(gaussian, a, b, batch, 5, 35,
+      2, 27);
+  KernelMatrixRule<GaussianKernel, false>::Block(gaussian, a, b, pairwise, 5,
+      35, 2, 27);
+
+  for (size_t j = 2; j < 27; ++j)
+    for (size_t i = 5; i < 35; ++i)
+      BOOST_REQUIRE_CLOSE(batch(i, j), pairwise(i, j), 1e-8);
+}
+
+/**
+ * Check that the batch Evaluate() of a kernel matches the pairwise Evaluate().
+ */
+template<typename KernelType>
+void CheckBatchEvaluate(KernelType& kernel)
+{
+  arma::mat a = arma::randu<arma::mat>(6, 20);
+  arma::mat b = arma::randu<arma::mat>(6, 25);
+  b.col(3).zeros();
+
+  arma::mat k;
+  kernel.Evaluate(a, b, k);
+  BOOST_REQUIRE_EQUAL(k.n_rows, 20);
+  BOOST_REQUIRE_EQUAL(k.n_cols, 25);
+  for (size_t i = 0; i < a.n_cols; ++i)
+  {
+    for (size_t j = 0; j < b.n_cols; ++j)
+    {
+      const double value = kernel.Evaluate(a.col(i), b.col(j));
+      if (std::abs(value) < 1e-10)
+        BOOST_REQUIRE_SMALL(k(i, j), 1e-10);
+      else
+        BOOST_REQUIRE_CLOSE(k(i, j), value, 1e-8);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(BatchEvaluateTest)
+{
+  LinearKernel linear;
+  CheckBatchEvaluate(linear);
+
+  PolynomialKernel polynomial(2.0, 0.5);
+  CheckBatchEvaluate(polynomial);
+
+  HyperbolicTangentKernel tangent(0.5, 0.1);
+  CheckBatchEvaluate(tangent);
+
+  CosineDistance cosine;
+  CheckBatchEvaluate(cosine);
+
+  GaussianKernel gaussian(1.3);
+  CheckBatchEvaluate(gaussian);
+
+  LaplacianKernel laplacian(0.9);
+  CheckBatchEvaluate(laplacian);
+
+  EpanechnikovKernel epanechnikov(1.5);
+  CheckBatchEvaluate(epanechnikov);
+
+  TriangularKernel triangular(2.0);
+  CheckBatchEvaluate(triangular);
+
+  SphericalKernel spherical(1.0);
+  CheckBatchEvaluate(spherical);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -56,4 +56,30 @@ BOOST_AUTO_TEST_CASE(IsNormalizedTest)
       false);
 }
 
+BOOST_AUTO_TEST_CASE(HasBatchEvaluateTest)
+{
+  // The default value should be false.
+  BOOST_REQUIRE_EQUAL((bool) KernelTraits<int>::HasBatchEvaluate, false);
+
+  // Kernels which can be evaluated on sets of points at once.
+  BOOST_REQUIRE_EQUAL((bool) KernelTraits<CosineDistance>::HasBatchEvaluate,
+      true);
+  BOOST_REQUIRE_EQUAL((bool) KernelTraits<EpanechnikovKernel>::HasBatchEvaluate,
+      true);
+  BOOST_REQUIRE_EQUAL((bool) KernelTraits<GaussianKernel>::HasBatchEvaluate,
+      true);
+  BOOST_REQUIRE_EQUAL((bool) KernelTraits<LaplacianKernel>::HasBatchEvaluate,
+      true);
+  BOOST_REQUIRE_EQUAL((bool) KernelTraits<SphericalKernel>::HasBatchEvaluate,
+      true);
+  BOOST_REQUIRE_EQUAL((bool) KernelTraits<TriangularKernel>::HasBatchEvaluate,
+      true);
+  BOOST_REQUIRE_EQUAL((bool) KernelTraits<LinearKernel>::HasBatchEvaluate,
+      true);
+  BOOST_REQUIRE_EQUAL((bool) KernelTraits<PolynomialKernel>::HasBatchEvaluate,
+      true);
+  BOOST_REQUIRE_EQUAL(
+      (bool) KernelTraits<PSpectrumStringKernel>::HasBatchEvaluate, true);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
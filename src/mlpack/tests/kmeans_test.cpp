@@ -7,14 +7,25 @@
 #include <mlpack/methods/kmeans/kmeans.hpp>
 #include <mlpack/methods/kmeans/allow_empty_clusters.hpp>
 #include <mlpack/methods/kmeans/refined_start.hpp>
+#include <mlpack/methods/kmeans/sparse_kmeans.hpp>
+#include <mlpack/methods/kmeans/kmeans_plus_plus.hpp>
+#include <mlpack/methods/kmeans/scalable_kmeans_plus_plus.hpp>
 #include <mlpack/methods/kmeans/elkan_kmeans.hpp>
 #include <mlpack/methods/kmeans/hamerly_kmeans.hpp>
+#include <mlpack/methods/kmeans/yinyang_kmeans.hpp>
+#include <mlpack/methods/kmeans/mini_batch_kmeans.hpp>
 #include <mlpack/methods/kmeans/pelleg_moore_kmeans.hpp>
 #include <mlpack/methods/kmeans/dtnn_kmeans.hpp>
 #include <mlpack/methods/kmeans/dual_tree_kmeans.hpp>
+#include <mlpack/methods/kmeans/chunked_kmeans.hpp>
+#include <mlpack/methods/kmeans/binary_matrix_chunks.hpp>
+#include <mlpack/methods/kmeans/lloyd_step_selection.hpp>
+#include <mlpack/methods/kmeans/local_communicator.hpp>
 
 #include <mlpack/core/tree/cover_tree/cover_tree.hpp>
 
+#include <sstream>
+
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
@@ -145,8 +156,9 @@ BOOST_AUTO_TEST_CASE(MaxVarianceNewClusterTest)
   metric::LMetric<2, true> metric;
 
   // This should only change one point.
-  BOOST_REQUIRE_EQUAL(MaxVarianceNewCluster::EmptyCluster(data, 2, centroids,
-      counts, metric), 1);
+  MaxVarianceNewCluster mvnc;
+  BOOST_REQUIRE_EQUAL(mvnc.EmptyCluster(data, 2, centroids, counts, metric),
+      1);
 
   // Add the variance of each point's distance away from the cluster.  I think
   // this is the sensible thing to do.
@@ -182,6 +194,45 @@ BOOST_AUTO_TEST_CASE(MaxVarianceNewClusterTest)
   BOOST_REQUIRE_EQUAL(counts[2], 1);
 }
 
+/**
+ * Make sure the max variance method handles several empty clusters in one
+ * iteration, reusing what it computed for the first.
+ */
+BOOST_AUTO_TEST_CASE(MaxVarianceNewClusterMultipleTest)
+{
+  arma::mat data("0.0 1.0 2.0 3.0 10.0 100.0 101.0;"
+                 "0.0 0.0 0.0 0.0  0.0   0.0   0.0;");
+
+  arma::mat centroids(2, 4);
+  centroids.col(0) = arma::mean(data.cols(0, 4), 1);
+  centroids.col(1) = arma::mean(data.cols(5, 6), 1);
+  centroids.cols(2, 3).fill(DBL_MAX);
+
+  arma::Col<size_t> counts("5 2 0 0");
+
+  metric::LMetric<2, true> metric;
+  MaxVarianceNewCluster mvnc;
+
+  // The first empty cluster takes the point furthest from cluster 0.
+  BOOST_REQUIRE_EQUAL(mvnc.EmptyCluster(data, 2, centroids, counts, metric),
+      1);
+  BOOST_REQUIRE_CLOSE(centroids(0, 2), 10.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(centroids(0, 0), 1.5, 1e-5);
+
+  // Cluster 0 still has the maximum variance, so the second empty cluster
+  // takes the next furthest point from it.
+  BOOST_REQUIRE_EQUAL(mvnc.EmptyCluster(data, 3, centroids, counts, metric),
+      1);
+  BOOST_REQUIRE_SMALL(centroids(0, 3), 1e-5);
+  BOOST_REQUIRE_CLOSE(centroids(0, 0), 2.0, 1e-5);
+  BOOST_REQUIRE_CLOSE(centroids(0, 1), 100.5, 1e-5);
+
+  BOOST_REQUIRE_EQUAL(counts[0], 3);
+  BOOST_REQUIRE_EQUAL(counts[1], 2);
+  BOOST_REQUIRE_EQUAL(counts[2], 1);
+  BOOST_REQUIRE_EQUAL(counts[3], 1);
+}
+
 /**
  * Make sure the random partitioner seems to return valid results.
  */
@@ -440,6 +491,36 @@ BOOST_AUTO_TEST_CASE(RefinedStartTest)
   BOOST_REQUIRE_LT(distortion, 14000.0);
 }
 
+/**
+ * Make sure the refined starting policy still finds well-separated clusters
+ * when the samplings are run in parallel.
+ */
+BOOST_AUTO_TEST_CASE(ParallelRefinedStartTest)
+{
+  // Three tight, far-apart Gaussians.
+  arma::mat data(3, 1500);
+  data.randn();
+  data.cols(500, 999) += 50.0;
+  data.cols(1000, 1499) -= 50.0;
+
+  RefinedStart rs(20, 0.1, 4);
+  BOOST_REQUIRE_EQUAL(rs.Threads(), 4);
+
+  arma::Col<size_t> assignments;
+  rs.Cluster(data, 3, assignments);
+
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, 1500);
+  for (size_t i = 0; i < 1500; ++i)
+  {
+    BOOST_REQUIRE_LT(assignments[i], 3);
+    BOOST_REQUIRE_EQUAL(assignments[i], assignments[500 * (i / 500)]);
+  }
+
+  BOOST_REQUIRE_NE(assignments[0], assignments[500]);
+  BOOST_REQUIRE_NE(assignments[0], assignments[1000]);
+  BOOST_REQUIRE_NE(assignments[500], assignments[1000]);
+}
+
 #ifdef ARMA_HAS_SPMAT
 // Can't do this test on Armadillo 3.4; var(SpBase) is not implemented.
 #if !((ARMA_VERSION_MAJOR == 3) && (ARMA_VERSION_MINOR == 4))
@@ -488,6 +569,100 @@ BOOST_AUTO_TEST_CASE(SparseKMeansTest)
   BOOST_REQUIRE_EQUAL(assignments[11], clusterTwo);
 }
 
+/**
+ * A sparse Lloyd step should give the same new centroids as the naive step,
+ * which computes every distance in full.
+ */
+BOOST_AUTO_TEST_CASE(SparseLloydStepTest)
+{
+  arma::sp_mat data;
+  data.sprandu(2000, 300, 0.01);
+  arma::mat centroids(2000, 8);
+  centroids.randu();
+  centroids *= 0.02;
+
+  metric::SquaredEuclideanDistance metric;
+  NaiveKMeans<metric::SquaredEuclideanDistance, arma::sp_mat> naive(data,
+      metric);
+  SparseKMeans<metric::SquaredEuclideanDistance, arma::sp_mat> sparse(data,
+      metric);
+  sparse.Threads() = 4;
+
+  arma::mat naiveCentroids, sparseCentroids;
+  arma::Col<size_t> naiveCounts, sparseCounts;
+  const double naiveNorm = naive.Iterate(centroids, naiveCentroids,
+      naiveCounts);
+  const double sparseNorm = sparse.Iterate(centroids, sparseCentroids,
+      sparseCounts);
+
+  BOOST_REQUIRE_CLOSE(naiveNorm, sparseNorm, 1e-5);
+  BOOST_REQUIRE_EQUAL(sparse.DistanceCalculations(),
+      naive.DistanceCalculations());
+  for (size_t i = 0; i < centroids.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(naiveCounts[i], sparseCounts[i]);
+  for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+  {
+    if (std::abs(naiveCentroids[i]) < 1e-10)
+      BOOST_REQUIRE_SMALL(sparseCentroids[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(naiveCentroids[i], sparseCentroids[i], 1e-5);
+  }
+
+  // The sums should not depend on the number of threads.
+  SparseKMeans<metric::SquaredEuclideanDistance, arma::sp_mat> serial(data,
+      metric);
+  serial.Threads() = 1;
+  arma::mat serialCentroids;
+  arma::Col<size_t> serialCounts;
+  serial.Iterate(centroids, serialCentroids, serialCounts);
+  for (size_t i = 0; i < serialCentroids.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(serialCentroids[i], sparseCentroids[i]);
+}
+
+/**
+ * Clustering sparse data with the sparse Lloyd step (which also finds the final
+ * assignments) should give the same clusters as the naive step.
+ */
+BOOST_AUTO_TEST_CASE(SparseKMeansClusterTest)
+{
+  // Three clusters, each of which has its nonzero elements in its own range of
+  // dimensions.
+  arma::sp_mat data(3000, 150);
+  for (size_t i = 0; i < 150; ++i)
+    for (size_t j = 0; j < 20; ++j)
+      data((i % 3) * 1000 + math::RandInt(1000), i) = 1.0 + math::Random();
+
+  arma::mat centroids(3000, 3);
+  for (size_t c = 0; c < 3; ++c)
+    centroids.col(c) = arma::vec(data.col(c));
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      NaiveKMeans, arma::sp_mat> naive;
+  arma::Col<size_t> naiveAssignments;
+  arma::mat naiveCentroids(centroids);
+  naive.Cluster(data, 3, naiveAssignments, naiveCentroids, false, true);
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      SparseKMeans, arma::sp_mat> sparse;
+  arma::Col<size_t> sparseAssignments;
+  arma::mat sparseCentroids(centroids);
+  sparse.Cluster(data, 3, sparseAssignments, sparseCentroids, false, true);
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(naiveAssignments[i], sparseAssignments[i]);
+    BOOST_REQUIRE_EQUAL(sparseAssignments[i], i % 3);
+  }
+
+  for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+  {
+    if (std::abs(naiveCentroids[i]) < 1e-10)
+      BOOST_REQUIRE_SMALL(sparseCentroids[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(naiveCentroids[i], sparseCentroids[i], 1e-5);
+  }
+}
+
 #endif // Exclude Armadillo 3.4.
 #endif // ARMA_HAS_SPMAT
 
@@ -525,6 +700,78 @@ BOOST_AUTO_TEST_CASE(ElkanTest)
   }
 }
 
+/**
+ * Yinyang k-means should give the same clusters as the naive method, with any
+ * number of groups, and need fewer distance calculations.
+ */
+BOOST_AUTO_TEST_CASE(YinyangTest)
+{
+  const size_t trials = 5;
+
+  for (size_t t = 0; t < trials; ++t)
+  {
+    arma::mat dataset(10, 1000);
+    dataset.randu();
+
+    const size_t k = 10 * (t + 1);
+    arma::mat centroids(10, k);
+    centroids.randu();
+
+    arma::mat naiveCentroids(centroids);
+    KMeans<> km;
+    arma::Col<size_t> assignments;
+    km.Cluster(dataset, k, assignments, naiveCentroids, false, true);
+
+    // 0 groups means the default (k / 10).
+    const size_t groups[] = { 0, 1, 3, k };
+    for (size_t g = 0; g < 4; ++g)
+    {
+      KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+          YinyangKMeans> yinyang;
+      yinyang.Groups() = groups[g];
+      yinyang.Threads() = 4;
+      arma::Col<size_t> yinyangAssignments;
+      arma::mat yinyangCentroids(centroids);
+      yinyang.Cluster(dataset, k, yinyangAssignments, yinyangCentroids, false,
+          true);
+
+      for (size_t i = 0; i < dataset.n_cols; ++i)
+        BOOST_REQUIRE_EQUAL(assignments[i], yinyangAssignments[i]);
+
+      for (size_t i = 0; i < centroids.n_elem; ++i)
+        BOOST_REQUIRE_CLOSE(naiveCentroids[i], yinyangCentroids[i], 1e-5);
+    }
+  }
+
+  // Count the distance calculations of a few iterations directly.
+  arma::mat dataset(5, 2000);
+  dataset.randu();
+  arma::mat centroids(5, 40);
+  centroids.randu();
+
+  metric::EuclideanDistance metric;
+  NaiveKMeans<metric::EuclideanDistance, arma::mat> naive(dataset, metric);
+  YinyangKMeans<metric::EuclideanDistance, arma::mat> yinyang(dataset, metric);
+  yinyang.Groups() = 4;
+
+  arma::mat naiveCentroids(centroids), yinyangCentroids(centroids);
+  arma::mat newCentroids;
+  arma::Col<size_t> naiveCounts, yinyangCounts;
+  for (size_t i = 0; i < 10; ++i)
+  {
+    naive.Iterate(naiveCentroids, newCentroids, naiveCounts);
+    naiveCentroids = newCentroids;
+    yinyang.Iterate(yinyangCentroids, newCentroids, yinyangCounts);
+    yinyangCentroids = newCentroids;
+
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+      BOOST_REQUIRE_EQUAL(naiveCounts[c], yinyangCounts[c]);
+  }
+
+  BOOST_REQUIRE_LT(yinyang.DistanceCalculations(),
+      naive.DistanceCalculations());
+}
+
 BOOST_AUTO_TEST_CASE(HamerlyTest)
 {
   const size_t trials = 5;
@@ -690,4 +937,594 @@ BOOST_AUTO_TEST_CASE(DualTreeKMeansTest)
   }
 }
 
+/**
+ * Make sure that the naive, Elkan and Hamerly steps give the same clusters with
+ * several threads as the naive step does with one thread.
+ */
+BOOST_AUTO_TEST_CASE(ParallelLloydStepTest)
+{
+  arma::mat dataset(10, 1000);
+  dataset.randu();
+
+  const size_t k = 15;
+  arma::mat centroids(10, k);
+  centroids.randu();
+
+  arma::mat serialCentroids(centroids);
+  KMeans<> km;
+  km.Threads() = 1;
+  arma::Col<size_t> assignments;
+  km.Cluster(dataset, k, assignments, serialCentroids, false, true);
+
+  KMeans<> naive(1000, metric::EuclideanDistance(), RandomPartition(),
+      MaxVarianceNewCluster(), 4);
+  arma::Col<size_t> naiveAssignments;
+  arma::mat naiveCentroids(centroids);
+  naive.Cluster(dataset, k, naiveAssignments, naiveCentroids, false, true);
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      ElkanKMeans> elkan(1000, metric::EuclideanDistance(), RandomPartition(),
+      MaxVarianceNewCluster(), 4);
+  arma::Col<size_t> elkanAssignments;
+  arma::mat elkanCentroids(centroids);
+  elkan.Cluster(dataset, k, elkanAssignments, elkanCentroids, false, true);
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      HamerlyKMeans> hamerly(1000, metric::EuclideanDistance(),
+      RandomPartition(), MaxVarianceNewCluster(), 4);
+  arma::Col<size_t> hamerlyAssignments;
+  arma::mat hamerlyCentroids(centroids);
+  hamerly.Cluster(dataset, k, hamerlyAssignments, hamerlyCentroids, false,
+      true);
+
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(assignments[i], naiveAssignments[i]);
+    BOOST_REQUIRE_EQUAL(assignments[i], elkanAssignments[i]);
+    BOOST_REQUIRE_EQUAL(assignments[i], hamerlyAssignments[i]);
+  }
+
+  for (size_t i = 0; i < centroids.n_elem; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(serialCentroids[i], naiveCentroids[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(serialCentroids[i], elkanCentroids[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(serialCentroids[i], hamerlyCentroids[i], 1e-5);
+  }
+}
+
+/**
+ * The sums of the Lloyd steps are added in an order which does not depend on
+ * the number of threads, so the centroids should be the same to the bit with
+ * any number of threads.  The dataset is large enough to be split into several
+ * blocks.
+ */
+BOOST_AUTO_TEST_CASE(DeterministicParallelLloydStepTest)
+{
+  arma::mat dataset(10, 20000);
+  dataset.randu();
+
+  const size_t k = 15;
+  arma::mat centroids(10, k);
+  centroids.randu();
+
+  arma::mat serialCentroids(centroids);
+  KMeans<> serial(5);
+  serial.Threads() = 1;
+  arma::Col<size_t> assignments;
+  serial.Cluster(dataset, k, assignments, serialCentroids, false, true);
+
+  const size_t threads[] = { 2, 3, 8 };
+  for (size_t t = 0; t < 3; ++t)
+  {
+    arma::mat parallelCentroids(centroids);
+    KMeans<> parallel(5);
+    parallel.Threads() = threads[t];
+    parallel.Cluster(dataset, k, assignments, parallelCentroids, false, true);
+
+    for (size_t i = 0; i < centroids.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(serialCentroids[i], parallelCentroids[i]);
+  }
+}
+
+/**
+ * util::TreeReducer should add the partial sums in the same order as
+ * util::TreeReduce(), whatever order the blocks are finished in, and free all
+ * of the partial sums but the first.
+ */
+BOOST_AUTO_TEST_CASE(TreeReducerTest)
+{
+  for (size_t blocks = 1; blocks <= 20; ++blocks)
+  {
+    std::vector<arma::vec> partials(blocks);
+    for (size_t b = 0; b < blocks; ++b)
+      partials[b] = 1e5 * arma::randn<arma::vec>(50);
+
+    std::vector<arma::vec> expected(partials);
+    util::TreeReduce(expected);
+
+    // Finish the blocks in reverse order, and in parallel.
+    std::vector<arma::vec> reversed(partials);
+    util::TreeReducer<arma::vec> reverseReducer(reversed);
+    for (size_t b = blocks; b > 0; --b)
+      reverseReducer.Finish(b - 1);
+
+    std::vector<arma::vec> parallel(partials);
+    util::TreeReducer<arma::vec> parallelReducer(parallel);
+    #pragma omp parallel for num_threads(4) schedule(dynamic)
+    for (omp_size_t b = 0; b < (omp_size_t) blocks; ++b)
+      parallelReducer.Finish(b);
+
+    for (size_t i = 0; i < expected[0].n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(reversed[0][i], expected[0][i]);
+      BOOST_REQUIRE_EQUAL(parallel[0][i], expected[0][i]);
+    }
+
+    for (size_t b = 1; b < blocks; ++b)
+    {
+      BOOST_REQUIRE_EQUAL(reversed[b].n_elem, 0);
+      BOOST_REQUIRE_EQUAL(parallel[b].n_elem, 0);
+    }
+  }
+}
+
+/**
+ * Make sure that mini-batch k-means finds the three clusters of the simple
+ * dataset, with centroids near the cluster means.
+ */
+BOOST_AUTO_TEST_CASE(MiniBatchKMeansTest)
+{
+  math::RandomSeed(0);
+
+  const arma::mat dataset = trans(kMeansData);
+  arma::mat centroids("1.0 8.0 -8.0; 1.0 8.0 4.0");
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      MiniBatchKMeans> kmeans;
+  arma::Col<size_t> assignments;
+  kmeans.Cluster(dataset, 3, assignments, centroids, false, true);
+
+  for (size_t i = 0; i < 13; i++)
+    BOOST_REQUIRE_EQUAL(assignments(i), (size_t) 0);
+  for (size_t i = 13; i < 20; i++)
+    BOOST_REQUIRE_EQUAL(assignments(i), (size_t) 1);
+  for (size_t i = 20; i < 30; i++)
+    BOOST_REQUIRE_EQUAL(assignments(i), (size_t) 2);
+
+  const size_t begins[] = { 0, 13, 20 };
+  const size_t ends[] = { 12, 19, 29 };
+  for (size_t c = 0; c < 3; ++c)
+  {
+    const arma::vec mean = arma::mean(dataset.cols(begins[c], ends[c]), 1);
+    BOOST_REQUIRE_SMALL(metric::EuclideanDistance::Evaluate(mean,
+        centroids.col(c)), 0.5);
+  }
+}
+
+/**
+ * Make sure that the dual-tree step types give the same clusters as the naive
+ * step when they run with several threads.
+ */
+BOOST_AUTO_TEST_CASE(ParallelDualTreeKMeansTest)
+{
+  const size_t trials = 3;
+
+  for (size_t t = 0; t < trials; ++t)
+  {
+    arma::mat dataset(10, 3000);
+    dataset.randu();
+
+    const size_t k = 10 * (t + 1);
+    arma::mat centroids(10, k);
+    centroids.randu();
+
+    arma::mat naiveCentroids(centroids);
+    KMeans<> km;
+    arma::Col<size_t> assignments;
+    km.Cluster(dataset, k, assignments, naiveCentroids, false, true);
+
+    KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+        DefaultDTNNKMeans> dtnn(1000, metric::EuclideanDistance(),
+        RandomPartition(), MaxVarianceNewCluster(), 4);
+    arma::Col<size_t> dtnnAssignments;
+    arma::mat dtnnCentroids(centroids);
+    dtnn.Cluster(dataset, k, dtnnAssignments, dtnnCentroids, false, true);
+
+    KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+        DefaultDualTreeKMeans> dualTree(1000, metric::EuclideanDistance(),
+        RandomPartition(), MaxVarianceNewCluster(), 4);
+    arma::Col<size_t> dualTreeAssignments;
+    arma::mat dualTreeCentroids(centroids);
+    dualTree.Cluster(dataset, k, dualTreeAssignments, dualTreeCentroids, false,
+        true);
+
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(assignments[i], dtnnAssignments[i]);
+      BOOST_REQUIRE_EQUAL(assignments[i], dualTreeAssignments[i]);
+    }
+
+    for (size_t i = 0; i < centroids.n_elem; ++i)
+    {
+      BOOST_REQUIRE_CLOSE(naiveCentroids[i], dtnnCentroids[i], 1e-5);
+      BOOST_REQUIRE_CLOSE(naiveCentroids[i], dualTreeCentroids[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Make sure that when the Lloyd step is cached between calls to Cluster(), the
+ * tree-based step types give the same results as the naive step for each call.
+ */
+template<template<class, class> class LloydStepType>
+void CachedLloydStepTest()
+{
+  arma::mat dataset(10, 1000);
+  dataset.randu();
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      LloydStepType> cached;
+  cached.CacheLloydStep() = true;
+
+  for (size_t t = 0; t < 3; ++t)
+  {
+    const size_t k = 5 * (t + 1);
+    arma::mat centroids(10, k);
+    centroids.randu();
+
+    arma::mat naiveCentroids(centroids);
+    KMeans<> km;
+    arma::Col<size_t> assignments;
+    km.Cluster(dataset, k, assignments, naiveCentroids, false, true);
+
+    arma::Col<size_t> cachedAssignments;
+    arma::mat cachedCentroids(centroids);
+    cached.Cluster(dataset, k, cachedAssignments, cachedCentroids, false,
+        true);
+
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+      BOOST_REQUIRE_EQUAL(assignments[i], cachedAssignments[i]);
+
+    for (size_t i = 0; i < centroids.n_elem; ++i)
+      BOOST_REQUIRE_CLOSE(naiveCentroids[i], cachedCentroids[i], 1e-5);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CachedLloydStepPellegMooreTest)
+{
+  CachedLloydStepTest<PellegMooreKMeans>();
+}
+
+BOOST_AUTO_TEST_CASE(CachedLloydStepDTNNTest)
+{
+  CachedLloydStepTest<DefaultDTNNKMeans>();
+}
+
+BOOST_AUTO_TEST_CASE(CachedLloydStepDualTreeTest)
+{
+  CachedLloydStepTest<DefaultDualTreeKMeans>();
+}
+
+/**
+ * Make sure that k-means started from the given initial partition policy
+ * recovers the three classes of kMeansData.
+ */
+template<typename InitialPartitionPolicy>
+void InitialPartitionPolicyTest(const InitialPartitionPolicy& policy)
+{
+  KMeans<metric::EuclideanDistance, InitialPartitionPolicy> kmeans(1000,
+      metric::EuclideanDistance(), policy);
+
+  arma::Col<size_t> assignments;
+  kmeans.Cluster((arma::mat) trans(kMeansData), 3, assignments);
+
+  const size_t firstClass = assignments(0);
+  const size_t secondClass = assignments(13);
+  const size_t thirdClass = assignments(20);
+  BOOST_REQUIRE_NE(firstClass, secondClass);
+  BOOST_REQUIRE_NE(firstClass, thirdClass);
+  BOOST_REQUIRE_NE(secondClass, thirdClass);
+
+  for (size_t i = 0; i < 13; i++)
+    BOOST_REQUIRE_EQUAL(assignments(i), firstClass);
+  for (size_t i = 13; i < 20; i++)
+    BOOST_REQUIRE_EQUAL(assignments(i), secondClass);
+  for (size_t i = 20; i < 30; i++)
+    BOOST_REQUIRE_EQUAL(assignments(i), thirdClass);
+}
+
+/**
+ * Make sure k-means++ seeding gives a correct clustering, and that it never
+ * chooses a centroid with no weight.
+ */
+BOOST_AUTO_TEST_CASE(KMeansPlusPlusTest)
+{
+  InitialPartitionPolicyTest(KMeansPlusPlus());
+  InitialPartitionPolicyTest(KMeansPlusPlus(2));
+
+  // Give weight only to one point of each class; then those points must be the
+  // chosen centroids, and each class gets its own cluster.
+  const arma::mat dataset = trans(kMeansData);
+  arma::vec weights(dataset.n_cols);
+  weights.zeros();
+  weights[0] = weights[13] = weights[20] = 1.0;
+
+  for (size_t trial = 0; trial < 10; ++trial)
+  {
+    arma::Col<size_t> assignments;
+    KMeansPlusPlus().Cluster(dataset, 3, weights, assignments);
+
+    BOOST_REQUIRE_EQUAL(assignments.n_elem, dataset.n_cols);
+    BOOST_REQUIRE_NE(assignments[0], assignments[13]);
+    BOOST_REQUIRE_NE(assignments[0], assignments[20]);
+    BOOST_REQUIRE_NE(assignments[13], assignments[20]);
+  }
+}
+
+/**
+ * Make sure k-means|| seeding gives a correct clustering, including when it
+ * runs no sampling rounds at all.
+ */
+BOOST_AUTO_TEST_CASE(ScalableKMeansPlusPlusTest)
+{
+  InitialPartitionPolicyTest(ScalableKMeansPlusPlus());
+  InitialPartitionPolicyTest(ScalableKMeansPlusPlus(0.5, 2, 2));
+  InitialPartitionPolicyTest(ScalableKMeansPlusPlus(2.0, 0));
+
+  arma::Col<size_t> assignments;
+  ScalableKMeansPlusPlus().Cluster((arma::mat) trans(kMeansData), 3,
+      assignments);
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, kMeansData.n_rows);
+  BOOST_REQUIRE_LT(arma::max(assignments), 3);
+}
+
+/**
+ * Make sure that BinaryMatrixChunks gives back the stored matrix, one chunk at
+ * a time, and again after Reset().
+ */
+BOOST_AUTO_TEST_CASE(BinaryMatrixChunksTest)
+{
+  arma::mat dataset;
+  dataset.randu(4, 23);
+
+  std::stringstream stream;
+  util::WriteBinary(stream, dataset);
+
+  BinaryMatrixChunks chunks(stream, 5);
+  BOOST_REQUIRE_EQUAL(chunks.Rows(), (size_t) 4);
+  BOOST_REQUIRE_EQUAL(chunks.Cols(), (size_t) 23);
+
+  for (size_t pass = 0; pass < 2; ++pass)
+  {
+    chunks.Reset();
+
+    arma::mat chunk;
+    size_t offset = 0;
+    size_t numChunks = 0;
+    while (chunks.NextChunk(chunk))
+    {
+      BOOST_REQUIRE_EQUAL(chunk.n_rows, (arma::uword) 4);
+      BOOST_REQUIRE_EQUAL((size_t) chunk.n_cols,
+          std::min((size_t) 5, 23 - offset));
+      for (size_t i = 0; i < chunk.n_cols; ++i)
+        for (size_t j = 0; j < 4; ++j)
+          BOOST_REQUIRE_EQUAL(chunk(j, i), dataset(j, offset + i));
+
+      offset += chunk.n_cols;
+      ++numChunks;
+    }
+
+    BOOST_REQUIRE_EQUAL(offset, (size_t) 23);
+    BOOST_REQUIRE_EQUAL(numChunks, (size_t) 5);
+  }
+}
+
+/**
+ * Make sure ChunkedKMeans gives the same result as KMeans with the naive Lloyd
+ * step when started from the same centroids, for any chunk size.
+ */
+BOOST_AUTO_TEST_CASE(ChunkedKMeansTest)
+{
+  const arma::mat dataset = trans(kMeansData);
+  const arma::mat initialCentroids("1.0 8.0 -8.0; 1.0 8.0 4.0");
+
+  KMeans<> kmeans;
+  arma::Col<size_t> assignments;
+  arma::mat centroids(initialCentroids);
+  kmeans.Cluster(dataset, 3, assignments, centroids, false, true);
+
+  std::stringstream stream;
+  util::WriteBinary(stream, dataset);
+
+  const size_t chunkSizes[] = { 1, 7, 30, 100 };
+  for (size_t s = 0; s < 4; ++s)
+  {
+    stream.clear();
+    stream.seekg(0);
+    BinaryMatrixChunks chunks(stream, chunkSizes[s]);
+
+    ChunkedKMeans<> chunkedKMeans(1000, metric::EuclideanDistance(), 2);
+    arma::mat chunkedCentroids(initialCentroids);
+    chunkedKMeans.Cluster(chunks, 3, chunkedCentroids, true);
+
+    arma::Col<size_t> chunkedAssignments;
+    chunkedKMeans.Assign(chunks, chunkedCentroids, chunkedAssignments);
+
+    BOOST_REQUIRE_EQUAL(chunkedAssignments.n_elem, assignments.n_elem);
+    for (size_t i = 0; i < assignments.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(chunkedAssignments[i], assignments[i]);
+    for (size_t i = 0; i < centroids.n_elem; ++i)
+      BOOST_REQUIRE_SMALL(chunkedCentroids[i] - centroids[i], 1e-8);
+
+    // Without an initial guess, the result should still be a valid
+    // clustering.
+    chunkedKMeans.Cluster(chunks, 3, chunkedCentroids);
+    BOOST_REQUIRE_EQUAL(chunkedCentroids.n_rows, (arma::uword) 2);
+    BOOST_REQUIRE_EQUAL(chunkedCentroids.n_cols, (arma::uword) 3);
+  }
+}
+
+/**
+ * Make sure that SelectLloydStep() picks the step types we expect for some
+ * typical problems, and never picks Elkan's algorithm if its bounds don't fit
+ * in memory.
+ */
+BOOST_AUTO_TEST_CASE(SelectLloydStepTest)
+{
+  // Small problems.
+  BOOST_REQUIRE_EQUAL(SelectLloydStep(1000, 50, 5), "naive");
+  BOOST_REQUIRE_EQUAL(SelectLloydStep(100, 2, 50), "naive");
+
+  // Nearly as many clusters as points.
+  BOOST_REQUIRE_EQUAL(SelectLloydStep(100000, 5, 20000), "dtnn");
+
+  // Many clusters in low dimensions.
+  BOOST_REQUIRE_EQUAL(SelectLloydStep(1000000, 3, 100), "dualtree");
+
+  // Many clusters in high dimensions, with and without enough memory for the
+  // bounds.
+  const double memory = ElkanKMeansMemory(100000, 100);
+  BOOST_REQUIRE_GT(memory, 100000.0 * 100 * sizeof(double));
+  BOOST_REQUIRE_EQUAL(SelectLloydStep(100000, 100, 100), "elkan");
+  BOOST_REQUIRE_EQUAL(SelectLloydStep(100000, 100, 100,
+      (size_t) memory + 1), "elkan");
+  BOOST_REQUIRE_EQUAL(SelectLloydStep(100000, 100, 100,
+      (size_t) memory / 2), "hamerly");
+
+  // Few clusters.
+  BOOST_REQUIRE_EQUAL(SelectLloydStep(100000, 100, 10), "hamerly");
+  BOOST_REQUIRE_EQUAL(SelectLloydStep(100000, 3, 10), "hamerly");
+}
+
+/**
+ * A communicator which pretends there is a second process, holding an exact
+ * copy of this process's points.
+ */
+class DuplicatedCommunicator
+{
+ public:
+  size_t Rank() const { return 0; }
+  size_t Size() const { return 2; }
+  void Sum(arma::vec& values) { values *= 2; }
+  void Broadcast(arma::vec& /* values */) { }
+};
+
+/**
+ * Make sure that when the sums and counts are combined over several processes,
+ * K-Means gives the same result as on one process with all of the points.  The
+ * other process holds a copy of the points, so the combined means are the same
+ * as the local ones.
+ */
+template<template<class, class> class LloydStepType>
+void CheckDistributedKMeans()
+{
+  arma::mat dataset(4, 2000);
+  dataset.randu();
+  arma::mat initialCentroids(4, 8);
+  initialCentroids.randu();
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      LloydStepType> local;
+  arma::Col<size_t> assignments;
+  arma::mat centroids(initialCentroids);
+  local.Cluster(dataset, 8, assignments, centroids, false, true);
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      LloydStepType, arma::mat, DuplicatedCommunicator> distributed;
+  BOOST_REQUIRE_EQUAL(distributed.Communicator().Size(), 2);
+  arma::Col<size_t> distributedAssignments;
+  arma::mat distributedCentroids(initialCentroids);
+  distributed.Cluster(dataset, 8, distributedAssignments, distributedCentroids,
+      false, true);
+
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], distributedAssignments[i]);
+  for (size_t i = 0; i < centroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(centroids[i], distributedCentroids[i], 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(DistributedKMeansTest)
+{
+  CheckDistributedKMeans<NaiveKMeans>();
+  CheckDistributedKMeans<ElkanKMeans>();
+  CheckDistributedKMeans<HamerlyKMeans>();
+  CheckDistributedKMeans<DefaultDualTreeKMeans>();
+}
+
+/**
+ * Make sure that Elkan's and Hamerly's algorithms stay exact when the centroids
+ * are changed between iterations, as the combining step of distributed K-Means
+ * and the empty cluster policies do.
+ */
+template<template<class, class> class LloydStepType>
+void CheckChangedCentroids()
+{
+  arma::mat dataset(3, 1000);
+  dataset.randu();
+  arma::mat centroids(3, 6);
+  centroids.randu();
+
+  metric::EuclideanDistance metric;
+  LloydStepType<metric::EuclideanDistance, arma::mat> step(dataset, metric);
+  arma::mat newCentroids;
+  arma::Col<size_t> counts;
+  step.Iterate(centroids, newCentroids, counts);
+
+  // Move the new centroids somewhere else, and iterate from there.
+  newCentroids += 0.1 * arma::randn<arma::mat>(3, 6);
+  arma::mat stepCentroids;
+  step.Iterate(newCentroids, stepCentroids, counts);
+
+  NaiveKMeans<metric::EuclideanDistance, arma::mat> naive(dataset, metric);
+  arma::mat naiveCentroids;
+  arma::Col<size_t> naiveCounts;
+  naive.Iterate(newCentroids, naiveCentroids, naiveCounts);
+
+  for (size_t c = 0; c < counts.n_elem; ++c)
+    BOOST_REQUIRE_EQUAL(counts[c], naiveCounts[c]);
+  for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(stepCentroids[i], naiveCentroids[i], 1e-5);
+}
+
+BOOST_AUTO_TEST_CASE(ChangedCentroidsTest)
+{
+  CheckChangedCentroids<ElkanKMeans>();
+  CheckChangedCentroids<HamerlyKMeans>();
+}
+
+/**
+ * Make sure that the offloaded naive Lloyd step finds the same clusters as the
+ * naive Lloyd step, also when a centroid has been left invalid by an empty
+ * cluster.
+ */
+BOOST_AUTO_TEST_CASE(OffloadedNaiveKMeansTest)
+{
+  arma::mat dataset(10, 5000);
+  dataset.randu();
+  dataset += 100.0;
+
+  arma::mat centroids(10, 9);
+  centroids.randu();
+  centroids += 100.0;
+  centroids.col(4).fill(DBL_MAX);
+
+  metric::EuclideanDistance metric;
+  NaiveKMeans<metric::EuclideanDistance, arma::mat> naive(dataset, metric);
+  arma::mat naiveCentroids;
+  arma::Col<size_t> naiveCounts;
+  naive.Iterate(centroids, naiveCentroids, naiveCounts);
+
+  NaiveKMeans<metric::EuclideanDistance, arma::mat> offloaded(dataset, metric);
+  offloaded.Offload() = true;
+  arma::mat offloadedCentroids;
+  arma::Col<size_t> offloadedCounts;
+  offloaded.Iterate(centroids, offloadedCentroids, offloadedCounts);
+
+  BOOST_REQUIRE_EQUAL(offloadedCounts[4], (size_t) 0);
+  for (size_t c = 0; c < naiveCounts.n_elem; ++c)
+    BOOST_REQUIRE_EQUAL(naiveCounts[c], offloadedCounts[c]);
+  for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(naiveCentroids[i], offloadedCentroids[i], 1e-5);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
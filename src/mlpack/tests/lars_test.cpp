@@ -50,7 +50,11 @@ void LARSVerifyCorrectness(arma::vec beta, arma::vec errCorr, double lambda)
 }
 
 
-void LassoTest(size_t nPoints, size_t nDims, bool elasticNet, bool useCholesky)
+void LassoTest(size_t nPoints,
+               size_t nDims,
+               bool elasticNet,
+               bool useCholesky,
+               bool cacheGram = true)
 {
   arma::mat X;
   arma::vec y;
@@ -70,6 +74,7 @@ void LassoTest(size_t nPoints, size_t nDims, bool elasticNet, bool useCholesky)
 
 
     LARS lars(useCholesky, lambda1, lambda2);
+    lars.CacheGram() = cacheGram;
     arma::vec betaOpt;
     lars.Regress(X, y, betaOpt);
 
@@ -104,6 +109,65 @@ BOOST_AUTO_TEST_CASE(LARSTestElasticNetGram)
   LassoTest(100, 10, true, false);
 }
 
+BOOST_AUTO_TEST_CASE(LARSTestLassoCholeskyNoGramCache)
+{
+  LassoTest(100, 10, false, true, false);
+}
+
+
+BOOST_AUTO_TEST_CASE(LARSTestLassoGramNoGramCache)
+{
+  LassoTest(100, 10, false, false, false);
+}
+
+
+BOOST_AUTO_TEST_CASE(LARSTestElasticNetCholeskyNoGramCache)
+{
+  LassoTest(100, 10, true, true, false);
+}
+
+
+BOOST_AUTO_TEST_CASE(LARSTestElasticNetGramNoGramCache)
+{
+  LassoTest(100, 10, true, false, false);
+}
+
+// Make sure that not storing the solution path, and computing the correlations
+// with several threads, does not change the solution.
+BOOST_AUTO_TEST_CASE(LARSTestNoStorePath)
+{
+  arma::mat X;
+  arma::vec y;
+  GenerateProblem(X, y, 100, 20);
+
+  arma::vec sortedAbsCorr = sort(abs(X * y));
+  const double lambda1 = sortedAbsCorr(10);
+
+  LARS lars(true, lambda1);
+  arma::vec beta;
+  lars.Regress(X, y, beta);
+
+  LARS larsNoPath(true, lambda1);
+  larsNoPath.StorePath() = false;
+  larsNoPath.Threads() = 2;
+  arma::vec betaNoPath;
+  larsNoPath.Regress(X, y, betaNoPath);
+
+  BOOST_REQUIRE_LE(larsNoPath.BetaPath().size(), 2);
+  BOOST_REQUIRE_EQUAL(larsNoPath.BetaPath().size(),
+      larsNoPath.LambdaPath().size());
+  BOOST_REQUIRE_CLOSE(larsNoPath.LambdaPath().back(), lambda1, 1e-10);
+
+  BOOST_REQUIRE_EQUAL(beta.n_elem, betaNoPath.n_elem);
+  for (size_t i = 0; i < beta.n_elem; ++i)
+  {
+    if (std::abs(beta[i]) < 1e-10)
+      BOOST_REQUIRE_SMALL(betaNoPath[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(beta[i], betaNoPath[i], 1e-8);
+  }
+}
+
 // Ensure that LARS doesn't crash when the data has linearly dependent features
 // (meaning that there is a singularity).  This test uses the Cholesky
 // factorization.
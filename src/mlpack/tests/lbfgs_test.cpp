@@ -112,4 +112,28 @@ BOOST_AUTO_TEST_CASE(RosenbrockWoodFunctionTest)
   }
 }
 
+/**
+ * Make sure that evaluating several line search step sizes at once takes the
+ * same steps as the sequential line search.
+ */
+BOOST_AUTO_TEST_CASE(ParallelLineSearchTest)
+{
+  GeneralizedRosenbrockFunction f(64);
+  L_BFGS<GeneralizedRosenbrockFunction> lbfgs1(f, 20);
+  L_BFGS<GeneralizedRosenbrockFunction> lbfgs2(f, 20);
+  lbfgs1.MaxIterations() = 10000;
+  lbfgs2.MaxIterations() = 10000;
+  lbfgs2.LineSearchThreads() = 4;
+
+  arma::vec coords1 = f.GetInitialPoint();
+  arma::vec coords2 = f.GetInitialPoint();
+  const double value1 = lbfgs1.Optimize(coords1);
+  const double value2 = lbfgs2.Optimize(coords2);
+
+  BOOST_REQUIRE_SMALL(value2, 1e-5);
+  BOOST_REQUIRE_EQUAL(value1, value2);
+  for (size_t j = 0; j < coords1.n_elem; j++)
+    BOOST_REQUIRE_EQUAL(coords1[j], coords2[j]);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
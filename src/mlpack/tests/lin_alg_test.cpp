@@ -185,4 +185,77 @@ BOOST_AUTO_TEST_CASE(TestRemoveRows)
   }
 }
 
+/**
+ * Make sure that Covariance() gives the same mean and covariance as the
+ * straightforward computation, for any number of threads, even when the data
+ * is far from the origin.
+ */
+BOOST_AUTO_TEST_CASE(TestCovariance)
+{
+  mat data = randu<mat>(5, 5000);
+  data.row(2) += 1e4;
+
+  mat centered;
+  Center(data, centered);
+  const mat trueCovariance = centered * trans(centered) / (data.n_cols - 1);
+  const vec trueMean = mean(data, 1);
+
+  for (size_t threads = 0; threads <= 4; ++threads)
+  {
+    mat covariance;
+    vec dataMean;
+    Covariance(data, covariance, dataMean, threads);
+
+    BOOST_REQUIRE_EQUAL(covariance.n_rows, 5);
+    BOOST_REQUIRE_EQUAL(covariance.n_cols, 5);
+    BOOST_REQUIRE_EQUAL(dataMean.n_elem, 5);
+    for (size_t i = 0; i < 5; ++i)
+    {
+      BOOST_REQUIRE_CLOSE(dataMean[i], trueMean[i], 1e-8);
+      for (size_t j = 0; j < 5; ++j)
+      {
+        if (std::abs(trueCovariance(i, j)) < 1e-5)
+          BOOST_REQUIRE_SMALL(covariance(i, j), 1e-5);
+        else
+          BOOST_REQUIRE_CLOSE(covariance(i, j), trueCovariance(i, j), 1e-5);
+      }
+    }
+  }
+}
+
+/**
+ * Make sure that whitening a matrix in place gives the same result as
+ * whitening it into another matrix.
+ */
+BOOST_AUTO_TEST_CASE(TestWhitenInPlace)
+{
+  mat data = randu<mat>(4, 3000);
+  data.row(1) += 2 * data.row(0);
+
+  mat whitened, whiteningMatrix, inPlace(data), inPlaceWhiteningMatrix;
+  WhitenUsingSVD(data, whitened, whiteningMatrix);
+  WhitenUsingSVD(inPlace, inPlace, inPlaceWhiteningMatrix);
+
+  BOOST_REQUIRE_EQUAL(inPlace.n_rows, whitened.n_rows);
+  BOOST_REQUIRE_EQUAL(inPlace.n_cols, whitened.n_cols);
+  for (size_t i = 0; i < whitened.n_elem; ++i)
+  {
+    if (std::abs(whitened[i]) < 1e-5)
+      BOOST_REQUIRE_SMALL(inPlace[i], 1e-5);
+    else
+      BOOST_REQUIRE_CLOSE(inPlace[i], whitened[i], 1e-8);
+  }
+
+  inPlace = data;
+  WhitenUsingEig(data, whitened, whiteningMatrix);
+  WhitenUsingEig(inPlace, inPlace, inPlaceWhiteningMatrix);
+  for (size_t i = 0; i < whitened.n_elem; ++i)
+  {
+    if (std::abs(whitened[i]) < 1e-5)
+      BOOST_REQUIRE_SMALL(inPlace[i], 1e-5);
+    else
+      BOOST_REQUIRE_CLOSE(inPlace[i], whitened[i], 1e-8);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -173,4 +173,87 @@ BOOST_AUTO_TEST_CASE(RidgeRegressionTestCase)
     BOOST_REQUIRE_SMALL(predictions(i) - responses(i), .05);
 }
 
+/**
+ * Make sure that training on chunks of the data with Update() gives the same
+ * model as training on all of it at once, for linear and ridge regression and
+ * with observation weights.
+ */
+BOOST_AUTO_TEST_CASE(StreamingLinearRegressionTest)
+{
+  arma::mat predictors = arma::randu<arma::mat>(5, 1000);
+  arma::vec responses = trans(arma::randu<arma::rowvec>(5) * predictors) +
+      0.1 * arma::randu<arma::vec>(1000);
+  arma::vec weights = arma::randu<arma::vec>(1000) + 0.5;
+
+  const double lambdas[] = { 0.0, 0.5 };
+  for (size_t l = 0; l < 2; ++l)
+  {
+    for (size_t w = 0; w < 2; ++w)
+    {
+      const arma::vec emptyWeights;
+      const arma::vec& chosenWeights = (w == 0) ? emptyWeights : weights;
+      LinearRegression lr(predictors, responses, lambdas[l], true,
+          chosenWeights);
+
+      LinearRegression streaming;
+      streaming.Lambda() = lambdas[l];
+      for (size_t begin = 0; begin < 1000; begin += 300)
+      {
+        const size_t end = std::min(begin + 300, (size_t) 1000) - 1;
+        if (w == 0)
+        {
+          streaming.Update(predictors.cols(begin, end),
+              responses.subvec(begin, end));
+        }
+        else
+        {
+          streaming.Update(predictors.cols(begin, end),
+              responses.subvec(begin, end), weights.subvec(begin, end));
+        }
+      }
+      streaming.Solve();
+
+      BOOST_REQUIRE_EQUAL(streaming.Parameters().n_elem,
+          lr.Parameters().n_elem);
+      for (size_t i = 0; i < lr.Parameters().n_elem; ++i)
+        BOOST_REQUIRE_CLOSE(streaming.Parameters()[i], lr.Parameters()[i],
+            1e-5);
+    }
+  }
+}
+
+/**
+ * Make sure that merging models trained on separate halves of the data gives
+ * the same model as training one model on all of it, for any number of
+ * threads.
+ */
+BOOST_AUTO_TEST_CASE(MergeLinearRegressionTest)
+{
+  arma::mat predictors = arma::randu<arma::mat>(4, 500);
+  arma::vec responses = arma::randu<arma::vec>(500);
+
+  LinearRegression all;
+  all.Update(predictors, responses);
+  all.Solve();
+
+  LinearRegression first, second;
+  first.Threads() = 1;
+  second.Threads() = 3;
+  first.Update(predictors.cols(0, 199), responses.subvec(0, 199));
+  second.Update(predictors.cols(200, 499), responses.subvec(200, 499));
+  first.Merge(second);
+  first.Solve();
+
+  BOOST_REQUIRE_EQUAL(first.Parameters().n_elem, 5);
+  for (size_t i = 0; i < 5; ++i)
+    BOOST_REQUIRE_CLOSE(first.Parameters()[i], all.Parameters()[i], 1e-5);
+
+  // Predictions from the merged model should be the same too.
+  arma::vec predictions, mergedPredictions;
+  all.Predict(predictors, predictions);
+  first.Predict(predictors, mergedPredictions);
+  for (size_t i = 0; i < 500; ++i)
+    BOOST_REQUIRE_CLOSE(predictions[i], mergedPredictions[i], 1e-5);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -248,6 +248,159 @@ BOOST_AUTO_TEST_CASE(LoadCSVTxtTest)
   remove("test_file.txt");
 }
 
+/**
+ * Make sure the text parser handles lines split across many chunks, blank
+ * lines, carriage returns and empty CSV fields.
+ */
+BOOST_AUTO_TEST_CASE(LoadTextChunkTest)
+{
+  arma::mat expected = arma::randu<arma::mat>(7, 300);
+  expected.col(5).zeros(); // Written as empty fields below.
+  expected.col(9).fill(-1e-200);
+
+  std::ostringstream csv;
+  std::ostringstream ascii;
+  csv.precision(17);
+  ascii.precision(17);
+  for (size_t i = 0; i < expected.n_cols; ++i)
+  {
+    for (size_t j = 0; j < expected.n_rows; ++j)
+    {
+      if (i != 5)
+        csv << expected(j, i);
+      csv << ((j + 1 < expected.n_rows) ? "," : "\r\n");
+      ascii << "  " << expected(j, i) << ((j % 2 == 0) ? "\t" : " ");
+    }
+    ascii << "\n";
+    if (i % 50 == 0)
+    {
+      csv << "\n";
+      ascii << " \t\n";
+    }
+  }
+
+  // A chunk of 64 characters is shorter than a line.
+  for (size_t chunk = 64; chunk <= 65536; chunk *= 32)
+  {
+    std::istringstream csvStream(csv.str());
+    arma::mat test;
+    BOOST_REQUIRE(data::LoadText(csvStream, test, true, true, chunk));
+    BOOST_REQUIRE_EQUAL(test.n_rows, expected.n_rows);
+    BOOST_REQUIRE_EQUAL(test.n_cols, expected.n_cols);
+    for (size_t i = 0; i < expected.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(test[i], expected[i]);
+
+    std::istringstream asciiStream(ascii.str());
+    BOOST_REQUIRE(data::LoadText(asciiStream, test, false, false, chunk));
+    BOOST_REQUIRE_EQUAL(test.n_rows, expected.n_cols);
+    BOOST_REQUIRE_EQUAL(test.n_cols, expected.n_rows);
+    for (size_t i = 0; i < expected.n_rows; ++i)
+      for (size_t j = 0; j < expected.n_cols; ++j)
+        BOOST_REQUIRE_EQUAL(test(j, i), expected(i, j));
+  }
+}
+
+/**
+ * Make sure a malformed CSV or TSV file fails to load.
+ */
+BOOST_AUTO_TEST_CASE(LoadBadTextTest)
+{
+  std::fstream f;
+  f.open("test_file.csv", std::fstream::out);
+  f << "1, 2, 3" << std::endl << "4, 5" << std::endl;
+  f.close();
+
+  arma::mat test;
+  BOOST_REQUIRE(data::Load("test_file.csv", test) == false);
+
+  f.open("test_file.csv", std::fstream::out);
+  f << "1, 2, 3" << std::endl << "4, x, 6" << std::endl;
+  f.close();
+
+  BOOST_REQUIRE(data::Load("test_file.csv", test) == false);
+
+  // TSV files are whitespace-separated.
+  f.open("test_file.tsv", std::fstream::out);
+  f << "1\t2\t3" << std::endl << "4\t5\t6" << std::endl;
+  f.close();
+
+  BOOST_REQUIRE(data::Load("test_file.tsv", test) == true);
+  BOOST_REQUIRE_EQUAL(test.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(test.n_cols, 2);
+  for (int i = 0; i < 6; i++)
+    BOOST_REQUIRE_CLOSE(test[i], (double) (i + 1), 1e-5);
+
+  remove("test_file.csv");
+  remove("test_file.tsv");
+}
+
+/**
+ * Make sure sparse matrices are loaded correctly from coordinate lists, Matrix
+ * Market files and libsvm files.
+ */
+BOOST_AUTO_TEST_CASE(LoadSparseTest)
+{
+  // Three points in four dimensions, stored one point per row.
+  arma::mat expected = "0.0 1.5 0.0 3.0;"
+                       "0.0 0.0 0.0 0.0;"
+                       "-2.0 0.0 0.0 0.5";
+  expected = trans(expected);
+
+  std::fstream f;
+  f.open("test_file.coo", std::fstream::out);
+  f << "0 1 1.5" << std::endl << "0, 3, 3.0" << std::endl << std::endl
+      << "2 0 -2" << std::endl << "2 3 0.5" << std::endl;
+  f.close();
+
+  f.open("test_file.mtx", std::fstream::out);
+  f << "%%MatrixMarket matrix coordinate real general" << std::endl
+      << "% A comment." << std::endl << "3 4 4" << std::endl << "1 2 1.5"
+      << std::endl << "1 4 3.0" << std::endl << "3 1 -2" << std::endl
+      << "3 4 0.5" << std::endl;
+  f.close();
+
+  f.open("test_file.svm", std::fstream::out);
+  f << "1 2:1.5 4:3.0" << std::endl << "-1" << std::endl
+      << "2 1:-2 4:0.5 # A comment." << std::endl;
+  f.close();
+
+  const char* files[] = { "test_file.coo", "test_file.mtx", "test_file.svm" };
+  for (size_t file = 0; file < 3; ++file)
+  {
+    arma::sp_mat test;
+    BOOST_REQUIRE(data::Load(files[file], test) == true);
+    BOOST_REQUIRE_EQUAL(test.n_rows, 4);
+    BOOST_REQUIRE_EQUAL(test.n_cols, 3);
+    BOOST_REQUIRE_EQUAL(test.n_nonzero, 4);
+    for (size_t i = 0; i < expected.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(test[i], expected[i]);
+
+    // Not transposed.
+    BOOST_REQUIRE(data::Load(files[file], test, false, false) == true);
+    BOOST_REQUIRE_EQUAL(test.n_rows, 3);
+    BOOST_REQUIRE_EQUAL(test.n_cols, 4);
+    BOOST_REQUIRE_EQUAL(test(2, 0), -2.0);
+  }
+
+  arma::sp_mat test;
+  arma::vec labels;
+  BOOST_REQUIRE(data::LoadLibSVM("test_file.svm", test, labels) == true);
+  BOOST_REQUIRE_EQUAL(labels.n_elem, 3);
+  BOOST_REQUIRE_EQUAL(labels[0], 1.0);
+  BOOST_REQUIRE_EQUAL(labels[1], -1.0);
+  BOOST_REQUIRE_EQUAL(labels[2], 2.0);
+
+  // A malformed line is an error.
+  f.open("test_file.coo", std::fstream::out);
+  f << "0 1 1.5" << std::endl << "0 x 3.0" << std::endl;
+  f.close();
+  BOOST_REQUIRE(data::Load("test_file.coo", test) == false);
+
+  remove("test_file.coo");
+  remove("test_file.mtx");
+  remove("test_file.svm");
+}
+
 /**
  * Make sure arma_binary is loaded correctly.
  */
@@ -299,6 +452,107 @@ BOOST_AUTO_TEST_CASE(SaveArmaBinaryTest)
   remove("test_file.bin");
 }
 
+/**
+ * Make sure InplaceTranspose() gives the same result as trans().
+ */
+BOOST_AUTO_TEST_CASE(InplaceTransposeTest)
+{
+  const size_t shapes[][2] = { { 1, 1 }, { 1, 9 }, { 9, 1 }, { 70, 70 },
+                               { 3, 50 }, { 64, 17 }, { 0, 5 } };
+  for (size_t s = 0; s < 7; ++s)
+  {
+    arma::mat test = arma::randu<arma::mat>(shapes[s][0], shapes[s][1]);
+    const arma::mat expected = trans(test);
+    const double* mem = test.memptr();
+
+    data::InplaceTranspose(test);
+
+    BOOST_REQUIRE_EQUAL(test.memptr(), mem);
+    BOOST_REQUIRE_EQUAL(test.n_rows, expected.n_rows);
+    BOOST_REQUIRE_EQUAL(test.n_cols, expected.n_cols);
+    for (size_t i = 0; i < expected.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(test[i], expected[i]);
+  }
+}
+
+/**
+ * Make sure transposed Armadillo binary files larger than one block are saved
+ * and loaded correctly.
+ */
+BOOST_AUTO_TEST_CASE(TransposedArmaBinaryTest)
+{
+  arma::mat test = arma::randu<arma::mat>(3, 70000);
+  BOOST_REQUIRE(data::Save("test_file.bin", test) == true);
+
+  // The file holds the transpose.
+  arma::mat file;
+  BOOST_REQUIRE(file.load("test_file.bin", arma::arma_binary));
+  BOOST_REQUIRE_EQUAL(file.n_rows, 70000);
+  BOOST_REQUIRE_EQUAL(file.n_cols, 3);
+  for (size_t i = 0; i < test.n_rows; ++i)
+    for (size_t j = 0; j < test.n_cols; ++j)
+      BOOST_REQUIRE_EQUAL(file(j, i), test(i, j));
+
+  arma::mat test2;
+  BOOST_REQUIRE(data::Load("test_file.bin", test2) == true);
+  BOOST_REQUIRE_EQUAL(test2.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(test2.n_cols, 70000);
+  for (size_t i = 0; i < test.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(test2[i], test[i]);
+
+  remove("test_file.bin");
+}
+
+/**
+ * Make sure gzip and zstd compressed files can be saved and loaded (for
+ * whichever compressions mlpack was built with), and that a compressed file
+ * which can't be used gives an error.
+ */
+BOOST_AUTO_TEST_CASE(CompressedLoadSaveTest)
+{
+  // Integers survive the trip through a text file exactly.
+  arma::mat test = arma::floor(1000.0 * arma::randu<arma::mat>(4, 70000));
+
+  const data::Compression compressions[] = { data::GZIP_COMPRESSION,
+                                             data::ZSTD_COMPRESSION };
+  const char* extensions[] = { ".gz", ".zst" };
+  const char* names[] = { "test_file.csv", "test_file.bin" };
+  for (size_t c = 0; c < 2; ++c)
+  {
+    for (size_t n = 0; n < 2; ++n)
+    {
+      const std::string filename = std::string(names[n]) + extensions[c];
+      if (!data::CompressionSupported(compressions[c]))
+      {
+        BOOST_REQUIRE(data::Save(filename, test) == false);
+        continue;
+      }
+
+      BOOST_REQUIRE(data::Save(filename, test) == true);
+
+      arma::mat test2;
+      BOOST_REQUIRE(data::Load(filename, test2) == true);
+      BOOST_REQUIRE_EQUAL(test2.n_rows, 4);
+      BOOST_REQUIRE_EQUAL(test2.n_cols, 70000);
+      for (size_t i = 0; i < test.n_elem; ++i)
+        BOOST_REQUIRE_EQUAL(test2[i], test[i]);
+
+      remove(filename.c_str());
+    }
+  }
+
+  // A file which is not actually compressed can't be loaded.
+  std::fstream f;
+  f.open("test_file.csv.gz", std::fstream::out);
+  f << "1, 2, 3" << std::endl;
+  f.close();
+
+  arma::mat test3;
+  BOOST_REQUIRE(data::Load("test_file.csv.gz", test3) == false);
+
+  remove("test_file.csv.gz");
+}
+
 /**
  * Make sure raw_binary is loaded correctly.
  */
@@ -326,6 +580,67 @@ BOOST_AUTO_TEST_CASE(LoadRawBinaryTest)
   remove("test_file.bin");
 }
 
+/**
+ * Make sure raw binary files are mapped correctly, without any copy.
+ */
+BOOST_AUTO_TEST_CASE(MapRawBinaryTest)
+{
+  arma::mat test = arma::randu<arma::mat>(4, 50);
+  BOOST_REQUIRE(test.quiet_save("test_file.bin", arma::raw_binary) == true);
+
+  data::MappedMatrix mapped;
+  BOOST_REQUIRE(mapped.Map("test_file.bin", false, 4) == true);
+#if defined(__unix__) || defined(__APPLE__)
+  BOOST_REQUIRE(mapped.IsMapped());
+
+  // The matrix has to use the mapped pages themselves, not a copy of them.
+  const char* begin = (const char*) mapped.Address();
+  const char* elements = (const char*) mapped.Matrix().memptr();
+  BOOST_REQUIRE(elements >= begin);
+  BOOST_REQUIRE(elements + sizeof(double) * mapped.Matrix().n_elem <=
+      begin + mapped.Length());
+#endif
+
+  BOOST_REQUIRE_EQUAL(mapped.Matrix().n_rows, 4);
+  BOOST_REQUIRE_EQUAL(mapped.Matrix().n_cols, 50);
+  for (size_t i = 0; i < test.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(mapped.Matrix()[i], test[i]);
+
+  // Without a number of rows, the file is a single column.
+  BOOST_REQUIRE(data::Load("test_file.bin", mapped) == true);
+  BOOST_REQUIRE_EQUAL(mapped.Matrix().n_rows, 200);
+  BOOST_REQUIRE_EQUAL(mapped.Matrix().n_cols, 1);
+
+  mapped.Unmap();
+  BOOST_REQUIRE_EQUAL(mapped.Matrix().n_elem, 0);
+  BOOST_REQUIRE(!mapped.IsMapped());
+
+  // Remove the file.
+  remove("test_file.bin");
+}
+
+/**
+ * Make sure Armadillo binary files give the stored matrix whether or not they
+ * can be mapped.
+ */
+BOOST_AUTO_TEST_CASE(MapArmaBinaryTest)
+{
+  for (size_t cols = 1; cols < 20; ++cols)
+  {
+    arma::mat test = arma::randu<arma::mat>(3, cols);
+    BOOST_REQUIRE(data::Save("test_file.bin", test, false, false) == true);
+
+    data::MappedMatrix mapped("test_file.bin");
+    BOOST_REQUIRE_EQUAL(mapped.Matrix().n_rows, 3);
+    BOOST_REQUIRE_EQUAL(mapped.Matrix().n_cols, cols);
+    for (size_t i = 0; i < test.n_elem; ++i)
+      BOOST_REQUIRE_CLOSE(mapped.Matrix()[i], test[i], 1e-10);
+  }
+
+  // Remove the file.
+  remove("test_file.bin");
+}
+
 /**
  * Make sure load as PGM is successful.
  */
@@ -563,4 +878,180 @@ BOOST_AUTO_TEST_CASE(NormalizeLabelTest)
     BOOST_REQUIRE_EQUAL(randLabels[i], revertedLabels[i]);
 }
 
+/**
+ * Label normalization with many different labels should give the labels in
+ * the order they are first seen.
+ */
+BOOST_AUTO_TEST_CASE(NormalizeManyLabelsTest)
+{
+  // 20000 different labels, each appearing five times.
+  arma::Col<size_t> labels(100000);
+  for (size_t i = 0; i < labels.n_elem; ++i)
+    labels[i] = 3 * ((i * 7919) % 20000) + 1;
+
+  arma::Col<size_t> newLabels;
+  arma::Col<size_t> mappings;
+  data::NormalizeLabels(labels, newLabels, mappings);
+
+  BOOST_REQUIRE_EQUAL(mappings.n_elem, 20000);
+  for (size_t i = 0; i < 20000; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(newLabels[i], i);
+    BOOST_REQUIRE_EQUAL(mappings[i], labels[i]);
+  }
+
+  arma::Col<size_t> revertedLabels;
+  data::RevertLabels(newLabels, mappings, revertedLabels);
+  for (size_t i = 0; i < labels.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(labels[i], revertedLabels[i]);
+}
+
+/**
+ * Make sure that the Hilbert and Morton orders are permutations which put
+ * nearby points together, and that Reorder() applies them correctly.
+ */
+BOOST_AUTO_TEST_CASE(SpaceFillingCurveOrderTest)
+{
+  arma::mat dataset(2, 2000);
+  dataset.randu();
+
+  // The length of the path through the points in their original (random)
+  // order.
+  double randomLength = 0.0;
+  for (size_t i = 1; i < dataset.n_cols; ++i)
+    randomLength += arma::norm(dataset.col(i) - dataset.col(i - 1), 2);
+
+  for (size_t curve = 0; curve < 2; ++curve)
+  {
+    std::vector<size_t> oldFromNew;
+    if (curve == 0)
+      data::HilbertOrder(dataset, oldFromNew);
+    else
+      data::MortonOrder(dataset, oldFromNew);
+
+    BOOST_REQUIRE_EQUAL(oldFromNew.size(), dataset.n_cols);
+    std::vector<bool> seen(dataset.n_cols, false);
+    for (size_t i = 0; i < oldFromNew.size(); ++i)
+    {
+      BOOST_REQUIRE_LT(oldFromNew[i], dataset.n_cols);
+      BOOST_REQUIRE(!seen[oldFromNew[i]]);
+      seen[oldFromNew[i]] = true;
+    }
+
+    arma::mat reordered(dataset);
+    data::Reorder(reordered, oldFromNew);
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(reordered(0, i), dataset(0, oldFromNew[i]));
+      BOOST_REQUIRE_EQUAL(reordered(1, i), dataset(1, oldFromNew[i]));
+    }
+
+    // The path along the curve should be far shorter.
+    double curveLength = 0.0;
+    for (size_t i = 1; i < reordered.n_cols; ++i)
+      curveLength += arma::norm(reordered.col(i) - reordered.col(i - 1), 2);
+    BOOST_REQUIRE_LT(curveLength, 0.2 * randomLength);
+  }
+
+  // Higher-dimensional data needs keys of more than one word.
+  arma::mat highDimensional(20, 500);
+  highDimensional.randu();
+  std::vector<size_t> oldFromNew;
+  data::HilbertOrder(highDimensional, oldFromNew);
+  std::vector<size_t> sorted(oldFromNew);
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t i = 0; i < sorted.size(); ++i)
+    BOOST_REQUIRE_EQUAL(sorted[i], i);
+}
+
+//! Pipeline loader which produces chunks holding 0, 1, ..., n - 1.
+class CountingLoader
+{
+ public:
+  CountingLoader(const size_t n) : n(n), next(0) { }
+
+  bool operator()(arma::vec& chunk)
+  {
+    if (next == n)
+      return false;
+
+    chunk.set_size(3);
+    chunk.fill(next++);
+    return true;
+  }
+
+ private:
+  size_t n;
+  size_t next;
+};
+
+//! Pipeline stage which doubles each chunk.
+class DoublingStage
+{
+ public:
+  void operator()(arma::vec& chunk, arma::vec& result) { result = 2 * chunk; }
+};
+
+//! Pipeline writer which keeps the first element of each result.
+class CollectingWriter
+{
+ public:
+  void operator()(arma::vec& result) { results.push_back(result[0]); }
+
+  std::vector<double> results;
+};
+
+/**
+ * Make sure every chunk goes through the pipeline once and in order, with and
+ * without overlapping the stages, and that an empty input works.
+ */
+BOOST_AUTO_TEST_CASE(PipelineOrderTest)
+{
+  for (size_t n = 0; n < 6; ++n)
+  {
+    for (size_t overlap = 0; overlap < 2; ++overlap)
+    {
+      data::Pipeline<arma::vec, arma::vec> pipeline(overlap == 1);
+      CountingLoader loader(n);
+      DoublingStage compute;
+      CollectingWriter writer;
+
+      BOOST_REQUIRE_EQUAL(pipeline.Run(loader, compute, writer), n);
+      BOOST_REQUIRE_EQUAL(writer.results.size(), n);
+      for (size_t i = 0; i < n; ++i)
+        BOOST_REQUIRE_CLOSE(writer.results[i], 2.0 * i, 1e-5);
+    }
+  }
+}
+
+/**
+ * Saving a matrix in chunks with SaveChunk() should give a file which loads as
+ * the whole matrix.  The matrix is large enough that its text is formatted in
+ * several blocks.
+ */
+BOOST_AUTO_TEST_CASE(SaveChunkTest)
+{
+  arma::mat test = arma::randu<arma::mat>(3, 50000);
+
+  std::ofstream stream("test_file.csv");
+  BOOST_REQUIRE(data::SaveChunk(stream, arma::mat(test.cols(0, 29999)),
+      arma::csv_ascii));
+  BOOST_REQUIRE(data::SaveChunk(stream, arma::mat(test.cols(30000, 49999)),
+      arma::csv_ascii));
+  stream.close();
+
+  // Binary formats can't be written in chunks.
+  std::ostringstream binaryStream;
+  BOOST_REQUIRE(!data::SaveChunk(binaryStream, test, arma::arma_binary));
+
+  arma::mat loaded;
+  BOOST_REQUIRE(data::Load("test_file.csv", loaded));
+  remove("test_file.csv");
+
+  BOOST_REQUIRE_EQUAL(loaded.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(loaded.n_cols, 50000);
+  for (size_t i = 0; i < test.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(loaded[i], test[i], 1e-5);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
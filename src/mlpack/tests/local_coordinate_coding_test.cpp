@@ -124,4 +124,40 @@ BOOST_AUTO_TEST_CASE(LocalCoordinateCodingTestWhole)
 */
 
 
+/**
+ * Make sure that the coding step gives the same codes whether the points are
+ * coded with one thread or with several.
+ */
+BOOST_AUTO_TEST_CASE(LocalCoordinateCodingTestCodingStepThreads)
+{
+  double lambda = 0.1;
+  uword nAtoms = 25;
+
+  mat X;
+  X.load("mnist_first250_training_4s_and_9s.arm");
+  uword nPoints = X.n_cols;
+
+  // normalize each point since these are images
+  for (uword i = 0; i < nPoints; i++)
+    X.col(i) /= norm(X.col(i), 2);
+
+  LocalCoordinateCoding<> lcc(X, nAtoms, lambda, 1);
+  LocalCoordinateCoding<sparse_coding::NothingInitializer> lccThreads(X,
+      nAtoms, lambda, 4);
+  lccThreads.Dictionary() = lcc.Dictionary();
+
+  lcc.OptimizeCode();
+  lccThreads.OptimizeCode();
+
+  BOOST_REQUIRE_EQUAL(lcc.Codes().n_rows, lccThreads.Codes().n_rows);
+  BOOST_REQUIRE_EQUAL(lcc.Codes().n_cols, lccThreads.Codes().n_cols);
+  for (uword i = 0; i < lcc.Codes().n_elem; ++i)
+  {
+    if (std::abs(lcc.Codes()[i]) < 1e-10)
+      BOOST_REQUIRE_SMALL(lccThreads.Codes()[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(lcc.Codes()[i], lccThreads.Codes()[i], 1e-8);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -29,7 +29,8 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionEvaluate)
   arma::vec responses("1 1 0");
 
   // Create a LogisticRegressionFunction.
-  LogisticRegressionFunction lrf(data, responses, 0.0 /* no regularization */);
+  LogisticRegressionFunction<> lrf(data, responses,
+      0.0 /* no regularization */);
 
   // These were hand-calculated using Octave.
   BOOST_REQUIRE_CLOSE(lrf.Evaluate(arma::vec("1 1 1")), 7.0562141665, 1e-5);
@@ -57,7 +58,8 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionRandomEvaluate)
   for (size_t i = 0; i < points; ++i)
     responses[i] = math::RandInt(0, 2);
 
-  LogisticRegressionFunction lrf(data, responses, 0.0 /* no regularization */);
+  LogisticRegressionFunction<> lrf(data, responses,
+      0.0 /* no regularization */);
 
   // Run a bunch of trials.
   for (size_t i = 0; i < trials; ++i)
@@ -99,9 +101,9 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionRegularizationEvaluate)
   for (size_t i = 0; i < points; ++i)
     responses[i] = math::RandInt(0, 2);
 
-  LogisticRegressionFunction lrfNoReg(data, responses, 0.0);
-  LogisticRegressionFunction lrfSmallReg(data, responses, 0.5);
-  LogisticRegressionFunction lrfBigReg(data, responses, 20.0);
+  LogisticRegressionFunction<> lrfNoReg(data, responses, 0.0);
+  LogisticRegressionFunction<> lrfSmallReg(data, responses, 0.5);
+  LogisticRegressionFunction<> lrfBigReg(data, responses, 20.0);
 
   for (size_t i = 0; i < trials; ++i)
   {
@@ -133,7 +135,8 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionGradient)
   arma::vec responses("1 1 0");
 
   // Create a LogisticRegressionFunction.
-  LogisticRegressionFunction lrf(data, responses, 0.0 /* no regularization */);
+  LogisticRegressionFunction<> lrf(data, responses,
+      0.0 /* no regularization */);
   arma::vec gradient;
 
   // If the model is at the optimum, then the gradient should be zero.
@@ -182,7 +185,8 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionSeparableEvaluate)
   arma::vec responses("1 1 0");
 
   // Create a LogisticRegressionFunction.
-  LogisticRegressionFunction lrf(data, responses, 0.0 /* no regularization */);
+  LogisticRegressionFunction<> lrf(data, responses,
+      0.0 /* no regularization */);
 
   // These were hand-calculated using Octave.
   BOOST_REQUIRE_CLOSE(lrf.Evaluate(arma::vec("1 1 1"), 0), 4.85873516e-2, 1e-5);
@@ -231,9 +235,9 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionRegularizationSeparableEvaluate)
   for (size_t i = 0; i < points; ++i)
     responses[i] = math::RandInt(0, 2);
 
-  LogisticRegressionFunction lrfNoReg(data, responses, 0.0);
-  LogisticRegressionFunction lrfSmallReg(data, responses, 0.5);
-  LogisticRegressionFunction lrfBigReg(data, responses, 20.0);
+  LogisticRegressionFunction<> lrfNoReg(data, responses, 0.0);
+  LogisticRegressionFunction<> lrfSmallReg(data, responses, 0.5);
+  LogisticRegressionFunction<> lrfBigReg(data, responses, 20.0);
 
   // Check that the number of functions is correct.
   BOOST_REQUIRE_EQUAL(lrfNoReg.NumFunctions(), points);
@@ -273,7 +277,8 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionSeparableGradient)
   arma::vec responses("1 1 0");
 
   // Create a LogisticRegressionFunction.
-  LogisticRegressionFunction lrf(data, responses, 0.0 /* no regularization */);
+  LogisticRegressionFunction<> lrf(data, responses,
+      0.0 /* no regularization */);
   arma::vec gradient;
 
   // If the model is at the optimum, then the gradient should be zero.
@@ -337,6 +342,142 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionSeparableGradient)
   BOOST_REQUIRE_SMALL(gradient[2], 1e-15);
 }
 
+/**
+ * Test that the full Evaluate() and Gradient() give the sums over the points,
+ * whichever parameters they were called with before (the sigmoids of the last
+ * parameters are kept).
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionCachedSigmoids)
+{
+  const arma::mat data = arma::randu<arma::mat>(5, 100);
+  arma::vec responses(100);
+  for (size_t i = 0; i < 100; ++i)
+    responses[i] = (data(0, i) + data(1, i) > 1.0) ? 1 : 0;
+
+  LogisticRegressionFunction<> lrf(data, responses, 0.3);
+  const arma::vec parameters1 = arma::randn<arma::vec>(6);
+  const arma::vec parameters2 = arma::randn<arma::vec>(6);
+
+  // The sums of the separable functions, computed independently.
+  double objective1 = 0.0, objective2 = 0.0;
+  arma::mat gradient1 = arma::zeros<arma::mat>(6, 1);
+  arma::mat gradient2 = arma::zeros<arma::mat>(6, 1);
+  arma::mat pointGradient;
+  for (size_t i = 0; i < 100; ++i)
+  {
+    objective1 += lrf.Evaluate(parameters1, i);
+    objective2 += lrf.Evaluate(parameters2, i);
+    lrf.Gradient(parameters1, i, pointGradient);
+    gradient1 += pointGradient;
+    lrf.Gradient(parameters2, i, pointGradient);
+    gradient2 += pointGradient;
+  }
+
+  arma::mat gradient;
+  BOOST_REQUIRE_CLOSE(lrf.Evaluate(parameters1), objective1, 1e-8);
+  lrf.Gradient(parameters1, gradient);
+  for (size_t j = 0; j < 6; ++j)
+    BOOST_REQUIRE_CLOSE(gradient[j], gradient1[j], 1e-8);
+
+  lrf.Gradient(parameters2, gradient);
+  for (size_t j = 0; j < 6; ++j)
+    BOOST_REQUIRE_CLOSE(gradient[j], gradient2[j], 1e-8);
+  BOOST_REQUIRE_CLOSE(lrf.Evaluate(parameters2), objective2, 1e-8);
+  BOOST_REQUIRE_CLOSE(lrf.Evaluate(parameters1), objective1, 1e-8);
+
+  // A point classified wrongly with great confidence gives a large but finite
+  // objective.
+  const arma::vec extreme("1000 -1000 -1000 -1000 -1000 -1000");
+  const double objective = lrf.Evaluate(extreme);
+  BOOST_REQUIRE(objective == objective);
+  BOOST_REQUIRE_LT(objective, DBL_MAX);
+  BOOST_REQUIRE_GT(objective, 1000.0);
+}
+
+/**
+ * Test that the batch Gradient() is the sum of the separable gradients.
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionBatchGradient)
+{
+  const arma::mat data = arma::randu<arma::mat>(5, 100);
+  arma::vec responses(100);
+  for (size_t i = 0; i < 100; ++i)
+    responses[i] = (data(0, i) + data(1, i) > 1.0) ? 1 : 0;
+
+  LogisticRegressionFunction<> lrf(data, responses, 0.7);
+  const arma::vec parameters = arma::randn<arma::vec>(6);
+
+  arma::mat gradient, pointGradient;
+  lrf.Gradient(parameters, 20, 30, gradient);
+
+  arma::mat sum = arma::zeros<arma::mat>(6, 1);
+  for (size_t i = 20; i < 50; ++i)
+  {
+    lrf.Gradient(parameters, i, pointGradient);
+    sum += pointGradient;
+  }
+
+  BOOST_REQUIRE_EQUAL(gradient.n_elem, 6);
+  for (size_t i = 0; i < 6; ++i)
+    BOOST_REQUIRE_CLOSE(gradient[i], sum[i], 1e-8);
+}
+
+/**
+ * Test that the sparse Gradient() plus the regularization of Regularization()
+ * is the separable gradient, and that it is zero outside of Support().
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionSparseGradient)
+{
+  // Keep about a third of the features of each point.
+  arma::mat data = arma::randu<arma::mat>(10, 50);
+  data.elem(arma::find(data < 0.66)).zeros();
+  data.col(0).zeros();
+  arma::vec responses(50);
+  for (size_t i = 0; i < 50; ++i)
+    responses[i] = (arma::accu(data.col(i)) > 2.5) ? 1 : 0;
+
+  LogisticRegressionFunction<> lrf(data, responses, 0.7);
+  const arma::vec parameters = arma::randn<arma::vec>(11);
+
+  arma::mat lambdas;
+  lrf.Regularization(lambdas);
+  BOOST_REQUIRE_EQUAL(lambdas.n_elem, 11);
+  BOOST_REQUIRE_SMALL(lambdas[0], 1e-15);
+  for (size_t j = 1; j < 11; ++j)
+    BOOST_REQUIRE_CLOSE(lambdas[j], 0.7 / 50, 1e-8);
+
+  arma::mat gradient;
+  arma::sp_mat sparseGradient;
+  arma::uvec support;
+  for (size_t i = 0; i < 50; ++i)
+  {
+    lrf.Gradient(parameters, i, gradient);
+    lrf.Gradient(parameters, i, sparseGradient);
+    lrf.Support(i, support);
+
+    BOOST_REQUIRE_EQUAL(support.n_elem, arma::accu(data.col(i) != 0) + 1);
+    BOOST_REQUIRE_EQUAL(support[0], 0);
+    for (size_t k = 1; k < support.n_elem; ++k)
+      BOOST_REQUIRE(data(support[k] - 1, i) != 0);
+
+    BOOST_REQUIRE_EQUAL(sparseGradient.n_rows, 11);
+    BOOST_REQUIRE_EQUAL(sparseGradient.n_cols, 1);
+    BOOST_REQUIRE_LE(sparseGradient.n_nonzero, support.n_elem);
+    for (size_t j = 0; j < 11; ++j)
+    {
+      // Without the regularization, features the point doesn't have give a
+      // zero gradient.
+      const double expected = gradient[j] - lambdas[j] * parameters[j];
+      if (j > 0 && data(j - 1, i) == 0)
+        BOOST_REQUIRE_SMALL(expected, 1e-10);
+      if (std::abs(expected) < 1e-10)
+        BOOST_REQUIRE_SMALL((double) sparseGradient(j, 0), 1e-10);
+      else
+        BOOST_REQUIRE_CLOSE((double) sparseGradient(j, 0), expected, 1e-6);
+    }
+  }
+}
+
 /**
  * Test Gradient() function when regularization is used.
  */
@@ -354,9 +495,9 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionRegularizationGradient)
   for (size_t i = 0; i < points; ++i)
     responses[i] = math::RandInt(0, 2);
 
-  LogisticRegressionFunction lrfNoReg(data, responses, 0.0);
-  LogisticRegressionFunction lrfSmallReg(data, responses, 0.5);
-  LogisticRegressionFunction lrfBigReg(data, responses, 20.0);
+  LogisticRegressionFunction<> lrfNoReg(data, responses, 0.0);
+  LogisticRegressionFunction<> lrfSmallReg(data, responses, 0.5);
+  LogisticRegressionFunction<> lrfBigReg(data, responses, 20.0);
 
   for (size_t i = 0; i < trials; ++i)
   {
@@ -416,9 +557,9 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionRegularizationSeparableGradient)
   for (size_t i = 0; i < points; ++i)
     responses[i] = math::RandInt(0, 2);
 
-  LogisticRegressionFunction lrfNoReg(data, responses, 0.0);
-  LogisticRegressionFunction lrfSmallReg(data, responses, 0.5);
-  LogisticRegressionFunction lrfBigReg(data, responses, 20.0);
+  LogisticRegressionFunction<> lrfNoReg(data, responses, 0.0);
+  LogisticRegressionFunction<> lrfSmallReg(data, responses, 0.5);
+  LogisticRegressionFunction<> lrfBigReg(data, responses, 20.0);
 
   for (size_t i = 0; i < trials; ++i)
   {
@@ -497,8 +638,8 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionSGDSimpleTest)
 
   // Create a logistic regression object using a custom SGD object with a much
   // smaller tolerance.
-  LogisticRegressionFunction lrf(data, responses, 0.001);
-  SGD<LogisticRegressionFunction> sgd(lrf, 0.005, 500000, 1e-10);
+  LogisticRegressionFunction<> lrf(data, responses, 0.001);
+  SGD<LogisticRegressionFunction<> > sgd(lrf, 0.005, 500000, 1e-10);
   LogisticRegression<SGD> lr(sgd);
 
   // Test sigmoid function.
@@ -546,8 +687,8 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionSGDRegularizationSimpleTest)
 
   // Create a logistic regression object using custom SGD with a much smaller
   // tolerance.
-  LogisticRegressionFunction lrf(data, responses, 0.001);
-  SGD<LogisticRegressionFunction> sgd(lrf, 0.005, 500000, 1e-10);
+  LogisticRegressionFunction<> lrf(data, responses, 0.001);
+  SGD<LogisticRegressionFunction<> > sgd(lrf, 0.005, 500000, 1e-10);
   LogisticRegression<SGD> lr(sgd);
 
   // Test sigmoid function.
@@ -655,6 +796,105 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionSGDGaussianTest)
   BOOST_REQUIRE_CLOSE(testAcc, 100.0, 0.6); // 0.6% error tolerance.
 }
 
+/**
+ * Train logistic regression with mini-batch SGD on a two-Gaussian dataset.
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionMiniBatchSGDGaussianTest)
+{
+  // Generate a two-Gaussian dataset.
+  GaussianDistribution g1(arma::vec("1.0 1.0 1.0"), arma::eye<arma::mat>(3, 3));
+  GaussianDistribution g2(arma::vec("9.0 9.0 9.0"), arma::eye<arma::mat>(3, 3));
+
+  arma::mat data(3, 1000);
+  arma::vec responses(1000);
+  for (size_t i = 0; i < 500; ++i)
+  {
+    data.col(i) = g1.Random();
+    responses[i] = 0;
+  }
+  for (size_t i = 500; i < 1000; ++i)
+  {
+    data.col(i) = g2.Random();
+    responses[i] = 1;
+  }
+
+  // Each step uses 50 points.
+  LogisticRegressionFunction<> lrf(data, responses, 0.5);
+  SGD<LogisticRegressionFunction<> > sgd(lrf, 0.01, 1000000, 1e-5, true, 50);
+  BOOST_REQUIRE_EQUAL(sgd.BatchSize(), 50);
+  LogisticRegression<SGD> lr(sgd);
+
+  const double acc = lr.ComputeAccuracy(data, responses);
+  BOOST_REQUIRE_CLOSE(acc, 100.0, 0.3); // 0.3% error tolerance.
+}
+
+/**
+ * A LogisticRegressionFunction without the sparse gradient, so that SGD takes
+ * dense steps with it.
+ */
+class DenseLogisticRegressionFunction
+{
+ public:
+  DenseLogisticRegressionFunction(
+      const LogisticRegressionFunction<>& function) : function(function) { }
+
+  size_t NumFunctions() const { return function.NumFunctions(); }
+
+  double Evaluate(const arma::mat& parameters, const size_t i) const
+  {
+    return function.Evaluate(parameters, i);
+  }
+
+  void Gradient(const arma::mat& parameters,
+                const size_t i,
+                arma::mat& gradient) const
+  {
+    function.Gradient(parameters, i, gradient);
+  }
+
+ private:
+  const LogisticRegressionFunction<>& function;
+};
+
+/**
+ * Make sure that SGD with sparse steps and lazy regularization finds the same
+ * parameters as SGD with dense steps, on data with sparse features.
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionSparseSGDTest)
+{
+  arma::mat data = arma::randu<arma::mat>(30, 200);
+  data.elem(arma::find(data < 0.8)).zeros();
+  arma::vec responses(200);
+  for (size_t i = 0; i < 200; ++i)
+    responses[i] = (arma::accu(data.rows(0, 14).col(i)) >
+        arma::accu(data.rows(15, 29).col(i))) ? 1 : 0;
+
+  LogisticRegressionFunction<> lrf(data, responses, 0.5);
+  DenseLogisticRegressionFunction denseLrf(lrf);
+
+  // The objective is evaluated exactly at the end of each pass, which sparse
+  // steps need; the functions are not shuffled, so both runs take the same
+  // steps.
+  SGD<LogisticRegressionFunction<> > sparseSgd(lrf, 0.05, 20000, 1e-10, false,
+      1, 200);
+  SGD<DenseLogisticRegressionFunction> denseSgd(denseLrf, 0.05, 20000, 1e-10,
+      false, 1, 200);
+
+  arma::mat sparseParameters = arma::zeros<arma::mat>(31, 1);
+  arma::mat denseParameters = arma::zeros<arma::mat>(31, 1);
+  const double sparseObjective = sparseSgd.Optimize(sparseParameters);
+  const double denseObjective = denseSgd.Optimize(denseParameters);
+
+  BOOST_REQUIRE_CLOSE(sparseObjective, denseObjective, 1e-5);
+  for (size_t j = 0; j < 31; ++j)
+  {
+    if (std::abs(denseParameters[j]) < 1e-8)
+      BOOST_REQUIRE_SMALL(sparseParameters[j], 1e-8);
+    else
+      BOOST_REQUIRE_CLOSE(sparseParameters[j], denseParameters[j], 1e-5);
+  }
+}
+
 /**
  * Test constructor that takes an already-instantiated optimizer.
  */
@@ -666,8 +906,8 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionInstantiatedOptimizer)
   arma::vec responses("1 1 0");
 
   // Create an optimizer and function.
-  LogisticRegressionFunction lrf(data, responses, 0.0005);
-  L_BFGS<LogisticRegressionFunction> lbfgsOpt(lrf);
+  LogisticRegressionFunction<> lrf(data, responses, 0.0005);
+  L_BFGS<LogisticRegressionFunction<> > lbfgsOpt(lrf);
   lbfgsOpt.MinGradientNorm() = 1e-50;
   LogisticRegression<L_BFGS> lr(lbfgsOpt);
 
@@ -681,7 +921,7 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionInstantiatedOptimizer)
   BOOST_REQUIRE_SMALL(sigmoids[2], 0.1);
 
   // Now do the same with SGD.
-  SGD<LogisticRegressionFunction> sgdOpt(lrf);
+  SGD<LogisticRegressionFunction<> > sgdOpt(lrf);
   sgdOpt.StepSize() = 0.15;
   sgdOpt.Tolerance() = 1e-75;
   LogisticRegression<SGD> lr2(sgdOpt);
@@ -696,4 +936,136 @@ BOOST_AUTO_TEST_CASE(LogisticRegressionInstantiatedOptimizer)
   BOOST_REQUIRE_SMALL(sigmoids[2], 0.1);
 }
 
+/**
+ * Make sure that the LogisticRegressionFunction with sparse predictors gives
+ * the same objectives and gradients as with the same dense predictors.
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionFunctionSparsePredictors)
+{
+  arma::mat data = arma::randu<arma::mat>(40, 300);
+  data.elem(arma::find(data < 0.9)).zeros();
+  arma::sp_mat sparseData(data);
+  arma::vec responses(300);
+  for (size_t i = 0; i < 300; ++i)
+    responses[i] = math::RandInt(0, 2);
+
+  LogisticRegressionFunction<> lrf(data, responses, 0.4);
+  LogisticRegressionFunction<arma::sp_mat> sparseLrf(sparseData, responses,
+      0.4);
+
+  arma::mat parameters = arma::randn<arma::mat>(41, 1);
+
+  BOOST_REQUIRE_CLOSE(lrf.Evaluate(parameters), sparseLrf.Evaluate(parameters),
+      1e-5);
+
+  arma::mat gradient, sparseGradient;
+  lrf.Gradient(parameters, gradient);
+  sparseLrf.Gradient(parameters, sparseGradient);
+  for (size_t j = 0; j < 41; ++j)
+    BOOST_REQUIRE_CLOSE(gradient[j], sparseGradient[j], 1e-5);
+
+  lrf.Gradient(parameters, 10, 50, gradient);
+  sparseLrf.Gradient(parameters, 10, 50, sparseGradient);
+  for (size_t j = 0; j < 41; ++j)
+    BOOST_REQUIRE_CLOSE(gradient[j], sparseGradient[j], 1e-5);
+
+  for (size_t i = 0; i < 300; i += 7)
+  {
+    BOOST_REQUIRE_CLOSE(lrf.Evaluate(parameters, i),
+        sparseLrf.Evaluate(parameters, i), 1e-5);
+
+    lrf.Gradient(parameters, i, gradient);
+    sparseLrf.Gradient(parameters, i, sparseGradient);
+    for (size_t j = 0; j < 41; ++j)
+      BOOST_REQUIRE_CLOSE(gradient[j], sparseGradient[j], 1e-5);
+
+    arma::uvec indices, sparseIndices;
+    lrf.Support(i, indices);
+    sparseLrf.Support(i, sparseIndices);
+    BOOST_REQUIRE_EQUAL(indices.n_elem, sparseIndices.n_elem);
+    for (size_t j = 0; j < indices.n_elem; ++j)
+      BOOST_REQUIRE_EQUAL(indices[j], sparseIndices[j]);
+  }
+}
+
+/**
+ * Train logistic regression on sparse predictors, and make sure it gives the
+ * same model and predictions as with dense predictors.
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionSparseLBFGSTest)
+{
+  arma::mat data = arma::randu<arma::mat>(20, 500);
+  data.elem(arma::find(data < 0.7)).zeros();
+  arma::vec responses(500);
+  for (size_t i = 0; i < 500; ++i)
+    responses[i] = (arma::accu(data.rows(0, 9).col(i)) >
+        arma::accu(data.rows(10, 19).col(i))) ? 1 : 0;
+  arma::sp_mat sparseData(data);
+
+  LogisticRegression<> lr(data, responses, 0.1);
+  LogisticRegression<L_BFGS, arma::sp_mat> sparseLr(sparseData, responses,
+      0.1);
+
+  for (size_t j = 0; j < lr.Parameters().n_elem; ++j)
+    BOOST_REQUIRE_CLOSE(lr.Parameters()[j], sparseLr.Parameters()[j], 0.1);
+
+  arma::vec predictions, sparsePredictions;
+  lr.Predict(data, predictions);
+  sparseLr.Predict(sparseData, sparsePredictions);
+  for (size_t i = 0; i < 500; ++i)
+    BOOST_REQUIRE_EQUAL(predictions[i], sparsePredictions[i]);
+
+  BOOST_REQUIRE_CLOSE(lr.ComputeAccuracy(data, responses),
+      sparseLr.ComputeAccuracy(sparseData, responses), 1e-5);
+}
+
+/**
+ * Make sure the batched and single-point prediction paths give the sigmoid of
+ * the model at each point, for dense and sparse predictors and any number of
+ * threads.
+ */
+BOOST_AUTO_TEST_CASE(LogisticRegressionBatchedPredictionTest)
+{
+  arma::mat data = arma::randu<arma::mat>(15, 2000) - 0.5;
+  data.elem(arma::find(arma::abs(data) < 0.2)).zeros();
+  arma::sp_mat sparseData(data);
+  const arma::vec parameters = arma::randn<arma::vec>(16);
+
+  // The probabilities, computed directly.
+  const arma::vec expected = 1.0 / (1.0 + arma::exp(-parameters[0] -
+      data.t() * parameters.subvec(1, 15)));
+
+  LogisticRegression<> lr(parameters);
+  LogisticRegression<L_BFGS, arma::sp_mat> sparseLr(parameters);
+
+  for (size_t threads = 0; threads < 4; ++threads)
+  {
+    lr.Threads() = threads;
+    sparseLr.Threads() = threads;
+
+    arma::vec probabilities, sparseProbabilities, predictions,
+        sparsePredictions;
+    lr.PredictProbabilities(data, probabilities);
+    sparseLr.PredictProbabilities(sparseData, sparseProbabilities);
+    lr.Predict(data, predictions, 0.3);
+    sparseLr.Predict(sparseData, sparsePredictions, 0.3);
+
+    BOOST_REQUIRE_EQUAL(probabilities.n_elem, 2000);
+    BOOST_REQUIRE_EQUAL(sparseProbabilities.n_elem, 2000);
+    BOOST_REQUIRE_EQUAL(predictions.n_elem, 2000);
+    BOOST_REQUIRE_EQUAL(sparsePredictions.n_elem, 2000);
+    for (size_t i = 0; i < 2000; ++i)
+    {
+      BOOST_REQUIRE_CLOSE(probabilities[i], expected[i], 1e-8);
+      BOOST_REQUIRE_CLOSE(sparseProbabilities[i], expected[i], 1e-8);
+      BOOST_REQUIRE_CLOSE(lr.PredictProbability(data.col(i)), expected[i],
+          1e-8);
+
+      const double response = std::floor(expected[i] + 0.7);
+      BOOST_REQUIRE_EQUAL(predictions[i], response);
+      BOOST_REQUIRE_EQUAL(sparsePredictions[i], response);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
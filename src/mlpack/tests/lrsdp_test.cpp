@@ -169,4 +169,157 @@ BOOST_AUTO_TEST_CASE(Keller4LovaszThetaSDP)
   }
 }*/
 
+/**
+ * Make sure that sparse and low-rank objective and constraint matrices give the
+ * same objective, constraints and gradient as the equivalent dense matrices.
+ */
+BOOST_AUTO_TEST_CASE(SparseLowRankConstraintTest)
+{
+  const size_t n = 10;
+  arma::mat coordinates(n, 3);
+  coordinates.randu();
+
+  LRSDPFunction dense(3, coordinates);
+  LRSDPFunction compact(3, coordinates);
+
+  // C = -I, which is stored sparsely.
+  dense.C() = -arma::eye<arma::mat>(n, n);
+  compact.CMode() = 1;
+  compact.C().set_size(3, n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    compact.C()(0, i) = i;
+    compact.C()(1, i) = i;
+    compact.C()(2, i) = -1;
+  }
+
+  // A_0 is a dense symmetric matrix in both.
+  arma::mat a0(n, n);
+  a0.randu();
+  a0 += trans(a0);
+  dense.A()[0] = a0;
+  dense.AModes()[0] = 0;
+  compact.A()[0] = a0;
+  compact.AModes()[0] = 0;
+
+  // A_1 is the distance constraint between points 2 and 7.
+  dense.A()[1].zeros(n, n);
+  dense.A()[1](2, 2) = 1;
+  dense.A()[1](7, 7) = 1;
+  dense.A()[1](2, 7) = -1;
+  dense.A()[1](7, 2) = -1;
+  dense.AModes()[1] = 0;
+  compact.A()[1].set_size(3, 4);
+  compact.A()[1].col(0) = arma::vec("2 2 1");
+  compact.A()[1].col(1) = arma::vec("7 7 1");
+  compact.A()[1].col(2) = arma::vec("2 7 -1");
+  compact.A()[1].col(3) = arma::vec("7 2 -1");
+  compact.AModes()[1] = 1;
+
+  // A_2 = U U^T, which is stored as U.
+  arma::mat u(n, 2);
+  u.randu();
+  dense.A()[2] = u * trans(u);
+  dense.AModes()[2] = 0;
+  compact.A()[2] = u;
+  compact.AModes()[2] = 2;
+
+  dense.B() = arma::vec("1 2 3");
+  compact.B() = dense.B();
+
+  BOOST_REQUIRE_CLOSE(compact.Evaluate(coordinates),
+      dense.Evaluate(coordinates), 1e-8);
+  for (size_t i = 0; i < 3; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(compact.EvaluateConstraint(i, coordinates),
+        dense.EvaluateConstraint(i, coordinates), 1e-8);
+  }
+
+  const arma::vec lambda("0.5 -1.0 2.0");
+  AugLagrangianFunction<LRSDPFunction> denseAugLag(dense, lambda, 3.0);
+  AugLagrangianFunction<LRSDPFunction> compactAugLag(compact, lambda, 3.0);
+
+  BOOST_REQUIRE_CLOSE(compactAugLag.Evaluate(coordinates),
+      denseAugLag.Evaluate(coordinates), 1e-8);
+
+  arma::mat denseGradient, compactGradient;
+  denseAugLag.Gradient(coordinates, denseGradient);
+  compactAugLag.Gradient(coordinates, compactGradient);
+  BOOST_REQUIRE_EQUAL(compactGradient.n_rows, n);
+  BOOST_REQUIRE_EQUAL(compactGradient.n_cols, 3);
+  for (size_t i = 0; i < denseGradient.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(compactGradient[i], denseGradient[i], 1e-8);
+
+  // The combined evaluation must agree with the separate ones.
+  arma::mat combinedGradient;
+  BOOST_REQUIRE_CLOSE(compactAugLag.EvaluateWithGradient(coordinates,
+      combinedGradient), denseAugLag.Evaluate(coordinates), 1e-8);
+  for (size_t i = 0; i < denseGradient.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(combinedGradient[i], denseGradient[i], 1e-8);
+}
+
+/**
+ * Make sure that the batch constraint evaluations of the LRSDPFunction match
+ * the evaluation of each constraint on its own, with one thread and with
+ * several.
+ */
+BOOST_AUTO_TEST_CASE(BatchConstraintTest)
+{
+  const size_t n = 20;
+  const size_t numConstraints = 50;
+  arma::mat coordinates(n, 4);
+  coordinates.randu();
+
+  LRSDPFunction function(numConstraints, coordinates);
+  function.C() = -arma::eye<arma::mat>(n, n);
+
+  // Distance constraints between random pairs of points, stored sparsely, with
+  // a dense first constraint.
+  function.A()[0].ones(n, n);
+  function.AModes()[0] = 0;
+  for (size_t i = 1; i < numConstraints; ++i)
+  {
+    const size_t p = (size_t) math::RandInt(n);
+    const size_t q = (size_t) math::RandInt(n);
+    arma::mat& a = function.A()[i];
+    a.set_size(3, 4);
+    a.row(0) = arma::rowvec("1 1 0 0") * p + arma::rowvec("0 0 1 1") * q;
+    a.row(1) = arma::rowvec("1 0 1 0") * p + arma::rowvec("0 1 0 1") * q;
+    a.row(2) = arma::rowvec("1 -1 -1 1");
+    function.AModes()[i] = 1;
+  }
+  function.B().randu();
+
+  arma::vec weights(numConstraints);
+  weights.randn();
+  weights[3] = 0.0;
+
+  // Compute the expected values one constraint at a time.
+  arma::vec expectedConstraints(numConstraints);
+  arma::mat expectedGradient = arma::zeros<arma::mat>(n, 4);
+  arma::mat constraintGradient;
+  for (size_t i = 0; i < numConstraints; ++i)
+  {
+    expectedConstraints[i] = function.EvaluateConstraint(i, coordinates);
+    function.GradientConstraint(i, coordinates, constraintGradient);
+    expectedGradient += weights[i] * constraintGradient;
+  }
+
+  for (size_t threads = 1; threads <= 4; threads += 3)
+  {
+    function.Threads() = threads;
+
+    arma::vec constraints;
+    function.EvaluateConstraints(coordinates, constraints);
+    BOOST_REQUIRE_EQUAL(constraints.n_elem, numConstraints);
+    for (size_t i = 0; i < numConstraints; ++i)
+      BOOST_REQUIRE_CLOSE(constraints[i], expectedConstraints[i], 1e-10);
+
+    arma::mat gradient = arma::zeros<arma::mat>(n, 4);
+    function.GradientConstraints(coordinates, weights, gradient);
+    for (size_t i = 0; i < gradient.n_elem; ++i)
+      BOOST_REQUIRE_SMALL(gradient[i] - expectedGradient[i], 1e-10);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
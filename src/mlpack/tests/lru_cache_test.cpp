@@ -0,0 +1,80 @@
+/**
+ * @file lru_cache_test.cpp
+ *
+ * Tests for util::LRUCache.
+ */
+#include <mlpack/core.hpp>
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+BOOST_AUTO_TEST_SUITE(LRUCacheTest);
+
+/**
+ * When the cache is full, the least recently used value should be dropped, and
+ * finding a value should make it the most recently used.
+ */
+BOOST_AUTO_TEST_CASE(LRUCacheEvictionTest)
+{
+  LRUCache<size_t, double> cache(3);
+  cache.Insert(1, 1.0);
+  cache.Insert(2, 2.0);
+  cache.Insert(3, 3.0);
+  BOOST_REQUIRE_EQUAL(cache.Size(), 3);
+
+  // Now 2 is the least recently used.
+  BOOST_REQUIRE(cache.Find(1) != NULL);
+  BOOST_REQUIRE_CLOSE(*cache.Find(1), 1.0, 1e-5);
+
+  cache.Insert(4, 4.0);
+  BOOST_REQUIRE_EQUAL(cache.Size(), 3);
+  BOOST_REQUIRE(cache.Find(2) == NULL);
+  BOOST_REQUIRE(cache.Find(1) != NULL);
+  BOOST_REQUIRE(cache.Find(3) != NULL);
+  BOOST_REQUIRE(cache.Find(4) != NULL);
+
+  // Replacing a value keeps the size.
+  cache.Insert(3, 6.0);
+  BOOST_REQUIRE_EQUAL(cache.Size(), 3);
+  BOOST_REQUIRE_CLOSE(*cache.Find(3), 6.0, 1e-5);
+
+  BOOST_REQUIRE_EQUAL(cache.Hits(), 6);
+  BOOST_REQUIRE_EQUAL(cache.Misses(), 1);
+
+  cache.Clear();
+  BOOST_REQUIRE_EQUAL(cache.Size(), 0);
+  BOOST_REQUIRE(cache.Find(1) == NULL);
+}
+
+/**
+ * Query points can be keys, and a cache of capacity 0 keeps nothing.
+ */
+BOOST_AUTO_TEST_CASE(LRUCacheVectorKeyTest)
+{
+  arma::mat points = arma::randu<arma::mat>(5, 100);
+
+  LRUCache<std::vector<double>, size_t> cache(100);
+  LRUCache<std::vector<double>, size_t> emptyCache;
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    const std::vector<double> key(points.colptr(i), points.colptr(i) + 5);
+    cache.Insert(key, i);
+    emptyCache.Insert(key, i);
+  }
+
+  BOOST_REQUIRE_EQUAL(emptyCache.Size(), 0);
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    const std::vector<double> key(points.colptr(i), points.colptr(i) + 5);
+    BOOST_REQUIRE(cache.Find(key) != NULL);
+    BOOST_REQUIRE_EQUAL(*cache.Find(key), i);
+  }
+
+  points(0, 0) += 1.0;
+  const std::vector<double> changed(points.colptr(0), points.colptr(0) + 5);
+  BOOST_REQUIRE(cache.Find(changed) == NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
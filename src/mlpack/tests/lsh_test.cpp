@@ -9,6 +9,7 @@
 #include "old_boost_test_definitions.hpp"
 
 #include <mlpack/methods/lsh/lsh_search.hpp>
+#include <sstream>
 
 using namespace std;
 using namespace mlpack;
@@ -61,16 +62,14 @@ BOOST_AUTO_TEST_CASE(LSHSearchTest)
   LSHSearch<> lsh_test(rdata, qdata, 3, 2, hashWidth, 11, 3);
 //   LSHSearch<> lsh_test(rdata, qdata, 3, 2, 0.0, 11, 3);
 
-  // Given this, the 'LSHSearch::bucketRowInHashTable' should be:
-  // COR.SOL.: [2 11 4 7 6 3 11 0 5 1 8]
-  //
-  // The 'LSHSearch::bucketContentSize' should be:
+  // Given this, the number of points in each bucket (the differences of
+  // 'LSHSearch::bucketOffsets') should be:
   // COR.SOL.: [2 0 1 1 3 1 0 3 3 3 1]
   //
-  // The final hash table 'LSHSearch::secondHashTable' should be
-  // of size (3 x 9) with the following content:
+  // The final hash table 'LSHSearch::secondHashTable' should hold these
+  // buckets, one after another:
   // COR.SOL.:
-  // [0 2 4; 1 7 8; 3 9 10; 5 10 10; 6 10 10; 0 5 6; 1 2 8; 3 10 10; 4 10 10]
+  // [3 9; ; 6; 3; 1 2 8; 5; ; 0 2 4; 0 5 6; 1 7 8; 4]
 
   arma::Mat<size_t> neighbors;
   arma::mat distances;
@@ -108,4 +107,133 @@ BOOST_AUTO_TEST_CASE(LSHSearchTest)
   }
 }
 
+/**
+ * Multi-probe search looks at the query's own buckets and more, so it must find
+ * neighbors that are at least as good as those of the plain search with the
+ * same hash tables.  It should also find many more candidates.
+ */
+BOOST_AUTO_TEST_CASE(LSHMultiprobeTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat rdata(5, 1000);
+  rdata.randu();
+  arma::mat qdata(5, 100);
+  qdata.randu();
+
+  LSHSearch<> lsh(rdata, qdata, 10, 3);
+
+  arma::Mat<size_t> neighbors, probeNeighbors;
+  arma::mat distances, probeDistances;
+  lsh.Search(5, neighbors, distances);
+  lsh.Search(5, probeNeighbors, probeDistances, 0, 20);
+
+  size_t found = 0, probeFound = 0;
+  for (size_t i = 0; i < distances.n_elem; ++i)
+  {
+    BOOST_REQUIRE_LE(probeDistances[i], distances[i]);
+
+    if (neighbors[i] != rdata.n_cols)
+      ++found;
+    if (probeNeighbors[i] != rdata.n_cols)
+      ++probeFound;
+  }
+
+  BOOST_REQUIRE_GE(probeFound, found);
+}
+
+/**
+ * With a second hash table of size 1, every point lands in the same bucket, so
+ * if buckets are not limited, no point may be lost and the search must be
+ * exact.
+ */
+BOOST_AUTO_TEST_CASE(LSHUnlimitedBucketTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat rdata(3, 1000);
+  rdata.randu();
+  arma::mat qdata(3, 20);
+  qdata.randu();
+
+  LSHSearch<> lsh(rdata, qdata, 5, 2, 0.0, 1);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  lsh.Search(1, neighbors, distances);
+
+  for (size_t i = 0; i < qdata.n_cols; ++i)
+  {
+    double best = DBL_MAX;
+    for (size_t j = 0; j < rdata.n_cols; ++j)
+      best = std::min(best, arma::accu(arma::square(qdata.col(i) -
+          rdata.col(j))));
+
+    BOOST_REQUIRE_CLOSE(distances(0, i), best, 1e-5);
+  }
+}
+
+/**
+ * The parallel batched search must give the same results as the search with
+ * one thread.
+ */
+BOOST_AUTO_TEST_CASE(LSHParallelSearchTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat rdata(4, 3000);
+  rdata.randu();
+  arma::mat qdata(4, 2500);
+  qdata.randu();
+
+  LSHSearch<> lsh(rdata, qdata, 8, 5);
+
+  arma::Mat<size_t> neighbors, serialNeighbors;
+  arma::mat distances, serialDistances;
+  lsh.Search(3, neighbors, distances, 0, 2);
+
+  lsh.Threads() = 1;
+  lsh.Search(3, serialNeighbors, serialDistances, 0, 2);
+
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], serialNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], serialDistances[i], 1e-5);
+  }
+}
+
+/**
+ * Save an LSHSearch object to a stream, load it again, and make sure the loaded
+ * object gives exactly the same results.
+ */
+BOOST_AUTO_TEST_CASE(LSHSaveLoadTest)
+{
+  math::RandomSeed(0);
+
+  arma::mat rdata(5, 500);
+  rdata.randu();
+  arma::mat qdata(5, 100);
+  qdata.randu();
+
+  LSHSearch<> lsh(rdata, qdata, 6, 8, 0.0, 99901, 200);
+
+  std::stringstream stream;
+  lsh.Save(stream);
+
+  LSHSearch<> loaded(rdata, qdata, stream);
+
+  arma::Mat<size_t> neighbors, loadedNeighbors;
+  arma::mat distances, loadedDistances;
+  lsh.Search(4, neighbors, distances, 0, 3);
+  loaded.Search(4, loadedNeighbors, loadedDistances, 0, 3);
+
+  BOOST_REQUIRE_EQUAL(loadedNeighbors.n_rows, neighbors.n_rows);
+  BOOST_REQUIRE_EQUAL(loadedNeighbors.n_cols, neighbors.n_cols);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(loadedNeighbors[i], neighbors[i]);
+    BOOST_REQUIRE_CLOSE(loadedDistances[i], distances[i], 1e-5);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
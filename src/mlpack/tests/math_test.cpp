@@ -578,4 +578,57 @@ BOOST_AUTO_TEST_CASE(RangeContainsRange)
   BOOST_REQUIRE_EQUAL(b.Contains(a), true);
 }
 
+/**
+ * Each thread in a parallel region should draw from its own random number
+ * generator, which is reseeded by RandomSeed(), and the global generator should
+ * be unaffected by those draws.
+ */
+BOOST_AUTO_TEST_CASE(ThreadRandomTest)
+{
+  RandomSeed(12);
+  const double first = Random();
+
+  arma::mat draws(100, 4);
+  arma::mat redraws(100, 4);
+  draws.fill(-1.0);
+  redraws.fill(-1.0);
+
+  RandomSeed(12);
+  #pragma omp parallel num_threads(4)
+  {
+#ifdef _OPENMP
+    const size_t thread = (size_t) omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+    for (size_t i = 0; i < draws.n_rows; ++i)
+      draws(i, thread) = Random();
+  }
+
+  // If the region really ran in parallel, the global generator hasn't been
+  // used yet.
+  if (draws(0, 1) != -1.0)
+    BOOST_REQUIRE_EQUAL(Random(), first);
+
+  RandomSeed(12);
+  #pragma omp parallel num_threads(4)
+  {
+#ifdef _OPENMP
+    const size_t thread = (size_t) omp_get_thread_num();
+#else
+    const size_t thread = 0;
+#endif
+    for (size_t i = 0; i < redraws.n_rows; ++i)
+      redraws(i, thread) = Random();
+  }
+
+  for (size_t i = 0; i < draws.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(draws[i], redraws[i]);
+
+  // Every thread which ran should have a different stream.
+  for (size_t t = 1; t < draws.n_cols; ++t)
+    if (draws(0, t) != -1.0)
+      BOOST_REQUIRE_NE(draws(0, t), draws(0, 0));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
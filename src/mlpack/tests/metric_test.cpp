@@ -82,4 +82,46 @@ BOOST_AUTO_TEST_CASE(LINFMetricTest)
                       lMetric.Evaluate(a2, b2), 1e-5);
 }
 
+/**
+ * EvaluateBounded() should give the distance exactly when it is within the
+ * bound, and something past the bound (but not past the distance) otherwise.
+ */
+template<typename MetricType>
+void CheckEvaluateBounded(const arma::vec& a, const arma::vec& b)
+{
+  const double distance = MetricType::Evaluate(a, b);
+
+  BOOST_REQUIRE_EQUAL(MetricType::EvaluateBounded(a, b, DBL_MAX), distance);
+  BOOST_REQUIRE_EQUAL(MetricType::EvaluateBounded(a, b, 1.01 * distance),
+      distance);
+  BOOST_REQUIRE_EQUAL(MetricType::EvaluateBounded(a, b, 2 * distance),
+      distance);
+
+  const double bounded = MetricType::EvaluateBounded(a, b, 0.1 * distance);
+  BOOST_REQUIRE_GT(bounded, 0.1 * distance);
+  BOOST_REQUIRE_LE(bounded, distance * (1 + 1e-10));
+}
+
+BOOST_AUTO_TEST_CASE(EvaluateBoundedTest)
+{
+  arma::vec a(100);
+  a.randn();
+  arma::vec b(100);
+  b.randn();
+
+  CheckEvaluateBounded<ManhattanDistance>(a, b);
+  CheckEvaluateBounded<SquaredEuclideanDistance>(a, b);
+  CheckEvaluateBounded<EuclideanDistance>(a, b);
+  CheckEvaluateBounded<LMetric<3, true> >(a, b);
+  CheckEvaluateBounded<ChebyshevDistance>(a, b);
+
+  // Short points are not worth abandoning, so the distance is exact.
+  arma::vec c(10);
+  c.randn();
+  arma::vec d(10);
+  d.randn();
+  BOOST_REQUIRE_EQUAL(EuclideanDistance::EvaluateBounded(c, d, 0.0),
+      EuclideanDistance::Evaluate(c, d));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,167 @@
+/**
+ * @file model_selection_test.cpp
+ *
+ * Tests for util::ModelSelection.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/methods/linear_regression/linear_regression.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::util;
+using namespace mlpack::regression;
+
+BOOST_AUTO_TEST_SUITE(ModelSelectionTest);
+
+/**
+ * An evaluator for points which are their own indices (and have their indices
+ * as responses); it returns the sum of the test points, or -1 if the training
+ * and test sets do not make up the whole dataset.
+ */
+class IndexEvaluator
+{
+ public:
+  IndexEvaluator(const size_t n) : n(n) { }
+
+  double Evaluate(const size_t /* configuration */,
+                  const arma::mat& trainData,
+                  const arma::mat& trainResponses,
+                  const arma::mat& testData,
+                  const arma::mat& testResponses) const
+  {
+    if (trainData.n_cols + testData.n_cols != n)
+      return -1.0;
+    if (arma::any(arma::vectorise(trainData != trainResponses)) ||
+        arma::any(arma::vectorise(testData != testResponses)))
+      return -1.0;
+
+    // Every point is in one of the two sets, so they add up to the sum of all
+    // the indices.
+    const double sum = arma::accu(trainData) + arma::accu(testData);
+    if (sum != (double) (n * (n - 1) / 2))
+      return -1.0;
+
+    return arma::accu(testData);
+  }
+
+ private:
+  size_t n;
+};
+
+/**
+ * Each point should be in the test set of exactly one fold, and the training
+ * set of each fold should be the rest of the points.
+ */
+BOOST_AUTO_TEST_CASE(ModelSelectionFoldsTest)
+{
+  const size_t n = 103;
+  arma::mat data(1, n);
+  for (size_t i = 0; i < n; ++i)
+    data[i] = i;
+
+  IndexEvaluator evaluator(n);
+  for (size_t shuffle = 0; shuffle < 2; ++shuffle)
+  {
+    ModelSelection<IndexEvaluator> selection(evaluator, 3, 5, (shuffle == 1));
+    selection.Threads() = 4;
+    selection.Run(data, data);
+
+    BOOST_REQUIRE_EQUAL(selection.Scores().n_rows, 3);
+    BOOST_REQUIRE_EQUAL(selection.Scores().n_cols, 5);
+    BOOST_REQUIRE_EQUAL(selection.Times().n_rows, 3);
+    BOOST_REQUIRE_EQUAL(selection.Times().n_cols, 5);
+
+    for (size_t c = 0; c < 3; ++c)
+    {
+      for (size_t f = 0; f < 5; ++f)
+      {
+        BOOST_REQUIRE_GE(selection.Scores()(c, f), 0.0);
+        BOOST_REQUIRE_GE(selection.Times()(c, f), 0.0);
+      }
+
+      BOOST_REQUIRE_CLOSE(arma::accu(selection.Scores().row(c)),
+          (double) (n * (n - 1) / 2), 1e-5);
+    }
+
+    // Without shuffling, the folds are contiguous ranges of points.
+    if (shuffle == 0)
+    {
+      for (size_t f = 0; f < 5; ++f)
+      {
+        const size_t begin = f * n / 5;
+        const size_t end = (f + 1) * n / 5;
+        const double sum = (double) ((end * (end - 1) / 2) -
+            (begin == 0 ? 0 : begin * (begin - 1) / 2));
+        BOOST_REQUIRE_CLOSE(selection.Scores()(0, f), sum, 1e-5);
+      }
+    }
+  }
+}
+
+/**
+ * An evaluator which scores ridge regression by the mean squared error on the
+ * test set.
+ */
+class RidgeEvaluator
+{
+ public:
+  RidgeEvaluator(const arma::vec& lambdas) : lambdas(lambdas) { }
+
+  double Evaluate(const size_t configuration,
+                  const arma::mat& trainData,
+                  const arma::mat& trainResponses,
+                  const arma::mat& testData,
+                  const arma::mat& testResponses) const
+  {
+    const arma::vec responses = trainResponses.row(0).t();
+    LinearRegression lr(trainData, responses, lambdas[configuration]);
+    arma::vec predictions;
+    lr.Predict(testData, predictions);
+    return arma::mean(arma::square(predictions - testResponses.row(0).t()));
+  }
+
+ private:
+  const arma::vec& lambdas;
+};
+
+/**
+ * On data that is almost exactly linear, no regularization should be best, and
+ * the scores should not depend on the number of threads.
+ */
+BOOST_AUTO_TEST_CASE(ModelSelectionRidgeTest)
+{
+  arma::mat predictors(5, 500);
+  predictors.randu();
+  arma::vec weights("1.0 -2.0 3.0 0.5 4.0");
+  arma::mat responses = weights.t() * predictors + 1.0;
+  responses += 0.01 * arma::randn<arma::rowvec>(500);
+
+  arma::vec lambdas("0.0 10.0 1000.0");
+  RidgeEvaluator evaluator(lambdas);
+
+  ModelSelection<RidgeEvaluator> serial(evaluator, lambdas.n_elem, 10);
+  serial.Threads() = 1;
+  math::RandomSeed(42);
+  serial.Run(predictors, responses);
+
+  ModelSelection<RidgeEvaluator> parallel(evaluator, lambdas.n_elem, 10);
+  parallel.Threads() = 4;
+  math::RandomSeed(42);
+  parallel.Run(predictors, responses);
+
+  BOOST_REQUIRE_EQUAL(serial.Best(), 0);
+  BOOST_REQUIRE_EQUAL(parallel.Best(), 0);
+  BOOST_REQUIRE_EQUAL(parallel.Best(true), 2);
+
+  const arma::vec means = parallel.MeanScores();
+  BOOST_REQUIRE_EQUAL(means.n_elem, 3);
+  BOOST_REQUIRE_LT(means[0], means[1]);
+  BOOST_REQUIRE_LT(means[1], means[2]);
+
+  for (size_t i = 0; i < serial.Scores().n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(serial.Scores()[i], parallel.Scores()[i], 1e-5);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
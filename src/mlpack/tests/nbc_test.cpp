@@ -122,4 +122,142 @@ BOOST_AUTO_TEST_CASE(NaiveBayesClassifierIncrementalTest)
     BOOST_REQUIRE_EQUAL(testRes(i), calcVec(i));
 }
 
+/**
+ * Make sure training and classifying with sparse data gives the same results
+ * as with the same data stored densely.
+ */
+BOOST_AUTO_TEST_CASE(SparseNaiveBayesClassifierTest)
+{
+  arma::sp_mat sparseData = arma::sprandu<arma::sp_mat>(40, 300, 0.1);
+  arma::Col<size_t> labels(300);
+  for (size_t i = 0; i < labels.n_elem; ++i)
+    labels[i] = i % 3;
+  // Make the classes distinguishable.
+  for (size_t i = 0; i < labels.n_elem; ++i)
+    sparseData(labels[i], i) = 2.0 + labels[i] + 0.1 * (i % 7);
+
+  const arma::mat denseData(sparseData);
+
+  for (size_t incremental = 0; incremental < 2; ++incremental)
+  {
+    NaiveBayesClassifier<> dense(denseData, labels, 3, incremental == 1);
+    NaiveBayesClassifier<arma::sp_mat> sparse(sparseData, labels, 3,
+        incremental == 1);
+
+    for (size_t i = 0; i < dense.Means().n_elem; ++i)
+    {
+      BOOST_REQUIRE_CLOSE(sparse.Means()[i] + 1.0, dense.Means()[i] + 1.0,
+          1e-8);
+      BOOST_REQUIRE_CLOSE(sparse.Variances()[i] + 1.0,
+          dense.Variances()[i] + 1.0, 1e-8);
+    }
+    for (size_t i = 0; i < 3; ++i)
+      BOOST_REQUIRE_CLOSE(sparse.Probabilities()[i],
+          dense.Probabilities()[i], 1e-8);
+
+    arma::Col<size_t> denseResults, sparseResults;
+    dense.Classify(denseData, denseResults);
+    sparse.Classify(sparseData, sparseResults);
+    for (size_t i = 0; i < labels.n_elem; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(sparseResults[i], denseResults[i]);
+      BOOST_REQUIRE_EQUAL(sparseResults[i], labels[i]);
+    }
+  }
+}
+
+/**
+ * Make sure that classifying many points, which are split into several blocks,
+ * gives the same results as evaluating the Gaussian log-likelihood of each
+ * point under each class directly.
+ */
+BOOST_AUTO_TEST_CASE(NaiveBayesClassifierBlockTest)
+{
+  const size_t classes = 10;
+  arma::mat data = arma::randu<arma::mat>(5, 3000);
+  arma::Col<size_t> labels(3000);
+  for (size_t i = 0; i < labels.n_elem; ++i)
+  {
+    labels[i] = i % classes;
+    data(i % 5, i) += 0.5 * labels[i];
+  }
+
+  NaiveBayesClassifier<> nbc(data, labels, classes);
+
+  arma::Col<size_t> results;
+  nbc.Classify(data, results);
+  BOOST_REQUIRE_EQUAL(results.n_elem, data.n_cols);
+
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    arma::vec logLikelihoods(classes);
+    for (size_t c = 0; c < classes; ++c)
+    {
+      logLikelihoods[c] = std::log(nbc.Probabilities()[c]);
+      for (size_t d = 0; d < data.n_rows; ++d)
+      {
+        const double diff = data(d, i) - nbc.Means()(d, c);
+        const double var = nbc.Variances()(d, c);
+        logLikelihoods[c] -= 0.5 * (std::log(2 * M_PI * var) +
+            diff * diff / var);
+      }
+    }
+
+    arma::uword maxIndex;
+    logLikelihoods.max(maxIndex);
+    BOOST_REQUIRE_EQUAL(results[i], maxIndex);
+  }
+}
+
+/**
+ * Make sure that training a chunk at a time, and merging classifiers trained on
+ * separate chunks, gives the same model as training on all the data at once.
+ */
+BOOST_AUTO_TEST_CASE(NaiveBayesClassifierChunkedTrainingTest)
+{
+  const size_t classes = 3;
+  arma::mat data = arma::randu<arma::mat>(4, 600);
+  arma::Col<size_t> labels(600);
+  for (size_t i = 0; i < labels.n_elem; ++i)
+  {
+    labels[i] = (i * 7) % classes;
+    data.col(i) += 100.0 * labels[i];
+  }
+
+  NaiveBayesClassifier<> full(data, labels, classes);
+
+  // Train one chunk at a time.
+  NaiveBayesClassifier<> chunked(data.n_rows, classes);
+  for (size_t begin = 0; begin < data.n_cols; begin += 150)
+  {
+    const arma::mat chunk = data.cols(begin, begin + 149);
+    const arma::Col<size_t> chunkLabels = labels.subvec(begin, begin + 149);
+    chunked.Train(chunk, chunkLabels);
+  }
+
+  // Train two halves separately, and merge them.
+  const arma::mat firstHalf = data.cols(0, 249);
+  const arma::mat secondHalf = data.cols(250, 599);
+  NaiveBayesClassifier<> merged(firstHalf, labels.subvec(0, 249), classes);
+  NaiveBayesClassifier<> other(secondHalf, labels.subvec(250, 599), classes);
+  merged.Merge(other);
+
+  for (size_t i = 0; i < full.Means().n_elem; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(chunked.Means()[i], full.Means()[i], 1e-8);
+    BOOST_REQUIRE_CLOSE(chunked.Variances()[i], full.Variances()[i], 1e-6);
+    BOOST_REQUIRE_CLOSE(merged.Means()[i], full.Means()[i], 1e-8);
+    BOOST_REQUIRE_CLOSE(merged.Variances()[i], full.Variances()[i], 1e-6);
+  }
+
+  for (size_t i = 0; i < classes; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(chunked.Probabilities()[i], full.Probabilities()[i],
+        1e-8);
+    BOOST_REQUIRE_CLOSE(merged.Probabilities()[i], full.Probabilities()[i],
+        1e-8);
+    BOOST_REQUIRE_EQUAL(merged.Counts()[i], full.Counts()[i]);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
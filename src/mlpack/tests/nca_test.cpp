@@ -244,6 +244,99 @@ BOOST_AUTO_TEST_CASE(SoftmaxSeparableGradient)
   BOOST_REQUIRE_CLOSE(gradient(1, 1), -2.0 * -0.1435886, 0.01);
 }
 
+/**
+ * Ensure the batch gradient is the sum of the separable gradients.
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxBatchGradient)
+{
+  arma::mat data           = "-0.1 -0.1 -0.1  0.1  0.1  0.1;"
+                             " 1.0  0.0 -1.0  1.0  0.0 -1.0 ";
+  arma::Col<size_t> labels = " 0    0    0    1    1    1   ";
+
+  SoftmaxErrorFunction<SquaredEuclideanDistance> sef(data, labels);
+
+  arma::mat coordinates = "1.2 0.3; -0.4 0.8";
+  arma::mat gradient, pointGradient;
+  arma::mat sum = arma::zeros<arma::mat>(2, 2);
+
+  sef.Gradient(coordinates, 1, 4, gradient);
+  for (size_t i = 1; i < 5; ++i)
+  {
+    sef.Gradient(coordinates, i, pointGradient);
+    sum += pointGradient;
+  }
+
+  BOOST_REQUIRE_EQUAL(gradient.n_rows, 2);
+  BOOST_REQUIRE_EQUAL(gradient.n_cols, 2);
+  for (size_t i = 0; i < 4; ++i)
+    BOOST_REQUIRE_CLOSE(gradient[i], sum[i], 1e-8);
+}
+
+/**
+ * With a cutoff larger than any distance, the truncated objective and gradient
+ * should be the same as the exact ones, for both the squared Euclidean and the
+ * Euclidean distance.
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxLargeCutoff)
+{
+  arma::mat data = arma::randu<arma::mat>(3, 100);
+  arma::Col<size_t> labels(100);
+  for (size_t i = 0; i < 100; ++i)
+    labels[i] = math::RandInt(0, 3);
+
+  arma::mat coordinates = arma::randu<arma::mat>(3, 3);
+
+  SoftmaxErrorFunction<SquaredEuclideanDistance> sef(data, labels);
+  SoftmaxErrorFunction<SquaredEuclideanDistance> truncatedSef(data, labels);
+  truncatedSef.Cutoff() = 1000.0;
+  SoftmaxErrorFunction<EuclideanDistance> eef(data, labels);
+  SoftmaxErrorFunction<EuclideanDistance> truncatedEef(data, labels);
+  truncatedEef.Cutoff() = 1000.0;
+
+  BOOST_REQUIRE_CLOSE(sef.Evaluate(coordinates),
+      truncatedSef.Evaluate(coordinates), 1e-8);
+  BOOST_REQUIRE_CLOSE(eef.Evaluate(coordinates),
+      truncatedEef.Evaluate(coordinates), 1e-8);
+
+  arma::mat gradient, truncatedGradient;
+  sef.Gradient(coordinates, gradient);
+  truncatedSef.Gradient(coordinates, truncatedGradient);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(gradient[i], truncatedGradient[i], 1e-8);
+
+  eef.Gradient(coordinates, gradient);
+  truncatedEef.Gradient(coordinates, truncatedGradient);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(gradient[i], truncatedGradient[i], 1e-8);
+}
+
+/**
+ * With a cutoff that drops the pairs of points that are far apart, the
+ * objective and gradient should barely change.
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxTruncatedNeighborhoods)
+{
+  arma::mat data = 10 * arma::randu<arma::mat>(2, 400);
+  arma::Col<size_t> labels(400);
+  for (size_t i = 0; i < 400; ++i)
+    labels[i] = (data(0, i) > 5.0) ? 1 : 0;
+
+  arma::mat coordinates = "1.1 0.2; -0.3 0.9";
+
+  SoftmaxErrorFunction<SquaredEuclideanDistance> sef(data, labels);
+  SoftmaxErrorFunction<SquaredEuclideanDistance> truncatedSef(data, labels);
+  truncatedSef.Cutoff() = 30.0;
+
+  BOOST_REQUIRE_CLOSE(sef.Evaluate(coordinates),
+      truncatedSef.Evaluate(coordinates), 1e-5);
+
+  arma::mat gradient, truncatedGradient;
+  sef.Gradient(coordinates, gradient);
+  truncatedSef.Gradient(coordinates, truncatedGradient);
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(gradient[i], truncatedGradient[i], 1e-5);
+}
+
 //
 // Tests for the NCA algorithm.
 //
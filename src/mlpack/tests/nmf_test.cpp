@@ -213,4 +213,83 @@ BOOST_AUTO_TEST_CASE(SparseNMFALSTest)
       1e-5);
 }
 
+/**
+ * Check that the sparse version of the divergence update rules, which only
+ * computes WH at the nonzeros of V, gives the same factorization as the dense
+ * version on a dense copy of the matrix.
+ */
+BOOST_AUTO_TEST_CASE(SparseNMFRandomDivTest)
+{
+  mlpack::math::RandomSeed(std::time(NULL));
+  sp_mat v;
+  v.sprandu(20, 20, 0.3);
+  // Ensure there is at least one nonzero element in every row and column.
+  for (size_t i = 0; i < 20; ++i)
+    v(i, i) += 1e-5;
+  mat dv(v); // Make a dense copy.
+  mat w, h, dw, dh;
+  size_t r = 10;
+
+  SimpleResidueTermination srt(1e-10, 100);
+  AMF<SimpleResidueTermination,
+      RandomInitialization,
+      NMFMultiplicativeDivergenceUpdate> nmf(srt);
+  const size_t seed = mlpack::math::RandInt(1000000);
+  mlpack::math::RandomSeed(seed);
+  nmf.Apply(v, r, w, h);
+  mlpack::math::RandomSeed(seed);
+  nmf.Apply(dv, r, dw, dh);
+
+  BOOST_REQUIRE_SMALL(arma::norm(w - dw, "fro") / arma::norm(dw, "fro"),
+      1e-5);
+  BOOST_REQUIRE_SMALL(arma::norm(h - dh, "fro") / arma::norm(dh, "fro"),
+      1e-5);
+}
+
+/**
+ * Check that the sparse ALS update rule fits the observed entries of a sparse
+ * low-rank matrix, and that the result does not depend on the number of
+ * threads.
+ */
+BOOST_AUTO_TEST_CASE(SparseALSTest)
+{
+  mlpack::math::RandomSeed(std::time(NULL));
+  const mat w0 = randu<mat>(30, 2) + 0.5;
+  const mat h0 = randu<mat>(2, 40) + 0.5;
+  const mat full = w0 * h0;
+
+  // Observe about half of the entries, and at least one in each row and
+  // column.
+  sp_mat v(30, 40);
+  for (size_t j = 0; j < 40; ++j)
+    for (size_t i = 0; i < 30; ++i)
+      if (i == (j % 30) || mlpack::math::Random() < 0.5)
+        v(i, j) = full(i, j);
+
+  const size_t seed = mlpack::math::RandInt(1000000);
+  mat w, h, w1, h1;
+
+  SparseALSFactorizer als(SimpleToleranceTermination<sp_mat>(),
+      RandomInitialization(), SparseALSUpdate(1e-6, 0));
+  mlpack::math::RandomSeed(seed);
+  als.Apply(v, 2, w, h);
+
+  SparseALSFactorizer serial(SimpleToleranceTermination<sp_mat>(),
+      RandomInitialization(), SparseALSUpdate(1e-6, 1));
+  mlpack::math::RandomSeed(seed);
+  serial.Apply(v, 2, w1, h1);
+
+  // The residue only counts the observed entries.
+  const mat vp = w * h;
+  double error = 0.0;
+  for (sp_mat::const_iterator it = v.begin(); it != v.end(); ++it)
+    error += std::pow(vp(it.row(), it.col()) - (*it), 2.0);
+  BOOST_REQUIRE_SMALL(std::sqrt(error / v.n_nonzero), 1e-3);
+
+  // Each row and column is solved on its own, so the threads can't change the
+  // result.
+  BOOST_REQUIRE_SMALL(arma::norm(w - w1, "fro"), 1e-10);
+  BOOST_REQUIRE_SMALL(arma::norm(h - h1, "fro"), 1e-10);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
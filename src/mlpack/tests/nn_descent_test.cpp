@@ -0,0 +1,119 @@
+/**
+ * @file nn_descent_test.cpp
+ *
+ * Tests for the NNDescent class.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/methods/nn_descent/nn_descent.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+BOOST_AUTO_TEST_SUITE(NNDescentTest);
+
+//! Return the fraction of the true neighbors which were found.
+double GraphRecall(const arma::Mat<size_t>& trueNeighbors,
+              const arma::Mat<size_t>& neighbors)
+{
+  size_t found = 0;
+  for (size_t i = 0; i < neighbors.n_cols; ++i)
+    for (size_t j = 0; j < neighbors.n_rows; ++j)
+      for (size_t l = 0; l < trueNeighbors.n_rows; ++l)
+        if (neighbors(j, i) == trueNeighbors(l, i))
+          ++found;
+
+  return (double) found / trueNeighbors.n_elem;
+}
+
+/**
+ * Make sure that the graph has the right format: each column holds k distinct
+ * neighbors, not including the point itself, sorted by their distances, which
+ * are correct.
+ */
+BOOST_AUTO_TEST_CASE(GraphFormatTest)
+{
+  arma::mat dataset;
+  dataset.randu(5, 500);
+
+  NNDescent<> nnDescent(dataset);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  nnDescent.Build(8, neighbors, distances);
+
+  BOOST_REQUIRE_EQUAL(neighbors.n_rows, 8);
+  BOOST_REQUIRE_EQUAL(neighbors.n_cols, 500);
+  BOOST_REQUIRE_EQUAL(distances.n_rows, 8);
+  BOOST_REQUIRE_EQUAL(distances.n_cols, 500);
+  BOOST_REQUIRE_GT(nnDescent.Iterations(), 0);
+
+  for (size_t i = 0; i < neighbors.n_cols; ++i)
+  {
+    for (size_t j = 0; j < neighbors.n_rows; ++j)
+    {
+      BOOST_REQUIRE_LT(neighbors(j, i), 500);
+      BOOST_REQUIRE_NE(neighbors(j, i), i);
+      BOOST_REQUIRE_CLOSE(distances(j, i), metric::EuclideanDistance::Evaluate(
+          dataset.col(i), dataset.col(neighbors(j, i))), 1e-5);
+      if (j > 0)
+        BOOST_REQUIRE_LE(distances(j - 1, i), distances(j, i));
+      for (size_t l = 0; l < j; ++l)
+        BOOST_REQUIRE_NE(neighbors(l, i), neighbors(j, i));
+    }
+  }
+}
+
+/**
+ * Make sure that almost all of the true neighbors are found, and with far
+ * fewer distance evaluations than brute force.
+ */
+BOOST_AUTO_TEST_CASE(RecallTest)
+{
+  arma::mat dataset;
+  dataset.randu(10, 3000);
+
+  AllkNN allknn(dataset);
+  arma::Mat<size_t> trueNeighbors;
+  arma::mat trueDistances;
+  allknn.Search(10, trueNeighbors, trueDistances);
+
+  NNDescent<> nnDescent(dataset);
+  nnDescent.Threads() = 4;
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  nnDescent.Build(10, neighbors, distances);
+
+  BOOST_REQUIRE_GT(GraphRecall(trueNeighbors, neighbors), 0.9);
+  BOOST_REQUIRE_LT(nnDescent.DistanceEvaluations(), 3000 * 3000 / 2);
+}
+
+/**
+ * Starting from the true neighbors, nothing should change, and the search
+ * should stop after one iteration.
+ */
+BOOST_AUTO_TEST_CASE(InitialNeighborsTest)
+{
+  arma::mat dataset;
+  dataset.randu(4, 1000);
+
+  AllkNN allknn(dataset);
+  arma::Mat<size_t> trueNeighbors;
+  arma::mat trueDistances;
+  allknn.Search(6, trueNeighbors, trueDistances);
+
+  NNDescent<> nnDescent(dataset);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  nnDescent.Build(6, trueNeighbors, neighbors, distances);
+
+  BOOST_REQUIRE_EQUAL(nnDescent.Iterations(), 1);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], trueNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], trueDistances[i], 1e-5);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
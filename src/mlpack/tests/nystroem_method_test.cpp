@@ -179,4 +179,48 @@ BOOST_AUTO_TEST_CASE(GermanTest)
   }
 }
 
+/**
+ * Make sure that a cache filled by a higher rank approximation gives the same
+ * lower rank approximations as computing them from scratch (with ordered
+ * selection the landmarks are nested), and is refilled for a higher rank.
+ */
+BOOST_AUTO_TEST_CASE(CacheTest)
+{
+  arma::mat data;
+  data.randu(5, 100);
+
+  GaussianKernel gk;
+  NystroemCache cache;
+
+  arma::mat g;
+  NystroemMethod<GaussianKernel, OrderedSelection> nm20(data, gk, 20, &cache);
+  nm20.Apply(g);
+  BOOST_REQUIRE_EQUAL(cache.Rank(), 20);
+  BOOST_REQUIRE_EQUAL(cache.SemiKernel().n_rows, 100);
+  BOOST_REQUIRE_EQUAL(cache.SemiKernel().n_cols, 20);
+
+  for (size_t rank = 5; rank <= 20; rank += 5)
+  {
+    arma::mat cachedG, uncachedG;
+    NystroemMethod<GaussianKernel, OrderedSelection> cached(data, gk, rank,
+        &cache);
+    cached.Apply(cachedG);
+    NystroemMethod<GaussianKernel, OrderedSelection> nm(data, gk, rank);
+    nm.Apply(uncachedG);
+
+    // The cache is not refilled for a lower rank.
+    BOOST_REQUIRE_EQUAL(cache.Rank(), 20);
+
+    const arma::mat cachedApproximation = cachedG * cachedG.t();
+    const arma::mat approximation = uncachedG * uncachedG.t();
+    for (size_t i = 0; i < approximation.n_elem; ++i)
+      BOOST_REQUIRE_SMALL(cachedApproximation[i] - approximation[i], 1e-8);
+  }
+
+  NystroemMethod<GaussianKernel, OrderedSelection> nm30(data, gk, 30, &cache);
+  nm30.Apply(g);
+  BOOST_REQUIRE_EQUAL(cache.Rank(), 30);
+  BOOST_REQUIRE_EQUAL(g.n_cols, 30);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,127 @@
+/**
+ * @file parallel_sgd_test.cpp
+ *
+ * Test file for ParallelSGD (stochastic gradient descent split across
+ * threads).
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/parallel_sgd/parallel_sgd.hpp>
+#include <mlpack/core/optimizers/lbfgs/lbfgs.hpp>
+#include <mlpack/core/optimizers/lbfgs/test_functions.hpp>
+#include <mlpack/methods/logistic_regression/logistic_regression_function.hpp>
+
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::optimization;
+using namespace mlpack::optimization::test;
+using namespace mlpack::regression;
+
+BOOST_AUTO_TEST_SUITE(ParallelSGDTest);
+
+/**
+ * The generalized Rosenbrock function has dense gradients, so its steps are
+ * taken synchronously.
+ */
+BOOST_AUTO_TEST_CASE(SynchronousGeneralizedRosenbrockTest)
+{
+  GeneralizedRosenbrockFunction f(10);
+
+  ParallelSGD<GeneralizedRosenbrockFunction> s(f, 0.001, 0, 1e-15, 4, 4);
+  BOOST_REQUIRE_EQUAL(s.Threads(), 4);
+  BOOST_REQUIRE_EQUAL(s.BatchSize(), 4);
+
+  arma::mat coordinates = f.GetInitialPoint();
+  const double result = s.Optimize(coordinates);
+
+  BOOST_REQUIRE_SMALL(result, 1e-10);
+  for (size_t j = 0; j < 10; ++j)
+    BOOST_REQUIRE_CLOSE(coordinates[j], (double) 1.0, 1e-3);
+}
+
+/**
+ * Logistic regression on sparse features has sparse gradients, so its steps are
+ * taken without locking; the result should be close to the optimum found by
+ * L-BFGS.
+ */
+BOOST_AUTO_TEST_CASE(HogwildLogisticRegressionTest)
+{
+  arma::mat data = arma::randu<arma::mat>(30, 200);
+  data.elem(arma::find(data < 0.8)).zeros();
+  arma::vec responses(200);
+  for (size_t i = 0; i < 200; ++i)
+    responses[i] = (arma::accu(data.rows(0, 14).col(i)) >
+        arma::accu(data.rows(15, 29).col(i))) ? 1 : 0;
+
+  LogisticRegressionFunction<> lrf(data, responses, 0.5);
+
+  arma::mat optimum = arma::zeros<arma::mat>(31, 1);
+  L_BFGS<LogisticRegressionFunction<> > lbfgs(lrf);
+  const double optimalObjective = lbfgs.Optimize(optimum);
+
+  ParallelSGD<LogisticRegressionFunction<> > s(lrf, 0.01, 200000, 1e-6);
+  arma::mat parameters = arma::zeros<arma::mat>(31, 1);
+  const double objective = s.Optimize(parameters);
+
+  BOOST_REQUIRE_CLOSE(objective, lrf.Evaluate(parameters), 1e-5);
+  BOOST_REQUIRE_CLOSE(objective, optimalObjective, 1.0);
+}
+
+/**
+ * Synchronous steps must give exactly the same result for any number of
+ * threads.
+ */
+BOOST_AUTO_TEST_CASE(SynchronousThreadIndependenceTest)
+{
+  GeneralizedRosenbrockFunction f(20);
+
+  arma::mat reference;
+  for (size_t threads = 1; threads <= 4; ++threads)
+  {
+    ParallelSGD<GeneralizedRosenbrockFunction> s(f, 0.001, 2000, 1e-15,
+        threads, 4);
+    arma::mat coordinates = f.GetInitialPoint();
+    math::RandomSeed(42);
+    s.Optimize(coordinates);
+
+    if (threads == 1)
+    {
+      reference = coordinates;
+      continue;
+    }
+
+    for (size_t j = 0; j < coordinates.n_elem; ++j)
+      BOOST_REQUIRE_EQUAL(coordinates[j], reference[j]);
+  }
+}
+
+/**
+ * With sparse gradients, a regularized coordinate that no function depends on
+ * must get the decay of every step of the pass, instead of being set to zero.
+ */
+BOOST_AUTO_TEST_CASE(HogwildUnusedCoordinateTest)
+{
+  arma::mat data = arma::randu<arma::mat>(10, 200);
+  data.elem(arma::find(data < 0.5)).zeros();
+  // No point has the fourth feature.
+  data.row(3).zeros();
+  arma::vec responses(200);
+  for (size_t i = 0; i < 200; ++i)
+    responses[i] = (data(0, i) > data(1, i)) ? 1 : 0;
+
+  LogisticRegressionFunction<> lrf(data, responses, 0.5);
+  arma::mat lambdas;
+  lrf.Regularization(lambdas);
+
+  // One pass over the functions.
+  ParallelSGD<LogisticRegressionFunction<> > s(lrf, 0.01, 200, 1e-15);
+  arma::mat parameters = arma::zeros<arma::mat>(11, 1);
+  parameters[4] = 1.0;
+  s.Optimize(parameters);
+
+  BOOST_REQUIRE_CLOSE(parameters[4], std::pow(1.0 - 0.01 * lambdas[4], 200.0),
+      1e-8);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
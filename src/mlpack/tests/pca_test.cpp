@@ -6,6 +6,7 @@
  */
 #include <mlpack/core.hpp>
 #include <mlpack/methods/pca/pca.hpp>
+#include <mlpack/methods/pca/incremental_pca.hpp>
 
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -44,6 +45,39 @@ BOOST_AUTO_TEST_CASE(ArmaComparisonPCATest)
   }
 }
 
+/**
+ * Compare the output of our PCA implementation with Armadillo's when there are
+ * many more points than dimensions (so the covariance matrix is decomposed).
+ */
+BOOST_AUTO_TEST_CASE(ArmaComparisonManyPointsPCATest)
+{
+  mat coeff, coeff1;
+  vec eigVal, eigVal1;
+  mat score, score1;
+
+  mat data = randu<mat>(10, 1000);
+  data.row(0) *= 10;
+  data.row(1) += 100;
+
+  PCA p;
+
+  p.Apply(data, score1, eigVal1, coeff1);
+  princomp(coeff, score, eigVal, trans(data));
+
+  BOOST_REQUIRE_EQUAL(eigVal1.n_elem, eigVal.n_elem);
+  for (size_t i = 0; i < eigVal.n_elem; i++)
+    BOOST_REQUIRE_CLOSE(eigVal[i], eigVal1[i], 0.0001);
+
+  // The projected data should be the same, up to the sign of each component.
+  score = trans(score);
+  for (size_t i = 0; i < score.n_rows; i++)
+  {
+    const double sign = (dot(score.row(i), score1.row(i)) > 0) ? 1.0 : -1.0;
+    for (size_t j = 0; j < score.n_cols; j++)
+      BOOST_REQUIRE_SMALL(score(i, j) - sign * score1(i, j), 1e-8);
+  }
+}
+
 /**
  * Test that dimensionality reduction with PCA works the same way MATLAB does
  * (which should be correct!).
@@ -198,4 +232,112 @@ BOOST_AUTO_TEST_CASE(PCAScalingTest)
 }
 
 
+/**
+ * Randomized PCA of a dataset with (nearly) low rank should give the same
+ * projection and retained variance as exact PCA, up to the signs of the
+ * components.
+ */
+BOOST_AUTO_TEST_CASE(RandomizedPCATest)
+{
+  for (size_t scale = 0; scale < 2; ++scale)
+  {
+    // 40-dimensional data that mostly lies in a 3-dimensional subspace.
+    mat data = randn<mat>(40, 3) * diagmat(vec("10 5 2")) *
+        randn<mat>(3, 500) + 0.01 * randn<mat>(40, 500);
+    data.each_col() += randu<vec>(40);
+    mat randomizedData = data;
+
+    PCA p(scale == 1);
+    const double varRetained = p.Apply(data, (size_t) 3);
+
+    PCA randomizedP(scale == 1);
+    randomizedP.Randomized() = true;
+    const double randomizedVarRetained = randomizedP.Apply(randomizedData,
+        (size_t) 3);
+
+    BOOST_REQUIRE_EQUAL(randomizedData.n_rows, 3);
+    BOOST_REQUIRE_EQUAL(randomizedData.n_cols, 500);
+    BOOST_REQUIRE_CLOSE(varRetained, randomizedVarRetained, 1e-3);
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+      const double sign = (dot(data.row(i), randomizedData.row(i)) > 0) ? 1.0 :
+          -1.0;
+      for (size_t j = 0; j < 500; ++j)
+        BOOST_REQUIRE_SMALL(data(i, j) - sign * randomizedData(i, j), 1e-4);
+    }
+  }
+}
+
+/**
+ * Incremental PCA with enough components to represent the data exactly should
+ * give the same components and eigenvalues as PCA on all of the data at once.
+ */
+BOOST_AUTO_TEST_CASE(IncrementalPCATest)
+{
+  mat data = randn<mat>(6, 6) * randn<mat>(6, 1000);
+  data.each_col() += 3 * randu<vec>(6);
+
+  PCA p;
+  mat transData;
+  vec eigval;
+  mat eigvec;
+  p.Apply(data, transData, eigval, eigvec);
+
+  IncrementalPCA incremental(6);
+  for (size_t begin = 0; begin < 1000; begin += 150)
+    incremental.Update(data.cols(begin, std::min(begin + 150,
+        (size_t) 1000) - 1));
+
+  BOOST_REQUIRE_EQUAL(incremental.Points(), 1000);
+  for (size_t i = 0; i < 6; ++i)
+    BOOST_REQUIRE_CLOSE(incremental.Mean()[i], mean(data.row(i)), 1e-8);
+
+  const vec incrementalEigval = incremental.EigenValues();
+  BOOST_REQUIRE_EQUAL(incrementalEigval.n_elem, 6);
+  for (size_t i = 0; i < 6; ++i)
+    BOOST_REQUIRE_CLOSE(incrementalEigval[i], eigval[i], 1e-5);
+
+  // The projections should match, up to the signs of the components.
+  mat incrementalTransData;
+  incremental.Transform(data, incrementalTransData);
+  for (size_t i = 0; i < 6; ++i)
+  {
+    const double sign = (dot(transData.row(i), incrementalTransData.row(i)) >
+        0) ? 1.0 : -1.0;
+    for (size_t j = 0; j < 1000; ++j)
+      BOOST_REQUIRE_SMALL(transData(i, j) - sign * incrementalTransData(i, j),
+          1e-6);
+  }
+}
+
+/**
+ * With fewer components than the data has, incremental PCA should still find
+ * the dominant components of data which is close to low-rank.
+ */
+BOOST_AUTO_TEST_CASE(IncrementalPCALowRankTest)
+{
+  mat basis = randn<mat>(20, 2);
+  mat data = basis * diagmat(vec("10 3")) * randn<mat>(2, 2000) +
+      0.01 * randn<mat>(20, 2000);
+
+  PCA p;
+  mat transData;
+  vec eigval;
+  mat eigvec;
+  p.Apply(data, transData, eigval, eigvec);
+
+  IncrementalPCA incremental(2);
+  for (size_t begin = 0; begin < 2000; begin += 100)
+    incremental.Update(data.cols(begin, begin + 99));
+
+  const vec incrementalEigval = incremental.EigenValues();
+  for (size_t i = 0; i < 2; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(incrementalEigval[i], eigval[i], 0.1);
+    BOOST_REQUIRE_CLOSE(std::abs(dot(incremental.EigenVectors().col(i),
+        eigvec.col(i))), 1.0, 0.1);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -166,4 +166,31 @@ BOOST_AUTO_TEST_CASE(SecondaryConstructor)
   Perceptron<> p2(p1);
 }
 
+/**
+ * This tests that training on several shards in parallel, with parameter
+ * mixing, converges on linearly separable data, and that classifying many
+ * points at once (in several blocks) gives the correct labels.
+ */
+BOOST_AUTO_TEST_CASE(ParallelShardTraining)
+{
+  mat trainData = randu<mat>(2, 3000);
+  Row<size_t> labels(3000);
+  for (size_t i = 0; i < trainData.n_cols; ++i)
+  {
+    labels[i] = i % 3;
+    if (labels[i] == 1)
+      trainData(0, i) += 10.0;
+    else if (labels[i] == 2)
+      trainData(1, i) += 10.0;
+  }
+
+  Perceptron<> p(trainData, labels, 1000, 4);
+
+  Row<size_t> predictedLabels(trainData.n_cols);
+  p.Classify(trainData, predictedLabels);
+
+  for (size_t i = 0; i < trainData.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(predictedLabels[i], labels[i]);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,96 @@
+/**
+ * @file pq_search_test.cpp
+ *
+ * Tests for the PQSearch class.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/methods/pq/pq_search.hpp>
+#include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::neighbor;
+
+BOOST_AUTO_TEST_SUITE(PQSearchTest);
+
+/**
+ * Make sure that the codes reconstruct the points much better than their mean
+ * does.
+ */
+BOOST_AUTO_TEST_CASE(DecodeTest)
+{
+  arma::mat dataset;
+  dataset.randu(6, 1000);
+
+  PQSearch pq(3);
+  pq.Train(dataset);
+  pq.Add(dataset);
+  BOOST_REQUIRE_EQUAL(pq.Size(), 1000);
+  BOOST_REQUIRE_EQUAL(pq.ListCentroids().n_cols, 1);
+  for (size_t m = 0; m < 3; ++m)
+  {
+    BOOST_REQUIRE_EQUAL(pq.Codebook(m).n_rows, 2);
+    BOOST_REQUIRE_EQUAL(pq.Codebook(m).n_cols, 256);
+  }
+
+  // The variance of each dimension is 1 / 12.
+  double error = 0.0;
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+  {
+    arma::vec point;
+    pq.Decode(i, point);
+    error += arma::accu(arma::square(point - dataset.col(i)));
+  }
+  BOOST_REQUIRE_LT(error / dataset.n_elem, 0.01);
+}
+
+/**
+ * Add the points in two chunks to an index with an inverted file, and make
+ * sure that most true nearest neighbors are found when all lists are searched,
+ * and that searching one list still returns valid neighbors.
+ */
+BOOST_AUTO_TEST_CASE(InvertedFileRecallTest)
+{
+  arma::mat dataset;
+  dataset.randu(8, 4000);
+  arma::mat queries;
+  queries.randu(8, 100);
+
+  PQSearch pq(4, 10);
+  pq.Threads() = 4;
+  pq.Train(dataset);
+  pq.Add(dataset.cols(0, 1999));
+  pq.Add(dataset.cols(2000, 3999));
+  BOOST_REQUIRE_EQUAL(pq.Size(), 4000);
+  BOOST_REQUIRE_EQUAL(pq.ListCentroids().n_cols, 10);
+
+  AllkNN allknn(dataset, queries);
+  arma::Mat<size_t> trueNeighbors;
+  arma::mat trueDistances;
+  allknn.Search(1, trueNeighbors, trueDistances);
+
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  pq.Search(queries, 10, neighbors, distances, 10);
+
+  size_t found = 0;
+  for (size_t i = 0; i < queries.n_cols; ++i)
+    for (size_t j = 0; j < neighbors.n_rows; ++j)
+      if (neighbors(j, i) == trueNeighbors(0, i))
+        ++found;
+  BOOST_REQUIRE_GT(found, 80);
+
+  pq.Search(queries, 10, neighbors, distances, 1);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    if (neighbors[i] != (size_t() - 1))
+    {
+      BOOST_REQUIRE_LT(neighbors[i], 4000);
+      if (i % neighbors.n_rows > 0)
+        BOOST_REQUIRE_LE(distances[i - 1], distances[i]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
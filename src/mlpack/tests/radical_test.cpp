@@ -52,4 +52,35 @@ BOOST_AUTO_TEST_CASE(Radical_Test_Radical3D)
   BOOST_REQUIRE_CLOSE(valBest, valEst, 0.25);
 }
 
+/**
+ * Make sure that searching the angles with several threads gives the same
+ * result as searching them with one.
+ */
+BOOST_AUTO_TEST_CASE(RadicalThreadsTest)
+{
+  mat matX;
+  data::Load("data_3d_mixed.txt", matX);
+
+  Radical rad(0.175, 5, 100, matX.n_rows - 1, 0, 1);
+  Radical radThreads(0.175, 5, 100, matX.n_rows - 1, 0, 4);
+
+  mat matY, matW;
+  math::RandomSeed(10);
+  rad.DoRadical(matX, matY, matW);
+
+  mat matYThreads, matWThreads;
+  math::RandomSeed(10);
+  radThreads.DoRadical(matX, matYThreads, matWThreads);
+
+  BOOST_REQUIRE_EQUAL(matY.n_rows, matYThreads.n_rows);
+  BOOST_REQUIRE_EQUAL(matY.n_cols, matYThreads.n_cols);
+  for (uword i = 0; i < matY.n_elem; ++i)
+  {
+    if (std::abs(matY[i]) < 1e-8)
+      BOOST_REQUIRE_SMALL(matYThreads[i], 1e-8);
+    else
+      BOOST_REQUIRE_CLOSE(matY[i], matYThreads[i], 1e-6);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
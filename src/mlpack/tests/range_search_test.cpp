@@ -1060,4 +1060,185 @@ BOOST_AUTO_TEST_CASE(DualBallTreeTest2)
   }
 }
 
+/**
+ * Make sure that searching into a RangeSearchResults object gives the same
+ * results as searching into vectors, for each search mode and with and without
+ * a query set.
+ */
+BOOST_AUTO_TEST_CASE(RangeSearchResultsTest)
+{
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+  arma::mat queries = dataset.cols(0, 299) + 0.01;
+
+  for (size_t mode = 0; mode < 6; ++mode)
+  {
+    const bool naive = (mode % 3 == 0);
+    const bool singleMode = (mode % 3 == 1);
+    RangeSearch<>* rs = (mode < 3) ?
+        new RangeSearch<>(dataset, queries, naive, singleMode) :
+        new RangeSearch<>(dataset, naive, singleMode);
+
+    vector<vector<size_t> > neighbors;
+    vector<vector<double> > distances;
+    rs->Search(Range(0.15, 0.8), neighbors, distances);
+
+    RangeSearchResults results;
+    rs->Search(Range(0.15, 0.8), results);
+
+    BOOST_REQUIRE_EQUAL(results.NumQueries(), neighbors.size());
+
+    vector<vector<pair<double, size_t> > > sorted;
+    SortResults(neighbors, distances, sorted);
+
+    size_t total = 0;
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+      BOOST_REQUIRE_EQUAL(results.NumResults(i), sorted[i].size());
+      total += sorted[i].size();
+
+      vector<pair<double, size_t> > flat(results.NumResults(i));
+      for (size_t j = 0; j < flat.size(); ++j)
+        flat[j] = make_pair(results.Distance(i, j), results.Neighbor(i, j));
+      sort(flat.begin(), flat.end());
+
+      for (size_t j = 0; j < flat.size(); ++j)
+      {
+        BOOST_REQUIRE_EQUAL(flat[j].second, sorted[i][j].second);
+        BOOST_REQUIRE_CLOSE(flat[j].first, sorted[i][j].first, 1e-5);
+      }
+    }
+
+    BOOST_REQUIRE_EQUAL(results.TotalResults(), total);
+
+    delete rs;
+  }
+}
+
+/**
+ * Make sure that Count() gives the number of results of Search(), for each
+ * search mode, with and without a query set, and with the cover tree, both for
+ * a range that includes zero and for one that does not.
+ */
+BOOST_AUTO_TEST_CASE(CountTest)
+{
+  arma::mat dataset;
+  if (!data::Load("test_data_3_1000.csv", dataset))
+    BOOST_FAIL("Cannot load test dataset test_data_3_1000.csv!");
+  arma::mat queries = dataset.cols(0, 299) + 0.01;
+
+  typedef tree::CoverTree<metric::EuclideanDistance, tree::FirstPointIsRoot,
+      RangeSearchStat> CoverTreeType;
+  CoverTreeType coverTree(dataset);
+
+  for (size_t r = 0; r < 2; ++r)
+  {
+    const Range range = (r == 0) ? Range(0.0, 0.5) : Range(0.15, 0.8);
+
+    for (size_t mode = 0; mode < 6; ++mode)
+    {
+      const bool naive = (mode % 3 == 0);
+      const bool singleMode = (mode % 3 == 1);
+      RangeSearch<>* rs = (mode < 3) ?
+          new RangeSearch<>(dataset, queries, naive, singleMode) :
+          new RangeSearch<>(dataset, naive, singleMode);
+
+      vector<vector<size_t> > neighbors;
+      vector<vector<double> > distances;
+      rs->Search(range, neighbors, distances);
+
+      arma::Col<size_t> counts;
+      rs->Count(range, counts);
+
+      BOOST_REQUIRE_EQUAL(counts.n_elem, neighbors.size());
+      for (size_t i = 0; i < neighbors.size(); ++i)
+        BOOST_REQUIRE_EQUAL(counts[i], neighbors[i].size());
+
+      delete rs;
+    }
+
+    RangeSearch<metric::EuclideanDistance, CoverTreeType> coverSearch(
+        &coverTree, dataset);
+
+    vector<vector<size_t> > neighbors;
+    vector<vector<double> > distances;
+    coverSearch.Search(range, neighbors, distances);
+
+    arma::Col<size_t> counts;
+    coverSearch.Count(range, counts);
+
+    BOOST_REQUIRE_EQUAL(counts.n_elem, neighbors.size());
+    for (size_t i = 0; i < neighbors.size(); ++i)
+      BOOST_REQUIRE_EQUAL(counts[i], neighbors[i].size());
+  }
+}
+
+/**
+ * Make sure that building the trees on the given matrices in place gives the
+ * same results as building them on copies, and that the permutations given
+ * back describe how the matrices were rearranged.
+ */
+BOOST_AUTO_TEST_CASE(InPlaceTreeBuildingTest)
+{
+  arma::mat reference(3, 1000);
+  reference.randu();
+  arma::mat query(3, 200);
+  query.randu();
+  const Range range(0.05, 0.15);
+
+  for (size_t mode = 0; mode < 3; ++mode)
+  {
+    const bool singleMode = (mode == 1);
+    const bool monochromatic = (mode == 2);
+
+    RangeSearch<>* copying = monochromatic ?
+        new RangeSearch<>(reference, false, singleMode) :
+        new RangeSearch<>(reference, query, false, singleMode);
+    vector<vector<size_t> > neighbors;
+    vector<vector<double> > distances;
+    copying->Search(range, neighbors, distances);
+    delete copying;
+
+    arma::mat inPlaceReference(reference);
+    arma::mat inPlaceQuery(query);
+    vector<size_t> oldFromNewReferences;
+    vector<size_t> oldFromNewQueries;
+    RangeSearch<>* inPlace = monochromatic ?
+        new RangeSearch<>(inPlaceReference, oldFromNewReferences, singleMode) :
+        new RangeSearch<>(inPlaceReference, inPlaceQuery, oldFromNewReferences,
+            oldFromNewQueries, singleMode);
+
+    BOOST_REQUIRE_EQUAL(oldFromNewReferences.size(), reference.n_cols);
+    for (size_t i = 0; i < reference.n_cols; ++i)
+      for (size_t d = 0; d < reference.n_rows; ++d)
+        BOOST_REQUIRE_EQUAL(inPlaceReference(d, i),
+            reference(d, oldFromNewReferences[i]));
+    if (!monochromatic)
+    {
+      BOOST_REQUIRE_EQUAL(oldFromNewQueries.size(), query.n_cols);
+      for (size_t i = 0; i < query.n_cols; ++i)
+        for (size_t d = 0; d < query.n_rows; ++d)
+          BOOST_REQUIRE_EQUAL(inPlaceQuery(d, i),
+              query(d, oldFromNewQueries[i]));
+    }
+
+    vector<vector<size_t> > inPlaceNeighbors;
+    vector<vector<double> > inPlaceDistances;
+    inPlace->Search(range, inPlaceNeighbors, inPlaceDistances);
+    delete inPlace;
+
+    // The order of the results of each point is not specified, so sort them.
+    BOOST_REQUIRE_EQUAL(inPlaceNeighbors.size(), neighbors.size());
+    for (size_t i = 0; i < neighbors.size(); ++i)
+    {
+      sort(neighbors[i].begin(), neighbors[i].end());
+      sort(inPlaceNeighbors[i].begin(), inPlaceNeighbors[i].end());
+      BOOST_REQUIRE_EQUAL(inPlaceNeighbors[i].size(), neighbors[i].size());
+      for (size_t j = 0; j < neighbors[i].size(); ++j)
+        BOOST_REQUIRE_EQUAL(inPlaceNeighbors[i][j], neighbors[i][j]);
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -10,6 +10,7 @@
 #include <mlpack/core/tree/tree_traits.hpp>
 #include <mlpack/core/tree/rectangle_tree.hpp>
 #include <mlpack/methods/neighbor_search/neighbor_search.hpp>
+#include <mlpack/methods/range_search/range_search.hpp>
 
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
@@ -18,6 +19,7 @@ using namespace mlpack;
 using namespace mlpack::neighbor;
 using namespace mlpack::tree;
 using namespace mlpack::metric;
+using namespace mlpack::range;
 
 BOOST_AUTO_TEST_SUITE(RectangleTreeTest);
 
@@ -182,10 +184,10 @@ void CheckExactContainment(const TreeType& tree)
       double max = -1.0 * DBL_MAX;
       for(size_t j = 0; j < tree.Count(); j++)
       {
-        if (tree.LocalDataset().col(j)[i] < min)
-          min = tree.LocalDataset().col(j)[i];
-        if (tree.LocalDataset().col(j)[i] > max)
-          max = tree.LocalDataset().col(j)[i];
+        if (tree.Dataset()(i, tree.Points()[j]) < min)
+          min = tree.Dataset()(i, tree.Points()[j]);
+        if (tree.Dataset()(i, tree.Points()[j]) > max)
+          max = tree.Dataset()(i, tree.Points()[j]);
       }
       BOOST_REQUIRE_EQUAL(max, tree.Bound()[i].Hi());
       BOOST_REQUIRE_EQUAL(min, tree.Bound()[i].Lo());
@@ -248,37 +250,34 @@ BOOST_AUTO_TEST_CASE(RectangleTreeContainmentTest)
 }
 
 /**
- * A function to ensure that the dataset for the tree, and the datasets stored
- * in each leaf node are in sync.
+ * A function to ensure that the points of each leaf of a reordered tree are
+ * contiguous, with the leaves in depth-first order.
+ *
  * @param tree The tree to check.
+ * @param next The index the next point should have.
  */
 template<typename TreeType>
-void CheckSync(const TreeType& tree)
+void CheckContiguous(const TreeType& tree, size_t& next)
 {
   if (tree.IsLeaf())
   {
     for (size_t i = 0; i < tree.Count(); i++)
-    {
-      for (size_t j = 0; j < tree.LocalDataset().n_rows; j++)
-      {
-        BOOST_REQUIRE_EQUAL(tree.LocalDataset().col(i)[j],
-                            tree.Dataset().col(tree.Points()[i])[j]);
-      }
-    }
+      BOOST_REQUIRE_EQUAL(tree.Points()[i], next++);
   }
   else
   {
     for (size_t i = 0; i < tree.NumChildren(); i++)
-      CheckSync(*tree.Children()[i]);
+      CheckContiguous(*tree.Children()[i], next);
   }
 }
 
-// Test to ensure that the dataset used by the whole tree (and the traversers)
-// is in sync with the datasets stored in each leaf node.
-BOOST_AUTO_TEST_CASE(TreeLocalDatasetInSync)
+// Test that reordering the dataset makes the points of each leaf contiguous,
+// moves the points correctly, and leaves the bounds valid.
+BOOST_AUTO_TEST_CASE(TreeReorderDataset)
 {
   arma::mat dataset;
   dataset.randu(8, 1000); // 1000 points in 8 dimensions.
+  arma::mat oldDataset(dataset);
 
   typedef RectangleTree<
       RTreeSplit<RTreeDescentHeuristic,
@@ -288,8 +287,26 @@ BOOST_AUTO_TEST_CASE(TreeLocalDatasetInSync)
       NeighborSearchStat<NearestNeighborSort>,
       arma::mat> TreeType;
 
-  TreeType tree(dataset, 20, 6, 5, 2, 0);
-  CheckSync(tree);
+  // Leave the first ten points out of the tree; they should go at the end.
+  TreeType tree(dataset, 20, 6, 5, 2, 10);
+
+  std::vector<size_t> oldFromNew;
+  tree.ReorderDataset(oldFromNew);
+
+  BOOST_REQUIRE_EQUAL(oldFromNew.size(), 1000);
+  for (size_t i = 0; i < 10; i++)
+    BOOST_REQUIRE_EQUAL(oldFromNew[990 + i], i);
+
+  for (size_t i = 0; i < dataset.n_cols; i++)
+    for (size_t j = 0; j < dataset.n_rows; j++)
+      BOOST_REQUIRE_EQUAL(dataset(j, i), oldDataset(j, oldFromNew[i]));
+
+  size_t next = 0;
+  CheckContiguous(tree, next);
+  BOOST_REQUIRE_EQUAL(next, 990);
+
+  CheckContainment(tree);
+  CheckExactContainment(tree);
 }
 
 /**
@@ -416,6 +433,68 @@ BOOST_AUTO_TEST_CASE(TreeBalance)
   BOOST_REQUIRE_EQUAL(tree.TreeDepth(), GetMinLevel(tree));
 }
 
+// Make sure a bulk-loaded tree is a valid, balanced tree that holds every point
+// once, that it can still be grown dynamically, and that searching it gives the
+// same results as a naive search.
+BOOST_AUTO_TEST_CASE(BulkLoadTest)
+{
+  arma::mat dataset;
+  dataset.randu(8, 2000);
+
+  typedef RectangleTree<
+      RStarTreeSplit<RStarTreeDescentHeuristic,
+                     NeighborSearchStat<NearestNeighborSort>,
+                     arma::mat>,
+      RStarTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> TreeType;
+  TreeType tree(dataset, 20, 6, 5, 2, 0, true);
+
+  BOOST_REQUIRE_EQUAL(tree.NumDescendants(), 2000);
+  BOOST_REQUIRE_EQUAL(GetMinLevel(tree), GetMaxLevel(tree));
+  CheckFills(tree);
+  CheckContainment(tree);
+  CheckExactContainment(tree);
+  CheckHierarchy(tree);
+  CheckSync(tree);
+
+  // Every point should be in the tree exactly once.
+  std::vector<size_t> seen(2000, 0);
+  for (size_t i = 0; i < tree.NumDescendants(); i++)
+    ++seen[tree.Descendant(i)];
+  for (size_t i = 0; i < seen.size(); i++)
+    BOOST_REQUIRE_EQUAL(seen[i], 1);
+
+  // Now add some points the usual way.
+  arma::mat newPoints;
+  newPoints.randu(8, 100);
+  dataset.insert_cols(2000, newPoints);
+  for (size_t i = 2000; i < 2100; i++)
+    tree.InsertPoint(i);
+
+  BOOST_REQUIRE_EQUAL(tree.NumDescendants(), 2100);
+  BOOST_REQUIRE_EQUAL(GetMinLevel(tree), GetMaxLevel(tree));
+  CheckContainment(tree);
+  CheckSync(tree);
+
+  NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>, TreeType>
+      allknn(&tree, dataset, true);
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  allknn.Search(5, neighbors, distances);
+
+  AllkNN naive(dataset, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  for (size_t i = 0; i < neighbors.n_elem; i++)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], naiveDistances[i], 1e-5);
+  }
+}
+
 // A test to see if point deletion is working correctly.  We build a tree, then
 // delete numIter points and test that the query gives correct results.  It is
 // remotely possible that this test will give a false negative if it should
@@ -578,6 +657,116 @@ BOOST_AUTO_TEST_CASE(PointDynamicAdd)
   }
 }
 
+// Add and then remove points through NeighborSearch::Insert() and
+// NeighborSearch::Remove(), and make sure the results match a naive search on
+// the points that are left.
+BOOST_AUTO_TEST_CASE(NeighborSearchInsertRemoveTest)
+{
+  arma::mat dataset;
+  dataset.randu(8, 1000);
+  arma::mat querySet;
+  querySet.randu(8, 200);
+  arma::mat newPoints;
+  newPoints.randu(8, 100);
+
+  typedef RectangleTree<
+      RStarTreeSplit<RStarTreeDescentHeuristic,
+                     NeighborSearchStat<NearestNeighborSort>,
+                     arma::mat>,
+      RStarTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> TreeType;
+  TreeType tree(dataset, 20, 6, 5, 2, 0);
+
+  NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>, TreeType>
+      allknn(&tree, NULL, dataset, querySet, true);
+
+  // Search once before the reference set changes, to make sure nothing stale
+  // is left behind.
+  arma::Mat<size_t> neighbors;
+  arma::mat distances;
+  allknn.Search(5, neighbors, distances);
+
+  allknn.Insert(newPoints);
+  BOOST_REQUIRE_EQUAL(dataset.n_cols, 1100);
+  BOOST_REQUIRE_EQUAL(tree.NumDescendants(), 1100);
+
+  // Remove the last 50 points, so that the remaining points are a prefix of
+  // the dataset.
+  arma::Col<size_t> indices = arma::linspace<arma::Col<size_t> >(1050, 1099,
+      50);
+  allknn.Remove(indices);
+  BOOST_REQUIRE_EQUAL(tree.NumDescendants(), 1050);
+
+  CheckContainment(tree);
+  CheckSync(tree);
+  CheckExactContainment(tree);
+
+  allknn.Search(5, neighbors, distances);
+
+  arma::mat naiveSet = dataset.cols(0, 1049);
+  AllkNN naive(naiveSet, querySet, true);
+  arma::Mat<size_t> naiveNeighbors;
+  arma::mat naiveDistances;
+  naive.Search(5, naiveNeighbors, naiveDistances);
+
+  for (size_t i = 0; i < neighbors.n_elem; i++)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], naiveNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], naiveDistances[i], 1e-5);
+  }
+}
+
+// Make sure that RangeSearch::Insert() and RangeSearch::Remove() give the same
+// results as a naive search on the points that are left.
+BOOST_AUTO_TEST_CASE(RangeSearchInsertRemoveTest)
+{
+  arma::mat dataset;
+  dataset.randu(3, 500);
+  arma::mat querySet;
+  querySet.randu(3, 100);
+  arma::mat newPoints;
+  newPoints.randu(3, 60);
+
+  typedef RectangleTree<
+      RStarTreeSplit<RStarTreeDescentHeuristic, RangeSearchStat, arma::mat>,
+      RStarTreeDescentHeuristic,
+      RangeSearchStat,
+      arma::mat> TreeType;
+  TreeType tree(dataset, 20, 6, 5, 2, 0);
+
+  RangeSearch<metric::EuclideanDistance, TreeType> rs(&tree, NULL, dataset,
+      querySet, true);
+
+  rs.Insert(newPoints);
+  arma::Col<size_t> indices = arma::linspace<arma::Col<size_t> >(530, 559, 30);
+  rs.Remove(indices);
+  BOOST_REQUIRE_EQUAL(tree.NumDescendants(), 530);
+
+  std::vector<std::vector<size_t> > neighbors;
+  std::vector<std::vector<double> > distances;
+  rs.Search(math::Range(0.1, 0.3), neighbors, distances);
+
+  arma::mat naiveSet = dataset.cols(0, 529);
+  RangeSearch<> naive(naiveSet, querySet, true);
+  std::vector<std::vector<size_t> > naiveNeighbors;
+  std::vector<std::vector<double> > naiveDistances;
+  naive.Search(math::Range(0.1, 0.3), naiveNeighbors, naiveDistances);
+
+  BOOST_REQUIRE_EQUAL(neighbors.size(), naiveNeighbors.size());
+  for (size_t i = 0; i < neighbors.size(); i++)
+  {
+    std::vector<size_t> sorted(neighbors[i]);
+    std::vector<size_t> naiveSorted(naiveNeighbors[i]);
+    std::sort(sorted.begin(), sorted.end());
+    std::sort(naiveSorted.begin(), naiveSorted.end());
+
+    BOOST_REQUIRE_EQUAL(sorted.size(), naiveSorted.size());
+    for (size_t j = 0; j < sorted.size(); j++)
+      BOOST_REQUIRE_EQUAL(sorted[j], naiveSorted[j]);
+  }
+}
+
 // A test to ensure that the SingleTreeTraverser is working correctly by
 // comparing its results to the results of a naive search.
 BOOST_AUTO_TEST_CASE(SingleTreeTraverserTest)
@@ -884,4 +1073,147 @@ BOOST_AUTO_TEST_CASE(RStarTreeSplitTest)
       0.9, 1e-15);
 }
 
+// Make sure snapshots of a ConcurrentRectangleTree don't change when points
+// are inserted and deleted, and that searches on them give the same results as
+// naive search on their datasets.
+BOOST_AUTO_TEST_CASE(ConcurrentRectangleTreeSnapshotTest)
+{
+  arma::mat dataset;
+  dataset.randu(8, 1000);
+  arma::mat querySet;
+  querySet.randu(8, 100);
+  arma::mat newPoints;
+  newPoints.randu(8, 50);
+
+  typedef RectangleTree<
+      RStarTreeSplit<RStarTreeDescentHeuristic,
+                     NeighborSearchStat<NearestNeighborSort>,
+                     arma::mat>,
+      RStarTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> TreeType;
+  typedef ConcurrentRectangleTree<TreeType> ConcurrentTreeType;
+  ConcurrentTreeType tree(dataset, 20, 6, 5, 2);
+
+  const ConcurrentTreeType::Snapshot* s1 = tree.Acquire();
+  BOOST_REQUIRE_EQUAL(s1->Version(), 0);
+  BOOST_REQUIRE_EQUAL(s1->Tree()->NumDescendants(), 1000);
+
+  for (size_t i = 0; i < newPoints.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(tree.InsertPoint(newPoints.col(i)), 1000 + i);
+  for (size_t i = 0; i < 20; ++i)
+    BOOST_REQUIRE(tree.DeletePoint(i));
+
+  // Nothing is published yet.
+  BOOST_REQUIRE_EQUAL(tree.Version(), 0);
+  BOOST_REQUIRE_EQUAL(tree.Snapshots(), 1);
+  tree.Publish();
+
+  // The first snapshot is kept, and is unchanged.
+  BOOST_REQUIRE_EQUAL(tree.Version(), 1);
+  BOOST_REQUIRE_EQUAL(tree.Snapshots(), 2);
+  BOOST_REQUIRE_EQUAL(s1->Version(), 0);
+  BOOST_REQUIRE_EQUAL(s1->Dataset().n_cols, 1000);
+  BOOST_REQUIRE_EQUAL(s1->Tree()->NumDescendants(), 1000);
+  CheckContainment(*s1->Tree());
+  CheckExactContainment(*s1->Tree());
+
+  const ConcurrentTreeType::Snapshot* s2 = tree.Acquire();
+  BOOST_REQUIRE_EQUAL(s2->Version(), 1);
+  BOOST_REQUIRE_EQUAL(s2->Dataset().n_cols, 1050);
+  BOOST_REQUIRE_EQUAL(s2->Tree()->NumDescendants(), 1030);
+  CheckContainment(*s2->Tree());
+  CheckExactContainment(*s2->Tree());
+
+  // Single-tree search on the old snapshot gives the results of naive search
+  // on the old dataset.
+  NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>, TreeType>
+      allknn1(s1->Tree(), NULL, s1->Dataset(), querySet, true);
+  arma::Mat<size_t> neighbors1;
+  arma::mat distances1;
+  allknn1.Search(5, neighbors1, distances1);
+
+  AllkNN allknn2(dataset, querySet, true, true);
+  arma::Mat<size_t> neighbors2;
+  arma::mat distances2;
+  allknn2.Search(5, neighbors2, distances2);
+
+  for (size_t i = 0; i < neighbors1.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors1[i], neighbors2[i]);
+    BOOST_REQUIRE_CLOSE(distances1[i], distances2[i], 1e-5);
+  }
+
+  tree.Release(s1);
+  BOOST_REQUIRE_EQUAL(tree.Snapshots(), 1);
+  tree.Release(s2);
+  BOOST_REQUIRE_EQUAL(tree.Snapshots(), 1);
+
+  // Publishing with no changes does nothing.
+  tree.Publish();
+  BOOST_REQUIRE_EQUAL(tree.Version(), 1);
+}
+
+// Search snapshots from several threads while one thread inserts points and
+// publishes them.  Each version has a known number of points.
+BOOST_AUTO_TEST_CASE(ConcurrentRectangleTreeReadersTest)
+{
+  arma::mat dataset;
+  dataset.randu(4, 500);
+  arma::mat querySet;
+  querySet.randu(4, 20);
+  arma::mat newPoints;
+  newPoints.randu(4, 200);
+
+  typedef RectangleTree<
+      RStarTreeSplit<RStarTreeDescentHeuristic,
+                     NeighborSearchStat<NearestNeighborSort>,
+                     arma::mat>,
+      RStarTreeDescentHeuristic,
+      NeighborSearchStat<NearestNeighborSort>,
+      arma::mat> TreeType;
+  typedef ConcurrentRectangleTree<TreeType> ConcurrentTreeType;
+  ConcurrentTreeType tree(dataset);
+
+  size_t failures = 0;
+
+  // Every fifth iteration publishes ten new points.
+  #pragma omp parallel for reduction(+:failures)
+  for (omp_size_t i = 0; i < 100; ++i)
+  {
+    if (i % 5 == 0)
+    {
+      for (size_t j = 0; j < 10; ++j)
+        tree.InsertPoint(newPoints.col(2 * (size_t) i + j));
+      tree.Publish();
+      continue;
+    }
+
+    const ConcurrentTreeType::Snapshot* snapshot = tree.Acquire();
+    const size_t points = 500 + 10 * snapshot->Version();
+    if (snapshot->Tree()->NumDescendants() != points ||
+        snapshot->Dataset().n_cols != points)
+      ++failures;
+
+    NeighborSearch<NearestNeighborSort, metric::LMetric<2, true>, TreeType>
+        allknn(snapshot->Tree(), NULL, snapshot->Dataset(), querySet, true);
+    arma::Mat<size_t> neighbors;
+    arma::mat distances;
+    allknn.Search(1, neighbors, distances);
+    if (arma::max(neighbors.row(0)) >= points)
+      ++failures;
+
+    tree.Release(snapshot);
+  }
+
+  BOOST_REQUIRE_EQUAL(failures, 0);
+  BOOST_REQUIRE_EQUAL(tree.Version(), 20);
+  BOOST_REQUIRE_EQUAL(tree.Snapshots(), 1);
+
+  const ConcurrentTreeType::Snapshot* snapshot = tree.Acquire();
+  BOOST_REQUIRE_EQUAL(snapshot->Tree()->NumDescendants(), 700);
+  CheckExactContainment(*snapshot->Tree());
+  tree.Release(snapshot);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -244,4 +244,74 @@ BOOST_AUTO_TEST_CASE(RegularizedSVDFunctionOptimize)
   BOOST_REQUIRE_SMALL(relativeError, 1e-2);
 }
 
+/**
+ * Warm-start RegularizedSVD from the factors that generated the ratings, with
+ * new users and items in the data.  The factors should grow to hold the new
+ * users and items, the factors of users without ratings should be kept, and
+ * the ratings should still be predicted well after a pass.
+ */
+BOOST_AUTO_TEST_CASE(RegularizedSVDWarmStart)
+{
+  // Define useful constants.
+  const size_t numUsers = 50;
+  const size_t numItems = 50;
+  const size_t numRatings = 500;
+  const size_t rank = 5;
+
+  // The factors of the original users and items.
+  arma::mat initialU = arma::randu(numItems, rank);
+  arma::mat initialV = arma::randu(rank, numUsers);
+
+  // The ratings are for the first 40 users and 10 new users, and for the
+  // original items and 5 new items.
+  arma::mat data = arma::randu(3, numRatings);
+  data.row(0) = floor(data.row(0) * 50);
+  data.row(1) = floor(data.row(1) * 55);
+  for (size_t i = 0; i < numRatings; i++)
+  {
+    if (data(0, i) >= 40)
+      data(0, i) += 10;
+  }
+  data(0, numRatings - 1) = 59;
+  data(1, numRatings - 1) = 54;
+
+  // Ratings that only involve the original users and items come from their
+  // factors.
+  std::vector<size_t> oldRatings;
+  for (size_t i = 0; i < numRatings; i++)
+  {
+    if (data(0, i) < numUsers && data(1, i) < numItems)
+    {
+      data(2, i) = arma::dot(initialU.row(data(1, i)),
+          initialV.col(data(0, i)));
+      oldRatings.push_back(i);
+    }
+  }
+
+  RegularizedSVD<> rSVD(1, 0.01, 0.0);
+  arma::mat u, v;
+  rSVD.Apply(data, initialU, initialV, u, v);
+
+  BOOST_REQUIRE_EQUAL(u.n_rows, 55);
+  BOOST_REQUIRE_EQUAL(u.n_cols, rank);
+  BOOST_REQUIRE_EQUAL(v.n_rows, rank);
+  BOOST_REQUIRE_EQUAL(v.n_cols, 60);
+
+  // Users 40 to 49 have no ratings, so their factors are unchanged.
+  for (size_t user = 40; user < numUsers; user++)
+    for (size_t j = 0; j < rank; j++)
+      BOOST_REQUIRE_EQUAL(v(j, user), initialV(j, user));
+
+  // The ratings of the original users and items are still predicted well.
+  double squaredError = 0.0;
+  for (size_t i = 0; i < oldRatings.size(); i++)
+  {
+    const size_t r = oldRatings[i];
+    const double error = data(2, r) - arma::dot(u.row(data(1, r)),
+        v.col(data(0, r)));
+    squaredError += error * error;
+  }
+  BOOST_REQUIRE_SMALL(std::sqrt(squaredError / oldRatings.size()), 0.1);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -125,4 +125,34 @@ BOOST_AUTO_TEST_CASE(RastrigrinFunctionTest)
   BOOST_REQUIRE_GE(successes, 1);
 }
 
+/**
+ * Make sure that parallel tempering with several chains also escapes from the
+ * local minima of the Rastrigrin function.
+ */
+BOOST_AUTO_TEST_CASE(RastrigrinFunctionChainsTest)
+{
+  size_t successes = 0;
+
+  for (size_t trial = 0; trial < 3; ++trial)
+  {
+    RastrigrinFunction f;
+    ExponentialSchedule schedule(3e-6);
+    SA<RastrigrinFunction> sa(f, schedule, 20000000, 100, 50, 1000, 1e-12, 2,
+        0.2, 0.01, 0.1, 4, 2.0);
+    arma::mat coordinates = f.GetInitialPoint();
+
+    const double result = sa.Optimize(coordinates);
+
+    // The returned energy must be the energy of the returned point.
+    BOOST_REQUIRE_CLOSE(result + 1.0, f.Evaluate(coordinates) + 1.0, 1e-8);
+
+    if ((std::abs(result) < 1e-3) &&
+        (std::abs(coordinates[0]) < 1e-3) &&
+        (std::abs(coordinates[1]) < 1e-3))
+      ++successes;
+  }
+
+  BOOST_REQUIRE_GE(successes, 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -171,4 +171,62 @@ BOOST_AUTO_TEST_CASE(SaveRestoreModelChildClassUsage)
   delete loader;
 }
 
+/**
+ * Make sure that binary archives store everything XML files do, including
+ * children, and that matrices come back exactly.
+ */
+BOOST_AUTO_TEST_CASE(SaveRestoreBinaryArchive)
+{
+  arma::mat matrix = arma::randu<arma::mat>(30, 40);
+  arma::vec vector = arma::randu<arma::vec>(25);
+  size_t s = 1200;
+  std::string str = "Hello world!";
+
+  SaveRestoreUtility child;
+  child.SaveParameter(ARGSTR(vector));
+  child.SaveParameter(ARGSTR(s));
+
+  SaveRestoreUtility sRM;
+  sRM.SaveParameter(ARGSTR(matrix));
+  sRM.SaveParameter(ARGSTR(str));
+  sRM.AddChild(child, "child");
+  BOOST_REQUIRE(sRM.WriteFile("test_binary_archive.bin"));
+
+  // The same loader reads this, and XML files as before.
+  SaveRestoreUtility loaded;
+  BOOST_REQUIRE(loaded.ReadFile("test_binary_archive.bin"));
+
+  arma::mat matrix2;
+  loaded.LoadParameter(matrix2, "matrix");
+  BOOST_REQUIRE_EQUAL(matrix2.n_rows, matrix.n_rows);
+  BOOST_REQUIRE_EQUAL(matrix2.n_cols, matrix.n_cols);
+  for (size_t i = 0; i < matrix.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(matrix2[i], matrix[i]);
+
+  std::string str2;
+  BOOST_REQUIRE_EQUAL(loaded.LoadParameter(str2, "str"), str);
+
+  BOOST_REQUIRE_EQUAL(loaded.Children().count("child"), 1);
+  SaveRestoreUtility loadedChild = loaded.Children()["child"];
+  BOOST_REQUIRE(loadedChild.HasParameter("vector"));
+  arma::vec vector2;
+  loadedChild.LoadParameter(vector2, "vector");
+  BOOST_REQUIRE_EQUAL(vector2.n_elem, vector.n_elem);
+  for (size_t i = 0; i < vector.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(vector2[i], vector[i]);
+  size_t s2;
+  BOOST_REQUIRE_EQUAL(loadedChild.LoadParameter(s2, "s"), s);
+
+  // Writing the loaded model as XML must still work.
+  BOOST_REQUIRE(loaded.WriteFile("test_binary_archive.xml"));
+  SaveRestoreUtility xml;
+  xml.ReadFile("test_binary_archive.xml");
+  xml.LoadParameter(matrix2, "matrix");
+  for (size_t i = 0; i < matrix.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(matrix2[i], matrix[i], 1e-5);
+
+  remove("test_binary_archive.bin");
+  remove("test_binary_archive.xml");
+}
+
 BOOST_AUTO_TEST_SUITE_END();
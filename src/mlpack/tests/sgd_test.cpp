@@ -58,4 +58,127 @@ BOOST_AUTO_TEST_CASE(GeneralizedRosenbrockTest)
   }
 }
 
+/**
+ * Make sure that SGD still converges when the objective is only evaluated at
+ * the end of each pass, either exactly or on a sample of the functions.
+ */
+BOOST_AUTO_TEST_CASE(GeneralizedRosenbrockPassObjectiveTest)
+{
+  GeneralizedRosenbrockFunction f(20);
+
+  // The exact objective, computed at the end of each pass.
+  SGD<GeneralizedRosenbrockFunction> s(f, 0.001, 0, 1e-15, true, 1,
+      f.NumFunctions());
+  BOOST_REQUIRE_EQUAL(s.ObjectiveSamples(), f.NumFunctions());
+
+  arma::mat coordinates = f.GetInitialPoint();
+  double result = s.Optimize(coordinates);
+
+  BOOST_REQUIRE_SMALL(result, 1e-10);
+  for (size_t j = 0; j < 20; ++j)
+    BOOST_REQUIRE_CLOSE(coordinates[j], (double) 1.0, 1e-3);
+
+  // An estimate from five of the functions.
+  SGD<GeneralizedRosenbrockFunction> sampled(f, 0.001, 0, 1e-15, true, 1, 5);
+
+  coordinates = f.GetInitialPoint();
+  sampled.Optimize(coordinates);
+
+  for (size_t j = 0; j < 20; ++j)
+    BOOST_REQUIRE_CLOSE(coordinates[j], (double) 1.0, 1e-3);
+}
+
+/**
+ * Check the first steps of each update policy by hand.
+ */
+BOOST_AUTO_TEST_CASE(UpdatePolicyStepsTest)
+{
+  const arma::mat gradient("1.0; -4.0");
+  const arma::mat start("0.0; 0.0");
+
+  arma::mat iterate = start;
+  VanillaUpdate vanilla;
+  vanilla.Initialize(2, 1);
+  vanilla.Update(iterate, 0.1, gradient);
+  BOOST_REQUIRE_CLOSE(iterate[0], -0.1, 1e-10);
+  BOOST_REQUIRE_CLOSE(iterate[1], 0.4, 1e-10);
+
+  // The second step adds half of the first again.
+  iterate = start;
+  MomentumUpdate momentum(0.5);
+  momentum.Initialize(2, 1);
+  momentum.Update(iterate, 0.1, gradient);
+  momentum.Update(iterate, 0.1, gradient);
+  BOOST_REQUIRE_CLOSE(iterate[0], -0.25, 1e-10);
+  BOOST_REQUIRE_CLOSE(iterate[1], 1.0, 1e-10);
+
+  // Each coordinate moves by the step size at first, whatever its gradient.
+  iterate = start;
+  AdaGradUpdate adagrad;
+  adagrad.Initialize(2, 1);
+  adagrad.Update(iterate, 0.1, gradient);
+  BOOST_REQUIRE_CLOSE(iterate[0], -0.1, 1e-5);
+  BOOST_REQUIRE_CLOSE(iterate[1], 0.1, 1e-5);
+  adagrad.Update(iterate, 0.1, gradient);
+  BOOST_REQUIRE_CLOSE(iterate[0], -0.1 - 0.1 / std::sqrt(2.0), 1e-5);
+  BOOST_REQUIRE_CLOSE(iterate[1], 0.1 + 0.1 / std::sqrt(2.0), 1e-5);
+
+  iterate = start;
+  RMSPropUpdate rmsprop(0.75);
+  rmsprop.Initialize(2, 1);
+  rmsprop.Update(iterate, 0.1, gradient);
+  BOOST_REQUIRE_CLOSE(iterate[0], -0.2, 1e-5);
+  BOOST_REQUIRE_CLOSE(iterate[1], 0.2, 1e-5);
+
+  iterate = start;
+  AdamUpdate adam;
+  adam.Initialize(2, 1);
+  adam.Update(iterate, 0.1, gradient);
+  BOOST_REQUIRE_CLOSE(iterate[0], -0.1, 1e-5);
+  BOOST_REQUIRE_CLOSE(iterate[1], 0.1, 1e-5);
+  adam.Update(iterate, 0.1, gradient);
+  BOOST_REQUIRE_CLOSE(iterate[0], -0.2, 1e-5);
+  BOOST_REQUIRE_CLOSE(iterate[1], 0.2, 1e-5);
+
+  // Initialize() resets the state.
+  iterate = start;
+  adam.Initialize(2, 1);
+  adam.Update(iterate, 0.1, gradient);
+  BOOST_REQUIRE_CLOSE(iterate[0], -0.1, 1e-5);
+}
+
+/**
+ * Make sure that the adaptive variants of SGD minimize the generalized
+ * Rosenbrock function.  With a fixed step size, RMSProp and Adam keep moving
+ * around the minimum instead of converging exactly.
+ */
+template<typename OptimizerType>
+void AdaptiveRosenbrockTest(OptimizerType& s, GeneralizedRosenbrockFunction& f)
+{
+  arma::mat coordinates = f.GetInitialPoint();
+  const double result = s.Optimize(coordinates);
+
+  BOOST_REQUIRE_SMALL(result, 1e-2);
+  for (size_t j = 0; j < coordinates.n_elem; ++j)
+    BOOST_REQUIRE_CLOSE(coordinates[j], (double) 1.0, 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(AdaptiveSGDGeneralizedRosenbrockTest)
+{
+  GeneralizedRosenbrockFunction f(10);
+
+  MomentumSGD<GeneralizedRosenbrockFunction> momentum(f, 0.0001, 1000000,
+      1e-15);
+  AdaptiveRosenbrockTest(momentum, f);
+
+  AdaGrad<GeneralizedRosenbrockFunction> adagrad(f, 0.5, 1000000, 1e-15);
+  AdaptiveRosenbrockTest(adagrad, f);
+
+  RMSProp<GeneralizedRosenbrockFunction> rmsprop(f, 0.0001, 1000000, 1e-15);
+  AdaptiveRosenbrockTest(rmsprop, f);
+
+  Adam<GeneralizedRosenbrockFunction> adam(f, 0.0001, 1000000, 1e-15);
+  AdaptiveRosenbrockTest(adam, f);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -166,6 +166,98 @@ BOOST_AUTO_TEST_CASE(SoftmaxRegressionFunctionGradient)
   }
 }
 
+/**
+ * Make sure that the objective and gradient do not depend on the block size or
+ * the number of threads, and that EvaluateWithGradient() gives the same
+ * results as Evaluate() and Gradient().
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxRegressionFunctionBlockSize)
+{
+  const size_t points = 1000;
+  const size_t inputSize = 10;
+  const size_t numClasses = 5;
+
+  arma::mat data;
+  data.randu(inputSize, points);
+
+  arma::vec labels(points);
+  for (size_t i = 0; i < points; i++)
+    labels(i) = math::RandInt(0, numClasses);
+
+  SoftmaxRegressionFunction srf1(data, labels, inputSize, numClasses, 0.1);
+  SoftmaxRegressionFunction srf2(data, labels, inputSize, numClasses, 0.1);
+  srf1.BlockSize(points);
+  srf1.Threads(1);
+  srf2.BlockSize(37);
+  srf2.Threads(4);
+
+  arma::mat parameters;
+  parameters.randu(numClasses, inputSize);
+
+  arma::mat gradient1, gradient2, gradient3;
+  srf1.Gradient(parameters, gradient1);
+  srf2.Gradient(parameters, gradient2);
+  const double objective = srf2.EvaluateWithGradient(parameters, gradient3);
+
+  BOOST_REQUIRE_CLOSE(srf1.Evaluate(parameters), srf2.Evaluate(parameters),
+      1e-5);
+  BOOST_REQUIRE_CLOSE(srf1.Evaluate(parameters), objective, 1e-5);
+
+  BOOST_REQUIRE_EQUAL(gradient1.n_rows, gradient2.n_rows);
+  BOOST_REQUIRE_EQUAL(gradient1.n_cols, gradient2.n_cols);
+  for (size_t i = 0; i < gradient1.n_elem; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(gradient1[i], gradient2[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(gradient1[i], gradient3[i], 1e-5);
+  }
+}
+
+/**
+ * Make sure that EvaluateWithGradient() returns the same objective and gradient
+ * as separate calls to Evaluate() and Gradient() on the same object, both with
+ * and without regularization.
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxRegressionFunctionEvaluateWithGradient)
+{
+  const size_t points = 1000;
+  const size_t inputSize = 10;
+  const size_t numClasses = 5;
+
+  arma::mat data;
+  data.randu(inputSize, points);
+
+  arma::vec labels(points);
+  for (size_t i = 0; i < points; i++)
+    labels(i) = math::RandInt(0, numClasses);
+
+  SoftmaxRegressionFunction srf1(data, labels, inputSize, numClasses, 0);
+  SoftmaxRegressionFunction srf2(data, labels, inputSize, numClasses, 20);
+
+  arma::mat parameters;
+  parameters.randu(numClasses, inputSize);
+
+  arma::mat gradient1, gradient2, combinedGradient1, combinedGradient2;
+  srf1.Gradient(parameters, gradient1);
+  srf2.Gradient(parameters, gradient2);
+  const double objective1 = srf1.EvaluateWithGradient(parameters,
+      combinedGradient1);
+  const double objective2 = srf2.EvaluateWithGradient(parameters,
+      combinedGradient2);
+
+  BOOST_REQUIRE_CLOSE(srf1.Evaluate(parameters), objective1, 1e-5);
+  BOOST_REQUIRE_CLOSE(srf2.Evaluate(parameters), objective2, 1e-5);
+
+  BOOST_REQUIRE_EQUAL(combinedGradient1.n_rows, gradient1.n_rows);
+  BOOST_REQUIRE_EQUAL(combinedGradient1.n_cols, gradient1.n_cols);
+  BOOST_REQUIRE_EQUAL(combinedGradient2.n_rows, gradient2.n_rows);
+  BOOST_REQUIRE_EQUAL(combinedGradient2.n_cols, gradient2.n_cols);
+  for (size_t i = 0; i < gradient1.n_elem; ++i)
+  {
+    BOOST_REQUIRE_CLOSE(gradient1[i], combinedGradient1[i], 1e-5);
+    BOOST_REQUIRE_CLOSE(gradient2[i], combinedGradient2[i], 1e-5);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(SoftmaxRegressionTwoClasses)
 {
   const size_t points = 1000;
@@ -298,4 +390,61 @@ BOOST_AUTO_TEST_CASE(SoftmaxRegressionMultipleClasses)
   BOOST_REQUIRE_CLOSE(testAcc, 100.0, 2.0);
 }
 
+/**
+ * Make sure the batched and single-point prediction paths agree with each
+ * other and with the class probabilities, with any number of threads.
+ */
+BOOST_AUTO_TEST_CASE(SoftmaxRegressionBatchedPredictionTest)
+{
+  const size_t points = 1000;
+  const size_t inputSize = 3;
+  const size_t numClasses = 3;
+
+  GaussianDistribution g1(arma::vec("1.0 9.0 1.0"), arma::eye<arma::mat>(3, 3));
+  GaussianDistribution g2(arma::vec("4.0 3.0 4.0"), arma::eye<arma::mat>(3, 3));
+  GaussianDistribution g3(arma::vec("8.0 1.0 8.0"), arma::eye<arma::mat>(3, 3));
+
+  arma::mat data(inputSize, points);
+  arma::vec labels(points);
+  for (size_t i = 0; i < points; i++)
+  {
+    labels(i) = i % 3;
+    data.col(i) = (i % 3 == 0) ? g1.Random() : ((i % 3 == 1) ? g2.Random() :
+        g3.Random());
+  }
+
+  SoftmaxRegression<> sr(data, labels, inputSize, numClasses, 0.0001);
+
+  arma::vec serialPredictions;
+  sr.Threads() = 1;
+  sr.Predict(data, serialPredictions);
+
+  for (size_t threads = 0; threads < 4; ++threads)
+  {
+    sr.Threads() = threads;
+    arma::vec predictions;
+    arma::mat probabilities;
+    sr.Predict(data, predictions);
+    sr.PredictProbabilities(data, probabilities);
+
+    BOOST_REQUIRE_EQUAL(predictions.n_elem, points);
+    BOOST_REQUIRE_EQUAL(probabilities.n_rows, numClasses);
+    BOOST_REQUIRE_EQUAL(probabilities.n_cols, points);
+    for (size_t i = 0; i < points; ++i)
+    {
+      BOOST_REQUIRE_EQUAL(predictions[i], serialPredictions[i]);
+      BOOST_REQUIRE_EQUAL(sr.PredictClass(data.col(i)),
+          (size_t) predictions[i]);
+      BOOST_REQUIRE_CLOSE(arma::accu(probabilities.col(i)), 1.0, 1e-8);
+
+      arma::uword maxClass;
+      probabilities.col(i).max(maxClass);
+      BOOST_REQUIRE_EQUAL((size_t) maxClass, (size_t) predictions[i]);
+    }
+  }
+
+  // The predictions are right nearly all of the time.
+  BOOST_REQUIRE_CLOSE(sr.ComputeAccuracy(data, labels), 100.0, 2.0);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -5,6 +5,7 @@
  * Test the SparseAutoencoder class.
  */
 #include <mlpack/core.hpp>
+#include <mlpack/core/optimizers/sgd/sgd.hpp>
 #include <mlpack/methods/sparse_autoencoder/sparse_autoencoder.hpp>
 
 #include <boost/test/unit_test.hpp>
@@ -263,4 +264,149 @@ BOOST_AUTO_TEST_CASE(SparseAutoencoderFunctionGradient)
   }
 }
 
+/**
+ * Make sure that the objective and gradient do not depend on the block size or
+ * the number of threads, and that EvaluateWithGradient() gives the same
+ * results as Evaluate() and Gradient().
+ */
+BOOST_AUTO_TEST_CASE(SparseAutoencoderFunctionBlockSize)
+{
+  const size_t points = 1000;
+  const size_t vSize = 20;
+  const size_t hSize = 10;
+
+  arma::mat data;
+  data.randu(vSize, points);
+
+  SparseAutoencoderFunction saf1(data, vSize, hSize, 0.01, 3, 0.1);
+  SparseAutoencoderFunction saf2(data, vSize, hSize, 0.01, 3, 0.1);
+  saf1.BlockSize(points);
+  saf1.Threads(1);
+  saf2.BlockSize(37);
+  saf2.Threads(4);
+
+  const arma::mat& parameters = saf1.GetInitialPoint();
+
+  arma::mat gradient1, gradient2, gradient3;
+  saf1.Gradient(parameters, gradient1);
+  saf2.Gradient(parameters, gradient2);
+  const double objective = saf2.EvaluateWithGradient(parameters, gradient3);
+
+  BOOST_REQUIRE_CLOSE(saf1.Evaluate(parameters), saf2.Evaluate(parameters),
+      1e-5);
+  BOOST_REQUIRE_CLOSE(saf1.Evaluate(parameters), objective, 1e-5);
+
+  BOOST_REQUIRE_EQUAL(gradient1.n_rows, gradient2.n_rows);
+  BOOST_REQUIRE_EQUAL(gradient1.n_cols, gradient2.n_cols);
+  BOOST_REQUIRE_EQUAL(gradient1.n_rows, gradient3.n_rows);
+  BOOST_REQUIRE_EQUAL(gradient1.n_cols, gradient3.n_cols);
+  for (size_t i = 0; i < gradient1.n_elem; ++i)
+  {
+    if (std::abs(gradient1[i]) < 1e-10)
+    {
+      BOOST_REQUIRE_SMALL(gradient2[i], 1e-10);
+      BOOST_REQUIRE_SMALL(gradient3[i], 1e-10);
+    }
+    else
+    {
+      BOOST_REQUIRE_CLOSE(gradient1[i], gradient2[i], 1e-5);
+      BOOST_REQUIRE_CLOSE(gradient1[i], gradient3[i], 1e-5);
+    }
+  }
+}
+
+/**
+ * Make sure that, with a fixed estimate of the average hidden activations, the
+ * mini-batch gradients sum to NumFunctions() times the full gradient, and the
+ * functions sum to NumFunctions() times the objective.
+ */
+BOOST_AUTO_TEST_CASE(SparseAutoencoderFunctionMiniBatchGradient)
+{
+  const size_t points = 1000;
+  const size_t vSize = 20;
+  const size_t hSize = 10;
+
+  arma::mat data;
+  data.randu(vSize, points);
+
+  SparseAutoencoderFunction saf(data, vSize, hSize, 0.01, 3, 0.1);
+  const arma::mat& parameters = saf.GetInitialPoint();
+
+  // Compute the average hidden activations over the whole dataset.
+  arma::mat hiddenLayer = parameters.submat(0, 0, hSize - 1, vSize - 1) * data;
+  hiddenLayer.each_col() += arma::vec(parameters.submat(0, vSize, hSize - 1,
+      vSize));
+  saf.Sigmoid(hiddenLayer, hiddenLayer);
+  const arma::vec rhoCap = arma::mean(hiddenLayer, 1);
+
+  // Keep the estimate fixed.
+  saf.RhoCapEstimate(rhoCap);
+  saf.RhoDecay(1.0);
+
+  BOOST_REQUIRE_EQUAL(saf.NumFunctions(), points);
+
+  double objective = 0;
+  for (size_t i = 0; i < points; ++i)
+    objective += saf.Evaluate(parameters, i);
+  BOOST_REQUIRE_CLOSE(objective, points * saf.Evaluate(parameters), 1e-5);
+
+  arma::mat gradient, batchGradient, pointGradient;
+  saf.Gradient(parameters, gradient);
+
+  arma::mat sum(parameters.n_rows, parameters.n_cols, arma::fill::zeros);
+  for (size_t begin = 0; begin < points - 1; begin += 33)
+  {
+    saf.Gradient(parameters, begin, std::min((size_t) 33, points - 1 - begin),
+        batchGradient);
+    sum += batchGradient;
+  }
+  saf.Gradient(parameters, points - 1, pointGradient);
+  sum += pointGradient;
+
+  for (size_t i = 0; i < gradient.n_elem; ++i)
+  {
+    if (std::abs(gradient[i]) < 1e-10)
+      BOOST_REQUIRE_SMALL(sum[i] / points, 1e-8);
+    else
+      BOOST_REQUIRE_CLOSE(sum[i] / points, gradient[i], 1e-5);
+  }
+
+  BOOST_REQUIRE_EQUAL(arma::accu(saf.RhoCapEstimate() != rhoCap), 0);
+}
+
+/**
+ * Train a sparse autoencoder with mini-batch SGD, and make sure that the
+ * objective goes down, and that the running estimate of the average hidden
+ * activations is close to the real averages.
+ */
+BOOST_AUTO_TEST_CASE(SparseAutoencoderMiniBatchSGDTest)
+{
+  const size_t points = 1000;
+  const size_t vSize = 20;
+  const size_t hSize = 10;
+
+  arma::mat data;
+  data.randu(vSize, points);
+
+  SparseAutoencoderFunction saf(data, vSize, hSize, 0.0001, 3, 0.1);
+  const double initialObjective = saf.Evaluate(saf.GetInitialPoint());
+
+  optimization::SGD<SparseAutoencoderFunction> sgd(saf, 0.05, 20 * points,
+      0, true, 50);
+  arma::mat parameters = saf.GetInitialPoint();
+  sgd.Optimize(parameters);
+
+  BOOST_REQUIRE_LT(saf.Evaluate(parameters), initialObjective);
+
+  arma::mat hiddenLayer = parameters.submat(0, 0, hSize - 1, vSize - 1) * data;
+  hiddenLayer.each_col() += arma::vec(parameters.submat(0, vSize, hSize - 1,
+      vSize));
+  saf.Sigmoid(hiddenLayer, hiddenLayer);
+  const arma::vec rhoCap = arma::mean(hiddenLayer, 1);
+
+  BOOST_REQUIRE_EQUAL(saf.RhoCapEstimate().n_elem, hSize);
+  for (size_t i = 0; i < hSize; ++i)
+    BOOST_REQUIRE_SMALL(saf.RhoCapEstimate()[i] - rhoCap[i], 0.05);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
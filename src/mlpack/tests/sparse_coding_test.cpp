@@ -136,4 +136,84 @@ BOOST_AUTO_TEST_CASE(SparseCodingTestWhole)
 */
 
 
+/**
+ * Make sure that the coding step gives the same codes whether the points are
+ * coded with one thread or with several.
+ */
+BOOST_AUTO_TEST_CASE(SparseCodingTestCodingStepThreads)
+{
+  double lambda1 = 0.1;
+  double lambda2 = 0.2;
+  uword nAtoms = 25;
+
+  mat X;
+  X.load("mnist_first250_training_4s_and_9s.arm");
+  uword nPoints = X.n_cols;
+
+  // Normalize each point since these are images.
+  for (uword i = 0; i < nPoints; ++i)
+    X.col(i) /= norm(X.col(i), 2);
+
+  SparseCoding<> sc(X, nAtoms, lambda1, lambda2, 1);
+  SparseCoding<NothingInitializer> scThreads(X, nAtoms, lambda1, lambda2, 4);
+  scThreads.Dictionary() = sc.Dictionary();
+
+  sc.OptimizeCode();
+  scThreads.OptimizeCode();
+
+  BOOST_REQUIRE_EQUAL(sc.Codes().n_rows, scThreads.Codes().n_rows);
+  BOOST_REQUIRE_EQUAL(sc.Codes().n_cols, scThreads.Codes().n_cols);
+  for (uword i = 0; i < sc.Codes().n_elem; ++i)
+  {
+    if (std::abs(sc.Codes()[i]) < 1e-10)
+      BOOST_REQUIRE_SMALL(scThreads.Codes()[i], 1e-10);
+    else
+      BOOST_REQUIRE_CLOSE(sc.Codes()[i], scThreads.Codes()[i], 1e-8);
+  }
+}
+
+/**
+ * Make sure that online dictionary learning keeps the atoms in the unit ball,
+ * improves the objective over the initial dictionary, and leaves the codes of
+ * the whole dataset for the learned dictionary in Codes().
+ */
+BOOST_AUTO_TEST_CASE(SparseCodingTestOnlineEncode)
+{
+  math::RandomSeed(42);
+
+  double lambda1 = 0.1;
+  uword nAtoms = 25;
+
+  mat X;
+  X.load("mnist_first250_training_4s_and_9s.arm");
+  uword nPoints = X.n_cols;
+
+  // Normalize each point since these are images.
+  for (uword i = 0; i < nPoints; ++i)
+    X.col(i) /= norm(X.col(i), 2);
+
+  SparseCoding<> sc(X, nAtoms, lambda1);
+  sc.OptimizeCode();
+  const double initialObjective = sc.Objective();
+
+  // Three passes over the data, with the last mini-batch of each pass smaller
+  // than the others.
+  sc.OnlineEncode(30, 27);
+
+  for (uword j = 0; j < nAtoms; ++j)
+    BOOST_REQUIRE_LE(norm(sc.Dictionary().col(j), 2), 1.0 + 1e-10);
+
+  BOOST_REQUIRE_LT(sc.Objective(), initialObjective);
+
+  mat D = sc.Dictionary();
+  mat Z = sc.Codes();
+  BOOST_REQUIRE_EQUAL(Z.n_rows, nAtoms);
+  BOOST_REQUIRE_EQUAL(Z.n_cols, nPoints);
+  for (uword i = 0; i < nPoints; ++i)
+  {
+    vec errCorr = trans(D) * (D * Z.unsafe_col(i) - X.unsafe_col(i));
+    SCVerifyCorrectness(Z.unsafe_col(i), errCorr, lambda1);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -170,4 +170,36 @@ BOOST_AUTO_TEST_CASE(SVDBatchNegativeElementTest)
   BOOST_REQUIRE_CLOSE(arma::norm(test, "fro"), arma::norm(result, "fro"), 5.0);
 }
 
+/**
+ * Make sure SimpleToleranceTermination still converges when the residue is
+ * estimated from a sample of the entries and only checked every few iterations,
+ * and that the estimate is close to the RMSE over all of the entries.
+ */
+BOOST_AUTO_TEST_CASE(SVDBatchSampledResidueTest)
+{
+  mlpack::math::RandomSeed(10);
+  sp_mat data;
+  data.sprandu(200, 200, 0.2);
+
+  SimpleToleranceTermination<sp_mat> stt(1e-5, 10000, 3, 2000, 5);
+  AMF<SimpleToleranceTermination<sp_mat>,
+      AverageInitialization,
+      SVDBatchLearning> amf(stt);
+  mat m1, m2;
+  const double residue = amf.Apply(data, 2, m1, m2);
+
+  BOOST_REQUIRE_NE(amf.TerminationPolicy().Iteration(),
+                   amf.TerminationPolicy().MaxIterations());
+  BOOST_REQUIRE_EQUAL(amf.TerminationPolicy().SampleSize(), 2000);
+  BOOST_REQUIRE_EQUAL(amf.TerminationPolicy().CheckInterval(), 5);
+
+  double error = 0.0;
+  for (sp_mat::const_iterator it = data.begin(); it != data.end(); ++it)
+    error += std::pow((*it) - arma::dot(m1.row(it.row()), m2.col(it.col())),
+        2.0);
+  const double rmse = std::sqrt(error / data.n_nonzero);
+
+  BOOST_REQUIRE_CLOSE(residue, rmse, 15.0);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
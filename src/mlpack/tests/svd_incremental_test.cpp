@@ -2,6 +2,7 @@
 #include <mlpack/methods/amf/amf.hpp>
 #include <mlpack/methods/amf/update_rules/svd_incomplete_incremental_learning.hpp>
 #include <mlpack/methods/amf/update_rules/svd_complete_incremental_learning.hpp>
+#include <mlpack/methods/amf/update_rules/svd_parallel_incremental_learning.hpp>
 #include <mlpack/methods/amf/init_rules/random_init.hpp>
 #include <mlpack/methods/amf/termination_policies/incomplete_incremental_termination.hpp>
 #include <mlpack/methods/amf/termination_policies/complete_incremental_termination.hpp>
@@ -116,4 +117,46 @@ BOOST_AUTO_TEST_CASE(SVDIncompleteIncrementalRegularizationTest)
   BOOST_REQUIRE_LT(RMSE_2, RMSE_1);
 }
 
+/**
+ * Make sure the parallel incremental learning converges on the observed entries
+ * of a low-rank matrix, and that the number of threads does not change the
+ * result for a fixed number of blocks.
+ */
+BOOST_AUTO_TEST_CASE(SVDParallelIncrementalTest)
+{
+  mlpack::math::RandomSeed(10);
+  const mat w0 = randu<mat>(60, 2) + 0.5;
+  const mat h0 = randu<mat>(2, 80) + 0.5;
+  const mat full = w0 * h0;
+
+  // Observe about a third of the entries, and at least one in each row and
+  // column.
+  sp_mat data(60, 80);
+  for (size_t j = 0; j < 80; ++j)
+    for (size_t i = 0; i < 60; ++i)
+      if (i == (j % 60) || mlpack::math::Random() < 0.3)
+        data(i, j) = full(i, j);
+
+  SimpleToleranceTermination<sp_mat> stt(1e-5, 2000);
+  AMF<SimpleToleranceTermination<sp_mat>,
+      RandomInitialization,
+      SVDParallelIncrementalLearning> amf(stt, RandomInitialization(),
+      SVDParallelIncrementalLearning(0.01, 0, 0, 4, 0));
+  AMF<SimpleToleranceTermination<sp_mat>,
+      RandomInitialization,
+      SVDParallelIncrementalLearning> serial(stt, RandomInitialization(),
+      SVDParallelIncrementalLearning(0.01, 0, 0, 4, 1));
+
+  mat m1, m2, s1, s2;
+  mlpack::math::RandomSeed(10);
+  const double rmse = amf.Apply(data, 2, m1, m2);
+  mlpack::math::RandomSeed(10);
+  serial.Apply(data, 2, s1, s2);
+
+  BOOST_REQUIRE_SMALL(rmse, 0.1);
+
+  BOOST_REQUIRE_SMALL(arma::norm(m1 - s1, "fro"), 1e-10);
+  BOOST_REQUIRE_SMALL(arma::norm(m2 - s2, "fro"), 1e-10);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
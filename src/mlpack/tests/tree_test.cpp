@@ -11,6 +11,7 @@
 #include <mlpack/core/tree/rectangle_tree.hpp>
 
 #include <queue>
+#include <sstream>
 #include <stack>
 
 #include <boost/test/unit_test.hpp>
@@ -999,6 +1000,207 @@ BOOST_AUTO_TEST_CASE(HRectBoundDiameter)
   BOOST_REQUIRE_SMALL(d.Diameter(), 1e-5);
 }
 
+/**
+ * Check the distances of an HRectBound with the given power against distances
+ * computed dimension by dimension, for random bounds and points.
+ */
+template<int Power, bool TakeRoot>
+void CheckHRectBoundDistances()
+{
+  for (size_t trial = 0; trial < 20; ++trial)
+  {
+    const size_t dim = math::RandInt(1, 8);
+    HRectBound<Power, TakeRoot> a(dim), b(dim);
+    arma::vec point(dim, arma::fill::randn);
+
+    double minPoint = 0, maxPoint = 0, minBound = 0, maxBound = 0;
+    for (size_t d = 0; d < dim; ++d)
+    {
+      const double aLo = math::Random(-2.0, 2.0);
+      const double bLo = math::Random(-2.0, 2.0);
+      a[d] = math::Range(aLo, aLo + math::Random(0.0, 1.0));
+      b[d] = math::Range(bLo, bLo + math::Random(0.0, 1.0));
+
+      double minDist = 0;
+      if (point[d] < a[d].Lo())
+        minDist = a[d].Lo() - point[d];
+      else if (point[d] > a[d].Hi())
+        minDist = point[d] - a[d].Hi();
+      minPoint += std::pow(minDist, (double) Power);
+      maxPoint += std::pow(std::max(std::abs(point[d] - a[d].Lo()),
+          std::abs(point[d] - a[d].Hi())), (double) Power);
+
+      minDist = 0;
+      if (b[d].Lo() > a[d].Hi())
+        minDist = b[d].Lo() - a[d].Hi();
+      else if (a[d].Lo() > b[d].Hi())
+        minDist = a[d].Lo() - b[d].Hi();
+      minBound += std::pow(minDist, (double) Power);
+      maxBound += std::pow(std::max(b[d].Hi() - a[d].Lo(),
+          a[d].Hi() - b[d].Lo()), (double) Power);
+    }
+
+    if (TakeRoot)
+    {
+      minPoint = std::pow(minPoint, 1.0 / (double) Power);
+      maxPoint = std::pow(maxPoint, 1.0 / (double) Power);
+      minBound = std::pow(minBound, 1.0 / (double) Power);
+      maxBound = std::pow(maxBound, 1.0 / (double) Power);
+    }
+
+    // Some of the minimum distances are zero.
+    BOOST_REQUIRE_SMALL(a.MinDistance(point) - minPoint, 1e-5);
+    BOOST_REQUIRE_SMALL(a.MinDistance(b) - minBound, 1e-5);
+    BOOST_REQUIRE_CLOSE(a.MaxDistance(point), maxPoint, 1e-5);
+    BOOST_REQUIRE_CLOSE(a.MaxDistance(b), maxBound, 1e-5);
+
+    math::Range r = a.RangeDistance(point);
+    BOOST_REQUIRE_SMALL(r.Lo() - minPoint, 1e-5);
+    BOOST_REQUIRE_CLOSE(r.Hi(), maxPoint, 1e-5);
+
+    r = a.RangeDistance(b);
+    BOOST_REQUIRE_SMALL(r.Lo() - minBound, 1e-5);
+    BOOST_REQUIRE_CLOSE(r.Hi(), maxBound, 1e-5);
+  }
+}
+
+/**
+ * Ensure that the distances of HRectBound are right for the powers that have
+ * specialized implementations (1 and 2) and for one that does not (3).
+ */
+BOOST_AUTO_TEST_CASE(HRectBoundPowerDistances)
+{
+  CheckHRectBoundDistances<1, true>();
+  CheckHRectBoundDistances<1, false>();
+  CheckHRectBoundDistances<2, true>();
+  CheckHRectBoundDistances<2, false>();
+  CheckHRectBoundDistances<3, true>();
+  CheckHRectBoundDistances<3, false>();
+}
+
+/**
+ * Ensure that FixedHRectBound gives the same distances, widths and centroids as
+ * HRectBound, and that FixedLMetric gives the same distances as LMetric.
+ */
+BOOST_AUTO_TEST_CASE(FixedHRectBoundTest)
+{
+  arma::mat points(3, 40);
+  points.randu();
+
+  HRectBound<2> a(3), b(3);
+  FixedHRectBound<3> fa, fb(3);
+  a |= points.cols(0, 9);
+  fa |= points.cols(0, 9);
+  b |= points.cols(10, 19);
+  fb |= points.cols(10, 19);
+
+  BOOST_REQUIRE_EQUAL(fa.Dim(), 3);
+  BOOST_REQUIRE_CLOSE(fa.MinWidth(), a.MinWidth(), 1e-5);
+  BOOST_REQUIRE_CLOSE(fa.Diameter(), a.Diameter(), 1e-5);
+  BOOST_REQUIRE_CLOSE(fa.Volume(), a.Volume(), 1e-5);
+  for (size_t d = 0; d < 3; ++d)
+  {
+    BOOST_REQUIRE_EQUAL(fa[d].Lo(), a[d].Lo());
+    BOOST_REQUIRE_EQUAL(fa[d].Hi(), a[d].Hi());
+  }
+
+  arma::vec centroid, fixedCentroid;
+  a.Centroid(centroid);
+  fa.Centroid(fixedCentroid);
+  for (size_t d = 0; d < 3; ++d)
+    BOOST_REQUIRE_CLOSE(fixedCentroid[d], centroid[d], 1e-5);
+
+  // The bound-to-bound distances.
+  BOOST_REQUIRE_CLOSE(fa.MaxDistance(fb), a.MaxDistance(b), 1e-5);
+  BOOST_REQUIRE_SMALL(fa.MinDistance(fb) - a.MinDistance(b), 1e-5);
+  const Range r = a.RangeDistance(b);
+  const Range fr = fa.RangeDistance(fb);
+  BOOST_REQUIRE_SMALL(fr.Lo() - r.Lo(), 1e-5);
+  BOOST_REQUIRE_CLOSE(fr.Hi(), r.Hi(), 1e-5);
+
+  // The bound-to-point distances and the metric, for points both inside and
+  // outside of the bounds.
+  for (size_t i = 0; i < points.n_cols; ++i)
+  {
+    const arma::vec point = points.col(i) * 1.5 - 0.25;
+    BOOST_REQUIRE_SMALL(fa.MinDistance(point) - a.MinDistance(point), 1e-5);
+    BOOST_REQUIRE_CLOSE(fa.MaxDistance(point), a.MaxDistance(point), 1e-5);
+    BOOST_REQUIRE_EQUAL(fa.Contains(point), a.Contains(point));
+
+    BOOST_REQUIRE_CLOSE(FixedLMetric<3>::Evaluate(point, points.col(0)),
+        EuclideanDistance::Evaluate(point, points.col(0)), 1e-5);
+    BOOST_REQUIRE_CLOSE((FixedLMetric<3, 1, false>::Evaluate(point,
+        points.col(0))), ManhattanDistance::Evaluate(point, points.col(0)),
+        1e-5);
+    BOOST_REQUIRE_CLOSE((FixedLMetric<3, 3, true>::Evaluate(point,
+        points.col(0))), (LMetric<3, true>::Evaluate(point, points.col(0))),
+        1e-5);
+    BOOST_REQUIRE_CLOSE((FixedLMetric<3, INT_MAX, false>::Evaluate(point,
+        points.col(0))), ChebyshevDistance::Evaluate(point, points.col(0)),
+        1e-5);
+  }
+
+  // Expanding one bound by the other.
+  a |= b;
+  fa |= fb;
+  for (size_t d = 0; d < 3; ++d)
+  {
+    BOOST_REQUIRE_EQUAL(fa[d].Lo(), a[d].Lo());
+    BOOST_REQUIRE_EQUAL(fa[d].Hi(), a[d].Hi());
+  }
+  BOOST_REQUIRE_CLOSE(fa.MinWidth(), a.MinWidth(), 1e-5);
+}
+
+/**
+ * A kd-tree built with FixedHRectBound should be the same as one built with
+ * HRectBound.
+ */
+BOOST_AUTO_TEST_CASE(FixedHRectBoundTreeTest)
+{
+  arma::mat dataset(2, 1000);
+  dataset.randu();
+  arma::mat fixedDataset(dataset);
+
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+  typedef BinarySpaceTree<FixedHRectBound<2> > FixedTreeType;
+
+  TreeType root(dataset, 10);
+  FixedTreeType fixedRoot(fixedDataset, 10);
+
+  std::stack<TreeType*> nodes;
+  std::stack<FixedTreeType*> fixedNodes;
+  nodes.push(&root);
+  fixedNodes.push(&fixedRoot);
+  while (!nodes.empty())
+  {
+    TreeType* node = nodes.top();
+    FixedTreeType* fixedNode = fixedNodes.top();
+    nodes.pop();
+    fixedNodes.pop();
+
+    BOOST_REQUIRE_EQUAL(fixedNode->Begin(), node->Begin());
+    BOOST_REQUIRE_EQUAL(fixedNode->Count(), node->Count());
+    BOOST_REQUIRE_EQUAL(fixedNode->NumChildren(), node->NumChildren());
+    for (size_t d = 0; d < 2; ++d)
+    {
+      BOOST_REQUIRE_EQUAL(fixedNode->Bound()[d].Lo(), node->Bound()[d].Lo());
+      BOOST_REQUIRE_EQUAL(fixedNode->Bound()[d].Hi(), node->Bound()[d].Hi());
+    }
+    BOOST_REQUIRE_CLOSE(fixedNode->FurthestDescendantDistance(),
+        node->FurthestDescendantDistance(), 1e-5);
+    BOOST_REQUIRE_SMALL(fixedNode->ParentDistance() - node->ParentDistance(),
+        1e-5);
+
+    for (size_t i = 0; i < node->NumChildren(); ++i)
+    {
+      nodes.push(&node->Child(i));
+      fixedNodes.push(&fixedNode->Child(i));
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(arma::accu(fixedDataset != dataset), 0);
+}
+
 /**
  * It seems as though Bill has stumbled across a bug where
  * BinarySpaceTree<>::count() returns something different than
@@ -1219,6 +1421,297 @@ BOOST_AUTO_TEST_CASE(ParentDistanceTestWithMapping)
   }
 }
 
+/**
+ * Make sure that a tree large enough to be built in parallel gives the same
+ * permutation and the same tree structure as a serial build.  If mlpack was
+ * compiled without OpenMP, both builds are serial.
+ */
+BOOST_AUTO_TEST_CASE(ParallelTreeBuildDeterminismTest)
+{
+  arma::mat dataset;
+  dataset.randu(4, 50000);
+
+  arma::mat serialData(dataset);
+  arma::mat parallelData(dataset);
+  std::vector<size_t> serialOldFromNew;
+  std::vector<size_t> parallelOldFromNew;
+
+#ifdef _OPENMP
+  const int oldThreads = omp_get_max_threads();
+  omp_set_num_threads(1);
+#endif
+
+  BinarySpaceTree<HRectBound<2> > serialTree(serialData, serialOldFromNew);
+
+#ifdef _OPENMP
+  omp_set_num_threads(4);
+#endif
+
+  BinarySpaceTree<HRectBound<2> > parallelTree(parallelData,
+      parallelOldFromNew);
+
+#ifdef _OPENMP
+  omp_set_num_threads(oldThreads);
+#endif
+
+  // The permutations must be exactly identical.
+  BOOST_REQUIRE_EQUAL(serialOldFromNew.size(), parallelOldFromNew.size());
+  for (size_t i = 0; i < serialOldFromNew.size(); ++i)
+    BOOST_REQUIRE_EQUAL(serialOldFromNew[i], parallelOldFromNew[i]);
+
+  for (size_t i = 0; i < serialData.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(serialData[i], parallelData[i]);
+
+  // Now check that the structure of the trees is the same.
+  std::stack<BinarySpaceTree<HRectBound<2> >*> serialStack, parallelStack;
+  serialStack.push(&serialTree);
+  parallelStack.push(&parallelTree);
+  while (!serialStack.empty())
+  {
+    BinarySpaceTree<HRectBound<2> >* serialNode = serialStack.top();
+    BinarySpaceTree<HRectBound<2> >* parallelNode = parallelStack.top();
+    serialStack.pop();
+    parallelStack.pop();
+
+    BOOST_REQUIRE_EQUAL(serialNode->Begin(), parallelNode->Begin());
+    BOOST_REQUIRE_EQUAL(serialNode->Count(), parallelNode->Count());
+    BOOST_REQUIRE_EQUAL(serialNode->NumChildren(), parallelNode->NumChildren());
+
+    for (size_t i = 0; i < serialNode->NumChildren(); ++i)
+    {
+      serialStack.push(&serialNode->Child(i));
+      parallelStack.push(&parallelNode->Child(i));
+    }
+  }
+}
+
+/**
+ * Save a kd-tree, load it again on the original (unpermuted) dataset, and make
+ * sure the loaded tree is identical to the built one.
+ */
+BOOST_AUTO_TEST_CASE(BinarySpaceTreeSaveLoadTest)
+{
+  arma::mat dataset;
+  dataset.randu(5, 1000);
+
+  arma::mat builtData(dataset);
+  arma::mat loadedData(dataset);
+  std::vector<size_t> builtOldFromNew;
+  std::vector<size_t> loadedOldFromNew;
+
+  BinarySpaceTree<HRectBound<2> > builtTree(builtData, builtOldFromNew, 15);
+
+  std::stringstream stream;
+  builtTree.Save(stream, builtOldFromNew);
+
+  BinarySpaceTree<HRectBound<2> > loadedTree(loadedData, loadedOldFromNew,
+      stream);
+
+  BOOST_REQUIRE_EQUAL(builtOldFromNew.size(), loadedOldFromNew.size());
+  for (size_t i = 0; i < builtOldFromNew.size(); ++i)
+    BOOST_REQUIRE_EQUAL(builtOldFromNew[i], loadedOldFromNew[i]);
+
+  for (size_t i = 0; i < builtData.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(builtData[i], loadedData[i]);
+
+  BOOST_REQUIRE_EQUAL(loadedTree.MaxLeafSize(), (size_t) 15);
+
+  std::stack<BinarySpaceTree<HRectBound<2> >*> builtStack, loadedStack;
+  builtStack.push(&builtTree);
+  loadedStack.push(&loadedTree);
+  while (!builtStack.empty())
+  {
+    BinarySpaceTree<HRectBound<2> >* builtNode = builtStack.top();
+    BinarySpaceTree<HRectBound<2> >* loadedNode = loadedStack.top();
+    builtStack.pop();
+    loadedStack.pop();
+
+    BOOST_REQUIRE_EQUAL(builtNode->Begin(), loadedNode->Begin());
+    BOOST_REQUIRE_EQUAL(builtNode->Count(), loadedNode->Count());
+    BOOST_REQUIRE_EQUAL(builtNode->NumChildren(), loadedNode->NumChildren());
+    BOOST_REQUIRE_CLOSE(builtNode->ParentDistance(),
+        loadedNode->ParentDistance(), 1e-5);
+
+    for (size_t d = 0; d < builtNode->Bound().Dim(); ++d)
+    {
+      BOOST_REQUIRE_EQUAL(builtNode->Bound()[d].Lo(),
+          loadedNode->Bound()[d].Lo());
+      BOOST_REQUIRE_EQUAL(builtNode->Bound()[d].Hi(),
+          loadedNode->Bound()[d].Hi());
+    }
+
+    for (size_t i = 0; i < builtNode->NumChildren(); ++i)
+    {
+      builtStack.push(&builtNode->Child(i));
+      loadedStack.push(&loadedNode->Child(i));
+    }
+  }
+}
+
+/**
+ * Make sure that compacting a kd-tree keeps its structure, and places all of
+ * the nodes contiguously in depth-first order.
+ */
+BOOST_AUTO_TEST_CASE(BinarySpaceTreeCompactTest)
+{
+  // The second tree is large enough that its subtrees are copied in parallel.
+  for (size_t points = 2000; points <= 32000; points *= 16)
+  {
+    arma::mat dataset;
+    dataset.randu(3, points);
+    arma::mat compactData(dataset);
+
+    BinarySpaceTree<HRectBound<2> > tree(dataset);
+    BinarySpaceTree<HRectBound<2> > compactTree(compactData);
+    const size_t treeSize = compactTree.TreeSize();
+
+    BOOST_REQUIRE(!compactTree.IsCompact());
+    compactTree.Compact();
+    BOOST_REQUIRE(compactTree.IsCompact());
+    BOOST_REQUIRE_EQUAL(compactTree.TreeSize(), treeSize);
+
+    // Compacting a second time does nothing.
+    compactTree.Compact();
+    BOOST_REQUIRE_EQUAL(compactTree.TreeSize(), treeSize);
+
+    std::stack<BinarySpaceTree<HRectBound<2> >*> stack, compactStack;
+    stack.push(&tree);
+    compactStack.push(&compactTree);
+    BinarySpaceTree<HRectBound<2> >* last = NULL;
+    while (!stack.empty())
+    {
+      BinarySpaceTree<HRectBound<2> >* node = stack.top();
+      BinarySpaceTree<HRectBound<2> >* compactNode = compactStack.top();
+      stack.pop();
+      compactStack.pop();
+
+      BOOST_REQUIRE_EQUAL(node->Begin(), compactNode->Begin());
+      BOOST_REQUIRE_EQUAL(node->Count(), compactNode->Count());
+      BOOST_REQUIRE_EQUAL(node->NumChildren(), compactNode->NumChildren());
+      BOOST_REQUIRE_EQUAL(node->ParentDistance(),
+          compactNode->ParentDistance());
+      BOOST_REQUIRE(compactNode->IsCompact());
+
+      // Every non-root node must directly follow the previous node in
+      // depth-first order.
+      if (last != NULL)
+        BOOST_REQUIRE(compactNode == last + 1);
+      if (compactNode != &compactTree)
+        last = compactNode;
+
+      for (size_t i = 0; i < node->NumChildren(); ++i)
+      {
+        BOOST_REQUIRE(compactNode->Child(i).Parent() == compactNode);
+
+        // Push the right child first so the left child is visited next.
+        stack.push(&node->Child(node->NumChildren() - 1 - i));
+        compactStack.push(&compactNode->Child(node->NumChildren() - 1 - i));
+      }
+    }
+  }
+}
+
+/**
+ * Make sure that a kd-tree copied to refer to a copy of its dataset has the
+ * same structure, and refers to the copy.
+ */
+BOOST_AUTO_TEST_CASE(BinarySpaceTreeCopyToDatasetTest)
+{
+  arma::mat dataset;
+  dataset.randu(3, 1000);
+
+  typedef BinarySpaceTree<HRectBound<2> > TreeType;
+  TreeType tree(dataset);
+  tree.Compact();
+
+  arma::mat datasetCopy(dataset);
+  TreeType copy(tree, datasetCopy);
+  BOOST_REQUIRE(!copy.IsCompact());
+  BOOST_REQUIRE(copy.Parent() == NULL);
+  BOOST_REQUIRE_EQUAL(copy.TreeSize(), tree.TreeSize());
+
+  std::stack<TreeType*> stack, copyStack;
+  stack.push(&tree);
+  copyStack.push(&copy);
+  while (!stack.empty())
+  {
+    TreeType* node = stack.top();
+    TreeType* copyNode = copyStack.top();
+    stack.pop();
+    copyStack.pop();
+
+    BOOST_REQUIRE(&copyNode->Dataset() == &datasetCopy);
+    BOOST_REQUIRE_EQUAL(node->Begin(), copyNode->Begin());
+    BOOST_REQUIRE_EQUAL(node->Count(), copyNode->Count());
+    BOOST_REQUIRE_EQUAL(node->NumChildren(), copyNode->NumChildren());
+    for (size_t d = 0; d < 3; ++d)
+    {
+      BOOST_REQUIRE_EQUAL(node->Bound()[d].Lo(), copyNode->Bound()[d].Lo());
+      BOOST_REQUIRE_EQUAL(node->Bound()[d].Hi(), copyNode->Bound()[d].Hi());
+    }
+
+    for (size_t i = 0; i < node->NumChildren(); ++i)
+    {
+      BOOST_REQUIRE(copyNode->Child(i).Parent() == copyNode);
+      stack.push(&node->Child(i));
+      copyStack.push(&copyNode->Child(i));
+    }
+  }
+}
+
+/**
+ * Save a cover tree, load it again, and make sure the loaded tree is identical
+ * to the built one.
+ */
+BOOST_AUTO_TEST_CASE(CoverTreeSaveLoadTest)
+{
+  arma::mat dataset;
+  dataset.randu(5, 500);
+
+  typedef CoverTree<EuclideanDistance> TreeType;
+  TreeType builtTree(dataset, 1.3);
+
+  std::stringstream stream;
+  builtTree.Save(stream);
+
+  TreeType loadedTree(dataset, stream);
+
+  BOOST_REQUIRE_CLOSE(loadedTree.Base(), 1.3, 1e-5);
+
+  std::stack<TreeType*> builtStack, loadedStack;
+  builtStack.push(&builtTree);
+  loadedStack.push(&loadedTree);
+  while (!builtStack.empty())
+  {
+    TreeType* builtNode = builtStack.top();
+    TreeType* loadedNode = loadedStack.top();
+    builtStack.pop();
+    loadedStack.pop();
+
+    BOOST_REQUIRE_EQUAL(builtNode->Point(), loadedNode->Point());
+    BOOST_REQUIRE_EQUAL(builtNode->Scale(), loadedNode->Scale());
+    BOOST_REQUIRE_EQUAL(builtNode->NumDescendants(),
+        loadedNode->NumDescendants());
+    BOOST_REQUIRE_EQUAL(builtNode->NumChildren(), loadedNode->NumChildren());
+    BOOST_REQUIRE_EQUAL(builtNode->ParentDistance(),
+        loadedNode->ParentDistance());
+    BOOST_REQUIRE_EQUAL(builtNode->FurthestDescendantDistance(),
+        loadedNode->FurthestDescendantDistance());
+
+    if (builtNode->Parent() == NULL)
+      BOOST_REQUIRE(loadedNode->Parent() == NULL);
+    else
+      BOOST_REQUIRE_EQUAL(builtNode->Parent()->Point(),
+          loadedNode->Parent()->Point());
+
+    for (size_t i = 0; i < builtNode->NumChildren(); ++i)
+    {
+      builtStack.push(&builtNode->Child(i));
+      loadedStack.push(&loadedNode->Child(i));
+    }
+  }
+}
+
 // Forward declaration of methods we need for the next test.
 template<typename TreeType, typename MatType>
 bool CheckPointBounds(TreeType& node, const MatType& data);
@@ -1322,6 +1815,133 @@ BOOST_AUTO_TEST_CASE(KdTreeTest)
   BOOST_REQUIRE_EQUAL(root.TreeDepth(), 7);
 }
 
+// Check that every node of the tree has a non-empty left and right child (or
+// none), and, if balanced is true, that the counts of the children differ by at
+// most one.
+template<typename TreeType>
+void CheckSplits(const TreeType& node, const bool balanced)
+{
+  if (node.IsLeaf())
+    return;
+
+  BOOST_REQUIRE_GT(node.Left()->Count(), 0);
+  BOOST_REQUIRE_GT(node.Right()->Count(), 0);
+  BOOST_REQUIRE_EQUAL(node.Left()->Count() + node.Right()->Count(),
+      node.Count());
+  if (balanced)
+    BOOST_REQUIRE_LE(node.Left()->Count() - node.Right()->Count(), 1);
+
+  CheckSplits(*node.Left(), balanced);
+  CheckSplits(*node.Right(), balanced);
+}
+
+// Build a tree with the given split type, and check the mappings, the bounds
+// and the splits.
+template<typename TreeType>
+void CheckSplitType(const arma::mat& data, const bool balanced)
+{
+  arma::mat dataset(data);
+  std::vector<size_t> oldFromNew;
+  std::vector<size_t> newFromOld;
+  TreeType root(dataset, oldFromNew, newFromOld, 10);
+
+  BOOST_REQUIRE_EQUAL(root.Count(), data.n_cols);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    for (size_t j = 0; j < data.n_rows; ++j)
+    {
+      BOOST_REQUIRE_EQUAL(dataset(j, i), data(j, oldFromNew[i]));
+      BOOST_REQUIRE_EQUAL(dataset(j, newFromOld[i]), data(j, i));
+    }
+  }
+
+  BOOST_REQUIRE(CheckPointBounds(root, dataset));
+  CheckSplits(root, balanced);
+
+  // Building without mappings must give the same tree.
+  arma::mat unmappedDataset(data);
+  TreeType unmappedRoot(unmappedDataset, 10);
+  BOOST_REQUIRE_EQUAL(unmappedRoot.TreeSize(), root.TreeSize());
+  BOOST_REQUIRE_EQUAL(arma::accu(unmappedDataset != dataset), 0);
+}
+
+/**
+ * Make sure that a ball bound built from a set of points at once is the ball
+ * around their centroid which just contains them.
+ */
+BOOST_AUTO_TEST_CASE(BallBoundCentroidTest)
+{
+  arma::mat points(3, 100);
+  points.randu();
+
+  BallBound<> bound;
+  bound |= points;
+
+  const arma::vec centroid = arma::mean(points, 1);
+  double radius = 0;
+  for (size_t i = 0; i < points.n_cols; ++i)
+    radius = std::max(radius, arma::norm(points.col(i) - centroid, 2));
+
+  for (size_t i = 0; i < 3; ++i)
+    BOOST_REQUIRE_CLOSE(bound.Center()[i], centroid[i], 1e-5);
+  BOOST_REQUIRE_CLOSE(bound.Radius(), radius, 1e-5);
+  for (size_t i = 0; i < points.n_cols; ++i)
+    BOOST_REQUIRE(bound.Contains(points.col(i)));
+}
+
+/**
+ * Check the other split types of the BinarySpaceTree on clustered data: the
+ * median and vantage point splits must give a balanced tree, the sliding
+ * midpoint split must never leave a child empty (even with ball bounds, which
+ * are not tight), and the PCA split must follow the principal direction of the
+ * data.
+ */
+BOOST_AUTO_TEST_CASE(BinarySpaceTreeSplitTypesTest)
+{
+  // A few tight clusters, with some duplicate points.
+  arma::mat data(4, 1000);
+  data.randn();
+  for (size_t i = 0; i < data.n_cols; ++i)
+    data.col(i) = 0.01 * data.col(i) + (i % 3) * arma::ones<arma::vec>(4);
+  for (size_t i = 0; i < 20; ++i)
+    data.col(990 + i / 2) = data.col(0);
+
+  typedef HRectBound<2> BoundType;
+  CheckSplitType<BinarySpaceTree<BoundType, EmptyStatistic, arma::mat,
+      MeanSplit<BoundType> > >(data, false);
+  CheckSplitType<BinarySpaceTree<BoundType, EmptyStatistic, arma::mat,
+      MedianSplit<BoundType> > >(data, true);
+  CheckSplitType<BinarySpaceTree<BoundType, EmptyStatistic, arma::mat,
+      SlidingMidpointSplit<BoundType> > >(data, false);
+  CheckSplitType<BinarySpaceTree<BoundType, EmptyStatistic, arma::mat,
+      PCASplit<BoundType> > >(data, true);
+  CheckSplitType<BinarySpaceTree<BallBound<>, EmptyStatistic, arma::mat,
+      SlidingMidpointSplit<BallBound<> > > >(data, false);
+  CheckSplitType<BinarySpaceTree<BallBound<>, EmptyStatistic, arma::mat,
+      BallSplit<BallBound<> > > >(data, false);
+  CheckSplitType<BinarySpaceTree<BallBound<>, EmptyStatistic, arma::mat,
+      VPTreeSplit<BallBound<> > > >(data, true);
+  CheckSplitType<BinarySpaceTree<BallBound<arma::vec, ManhattanDistance>,
+      EmptyStatistic, arma::mat, VPTreeSplit<BallBound<arma::vec,
+      ManhattanDistance> > > >(data, true);
+
+  // On points along a diagonal line, the first PCA split divides the line in
+  // half, so one child holds the first half of the line and the other holds
+  // the second half.
+  arma::mat line(3, 200);
+  for (size_t i = 0; i < line.n_cols; ++i)
+    line.col(i) = (double) ((i * 37) % 200) * arma::ones<arma::vec>(3);
+  BinarySpaceTree<BoundType, EmptyStatistic, arma::mat, PCASplit<BoundType> >
+      lineRoot(line, 10);
+  BOOST_REQUIRE_EQUAL(lineRoot.Left()->Count(), 100);
+  const bool firstHalfLeft = (line(0, 0) < 100.0);
+  for (size_t i = 0; i < line.n_cols; ++i)
+  {
+    const bool inLeft = (i < lineRoot.Left()->Count());
+    BOOST_REQUIRE_EQUAL((line(0, i) < 100.0), (inLeft == firstHalfLeft));
+  }
+}
+
 // Recursively checks that each node contains all points that it claims to have.
 template<typename TreeType, typename MatType>
 bool CheckPointBounds(TreeType& node, const MatType& data)
@@ -1734,6 +2354,28 @@ BOOST_AUTO_TEST_CASE(CoverTreeConstructionTest)
   CheckSeparation<CoverTree<>, LMetric<2, true> >(tree, tree);
 }
 
+/**
+ * Create a cover tree with enough points that the distance computations near
+ * the root are split between threads, and make sure it's accurate.
+ */
+BOOST_AUTO_TEST_CASE(CoverTreeLargeConstructionTest)
+{
+  arma::mat dataset;
+  dataset.randu(5, 6000);
+
+  CoverTree<> tree(dataset);
+
+  arma::vec counts;
+  counts.zeros(6000);
+  RecurseTreeCountLeaves(tree, counts);
+
+  for (size_t i = 0; i < 6000; ++i)
+    BOOST_REQUIRE_EQUAL(counts[i], 1);
+
+  CheckSelfChild<CoverTree<> >(tree);
+  CheckCovering<CoverTree<>, LMetric<2, true> >(tree);
+}
+
 /**
  * Test the manual constructor.
  */
@@ -1783,6 +2425,64 @@ BOOST_AUTO_TEST_CASE(CoverTreeAlternateMetricTest)
   CheckSeparation<CoverTree<LMetric<1, true> >, LMetric<1, true> >(tree, tree);
 }
 
+/**
+ * Make sure that a compacted cover tree is identical to the original tree, and
+ * that its nodes are stored contiguously in depth-first order.
+ */
+BOOST_AUTO_TEST_CASE(CoverTreeCompactTest)
+{
+  arma::mat dataset;
+  dataset.randu(4, 1500);
+
+  CoverTree<> tree(dataset);
+  CoverTree<> compactTree(dataset);
+
+  BOOST_REQUIRE(!compactTree.IsCompact());
+  compactTree.Compact();
+  BOOST_REQUIRE(compactTree.IsCompact());
+
+  // Compacting a second time does nothing.
+  compactTree.Compact();
+
+  std::stack<CoverTree<>*> stack, compactStack;
+  stack.push(&tree);
+  compactStack.push(&compactTree);
+  CoverTree<>* last = NULL;
+  while (!stack.empty())
+  {
+    CoverTree<>* node = stack.top();
+    CoverTree<>* compactNode = compactStack.top();
+    stack.pop();
+    compactStack.pop();
+
+    BOOST_REQUIRE_EQUAL(node->Point(), compactNode->Point());
+    BOOST_REQUIRE_EQUAL(node->Scale(), compactNode->Scale());
+    BOOST_REQUIRE_EQUAL(node->NumChildren(), compactNode->NumChildren());
+    BOOST_REQUIRE_EQUAL(node->NumDescendants(), compactNode->NumDescendants());
+    BOOST_REQUIRE_EQUAL(node->ParentDistance(), compactNode->ParentDistance());
+    BOOST_REQUIRE_EQUAL(node->FurthestDescendantDistance(),
+        compactNode->FurthestDescendantDistance());
+    BOOST_REQUIRE(compactNode->IsCompact());
+
+    // Every non-root node must directly follow the previous node in
+    // depth-first order.
+    if (last != NULL)
+      BOOST_REQUIRE(compactNode == last + 1);
+    if (compactNode != &compactTree)
+      last = compactNode;
+
+    // Push the children in reverse, so the first child is visited first.
+    for (size_t i = node->NumChildren(); i > 0; --i)
+    {
+      BOOST_REQUIRE(compactNode->Child(i - 1).Parent() == compactNode);
+      stack.push(&node->Child(i - 1));
+      compactStack.push(&compactNode->Child(i - 1));
+    }
+  }
+
+  CheckCovering<CoverTree<>, LMetric<2, true> >(compactTree);
+}
+
 /**
  * Make sure copy constructor works for the cover tree.
  */
@@ -1997,4 +2697,52 @@ BOOST_AUTO_TEST_CASE(CoverTreeDescendantTest)
   CheckDescendants(&tree);
 }
 
+//! Count the nodes of the tree, and make sure every non-leaf node has at least
+//! two children.
+template<typename TreeType>
+size_t CountExplicitNodes(const TreeType& node)
+{
+  if (node.NumChildren() == 0)
+    return 1;
+
+  BOOST_REQUIRE_GE(node.NumChildren(), 2);
+  size_t count = 1;
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+    count += CountExplicitNodes(node.Child(i));
+
+  return count;
+}
+
+/**
+ * Make sure the cover tree has no implicit nodes (nodes with only a self-child)
+ * and at most 2n - 1 nodes, on data that is clustered at many scales and has
+ * duplicate points, and that this holds for a tree loaded from a stream too.
+ */
+BOOST_AUTO_TEST_CASE(CoverTreeExplicitNodesTest)
+{
+  // Points at 2^-i for i = 0, ..., 39, each of which is the only point at its
+  // scale, plus a tight cluster with duplicates.
+  arma::mat dataset(2, 100);
+  for (size_t i = 0; i < 40; ++i)
+  {
+    dataset(0, i) = std::pow(2.0, -((double) i));
+    dataset(1, i) = 0.0;
+  }
+  for (size_t i = 40; i < 100; ++i)
+  {
+    dataset(0, i) = 5.0 + 1e-6 * (i % 10);
+    dataset(1, i) = 5.0;
+  }
+
+  CoverTree<> tree(dataset);
+  BOOST_REQUIRE_LE(CountExplicitNodes(tree), 2 * dataset.n_cols - 1);
+  BOOST_REQUIRE_EQUAL(NumLeaves(&tree), dataset.n_cols);
+
+  std::stringstream stream;
+  tree.Save(stream);
+  CoverTree<> loadedTree(dataset, stream);
+  BOOST_REQUIRE_EQUAL(CountExplicitNodes(loadedTree),
+      CountExplicitNodes(tree));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -20,6 +20,7 @@
 using namespace mlpack;
 using namespace mlpack::tree;
 using namespace mlpack::metric;
+using namespace mlpack::bound;
 
 BOOST_AUTO_TEST_SUITE(TreeTraitsTest);
 
@@ -36,6 +37,8 @@ BOOST_AUTO_TEST_CASE(DefaultsTraitsTest)
   BOOST_REQUIRE_EQUAL(b, true);
   b = TreeTraits<int>::HasSelfChildren;
   BOOST_REQUIRE_EQUAL(b, false);
+  b = TreeTraits<int>::CanCopyToDataset;
+  BOOST_REQUIRE_EQUAL(b, false);
 }
 
 // Test the binary space tree traits.
@@ -49,6 +52,27 @@ BOOST_AUTO_TEST_CASE(BinarySpaceTreeTraitsTest)
   // Points are not contained at multiple levels.
   b = TreeTraits<BinarySpaceTree<LMetric<2, false> > >::HasSelfChildren;
   BOOST_REQUIRE_EQUAL(b, false);
+
+  // The traits don't depend on the split type.
+  b = TreeTraits<BinarySpaceTree<HRectBound<2>, EmptyStatistic, arma::mat,
+      MedianSplit<HRectBound<2> > > >::RearrangesDataset;
+  BOOST_REQUIRE_EQUAL(b, true);
+
+  // The balls of the children of ball trees and vantage point trees can
+  // overlap.
+  b = TreeTraits<BinarySpaceTree<BallBound<>, EmptyStatistic, arma::mat,
+      VPTreeSplit<BallBound<> > > >::HasOverlappingChildren;
+  BOOST_REQUIRE_EQUAL(b, true);
+  b = TreeTraits<BinarySpaceTree<BallBound<>, EmptyStatistic, arma::mat,
+      BallSplit<BallBound<> > > >::RearrangesDataset;
+  BOOST_REQUIRE_EQUAL(b, true);
+
+  // Binary space trees can be copied to refer to another dataset.
+  b = TreeTraits<BinarySpaceTree<HRectBound<2> > >::CanCopyToDataset;
+  BOOST_REQUIRE_EQUAL(b, true);
+  b = TreeTraits<BinarySpaceTree<BallBound<>, EmptyStatistic, arma::mat,
+      BallSplit<BallBound<> > > >::CanCopyToDataset;
+  BOOST_REQUIRE_EQUAL(b, true);
 }
 
 // Test the cover tree traits.
@@ -61,6 +85,10 @@ BOOST_AUTO_TEST_CASE(CoverTreeTraitsTest)
   // The cover tree has self-children.
   b = TreeTraits<CoverTree<> >::HasSelfChildren;
   BOOST_REQUIRE_EQUAL(b, true);
+
+  // The cover tree cannot be copied to refer to another dataset.
+  b = TreeTraits<CoverTree<> >::CanCopyToDataset;
+  BOOST_REQUIRE_EQUAL(b, false);
 }
 
 BOOST_AUTO_TEST_SUITE_END();
@@ -46,4 +46,30 @@ BOOST_AUTO_TEST_CASE(TestUnion)
   BOOST_REQUIRE(testUnionFind_.Find(6) == testUnionFind_.Find(3));
 }
 
+BOOST_AUTO_TEST_CASE(TestFlatten)
+{
+  static const size_t testSize_ = 10;
+  UnionFind testUnionFind_(testSize_);
+
+  testUnionFind_.Union(0, 1);
+  testUnionFind_.Union(2, 3);
+  testUnionFind_.Union(0, 2);
+  testUnionFind_.Union(7, 8);
+
+  // Record the components before flattening.
+  std::vector<size_t> components(testSize_);
+  for (size_t i = 0; i < testSize_; i++)
+    components[i] = testUnionFind_.Find(i);
+
+  testUnionFind_.Flatten(2);
+
+  // The components must not change, and the read-only Find() must agree.
+  const UnionFind& constUnionFind_ = testUnionFind_;
+  for (size_t i = 0; i < testSize_; i++)
+  {
+    BOOST_REQUIRE(testUnionFind_.Find(i) == components[i]);
+    BOOST_REQUIRE(constUnionFind_.Find(i) == components[i]);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();